@@ -25,11 +25,25 @@
 /// -t Throughput test
 /// -p Publish node
 /// -r Reply node
+/// -rate Messages per second of the latency test, sent at fixed times
+///       instead of after each reply
+/// -format Output format: tsv (default), csv or json
+/// -hist Latency histogram file
+/// -delay Relay node: time each reply is held, in milliseconds
+/// -jitter Relay node: random variation of the hold time, in milliseconds
+/// -loss Relay node: percentage of latency messages dropped
 ///
 /// Choose one of [-l, -t], and one (or none for in-process
 /// testing) [-p,-r].
 ///
-/// See `latency.gp` and `throughput.gp` to plot output.
+/// See `latency.gp` and `throughput.gp` to plot output (tsv or csv).
+///
+/// -delay, -jitter and -loss emulate a lossy link, e.g. Wi-Fi, in the relay
+/// node, without privileges. The replies keep their order, as on a TCP
+/// connection, and the latency reported (half of the round trip) grows by
+/// half of the hold time. The messages without reply count as lost. See
+/// `netem.bash` to emulate the link in the kernel instead, below the
+/// transport.
 //////////////////////////////////////////////////
 
 #ifdef __linux__
@@ -38,15 +52,24 @@
 
 #include <gflags/gflags.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <iomanip>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <csignal>
+#include <ctime>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <thread>
 #include <mutex>
+#include <random>
+#include <sstream>
+#include <utility>
 #include <vector>
 #include <ignition/msgs.hh>
 #include <ignition/transport.hh>
@@ -59,11 +82,268 @@ DEFINE_bool(p, false, "Publishing node");
 DEFINE_uint64(f, 0, "Flood the network with extra publishers and subscribers");
 DEFINE_uint64(i, 1000, "Number of iterations");
 DEFINE_string(o, "", "Output filename");
+DEFINE_double(rate, 0, "Latency testing: messages per second sent at fixed "
+    "times, measured from the time each one should have been sent. 0 to send "
+    "each message after the reply to the previous one");
+DEFINE_string(format, "tsv", "Output format: tsv, csv or json");
+DEFINE_string(hist, "", "Latency testing: output filename of the histograms "
+    "of each message size, in the percentile format of HdrHistogram");
+DEFINE_double(delay, 0, "Relay node: time each reply is held (ms)");
+DEFINE_double(jitter, 0, "Relay node: random variation of the hold time, "
+    "uniform in [-jitter, jitter] (ms)");
+DEFINE_double(loss, 0, "Relay node: percentage of latency messages dropped");
+
+/// \brief Longest wait for the reply of a latency message.
+static const std::chrono::seconds kReplyTimeout(1);
 
 std::condition_variable gCondition;
 std::mutex gMutex;
 bool gStop = false;
 
+/// \brief Histogram of latencies with a bounded relative error, like an HDR
+/// histogram. The values are grouped by power of two, and each group is
+/// split into kHalfBuckets linear buckets, so a value is recorded with an
+/// error below 1/kHalfBuckets, whatever its magnitude.
+class LatencyHistogram
+{
+  /// \brief Record a value.
+  /// \param[in] _value The value, in nanoseconds.
+  public: void Record(const uint64_t _value)
+  {
+    const std::size_t index = Index(_value);
+    if (index >= this->counts.size())
+      this->counts.resize(index + 1, 0);
+    ++this->counts[index];
+    ++this->count;
+    this->sum += _value;
+    this->min = std::min(this->min, _value);
+    this->max = std::max(this->max, _value);
+  }
+
+  /// \brief Remove all the values.
+  public: void Reset()
+  {
+    *this = LatencyHistogram();
+  }
+
+  /// \brief Get the number of values.
+  /// \return The number of values.
+  public: uint64_t Count() const
+  {
+    return this->count;
+  }
+
+  /// \brief Get the mean of the values.
+  /// \return The mean, or 0 without values.
+  public: double Mean() const
+  {
+    return this->count == 0 ? 0 : static_cast<double>(this->sum) / this->count;
+  }
+
+  /// \brief Get the smallest value.
+  /// \return The value, or 0 without values.
+  public: uint64_t Min() const
+  {
+    return this->count == 0 ? 0 : this->min;
+  }
+
+  /// \brief Get the biggest value.
+  /// \return The value.
+  public: uint64_t Max() const
+  {
+    return this->max;
+  }
+
+  /// \brief Get a percentile of the values.
+  /// \param[in] _percentile The percentile, between 0 and 100.
+  /// \return The value, or 0 without values.
+  public: uint64_t Percentile(const double _percentile) const
+  {
+    if (this->count == 0)
+      return 0;
+
+    const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(
+      std::ceil(_percentile / 100.0 * this->count)));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < this->counts.size(); ++i)
+    {
+      seen += this->counts[i];
+      if (seen >= target)
+        return std::min(std::max(Value(i), this->min), this->max);
+    }
+    return this->max;
+  }
+
+  /// \brief Output the percentile distribution like HdrHistogram does, so
+  /// the tools plotting HdrHistogram files can read it.
+  /// \param[in] _stream Output stream.
+  /// \param[in] _scale Divisor of the values, e.g. 1000 for microseconds.
+  public: void OutputPercentiles(std::ostream &_stream,
+                                 const double _scale) const
+  {
+    _stream << std::setw(12) << "Value" << std::setw(15) << "Percentile"
+            << std::setw(11) << "TotalCount" << std::setw(17)
+            << "1/(1-Percentile)" << "\n\n";
+
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < this->counts.size(); ++i)
+    {
+      if (this->counts[i] == 0)
+        continue;
+      seen += this->counts[i];
+      const double fraction = static_cast<double>(seen) / this->count;
+      _stream << std::fixed << std::setprecision(3) << std::setw(12)
+              << std::min(Value(i), this->max) / _scale
+              << std::setprecision(12) << std::setw(15) << fraction
+              << std::setw(11) << seen;
+      if (seen < this->count)
+      {
+        _stream << std::setprecision(2) << std::setw(17)
+                << 1.0 / (1.0 - fraction);
+      }
+      _stream << "\n";
+    }
+    _stream << "#[Mean    = " << std::setprecision(3) << this->Mean() / _scale
+            << ", Max     = " << this->Max() / _scale << "]\n"
+            << "#[Total count    = " << this->count << "]\n";
+  }
+
+  /// \brief Get the bucket of a value.
+  /// \param[in] _value The value.
+  /// \return Index of the bucket.
+  private: static std::size_t Index(const uint64_t _value)
+  {
+    if (_value < 2 * kHalfBuckets)
+      return static_cast<std::size_t>(_value);
+
+    // Shift the value to [kHalfBuckets, 2 * kHalfBuckets).
+    std::size_t shift = 0;
+    while ((_value >> shift) >= 2 * kHalfBuckets)
+      ++shift;
+    return static_cast<std::size_t>(
+      2 * kHalfBuckets + (shift - 1) * kHalfBuckets +
+      ((_value >> shift) - kHalfBuckets));
+  }
+
+  /// \brief Get the value in the middle of a bucket.
+  /// \param[in] _index Index of the bucket.
+  /// \return The value.
+  private: static uint64_t Value(const std::size_t _index)
+  {
+    if (_index < 2 * kHalfBuckets)
+      return _index;
+
+    const std::size_t shift = (_index - 2 * kHalfBuckets) / kHalfBuckets + 1;
+    const uint64_t sub = (_index - 2 * kHalfBuckets) % kHalfBuckets +
+      kHalfBuckets;
+    return (sub << shift) + ((uint64_t(1) << shift) >> 1);
+  }
+
+  /// \brief Number of buckets of each power of two, which bounds the
+  /// relative error of the values.
+  private: static constexpr uint64_t kHalfBuckets = 64;
+
+  /// \brief Number of values of each bucket.
+  private: std::vector<uint64_t> counts;
+
+  /// \brief Number of values.
+  private: uint64_t count = 0;
+
+  /// \brief Sum of the values.
+  private: uint64_t sum = 0;
+
+  /// \brief Smallest value.
+  private: uint64_t min = std::numeric_limits<uint64_t>::max();
+
+  /// \brief Biggest value.
+  private: uint64_t max = 0;
+};
+
+/// \brief Writes the results of a test as tab or comma separated values,
+/// with the metadata in comments, which the gnuplot scripts read, or as a
+/// JSON document.
+class ResultWriter
+{
+  /// \brief Start the results.
+  /// \param[in] _stream Output stream.
+  /// \param[in] _format Output format: tsv, csv or json.
+  /// \param[in] _metadata Description of the test, as key and value.
+  /// \param[in] _columns Names of the columns.
+  public: ResultWriter(std::ostream &_stream, const std::string &_format,
+              const std::vector<std::pair<std::string, std::string>>
+                &_metadata,
+              const std::vector<std::string> &_columns)
+    : stream(_stream), json(_format == "json"), columns(_columns)
+  {
+    const std::string separator = _format == "csv" ? "," : "\t";
+    if (this->json)
+    {
+      this->stream << "{\n";
+      for (const auto &entry : _metadata)
+      {
+        this->stream << "  \"" << entry.first << "\": \"" << entry.second
+                     << "\",\n";
+      }
+      this->stream << "  \"results\": [";
+      return;
+    }
+
+    for (const auto &entry : _metadata)
+      this->stream << "# " << entry.second << "\n";
+
+    this->stream << "#";
+    for (std::size_t i = 0; i < this->columns.size(); ++i)
+      this->stream << (i == 0 ? " " : separator) << this->columns[i];
+    this->stream << std::endl;
+    this->separator = separator;
+  }
+
+  /// \brief Destructor, ends the results.
+  public: ~ResultWriter()
+  {
+    if (this->json)
+      this->stream << (this->rows == 0 ? "" : "\n  ") << "]\n}" << std::endl;
+  }
+
+  /// \brief Write the values of a row, in the order of the columns.
+  /// \param[in] _values The values.
+  public: void Row(const std::vector<std::string> &_values)
+  {
+    if (this->json)
+    {
+      this->stream << (this->rows == 0 ? "\n" : ",\n") << "    {";
+      for (std::size_t i = 0; i < _values.size(); ++i)
+      {
+        this->stream << (i == 0 ? "" : ", ") << "\"" << this->columns[i]
+                     << "\": " << _values[i];
+      }
+      this->stream << "}";
+    }
+    else
+    {
+      for (std::size_t i = 0; i < _values.size(); ++i)
+        this->stream << (i == 0 ? "" : this->separator) << _values[i];
+      this->stream << std::endl;
+    }
+    ++this->rows;
+  }
+
+  /// \brief Output stream.
+  private: std::ostream &stream;
+
+  /// \brief True for the JSON format.
+  private: bool json;
+
+  /// \brief Names of the columns.
+  private: std::vector<std::string> columns;
+
+  /// \brief Separator of the values.
+  private: std::string separator;
+
+  /// \brief Number of rows written.
+  private: std::size_t rows = 0;
+};
+
 /// \brief A class that subscribes to all of the `/benchmark/flood/*`
 /// topics. FloodSub and FloodPub can be enabled with the `-f <num>` command
 /// line argument. Flooding adds <num> extra publishers and subscribers. The
@@ -164,6 +444,146 @@ class FloodPub
   private: std::vector<ignition::transport::Node::Publisher> floodPubs;
 };
 
+/// \brief Emulation of a lossy link in the relay node. Each message is
+/// held for the delay plus a random jitter before its publication, or
+/// dropped. The messages are published in order by a thread of their own.
+class LinkEmulator
+{
+  /// \brief Constructor.
+  /// \param[in] _delay Hold time of each message in milliseconds.
+  /// \param[in] _jitter Random variation of the hold time in milliseconds,
+  /// uniform in [-_jitter, _jitter].
+  /// \param[in] _loss Percentage of droppable messages dropped.
+  public: LinkEmulator(const double _delay, const double _jitter,
+                       const double _loss)
+    : delay(_delay),
+      jitter(_jitter),
+      loss(_loss / 100.0),
+      enabled(_delay > 0 || _jitter > 0 || _loss > 0)
+  {
+    if (this->enabled)
+      this->thread = std::thread(&LinkEmulator::Run, this);
+  }
+
+  /// \brief Destructor. The messages still held are dropped.
+  public: ~LinkEmulator()
+  {
+    if (!this->enabled)
+      return;
+
+    {
+      std::lock_guard<std::mutex> lk(this->mutex);
+      this->done = true;
+    }
+    this->condition.notify_all();
+    this->thread.join();
+  }
+
+  /// \brief Publish a message through the emulated link.
+  /// \param[in] _pub The publisher.
+  /// \param[in] _msg The message.
+  /// \param[in] _droppable Whether the message can be dropped.
+  public: void Publish(ignition::transport::Node::Publisher &_pub,
+                       const ignition::msgs::Bytes &_msg,
+                       const bool _droppable)
+  {
+    if (!this->enabled)
+    {
+      _pub.Publish(_msg);
+      return;
+    }
+
+    std::lock_guard<std::mutex> lk(this->mutex);
+    if (_droppable && this->uniform(this->random) < this->loss)
+      return;
+
+    const double holdMs = std::max(0.0, this->delay +
+      this->jitter * (2 * this->uniform(this->random) - 1));
+    const auto deadline = std::max(this->lastDeadline,
+      std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(holdMs)));
+    this->lastDeadline = deadline;
+    this->held.push_back({deadline, &_pub, _msg});
+    this->condition.notify_all();
+  }
+
+  /// \brief Publish the held messages when their time comes.
+  private: void Run()
+  {
+    std::unique_lock<std::mutex> lk(this->mutex);
+    while (!this->done)
+    {
+      if (this->held.empty())
+      {
+        this->condition.wait(lk);
+        continue;
+      }
+
+      if (this->condition.wait_until(lk, this->held.front().deadline) !=
+          std::cv_status::timeout)
+      {
+        continue;
+      }
+
+      Held next = std::move(this->held.front());
+      this->held.pop_front();
+      lk.unlock();
+      next.pub->Publish(next.msg);
+      lk.lock();
+    }
+  }
+
+  /// \brief A message held by the link.
+  private: struct Held
+  {
+    /// \brief Time of the publication.
+    std::chrono::steady_clock::time_point deadline;
+
+    /// \brief The publisher.
+    ignition::transport::Node::Publisher *pub;
+
+    /// \brief The message.
+    ignition::msgs::Bytes msg;
+  };
+
+  /// \brief Hold time in milliseconds.
+  private: const double delay;
+
+  /// \brief Jitter of the hold time in milliseconds.
+  private: const double jitter;
+
+  /// \brief Probability of dropping a message.
+  private: const double loss;
+
+  /// \brief Whether the link is emulated at all.
+  private: const bool enabled;
+
+  /// \brief Held messages, by deadline.
+  private: std::deque<Held> held;
+
+  /// \brief Deadline of the last held message, to keep the order.
+  private: std::chrono::steady_clock::time_point lastDeadline;
+
+  /// \brief Random numbers of the jitter and the losses.
+  private: std::mt19937 random{std::random_device{}()};
+
+  /// \brief Uniform distribution in [0, 1).
+  private: std::uniform_real_distribution<double> uniform{0.0, 1.0};
+
+  /// \brief Protects the members above.
+  private: std::mutex mutex;
+
+  /// \brief Signaled when a message is held or on destruction.
+  private: std::condition_variable condition;
+
+  /// \brief Set on destruction.
+  private: bool done = false;
+
+  /// \brief Thread publishing the held messages.
+  private: std::thread thread;
+};
+
 /// \brief The ReplyTester subscribes to the benchmark topics, and relays
 /// incoming messages on a corresponding "reply" topic.
 ///
@@ -240,14 +660,15 @@ class ReplyTester
     this->prevStamp = _msg.header().stamp().sec();
     // Debug:: std::cout << _msg.header().stamp().sec() << std::endl;
 
-    this->throughputPub.Publish(_msg);
+    // Not dropped, the throughput test waits for all the messages.
+    this->link.Publish(this->throughputPub, _msg, false);
   }
 
   /// \brief Function called each time a latency message is received.
   /// \param[in] _msg Incoming message of variable size.
   private: void LatencyCb(const ignition::msgs::Bytes &_msg)
   {
-    this->latencyPub.Publish(_msg);
+    this->link.Publish(this->latencyPub, _msg, true);
   }
 
   /// \brief The transport node
@@ -260,6 +681,10 @@ class ReplyTester
   private: ignition::transport::Node::Publisher latencyPub;
 
   private: int prevStamp = 0;
+
+  /// \brief The emulated link of the replies. Declared last, so it stops
+  /// before the publishers go away.
+  private: LinkEmulator link{FLAGS_delay, FLAGS_jitter, FLAGS_loss};
 };
 
 /// \brief The PubTester is used to collect data on latency or throughput.
@@ -300,6 +725,29 @@ class PubTester
     this->sentMsgs = _iters;
   }
 
+  /// \brief Set the rate of the latency test.
+  /// \param[in] _rate Messages per second, or 0 to send each message after
+  /// the reply to the previous one.
+  public: void SetRate(const double _rate)
+  {
+    this->rate = _rate;
+  }
+
+  /// \brief Set the output format.
+  /// \param[in] _format tsv, csv or json.
+  public: void SetFormat(const std::string &_format)
+  {
+    this->format = _format;
+  }
+
+  /// \brief Set the filename of the latency histograms. Use empty string
+  /// to not output them.
+  /// \param[in] _filename Histograms filename
+  public: void SetHistogramFilename(const std::string &_filename)
+  {
+    this->histFilename = _filename;
+  }
+
   /// \brief Create the publishers and subscribers.
   public: void Init()
   {
@@ -355,24 +803,52 @@ class PubTester
     this->condition.notify_all();
   }
 
-  /// \brief Output header information
-  /// \param[in] _stream Stream pointer
-  private: void OutputHeader(std::ostream *_stream)
+  /// \brief Describe the test, so that the results can be reproduced.
+  /// \param[in] _test Name of the test.
+  /// \return The description, as key and value.
+  private: std::vector<std::pair<std::string, std::string>> Metadata(
+               const std::string &_test) const
   {
+    std::vector<std::pair<std::string, std::string>> metadata;
+
     std::time_t t = std::time(NULL);
     std::tm tm = *std::localtime(&t);
-
-    (*_stream) << "# " << std::put_time(&tm, "%FT%T%Z") << std::endl;
-    (*_stream) << "# Ignition Transport Version "
-               << IGNITION_TRANSPORT_VERSION_FULL << std::endl;
+    std::ostringstream date;
+    date << std::put_time(&tm, "%FT%T%Z");
+    metadata.push_back({"date", date.str()});
+    metadata.push_back({"version", std::string("Ignition Transport Version ") +
+      IGNITION_TRANSPORT_VERSION_FULL});
 
 #ifdef __linux__
     struct utsname unameData;
     uname(&unameData);
-    (*_stream) << "# " << unameData.sysname << " " << unameData.release
-               << " " << unameData.version << " " << unameData.machine
-               << std::endl;
+    metadata.push_back({"system", std::string(unameData.sysname) + " " +
+      unameData.release + " " + unameData.version + " " +
+      unameData.machine});
 #endif
+
+    std::string settings = _test + ", " + std::to_string(this->sentMsgs) +
+      " messages per size";
+    if (_test == "latency")
+    {
+      settings += this->rate > 0 ?
+        ", sent at " + std::to_string(this->rate) + " messages/s" :
+        ", each one sent after the previous reply";
+    }
+    metadata.push_back({"test", settings});
+    return metadata;
+  }
+
+  /// \brief Get the output stream.
+  /// \param[in] _fstream File stream to use if there is an output file.
+  /// \return The output stream.
+  private: std::ostream &Output(std::ofstream &_fstream)
+  {
+    if (this->filename.empty())
+      return std::cout;
+
+    _fstream.open(this->filename);
+    return _fstream;
   }
 
   /// \brief Measure throughput. The output contains three columns:
@@ -390,19 +866,9 @@ class PubTester
     if (this->stop)
       return;
 
-    std::ostream *stream = &std::cout;
     std::ofstream fstream;
-
-    if (!this->filename.empty())
-    {
-      fstream.open(this->filename);
-      stream = &fstream;
-    }
-
-    this->OutputHeader(stream);
-
-    // Column headers.
-    (*stream) << "# Test\tSize(B)\t\tMB/s\t\tKmsg/s\n";
+    ResultWriter writer(this->Output(fstream), this->format,
+      this->Metadata("throughput"), {"Test", "Size(B)", "MB/s", "Kmsg/s"});
 
     int testNum = 1;
     // Iterate over each of the message sizes
@@ -444,16 +910,25 @@ class PubTester
       double seconds = (duration * 1e-6);
 
       // Output the data
-      (*stream) << std::fixed << testNum++ << "\t" << this->dataSize << "\t\t"
-                << (this->totalBytes * 1e-6) / seconds << "\t"
-                << (this->msgCount * 1e-3) / seconds << "\t" <<  std::endl;
+      writer.Row({std::to_string(testNum++), std::to_string(this->dataSize),
+                  std::to_string((this->totalBytes * 1e-6) / seconds),
+                  std::to_string((this->msgCount * 1e-3) / seconds)});
       this->expectedStamp = 0;
     }
   }
 
-  /// \brief Measure latency. The output contains two columns:
-  ///    1. Message size in bytes.
-  ///    2. Latency in microseconds.
+  /// \brief Measure latency, as half of the round trip time of the
+  /// messages. The output contains a row per message size, with the test
+  /// number, the size in bytes, the average, minimum and maximum latencies,
+  /// the 50th, 90th, 99th and 99.9th percentiles in microseconds, and the
+  /// number of messages without reply.
+  ///
+  /// Without rate, each message is sent after the reply to the previous
+  /// one. With a rate, the messages are sent at fixed times whatever the
+  /// replies, and the latency of each one is measured from the time it
+  /// should have been sent. So a stall delays the latency of all the
+  /// messages that should have been sent meanwhile, instead of just one
+  /// (coordinated omission).
   public: void Latency()
   {
     // Wait for subscriber
@@ -465,22 +940,16 @@ class PubTester
     if (this->stop)
       return;
 
-    std::ostream *stream = &std::cout;
     std::ofstream fstream;
+    ResultWriter writer(this->Output(fstream), this->format,
+      this->Metadata("latency"),
+      {"Test", "Size(B)", "Avg_(us)", "Min_(us)", "Max_(us)", "P50_(us)",
+       "P90_(us)", "P99_(us)", "P99.9_(us)", "Lost"});
 
-    if (!this->filename.empty())
-    {
-      fstream.open(this->filename);
-      stream = &fstream;
-    }
+    std::ofstream histStream;
+    if (!this->histFilename.empty())
+      histStream.open(this->histFilename);
 
-    this->OutputHeader(stream);
-
-    // Column headers.
-    (*stream) << "# Test\tSize(B)\tAvg_(us)\tMin_(us)\tMax_(us)\n";
-
-    uint64_t maxLatency = 0;
-    uint64_t minLatency = std::numeric_limits<uint64_t>::max();
     int testNum = 1;
     // Iterate over each of the message sizes
     for (auto msgSize : this->msgSizes)
@@ -490,46 +959,105 @@ class PubTester
 
       // Create the message of the given size
       this->PrepMsg(msgSize);
+      this->histogram.Reset();
+
+      if (this->rate > 0)
+        this->LatencyOpenLoop();
+      else
+        this->LatencyClosedLoop();
+
+      std::lock_guard<std::mutex> lk(this->mutex);
+      auto us = [](const double _ns) {return std::to_string(_ns * 1e-3);};
+      writer.Row({std::to_string(testNum++), std::to_string(this->dataSize),
+                  us(this->histogram.Mean()), us(this->histogram.Min()),
+                  us(this->histogram.Max()),
+                  us(this->histogram.Percentile(50)),
+                  us(this->histogram.Percentile(90)),
+                  us(this->histogram.Percentile(99)),
+                  us(this->histogram.Percentile(99.9)),
+                  std::to_string(this->sentMsgs - this->histogram.Count())});
+
+      if (histStream.is_open())
+      {
+        histStream << "# Size(B) " << this->dataSize << ", microseconds\n";
+        this->histogram.OutputPercentiles(histStream, 1e3);
+        histStream << "\n";
+      }
+    }
+  }
 
-      uint64_t sum = 0;
+  /// \brief Send each message after the reply to the previous one.
+  private: void LatencyClosedLoop()
+  {
+    this->openLoop = false;
 
-      // Send each message.
-      for (int i = 0; i < this->sentMsgs && !this->stop; ++i)
-      {
-        // Lock so that we wait on a condition variable.
-        std::unique_lock<std::mutex> lk(this->mutex);
+    // Send each message.
+    for (uint64_t i = 0; i < this->sentMsgs && !this->stop; ++i)
+    {
+      // Lock so that we wait on a condition variable.
+      std::unique_lock<std::mutex> lk(this->mutex);
 
-        // Start the clock
-        auto timeStart = std::chrono::high_resolution_clock::now();
-        this->timeEnd = timeStart;
+      // Start the clock
+      auto timeStart = std::chrono::high_resolution_clock::now();
+      this->timeEnd = timeStart;
 
-        // Send the message.
-        this->latencyPub.Publish(this->msg);
+      // Send the message. Its number tells the late replies apart.
+      this->expectedReply = i;
+      this->msg.mutable_header()->mutable_stamp()->set_sec(i);
+      this->latencyPub.Publish(this->msg);
 
-        // Wait for the response.
-        this->condition.wait(lk, [this, &timeStart] {
-            return gStop || this->timeEnd > timeStart;});
+      // Wait for the response. Without it, the message is lost.
+      if (!this->condition.wait_for(lk, kReplyTimeout, [this, &timeStart] {
+            return gStop || this->timeEnd > timeStart;}) || gStop)
+      {
+        continue;
+      }
 
-        // Compute the number of microseconds
-        uint64_t duration =
-          std::chrono::duration_cast<std::chrono::microseconds>(
-              this->timeEnd - timeStart).count();
+      // Half of the round trip, in nanoseconds
+      this->histogram.Record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          this->timeEnd - timeStart).count() / 2);
+    }
+  }
+
+  /// \brief Send the messages at fixed times, without waiting for the
+  /// replies.
+  private: void LatencyOpenLoop()
+  {
+    {
+      std::lock_guard<std::mutex> lk(this->mutex);
+      this->openLoop = true;
+      this->intendedTimes.assign(this->sentMsgs, {});
+      this->sendTimes.assign(this->sentMsgs, {});
+    }
 
-        if (duration > maxLatency)
-          maxLatency = duration;
-        if (duration < minLatency)
-          minLatency = duration;
+    const auto period = std::chrono::duration_cast<
+      std::chrono::high_resolution_clock::duration>(
+        std::chrono::duration<double>(1.0 / this->rate));
+    const auto start = std::chrono::high_resolution_clock::now();
 
-        // Add to the sum of microseconds
-        sum += duration;
+    for (uint64_t i = 0; i < this->sentMsgs && !this->stop; ++i)
+    {
+      // Don't skip the messages that are late, they are sent at once.
+      const auto intended = start + i * period;
+      std::this_thread::sleep_until(intended);
+
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->intendedTimes[i] = intended;
+        this->sendTimes[i] = std::chrono::high_resolution_clock::now();
       }
 
-      // Output data.
-      (*stream) << std::fixed << testNum++ << "\t" << this->dataSize << "\t"
-                << (sum / static_cast<double>(this->sentMsgs)) * 0.5 << "\t"
-                << minLatency * 0.5 << "\t"
-                << maxLatency * 0.5 << std::endl;
+      // The reply may be received before Publish() returns.
+      this->msg.mutable_header()->mutable_stamp()->set_sec(i);
+      this->latencyPub.Publish(this->msg);
     }
+
+    // Wait for the last replies, for one second at most.
+    std::unique_lock<std::mutex> lk(this->mutex);
+    this->condition.wait_for(lk, std::chrono::seconds(1), [this] {
+        return gStop || this->histogram.Count() >= this->sentMsgs;});
+    this->openLoop = false;
   }
 
   /// \brief Callback that handles throughput replies
@@ -566,11 +1094,31 @@ class PubTester
   private: void LatencyCb(const ignition::msgs::Bytes &_msg)
   {
     // End the time.
-    this->timeEnd = std::chrono::high_resolution_clock::now();
+    const auto now = std::chrono::high_resolution_clock::now();
 
     // Lock and notify
     std::unique_lock<std::mutex> lk(this->mutex);
 
+    if (!this->openLoop)
+    {
+      if (_msg.header().stamp().sec() != this->expectedReply)
+        return;
+      this->timeEnd = now;
+    }
+    else
+    {
+      const int64_t i = _msg.header().stamp().sec();
+      if (i < 0 || static_cast<uint64_t>(i) >= this->sendTimes.size())
+        return;
+
+      // Half of the round trip, plus the time the message waited to be
+      // sent.
+      const auto sent = this->sendTimes[i];
+      this->histogram.Record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          (now - sent) / 2 + (sent - this->intendedTimes[i])).count());
+    }
+
     this->condition.notify_all();
   }
 
@@ -635,7 +1183,36 @@ class PubTester
   /// \brief Output filename or empty string for console output.
   private: std::string filename = "";
 
+  /// \brief Output format: tsv, csv or json.
+  private: std::string format = "tsv";
+
+  /// \brief Histograms filename or empty string for no histograms.
+  private: std::string histFilename = "";
+
+  /// \brief Messages per second of the latency test, 0 for closed loop.
+  private: double rate = 0;
+
+  /// \brief True while the latency test runs in open loop.
+  private: bool openLoop = false;
+
+  /// \brief Latencies of the current message size, in nanoseconds.
+  private: LatencyHistogram histogram;
+
+  /// \brief Times when the messages of the open loop latency test should
+  /// have been sent, by message number.
+  private: std::vector<std::chrono::high_resolution_clock::time_point>
+    intendedTimes;
+
+  /// \brief Times when the messages of the open loop latency test were
+  /// sent, by message number.
+  private: std::vector<std::chrono::high_resolution_clock::time_point>
+    sendTimes;
+
   private: int expectedStamp = 0;
+
+  /// \brief Number of the message whose reply the closed loop latency test
+  /// waits for.
+  private: int64_t expectedReply = 0;
 };
 
 // The PubTester is global so that the signal handler can easily kill it.
@@ -671,6 +1248,13 @@ int main(int argc, char **argv)
   usage += " Example interprocess throughput:\n";
   usage += " \tTerminal 1: ./bench -t -r\n";
   usage += " \tTerminal 2: ./bench -t -p\n";
+  usage += " Example interprocess latency at 1000 messages/s, as CSV:\n";
+  usage += " \tTerminal 1: ./bench -l -r\n";
+  usage += " \tTerminal 2: ./bench -l -p -rate 1000 -format csv";
+  usage += " -o latency.csv -hist latency.hgrm\n";
+  usage += " Example interprocess latency over an emulated Wi-Fi link:\n";
+  usage += " \tTerminal 1: ./bench -l -r -delay 4 -jitter 3 -loss 1\n";
+  usage += " \tTerminal 2: ./bench -l -p -rate 100\n";
 
   gflags::SetUsageMessage(usage);
 
@@ -690,6 +1274,16 @@ int main(int argc, char **argv)
   // Set the number of iterations.
   gPubTester.SetIterations(FLAGS_i);
   gPubTester.SetOutputFilename(FLAGS_o);
+  gPubTester.SetRate(FLAGS_rate);
+  gPubTester.SetFormat(FLAGS_format);
+  gPubTester.SetHistogramFilename(FLAGS_hist);
+
+  if (FLAGS_format != "tsv" && FLAGS_format != "csv" &&
+      FLAGS_format != "json")
+  {
+    std::cerr << "Invalid format [" << FLAGS_format << "]" << std::endl;
+    return -1;
+  }
 
   // Run the responder
   if (FLAGS_r)
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+//////////////////////////////////////////////////
+/// Usage: ./bench_discovery <options>
+///
+/// Measures how the discovery scales with the number of peers. It starts
+/// many discovery instances in this process, all on the loopback interface
+/// (unless IGN_IP says otherwise), each one advertising some topics as a
+/// process of its own would, plus an observer which advertises nothing.
+/// It reports:
+///
+/// * the convergence time: from the start of the peers until the observer,
+///   and then every peer, know all the publishers.
+/// * the CPU time of the process per heartbeat sent and per heartbeat
+///   received, at steady state.
+/// * the growth of the resident memory, per peer and per publisher known
+///   by a discovery instance, which is dominated by their TopicStorage.
+///
+/// Options:
+///
+/// -peers     Number of simulated peers. Default: 200
+/// -topics    Topics advertised by each peer. Default: 20
+/// -heartbeat Heartbeat interval of the peers in milliseconds. Default: 1000
+/// -duration  Steady state measurement time in seconds. Default: 10
+/// -timeout   Longest convergence time in seconds. Default: 60
+/// -port      UDP port of the discovery traffic, so it doesn't reach the
+///            other programs. Default: 11350
+///
+/// Every peer has a reception thread and a few sockets, so thousands of
+/// peers need a high limit of open files (ulimit -n), which this program
+/// tries to raise. The options of the discovery set with environment
+/// variables (e.g. IGN_DISCOVERY_COMPACT) apply to all the peers. Only
+/// supported on POSIX systems.
+//////////////////////////////////////////////////
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+#include <ignition/transport.hh>
+#include <ignition/transport/Discovery.hh>
+
+DEFINE_bool(h, false, "Show help");
+DEFINE_uint64(peers, 200, "Number of simulated peers");
+DEFINE_uint64(topics, 20, "Topics advertised by each peer");
+DEFINE_uint64(heartbeat, 1000, "Heartbeat interval of the peers (ms)");
+DEFINE_double(duration, 10.0, "Steady state measurement time (s)");
+DEFINE_double(timeout, 60.0, "Longest convergence time (s)");
+DEFINE_int32(port, 11350, "UDP port of the discovery traffic");
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Multicast group of the benchmark.
+static const char kMulticastGroup[] = "239.255.0.7";
+
+#ifndef _WIN32
+//////////////////////////////////////////////////
+/// \brief CPU time used by this process, user and system.
+/// \return The time in seconds.
+static double cpuTime()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+    static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) *
+    1e-6;
+}
+
+//////////////////////////////////////////////////
+/// \brief Resident memory of this process, only known on Linux.
+/// \return The memory in bytes, or 0 if unknown.
+static uint64_t residentMemory()
+{
+  std::ifstream statm("/proc/self/statm");
+  uint64_t size = 0;
+  uint64_t resident = 0;
+  if (!(statm >> size >> resident))
+    return 0;
+  return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+//////////////////////////////////////////////////
+/// \brief Raise the limit of open files as much as allowed.
+static void raiseFileLimit()
+{
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+  {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+#endif
+
+//////////////////////////////////////////////////
+/// \brief A simulated peer: a discovery instance and the number of
+/// publishers of the other peers that it discovered.
+class Peer
+{
+  /// \brief Constructor.
+  /// \param[in] _index Index of the peer, part of its topic names.
+  public: explicit Peer(const uint64_t _index)
+    : pUuid(Uuid().ToString()),
+      discovery(pUuid, kMulticastGroup, FLAGS_port)
+  {
+    const unsigned int heartbeat = static_cast<unsigned int>(FLAGS_heartbeat);
+    this->discovery.SetHeartbeatInterval(heartbeat);
+    this->discovery.SetSilenceInterval(3 * heartbeat);
+    this->discovery.ConnectionsCb([this](const MessagePublisher &)
+      {
+        this->discovered.fetch_add(1, std::memory_order_relaxed);
+      });
+
+    const std::string nUuid = Uuid().ToString();
+    for (uint64_t i = 0; i < FLAGS_topics; ++i)
+    {
+      this->publishers.emplace_back("@/bench_discovery@/peer_" +
+        std::to_string(_index) + "/topic_" + std::to_string(i),
+        "tcp://127.0.0.1:12345", "tcp://127.0.0.1:12346", this->pUuid, nUuid,
+        msgs::Int32().GetTypeName(), AdvertiseMessageOptions());
+    }
+  }
+
+  /// \brief Start the discovery and advertise the topics.
+  public: void Start()
+  {
+    this->discovery.Start();
+    for (const auto &publisher : this->publishers)
+      this->discovery.Advertise(publisher);
+  }
+
+  /// \brief Process UUID of the peer.
+  public: const std::string pUuid;
+
+  /// \brief The discovery instance.
+  public: Discovery<MessagePublisher> discovery;
+
+  /// \brief Publishers advertised by the peer.
+  public: std::vector<MessagePublisher> publishers;
+
+  /// \brief Publishers of the other peers discovered.
+  public: std::atomic<uint64_t> discovered{0};
+};
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  std::string usage("Scaling benchmark of the discovery.");
+  usage += " Usage:\n ./bench_discovery <options>\n\n";
+  usage += " Example with 1000 peers of 50 topics:\n";
+  usage += "\t./bench_discovery -peers 1000 -topics 50\n";
+
+  gflags::SetUsageMessage(usage);
+
+  // Parse command line arguments
+  gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+
+  // Show help, if specified
+  if (FLAGS_h)
+  {
+    gflags::SetCommandLineOptionWithMode("help", "false",
+        gflags::SET_FLAGS_DEFAULT);
+    gflags::SetCommandLineOptionWithMode("helpshort", "true",
+        gflags::SET_FLAGS_DEFAULT);
+  }
+  gflags::HandleCommandLineHelpFlags();
+
+#ifdef _WIN32
+  std::cerr << "bench_discovery is only supported on POSIX systems"
+            << std::endl;
+  return -1;
+#else
+  if (FLAGS_peers == 0 || FLAGS_heartbeat == 0)
+  {
+    std::cerr << "-peers and -heartbeat must be positive" << std::endl;
+    return -1;
+  }
+
+  // Keep the traffic on the loopback interface.
+  setenv("IGN_IP", "127.0.0.1", 0);
+  raiseFileLimit();
+
+  const uint64_t memoryBefore = residentMemory();
+
+  // The observer advertises nothing.
+  Peer observer(FLAGS_peers);
+  observer.publishers.clear();
+  std::vector<std::unique_ptr<Peer>> peers;
+  for (uint64_t i = 0; i < FLAGS_peers; ++i)
+    peers.push_back(std::make_unique<Peer>(i));
+
+  // Publishers that each instance has to discover.
+  const uint64_t total = FLAGS_peers * FLAGS_topics;
+  const uint64_t others = total - FLAGS_topics;
+
+  std::cout << "Peers: " << FLAGS_peers << ", topics per peer: "
+            << FLAGS_topics << ", heartbeat: " << FLAGS_heartbeat << " ms"
+            << std::endl;
+
+  // Convergence.
+  const auto start = std::chrono::steady_clock::now();
+  const auto deadline = start + std::chrono::duration_cast<
+    std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(FLAGS_timeout));
+  observer.Start();
+  for (auto &peer : peers)
+    peer->Start();
+
+  auto elapsed = [&start]
+  {
+    return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  };
+  auto allConverged = [&]
+  {
+    for (const auto &peer : peers)
+    {
+      if (peer->discovered < others)
+        return false;
+    }
+    return true;
+  };
+
+  double observerTime = -1;
+  double peersTime = -1;
+  while (std::chrono::steady_clock::now() < deadline &&
+         (observerTime < 0 || peersTime < 0))
+  {
+    if (observerTime < 0 && observer.discovered >= total)
+      observerTime = elapsed();
+    if (peersTime < 0 && allConverged())
+      peersTime = elapsed();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  uint64_t minDiscovered = total;
+  for (const auto &peer : peers)
+    minDiscovered = std::min(minDiscovered, peer->discovered + FLAGS_topics);
+
+  std::cout << std::fixed << std::setprecision(3);
+  if (observerTime >= 0)
+    std::cout << "Observer convergence: " << observerTime << " s\n";
+  else
+  {
+    std::cout << "Observer convergence: timeout, " << observer.discovered
+              << "/" << total << " publishers\n";
+  }
+  if (peersTime >= 0)
+    std::cout << "Peers convergence:    " << peersTime << " s\n";
+  else
+  {
+    std::cout << "Peers convergence:    timeout, worst peer " << minDiscovered
+              << "/" << total << " publishers\n";
+  }
+
+  // Memory, once the storage of the publishers stopped growing.
+  const uint64_t memoryAfter = residentMemory();
+  if (memoryBefore > 0 && memoryAfter > memoryBefore)
+  {
+    const double grown = static_cast<double>(memoryAfter - memoryBefore);
+    const uint64_t known = observer.discovered + FLAGS_peers * minDiscovered;
+    std::cout << std::setprecision(1)
+              << "Memory growth:        " << grown / (1 << 20) << " MB\n"
+              << "Memory per peer:      " << grown / FLAGS_peers / 1024
+              << " KB\n"
+              << "Memory per publisher: "
+              << grown / std::max<uint64_t>(known, 1) << " B\n";
+  }
+
+  // Steady state: only heartbeats and activity checks.
+  auto traffic = [&](uint64_t &_sent, uint64_t &_recv)
+  {
+    _sent = 0;
+    _recv = 0;
+    auto add = [&_sent, &_recv](const Peer &_peer)
+    {
+      uint64_t sent, sentBytes, recv, recvBytes;
+      _peer.discovery.Traffic(sent, sentBytes, recv, recvBytes);
+      _sent += sent;
+      _recv += recv;
+    };
+    add(observer);
+    for (const auto &peer : peers)
+      add(*peer);
+  };
+
+  uint64_t sentBefore, recvBefore;
+  traffic(sentBefore, recvBefore);
+  const double cpuBefore = cpuTime();
+  const auto steadyStart = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(FLAGS_duration));
+  const double wall = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - steadyStart).count();
+  const double cpu = cpuTime() - cpuBefore;
+  uint64_t sentAfter, recvAfter;
+  traffic(sentAfter, recvAfter);
+
+  const uint64_t sent = sentAfter - sentBefore;
+  const uint64_t recv = recvAfter - recvBefore;
+  std::cout << std::setprecision(1)
+            << "Steady state CPU:     " << 100.0 * cpu / wall << " %\n"
+            << "Datagrams sent:       " << sent / wall << " /s\n"
+            << "Datagrams received:   " << recv / wall << " /s\n"
+            << std::setprecision(2)
+            << "CPU per sent:         "
+            << 1e6 * cpu / std::max<uint64_t>(sent, 1) << " us\n"
+            << "CPU per received:     "
+            << 1e6 * cpu / std::max<uint64_t>(recv, 1) << " us" << std::endl;
+
+  // Each peer says goodbye to all the others, which takes a while.
+  std::cout << "Stopping the peers..." << std::endl;
+  return observerTime >= 0 && peersTime >= 0 ? 0 : 1;
+#endif
+}
@@ -0,0 +1,580 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+//////////////////////////////////////////////////
+/// Usage: ./bench_scaling <options>
+///
+/// Measures the aggregate throughput and the latency of publications while
+/// sweeping the number of topics, of publishing nodes, of subscribing nodes
+/// and of subscribing processes. Every publisher publishes on every topic,
+/// as fast as it can, and every subscriber subscribes to every topic, so it
+/// stresses NodeShared::mutex and the reception thread of each process.
+///
+/// Options:
+///
+/// -topics      Comma separated numbers of topics. Default: 1,4,16
+/// -publishers  Comma separated numbers of publishing nodes, each one with
+///              a thread of its own. Default: 1,4
+/// -subscribers Comma separated numbers of subscribing nodes per process.
+///              Default: 1,4
+/// -processes   Comma separated numbers of subscribing processes, 0 for the
+///              subscribers in the publishing process. Default: 0,1,2
+/// -size        Size of the messages in bytes. Default: 256
+/// -duration    Publication time of each configuration in seconds.
+///              Default: 2
+/// -o           Output CSV filename
+///
+/// The subscribing processes are this program, started again with
+/// -subscriber_process. They are only supported on POSIX systems.
+//////////////////////////////////////////////////
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+#include <ignition/transport.hh>
+
+DEFINE_bool(h, false, "Show help");
+DEFINE_string(topics, "1,4,16", "Comma separated numbers of topics");
+DEFINE_string(publishers, "1,4",
+    "Comma separated numbers of publishing nodes");
+DEFINE_string(subscribers, "1,4",
+    "Comma separated numbers of subscribing nodes per process");
+DEFINE_string(processes, "0,1,2",
+    "Comma separated numbers of subscribing processes, 0 for the same process");
+DEFINE_uint64(size, 256, "Size of the messages in bytes");
+DEFINE_double(duration, 2.0, "Publication time of each configuration (s)");
+DEFINE_string(o, "", "Output CSV filename");
+DEFINE_int32(subscriber_process, -1,
+    "Internal: run as the subscribing process with this id");
+
+/// \brief Most latency samples kept by a process.
+static const std::size_t kMaxSamples = 100000;
+
+/// \brief Size of the timestamp at the start of the messages.
+static const std::size_t kStampSize = sizeof(int64_t);
+
+//////////////////////////////////////////////////
+/// \brief Current time of the monotonic clock, which all the processes of
+/// the machine share on Linux.
+/// \return The time in nanoseconds.
+static int64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//////////////////////////////////////////////////
+/// \brief Name of a benchmark topic.
+/// \param[in] _index Index of the topic.
+/// \return The name.
+static std::string topicName(const uint64_t _index)
+{
+  return "/benchmark/scaling/" + std::to_string(_index);
+}
+
+//////////////////////////////////////////////////
+/// \brief Name of the service returning the results of a subscribing
+/// process.
+/// \param[in] _id Id of the process.
+/// \return The name.
+static std::string resultsService(const int _id)
+{
+  return "/benchmark/scaling/results_" + std::to_string(_id);
+}
+
+//////////////////////////////////////////////////
+/// \brief Parse a comma separated list of numbers.
+/// \param[in] _list The list.
+/// \return The numbers, empty if the list is invalid.
+static std::vector<uint64_t> parseList(const std::string &_list)
+{
+  std::vector<uint64_t> values;
+  std::stringstream stream(_list);
+  std::string item;
+  while (std::getline(stream, item, ','))
+  {
+    try
+    {
+      values.push_back(std::stoull(item));
+    }
+    catch (...)
+    {
+      std::cerr << "Invalid number [" << item << "] in [" << _list << "]"
+                << std::endl;
+      return {};
+    }
+  }
+  return values;
+}
+
+/// \brief Subscribing nodes of a process. Each one subscribes to all the
+/// topics, counts the messages and samples their latency.
+class ScalingSubscribers
+{
+  /// \brief Create the subscribers.
+  /// \param[in] _nodes Number of subscribing nodes.
+  /// \param[in] _topics Number of topics.
+  public: ScalingSubscribers(const uint64_t _nodes, const uint64_t _topics)
+    : nodes(_nodes)
+  {
+    for (auto &node : this->nodes)
+    {
+      for (uint64_t t = 0; t < _topics; ++t)
+        node.Subscribe(topicName(t), &ScalingSubscribers::OnMsg, this);
+    }
+  }
+
+  /// \brief Get the results, and reset them.
+  /// \param[out] _received Number of messages received.
+  /// \param[out] _samples Latency samples in nanoseconds.
+  public: void TakeResults(uint64_t &_received, std::vector<int64_t> &_samples)
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    _received = this->received;
+    _samples.swap(this->samples);
+    this->received = 0;
+    this->samples.clear();
+  }
+
+  /// \brief Message callback.
+  /// \param[in] _msg The message.
+  private: void OnMsg(const ignition::msgs::Bytes &_msg)
+  {
+    const int64_t now = nowNs();
+    if (_msg.data().size() < kStampSize)
+      return;
+
+    int64_t stamp;
+    memcpy(&stamp, _msg.data().data(), kStampSize);
+
+    // Reservoir sampling, so the samples span the whole run.
+    std::lock_guard<std::mutex> lk(this->mutex);
+    ++this->received;
+    if (this->samples.size() < kMaxSamples)
+    {
+      this->samples.push_back(now - stamp);
+    }
+    else
+    {
+      std::uniform_int_distribution<uint64_t> dist(0, this->received - 1);
+      const uint64_t slot = dist(this->random);
+      if (slot < kMaxSamples)
+        this->samples[slot] = now - stamp;
+    }
+  }
+
+  /// \brief The subscribing nodes.
+  private: std::vector<ignition::transport::Node> nodes;
+
+  /// \brief Protect the results.
+  private: std::mutex mutex;
+
+  /// \brief Number of messages received.
+  private: uint64_t received = 0;
+
+  /// \brief Latency samples in nanoseconds.
+  private: std::vector<int64_t> samples;
+
+  /// \brief Generator of the reservoir sampling.
+  private: std::mt19937_64 random;
+};
+
+//////////////////////////////////////////////////
+/// \brief Run as a subscribing process, until the results are requested.
+/// \param[in] _id Id of the process.
+/// \return The exit code.
+static int runSubscriberProcess(const int _id)
+{
+  std::vector<uint64_t> topics = parseList(FLAGS_topics);
+  std::vector<uint64_t> subscribers = parseList(FLAGS_subscribers);
+  if (topics.size() != 1 || subscribers.size() != 1)
+    return -1;
+
+  ScalingSubscribers scalingSubscribers(subscribers[0], topics[0]);
+
+  std::mutex mutex;
+  std::condition_variable done;
+  bool replied = false;
+
+  ignition::transport::Node node;
+  std::function<bool(const ignition::msgs::Empty &, ignition::msgs::Bytes &)>
+    cb = [&](const ignition::msgs::Empty &, ignition::msgs::Bytes &_rep)
+    {
+      uint64_t received;
+      std::vector<int64_t> samples;
+      scalingSubscribers.TakeResults(received, samples);
+
+      // The number of messages, followed by the latency samples.
+      std::string *data = _rep.mutable_data();
+      data->resize(sizeof(int64_t) * (1 + samples.size()));
+      memcpy(&(*data)[0], &received, sizeof(received));
+      if (!samples.empty())
+      {
+        memcpy(&(*data)[sizeof(int64_t)], samples.data(),
+               sizeof(int64_t) * samples.size());
+      }
+
+      std::lock_guard<std::mutex> lk(mutex);
+      replied = true;
+      done.notify_all();
+      return true;
+    };
+  if (!node.Advertise(resultsService(_id), cb))
+    return -1;
+
+  std::unique_lock<std::mutex> lk(mutex);
+  done.wait(lk, [&]{return replied;});
+  // Let the response leave before the node is destroyed.
+  lk.unlock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  return 0;
+}
+
+/// \brief Results of a configuration.
+struct ScalingResult
+{
+  /// \brief Number of messages published.
+  uint64_t published = 0;
+
+  /// \brief Number of messages received by all the subscribers.
+  uint64_t received = 0;
+
+  /// \brief Latency samples in nanoseconds.
+  std::vector<int64_t> samples;
+};
+
+//////////////////////////////////////////////////
+/// \brief Start a subscribing process.
+/// \param[in] _program Path of this program.
+/// \param[in] _id Id of the process.
+/// \param[in] _topics Number of topics.
+/// \param[in] _subscribers Number of subscribing nodes.
+/// \return The process id, or -1.
+static int64_t startSubscriberProcess(const std::string &_program,
+    const int _id, const uint64_t _topics, const uint64_t _subscribers)
+{
+#ifdef _WIN32
+  (void)_program;
+  (void)_id;
+  (void)_topics;
+  (void)_subscribers;
+  std::cerr << "Subscribing processes are not supported on Windows"
+            << std::endl;
+  return -1;
+#else
+  const std::string idArg = "-subscriber_process=" + std::to_string(_id);
+  const std::string topicsArg = "-topics=" + std::to_string(_topics);
+  const std::string subscribersArg =
+    "-subscribers=" + std::to_string(_subscribers);
+
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    execl(_program.c_str(), _program.c_str(), idArg.c_str(),
+          topicsArg.c_str(), subscribersArg.c_str(),
+          reinterpret_cast<char *>(0));
+    std::cerr << "Error running [" << _program << "]" << std::endl;
+    _exit(-1);
+  }
+  return pid;
+#endif
+}
+
+//////////////////////////////////////////////////
+/// \brief Run one configuration.
+/// \param[in] _program Path of this program.
+/// \param[in] _topics Number of topics.
+/// \param[in] _publishers Number of publishing nodes.
+/// \param[in] _subscribers Number of subscribing nodes per process.
+/// \param[in] _processes Number of subscribing processes, 0 for the
+/// subscribers in this process.
+/// \param[out] _result The results.
+/// \return True if the configuration ran.
+static bool runConfiguration(const std::string &_program,
+    const uint64_t _topics, const uint64_t _publishers,
+    const uint64_t _subscribers, const uint64_t _processes,
+    ScalingResult &_result)
+{
+  std::vector<ignition::transport::Node> pubNodes(_publishers);
+  std::vector<std::vector<ignition::transport::Node::Publisher>> pubs(
+    _publishers);
+  for (uint64_t p = 0; p < _publishers; ++p)
+  {
+    for (uint64_t t = 0; t < _topics; ++t)
+    {
+      pubs[p].push_back(
+        pubNodes[p].Advertise<ignition::msgs::Bytes>(topicName(t)));
+    }
+  }
+
+  std::unique_ptr<ScalingSubscribers> localSubscribers;
+  std::vector<int64_t> pids;
+  if (_processes == 0)
+  {
+    localSubscribers.reset(new ScalingSubscribers(_subscribers, _topics));
+  }
+  else
+  {
+    for (uint64_t i = 0; i < _processes; ++i)
+    {
+      const int64_t pid = startSubscriberProcess(_program,
+        static_cast<int>(i), _topics, _subscribers);
+      if (pid < 0)
+        return false;
+      pids.push_back(pid);
+    }
+
+    // Wait for all the remote subscribers of all the topics.
+    for (uint64_t t = 0; t < _topics; ++t)
+    {
+      if (!pubNodes.front().WaitForSubscribers(topicName(t),
+            _processes * _subscribers, std::chrono::seconds(10)))
+      {
+        std::cerr << "Timed out waiting for the subscribers of ["
+                  << topicName(t) << "]" << std::endl;
+      }
+    }
+  }
+
+  // Publish on all the topics from all the publishers at once.
+  std::atomic<bool> running{true};
+  std::vector<uint64_t> published(_publishers, 0);
+  std::vector<std::thread> threads;
+  for (uint64_t p = 0; p < _publishers; ++p)
+  {
+    threads.emplace_back([&, p]
+      {
+        ignition::msgs::Bytes msg;
+        msg.mutable_data()->resize(std::max<uint64_t>(FLAGS_size, kStampSize));
+        uint64_t count = 0;
+        while (running)
+        {
+          for (auto &pub : pubs[p])
+          {
+            const int64_t stamp = nowNs();
+            memcpy(&(*msg.mutable_data())[0], &stamp, kStampSize);
+            pub.Publish(msg);
+            ++count;
+          }
+        }
+        published[p] = count;
+      });
+  }
+
+  std::this_thread::sleep_for(
+    std::chrono::duration<double>(FLAGS_duration));
+  running = false;
+  for (auto &thread : threads)
+    thread.join();
+
+  // Let the last messages arrive.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  _result = ScalingResult();
+  for (const auto count : published)
+    _result.published += count;
+
+  if (localSubscribers)
+  {
+    localSubscribers->TakeResults(_result.received, _result.samples);
+    return true;
+  }
+
+  for (uint64_t i = 0; i < _processes; ++i)
+  {
+    ignition::msgs::Empty req;
+    ignition::msgs::Bytes rep;
+    bool ok = false;
+    if (!pubNodes.front().Request(resultsService(static_cast<int>(i)), req,
+          5000, rep, ok) || !ok || rep.data().size() < sizeof(int64_t))
+    {
+      std::cerr << "No results from subscribing process " << i << std::endl;
+      continue;
+    }
+
+    int64_t received;
+    memcpy(&received, rep.data().data(), sizeof(received));
+    _result.received += static_cast<uint64_t>(received);
+    const std::size_t count = rep.data().size() / sizeof(int64_t) - 1;
+    const std::size_t offset = _result.samples.size();
+    _result.samples.resize(offset + count);
+    if (count > 0)
+    {
+      memcpy(&_result.samples[offset], rep.data().data() + sizeof(int64_t),
+             count * sizeof(int64_t));
+    }
+  }
+
+#ifndef _WIN32
+  for (const auto pid : pids)
+  {
+    int status;
+    waitpid(static_cast<pid_t>(pid), &status, 0);
+  }
+#endif
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get a percentile of sorted samples.
+/// \param[in] _samples Sorted samples.
+/// \param[in] _percentile The percentile, between 0 and 100.
+/// \return The sample, in microseconds.
+static double percentileUs(const std::vector<int64_t> &_samples,
+    const double _percentile)
+{
+  if (_samples.empty())
+    return 0;
+  const std::size_t index = std::min(_samples.size() - 1,
+    static_cast<std::size_t>(_percentile / 100.0 * _samples.size()));
+  return _samples[index] / 1e3;
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  std::string usage("Scaling benchmark of the publications.");
+  usage += " Usage:\n ./bench_scaling <options>\n\n";
+  usage += " Example sweep of the topics with two subscribing processes:\n";
+  usage += "\t./bench_scaling -topics 1,10,100 -publishers 1";
+  usage += " -subscribers 1 -processes 2\n";
+
+  gflags::SetUsageMessage(usage);
+
+  // Parse command line arguments
+  gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+
+  // Show help, if specified
+  if (FLAGS_h)
+  {
+    gflags::SetCommandLineOptionWithMode("help", "false",
+        gflags::SET_FLAGS_DEFAULT);
+    gflags::SetCommandLineOptionWithMode("helpshort", "true",
+        gflags::SET_FLAGS_DEFAULT);
+  }
+  gflags::HandleCommandLineHelpFlags();
+
+  if (FLAGS_subscriber_process >= 0)
+    return runSubscriberProcess(FLAGS_subscriber_process);
+
+  std::vector<uint64_t> topics = parseList(FLAGS_topics);
+  std::vector<uint64_t> publishers = parseList(FLAGS_publishers);
+  std::vector<uint64_t> subscribers = parseList(FLAGS_subscribers);
+  std::vector<uint64_t> processes = parseList(FLAGS_processes);
+  if (topics.empty() || publishers.empty() || subscribers.empty() ||
+      processes.empty())
+  {
+    return -1;
+  }
+
+  // Keep the benchmark away from the other programs. The subscribing
+  // processes inherit the partition.
+  if (!std::getenv("IGN_PARTITION"))
+  {
+    std::random_device rd;
+    const std::string partition = "bench_scaling_" + std::to_string(rd());
+#ifdef _WIN32
+    _putenv_s("IGN_PARTITION", partition.c_str());
+#else
+    setenv("IGN_PARTITION", partition.c_str(), 1);
+#endif
+  }
+
+  std::ofstream csv;
+  if (!FLAGS_o.empty())
+  {
+    csv.open(FLAGS_o);
+    csv << "topics,publishers,subscribers,processes,published,received,"
+        << "throughput_msgs_per_s,delivered_percent,p50_us,p99_us,max_us\n";
+  }
+
+  std::cout << std::setw(7) << "topics" << std::setw(5) << "pubs"
+            << std::setw(5) << "subs" << std::setw(6) << "procs"
+            << std::setw(14) << "msgs/s" << std::setw(11) << "delivered"
+            << std::setw(11) << "p50 us" << std::setw(11) << "p99 us"
+            << std::setw(11) << "max us" << std::endl;
+
+  for (const auto t : topics)
+  {
+    for (const auto p : publishers)
+    {
+      for (const auto s : subscribers)
+      {
+        for (const auto procs : processes)
+        {
+          ScalingResult result;
+          if (t == 0 || p == 0 || s == 0 ||
+              !runConfiguration(argv[0], t, p, s, procs, result))
+          {
+            continue;
+          }
+
+          std::sort(result.samples.begin(), result.samples.end());
+          const double throughput = result.received / FLAGS_duration;
+          const uint64_t expected =
+            result.published * s * std::max<uint64_t>(procs, 1);
+          const double delivered = expected == 0 ? 0 :
+            100.0 * result.received / expected;
+          const double p50 = percentileUs(result.samples, 50);
+          const double p99 = percentileUs(result.samples, 99);
+          const double max = percentileUs(result.samples, 100);
+
+          std::cout << std::fixed << std::setprecision(1)
+                    << std::setw(7) << t << std::setw(5) << p
+                    << std::setw(5) << s << std::setw(6) << procs
+                    << std::setw(14) << throughput
+                    << std::setw(10) << delivered << "%"
+                    << std::setw(11) << p50 << std::setw(11) << p99
+                    << std::setw(11) << max << std::endl;
+
+          if (csv.is_open())
+          {
+            csv << t << "," << p << "," << s << "," << procs << ","
+                << result.published << "," << result.received << ","
+                << throughput << "," << delivered << "," << p50 << ","
+                << p99 << "," << max << "\n";
+          }
+        }
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <iostream>
+#include <string>
+#include <ignition/transport.hh>
+
+//////////////////////////////////////////////////
+/// \brief Run a discovery server. Start the other processes with
+/// IGN_DISCOVERY_SERVER set to the address of this host.
+/// With --host, run it as the discovery daemon of this host instead: the
+/// local processes use IGN_DISCOVERY_SERVER=127.0.0.1 and the daemon talks
+/// to the rest of the network through multicast.
+int main(int argc, char **argv)
+{
+  bool verbose = false;
+  bool host = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    verbose = verbose || std::string(argv[i]) == "-v";
+    host = host || std::string(argv[i]) == "--host";
+  }
+
+  ignition::transport::DiscoveryServer server(verbose);
+  server.SetMulticastBridge(host);
+  if (!server.Start())
+  {
+    std::cerr << "Error starting the discovery server" << std::endl;
+    return -1;
+  }
+
+  // Zzzzzz.
+  ignition::transport::waitForShutdown();
+}
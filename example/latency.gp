@@ -10,7 +10,10 @@
 #   gnuplot -e "filename='MY_FILENAME'; prefix='MY_PREFIX'" latency.gp
 #
 #   where prefix is a string that will be prepended to the title. This can
-#   be used to describe the test scenario.
+#   be used to describe the test scenario. Add "csv=1" for the results of
+#   "bench -format csv".
+
+if (exists("csv")) set datafile separator comma
 
 set terminal png size 1920,1080 enhanced font 'Verdana, 20'
 set ylabel 'microseconds'
@@ -22,14 +25,20 @@ set xtics (0, '256' 1, '512' 2, "1K" 3, "2K" 4, "4K" 5, "8K" 6, "16K" 7,\
 
 set output sprintf("latency-%s-all.png", prefix)
 set title sprintf("%s Latency", prefix)
-plot filename using 1:3 with linespoints title 'Avg' lw 2
+plot filename using 1:3 with linespoints title 'Avg' lw 2, \
+     filename using 1:6 with linespoints title 'p50' lw 2, \
+     filename using 1:8 with linespoints title 'p99' lw 2
 
 set output sprintf("latency-%s-small.png", prefix)
 set title sprintf("%s Latency with Small Messages", prefix)
 set xrange [1:9]
-plot filename using 1:3 with linespoints title 'Avg' lw 2
+plot filename using 1:3 with linespoints title 'Avg' lw 2, \
+     filename using 1:6 with linespoints title 'p50' lw 2, \
+     filename using 1:8 with linespoints title 'p99' lw 2
 
 set output sprintf("latency-%s-large.png", prefix)
 set title sprintf("%s Latency with Large Messages", prefix)
 set xrange [7:15]
-plot filename using 1:3 with linespoints title 'Avg' lw 2
+plot filename using 1:3 with linespoints title 'Avg' lw 2, \
+     filename using 1:6 with linespoints title 'p50' lw 2, \
+     filename using 1:8 with linespoints title 'p99' lw 2
@@ -0,0 +1,32 @@
+#!/bin/bash
+#
+# Emulate a wireless link on a network interface with the netem queueing
+# discipline, to run the benchmarks under delay, jitter and packet loss.
+# Unlike the -delay, -jitter and -loss options of bench, it also affects
+# the discovery and the TCP connections of the transport. Requires root.
+#
+# Usage: netem.bash start [interface] [delay ms] [jitter ms] [loss %]
+#        netem.bash stop [interface]
+#
+# E.g. netem.bash start lo 5 3 1, then run bench and netem.bash stop lo.
+
+command=$1
+interface=${2:-lo}
+delay=${3:-5}
+jitter=${4:-3}
+loss=${5:-1}
+
+case "$command" in
+  start)
+    tc qdisc replace dev "$interface" root netem \
+      delay "${delay}ms" "${jitter}ms" distribution normal loss "${loss}%"
+    ;;
+  stop)
+    tc qdisc del dev "$interface" root
+    ;;
+  *)
+    echo "Usage: $0 start [interface] [delay ms] [jitter ms] [loss %]"
+    echo "       $0 stop [interface]"
+    exit 1
+    ;;
+esac
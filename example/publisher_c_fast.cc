@@ -70,18 +70,25 @@ int main(int argc, char **argv)
   // Serialize the message.
   msgRed.SerializeToArray(bufferRed, sizeRed);
 
+  // Advertise the topic once, the publishers don't look it up again.
+  IgnTransportPublisher *pub = ignTransportAdvertisePublisher(node, topic,
+      msg.GetTypeName().c_str());
+  IgnTransportPublisher *pubRed = ignTransportAdvertisePublisher(nodeRed,
+      topic, msgRed.GetTypeName().c_str());
+
   // Publish messages as fast as possible.
   while (!g_terminatePub)
   {
-    ignTransportPublish(node, topic, buffer, msg.GetTypeName().c_str());
-    ignTransportPublish(nodeRed, topic, bufferRed,
-        msgRed.GetTypeName().c_str());
+    ignTransportPublisherPublish(pub, buffer, size);
+    ignTransportPublisherPublish(pubRed, bufferRed, sizeRed);
 
     printf("Publishing hello on topic %s.\n", topic);
   }
 
   free(buffer);
   free(bufferRed);
+  ignTransportPublisherDestroy(&pub);
+  ignTransportPublisherDestroy(&pubRed);
   ignTransportNodeDestroy(&node);
   ignTransportNodeDestroy(&nodeRed);
 
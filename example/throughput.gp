@@ -11,9 +11,12 @@
 #   gnuplot -e "filename='MY_FILENAME'; prefix='MY_PREFIX'" throughput.gp
 #
 #   where prefix is a string that will be prepended to the title. This can
-#   be used to describe the test scenario.
+#   be used to describe the test scenario. Add "csv=1" for the results of
+#   "bench -format csv".
 #
 
+if (exists("csv")) set datafile separator comma
+
 set terminal png size 1920,1080 enhanced font "Roboto, 20"
 set ylabel 'MB/s' tc lt 1
 set ytics nomirror tc lt 1
@@ -18,9 +18,12 @@
 #ifndef IGN_TRANSPORT_ADVERTISEOPTIONS_HH_
 #define IGN_TRANSPORT_ADVERTISEOPTIONS_HH_
 
+#include <chrono>
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <string>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
@@ -51,6 +54,46 @@ namespace ignition
       ALL
     };
 
+    /// \def QueueOverflowPolicy_t This strongly typed enum defines what
+    /// happens when a message is published and the queue of messages pending
+    /// delivery to the subscribers of the same process is full.
+    enum class QueueOverflowPolicy_t
+    {
+      /// \brief Discard the oldest message not delivered yet.
+      DROP_OLDEST,
+      /// \brief Discard the message being published.
+      DROP_NEWEST,
+      /// \brief Block the publisher until there is room in the queue.
+      BLOCK
+    };
+
+    /// \def TrafficClass_t This strongly typed enum defines the kind of
+    /// traffic of a topic. Each class has a publisher socket of its own, so
+    /// the messages of a class don't wait in the queues of another one.
+    enum class TrafficClass_t
+    {
+      /// \brief Messages sent with the rest of the topics (default).
+      DEFAULT,
+      /// \brief Large or frequent messages, e.g.: images or point clouds.
+      BULK,
+      /// \brief Small messages that need a bounded latency, e.g.: commands
+      /// or emergency stops. They are also received by a thread of their
+      /// own, and their packets are marked for priority by the network.
+      CONTROL
+    };
+
+    /// \def Compression_t This strongly typed enum defines how the messages
+    /// of a topic are compressed before being sent to the remote
+    /// subscribers.
+    enum class Compression_t
+    {
+      /// \brief The messages are sent as they are (default).
+      NONE,
+      /// \brief Deflate, with the fastest level. Only available if the
+      /// library was built with zlib.
+      ZLIB
+    };
+
     /// \class AdvertiseOptions AdvertiseOptions.hh
     /// ignition/transport/AdvertiseOptions.hh
     /// \brief A class for customizing the publication options for a topic or
@@ -177,6 +220,68 @@ namespace ignition
         else
           _out << "\tThrottled? No" << std::endl;
 
+        if (_other.LocalQueueDepth() != 0)
+        {
+          _out << "\tLocal queue depth: " << _other.LocalQueueDepth()
+               << std::endl;
+          _out << "\tOverflow policy: ";
+          switch (_other.OverflowPolicy())
+          {
+            case QueueOverflowPolicy_t::DROP_OLDEST:
+              _out << "Drop oldest" << std::endl;
+              break;
+            case QueueOverflowPolicy_t::DROP_NEWEST:
+              _out << "Drop newest" << std::endl;
+              break;
+            case QueueOverflowPolicy_t::BLOCK:
+              _out << "Block" << std::endl;
+              break;
+            default:
+              _out << "Unknown" << std::endl;
+          }
+        }
+
+        if (!_other.MulticastGroup().empty())
+          _out << "\tMulticast group: " << _other.MulticastGroup() << std::endl;
+
+        if (_other.BestEffort())
+          _out << "\tBest effort: Yes" << std::endl;
+
+        if (_other.Latched())
+          _out << "\tLatched: Yes" << std::endl;
+
+        if (_other.SubscriberMsgsPerSec() != 0 &&
+            _other.SubscriberMsgsPerSec() !=
+              std::numeric_limits<uint64_t>::max())
+        {
+          _out << "\tSubscriber rate: " << _other.SubscriberMsgsPerSec()
+               << " msgs/sec" << std::endl;
+        }
+
+        if (_other.TrafficClass() == TrafficClass_t::BULK)
+          _out << "\tTraffic class: Bulk" << std::endl;
+        else if (_other.TrafficClass() == TrafficClass_t::CONTROL)
+          _out << "\tTraffic class: Control" << std::endl;
+
+        if (_other.FragmentSize() != 0)
+        {
+          _out << "\tFragment size: " << _other.FragmentSize() << " bytes"
+               << std::endl;
+        }
+
+        if (_other.Compression() == Compression_t::ZLIB)
+        {
+          _out << "\tCompression: zlib, above "
+               << _other.CompressionThreshold() << " bytes" << std::endl;
+        }
+
+        if (_other.RealtimeSlots() != 0)
+        {
+          _out << "\tReal-time queue: " << _other.RealtimeSlots()
+               << " slots of " << _other.RealtimeSlotSize() << " bytes"
+               << std::endl;
+        }
+
         return _out;
       }
 
@@ -197,6 +302,227 @@ namespace ignition
       /// \param[in] _newMsgsPerSec Maximum number of messages per second.
       public: void SetMsgsPerSec(const uint64_t _newMsgsPerSec);
 
+      /// \brief Get the maximum number of messages published that can be
+      /// waiting for delivery to the subscribers of the same process.
+      /// \return The maximum number of messages. 0 means unlimited.
+      /// \sa SetLocalQueueDepth
+      public: uint64_t LocalQueueDepth() const;
+
+      /// \brief Set the maximum number of messages published that can be
+      /// waiting for delivery to the subscribers of the same process. When
+      /// the limit is reached, the overflow policy decides what to do with the
+      /// next message. Each pending message holds a copy of the message, so
+      /// this bounds the memory used when local subscribers are slow.
+      /// \param[in] _depth Maximum number of messages. 0 means unlimited,
+      /// which is the default.
+      /// \sa SetOverflowPolicy
+      public: void SetLocalQueueDepth(const uint64_t _depth);
+
+      /// \brief Get the policy applied when the local queue is full.
+      /// \return The overflow policy.
+      /// \sa SetOverflowPolicy
+      public: QueueOverflowPolicy_t OverflowPolicy() const;
+
+      /// \brief Set the policy applied when the local queue is full. The
+      /// default policy is QueueOverflowPolicy_t::DROP_OLDEST. Note that
+      /// QueueOverflowPolicy_t::BLOCK never blocks a publication made from a
+      /// subscriber callback, since the callback could be the one that has
+      /// to drain the queue. The message is queued anyway in that case.
+      /// It doesn't block either when the application spins (see
+      /// ThreadConfig::SetManualSpin), since the publisher could be the
+      /// thread that drains the queue: the message is dropped instead, like
+      /// with QueueOverflowPolicy_t::DROP_NEWEST.
+      /// \param[in] _policy The overflow policy.
+      /// \sa SetLocalQueueDepth
+      public: void SetOverflowPolicy(const QueueOverflowPolicy_t _policy);
+
+      /// \brief Get the multicast group that the remote subscribers receive
+      /// the messages from.
+      /// \return The group and port, or an empty string if the messages are
+      /// sent to each subscriber.
+      /// \sa SetMulticastGroup
+      public: const std::string &MulticastGroup() const;
+
+      /// \brief Send the messages once to a multicast group instead of once
+      /// to each remote subscriber, so the cost of the publisher doesn't grow
+      /// with the number of subscribers. The data travels with the PGM
+      /// protocol (ZeroMQ's epgm transport) and the group is announced via
+      /// discovery. Subscribers in the same host, or whose ZeroMQ library
+      /// can't join the group, still receive the messages over TCP. A
+      /// subscriber in the group receives all its data, including the topics
+      /// that it doesn't subscribe to, so separate groups keep heavy topics
+      /// apart. By default the messages are sent to each subscriber.
+      /// \param[in] _group IPv4 multicast group and port, e.g.:
+      /// "239.255.0.8:11320", or an empty string to disable multicast.
+      /// \sa MulticastGroup
+      public: void SetMulticastGroup(const std::string &_group);
+
+      /// \brief Whether the remote subscribers can receive the messages as
+      /// best effort datagrams.
+      /// \return True if best effort delivery is offered.
+      /// \sa SetBestEffort
+      public: bool BestEffort() const;
+
+      /// \brief Offer best effort delivery to the remote subscribers that ask
+      /// for it with SubscribeOptions::SetBestEffort(). Each message is sent
+      /// as a single UDP datagram, which is never retransmitted nor waits for
+      /// a previous one, so a lossy link doesn't delay the most recent
+      /// messages. Lost and late messages are dropped, and are counted by the
+      /// sequence numbers of the messages. Messages that don't fit in a
+      /// datagram, subscribers that don't ask for best effort and peers
+      /// without support for it keep using TCP. Not available when the
+      /// authentication is enabled nor on Windows. Disabled by default.
+      /// \param[in] _bestEffort True to offer best effort delivery.
+      /// \sa BestEffort
+      public: void SetBestEffort(const bool _bestEffort);
+
+      /// \brief Whether the publisher keeps its last message for the
+      /// subscribers that come later.
+      /// \return True if the publisher is latched.
+      /// \sa SetLatched
+      public: bool Latched() const;
+
+      /// \brief Keep the last message published and deliver it to each new
+      /// local or remote subscriber as soon as it connects, so slowly
+      /// changing topics (e.g.: maps, robot descriptions or parameters) don't
+      /// have to be published periodically for the late subscribers. The
+      /// message is kept serialized until the publisher is destroyed. A
+      /// subscriber of an older version may receive the message more than
+      /// once. Disabled by default.
+      /// \param[in] _latched True to latch the publisher.
+      /// \sa Latched
+      public: void SetLatched(const bool _latched);
+
+      /// \brief Get the rate at which a subscriber process wants the
+      /// messages of the topic.
+      /// \return The rate in messages per second, kUnthrottled for all the
+      /// messages or 0 if unknown.
+      /// \sa SetSubscriberMsgsPerSec
+      public: uint64_t SubscriberMsgsPerSec() const;
+
+      /// \brief Set the rate at which a subscriber process wants the
+      /// messages of the topic. This is set by Ignition Transport, not by
+      /// the users: the advertisements carry kUnthrottled when the publisher
+      /// can send fewer messages to the subscribers that ask for it, and the
+      /// registrations of the subscribers carry the fastest
+      /// SubscribeOptions::MsgsPerSec() of the process. The publisher then
+      /// sends each subscriber process only the messages it asked for.
+      /// Peers without support for it leave it to 0, the default.
+      /// \param[in] _msgsPerSec The rate in messages per second.
+      /// \sa SubscriberMsgsPerSec
+      public: void SetSubscriberMsgsPerSec(const uint64_t _msgsPerSec);
+
+      /// \brief Get whether a subscriber process accepts the compact header.
+      /// \return True if the compact header is accepted.
+      /// \sa SetCompactHeader
+      public: bool CompactHeader() const;
+
+      /// \brief Set whether a subscriber process accepts the compact header
+      /// (see IGN_TRANSPORT_COMPACT_HEADER). This is set by Ignition
+      /// Transport, not by the users: the registrations of the subscribers
+      /// able to read it carry it, and the publisher only uses the compact
+      /// header on the topics where all the remote subscribers do. Peers
+      /// without support for it leave it to false, the default.
+      /// \param[in] _compact True if the compact header is accepted.
+      /// \sa CompactHeader
+      public: void SetCompactHeader(const bool _compact);
+
+      /// \brief Get the traffic class of the topic.
+      /// \return The traffic class.
+      /// \sa SetTrafficClass
+      public: TrafficClass_t TrafficClass() const;
+
+      /// \brief Set the traffic class of the topic. The topics of a class
+      /// other than TrafficClass_t::DEFAULT are sent through a publisher
+      /// socket of their own, with its own send buffers, so a flood of bulk
+      /// data (e.g.: images) filling its buffers doesn't delay the messages
+      /// of the other topics. The remote subscribers receive the
+      /// TrafficClass_t::CONTROL topics in a thread of their own, and their
+      /// TCP connections are marked with a DSCP value. A topic published by
+      /// several nodes of a process keeps the class of its first publisher.
+      /// Default is TrafficClass_t::DEFAULT.
+      /// \param[in] _class The traffic class.
+      /// \sa TrafficClass
+      public: void SetTrafficClass(const TrafficClass_t _class);
+
+      /// \brief Get the size of the fragments of the large messages.
+      /// \return The size in bytes, or 0 if the messages aren't fragmented.
+      /// \sa SetFragmentSize
+      public: uint64_t FragmentSize() const;
+
+      /// \brief Send the messages bigger than _size bytes to the remote
+      /// subscribers in fragments of _size bytes. The fragments are paced by
+      /// the reception thread, so other messages go through the publisher
+      /// socket between them and a slow subscriber doesn't make it queue the
+      /// whole message at once. The subscribers reassemble the message
+      /// before running their callbacks, and can follow the transfer with
+      /// SubscribeOptions::SetProgressCallback(). Only the buffers of
+      /// Node::Publisher::Publish() and PublishRaw() are fragmented, and
+      /// only while all the remote subscribers support it. If a fragment is
+      /// lost, the whole message is. Default is 0, no fragmentation.
+      /// \param[in] _size The size in bytes.
+      /// \sa FragmentSize
+      public: void SetFragmentSize(const uint64_t _size);
+
+      /// \brief Get how the messages are compressed for the remote
+      /// subscribers.
+      /// \return The compression method.
+      /// \sa SetCompression
+      public: Compression_t Compression() const;
+
+      /// \brief Get the size above which the messages are compressed.
+      /// \return The size in bytes.
+      /// \sa SetCompression
+      public: uint64_t CompressionThreshold() const;
+
+      /// \brief Compress the messages of at least _threshold bytes sent to
+      /// the remote subscribers, e.g. over a wireless link. The subscribers
+      /// decompress them before running their callbacks, and the
+      /// subscribers of the same process always get the messages as they
+      /// are. Only the messages sent through the publisher socket are
+      /// compressed, as long as all the remote subscribers support it, and
+      /// the messages that don't get smaller are sent as they are. If the
+      /// method isn't available, the messages aren't compressed. Default is
+      /// Compression_t::NONE.
+      /// \param[in] _compression The compression method.
+      /// \param[in] _threshold The size in bytes.
+      /// \sa Compression
+      /// \sa CompressionThreshold
+      public: void SetCompression(const Compression_t _compression,
+                                  const uint64_t _threshold = 1024);
+
+      /// \brief Get the number of slots of the real-time queue.
+      /// \return The number of slots, or 0 if the publisher doesn't have a
+      /// real-time queue.
+      /// \sa SetRealtimeQueue
+      public: uint64_t RealtimeSlots() const;
+
+      /// \brief Get the size of the slots of the real-time queue.
+      /// \return The size in bytes, or 0 if the publisher doesn't have a
+      /// real-time queue.
+      /// \sa SetRealtimeQueue
+      public: uint64_t RealtimeSlotSize() const;
+
+      /// \brief Make the publisher safe to use from a real-time thread,
+      /// e.g. a SCHED_FIFO control loop. Node::Publisher::Publish() and
+      /// PublishRaw() only serialize the message into one of _slots slots
+      /// of _slotSize bytes, all allocated with the publisher, and hand it
+      /// over to a transport thread ("ign-rt-publish", see ThreadConfig)
+      /// that publishes it. The caller doesn't allocate memory, take a lock,
+      /// wait or print anything: a message that doesn't fit, that can't be
+      /// serialized or that finds the queue full is dropped and counted,
+      /// see Node::Publisher::DroppedRealtimeMessages() and
+      /// FailedRealtimeMessages(). The messages are published in order,
+      /// and a publisher must only be used by one real-time thread at a
+      /// time. Default is 0 slots, no real-time queue.
+      /// \param[in] _slots Number of slots, 0 to disable the queue.
+      /// \param[in] _slotSize Size of each slot in bytes, at least the size
+      /// of the biggest serialized message.
+      /// \sa RealtimeSlots
+      /// \sa RealtimeSlotSize
+      public: void SetRealtimeQueue(const uint64_t _slots,
+                                    const uint64_t _slotSize);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
@@ -251,9 +577,59 @@ namespace ignition
                                           const AdvertiseServiceOptions &_other)
       {
         _out << static_cast<AdvertiseOptions>(_other);
+        if (_other.MaxConcurrentCalls() != 0)
+        {
+          _out << "\tMax concurrent calls: " << _other.MaxConcurrentCalls()
+               << std::endl;
+        }
+        if (_other.ReplyCacheTtl() > std::chrono::nanoseconds::zero())
+        {
+          _out << "\tReply cache TTL: "
+               << std::chrono::duration<double>(_other.ReplyCacheTtl()).count()
+               << " s" << std::endl;
+        }
         return _out;
       }
 
+      /// \brief Get the maximum number of calls to the service made from other
+      /// processes that can run at the same time.
+      /// \return The maximum number of calls. 0 means that the calls run in
+      /// the reception thread.
+      /// \sa SetMaxConcurrentCalls
+      public: uint32_t MaxConcurrentCalls() const;
+
+      /// \brief Set the maximum number of calls to the service made from other
+      /// processes that can run at the same time. When not 0, the service
+      /// callback runs in a pool of worker threads shared by all the services
+      /// of the process, and the response is sent when the callback returns.
+      /// This way a slow service doesn't delay the reception of messages and
+      /// the calls to other services. Note that the callback can then run
+      /// concurrently with other callbacks, and with itself when the limit is
+      /// greater than 1. The size of the pool also bounds the number of calls
+      /// running at the same time. Calls made from the same process always
+      /// run in the thread of the requester.
+      /// \param[in] _maxCalls Maximum number of calls. 0 means that the calls
+      /// run in the reception thread, one at a time, which is the default.
+      public: void SetMaxConcurrentCalls(const uint32_t _maxCalls);
+
+      /// \brief Get the time during which a response is cached.
+      /// \return The time to live of the responses, 0 if they aren't cached.
+      /// \sa SetReplyCacheTtl
+      public: std::chrono::nanoseconds ReplyCacheTtl() const;
+
+      /// \brief Mark the service as idempotent, i.e. it always returns the
+      /// same response to the same request, so the responses to the calls
+      /// made from other processes are cached. A request whose bytes match
+      /// a cached request is answered from the cache by the reception
+      /// thread, without running the callback, until the response expires.
+      /// Only the successful responses are cached, and the cache of the
+      /// service is cleared when it is unadvertised. Calls made from the
+      /// same process and requests for a stream of responses always run the
+      /// callback.
+      /// \param[in] _ttl Time during which a response is served from the
+      /// cache. 0 disables the cache, which is the default.
+      public: void SetReplyCacheTtl(const std::chrono::nanoseconds &_ttl);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
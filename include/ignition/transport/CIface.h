@@ -18,6 +18,9 @@
 #ifndef INCLUDE_IGNITION_TRANSPORT_CIFACE_H_
 #define INCLUDE_IGNITION_TRANSPORT_CIFACE_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "ignition/transport/Export.hh"
 
 #ifdef __cplusplus
@@ -32,6 +35,38 @@ extern "C" {
   /// \brief A transport node.
   typedef struct IgnTransportNode IgnTransportNode;
 
+  /// \brief A publisher of a topic.
+  typedef struct IgnTransportPublisher IgnTransportPublisher;
+
+  /// \brief Information about a received message. The strings are only
+  /// valid during the callback.
+  typedef struct IgnTransportMessageInfo
+  {
+    /// \brief Topic of the message, without the partition.
+    const char *topic;
+
+    /// \brief Partition of the topic.
+    const char *partition;
+
+    /// \brief Name of the message type.
+    const char *msgType;
+
+    /// \brief Address of the process that published the message, empty if
+    /// the message was published in this process.
+    const char *publisherAddress;
+
+    /// \brief 1 if the message was published in this process, 0 otherwise.
+    int intraProcess;
+
+    /// \brief Time when the message was received, in nanoseconds of the
+    /// monotonic clock.
+    int64_t receptionTime;
+  } IgnTransportMessageInfo;
+
+  /// \brief Ownership of the data of a received message, see
+  /// ignTransportSubscribeInfo().
+  typedef struct IgnTransportLoan IgnTransportLoan;
+
   /// \brief Create a transport node.
   /// \param[in] _partition Optional name of the partition to use.
   /// Use nullptr to use the default value, which is specified via the
@@ -60,7 +95,9 @@ extern "C" {
   /// \brief Publishes a message on a topic.
   /// \param[in] _node Pointer to a node.
   /// \param[in] _topic Topic on which to publish the message.
-  /// \param[in] _data Byte array of serialized data to publish.
+  /// \param[in] _data Null terminated byte array of serialized data to
+  /// publish. Use ignTransportPublishData() for data that might contain
+  /// null bytes, like most serialized messages.
   /// \param[in] _msgType Name of the message type.
   /// \return 0 on success.
   int IGNITION_TRANSPORT_VISIBLE
@@ -69,6 +106,50 @@ extern "C" {
                       const void *_data,
                       const char *_msgType);
 
+  /// \brief Publishes a message on a topic.
+  /// \param[in] _node Pointer to a node.
+  /// \param[in] _topic Topic on which to publish the message.
+  /// \param[in] _data Byte array of serialized data to publish.
+  /// \param[in] _size Size of the data (bytes).
+  /// \param[in] _msgType Name of the message type.
+  /// \return 0 on success.
+  int IGNITION_TRANSPORT_VISIBLE
+  ignTransportPublishData(IgnTransportNode *_node,
+                          const char *_topic,
+                          const void *_data,
+                          size_t _size,
+                          const char *_msgType);
+
+  /// \brief Advertise a topic and get a publisher for it. Publishing with
+  /// the publisher doesn't look up the topic, which is faster than
+  /// ignTransportPublishData() for high rate publications.
+  /// \param[in] _node Pointer to a node.
+  /// \param[in] _topic Topic on which to publish the messages.
+  /// \param[in] _msgType Name of the message type.
+  /// \return A pointer to a new publisher, or null if the topic couldn't be
+  /// advertised. Do not manually delete this pointer, instead use
+  /// ignTransportPublisherDestroy. The topic stays advertised while the
+  /// publisher exists.
+  IgnTransportPublisher IGNITION_TRANSPORT_VISIBLE
+  *ignTransportAdvertisePublisher(IgnTransportNode *_node,
+                                  const char *_topic,
+                                  const char *_msgType);
+
+  /// \brief Publishes a message with a publisher.
+  /// \param[in] _pub Pointer to a publisher.
+  /// \param[in] _data Byte array of serialized data to publish.
+  /// \param[in] _size Size of the data (bytes).
+  /// \return 0 on success.
+  int IGNITION_TRANSPORT_VISIBLE
+  ignTransportPublisherPublish(IgnTransportPublisher *_pub,
+                               const void *_data,
+                               size_t _size);
+
+  /// \brief Destroy a publisher.
+  /// \param[in, out] _pub The publisher to destroy.
+  void IGNITION_TRANSPORT_VISIBLE
+  ignTransportPublisherDestroy(IgnTransportPublisher **_pub);
+
   /// \brief Subscribe to a topic, and register a callback.
   /// \param[in] _node Pointer to a node.
   /// \param[in] _topic Name of the topic.
@@ -104,6 +185,33 @@ extern "C" {
                             void (*_callback)(char *, size_t, char *, void *),
                             void *_userData);
 
+  /// \brief Subscribe to a topic, and register a callback that gets all
+  /// the information about the messages, without copying it.
+  ///
+  /// The callback receives the data, its size, the information about the
+  /// message, a loan and _userData. Without _loan, the loan is null and the
+  /// data is only valid during the callback. With _loan, the data belongs to
+  /// the loan, and it stays valid until the loan is released with
+  /// ignTransportLoanRelease(), in the callback or later, so the callback can
+  /// keep it without copying it.
+  /// \param[in] _node Pointer to a node.
+  /// \param[in] _topic Name of the topic.
+  /// \param[in] _loan Non zero to loan the data to the callback.
+  /// \param[in] _callback The function to call when a message is received.
+  /// \param[in] _userData Arbitrary user data pointer.
+  /// \return 0 on success.
+  int IGNITION_TRANSPORT_VISIBLE
+  ignTransportSubscribeInfo(IgnTransportNode *_node,
+                const char *_topic, int _loan,
+                void (*_callback)(const char *, size_t,
+                  const IgnTransportMessageInfo *, IgnTransportLoan *, void *),
+                void *_userData);
+
+  /// \brief Release the data of a message loaned to a callback.
+  /// \param[in] _loan The loan. Null is ignored.
+  void IGNITION_TRANSPORT_VISIBLE
+  ignTransportLoanRelease(IgnTransportLoan *_loan);
+
   /// \brief Unsubscribe from a topic.
   /// \param[in] _node Pointer to a node.
   /// \param[in] _topic Name of the topic.
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_CALLBACKTRACE_HH_
+#define IGN_TRANSPORT_CALLBACKTRACE_HH_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class CallbackTrace CallbackTrace.hh
+    /// ignition/transport/CallbackTrace.hh
+    /// \brief Execution times of the callbacks of a handler: how long they
+    /// run and how long the messages wait from their reception until their
+    /// callback starts. The traces are only recorded when the
+    /// IGN_TRANSPORT_CALLBACK_TRACING environment variable is set to 1. This
+    /// class is thread safe.
+    class CallbackTrace
+    {
+      /// \brief Account for an execution of the callback.
+      /// \param[in] _duration Time spent in the callback.
+      /// \param[in] _delay Time from the reception of the message until the
+      /// callback started.
+      public: void Record(const std::chrono::nanoseconds &_duration,
+                          const std::chrono::nanoseconds &_delay)
+      {
+        const auto duration = static_cast<uint64_t>(_duration.count());
+        const auto delay = static_cast<uint64_t>(_delay.count());
+        this->count.fetch_add(1, std::memory_order_relaxed);
+        this->totalDuration.fetch_add(duration, std::memory_order_relaxed);
+        this->totalDelay.fetch_add(delay, std::memory_order_relaxed);
+        UpdateMax(this->maxDuration, duration);
+        UpdateMax(this->maxDelay, delay);
+      }
+
+      /// \brief Get the number of callbacks executed.
+      /// \return The number of callbacks.
+      public: uint64_t Count() const
+      {
+        return this->count.load(std::memory_order_relaxed);
+      }
+
+      /// \brief Get the total time spent in the callbacks.
+      /// \return The time spent.
+      public: std::chrono::nanoseconds TotalDuration() const
+      {
+        return Load(this->totalDuration);
+      }
+
+      /// \brief Get the longest time spent in a callback.
+      /// \return The longest time.
+      public: std::chrono::nanoseconds MaxDuration() const
+      {
+        return Load(this->maxDuration);
+      }
+
+      /// \brief Get the total time that the messages waited for their
+      /// callbacks.
+      /// \return The waiting time.
+      public: std::chrono::nanoseconds TotalDelay() const
+      {
+        return Load(this->totalDelay);
+      }
+
+      /// \brief Get the longest time that a message waited for its callback.
+      /// \return The longest waiting time.
+      public: std::chrono::nanoseconds MaxDelay() const
+      {
+        return Load(this->maxDelay);
+      }
+
+      /// \brief Read a time.
+      /// \param[in] _value The time (ns).
+      /// \return The time.
+      private: static std::chrono::nanoseconds Load(
+                   const std::atomic<uint64_t> &_value)
+      {
+        return std::chrono::nanoseconds(
+          _value.load(std::memory_order_relaxed));
+      }
+
+      /// \brief Update a maximum.
+      /// \param[in, out] _max The maximum.
+      /// \param[in] _value The new value.
+      private: static void UpdateMax(std::atomic<uint64_t> &_max,
+                                     const uint64_t _value)
+      {
+        uint64_t current = _max.load(std::memory_order_relaxed);
+        while (current < _value && !_max.compare_exchange_weak(current,
+                 _value, std::memory_order_relaxed))
+        {
+        }
+      }
+
+      /// \brief Number of callbacks executed.
+      private: std::atomic<uint64_t> count{0};
+
+      /// \brief Time spent in the callbacks (ns).
+      private: std::atomic<uint64_t> totalDuration{0};
+
+      /// \brief Longest time spent in a callback (ns).
+      private: std::atomic<uint64_t> maxDuration{0};
+
+      /// \brief Time waited by the messages (ns).
+      private: std::atomic<uint64_t> totalDelay{0};
+
+      /// \brief Longest time waited by a message (ns).
+      private: std::atomic<uint64_t> maxDelay{0};
+    };
+    }
+  }
+}
+#endif
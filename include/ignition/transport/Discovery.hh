@@ -59,13 +59,22 @@
 #include <ignition/msgs/discovery.pb.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <queue>
+#include <random>
+#include <set>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include <ignition/msgs/Utility.hh>
@@ -75,7 +84,9 @@
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/NetUtils.hh"
 #include "ignition/transport/Publisher.hh"
+#include "ignition/transport/ThreadConfig.hh"
 #include "ignition/transport/TopicStorage.hh"
+#include "ignition/transport/TopicUtils.hh"
 #include "ignition/transport/TransportTypes.hh"
 
 namespace ignition
@@ -105,6 +116,126 @@ namespace ignition
       const std::vector<int> &_sockets,
       const int _timeout);
 
+    /// \internal
+    /// \brief Discovery helper function to poll several sockets at once.
+    /// \param[in] _sockets Sockets on which to listen.
+    /// \param[in] _timeout Length of time to poll (milliseconds).
+    /// \param[out] _ready For each socket, true if it received data.
+    /// \return True if any socket received data.
+    bool IGNITION_TRANSPORT_VISIBLE pollSockets(
+      const std::vector<int> &_sockets,
+      const int _timeout,
+      std::vector<bool> &_ready);
+
+    /// \internal
+    /// \brief Remove from a message the fields that have the same value in a
+    /// previous message, so merging the result into the previous message
+    /// restores the original one. Used by the compact encoding of the
+    /// discovery messages.
+    /// \param[in] _prev The previous message.
+    /// \param[in,out] _msg The message, of the same type as _prev.
+    /// \return False if merging can't restore the message, e.g.: because a
+    /// field set in _prev isn't set in _msg. _msg is left partially
+    /// modified in that case.
+    bool IGNITION_TRANSPORT_VISIBLE diffMessage(
+      const google::protobuf::Message &_prev,
+      google::protobuf::Message &_msg);
+
+    /// \internal
+    /// \brief Serialize a discovery message as a frame preceded by its size,
+    /// and append it to a buffer.
+    /// \param[in] _msg Discovery message.
+    /// \param[in,out] _buffer The buffer.
+    /// \return True on success or false if the message couldn't be
+    /// serialized or the buffer would be too large for a datagram.
+    bool IGNITION_TRANSPORT_VISIBLE appendDiscoveryFrame(
+      const msgs::Discovery &_msg,
+      std::string &_buffer);
+
+    /// \internal
+    /// \brief Pack discovery messages in as few datagrams as possible. The
+    /// datagrams fit in an Ethernet MTU, so they aren't fragmented. A message
+    /// that doesn't fit in that size on its own is sent alone.
+    /// \param[in] _msgs Discovery messages.
+    /// \param[in] _compact True for encoding each message as the
+    /// difference with the previous one in the datagram.
+    /// \param[in] _tag Optional function called on the first message of
+    /// each datagram, before encoding it.
+    /// \param[in] _partitionTags True for tagging the datagrams whose
+    /// messages belong to a single partition. \sa readPartitionTag.
+    /// \return The datagrams.
+    std::vector<std::string> IGNITION_TRANSPORT_VISIBLE packDiscoveryMsgs(
+      const std::vector<msgs::Discovery> &_msgs,
+      const bool _compact,
+      const std::function<void(msgs::Discovery &_msg)> &_tag = nullptr,
+      const bool _partitionTags = false);
+
+    /// \internal
+    /// \brief Get the hash of the partition of a fully qualified topic name.
+    /// It's the same in all the processes.
+    /// \param[in] _topic Fully qualified topic name.
+    /// \return The hash, never 0, or 0 if _topic isn't fully qualified.
+    uint32_t IGNITION_TRANSPORT_VISIBLE partitionHash(
+      const std::string &_topic);
+
+    /// \internal
+    /// \brief Get the hash of the partition of the topic of a discovery
+    /// message.
+    /// \param[in] _msg Discovery message.
+    /// \return The hash, or 0 if the message isn't about a topic, e.g.: a
+    /// heartbeat.
+    uint32_t IGNITION_TRANSPORT_VISIBLE partitionHash(
+      const msgs::Discovery &_msg);
+
+    /// \internal
+    /// \brief Prepend a partition tag to a datagram, so the processes that
+    /// don't use the partition discard it without parsing its messages.
+    /// \param[in] _hash Hash of the partition. \sa partitionHash.
+    /// \param[in,out] _datagram The datagram.
+    void IGNITION_TRANSPORT_VISIBLE tagPartition(
+      const uint32_t _hash,
+      std::string &_datagram);
+
+    /// \internal
+    /// \brief Read the partition tag of a datagram.
+    /// \param[in] _data The datagram.
+    /// \param[in] _size Size of the datagram.
+    /// \param[out] _hash Hash of the partition of all its messages.
+    /// \return False if the datagram isn't tagged.
+    bool IGNITION_TRANSPORT_VISIBLE readPartitionTag(
+      const char *_data,
+      const size_t _size,
+      uint32_t &_hash);
+
+    /// \internal
+    /// \brief Unpack the discovery messages of a datagram. Messages that
+    /// can't be parsed are skipped.
+    /// \param[in] _data The datagram.
+    /// \param[in] _size Size of the datagram.
+    /// \param[out] _msgs Discovery messages.
+    /// \return False if the datagram isn't well formed and must be ignored.
+    bool IGNITION_TRANSPORT_VISIBLE unpackDiscoveryMsgs(
+      const char *_data,
+      const size_t _size,
+      std::vector<msgs::Discovery> &_msgs);
+
+    /// \internal
+    /// \brief Unpack the discovery messages of a datagram, reusing the
+    /// messages of a previous datagram. Parsing into an existing message
+    /// keeps the memory of its fields, so a receiving loop that keeps _msgs
+    /// doesn't allocate once it has seen datagrams of every size.
+    /// \param[in] _data The datagram.
+    /// \param[in] _size Size of the datagram.
+    /// \param[in,out] _msgs Discovery messages. The first _count elements
+    /// are the messages of the datagram, the rest are left for later.
+    /// \param[out] _count Number of messages unpacked.
+    /// \return False if the datagram isn't well formed and must be ignored.
+    bool IGNITION_TRANSPORT_VISIBLE unpackDiscoveryMsgs(
+      const char *_data,
+      const size_t _size,
+      std::vector<msgs::Discovery> &_msgs,
+      size_t &_count);
+
     /// \class Discovery Discovery.hh ignition/transport/Discovery.hh
     /// \brief A discovery class that implements a distributed topic discovery
     /// protocol. It uses UDP multicast for sending/receiving messages and
@@ -141,6 +272,10 @@ namespace ignition
           exit(false),
           enabled(false)
       {
+        std::string ignInterest;
+        this->interestOnly = env("IGN_DISCOVERY_INTEREST", ignInterest) &&
+          ignInterest == "1";
+
         std::string ignIp;
         if (env("IGN_IP", ignIp) && !ignIp.empty())
           this->hostInterfaces = {ignIp};
@@ -163,6 +298,18 @@ namespace ignition
           return;
         }
 #endif
+        // All the discovery traffic goes through a discovery server instead
+        // of the multicast group. Fall back to multicast if the server can't
+        // be used.
+        std::string server;
+        if (env("IGN_DISCOVERY_SERVER", server) && !server.empty() &&
+            this->UseServer(server))
+        {
+          if (this->verbose)
+            this->PrintCurrentState();
+          return;
+        }
+
         for (const auto &netIface : this->hostInterfaces)
         {
           auto succeed = this->RegisterNetIface(netIface);
@@ -255,11 +402,22 @@ namespace ignition
         this->exitMutex.unlock();
 
         // Wait for the service threads to finish before exit.
+        this->WakeUp();
         if (this->threadReception.joinable())
           this->threadReception.join();
 
+        if (this->wakeupSocket >= 0)
+        {
+#ifdef _WIN32
+          closesocket(this->wakeupSocket);
+#else
+          close(this->wakeupSocket);
+#endif
+        }
+
         // Broadcast a BYE message to trigger the remote cancellation of
-        // all our advertised topics.
+        // all our advertised topics. The unadvertisements not sent yet go
+        // first, in the same burst.
         this->SendMsg(DestinationType::ALL, msgs::Discovery::BYE,
           Publisher("", "", this->pUuid, "", AdvertiseOptions()));
 
@@ -294,8 +452,24 @@ namespace ignition
         this->timeNextHeartbeat = now;
         this->timeNextActivity = now;
 
+        this->CreateWakeupSocket();
+
         // Start the thread that receives discovery information.
         this->threadReception = std::thread(&Discovery::RecvMessages, this);
+
+        // Ask all the peers for their state, so we don't wait for their next
+        // heartbeat to learn about their publishers. Not needed when we only
+        // track a few topics, or with a discovery server, which answers each
+        // topic request on its own.
+        bool snapshot;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          snapshot = !this->interestOnly && !this->serverMode;
+          this->snapshotRequested = snapshot;
+          this->timeSnapshotRequested = std::chrono::steady_clock::now();
+        }
+        if (snapshot)
+          this->SendResyncRequest(kAnyPeer);
       }
 
       /// \brief Advertise a new message.
@@ -313,6 +487,9 @@ namespace ignition
           // Add the addressing information (local publisher).
           if (!this->info.AddPublisher(_publisher))
             return false;
+
+          if (_publisher.Options().Scope() != Scope_t::PROCESS)
+            this->BumpEpoch();
         }
 
         // Only advertise a message outside this process if the scope
@@ -335,6 +512,19 @@ namespace ignition
       /// \return True if the method succeeded or false otherwise
       /// (e.g. if the discovery has not been started).
       public: bool Discover(const std::string &_topic) const
+      {
+        return this->Discover(std::vector<std::string>{_topic});
+      }
+
+      /// \brief Request discovery information about a set of topics. The
+      /// discovery requests are packed in as few datagrams as possible, which
+      /// is preferable to calling Discover() once per topic when subscribing
+      /// to many topics at once.
+      /// \sa Discover(const std::string &).
+      /// \param[in] _topics Topic names requested.
+      /// \return True if the method succeeded or false otherwise
+      /// (e.g. if the discovery has not been started).
+      public: bool Discover(const std::vector<std::string> &_topics) const
       {
         DiscoveryCallback<Pub> cb;
         bool found;
@@ -349,20 +539,35 @@ namespace ignition
           cb = this->connectionCb;
         }
 
-        Pub pub;
-        pub.SetTopic(_topic);
-        pub.SetPUuid(this->pUuid);
-
-        // Send a discovery request.
-        this->SendMsg(DestinationType::ALL, msgs::Discovery::SUBSCRIBE, pub);
-
+        // Remember what we're interested in.
         {
           std::lock_guard<std::mutex> lock(this->mutex);
-          found = this->info.Publishers(_topic, addresses);
+          this->interests.insert(_topics.begin(), _topics.end());
+        }
+
+        std::vector<msgs::Discovery> requests(_topics.size());
+        for (size_t i = 0; i < _topics.size(); ++i)
+        {
+          Pub pub;
+          pub.SetTopic(_topics[i]);
+          pub.SetPUuid(this->pUuid);
+          this->FillMsg(msgs::Discovery::SUBSCRIBE, pub, requests[i]);
         }
 
-        if (found)
+        // Send the discovery requests.
+        this->SendBatch(DestinationType::ALL, requests);
+
+        for (const auto &topic : _topics)
         {
+          addresses.clear();
+          {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            found = this->info.Publishers(topic, addresses);
+          }
+
+          if (!found)
+            continue;
+
           // I already have information about this topic.
           for (const auto &proc : addresses)
           {
@@ -382,6 +587,54 @@ namespace ignition
         return true;
       }
 
+      /// \brief Request discovery information about all the topics under a
+      /// prefix, see TopicUtils::MatchesPrefix(). The connection callback is
+      /// executed for the publishers already known, and for the ones
+      /// advertised later as usual. The peers only answer requests for exact
+      /// topics, so in the interest-only mode the topics are found when
+      /// their publishers advertise them.
+      /// \param[in] _prefix Fully qualified prefix of the topics.
+      /// \return True if the method succeeded or false otherwise
+      /// (e.g. if the discovery has not been started).
+      /// \sa SetInterestOnly.
+      public: bool DiscoverPrefix(const std::string &_prefix) const
+      {
+        DiscoveryCallback<Pub> cb;
+        std::vector<Pub> known;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+
+          if (!this->enabled)
+            return false;
+
+          cb = this->connectionCb;
+          this->interestPrefixes.insert(_prefix);
+
+          std::vector<std::string> topics;
+          this->info.TopicList(topics);
+          for (const auto &topic : topics)
+          {
+            Addresses_M<Pub> addresses;
+            if (!TopicUtils::MatchesPrefix(topic, _prefix) ||
+                !this->info.Publishers(topic, addresses))
+            {
+              continue;
+            }
+
+            for (const auto &proc : addresses)
+              known.insert(known.end(), proc.second.begin(), proc.second.end());
+          }
+        }
+
+        if (cb)
+        {
+          for (const auto &pub : known)
+            cb(pub);
+        }
+
+        return true;
+      }
+
       /// \brief Register a node from this process as a remote subscriber.
       /// \param[in] _pub Contains information about the subscriber.
       public: void Register(const MessagePublisher &_pub) const
@@ -390,6 +643,25 @@ namespace ignition
           DestinationType::ALL, msgs::Discovery::NEW_CONNECTION, _pub);
       }
 
+      /// \brief Register a node from this process as a remote subscriber,
+      /// telling the publisher if the node collects topic statistics. It can
+      /// be called again to change the statistics preference.
+      /// \param[in] _pub Contains information about the subscriber.
+      /// \param[in] _stats True if the subscriber wants the publication
+      /// metadata used for topic statistics.
+      /// \sa StatsRegistrationsCb.
+      public: void Register(const MessagePublisher &_pub,
+                            const bool _stats) const
+      {
+        msgs::Discovery msg;
+        if (!this->FillMsg(msgs::Discovery::NEW_CONNECTION, _pub, msg))
+          return;
+
+        if (_stats)
+          msg.mutable_header()->add_data()->set_key(kStatsKey);
+        this->SendDiscoveryMsg(DestinationType::ALL, msg);
+      }
+
       /// \brief Unregister a node from this process as a remote subscriber.
       /// \param[in] _pub Contains information about the subscriber.
       public: void Unregister(const MessagePublisher &_pub) const
@@ -398,6 +670,20 @@ namespace ignition
           DestinationType::ALL, msgs::Discovery::END_CONNECTION, _pub);
       }
 
+      /// \brief Unregister nodes from this process as remote subscribers,
+      /// packing the discovery messages in as few datagrams as possible.
+      /// \param[in] _pubs Contain information about the subscribers.
+      public: void Unregister(const std::vector<MessagePublisher> &_pubs) const
+      {
+        std::vector<msgs::Discovery> unregistrations(_pubs.size());
+        for (size_t i = 0; i < _pubs.size(); ++i)
+        {
+          this->FillMsg(msgs::Discovery::END_CONNECTION, _pubs[i],
+            unregistrations[i]);
+        }
+        this->SendBatch(DestinationType::ALL, unregistrations);
+      }
+
       /// \brief Get the discovery information.
       /// \return Reference to the discovery information object.
       public: const TopicStorage<Pub> &Info() const
@@ -406,6 +692,21 @@ namespace ignition
         return this->info;
       }
 
+      /// \brief Get the discovery traffic of this process since it started,
+      /// for monitoring purposes.
+      /// \param[out] _sentDatagrams Number of datagrams sent.
+      /// \param[out] _sentBytes Number of bytes sent.
+      /// \param[out] _recvDatagrams Number of datagrams received.
+      /// \param[out] _recvBytes Number of bytes received.
+      public: void Traffic(uint64_t &_sentDatagrams, uint64_t &_sentBytes,
+                           uint64_t &_recvDatagrams, uint64_t &_recvBytes) const
+      {
+        _sentDatagrams = this->sentDatagrams.load(std::memory_order_relaxed);
+        _sentBytes = this->sentBytes.load(std::memory_order_relaxed);
+        _recvDatagrams = this->recvDatagrams.load(std::memory_order_relaxed);
+        _recvBytes = this->recvBytes.load(std::memory_order_relaxed);
+      }
+
       /// \brief Get all the publishers' information known for a given topic.
       /// \param[in] _topic Topic name.
       /// \param[out] _publishers Publishers requested.
@@ -440,19 +741,83 @@ namespace ignition
 
           // Remove the topic information.
           this->info.DelPublisherByNode(_topic, this->pUuid, _nUuid);
+
+          if (inf.Options().Scope() != Scope_t::PROCESS)
+            this->BumpEpoch();
         }
 
         // Only unadvertise a message outside this process if the scope
         // is not 'Process'.
         if (inf.Options().Scope() != Scope_t::PROCESS)
         {
-          this->SendMsg(DestinationType::ALL,
-              msgs::Discovery::UNADVERTISE, inf);
+          std::vector<msgs::Discovery> unadvertisement(1);
+          this->FillMsg(msgs::Discovery::UNADVERTISE, inf,
+            unadvertisement.front());
+          this->QueueUnadvertisements(std::move(unadvertisement));
+        }
+
+        return true;
+      }
+
+      /// \brief Unadvertise several topics advertised by a node, packing the
+      /// discovery messages in as few datagrams as possible.
+      /// \param[in] _topics Topic names to be unadvertised.
+      /// \param[in] _nUuid Node UUID.
+      /// \return True if the method succeeded or false otherwise
+      /// (e.g. if the discovery has not been started).
+      /// \sa Unadvertise(const std::string &, const std::string &)
+      public: bool Unadvertise(const std::vector<std::string> &_topics,
+                               const std::string &_nUuid)
+      {
+        std::vector<Pub> infos;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+
+          if (!this->enabled)
+            return false;
+
+          for (const auto &topic : _topics)
+          {
+            // Skip the topics not advertised by any of my nodes.
+            Pub inf;
+            if (!this->info.Publisher(topic, this->pUuid, _nUuid, inf))
+              continue;
+
+            // Remove the topic information.
+            this->info.DelPublisherByNode(topic, this->pUuid, _nUuid);
+
+            if (inf.Options().Scope() != Scope_t::PROCESS)
+            {
+              this->BumpEpoch();
+              infos.push_back(std::move(inf));
+            }
+          }
+        }
+
+        std::vector<msgs::Discovery> unadvertisements(infos.size());
+        for (size_t i = 0; i < infos.size(); ++i)
+        {
+          this->FillMsg(msgs::Discovery::UNADVERTISE, infos[i],
+            unadvertisements[i]);
         }
+        this->QueueUnadvertisements(std::move(unadvertisements));
 
         return true;
       }
 
+      /// \brief Send the unadvertisements queued by Unadvertise() now,
+      /// instead of waiting for the reception thread, e.g.: when the process
+      /// exits. Any other discovery message sends them first.
+      public: void FlushUnadvertisements() const
+      {
+        std::vector<msgs::Discovery> pending;
+        {
+          std::lock_guard<std::mutex> lock(this->unadvertiseMutex);
+          pending.swap(this->pendingUnadvertisements);
+        }
+        this->SendBatch(DestinationType::ALL, pending);
+      }
+
       /// \brief Get the IP address of this host.
       /// \return A string with this host's IP address.
       public: std::string HostAddr() const
@@ -519,6 +884,109 @@ namespace ignition
         this->silenceInterval = _ms;
       }
 
+      /// \brief Check if only the topics of interest are tracked.
+      /// \return True if only the publishers of the topics passed to
+      /// Discover() are stored and notified.
+      /// \sa SetInterestOnly.
+      public: bool InterestOnly() const
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->interestOnly;
+      }
+
+      /// \brief Only track the topics of interest, i.e. the ones passed to
+      /// Discover() by subscribing, requesting a service or watching a topic.
+      /// The advertisements of other topics are ignored, so memory and CPU
+      /// usage follow the topics that the process uses. TopicList() only
+      /// reports the topics of interest in this mode. It can also be enabled
+      /// with IGN_DISCOVERY_INTEREST=1. It's disabled by default.
+      /// \param[in] _enabled True for tracking the topics of interest only.
+      /// \sa InterestOnly.
+      public: void SetInterestOnly(const bool _enabled)
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->interestOnly = _enabled;
+      }
+
+      /// \brief Let the discovery know that the transport lost its
+      /// connection to a publisher address, e.g.: because the process died
+      /// and its heartbeats timed out. The publishers of the process are
+      /// removed without waiting for its silence to last the silence
+      /// interval, and the disconnection callback is executed for each of
+      /// them. If the process is still alive, its state is requested again
+      /// with its next heartbeat. Processes that don't announce the epoch of
+      /// their state are left alone, since they could never be requested it.
+      /// \param[in] _addr The address.
+      public: void Disconnected(const std::string &_addr)
+      {
+        std::vector<Pub> removed;
+        DiscoveryCallback<Pub> disconnectCb;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          std::string proc;
+          if (!this->info.ProcessByAddr(_addr, proc))
+            return;
+
+          auto peer = this->peers.find(proc);
+          if (peer == this->peers.end() || !peer->second.epochs)
+            return;
+
+          std::map<std::string, std::vector<Pub>> nodes;
+          this->info.PublishersByProc(proc, nodes);
+          for (const auto &node : nodes)
+          {
+            removed.insert(removed.end(), node.second.begin(),
+              node.second.end());
+          }
+          this->info.DelPublishersByProc(proc);
+
+          // No epoch matches, so the next heartbeat asks for the state.
+          peer->second.epoch = std::numeric_limits<uint64_t>::max();
+          peer->second.synced = false;
+          peer->second.received.clear();
+          disconnectCb = this->disconnectionCb;
+        }
+
+        if (this->verbose)
+        {
+          std::cout << "\t* Connection to [" << _addr << "] lost"
+                    << std::endl;
+        }
+
+        if (disconnectCb)
+        {
+          for (const auto &pub : removed)
+            disconnectCb(pub);
+        }
+      }
+
+      /// \brief Declare a partition used by the process. Once there is one,
+      /// the datagrams tagged with other partitions are discarded before
+      /// parsing them, so the traffic of the processes in other partitions
+      /// sharing the multicast group costs little. The tags can be disabled
+      /// with IGN_DISCOVERY_PARTITIONS=0. They aren't used with unicast
+      /// relays, which forward the traffic of all the partitions.
+      /// \param[in] _partition Partition name, as in NodeOptions.
+      public: void AddPartition(const std::string &_partition)
+      {
+        // The partition is the prefix of the fully qualified names.
+        std::string name;
+        if (!TopicUtils::FullyQualifiedName(_partition, "", "/p", name))
+          return;
+
+        bool resync;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          resync = !this->partitions.empty() && this->enabled;
+          if (!this->partitions.insert(partitionHash(name)).second)
+            return;
+        }
+
+        // The publishers of the new partition may have been discarded.
+        if (resync)
+          this->SendResyncRequest(kAnyPeer);
+      }
+
       /// \brief Register a callback to receive discovery connection events.
       /// Each time a new topic is connected, the callback will be executed.
       /// This version uses a free function as callback.
@@ -557,6 +1025,19 @@ namespace ignition
         this->unregistrationCb = _cb;
       }
 
+      /// \brief Register a callback to receive, for each registration of a
+      /// remote subscriber, whether it wants the publication metadata used
+      /// for topic statistics. It's executed after the callback set with
+      /// RegistrationsCb().
+      /// \param[in] _cb Function callback, with the subscriber and true if
+      /// it collects statistics.
+      public: void StatsRegistrationsCb(
+        const std::function<void(const Pub &_pub, const bool _stats)> &_cb)
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->statsRegistrationCb = _cb;
+      }
+
       /// \brief Print the current discovery state.
       public: void PrintCurrentState() const
       {
@@ -600,18 +1081,101 @@ namespace ignition
       }
 
       /// \brief Get the list of topics currently advertised in the network.
+      /// It waits for the discovery to converge, see WaitForInit().
       /// \param[out] _topics List of advertised topics.
       public: void TopicList(std::vector<std::string> &_topics) const
       {
-        this->WaitForInit();
+        this->TopicList(_topics,
+          std::chrono::milliseconds(2 * this->HeartbeatInterval()));
+      }
+
+      /// \brief Get the list of topics currently advertised in the network,
+      /// waiting up to a timeout for the discovery to converge.
+      /// \param[out] _topics List of advertised topics.
+      /// \param[in] _timeout Maximum time to wait for the peers, see
+      /// WaitForSnapshot().
+      public: void TopicList(std::vector<std::string> &_topics,
+                             const std::chrono::milliseconds &_timeout) const
+      {
+        // With a discovery server we only know about the topics we asked
+        // for. Ask for all of them, the server answers with a heartbeat once
+        // it has sent them, so there is no initialization phase to wait for.
+        if (!this->serverMode)
+          this->WaitForSnapshot(_timeout);
+        else
+        {
+          Pub pub;
+          pub.SetPUuid(this->pUuid);
+          msgs::Discovery msg;
+          this->FillMsg(msgs::Discovery::SUBSCRIBE, pub, msg);
+          msg.mutable_header()->add_data()->set_key(kAllKey);
+
+          std::unique_lock<std::mutex> lk(this->mutex);
+          const Timestamp requested = std::chrono::steady_clock::now();
+          lk.unlock();
+          this->SendDiscoveryMsg(DestinationType::ALL, msg);
+          lk.lock();
+          this->serverCv.wait_for(lk,
+            std::min(_timeout,
+              std::chrono::milliseconds(this->heartbeatInterval)),
+            [this, requested]
+            {
+              return this->lastServerHeartbeat > requested;
+            });
+        }
+
         std::lock_guard<std::mutex> lock(this->mutex);
         this->info.TopicList(_topics);
       }
 
+      /// \brief Wait until the peers have answered the request for their
+      /// state sent by Start(), which usually takes much less time than the
+      /// initialization phase. The answers are considered complete once no
+      /// publisher has been advertised for kSnapshotQuiet, after the peers
+      /// had kMinResyncInterval to answer, or after _timeout. The discovery
+      /// is initialized then, so WaitForInit() doesn't block anymore. Without
+      /// a request, e.g. with a discovery server, it waits for the
+      /// initialization phase, two heartbeats, up to _timeout.
+      /// \param[in] _timeout Maximum time to wait.
+      public: void WaitForSnapshot(
+                  const std::chrono::milliseconds &_timeout) const
+      {
+        std::unique_lock<std::mutex> lk(this->mutex);
+        if (!this->snapshotRequested)
+        {
+          this->initializedCv.wait_for(lk, _timeout,
+            [this]{return this->initialized;});
+          return;
+        }
+
+        const Timestamp deadline = std::chrono::steady_clock::now() + _timeout;
+        while (!this->initialized)
+        {
+          const Timestamp quietUntil = std::max(
+            this->timeSnapshotRequested + kMinResyncInterval,
+            this->timeLastAdvertisement) + kSnapshotQuiet;
+          const Timestamp until = std::min(deadline, quietUntil);
+          if (std::chrono::steady_clock::now() >= until)
+            break;
+          this->initializedCv.wait_until(lk, until);
+        }
+
+        if (!this->initialized)
+        {
+          this->initialized = true;
+          this->initializedCv.notify_all();
+        }
+      }
+
       /// \brief Check if ready/initialized. If not, then wait on the
-      /// initializedCv condition variable.
+      /// initializedCv condition variable. When the state of the peers was
+      /// requested, the discovery is ready as soon as their answers are
+      /// complete, see WaitForSnapshot(), usually long before the two
+      /// heartbeats of the initialization phase.
       public: void WaitForInit() const
       {
+        this->WaitForSnapshot(
+          std::chrono::milliseconds(2 * this->HeartbeatInterval()));
         std::unique_lock<std::mutex> lk(this->mutex);
 
         if (!this->initialized)
@@ -641,25 +1205,48 @@ namespace ignition
 
           disconnectCb = this->disconnectionCb;
 
-          for (auto it = this->activity.cbegin(); it != this->activity.cend();)
+          // Only look at the processes whose last known activity is too old.
+          // The activity of most of them has been updated since then, so
+          // they're scheduled again with their current activity.
+          const std::chrono::milliseconds silence(this->silenceInterval);
+          while (!this->expirations.empty() &&
+                 now - this->expirations.top().first > silence)
           {
-            // Elapsed time since the last update from this publisher.
-            auto elapsed = now - it->second;
+            const std::string procUuid = this->expirations.top().second;
+            this->expirations.pop();
 
-            // This publisher has expired.
-            if (std::chrono::duration_cast<std::chrono::milliseconds>
-                 (elapsed).count() > this->silenceInterval)
+            auto it = this->activity.find(procUuid);
+            if (it == this->activity.end())
             {
-              // Remove all the info entries for this process UUID.
-              this->info.DelPublishersByProc(it->first);
+              // It's gone already, e.g.: after a BYE.
+              this->scheduled.erase(procUuid);
+              continue;
+            }
 
-              uuids.push_back(it->first);
+            // Last update from this publisher. With a discovery server, we
+            // only hear from a process when its state changes, and the server
+            // tells us when it's gone. Its entries are valid while the server
+            // is alive.
+            Timestamp last = it->second;
+            if (this->serverMode)
+              last = std::max(last, this->lastServerContact);
 
-              // Remove the activity entry.
-              this->activity.erase(it++);
+            if (now - last <= silence)
+            {
+              this->expirations.emplace(last, procUuid);
+              continue;
             }
-            else
-              ++it;
+
+            // This publisher has expired. Remove all the info entries for
+            // this process UUID.
+            this->info.DelPublishersByProc(procUuid);
+
+            uuids.push_back(procUuid);
+            this->peers.erase(procUuid);
+
+            // Remove the activity entry.
+            this->activity.erase(it);
+            this->scheduled.erase(procUuid);
           }
 
           this->timeNextActivity = std::chrono::steady_clock::now() +
@@ -692,25 +1279,12 @@ namespace ignition
             return;
         }
 
-        Publisher pub("", "", this->pUuid, "", AdvertiseOptions());
-        this->SendMsg(DestinationType::ALL, msgs::Discovery::HEARTBEAT, pub);
-
-        std::map<std::string, std::vector<Pub>> nodes;
-        {
-          std::lock_guard<std::mutex> lock(this->mutex);
-
-          // Re-advertise topics that are advertised inside this process.
-          this->info.PublishersByProc(this->pUuid, nodes);
-        }
+        this->SendHeartbeat();
 
-        for (const auto &topic : nodes)
-        {
-          for (const auto &node : topic.second)
-          {
-            this->SendMsg(DestinationType::ALL,
-                msgs::Discovery::ADVERTISE, node);
-          }
-        }
+        // Peers that don't track epochs learn about our topics from the
+        // periodic advertisements.
+        if (!this->AllPeers(&PeerState::epochs))
+          this->SendFullState();
 
         {
           std::lock_guard<std::mutex> lock(this->mutex);
@@ -733,6 +1307,89 @@ namespace ignition
         }
       }
 
+      /// \brief Send a heartbeat. It carries the epoch of our state, so the
+      /// peers can tell if their copy is up to date.
+      private: void SendHeartbeat()
+      {
+        msgs::Discovery heartbeat;
+        this->FillMsg(msgs::Discovery::HEARTBEAT,
+          Publisher("", "", this->pUuid, "", AdvertiseOptions()), heartbeat);
+        uint64_t stateEpoch;
+        std::vector<Pub> state;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          stateEpoch = this->epoch;
+          this->LocalState(state);
+        }
+        heartbeat.mutable_header()->MergeFrom(
+          StateHeader(stateEpoch, state));
+        this->SendDiscoveryMsg(DestinationType::ALL, heartbeat);
+
+        if (this->verbose)
+          std::cout << "\t* Sending HEARTBEAT msg" << std::endl;
+      }
+
+      /// \brief Increase the epoch of the local state, after a change sent
+      /// to the peers. The change is a single datagram, so the new epoch is
+      /// repeated by heartbeats at growing, jittered intervals: a peer that
+      /// lost the change sees that its copy is out of date and asks for our
+      /// state, without waiting for the next periodic heartbeat. The peers up
+      /// to date don't answer. Must be called with the mutex locked.
+      private: void BumpEpoch()
+      {
+        ++this->epoch;
+
+        const Timestamp previous = this->timeNextBeacon;
+        const bool pending = this->beaconBackoff.count() > 0;
+        this->beaconBackoff = kBeaconDelay;
+        this->timeNextBeacon = std::chrono::steady_clock::now() +
+          this->Jitter(this->beaconBackoff);
+
+        // Let the reception thread update its timeout.
+        if (!pending || this->timeNextBeacon < previous)
+          this->WakeUp();
+      }
+
+      /// \brief Get a random duration around a given one, so the peers that
+      /// change their state together don't send their beacons together.
+      /// Must be called with the mutex locked.
+      /// \param[in] _duration The duration.
+      /// \return A duration between 75% and 125% of _duration.
+      private: std::chrono::milliseconds Jitter(
+                   const std::chrono::milliseconds &_duration)
+      {
+        std::uniform_real_distribution<double> factor(0.75, 1.25);
+        return std::chrono::milliseconds(static_cast<int64_t>(
+          static_cast<double>(_duration.count()) * factor(this->jitterRng)));
+      }
+
+      /// \brief Send the heartbeat that repeats the epoch of a recent state
+      /// change, if it's time to. \sa BumpEpoch.
+      private: void UpdateBeacon()
+      {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (this->beaconBackoff.count() == 0 ||
+              std::chrono::steady_clock::now() < this->timeNextBeacon)
+          {
+            return;
+          }
+
+          // Exponential backoff, until the periodic heartbeats take over.
+          this->beaconBackoff *= 2;
+          if (2 * this->beaconBackoff >=
+              std::chrono::milliseconds(this->heartbeatInterval))
+            this->beaconBackoff = std::chrono::milliseconds::zero();
+          else
+          {
+            this->timeNextBeacon = std::chrono::steady_clock::now() +
+              this->Jitter(this->beaconBackoff);
+          }
+        }
+
+        this->SendHeartbeat();
+      }
+
       /// \brief Calculate the next timeout. There are three main activities to
       /// perform by the discovery component:
       /// 1. Receive discovery messages.
@@ -745,35 +1402,95 @@ namespace ignition
       private: int NextTimeout() const
       {
         auto now = std::chrono::steady_clock::now();
-        auto timeUntilNextHeartbeat = this->timeNextHeartbeat - now;
-        auto timeUntilNextActivity = this->timeNextActivity - now;
-
-        int t = static_cast<int>(
-          std::chrono::duration_cast<std::chrono::milliseconds>
-            (std::min(timeUntilNextHeartbeat, timeUntilNextActivity)).count());
-        int t2 = std::min(t, this->kTimeout);
-        return std::max(t2, 0);
-      }
+        auto timeUntilNext = this->timeNextHeartbeat - now;
 
-      /// \brief Receive discovery messages.
-      private: void RecvMessages()
-      {
-        bool timeToExit = false;
-        while (!timeToExit)
         {
-          // Calculate the timeout.
-          int timeout = this->NextTimeout();
+          std::lock_guard<std::mutex> lock(this->mutex);
+
+          // The oldest activity is the next one that can expire.
+          if (!this->expirations.empty())
+          {
+            const auto nextExpiration = this->expirations.top().first +
+              std::chrono::milliseconds(this->silenceInterval + 1);
+            timeUntilNext = std::min(timeUntilNext,
+              std::max(this->timeNextActivity, nextExpiration) - now);
+          }
+
+          if (this->resyncRequested)
+          {
+            timeUntilNext = std::min(timeUntilNext,
+              this->timeLastFullState + kMinResyncInterval - now);
+          }
+
+          if (this->beaconBackoff.count() > 0)
+          {
+            timeUntilNext = std::min(timeUntilNext,
+              this->timeNextBeacon - now);
+          }
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(this->unadvertiseMutex);
+          if (!this->pendingUnadvertisements.empty())
+          {
+            timeUntilNext = std::min(timeUntilNext,
+              this->timeFlushUnadvertisements - now);
+          }
+        }
+
+        if (!this->relayQueue.empty())
+          timeUntilNext = std::min(timeUntilNext, this->timeFlushRelays - now);
+
+        // Round up, so we don't wake up right before the deadline.
+        int t = static_cast<int>(
+          std::chrono::ceil<std::chrono::milliseconds>(timeUntilNext).count());
+
+        // Without a wakeup socket, we need to check for exit regularly.
+        if (this->wakeupSocket < 0)
+          t = std::min(t, this->kTimeout);
+        return std::max(t, 0);
+      }
+
+      /// \brief Receive discovery messages.
+      private: void RecvMessages()
+      {
+        ThreadConfig::Global().Apply("ign-discovery");
+
+        bool timeToExit = false;
+        while (!timeToExit)
+        {
+          // Calculate the timeout.
+          int timeout = this->NextTimeout();
+
+          std::vector<int> pollSet = {this->sockets.at(0)};
+          if (this->wakeupSocket >= 0)
+            pollSet.push_back(this->wakeupSocket);
 
-          if (pollSockets(this->sockets, timeout))
+          std::vector<bool> ready;
+          if (pollSockets(pollSet, timeout, ready))
           {
-            this->RecvDiscoveryUpdate();
+            if (ready.at(0))
+            {
+              this->RecvDiscoveryUpdate();
+
+              if (this->verbose)
+                this->PrintCurrentState();
+            }
 
-            if (this->verbose)
-              this->PrintCurrentState();
+            if (ready.size() > 1 && ready.at(1))
+            {
+              char c;
+              recv(this->wakeupSocket, reinterpret_cast<raw_type *>(&c),
+                sizeof(c), 0);
+            }
           }
 
+          this->UpdateUnadvertisements();
+          this->UpdateRelays();
+          this->UpdateBeacon();
           this->UpdateHeartbeat();
           this->UpdateActivity();
+          this->UpdateResync();
 
           // Is it time to exit?
           {
@@ -798,44 +1515,68 @@ namespace ignition
               reinterpret_cast<socklen_t *>(&addrLen));
         if (received > 0)
         {
-          uint16_t len = 0;
-          memcpy(&len, &rcvStr[0], sizeof(len));
-
-          // Ignition Transport delimits each discovery message with a
-          // frame_delimiter that contains byte size information.
-          // A discovery message has the form:
-          //
-          // <frame_delimiter><frame_body>
-          //
-          // Ignition Transport version < 8 sends a frame delimiter that
-          // contains the value of sizeof(frame_delimiter)
-          // + sizeof(frame_body). In other words, the frame_delimiter
-          // contains a value that represents the total size of the
-          // frame_body and frame_delimiter in bytes.
-          //
-          // Ignition Transport version >= 8 sends a frame_delimiter
-          // that contains the value of sizeof(frame_body). In other
-          // words, the frame_delimiter contains a value that represents
-          // the total size of only the frame_body.
-          //
-          // It is possible that two incompatible versions of Ignition
-          // Transport exist on the same network. If we receive an
-          // unexpected size, then we ignore the message.
-
-          // If-condition for version 8+
-          if (len + sizeof(len) == received)
+          this->recvDatagrams.fetch_add(1, std::memory_order_relaxed);
+          this->recvBytes.fetch_add(received, std::memory_order_relaxed);
+
+          // Ignore the datagrams of the partitions that we don't use.
+          uint32_t partition;
+          if (readPartitionTag(rcvStr, received, partition) &&
+              this->Foreign(partition))
+          {
+            return;
+          }
+
+          // Ignore the datagram if it isn't well formed. See
+          // unpackDiscoveryMsgs() for details about the format. The
+          // messages of the previous datagrams are reused.
+          auto &msgs = this->rcvMsgs;
+          size_t count;
+          if (!unpackDiscoveryMsgs(rcvStr, received, msgs, count) ||
+              count == 0)
           {
-            std::string srcAddr = inet_ntoa(clntAddr.sin_addr);
-            uint16_t srcPort = ntohs(clntAddr.sin_port);
+            return;
+          }
 
-            if (this->verbose)
+          std::string srcAddr = inet_ntoa(clntAddr.sin_addr);
+          uint16_t srcPort = ntohs(clntAddr.sin_port);
+
+          // A multi-homed peer sends each datagram through all its
+          // interfaces.
+          if (this->Duplicate(srcAddr, msgs.front()))
+            return;
+
+          if (this->serverMode)
+          {
+            if (clntAddr.sin_addr.s_addr != this->serverAddr.sin_addr.s_addr ||
+                clntAddr.sin_port != this->serverAddr.sin_port)
             {
-              std::cout << "\nReceived discovery update from "
-                << srcAddr << ": " << srcPort << std::endl;
+              return;
             }
 
-            this->DispatchDiscoveryMsg(srcAddr, rcvStr + sizeof(len), len);
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->lastServerContact = std::chrono::steady_clock::now();
+          }
+
+          if (this->verbose)
+          {
+            std::cout << "\nReceived discovery update from "
+              << srcAddr << ": " << srcPort << std::endl;
+          }
+
+          // Answers to the messages in this datagram, sent together. The
+          // publishers of a run of unadvertisements are removed together,
+          // before any other message can add them back.
+          std::vector<msgs::Discovery> replies;
+          for (size_t i = 0; i < count; ++i)
+          {
+            auto &msg = msgs[i];
+            if (msg.type() != msgs::Discovery::UNADVERTISE)
+              this->DelUnadvertised();
+            this->DispatchDiscoveryMsg(srcAddr, msg, replies);
           }
+          this->DelUnadvertised();
+          this->ForwardRelayed();
+          this->SendBatch(DestinationType::ALL, replies);
         }
         else if (received < 0)
         {
@@ -844,26 +1585,92 @@ namespace ignition
         }
       }
 
-      /// \brief Parse a discovery message received via the UDP socket
+      /// \brief Check if a datagram is a copy of one that was already
+      /// received through another interface, using the sequence number of
+      /// its first message. It also records the interface that is closest to
+      /// the sender, the one that the first datagram came through.
+      /// \param[in] _fromIp IP address of the sender.
+      /// \param[in] _msg First message of the datagram.
+      /// \return True if the datagram has to be discarded.
+      private: bool Duplicate(const std::string &_fromIp,
+                              const msgs::Discovery &_msg)
+      {
+        // Relayed messages come from a single unicast peer.
+        if (this->serverMode || this->Version() != _msg.version() ||
+            _msg.process_uuid() == this->pUuid ||
+            (_msg.has_flags() && _msg.flags().relay()))
+        {
+          return false;
+        }
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto &peer = this->peers[_msg.process_uuid()];
+        if (peer.iface < 0)
+          peer.iface = this->ClosestIface(_fromIp);
+
+        auto data = FindHeader(_msg, kSeqKey);
+        if (!data || data->value_size() != 1)
+          return false;
+
+        uint64_t seq;
+        try
+        {
+          seq = std::stoull(data->value(0));
+        }
+        catch (...)
+        {
+          return false;
+        }
+
+        auto &seqs = peer.seqs;
+        if (std::find(seqs.begin(), seqs.end(), seq) != seqs.end())
+          return true;
+
+        seqs.push_back(seq);
+        if (seqs.size() > kMaxSeqs)
+          seqs.pop_front();
+        return false;
+      }
+
+      /// \brief Get the socket whose interface shares the longest prefix
+      /// with an address.
+      /// \param[in] _ip The address.
+      /// \return Index of the socket.
+      private: int ClosestIface(const std::string &_ip) const
+      {
+        const uint32_t addr = ntohl(inet_addr(_ip.c_str()));
+        int closest = 0;
+        int longest = -1;
+        for (size_t i = 0; i < this->socketIfaces.size(); ++i)
+        {
+          const uint32_t diff =
+            addr ^ ntohl(inet_addr(this->socketIfaces[i].c_str()));
+          int prefix = 0;
+          while (prefix < 32 && !(diff & (0x80000000u >> prefix)))
+            ++prefix;
+
+          if (prefix > longest)
+          {
+            longest = prefix;
+            closest = static_cast<int>(i);
+          }
+        }
+        return closest;
+      }
+
+      /// \brief Process a discovery message received via the UDP socket
       /// \param[in] _fromIp IP address of the message sender.
       /// \param[in] _msg Received message.
-      /// \param[in] _len Entire length of the package in octets.
+      /// \param[out] _replies Discovery messages to send as an answer.
       private: void DispatchDiscoveryMsg(const std::string &_fromIp,
-                                         char *_msg, uint16_t _len)
+                                         msgs::Discovery &_msg,
+                                         std::vector<msgs::Discovery> &_replies)
       {
-        ignition::msgs::Discovery msg;
-
-        // Parse the message, and return if parsing failed. Parsing could
-        // fail when another discovery node is publishing messages using an
-        // older (or newer) format.
-        if (!msg.ParseFromArray(_msg, _len))
-          return;
-
         // Discard the message if the wire protocol is different than mine.
-        if (this->Version() != msg.version())
+        if (this->Version() != _msg.version())
           return;
 
-        std::string recvPUuid = msg.process_uuid();
+        const std::string &recvPUuid = _msg.process_uuid();
 
         // Discard our own discovery messages.
         if (recvPUuid == this->pUuid)
@@ -872,18 +1679,20 @@ namespace ignition
         // Forwarding summary:
         //   - From a unicast peer  -> to multicast group (with NO_RELAY flag).
         //   - From multicast group -> to unicast peers (with RELAY flag).
+        //   - Nothing when using a discovery server.
 
         // If the RELAY flag is set, this discovery message is coming via a
         // unicast transmission. In this case, we don't process it, we just
         // forward it to the multicast group, and it will be dispatched once
         // received there. Note that we also unset the RELAY flag and set the
         // NO_RELAY flag, to avoid forwarding the message anymore.
-        if (msg.has_flags() && msg.flags().relay())
+        if (!this->serverMode && _msg.has_flags() && _msg.flags().relay())
         {
-          // Unset the RELAY flag in the header and set the NO_RELAY.
-          msg.mutable_flags()->set_relay(false);
-          msg.mutable_flags()->set_no_relay(true);
-          this->SendMulticast(msg);
+          // Unset the RELAY flag in the header and set the NO_RELAY. The
+          // messages of the datagram are forwarded together.
+          _msg.mutable_flags()->set_relay(false);
+          _msg.mutable_flags()->set_no_relay(true);
+          this->forwarded.push_back(_msg);
 
           // A unicast peer contacted me. I need to save its address for
           // sending future messages in the future.
@@ -894,14 +1703,18 @@ namespace ignition
         // and the NO_RELAY flag is not set, we forward this message via unicast
         // to all our relays. Note that this is the most common case, where we
         // receive a regular multicast message and we forward it to any remote
-        // relays.
-        else if (!msg.has_flags() || !msg.flags().no_relay())
+        // relays. The messages are batched, see QueueRelay().
+        else if (!this->serverMode &&
+                 (!_msg.has_flags() || !_msg.flags().no_relay()))
         {
-          msg.mutable_flags()->set_relay(true);
-          this->SendUnicast(msg);
+          _msg.mutable_flags()->set_relay(true);
+          this->QueueRelay(_msg);
         }
 
-        bool isSenderLocal = (std::find(this->hostInterfaces.begin(),
+        // The discovery server only forwards HOST scoped publishers to the
+        // processes on the same host.
+        bool isSenderLocal = this->serverMode ||
+          (std::find(this->hostInterfaces.begin(),
           this->hostInterfaces.end(), _fromIp) != this->hostInterfaces.end()) ||
           (_fromIp.find("127.") == 0);
 
@@ -910,53 +1723,87 @@ namespace ignition
         DiscoveryCallback<Pub> disconnectCb;
         DiscoveryCallback<Pub> registerCb;
         DiscoveryCallback<Pub> unregisterCb;
+        std::function<void(const Pub &, const bool)> statsCb;
         {
           std::lock_guard<std::mutex> lock(this->mutex);
-          this->activity[recvPUuid] = std::chrono::steady_clock::now();
+          const Timestamp now = std::chrono::steady_clock::now();
+          this->activity[recvPUuid] = now;
+          if (this->scheduled.insert(recvPUuid).second)
+            this->expirations.emplace(now, recvPUuid);
           connectCb = this->connectionCb;
           disconnectCb = this->disconnectionCb;
           registerCb = this->registrationCb;
           unregisterCb = this->unregistrationCb;
+          statsCb = this->statsRegistrationCb;
         }
 
-        switch (msg.type())
+        switch (_msg.type())
         {
           case msgs::Discovery::ADVERTISE:
           {
             // Read the rest of the fields.
-            Pub publisher;
-            publisher.SetFromDiscovery(msg);
+            Pub &publisher = this->rcvPub;
+            publisher.SetFromDiscovery(_msg);
 
             // Check scope of the topic.
-            if ((publisher.Options().Scope() == Scope_t::PROCESS) ||
-                (publisher.Options().Scope() == Scope_t::HOST &&
-                 !isSenderLocal))
+            if ((publisher.Options().Scope() != Scope_t::PROCESS) &&
+                (publisher.Options().Scope() != Scope_t::HOST ||
+                 isSenderLocal) &&
+                this->Interested(publisher.Topic()))
             {
-              return;
-            }
+              // Register an advertised address for the topic.
+              bool added;
+              {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                added = this->info.AddPublisher(publisher);
+                this->timeLastAdvertisement = std::chrono::steady_clock::now();
+              }
 
-            // Register an advertised address for the topic.
-            bool added;
-            {
-              std::lock_guard<std::mutex> lock(this->mutex);
-              added = this->info.AddPublisher(publisher);
+              if (added && connectCb)
+              {
+                // Execute the client's callback.
+                connectCb(publisher);
+              }
             }
 
-            if (added && connectCb)
+            // Part of the full state of the peer.
+            uint64_t epoch = 0;
+            uint64_t count = 0;
+            if (ReadStateHeader(_msg, epoch, count))
             {
-              // Execute the client's callback.
-              connectCb(publisher);
+              // The publishers of the partitions that we don't use aren't
+              // counted, since we may not receive them.
+              const bool counted = !FindHeader(_msg, kPartitionsKey) ||
+                !this->Foreign(partitionHash(publisher.Topic()));
+              this->UpdatePeerState(recvPUuid, epoch,
+                this->StateCount(_msg, count),
+                counted ? &publisher : nullptr, disconnectCb);
             }
 
             break;
           }
           case msgs::Discovery::SUBSCRIBE:
           {
+            // A peer asking for the full state of some processes.
+            auto resync = FindHeader(_msg, kResyncKey);
+            if (resync)
+            {
+              if (std::find(resync->value().begin(), resync->value().end(),
+                    this->pUuid) != resync->value().end() ||
+                  std::find(resync->value().begin(), resync->value().end(),
+                    kAnyPeer) != resync->value().end())
+              {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->resyncRequested = true;
+              }
+              break;
+            }
+
             std::string recvTopic;
             // Read the topic information.
-            if (msg.has_sub())
+            if (_msg.has_sub())
             {
-              recvTopic = msg.sub().topic();
+              recvTopic = _msg.sub().topic();
             }
             else
             {
@@ -989,8 +1836,9 @@ namespace ignition
               }
 
               // Answer an ADVERTISE message.
-              this->SendMsg(DestinationType::ALL,
-                  msgs::Discovery::ADVERTISE, nodeInfo);
+              _replies.emplace_back();
+              this->FillMsg(msgs::Discovery::ADVERTISE, nodeInfo,
+                _replies.back());
             }
 
             break;
@@ -998,19 +1846,22 @@ namespace ignition
           case msgs::Discovery::NEW_CONNECTION:
           {
             // Read the rest of the fields.
-            Pub publisher;
-            publisher.SetFromDiscovery(msg);
+            Pub &publisher = this->rcvPub;
+            publisher.SetFromDiscovery(_msg);
 
             if (registerCb)
               registerCb(publisher);
 
+            if (statsCb)
+              statsCb(publisher, FindHeader(_msg, kStatsKey) != nullptr);
+
             break;
           }
           case msgs::Discovery::END_CONNECTION:
           {
             // Read the rest of the fields.
-            Pub publisher;
-            publisher.SetFromDiscovery(msg);
+            Pub &publisher = this->rcvPub;
+            publisher.SetFromDiscovery(_msg);
 
             if (unregisterCb)
               unregisterCb(publisher);
@@ -1019,7 +1870,35 @@ namespace ignition
           }
           case msgs::Discovery::HEARTBEAT:
           {
-            // The timestamp has already been updated.
+            // The timestamp has already been updated. Remember what the peer
+            // supports.
+            uint64_t epoch = 0;
+            uint64_t count = 0;
+            const bool hasState = ReadStateHeader(_msg, epoch, count);
+            {
+              std::lock_guard<std::mutex> lock(this->mutex);
+              auto &peer = this->peers[recvPUuid];
+              peer.batch = FindHeader(_msg, kBatchKey) != nullptr;
+              peer.compact = FindHeader(_msg, kCompactKey) != nullptr;
+              peer.partitions = FindHeader(_msg, kPartitionsKey) != nullptr;
+              peer.epochs = hasState;
+
+              // Only the discovery server sends us heartbeats.
+              if (this->serverMode)
+              {
+                this->serverUuid = recvPUuid;
+                this->lastServerHeartbeat = std::chrono::steady_clock::now();
+                this->serverCv.notify_all();
+              }
+            }
+
+            // Ask for the state of the peer if our copy is out of date.
+            if (hasState &&
+                this->UpdatePeerState(recvPUuid, epoch,
+                  this->StateCount(_msg, count), nullptr, disconnectCb))
+            {
+              this->SendResyncRequest(recvPUuid);
+            }
             break;
           }
           case msgs::Discovery::BYE:
@@ -1028,6 +1907,7 @@ namespace ignition
             {
               std::lock_guard<std::mutex> lock(this->mutex);
               this->activity.erase(recvPUuid);
+              this->peers.erase(recvPUuid);
             }
 
             if (disconnectCb)
@@ -1049,13 +1929,14 @@ namespace ignition
           case msgs::Discovery::UNADVERTISE:
           {
             // Read the address.
-            Pub publisher;
-            publisher.SetFromDiscovery(msg);
+            Pub &publisher = this->rcvPub;
+            publisher.SetFromDiscovery(_msg);
 
             // Check scope of the topic.
             if ((publisher.Options().Scope() == Scope_t::PROCESS) ||
                 (publisher.Options().Scope() == Scope_t::HOST &&
-                 !isSenderLocal))
+                 !isSenderLocal) ||
+                !this->Interested(publisher.Topic()))
             {
               return;
             }
@@ -1066,18 +1947,15 @@ namespace ignition
               disconnectCb(publisher);
             }
 
-            // Remove the address entry for this topic.
-            {
-              std::lock_guard<std::mutex> lock(this->mutex);
-              this->info.DelPublisherByNode(publisher.Topic(),
-                publisher.PUuid(), publisher.NUuid());
-            }
+            // Remove the address entry for this topic, with the rest of the
+            // unadvertisements of the datagram. \sa DelUnadvertised().
+            this->unadvertised.push_back(std::move(publisher));
 
             break;
           }
           default:
           {
-            std::cerr << "Unknown message type [" << msg.type() << "].\n";
+            std::cerr << "Unknown message type [" << _msg.type() << "].\n";
             break;
           }
         }
@@ -1095,9 +1973,31 @@ namespace ignition
                    const T &_pub) const
       {
         ignition::msgs::Discovery discoveryMsg;
-        discoveryMsg.set_version(this->Version());
-        discoveryMsg.set_type(_type);
-        discoveryMsg.set_process_uuid(this->pUuid);
+        if (!this->FillMsg(_type, _pub, discoveryMsg))
+          return;
+
+        this->SendDiscoveryMsg(_destType, discoveryMsg);
+
+        if (this->verbose)
+        {
+          std::cout << "\t* Sending " << msgs::ToString(_type)
+                    << " msg [" << _pub.Topic() << "]" << std::endl;
+        }
+      }
+
+      /// \brief Build a discovery message.
+      /// \param[in] _type Message type.
+      /// \param[in] _pub Publishers's information to send.
+      /// \param[out] _msg The discovery message.
+      /// \return True on success or false if the type is unknown.
+      private: template<typename T>
+      bool FillMsg(const msgs::Discovery::Type _type,
+                   const T &_pub,
+                   msgs::Discovery &_msg) const
+      {
+        _msg.set_version(this->Version());
+        _msg.set_type(_type);
+        _msg.set_process_uuid(this->pUuid);
 
         switch (_type)
         {
@@ -1106,27 +2006,50 @@ namespace ignition
           case msgs::Discovery::NEW_CONNECTION:
           case msgs::Discovery::END_CONNECTION:
           {
-            _pub.FillDiscovery(discoveryMsg);
+            _pub.FillDiscovery(_msg);
             break;
           }
           case msgs::Discovery::SUBSCRIBE:
           {
-            discoveryMsg.mutable_sub()->set_topic(_pub.Topic());
+            _msg.mutable_sub()->set_topic(_pub.Topic());
             break;
           }
           case msgs::Discovery::HEARTBEAT:
+          {
+            // Let the peers know that we accept batched datagrams and the
+            // compact encoding.
+            auto data = _msg.mutable_header()->add_data();
+            data->set_key(kBatchKey);
+            data->add_value("1");
+            data = _msg.mutable_header()->add_data();
+            data->set_key(kCompactKey);
+            data->add_value("1");
+            break;
+          }
           case msgs::Discovery::BYE:
             break;
           default:
             std::cerr << "Discovery::SendMsg() error: Unrecognized message"
                       << " type [" << _type << "]" << std::endl;
-            return;
+            return false;
         }
 
+        return true;
+      }
+
+      /// \brief Send a discovery message.
+      /// \param[in] _destType Destination of the message.
+      /// \param[in] _msg Discovery message.
+      private: void SendDiscoveryMsg(const DestinationType &_destType,
+                                     msgs::Discovery _msg) const
+      {
+        // The peers receive the messages in order.
+        this->FlushUnadvertisements();
+
         if (_destType == DestinationType::MULTICAST ||
             _destType == DestinationType::ALL)
         {
-          this->SendMulticast(discoveryMsg);
+          this->SendMulticast(_msg);
         }
 
         // Send the discovery message to the unicast relays.
@@ -1134,166 +2057,628 @@ namespace ignition
             _destType == DestinationType::ALL)
         {
           // Set the RELAY flag in the header.
-          discoveryMsg.mutable_flags()->set_relay(true);
-          this->SendUnicast(discoveryMsg);
+          _msg.mutable_flags()->set_relay(true);
+          this->SendUnicast(_msg);
+        }
+      }
+
+      /// \brief Send a set of discovery messages, packing as many of them as
+      /// possible in each datagram. If any of the known peers doesn't accept
+      /// batched datagrams, the messages are sent one by one.
+      /// \param[in] _destType Destination of the messages.
+      /// \param[in] _msgs Discovery messages.
+      private: void SendBatch(const DestinationType &_destType,
+                              const std::vector<msgs::Discovery> &_msgs) const
+      {
+        if (_msgs.empty())
+          return;
+
+        // The peers receive the messages in order.
+        this->FlushUnadvertisements();
+
+        if (_msgs.size() == 1 || !this->AllPeers(&PeerState::batch))
+        {
+          for (const auto &msg : _msgs)
+            this->SendDiscoveryMsg(_destType, msg);
+        }
+        else
+        {
+          const bool compact =
+            CompactEnabled() && this->AllPeers(&PeerState::compact);
+
+          if (_destType == DestinationType::MULTICAST ||
+              _destType == DestinationType::ALL)
+          {
+            const bool everywhere = std::any_of(_msgs.begin(), _msgs.end(),
+              &Discovery::Announcement);
+            std::function<void(msgs::Discovery &)> tag;
+            if (this->MultiHomed())
+              tag = [this](msgs::Discovery &_msg) {this->TagSequence(_msg);};
+
+            for (const auto &datagram :
+                   packDiscoveryMsgs(_msgs, compact, tag,
+                     this->PartitionTags()))
+            {
+              this->SendMulticast(datagram, everywhere);
+            }
+          }
+
+          // Send the discovery messages to the unicast relays.
+          if ((_destType == DestinationType::UNICAST ||
+               _destType == DestinationType::ALL) && !this->relayAddrs.empty())
+          {
+            // Set the RELAY flag in the headers.
+            std::vector<msgs::Discovery> relayed = _msgs;
+            for (auto &msg : relayed)
+              msg.mutable_flags()->set_relay(true);
+
+            for (const auto &datagram : packDiscoveryMsgs(relayed, compact))
+              this->SendUnicast(datagram);
+          }
         }
 
         if (this->verbose)
         {
-          std::cout << "\t* Sending " << msgs::ToString(_type)
-                    << " msg [" << _pub.Topic() << "]" << std::endl;
+          std::cout << "\t* Sending " << _msgs.size() << " discovery msgs"
+                    << std::endl;
         }
       }
 
-      /// \brief Send a discovery message through all unicast relays.
-      /// \param[in] _msg Discovery message.
-      private: void SendUnicast(const msgs::Discovery &_msg) const
+      /// \brief Forward declaration.
+      private: struct PeerState;
+
+      /// \brief Check if all the known peers support a feature.
+      /// \param[in] _feature The feature.
+      /// \return True if they do.
+      private: bool AllPeers(bool PeerState::*_feature) const
       {
-        uint16_t msgSize;
+        std::lock_guard<std::mutex> lock(this->mutex);
 
-#if GOOGLE_PROTOBUF_VERSION >= 3004000
-        size_t msgSizeFull = _msg.ByteSizeLong();
-#else
-        int msgSizeFull = _msg.ByteSize();
-#endif
-        if (msgSizeFull + sizeof(msgSize) > this->kMaxRcvStr)
+        // We only talk to the discovery server.
+        if (this->serverMode)
         {
-          std::cerr << "Discovery message too large to send. Discovery won't "
-            << "work. This shouldn't happen.\n";
-          return;
+          auto server = this->peers.find(this->serverUuid);
+          return server != this->peers.end() && server->second.*_feature;
         }
-        msgSize = msgSizeFull;
 
-        uint16_t totalSize = sizeof(msgSize) + msgSize;
-        char *buffer = static_cast<char *>(new char[totalSize]);
-        memcpy(&buffer[0], &msgSize, sizeof(msgSize));
+        for (const auto &proc : this->activity)
+        {
+          auto peer = this->peers.find(proc.first);
+          if (peer == this->peers.end() || !(peer->second.*_feature))
+            return false;
+        }
+        return true;
+      }
 
-        if (_msg.SerializeToArray(buffer + sizeof(msgSize), msgSize))
+      /// \brief Get the local publishers announced to the peers. Must be
+      /// called with the mutex locked.
+      /// \param[out] _state The publishers.
+      private: void LocalState(std::vector<Pub> &_state) const
+      {
+        std::map<std::string, std::vector<Pub>> nodes;
+        this->info.PublishersByProc(this->pUuid, nodes);
+        for (const auto &topic : nodes)
         {
-          // Send the discovery message to the unicast relays.
-          for (const auto &sockAddr : this->relayAddrs)
+          for (const auto &node : topic.second)
           {
-            errno = 0;
-            auto sent = sendto(this->sockets.at(0),
-              reinterpret_cast<const raw_type *>(
-                reinterpret_cast<const unsigned char*>(buffer)),
-              totalSize, 0,
-              reinterpret_cast<const sockaddr *>(&sockAddr),
-              sizeof(sockAddr));
-
-            if (sent != totalSize)
-            {
-              std::cerr << "Exception sending a unicast message:" << std::endl;
-              std::cerr << "  Return value: " << sent << std::endl;
-              std::cerr << "  Error code: " << strerror(errno) << std::endl;
-              break;
-            }
+            if (node.Options().Scope() != Scope_t::PROCESS)
+              _state.push_back(node);
           }
         }
-        else
+      }
+
+      /// \brief Advertise all the local publishers, tagged with the epoch of
+      /// the state.
+      private: void SendFullState()
+      {
+        uint64_t stateEpoch;
+        std::vector<Pub> state;
         {
-          std::cerr << "Discovery::SendUnicast: Error serializing data."
-            << std::endl;
+          std::lock_guard<std::mutex> lock(this->mutex);
+          stateEpoch = this->epoch;
+          this->LocalState(state);
+          this->resyncRequested = false;
+          this->timeLastFullState = std::chrono::steady_clock::now();
         }
 
-        delete [] buffer;
+        const msgs::Header header = StateHeader(stateEpoch, state);
+        std::vector<msgs::Discovery> adverts(state.size());
+        for (size_t i = 0; i < state.size(); ++i)
+        {
+          this->FillMsg(msgs::Discovery::ADVERTISE, state[i], adverts[i]);
+          adverts[i].mutable_header()->MergeFrom(header);
+        }
+        this->SendBatch(DestinationType::ALL, adverts);
       }
 
-      /// \brief Send a discovery message through the multicast group.
-      /// \param[in] _msg Discovery message.
-      private: void SendMulticast(const msgs::Discovery &_msg) const
+      /// \brief Send our full state if a peer asked for it. Requests are
+      /// coalesced, so the state isn't sent more often than every
+      /// kMinResyncInterval.
+      private: void UpdateResync()
       {
-        uint16_t msgSize;
-
-#if GOOGLE_PROTOBUF_VERSION >= 3004000
-        size_t msgSizeFull = _msg.ByteSizeLong();
-#else
-        int msgSizeFull = _msg.ByteSize();
-#endif
-        if (msgSizeFull + sizeof(msgSize) > this->kMaxRcvStr)
         {
-          std::cerr << "Discovery message too large to send. Discovery won't "
-            << "work. This shouldn't happen.\n";
-          return;
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (!this->resyncRequested ||
+              std::chrono::steady_clock::now() <
+                this->timeLastFullState + kMinResyncInterval)
+          {
+            return;
+          }
         }
 
-        msgSize = msgSizeFull;
-        uint16_t totalSize = sizeof(msgSize) + msgSize;
-        char *buffer = static_cast<char *>(new char[totalSize]);
-        memcpy(&buffer[0], &msgSize, sizeof(msgSize));
+        this->SendFullState();
+      }
+
+      /// \brief Ask a peer for its full state.
+      /// \param[in] _pUuid UUID of the peer, or kAnyPeer for all of them.
+      private: void SendResyncRequest(const std::string &_pUuid) const
+      {
+        Pub pub;
+        pub.SetPUuid(this->pUuid);
+
+        msgs::Discovery msg;
+        this->FillMsg(msgs::Discovery::SUBSCRIBE, pub, msg);
+        auto data = msg.mutable_header()->add_data();
+        data->set_key(kResyncKey);
+        data->add_value(_pUuid);
+        this->SendDiscoveryMsg(DestinationType::ALL, msg);
+      }
 
-        if (_msg.SerializeToArray(buffer + sizeof(msgSize), msgSize))
+      /// \brief Update our copy of the state of a peer. Once all the
+      /// publishers of an epoch have been received, the ones that aren't part
+      /// of it anymore are removed.
+      /// \param[in] _pUuid UUID of the peer.
+      /// \param[in] _epoch Epoch of the state of the peer.
+      /// \param[in] _count Number of publishers in the state of the peer.
+      /// \param[in] _pub A publisher of the state that was received, or
+      /// nullptr.
+      /// \param[in] _disconnectCb Callback notifying the removed publishers.
+      /// \return True if our copy of the state is still incomplete.
+      private: bool UpdatePeerState(const std::string &_pUuid,
+                                    const uint64_t _epoch,
+                                    const uint64_t _count,
+                                    const Pub *_pub,
+                                    const DiscoveryCallback<Pub> &_disconnectCb)
+      {
+        std::vector<Pub> stale;
         {
-          // Send the discovery message to the multicast group through all the
-          // sockets.
-          for (const auto &sock : this->Sockets())
+          std::lock_guard<std::mutex> lock(this->mutex);
+          auto &peer = this->peers[_pUuid];
+          peer.epochs = true;
+          if (peer.epoch != _epoch)
+          {
+            peer.epoch = _epoch;
+            peer.synced = false;
+            peer.received.clear();
+          }
+
+          if (peer.synced)
+            return false;
+
+          if (_pub)
+            peer.received.emplace(_pub->Topic(), _pub->NUuid());
+
+          if (peer.received.size() < _count)
+            return true;
+
+          peer.synced = true;
+
+          std::map<std::string, std::vector<Pub>> nodes;
+          this->info.PublishersByProc(_pUuid, nodes);
+          for (const auto &topic : nodes)
           {
-            errno = 0;
-            if (sendto(sock, reinterpret_cast<const raw_type *>(
-              reinterpret_cast<const unsigned char*>(buffer)),
-              totalSize, 0,
-              reinterpret_cast<const sockaddr *>(this->MulticastAddr()),
-              sizeof(*(this->MulticastAddr()))) != totalSize)
+            for (const auto &node : topic.second)
             {
-              // Ignore EPERM and ENOBUFS errors.
-              //
-              // See issue #106
-              //
-              // Rationale drawn from:
-              //
-              // * https://groups.google.com/forum/#!topic/comp.protocols.tcp-ip/Qou9Sfgr77E
-              // * https://stackoverflow.com/questions/16555101/sendto-dgrams-do-not-block-for-enobufs-on-osx
-              if (errno != EPERM && errno != ENOBUFS)
+              if (peer.received.count({node.Topic(), node.NUuid()}) == 0)
               {
-                std::cerr << "Exception sending a multicast message:"
-                  << strerror(errno) << std::endl;
+                stale.push_back(node);
+                this->info.DelPublisherByNode(node.Topic(), _pUuid,
+                  node.NUuid());
               }
-              break;
             }
           }
+          peer.received.clear();
         }
-        else
+
+        if (_disconnectCb)
         {
-          std::cerr << "Discovery::SendMulticast: Error serializing data."
-            << std::endl;
+          for (const auto &pub : stale)
+            _disconnectCb(pub);
         }
-
-        delete [] buffer;
+        return false;
       }
 
-      /// \brief Get the list of sockets used for discovery.
-      /// \return The list of sockets.
-      private: const std::vector<int> &Sockets() const
+      /// \brief Check if we track the publishers of a topic.
+      /// \param[in] _topic The topic.
+      /// \return True unless only the topics of interest are tracked and
+      /// _topic isn't one of them, nor under one of the prefixes of interest.
+      /// \sa SetInterestOnly.
+      private: bool Interested(const std::string &_topic) const
       {
-        return this->sockets;
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->interestOnly || this->interests.count(_topic) > 0)
+          return true;
+
+        for (const auto &prefix : this->interestPrefixes)
+        {
+          if (TopicUtils::MatchesPrefix(_topic, prefix))
+            return true;
+        }
+        return false;
       }
 
-      /// \brief Get the data structure used for multicast communication.
-      /// \return The data structure containing the multicast information.
-      private: const sockaddr_in *MulticastAddr() const
+      /// \brief Find an entry in the header of a discovery message.
+      /// \param[in] _msg Discovery message.
+      /// \param[in] _key Key of the entry.
+      /// \return The entry or nullptr if not found.
+      private: static const msgs::Header::Map *FindHeader(
+        const msgs::Discovery &_msg, const std::string &_key)
       {
-        return &this->mcastAddr;
+        for (const auto &data : _msg.header().data())
+        {
+          if (data.key() == _key)
+            return &data;
+        }
+        return nullptr;
       }
 
-      /// \brief Get the discovery protocol version.
-      /// \return The discovery version.
-      private: uint8_t Version() const
+      /// \brief Get the header entries that tag a discovery message with
+      /// the epoch of our state. The number of publishers of each partition
+      /// is included, for the peers that only track some of them.
+      /// \param[in] _epoch Epoch of the state.
+      /// \param[in] _state Publishers of the state.
+      /// \return The header entries.
+      private: static msgs::Header StateHeader(const uint64_t _epoch,
+                                               const std::vector<Pub> &_state)
       {
-        static std::string ignStats;
-        static int topicStats =
-          (env("IGN_TRANSPORT_TOPIC_STATISTICS", ignStats) && ignStats == "1");
-        return this->kWireVersion + (topicStats * 100);
+        msgs::Header header;
+        auto data = header.add_data();
+        data->set_key(kEpochKey);
+        data->add_value(std::to_string(_epoch));
+        data->add_value(std::to_string(_state.size()));
+
+        if (!PartitionTagsEnabled())
+          return header;
+
+        std::map<uint32_t, uint64_t> counts;
+        for (const auto &pub : _state)
+          ++counts[partitionHash(pub.Topic())];
+
+        data = header.add_data();
+        data->set_key(kPartitionsKey);
+        for (const auto &count : counts)
+        {
+          data->add_value(std::to_string(count.first) + ":" +
+            std::to_string(count.second));
+        }
+        return header;
       }
 
-      /// \brief Register a new network interface in the discovery system.
-      /// \param[in] _ip IP address to register.
-      /// \return True when the interface was successfully registered or false
-      /// otherwise (e.g.: invalid IP address).
-      private: bool RegisterNetIface(const std::string &_ip)
+      /// \brief Get the number of publishers of the state of a peer that we
+      /// receive, i.e. the ones of the partitions that we use.
+      /// \param[in] _msg Discovery message tagged with the state of the peer.
+      /// \param[in] _count Number of publishers in the state.
+      /// \return The number of publishers received.
+      private: uint64_t StateCount(const msgs::Discovery &_msg,
+                                   const uint64_t _count) const
       {
-        // Make a new socket for sending discovery information.
-        int sock = static_cast<int>(socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP));
-        if (sock < 0)
+        auto data = FindHeader(_msg, kPartitionsKey);
+        if (!data)
+          return _count;
+
+        uint64_t count = _count;
+        for (const auto &value : data->value())
+        {
+          const auto colon = value.find(':');
+          if (colon == std::string::npos)
+            continue;
+
+          try
+          {
+            if (this->Foreign(static_cast<uint32_t>(
+                  std::stoul(value.substr(0, colon)))))
+            {
+              count -= std::min<uint64_t>(count,
+                std::stoull(value.substr(colon + 1)));
+            }
+          }
+          catch (...)
+          {
+            continue;
+          }
+        }
+        return count;
+      }
+
+      /// \brief Check if the datagrams of a partition are discarded, because
+      /// we don't use it. \sa AddPartition.
+      /// \param[in] _hash Hash of the partition. \sa partitionHash.
+      /// \return True if they are.
+      private: bool Foreign(const uint32_t _hash) const
+      {
+        if (!PartitionTagsEnabled() || _hash == 0)
+          return false;
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return !this->partitions.empty() && this->relayAddrs.empty() &&
+          this->partitions.count(_hash) == 0;
+      }
+
+      /// \brief Check if we tag the datagrams that we send with their
+      /// partition. All the peers must accept the tags.
+      /// \return True if we do.
+      private: bool PartitionTags() const
+      {
+        return PartitionTagsEnabled() && !this->serverMode &&
+          this->AllPeers(&PeerState::partitions);
+      }
+
+      /// \brief Read the epoch of the state of a peer from a discovery
+      /// message.
+      /// \param[in] _msg Discovery message.
+      /// \param[out] _epoch Epoch of the state.
+      /// \param[out] _count Number of publishers in the state.
+      /// \return True if the message was tagged with the epoch.
+      private: static bool ReadStateHeader(const msgs::Discovery &_msg,
+                                           uint64_t &_epoch,
+                                           uint64_t &_count)
+      {
+        auto data = FindHeader(_msg, kEpochKey);
+        if (!data || data->value_size() != 2)
+          return false;
+
+        try
+        {
+          _epoch = std::stoull(data->value(0));
+          _count = std::stoull(data->value(1));
+        }
+        catch (...)
+        {
+          return false;
+        }
+        return true;
+      }
+
+      /// \brief Send a discovery message through all unicast relays.
+      /// \param[in] _msg Discovery message.
+      private: void SendUnicast(const msgs::Discovery &_msg) const
+      {
+        std::string buffer;
+        if (appendDiscoveryFrame(_msg, buffer))
+          this->SendUnicast(buffer);
+      }
+
+      /// \brief Send a datagram through all unicast relays.
+      /// \param[in] _buffer The datagram.
+      private: void SendUnicast(const std::string &_buffer) const
+      {
+        uint16_t totalSize = static_cast<uint16_t>(_buffer.size());
+
+        // Send the discovery message to the unicast relays.
+        for (const auto &sockAddr : this->relayAddrs)
+        {
+          errno = 0;
+          auto sent = sendto(this->sockets.at(0),
+            reinterpret_cast<const raw_type *>(
+              reinterpret_cast<const unsigned char*>(_buffer.data())),
+            totalSize, 0,
+            reinterpret_cast<const sockaddr *>(&sockAddr),
+            sizeof(sockAddr));
+
+          if (sent != totalSize)
+          {
+            std::cerr << "Exception sending a unicast message:" << std::endl;
+            std::cerr << "  Return value: " << sent << std::endl;
+            std::cerr << "  Error code: " << strerror(errno) << std::endl;
+            break;
+          }
+          this->CountSent(totalSize);
+        }
+      }
+
+      /// \brief Account for a datagram sent.
+      /// \param[in] _size Size of the datagram (bytes).
+      private: void CountSent(const uint16_t _size) const
+      {
+        this->sentDatagrams.fetch_add(1, std::memory_order_relaxed);
+        this->sentBytes.fetch_add(_size, std::memory_order_relaxed);
+      }
+
+      /// \brief Send a discovery message through the multicast group.
+      /// \param[in] _msg Discovery message.
+      private: void SendMulticast(const msgs::Discovery &_msg) const
+      {
+        std::string buffer;
+        if (this->MultiHomed())
+        {
+          msgs::Discovery tagged = _msg;
+          this->TagSequence(tagged);
+          if (!appendDiscoveryFrame(tagged, buffer))
+            return;
+        }
+        else if (!appendDiscoveryFrame(_msg, buffer))
+          return;
+
+        const uint32_t partition = partitionHash(_msg);
+        if (partition != 0 && this->PartitionTags())
+          tagPartition(partition, buffer);
+        this->SendMulticast(buffer, Announcement(_msg));
+      }
+
+      /// \brief Check if we send the multicast traffic through several
+      /// interfaces.
+      /// \return True if we do.
+      private: bool MultiHomed() const
+      {
+        return !this->serverMode && this->sockets.size() > 1;
+      }
+
+      /// \brief Tag one of our messages with a sequence number, so the peers
+      /// can discard the copies received through our other interfaces. The
+      /// messages of other processes that we relay keep their own tag.
+      /// \param[in,out] _msg The message.
+      private: void TagSequence(msgs::Discovery &_msg) const
+      {
+        if (_msg.process_uuid() != this->pUuid || FindHeader(_msg, kSeqKey))
+          return;
+
+        auto data = _msg.mutable_header()->add_data();
+        data->set_key(kSeqKey);
+        data->add_value(std::to_string(++this->seq));
+      }
+
+      /// \brief Check if a message has to reach the processes that we don't
+      /// know yet, so it's sent through all the interfaces.
+      /// \param[in] _msg The message.
+      /// \return True for heartbeats, discovery requests and goodbyes.
+      private: static bool Announcement(const msgs::Discovery &_msg)
+      {
+        return _msg.type() == msgs::Discovery::HEARTBEAT ||
+               _msg.type() == msgs::Discovery::SUBSCRIBE ||
+               _msg.type() == msgs::Discovery::BYE;
+      }
+
+      /// \brief Send a datagram through the multicast group.
+      /// \param[in] _buffer The datagram.
+      /// \param[in] _everywhere True for sending it through all the
+      /// interfaces. Otherwise, when there are several interfaces, only the
+      /// ones closest to the known peers are used.
+      private: void SendMulticast(const std::string &_buffer,
+                                  const bool _everywhere = true) const
+      {
+        uint16_t totalSize = static_cast<uint16_t>(_buffer.size());
+
+        if (this->serverMode)
+        {
+          errno = 0;
+          if (sendto(this->sockets.at(0), reinterpret_cast<const raw_type *>(
+            reinterpret_cast<const unsigned char*>(_buffer.data())),
+            totalSize, 0,
+            reinterpret_cast<const sockaddr *>(&this->serverAddr),
+            sizeof(this->serverAddr)) != totalSize)
+          {
+            std::cerr << "Exception sending a message to the discovery "
+              << "server:" << strerror(errno) << std::endl;
+            return;
+          }
+          this->CountSent(totalSize);
+          return;
+        }
+
+        // The interfaces closest to the peers.
+        std::vector<bool> used(this->sockets.size(), true);
+        if (!_everywhere && this->MultiHomed())
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          std::vector<bool> closest(this->sockets.size(), false);
+          bool known = !this->activity.empty();
+          for (const auto &proc : this->activity)
+          {
+            auto peer = this->peers.find(proc.first);
+            if (peer == this->peers.end() || peer->second.iface < 0)
+            {
+              known = false;
+              break;
+            }
+            closest[peer->second.iface] = true;
+          }
+          if (known)
+            used = closest;
+        }
+
+        // Send the discovery message to the multicast group through the
+        // sockets.
+        for (size_t i = 0; i < this->sockets.size(); ++i)
+        {
+          if (!used[i])
+            continue;
+
+          const int sock = this->sockets[i];
+          errno = 0;
+          if (sendto(sock, reinterpret_cast<const raw_type *>(
+            reinterpret_cast<const unsigned char*>(_buffer.data())),
+            totalSize, 0,
+            reinterpret_cast<const sockaddr *>(this->MulticastAddr()),
+            sizeof(*(this->MulticastAddr()))) != totalSize)
+          {
+            // Ignore EPERM and ENOBUFS errors.
+            //
+            // See issue #106
+            //
+            // Rationale drawn from:
+            //
+            // * https://groups.google.com/forum/#!topic/comp.protocols.tcp-ip/Qou9Sfgr77E
+            // * https://stackoverflow.com/questions/16555101/sendto-dgrams-do-not-block-for-enobufs-on-osx
+            if (errno != EPERM && errno != ENOBUFS)
+            {
+              std::cerr << "Exception sending a multicast message:"
+                << strerror(errno) << std::endl;
+            }
+            break;
+          }
+          this->CountSent(totalSize);
+        }
+      }
+
+      /// \brief Get the list of sockets used for discovery.
+      /// \return The list of sockets.
+      private: const std::vector<int> &Sockets() const
+      {
+        return this->sockets;
+      }
+
+      /// \brief Get the data structure used for multicast communication.
+      /// \return The data structure containing the multicast information.
+      private: const sockaddr_in *MulticastAddr() const
+      {
+        return &this->mcastAddr;
+      }
+
+      /// \brief Check if the partition tags are enabled with
+      /// IGN_DISCOVERY_PARTITIONS. \sa AddPartition.
+      /// \return True if enabled.
+      private: static bool PartitionTagsEnabled()
+      {
+        static std::string ignPartitions;
+        static const bool enabled =
+          !(env("IGN_DISCOVERY_PARTITIONS", ignPartitions) &&
+            ignPartitions == "0");
+        return enabled;
+      }
+
+      /// \brief Check if the compact encoding of batched datagrams is
+      /// enabled with IGN_DISCOVERY_COMPACT.
+      /// \return True if enabled.
+      private: static bool CompactEnabled()
+      {
+        static std::string ignCompact;
+        static const bool enabled =
+          !(env("IGN_DISCOVERY_COMPACT", ignCompact) && ignCompact == "0");
+        return enabled;
+      }
+
+      /// \brief Get the discovery protocol version.
+      /// \return The discovery version.
+      private: uint8_t Version() const
+      {
+        static std::string ignStats;
+        static int topicStats =
+          (env("IGN_TRANSPORT_TOPIC_STATISTICS", ignStats) && ignStats == "1");
+        // The publication metadata used for the statistics is only sent to
+        // the subscribers that ask for it. This framing isn't compatible with
+        // older processes using statistics, which used a different offset.
+        return this->kWireVersion + (topicStats * 120);
+      }
+
+      /// \brief Register a new network interface in the discovery system.
+      /// \param[in] _ip IP address to register.
+      /// \return True when the interface was successfully registered or false
+      /// otherwise (e.g.: invalid IP address).
+      private: bool RegisterNetIface(const std::string &_ip)
+      {
+        // Make a new socket for sending discovery information.
+        int sock = static_cast<int>(socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP));
+        if (sock < 0)
         {
           std::cerr << "Socket creation failed." << std::endl;
           return false;
@@ -1313,6 +2698,7 @@ namespace ignition
         }
 
         this->sockets.push_back(sock);
+        this->socketIfaces.push_back(_ip);
 
         // Join the multicast group. We have to do it for each network interface
         // but we can do it on the same socket. We will use the socket at
@@ -1332,6 +2718,295 @@ namespace ignition
         return true;
       }
 
+      /// \brief Send all the discovery traffic to a discovery server, through
+      /// a socket bound to an ephemeral port, so the server can answer to
+      /// each process even if several of them run on the same host.
+      /// \param[in] _host Host name or IP address of the server. It listens
+      /// on the same port used for multicast discovery.
+      /// \return True when all the traffic goes to the server or false if the
+      /// server can't be resolved or the socket can't be created.
+      /// \sa DiscoveryServer.
+      private: bool UseServer(const std::string &_host)
+      {
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo *res = nullptr;
+        if (getaddrinfo(_host.c_str(), nullptr, &hints, &res) != 0 || !res)
+        {
+          std::cerr << "Unable to resolve the discovery server [" << _host
+                    << "]" << std::endl;
+          return false;
+        }
+        memcpy(&this->serverAddr, res->ai_addr, sizeof(this->serverAddr));
+        freeaddrinfo(res);
+        this->serverAddr.sin_port = htons(static_cast<u_short>(this->port));
+
+        int sock = static_cast<int>(socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP));
+        if (sock < 0)
+        {
+          std::cerr << "Socket creation failed." << std::endl;
+          return false;
+        }
+
+        sockaddr_in localAddr;
+        memset(&localAddr, 0, sizeof(localAddr));
+        localAddr.sin_family = AF_INET;
+        localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+        localAddr.sin_port = 0;
+        if (bind(sock, reinterpret_cast<sockaddr *>(&localAddr),
+              sizeof(sockaddr_in)) < 0)
+        {
+          std::cerr << "Binding to a local port failed." << std::endl;
+#ifdef _WIN32
+          closesocket(sock);
+#else
+          close(sock);
+#endif
+          return false;
+        }
+
+        this->sockets.push_back(sock);
+        this->serverMode = true;
+        return true;
+      }
+
+      /// \brief Create the socket used to wake up the reception thread, bound
+      /// to an ephemeral port of the loopback interface. If it can't be
+      /// created, the reception thread checks for exit regularly instead.
+      private: void CreateWakeupSocket()
+      {
+        int sock = static_cast<int>(socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP));
+        if (sock < 0)
+          return;
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t addrLen = sizeof(addr);
+        if (bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+            getsockname(sock, reinterpret_cast<sockaddr *>(&addr),
+              &addrLen) < 0)
+        {
+#ifdef _WIN32
+          closesocket(sock);
+#else
+          close(sock);
+#endif
+          return;
+        }
+
+        this->wakeupAddr = addr;
+        this->wakeupSocket = sock;
+      }
+
+      /// \brief Queue unadvertisements, sent by the reception thread
+      /// kUnadvertiseDelay after the first one. A burst of them, e.g.: when
+      /// many publishers are destroyed together, is packed in a few
+      /// datagrams.
+      /// \param[in] _msgs The UNADVERTISE messages.
+      private: void QueueUnadvertisements(std::vector<msgs::Discovery> _msgs)
+      {
+        {
+          std::lock_guard<std::mutex> lock(this->unadvertiseMutex);
+          if (!this->pendingUnadvertisements.empty())
+          {
+            std::move(_msgs.begin(), _msgs.end(),
+              std::back_inserter(this->pendingUnadvertisements));
+            return;
+          }
+
+          this->pendingUnadvertisements = std::move(_msgs);
+          this->timeFlushUnadvertisements =
+            std::chrono::steady_clock::now() + kUnadvertiseDelay;
+        }
+
+        // Let the reception thread update its timeout.
+        this->WakeUp();
+      }
+
+      /// \brief Send the queued unadvertisements if it's time to.
+      private: void UpdateUnadvertisements()
+      {
+        {
+          std::lock_guard<std::mutex> lock(this->unadvertiseMutex);
+          if (this->pendingUnadvertisements.empty() ||
+              std::chrono::steady_clock::now() <
+                this->timeFlushUnadvertisements)
+          {
+            return;
+          }
+        }
+        this->FlushUnadvertisements();
+      }
+
+      /// \brief Queue a message of another process, received through the
+      /// multicast group, for the unicast relays. The queue is sent every
+      /// kRelayInterval, packed in as few datagrams as possible, and a
+      /// message replaces the queued one that it supersedes, e.g.: the
+      /// previous heartbeat of the same process. So a process relaying the
+      /// discovery of a whole network to the other networks sends them a
+      /// deduplicated summary, instead of a datagram per message.
+      /// \param[in] _msg The message, with the RELAY flag set.
+      private: void QueueRelay(const msgs::Discovery &_msg)
+      {
+        if (this->relayAddrs.empty())
+          return;
+
+        if (this->relayQueue.empty())
+        {
+          this->timeFlushRelays =
+            std::chrono::steady_clock::now() + kRelayInterval;
+        }
+
+        const std::string key = RelayKey(_msg);
+        if (!key.empty())
+        {
+          auto it = this->relayIndex.find(key);
+          if (it != this->relayIndex.end())
+          {
+            // The superseded message is dropped and the new one is queued
+            // last, so the messages about a publisher stay in order.
+            this->relayQueue[it->second].Clear();
+            it->second = this->relayQueue.size();
+          }
+          else
+            this->relayIndex.emplace(key, this->relayQueue.size());
+        }
+        this->relayQueue.push_back(_msg);
+      }
+
+      /// \brief Get what a relayed message is about. A queued message is
+      /// superseded by a later one about the same thing.
+      /// \param[in] _msg The message.
+      /// \return The key, or an empty string if the message is never
+      /// superseded.
+      private: static std::string RelayKey(const msgs::Discovery &_msg)
+      {
+        std::string key;
+        switch (_msg.type())
+        {
+          case msgs::Discovery::ADVERTISE:
+          case msgs::Discovery::UNADVERTISE:
+            key = "p";
+            break;
+          case msgs::Discovery::NEW_CONNECTION:
+          case msgs::Discovery::END_CONNECTION:
+            key = "c";
+            break;
+          case msgs::Discovery::HEARTBEAT:
+            return "h\n" + _msg.process_uuid();
+          case msgs::Discovery::SUBSCRIBE:
+          {
+            key = "s\n" + _msg.process_uuid() + "\n" + _msg.sub().topic();
+            auto resync = FindHeader(_msg, kResyncKey);
+            if (resync)
+            {
+              for (const auto &value : resync->value())
+                key += "\n" + value;
+            }
+            return key;
+          }
+          default:
+            return key;
+        }
+
+        return key + "\n" + _msg.process_uuid() + "\n" + _msg.pub().topic() +
+          "\n" + _msg.pub().node_uuid() + "\n" + _msg.pub().address();
+      }
+
+      /// \brief Send the queued relayed messages, if it's time to.
+      /// \sa QueueRelay.
+      private: void UpdateRelays()
+      {
+        if (this->relayQueue.empty() ||
+            std::chrono::steady_clock::now() < this->timeFlushRelays)
+        {
+          return;
+        }
+
+        std::vector<msgs::Discovery> msgs;
+        msgs.reserve(this->relayQueue.size());
+        for (auto &msg : this->relayQueue)
+        {
+          // Superseded messages are cleared.
+          if (!msg.process_uuid().empty())
+            msgs.push_back(std::move(msg));
+        }
+        this->relayQueue.clear();
+        this->relayIndex.clear();
+
+        if (!this->AllPeers(&PeerState::batch))
+        {
+          for (const auto &msg : msgs)
+            this->SendUnicast(msg);
+          return;
+        }
+
+        const bool compact =
+          CompactEnabled() && this->AllPeers(&PeerState::compact);
+        for (const auto &datagram : packDiscoveryMsgs(msgs, compact))
+          this->SendUnicast(datagram);
+      }
+
+      /// \brief Send to the multicast group the messages of the last
+      /// datagram received from a unicast relay, packed together.
+      private: void ForwardRelayed()
+      {
+        if (this->forwarded.empty())
+          return;
+
+        if (this->forwarded.size() == 1 || !this->AllPeers(&PeerState::batch))
+        {
+          for (const auto &msg : this->forwarded)
+            this->SendMulticast(msg);
+        }
+        else
+        {
+          const bool compact =
+            CompactEnabled() && this->AllPeers(&PeerState::compact);
+          for (const auto &datagram : packDiscoveryMsgs(this->forwarded,
+                 compact, nullptr, this->PartitionTags()))
+          {
+            this->SendMulticast(datagram);
+          }
+        }
+        this->forwarded.clear();
+      }
+
+      /// \brief Remove the publishers of the unadvertisements received,
+      /// taking the mutex once for all of them.
+      private: void DelUnadvertised()
+      {
+        if (this->unadvertised.empty())
+          return;
+
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          for (const auto &publisher : this->unadvertised)
+          {
+            this->info.DelPublisherByNode(publisher.Topic(),
+              publisher.PUuid(), publisher.NUuid());
+          }
+        }
+        this->unadvertised.clear();
+      }
+
+      /// \brief Wake up the reception thread.
+      private: void WakeUp() const
+      {
+        if (this->wakeupSocket < 0)
+          return;
+
+        const char c = 0;
+        sendto(this->wakeupSocket, reinterpret_cast<const raw_type *>(&c),
+          sizeof(c), 0, reinterpret_cast<const sockaddr *>(&this->wakeupAddr),
+          sizeof(this->wakeupAddr));
+      }
+
       /// \brief Register a new relay address.
       /// \param[in] _ip New IP address.
       private: void AddRelayAddress(const std::string &_ip)
@@ -1370,13 +3045,84 @@ namespace ignition
       /// \brief IP Address used for multicast.
       private: std::string multicastGroup;
 
-      /// \brief Timeout used for receiving messages (ms.).
+      /// \brief Maximum time between two checks for exit, used when the
+      /// wakeup socket isn't available (ms.).
       private: const int kTimeout = 250;
 
+      /// \brief Socket that wakes up the reception thread, or -1.
+      /// \sa WakeUp.
+      private: int wakeupSocket = -1;
+
+      /// \brief Address of the wakeup socket.
+      private: sockaddr_in wakeupAddr;
+
       /// \brief Longest string to receive.
       private: static const uint16_t kMaxRcvStr =
                std::numeric_limits<uint16_t>::max();
 
+      /// \brief Key of the heartbeat header entry announcing that a
+      /// process accepts batched datagrams.
+      private: static constexpr const char *kBatchKey = "batch";
+
+      /// \brief Key of the heartbeat header entry announcing that a
+      /// process accepts the compact encoding.
+      private: static constexpr const char *kCompactKey = "compact";
+
+      /// \brief Key of the header entry with the number of publishers of
+      /// each partition in the state of a process. It also announces that
+      /// the process accepts the partition tags.
+      private: static constexpr const char *kPartitionsKey = "partitions";
+
+      /// \brief Key of the header entry with the epoch of the state of a
+      /// process and its number of publishers.
+      private: static constexpr const char *kEpochKey = "epoch";
+
+      /// \brief Key of the header entry of a SUBSCRIBE message asking for
+      /// the full state of some processes.
+      private: static constexpr const char *kResyncKey = "resync";
+
+      /// \brief Value of a resync header entry that targets all the peers,
+      /// sent when a discovery instance starts.
+      private: static constexpr const char *kAnyPeer = "*";
+
+      /// \brief Key of the header entry of a SUBSCRIBE message asking a
+      /// discovery server for all the publishers it knows.
+      private: static constexpr const char *kAllKey = "all";
+
+      /// \brief Key of the header entry with the sequence number of a
+      /// message, added by the processes sending through several interfaces.
+      private: static constexpr const char *kSeqKey = "seq";
+
+      /// \brief Key of the header entry of a NEW_CONNECTION message telling
+      /// the publisher that the subscriber collects topic statistics.
+      private: static constexpr const char *kStatsKey = "stats";
+
+      /// \brief Number of sequence numbers remembered for each peer.
+      private: static const size_t kMaxSeqs = 64;
+
+      /// \brief Minimum time between two transmissions of our full state
+      /// requested by peers.
+      private: static constexpr std::chrono::milliseconds kMinResyncInterval{
+        100};
+
+      /// \brief Time without advertisements after which the answers to our
+      /// request for the state of the peers are considered complete.
+      /// \sa WaitForSnapshot
+      private: static constexpr std::chrono::milliseconds kSnapshotQuiet{50};
+
+      /// \brief First interval between a state change and the heartbeat that
+      /// repeats its epoch. It doubles for each beacon. \sa BumpEpoch
+      private: static constexpr std::chrono::milliseconds kBeaconDelay{20};
+
+      /// \brief Time that the messages of other processes wait for the rest
+      /// of the ones sent together to the unicast relays. \sa QueueRelay.
+      private: static constexpr std::chrono::milliseconds kRelayInterval{50};
+
+      /// \brief Time that the unadvertisements wait for the rest of their
+      /// burst. \sa QueueUnadvertisements
+      private: static constexpr std::chrono::milliseconds kUnadvertiseDelay{
+        5};
+
       /// \brief Wire protocol version. Bump up the version number if you modify
       /// the wire protocol (for discovery or message/service exchange).
       private: static const uint8_t kWireVersion = 10;
@@ -1390,6 +3136,24 @@ namespace ignition
       /// \brief List of host network interfaces.
       private: std::vector<std::string> hostInterfaces;
 
+      /// \brief IP address of the interface of each socket in "sockets".
+      private: std::vector<std::string> socketIfaces;
+
+      /// \brief Last sequence number used. See TagSequence().
+      private: mutable std::atomic<uint64_t> seq{0};
+
+      /// \brief Number of datagrams sent. See Traffic().
+      private: mutable std::atomic<uint64_t> sentDatagrams{0};
+
+      /// \brief Number of bytes sent.
+      private: mutable std::atomic<uint64_t> sentBytes{0};
+
+      /// \brief Number of datagrams received.
+      private: std::atomic<uint64_t> recvDatagrams{0};
+
+      /// \brief Number of bytes received.
+      private: std::atomic<uint64_t> recvBytes{0};
+
       /// \brief Process UUID.
       private: std::string pUuid;
 
@@ -1422,15 +3186,154 @@ namespace ignition
       /// ToDo: Remove static when possible.
       private: inline static DiscoveryCallback<Pub> unregistrationCb;
 
+      /// \brief Callback executed with the statistics preference of each
+      /// registered remote subscriber.
+      private: std::function<void(const Pub &_pub, const bool _stats)>
+                 statsRegistrationCb;
+
       /// \brief Addressing information.
       private: TopicStorage<Pub> info;
 
+      /// \brief When true, only the publishers of the topics of interest are
+      /// stored. \sa SetInterestOnly.
+      private: bool interestOnly = false;
+
+      /// \brief Topics passed to Discover().
+      private: mutable std::set<std::string> interests;
+
+      /// \brief Prefixes passed to DiscoverPrefix().
+      private: mutable std::set<std::string> interestPrefixes;
+
+      /// \brief Hashes of the partitions passed to AddPartition().
+      private: std::set<uint32_t> partitions;
+
+      /// \brief Messages of the last datagram received, kept to reuse their
+      /// memory. Only used by the reception thread.
+      private: std::vector<msgs::Discovery> rcvMsgs;
+
+      /// \brief Publisher of the last discovery message received, kept to
+      /// reuse its memory. Only used by the reception thread.
+      private: Pub rcvPub;
+
+      /// \brief Messages of other processes queued for the unicast relays.
+      /// The superseded ones are cleared. Only used by the reception thread.
+      /// \sa QueueRelay.
+      private: std::vector<msgs::Discovery> relayQueue;
+
+      /// \brief Position in relayQueue of the last message about each key.
+      /// \sa RelayKey.
+      private: std::map<std::string, size_t> relayIndex;
+
+      /// \brief Time at which relayQueue is sent.
+      private: Timestamp timeFlushRelays;
+
+      /// \brief Messages received from a unicast relay, to forward to the
+      /// multicast group. Only used by the reception thread.
+      private: std::vector<msgs::Discovery> forwarded;
+
       /// \brief Activity information. Every time there is a message from a
       /// remote node, its activity information is updated. If we do not hear
       /// from a node in a while, its entries in 'info' will be invalided. The
       /// key is the process uuid.
       protected: std::map<std::string, Timestamp> activity;
 
+      /// \brief Processes in 'activity' ordered by the time of their activity
+      /// when they were last checked, oldest first. The activity of a process
+      /// is only checked again once that time is older than the silence
+      /// interval, so the expiration work doesn't grow with the number of
+      /// processes that are alive.
+      private: std::priority_queue<std::pair<Timestamp, std::string>,
+        std::vector<std::pair<Timestamp, std::string>>,
+        std::greater<std::pair<Timestamp, std::string>>> expirations;
+
+      /// \brief Processes with an entry in 'expirations'.
+      private: std::set<std::string> scheduled;
+
+      /// \brief What we know about the discovery state of a remote process.
+      private: struct PeerState
+      {
+        /// \brief The process accepts batched datagrams.
+        public: bool batch = false;
+
+        /// \brief The process accepts the compact encoding.
+        public: bool compact = false;
+
+        /// \brief The process accepts the partition tags.
+        public: bool partitions = false;
+
+        /// \brief The process announces the epoch of its state.
+        public: bool epochs = false;
+
+        /// \brief True when our copy of the state is complete.
+        public: bool synced = false;
+
+        /// \brief Epoch of our copy of the state.
+        public: uint64_t epoch = 0;
+
+        /// \brief Topic and node UUID of the publishers received for the
+        /// epoch, while syncing.
+        public: std::set<std::pair<std::string, std::string>> received;
+
+        /// \brief Index of the socket whose interface is the closest to the
+        /// process, or -1 if unknown.
+        public: int iface = -1;
+
+        /// \brief Last sequence numbers received from the process.
+        public: std::deque<uint64_t> seqs;
+      };
+
+      /// \brief Discovery state of the remote processes. The key is the
+      /// process UUID.
+      private: std::map<std::string, PeerState> peers;
+
+      /// \brief Epoch of the local state. Increased each time a local
+      /// publisher is added or removed. \sa BumpEpoch.
+      private: uint64_t epoch = 0;
+
+      /// \brief Interval until the next beacon, the heartbeat that repeats
+      /// the epoch of a recent state change. Zero if there is none to send.
+      private: std::chrono::milliseconds beaconBackoff{0};
+
+      /// \brief Time at which the next beacon is sent.
+      private: Timestamp timeNextBeacon;
+
+      /// \brief Random generator of the jitter of the beacons.
+      private: std::minstd_rand jitterRng{std::random_device{}()};
+
+      /// \brief True when a peer asked for our full state.
+      private: bool resyncRequested = false;
+
+      /// \brief Last time our full state was sent.
+      private: Timestamp timeLastFullState;
+
+      /// \brief True if Start() asked the peers for their state.
+      private: bool snapshotRequested = false;
+
+      /// \brief Time when Start() asked the peers for their state.
+      private: Timestamp timeSnapshotRequested;
+
+      /// \brief Last time a publisher was advertised by a peer.
+      private: Timestamp timeLastAdvertisement;
+
+      /// \brief True when using a discovery server instead of multicast.
+      /// \sa UseServer.
+      private: bool serverMode = false;
+
+      /// \brief Address of the discovery server.
+      private: sockaddr_in serverAddr;
+
+      /// \brief Process UUID of the discovery server.
+      private: std::string serverUuid;
+
+      /// \brief Last time we received anything from the discovery server.
+      private: Timestamp lastServerContact;
+
+      /// \brief Last time we received a heartbeat from the discovery server.
+      private: Timestamp lastServerHeartbeat;
+
+      /// \brief Notified when a heartbeat from the discovery server arrives.
+      private: mutable std::condition_variable serverCv;
+
       /// \brief Print discovery information to stdout.
       private: bool verbose;
 
@@ -1446,6 +3349,22 @@ namespace ignition
       /// \brief Mutex to guarantee exclusive access between the threads.
       private: mutable std::mutex mutex;
 
+      /// \brief Unadvertisements waiting to be sent. Protected by
+      /// unadvertiseMutex. \sa QueueUnadvertisements().
+      private: mutable std::vector<msgs::Discovery> pendingUnadvertisements;
+
+      /// \brief Time at which the pendingUnadvertisements are sent.
+      /// Protected by unadvertiseMutex.
+      private: Timestamp timeFlushUnadvertisements;
+
+      /// \brief Mutex protecting pendingUnadvertisements. It's never held
+      /// while sending, so it can be taken with the mutex locked.
+      private: mutable std::mutex unadvertiseMutex;
+
+      /// \brief Publishers of the unadvertisements received in the current
+      /// datagram. Only used by the reception thread.
+      private: std::vector<Pub> unadvertised;
+
       /// \brief Thread in charge of receiving and handling incoming messages.
       private: std::thread threadReception;
 
@@ -1461,8 +3380,9 @@ namespace ignition
       /// \brief Once the discovery starts, it can take up to
       /// HeartbeatInterval milliseconds to discover the existing nodes on the
       /// network. This variable is 'false' during the first HeartbeatInterval
-      /// period and is set to 'true' after that.
-      private: bool initialized;
+      /// period and is set to 'true' after that, or once WaitForSnapshot()
+      /// returns.
+      private: mutable bool initialized;
 
       /// \brief Number of heartbeats sent while discovery is uninitialized.
       private: unsigned int numHeartbeatsUninitialized;
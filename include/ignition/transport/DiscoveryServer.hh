@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_DISCOVERYSERVER_HH_
+#define IGN_TRANSPORT_DISCOVERYSERVER_HH_
+
+#include <cstddef>
+#include <memory>
+
+#include <ignition/utilities/SuppressWarning.hh>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class DiscoveryServer DiscoveryServer.hh
+    /// ignition/transport/DiscoveryServer.hh
+    /// \brief A discovery server, for networks where multicast isn't
+    /// available or doesn't scale. The processes that set the
+    /// IGN_DISCOVERY_SERVER environment variable send all their discovery
+    /// messages to the server, via unicast. The server keeps the publishers
+    /// of every process and only forwards each advertisement to the processes
+    /// that subscribed to its topic, so the discovery traffic doesn't grow
+    /// with the square of the number of processes.
+    ///
+    /// The server listens on the discovery ports used by its clients, read
+    /// from IGN_DISCOVERY_MSG_PORT and IGN_DISCOVERY_SRV_PORT like in any
+    /// other process. It has to own those ports on its host: processes on
+    /// that host using multicast discovery with the same ports can't run next
+    /// to it.
+    class IGNITION_TRANSPORT_VISIBLE DiscoveryServer
+    {
+      /// \brief Constructor.
+      /// \param[in] _verbose True for enabling verbose mode.
+      public: explicit DiscoveryServer(const bool _verbose = false);
+
+      /// \brief Destructor. Stops the server.
+      public: ~DiscoveryServer();
+
+      /// \brief Bind the discovery ports and start serving.
+      /// \return True on success or false if the server was already running
+      /// or a port couldn't be bound.
+      public: bool Start();
+
+      /// \brief Also take part in the multicast discovery on behalf of the
+      /// clients, so the server can run as a discovery daemon shared by all
+      /// the processes of its host. The processes reach it through the
+      /// loopback interface (IGN_DISCOVERY_SERVER=127.0.0.1), and the
+      /// multicast traffic and the state of the network are handled once for
+      /// the whole host. Anything not coming from the loopback interface is
+      /// considered multicast traffic from other hosts. The multicast group
+      /// is read from IGN_DISCOVERY_MULTICAST_IP. It must be called before
+      /// Start(). It's disabled by default.
+      /// \param[in] _enabled True for bridging with the multicast discovery.
+      public: void SetMulticastBridge(const bool _enabled);
+
+      /// \brief Check if the server bridges its clients with the multicast
+      /// discovery.
+      /// \return True if enabled.
+      /// \sa SetMulticastBridge.
+      public: bool MulticastBridge() const;
+
+      /// \brief Stop serving and release the ports.
+      public: void Stop();
+
+      /// \brief Get the number of processes using the server.
+      /// \return The number of clients.
+      public: std::size_t ClientCount() const;
+
+      /// \internal Implementation of this class.
+      private: class Implementation;
+
+      /// \internal Pointer to the implementation of this class.
+      IGN_UTILS_WARN_IGNORE__DLL_INTERFACE_MISSING
+      private: std::unique_ptr<Implementation> dataPtr;
+      IGN_UTILS_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+#endif
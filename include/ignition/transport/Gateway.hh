@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#ifndef IGN_TRANSPORT_GATEWAY_HH_
+#define IGN_TRANSPORT_GATEWAY_HH_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ignition/transport/NodeOptions.hh"
+#include "ignition/transport/SubscribeOptions.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    // Forward declarations.
+    class GatewayPrivate;
+
+    /// \class Gateway Gateway.hh ignition/transport/Gateway.hh
+    /// \brief Forward topics from one partition (or namespace) to another.
+    /// The gateway subscribes once to each topic on the upstream side and
+    /// republishes the serialized messages, without parsing them, on the
+    /// downstream side. However many subscribers the downstream side has,
+    /// they only cost a single subscription upstream, e.g.: the fleet
+    /// servers subscribe to the gateway instead of to each robot's uplink.
+    ///
+    /// The messages can be downsampled with the subscribe options of a topic
+    /// and compressed with its advertise options. The type of a topic is
+    /// advertised downstream when its first message arrives.
+    ///
+    /// The network interface and the discovery settings are shared by all
+    /// the nodes of a process, see IGN_IP, so the gateway connects
+    /// partitions, or namespaces, reachable from the same interface.
+    class IGNITION_TRANSPORT_VISIBLE Gateway
+    {
+      /// \brief Constructor.
+      /// \param[in] _upstream Options of the node subscribing to the topics,
+      /// e.g.: the partition of the robot.
+      /// \param[in] _downstream Options of the node republishing them.
+      public: Gateway(const NodeOptions &_upstream,
+                      const NodeOptions &_downstream);
+
+      /// \brief Destructor. Stops forwarding all the topics.
+      public: ~Gateway();
+
+      /// \brief Start forwarding a topic.
+      /// \param[in] _topic Name of the topic upstream.
+      /// \param[in] _downstreamTopic Name of the topic downstream, or empty
+      /// to use the same name.
+      /// \param[in] _subOpts Options of the subscription upstream, e.g.: the
+      /// rate of the messages forwarded, see SubscribeOptions::SetMsgsPerSec.
+      /// \param[in] _advOpts Options of the publisher downstream, e.g.: the
+      /// compression of the messages, see
+      /// AdvertiseMessageOptions::SetCompression.
+      /// \return True if the topic is being forwarded. False if a name is
+      /// invalid, if the topic is already forwarded, or if both names refer
+      /// to the same topic, which would forward its messages in a loop.
+      public: bool Forward(const std::string &_topic,
+                  const std::string &_downstreamTopic = "",
+                  const SubscribeOptions &_subOpts = SubscribeOptions(),
+                  const AdvertiseMessageOptions &_advOpts =
+                    AdvertiseMessageOptions());
+
+      /// \brief Stop forwarding a topic.
+      /// \param[in] _topic Name of the topic upstream.
+      /// \return True if the topic was forwarded.
+      public: bool Stop(const std::string &_topic);
+
+      /// \brief Get the topics forwarded.
+      /// \return The names of the topics upstream.
+      public: std::vector<std::string> Topics() const;
+
+      /// \brief Get the number of messages of a topic forwarded so far.
+      /// \param[in] _topic Name of the topic upstream.
+      /// \return The number of messages, 0 if the topic isn't forwarded.
+      public: uint64_t Forwarded(const std::string &_topic) const;
+
+      /// \brief Get the number of messages of a topic that couldn't be
+      /// forwarded, e.g.: because their type isn't the advertised one.
+      /// \param[in] _topic Name of the topic upstream.
+      /// \return The number of messages, 0 if the topic isn't forwarded.
+      public: uint64_t Failed(const std::string &_topic) const;
+
+      /// \brief No copy constructor.
+      public: Gateway(const Gateway &) = delete;
+
+      /// \brief No assignment operator.
+      public: Gateway &operator=(const Gateway &) = delete;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::unique_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \internal
+      /// \brief Smart pointer to private data.
+      private: std::unique_ptr<GatewayPrivate> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
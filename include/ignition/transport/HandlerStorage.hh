@@ -21,7 +21,10 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/TransportTypes.hh"
@@ -52,6 +55,27 @@ namespace ignition
       /// \brief Constructor.
       public: HandlerStorage() = default;
 
+      /// \brief Copy constructor.
+      /// \param[in] _other Storage to copy.
+      public: HandlerStorage(const HandlerStorage &_other)
+        : data(_other.data)
+      {
+        this->Reindex();
+      }
+
+      /// \brief Assignment operator.
+      /// \param[in] _other Storage to copy.
+      /// \return Reference to this storage.
+      public: HandlerStorage &operator=(const HandlerStorage &_other)
+      {
+        if (this != &_other)
+        {
+          this->data = _other.data;
+          this->Reindex();
+        }
+        return *this;
+      }
+
       /// \brief Destructor.
       public: virtual ~HandlerStorage() = default;
 
@@ -67,10 +91,11 @@ namespace ignition
         std::map<std::string,
           std::map<std::string, std::shared_ptr<T> >> &_handlers) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        _handlers = this->data.at(_topic);
+        _handlers = topicIt->second;
         return true;
       }
 
@@ -86,10 +111,11 @@ namespace ignition
                                 const std::string &_repTypeName,
                                 std::shared_ptr<T> &_handler) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        const auto &m = this->data.at(_topic);
+        const auto &m = topicIt->second;
         for (const auto &node : m)
         {
           for (const auto &handler : node.second)
@@ -115,10 +141,11 @@ namespace ignition
                                 const std::string &_msgTypeName,
                                 std::shared_ptr<T> &_handler) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        const auto &m = this->data.at(_topic);
+        const auto &m = topicIt->second;
         for (const auto &node : m)
         {
           for (const auto &handler : node.second)
@@ -145,17 +172,20 @@ namespace ignition
                            const std::string &_hUuid,
                            std::shared_ptr<T> &_handler) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        auto const &m = this->data.at(_topic);
-        if (m.find(_nUuid) == m.end())
+        auto const &m = topicIt->second;
+        auto nodeIt = m.find(_nUuid);
+        if (nodeIt == m.end())
           return false;
 
-        if (m.at(_nUuid).find(_hUuid) == m.at(_nUuid).end())
+        auto handlerIt = nodeIt->second.find(_hUuid);
+        if (handlerIt == nodeIt->second.end())
           return false;
 
-        _handler = m.at(_nUuid).at(_hUuid);
+        _handler = handlerIt->second;
         return true;
       }
 
@@ -168,16 +198,9 @@ namespace ignition
                               const std::string &_nUuid,
                               const std::shared_ptr<T> &_handler)
       {
-        // Create the topic entry.
-        if (this->data.find(_topic) == this->data.end())
-          this->data[_topic] = UUIDHandler_Collection_M();
-
-        // Create the Node UUID entry.
-        if (this->data[_topic].find(_nUuid) == this->data[_topic].end())
-          this->data[_topic][_nUuid] = UUIDHandler_M();
-
-        // Add/Replace the Req handler.
-        this->data[_topic][_nUuid].insert(
+        // Create the topic and Node UUID entries if needed, and add the Req
+        // handler.
+        this->Insert(_topic)[_nUuid].insert(
           std::make_pair(_handler->HandlerUuid(), _handler));
       }
 
@@ -187,10 +210,11 @@ namespace ignition
       /// \return true if we have stored at least one request for the topic.
       public: bool HasHandlersForTopic(const std::string &_topic) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        return !this->data.at(_topic).empty();
+        return !topicIt->second.empty();
       }
 
       /// \brief Check if a node has at least one handler.
@@ -200,11 +224,11 @@ namespace ignition
       public: bool HasHandlersForNode(const std::string &_topic,
                                       const std::string &_nUuid) const
       {
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        return this->data.at(_topic).find(_nUuid) !=
-               this->data.at(_topic).end();
+        return topicIt->second.find(_nUuid) != topicIt->second.end();
       }
 
       /// \brief Remove a request handler. The node's uuid is used as a key to
@@ -218,15 +242,17 @@ namespace ignition
                                  const std::string &_reqUuid)
       {
         size_t counter = 0;
-        if (this->data.find(_topic) != this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt != this->data.end())
         {
-          if (this->data[_topic].find(_nUuid) != this->data[_topic].end())
+          auto nodeIt = topicIt->second.find(_nUuid);
+          if (nodeIt != topicIt->second.end())
           {
-            counter = this->data[_topic][_nUuid].erase(_reqUuid);
-            if (this->data[_topic][_nUuid].empty())
-              this->data[_topic].erase(_nUuid);
-            if (this->data[_topic].empty())
-              this->data.erase(_topic);
+            counter = nodeIt->second.erase(_reqUuid);
+            if (nodeIt->second.empty())
+              topicIt->second.erase(nodeIt);
+            if (topicIt->second.empty())
+              this->Erase(topicIt);
           }
         }
 
@@ -241,20 +267,89 @@ namespace ignition
                                          const std::string &_nUuid)
       {
         size_t counter = 0;
-        if (this->data.find(_topic) != this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt != this->data.end())
         {
-          counter = this->data[_topic].erase(_nUuid);
-          if (this->data[_topic].empty())
-            this->data.erase(_topic);
+          counter = topicIt->second.erase(_nUuid);
+          if (topicIt->second.empty())
+            this->Erase(topicIt);
         }
 
         return counter > 0;
       }
 
+      /// \brief Get the list of topics with handlers.
+      /// \param[out] _topics List of topics, sorted alphabetically.
+      public: void TopicList(std::vector<std::string> &_topics) const
+      {
+        for (auto const &topic : this->data)
+          _topics.push_back(topic.first);
+      }
+
+      /// \brief Find the entry of a topic through the hashed index.
+      /// \param[in] _topic Topic name.
+      /// \return The entry, or data.end() if the topic isn't stored.
+      private: typename TopicServiceCalls_M::const_iterator Find(
+                   const std::string &_topic) const
+      {
+        auto it = this->topicIndex.find(_topic);
+        if (it == this->topicIndex.end())
+          return this->data.end();
+        return it->second;
+      }
+
+      /// \brief Find the entry of a topic through the hashed index.
+      /// \param[in] _topic Topic name.
+      /// \return The entry, or data.end() if the topic isn't stored.
+      private: typename TopicServiceCalls_M::iterator Find(
+                   const std::string &_topic)
+      {
+        auto it = this->topicIndex.find(_topic);
+        if (it == this->topicIndex.end())
+          return this->data.end();
+        return it->second;
+      }
+
+      /// \brief Get the entry of a topic, creating it if needed.
+      /// \param[in] _topic Topic name.
+      /// \return The handlers of the topic.
+      private: UUIDHandler_Collection_M &Insert(const std::string &_topic)
+      {
+        auto it = this->Find(_topic);
+        if (it != this->data.end())
+          return it->second;
+
+        it = this->data.emplace(_topic, UUIDHandler_Collection_M()).first;
+        this->topicIndex.emplace(it->first, it);
+        return it->second;
+      }
+
+      /// \brief Remove the entry of a topic.
+      /// \param[in] _it The entry.
+      private: void Erase(typename TopicServiceCalls_M::iterator _it)
+      {
+        this->topicIndex.erase(_it->first);
+        this->data.erase(_it);
+      }
+
+      /// \brief Rebuild the index of the topics.
+      private: void Reindex()
+      {
+        this->topicIndex.clear();
+        for (auto it = this->data.begin(); it != this->data.end(); ++it)
+          this->topicIndex.emplace(it->first, it);
+      }
+
       /// \brief Stores all the service call data for each topic. The key of
       /// _data is the topic name. The value is another map, where the key is
       /// the node UUID and the value is a smart pointer to the handler.
       private: TopicServiceCalls_M data;
+
+      /// \brief Entries of data by topic name. The topics are hashed since
+      /// every message lookup is keyed by the fully qualified topic name,
+      /// while data keeps them sorted. The keys refer to the ones of data.
+      private: std::unordered_map<std::string_view,
+                 typename TopicServiceCalls_M::iterator> topicIndex;
     };
     }
   }
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_LAZYMESSAGE_HH_
+#define IGN_TRANSPORT_LAZYMESSAGE_HH_
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class LazyMessage LazyMessage.hh ignition/transport/LazyMessage.hh
+    /// \brief A handle to a serialized message that is only deserialized
+    /// when accessed. Copies of the handle share the serialized data and the
+    /// deserialized message, so handles are cheap to copy and can be handed
+    /// over to other threads. A subscriber can inspect the size or forward
+    /// the serialized data of the messages and only pay the deserialization
+    /// cost for the ones that it actually uses. This class is thread safe.
+    /// \tparam T Protobuf message type.
+    template <typename T>
+    class LazyMessage
+    {
+      /// \brief Default constructor. Creates an empty handle.
+      public: LazyMessage() = default;
+
+      /// \brief Constructor. Copies the serialized data.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message in bytes.
+      /// \param[in] _type Message type name.
+      public: LazyMessage(const char *_data, const std::size_t _size,
+                          const std::string &_type)
+        : state(std::make_shared<State>())
+      {
+        this->state->data.assign(_data, _size);
+        this->state->owned = true;
+        this->state->type = _type;
+      }
+
+      /// \brief Create a handle that refers to the serialized data without
+      /// copying it, e.g. the buffer of a raw callback. The data must stay
+      /// valid until Detach() is called. Used by Node::SubscribeLazy().
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message in bytes.
+      /// \param[in] _type Message type name.
+      /// \return The handle.
+      public: static LazyMessage Borrow(const char *_data,
+                                        const std::size_t _size,
+                                        const std::string &_type)
+      {
+        LazyMessage lazy;
+        lazy.state = std::make_shared<State>();
+        lazy.state->borrowed = _data;
+        lazy.state->borrowedSize = _size;
+        lazy.state->type = _type;
+        return lazy;
+      }
+
+      /// \brief Stop referring to the data of a handle created with
+      /// Borrow(), before the data goes away. The data is only copied if
+      /// other copies of the handle are still alive.
+      public: void Detach()
+      {
+        if (!this->state)
+          return;
+
+        State &s = *this->state;
+        std::lock_guard<std::mutex> lk(s.mutex);
+        if (!s.owned && this->state.use_count() > 1)
+          s.Own();
+        s.borrowed = nullptr;
+        s.borrowedSize = 0;
+      }
+
+      /// \brief Check if the handle refers to a message.
+      /// \return True if not empty.
+      public: bool Valid() const
+      {
+        return this->state != nullptr;
+      }
+
+      /// \brief Get the serialized message. A handle created with Borrow()
+      /// copies the data the first time.
+      /// \return The serialized message or an empty string if the handle is
+      /// empty.
+      public: const std::string &Data() const
+      {
+        static const std::string kEmpty;
+        if (!this->state)
+          return kEmpty;
+
+        State &s = *this->state;
+        std::lock_guard<std::mutex> lk(s.mutex);
+        if (!s.owned)
+          s.Own();
+        return s.data;
+      }
+
+      /// \brief Get the message type name.
+      /// \return The type name or an empty string if the handle is empty.
+      public: const std::string &Type() const
+      {
+        static const std::string kEmpty;
+        return this->state ? this->state->type : kEmpty;
+      }
+
+      /// \brief Get the deserialized message. The message is deserialized by
+      /// the first call, and shared by all the copies of this handle.
+      /// \return The message, or nullptr if the handle is empty or the data
+      /// can't be parsed.
+      public: std::shared_ptr<const T> Get() const
+      {
+        if (!this->state)
+          return nullptr;
+
+        State &s = *this->state;
+        std::call_once(s.parsed, [&s]()
+        {
+          std::lock_guard<std::mutex> lk(s.mutex);
+          const char *data = s.owned ? s.data.data() : s.borrowed;
+          const std::size_t size = s.owned ? s.data.size() : s.borrowedSize;
+          auto msg = std::make_shared<T>();
+          if (data &&
+              size <= static_cast<std::size_t>(std::numeric_limits<int>::max())
+              && msg->ParseFromArray(data, static_cast<int>(size)))
+          {
+            s.msg = std::move(msg);
+          }
+        });
+        return s.msg;
+      }
+
+      /// \brief Shared state of the copies of a handle.
+      private: struct State
+      {
+        /// \brief Copy the borrowed data. Must be called with the mutex
+        /// locked.
+        public: void Own()
+        {
+          if (this->borrowed)
+            this->data.assign(this->borrowed, this->borrowedSize);
+          this->owned = true;
+        }
+
+        /// \brief The serialized message, once owned.
+        public: std::string data;
+
+        /// \brief True once data holds the serialized message.
+        public: bool owned = false;
+
+        /// \brief The serialized message referred to until it's owned, see
+        /// Borrow().
+        public: const char *borrowed = nullptr;
+
+        /// \brief Size of the borrowed message.
+        public: std::size_t borrowedSize = 0;
+
+        /// \brief Protects the data while it's borrowed.
+        public: std::mutex mutex;
+
+        /// \brief Message type name.
+        public: std::string type;
+
+        /// \brief Used to deserialize the message only once.
+        public: std::once_flag parsed;
+
+        /// \brief The deserialized message, once parsed.
+        public: std::shared_ptr<const T> msg;
+      };
+
+      /// \brief Shared state, or nullptr if the handle is empty.
+      private: std::shared_ptr<State> state;
+    };
+    }
+  }
+}
+#endif
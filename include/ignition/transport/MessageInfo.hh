@@ -18,6 +18,7 @@
 #ifndef IGN_TRANSPORT_MESSAGEINFO_HH_
 #define IGN_TRANSPORT_MESSAGEINFO_HH_
 
+#include <chrono>
 #include <memory>
 #include <string>
 
@@ -89,6 +90,67 @@ namespace ignition
       /// \param[in] _value The intra-process value.
       public: void SetIntraProcess(bool _value);
 
+      /// \brief Get the address of the process that published the message.
+      /// \return The address, or an empty string for the intra-process
+      /// messages.
+      public: const std::string &PublisherAddress() const;
+
+      /// \brief Set the address of the process that published the message.
+      /// \param[in] _address The address.
+      public: void SetPublisherAddress(const std::string &_address);
+
+      /// \brief Get the time when the message was received, or published
+      /// for the intra-process messages.
+      /// \return The time, or the epoch of the steady clock if unknown.
+      public: std::chrono::steady_clock::time_point ReceptionTime() const;
+
+      /// \brief Set the time when the message was received.
+      /// \param[in] _time The time.
+      public: void SetReceptionTime(
+                  const std::chrono::steady_clock::time_point &_time);
+
+      /// \brief Get the time when the message was received, on the system
+      /// clock. The best effort datagrams take it from the kernel where
+      /// available (SO_TIMESTAMPNS).
+      /// \return The time, or the epoch of the system clock if unknown.
+      public: std::chrono::system_clock::time_point ReceptionSystemTime()
+                  const;
+
+      /// \brief Set the time when the message was received, on the system
+      /// clock.
+      /// \param[in] _time The time.
+      public: void SetReceptionSystemTime(
+                  const std::chrono::system_clock::time_point &_time);
+
+      /// \brief Get the time when the message was published, on the steady
+      /// clock of the host of the publisher. It can only be compared with
+      /// the times of the same host. It's known when the publisher attaches
+      /// the publication metadata to the message, which is always the case
+      /// with the compact header (IGN_TRANSPORT_COMPACT_HEADER) and for the
+      /// intra-process messages.
+      /// \return The time, or the epoch of the steady clock if unknown.
+      public: std::chrono::steady_clock::time_point SendTime() const;
+
+      /// \brief Set the time when the message was published, on the steady
+      /// clock.
+      /// \param[in] _time The time.
+      public: void SetSendTime(
+                  const std::chrono::steady_clock::time_point &_time);
+
+      /// \brief Get the time when the message was published, on the system
+      /// clock of the publisher, which can be compared with
+      /// ReceptionSystemTime() if the clocks of both hosts are synchronized
+      /// (e.g.: with PTP). Older publishers and the best effort datagrams
+      /// don't send it.
+      /// \return The time, or the epoch of the system clock if unknown.
+      public: std::chrono::system_clock::time_point SendSystemTime() const;
+
+      /// \brief Set the time when the message was published, on the system
+      /// clock.
+      /// \param[in] _time The time.
+      public: void SetSendSystemTime(
+                  const std::chrono::system_clock::time_point &_time);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_MESSAGELOAN_HH_
+#define IGN_TRANSPORT_MESSAGELOAN_HH_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ignition/transport/TransportTypes.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    class MessageLoanPrivate;
+
+    /// \brief A buffer lent by the transport to build a serialized message
+    /// in place, e.g. the bytes of an image, which is then published
+    /// without any copy. The buffer comes from the pool of the transport,
+    /// so a steady stream of similarly sized messages doesn't allocate
+    /// memory, and it is returned to the pool once every subscriber is
+    /// done with the message. A loan can only be published once, and it
+    /// can't be copied.
+    ///
+    /// \code
+    ///   auto loan = pub.Loan(frameSize);
+    ///   camera.Capture(loan.Data(), loan.Capacity());
+    ///   pub.Publish(std::move(loan));
+    /// \endcode
+    /// \sa Node::Publisher::Loan
+    class IGNITION_TRANSPORT_VISIBLE MessageLoan
+    {
+      /// \brief Default constructor, an invalid loan.
+      public: MessageLoan();
+
+      /// \brief Take over a buffer, e.g. one that isn't provided by the
+      /// transport.
+      /// \param[in] _buffer The buffer.
+      /// \param[in] _capacity Size of the buffer (bytes). It is also the
+      /// initial size of the message.
+      public: MessageLoan(std::shared_ptr<char[]> _buffer,
+                          const std::size_t _capacity);
+
+      /// \brief Move constructor.
+      /// \param[in] _other The loan to move, left invalid.
+      public: MessageLoan(MessageLoan &&_other);
+
+      /// \brief Move assignment operator.
+      /// \param[in] _other The loan to move, left invalid.
+      /// \return Reference to this loan.
+      public: MessageLoan &operator=(MessageLoan &&_other);
+
+      /// \brief No copies, a loan is published once.
+      public: MessageLoan(const MessageLoan &) = delete;
+
+      /// \brief No copies, a loan is published once.
+      public: MessageLoan &operator=(const MessageLoan &) = delete;
+
+      /// \brief Destructor. A loan that wasn't published is returned.
+      public: ~MessageLoan();
+
+      /// \brief Check if the loan holds a buffer.
+      /// \return True if the loan can be written and published.
+      public: bool Valid() const;
+
+      /// \brief Get the buffer.
+      /// \return The buffer, or nullptr if the loan isn't valid.
+      public: char *Data();
+
+      /// \brief Get the buffer.
+      /// \return The buffer, or nullptr if the loan isn't valid.
+      public: const char *Data() const;
+
+      /// \brief Get the size of the buffer.
+      /// \return The number of bytes that can be written.
+      public: std::size_t Capacity() const;
+
+      /// \brief Get the size of the message.
+      /// \return The number of bytes published, the capacity unless
+      /// changed with Resize() or Serialize().
+      public: std::size_t Size() const;
+
+      /// \brief Set the size of the message.
+      /// \param[in] _size The number of bytes to publish.
+      /// \return False if _size exceeds the capacity.
+      public: bool Resize(const std::size_t _size);
+
+      /// \brief Get the type of the message.
+      /// \return The type set by SetType() or Serialize(), or an empty
+      /// string for the type advertised by the publisher.
+      public: const std::string &Type() const;
+
+      /// \brief Set the type of the message, only needed by the publishers
+      /// of generic messages.
+      /// \param[in] _type The protobuf type name of the message.
+      public: void SetType(const std::string &_type);
+
+      /// \brief Serialize a message into the buffer, setting the size and
+      /// the type of the loan.
+      /// \param[in] _msg The message.
+      /// \return False if the loan isn't valid, if the message doesn't fit
+      /// or if it couldn't be serialized.
+      public: bool Serialize(const ProtoMsg &_msg);
+
+      /// \brief Give up the buffer, leaving the loan invalid.
+      /// \return The buffer, e.g. to pass it to
+      /// Node::Publisher::PublishRaw().
+      public: std::shared_ptr<const char[]> Release();
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::unique_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Private data.
+      private: std::unique_ptr<MessageLoanPrivate> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+
+#endif
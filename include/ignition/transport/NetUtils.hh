@@ -38,7 +38,8 @@ namespace ignition
     /// \return true if the IP address is private.
     bool isPrivateIP(const char *_ip);
 
-    /// \brief Determine if an IP is private.
+    /// \brief Determine the IPv4 address of a hostname. The resolution
+    /// gives up after a short timeout, e.g. with a misconfigured DNS.
     /// \param[in] _hostname Hostname
     /// \param[out] _ip IP associated to the input hostname.
     /// \return 0 when success.
@@ -47,12 +48,16 @@ namespace ignition
     /// \brief Determine IP or hostname.
     /// Reference: https://github.com/ros/ros_comm/blob/hydro-devel/clients/
     /// roscpp/src/libros/network.cpp
+    /// Unless IGN_IP is set, the host is only determined the first time,
+    /// later calls return the same value.
     /// \return The IP or hostname of this host.
     std::string IGNITION_TRANSPORT_VISIBLE determineHost();
 
     /// \brief Determine the list of network interfaces for this machine.
     /// Reference: https://github.com/ros/ros_comm/blob/hydro-devel/clients/
     /// roscpp/src/libros/network.cpp
+    /// The interfaces are only searched the first time, later calls return
+    /// the same list.
     /// \return The list of network interfaces.
     std::vector<std::string> IGNITION_TRANSPORT_VISIBLE determineInterfaces();
 
@@ -18,7 +18,10 @@
 #define IGN_TRANSPORT_NODE_HH_
 
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -38,13 +41,20 @@
 #include "ignition/transport/AdvertiseOptions.hh"
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
+#include "ignition/transport/LazyMessage.hh"
+#include "ignition/transport/MessageLoan.hh"
 #include "ignition/transport/NodeOptions.hh"
 #include "ignition/transport/NodeShared.hh"
 #include "ignition/transport/Publisher.hh"
 #include "ignition/transport/RepHandler.hh"
 #include "ignition/transport/ReqHandler.hh"
+#include "ignition/transport/Serializer.hh"
+#include "ignition/transport/RequestAwaitable.hh"
+#include "ignition/transport/ServiceCompletion.hh"
+#include "ignition/transport/ServiceStream.hh"
 #include "ignition/transport/SubscribeOptions.hh"
 #include "ignition/transport/SubscriptionHandler.hh"
+#include "ignition/transport/TopicName.hh"
 #include "ignition/transport/TopicStatistics.hh"
 #include "ignition/transport/TopicUtils.hh"
 #include "ignition/transport/TransportTypes.hh"
@@ -83,6 +93,28 @@ namespace ignition
     /// If your buffer reaches the maximum capacity data will be dropped.
     int IGNITION_TRANSPORT_VISIBLE sndHwm();
 
+    /// \brief Get the counters of the ZMQ sockets used for the topics by
+    /// all the nodes of this process, e.g. to check if the send buffer
+    /// (High Water Mark) is large enough. \sa NodeShared::SocketStatistics.
+    /// \return The counters.
+    NodeShared::SocketStatistics IGNITION_TRANSPORT_VISIBLE socketStats();
+
+    /// \brief Receive and dispatch the pending messages, service requests
+    /// and responses of all the nodes of this process in the calling
+    /// thread. It's only available when the transport doesn't run its own
+    /// reception threads, see ThreadConfig::ManualSpin().
+    /// \param[in] _timeout Maximum time to wait for something to do.
+    /// \return True if something was processed or false otherwise.
+    /// \sa NodeShared::SpinOnce().
+    bool IGNITION_TRANSPORT_VISIBLE spinOnce(
+      const std::chrono::milliseconds &_timeout =
+        std::chrono::milliseconds(0));
+
+    /// \brief Get the file descriptors to wait on before calling spinOnce(),
+    /// e.g.: with poll(). \sa NodeShared::SpinDescriptors().
+    /// \return The file descriptors.
+    std::vector<int> IGNITION_TRANSPORT_VISIBLE spinDescriptors();
+
     /// \brief Block the current thread until a SIGINT or SIGTERM is received.
     /// Note that this function registers a signal handler. Do not use this
     /// function if you want to manage yourself SIGINT/SIGTERM.
@@ -96,6 +128,9 @@ namespace ignition
     {
       class PublisherPrivate;
 
+      // Forward declaration.
+      public: template<typename MessageT> class TypedPublisher;
+
       /// \brief A class that is used to store information about an
       /// advertised publisher. An instance of this class is returned
       /// from Node::Advertise, and should be used in subsequent
@@ -146,6 +181,76 @@ namespace ignition
         /// \return true when success.
         public: bool Publish(const ProtoMsg &_msg);
 
+        /// \brief Publish a message taking ownership of it. Intraprocess
+        /// subscribers receive this same message instead of a copy.
+        /// \param[in] _msg A google::protobuf message. It must not be
+        /// modified once published, since local subscribers may still be
+        /// using it.
+        /// \return true when success.
+        public: bool Publish(std::unique_ptr<ProtoMsg> _msg);
+
+        /// \brief Publish a message moving its content. Intraprocess
+        /// subscribers receive the moved content instead of a deep copy of the
+        /// message, which is left in a valid but unspecified state.
+        /// \param[in] _msg A google::protobuf message.
+        /// \return true when success.
+        public: bool Publish(ProtoMsg &&_msg);
+
+        /// \brief Publish a message taking ownership of it, without blocking
+        /// the caller: the message is serialized and sent by a worker of the
+        /// transport, e.g. to keep the serialization of a large point cloud
+        /// off a sensor thread. The messages of a publisher are published in
+        /// the order of the calls, one at a time, and the ones of different
+        /// publishers in parallel. The queue isn't bounded, the caller
+        /// should wait for the results when it publishes faster than the
+        /// workers.
+        /// \param[in] _msg A google::protobuf message. It must not be
+        /// modified once published, like with Publish(std::unique_ptr).
+        /// \param[in] _done Optional callback executed by the worker with the
+        /// result of the publication, once it's done.
+        /// \return The result of the publication, true when success. It's
+        /// ready when the publication is done.
+        public: std::future<bool> PublishAsync(
+                    std::unique_ptr<ProtoMsg> _msg,
+                    std::function<void(const bool _result)> _done = nullptr);
+
+        /// \brief Publish a message of a type that isn't protobuf, with its
+        /// specialization of Serializer. The message is serialized in a
+        /// loan, see Loan(), and published without another copy.
+        /// \param[in] _msg The message.
+        /// \return true when success.
+        public: template<typename MessageT>
+                std::enable_if_t<IsCustomSerialized<MessageT>::value, bool>
+                Publish(const MessageT &_msg);
+
+        /// \brief Publish a batch of messages. This is equivalent to calling
+        /// Publish() with each message in sequence, but the subscriber lookup,
+        /// the serialization buffer and the socket lock are shared by the
+        /// whole batch. The batch counts as a single publication for
+        /// throttling purposes.
+        /// \param[in] _msgs The messages, in publication order. All of them
+        /// must have the advertised type, otherwise nothing is published.
+        /// \return true when success.
+        public: bool PublishBatch(const std::vector<const ProtoMsg *> &_msgs);
+
+        /// \brief Publish a batch of messages.
+        /// \param[in] _msgs The messages, in publication order.
+        /// \return true when success.
+        /// \sa PublishBatch(const std::vector<const ProtoMsg *> &)
+        public: template<typename MessageT>
+                bool PublishBatch(const std::vector<MessageT> &_msgs);
+
+        /// \brief Implementation of all the Publish() functions.
+        /// \param[in] _msg The message to publish.
+        /// \param[in] _owned Optional ownership of _msg. When set, it is
+        /// handed to the intraprocess subscribers instead of a copy of _msg.
+        /// \param[in] _typeChecked Whether the type of _msg is known to be
+        /// the advertised type, e.g. by TypedPublisher.
+        /// \return true when success.
+        private: bool PublishHelper(const ProtoMsg &_msg,
+                                    std::unique_ptr<ProtoMsg> _owned,
+                                    const bool _typeChecked = false);
+
         /// \brief Publish a raw pre-serialized message.
         ///
         /// \warning This function is only intended for advanced users. The
@@ -171,6 +276,69 @@ namespace ignition
           const std::string &_msgData,
           const std::string &_msgType);
 
+        /// \brief Publish a raw pre-serialized message stored in a byte
+        /// array.
+        ///
+        /// \warning See PublishRaw(const std::string &, const std::string &)
+        /// for the intended use of this function. The data is copied once
+        /// when publishing to remote subscribers.
+        ///
+        /// \param[in] _msgData Pointer to the serialized message.
+        /// \param[in] _size Size of the serialized message (bytes).
+        /// \param[in] _msgType A std::string that contains the message type
+        /// name.
+        /// \return true when success.
+        public: bool PublishRaw(
+          const void *_msgData,
+          const std::size_t _size,
+          const std::string &_msgType);
+
+        /// \brief Publish a raw pre-serialized message stored in a shared
+        /// buffer. The buffer is handed to the remote subscribers without
+        /// copying it, and it is released, with the deleter of _msgData,
+        /// when the last publication that uses it is sent. So the contents
+        /// of the buffer must not change after this call.
+        ///
+        /// \warning See PublishRaw(const std::string &, const std::string &)
+        /// for the intended use of this function.
+        ///
+        /// \param[in] _msgData The serialized message.
+        /// \param[in] _size Size of the serialized message (bytes).
+        /// \param[in] _msgType A std::string that contains the message type
+        /// name.
+        /// \return true when success.
+        public: bool PublishRaw(
+          const std::shared_ptr<const char[]> &_msgData,
+          const std::size_t _size,
+          const std::string &_msgType);
+
+        /// \brief Borrow a buffer of the transport, to build a serialized
+        /// message in place and publish it with Publish(MessageLoan &&).
+        /// \param[in] _size Size of the buffer (bytes).
+        /// \return The loan, invalid if the publisher isn't valid.
+        public: MessageLoan Loan(const std::size_t _size);
+
+        /// \brief Publish the serialized message built in a loan, without
+        /// copying it, as PublishRaw() does with a shared buffer. The type
+        /// of the loan, when set, must match the advertised type.
+        /// \param[in] _loan The loan, left invalid.
+        /// \return true when success.
+        /// \sa MessageLoan
+        public: bool Publish(MessageLoan &&_loan);
+
+        /// \brief Implementation of all the PublishRaw() functions.
+        /// \param[in] _msgData Pointer to the serialized message.
+        /// \param[in] _size Size of the serialized message (bytes).
+        /// \param[in] _msgType Name of the message type.
+        /// \param[in] _buffer Optional owner of _msgData. When set, it's
+        /// passed to ZMQ instead of a copy of the data.
+        /// \return true when success.
+        private: bool PublishRawHelper(
+          const char *_msgData,
+          const std::size_t _size,
+          const std::string &_msgType,
+          std::shared_ptr<const char[]> _buffer);
+
         /// \brief Check if message publication is throttled. If so, verify
         /// whether the next message should be published or not.
         ///
@@ -190,6 +358,48 @@ namespace ignition
         /// \return True if subscribers have connected to this publisher.
         public: bool HasConnections() const;
 
+        /// \brief Get the number of messages that were not delivered to the
+        /// subscribers of the same process because the local queue of this
+        /// publisher was full.
+        /// \return Number of messages dropped.
+        /// \sa AdvertiseMessageOptions::SetLocalQueueDepth
+        public: uint64_t DroppedLocalMessages() const;
+
+        /// \brief Get the number of messages that were dropped because the
+        /// real-time queue of this publisher was full, or because another
+        /// thread was publishing at the same time.
+        /// \return Number of messages dropped.
+        /// \sa AdvertiseMessageOptions::SetRealtimeQueue
+        public: uint64_t DroppedRealtimeMessages() const;
+
+        /// \brief Get the number of messages that were not published through
+        /// the real-time queue of this publisher because they didn't fit in
+        /// a slot, weren't of the advertised type or couldn't be serialized.
+        /// \return Number of messages that failed.
+        /// \sa AdvertiseMessageOptions::SetRealtimeQueue
+        public: uint64_t FailedRealtimeMessages() const;
+
+        /// \brief Check if the messages go through a real-time queue.
+        /// \return True if the publisher has a real-time queue.
+        private: bool Realtime() const;
+
+        /// \brief Queue a serialized message in the real-time queue.
+        /// \param[in] _size Size of the serialized message (bytes).
+        /// \param[in] _write Function that serializes _msg in a slot of the
+        /// queue of _size bytes.
+        /// \param[in] _msg The message.
+        /// \param[in] _msgType Name of the message type.
+        /// \return true if the message was queued.
+        private: bool PublishRealtime(const std::size_t _size,
+          bool (*_write)(const void *_msg, char *_data,
+                         const std::size_t _size),
+          const void *_msg,
+          const std::string &_msgType);
+
+        /// \brief Constructor of a publisher sharing private data.
+        /// \param[in] _dataPtr The private data.
+        private: explicit Publisher(std::shared_ptr<PublisherPrivate> _dataPtr);
+
         /// \internal
         /// \brief Smart pointer to private data.
         /// This is std::shared_ptr because we want to trigger the destructor
@@ -205,6 +415,51 @@ namespace ignition
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
+
+        /// \brief The typed publishers skip the type checks.
+        template<typename MessageT> friend class TypedPublisher;
+      };
+
+      /// \brief A publisher returned by Advertise<MessageT>(), which knows
+      /// the advertised type at compile time. Publishing a MessageT skips the
+      /// type check done for every message by Publisher::Publish(). The
+      /// messages of other types still go through Publisher, and are
+      /// rejected at runtime.
+      public: template<typename MessageT>
+      class TypedPublisher : public Publisher
+      {
+        /// \brief Default constructor, an invalid publisher.
+        public: TypedPublisher() = default;
+
+        // The other versions of Publish().
+        public: using Publisher::Publish;
+
+        /// \brief Publish a message, see Publisher::Publish().
+        /// \param[in] _msg The message.
+        /// \return true when success.
+        public: bool Publish(const MessageT &_msg);
+
+        /// \brief Publish a message taking ownership of it, see
+        /// Publisher::Publish(std::unique_ptr<ProtoMsg>).
+        /// \param[in] _msg The message.
+        /// \return true when success.
+        public: bool Publish(std::unique_ptr<MessageT> _msg);
+
+        /// \brief Publish a message moving its content, see
+        /// Publisher::Publish(ProtoMsg &&).
+        /// \param[in] _msg The message.
+        /// \return true when success.
+        public: bool Publish(MessageT &&_msg);
+
+        /// \brief Constructor, only used by Node::Advertise().
+        /// \param[in] _publisher The publisher of a MessageT.
+        private: explicit TypedPublisher(const Publisher &_publisher)
+          : Publisher(_publisher)
+        {
+        }
+
+        /// \brief Node::Advertise() creates the typed publishers.
+        friend class Node;
       };
 
       /// \brief Constructor.
@@ -223,10 +478,19 @@ namespace ignition
       /// was succesfully advertised.
       /// \sa AdvertiseOptions.
       public: template<typename MessageT>
-      Node::Publisher Advertise(
+      Node::TypedPublisher<MessageT> Advertise(
           const std::string &_topic,
           const AdvertiseMessageOptions &_options = AdvertiseMessageOptions());
 
+      /// \brief Advertise a new topic with a name already resolved.
+      /// \param[in] _topic Topic name, see Resolve().
+      /// \param[in] _options Advertise options.
+      /// \return A PublisherId, see the other versions of Advertise().
+      public: template<typename MessageT>
+      Node::TypedPublisher<MessageT> Advertise(
+          const TopicName &_topic,
+          const AdvertiseMessageOptions &_options = AdvertiseMessageOptions());
+
       /// \brief Advertise a new topic. If a topic is currently advertised,
       /// you cannot advertise it a second time (regardless of its type).
       /// \param[in] _topic Topic name to be advertised.
@@ -243,6 +507,17 @@ namespace ignition
           const std::string &_msgTypeName,
           const AdvertiseMessageOptions &_options = AdvertiseMessageOptions());
 
+      /// \brief Advertise a new topic with a name already resolved.
+      /// \param[in] _topic Topic name, see Resolve().
+      /// \param[in] _msgTypeName Name of the message type that will be
+      /// published on the topic.
+      /// \param[in] _options Advertise options.
+      /// \return A PublisherId, see the other versions of Advertise().
+      public: Node::Publisher Advertise(
+          const TopicName &_topic,
+          const std::string &_msgTypeName,
+          const AdvertiseMessageOptions &_options = AdvertiseMessageOptions());
+
       /// \brief Get the list of topics advertised by this node.
       /// \return A vector containing all the topics advertised by this node.
       public: std::vector<std::string> AdvertisedTopics() const;
@@ -325,6 +600,20 @@ namespace ignition
                              const MessageInfo &_info)> &_callback,
           const SubscribeOptions &_opts = SubscribeOptions());
 
+      /// \brief Subscribe to a topic with a name already resolved.
+      /// \param[in] _topic Topic to be subscribed, see Resolve().
+      /// \param[in] _callback Lambda function with the following parameters:
+      ///   \param[in] _msg Protobuf message containing a new topic update.
+      ///   \param[in] _info Message information (e.g.: topic name).
+      /// \param[in] _opts Subscription options.
+      /// \return true when successfully subscribed or false otherwise.
+      public: template<typename MessageT>
+      bool Subscribe(
+          const TopicName &_topic,
+          std::function<void(const MessageT &_msg,
+                             const MessageInfo &_info)> &_callback,
+          const SubscribeOptions &_opts = SubscribeOptions());
+
       /// \brief Subscribe to a topic registering a callback.
       /// Note that this callback includes message information.
       /// In this version the callback is a member function.
@@ -344,6 +633,43 @@ namespace ignition
           ClassT *_obj,
           const SubscribeOptions &_opts = SubscribeOptions());
 
+      /// \brief Subscribe to a topic registering a callback that shares the
+      /// messages with the transport, so it can keep them, e.g. hand them
+      /// over to a worker thread, without copying them. The messages are
+      /// read-only, and the other subscribers of the process may share them
+      /// too. The messages of a publisher delivered inline, see
+      /// SubscribeOptions::SetInlineDelivery(), are copied.
+      /// \param[in] _topic Topic to be subscribed.
+      /// \param[in] _callback Function with the following parameters:
+      ///   \param[in] _msg The message, never null.
+      ///   \param[in] _info Message information (e.g.: topic name).
+      /// \param[in] _opts Subscription options.
+      /// \return true when successfully subscribed or false otherwise.
+      public: template<typename MessageT>
+      bool SubscribeShared(
+          const std::string &_topic,
+          const SharedMsgCallback<MessageT> &_callback,
+          const SubscribeOptions &_opts = SubscribeOptions());
+
+      /// \brief Subscribe to a topic registering a callback that receives
+      /// the messages still serialized. The message is only deserialized when
+      /// the callback, or any thread that it hands the message to, calls
+      /// LazyMessage::Get(), so filtering subscribers don't pay the parsing
+      /// cost of the messages that they discard. This subscription uses the
+      /// raw path, so local publishers serialize the messages for it.
+      /// \param[in] _topic Topic to be subscribed.
+      /// \param[in] _callback Function with the following parameters:
+      ///   \param[in] _msg Handle to the serialized message.
+      ///   \param[in] _info Message information (e.g.: topic name).
+      /// \param[in] _opts Subscription options.
+      /// \return true when successfully subscribed or false otherwise.
+      public: template<typename MessageT>
+      bool SubscribeLazy(
+          const std::string &_topic,
+          const std::function<void(const LazyMessage<MessageT> &_msg,
+                                   const MessageInfo &_info)> &_callback,
+          const SubscribeOptions &_opts = SubscribeOptions());
+
       /// \brief Get the list of topics subscribed by this node. Note that
       /// we might be interested in one topic but we still don't know the
       /// address of a publisher.
@@ -516,6 +842,55 @@ namespace ignition
           ClassT *_obj,
           const AdvertiseServiceOptions &_options = AdvertiseServiceOptions());
 
+      /// \brief Advertise a new service whose responses are produced
+      /// asynchronously. Instead of filling the response, the callback
+      /// receives a completion handle that can be kept and completed later,
+      /// from any thread (e.g.: when a database query finishes). This way a
+      /// service can have many calls in progress without blocking a thread
+      /// per call. If all the copies of the handle are destroyed without
+      /// completing the call, a failed response is sent. Note that calls made
+      /// from the same process block the requester until the call is
+      /// completed.
+      /// \param[in] _topic Topic name associated to the service.
+      /// \param[in] _callback Callback to handle the service request with the
+      /// following parameters:
+      ///   \param[in] _request Protobuf message containing the request.
+      ///   \param[in] _completion Handle used to send the response.
+      /// \param[in] _options Advertise options.
+      /// \return true when the topic has been successfully advertised or
+      /// false otherwise.
+      /// \sa ServiceCompletion
+      public: template<typename RequestT, typename ReplyT>
+      bool AdvertiseAsync(
+          const std::string &_topic,
+          std::function<void(const RequestT &_request,
+            const ServiceCompletion<ReplyT> &_completion)> _callback,
+          const AdvertiseServiceOptions &_options = AdvertiseServiceOptions());
+
+      /// \brief Advertise a new service whose responder sends a stream of
+      /// responses to each call, e.g.: the chunks of a large map or
+      /// incremental search results. The callback receives a stream handle
+      /// and writes the responses to it, blocking while the requester is
+      /// behind, until it closes the stream. The handle can be kept and used
+      /// from any thread. Streaming calls run in a thread pool, and requests
+      /// made with Request() instead of RequestStream() only receive the
+      /// first response.
+      /// \param[in] _topic Topic name associated to the service.
+      /// \param[in] _callback Callback to handle the service request with the
+      /// following parameters:
+      ///   \param[in] _request Protobuf message containing the request.
+      ///   \param[in] _stream Handle used to send the responses.
+      /// \param[in] _options Advertise options.
+      /// \return true when the topic has been successfully advertised or
+      /// false otherwise.
+      /// \sa ServiceStream
+      public: template<typename RequestT, typename ReplyT>
+      bool AdvertiseStream(
+          const std::string &_topic,
+          std::function<void(const RequestT &_request,
+            const ServiceStream<ReplyT> &_stream)> _callback,
+          const AdvertiseServiceOptions &_options = AdvertiseServiceOptions());
+
       /// \brief Get the list of services advertised by this node.
       /// \return A vector containing all services advertised by this node.
       public: std::vector<std::string> AdvertisedServices() const;
@@ -570,6 +945,21 @@ namespace ignition
           std::function<void(const ReplyT &_reply,
                              const bool _result)> &_callback);
 
+      /// \brief Request a new service with a name already resolved, using a
+      /// non-blocking call.
+      /// \param[in] _topic Service name requested, see Resolve().
+      /// \param[in] _request Protobuf message containing the request's
+      /// parameters.
+      /// \param[in] _callback Lambda function executed when the response
+      /// arrives, see the other versions of Request().
+      /// \return true when the service call was succesfully requested.
+      public: template<typename RequestT, typename ReplyT>
+      bool Request(
+          const TopicName &_topic,
+          const RequestT &_request,
+          std::function<void(const ReplyT &_reply,
+                             const bool _result)> &_callback);
+
       /// \brief Request a new service without input parameter using a
       /// non-blocking call.
       /// In this version the callback is a lambda function.
@@ -639,6 +1029,25 @@ namespace ignition
           ReplyT &_reply,
           bool &_result);
 
+      /// \brief Request a new service with a name already resolved, using a
+      /// blocking call. This is the version for calling the same service
+      /// at a high rate.
+      /// \param[in] _topic Service name requested, see Resolve().
+      /// \param[in] _request Protobuf message containing the request's
+      /// parameters.
+      /// \param[in] _timeout The request will timeout after '_timeout' ms.
+      /// \param[out] _reply Protobuf message containing the response.
+      /// \param[out] _result Result of the service call.
+      /// \return true when the request was executed or false if the timeout
+      /// expired.
+      public: template<typename RequestT, typename ReplyT>
+      bool Request(
+          const TopicName &_topic,
+          const RequestT &_request,
+          const unsigned int &_timeout,
+          ReplyT &_reply,
+          bool &_result);
+
       /// \brief Request a new service without input parameter using a blocking
       /// call.
       /// \param[in] _topic Service name requested.
@@ -654,6 +1063,59 @@ namespace ignition
           ReplyT &_reply,
           bool &_result);
 
+      /// \brief Request a new service and get a future for the response.
+      /// Many requests can be in flight at the same time without blocking a
+      /// thread per request, and joined later. The future becomes ready when
+      /// the response arrives. Use std::future::wait_for() to bound the
+      /// waiting time.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _request Protobuf message containing the request's
+      /// parameters.
+      /// \return A future holding the response, or std::nullopt if the
+      /// service call failed. If the request couldn't be made, the future is
+      /// not valid (see std::future::valid()).
+      public: template<typename RequestT, typename ReplyT>
+      std::future<std::optional<ReplyT>> RequestFuture(
+          const std::string &_topic,
+          const RequestT &_request);
+
+      /// \brief Request a new service and receive a stream of responses,
+      /// from a service advertised with AdvertiseStream(). Services
+      /// advertised otherwise send a stream with a single response. The
+      /// responder only sends a few responses ahead of the ones consumed, so
+      /// slow callbacks slow down the responder instead of piling up
+      /// responses in memory.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _request Protobuf message containing the request's
+      /// parameters.
+      /// \param[in] _onReply Callback executed with each response, in
+      /// order.
+      /// \param[in] _onDone Callback executed once after the last response,
+      /// with the result of the service call.
+      /// \return true when the service call was succesfully requested.
+      public: template<typename RequestT, typename ReplyT>
+      bool RequestStream(
+          const std::string &_topic,
+          const RequestT &_request,
+          std::function<void(const ReplyT &_reply)> _onReply,
+          std::function<void(const bool _result)> _onDone);
+
+#ifdef __cpp_impl_coroutine
+      /// \brief Request a new service from a C++20 coroutine. The result of
+      /// co_await on the returned object is the response, or std::nullopt if
+      /// the service call failed or the request couldn't be made. Only
+      /// available when compiling with coroutine support.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _request Protobuf message containing the request's
+      /// parameters.
+      /// \return The awaitable response.
+      /// \sa RequestAwaitable
+      public: template<typename RequestT, typename ReplyT>
+      RequestAwaitable<ReplyT> RequestAwait(
+          const std::string &_topic,
+          const RequestT &_request);
+#endif
+
       /// \brief Request a new service without waiting for response.
       /// \param[in] _topic Topic requested.
       /// \param[in] _request Protobuf message containing the request's
@@ -662,6 +1124,19 @@ namespace ignition
       public: template<typename RequestT>
       bool Request(const std::string &_topic, const RequestT &_request);
 
+      /// \brief Request a oneway service many times at once, without waiting
+      /// for responses. All the requests are packed in a single message,
+      /// and the responder runs its callback with each of them in order.
+      /// Cheaper than calling Request() for each request when sending many
+      /// small commands. Responders of older versions ignore the batches.
+      /// \param[in] _topic Service name requested.
+      /// \param[in] _requests Protobuf messages containing the parameters
+      /// of each request.
+      /// \return true when the requests were succesfully requested.
+      public: template<typename RequestT>
+      bool RequestBatch(const std::string &_topic,
+                        const std::vector<RequestT> &_requests);
+
       /// \brief Unadvertise a service.
       /// \param[in] _topic Service name to be unadvertised.
       /// \return true if the service was successfully unadvertised.
@@ -669,12 +1144,22 @@ namespace ignition
 
       /// \brief Get the list of topics currently advertised in the network.
       /// Note that this function can block for some time if the
-      /// discovery is in its initialization phase.
-      /// The value of the "heartbeatInterval" constant, with a default
-      /// value of 1000 ms, sets the maximum blocking time period.
+      /// discovery is in its initialization phase, until the other
+      /// processes have answered the request for their topics sent when the
+      /// discovery started. It usually takes a small fraction of the
+      /// "heartbeatInterval" constant, with a default value of 1000 ms, and
+      /// never more than twice this interval.
       /// \param[out] _topics List of advertised topics.
       public: void TopicList(std::vector<std::string> &_topics) const;
 
+      /// \brief Get the list of topics currently advertised in the network,
+      /// blocking at most _timeout if the discovery is in its
+      /// initialization phase.
+      /// \param[out] _topics List of advertised topics.
+      /// \param[in] _timeout Maximum time to wait for the other processes.
+      public: void TopicList(std::vector<std::string> &_topics,
+                             const std::chrono::milliseconds &_timeout) const;
+
       /// \brief Get the information about a topic.
       /// \param[in] _topic Name of the topic.
       /// \param[out] _publishers List of publishers on the topic
@@ -682,14 +1167,61 @@ namespace ignition
       public: bool TopicInfo(const std::string &_topic,
                              std::vector<MessagePublisher> &_publishers) const;
 
-      /// \brief Get the list of topics currently advertised in the network.
-      /// Note that this function can block for some time if the
-      /// discovery is in its initialization phase.
-      /// The value of the "heartbeatInterval" constant, with a default
-      /// value of 1000ms, sets the maximum blocking time period.
+      /// \brief Block until the other processes have answered the request
+      /// for their topics and services sent when the discovery started, or
+      /// until the timeout expires. Afterwards, TopicList(), TopicInfo(),
+      /// ServiceList() and ServiceInfo() don't wait for the initialization
+      /// phase of the discovery, so one-shot queries take a fraction of the
+      /// heartbeat interval. The services are only waited for once a node
+      /// of this process has used them, their discovery starts then.
+      /// \param[in] _timeout Maximum time to wait.
+      public: void WaitForDiscovery(const std::chrono::milliseconds &_timeout =
+                                      std::chrono::milliseconds(500)) const;
+
+      /// \brief Block until there are at least _count publishers of a topic
+      /// in other processes, or until the timeout expires. The function
+      /// wakes up on the discovery updates, it doesn't poll.
+      /// \param[in] _topic Name of the topic.
+      /// \param[in] _count Number of publishers (nodes) to wait for.
+      /// \param[in] _timeout Maximum time to wait.
+      /// \return True if there are enough publishers, false on timeout or if
+      /// the topic name is invalid.
+      public: bool WaitForPublishers(const std::string &_topic,
+                                     const std::size_t _count,
+                                     const std::chrono::milliseconds &_timeout)
+                                     const;
+
+      /// \brief Block until there are at least _count subscribers of a topic
+      /// in other processes, or until the timeout expires. Remote
+      /// subscribers only register with the processes publishing the topic,
+      /// so a node of this process has to advertise it first. The function
+      /// wakes up on the discovery updates, it doesn't poll.
+      /// \param[in] _topic Name of the topic.
+      /// \param[in] _count Number of subscribers (nodes) to wait for.
+      /// \param[in] _timeout Maximum time to wait.
+      /// \return True if there are enough subscribers, false on timeout or
+      /// if the topic name is invalid.
+      /// \sa Node::Publisher::HasConnections.
+      public: bool WaitForSubscribers(const std::string &_topic,
+                                      const std::size_t _count,
+                                      const std::chrono::milliseconds &_timeout)
+                                      const;
+
+      /// \brief Get the list of services currently advertised in the
+      /// network. Note that this function can block for some time if the
+      /// discovery is in its initialization phase, see TopicList().
       /// \param[out] _services List of advertised services.
       public: void ServiceList(std::vector<std::string> &_services) const;
 
+      /// \brief Get the list of services currently advertised in the
+      /// network, blocking at most _timeout if the discovery is in its
+      /// initialization phase.
+      /// \param[out] _services List of advertised services.
+      /// \param[in] _timeout Maximum time to wait for the other processes.
+      public: void ServiceList(std::vector<std::string> &_services,
+                               const std::chrono::milliseconds &_timeout)
+                               const;
+
       /// \brief Get the information about a service.
       /// \param[in] _service Name of the service.
       /// \param[out] _publishers List of publishers on the service.
@@ -717,16 +1249,95 @@ namespace ignition
         const std::string &_msgType = kGenericMessageType,
         const SubscribeOptions &_opts = SubscribeOptions());
 
+      /// \brief Subscribe to a topic with a name already resolved, see
+      /// the other version of SubscribeRaw().
+      /// \param[in] _topic Topic to subscribe to, see Resolve().
+      /// \param[in] _callback Callback of the raw messages.
+      /// \param[in] _msgType The type of message to subscribe to.
+      /// \param[in] _opts Options for subscribing.
+      /// \return True if subscribing was successful.
+      public: bool SubscribeRaw(
+        const TopicName &_topic,
+        const RawCallback &_callback,
+        const std::string &_msgType = kGenericMessageType,
+        const SubscribeOptions &_opts = SubscribeOptions());
+
+      /// \brief Subscribe to all the topics under a prefix, e.g. "/robot"
+      /// subscribes to "/robot", "/robot/scan" and "/robot/arm/joint", but
+      /// not to "/robotic". A prefix of "/" subscribes to all the topics of
+      /// the partition. The subscription uses a single filter in the
+      /// sockets, whatever the number of topics, and the callback receives
+      /// the messages of the topics found now and in the future, of any
+      /// message type. MessageInfo::Topic() tells them apart.
+      /// \param[in] _prefix Prefix of the topics. Remapping doesn't apply.
+      /// \param[in] _callback A function pointer or std::function object
+      /// like the one of SubscribeRaw().
+      /// \param[in] _opts Options for subscribing.
+      /// \return True if subscribing was successful.
+      /// \sa UnsubscribePrefix
+      public: bool SubscribeRawPrefix(
+        const std::string &_prefix,
+        const RawCallback &_callback,
+        const SubscribeOptions &_opts = SubscribeOptions());
+
+      /// \brief Get the prefixes passed to SubscribeRawPrefix().
+      /// \return The subscribed prefixes.
+      public: std::vector<std::string> SubscribedPrefixes() const;
+
+      /// \brief Remove the callbacks of SubscribeRawPrefix() for a prefix.
+      /// \param[in] _prefix Prefix of the topics.
+      /// \return True if the node was subscribed to the prefix.
+      public: bool UnsubscribePrefix(const std::string &_prefix);
+
+      /// \brief Follow the changes of the topic publishers known through the
+      /// discovery, of all the topics of the partition of this node, whether
+      /// this process subscribes to them or not. Unlike TopicList() and
+      /// TopicInfo(), it doesn't copy the discovery information nor wait for
+      /// it, so a monitoring tool can update its view incrementally. The
+      /// callbacks are executed one at a time, in order, in a thread of the
+      /// transport. A publisher may be reported as added more than once, and
+      /// a process gone is reported once for all its publishers, see
+      /// DiscoveryChange_t::PROCESS_REMOVED.
+      /// \param[in] _callback Callback of the changes, which receives the
+      /// publishers with their fully qualified topic names.
+      /// \param[in] _replay True to report first the publishers known now as
+      /// added, so the callback starts from a full view.
+      /// \return Id of the subscription, see UnsubscribeDiscovery().
+      public: uint64_t SubscribeDiscovery(
+        const DiscoveryChangeCallback &_callback,
+        const bool _replay = true);
+
+      /// \brief Stop following the changes of the discovery. When this
+      /// returns, the callback isn't running and won't be executed again,
+      /// unless it's the caller.
+      /// \param[in] _id Id returned by SubscribeDiscovery().
+      /// \return True if the subscription belonged to this node.
+      public: bool UnsubscribeDiscovery(const uint64_t _id);
+
       /// \brief Get the reference to the current node options.
       /// \return Reference to the current node options.
       public: const NodeOptions &Options() const;
 
+      /// \brief Resolve a topic or service name as seen by this node:
+      /// remapped, see NodeOptions::AddTopicRemap(), and qualified with the
+      /// partition and the namespace of the node. The functions that take a
+      /// TopicName skip all that work, so a name used often can be resolved
+      /// once. The names passed as strings to the other functions are
+      /// resolved through a cache of this node too.
+      /// \param[in] _topic Topic or service name.
+      /// \return The resolved name, check TopicName::Valid().
+      public: TopicName Resolve(const std::string &_topic) const;
+
       /// \brief Turn topic statistics on or off.
       /// \param[in] _topic The name of the topic on which to enable or disable
       /// statistics.
       /// \param[in] _enable True to enable statistics, false to disable.
       /// \param[in] _publicationTopic Topic on which to publish statistics.
-      /// \param[in] _publicationRate Rate at which to publish statistics.
+      /// \param[in] _publicationRate Maximum rate at which to publish
+      /// statistics (Hz). The statistics of the messages received in between
+      /// are aggregated, and published by a thread of the process, not by
+      /// the thread receiving the messages. Nothing is published while no
+      /// message is received.
       public: bool EnableStats(const std::string &_topic, bool _enable,
                   const std::string &_publicationTopic = "/statistics",
                   uint64_t _publicationRate = 1);
@@ -740,6 +1351,17 @@ namespace ignition
       public: std::optional<TopicStatistics> TopicStats(
                   const std::string &_topic) const;
 
+      /// \brief Get the number of messages lost before reaching the
+      /// subscriptions of this node to a topic. Each message lost on its way
+      /// from a remote publisher is detected from the gaps in the sequence
+      /// numbers of the publisher. The sequence numbers are part of every
+      /// message sent with the compact header (IGN_TRANSPORT_COMPACT_HEADER),
+      /// otherwise only when statistics are enabled on the topic.
+      /// \param[in] _topic The name of the topic.
+      /// \return The number of messages lost, summed over the subscriptions
+      /// of this node to the topic.
+      public: uint64_t DroppedMsgCount(const std::string &_topic) const;
+
       /// \brief Get a pointer to the shared node (singleton shared by all the
       /// nodes).
       /// \return The pointer to the shared node.
@@ -762,6 +1384,32 @@ namespace ignition
       /// \return True on success.
       private: bool SubscribeHelper(const std::string &_fullyQualifiedTopic);
 
+      /// \brief Helper function for Subscribe. Stores a subscription
+      /// handler and subscribes to its topic.
+      /// \param[in] _fullyQualifiedTopic Fully qualified topic name.
+      /// \param[in] _handler The subscription handler.
+      /// \return True on success.
+      private: bool SubscribeHandler(const std::string &_fullyQualifiedTopic,
+                                     const ISubscriptionHandlerPtr &_handler);
+
+      /// \brief Helper function for Advertise. Stores a replier handler and
+      /// advertises its service.
+      /// \param[in] _topic Service name.
+      /// \param[in] _handler The replier handler.
+      /// \param[in] _options Advertise options.
+      /// \return True on success.
+      private: bool AdvertiseHelper(const std::string &_topic,
+                                    const IRepHandlerPtr &_handler,
+                                    const AdvertiseServiceOptions &_options);
+
+      /// \brief Helper function for RequestStream. Runs the request with a
+      /// responder of this process or sends it to a remote one.
+      /// \param[in] _topic Service name.
+      /// \param[in] _handler The request handler.
+      /// \return True on success.
+      private: bool RequestStreamHelper(const std::string &_topic,
+                                        const IReqHandlerPtr &_handler);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
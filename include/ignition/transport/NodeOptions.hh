@@ -106,6 +106,23 @@ namespace ignition
       /// \sa Partition
       public: bool SetPartition(const std::string &_partition);
 
+      /// \brief Get the transport context of the node.
+      /// \return The name of the context, empty for the default one.
+      /// \sa SetContext.
+      public: const std::string &Context() const;
+
+      /// \brief Bind the node to a transport context. The nodes of a context
+      /// share its sockets, threads and discovery, isolated from the ones of
+      /// the other contexts of the process, e.g. to spread a heavy process
+      /// over several reception threads or to keep unrelated subsystems
+      /// apart. The nodes of different contexts communicate as if they lived
+      /// in different processes, see NodeShared::Instance(). A context can
+      /// also use discovery ports of its own, see
+      /// NodeShared::ConfigureContext().
+      /// \param[in] _context Name of the context, empty for the default one.
+      /// \sa Context.
+      public: void SetContext(const std::string &_context);
+
       /// \brief Add a new topic remapping. Any [Un]Advertise(),
       /// [Un]Subscribe() or Request() operation will check for topic
       /// remappings. If a topic is remapped, the '_fromTopic' topic will be
@@ -117,6 +134,17 @@ namespace ignition
       public: bool AddTopicRemap(const std::string &_fromTopic,
                                  const std::string &_toTopic);
 
+      /// \brief Add the topic remappings listed in a file. Each line of the
+      /// file contains a remapping, with the syntax "<from> := <to>". Empty
+      /// lines and lines starting with '#' are ignored. The invalid lines are
+      /// reported and skipped. The remappings are also loaded at construction
+      /// from the file set in the IGN_TRANSPORT_TOPIC_REMAPS environment
+      /// variable, which is read only once per process.
+      /// \param[in] _filename Path to the file.
+      /// \return True if all the remappings were added or false otherwise.
+      /// \sa AddTopicRemap
+      public: bool LoadTopicRemaps(const std::string &_filename);
+
       /// \brief Get a topic remapping.
       /// \param[in] _fromTopic The original topic.
       /// \param[out] _toTopic The new topic name.
@@ -26,6 +26,9 @@
 #pragma warning(pop)
 #endif
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -60,6 +63,9 @@ namespace ignition
     /// \brief Private data pointer
     class NodeSharedPrivate;
 
+    /// \brief A message received from a remote publisher.
+    class ReceivedMessage;
+
     /// \class NodeShared NodeShared.hh ignition/transport/NodeShared.hh
     /// \brief Private data for the Node class. This class should not be
     /// directly used. You should use the Node class.
@@ -70,9 +76,59 @@ namespace ignition
       /// \return Pointer to the current NodeShared instance.
       public: static NodeShared *Instance();
 
+      /// \brief Get the NodeShared instance of a transport context, shared
+      /// between the nodes bound to it, see NodeOptions::SetContext(). Each
+      /// context has its own sockets, threads, discovery and process UUID,
+      /// so the nodes of different contexts communicate as if they lived in
+      /// different processes. The instance is created on first use.
+      /// \param[in] _context Name of the context, empty for the default
+      /// one, returned by Instance().
+      /// \return Pointer to the NodeShared instance of the context.
+      public: static NodeShared *Instance(const std::string &_context);
+
+      /// \brief Set the discovery ports of a context before its first use.
+      /// A context with ports of its own doesn't discover the nodes of the
+      /// other contexts, nor the processes using other ports. By default
+      /// the contexts use the ports of IGN_DISCOVERY_MSG_PORT and
+      /// IGN_DISCOVERY_SRV_PORT.
+      /// \param[in] _context Name of the context, not empty.
+      /// \param[in] _msgDiscPort Port of the discovery of the topics.
+      /// \param[in] _srvDiscPort Port of the discovery of the services.
+      /// \return False if the context is already in use or the ports are
+      /// invalid.
+      public: static bool ConfigureContext(const std::string &_context,
+                                           const int _msgDiscPort,
+                                           const int _srvDiscPort);
+
+      /// \brief Get the name of the transport context of this instance.
+      /// \return The name, empty for the default context.
+      public: const std::string &Context() const;
+
       /// \brief Receive data and control messages.
       public: void RunReceptionTask();
 
+      /// \brief Receive and dispatch the pending messages and service calls
+      /// on the calling thread, waiting for them up to a timeout. It's only
+      /// available when the reception runs in the application, see
+      /// ThreadConfig::ManualSpin(), and must be called by one thread at a
+      /// time.
+      /// \param[in] _timeout Maximum time to wait for something to do, 0
+      /// to return right away.
+      /// \return True if something was received or dispatched, or false
+      /// otherwise (e.g.: the timeout expired or the reception runs in a
+      /// thread of the transport).
+      public: bool SpinOnce(const std::chrono::milliseconds &_timeout);
+
+      /// \brief Get the file descriptors that become readable when
+      /// SpinOnce() has something to do, for integrating the transport in
+      /// the event loop of the application (e.g.: with poll() or epoll).
+      /// They are edge triggered, as ZMQ_FD: when one becomes readable,
+      /// SpinOnce() has to be called with a timeout of 0 until it returns
+      /// false.
+      /// \return The file descriptors, or an empty vector when the reception
+      /// runs in a thread of the transport.
+      public: std::vector<int> SpinDescriptors();
+
       /// \brief Publish data.
       /// \param[in] _topic Topic to be published.
       /// \param[in, out] _data Serialized data. Note that this buffer will be
@@ -83,16 +139,65 @@ namespace ignition
       /// deallocates the buffer containing the published data.
       /// \ref http://zeromq.org/blog:zero-copy
       /// \param[in] _msgType Message type in string format.
-      /// \return true when success or false otherwise.
+      /// \param[in] _hint Opaque pointer passed to _ffn along with _data.
+      /// \return true when success or false otherwise. The buffer is
+      /// released with _ffn in both cases.
       public: bool Publish(const std::string &_topic,
                            char *_data,
                            const size_t _dataSize,
                            DeallocFunc *_ffn,
-                           const std::string &_msgType);
+                           const std::string &_msgType,
+                           void *_hint = nullptr);
+
+      /// \brief Publish data of a publisher. The sequence number of the
+      /// publisher is incremented and attached to the message, so the
+      /// subscribers can detect the messages lost.
+      /// \param[in] _topic Topic to be published.
+      /// \param[in, out] _data Serialized data, deallocated by ZMQ.
+      /// \param[in] _dataSize Data size (bytes).
+      /// \param[in, out] _ffn Deallocation function.
+      /// \param[in] _msgType Message type in string format.
+      /// \param[in] _hint Opaque pointer passed to _ffn along with _data.
+      /// \param[in] _publisherId Id of the publisher, unique in the process.
+      /// \param[in, out] _seq Sequence number of the last message of the
+      /// publisher. It's only modified with the mutex locked.
+      /// \return true when success or false otherwise. The buffer is
+      /// released with _ffn in both cases.
+      /// \sa Publish(const std::string &, char *, const size_t, DeallocFunc *,
+      /// const std::string &, void *)
+      public: bool Publish(const std::string &_topic,
+                           char *_data,
+                           const size_t _dataSize,
+                           DeallocFunc *_ffn,
+                           const std::string &_msgType,
+                           void *_hint,
+                           const uint64_t _publisherId,
+                           uint64_t &_seq);
 
       /// \brief Method in charge of receiving the topic updates.
       public: void RecvMsgUpdate();
 
+      /// \brief Method in charge of receiving the topic updates sent as best
+      /// effort datagrams.
+      public: void RecvDatagram();
+
+      /// \brief Deliver the last message of the latched publishers of a
+      /// topic in this process to a new subscription handler. The callback
+      /// runs asynchronously, like for any message published locally.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _handler The subscription handler.
+      /// \sa AdvertiseMessageOptions::SetLatched
+      public: void DeliverLatched(const std::string &_topic,
+                                  const ISubscriptionHandlerPtr &_handler);
+
+      /// \brief Deliver the last message of the latched publishers of a
+      /// topic in this process to a new raw subscription handler.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _handler The raw subscription handler.
+      /// \sa AdvertiseMessageOptions::SetLatched
+      public: void DeliverLatched(const std::string &_topic,
+                                  const RawSubscriptionHandlerPtr &_handler);
+
       /// \brief HandlerInfo contains information about callback handlers which
       /// is useful for local publishers and message receivers. You should only
       /// retrieve a HandlerInfo by calling
@@ -162,6 +267,28 @@ namespace ignition
           const std::string &_topic,
           const std::string &_msgType) const;
 
+      /// \brief Get an immutable snapshot of the subscribers of a topic. The
+      /// snapshot is cached and shared between all callers until the set of
+      /// local or remote subscribers for the topic changes, so the common case
+      /// performs a single atomic load without locking NodeShared::mutex or
+      /// copying any handler map.
+      /// \param[in] _topic Only information about subscribers to this topic
+      /// will be returned.
+      /// \param[in] _msgType If there are no remote subscribers listening for
+      /// this message type, then SubscriberInfo::haveRemote will be false in
+      /// the returned snapshot.
+      /// \return Information about subscribers. Never null.
+      public: std::shared_ptr<const SubscriberInfo> SubscriberSnapshot(
+          const std::string &_topic,
+          const std::string &_msgType) const;
+
+      /// \brief Discard the cached subscriber snapshots of a topic. This must
+      /// be called after modifying the local or remote subscribers of the
+      /// topic, with NodeShared::mutex locked.
+      /// \param[in] _topic Topic whose snapshots are discarded.
+      /// \sa SubscriberSnapshot
+      public: void InvalidateSubscriberSnapshot(const std::string &_topic);
+
       /// \brief Call the SubscriptionHandler callbacks (local and raw) for this
       /// NodeShared.
       /// \param[in] _info Message information.
@@ -173,6 +300,23 @@ namespace ignition
         const std::string &_msgData,
         const HandlerInfo &_handlerInfo);
 
+      /// \brief Call the SubscriptionHandler callbacks (local and raw) for this
+      /// NodeShared using a view of the serialized data. The data is not
+      /// copied, so it only needs to remain valid for the duration of the call.
+      /// \param[in] _info Message information.
+      /// \param[in] _msgData Pointer to the raw serialized data for the message
+      /// \param[in] _size Size of the serialized data in bytes.
+      /// \param[in] _handlerInfo Information for the handlers of this node,
+      /// as generated by CheckHandlerInfo(const std::string&) const
+      /// \param[in] _received Reception time of the message, used to trace
+      /// the time that it waits for the callbacks. Unknown by default.
+      public: void TriggerCallbacks(
+        const MessageInfo &_info,
+        const char *_msgData,
+        const size_t _size,
+        const HandlerInfo &_handlerInfo,
+        const std::chrono::steady_clock::time_point &_received = {});
+
       /// \brief Method in charge of receiving the control updates (when a new
       /// remote subscriber notifies its presence for example).
       /// ToDo: Remove this function when possible.
@@ -217,6 +361,13 @@ namespace ignition
       /// \param[in] _pub Information of the remote subscriber.
       public: void OnEndRegistration(const MessagePublisher &_pub);
 
+      /// \brief Callback executed with the statistics preference of a remote
+      /// subscriber, each time that it registers.
+      /// \param[in] _pub Information of the remote subscriber.
+      /// \param[in] _stats True if the subscriber collects topic statistics.
+      public: void OnStatsRegistration(const MessagePublisher &_pub,
+                                       const bool _stats);
+
       /// \brief Pass through to bool Publishers(const std::string &_topic,
       /// Addresses_M<Pub> &_publishers) const
       /// \param[in] _topic Service name.
@@ -267,15 +418,99 @@ namespace ignition
       /// If your buffer reaches the maximum capacity data will be dropped.
       public: int SndHwm();
 
+      /// \brief Counters of the ZMQ sockets used for the topics.
+      public: struct SocketStatistics
+      {
+        /// \brief Messages handed to the publisher socket.
+        public: uint64_t sentMsgs = 0;
+
+        /// \brief Messages not sent because the send buffer of a subscriber
+        /// was full. Only counted if IGN_TRANSPORT_COUNT_HWM_DROPS is set,
+        /// otherwise ZMQ drops them silently.
+        public: uint64_t hwmDroppedMsgs = 0;
+
+        /// \brief True if the messages dropped at the send HWM are counted.
+        public: bool hwmDropsCounted = false;
+
+        /// \brief Messages received by the subscriber socket.
+        public: uint64_t receivedMsgs = 0;
+
+        /// \brief Remote subscribers connected to the publisher socket.
+        public: uint64_t subscriberConnections = 0;
+
+        /// \brief Remote publishers that the subscriber socket is connected
+        /// to.
+        public: uint64_t publisherConnections = 0;
+      };
+
+      /// \brief Register a callback executed when a topic publisher is
+      /// discovered, whether it lives in another process or is advertised by
+      /// a node of this process. It lets a component follow the topics that
+      /// appear without running a discovery of its own. The callbacks are
+      /// executed one at a time in a thread of the transport, so they can
+      /// subscribe to the topics. A publisher may be reported more than once.
+      /// \param[in] _cb The callback, which receives the publisher with its
+      /// fully qualified topic name.
+      /// \return Id of the callback, see RemoveConnectionsCb().
+      public: uint64_t AddConnectionsCb(
+                  std::function<void(const MessagePublisher &_pub)> _cb);
+
+      /// \brief Unregister a callback registered with AddConnectionsCb().
+      /// When this returns, the callback isn't running and won't be executed
+      /// again, unless it's the caller.
+      /// \param[in] _id Id of the callback.
+      public: void RemoveConnectionsCb(const uint64_t _id);
+
+      /// \brief Register a callback executed when a topic publisher is
+      /// discovered, unadvertised or gone with its process, in this process
+      /// or in another one, like AddConnectionsCb(). The callbacks share the
+      /// thread and the order of the ones of AddConnectionsCb().
+      /// \param[in] _cb The callback.
+      /// \param[in] _replay True to report first the publishers known now as
+      /// added, to this callback only.
+      /// \return Id of the callback, see RemoveDiscoveryCb().
+      public: uint64_t AddDiscoveryCb(DiscoveryChangeCallback _cb,
+                                      const bool _replay = false);
+
+      /// \brief Unregister a callback registered with AddDiscoveryCb(), see
+      /// RemoveConnectionsCb().
+      /// \param[in] _id Id of the callback.
+      public: void RemoveDiscoveryCb(const uint64_t _id);
+
+      /// \brief Get the counters of the ZMQ sockets used for the topics.
+      /// \return The counters.
+      public: SocketStatistics SocketStats() const;
+
+      /// \brief Wait for data and control messages and receive them.
+      /// \param[in] _timeout Maximum time to wait, or -1 to wait until
+      /// something is received.
+      /// \return True if something was received or false otherwise.
+      private: bool ReceiveOnce(const std::chrono::milliseconds &_timeout);
+
       /// \brief Turn topic statistics on or off.
       /// \param[in] _topic The name of the topic on which to enable or disable
       /// statistics.
       /// \param[in] _enable True to enable statistics, false to disable.
-      /// \param[in] _cb Callback that is triggered whenever statistics are
-      /// updated.
+      /// \param[in] _cb Callback that is triggered with the statistics
+      /// once a second at most, after messages are received.
       public: void EnableStats(const std::string &_topic, bool _enable,
                   std::function<void(const TopicStatistics &_stats)> _cb);
 
+      /// \brief Turn topic statistics on or off. The reception threads only
+      /// update the statistics, and a thread of its own runs the callback,
+      /// without any lock of the transport held, once per period at most
+      /// and only when messages were received since the last call. Once
+      /// disabled, the callback is neither running nor called again.
+      /// \param[in] _topic The name of the topic on which to enable or disable
+      /// statistics.
+      /// \param[in] _enable True to enable statistics, false to disable.
+      /// \param[in] _cb Callback that is triggered with the statistics.
+      /// \param[in] _period Minimum time between two calls of the callback,
+      /// at least a millisecond.
+      public: void EnableStats(const std::string &_topic, bool _enable,
+                  std::function<void(const TopicStatistics &_stats)> _cb,
+                  const std::chrono::nanoseconds &_period);
+
       /// \brief Get the current statistics for a topic. Statistics must
       /// have been enabled using the EnableStatistics function, otherwise
       /// the return value will be std::nullopt.
@@ -285,9 +520,23 @@ namespace ignition
       public: std::optional<TopicStatistics> TopicStats(
                   const std::string &_topic) const;
 
+      /// \brief Get the metrics of the transport internals of this process,
+      /// in the Prometheus text exposition format. They include the messages
+      /// and bytes sent and received per topic, the depth of the local
+      /// publication queue, the execution times of the callbacks of each
+      /// handler (if IGN_TRANSPORT_CALLBACK_TRACING is set) and the discovery
+      /// traffic. The same metrics are published on the
+      /// topic set with IGN_TRANSPORT_METRICS_TOPIC, if any.
+      /// \return The metrics.
+      public: std::string MetricsText() const;
+
       /// \brief Constructor.
       protected: NodeShared();
 
+      /// \brief Constructor of the instance of a transport context.
+      /// \param[in] _context Name of the context, see Instance().
+      protected: explicit NodeShared(const std::string &_context);
+
       /// \brief Destructor.
       protected: virtual ~NodeShared();
 
@@ -296,6 +545,101 @@ namespace ignition
       /// return false if any operation on a ZMQ socket triggered an exception.
       private: bool InitializeSockets();
 
+      /// \brief Create the sockets and start the discovery of the services,
+      /// unless it is already done. Processes that only publish and
+      /// subscribe never call it, so they don't pay for the sockets, the
+      /// file descriptors and the threads of the services.
+      /// \return True if the services are ready or false otherwise, e.g. if
+      /// any operation on a ZMQ socket triggered an exception.
+      private: bool InitializeServices();
+
+      /// \brief Declare a partition used by a node of the process, so the
+      /// discovery can discard the traffic of the other partitions.
+      /// \param[in] _partition The partition. \sa NodeOptions::Partition.
+      private: void AddPartition(const std::string &_partition);
+
+      /// \brief Handle the loss of a connection of the subscriber socket,
+      /// reported by its monitor: the socket stops reconnecting, and the
+      /// discovery removes the publishers of the process at once.
+      /// \param[in] _endpoint The endpoint of the connection.
+      private: void OnDataDisconnection(const std::string &_endpoint);
+
+      /// \brief Deliver a message received from a remote publisher to the
+      /// local subscribers, after updating the statistics of the topic and
+      /// dropping the copies already delivered.
+      /// \param[in,out] _msg The message. Its payload is moved.
+      private: void DeliverMsg(ReceivedMessage &_msg);
+
+      /// \brief Receive the topics of the control traffic class, until the
+      /// process exits. \sa TrafficClass_t::CONTROL.
+      private: void RunControlReceptionTask();
+
+      /// \brief Send the last message of the latched publishers of a topic
+      /// to its remote subscribers, with their original sequence numbers.
+      /// Must be called with the mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      private: void SendLatched(const std::string &_topic);
+
+      /// \brief Send the copies of the latched messages that are due, see
+      /// NodeSharedPrivate::ScheduleLatchedResends().
+      private: void SendPendingLatched();
+
+      /// \brief Stop waiting for the responses of the service requests
+      /// whose deadline passed, and forget their handlers. Must be called
+      /// with srvMutex locked.
+      /// \param[in] _now Current time.
+      private: void ExpireRequests(
+                   const std::chrono::steady_clock::time_point &_now);
+
+      /// \brief Choose how this process receives a topic after a change in
+      /// its subscribers or publishers. When all the subscribers are
+      /// throttled and all the publishers can limit the rate, the topic is
+      /// received at the fastest rate of the subscribers with a filter of
+      /// its own. The publishers are told about the new rate. Must be called
+      /// with the mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \sa AdvertiseMessageOptions::SetSubscriberMsgsPerSec
+      private: void UpdateSubscriberRate(const std::string &_topic);
+
+      /// \brief Register the nodes of this process subscribed to a topic
+      /// with all the publishers that we are connected to. Must be called
+      /// with the mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _stats Whether the nodes collect statistics.
+      private: void RegisterWithPublishers(const std::string &_topic,
+                                           const bool _stats);
+
+      /// \brief Subscribe a node to all the topics under a prefix. The
+      /// prefix gets one filter in the subscriber sockets, and the handler
+      /// is attached to each topic under it as its publishers are found.
+      /// Must be called with the mutex locked.
+      /// \param[in] _prefix Fully qualified prefix.
+      /// \param[in] _nUuid UUID of the node.
+      /// \param[in] _handler Callback of the node.
+      /// \sa Node::SubscribeRawPrefix
+      private: void AddPrefixSubscription(const std::string &_prefix,
+                   const std::string &_nUuid,
+                   const RawSubscriptionHandlerPtr &_handler);
+
+      /// \brief Remove the subscriptions of a node to a prefix, and its
+      /// handlers from the topics under it. Must be called with the mutex
+      /// locked.
+      /// \param[in] _prefix Fully qualified prefix.
+      /// \param[in] _nUuid UUID of the node.
+      /// \return True if the node was subscribed to the prefix.
+      private: bool RemovePrefixSubscription(const std::string &_prefix,
+                                             const std::string &_nUuid);
+
+      /// \brief Attach the handlers of the prefix subscriptions that match a
+      /// topic to its local subscribers. It's harmless to call it again for
+      /// the same topic. Must be called with the mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _nUuid Only attach the handlers of this node, or the ones
+      /// of all the nodes if empty.
+      /// \return True if at least one handler matches the topic.
+      private: bool AttachPrefixHandlers(const std::string &_topic,
+                                         const std::string &_nUuid = "");
+
       //////////////////////////////////////////////////
       /////// Declare here other member variables //////
       //////////////////////////////////////////////////
@@ -318,9 +662,17 @@ namespace ignition
       /// \brief thread in charge of receiving and handling incoming messages.
       public: std::thread threadReception;
 
-      /// \brief Mutex to guarantee exclusive access between all threads.
+      /// \brief Mutex protecting the topics: the local subscribers, the
+      /// publishers, the topic sockets and their connections.
       public: mutable std::recursive_mutex mutex;
 
+      /// \brief Mutex protecting the services: the repliers, the pending
+      /// and in flight requests, the service sockets and their connections.
+      /// It's independent from the mutex of the topics, so the service calls
+      /// don't wait for the publications. A thread holding it may lock the
+      /// mutex of the topics, never the other way around.
+      public: mutable std::recursive_mutex srvMutex;
+
       /// \brief Default IP address used by the message discovery layer.
       public: std::string discoveryIP = "239.255.0.7";
 
@@ -339,9 +691,6 @@ namespace ignition
       /// \brief Remote connections for pub/sub messages.
       private: TopicStorage<MessagePublisher> connections;
 
-      /// \brief List of connected zmq end points for request/response.
-      private: std::vector<std::string> srvConnections;
-
       /// \brief Remote subscribers.
       public: TopicStorage<MessagePublisher> remoteSubscribers;
 #ifdef _WIN32
@@ -394,6 +743,24 @@ namespace ignition
             const std::string &_fullyQualifiedTopic,
             const std::string &_nUuid);
 
+        /// \brief Returns true if a subscriber of a node to a topic asks for
+        /// best effort delivery.
+        /// \param[in] _fullyQualifiedTopic Fully-qualified topic name.
+        /// \param[in] _nUuid The UUID of the node.
+        /// \return True if the node wants the topic as datagrams.
+        /// \sa SubscribeOptions::SetBestEffort
+        public: bool BestEffort(
+            const std::string &_fullyQualifiedTopic,
+            const std::string &_nUuid) const;
+
+        /// \brief Get the rate at which the subscribers of this process
+        /// want the messages of a topic, i.e. the fastest one.
+        /// \param[in] _fullyQualifiedTopic Fully-qualified topic name.
+        /// \return The rate in messages per second or kUnthrottled.
+        /// \sa SubscribeOptions::SetMsgsPerSec
+        public: uint64_t MsgsPerSec(
+            const std::string &_fullyQualifiedTopic) const;
+
         /// \brief Normal local subscriptions.
         public: HandlerStorage<ISubscriptionHandler> normal;
 
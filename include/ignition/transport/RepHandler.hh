@@ -30,13 +30,20 @@
 #include <google/protobuf/stubs/casts.h>
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <string>
 
+#include "ignition/transport/CallbackTrace.hh"
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
+#include "ignition/transport/ServiceCompletion.hh"
+#include "ignition/transport/ServiceStream.hh"
 #include "ignition/transport/TransportTypes.hh"
 #include "ignition/transport/Uuid.hh"
 
@@ -76,6 +83,60 @@ namespace ignition
       public: virtual bool RunCallback(const std::string &_req,
                                        std::string &_rep) = 0;
 
+      /// \brief Executes the callback registered for this handler and calls
+      /// a function with the response when it's available. The function can
+      /// be called after returning, from any thread, if the handler is
+      /// asynchronous.
+      /// \param[in] _req Serialized data received.
+      /// \param[in] _done Function called once with the serialized response
+      /// and the service call result.
+      /// \sa Asynchronous
+      public: virtual void RunCallbackAsync(const std::string &_req,
+        const std::function<void(const std::string &_rep,
+                                 const bool _result)> &_done)
+      {
+        std::string rep;
+        bool result = this->RunCallback(_req, rep);
+        _done(rep, result);
+      }
+
+      /// \brief Check if the callback of this handler completes the service
+      /// calls asynchronously.
+      /// \return True if the response can be available after the callback
+      /// returns.
+      public: virtual bool Asynchronous() const
+      {
+        return false;
+      }
+
+      /// \brief Executes the callback registered for this handler for a
+      /// request that accepts a stream of responses. Handlers that aren't
+      /// streaming send a stream with their only response.
+      /// \param[in] _req Serialized data received.
+      /// \param[in] _write Function called with each serialized response. It
+      /// returns false if the response can't be sent.
+      /// \param[in] _close Function called once to end the stream, with the
+      /// service call result.
+      /// \sa Streaming
+      public: virtual void RunStreamCallback(const std::string &_req,
+        const std::function<bool(const std::string &_rep)> &_write,
+        const std::function<void(const bool _result)> &_close)
+      {
+        this->RunCallbackAsync(_req,
+          [_write, _close](const std::string &_rep, const bool _result)
+          {
+            _close(_result && _write(_rep));
+          });
+      }
+
+      /// \brief Check if the callback of this handler sends a stream of
+      /// responses.
+      /// \return True if the handler is streaming.
+      public: virtual bool Streaming() const
+      {
+        return false;
+      }
+
       /// \brief Get the unique UUID of this handler.
       /// \return a string representation of the handler UUID.
       public: std::string HandlerUuid() const
@@ -91,6 +152,51 @@ namespace ignition
       /// \return Message type name.
       public: virtual std::string RepTypeName() const = 0;
 
+      /// \brief Get the maximum number of calls from other processes that can
+      /// run at the same time.
+      /// \return The maximum number of calls. 0 means that the calls run in
+      /// the reception thread.
+      /// \sa AdvertiseServiceOptions::MaxConcurrentCalls
+      public: uint32_t MaxConcurrentCalls() const
+      {
+        return this->maxConcurrentCalls;
+      }
+
+      /// \brief Set the maximum number of calls from other processes that can
+      /// run at the same time.
+      /// \param[in] _maxCalls The maximum number of calls.
+      /// \sa AdvertiseServiceOptions::SetMaxConcurrentCalls
+      public: void SetMaxConcurrentCalls(const uint32_t _maxCalls)
+      {
+        this->maxConcurrentCalls = _maxCalls;
+      }
+
+      /// \brief Get the time during which the responses to the calls from
+      /// other processes are cached.
+      /// \return The time to live, 0 if the responses aren't cached.
+      /// \sa AdvertiseServiceOptions::ReplyCacheTtl
+      public: std::chrono::nanoseconds ReplyCacheTtl() const
+      {
+        return this->replyCacheTtl;
+      }
+
+      /// \brief Set the time during which the responses to the calls from
+      /// other processes are cached.
+      /// \param[in] _ttl The time to live.
+      /// \sa AdvertiseServiceOptions::SetReplyCacheTtl
+      public: void SetReplyCacheTtl(const std::chrono::nanoseconds &_ttl)
+      {
+        this->replyCacheTtl = _ttl;
+      }
+
+      /// \brief Get the execution times of the callbacks of this handler for
+      /// calls from other processes. This is used for the transport metrics.
+      /// \return The execution times.
+      public: CallbackTrace &Trace() const
+      {
+        return this->trace;
+      }
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::string
@@ -102,6 +208,15 @@ namespace ignition
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
+
+      /// \brief Maximum number of calls running at the same time.
+      private: uint32_t maxConcurrentCalls = 0;
+
+      /// \brief Time to live of the cached responses.
+      private: std::chrono::nanoseconds replyCacheTtl{0};
+
+      /// \brief Execution times of the callbacks.
+      private: mutable CallbackTrace trace;
     };
 
     /// \class RepHandler RepHandler.hh
@@ -188,13 +303,13 @@ namespace ignition
       // Documentation inherited.
       public: virtual std::string ReqTypeName() const
       {
-        return Req().GetTypeName();
+        return this->reqTypeName;
       }
 
       // Documentation inherited.
       public: virtual std::string RepTypeName() const
       {
-        return Rep().GetTypeName();
+        return this->repTypeName;
       }
 
       /// \brief Create a specific protobuf message given its serialized data.
@@ -217,6 +332,317 @@ namespace ignition
 
       /// \brief Callback to the function registered for this handler.
       private: std::function<bool(const Req &, Rep &)> cb;
+
+      /// \brief Message type name of the request. Looked up on every call,
+      /// so it's only built once.
+      private: const std::string reqTypeName = Req().GetTypeName();
+
+      /// \brief Message type name of the response.
+      private: const std::string repTypeName = Rep().GetTypeName();
+    };
+
+    /// \class AsyncRepHandler RepHandler.hh
+    /// \brief A service reply handler whose callback receives a completion
+    /// handle instead of filling the response. The response is sent when the
+    /// handle is completed, which can happen after the callback returns and
+    /// from any thread. 'Req' is the protobuf message type containing the
+    /// input parameters of the service call. 'Rep' is the protobuf message
+    /// type of the service response.
+    template <typename Req, typename Rep> class AsyncRepHandler
+      : public IRepHandler
+    {
+      // Documentation inherited.
+      public: AsyncRepHandler() = default;
+
+      /// \brief Set the callback for this handler.
+      /// \param[in] _cb The callback with the following parameters:
+      /// \param[in] _req Protobuf message containing the service request params
+      /// \param[in] _completion Handle used to send the response.
+      public: void SetCallback(const std::function<void(const Req &,
+        const ServiceCompletion<Rep> &)> &_cb)
+      {
+        this->cb = _cb;
+      }
+
+      /// \brief Executes the local callback registered for this handler. The
+      /// calling thread is blocked until the call is completed, so the
+      /// completion must not depend on it.
+      /// \param[in] _msgReq Input parameter (Protobuf message).
+      /// \param[out] _msgRep Output parameter (Protobuf message).
+      /// \return Service call result.
+      public: bool RunLocalCallback(const transport::ProtoMsg &_msgReq,
+                                    transport::ProtoMsg &_msgRep)
+      {
+        // Execute the callback (if existing)
+        if (!this->cb)
+        {
+          std::cerr << "AsyncRepHandler::RunLocalCallback() error: "
+                    << "Callback is NULL" << std::endl;
+          return false;
+        }
+
+#if GOOGLE_PROTOBUF_VERSION > 2999999
+        auto msgReq = google::protobuf::down_cast<const Req*>(&_msgReq);
+        auto msgRep = google::protobuf::down_cast<Rep*>(&_msgRep);
+#else
+        auto msgReq =
+          google::protobuf::internal::down_cast<const Req*>(&_msgReq);
+        auto msgRep = google::protobuf::internal::down_cast<Rep*>(&_msgRep);
+#endif
+
+        auto promise = std::make_shared<std::promise<bool>>();
+        std::future<bool> future = promise->get_future();
+        this->cb(*msgReq, ServiceCompletion<Rep>(
+          [promise, msgRep](const Rep &_rep, const bool _result)
+          {
+            if (_result)
+              msgRep->CopyFrom(_rep);
+            promise->set_value(_result);
+          }));
+
+        return future.get();
+      }
+
+      // Documentation inherited.
+      public: bool RunCallback(const std::string &_req,
+                               std::string &_rep)
+      {
+        std::promise<bool> promise;
+        std::future<bool> future = promise.get_future();
+        this->RunCallbackAsync(_req,
+          [&promise, &_rep](const std::string &_data, const bool _result)
+          {
+            _rep = _data;
+            promise.set_value(_result);
+          });
+
+        return future.get();
+      }
+
+      // Documentation inherited.
+      public: void RunCallbackAsync(const std::string &_req,
+        const std::function<void(const std::string &_rep,
+                                 const bool _result)> &_done)
+      {
+        // Check if we have a callback registered.
+        if (!this->cb)
+        {
+          std::cerr << "AsyncRepHandler::RunCallbackAsync() error: "
+                    << "Callback is NULL" << std::endl;
+          _done("", false);
+          return;
+        }
+
+        // Instantiate the specific protobuf message associated to this topic.
+        auto msgReq = std::make_shared<Req>();
+        if (!msgReq->ParseFromString(_req))
+        {
+          std::cerr << "AsyncRepHandler::RunCallbackAsync() error: "
+                    << "ParseFromString failed" << std::endl;
+        }
+
+        this->cb(*msgReq, ServiceCompletion<Rep>(
+          [_done](const Rep &_rep, const bool _result)
+          {
+            if (!_result)
+            {
+              _done("", false);
+              return;
+            }
+
+            std::string data;
+            if (!_rep.SerializeToString(&data))
+            {
+              std::cerr << "AsyncRepHandler: Error serializing the response"
+                        << std::endl;
+              _done("", false);
+              return;
+            }
+
+            _done(data, true);
+          }));
+      }
+
+      // Documentation inherited.
+      public: bool Asynchronous() const
+      {
+        return true;
+      }
+
+      // Documentation inherited.
+      public: virtual std::string ReqTypeName() const
+      {
+        return this->reqTypeName;
+      }
+
+      // Documentation inherited.
+      public: virtual std::string RepTypeName() const
+      {
+        return this->repTypeName;
+      }
+
+      /// \brief Callback to the function registered for this handler.
+      private: std::function<void(const Req &,
+        const ServiceCompletion<Rep> &)> cb;
+
+      /// \brief Message type name of the request. Looked up on every call,
+      /// so it's only built once.
+      private: const std::string reqTypeName = Req().GetTypeName();
+
+      /// \brief Message type name of the response.
+      private: const std::string repTypeName = Rep().GetTypeName();
+    };
+
+    /// \class StreamRepHandler RepHandler.hh
+    /// \brief A service reply handler whose callback sends a sequence of
+    /// responses through a stream handle. Requests that don't accept a stream
+    /// only receive the first response. 'Req' is the protobuf message type
+    /// containing the input parameters of the service call. 'Rep' is the
+    /// protobuf message type of the responses.
+    template <typename Req, typename Rep> class StreamRepHandler
+      : public IRepHandler
+    {
+      // Documentation inherited.
+      public: StreamRepHandler() = default;
+
+      /// \brief Set the callback for this handler.
+      /// \param[in] _cb The callback with the following parameters:
+      /// \param[in] _req Protobuf message containing the service request params
+      /// \param[in] _stream Handle used to send the responses.
+      public: void SetCallback(const std::function<void(const Req &,
+        const ServiceStream<Rep> &)> &_cb)
+      {
+        this->cb = _cb;
+      }
+
+      /// \brief Executes the local callback registered for this handler, for
+      /// a request that only accepts one response. The calling thread is
+      /// blocked until the stream is closed.
+      /// \param[in] _msgReq Input parameter (Protobuf message).
+      /// \param[out] _msgRep Output parameter (Protobuf message).
+      /// \return Service call result.
+      public: bool RunLocalCallback(const transport::ProtoMsg &_msgReq,
+                                    transport::ProtoMsg &_msgRep)
+      {
+        std::string req;
+        std::string rep;
+        if (!_msgReq.SerializeToString(&req) || !this->RunCallback(req, rep))
+          return false;
+
+        return _msgRep.ParseFromString(rep);
+      }
+
+      // Documentation inherited.
+      public: bool RunCallback(const std::string &_req,
+                               std::string &_rep)
+      {
+        std::promise<bool> promise;
+        std::future<bool> future = promise.get_future();
+        this->RunCallbackAsync(_req,
+          [&promise, &_rep](const std::string &_data, const bool _result)
+          {
+            _rep = _data;
+            promise.set_value(_result);
+          });
+
+        return future.get();
+      }
+
+      // Documentation inherited.
+      public: void RunCallbackAsync(const std::string &_req,
+        const std::function<void(const std::string &_rep,
+                                 const bool _result)> &_done)
+      {
+        // Only the first response is sent.
+        auto sent = std::make_shared<std::atomic<bool>>(false);
+        this->RunStreamCallback(_req,
+          [sent, _done](const std::string &_rep)
+          {
+            if (sent->exchange(true))
+              return false;
+
+            _done(_rep, true);
+            return true;
+          },
+          [sent, _done](const bool /*_result*/)
+          {
+            if (!sent->exchange(true))
+              _done("", false);
+          });
+      }
+
+      // Documentation inherited.
+      public: void RunStreamCallback(const std::string &_req,
+        const std::function<bool(const std::string &_rep)> &_write,
+        const std::function<void(const bool _result)> &_close)
+      {
+        // Check if we have a callback registered.
+        if (!this->cb)
+        {
+          std::cerr << "StreamRepHandler::RunStreamCallback() error: "
+                    << "Callback is NULL" << std::endl;
+          _close(false);
+          return;
+        }
+
+        // Instantiate the specific protobuf message associated to this topic.
+        auto msgReq = std::make_shared<Req>();
+        if (!msgReq->ParseFromString(_req))
+        {
+          std::cerr << "StreamRepHandler::RunStreamCallback() error: "
+                    << "ParseFromString failed" << std::endl;
+        }
+
+        this->cb(*msgReq, ServiceStream<Rep>(
+          [_write](const Rep &_rep)
+          {
+            std::string data;
+            if (!_rep.SerializeToString(&data))
+            {
+              std::cerr << "StreamRepHandler: Error serializing the response"
+                        << std::endl;
+              return false;
+            }
+
+            return _write(data);
+          },
+          _close));
+      }
+
+      // Documentation inherited.
+      public: bool Asynchronous() const
+      {
+        return true;
+      }
+
+      // Documentation inherited.
+      public: bool Streaming() const
+      {
+        return true;
+      }
+
+      // Documentation inherited.
+      public: virtual std::string ReqTypeName() const
+      {
+        return this->reqTypeName;
+      }
+
+      // Documentation inherited.
+      public: virtual std::string RepTypeName() const
+      {
+        return this->repTypeName;
+      }
+
+      /// \brief Callback to the function registered for this handler.
+      private: std::function<void(const Req &,
+        const ServiceStream<Rep> &)> cb;
+
+      /// \brief Message type name of the request. Looked up on every call,
+      /// so it's only built once.
+      private: const std::string reqTypeName = Req().GetTypeName();
+
+      /// \brief Message type name of the response.
+      private: const std::string repTypeName = Rep().GetTypeName();
     };
     }
   }
@@ -26,7 +26,9 @@
 #pragma warning(pop)
 #endif
 
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -71,6 +73,30 @@ namespace ignition
       public: virtual void NotifyResult(const std::string &_rep,
                                         const bool _result) = 0;
 
+      /// \brief Executes the callback registered for this handler with one
+      /// of the responses of a stream. More responses, or the end of the
+      /// stream, will follow.
+      /// \param[in] _rep Serialized data containing the response.
+      /// \sa StreamWindow
+      public: virtual void NotifyPartial(const std::string &/*_rep*/)
+      {
+      }
+
+      /// \brief Notify the successful end of a stream of responses.
+      /// \sa StreamWindow
+      public: virtual void NotifyStreamEnd()
+      {
+      }
+
+      /// \brief Get the number of responses of a stream that the responder
+      /// can send before they are consumed.
+      /// \return The window size, or 0 if the request only accepts one
+      /// response.
+      public: virtual uint32_t StreamWindow() const
+      {
+        return 0;
+      }
+
       /// \brief Get the node UUID.
       /// \return The string representation of the node UUID.
       public: std::string NodeUuid() const
@@ -106,11 +132,44 @@ namespace ignition
         this->requested = _value;
       }
 
+      /// \brief Set the time that the requester is willing to wait for the
+      /// response. The deadline is sent with the request, so the responder can
+      /// drop the request instead of running it after the requester gave up.
+      /// \param[in] _timeout Maximum waiting time in milliseconds, counted
+      /// from now.
+      public: void SetTimeout(const unsigned int _timeout)
+      {
+        this->deadline = std::chrono::steady_clock::now() +
+          std::chrono::milliseconds(_timeout);
+        this->hasDeadline = true;
+      }
+
+      /// \brief Get the deadline of the service call.
+      /// \param[out] _deadline The deadline, if any.
+      /// \return True if the service call has a deadline.
+      public: bool Deadline(std::chrono::steady_clock::time_point &_deadline)
+        const
+      {
+        if (this->hasDeadline)
+          _deadline = this->deadline;
+        return this->hasDeadline;
+      }
+
       /// \brief Serialize the Req protobuf message stored.
       /// \param[out] _buffer The serialized data.
       /// \return True if the serialization succeed or false otherwise.
       public: virtual bool Serialize(std::string &_buffer) const = 0;
 
+      /// \brief Get the serialized request. The request is serialized only
+      /// once, when its message is set, and the same bytes are used every time
+      /// that it's sent.
+      /// \return The serialized request or nullptr if the request message
+      /// wasn't set or couldn't be serialized.
+      public: const std::string *SerializedRequest() const
+      {
+        return this->reqDataValid ? &this->reqData : nullptr;
+      }
+
       /// \brief Returns the unique handler UUID.
       /// \return The handler's UUID.
       public: std::string HandlerUuid() const
@@ -158,11 +217,17 @@ namespace ignition
       /// \brief Stores the service response as raw bytes.
       protected: std::string rep;
 
+      /// \brief The serialized request.
+      protected: std::string reqData;
+
       /// \brief Unique handler's UUID.
       protected: std::string hUuid;
 
       /// \brief Node UUID.
       private: std::string nUuid;
+
+      /// \brief Deadline of the service call, if hasDeadline is true.
+      private: std::chrono::steady_clock::time_point deadline;
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
@@ -170,6 +235,12 @@ namespace ignition
       /// \brief Stores the result of the service call.
       protected: bool result;
 
+      /// \brief True if reqData contains the serialized request.
+      protected: bool reqDataValid = false;
+
+      /// \brief True if the service call has a deadline.
+      private: bool hasDeadline = false;
+
       /// \brief When true, the REQ was already sent and the REP should be on
       /// its way. Used to not resend the same REQ more than one time.
       private: bool requested;
@@ -234,7 +305,12 @@ namespace ignition
           return;
         }
 
-        this->reqMsg.CopyFrom(*_reqMsg);
+        this->reqDataValid = _reqMsg->SerializeToString(&this->reqData);
+        if (!this->reqDataValid)
+        {
+          std::cerr << "ReqHandler::SetMessage(): Error serializing the "
+                    << "request" << std::endl;
+        }
       }
 
       /// \brief This function is only used for compatibility with
@@ -249,13 +325,14 @@ namespace ignition
       // Documentation inherited
       public: bool Serialize(std::string &_buffer) const
       {
-        if (!this->reqMsg.SerializeToString(&_buffer))
+        if (!this->reqDataValid)
         {
           std::cerr << "ReqHandler::Serialize(): Error serializing the request"
                     << std::endl;
           return false;
         }
 
+        _buffer = this->reqData;
         return true;
       }
 
@@ -283,24 +360,151 @@ namespace ignition
       // Documentation inherited.
       public: virtual std::string ReqTypeName() const
       {
-        return Req().GetTypeName();
+        return this->reqTypeName;
       }
 
       // Documentation inherited.
       public: virtual std::string RepTypeName() const
       {
-        return Rep().GetTypeName();
+        return this->repTypeName;
       }
 
-      /// \brief Protobuf message containing the request's parameters.
-      private: Req reqMsg;
-
       /// \brief Callback to the function registered for this handler with the
       /// following parameters:
       /// \param[in] _rep Protobuf message containing the service response.
       /// \param[in] _result True when the service request was successful or
       /// false otherwise.
       private: std::function<void(const Rep &_rep, const bool _result)> cb;
+
+      /// \brief Message type name of the request. Looked up every time that
+      /// the pending requests are sent, so it's only built once.
+      private: const std::string reqTypeName = Req().GetTypeName();
+
+      /// \brief Message type name of the response.
+      private: const std::string repTypeName = Rep().GetTypeName();
+    };
+
+    /// \class StreamReqHandler ReqHandler.hh
+    /// \brief A request handler that accepts a stream of responses.
+    /// 'Req' is a protobuf message type containing the input parameters of
+    /// the service request. 'Rep' is the protobuf message type of the
+    /// responses.
+    template <typename Req, typename Rep> class StreamReqHandler
+      : public ReqHandler<Req, Rep>
+    {
+      /// \brief Default number of responses that can be in flight.
+      public: static constexpr uint32_t kDefaultWindow = 16;
+
+      // Documentation inherited.
+      public: explicit StreamReqHandler(const std::string &_nUuid)
+        : ReqHandler<Req, Rep>(_nUuid)
+      {
+      }
+
+      /// \brief Set the callbacks for this handler.
+      /// \param[in] _onReply Callback executed with each response.
+      /// \param[in] _onDone Callback executed once at the end of the stream,
+      /// with the service call result.
+      public: void SetCallbacks(
+        const std::function<void(const Rep &_rep)> &_onReply,
+        const std::function<void(const bool _result)> &_onDone)
+      {
+        this->onReply = _onReply;
+        this->onDone = _onDone;
+      }
+
+      // Documentation inherited.
+      public: void NotifyResult(const std::string &_rep, const bool _result)
+      {
+        // Responders that don't stream send a single response.
+        if (_result)
+          this->NotifyPartial(_rep);
+
+        this->Finish(_result);
+      }
+
+      // Documentation inherited.
+      public: void NotifyPartial(const std::string &_rep)
+      {
+        if (this->onReply)
+          this->onReply(*this->CreateMsg(_rep));
+      }
+
+      // Documentation inherited.
+      public: void NotifyStreamEnd()
+      {
+        this->Finish(true);
+      }
+
+      // Documentation inherited.
+      public: uint32_t StreamWindow() const
+      {
+        return kDefaultWindow;
+      }
+
+      /// \brief Notify the end of the stream.
+      /// \param[in] _result The service call result.
+      private: void Finish(const bool _result)
+      {
+        if (this->onDone)
+          this->onDone(_result);
+
+        this->repAvailable = true;
+        this->condition.notify_one();
+      }
+
+      /// \brief Callback executed with each response.
+      private: std::function<void(const Rep &_rep)> onReply;
+
+      /// \brief Callback executed at the end of the stream.
+      private: std::function<void(const bool _result)> onDone;
+    };
+
+    /// \class BatchReqHandler ReqHandler.hh
+    /// \brief A request handler that sends many oneway requests to the same
+    /// service at once. The serialized requests are packed one after the
+    /// other, each one preceded by its size as a uint32_t, and sent with the
+    /// kOnewayBatchType response type. 'Req' is a protobuf message type
+    /// containing the input parameters of each request. 'Rep' is the response
+    /// type of the oneway service, msgs::Empty.
+    template <typename Req, typename Rep> class BatchReqHandler
+      : public ReqHandler<Req, Rep>
+    {
+      // Documentation inherited.
+      public: explicit BatchReqHandler(const std::string &_nUuid)
+        : ReqHandler<Req, Rep>(_nUuid)
+      {
+      }
+
+      /// \brief Append a request to the batch.
+      /// \param[in] _reqMsg Protobuf message containing the input parameters
+      /// of the request.
+      /// \return True if the request was serialized.
+      public: bool AddMessage(const Req &_reqMsg)
+      {
+        if (!_reqMsg.SerializeToString(&this->buffer))
+        {
+          std::cerr << "BatchReqHandler::AddMessage(): Error serializing the "
+                    << "request" << std::endl;
+          return false;
+        }
+
+        const uint32_t size = static_cast<uint32_t>(this->buffer.size());
+        this->reqData.append(reinterpret_cast<const char *>(&size),
+          sizeof(size));
+        this->reqData.append(this->buffer);
+        this->reqDataValid = true;
+        return true;
+      }
+
+      // Documentation inherited.
+      public: virtual std::string RepTypeName() const
+      {
+        return kOnewayBatchType;
+      }
+
+      /// \brief Buffer reused to serialize each request.
+      private: std::string buffer;
     };
 
     /// \class ReqHandler<google::protobuf::Message> ReqHandler.hh
@@ -327,8 +531,14 @@ namespace ignition
           return;
         }
 
+        // Only the type of the message is needed after serializing it.
         this->reqMsg = _reqMsg->New();
-        this->reqMsg->CopyFrom(*_reqMsg);
+        this->reqDataValid = _reqMsg->SerializeToString(&this->reqData);
+        if (!this->reqDataValid)
+        {
+          std::cerr << "ReqHandler::SetMessage(): Error serializing the "
+                    << "request" << std::endl;
+        }
       }
 
       /// \brief Set the REP protobuf message for this handler.
@@ -356,13 +566,14 @@ namespace ignition
           return false;
         }
 
-        if (!this->reqMsg->SerializeToString(&_buffer))
+        if (!this->reqDataValid)
         {
           std::cerr << "ReqHandler::Serialize(): Error serializing the request"
                     << std::endl;
           return false;
         }
 
+        _buffer = this->reqData;
         return true;
       }
 
@@ -402,7 +613,7 @@ namespace ignition
         }
       }
 
-      /// \brief Protobuf message containing the request's parameters.
+      /// \brief Empty protobuf message with the type of the request.
       private: google::protobuf::Message *reqMsg = nullptr;
 
       /// \brief Protobuf message containing the response.
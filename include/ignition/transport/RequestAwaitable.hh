@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_REQUESTAWAITABLE_HH_
+#define IGN_TRANSPORT_REQUESTAWAITABLE_HH_
+
+// Only available when compiling with C++20 coroutines.
+#ifdef __cpp_impl_coroutine
+
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class RequestAwaitable RequestAwaitable.hh
+    /// ignition/transport/RequestAwaitable.hh
+    /// \brief The response of a service call, that can be awaited from a C++20
+    /// coroutine. The result of the co_await expression is the response, or
+    /// std::nullopt if the service call failed. The coroutine is resumed in
+    /// the thread that receives the response, so it should hand heavy work
+    /// over to another thread. Only one coroutine can await the response.
+    /// \tparam ReplyT Protobuf message type of the response.
+    /// \sa Node::RequestAwait
+    template <typename ReplyT>
+    class RequestAwaitable
+    {
+      /// \brief Constructor. Creates a pending response.
+      public: RequestAwaitable()
+        : state(std::make_shared<State>())
+      {
+      }
+
+      /// \brief Get the callback that receives the response. Compatible with
+      /// Node::Request().
+      /// \return The callback.
+      public: std::function<void(const ReplyT &_reply, const bool _result)>
+        Callback() const
+      {
+        std::shared_ptr<State> s = this->state;
+        return [s](const ReplyT &_reply, const bool _result)
+        {
+          s->Set(_result ? std::optional<ReplyT>(_reply) : std::nullopt);
+        };
+      }
+
+      /// \brief Mark the service call as failed, e.g.: because the request
+      /// couldn't be made.
+      public: void Fail() const
+      {
+        this->state->Set(std::nullopt);
+      }
+
+      /// \brief Check if the response is already available.
+      /// \return True if the awaiting coroutine doesn't need to suspend.
+      public: bool await_ready() const
+      {
+        std::lock_guard<std::mutex> lk(this->state->mutex);
+        return this->state->done;
+      }
+
+      /// \brief Suspend the awaiting coroutine until the response arrives.
+      /// \param[in] _handle Handle of the awaiting coroutine.
+      /// \return False if the response arrived meanwhile, in which case the
+      /// coroutine isn't suspended.
+      public: bool await_suspend(std::coroutine_handle<> _handle)
+      {
+        std::lock_guard<std::mutex> lk(this->state->mutex);
+        if (this->state->done)
+          return false;
+
+        this->state->waiter = _handle;
+        return true;
+      }
+
+      /// \brief Get the response.
+      /// \return The response or std::nullopt if the service call failed.
+      public: std::optional<ReplyT> await_resume()
+      {
+        std::lock_guard<std::mutex> lk(this->state->mutex);
+        return std::move(this->state->reply);
+      }
+
+      /// \brief State shared with the callback.
+      private: struct State
+      {
+        /// \brief Store the response and resume the awaiting coroutine.
+        /// Only the first call has effect.
+        /// \param[in] _reply The response or std::nullopt.
+        public: void Set(std::optional<ReplyT> _reply)
+        {
+          std::coroutine_handle<> handle;
+          {
+            std::lock_guard<std::mutex> lk(this->mutex);
+            if (this->done)
+              return;
+
+            this->reply = std::move(_reply);
+            this->done = true;
+            handle = std::exchange(this->waiter, nullptr);
+          }
+
+          if (handle)
+            handle.resume();
+        }
+
+        /// \brief Protects the members below.
+        public: std::mutex mutex;
+
+        /// \brief The response, once available.
+        public: std::optional<ReplyT> reply;
+
+        /// \brief True once the response is available.
+        public: bool done = false;
+
+        /// \brief The awaiting coroutine, if suspended.
+        public: std::coroutine_handle<> waiter;
+      };
+
+      /// \brief Shared state.
+      private: std::shared_ptr<State> state;
+    };
+    }
+  }
+}
+
+#endif
+#endif
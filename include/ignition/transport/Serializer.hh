@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_SERIALIZER_HH_
+#define IGN_TRANSPORT_SERIALIZER_HH_
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/TransportTypes.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \brief Serialization of the messages of type MessageT. Protobuf
+    /// messages are supported out of the box. Other types, e.g. FlatBuffers
+    /// or fixed layout structs, are published and subscribed to like
+    /// protobuf messages once this class is specialized for them, with the
+    /// following static functions:
+    ///
+    /// \code
+    ///   // Name of the type, advertised and matched by the subscribers.
+    ///   static std::string TypeName();
+    ///
+    ///   // Exact size of the serialized message (bytes).
+    ///   static std::size_t ByteSize(const MessageT &_msg);
+    ///
+    ///   // Write ByteSize(_msg) bytes to _data, which holds _size bytes.
+    ///   static bool Serialize(const MessageT &_msg, char *_data,
+    ///                         std::size_t _size);
+    ///
+    ///   // Read a message, returning false if the data isn't valid.
+    ///   static bool Deserialize(const char *_data, std::size_t _size,
+    ///                           MessageT &_msg);
+    /// \endcode
+    ///
+    /// The messages of these types are serialized in a buffer lent by the
+    /// transport, see MessageLoan, and delivered to the subscribers
+    /// through a raw subscription. Services only support protobuf.
+    /// \sa TrivialSerializer
+    template<typename MessageT, typename Enable = void>
+    class Serializer;
+
+    /// \brief Serialization of the protobuf messages.
+    template<typename MessageT>
+    class Serializer<MessageT,
+      std::enable_if_t<std::is_base_of<ProtoMsg, MessageT>::value>>
+    {
+      /// \brief Get the name of the type.
+      /// \return The protobuf type name.
+      public: static std::string TypeName()
+      {
+        return MessageT().GetTypeName();
+      }
+
+      /// \brief Get the size of a serialized message.
+      /// \param[in] _msg The message.
+      /// \return The size (bytes).
+      public: static std::size_t ByteSize(const MessageT &_msg)
+      {
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+        return static_cast<std::size_t>(_msg.ByteSizeLong());
+#else
+        return static_cast<std::size_t>(_msg.ByteSize());
+#endif
+      }
+
+      /// \brief Serialize a message.
+      /// \param[in] _msg The message.
+      /// \param[out] _data The buffer.
+      /// \param[in] _size Size of the buffer (bytes).
+      /// \return True if the message was serialized.
+      public: static bool Serialize(const MessageT &_msg, char *_data,
+                                    const std::size_t _size)
+      {
+        return _msg.SerializeToArray(_data, static_cast<int>(_size));
+      }
+
+      /// \brief Parse a message.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message (bytes).
+      /// \param[out] _msg The message.
+      /// \return True if the message was parsed.
+      public: static bool Deserialize(const char *_data,
+                                      const std::size_t _size,
+                                      MessageT &_msg)
+      {
+        return _msg.ParseFromArray(_data, static_cast<int>(_size));
+      }
+    };
+
+    /// \brief Serialization of trivially copyable structs as their bytes,
+    /// so they are written and read with a single copy, without parsing.
+    /// All the processes must agree on the layout of the struct, i.e. use
+    /// the same definition, compiler ABI and byte order. A specialization
+    /// of Serializer only has to derive from it and name the type:
+    ///
+    /// \code
+    ///   template<>
+    ///   class ignition::transport::Serializer<Imu>
+    ///     : public ignition::transport::TrivialSerializer<Imu>
+    ///   {
+    ///     public: static std::string TypeName() {return "sensors.Imu";}
+    ///   };
+    /// \endcode
+    template<typename MessageT>
+    class TrivialSerializer
+    {
+      static_assert(std::is_trivially_copyable<MessageT>::value,
+        "TrivialSerializer requires a trivially copyable type");
+
+      /// \brief Get the size of a serialized message.
+      /// \return The size of the struct (bytes).
+      public: static std::size_t ByteSize(const MessageT &)
+      {
+        return sizeof(MessageT);
+      }
+
+      /// \brief Serialize a message.
+      /// \param[in] _msg The message.
+      /// \param[out] _data The buffer.
+      /// \param[in] _size Size of the buffer (bytes).
+      /// \return False if the buffer is too small.
+      public: static bool Serialize(const MessageT &_msg, char *_data,
+                                    const std::size_t _size)
+      {
+        if (_size < sizeof(MessageT))
+          return false;
+        std::memcpy(_data, &_msg, sizeof(MessageT));
+        return true;
+      }
+
+      /// \brief Read a message.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message (bytes).
+      /// \param[out] _msg The message.
+      /// \return False if the size isn't the size of the struct.
+      public: static bool Deserialize(const char *_data,
+                                      const std::size_t _size,
+                                      MessageT &_msg)
+      {
+        if (_size != sizeof(MessageT))
+          return false;
+        std::memcpy(&_msg, _data, sizeof(MessageT));
+        return true;
+      }
+    };
+
+    /// \brief Check if a type is serialized by a specialization of
+    /// Serializer other than the one of protobuf.
+    template<typename MessageT, typename Enable = void>
+    struct IsCustomSerialized : std::false_type
+    {
+    };
+
+    /// \brief Check if a type is serialized by a specialization of
+    /// Serializer other than the one of protobuf.
+    template<typename MessageT>
+    struct IsCustomSerialized<MessageT,
+      std::void_t<decltype(Serializer<MessageT>::TypeName())>>
+      : std::integral_constant<bool,
+          !std::is_base_of<ProtoMsg, MessageT>::value>
+    {
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_SERVICECOMPLETION_HH_
+#define IGN_TRANSPORT_SERVICECOMPLETION_HH_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class ServiceCompletion ServiceCompletion.hh
+    /// ignition/transport/ServiceCompletion.hh
+    /// \brief A handle used by an asynchronous service responder to send the
+    /// response of a service call. The responder can keep the handle and
+    /// complete the call later, from any thread. Copies of the handle refer
+    /// to the same call, and only the first completion is sent. If all the
+    /// copies are destroyed without completing the call, a failed response is
+    /// sent, so the requester is never left waiting. This class is thread
+    /// safe.
+    /// \tparam Rep Protobuf message type of the response.
+    template <typename Rep>
+    class ServiceCompletion
+    {
+      /// \brief Default constructor. Creates an empty handle.
+      public: ServiceCompletion() = default;
+
+      /// \brief Constructor.
+      /// \param[in] _done Function sending the response.
+      public: explicit ServiceCompletion(
+        std::function<void(const Rep &_rep, const bool _result)> _done)
+        : state(std::make_shared<State>(std::move(_done)))
+      {
+      }
+
+      /// \brief Check if the handle refers to a service call.
+      /// \return True if not empty.
+      public: bool Valid() const
+      {
+        return this->state != nullptr;
+      }
+
+      /// \brief Check if the service call has been completed.
+      /// \return True if the call was completed or the handle is empty.
+      public: bool Completed() const
+      {
+        return !this->state || this->state->completed.load();
+      }
+
+      /// \brief Send the response of the service call.
+      /// \param[in] _rep The response.
+      /// \param[in] _result True when the service call was successful or
+      /// false otherwise. The response is ignored when false.
+      /// \return True if the response was sent or false if the call had
+      /// already been completed or the handle is empty.
+      public: bool Complete(const Rep &_rep, const bool _result = true) const
+      {
+        if (!this->state || this->state->completed.exchange(true))
+          return false;
+
+        this->state->done(_rep, _result);
+        return true;
+      }
+
+      /// \brief Shared state of the copies of a handle.
+      private: struct State
+      {
+        /// \brief Constructor.
+        /// \param[in] _done Function sending the response.
+        public: explicit State(
+          std::function<void(const Rep &_rep, const bool _result)> _done)
+          : done(std::move(_done))
+        {
+        }
+
+        /// \brief Destructor. Fails the call if it wasn't completed.
+        public: ~State()
+        {
+          if (!this->completed.exchange(true) && this->done)
+            this->done(Rep(), false);
+        }
+
+        /// \brief Function sending the response.
+        public: std::function<void(const Rep &_rep, const bool _result)> done;
+
+        /// \brief True once the call has been completed.
+        public: std::atomic<bool> completed{false};
+      };
+
+      /// \brief Shared state, or nullptr if the handle is empty.
+      private: std::shared_ptr<State> state;
+    };
+    }
+  }
+}
+#endif
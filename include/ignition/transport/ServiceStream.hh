@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_SERVICESTREAM_HH_
+#define IGN_TRANSPORT_SERVICESTREAM_HH_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class ServiceStream ServiceStream.hh
+    /// ignition/transport/ServiceStream.hh
+    /// \brief A handle used by a streaming service responder to send a
+    /// sequence of responses to a single service call. Write() blocks while
+    /// the requester is behind, so a fast responder can't flood a slow
+    /// requester. The stream ends when it's closed. Copies of the handle
+    /// refer to the same stream. If all the copies are destroyed without
+    /// closing the stream, it's closed as failed. This class is thread safe.
+    /// \tparam Rep Protobuf message type of the responses.
+    template <typename Rep>
+    class ServiceStream
+    {
+      /// \brief Default constructor. Creates an empty handle.
+      public: ServiceStream() = default;
+
+      /// \brief Constructor.
+      /// \param[in] _write Function sending a response. It returns false if
+      /// the response can't be sent.
+      /// \param[in] _close Function ending the stream.
+      public: ServiceStream(std::function<bool(const Rep &_rep)> _write,
+                            std::function<void(const bool _result)> _close)
+        : state(std::make_shared<State>(std::move(_write), std::move(_close)))
+      {
+      }
+
+      /// \brief Check if the handle refers to a stream.
+      /// \return True if not empty.
+      public: bool Valid() const
+      {
+        return this->state != nullptr;
+      }
+
+      /// \brief Check if the stream has been closed.
+      /// \return True if the stream was closed or the handle is empty.
+      public: bool Closed() const
+      {
+        return !this->state || this->state->closed.load();
+      }
+
+      /// \brief Send the next response of the stream. Blocks while the
+      /// requester hasn't consumed the previous responses.
+      /// \param[in] _rep The response.
+      /// \return True if the response was sent or false if the stream is
+      /// closed, the requester doesn't accept more responses or it stopped
+      /// consuming them. The stream should be closed when false.
+      public: bool Write(const Rep &_rep) const
+      {
+        if (this->Closed())
+          return false;
+
+        return this->state->write(_rep);
+      }
+
+      /// \brief End the stream.
+      /// \param[in] _result True when the service call was successful or
+      /// false otherwise.
+      /// \return True if the stream was closed or false if it had already
+      /// been closed or the handle is empty.
+      public: bool Close(const bool _result = true) const
+      {
+        if (!this->state || this->state->closed.exchange(true))
+          return false;
+
+        this->state->close(_result);
+        return true;
+      }
+
+      /// \brief Shared state of the copies of a handle.
+      private: struct State
+      {
+        /// \brief Constructor.
+        /// \param[in] _write Function sending a response.
+        /// \param[in] _close Function ending the stream.
+        public: State(std::function<bool(const Rep &_rep)> _write,
+                      std::function<void(const bool _result)> _close)
+          : write(std::move(_write)), close(std::move(_close))
+        {
+        }
+
+        /// \brief Destructor. Fails the stream if it wasn't closed.
+        public: ~State()
+        {
+          if (!this->closed.exchange(true) && this->close)
+            this->close(false);
+        }
+
+        /// \brief Function sending a response.
+        public: std::function<bool(const Rep &_rep)> write;
+
+        /// \brief Function ending the stream.
+        public: std::function<void(const bool _result)> close;
+
+        /// \brief True once the stream has been closed.
+        public: std::atomic<bool> closed{false};
+      };
+
+      /// \brief Shared state, or nullptr if the handle is empty.
+      private: std::shared_ptr<State> state;
+    };
+    }
+  }
+}
+#endif
@@ -18,11 +18,16 @@
 #ifndef IGN_TRANSPORT_SUBSCRIBEOPTIONS_HH_
 #define IGN_TRANSPORT_SUBSCRIBEOPTIONS_HH_
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
+#include "ignition/transport/MessageInfo.hh"
 
 namespace ignition
 {
@@ -33,6 +38,25 @@ namespace ignition
     //
     class SubscribeOptionsPrivate;
 
+    /// \def MessageFilter
+    /// \brief Predicate evaluated on a message before it's deserialized:
+    /// \param[in] _msgData The serialized message.
+    /// \param[in] _size Number of bytes in the serialized message.
+    /// \param[in] _info Message information (e.g.: topic and type).
+    /// \return True to deliver the message or false to discard it.
+    using MessageFilter =
+        std::function<bool(const char *_msgData, const size_t _size,
+                           const MessageInfo &_info)>;
+
+    /// \def MessageProgressCallback
+    /// \brief Callback following the reception of a fragmented message:
+    /// \param[in] _info Message information (e.g.: topic and type).
+    /// \param[in] _received Number of bytes received so far.
+    /// \param[in] _total Number of bytes of the whole message.
+    using MessageProgressCallback =
+        std::function<void(const MessageInfo &_info, const uint64_t _received,
+                           const uint64_t _total)>;
+
     /// \class SubscribeOptions SubscribeOptions.hh
     /// ignition/transport/SubscribeOptions.hh
     /// \brief A class to provide different options for a subscription.
@@ -66,6 +90,132 @@ namespace ignition
       /// \return The maximum number of messages per second.
       public: uint64_t MsgsPerSec() const;
 
+      /// \brief Set the maximum number of received messages that can wait for
+      /// the callback of this subscription, with "keep last" semantics: when a
+      /// new message arrives and the queue is full, the oldest message waiting
+      /// is discarded. Messages are delivered in order and the callback is
+      /// never executed concurrently with itself. A subscriber that falls
+      /// behind jumps straight to the freshest messages instead of working
+      /// through a backlog of stale ones.
+      ///
+      /// When set, the callback runs in a transport thread shared by all the
+      /// queued subscriptions instead of the thread that received the message.
+      /// \param[in] _size Maximum number of queued messages. The default
+      /// value, 0, disables the queue: every message is delivered.
+      public: void SetQueueSize(const uint64_t _size);
+
+      /// \brief Get the maximum number of received messages that can wait for
+      /// the callback of this subscription.
+      /// \return The queue size. 0 means that the queue is disabled.
+      /// \sa SetQueueSize
+      public: uint64_t QueueSize() const;
+
+      /// \brief Set a filter for the messages of this subscription. The
+      /// filter receives the serialized message and its information before
+      /// the message is deserialized and the callback is executed, so the
+      /// messages discarded don't pay the parsing cost. The filter runs in the
+      /// thread that delivers the message and must be thread safe.
+      ///
+      /// Messages published from the same process are serialized once to be
+      /// evaluated by the filters.
+      /// \param[in] _filter The filter. An empty function, the default,
+      /// accepts all the messages.
+      public: void SetFilter(const MessageFilter &_filter);
+
+      /// \brief Get the filter of this subscription.
+      /// \return The filter. Empty if all the messages are accepted.
+      /// \sa SetFilter
+      public: const MessageFilter &Filter() const;
+
+      /// \brief Set a callback following the reception of the messages
+      /// that the remote publishers send in fragments, see
+      /// AdvertiseMessageOptions::SetFragmentSize(). It's called after each
+      /// fragment, the last time with _received equal to _total, right
+      /// before the message is deserialized and the subscription callback
+      /// executed. It runs in the thread that receives the messages, so it
+      /// must be thread safe and return quickly.
+      /// \param[in] _cb The callback. An empty function, the default,
+      /// disables the reports.
+      public: void SetProgressCallback(const MessageProgressCallback &_cb);
+
+      /// \brief Get the progress callback of this subscription.
+      /// \return The callback. Empty if the progress isn't reported.
+      /// \sa SetProgressCallback
+      public: const MessageProgressCallback &ProgressCallback() const;
+
+      /// \brief Receive the messages as best effort datagrams from the
+      /// publishers that offer it, see
+      /// AdvertiseMessageOptions::SetBestEffort(). The messages lost or
+      /// arriving after a newer one are dropped instead of delaying the next
+      /// ones, which suits topics where only the latest value matters. The
+      /// topic is received over TCP from the other publishers.
+      ///
+      /// The choice is made per node: when the subscriptions of a process to
+      /// a topic mix both kinds, the messages received over TCP behind a
+      /// newer datagram are dropped as well.
+      /// \param[in] _bestEffort True to ask for best effort delivery. The
+      /// default value is false.
+      public: void SetBestEffort(const bool _bestEffort);
+
+      /// \brief Whether this subscription asks for best effort delivery.
+      /// \return True if best effort delivery is requested.
+      /// \sa SetBestEffort
+      public: bool BestEffort() const;
+
+      /// \brief Set the callback group of this subscription. The callbacks
+      /// of the subscriptions in the same group, from any node of the
+      /// process, run one at a time, in the order in which the messages are
+      /// received, so they can share data without locking it. The callbacks
+      /// of different groups run concurrently in a pool of transport
+      /// threads instead of the thread that received the message.
+      ///
+      /// The queue size, if any, still applies to each subscription: a
+      /// subscription with a full queue doesn't discard the messages of the
+      /// rest of its group.
+      /// \param[in] _group Name of the group. The default value, an empty
+      /// name, runs the callback in the thread that receives the message.
+      public: void SetCallbackGroup(const std::string &_group);
+
+      /// \brief Get the callback group of this subscription.
+      /// \return Name of the group, or empty if the subscription isn't in a
+      /// group.
+      /// \sa SetCallbackGroup
+      public: const std::string &CallbackGroup() const;
+
+      /// \brief Run the callback directly in the thread that publishes the
+      /// messages of the same process, inside Node::Publisher::Publish(),
+      /// instead of handing them to the transport thread that dispatches
+      /// the local messages. This saves a queue, a wake up and a context
+      /// switch per message, e.g. in a chain of callbacks that publish. The
+      /// publisher is blocked until the callback returns, and its local
+      /// queue depth doesn't apply to this subscription. The messages
+      /// received from other processes are not affected. Ignored if the
+      /// subscription has a queue size or a callback group.
+      /// \param[in] _inline True to run the callback in the publishing
+      /// thread. The default value is false.
+      public: void SetInlineDelivery(const bool _inline);
+
+      /// \brief Whether the callback runs in the publishing thread.
+      /// \return True if the local messages are delivered inline.
+      /// \sa SetInlineDelivery
+      public: bool InlineDelivery() const;
+
+      /// \brief Set the lifespan of the messages. A message older than its
+      /// lifespan when it's about to be delivered, e.g.: because the
+      /// subscriber fell behind, is discarded before being parsed, and
+      /// counted as dropped. The age is measured from the publication time
+      /// of the message, see MessageInfo::SendSystemTime(), so the clocks
+      /// of the hosts must be synchronized. The messages of older
+      /// publishers, without a publication time, never expire.
+      /// \param[in] _lifespan The lifespan. A value of zero, the default,
+      /// disables it. Negative values are set to zero.
+      public: void SetLifespan(const std::chrono::nanoseconds &_lifespan);
+
+      /// \brief Get the lifespan of the messages.
+      /// \return The lifespan, zero if the messages don't expire.
+      /// \sa SetLifespan
+      public: std::chrono::nanoseconds Lifespan() const;
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
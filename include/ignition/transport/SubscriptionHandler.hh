@@ -32,14 +32,17 @@
 #include <google/protobuf/stubs/casts.h>
 #endif
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
 
 #include <ignition/msgs/Factory.hh>
 
+#include "ignition/transport/CallbackTrace.hh"
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Export.hh"
 #include "ignition/transport/MessageInfo.hh"
@@ -81,11 +84,121 @@ namespace ignition
       /// \return A string representation of the handler UUID.
       public: std::string HandlerUuid() const;
 
+      /// \brief Get the size of the keep last queue of this handler.
+      /// \return The queue size or 0 if the messages are not queued.
+      /// \sa SubscribeOptions::SetQueueSize
+      public: uint64_t QueueSize() const;
+
+      /// \brief Check if the callbacks of this handler are dispatched to
+      /// the pool of transport threads, because they have a keep last queue
+      /// or a callback group.
+      /// \return True if the callbacks don't run in the receiving thread.
+      public: bool Deferred() const;
+
+      /// \brief Check if the local messages are delivered to this handler
+      /// in the publishing thread.
+      /// \return True if inline delivery was requested and the callbacks
+      /// aren't deferred.
+      /// \sa SubscribeOptions::SetInlineDelivery
+      public: bool Inline() const;
+
+      /// \brief Get the key that serializes the callbacks of this handler in
+      /// the executors: its callback group, or its UUID if it has none.
+      /// \return The key.
+      /// \sa SubscribeOptions::SetCallbackGroup
+      public: std::string ExecutorKey() const;
+
+      /// \brief Check if this handler asks for best effort delivery.
+      /// \return True if the messages can be received as datagrams.
+      /// \sa SubscribeOptions::SetBestEffort
+      public: bool BestEffort() const;
+
+      /// \brief Get the maximum rate at which this handler wants messages.
+      /// \return The rate in messages per second or kUnthrottled.
+      /// \sa SubscribeOptions::SetMsgsPerSec
+      public: uint64_t MsgsPerSec() const;
+
+      /// \brief Check if this handler accepts messages of a given type. The
+      /// type name of the handler is cached, so no string is created.
+      /// \param[in] _type Message type name.
+      /// \return True if the handler is generic or the types match.
+      public: bool AcceptsType(const std::string &_type) const;
+
+      /// \brief Check if this handler accepts a message. Typed handlers
+      /// compare the message descriptor with theirs, which is a pointer
+      /// comparison for messages of generated classes.
+      /// \param[in] _msg The message.
+      /// \return True if the handler is generic or the types match.
+      public: bool Accepts(const ProtoMsg &_msg) const;
+
+      /// \brief Check if this handler has a message filter.
+      /// \return True if the handler has a filter.
+      /// \sa SubscribeOptions::SetFilter
+      public: bool HasFilter() const;
+
+      /// \brief Evaluate the message filter of this handler.
+      /// \param[in] _msgData The serialized message.
+      /// \param[in] _size Number of bytes in the serialized message.
+      /// \param[in] _info Message information.
+      /// \return True if the message has to be delivered, which is always the
+      /// case for handlers without filter.
+      public: bool Filter(const char *_msgData, const size_t _size,
+                          const MessageInfo &_info) const;
+
+      /// \brief Check if a message outlived the lifespan of this handler.
+      /// The expired messages are counted as dropped, so the caller must
+      /// discard them.
+      /// \param[in] _info Message information.
+      /// \return True if the message has to be discarded, which is never
+      /// the case for handlers without lifespan.
+      /// \sa SubscribeOptions::SetLifespan
+      public: bool Expired(const MessageInfo &_info) const;
+
+      /// \brief Report the reception progress of a fragmented message to
+      /// the progress callback of this handler, if any.
+      /// \param[in] _info Message information.
+      /// \param[in] _received Number of bytes received so far.
+      /// \param[in] _total Number of bytes of the whole message.
+      /// \sa SubscribeOptions::SetProgressCallback
+      public: void ReportProgress(const MessageInfo &_info,
+                                  const uint64_t _received,
+                                  const uint64_t _total) const;
+
+      /// \brief Get the execution times of the callbacks of this handler.
+      /// This is used for the transport metrics.
+      /// \return The execution times.
+      public: CallbackTrace &Trace() const;
+
+      /// \brief Get the number of messages lost before reaching this
+      /// handler, detected from the gaps in the sequence numbers of the
+      /// remote publishers.
+      /// \return The number of messages lost.
+      public: uint64_t DroppedMsgCount() const;
+
+      /// \brief Account for messages lost before reaching this handler.
+      /// \param[in] _count Number of messages lost.
+      public: void AddDroppedMsgs(const uint64_t _count) const;
+
+      /// \brief Check if a message would be accepted by the throttling of
+      /// this handler now, without counting it. It lets the subscriber skip
+      /// the deserialization of the messages that the callback won't get.
+      /// \return True if the handler isn't throttled or its period has
+      /// elapsed since the last callback.
+      /// \sa SubscribeOptions::SetMsgsPerSec
+      public: bool ThrottledUpdateReady() const;
+
       /// \brief Check if message subscription is throttled. If so, verify
       /// whether the callback should be executed or not.
       /// \return true if the callback should be executed or false otherwise.
       protected: bool UpdateThrottling();
 
+      /// \brief Set the type of the messages accepted by this handler. Must be
+      /// called by the constructors of the derived classes.
+      /// \param[in] _typeName Message type name or kGenericMessageType.
+      /// \param[in] _descriptor Descriptor of the message type, if known.
+      protected: void SetType(const std::string &_typeName,
+                   const google::protobuf::Descriptor *_descriptor = nullptr);
+
       /// \brief Subscribe options.
       protected: SubscribeOptions opts;
 
@@ -102,11 +215,28 @@ namespace ignition
       /// \brief Unique handler's UUID.
       protected: std::string hUuid;
 
-      /// \brief Timestamp of the last callback executed.
-      protected: Timestamp lastCbTimestamp;
+      /// \brief Time of the last callback executed, in nanoseconds of the
+      /// steady clock. It's checked before the messages are deserialized,
+      /// possibly from another thread than the callbacks.
+      protected: std::atomic<int64_t> lastCbTimestamp{0};
 
       /// \brief Node UUID.
       private: std::string nUuid;
+
+      /// \brief Cached type name of the messages accepted.
+      protected: std::string typeName;
+
+      /// \brief Descriptor of the messages accepted, or nullptr if unknown.
+      private: const google::protobuf::Descriptor *descriptor = nullptr;
+
+      /// \brief True if the handler accepts all message types.
+      private: bool generic = false;
+
+      /// \brief Execution times of the callbacks.
+      private: mutable CallbackTrace trace;
+
+      /// \brief Number of messages lost.
+      private: mutable std::atomic<uint64_t> droppedMsgs{0};
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
@@ -141,6 +271,19 @@ namespace ignition
         const ProtoMsg &_msg,
         const MessageInfo &_info) = 0;
 
+      /// \brief Executes the local callback registered for this handler with
+      /// a message owned by the transport, which the callbacks registered
+      /// with a SharedMsgCallback share instead of copying it.
+      /// \param[in] _msg Protobuf message received. Never null.
+      /// \param[in] _info Message information (e.g.: topic name).
+      /// \return True when success, false otherwise.
+      public: virtual bool RunLocalSharedCallback(
+        const std::shared_ptr<const ProtoMsg> &_msg,
+        const MessageInfo &_info)
+      {
+        return this->RunLocalCallback(*_msg, _info);
+      }
+
       /// \brief Create a specific protobuf message given its serialized data.
       /// \param[in] _data The serialized data.
       /// \param[in] _type The data type.
@@ -148,6 +291,32 @@ namespace ignition
       public: virtual const std::shared_ptr<ProtoMsg> CreateMsg(
         const std::string &_data,
         const std::string &_type) const = 0;
+
+      /// \brief Create a specific protobuf message given a view of its
+      /// serialized data. The data is only read during this call, so it can
+      /// point straight into a transport buffer without being copied first.
+      /// \param[in] _data Pointer to the serialized data.
+      /// \param[in] _size Size of the serialized data in bytes.
+      /// \param[in] _type The data type.
+      /// \return Pointer to the specific protobuf message.
+      public: virtual const std::shared_ptr<ProtoMsg> CreateMsg(
+        const char *_data,
+        const size_t _size,
+        const std::string &_type) const
+      {
+        return this->CreateMsg(std::string(_data, _size), _type);
+      }
+
+      /// \brief Get the prototype of a message type. The prototypes are
+      /// looked up in the generated descriptor pool, falling back on the
+      /// Ignition Msgs factory. The prototypes found are cached, so the
+      /// lookup only happens the first time that a type is seen. The unknown
+      /// types are looked up again every time, since they may be registered
+      /// later. This function is thread safe.
+      /// \param[in] _type The message type name.
+      /// \return The prototype, to be used with ProtoMsg::New(), or nullptr if
+      /// the type is unknown.
+      protected: static const ProtoMsg *Prototype(const std::string &_type);
     };
 
     /// \class SubscriptionHandler SubscriptionHandler.hh
@@ -162,20 +331,31 @@ namespace ignition
         const SubscribeOptions &_opts = SubscribeOptions())
         : ISubscriptionHandler(_nUuid, _opts)
       {
+        this->SetType(T().GetTypeName(), T::descriptor());
       }
 
       // Documentation inherited.
       public: const std::shared_ptr<ProtoMsg> CreateMsg(
         const std::string &_data,
+        const std::string &_type) const
+      {
+        return this->CreateMsg(_data.data(), _data.size(), _type);
+      }
+
+      // Documentation inherited.
+      public: const std::shared_ptr<ProtoMsg> CreateMsg(
+        const char *_data,
+        const size_t _size,
         const std::string &/*_type*/) const
       {
         // Instantiate a specific protobuf message
         auto msgPtr = std::make_shared<T>();
 
         // Create the message using some serialized data
-        if (!msgPtr->ParseFromString(_data))
+        if (_size > static_cast<size_t>(std::numeric_limits<int>::max()) ||
+            !msgPtr->ParseFromArray(_data, static_cast<int>(_size)))
         {
-          std::cerr << "SubscriptionHandler::CreateMsg() error: ParseFromString"
+          std::cerr << "SubscriptionHandler::CreateMsg() error: ParseFromArray"
                     << " failed" << std::endl;
         }
 
@@ -185,7 +365,7 @@ namespace ignition
       // Documentation inherited.
       public: std::string TypeName()
       {
-        return T().GetTypeName();
+        return this->typeName;
       }
 
       /// \brief Set the callback for this handler.
@@ -195,12 +375,20 @@ namespace ignition
         this->cb = _cb;
       }
 
+      /// \brief Set a callback that shares the messages, instead of the one
+      /// set with SetCallback().
+      /// \param[in] _cb The callback.
+      public: void SetSharedCallback(const SharedMsgCallback<T> &_cb)
+      {
+        this->sharedCb = _cb;
+      }
+
       // Documentation inherited.
       public: bool RunLocalCallback(const ProtoMsg &_msg,
                                     const MessageInfo &_info)
       {
         // No callback stored.
-        if (!this->cb)
+        if (!this->cb && !this->sharedCb)
         {
           std::cerr << "SubscriptionHandler::RunLocalCallback() error: "
                     << "Callback is NULL" << std::endl;
@@ -217,12 +405,43 @@ namespace ignition
         auto msgPtr = google::protobuf::internal::down_cast<const T*>(&_msg);
 #endif
 
-        this->cb(*msgPtr, _info);
+        // The message isn't owned by the transport, e.g. the one of a
+        // publisher delivered inline, so the shared callbacks get a copy.
+        if (this->sharedCb)
+          this->sharedCb(std::make_shared<const T>(*msgPtr), _info);
+        else
+          this->cb(*msgPtr, _info);
+        return true;
+      }
+
+      // Documentation inherited.
+      public: bool RunLocalSharedCallback(
+        const std::shared_ptr<const ProtoMsg> &_msg,
+        const MessageInfo &_info)
+      {
+        if (!this->sharedCb)
+          return this->RunLocalCallback(*_msg, _info);
+
+        // Check the subscription throttling option.
+        if (!this->UpdateThrottling())
+          return true;
+
+#if GOOGLE_PROTOBUF_VERSION >= 3000000
+        auto msgPtr = google::protobuf::down_cast<const T*>(_msg.get());
+#else
+        auto msgPtr =
+          google::protobuf::internal::down_cast<const T*>(_msg.get());
+#endif
+
+        this->sharedCb(std::shared_ptr<const T>(_msg, msgPtr), _info);
         return true;
       }
 
       /// \brief Callback to the function registered for this handler.
       private: MsgCallback<T> cb;
+
+      /// \brief Callback sharing the messages, if set instead of cb.
+      private: SharedMsgCallback<T> sharedCb;
     };
 
     /// \brief Specialized template when the user prefers a callbacks that
@@ -235,6 +454,7 @@ namespace ignition
         const SubscribeOptions &_opts = SubscribeOptions())
         : ISubscriptionHandler(_nUuid, _opts)
       {
+        this->SetType(kGenericMessageType);
       }
 
       // Documentation inherited.
@@ -242,32 +462,26 @@ namespace ignition
         const std::string &_data,
         const std::string &_type) const
       {
-        std::shared_ptr<google::protobuf::Message> msgPtr;
-
-        const google::protobuf::Descriptor *desc =
-          google::protobuf::DescriptorPool::generated_pool()
-            ->FindMessageTypeByName(_type);
-
-        // First, check if we have the descriptor from the generated proto
-        // classes.
-        if (desc)
-        {
-          msgPtr.reset(google::protobuf::MessageFactory::generated_factory()
-            ->GetPrototype(desc)->New());
-        }
-        else
-        {
-          // Fallback on Ignition Msgs if the message type is not found.
-          msgPtr = ignition::msgs::Factory::New(_type);
-        }
+        return this->CreateMsg(_data.data(), _data.size(), _type);
+      }
 
-        if (!msgPtr)
+      // Documentation inherited.
+      public: const std::shared_ptr<ProtoMsg> CreateMsg(
+        const char *_data,
+        const size_t _size,
+        const std::string &_type) const
+      {
+        const ProtoMsg *prototype = Prototype(_type);
+        if (!prototype)
           return nullptr;
 
+        std::shared_ptr<google::protobuf::Message> msgPtr(prototype->New());
+
         // Create the message using some serialized data
-        if (!msgPtr->ParseFromString(_data))
+        if (_size > static_cast<size_t>(std::numeric_limits<int>::max()) ||
+            !msgPtr->ParseFromArray(_data, static_cast<int>(_size)))
         {
-          std::cerr << "CreateMsg() error: ParseFromString failed" << std::endl;
+          std::cerr << "CreateMsg() error: ParseFromArray failed" << std::endl;
           return nullptr;
         }
 
@@ -287,12 +501,20 @@ namespace ignition
         this->cb = _cb;
       }
 
+      /// \brief Set a callback that shares the messages, instead of the one
+      /// set with SetCallback().
+      /// \param[in] _cb The callback.
+      public: void SetSharedCallback(const SharedMsgCallback<ProtoMsg> &_cb)
+      {
+        this->sharedCb = _cb;
+      }
+
       // Documentation inherited.
       public: bool RunLocalCallback(const ProtoMsg &_msg,
                                     const MessageInfo &_info)
       {
         // No callback stored.
-        if (!this->cb)
+        if (!this->cb && !this->sharedCb)
         {
           std::cerr << "SubscriptionHandler::RunLocalCallback() "
                     << "error: Callback is NULL" << std::endl;
@@ -303,12 +525,40 @@ namespace ignition
         if (!this->UpdateThrottling())
           return true;
 
-        this->cb(_msg, _info);
+        // The message isn't owned by the transport, so the shared callbacks
+        // get a copy.
+        if (this->sharedCb)
+        {
+          std::shared_ptr<ProtoMsg> copy(_msg.New());
+          copy->CopyFrom(_msg);
+          this->sharedCb(copy, _info);
+        }
+        else
+          this->cb(_msg, _info);
+        return true;
+      }
+
+      // Documentation inherited.
+      public: bool RunLocalSharedCallback(
+        const std::shared_ptr<const ProtoMsg> &_msg,
+        const MessageInfo &_info)
+      {
+        if (!this->sharedCb)
+          return this->RunLocalCallback(*_msg, _info);
+
+        // Check the subscription throttling option.
+        if (!this->UpdateThrottling())
+          return true;
+
+        this->sharedCb(_msg, _info);
         return true;
       }
 
       /// \brief Callback to the function registered for this handler.
       private: MsgCallback<ProtoMsg> cb;
+
+      /// \brief Callback sharing the messages, if set instead of cb.
+      private: SharedMsgCallback<ProtoMsg> sharedCb;
     };
 
     //////////////////////////////////////////////////
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2016 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_THREADCONFIG_HH_
+#define IGN_TRANSPORT_THREADCONFIG_HH_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    class ThreadConfigPrivate;
+
+    /// \class ThreadConfig ThreadConfig.hh
+    /// ignition/transport/ThreadConfig.hh
+    /// \brief Scheduling of the threads started by the transport: the
+    /// reception, publication, discovery and worker threads, and the I/O
+    /// threads of 0MQ. The threads are named ("ign-reception",
+    /// "ign-discovery", ...) so they can be found with the system tools.
+    ///
+    /// The process-wide configuration is read from the environment the
+    /// first time it's needed:
+    /// * IGN_TRANSPORT_CPU_AFFINITY: CPUs on which the threads run, e.g.:
+    ///   "4-7,10".
+    /// * IGN_TRANSPORT_THREAD_PRIORITY: SCHED_FIFO priority of the threads,
+    ///   between 1 and 99.
+    /// * IGN_TRANSPORT_IO_THREADS: number of I/O threads of 0MQ.
+    /// * IGN_TRANSPORT_MANUAL_SPIN: "1" to receive the messages in the
+    ///   application, see ManualSpin().
+    ///
+    /// It can be replaced with SetGlobal() before creating the first node,
+    /// which starts most of the threads.
+    class IGNITION_TRANSPORT_VISIBLE ThreadConfig
+    {
+      /// \brief Constructor. The values are read from the environment
+      /// variables, the invalid ones are reported and ignored.
+      public: ThreadConfig();
+
+      /// \brief Copy constructor.
+      /// \param[in] _other The configuration to copy.
+      public: ThreadConfig(const ThreadConfig &_other);
+
+      /// \brief Destructor.
+      public: ~ThreadConfig();
+
+      /// \brief Assignment operator.
+      /// \param[in] _other The configuration to copy.
+      /// \return Reference to this configuration.
+      public: ThreadConfig &operator=(const ThreadConfig &_other);
+
+      /// \brief Get the CPUs on which the threads run.
+      /// \return The CPU indices, or an empty vector when the threads can run
+      /// on any CPU, which is the default.
+      public: const std::vector<unsigned int> &CpuAffinity() const;
+
+      /// \brief Set the CPUs on which the threads run. It's only supported on
+      /// Linux.
+      /// \param[in] _cpus The CPU indices, empty for any CPU.
+      public: void SetCpuAffinity(const std::vector<unsigned int> &_cpus);
+
+      /// \brief Get the real-time priority of the threads.
+      /// \return The SCHED_FIFO priority, or 0 if the threads use the default
+      /// scheduling, which is the default.
+      public: int Priority() const;
+
+      /// \brief Set the real-time priority of the threads. Running with
+      /// SCHED_FIFO requires privileges, e.g.: CAP_SYS_NICE on Linux.
+      /// \param[in] _priority The SCHED_FIFO priority, between 1 and 99, or
+      /// 0 for the default scheduling.
+      /// \return True if the priority is valid or false otherwise.
+      public: bool SetPriority(const int _priority);
+
+      /// \brief Get the number of I/O threads of 0MQ.
+      /// \return The number of threads. The default is 1.
+      public: int IoThreads() const;
+
+      /// \brief Set the number of I/O threads of 0MQ.
+      /// \param[in] _threads The number of threads, at least 1.
+      /// \return True if the number is valid or false otherwise.
+      public: bool SetIoThreads(const int _threads);
+
+      /// \brief Check if the messages and service calls are received and
+      /// dispatched by the application, calling spinOnce(), instead of by
+      /// the reception and publish threads. The application can wait for
+      /// work on spinDescriptors() in its own event loop. The discovery
+      /// threads run in both cases.
+      /// \return True if the application spins. The default is false.
+      public: bool ManualSpin() const;
+
+      /// \brief Set if the messages and service calls are received and
+      /// dispatched by the application. \sa ManualSpin().
+      /// \param[in] _manual True for the application to spin.
+      public: void SetManualSpin(const bool _manual);
+
+      /// \brief Apply the configuration to the calling thread: name it,
+      /// and set its affinity and priority. A failure is reported once per
+      /// process.
+      /// \param[in] _name Name of the thread, truncated to 15 characters.
+      /// \return True if the thread was configured or false otherwise.
+      public: bool Apply(const std::string &_name) const;
+
+      /// \brief Get the process-wide configuration of the transport
+      /// threads.
+      /// \return The configuration.
+      public: static ThreadConfig Global();
+
+      /// \brief Set the process-wide configuration of the transport threads.
+      /// It applies to the threads started afterwards, so it has to be set
+      /// before creating the first node.
+      /// \param[in] _config The configuration.
+      public: static void SetGlobal(const ThreadConfig &_config);
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::unique_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \internal
+      /// \brief Smart pointer to private data.
+      private: std::unique_ptr<ThreadConfigPrivate> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#ifndef IGN_TRANSPORT_TOPICLITERAL_HH_
+#define IGN_TRANSPORT_TOPICLITERAL_HH_
+
+#include <cstddef>
+#include <string_view>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/TopicUtils.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    /// \class ConstexprTopicUtils TopicLiteral.hh
+    /// ignition/transport/TopicLiteral.hh
+    /// \brief The validation rules of TopicUtils, usable in constant
+    /// expressions, e.g. to check the names known at compile time with a
+    /// static_assert. TopicUtils applies the same rules at runtime.
+    class ConstexprTopicUtils
+    {
+      /// \brief Determines if a namespace is valid.
+      /// \param[in] _ns Namespace to be checked.
+      /// \return true if the namespace is valid.
+      /// \sa TopicUtils::IsValidNamespace
+      public: static constexpr bool IsValidNamespace(const std::string_view _ns)
+      {
+        // An empty namespace is valid, so take a shortcut here.
+        if (_ns.empty())
+          return true;
+
+        // Too long string is not valid.
+        if (_ns.size() > TopicUtils::kMaxNameLength)
+          return false;
+
+        // "/" is not valid.
+        if (_ns == "/")
+          return false;
+
+        char previous = '\0';
+        for (const char c : _ns)
+        {
+          // If the topic name has a '~', a white space or a '@' is not valid.
+          if (c == '~' || c == ' ' || c == '@')
+            return false;
+
+          // It is not allowed to have two consecutive slashes, or a ':='.
+          if ((c == '/' && previous == '/') || (c == '=' && previous == ':'))
+            return false;
+
+          previous = c;
+        }
+
+        return true;
+      }
+
+      /// \brief Determines if a partition is valid.
+      /// \param[in] _partition Partition to be checked.
+      /// \return true if the partition is valid.
+      /// \sa TopicUtils::IsValidPartition
+      public: static constexpr bool IsValidPartition(
+                  const std::string_view _partition)
+      {
+        // A valid namespace is also a valid partition.
+        return IsValidNamespace(_partition);
+      }
+
+      /// \brief Determines if a topic name is valid.
+      /// \param[in] _topic Topic name to be checked.
+      /// \return true if the topic name is valid.
+      /// \sa TopicUtils::IsValidTopic
+      public: static constexpr bool IsValidTopic(const std::string_view _topic)
+      {
+        return IsValidNamespace(_topic) && !_topic.empty();
+      }
+    };
+
+    /// \class TopicLiteral TopicLiteral.hh ignition/transport/TopicLiteral.hh
+    /// \brief The fully qualified name of a topic or service whose
+    /// partition, namespace and name are known at compile time, built in a
+    /// fixed size buffer by a constant expression. A bad name is caught at
+    /// build time with a static_assert, and a TopicName created from the
+    /// literal doesn't validate it again:
+    ///
+    /// \code
+    ///   constexpr auto kEcho = MakeTopicLiteral("robot", "", "/echo");
+    ///   static_assert(kEcho.Valid(), "Invalid service name");
+    ///   static_assert(kEcho.Name() == "@/robot@/echo");
+    ///
+    ///   const TopicName echo(kEcho);
+    ///   while (running)
+    ///     node.Request(echo, req, timeout, rep, result);
+    /// \endcode
+    ///
+    /// The name is qualified like TopicUtils::FullyQualifiedName() does,
+    /// without the remapping or the options of any node.
+    /// \sa MakeTopicLiteral
+    template<std::size_t N>
+    class TopicLiteral
+    {
+      /// \brief Constructor.
+      /// \param[in] _partition Partition name.
+      /// \param[in] _ns Namespace.
+      /// \param[in] _topic Topic or service name.
+      public: constexpr TopicLiteral(const std::string_view _partition,
+                                     const std::string_view _ns,
+                                     std::string_view _topic)
+      {
+        if (!ConstexprTopicUtils::IsValidPartition(_partition) ||
+            !ConstexprTopicUtils::IsValidNamespace(_ns) ||
+            !ConstexprTopicUtils::IsValidTopic(_topic) ||
+            _partition.size() + _ns.size() + _topic.size() + 6 > N)
+        {
+          return;
+        }
+
+        std::string_view partition = _partition;
+
+        // If the partition contains a trailing slash, remove it.
+        if (!partition.empty() && partition.back() == '/')
+          partition.remove_suffix(1);
+
+        // If the topic ends in "/", remove it.
+        if (_topic.back() == '/')
+          _topic.remove_suffix(1);
+
+        this->Append('@');
+        if (!partition.empty() && partition.front() != '/')
+          this->Append('/');
+        this->Append(partition);
+        this->partitionEnd = this->size;
+        this->Append('@');
+
+        // An absolute topic isn't prefixed by the namespace.
+        if (_topic.empty() || _topic.front() != '/')
+        {
+          if (_ns.empty() || _ns.front() != '/')
+            this->Append('/');
+          this->Append(_ns);
+          if (!_ns.empty() && _ns.back() != '/')
+            this->Append('/');
+        }
+        this->Append(_topic);
+
+        this->valid = this->size <= TopicUtils::kMaxNameLength;
+      }
+
+      /// \brief Check if the name is valid.
+      /// \return True if the partition, the namespace and the topic are
+      /// valid, see TopicUtils::FullyQualifiedName().
+      public: constexpr bool Valid() const
+      {
+        return this->valid;
+      }
+
+      /// \brief Get the fully qualified name.
+      /// \return The fully qualified name, or an empty string if the name
+      /// isn't valid.
+      public: constexpr std::string_view Name() const
+      {
+        return this->valid ? std::string_view(this->data, this->size) :
+          std::string_view();
+      }
+
+      /// \brief Get the partition of the name.
+      /// \return The partition, e.g. "/robot" for "@/robot@/ns/topic".
+      public: constexpr std::string_view Partition() const
+      {
+        return this->valid ?
+          std::string_view(this->data + 1, this->partitionEnd - 1) :
+          std::string_view();
+      }
+
+      /// \brief Get the name without the partition.
+      /// \return The namespace and topic name, e.g. "/ns/topic".
+      public: constexpr std::string_view Topic() const
+      {
+        return this->valid ?
+          std::string_view(this->data + this->partitionEnd + 1,
+            this->size - this->partitionEnd - 1) :
+          std::string_view();
+      }
+
+      /// \brief Append a character to the name.
+      /// \param[in] _c The character.
+      private: constexpr void Append(const char _c)
+      {
+        this->data[this->size++] = _c;
+      }
+
+      /// \brief Append a string to the name.
+      /// \param[in] _str The string.
+      private: constexpr void Append(const std::string_view _str)
+      {
+        for (const char c : _str)
+          this->Append(c);
+      }
+
+      /// \brief The fully qualified name, null terminated.
+      private: char data[N] = {};
+
+      /// \brief Size of the fully qualified name.
+      private: std::size_t size = 0;
+
+      /// \brief Position of the '@' that ends the partition.
+      private: std::size_t partitionEnd = 0;
+
+      /// \brief True if the name is valid.
+      private: bool valid = false;
+    };
+
+    /// \brief Qualify a topic or service name known at compile time.
+    /// \param[in] _partition Partition name.
+    /// \param[in] _ns Namespace.
+    /// \param[in] _topic Topic or service name.
+    /// \return The fully qualified name, with a buffer sized for the longest
+    /// possible qualification of the literals.
+    template<std::size_t P, std::size_t NS, std::size_t T>
+    constexpr TopicLiteral<P + NS + T + 3> MakeTopicLiteral(
+        const char (&_partition)[P], const char (&_ns)[NS],
+        const char (&_topic)[T])
+    {
+      return TopicLiteral<P + NS + T + 3>(
+        std::string_view(_partition, P - 1), std::string_view(_ns, NS - 1),
+        std::string_view(_topic, T - 1));
+    }
+
+    /// \brief Qualify a topic or service name known at compile time,
+    /// without partition and namespace.
+    /// \param[in] _topic Topic or service name.
+    /// \return The fully qualified name.
+    template<std::size_t T>
+    constexpr TopicLiteral<T + 5> MakeTopicLiteral(const char (&_topic)[T])
+    {
+      return MakeTopicLiteral("", "", _topic);
+    }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2016 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_TOPICNAME_HH_
+#define IGN_TRANSPORT_TOPICNAME_HH_
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+#include "ignition/transport/TopicLiteral.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+    //
+    class TopicNamePrivate;
+
+    /// \brief A topic or service name resolved once: validated, and turned
+    /// into its fully qualified name, see TopicUtils::FullyQualifiedName().
+    /// The copies share the resolved strings, so a name can be kept and
+    /// passed to the Node functions as often as needed, e.g. to call a
+    /// service at a high rate, without resolving it again.
+    ///
+    /// \code
+    ///   const auto name = node.Resolve("/echo");
+    ///   while (running)
+    ///     node.Request(name, req, timeout, rep, result);
+    /// \endcode
+    /// \sa Node::Resolve
+    class IGNITION_TRANSPORT_VISIBLE TopicName
+    {
+      /// \brief Default constructor, an invalid name.
+      public: TopicName();
+
+      /// \brief Resolve a name. No remapping is applied, see
+      /// Node::Resolve() for the names as seen by a node.
+      /// \param[in] _partition Partition name.
+      /// \param[in] _ns Namespace.
+      /// \param[in] _topic Topic or service name.
+      public: TopicName(const std::string &_partition,
+                        const std::string &_ns,
+                        const std::string &_topic);
+
+      /// \brief Create a name from a literal qualified at compile time,
+      /// without validating it again.
+      /// \param[in] _literal The name, see MakeTopicLiteral().
+      public: template<std::size_t N>
+              explicit TopicName(const TopicLiteral<N> &_literal)
+        : TopicName(_literal.Name(), _literal.Partition().size() + 1)
+      {
+      }
+
+      /// \brief Check if the name is valid.
+      /// \return True if the partition, the namespace and the topic are
+      /// valid, see TopicUtils::IsValidTopic().
+      public: bool Valid() const;
+
+      /// \brief Get the fully qualified name.
+      /// \return The fully qualified name, or an empty string if the name
+      /// isn't valid.
+      public: const std::string &FullyQualifiedName() const;
+
+      /// \brief Get the partition of the name.
+      /// \return The partition, e.g. "/robot" for "@/robot@/ns/topic".
+      public: const std::string &Partition() const;
+
+      /// \brief Get the name without the partition.
+      /// \return The namespace and topic name, e.g. "/ns/topic", or the
+      /// topic as given if the name isn't valid.
+      public: const std::string &Topic() const;
+
+      /// \brief Equality operator.
+      /// \param[in] _other The name to compare.
+      /// \return True if both names have the same fully qualified name.
+      public: bool operator==(const TopicName &_other) const;
+
+      /// \brief Inequality operator.
+      /// \param[in] _other The name to compare.
+      /// \return True if the fully qualified names differ.
+      public: bool operator!=(const TopicName &_other) const;
+
+      /// \brief Create a name from a fully qualified name already validated.
+      /// \param[in] _fullyQualifiedName The name, empty if not valid.
+      /// \param[in] _partitionEnd Position of the '@' after the partition.
+      private: TopicName(const std::string_view _fullyQualifiedName,
+                         const std::size_t _partitionEnd);
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::shared_ptr
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+      /// \brief Private data, shared by the copies.
+      private: std::shared_ptr<const TopicNamePrivate> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    };
+    }
+  }
+}
+
+#endif
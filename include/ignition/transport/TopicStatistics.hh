@@ -19,6 +19,8 @@
 
 #include <ignition/msgs/statistic.pb.h>
 
+#include <array>
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <string>
@@ -36,7 +38,9 @@ namespace ignition
     class TopicStatisticsPrivate;
 
     /// \brief Computes the rolling average, min, max, and standard
-    /// deviation for a set of samples.
+    /// deviation for a set of samples. The percentiles are estimated from a
+    /// fixed size histogram with logarithmic buckets, HDR style, so the
+    /// memory used doesn't grow with the number of samples.
     class IGNITION_TRANSPORT_VISIBLE Statistics
     {
       /// \brief Default constructor.
@@ -69,6 +73,19 @@ namespace ignition
       /// \return The number of samples.
       public: uint64_t Count() const;
 
+      /// \brief Get an estimate of a percentile of the samples. The relative
+      /// error is below 2% of the value. The histogram has a resolution of a
+      /// thousandth of the sample unit (microseconds for the milliseconds of
+      /// TopicStatistics), negative samples are counted as zero and samples
+      /// over 2^32 thousandths of the unit are counted as the maximum.
+      /// \param[in] _percentile The percentile, in the [0, 100] range. E.g.
+      /// 99.9 for the value that is greater than 99.9% of the samples.
+      /// \return The percentile, or 0 if there aren't samples.
+      public: double Percentile(double _percentile) const;
+
+      /// \brief Number of buckets of the histogram.
+      private: static constexpr std::size_t kHistogramBuckets = 896;
+
       /// \brief Count of the samples.
       private: uint64_t count = 0;
 
@@ -84,6 +101,9 @@ namespace ignition
 
       /// \brief Maximum sample.
       private: double max = std::numeric_limits<double>::min();
+
+      /// \brief Histogram of the samples, used to estimate the percentiles.
+      private: std::array<uint32_t, kHistogramBuckets> histogram{};
     };
 
     /// \brief Encapsulates statistics for a single topic. The set of
@@ -112,7 +132,8 @@ namespace ignition
 
       /// \brief Update the topic statistics.
       /// \param[in] _sender Address of the sender.
-      /// \param[in] _stamp Publication time stamp.
+      /// \param[in] _stamp Publication time stamp, in nanoseconds of the
+      /// steady clock.
       /// \param[in] _seq Publication sequence number.
       public: void Update(const std::string &_sender,
                           uint64_t _stamp, uint64_t _seq);
@@ -21,6 +21,9 @@
 #include <algorithm>
 #include <map>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "ignition/transport/config.hh"
@@ -43,6 +46,31 @@ namespace ignition
       /// \brief Constructor.
       public: TopicStorage() = default;
 
+      /// \brief Copy constructor.
+      /// \param[in] _other Storage to copy.
+      public: TopicStorage(const TopicStorage &_other)
+        : data(_other.data),
+          procTopics(_other.procTopics),
+          nodeTopics(_other.nodeTopics)
+      {
+        this->Reindex();
+      }
+
+      /// \brief Assignment operator.
+      /// \param[in] _other Storage to copy.
+      /// \return Reference to this storage.
+      public: TopicStorage &operator=(const TopicStorage &_other)
+      {
+        if (this != &_other)
+        {
+          this->data = _other.data;
+          this->procTopics = _other.procTopics;
+          this->nodeTopics = _other.nodeTopics;
+          this->Reindex();
+        }
+        return *this;
+      }
+
       /// \brief Destructor.
       public: virtual ~TopicStorage() = default;
 
@@ -52,20 +80,15 @@ namespace ignition
       /// was already stored).
       public: bool AddPublisher(const T &_publisher)
       {
-        // The topic does not exist.
-        if (this->data.find(_publisher.Topic()) == this->data.end())
-        {
-          // VS2013 is buggy with initializer list here {}
-          this->data[_publisher.Topic()] =
-            std::map<std::string, std::vector<T>>();
-        }
+        // Create the topic entry if it does not exist.
+        auto &m = this->Insert(_publisher.Topic());
 
         // Check if the process uuid exists.
-        auto &m = this->data[_publisher.Topic()];
-        if (m.find(_publisher.PUuid()) != m.end())
+        auto procIt = m.find(_publisher.PUuid());
+        if (procIt != m.end())
         {
           // Check that the Publisher does not exist.
-          auto &v = m[_publisher.PUuid()];
+          auto &v = procIt->second;
           auto found = std::find_if(v.begin(), v.end(),
             [&](const T &_pub)
             {
@@ -80,6 +103,8 @@ namespace ignition
 
         // Add a new Publisher entry.
         m[_publisher.PUuid()].push_back(T(_publisher));
+        this->procTopics[_publisher.PUuid()].insert(_publisher.Topic());
+        this->nodeTopics[_publisher.NUuid()].insert(_publisher.Topic());
         return true;
       }
 
@@ -88,7 +113,7 @@ namespace ignition
       /// \return True if there is at least one entry stored for the topic.
       public: bool HasTopic(const std::string &_topic) const
       {
-        return this->data.find(_topic) != this->data.end();
+        return this->Find(_topic) != this->data.end();
       }
 
       /// \brief Return if there is any publisher stored for the given topic and
@@ -100,11 +125,12 @@ namespace ignition
       public: bool HasTopic(const std::string &_topic,
                             const std::string &_type) const
       {
-        if (!this->HasTopic(_topic))
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
         // m is {pUUID=>std::vector<Publisher>}.
-        auto &m = this->data.at(_topic);
+        auto &m = topicIt->second;
 
         for (auto const &procs : m)
         {
@@ -134,11 +160,11 @@ namespace ignition
       public: bool HasAnyPublishers(const std::string &_topic,
                                     const std::string &_pUuid) const
       {
-        if (!this->HasTopic(_topic))
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        return this->data.at(_topic).find(_pUuid) !=
-               this->data.at(_topic).end();
+        return topicIt->second.find(_pUuid) != topicIt->second.end();
       }
 
       /// \brief Return if the requested publisher's address is stored.
@@ -160,6 +186,30 @@ namespace ignition
         return false;
       }
 
+      /// \brief Get the process of the publishers that use an address.
+      /// \param[in] _addr Publisher's address.
+      /// \param[out] _pUuid Process UUID of the publishers.
+      /// \return true if a publisher with the address is stored.
+      public: bool ProcessByAddr(const std::string &_addr,
+                                 std::string &_pUuid) const
+      {
+        for (auto const &topic : this->data)
+        {
+          for (auto const &proc : topic.second)
+          {
+            for (auto const &pub : proc.second)
+            {
+              if (pub.Addr() == _addr)
+              {
+                _pUuid = proc.first;
+                return true;
+              }
+            }
+          }
+        }
+        return false;
+      }
+
       /// \brief Get the address information for a given topic and node UUID.
       /// \param[in] _topic Topic name.
       /// \param[in] _pUuid Process UUID of the publisher.
@@ -172,18 +222,20 @@ namespace ignition
                              T &_publisher) const
       {
         // Topic not found.
-        if (this->data.find(_topic) == this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
         // m is {pUUID=>Publisher}.
-        auto &m = this->data.at(_topic);
+        auto &m = topicIt->second;
 
         // pUuid not found.
-        if (m.find(_pUuid) == m.end())
+        auto procIt = m.find(_pUuid);
+        if (procIt == m.end())
           return false;
 
         // Vector of 0MQ known addresses for a given topic and pUuid.
-        auto &v = m.at(_pUuid);
+        auto &v = procIt->second;
         auto found = std::find_if(v.begin(), v.end(),
           [&](const T &_pub)
           {
@@ -207,10 +259,11 @@ namespace ignition
       public: bool Publishers(const std::string &_topic,
                              std::map<std::string, std::vector<T>> &_info) const
       {
-        if (!this->HasTopic(_topic))
+        auto topicIt = this->Find(_topic);
+        if (topicIt == this->data.end())
           return false;
 
-        _info = this->data.at(_topic);
+        _info = topicIt->second;
         return true;
       }
 
@@ -225,17 +278,18 @@ namespace ignition
       {
         size_t counter = 0;
 
-        // Iterate over all the topics.
-        if (this->data.find(_topic) != this->data.end())
+        auto topicIt = this->Find(_topic);
+        if (topicIt != this->data.end())
         {
           // m is {pUUID=>Publisher}.
-          auto &m = this->data[_topic];
+          auto &m = topicIt->second;
 
           // The pUuid exists.
-          if (m.find(_pUuid) != m.end())
+          auto procIt = m.find(_pUuid);
+          if (procIt != m.end())
           {
             // Vector of 0MQ known addresses for a given topic and pUuid.
-            auto &v = m[_pUuid];
+            auto &v = procIt->second;
             auto priorSize = v.size();
             v.erase(std::remove_if(v.begin(), v.end(),
               [&](const T &_pub)
@@ -245,11 +299,17 @@ namespace ignition
               v.end());
             counter = priorSize - v.size();
 
+            if (counter > 0)
+              this->Unindex(this->nodeTopics, _nUuid, _topic);
+
             if (v.empty())
-              m.erase(_pUuid);
+            {
+              m.erase(procIt);
+              this->Unindex(this->procTopics, _pUuid, _topic);
+            }
 
             if (m.empty())
-              this->data.erase(_topic);
+              this->Erase(topicIt);
           }
         }
 
@@ -261,21 +321,33 @@ namespace ignition
       /// \return True when at least one address was removed or false otherwise.
       public: bool DelPublishersByProc(const std::string &_pUuid)
       {
-        size_t counter = 0;
+        auto procIt = this->procTopics.find(_pUuid);
+        if (procIt == this->procTopics.end())
+          return false;
 
-        // Iterate over all the topics.
-        for (auto it = this->data.begin(); it != this->data.end();)
+        // Only visit the topics of the process.
+        for (auto const &topic : procIt->second)
         {
+          auto topicIt = this->Find(topic);
+          if (topicIt == this->data.end())
+            continue;
+
           // m is {pUUID=>Publisher}.
-          auto &m = it->second;
-          counter += m.erase(_pUuid);
+          auto &m = topicIt->second;
+          auto it = m.find(_pUuid);
+          if (it == m.end())
+            continue;
+
+          for (auto const &pub : it->second)
+            this->Unindex(this->nodeTopics, pub.NUuid(), topic);
+
+          m.erase(it);
           if (m.empty())
-            this->data.erase(it++);
-          else
-            ++it;
+            this->Erase(topicIt);
         }
 
-        return counter > 0;
+        this->procTopics.erase(procIt);
+        return true;
       }
 
       /// \brief Given a process UUID, the function returns the list of
@@ -288,19 +360,17 @@ namespace ignition
       {
         _pubs.clear();
 
-        // Iterate over all the topics.
-        for (auto const &topic : this->data)
+        auto procIt = this->procTopics.find(_pUuid);
+        if (procIt == this->procTopics.end())
+          return;
+
+        // Iterate over the topics of the process.
+        for (auto const &topic : procIt->second)
         {
           // m is {pUUID=>Publisher}.
-          auto &m = topic.second;
-          if (m.find(_pUuid) != m.end())
-          {
-            auto &v = m.at(_pUuid);
-            for (auto const &pub : v)
-            {
-              _pubs[pub.NUuid()].push_back(T(pub));
-            }
-          }
+          auto const &m = this->Find(topic)->second;
+          for (auto const &pub : m.at(_pUuid))
+            _pubs[pub.NUuid()].push_back(T(pub));
         }
       }
 
@@ -315,27 +385,29 @@ namespace ignition
       {
         _pubs.clear();
 
-        // Iterate over all the topics.
-        for (auto const &topic : this->data)
+        auto nodeIt = this->nodeTopics.find(_nUuid);
+        if (nodeIt == this->nodeTopics.end())
+          return;
+
+        // Iterate over the topics of the node.
+        for (auto const &topic : nodeIt->second)
         {
           // m is {pUUID=>Publisher}.
-          auto const &m = topic.second;
-          if (m.find(_pUuid) != m.end())
+          auto const &m = this->Find(topic)->second;
+          auto procIt = m.find(_pUuid);
+          if (procIt == m.end())
+            continue;
+
+          for (auto const &pub : procIt->second)
           {
-            auto const &v = m.at(_pUuid);
-            for (auto const &pub : v)
-            {
-              if (pub.NUuid() == _nUuid)
-              {
-                _pubs.push_back(T(pub));
-              }
-            }
+            if (pub.NUuid() == _nUuid)
+              _pubs.push_back(T(pub));
           }
         }
       }
 
       /// \brief Get the list of topics currently stored.
-      /// \param[out] _topics List of stored topics.
+      /// \param[out] _topics List of stored topics, sorted alphabetically.
       public: void TopicList(std::vector<std::string> &_topics) const
       {
         for (auto const &topic : this->data)
@@ -362,10 +434,105 @@ namespace ignition
         }
       }
 
+      /// \brief Remove a topic from one of the indexes.
+      /// \param[in,out] _index The index.
+      /// \param[in] _uuid The process or node UUID.
+      /// \param[in] _topic The topic.
+      private: static void Unindex(std::unordered_map<std::string,
+                                     std::unordered_set<std::string>> &_index,
+                                   const std::string &_uuid,
+                                   const std::string &_topic)
+      {
+        auto it = _index.find(_uuid);
+        if (it == _index.end())
+          return;
+
+        it->second.erase(_topic);
+        if (it->second.empty())
+          _index.erase(it);
+      }
+
+      /// \brief Publishers of a topic, by process UUID.
+      private: using ProcPublishers_M = std::map<std::string, std::vector<T>>;
+
+      /// \brief Publishers by topic.
+      private: using TopicPublishers_M =
+                 std::map<std::string, ProcPublishers_M>;
+
+      /// \brief Find the entry of a topic through the hashed index.
+      /// \param[in] _topic Topic name.
+      /// \return The entry, or data.end() if the topic isn't stored.
+      private: typename TopicPublishers_M::const_iterator Find(
+                   const std::string &_topic) const
+      {
+        auto it = this->topicIndex.find(_topic);
+        if (it == this->topicIndex.end())
+          return this->data.end();
+        return it->second;
+      }
+
+      /// \brief Find the entry of a topic through the hashed index.
+      /// \param[in] _topic Topic name.
+      /// \return The entry, or data.end() if the topic isn't stored.
+      private: typename TopicPublishers_M::iterator Find(
+                   const std::string &_topic)
+      {
+        auto it = this->topicIndex.find(_topic);
+        if (it == this->topicIndex.end())
+          return this->data.end();
+        return it->second;
+      }
+
+      /// \brief Get the entry of a topic, creating it if needed.
+      /// \param[in] _topic Topic name.
+      /// \return The publishers of the topic.
+      private: ProcPublishers_M &Insert(const std::string &_topic)
+      {
+        auto it = this->Find(_topic);
+        if (it != this->data.end())
+          return it->second;
+
+        it = this->data.emplace(_topic, ProcPublishers_M()).first;
+        this->topicIndex.emplace(it->first, it);
+        return it->second;
+      }
+
+      /// \brief Remove the entry of a topic.
+      /// \param[in] _it The entry.
+      private: void Erase(typename TopicPublishers_M::iterator _it)
+      {
+        this->topicIndex.erase(_it->first);
+        this->data.erase(_it);
+      }
+
+      /// \brief Rebuild the index of the topics.
+      private: void Reindex()
+      {
+        this->topicIndex.clear();
+        for (auto it = this->data.begin(); it != this->data.end(); ++it)
+          this->topicIndex.emplace(it->first, it);
+      }
+
       /// \brief The keys are topics. The values are another map, where the key
       /// is the process UUID and the value a vector of publishers.
       private: std::map<std::string,
                         std::map<std::string, std::vector<T>>> data;
+
+      /// \brief Entries of data by topic name. The topics are hashed since
+      /// most of the queries are keyed by topic name, while data keeps them
+      /// sorted. The keys refer to the ones of data.
+      private: std::unordered_map<std::string_view,
+                 typename TopicPublishers_M::iterator> topicIndex;
+
+      /// \brief Topics with publishers of each process, by process UUID. It
+      /// keeps the per process operations proportional to the entries of
+      /// that process, instead of the number of topics.
+      private: std::unordered_map<std::string,
+                                  std::unordered_set<std::string>> procTopics;
+
+      /// \brief Topics with publishers of each node, by node UUID.
+      private: std::unordered_map<std::string,
+                                  std::unordered_set<std::string>> nodeTopics;
     };
     }
   }
@@ -136,6 +136,18 @@ namespace ignition
       /// \return A valid topic, or empty string if not possible to convert.
       public: static std::string AsValidTopic(const std::string &_topic);
 
+      /// \brief Check if a topic is under a prefix. The prefix matches whole
+      /// segments of the topic name: "/robot" matches "/robot" and
+      /// "/robot/scan" but not "/robotic". A prefix ending in "/" matches
+      /// all the topics that start with it, e.g. "@/partition@/" matches all
+      /// the topics of a partition.
+      /// \param[in] _topic The topic, usually a fully qualified name.
+      /// \param[in] _prefix The prefix, with the same qualification.
+      /// \return True if _topic is _prefix or one of its subtopics.
+      /// \sa Node::SubscribeRawPrefix
+      public: static bool MatchesPrefix(const std::string &_topic,
+                                        const std::string &_prefix);
+
       /// \brief The kMaxNameLength specifies the maximum number of characters
       /// allowed in a namespace, a partition name, a topic name, and a fully
       /// qualified topic name.
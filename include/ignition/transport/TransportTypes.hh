@@ -132,6 +132,29 @@ namespace ignition
     using SrvDiscoveryCallback =
       std::function<void(const ServicePublisher &_publisher)>;
 
+    /// \brief Kind of change of the topic publishers known through the
+    /// discovery.
+    /// \sa Node::SubscribeDiscovery
+    enum class DiscoveryChange_t
+    {
+      /// \brief A publisher was discovered or advertised by this process.
+      ADDED,
+      /// \brief A publisher was unadvertised.
+      REMOVED,
+      /// \brief A process is gone, with all its publishers. Only the
+      /// process UUID of the publisher passed along is set.
+      PROCESS_REMOVED
+    };
+
+    /// \def DiscoveryChangeCallback
+    /// \brief Callback of the changes of the topic publishers:
+    ///   \param[in] _change Kind of change.
+    ///   \param[in] _publisher The publisher, with its fully qualified topic
+    /// name.
+    using DiscoveryChangeCallback =
+      std::function<void(const DiscoveryChange_t _change,
+                         const MessagePublisher &_publisher)>;
+
     /// \def MsgCallback
     /// \brief User callback used for receiving messages:
     ///   \param[in] _msg Protobuf message containing the topic update.
@@ -140,6 +163,17 @@ namespace ignition
     using MsgCallback =
       std::function<void(const T &_msg, const MessageInfo &_info)>;
 
+    /// \def SharedMsgCallback
+    /// \brief User callback used for receiving messages shared with the
+    /// transport, so they can be kept without copying them:
+    ///   \param[in] _msg Protobuf message containing the topic update. The
+    /// other subscribers of the process may share it too.
+    ///   \param[in] _info Message information (e.g.: topic name).
+    template <typename T>
+    using SharedMsgCallback =
+      std::function<void(const std::shared_ptr<const T> &_msg,
+                         const MessageInfo &_info)>;
+
     /// \def RawCallback
     /// \brief User callback used for receiving raw message data:
     /// \param[in] _msgData string of a serialized protobuf message
@@ -173,6 +207,12 @@ namespace ignition
     /// \brief The string type used for generic messages.
     const std::string kGenericMessageType = "google.protobuf.Message";
 
+    /// \brief The response type sent on the wire with a batch of oneway
+    /// requests. The responder runs the replier of the service that returns
+    /// msgs::Empty with each request of the batch.
+    /// \sa BatchReqHandler
+    const std::string kOnewayBatchType = "ignition.transport.OnewayBatch";
+
     /// \brief The high water mark of the recieve message buffer.
     /// \sa NodeShared::RcvHwm
     const int kDefaultRcvHwm = 1000;
@@ -180,6 +220,14 @@ namespace ignition
     /// \brief The high water mark of the send message buffer.
     /// \sa NodeShared::SndHwm
     const int kDefaultSndHwm = 1000;
+
+    /// \brief The rate of the multicast data in kbit/s.
+    /// \sa AdvertiseMessageOptions::SetMulticastGroup
+    const int kDefaultMulticastRate = 100000;
+
+    /// \brief The DSCP value of the packets of the control topics, expedited
+    /// forwarding. \sa TrafficClass_t::CONTROL
+    const int kDefaultControlDscp = 46;
     }
   }
 }
@@ -18,6 +18,8 @@
 #ifndef IGN_TRANSPORT_UUID_HH_
 #define IGN_TRANSPORT_UUID_HH_
 
+#include <cstddef>
+#include <functional>
 #include <iostream>
 #include <string>
 
@@ -54,6 +56,39 @@ namespace ignition
       /// \return the UUID in string format.
       public: std::string ToString() const;
 
+      /// \brief Return the binary representation of the Uuid: its 16 octets,
+      /// most significant first, as in the string representation. It's the
+      /// same on all the platforms, and smaller and cheaper to compare and
+      /// hash than the string representation.
+      /// \return The UUID in binary format.
+      public: std::string ToBinary() const;
+
+      /// \brief Parse a UUID in string or binary format.
+      /// \param[in] _str The UUID, as returned by ToString() or ToBinary().
+      /// \param[out] _uuid The UUID parsed, unchanged if _str isn't valid.
+      /// \return True if _str is a valid UUID or false otherwise.
+      public: static bool Parse(const std::string &_str, Uuid &_uuid);
+
+      /// \brief Get a hash of the UUID, for unordered containers.
+      /// \return The hash.
+      public: std::size_t Hash() const;
+
+      /// \brief Equality operator.
+      /// \param[in] _other The other UUID.
+      /// \return True if both UUIDs are the same.
+      public: bool operator==(const Uuid &_other) const;
+
+      /// \brief Inequality operator.
+      /// \param[in] _other The other UUID.
+      /// \return True if the UUIDs are different.
+      public: bool operator!=(const Uuid &_other) const;
+
+      /// \brief Less than operator, for ordered containers. The UUIDs are
+      /// ordered as their binary representations.
+      /// \param[in] _other The other UUID.
+      /// \return True if this UUID goes before _other.
+      public: bool operator<(const Uuid &_other) const;
+
       /// \brief Stream insertion operator.
       /// \param[out] _out The output stream.
       /// \param[in] _uuid UUID to write to the stream.
@@ -72,10 +107,37 @@ namespace ignition
       /// To summarize: 36 octets + \0 = 37 octets.
       private: static const int UuidStrLen = 37;
 
+      /// \brief Length of a UUID in binary format.
+      private: static const std::size_t UuidBinaryLen = 16;
+
+      /// \brief Get the octets of the UUID, most significant first.
+      /// \param[out] _octets The octets.
+      private: void Octets(unsigned char (&_octets)[UuidBinaryLen]) const;
+
+      /// \brief Set the UUID from its octets.
+      /// \param[in] _octets The octets, most significant first.
+      private: void SetOctets(const unsigned char (&_octets)[UuidBinaryLen]);
+
       /// \brief Internal representation.
       private: portable_uuid_t data;
     };
     }
   }
 }
+
+namespace std
+{
+  /// \brief Hash of a UUID, for unordered containers.
+  template<>
+  struct hash<ignition::transport::Uuid>
+  {
+    /// \brief Get the hash of a UUID.
+    /// \param[in] _uuid The UUID.
+    /// \return The hash.
+    std::size_t operator()(const ignition::transport::Uuid &_uuid) const
+    {
+      return _uuid.Hash();
+    }
+  };
+}
 #endif
@@ -20,6 +20,8 @@
 
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace ignition
 {
@@ -27,11 +29,152 @@ namespace ignition
   {
     //////////////////////////////////////////////////
     template<typename MessageT>
-    Node::Publisher Node::Advertise(
+    Node::TypedPublisher<MessageT> Node::Advertise(
         const std::string &_topic,
         const AdvertiseMessageOptions &_options)
     {
-      return this->Advertise(_topic, MessageT().GetTypeName(), _options);
+      return TypedPublisher<MessageT>(this->Advertise(_topic,
+        Serializer<MessageT>::TypeName(), _options));
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    Node::TypedPublisher<MessageT> Node::Advertise(
+        const TopicName &_topic,
+        const AdvertiseMessageOptions &_options)
+    {
+      return TypedPublisher<MessageT>(this->Advertise(_topic,
+        Serializer<MessageT>::TypeName(), _options));
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::SubscribeLazy(
+        const std::string &_topic,
+        const std::function<void(const LazyMessage<MessageT> &_msg,
+                                 const MessageInfo &_info)> &_callback,
+        const SubscribeOptions &_opts)
+    {
+      if (!_callback)
+      {
+        std::cerr << "Node::SubscribeLazy(): NULL callback" << std::endl;
+        return false;
+      }
+
+      auto cb = _callback;
+      RawCallback rawCb = [cb](const char *_msgData, const size_t _size,
+                               const MessageInfo &_info)
+      {
+        // The data is only copied if the callback keeps the handle.
+        auto lazy = LazyMessage<MessageT>::Borrow(_msgData, _size,
+          _info.Type());
+        cb(lazy, _info);
+        lazy.Detach();
+      };
+
+      return this->SubscribeRaw(_topic, rawCb, MessageT().GetTypeName(),
+        _opts);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::Publisher::PublishBatch(const std::vector<MessageT> &_msgs)
+    {
+      static_assert(std::is_base_of<ProtoMsg, MessageT>::value,
+        "PublishBatch() requires protobuf messages");
+
+      std::vector<const ProtoMsg *> msgs;
+      msgs.reserve(_msgs.size());
+      for (const MessageT &msg : _msgs)
+        msgs.push_back(&msg);
+      return this->PublishBatch(msgs);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::TypedPublisher<MessageT>::Publish(const MessageT &_msg)
+    {
+      if constexpr (IsCustomSerialized<MessageT>::value)
+        return Publisher::Publish(_msg);
+      else
+        return this->PublishHelper(_msg, nullptr, true);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::TypedPublisher<MessageT>::Publish(
+        std::unique_ptr<MessageT> _msg)
+    {
+      if (!_msg)
+      {
+        std::cerr << "Node::Publisher::Publish() NULL message" << std::endl;
+        return false;
+      }
+
+      if constexpr (IsCustomSerialized<MessageT>::value)
+      {
+        return Publisher::Publish(*_msg);
+      }
+      else
+      {
+        const ProtoMsg &msg = *_msg;
+        return this->PublishHelper(msg, std::move(_msg), true);
+      }
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::TypedPublisher<MessageT>::Publish(MessageT &&_msg)
+    {
+      if constexpr (IsCustomSerialized<MessageT>::value)
+      {
+        return Publisher::Publish(_msg);
+      }
+      else if (this->Realtime())
+      {
+        // The message is serialized in the real-time queue, no need to
+        // allocate another one.
+        return this->PublishHelper(_msg, nullptr, true);
+      }
+      else
+      {
+        // Steal the content of the message, see Publisher::Publish().
+        std::unique_ptr<MessageT> owned(new MessageT());
+        owned->Swap(&_msg);
+        return this->Publish(std::move(owned));
+      }
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    std::enable_if_t<IsCustomSerialized<MessageT>::value, bool>
+    Node::Publisher::Publish(const MessageT &_msg)
+    {
+      if (!this->Valid())
+        return false;
+
+      static const std::string kTypeName = Serializer<MessageT>::TypeName();
+      const std::size_t size = Serializer<MessageT>::ByteSize(_msg);
+      if (this->Realtime())
+      {
+        auto write = [](const void *_data, char *_slot,
+                        const std::size_t _slotSize)
+        {
+          return Serializer<MessageT>::Serialize(
+            *static_cast<const MessageT *>(_data), _slot, _slotSize);
+        };
+        return this->PublishRealtime(size, write, &_msg, kTypeName);
+      }
+
+      MessageLoan loan = this->Loan(size);
+      if (!Serializer<MessageT>::Serialize(_msg, loan.Data(), size))
+      {
+        std::cerr << "Node::Publisher::Publish(): Error serializing data"
+                  << std::endl;
+        return false;
+      }
+      loan.SetType(kTypeName);
+      return this->Publish(std::move(loan));
     }
 
     //////////////////////////////////////////////////
@@ -112,35 +255,110 @@ namespace ignition
                            const MessageInfo &_info)> &_cb,
         const SubscribeOptions &_opts)
     {
-      // Topic remapping.
-      std::string topic = _topic;
-      this->Options().TopicRemap(_topic, topic);
+      return this->Subscribe<MessageT>(this->Resolve(_topic), _cb, _opts);
+    }
 
-      std::string fullyQualifiedTopic;
-      if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::Subscribe(
+        const TopicName &_topic,
+        std::function<void(const MessageT &_msg,
+                           const MessageInfo &_info)> &_cb,
+        const SubscribeOptions &_opts)
+    {
+      if (!_topic.Valid())
       {
-        std::cerr << "Topic [" << topic << "] is not valid." << std::endl;
+        std::cerr << "Topic [" << _topic.Topic() << "] is not valid."
+                  << std::endl;
         return false;
       }
 
-      // Create a new subscription handler.
-      std::shared_ptr<SubscriptionHandler<MessageT>> subscrHandlerPtr(
-          new SubscriptionHandler<MessageT>(this->NodeUuid(), _opts));
+      // The messages of other serializers are read from a raw subscription.
+      if constexpr (!std::is_base_of<ProtoMsg, MessageT>::value)
+      {
+        auto cb = _cb;
+        RawCallback rawCb = [cb](const char *_msgData, const size_t _size,
+                                 const MessageInfo &_info)
+        {
+          MessageT msg;
+          if (!Serializer<MessageT>::Deserialize(_msgData, _size, msg))
+          {
+            std::cerr << "Node::Subscribe(): Error deserializing a message"
+                      << " of type [" << _info.Type() << "]" << std::endl;
+            return;
+          }
+          cb(msg, _info);
+        };
 
-      // Insert the callback into the handler.
-      subscrHandlerPtr->SetCallback(_cb);
+        return this->SubscribeRaw(_topic, rawCb,
+          Serializer<MessageT>::TypeName(), _opts);
+      }
+      else
+      {
+        const std::string &fullyQualifiedTopic = _topic.FullyQualifiedName();
+
+        // Create a new subscription handler.
+        std::shared_ptr<SubscriptionHandler<MessageT>> subscrHandlerPtr(
+            new SubscriptionHandler<MessageT>(this->NodeUuid(), _opts));
+
+        // Insert the callback into the handler.
+        subscrHandlerPtr->SetCallback(_cb);
+
+        return this->SubscribeHandler(fullyQualifiedTopic, subscrHandlerPtr);
+      }
+    }
+
+    //////////////////////////////////////////////////
+    template<typename MessageT>
+    bool Node::SubscribeShared(
+        const std::string &_topic,
+        const SharedMsgCallback<MessageT> &_callback,
+        const SubscribeOptions &_opts)
+    {
+      if (!_callback)
+      {
+        std::cerr << "Node::SubscribeShared(): NULL callback" << std::endl;
+        return false;
+      }
 
-      std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+      const TopicName topic = this->Resolve(_topic);
+      if (!topic.Valid())
+      {
+        std::cerr << "Topic [" << topic.Topic() << "] is not valid."
+                  << std::endl;
+        return false;
+      }
 
-      // Store the subscription handler. Each subscription handler is
-      // associated with a topic. When the receiving thread gets new data,
-      // it will recover the subscription handler associated to the topic and
-      // will invoke the callback.
-      this->Shared()->localSubscribers.normal.AddHandler(
-        fullyQualifiedTopic, this->NodeUuid(), subscrHandlerPtr);
+      // The messages of other serializers are read from a raw subscription.
+      if constexpr (!std::is_base_of<ProtoMsg, MessageT>::value)
+      {
+        auto cb = _callback;
+        RawCallback rawCb = [cb](const char *_msgData, const size_t _size,
+                                 const MessageInfo &_info)
+        {
+          auto msg = std::make_shared<MessageT>();
+          if (!Serializer<MessageT>::Deserialize(_msgData, _size, *msg))
+          {
+            std::cerr << "Node::SubscribeShared(): Error deserializing a "
+                      << "message of type [" << _info.Type() << "]"
+                      << std::endl;
+            return;
+          }
+          cb(msg, _info);
+        };
+
+        return this->SubscribeRaw(topic, rawCb,
+          Serializer<MessageT>::TypeName(), _opts);
+      }
+      else
+      {
+        std::shared_ptr<SubscriptionHandler<MessageT>> subscrHandlerPtr(
+            new SubscriptionHandler<MessageT>(this->NodeUuid(), _opts));
+        subscrHandlerPtr->SetSharedCallback(_callback);
 
-      return this->SubscribeHelper(fullyQualifiedTopic);
+        return this->SubscribeHandler(topic.FullyQualifiedName(),
+          subscrHandlerPtr);
+      }
     }
 
     //////////////////////////////////////////////////
@@ -228,18 +446,6 @@ namespace ignition
       std::function<bool(const RequestT &, ReplyT &)> _cb,
       const AdvertiseServiceOptions &_options)
     {
-      // Topic remapping.
-      std::string topic = _topic;
-      this->Options().TopicRemap(_topic, topic);
-
-      std::string fullyQualifiedTopic;
-      if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
-      {
-        std::cerr << "Service [" << topic << "] is not valid." << std::endl;
-        return false;
-      }
-
       // Create a new service reply handler.
       std::shared_ptr<RepHandler<RequestT, ReplyT>> repHandlerPtr(
         new RepHandler<RequestT, ReplyT>());
@@ -247,35 +453,43 @@ namespace ignition
       // Insert the callback into the handler.
       repHandlerPtr->SetCallback(_cb);
 
-      std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+      return this->AdvertiseHelper(_topic, repHandlerPtr, _options);
+    }
 
-      // Add the topic to the list of advertised services.
-      this->SrvsAdvertised().insert(fullyQualifiedTopic);
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    bool Node::AdvertiseStream(
+      const std::string &_topic,
+      std::function<void(const RequestT &,
+        const ServiceStream<ReplyT> &)> _cb,
+      const AdvertiseServiceOptions &_options)
+    {
+      // Create a new streaming service reply handler.
+      auto repHandlerPtr =
+        std::make_shared<StreamRepHandler<RequestT, ReplyT>>();
 
-      // Store the replier handler. Each replier handler is
-      // associated with a topic. When the receiving thread gets new requests,
-      // it will recover the replier handler associated to the topic and
-      // will invoke the service call.
-      this->Shared()->repliers.AddHandler(
-        fullyQualifiedTopic, this->NodeUuid(), repHandlerPtr);
+      // Insert the callback into the handler.
+      repHandlerPtr->SetCallback(_cb);
 
-      // Notify the discovery service to register and advertise my responser.
-      ServicePublisher publisher(fullyQualifiedTopic,
-        this->Shared()->myReplierAddress,
-        this->Shared()->replierId.ToString(),
-        this->Shared()->pUuid, this->NodeUuid(),
-        RequestT().GetTypeName(), ReplyT().GetTypeName(), _options);
+      return this->AdvertiseHelper(_topic, repHandlerPtr, _options);
+    }
 
-      if (!this->Shared()->AdvertisePublisher(publisher))
-      {
-        std::cerr << "Node::Advertise(): Error advertising service ["
-                  << topic
-                  << "]. Did you forget to start the discovery service?"
-                  << std::endl;
-        return false;
-      }
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    bool Node::AdvertiseAsync(
+      const std::string &_topic,
+      std::function<void(const RequestT &,
+        const ServiceCompletion<ReplyT> &)> _cb,
+      const AdvertiseServiceOptions &_options)
+    {
+      // Create a new asynchronous service reply handler.
+      auto repHandlerPtr =
+        std::make_shared<AsyncRepHandler<RequestT, ReplyT>>();
 
-      return true;
+      // Insert the callback into the handler.
+      repHandlerPtr->SetCallback(_cb);
+
+      return this->AdvertiseHelper(_topic, repHandlerPtr, _options);
     }
 
     //////////////////////////////////////////////////
@@ -399,33 +613,46 @@ namespace ignition
       const RequestT &_request,
       std::function<void(const ReplyT &_reply, const bool _result)> &_cb)
     {
-      // Topic remapping.
-      std::string topic = _topic;
-      this->Options().TopicRemap(_topic, topic);
+      return this->Request<RequestT, ReplyT>(this->Resolve(_topic), _request,
+        _cb);
+    }
 
-      std::string fullyQualifiedTopic;
-      if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    bool Node::Request(
+      const TopicName &_topic,
+      const RequestT &_request,
+      std::function<void(const ReplyT &_reply, const bool _result)> &_cb)
+    {
+      if (!_topic.Valid())
       {
-        std::cerr << "Service [" << topic << "] is not valid." << std::endl;
+        std::cerr << "Service [" << _topic.Topic() << "] is not valid."
+                  << std::endl;
         return false;
       }
+      const std::string &fullyQualifiedTopic = _topic.FullyQualifiedName();
+
+      // The services are created the first time they are used.
+      if (!this->Shared()->InitializeServices())
+        return false;
+
+      // Type names of the messages, built only once.
+      static const std::string kReqTypeName = RequestT().GetTypeName();
+      static const std::string kRepTypeName = ReplyT().GetTypeName();
 
       bool localResponserFound;
       IRepHandlerPtr repHandler;
       {
-        std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+        std::lock_guard<std::recursive_mutex> lk(this->Shared()->srvMutex);
         localResponserFound = this->Shared()->repliers.FirstHandler(
-              fullyQualifiedTopic,
-              RequestT().GetTypeName(),
-              ReplyT().GetTypeName(),
-              repHandler);
+              fullyQualifiedTopic, kReqTypeName, kRepTypeName, repHandler);
       }
 
       // If the responser is within my process.
       if (localResponserFound)
       {
-        // There is a responser in my process, let's use it.
+        // There is a responser in my process, let's use it. The messages are
+        // handed over directly, without serializing them.
         ReplyT rep;
         bool result = repHandler->RunLocalCallback(_request, rep);
 
@@ -444,7 +671,7 @@ namespace ignition
       reqHandlerPtr->SetCallback(_cb);
 
       {
-        std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+        std::lock_guard<std::recursive_mutex> lk(this->Shared()->srvMutex);
 
         // Store the request handler.
         this->Shared()->requests.AddHandler(
@@ -455,7 +682,7 @@ namespace ignition
         if (this->Shared()->TopicPublishers(fullyQualifiedTopic, addresses))
         {
           this->Shared()->SendPendingRemoteReqs(fullyQualifiedTopic,
-            RequestT().GetTypeName(), ReplyT().GetTypeName());
+            kReqTypeName, kRepTypeName);
         }
         else
         {
@@ -463,7 +690,7 @@ namespace ignition
           if (!this->Shared()->DiscoverService(fullyQualifiedTopic))
           {
             std::cerr << "Node::Request(): Error discovering service ["
-                      << topic
+                      << _topic.Topic()
                       << "]. Did you forget to start the discovery service?"
                       << std::endl;
             return false;
@@ -523,38 +750,55 @@ namespace ignition
             ReplyT &_reply,
             bool &_result)
     {
-      // Topic remapping.
-      std::string topic = _topic;
-      this->Options().TopicRemap(_topic, topic);
+      return this->Request(this->Resolve(_topic), _request, _timeout, _reply,
+        _result);
+    }
 
-      std::string fullyQualifiedTopic;
-      if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    bool Node::Request(
+            const TopicName &_topic,
+            const RequestT &_request,
+            const unsigned int &_timeout,
+            ReplyT &_reply,
+            bool &_result)
+    {
+      if (!_topic.Valid())
       {
-        std::cerr << "Service [" << topic << "] is not valid." << std::endl;
+        std::cerr << "Service [" << _topic.Topic() << "] is not valid."
+                  << std::endl;
         return false;
       }
+      const std::string &fullyQualifiedTopic = _topic.FullyQualifiedName();
 
-      // Create a new request handler.
-      std::shared_ptr<ReqHandler<RequestT, ReplyT>> reqHandlerPtr(
-        new ReqHandler<RequestT, ReplyT>(this->NodeUuid()));
-
-      // Insert the request's parameters.
-      reqHandlerPtr->SetMessage(&_request);
-      reqHandlerPtr->SetResponse(&_reply);
+      // The services are created the first time they are used.
+      if (!this->Shared()->InitializeServices())
+        return false;
 
-      std::unique_lock<std::recursive_mutex> lk(this->Shared()->mutex);
+      std::unique_lock<std::recursive_mutex> lk(this->Shared()->srvMutex);
 
       // If the responser is within my process.
       IRepHandlerPtr repHandler;
       if (this->Shared()->repliers.FirstHandler(fullyQualifiedTopic,
         _request.GetTypeName(), _reply.GetTypeName(), repHandler))
       {
-        // There is a responser in my process, let's use it.
+        // There is a responser in my process, let's use it. The messages are
+        // handed over directly, without serializing them, and the shared
+        // mutex isn't held while the responser runs.
+        lk.unlock();
         _result = repHandler->RunLocalCallback(_request, _reply);
         return true;
       }
 
+      // Create a new request handler.
+      std::shared_ptr<ReqHandler<RequestT, ReplyT>> reqHandlerPtr(
+        new ReqHandler<RequestT, ReplyT>(this->NodeUuid()));
+
+      // Insert the request's parameters.
+      reqHandlerPtr->SetMessage(&_request);
+      reqHandlerPtr->SetResponse(&_reply);
+      reqHandlerPtr->SetTimeout(_timeout);
+
       // Store the request handler.
       this->Shared()->requests.AddHandler(
         fullyQualifiedTopic, this->NodeUuid(), reqHandlerPtr);
@@ -572,7 +816,7 @@ namespace ignition
         if (!this->Shared()->DiscoverService(fullyQualifiedTopic))
         {
           std::cerr << "Node::Request(): Error discovering service ["
-                    << topic
+                    << _topic.Topic()
                     << "]. Did you forget to start the discovery service?"
                     << std::endl;
           return false;
@@ -618,6 +862,65 @@ namespace ignition
       return this->Request(_topic, req, _timeout, _reply, _result);
     }
 
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    bool Node::RequestStream(
+      const std::string &_topic,
+      const RequestT &_request,
+      std::function<void(const ReplyT &)> _onReply,
+      std::function<void(const bool)> _onDone)
+    {
+      // Create a new request handler.
+      auto reqHandlerPtr =
+        std::make_shared<StreamReqHandler<RequestT, ReplyT>>(this->NodeUuid());
+
+      // Insert the request's parameters and the callbacks.
+      reqHandlerPtr->SetMessage(&_request);
+      reqHandlerPtr->SetCallbacks(_onReply, _onDone);
+
+      return this->RequestStreamHelper(_topic, reqHandlerPtr);
+    }
+
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    std::future<std::optional<ReplyT>> Node::RequestFuture(
+      const std::string &_topic,
+      const RequestT &_request)
+    {
+      auto promise = std::make_shared<std::promise<std::optional<ReplyT>>>();
+      std::future<std::optional<ReplyT>> future = promise->get_future();
+
+      std::function<void(const ReplyT &, const bool)> f =
+        [promise](const ReplyT &_reply, const bool _result)
+      {
+        if (_result)
+          promise->set_value(_reply);
+        else
+          promise->set_value(std::nullopt);
+      };
+
+      if (!this->Request(_topic, _request, f))
+        return std::future<std::optional<ReplyT>>();
+
+      return future;
+    }
+
+#ifdef __cpp_impl_coroutine
+    //////////////////////////////////////////////////
+    template<typename RequestT, typename ReplyT>
+    RequestAwaitable<ReplyT> Node::RequestAwait(
+      const std::string &_topic,
+      const RequestT &_request)
+    {
+      RequestAwaitable<ReplyT> awaitable;
+      std::function<void(const ReplyT &, const bool)> f = awaitable.Callback();
+      if (!this->Request(_topic, _request, f))
+        awaitable.Fail();
+
+      return awaitable;
+    }
+#endif
+
     //////////////////////////////////////////////////
     template<typename RequestT>
     bool Node::Request(
@@ -634,6 +937,85 @@ namespace ignition
       return this->Request<RequestT, ignition::msgs::Empty>(
             _topic, _request, f);
     }
+
+    //////////////////////////////////////////////////
+    template<typename RequestT>
+    bool Node::RequestBatch(
+        const std::string &_topic,
+        const std::vector<RequestT> &_requests)
+    {
+      const TopicName topic = this->Resolve(_topic);
+      if (!topic.Valid())
+      {
+        std::cerr << "Service [" << topic.Topic() << "] is not valid."
+                  << std::endl;
+        return false;
+      }
+      const std::string &fullyQualifiedTopic = topic.FullyQualifiedName();
+
+      if (_requests.empty())
+        return true;
+
+      // The services are created the first time they are used.
+      if (!this->Shared()->InitializeServices())
+        return false;
+
+      // Type names of the messages, built only once.
+      static const std::string kReqTypeName = RequestT().GetTypeName();
+      static const std::string kRepTypeName =
+        ignition::msgs::Empty().GetTypeName();
+
+      bool localResponserFound;
+      IRepHandlerPtr repHandler;
+      {
+        std::lock_guard<std::recursive_mutex> lk(this->Shared()->srvMutex);
+        localResponserFound = this->Shared()->repliers.FirstHandler(
+              fullyQualifiedTopic, kReqTypeName, kRepTypeName, repHandler);
+      }
+
+      // If the responser is within my process, run it with each request.
+      if (localResponserFound)
+      {
+        ignition::msgs::Empty rep;
+        for (const RequestT &request : _requests)
+          repHandler->RunLocalCallback(request, rep);
+        return true;
+      }
+
+      // Create a new request handler with all the requests.
+      std::shared_ptr<BatchReqHandler<RequestT, ignition::msgs::Empty>>
+        reqHandlerPtr(new BatchReqHandler<RequestT, ignition::msgs::Empty>(
+          this->NodeUuid()));
+      for (const RequestT &request : _requests)
+      {
+        if (!reqHandlerPtr->AddMessage(request))
+          return false;
+      }
+
+      std::lock_guard<std::recursive_mutex> lk(this->Shared()->srvMutex);
+
+      // Store the request handler.
+      this->Shared()->requests.AddHandler(
+        fullyQualifiedTopic, this->NodeUuid(), reqHandlerPtr);
+
+      // If the responser's address is known, make the request.
+      SrvAddresses_M addresses;
+      if (this->Shared()->TopicPublishers(fullyQualifiedTopic, addresses))
+      {
+        this->Shared()->SendPendingRemoteReqs(fullyQualifiedTopic,
+          kReqTypeName, kRepTypeName);
+      }
+      else if (!this->Shared()->DiscoverService(fullyQualifiedTopic))
+      {
+        std::cerr << "Node::RequestBatch(): Error discovering service ["
+                  << topic.Topic()
+                  << "]. Did you forget to start the discovery service?"
+                  << std::endl;
+        return false;
+      }
+
+      return true;
+    }
   }
 }
 
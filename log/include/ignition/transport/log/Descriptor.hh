@@ -77,6 +77,13 @@ namespace ignition
           const std::string &_topicName,
           const std::string &_msgType) const;
 
+        /// \brief Check if the messages are indexed by topic and time, which
+        /// lets the queries for a few topics skip the messages of the other
+        /// topics. The log files recorded by older versions have an index by
+        /// time only.
+        /// \return true if the log has the topic index
+        public: bool HasTopicTimeIndex() const;
+
         // The Log class is a friend so that it can construct a Descriptor
         friend class Log;
 
@@ -19,15 +19,21 @@
 #define IGNITION_TRANSPORT_LOG_LOG_HH_
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <ios>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Batch.hh>
 #include <ignition/transport/log/QueryOptions.hh>
 #include <ignition/transport/log/Descriptor.hh>
 #include <ignition/transport/log/Export.hh>
+#include <ignition/transport/log/LogOptions.hh>
 
 namespace ignition
 {
@@ -60,7 +66,8 @@ namespace ignition
 
         /// \brief Get the schema version of the opened log
         /// \return the current version of the schema in the log file
-        /// \return empty string if the log has not been opened
+        /// \return empty string if the log has not been opened, or if it's
+        /// a chunked log file open for writing
         public: std::string Version() const;
 
         /// \brief Open a log file
@@ -72,9 +79,128 @@ namespace ignition
         public: bool Open(const std::string &_file,
             std::ios_base::openmode _mode = std::ios_base::in);
 
+        /// \brief Open a log file with custom database settings
+        /// \param[in] _file path to log file
+        /// \param[in] _mode flag indicating read only or read/write
+        ///   Can use (in or out)
+        /// \param[in] _options Settings of the database. The journal mode,
+        ///   the synchronous mode, the page size and the transaction limits
+        ///   only apply when writing. The file format is detected when
+        ///   reading, see LogOptions::Format. A manifest written by the
+        ///   Recorder for its topic groups is opened as one read only log,
+        ///   whose messages are merged by time.
+        /// \return True if the log file was successfully opened, false
+        /// otherwise.
+        public: bool Open(const std::string &_file,
+            std::ios_base::openmode _mode, const LogOptions &_options);
+
+        /// \brief Open the parts of a split recording for reading, as one
+        /// log. The messages of a part must all be older than the messages
+        /// of the next part, which is how Recorder splits its recordings.
+        /// The log can't be written, and the topic ids of its Descriptor are
+        /// those of the first part that has each topic.
+        /// \param[in] _files paths to the parts, in order, e.g. the result
+        /// of SplitFiles()
+        /// \return True if all the parts were successfully opened, false
+        /// otherwise.
+        public: bool Open(const std::vector<std::string> &_files);
+
+        /// \brief Open the parts of a split recording for reading with
+        /// custom database settings, e.g. to memory map them with
+        /// LogOptions::SetMmapSize(). The message data is then read from the
+        /// mapping, without a system call or a copy into the page cache of
+        /// SQLite, when the message fits in its page of the file.
+        /// \param[in] _files paths to the parts, in order
+        /// \param[in] _options Settings of the databases, see the other
+        /// overloads
+        /// \return True if all the parts were successfully opened, false
+        /// otherwise.
+        public: bool Open(const std::vector<std::string> &_files,
+            const LogOptions &_options);
+
+        /// \brief Open several recordings for reading as one log, whose
+        /// messages are merged by time, e.g. the recordings of several
+        /// robots. Unlike the parts passed to Open(), the recordings may
+        /// overlap in time. The queries step through all the recordings at
+        /// once, holding a single message of each one, so nothing is copied
+        /// to a merged file. The log can't be written, and the topic ids of
+        /// its Descriptor are those of the first recording that has each
+        /// topic.
+        /// \param[in] _files paths to the recordings. Each one is opened with
+        /// its parts, see SplitFiles(), and may be a manifest of topic
+        /// groups. The recordings that come first win the ties.
+        /// \param[in] _options Settings of the databases, see Open()
+        /// \return True if all the recordings were successfully opened, false
+        /// otherwise.
+        public: bool OpenMerged(const std::vector<std::string> &_files,
+            const LogOptions &_options = LogOptions());
+
+        /// \brief Callback receiving the chunks of a streamed log, see
+        /// OpenStream().
+        /// \param[in] _data The chunk, after a copy of the file header
+        /// \param[in] _size Size of the data (bytes)
+        /// \return false if the chunk was lost
+        public: using ChunkSink =
+          std::function<bool(const char *_data, std::size_t _size)>;
+
+        /// \brief Stream a chunked log to a callback instead of writing a
+        /// file, e.g. to send it to a LogServer. Each chunk is passed to the
+        /// callback once it's complete, and holds all the topics of the log,
+        /// so the chunks that arrive make a valid log file even if some of
+        /// them are lost. The log can only be written.
+        /// \param[in] _name Name of the log, returned by Filename()
+        /// \param[in] _sink Callback receiving the chunks
+        /// \param[in] _options Settings of the log. The format is always
+        /// LogOptions::Format::CHUNKED.
+        /// \return True if the log was opened, false otherwise.
+        public: bool OpenStream(const std::string &_name,
+            const ChunkSink &_sink, const LogOptions &_options);
+
+        /// \brief Get the name of a part of a split recording, see
+        /// Recorder::SetSplitSize(). The first part is named like the
+        /// recording, and the next ones have their number before the
+        /// extension, e.g. "run.tlog", "run.1.tlog", "run.2.tlog".
+        /// \param[in] _file path of the recording
+        /// \param[in] _part number of the part, starting at 0
+        /// \return The path of the part
+        public: static std::string PartFilename(const std::string &_file,
+                                                const std::size_t _part);
+
+        /// \brief Find the parts of a split recording.
+        /// \param[in] _file path of the recording, i.e. of its first part
+        /// \return _file, followed by the next parts that exist, in order
+        public: static std::vector<std::string> SplitFiles(
+            const std::string &_file);
+
+        /// \brief Get the name of the log file of a topic group of a
+        /// recording, see Recorder::AddTopicGroup(). The name of the group is
+        /// inserted before the extension, e.g. "run.camera.tlog".
+        /// \param[in] _file path of the recording
+        /// \param[in] _group name of the group
+        /// \return The path of the log file of the group
+        public: static std::string GroupFilename(const std::string &_file,
+                                                 const std::string &_group);
+
+        /// \brief Finalize a log file written with deferred indexes, see
+        /// LogOptions::SetDeferIndexes(): build the indexes of the messages
+        /// and the summary of the topics if they are missing, then update
+        /// the statistics of the query planner (ANALYZE). The log files
+        /// finalized already are only analyzed again, and the chunked log
+        /// files are left as they are. It must not be open for writing
+        /// meanwhile.
+        /// \param[in] _file Path of the log file, or of the manifest of a
+        /// recording split in groups, which finalizes every file listed
+        /// \param[in] _vacuum True to rebuild the file afterwards too
+        /// (VACUUM), so it's compact and in order, which takes as long as
+        /// copying it
+        /// \return true if the log file was finalized
+        public: static bool Finalize(const std::string &_file,
+                                     const bool _vacuum = false);
+
         /// \brief Get the name of the log file.
-        /// \return The name of the log file, or an empty string if Open has
-        /// not been successfully called.
+        /// \return The name of the log file, or of the first part of a split
+        /// recording, or an empty string if Open has not been successfully
+        /// called.
         public: std::string Filename() const;
 
         /// \brief Get a Descriptor for this log. The Descriptor will be
@@ -96,6 +222,62 @@ namespace ignition
             const std::string &_topic, const std::string &_type,
             const void *_data, std::size_t _len);
 
+        /// \brief Get the id of a topic in the log file, inserting the topic
+        /// if it is not in the log yet. Messages can then be inserted with the
+        /// id instead of looking the topic up each time.
+        /// \param[in] _topic Name of the topic
+        /// \param[in] _type Name of the message type
+        /// \return The id of the topic, or -1 if it could not be produced.
+        /// The id is only valid for this log file.
+        public: int64_t InsertOrGetTopicId(
+            const std::string &_topic, const std::string &_type);
+
+        /// \brief Insert a message into the log file
+        /// \param[in] _time Time the message was received (ns since Unix epoch)
+        /// \param[in] _topicId Id of the topic and message type, see
+        /// InsertOrGetTopicId()
+        /// \param[in] _data pointer to a buffer containing the message data
+        /// \param[in] _len number of bytes of data
+        /// \return true if the message was successfully inserted
+        public: bool InsertMessage(
+            const std::chrono::nanoseconds &_time, int64_t _topicId,
+            const void *_data, std::size_t _len);
+
+        /// \brief A message to insert into a log file, see InsertMessages().
+        /// It doesn't own its data, which must stay valid until the message
+        /// is inserted.
+        public: struct MessageRecord
+        {
+          /// \brief Time the message was received (ns since Unix epoch)
+          std::chrono::nanoseconds time;
+
+          /// \brief Name of the topic the message was on
+          std::string_view topic;
+
+          /// \brief Name of the message type
+          std::string_view type;
+
+          /// \brief pointer to a buffer containing the message data
+          const void *data = nullptr;
+
+          /// \brief number of bytes of data
+          std::size_t len = 0;
+
+          /// \brief Id of the topic and message type, see
+          /// InsertOrGetTopicId(). If it's negative, the topic and the type
+          /// are used instead.
+          int64_t topicId = -1;
+        };
+
+        /// \brief Insert several messages into the log file. This is much
+        /// faster than inserting them one by one: the messages are written in
+        /// the same transaction, and the topic of consecutive messages is only
+        /// looked up once.
+        /// \param[in] _records The messages to insert
+        /// \return The number of messages that were successfully inserted
+        public: std::size_t InsertMessages(
+            const std::vector<MessageRecord> &_records);
+
         /// \brief Get messages according to the specified options. By default,
         /// it will query all messages over the entire time range of the log.
         /// \param[in] _options A QueryOptions type to indicate what kind of
@@ -104,6 +286,82 @@ namespace ignition
         public: Batch QueryMessages(
             const QueryOptions &_options = AllTopics());
 
+        /// \brief Get the messages like QueryMessages(), but without their
+        /// data. Only the time, topic and type of the messages are read, so
+        /// the pages of the file holding the data are never loaded, and
+        /// Message::Data() is empty. Custom QueryOptions that don't use
+        /// QueryOptions::StandardMessageQueryPreamble() still read the data.
+        /// \param[in] _options A QueryOptions type to indicate what kind of
+        /// messages you would like to query.
+        /// \return A Batch which matches the requested QueryOptions.
+        public: Batch QueryHeaders(
+            const QueryOptions &_options = AllTopics());
+
+        /// \brief Get the messages like QueryMessages(), split into batches
+        /// of disjoint slices of time, to process them in parallel. Every
+        /// batch queries the log files through SQLite connections of its
+        /// own, so the batches can be iterated concurrently, from one thread
+        /// each. The logs that can't be opened again, like the chunked log
+        /// files and the logs open for writing, share their connection, which
+        /// SQLite serializes.
+        /// \param[in] _options A QueryOptions type to indicate what kind of
+        /// messages you would like to query.
+        /// \param[in] _partitions The number of batches, or 0 for one per
+        /// hardware thread. Fewer batches are returned if the time range is
+        /// shorter than that, in nanoseconds.
+        /// \return The batches, in the order of their slices of time. Empty if
+        /// the log is invalid or a query failed.
+        public: std::vector<Batch> QueryPartitions(
+            const QueryOptions &_options, std::size_t _partitions = 0);
+
+        /// \brief Copy the messages of a query to a new log file, e.g. a few
+        /// topics over a slice of time. The rows are copied from database
+        /// to database as they are stored, without decoding the messages,
+        /// when this log is a single read only file whose messages are
+        /// framed like the new one, see LogOptions::SetMessageCompression().
+        /// Otherwise, e.g. for a split recording, the messages are read and
+        /// inserted again.
+        /// \param[in] _file Path of the new log file. It must not exist.
+        /// \param[in] _options The messages to copy
+        /// \param[in] _fileOptions Settings of the new log file
+        /// \return true if the new log file has all the messages of the
+        /// query
+        public: bool Extract(const std::string &_file,
+            const QueryOptions &_options = AllTopics(),
+            const LogOptions &_fileOptions = LogOptions());
+
+        /// \brief Statistics of the messages of a topic, see
+        /// TopicSummaries().
+        public: struct TopicSummary
+        {
+          /// \brief Name of the topic
+          std::string topic;
+
+          /// \brief Name of the message type
+          std::string type;
+
+          /// \brief Number of messages
+          uint64_t messages = 0;
+
+          /// \brief Size of the messages as stored in the file, compressed
+          /// or not, in bytes
+          uint64_t bytes = 0;
+
+          /// \brief Time of the first message, or zero if there is none
+          std::chrono::nanoseconds firstTime{0};
+
+          /// \brief Time of the last message, or zero if there is none
+          std::chrono::nanoseconds lastTime{0};
+        };
+
+        /// \brief Get the statistics of every topic (and message type) of
+        /// the log, with a single pass over the index of the messages that
+        /// doesn't load their data. The topics without messages are listed
+        /// too.
+        /// \return The statistics, sorted by topic and type. Empty if the
+        /// log is invalid or the query failed.
+        public: std::vector<TopicSummary> TopicSummaries() const;
+
         /// \brief Get start time of the log, or in other words the
         /// time of the first message found in the log
         /// \return start time of the log, or zero if the log is not
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_LOGOPTIONS_HH_
+#define IGNITION_TRANSPORT_LOG_LOGOPTIONS_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <ignition/transport/config.hh>
+#include <ignition/transport/log/Export.hh>
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Settings of the SQLite database of a log file, used when it
+      /// is opened. The defaults keep the SQLite defaults and end the
+      /// recording transactions twice per second. See HighThroughput() for
+      /// a profile suited to recording lots of data on fast disks.
+      class IGNITION_TRANSPORT_LOG_VISIBLE LogOptions
+      {
+        /// \brief How SQLite journals the transactions, see
+        /// https://www.sqlite.org/pragma.html#pragma_journal_mode
+        public: enum class JournalMode
+        {
+          /// \brief Keep the SQLite default (DELETE).
+          DEFAULT,
+
+          /// \brief Write ahead log. The writes are appended to a separate
+          /// file, which is faster for sustained writing.
+          WAL,
+
+          /// \brief Keep the journal in memory. A crash in the middle of a
+          /// transaction may corrupt the log.
+          MEMORY,
+
+          /// \brief No journal. A crash in the middle of a transaction may
+          /// corrupt the log.
+          OFF
+        };
+
+        /// \brief How often SQLite waits for the data to reach the disk, see
+        /// https://www.sqlite.org/pragma.html#pragma_synchronous
+        public: enum class SyncMode
+        {
+          /// \brief Keep the SQLite default (FULL).
+          DEFAULT,
+
+          /// \brief Never wait. The log may be corrupted if the computer
+          /// loses power, but not if the process crashes.
+          OFF,
+
+          /// \brief Wait at the critical moments only. Safe with WAL.
+          NORMAL,
+
+          /// \brief Wait on every transaction.
+          FULL
+        };
+
+        /// \brief Format of the log files.
+        public: enum class Format
+        {
+          /// \brief A SQLite database, with a row per message.
+          SQLITE,
+
+          /// \brief Append only chunks of time sorted messages, each one
+          /// with an index of its topics and messages at its end. It avoids
+          /// the random writes of the database at high message rates. When
+          /// a chunked log file is opened for reading, its index is loaded
+          /// into a temporary database, and the messages are read from the
+          /// memory mapped file. Log files being written in this format
+          /// can't be queried until they are opened again for reading.
+          CHUNKED
+        };
+
+        /// \brief How the messages are compressed. The value identifies the
+        /// method in the log files, so it must never change.
+        public: enum class Compression
+        {
+          /// \brief Store the messages as they are.
+          NONE = 0,
+
+          /// \brief zlib (deflate). Only available if the library was built
+          /// with zlib.
+          ZLIB = 1
+        };
+
+        /// \brief Default constructor.
+        public: LogOptions();
+
+        /// \brief Copy constructor.
+        /// \param[in] _other The options to copy.
+        public: LogOptions(const LogOptions &_other);
+
+        /// \brief Copy assignment operator.
+        /// \param[in] _other The options to copy.
+        /// \return Reference to these options.
+        public: LogOptions &operator=(const LogOptions &_other);
+
+        /// \brief Destructor.
+        public: ~LogOptions();
+
+        /// \brief Options for recording lots of data on fast disks: write
+        /// ahead log, no waiting for the disk, 64 KiB pages, a 64 MiB cache
+        /// and transactions of up to 64 MiB. The log survives a crash of the
+        /// process, but not a power loss.
+        /// \return The options.
+        public: static LogOptions HighThroughput();
+
+        /// \brief Get the journal mode.
+        /// \return The journal mode.
+        public: JournalMode Journal() const;
+
+        /// \brief Set the journal mode.
+        /// \param[in] _mode The journal mode.
+        public: void SetJournal(const JournalMode _mode);
+
+        /// \brief Get the synchronous mode.
+        /// \return The synchronous mode.
+        public: SyncMode Synchronous() const;
+
+        /// \brief Set the synchronous mode.
+        /// \param[in] _mode The synchronous mode.
+        public: void SetSynchronous(const SyncMode _mode);
+
+        /// \brief Get the page size of new log files.
+        /// \return The page size in bytes, or 0 for the SQLite default.
+        public: std::size_t PageSize() const;
+
+        /// \brief Set the page size of new log files. It must be a power of
+        /// two between 512 and 65536. It has no effect on existing files.
+        /// \param[in] _bytes The page size in bytes, or 0 for the SQLite
+        /// default.
+        public: void SetPageSize(const std::size_t _bytes);
+
+        /// \brief Get the size of the page cache.
+        /// \return The size in bytes, or 0 for the SQLite default.
+        public: std::size_t CacheSize() const;
+
+        /// \brief Set the size of the page cache.
+        /// \param[in] _bytes The size in bytes, or 0 for the SQLite default.
+        public: void SetCacheSize(const std::size_t _bytes);
+
+        /// \brief Get the size of the file that is memory mapped.
+        /// \return The size in bytes, or 0 for not using memory mapping.
+        public: std::size_t MmapSize() const;
+
+        /// \brief Set the size of the file that is memory mapped, see
+        /// https://www.sqlite.org/mmap.html
+        /// \param[in] _bytes The size in bytes, or 0 for not using memory
+        /// mapping.
+        public: void SetMmapSize(const std::size_t _bytes);
+
+        /// \brief Get the maximum duration of a transaction.
+        /// \return The duration.
+        public: std::chrono::milliseconds TransactionPeriod() const;
+
+        /// \brief Set the maximum duration of a transaction. The messages
+        /// inserted in a log file are committed together, when a transaction
+        /// ends.
+        /// \param[in] _period The duration.
+        public: void SetTransactionPeriod(
+                    const std::chrono::milliseconds &_period);
+
+        /// \brief Get the maximum size of the messages of a transaction.
+        /// \return The size in bytes, or 0 for no limit.
+        public: std::size_t TransactionMaxBytes() const;
+
+        /// \brief Set the maximum size of the messages of a transaction. The
+        /// transaction ends once its messages reach that size.
+        /// \param[in] _bytes The size in bytes, or 0 for no limit.
+        public: void SetTransactionMaxBytes(const std::size_t _bytes);
+
+        /// \brief Get the maximum number of messages of a transaction.
+        /// \return The number of messages, or 0 for no limit.
+        public: uint64_t TransactionMaxMessages() const;
+
+        /// \brief Set the maximum number of messages of a transaction.
+        /// \param[in] _count The number of messages, or 0 for no limit.
+        public: void SetTransactionMaxMessages(const uint64_t _count);
+
+        /// \brief Get the format of new log files.
+        /// \return The format.
+        public: Format FileFormat() const;
+
+        /// \brief Set the format of new log files. The format of the log
+        /// files that are read is detected. Default is SQLITE.
+        /// \param[in] _format The format.
+        public: void SetFileFormat(const Format _format);
+
+        /// \brief Get the size of the chunks of the chunked log files.
+        /// \return The size in bytes.
+        public: std::size_t ChunkSize() const;
+
+        /// \brief Set the size of the chunks of the chunked log files. A
+        /// chunk is written once its messages reach that size, or when a
+        /// transaction would end, see SetTransactionPeriod(). Default is
+        /// 4 MiB.
+        /// \param[in] _bytes The size in bytes.
+        public: void SetChunkSize(const std::size_t _bytes);
+
+        /// \brief Get the compression of the messages of new log files.
+        /// \return The compression method.
+        public: Compression MessageCompression() const;
+
+        /// \brief Set the compression of the messages of new log files.
+        /// The compressed log files use the schema 0.2.0, which can't be read
+        /// by older versions of this library. The messages are decompressed
+        /// transparently when they are read. Default is NONE.
+        /// \param[in] _compression The compression method.
+        public: void SetMessageCompression(const Compression _compression);
+
+        /// \brief Get the compression level.
+        /// \return The level.
+        public: int CompressionLevel() const;
+
+        /// \brief Set the compression level, from 1 (fastest) to 9
+        /// (smallest). Default is 1.
+        /// \param[in] _level The level.
+        public: void SetCompressionLevel(const int _level);
+
+        /// \brief Get the size of the smallest message that is compressed.
+        /// \return The size in bytes.
+        public: std::size_t CompressionMinSize() const;
+
+        /// \brief Set the size of the smallest message that is compressed.
+        /// Smaller messages rarely get smaller, so they are stored as they
+        /// are. Default is 128 bytes.
+        /// \param[in] _bytes The size in bytes.
+        public: void SetCompressionMinSize(const std::size_t _bytes);
+
+        /// \brief Get the number of threads compressing the messages.
+        /// \return The number of threads, or 0 for one per core.
+        public: std::size_t CompressionThreads() const;
+
+        /// \brief Set the number of threads compressing the messages
+        /// inserted together with Log::InsertMessages(), including the one
+        /// inserting them. Default is 0, one per core.
+        /// \param[in] _threads The number of threads, or 0 for one per core.
+        public: void SetCompressionThreads(const std::size_t _threads);
+
+        /// \brief Check if the indexes of the messages are left out of new
+        /// log files, see SetDeferIndexes().
+        /// \return True if the indexes are deferred.
+        public: bool DeferIndexes() const;
+
+        /// \brief Set whether new log files are created without the indexes
+        /// of the messages by time and topic, which every insert would
+        /// update. The messages are inserted faster, and the queries scan
+        /// and sort them until Log::Finalize() builds the indexes. The
+        /// Recorder finalizes its files in the background once they are
+        /// closed. Only applies to the SQLite format. Default is false.
+        /// \param[in] _defer True to defer the indexes.
+        public: void SetDeferIndexes(const bool _defer);
+
+        /// \internal Implementation for this class
+        private: class Implementation;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+        /// \brief Private implementation
+        private: std::unique_ptr<Implementation> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+      };
+      }
+    }
+  }
+}
+#endif
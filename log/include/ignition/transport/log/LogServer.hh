@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_LOGSERVER_HH_
+#define IGNITION_TRANSPORT_LOG_LOGSERVER_HH_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <ignition/transport/config.hh>
+#include <ignition/transport/log/Export.hh>
+
+namespace ignition
+{
+  namespace transport
+  {
+    namespace log
+    {
+      // Inline bracket to help doxygen filtering.
+      inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
+      //
+      /// \brief Receives a recording streamed by Recorder::StartRemote(),
+      /// e.g. on a machine with more disk bandwidth than the robot, and
+      /// writes it to a chunked log file, which is read like any other log
+      /// file. The chunks are requests of a service, replied once they are
+      /// written.
+      class IGNITION_TRANSPORT_LOG_VISIBLE LogServer
+      {
+        /// \brief Constructor.
+        public: LogServer();
+
+        /// \brief Destructor. Stops receiving.
+        public: ~LogServer();
+
+        /// \brief Advertise the service receiving the chunks. The log file
+        /// is created when the first chunk arrives, since the chunks tell
+        /// whether the messages are compressed.
+        /// \param[in] _service Name of the service, as given to
+        /// Recorder::StartRemote()
+        /// \param[in] _file Path of the log file, overwritten if it exists
+        /// \return True if the service was advertised, false if it couldn't
+        /// be or if the server was already started.
+        public: bool Start(const std::string &_service,
+                           const std::string &_file);
+
+        /// \brief Stop receiving, and close the log file.
+        public: void Stop();
+
+        /// \brief Get the number of chunks written.
+        /// \return The number of chunks
+        public: uint64_t ReceivedChunks() const;
+
+        /// \brief Get the number of chunks rejected because they were
+        /// invalid, or compressed differently than the first one, or
+        /// couldn't be written.
+        /// \return The number of chunks
+        public: uint64_t RejectedChunks() const;
+
+        /// \internal Implementation of this class
+        private: class Implementation;
+
+#ifdef _WIN32
+// Disable warning C4251 which is triggered by
+// std::*
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+        /// \internal Pointer to the implementation
+        private: std::unique_ptr<Implementation> dataPtr;
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+      };
+      }
+    }
+  }
+}
+#endif
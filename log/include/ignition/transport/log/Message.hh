@@ -18,8 +18,10 @@
 #define IGNITION_TRANSPORT_LOG_MESSAGE_HH_
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Export.hh>
@@ -55,11 +57,14 @@ namespace ignition
         /// \param[in] _typeLen the length of _type
         /// \param[in] _topic the name of the topic the message was published to
         /// \param[in] _topicLen the length of _topic
+        /// \param[in] _topicId the id of the topic and message type, see
+        /// TopicId()
         public: Message(
             const std::chrono::nanoseconds &_timeRecv,
             const void *_data, std::size_t _dataLen,
             const char *_type, std::size_t _typeLen,
-            const char *_topic, std::size_t _topicLen);
+            const char *_topic, std::size_t _topicLen,
+            int64_t _topicId = -1);
 
         /// \brief No move constructor to prevent borrowed pointers from
         /// living beyond creator's expectations.
@@ -84,6 +89,29 @@ namespace ignition
         /// \return The topic for the message
         public: std::string Topic() const;
 
+        /// \brief Get the message data without copying it.
+        /// \return A view of the raw data for this message. It points into
+        /// the current row of the query, and is valid until the iterator
+        /// that returned this message moves.
+        public: std::string_view DataView() const;
+
+        /// \brief Get the message type without copying it.
+        /// \return A view of the message type name, valid until the iterator
+        /// that returned this message moves.
+        public: std::string_view TypeView() const;
+
+        /// \brief Get the topic name without copying it.
+        /// \return A view of the topic, valid until the iterator that
+        /// returned this message moves.
+        public: std::string_view TopicView() const;
+
+        /// \brief Get the id of the topic and message type, to look up
+        /// something per topic without comparing names.
+        /// \return The id of the topic and type in the Descriptor of the log
+        /// that was queried, see Descriptor::TopicId(), or -1 if the query
+        /// didn't use QueryOptions::StandardMessageQueryPreamble().
+        public: int64_t TopicId() const;
+
         /// \brief Return the time the message was received
         /// \return The time the message was received
         public: const std::chrono::nanoseconds &TimeReceived() const;
@@ -21,9 +21,13 @@
 #include <memory>
 #include <regex>
 #include <string>
+#include <vector>
 
+#include <ignition/transport/Clock.hh>
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Export.hh>
+#include <ignition/transport/log/Log.hh>
+#include <ignition/transport/log/LogOptions.hh>
 #include <ignition/transport/NodeOptions.hh>
 
 namespace ignition
@@ -51,6 +55,39 @@ namespace ignition
         public: explicit Playback(const std::string &_file,
                                const NodeOptions &_nodeOptions = NodeOptions());
 
+        /// \brief Constructor for a split recording, see Log::SplitFiles()
+        /// \param[in] _files paths to the parts of the recording, in order
+        public: explicit Playback(const std::vector<std::string> &_files,
+                               const NodeOptions &_nodeOptions = NodeOptions());
+
+        /// \brief Constructor with custom settings of the log file, e.g. to
+        /// memory map it for repeated playbacks, see
+        /// LogOptions::SetMmapSize().
+        /// \param[in] _files paths to the parts of the recording, in order
+        /// \param[in] _logOptions Settings of the log file, see Log::Open()
+        /// \param[in] _nodeOptions Options of the node that publishes
+        public: Playback(const std::vector<std::string> &_files,
+                         const LogOptions &_logOptions,
+                         const NodeOptions &_nodeOptions = NodeOptions());
+
+        /// \brief Constructor of a playback of a log that's already open,
+        /// e.g. several recordings merged by time with Log::OpenMerged().
+        /// The log is shared with the playback handles, and must not be
+        /// written while they play it back.
+        /// \param[in] _log The log file, opened for reading
+        /// \param[in] _nodeOptions Options of the node that publishes
+        public: explicit Playback(const std::shared_ptr<Log> &_log,
+                               const NodeOptions &_nodeOptions = NodeOptions());
+
+        /// \brief Constructor of a playback of the log of another one,
+        /// without opening it again, e.g. to play it back into another
+        /// partition with StartShared(). The topics, rate and backpressure
+        /// of _other are not copied.
+        /// \param[in] _other The playback whose log is played back
+        /// \param[in] _nodeOptions Options of the node that publishes
+        public: Playback(const Playback &_other,
+                         const NodeOptions &_nodeOptions);
+
         /// \brief move constructor
         /// \param[in] _old the instance being moved into this one
         public: Playback(Playback &&_old);  // NOLINT
@@ -92,6 +129,69 @@ namespace ignition
             std::chrono::seconds(1),
             bool _msgWaiting = true) const;
 
+        /// \brief Begin playing messages as a clock advances, instead of
+        /// the steady clock, e.g. the simulation time of a NetworkClock. The
+        /// playback starts once the clock is ready, and publishes each
+        /// message when the clock has advanced as much as the log since the
+        /// first message, see PlaybackHandle::SetRate(). So a simulator that
+        /// runs faster than real time replays the log faster too. The clock
+        /// is checked every millisecond, or at once when
+        /// PlaybackHandle::NotifyClock() is called, e.g. after each step of
+        /// a simulator, to replay in lock step with it.
+        /// \param[in] _clock The clock, or nullptr for the steady clock. Its
+        /// lifetime must exceed that of the playback.
+        /// \param[in] _waitAfterAdvertising How long to wait before the
+        /// publications begin after advertising the topics that will be
+        /// played back, in real time.
+        /// \param[in] _msgWaiting True to wait between publication of
+        /// messages based on the message timestamps.
+        /// \return A handle for managing the playback of the log, or nullptr
+        /// if an error prevents the playback from starting, see the other
+        /// overload.
+        public: [[nodiscard]] PlaybackHandlePtr Start(const Clock *_clock,
+          const std::chrono::nanoseconds &_waitAfterAdvertising =
+            std::chrono::seconds(1),
+            bool _msgWaiting = true) const;
+
+        /// \brief Begin playing messages of several playbacks of the same
+        /// log at once, each with its own topics, node options, rate and
+        /// backpressure, e.g. to replay a log into several partitions for a
+        /// comparison. The log is read once for all of them: each message
+        /// is read and copied a single time, then handed over to every
+        /// playback of its topic. A playback reads at most a thousand
+        /// messages ahead of the others, so a paused one holds them back
+        /// until it resumes or stops. A playback that seeks reads the log on
+        /// its own afterwards. The seeks of all of them are relative to the
+        /// first message of all their topics.
+        /// \param[in] _playbacks The playbacks, which must share their log,
+        /// see Playback(const Playback &, const NodeOptions &)
+        /// \param[in] _waitAfterAdvertising How long to wait before the
+        /// publications begin after advertising the topics of all the
+        /// playbacks.
+        /// \param[in] _msgWaiting True to wait between publication of
+        /// messages based on the message timestamps.
+        /// \return A handle for each playback, in the order of _playbacks,
+        /// or an empty vector if an error prevents the playbacks from
+        /// starting.
+        public: [[nodiscard]] static std::vector<PlaybackHandlePtr>
+          StartShared(const std::vector<const Playback *> &_playbacks,
+            const std::chrono::nanoseconds &_waitAfterAdvertising =
+              std::chrono::seconds(1),
+            bool _msgWaiting = true);
+
+        /// \brief Play the log into the subscribers of this process, without
+        /// publishing it: the messages go straight to their callbacks, in the
+        /// order they were recorded, without waiting between them. Every
+        /// callback runs in the calling thread and returns before the next
+        /// message, unless its subscription is queued, see
+        /// SubscribeOptions::SetQueueSize(). So the log is processed as fast
+        /// as the callbacks go, and the same way every time. The
+        /// subscriptions must be made before calling this, in the partition
+        /// of the node options of the playback.
+        /// \return Number of messages delivered, or -1 if this Playback
+        /// object is not valid.
+        public: int64_t PlayOffline() const;
+
         /// \brief Check if this Playback object has a valid log to play back
         /// \return true if this has a valid log to play back, otherwise false.
         public: bool Valid() const;
@@ -135,6 +235,32 @@ namespace ignition
         /// due to this function call.
         public: int64_t RemoveTopic(const std::regex &_topic);
 
+        /// \brief Set how fast the playbacks started afterwards replay the
+        /// log, see PlaybackHandle::SetRate().
+        /// \param[in] _rate Playback rate, clamped to [0.1, 100]. 1 plays
+        /// the log in real time (the default).
+        public: void SetRate(const double _rate);
+
+        /// \brief Get the rate of the playbacks started afterwards.
+        /// \return The playback rate
+        public: double Rate() const;
+
+        /// \brief Make the playbacks started afterwards wait for the
+        /// subscribers of this process, instead of dropping messages, when
+        /// _depth messages of a topic are waiting for delivery. This is the
+        /// way to replay a log as fast as possible (see Start()) without
+        /// losing messages in a subscriber that processes them. The messages
+        /// sent to other processes are not held back.
+        /// \param[in] _depth Maximum number of messages waiting per topic,
+        /// 0 to disable (the default)
+        /// \sa AdvertiseMessageOptions::SetLocalQueueDepth
+        public: void SetBackpressure(const std::size_t _depth);
+
+        /// \brief Get the backpressure depth, see SetBackpressure().
+        /// \return Maximum number of messages waiting per topic, 0 if
+        /// disabled
+        public: std::size_t Backpressure() const;
+
         /// \internal Implementation of this class
         private: class Implementation;
 
@@ -182,6 +308,23 @@ namespace ignition
         /// \brief Check pause status
         public: bool IsPaused() const;
 
+        /// \brief Change how fast the log is replayed. The time between two
+        /// messages is divided by the rate, e.g. 10 replays an hour of log
+        /// in six minutes. Steps are measured in log time, so they last
+        /// shorter too. It has no effect when the playback publishes as
+        /// fast as possible, see Playback::Start().
+        /// \param[in] _rate Playback rate, clamped to [0.1, 100]
+        public: void SetRate(const double _rate);
+
+        /// \brief Get how fast the log is replayed.
+        /// \return The playback rate
+        public: double Rate() const;
+
+        /// \brief Check the clock of the playback now, see
+        /// Playback::Start(const Clock *). A playback driven by the steady
+        /// clock doesn't need it.
+        public: void NotifyClock();
+
         /// \brief Block until playback runs out of messages to publish
         public: void WaitUntilFinished();
 
@@ -17,7 +17,10 @@
 #ifndef IGNITION_TRANSPORT_LOG_RECORDER_HH_
 #define IGNITION_TRANSPORT_LOG_RECORDER_HH_
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <regex>
 #include <set>
@@ -26,6 +29,7 @@
 #include <ignition/transport/Clock.hh>
 #include <ignition/transport/config.hh>
 #include <ignition/transport/log/Export.hh>
+#include <ignition/transport/log/LogOptions.hh>
 
 namespace ignition
 {
@@ -45,6 +49,7 @@ namespace ignition
         INVALID_TOPIC = -4,
         TOPIC_NOT_FOUND = -5,
         ALREADY_SUBSCRIBED_TO_TOPIC = -6,
+        NOT_RECORDING = -7,
       };
 
       /// \brief Records ignition transport topics
@@ -53,6 +58,73 @@ namespace ignition
       /// multiple thread safety, subscribing to topics
       class IGNITION_TRANSPORT_LOG_VISIBLE Recorder
       {
+        /// \brief Counters of the messages of a recorded topic.
+        public: struct TopicStatistics
+        {
+          /// \brief Messages received.
+          public: uint64_t receivedMsgs = 0;
+
+          /// \brief Messages dropped because the buffer was full.
+          public: uint64_t droppedMsgs = 0;
+
+          /// \brief Size of the dropped messages, in bytes.
+          public: uint64_t droppedBytes = 0;
+        };
+
+        /// \brief Counters of a recording, e.g. to check that it's complete
+        /// before using it: no message was dropped or failed to be written.
+        /// They are reset by Start().
+        public: struct Statistics
+        {
+          /// \brief Messages received while recording.
+          public: uint64_t receivedMsgs = 0;
+
+          /// \brief Messages written to the log file.
+          public: uint64_t writtenMsgs = 0;
+
+          /// \brief Messages that couldn't be written to the log file.
+          public: uint64_t failedMsgs = 0;
+
+          /// \brief Messages dropped because the buffer was full, see
+          /// SetBufferSize().
+          public: uint64_t droppedMsgs = 0;
+
+          /// \brief Size of the dropped messages, in bytes.
+          public: uint64_t droppedBytes = 0;
+
+          /// \brief Size of the messages in the buffer, in bytes.
+          public: std::size_t bufferedBytes = 0;
+
+          /// \brief Most bytes that have been in the buffer.
+          public: std::size_t maxBufferedBytes = 0;
+
+          /// \brief Messages in the buffer.
+          public: std::size_t queuedMsgs = 0;
+
+          /// \brief Most messages that have been in the buffer.
+          public: std::size_t maxQueuedMsgs = 0;
+
+          /// \brief How long the oldest message in the buffer has waited to
+          /// be written, by the clock of the recorder.
+          public: std::chrono::nanoseconds writerLag{0};
+
+          /// \brief Longest that a message waited to be written.
+          public: std::chrono::nanoseconds maxWriterLag{0};
+
+          /// \brief Chunks acknowledged by the LogServer, see StartRemote().
+          public: uint64_t sentChunks = 0;
+
+          /// \brief Chunks dropped because the spill buffer was full, or
+          /// rejected by the LogServer.
+          public: uint64_t droppedChunks = 0;
+
+          /// \brief Size of the chunks waiting to be sent to the LogServer.
+          public: std::size_t spilledBytes = 0;
+
+          /// \brief Counters of each subscribed topic, by topic name.
+          public: std::map<std::string, TopicStatistics> topics;
+        };
+
         /// \brief Default constructor
         public: Recorder();
 
@@ -77,11 +149,88 @@ namespace ignition
         /// already existed, this will return FAILED_TO_OPEN.
         public: RecorderError Start(const std::string &_file);
 
+        /// \brief Begin recording topics with custom database settings, e.g.
+        /// LogOptions::HighThroughput() for recording lots of data.
+        /// \param[in] _file path to log file
+        /// \param[in] _options Settings of the log file
+        /// \return NO_ERROR if recording was successfully started. If the file
+        /// already existed, this will return FAILED_TO_OPEN.
+        public: RecorderError Start(const std::string &_file,
+                                    const LogOptions &_options);
+
+        /// \brief Begin recording topics to a LogServer instead of a local
+        /// file, so recording doesn't compete for the disk bandwidth of the
+        /// machine. The messages are batched into chunks of
+        /// LogOptions::ChunkSize() bytes, compressed as set by _options, and
+        /// sent to the service of the server by a thread of the recorder.
+        /// The chunks wait in a spill buffer until the server acknowledges
+        /// them, so they are sent again when a link that dropped comes back,
+        /// and the oldest ones are dropped once the buffer holds _spillSize
+        /// MB. The recording isn't split, and the topics of the groups are
+        /// recorded with the others. Stop() waits up to kRemoteCloseTimeout
+        /// for the chunks left in the buffer to be sent.
+        /// \param[in] _service Name of the service of the LogServer
+        /// \param[in] _options Settings of the log. The format is always
+        /// LogOptions::Format::CHUNKED.
+        /// \param[in] _spillSize Size of the spill buffer in MB
+        /// \return SUCCESS if recording was successfully started,
+        /// ALREADY_RECORDING if a recording is in progress, or
+        /// FAILED_TO_OPEN if the log couldn't be created.
+        public: RecorderError StartRemote(const std::string &_service,
+                                          const LogOptions &_options,
+                                          std::size_t _spillSize = 256);
+
+        /// \brief Time that Stop() waits for the chunks of a recording
+        /// started by StartRemote() to be sent.
+        public: static constexpr std::chrono::seconds kRemoteCloseTimeout{10};
+
         /// \brief Stop recording topics. This function will block if there is
         /// any data in the internal buffer that has not yet been written to
-        /// disk.
+        /// disk. The log files written with deferred indexes, see
+        /// LogOptions::SetDeferIndexes(), are finalized afterwards in the
+        /// background, like the parts of a split recording once they are
+        /// closed.
         public: void Stop();
 
+        /// \brief Block until the log files closed so far are finalized,
+        /// see Stop(). The destructor waits for them too.
+        public: void WaitUntilFinalized();
+
+        /// \brief Begin recording topics in memory only, keeping a window of
+        /// the latest messages that is written to a log file on demand by
+        /// Dump(), e.g. after a fault. A message leaves the window when it is
+        /// older than _window, by the clock of the recorder, or to make room
+        /// for the new ones once the window holds _size MB, dropping the low
+        /// priority topics first like SetBufferSize(). The memory of the
+        /// window is allocated here, so recording doesn't allocate unless a
+        /// message doesn't fit in it. Stop() discards the window.
+        /// \param[in] _window Time kept, 0 to only limit the size
+        /// \param[in] _size Size kept in MB, 0 to only limit the time
+        /// \return SUCCESS if recording was started, ALREADY_RECORDING if a
+        /// recording is in progress, or INVALID_TOPIC if both limits are 0.
+        public: RecorderError StartBlackBox(
+            const std::chrono::nanoseconds &_window, std::size_t _size);
+
+        /// \brief Write the messages of the window kept since StartBlackBox()
+        /// to a log file, in the order they were received, with the topics
+        /// of all the groups. The messages received while dumping remain in
+        /// the window, the others leave it.
+        /// \param[in] _file path to log file
+        /// \param[in] _options Settings of the log file
+        /// \return SUCCESS if the messages were written, NOT_RECORDING if the
+        /// recording didn't start with StartBlackBox(), or FAILED_TO_OPEN if
+        /// the file couldn't be created.
+        public: RecorderError Dump(const std::string &_file,
+                                   const LogOptions &_options = LogOptions());
+
+        /// \brief Advertise a service that calls Dump(), with the path of the
+        /// log file as an ignition::msgs::StringMsg request. It replies with
+        /// an ignition::msgs::Boolean that is true if the dump succeeded.
+        /// \param[in] _service Name of the service
+        /// \return SUCCESS if the service was advertised, or INVALID_TOPIC
+        /// otherwise.
+        public: RecorderError AdvertiseDumpService(const std::string &_service);
+
         /// \brief Add a topic to be recorded (exact match only)
         /// \param[in] _topic The exact topic name
         /// \note This method attempts to subscribe to the topic immediately.
@@ -98,9 +247,50 @@ namespace ignition
         /// \return number of topics subscribed or negative number on error
         public: int64_t AddTopic(const std::regex &_topic);
 
+        /// \brief Add a topic to be recorded at a lower rate than it's
+        /// published, e.g. 1 Hz of a 100 Hz pose. The subscription is
+        /// throttled, so the publishers that support it send only the
+        /// messages recorded, and the others are discarded before the
+        /// recorder copies them. A topic already added keeps its rate.
+        /// \param[in] _topic The exact topic name
+        /// \param[in] _msgsPerSec Maximum number of messages recorded per
+        /// second, at least 1
+        /// \return SUCCESS if the subscription was created.
+        /// \sa SubscribeOptions::SetMsgsPerSec
+        public: RecorderError AddTopic(const std::string &_topic,
+                                       const uint64_t _msgsPerSec);
+
+        /// \brief Add the topics matching a pattern to be recorded at a
+        /// lower rate than they're published, including those that appear
+        /// later, see the other versions of AddTopic().
+        /// \param[in] _topic Pattern to match against topic names
+        /// \param[in] _msgsPerSec Maximum number of messages recorded per
+        /// second for each topic, at least 1
+        /// \return number of topics subscribed or negative number on error
+        public: int64_t AddTopic(const std::regex &_topic,
+                                 const uint64_t _msgsPerSec);
+
+        /// \brief Record the topics matching a pattern to a log file of
+        /// their own, written by a thread of its own, so a busy group of
+        /// topics doesn't slow down the others. The file is named by
+        /// Log::GroupFilename() after the file given to Start(), and a
+        /// manifest listing the files of the recording is written next to
+        /// it, named after that file with ".manifest" appended. Log::Open()
+        /// and Playback read the manifest as one log. A topic goes to the
+        /// first group it matches, and to the file given to Start() if it
+        /// matches none. The topics still have to be added with AddTopic().
+        /// \param[in] _name Name of the group, used in the name of its file
+        /// \param[in] _topics Pattern to match against topic names
+        /// \return SUCCESS if the group was added, ALREADY_RECORDING if the
+        /// recording has started, or INVALID_TOPIC if the name is empty,
+        /// holds a path separator or is a number.
+        public: RecorderError AddTopicGroup(const std::string &_name,
+                                            const std::regex &_topics);
+
         /// \brief Get the name of the log file.
-        /// \return The name of the log file, or an empty string if Start has
-        /// not been successfully called.
+        /// \return The name of the log file that is being written, which
+        /// changes when the recording is split, or an empty string if Start
+        /// has not been successfully called.
         public: std::string Filename() const;
 
         /// \brief Get the set of topics have have been added.
@@ -120,6 +310,54 @@ namespace ignition
         /// \param[in] _size Buffer size in MB
         public: void SetBufferSize(std::size_t _size);
 
+        /// \brief Set whether the messages of a topic are dropped before the
+        /// messages of the other topics when the buffer is full. A message
+        /// of a low priority topic is dropped, instead of older messages,
+        /// if there are only messages of normal priority in the buffer. The
+        /// messages are written in the order they were received either way.
+        /// \param[in] _topic The topic name, as given to AddTopic() or
+        /// matched by its pattern
+        /// \param[in] _lowPriority True to drop the topic first
+        public: void SetLowPriorityTopic(const std::string &_topic,
+                                         bool _lowPriority = true);
+
+        /// \brief Check if the messages of a topic are dropped first.
+        /// \param[in] _topic The topic name
+        /// \return True if the topic has a low priority
+        public: bool IsLowPriorityTopic(const std::string &_topic) const;
+
+        /// \brief Get the counters of the recording.
+        /// \return The counters
+        public: Statistics Stats() const;
+
+        /// \brief Get the size of the messages after which the recording
+        /// continues in a new file.
+        /// \return Split size in bytes, 0 if the recording isn't split by
+        /// size.
+        public: std::size_t SplitSize() const;
+
+        /// \brief Split the recording in files holding up to _size bytes of
+        /// messages, e.g. to keep the files below the size limit of a file
+        /// system. A message that is bigger gets a file of its own. The
+        /// files are named by Log::PartFilename() after the file given to
+        /// Start(), and can be read as one log with Log::SplitFiles(). No
+        /// message is dropped when a new file is started.
+        /// \param[in] _size Split size in bytes, 0 to disable (the default)
+        public: void SetSplitSize(std::size_t _size);
+
+        /// \brief Get the time after which the recording continues in a new
+        /// file.
+        /// \return Split duration, 0 if the recording isn't split by time.
+        public: std::chrono::nanoseconds SplitDuration() const;
+
+        /// \brief Split the recording in files spanning up to _duration of
+        /// time, measured with the clock of the recorder, see Sync(). The
+        /// files are named like with SetSplitSize(), and both limits can be
+        /// set at the same time.
+        /// \param[in] _duration Split duration, 0 to disable (the default)
+        public: void SetSplitDuration(
+            const std::chrono::nanoseconds &_duration);
+
         /// \internal Implementation of this class
         private: class Implementation;
 
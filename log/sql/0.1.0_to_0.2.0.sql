@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/* Migrates an empty 0.1.0 database to 0.2.0, used for compressed logs.
+
+   The tables are the same, but every messages.message is a frame that starts
+   with a byte identifying the compression method:
+     0: no compression, the serialized protobuf message follows.
+     1: zlib. The size of the serialized message follows as a little endian
+        64 bit integer, and then the compressed message.
+   Each message may be stored with a different method. */
+INSERT INTO migrations (from_version, to_version) VALUES ('0.1.0', '0.2.0');
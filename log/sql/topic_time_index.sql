@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/* Indexes the messages by topic and time received, so the queries for a few
+   topics read the rows of those topics only, already sorted by time.
+
+   It is applied to every new log file, after the schema 0.1.0 and the
+   migration to 0.2.0 if any. The tables don't change, so it doesn't insert a
+   migration: the log files without this index keep their version and are
+   read like before, using idx_time_recv. */
+CREATE INDEX IF NOT EXISTS idx_topic_time_recv
+  ON messages (topic_id, time_recv);
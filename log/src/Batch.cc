@@ -28,8 +28,20 @@ using namespace ignition::transport::log;
 
 //////////////////////////////////////////////////
 BatchPrivate::BatchPrivate(const std::shared_ptr<raii_sqlite3::Database> &_db,
-      std::vector<SqlStatement> &&_statements)  // NOLINT(build/c++11)
-  : statements(new std::vector<SqlStatement>(std::move(_statements))), db(_db)
+      std::vector<SqlStatement> &&_statements,  // NOLINT(build/c++11)
+      bool _framed)
+  : streams(new std::vector<Stream>(1, Stream(1)))
+{
+  Segment &segment = this->streams->front().front();
+  segment.db = _db;
+  segment.statements = std::move(_statements);
+  segment.framed = _framed;
+}
+
+//////////////////////////////////////////////////
+BatchPrivate::BatchPrivate(
+      std::vector<Stream> &&_streams)  // NOLINT(build/c++11)
+  : streams(new std::vector<Stream>(std::move(_streams)))
 {
 }
 
@@ -74,7 +86,7 @@ Batch::iterator Batch::begin()
   }
 
   std::unique_ptr<MsgIterPrivate> msgPriv(new MsgIterPrivate(
-        this->dataPtr->db, this->dataPtr->statements));
+        this->dataPtr->streams));
   return Batch::iterator(std::move(msgPriv));
 }
 
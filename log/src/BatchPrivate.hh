@@ -17,9 +17,12 @@
 #ifndef IGNITION_TRANSPORT_LOG_BATCHPRIVATE_HH_
 #define IGNITION_TRANSPORT_LOG_BATCHPRIVATE_HH_
 
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include "ignition/transport/log/Batch.hh"
 #include "ignition/transport/log/SqlStatement.hh"
 #include "raii-sqlite3.hh"
 
@@ -30,21 +33,49 @@ using namespace ignition::transport::log;
 /// \internal
 class ignition::transport::log::BatchPrivate
 {
+  /// \brief The statements to execute on one database. A split recording
+  /// has one segment per part, see Log::SplitFiles().
+  public: struct Segment
+  {
+    /// \brief SQLite3 database pointer wrapper
+    std::shared_ptr<raii_sqlite3::Database> db;
+
+    /// \brief Statements to be executed to get messages
+    std::vector<SqlStatement> statements;
+
+    /// \brief True if the messages are framed, see Compression.hh
+    bool framed = false;
+
+    /// \brief Ids of the topics of the queried log, by their ids in the
+    /// database of the segment, for the parts and the shards of a
+    /// recording. Empty if the ids are the same, see Message::TopicId().
+    std::unordered_map<int64_t, int64_t> topicIds;
+  };
+
+  /// \brief Segments whose messages are read one after the other. The
+  /// streams of a batch are merged by time, e.g. the topic groups of a
+  /// recording, see Recorder::AddTopicGroup().
+  public: using Stream = std::vector<Segment>;
+
   /// \brief constructor
   /// \param[in] _db an open sqlite3 database handle wrapper
   /// \param[in] _statements a list of statments to be executed to get messages
+  /// \param[in] _framed true if the messages are framed, see Compression.hh
   public: explicit BatchPrivate(
       const std::shared_ptr<raii_sqlite3::Database> &_db,
-      std::vector<SqlStatement> &&_statements);  // NOLINT(build/c++11)
+      std::vector<SqlStatement> &&_statements,  // NOLINT(build/c++11)
+      bool _framed = false);
+
+  /// \brief constructor
+  /// \param[in] _streams The streams whose messages are queried
+  public: explicit BatchPrivate(
+      std::vector<Stream> &&_streams);  // NOLINT(build/c++11)
 
   /// \brief destructor
   public: ~BatchPrivate();
 
-  /// \brief topic names that should be queried
-  public: std::shared_ptr<std::vector<SqlStatement>> statements;
-
-  /// \brief SQLite3 database pointer wrapper
-  public: std::shared_ptr<raii_sqlite3::Database> db;
+  /// \brief statements that should be executed, with their database
+  public: std::shared_ptr<std::vector<Stream>> streams;
 };
 
 #endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/msgs/bytes.pb.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "ChunkSender.hh"
+#include "Console.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+constexpr std::chrono::milliseconds ChunkSender::kRequestTimeout;
+constexpr std::chrono::milliseconds ChunkSender::kRetryPeriod;
+
+//////////////////////////////////////////////////
+ChunkSender::ChunkSender(const std::string &_service,
+    const std::size_t _spillSize)
+  : service(_service),
+    spillSize(_spillSize)
+{
+  this->thread = std::thread(&ChunkSender::Run, this);
+}
+
+//////////////////////////////////////////////////
+ChunkSender::~ChunkSender()
+{
+  if (this->thread.joinable())
+    this->Close(std::chrono::milliseconds::zero());
+}
+
+//////////////////////////////////////////////////
+bool ChunkSender::Push(const char *_data, const std::size_t _size)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    while (!this->queue.empty() &&
+           this->queuedBytes + _size > this->spillSize)
+    {
+      this->queuedBytes -= this->queue.front().size();
+      this->queue.pop_front();
+      ++this->dropped;
+    }
+    this->queue.emplace_back(_data, _size);
+    this->queuedBytes += _size;
+  }
+  this->condition.notify_all();
+  return true;
+}
+
+//////////////////////////////////////////////////
+void ChunkSender::Close(const std::chrono::milliseconds &_timeout)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->closing = true;
+    this->deadline = std::chrono::steady_clock::now() + _timeout;
+  }
+  this->condition.notify_all();
+  if (this->thread.joinable())
+    this->thread.join();
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (!this->queue.empty())
+  {
+    LWRN("Dropped " << this->queue.size() << " chunks that were not sent to ["
+         << this->service << "]\n");
+    this->dropped += this->queue.size();
+    this->queue.clear();
+    this->queuedBytes = 0;
+  }
+}
+
+//////////////////////////////////////////////////
+uint64_t ChunkSender::Sent() const
+{
+  return this->sent;
+}
+
+//////////////////////////////////////////////////
+uint64_t ChunkSender::Dropped() const
+{
+  return this->dropped;
+}
+
+//////////////////////////////////////////////////
+std::size_t ChunkSender::Spilled() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->queuedBytes;
+}
+
+//////////////////////////////////////////////////
+void ChunkSender::Run()
+{
+  bool connected = true;
+  ignition::msgs::Bytes request;
+  ignition::msgs::Boolean reply;
+  while (true)
+  {
+    std::chrono::milliseconds timeout = kRequestTimeout;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [this]
+        {
+          return !this->queue.empty() || this->closing;
+        });
+
+      const auto now = std::chrono::steady_clock::now();
+      if (this->queue.empty() || (this->closing && now >= this->deadline))
+        return;
+      if (this->closing)
+      {
+        timeout = std::min(timeout, std::max(std::chrono::milliseconds(1),
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+              this->deadline - now)));
+      }
+
+      // The chunk stays counted in queuedBytes while it's being sent
+      request.set_data(std::move(this->queue.front()));
+      this->queue.pop_front();
+    }
+
+    bool result = false;
+    reply.Clear();
+    const bool executed = this->node.Request(this->service, request,
+        static_cast<unsigned int>(timeout.count()), reply, result);
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    const std::size_t size = request.data().size();
+    if (executed)
+    {
+      this->queuedBytes -= size;
+      if (result && reply.data())
+      {
+        ++this->sent;
+      }
+      else
+      {
+        LERR("The log server [" << this->service << "] rejected a chunk\n");
+        ++this->dropped;
+      }
+
+      if (!connected)
+      {
+        LMSG("Reconnected to the log server [" << this->service << "], "
+             << this->queue.size() << " chunks left to send\n");
+        connected = true;
+      }
+      continue;
+    }
+
+    // The link is down: the chunk is sent again first, unless the chunks
+    // queued meanwhile filled the buffer, since it's the oldest
+    if (connected)
+    {
+      LWRN("No reply from the log server [" << this->service
+           << "], buffering the chunks\n");
+      connected = false;
+    }
+    if (this->queuedBytes > this->spillSize && !this->queue.empty())
+    {
+      this->queuedBytes -= size;
+      ++this->dropped;
+    }
+    else
+    {
+      this->queue.push_front(std::move(*request.mutable_data()));
+    }
+    this->condition.wait_for(lock, kRetryPeriod, [this]
+      {
+        return this->closing &&
+          std::chrono::steady_clock::now() >= this->deadline;
+      });
+  }
+}
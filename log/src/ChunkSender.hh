@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#ifndef IGNITION_TRANSPORT_LOG_CHUNKSENDER_HH_
+#define IGNITION_TRANSPORT_LOG_CHUNKSENDER_HH_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Node.hh"
+
+namespace ignition
+{
+namespace transport
+{
+namespace log
+{
+// Inline bracket to help doxygen filtering.
+inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+{
+  /// \brief Sends the chunks of a streamed log to a LogServer, in a thread
+  /// of its own, as requests of its service. The chunks wait in a spill
+  /// buffer until the server acknowledges them, so they are sent again
+  /// once a link that dropped comes back. When the buffer is full, its
+  /// oldest chunks are dropped. See Recorder::StartRemote().
+  class ChunkSender
+  {
+    /// \brief Time waited for the server to acknowledge a chunk.
+    public: static constexpr std::chrono::milliseconds kRequestTimeout{5000};
+
+    /// \brief Time waited before sending a chunk again.
+    public: static constexpr std::chrono::milliseconds kRetryPeriod{1000};
+
+    /// \brief Constructor. Starts the thread sending the chunks.
+    /// \param[in] _service Service of the LogServer
+    /// \param[in] _spillSize Size of the spill buffer (bytes). A single
+    /// chunk is kept even if it's bigger.
+    public: ChunkSender(const std::string &_service,
+                        const std::size_t _spillSize);
+
+    /// \brief Destructor. Stops the thread without waiting for the chunks
+    /// that weren't sent, see Close().
+    public: ~ChunkSender();
+
+    /// \brief Queue a chunk, see ChunkWriter::Sink. Doesn't wait for the
+    /// network.
+    /// \param[in] _data The chunk
+    /// \param[in] _size Size of the chunk (bytes)
+    /// \return true, the chunks dropped later are counted by Dropped()
+    public: bool Push(const char *_data, const std::size_t _size);
+
+    /// \brief Wait for the queued chunks to be acknowledged, and stop the
+    /// thread. The chunks still queued after _timeout are dropped.
+    /// \param[in] _timeout Time waited
+    public: void Close(const std::chrono::milliseconds &_timeout);
+
+    /// \brief Get the number of chunks acknowledged by the server.
+    /// \return The number of chunks
+    public: uint64_t Sent() const;
+
+    /// \brief Get the number of chunks dropped because the spill buffer
+    /// was full, or rejected by the server.
+    /// \return The number of chunks
+    public: uint64_t Dropped() const;
+
+    /// \brief Get the size of the chunks waiting to be sent.
+    /// \return The size (bytes)
+    public: std::size_t Spilled() const;
+
+    /// \brief Body of the thread.
+    private: void Run();
+
+    /// \brief Node of the requests.
+    private: Node node;
+
+    /// \brief Service of the LogServer.
+    private: const std::string service;
+
+    /// \brief Size of the spill buffer (bytes).
+    private: const std::size_t spillSize;
+
+    /// \brief Protects queue, queuedBytes, closing and deadline.
+    private: mutable std::mutex mutex;
+
+    /// \brief Signals new chunks and Close().
+    private: std::condition_variable condition;
+
+    /// \brief Chunks waiting to be sent, oldest first.
+    private: std::deque<std::string> queue;
+
+    /// \brief Size of the queued chunks, and of the chunk being sent.
+    private: std::size_t queuedBytes = 0;
+
+    /// \brief True once Close() was called.
+    private: bool closing = false;
+
+    /// \brief Time after which Close() drops the chunks.
+    private: std::chrono::steady_clock::time_point deadline;
+
+    /// \brief Chunks acknowledged.
+    private: std::atomic<uint64_t> sent{0};
+
+    /// \brief Chunks dropped.
+    private: std::atomic<uint64_t> dropped{0};
+
+    /// \brief The thread sending the chunks.
+    private: std::thread thread;
+  };
+}
+}
+}
+}
+
+#endif
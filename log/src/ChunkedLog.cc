@@ -0,0 +1,673 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ChunkedLog.hh"
+#include "Console.hh"
+#include "raii-sqlite3.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+/// \brief Magic number at the beginning of the files.
+static const char kFileMagic[] = "IGNLOGCK";
+
+/// \brief Size of the header of the files.
+static const std::size_t kFileHeaderSize = 16;
+static_assert(kFileHeaderSize == kStreamedChunkOffset,
+    "The streamed chunks follow a file header");
+
+/// \brief Version of the format written.
+static const uint32_t kFormatVersion = 1;
+
+/// \brief Flag of the file header set when the messages are framed.
+static const uint32_t kFramedFlag = 1;
+
+/// \brief Magic number at the beginning of the chunks.
+static const char kChunkMagic[] = "CHNK";
+
+/// \brief Magic number at the end of the chunks.
+static const char kChunkEndMagic[] = "KNHC";
+
+/// \brief Size of the header of the chunks.
+static const std::size_t kChunkHeaderSize = 40;
+
+/// \brief Size of the end of the chunks.
+static const std::size_t kChunkFooterSize = 16;
+
+/// \brief Size of a message in the index of a chunk.
+static const std::size_t kIndexEntrySize = 32;
+
+/// \brief Schema of the database used to query a chunked log file. It
+/// has the tables of the schema 0.1.0, but the messages are a view of the
+/// index and the mapped file.
+static const char kIndexSchema[] =
+  "PRAGMA journal_mode = OFF;"
+  "PRAGMA synchronous = OFF;"
+  "CREATE TABLE migrations ("
+  " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+  " from_version TEXT DEFAULT NULL,"
+  " to_version TEXT NOT NULL,"
+  " time_utc INTEGER NOT NULL DEFAULT CURRENT_TIMESTAMP);"
+  "INSERT INTO migrations (to_version) VALUES ('0.1.0');"
+  "CREATE TABLE message_types ("
+  " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+  " name TEXT NOT NULL UNIQUE,"
+  " proto_descriptor TEXT);"
+  "CREATE TABLE topics ("
+  " id INTEGER PRIMARY KEY,"
+  " name TEXT NOT NULL,"
+  " message_type_id NOT NULL REFERENCES message_types (id));"
+  "CREATE TABLE message_index ("
+  " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+  " time_recv INTEGER NOT NULL,"
+  " topic_id INTEGER NOT NULL,"
+  " offset INTEGER NOT NULL,"
+  " len INTEGER NOT NULL);"
+  "CREATE VIEW messages AS SELECT id, time_recv, topic_id,"
+  " chunk_message(offset, len) AS message FROM message_index;";
+
+//////////////////////////////////////////////////
+/// \brief Append a little endian integer to a buffer.
+/// \param[in] _value The integer
+/// \param[in] _bytes Size of the integer
+/// \param[in,out] _buffer The buffer
+static void appendInt(uint64_t _value, const std::size_t _bytes,
+    std::vector<char> &_buffer)
+{
+  for (std::size_t i = 0; i < _bytes; ++i)
+  {
+    _buffer.push_back(static_cast<char>(_value & 0xFF));
+    _value >>= 8;
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Read a little endian integer.
+/// \param[in] _data Location of the integer
+/// \param[in] _bytes Size of the integer
+/// \return The integer
+static uint64_t readInt(const unsigned char *_data, const std::size_t _bytes)
+{
+  uint64_t value = 0;
+  for (std::size_t i = _bytes; i > 0; --i)
+    value = (value << 8) | _data[i - 1];
+  return value;
+}
+
+//////////////////////////////////////////////////
+/// \brief Create the header of a file.
+/// \param[in] _framed True if the messages are framed
+/// \return The header
+static std::vector<char> makeFileHeader(const bool _framed)
+{
+  std::vector<char> header(kFileMagic, kFileMagic + 8);
+  appendInt(kFormatVersion, 4, header);
+  appendInt(_framed ? kFramedFlag : 0, 4, header);
+  return header;
+}
+
+//////////////////////////////////////////////////
+ChunkWriter::~ChunkWriter()
+{
+  if (this->IsOpen())
+    this->Flush();
+}
+
+//////////////////////////////////////////////////
+bool ChunkWriter::IsOpen() const
+{
+  return this->out.is_open() || this->sink;
+}
+
+//////////////////////////////////////////////////
+bool ChunkWriter::Open(const std::string &_file, const std::size_t _chunkSize,
+    const bool _framed)
+{
+  this->out.open(_file,
+    std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  if (!this->out)
+  {
+    LERR("Failed to create log file [" << _file << "]\n");
+    return false;
+  }
+
+  const std::vector<char> header = makeFileHeader(_framed);
+  this->out.write(header.data(), header.size());
+  this->out.flush();
+
+  this->chunkSize = _chunkSize;
+  return this->out.good();
+}
+
+//////////////////////////////////////////////////
+bool ChunkWriter::Open(Sink _sink, const std::size_t _chunkSize,
+    const bool _framed)
+{
+  if (!_sink)
+    return false;
+
+  this->sink = std::move(_sink);
+  this->fileHeader = makeFileHeader(_framed);
+  this->chunkSize = _chunkSize;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ChunkWriter::AppendChunk(const char *_data, const std::size_t _size)
+{
+  if (!this->out.is_open())
+    return false;
+
+  this->out.write(_data, _size);
+  this->out.flush();
+  if (!this->out)
+  {
+    LERR("Failed to write a chunk of the log file\n");
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+int64_t ChunkWriter::TopicId(const std::string &_name,
+    const std::string &_type)
+{
+  auto key = std::make_pair(_name, _type);
+  auto it = this->topics.find(key);
+  if (it != this->topics.end())
+    return it->second;
+
+  const int64_t id = static_cast<int64_t>(this->topics.size()) + 1;
+  it = this->topics.emplace(std::move(key), id).first;
+  this->newTopics.push_back(it);
+  return id;
+}
+
+//////////////////////////////////////////////////
+bool ChunkWriter::Append(const std::chrono::nanoseconds &_time,
+    const int64_t _topicId, const void *_data, const std::size_t _len)
+{
+  if (!this->IsOpen() || _topicId <= 0 ||
+      _topicId > static_cast<int64_t>(this->topics.size()))
+  {
+    return false;
+  }
+
+  this->entries.push_back({_time.count(), static_cast<uint64_t>(_topicId),
+    this->data.size(), _len});
+  const char *bytes = static_cast<const char *>(_data);
+  this->data.insert(this->data.end(), bytes, bytes + _len);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ChunkWriter::Full() const
+{
+  return this->data.size() >= this->chunkSize;
+}
+
+//////////////////////////////////////////////////
+bool ChunkWriter::Flush()
+{
+  if (this->entries.empty() && this->newTopics.empty())
+    return true;
+
+  // The messages are mostly in order already
+  std::stable_sort(this->entries.begin(), this->entries.end(),
+    [](const Entry &_a, const Entry &_b)
+    {
+      return _a.time < _b.time;
+    });
+
+  // A streamed chunk holds all the topics, in case the others are lost
+  std::vector<std::map<std::pair<std::string, std::string>,
+                       int64_t>::const_iterator> allTopics;
+  if (this->sink)
+  {
+    for (auto it = this->topics.cbegin(); it != this->topics.cend(); ++it)
+      allTopics.push_back(it);
+  }
+  const auto &chunkTopics = this->sink ? allTopics : this->newTopics;
+
+  std::vector<char> header(kChunkMagic, kChunkMagic + 4);
+  appendInt(chunkTopics.size(), 4, header);
+  appendInt(this->entries.size(), 8, header);
+  appendInt(this->data.size(), 8, header);
+  appendInt(this->entries.empty() ? 0 : this->entries.front().time, 8, header);
+  appendInt(this->entries.empty() ? 0 : this->entries.back().time, 8, header);
+
+  this->index.clear();
+  for (const auto &topic : chunkTopics)
+  {
+    const std::string &name = topic->first.first;
+    const std::string &type = topic->first.second;
+    appendInt(topic->second, 8, this->index);
+    appendInt(name.size(), 4, this->index);
+    appendInt(type.size(), 4, this->index);
+    this->index.insert(this->index.end(), name.begin(), name.end());
+    this->index.insert(this->index.end(), type.begin(), type.end());
+  }
+  for (const auto &entry : this->entries)
+  {
+    appendInt(entry.time, 8, this->index);
+    appendInt(entry.topicId, 8, this->index);
+    appendInt(entry.offset, 8, this->index);
+    appendInt(entry.len, 8, this->index);
+  }
+  const std::size_t indexSize = this->index.size();
+  appendInt(indexSize, 8, this->index);
+  this->index.insert(this->index.end(), kChunkEndMagic, kChunkEndMagic + 4);
+  appendInt(0, 4, this->index);
+
+  bool written = true;
+  if (this->sink)
+  {
+    this->streamed = this->fileHeader;
+    this->streamed.insert(this->streamed.end(), header.begin(), header.end());
+    this->streamed.insert(this->streamed.end(), this->data.begin(),
+        this->data.end());
+    this->streamed.insert(this->streamed.end(), this->index.begin(),
+        this->index.end());
+    written = this->sink(this->streamed.data(), this->streamed.size());
+  }
+  else
+  {
+    this->out.write(header.data(), header.size());
+    this->out.write(this->data.data(), this->data.size());
+    this->out.write(this->index.data(), this->index.size());
+    this->out.flush();
+    written = this->out.good();
+  }
+
+  this->newTopics.clear();
+  this->entries.clear();
+  this->data.clear();
+
+  if (!written)
+  {
+    LERR("Failed to write a chunk of the log file\n");
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief A read only memory mapped file.
+class MappedFile
+{
+  /// \brief Destructor. Unmaps the file.
+  public: ~MappedFile()
+  {
+#ifdef _WIN32
+    if (this->data)
+      UnmapViewOfFile(this->data);
+    if (this->mapping)
+      CloseHandle(this->mapping);
+    if (this->file != INVALID_HANDLE_VALUE)
+      CloseHandle(this->file);
+#else
+    if (this->data)
+      munmap(const_cast<unsigned char *>(this->data), this->size);
+#endif
+  }
+
+  /// \brief Map a file.
+  /// \param[in] _file Path of the file
+  /// \return true if the file was mapped
+  public: bool Open(const std::string &_file)
+  {
+#ifdef _WIN32
+    this->file = CreateFileA(_file.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize;
+    if (this->file == INVALID_HANDLE_VALUE ||
+        !GetFileSizeEx(this->file, &fileSize) || fileSize.QuadPart == 0)
+    {
+      return false;
+    }
+    this->mapping = CreateFileMappingA(
+        this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!this->mapping)
+      return false;
+    void *view = MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+      return false;
+    this->size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+    const int fd = open(_file.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+      close(fd);
+      return false;
+    }
+    void *view = mmap(nullptr, static_cast<std::size_t>(info.st_size),
+        PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid once the file is closed.
+    close(fd);
+    if (view == MAP_FAILED)
+      return false;
+    this->size = static_cast<std::size_t>(info.st_size);
+#endif
+    this->data = static_cast<const unsigned char *>(view);
+    return true;
+  }
+
+  /// \brief The contents of the file.
+  public: const unsigned char *data = nullptr;
+
+  /// \brief Size of the file.
+  public: std::size_t size = 0;
+
+#ifdef _WIN32
+  /// \brief Handle of the file.
+  private: HANDLE file = INVALID_HANDLE_VALUE;
+
+  /// \brief Handle of the mapping.
+  private: HANDLE mapping = nullptr;
+#endif
+};
+
+//////////////////////////////////////////////////
+/// \brief SQL function chunk_message(offset, len), returning a message of
+/// the mapped file without copying it.
+/// \param[in] _context Context of the function, with the mapped file
+/// \param[in] _argc Number of arguments
+/// \param[in] _argv The arguments
+static void chunkMessage(sqlite3_context *_context, int _argc,
+    sqlite3_value **_argv)
+{
+  const MappedFile *file =
+    static_cast<const MappedFile *>(sqlite3_user_data(_context));
+  const sqlite3_int64 offset = sqlite3_value_int64(_argv[0]);
+  const sqlite3_int64 len = sqlite3_value_int64(_argv[1]);
+  if (_argc != 2 || offset < 0 || len < 0 ||
+      static_cast<uint64_t>(offset) + static_cast<uint64_t>(len) > file->size)
+  {
+    sqlite3_result_error(_context, "Message out of the log file", -1);
+    return;
+  }
+  sqlite3_result_blob(_context, file->data + offset, static_cast<int>(len),
+      SQLITE_STATIC);
+}
+
+//////////////////////////////////////////////////
+/// \brief Unmap the file when the database is closed.
+/// \param[in] _file The mapped file
+static void destroyMappedFile(void *_file)
+{
+  delete static_cast<MappedFile *>(_file);
+}
+
+//////////////////////////////////////////////////
+/// \brief Find the end of a chunk, checking that it's complete.
+/// \param[in] _data The contents of the file
+/// \param[in] _size Size of the file
+/// \param[in] _pos Position of the chunk
+/// \param[out] _topicsPos Position of the topics of the chunk
+/// \param[out] _messagesPos Position of the messages of the chunk
+/// \return Position of the next chunk, or 0 if the chunk is incomplete
+static std::size_t chunkEnd(const unsigned char *_data,
+    const std::size_t _size, const std::size_t _pos,
+    std::size_t &_topicsPos, std::size_t &_messagesPos)
+{
+  const unsigned char *header = _data + _pos;
+  if (_size - _pos < kChunkHeaderSize || memcmp(header, kChunkMagic, 4) != 0)
+    return 0;
+
+  const uint64_t topicCount = readInt(header + 4, 4);
+  const uint64_t messageCount = readInt(header + 8, 8);
+  const uint64_t dataSize = readInt(header + 16, 8);
+
+  std::size_t pos = _pos + kChunkHeaderSize;
+  if (dataSize > _size - pos)
+    return 0;
+  pos += dataSize;
+
+  _topicsPos = pos;
+  for (uint64_t i = 0; i < topicCount; ++i)
+  {
+    if (_size - pos < 16)
+      return 0;
+    const uint64_t strings = readInt(_data + pos + 8, 4) +
+      readInt(_data + pos + 12, 4);
+    pos += 16;
+    if (strings > _size - pos)
+      return 0;
+    pos += strings;
+  }
+
+  _messagesPos = pos;
+  if (messageCount > (_size - pos) / kIndexEntrySize)
+    return 0;
+  pos += messageCount * kIndexEntrySize;
+
+  if (_size - pos < kChunkFooterSize ||
+      readInt(_data + pos, 8) != pos - _topicsPos ||
+      memcmp(_data + pos + 8, kChunkEndMagic, 4) != 0)
+  {
+    return 0;
+  }
+  return pos + kChunkFooterSize;
+}
+
+//////////////////////////////////////////////////
+bool log::IsChunkedLog(const std::string &_file)
+{
+  std::ifstream in(_file, std::ios_base::in | std::ios_base::binary);
+  char magic[8];
+  return in.read(magic, sizeof(magic)) && memcmp(magic, kFileMagic, 8) == 0;
+}
+
+//////////////////////////////////////////////////
+bool log::ParseStreamedChunk(const char *_data, const std::size_t _size,
+    bool &_framed)
+{
+  const unsigned char *data = reinterpret_cast<const unsigned char *>(_data);
+  if (_size < kFileHeaderSize || memcmp(data, kFileMagic, 8) != 0 ||
+      readInt(data + 8, 4) != kFormatVersion)
+  {
+    return false;
+  }
+  _framed = readInt(data + 12, 4) & kFramedFlag;
+
+  std::size_t topicsPos = 0;
+  std::size_t messagesPos = 0;
+  return chunkEnd(data, _size, kFileHeaderSize, topicsPos, messagesPos) ==
+    _size;
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<raii_sqlite3::Database> log::OpenChunkedLog(
+    const std::string &_file)
+{
+  std::unique_ptr<MappedFile> file(new MappedFile);
+  if (!file->Open(_file) || file->size < kFileHeaderSize ||
+      memcmp(file->data, kFileMagic, 8) != 0)
+  {
+    LERR("Failed to map log file [" << _file << "]\n");
+    return nullptr;
+  }
+
+  const uint64_t version = readInt(file->data + 8, 4);
+  if (version != kFormatVersion)
+  {
+    LERR("Chunked log file version '" << version
+         << "' is unsupported by this tool\n");
+    return nullptr;
+  }
+  const bool framed = readInt(file->data + 12, 4) & kFramedFlag;
+
+  // A temporary database, spilled to the disk if the index gets big
+  std::unique_ptr<raii_sqlite3::Database> db(new raii_sqlite3::Database(
+      "", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE));
+  if (!*db)
+    return nullptr;
+
+  // The database owns the mapping from now on, even if this fails
+  const MappedFile &mapped = *file;
+  if (sqlite3_create_function_v2(db->Handle(), "chunk_message", 2,
+        SQLITE_UTF8, file.release(), &chunkMessage, nullptr, nullptr,
+        &destroyMappedFile) != SQLITE_OK)
+  {
+    LERR("Failed to register the chunk_message function\n");
+    return nullptr;
+  }
+
+  std::string schema = kIndexSchema;
+  if (framed)
+  {
+    schema += "INSERT INTO migrations (from_version, to_version)"
+      " VALUES ('0.1.0', '0.2.0');";
+  }
+  schema += "BEGIN;";
+  if (sqlite3_exec(db->Handle(), schema.c_str(), NULL, 0, NULL) != SQLITE_OK)
+  {
+    LERR("Failed to create the index of the log file: "
+         << sqlite3_errmsg(db->Handle()) << "\n");
+    return nullptr;
+  }
+
+  raii_sqlite3::Statement typeStatement(*db,
+      "INSERT OR IGNORE INTO message_types (name) VALUES (?001);");
+  raii_sqlite3::Statement topicStatement(*db,
+      "INSERT OR IGNORE INTO topics (id, name, message_type_id)"
+      " SELECT ?001, ?002, id FROM message_types WHERE name = ?003;");
+  raii_sqlite3::Statement messageStatement(*db,
+      "INSERT INTO message_index (time_recv, topic_id, offset, len)"
+      " VALUES (?001, ?002, ?003, ?004);");
+  if (!typeStatement || !topicStatement || !messageStatement)
+  {
+    LERR("Failed to compile the statements to index the log file\n");
+    return nullptr;
+  }
+
+  std::size_t pos = kFileHeaderSize;
+  while (pos < mapped.size)
+  {
+    std::size_t topicsPos = 0;
+    std::size_t messagesPos = 0;
+    const std::size_t next = chunkEnd(mapped.data, mapped.size, pos,
+        topicsPos, messagesPos);
+    if (next == 0)
+    {
+      LWRN("Ignoring the incomplete chunk at the end of the log file\n");
+      break;
+    }
+
+    const unsigned char *header = mapped.data + pos;
+    const uint64_t topicCount = readInt(header + 4, 4);
+    const uint64_t messageCount = readInt(header + 8, 8);
+    const uint64_t dataSize = readInt(header + 16, 8);
+    const std::size_t dataPos = pos + kChunkHeaderSize;
+
+    int returnCode = SQLITE_DONE;
+    const unsigned char *p = mapped.data + topicsPos;
+    for (uint64_t i = 0; i < topicCount && returnCode == SQLITE_DONE; ++i)
+    {
+      const uint64_t id = readInt(p, 8);
+      const int nameLen = static_cast<int>(readInt(p + 8, 4));
+      const int typeLen = static_cast<int>(readInt(p + 12, 4));
+      const char *name = reinterpret_cast<const char *>(p + 16);
+      const char *type = name + nameLen;
+      p += 16 + nameLen + typeLen;
+
+      sqlite3_bind_text(typeStatement.Handle(), 1, type, typeLen,
+          SQLITE_STATIC);
+      returnCode = sqlite3_step(typeStatement.Handle());
+      sqlite3_reset(typeStatement.Handle());
+      if (returnCode != SQLITE_DONE)
+        break;
+
+      sqlite3_bind_int64(topicStatement.Handle(), 1,
+          static_cast<sqlite3_int64>(id));
+      sqlite3_bind_text(topicStatement.Handle(), 2, name, nameLen,
+          SQLITE_STATIC);
+      sqlite3_bind_text(topicStatement.Handle(), 3, type, typeLen,
+          SQLITE_STATIC);
+      returnCode = sqlite3_step(topicStatement.Handle());
+      sqlite3_reset(topicStatement.Handle());
+    }
+
+    p = mapped.data + messagesPos;
+    for (uint64_t i = 0; i < messageCount && returnCode == SQLITE_DONE; ++i)
+    {
+      const uint64_t offset = readInt(p + 16, 8);
+      const uint64_t len = readInt(p + 24, 8);
+      if (offset > dataSize || len > dataSize - offset)
+      {
+        LWRN("Ignoring a message out of its chunk\n");
+        p += kIndexEntrySize;
+        continue;
+      }
+
+      sqlite3_bind_int64(messageStatement.Handle(), 1,
+          static_cast<sqlite3_int64>(readInt(p, 8)));
+      sqlite3_bind_int64(messageStatement.Handle(), 2,
+          static_cast<sqlite3_int64>(readInt(p + 8, 8)));
+      sqlite3_bind_int64(messageStatement.Handle(), 3,
+          static_cast<sqlite3_int64>(dataPos + offset));
+      sqlite3_bind_int64(messageStatement.Handle(), 4,
+          static_cast<sqlite3_int64>(len));
+      returnCode = sqlite3_step(messageStatement.Handle());
+      sqlite3_reset(messageStatement.Handle());
+      p += kIndexEntrySize;
+    }
+
+    if (returnCode != SQLITE_DONE)
+    {
+      LERR("Failed to index the log file: " << sqlite3_errmsg(db->Handle())
+           << "\n");
+      return nullptr;
+    }
+    pos = next;
+  }
+
+  // Lots of queries are done by time received, like in the schema 0.1.0,
+  // and by topic, see topic_time_index.sql
+  if (sqlite3_exec(db->Handle(),
+        "COMMIT; CREATE INDEX idx_time_recv ON message_index (time_recv);"
+        "CREATE INDEX idx_topic_time_recv ON message_index"
+        " (topic_id, time_recv);",
+        NULL, 0, NULL) != SQLITE_OK)
+  {
+    LERR("Failed to index the log file: " << sqlite3_errmsg(db->Handle())
+         << "\n");
+    return nullptr;
+  }
+  return db;
+}
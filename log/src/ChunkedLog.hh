@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_CHUNKEDLOG_HH_
+#define IGNITION_TRANSPORT_LOG_CHUNKEDLOG_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "raii-sqlite3.hh"
+
+/// \file ChunkedLog.hh
+/// \brief The chunked log files are append only. They start with a header:
+///   - magic "IGNLOGCK" (8 bytes)
+///   - format version, currently 1 (uint32)
+///   - flags (uint32). Bit 0 is set if the messages are framed, see
+///     Compression.hh.
+///
+/// The header is followed by the chunks, each one written at once:
+///   - magic "CHNK" (4 bytes)
+///   - number of topics introduced by the chunk (uint32)
+///   - number of messages (uint64)
+///   - size of the message data (uint64)
+///   - time of the first and the last messages (int64, int64)
+///   - the message data
+///   - the topics introduced by the chunk: id (uint64), size of the name
+///     (uint32), size of the type (uint32), name, type
+///   - the messages, sorted by time: time (int64), topic id (uint64),
+///     offset in the message data (uint64), size (uint64)
+///   - size of the topics and the messages (uint64)
+///   - magic "KNHC" (4 bytes), and 4 reserved bytes
+///
+/// All the integers are little endian and the times are in nanoseconds. An
+/// incomplete chunk at the end of a file, e.g. after a crash, is ignored.
+///
+/// A log can also be streamed, e.g. to a LogServer: each chunk is then sent
+/// after a copy of the file header, and introduces all the topics of the
+/// log instead of the new ones, so the chunks that are received make a
+/// valid file even if some of them are lost. The readers keep the first
+/// topic of each id.
+
+namespace ignition
+{
+namespace transport
+{
+namespace log
+{
+// Inline bracket to help doxygen filtering.
+inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+{
+  /// \brief Writes the chunked log files.
+  class ChunkWriter
+  {
+    /// \brief Callback receiving the streamed chunks.
+    /// \param[in] _data The file header followed by a chunk
+    /// \param[in] _size Size of the data
+    /// \return false if the chunk was lost
+    public: using Sink =
+      std::function<bool(const char *_data, const std::size_t _size)>;
+
+    /// \brief Destructor. Writes the buffered messages.
+    public: ~ChunkWriter();
+
+    /// \brief Create a log file.
+    /// \param[in] _file Path of the file
+    /// \param[in] _chunkSize Size of the message data of a chunk
+    /// \param[in] _framed True if the messages are framed
+    /// \return true if the file was created
+    public: bool Open(const std::string &_file, const std::size_t _chunkSize,
+                      const bool _framed);
+
+    /// \brief Stream a log to a callback instead of writing a file.
+    /// \param[in] _sink Callback receiving each chunk once it's written
+    /// \param[in] _chunkSize Size of the message data of a chunk
+    /// \param[in] _framed True if the messages are framed
+    /// \return true if the sink is callable
+    public: bool Open(Sink _sink, const std::size_t _chunkSize,
+                      const bool _framed);
+
+    /// \brief Append a complete chunk to the file, e.g. one received from a
+    /// stream, see ParseStreamedChunk().
+    /// \param[in] _data The chunk
+    /// \param[in] _size Size of the chunk
+    /// \return true if the chunk was written
+    public: bool AppendChunk(const char *_data, const std::size_t _size);
+
+    /// \brief Get the id of a topic, adding it if it's new.
+    /// \param[in] _name Name of the topic
+    /// \param[in] _type Message type of the topic
+    /// \return The id of the topic
+    public: int64_t TopicId(const std::string &_name,
+                            const std::string &_type);
+
+    /// \brief Buffer a message in the current chunk.
+    /// \param[in] _time Time when the message was received
+    /// \param[in] _topicId Id of the topic of the message, see TopicId()
+    /// \param[in] _data The message
+    /// \param[in] _len Size of the message
+    /// \return true if the message was buffered
+    public: bool Append(const std::chrono::nanoseconds &_time,
+                        const int64_t _topicId, const void *_data,
+                        const std::size_t _len);
+
+    /// \brief Check if the current chunk reached its size.
+    /// \return true if the chunk should be written
+    public: bool Full() const;
+
+    /// \brief Write the current chunk, if it's not empty.
+    /// \return true if the chunk was written
+    public: bool Flush();
+
+    /// \brief A message of the current chunk.
+    private: struct Entry
+    {
+      /// \brief Time when the message was received
+      int64_t time;
+
+      /// \brief Id of the topic
+      uint64_t topicId;
+
+      /// \brief Offset of the message in the data of the chunk
+      uint64_t offset;
+
+      /// \brief Size of the message
+      uint64_t len;
+    };
+
+    /// \brief Check if the writer has a file or a sink.
+    /// \return true if it was opened
+    private: bool IsOpen() const;
+
+    /// \brief The file.
+    private: std::ofstream out;
+
+    /// \brief Callback receiving the chunks of a stream.
+    private: Sink sink;
+
+    /// \brief Header of the file, sent before each chunk of a stream.
+    private: std::vector<char> fileHeader;
+
+    /// \brief Memory of a streamed chunk, kept to reuse it.
+    private: std::vector<char> streamed;
+
+    /// \brief Size of the message data of a chunk.
+    private: std::size_t chunkSize = 0;
+
+    /// \brief Ids of the topics, indexed by topic name and message type.
+    private: std::map<std::pair<std::string, std::string>, int64_t> topics;
+
+    /// \brief Topics to write in the current chunk.
+    private: std::vector<std::map<std::pair<std::string, std::string>,
+                         int64_t>::const_iterator> newTopics;
+
+    /// \brief Messages of the current chunk.
+    private: std::vector<Entry> entries;
+
+    /// \brief Message data of the current chunk.
+    private: std::vector<char> data;
+
+    /// \brief Memory of the end of chunk, kept to reuse it.
+    private: std::vector<char> index;
+  };
+
+  /// \brief Check if a file is a chunked log file.
+  /// \param[in] _file Path of the file
+  /// \return true if the file starts like a chunked log file
+  bool IsChunkedLog(const std::string &_file);
+
+  /// \brief Check a chunk received from a stream, see ChunkWriter::Sink.
+  /// \param[in] _data The file header followed by the chunk
+  /// \param[in] _size Size of the data
+  /// \param[out] _framed True if the messages of the stream are framed
+  /// \return true if the data holds a supported header and exactly one
+  /// complete chunk, which starts at kStreamedChunkOffset
+  bool ParseStreamedChunk(const char *_data, const std::size_t _size,
+                          bool &_framed);
+
+  /// \brief Offset of the chunk in the data of ChunkWriter::Sink.
+  static const std::size_t kStreamedChunkOffset = 16;
+
+  /// \brief Open a chunked log file for reading. The file is memory mapped,
+  /// and its index is loaded into a temporary SQLite database with the
+  /// tables of the schema 0.1.0 (0.2.0 if the messages are framed), where
+  /// messages is a view that reads the messages from the mapped file. So
+  /// the file can be queried like any other log file. The database owns the
+  /// mapping.
+  /// \param[in] _file Path of the file
+  /// \return The database, or nullptr if the file couldn't be read
+  std::unique_ptr<raii_sqlite3::Database> OpenChunkedLog(
+      const std::string &_file);
+}
+}
+}
+}
+
+#endif
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <ios>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/log/Log.hh"
+#include "ignition/transport/log/LogOptions.hh"
+#include "ignition/transport/log/QueryOptions.hh"
+#include "ignition/transport/test_config.h"
+#include "ChunkedLog.hh"
+#include "Compression.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+/// \brief Write a chunked log file with 20 messages on two topics, in
+/// chunks of a few messages.
+/// \param[in] _file Path of the file
+/// \param[in] _options Settings of the log file
+static void writeLog(const std::string &_file, log::LogOptions _options)
+{
+  _options.SetFileFormat(log::LogOptions::Format::CHUNKED);
+  _options.SetChunkSize(16);
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(_file, std::ios_base::out, _options));
+  EXPECT_TRUE(logFile.Valid());
+  // The file can't be queried while it's written.
+  EXPECT_EQ("", logFile.Version());
+  EXPECT_EQ(nullptr, logFile.Descriptor());
+
+  for (int i = 1; i <= 10; ++i)
+  {
+    const std::string data = "data_" + std::to_string(i);
+    EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+      "/topic/a", "some.type", data.c_str(), data.size()));
+  }
+
+  std::vector<std::string> data;
+  std::vector<log::Log::MessageRecord> records;
+  for (int i = 11; i <= 20; ++i)
+    data.push_back("data_" + std::to_string(i));
+  // Out of order messages are sorted within their chunk.
+  for (int i = 19; i >= 10; --i)
+  {
+    records.push_back({std::chrono::seconds(i + 1), "/topic/b", "other.type",
+      data[i - 10].c_str(), data[i - 10].size()});
+  }
+  EXPECT_EQ(records.size(), logFile.InsertMessages(records));
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, WriteAndRead)
+{
+  const std::string logName = "chunked_" + testing::getRandomNumber() +
+    ".tlog";
+  writeLog(logName, log::LogOptions());
+  EXPECT_TRUE(log::IsChunkedLog(logName));
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(logName, std::ios_base::in));
+  EXPECT_EQ("0.1.0", logFile.Version());
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(20s, logFile.EndTime());
+
+  const log::Descriptor *desc = logFile.Descriptor();
+  ASSERT_NE(nullptr, desc);
+  EXPECT_EQ(1u, desc->TopicsToMsgTypesToId().at("/topic/a").size());
+  EXPECT_EQ(2u, desc->TopicsToMsgTypesToId().size());
+
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    ++count;
+    EXPECT_EQ("data_" + std::to_string(count), msg.Data());
+    EXPECT_EQ(std::chrono::seconds(count), msg.TimeReceived());
+    EXPECT_EQ(count <= 10 ? "/topic/a" : "/topic/b", msg.Topic());
+    EXPECT_EQ(count <= 10 ? "some.type" : "other.type", msg.Type());
+  }
+  EXPECT_EQ(20, count);
+
+  // The queries work like with any other log file.
+  count = 0;
+  for (const auto &msg : logFile.QueryMessages(
+         log::TopicList("/topic/b", log::QualifiedTimeRange(12s, 14s))))
+  {
+    EXPECT_EQ("/topic/b", msg.Topic());
+    ++count;
+  }
+  EXPECT_EQ(3, count);
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, IncompleteChunk)
+{
+  const std::string logName = "chunked_" + testing::getRandomNumber() +
+    ".tlog";
+  writeLog(logName, log::LogOptions());
+
+  // Cut the file in the middle of its last chunk, like after a crash.
+  std::string contents;
+  {
+    std::ifstream in(logName, std::ios_base::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out(logName, std::ios_base::binary | std::ios_base::trunc);
+    out.write(contents.data(), contents.size() - 10);
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(logName, std::ios_base::in));
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    ++count;
+    EXPECT_EQ("data_" + std::to_string(count), msg.Data());
+  }
+  EXPECT_GT(count, 0);
+  EXPECT_LT(count, 20);
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, Compressed)
+{
+  if (!log::CompressionAvailable(log::LogOptions::Compression::ZLIB))
+  {
+    std::cerr << "Built without zlib, skipping test." << std::endl;
+    return;
+  }
+
+  const std::string logName = "chunked_" + testing::getRandomNumber() +
+    ".tlog";
+  log::LogOptions options;
+  options.SetMessageCompression(log::LogOptions::Compression::ZLIB);
+  options.SetCompressionMinSize(0);
+  writeLog(logName, options);
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(logName, std::ios_base::in));
+  EXPECT_EQ("0.2.0", logFile.Version());
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    ++count;
+    EXPECT_EQ("data_" + std::to_string(count), msg.Data());
+  }
+  EXPECT_EQ(20, count);
+
+  // The compressed messages aren't decoded for their headers
+  count = 0;
+  for (const auto &msg : logFile.QueryHeaders())
+  {
+    ++count;
+    EXPECT_TRUE(msg.Data().empty());
+  }
+  EXPECT_EQ(20, count);
+
+  const auto summaries = logFile.TopicSummaries();
+  ASSERT_EQ(2u, summaries.size());
+  EXPECT_EQ(10u, summaries[1].messages);
+  EXPECT_EQ(11s, summaries[1].firstTime);
+  EXPECT_EQ(20s, summaries[1].lastTime);
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, NotChunked)
+{
+  EXPECT_FALSE(log::IsChunkedLog("/this/file/does/not/exist"));
+
+  const std::string logName = "chunked_" + testing::getRandomNumber() +
+    ".tlog";
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+  }
+  EXPECT_FALSE(log::IsChunkedLog(logName));
+  std::remove(logName.c_str());
+
+  // An unknown version of the format.
+  {
+    std::ofstream out(logName, std::ios_base::binary);
+    out.write("IGNLOGCK\x07\0\0\0\0\0\0\0", 16);
+  }
+  EXPECT_TRUE(log::IsChunkedLog(logName));
+  log::Log logFile;
+  EXPECT_FALSE(logFile.Open(logName, std::ios_base::in));
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(ChunkedLog, Stream)
+{
+  log::LogOptions options;
+  options.SetFileFormat(log::LogOptions::Format::CHUNKED);
+  options.SetChunkSize(16);
+
+  std::vector<std::string> chunks;
+  {
+    log::Log stream;
+    ASSERT_TRUE(stream.OpenStream("stream",
+      [&chunks](const char *_data, const std::size_t _size)
+      {
+        chunks.emplace_back(_data, _size);
+        return true;
+      }, options));
+    EXPECT_TRUE(stream.Valid());
+
+    for (int i = 1; i <= 20; ++i)
+    {
+      const std::string data = "data_" + std::to_string(i);
+      EXPECT_TRUE(stream.InsertMessage(std::chrono::seconds(i),
+        i % 2 ? "/topic/a" : "/topic/b", "some.type", data.c_str(),
+        data.size()));
+    }
+  }
+  ASSERT_GT(chunks.size(), 2u);
+
+  // Each chunk stands on its own.
+  for (const std::string &chunk : chunks)
+  {
+    bool framed = true;
+    EXPECT_TRUE(log::ParseStreamedChunk(chunk.data(), chunk.size(), framed));
+    EXPECT_FALSE(framed);
+    EXPECT_FALSE(log::ParseStreamedChunk(chunk.data(), chunk.size() - 1,
+      framed));
+  }
+
+  // A chunk lost on the way only loses its own messages.
+  const std::string logName = "chunked_" + testing::getRandomNumber() +
+    ".tlog";
+  {
+    log::ChunkWriter writer;
+    ASSERT_TRUE(writer.Open(logName, 0, false));
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+      if (i == 1)
+        continue;
+      EXPECT_TRUE(writer.AppendChunk(
+        chunks[i].data() + log::kStreamedChunkOffset,
+        chunks[i].size() - log::kStreamedChunkOffset));
+    }
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(logName, std::ios_base::in));
+  const log::Descriptor *desc = logFile.Descriptor();
+  ASSERT_NE(nullptr, desc);
+  EXPECT_EQ(2u, desc->TopicsToMsgTypesToId().size());
+
+  int count = 0;
+  int last = 0;
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    const int i = static_cast<int>(std::chrono::duration_cast<
+      std::chrono::seconds>(msg.TimeReceived()).count());
+    EXPECT_EQ("data_" + std::to_string(i), msg.Data());
+    EXPECT_EQ(i % 2 ? "/topic/a" : "/topic/b", msg.Topic());
+    EXPECT_GT(i, last);
+    last = i;
+    ++count;
+  }
+  EXPECT_GT(count, 0);
+  EXPECT_LT(count, 20);
+  EXPECT_EQ(20, last);
+
+  std::remove(logName.c_str());
+}
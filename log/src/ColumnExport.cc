@@ -0,0 +1,555 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+#include <ignition/msgs/Factory.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/log/Batch.hh"
+#include "ignition/transport/log/Descriptor.hh"
+#include "ignition/transport/log/Log.hh"
+#include "ignition/transport/log/QueryOptions.hh"
+
+#include "ColumnExport.hh"
+#include "Console.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+using FieldDescriptor = google::protobuf::FieldDescriptor;
+
+/// \brief First line of the column files
+static const char kColumnsHeader[] = "ignition-transport-columns 1";
+
+/// \brief Deepest nesting of the fields that are flattened, which stops the
+/// recursive message types
+static const std::size_t kMaxDepth = 16;
+
+/// \brief Most messages waiting for a worker thread
+static const std::size_t kQueuedMessages = 1024;
+
+namespace
+{
+  /// \brief A column of a flattened field
+  struct Column
+  {
+    /// \brief Name of the column, the path of the field
+    public: std::string name;
+
+    /// \brief Kind of the values, see ColumnExport.hh
+    public: std::string kind;
+
+    /// \brief Fields from the message to the value, empty for the time
+    public: std::vector<const FieldDescriptor *> path;
+
+    /// \brief The values, or the characters of the strings
+    public: std::string values;
+
+    /// \brief Offsets of the rows of the strings and the lists
+    public: std::vector<uint64_t> offsets{0};
+  };
+
+  /// \brief The columns of a topic and message type
+  struct TopicColumns
+  {
+    /// \brief The topic name
+    public: std::string topic;
+
+    /// \brief The message type
+    public: std::string type;
+
+    /// \brief Message parsed for every row
+    public: std::unique_ptr<google::protobuf::Message> msg;
+
+    /// \brief The columns, the time first
+    public: std::vector<Column> columns;
+
+    /// \brief Number of rows
+    public: uint64_t rows = 0;
+
+    /// \brief Messages that couldn't be parsed
+    public: uint64_t failed = 0;
+
+    /// \brief Index of the worker thread of the topic
+    public: std::size_t worker = 0;
+  };
+
+  /// \brief A message waiting for its worker thread
+  struct Queued
+  {
+    /// \brief Columns of the topic of the message
+    public: TopicColumns *columns = nullptr;
+
+    /// \brief Time when the message was received
+    public: int64_t time = 0;
+
+    /// \brief The serialized message
+    public: std::string data;
+  };
+
+  /// \brief A thread parsing the messages of some topics
+  struct Worker
+  {
+    /// \brief Protects queue and done
+    public: std::mutex mutex;
+
+    /// \brief Signals a change of queue or done
+    public: std::condition_variable condition;
+
+    /// \brief Messages waiting to be parsed
+    public: std::deque<Queued> queue;
+
+    /// \brief True once all the messages have been queued
+    public: bool done = false;
+
+    /// \brief The thread
+    public: std::thread thread;
+  };
+}
+
+//////////////////////////////////////////////////
+/// \brief Create an empty message of a type.
+/// \param[in] _type The message type
+/// \return The message, or nullptr if the type is unknown
+static std::unique_ptr<google::protobuf::Message> newMessage(
+    const std::string &_type)
+{
+  const google::protobuf::Descriptor *desc =
+    google::protobuf::DescriptorPool::generated_pool()
+      ->FindMessageTypeByName(_type);
+  if (desc)
+  {
+    const google::protobuf::Message *prototype =
+      google::protobuf::MessageFactory::generated_factory()->GetPrototype(
+        desc);
+    if (prototype)
+      return std::unique_ptr<google::protobuf::Message>(prototype->New());
+  }
+
+  // Fallback on Ignition Msgs if the message type is not found.
+  return ignition::msgs::Factory::New(_type);
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the kind of the column of a scalar field.
+/// \param[in] _field The field
+/// \return The kind, see ColumnExport.hh
+static std::string scalarKind(const FieldDescriptor *_field)
+{
+  switch (_field->cpp_type())
+  {
+    case FieldDescriptor::CPPTYPE_INT32:
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return "int32";
+    case FieldDescriptor::CPPTYPE_INT64:
+      return "int64";
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return "uint32";
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return "uint64";
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return "float";
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return "double";
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return "bool";
+    case FieldDescriptor::CPPTYPE_STRING:
+      return "string";
+    default:
+      return "";
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Add the columns of the fields of a message type and of its nested
+/// messages.
+/// \param[in] _desc The message type
+/// \param[in] _prefix Prefix of the names of the columns
+/// \param[in,out] _path Fields leading to the message type
+/// \param[in,out] _columns The columns
+static void addColumns(const google::protobuf::Descriptor *_desc,
+    const std::string &_prefix, std::vector<const FieldDescriptor *> &_path,
+    std::vector<Column> &_columns)
+{
+  if (_path.size() >= kMaxDepth)
+    return;
+
+  for (int i = 0; i < _desc->field_count(); ++i)
+  {
+    const FieldDescriptor *field = _desc->field(i);
+    const std::string name = _prefix + field->name();
+    _path.push_back(field);
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE)
+    {
+      if (!field->is_repeated())
+        addColumns(field->message_type(), name + ".", _path, _columns);
+    }
+    else
+    {
+      std::string kind = scalarKind(field);
+      if (field->is_repeated())
+        kind = kind == "string" ? "" : "list<" + kind + ">";
+      if (!kind.empty())
+      {
+        Column column;
+        column.name = name;
+        column.kind = kind;
+        column.path = _path;
+        _columns.push_back(std::move(column));
+      }
+    }
+    _path.pop_back();
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Append a value to a column.
+/// \param[in] _value The value
+/// \param[in,out] _values The values of the column
+template<typename T>
+static void appendValue(const T _value, std::string &_values)
+{
+  _values.append(reinterpret_cast<const char *>(&_value), sizeof(T));
+}
+
+//////////////////////////////////////////////////
+/// \brief Append the value of a scalar field to a column.
+/// \param[in] _msg Message holding the field
+/// \param[in] _field The field
+/// \param[in] _index Index of the value of a repeated field, or -1
+/// \param[in,out] _values The values of the column
+static void appendField(const google::protobuf::Message &_msg,
+    const FieldDescriptor *_field, const int _index, std::string &_values)
+{
+  const google::protobuf::Reflection *refl = _msg.GetReflection();
+  const bool repeated = _index >= 0;
+  switch (_field->cpp_type())
+  {
+    case FieldDescriptor::CPPTYPE_INT32:
+      appendValue<int32_t>(repeated ?
+          refl->GetRepeatedInt32(_msg, _field, _index) :
+          refl->GetInt32(_msg, _field), _values);
+      break;
+    case FieldDescriptor::CPPTYPE_ENUM:
+      appendValue<int32_t>(repeated ?
+          refl->GetRepeatedEnumValue(_msg, _field, _index) :
+          refl->GetEnumValue(_msg, _field), _values);
+      break;
+    case FieldDescriptor::CPPTYPE_INT64:
+      appendValue<int64_t>(repeated ?
+          refl->GetRepeatedInt64(_msg, _field, _index) :
+          refl->GetInt64(_msg, _field), _values);
+      break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+      appendValue<uint32_t>(repeated ?
+          refl->GetRepeatedUInt32(_msg, _field, _index) :
+          refl->GetUInt32(_msg, _field), _values);
+      break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+      appendValue<uint64_t>(repeated ?
+          refl->GetRepeatedUInt64(_msg, _field, _index) :
+          refl->GetUInt64(_msg, _field), _values);
+      break;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      appendValue<float>(repeated ?
+          refl->GetRepeatedFloat(_msg, _field, _index) :
+          refl->GetFloat(_msg, _field), _values);
+      break;
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      appendValue<double>(repeated ?
+          refl->GetRepeatedDouble(_msg, _field, _index) :
+          refl->GetDouble(_msg, _field), _values);
+      break;
+    case FieldDescriptor::CPPTYPE_BOOL:
+      appendValue<uint8_t>(repeated ?
+          refl->GetRepeatedBool(_msg, _field, _index) :
+          refl->GetBool(_msg, _field), _values);
+      break;
+    case FieldDescriptor::CPPTYPE_STRING:
+      _values += refl->GetString(_msg, _field);
+      break;
+    default:
+      break;
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Append a message to the columns of its topic.
+/// \param[in] _time Time when the message was received
+/// \param[in] _data The serialized message
+/// \param[in,out] _columns The columns of the topic
+static void appendRow(const int64_t _time, const std::string &_data,
+    TopicColumns &_columns)
+{
+  if (!_columns.msg->ParseFromString(_data))
+  {
+    ++_columns.failed;
+    return;
+  }
+
+  for (Column &column : _columns.columns)
+  {
+    if (column.path.empty())
+    {
+      appendValue(_time, column.values);
+      continue;
+    }
+
+    // The unset messages hold the default values
+    const google::protobuf::Message *msg = _columns.msg.get();
+    for (std::size_t i = 0; i + 1 < column.path.size(); ++i)
+      msg = &msg->GetReflection()->GetMessage(*msg, column.path[i]);
+
+    const FieldDescriptor *field = column.path.back();
+    if (!field->is_repeated())
+    {
+      appendField(*msg, field, -1, column.values);
+      if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING)
+        column.offsets.push_back(column.values.size());
+      continue;
+    }
+
+    const int size = msg->GetReflection()->FieldSize(*msg, field);
+    for (int i = 0; i < size; ++i)
+      appendField(*msg, field, i, column.values);
+    column.offsets.push_back(column.offsets.back() + size);
+  }
+  ++_columns.rows;
+}
+
+//////////////////////////////////////////////////
+/// \brief Write the file of the columns of a topic.
+/// \param[in] _file Path of the file
+/// \param[in] _columns The columns of the topic
+/// \return true if the file was written
+static bool writeColumns(const std::string &_file,
+    const TopicColumns &_columns)
+{
+  std::ofstream out(_file, std::ios_base::binary | std::ios_base::trunc);
+  out << kColumnsHeader << "\n"
+      << "topic " << _columns.topic << "\n"
+      << "type " << _columns.type << "\n"
+      << "rows " << _columns.rows << "\n";
+
+  // The strings and the lists have offsets before their values
+  const auto hasOffsets = [](const Column &_column)
+  {
+    return _column.kind == "string" || _column.kind.compare(0, 5, "list<") == 0;
+  };
+
+  uint64_t offset = 0;
+  for (const Column &column : _columns.columns)
+  {
+    uint64_t size = column.values.size();
+    if (hasOffsets(column))
+      size += column.offsets.size() * sizeof(uint64_t);
+    out << "column " << column.name << " " << column.kind << " " << offset
+        << " " << size << "\n";
+    offset += size;
+  }
+  out << "\n";
+
+  for (const Column &column : _columns.columns)
+  {
+    if (hasOffsets(column))
+    {
+      out.write(reinterpret_cast<const char *>(column.offsets.data()),
+          column.offsets.size() * sizeof(uint64_t));
+    }
+    out.write(column.values.data(), column.values.size());
+  }
+
+  out.close();
+  if (!out)
+  {
+    LERR("Failed to write [" << _file << "]\n");
+    return false;
+  }
+  LDBG("Exported " << _columns.rows << " messages of [" << _columns.topic
+       << "] to [" << _file << "]\n");
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string log::ColumnsFilename(const std::string &_dir,
+    const std::string &_topic, const std::string &_type)
+{
+  const std::size_t start = _topic.find_first_not_of('/');
+  std::string name =
+    start == std::string::npos ? std::string() : _topic.substr(start);
+  std::replace(name.begin(), name.end(), '/', '_');
+  std::replace(name.begin(), name.end(), '\\', '_');
+
+  std::string file = _dir;
+  if (!file.empty() && file.back() != '/')
+    file += '/';
+  return file + name + "." + _type + ".columns";
+}
+
+//////////////////////////////////////////////////
+bool log::ExportColumns(Log &_log, const std::string &_dir,
+    const std::regex &_pattern, std::size_t _threads)
+{
+  if (!_log.Valid())
+  {
+    LERR("Failed to open log file\n");
+    return false;
+  }
+
+  // The columns of the messages of each topic id
+  std::vector<std::unique_ptr<TopicColumns>> byId;
+  std::set<std::string> topics;
+  const Descriptor::NameToMap &allTopics =
+    _log.Descriptor()->TopicsToMsgTypesToId();
+  std::size_t count = 0;
+  for (const auto &topic : allTopics)
+  {
+    if (!std::regex_match(topic.first, _pattern))
+      continue;
+
+    for (const auto &type : topic.second)
+    {
+      auto columns = std::make_unique<TopicColumns>();
+      columns->msg = newMessage(type.first);
+      if (!columns->msg || type.second < 0)
+      {
+        LWRN("Skipping [" << topic.first << "]: unknown message type ["
+             << type.first << "]\n");
+        continue;
+      }
+      columns->topic = topic.first;
+      columns->type = type.first;
+
+      Column time;
+      time.name = "_time";
+      time.kind = "int64";
+      columns->columns.push_back(std::move(time));
+      std::vector<const FieldDescriptor *> path;
+      addColumns(columns->msg->GetDescriptor(), "", path, columns->columns);
+
+      columns->worker = count++;
+      const std::size_t id = static_cast<std::size_t>(type.second);
+      if (id >= byId.size())
+        byId.resize(id + 1);
+      byId[id] = std::move(columns);
+      topics.insert(topic.first);
+    }
+  }
+
+  if (count == 0)
+  {
+    LWRN("No topics to export\n");
+    return true;
+  }
+
+  if (_threads == 0)
+    _threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<Worker> workers(std::min(_threads, count));
+  for (auto &columns : byId)
+  {
+    if (columns)
+      columns->worker %= workers.size();
+  }
+
+  for (Worker &worker : workers)
+  {
+    worker.thread = std::thread([&worker]
+      {
+        while (true)
+        {
+          Queued queued;
+          {
+            std::unique_lock<std::mutex> lk(worker.mutex);
+            worker.condition.wait(lk,
+              [&worker]{return !worker.queue.empty() || worker.done;});
+            if (worker.queue.empty())
+              return;
+            queued = std::move(worker.queue.front());
+            worker.queue.pop_front();
+          }
+          worker.condition.notify_all();
+          appendRow(queued.time, queued.data, *queued.columns);
+        }
+      });
+  }
+
+  // The log is read once, in order
+  for (const Message &msg : _log.QueryMessages(TopicList::Create(topics)))
+  {
+    const int64_t id = msg.TopicId();
+    if (id < 0 || static_cast<std::size_t>(id) >= byId.size() || !byId[id])
+      continue;
+
+    Queued queued;
+    queued.columns = byId[id].get();
+    queued.time = msg.TimeReceived().count();
+    queued.data = msg.Data();
+
+    Worker &worker = workers[queued.columns->worker];
+    {
+      std::unique_lock<std::mutex> lk(worker.mutex);
+      worker.condition.wait(lk,
+        [&worker]{return worker.queue.size() < kQueuedMessages;});
+      worker.queue.push_back(std::move(queued));
+    }
+    worker.condition.notify_all();
+  }
+
+  for (Worker &worker : workers)
+  {
+    {
+      std::lock_guard<std::mutex> lk(worker.mutex);
+      worker.done = true;
+    }
+    worker.condition.notify_all();
+    worker.thread.join();
+  }
+
+  bool result = true;
+  for (const auto &columns : byId)
+  {
+    if (!columns)
+      continue;
+
+    if (columns->failed > 0)
+    {
+      LWRN("Failed to parse " << columns->failed << " messages of ["
+           << columns->topic << "]\n");
+    }
+    result = writeColumns(
+        ColumnsFilename(_dir, columns->topic, columns->type), *columns) &&
+      result;
+  }
+  return result;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_COLUMNEXPORT_HH_
+#define IGNITION_TRANSPORT_LOG_COLUMNEXPORT_HH_
+
+#include <cstddef>
+#include <regex>
+#include <string>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/log/Log.hh"
+
+/// \file ColumnExport.hh
+/// \brief Export of the messages of a log as columns, one file per topic and
+/// message type, so the fields can be loaded as arrays without parsing the
+/// messages again. The scalar fields of the messages are flattened into
+/// columns named after their path, e.g. "header.stamp.sec", and an extra
+/// column "_time" holds the time the messages were received. A file starts
+/// with a text header:
+///
+///   ignition-transport-columns 1
+///   topic <topic name>
+///   type <message type>
+///   rows <number of messages>
+///   column <name> <kind> <offset> <size>
+///   ...
+///
+/// followed by an empty line and the data of the columns, at the offset and
+/// with the size in bytes given by their line, from the end of the header.
+/// The values are in the byte order of the machine that exported them, and
+/// the kinds are int32, int64, uint32, uint64, float, double and bool (one
+/// byte), in rows values each. The enums are int32 columns. The strings and
+/// bytes fields are "string" columns: rows + 1 uint64 offsets followed by
+/// the characters, the value of row i spanning [offsets[i], offsets[i + 1])
+/// of the characters. The repeated scalar fields are "list<kind>" columns:
+/// rows + 1 uint64 offsets followed by the values, counted in values instead
+/// of bytes. The repeated messages and repeated strings are skipped.
+
+namespace ignition
+{
+namespace transport
+{
+namespace log
+{
+// Inline bracket to help doxygen filtering.
+inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+{
+  /// \brief Get the name of the file of a topic exported by ExportColumns().
+  /// \param[in] _dir Directory of the files
+  /// \param[in] _topic The topic name
+  /// \param[in] _type The message type
+  /// \return The path, with the separators of the topic replaced by '_',
+  /// e.g. "<dir>/camera_info.ignition.msgs.CameraInfo.columns"
+  std::string ColumnsFilename(const std::string &_dir,
+                              const std::string &_topic,
+                              const std::string &_type);
+
+  /// \brief Export the topics of a log as columns, see ColumnExport.hh. The
+  /// log is read once, and the messages are parsed by worker threads, each
+  /// one holding some of the topics. The message types are looked up in the
+  /// protobuf messages linked into the process and ignition-msgs, and the
+  /// topics of unknown types are skipped.
+  /// \param[in] _log The log
+  /// \param[in] _dir Existing directory of the files
+  /// \param[in] _pattern Pattern of the topic names to export
+  /// \param[in] _threads Number of worker threads, or 0 for one per hardware
+  /// thread
+  /// \return true if all the files were written, even if some messages
+  /// couldn't be parsed
+  bool ExportColumns(Log &_log, const std::string &_dir,
+                     const std::regex &_pattern, std::size_t _threads = 0);
+}
+}
+}
+}
+
+#endif
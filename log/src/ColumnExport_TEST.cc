@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <ignition/msgs/int32_v.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
+#include <ignition/msgs/vector3d.pb.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/log/Log.hh"
+#include "ignition/transport/test_config.h"
+#include "ColumnExport.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+using namespace std::chrono_literals;
+
+namespace
+{
+  /// \brief A file written by ExportColumns()
+  struct ColumnsFile
+  {
+    /// \brief Header lines other than the columns, e.g. "topic"
+    public: std::map<std::string, std::string> fields;
+
+    /// \brief Kind and data of each column
+    public: std::map<std::string, std::pair<std::string, std::string>>
+      columns;
+  };
+}
+
+//////////////////////////////////////////////////
+/// \brief Read a file written by ExportColumns().
+/// \param[in] _file Path of the file
+/// \param[out] _columns The contents of the file
+/// \return true if the file was read
+static bool readColumns(const std::string &_file, ColumnsFile &_columns)
+{
+  std::ifstream in(_file, std::ios_base::binary);
+  std::string line;
+  if (!std::getline(in, line) || line != "ignition-transport-columns 1")
+    return false;
+
+  std::vector<std::string> names;
+  std::vector<uint64_t> offsets;
+  std::vector<uint64_t> sizes;
+  while (std::getline(in, line) && !line.empty())
+  {
+    std::istringstream words(line);
+    std::string key;
+    words >> key;
+    if (key != "column")
+    {
+      std::getline(words >> std::ws, _columns.fields[key]);
+      continue;
+    }
+
+    std::string name;
+    std::string kind;
+    uint64_t offset;
+    uint64_t size;
+    words >> name >> kind >> offset >> size;
+    names.push_back(name);
+    offsets.push_back(offset);
+    sizes.push_back(size);
+    _columns.columns[name].first = kind;
+  }
+
+  const std::string data((std::istreambuf_iterator<char>(in)),
+      std::istreambuf_iterator<char>());
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    if (offsets[i] + sizes[i] > data.size())
+      return false;
+    _columns.columns[names[i]].second = data.substr(offsets[i], sizes[i]);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the values of a column.
+/// \param[in] _data Data of the column
+/// \param[in] _skip Number of values to skip, e.g. the offsets
+/// \return The values
+template<typename T>
+static std::vector<T> values(const std::string &_data,
+    const std::size_t _skip = 0)
+{
+  std::vector<T> result((_data.size() - _skip * sizeof(uint64_t)) /
+      sizeof(T));
+  std::memcpy(result.data(), _data.data() + _skip * sizeof(uint64_t),
+      result.size() * sizeof(T));
+  return result;
+}
+
+//////////////////////////////////////////////////
+TEST(ColumnExport, Filename)
+{
+  EXPECT_EQ("out/camera_info.a.B.columns",
+      log::ColumnsFilename("out", "/camera/info", "a.B"));
+  EXPECT_EQ("out/foo.a.B.columns",
+      log::ColumnsFilename("out/", "foo", "a.B"));
+  EXPECT_EQ("a_b.t.columns", log::ColumnsFilename("", "//a\\b", "t"));
+}
+
+//////////////////////////////////////////////////
+TEST(ColumnExport, Export)
+{
+  const std::string logName = "export_" + testing::getRandomNumber() +
+    ".tlog";
+  const std::string vectorType = msgs::Vector3d().GetTypeName();
+  const std::string listType = msgs::Int32_V().GetTypeName();
+  const std::string stringType = msgs::StringMsg().GetTypeName();
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+
+    for (int i = 0; i < 3; ++i)
+    {
+      msgs::Vector3d vector;
+      vector.set_x(i);
+      vector.set_z(-i);
+      vector.mutable_header()->mutable_stamp()->set_sec(10 + i);
+      std::string data = vector.SerializeAsString();
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+          "/vector", vectorType, data.data(), data.size()));
+
+      msgs::Int32_V list;
+      for (int j = 0; j <= i; ++j)
+        list.add_data(j);
+      data = list.SerializeAsString();
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i) + 1ms,
+          "/list", listType, data.data(), data.size()));
+
+      msgs::StringMsg str;
+      str.set_data(std::string(i + 1, 'a'));
+      data = str.SerializeAsString();
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i) + 2ms,
+          "/string", stringType, data.data(), data.size()));
+    }
+
+    // Not exported: unknown type, and a topic not matching the pattern
+    EXPECT_TRUE(logFile.InsertMessage(0s, "/unknown", "not.a.Type", "x", 1));
+    EXPECT_TRUE(logFile.InsertMessage(0s, "ignored", stringType, "x", 1));
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(logName));
+  ASSERT_TRUE(log::ExportColumns(logFile, ".", std::regex("/.*"), 2));
+
+  const std::string vectorFile = log::ColumnsFilename(".", "/vector",
+      vectorType);
+  const std::string listFile = log::ColumnsFilename(".", "/list", listType);
+  const std::string stringFile = log::ColumnsFilename(".", "/string",
+      stringType);
+
+  ColumnsFile vector;
+  ASSERT_TRUE(readColumns(vectorFile, vector));
+  EXPECT_EQ("/vector", vector.fields["topic"]);
+  EXPECT_EQ(vectorType, vector.fields["type"]);
+  EXPECT_EQ("3", vector.fields["rows"]);
+  EXPECT_EQ("int64", vector.columns["_time"].first);
+  EXPECT_EQ("double", vector.columns["x"].first);
+  EXPECT_EQ("int64", vector.columns["header.stamp.sec"].first);
+  EXPECT_EQ((std::vector<int64_t>{0, 1000000000, 2000000000}),
+      values<int64_t>(vector.columns["_time"].second));
+  EXPECT_EQ((std::vector<double>{0, 1, 2}),
+      values<double>(vector.columns["x"].second));
+  EXPECT_EQ((std::vector<double>{0, 0, 0}),
+      values<double>(vector.columns["y"].second));
+  EXPECT_EQ((std::vector<double>{0, -1, -2}),
+      values<double>(vector.columns["z"].second));
+  EXPECT_EQ((std::vector<int64_t>{10, 11, 12}),
+      values<int64_t>(vector.columns["header.stamp.sec"].second));
+
+  // The repeated messages aren't exported
+  EXPECT_EQ(0u, vector.columns.count("header.data"));
+
+  ColumnsFile list;
+  ASSERT_TRUE(readColumns(listFile, list));
+  EXPECT_EQ("3", list.fields["rows"]);
+  ASSERT_EQ("list<int32>", list.columns["data"].first);
+  const std::string &listData = list.columns["data"].second;
+  EXPECT_EQ((std::vector<uint64_t>{0, 1, 3, 6}),
+      values<uint64_t>(listData.substr(0, 4 * sizeof(uint64_t))));
+  EXPECT_EQ((std::vector<int32_t>{0, 0, 1, 0, 1, 2}), values<int32_t>(listData, 4));
+
+  ColumnsFile str;
+  ASSERT_TRUE(readColumns(stringFile, str));
+  ASSERT_EQ("string", str.columns["data"].first);
+  const std::string &strData = str.columns["data"].second;
+  EXPECT_EQ((std::vector<uint64_t>{0, 1, 3, 6}),
+      values<uint64_t>(strData.substr(0, 4 * sizeof(uint64_t))));
+  EXPECT_EQ("aaaaaa", strData.substr(4 * sizeof(uint64_t)));
+
+  std::ifstream unknown(log::ColumnsFilename(".", "/unknown", "not.a.Type"));
+  EXPECT_FALSE(unknown.is_open());
+  std::ifstream ignored(log::ColumnsFilename(".", "ignored", stringType));
+  EXPECT_FALSE(ignored.is_open());
+
+  EXPECT_EQ(0, std::remove(vectorFile.c_str()));
+  EXPECT_EQ(0, std::remove(listFile.c_str()));
+  EXPECT_EQ(0, std::remove(stringFile.c_str()));
+  EXPECT_EQ(0, std::remove(logName.c_str()));
+}
+
+//////////////////////////////////////////////////
+TEST(ColumnExport, InvalidLog)
+{
+  log::Log logFile;
+  EXPECT_FALSE(log::ExportColumns(logFile, ".", std::regex(".*")));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
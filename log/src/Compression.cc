@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstring>
+#include <vector>
+
+#include "build_config.hh"
+#include "Compression.hh"
+#include "Console.hh"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+/// \brief Size of the header of a compressed frame: the compression method
+/// and the size of the message.
+static const std::size_t kCompressedHeaderSize = 9;
+
+//////////////////////////////////////////////////
+/// \brief Store a message uncompressed.
+/// \param[in] _data The serialized message
+/// \param[in] _len Size of the message
+/// \param[out] _frame The framed message
+static void storeMessage(const void *_data, const std::size_t _len,
+    std::vector<char> &_frame)
+{
+  _frame.resize(_len + 1);
+  _frame[0] = static_cast<char>(LogOptions::Compression::NONE);
+  memcpy(_frame.data() + 1, _data, _len);
+}
+
+//////////////////////////////////////////////////
+bool log::CompressionAvailable(const LogOptions::Compression _compression)
+{
+  switch (_compression)
+  {
+    case LogOptions::Compression::NONE:
+      return true;
+    case LogOptions::Compression::ZLIB:
+#ifdef HAVE_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+//////////////////////////////////////////////////
+void log::EncodeMessage(const void *_data, const std::size_t _len,
+    const LogOptions::Compression _compression, const int _level,
+    const std::size_t _minSize, std::vector<char> &_frame)
+{
+  if (_compression != LogOptions::Compression::ZLIB || _len < _minSize)
+  {
+    storeMessage(_data, _len, _frame);
+    return;
+  }
+
+#ifdef HAVE_ZLIB
+  uLongf compressedLen = compressBound(static_cast<uLong>(_len));
+  _frame.resize(kCompressedHeaderSize + compressedLen);
+  int returnCode = compress2(
+      reinterpret_cast<Bytef *>(_frame.data() + kCompressedHeaderSize),
+      &compressedLen, reinterpret_cast<const Bytef *>(_data),
+      static_cast<uLong>(_len), _level);
+
+  // Keep the messages that don't get smaller as they are
+  if (returnCode != Z_OK || kCompressedHeaderSize + compressedLen > _len)
+  {
+    storeMessage(_data, _len, _frame);
+    return;
+  }
+
+  _frame.resize(kCompressedHeaderSize + compressedLen);
+  _frame[0] = static_cast<char>(LogOptions::Compression::ZLIB);
+  uint64_t size = _len;
+  for (std::size_t i = 1; i < kCompressedHeaderSize; ++i)
+  {
+    _frame[i] = static_cast<char>(size & 0xFF);
+    size >>= 8;
+  }
+#else
+  (void)_level;
+  storeMessage(_data, _len, _frame);
+#endif
+}
+
+//////////////////////////////////////////////////
+bool log::DecodeMessage(const void *_frame, const std::size_t _len,
+    std::vector<char> &_buffer, const void *&_data, std::size_t &_dataLen)
+{
+  if (_len == 0)
+    return false;
+
+  const unsigned char *frame = static_cast<const unsigned char *>(_frame);
+  switch (static_cast<LogOptions::Compression>(frame[0]))
+  {
+    case LogOptions::Compression::NONE:
+      _data = frame + 1;
+      _dataLen = _len - 1;
+      return true;
+#ifdef HAVE_ZLIB
+    case LogOptions::Compression::ZLIB:
+    {
+      if (_len < kCompressedHeaderSize)
+        return false;
+
+      uint64_t size = 0;
+      for (std::size_t i = kCompressedHeaderSize - 1; i > 0; --i)
+        size = (size << 8) | frame[i];
+
+      _buffer.resize(size);
+      uLongf decompressedLen = static_cast<uLongf>(size);
+      if (uncompress(reinterpret_cast<Bytef *>(_buffer.data()),
+            &decompressedLen, frame + kCompressedHeaderSize,
+            static_cast<uLong>(_len - kCompressedHeaderSize)) != Z_OK ||
+          decompressedLen != size)
+      {
+        return false;
+      }
+      _data = _buffer.data();
+      _dataLen = decompressedLen;
+      return true;
+    }
+#else
+    case LogOptions::Compression::ZLIB:
+      (void)_buffer;
+      LERR("Can't decompress the message, built without zlib\n");
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+//////////////////////////////////////////////////
+WorkerPool::WorkerPool(const std::size_t _threads)
+{
+  for (std::size_t i = 1; i < _threads; ++i)
+    this->workers.emplace_back(&WorkerPool::Loop, this);
+}
+
+//////////////////////////////////////////////////
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    this->stop = true;
+  }
+  this->newLoop.notify_all();
+
+  for (auto &worker : this->workers)
+    worker.join();
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::Run(const std::size_t _count,
+    const std::function<void(std::size_t)> &_task)
+{
+  if (this->workers.empty() || _count < 2)
+  {
+    for (std::size_t i = 0; i < _count; ++i)
+      _task(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    this->task = &_task;
+    this->count = _count;
+    this->next = 0;
+    this->busy = this->workers.size();
+    ++this->generation;
+  }
+  this->newLoop.notify_all();
+
+  // The calling thread takes part in the loop.
+  this->Work();
+
+  std::unique_lock<std::mutex> lk(this->mutex);
+  this->loopDone.wait(lk, [this]{return this->busy == 0;});
+  this->task = nullptr;
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::Work()
+{
+  for (std::size_t i = this->next.fetch_add(1); i < this->count;
+       i = this->next.fetch_add(1))
+  {
+    (*this->task)(i);
+  }
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::Loop()
+{
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lk(this->mutex);
+  while (true)
+  {
+    this->newLoop.wait(lk,
+      [&]{return this->stop || this->generation != seen;});
+
+    if (this->stop)
+      return;
+
+    seen = this->generation;
+    lk.unlock();
+    this->Work();
+    lk.lock();
+
+    if (--this->busy == 0)
+      this->loopDone.notify_one();
+  }
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_COMPRESSION_HH_
+#define IGNITION_TRANSPORT_LOG_COMPRESSION_HH_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/log/LogOptions.hh"
+
+namespace ignition
+{
+namespace transport
+{
+namespace log
+{
+// Inline bracket to help doxygen filtering.
+inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+{
+  /// \brief Check if a compression method can be used by this build.
+  /// \param[in] _compression The compression method
+  /// \return true if the messages can be compressed with it
+  bool CompressionAvailable(const LogOptions::Compression _compression);
+
+  /// \brief Frame a message as stored in the log files of schema 0.2.0,
+  /// compressing it if that makes it smaller. The frame starts with a byte
+  /// identifying the compression method (see LogOptions::Compression). The
+  /// compressed frames follow it with the size of the message as a little
+  /// endian 64 bit integer, and then the compressed data.
+  /// \param[in] _data The serialized message
+  /// \param[in] _len Size of the message
+  /// \param[in] _compression Compression method
+  /// \param[in] _level Compression level
+  /// \param[in] _minSize Smaller messages are not compressed
+  /// \param[out] _frame The framed message
+  void EncodeMessage(const void *_data, const std::size_t _len,
+      const LogOptions::Compression _compression, const int _level,
+      const std::size_t _minSize, std::vector<char> &_frame);
+
+  /// \brief Get a message from its frame, decompressing it if needed.
+  /// \param[in] _frame The framed message
+  /// \param[in] _len Size of the frame
+  /// \param[in,out] _buffer Memory to decompress the message into
+  /// \param[out] _data The serialized message, in the frame or in _buffer
+  /// \param[out] _dataLen Size of the message
+  /// \return true if the frame is valid
+  bool DecodeMessage(const void *_frame, const std::size_t _len,
+      std::vector<char> &_buffer, const void *&_data, std::size_t &_dataLen);
+
+  /// \brief A set of threads that run the iterations of a loop in parallel.
+  /// Used to compress the messages of a batch before inserting them.
+  class WorkerPool
+  {
+    /// \brief Constructor
+    /// \param[in] _threads Number of threads running the loops, including
+    /// the one calling Run()
+    public: explicit WorkerPool(const std::size_t _threads);
+
+    /// \brief Destructor. Waits for the threads.
+    public: ~WorkerPool();
+
+    /// \brief Run a loop and wait for all its iterations. Only one loop
+    /// runs at a time.
+    /// \param[in] _count Number of iterations
+    /// \param[in] _task Body of the loop, called with the iteration index
+    public: void Run(const std::size_t _count,
+                     const std::function<void(std::size_t)> &_task);
+
+    /// \brief Run iterations of the current loop until there are no more.
+    private: void Work();
+
+    /// \brief Loop of the worker threads.
+    private: void Loop();
+
+    /// \brief Protects the state of the current loop.
+    private: std::mutex mutex;
+
+    /// \brief Notifies the workers of a new loop.
+    private: std::condition_variable newLoop;
+
+    /// \brief Notifies Run() when the workers are done.
+    private: std::condition_variable loopDone;
+
+    /// \brief Body of the current loop.
+    private: const std::function<void(std::size_t)> *task = nullptr;
+
+    /// \brief Number of iterations of the current loop.
+    private: std::size_t count = 0;
+
+    /// \brief Next iteration to run.
+    private: std::atomic<std::size_t> next{0};
+
+    /// \brief Workers still running the current loop.
+    private: std::size_t busy = 0;
+
+    /// \brief Incremented for every loop.
+    private: uint64_t generation = 0;
+
+    /// \brief True when the pool is destroyed.
+    private: bool stop = false;
+
+    /// \brief The worker threads.
+    private: std::vector<std::thread> workers;
+  };
+}
+}
+}
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Compression.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+
+//////////////////////////////////////////////////
+/// \brief Decode a frame into a string.
+/// \param[in] _frame The frame
+/// \param[out] _data The message
+/// \return true if the frame was decoded
+static bool decode(const std::vector<char> &_frame, std::string &_data)
+{
+  std::vector<char> buffer;
+  const void *data = nullptr;
+  std::size_t len = 0;
+  if (!log::DecodeMessage(_frame.data(), _frame.size(), buffer, data, len))
+    return false;
+  _data.assign(static_cast<const char *>(data), len);
+  return true;
+}
+
+//////////////////////////////////////////////////
+TEST(Compression, Uncompressed)
+{
+  const std::string data("some_data");
+  std::vector<char> frame;
+  log::EncodeMessage(data.c_str(), data.size(),
+      log::LogOptions::Compression::NONE, 1, 0, frame);
+  ASSERT_EQ(data.size() + 1, frame.size());
+  EXPECT_EQ(0, frame[0]);
+
+  std::string decoded;
+  EXPECT_TRUE(decode(frame, decoded));
+  EXPECT_EQ(data, decoded);
+}
+
+//////////////////////////////////////////////////
+TEST(Compression, Zlib)
+{
+  if (!log::CompressionAvailable(log::LogOptions::Compression::ZLIB))
+  {
+    std::cerr << "Built without zlib, skipping test." << std::endl;
+    return;
+  }
+
+  const std::string data(1000, 'x');
+  std::vector<char> frame;
+  log::EncodeMessage(data.c_str(), data.size(),
+      log::LogOptions::Compression::ZLIB, 1, 128, frame);
+  EXPECT_LT(frame.size(), data.size());
+  EXPECT_EQ(1, frame[0]);
+
+  std::string decoded;
+  EXPECT_TRUE(decode(frame, decoded));
+  EXPECT_EQ(data, decoded);
+
+  // A truncated frame is invalid.
+  frame.resize(frame.size() / 2);
+  EXPECT_FALSE(decode(frame, decoded));
+
+  // The small messages are stored as they are.
+  log::EncodeMessage(data.c_str(), 100,
+      log::LogOptions::Compression::ZLIB, 1, 128, frame);
+  EXPECT_EQ(0, frame[0]);
+
+  // And so are the ones that don't get smaller.
+  const std::string random("a8#kQ!z0");
+  log::EncodeMessage(random.c_str(), random.size(),
+      log::LogOptions::Compression::ZLIB, 9, 0, frame);
+  EXPECT_EQ(0, frame[0]);
+  EXPECT_TRUE(decode(frame, decoded));
+  EXPECT_EQ(random, decoded);
+}
+
+//////////////////////////////////////////////////
+TEST(Compression, InvalidFrame)
+{
+  std::string decoded;
+  EXPECT_FALSE(decode({}, decoded));
+  EXPECT_FALSE(decode({42, 'a'}, decoded));
+}
+
+//////////////////////////////////////////////////
+TEST(Compression, WorkerPool)
+{
+  for (std::size_t threads : {0u, 1u, 4u})
+  {
+    log::WorkerPool pool(threads);
+    for (int loop = 0; loop < 10; ++loop)
+    {
+      std::vector<std::atomic<int>> runs(100);
+      pool.Run(runs.size(), [&runs](std::size_t _i) { ++runs[_i]; });
+      for (const auto &run : runs)
+        EXPECT_EQ(1, run);
+    }
+  }
+}
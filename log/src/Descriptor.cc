@@ -30,14 +30,18 @@ void Descriptor::Implementation::Reset(const TopicKeyMap &_columns)
 
   for (const auto &entry : _columns)
   {
-    const TopicKey &key = entry.first;
-    int64_t id = entry.second;
-
-    this->topicsToMsgTypesToId[key.topic][key.type] = id;
-    this->msgTypesToTopicsToId[key.type][key.topic] = id;
+    this->Insert(entry.first, entry.second);
   }
 }
 
+//////////////////////////////////////////////////
+void Descriptor::Implementation::Insert(const TopicKey &_key,
+    const int64_t _id)
+{
+  this->topicsToMsgTypesToId[_key.topic][_key.type] = _id;
+  this->msgTypesToTopicsToId[_key.type][_key.topic] = _id;
+}
+
 //////////////////////////////////////////////////
 auto Descriptor::TopicsToMsgTypesToId() const -> const NameToMap &
 {
@@ -50,6 +54,12 @@ auto Descriptor::MsgTypesToTopicsToId() const -> const NameToMap &
   return this->dataPtr->msgTypesToTopicsToId;
 }
 
+//////////////////////////////////////////////////
+bool Descriptor::HasTopicTimeIndex() const
+{
+  return this->dataPtr->topicTimeIndex;
+}
+
 //////////////////////////////////////////////////
 int64_t Descriptor::TopicId(const std::string &_topicName,
     const std::string &_msgType) const
@@ -78,6 +78,13 @@ namespace ignition
         /// \param[in] _topics The map of topics that the log contains.
         public: void Reset(const TopicKeyMap &_topics);
 
+        /// \internal Add a topic to this descriptor. This should only be
+        /// called by the Log class, when it has inserted the topic in the
+        /// file, so the descriptor doesn't have to be generated again.
+        /// \param[in] _key The name and message type of the topic.
+        /// \param[in] _id The id of the topic.
+        public: void Insert(const TopicKey &_key, const int64_t _id);
+
 #ifdef _WIN32
 // Disable warning C4251 which is triggered by
 // std::unique_ptr
@@ -89,6 +96,9 @@ namespace ignition
 
         /// \internal \sa Descriptor::MsgTypesToTopicsToId()
         public: NameToMap msgTypesToTopicsToId;
+
+        /// \internal \sa Descriptor::HasTopicTimeIndex()
+        public: bool topicTimeIndex = false;
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
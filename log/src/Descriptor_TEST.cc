@@ -39,6 +39,14 @@ class ignition::transport::log::Log
   {
     descriptor.dataPtr->Reset(_topics);
   }
+
+  /// \brief call descriptor api Insert()
+  /// \sa Descriptor::Implementation::Insert(const TopicKey &, int64_t)
+  public: static void Insert(
+      Descriptor &descriptor, const TopicKey &_key, const int64_t _id)
+  {
+    descriptor.dataPtr->Insert(_key, _id);
+  }
 };
 
 //////////////////////////////////////////////////
@@ -109,6 +117,28 @@ TEST(Descriptor, TopicIdMultipleTopicsSameType)
   EXPECT_GT(0, desc.TopicId("/foo/bar", "ign.msgs.DNEE"));
 }
 
+//////////////////////////////////////////////////
+TEST(Descriptor, InsertKeepsTopics)
+{
+  Descriptor desc = Log::Construct();
+  TopicKeyMap topics;
+  TopicKey key1 = {"/foo/bar", "ign.msgs.DNE"};
+  topics[key1] = 5;
+  Log::Reset(desc, topics);
+
+  TopicKey key2 = {"/foo/bar", "ign.msgs.DNE2"};
+  TopicKey key3 = {"/fiz/buz", "ign.msgs.DNE"};
+  Log::Insert(desc, key2, 6);
+  Log::Insert(desc, key3, 7);
+  EXPECT_EQ(5, desc.TopicId("/foo/bar", "ign.msgs.DNE"));
+  EXPECT_EQ(6, desc.TopicId("/foo/bar", "ign.msgs.DNE2"));
+  EXPECT_EQ(7, desc.TopicId("/fiz/buz", "ign.msgs.DNE"));
+  EXPECT_EQ(2u, desc.TopicsToMsgTypesToId().at("/foo/bar").size());
+  EXPECT_EQ(2u, desc.MsgTypesToTopicsToId().at("ign.msgs.DNE").size());
+  EXPECT_EQ(6, desc.MsgTypesToTopicsToId().at("ign.msgs.DNE2").at(
+      "/foo/bar"));
+}
+
 //////////////////////////////////////////////////
 TEST(Descriptor, TopicsMapOneTopic)
 {
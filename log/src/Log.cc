@@ -17,22 +17,33 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "ignition/transport/log/Descriptor.hh"
 #include "ignition/transport/log/Log.hh"
+#include "ignition/transport/log/LogOptions.hh"
+#include "ignition/transport/log/QueryOptions.hh"
 #include "ignition/transport/log/SqlStatement.hh"
 #include "BatchPrivate.hh"
 #include "build_config.hh"
+#include "ChunkedLog.hh"
+#include "Compression.hh"
 #include "Console.hh"
 #include "Descriptor.hh"
+#include "Manifest.hh"
 #include "raii-sqlite3.hh"
 
 using namespace ignition::transport;
@@ -58,24 +69,135 @@ class ignition::transport::log::Log::Implementation
 
   /// \brief Get topic_id associated with a topic name and message type
   /// If the topic is not in the log it will be added
-  /// \note Invalidates the descriptor if a topic is inserted
+  /// \note Adds the topic to the descriptor if it is inserted
   /// \param[in] _name the name of the topic
   /// \param[in] _type the name of the message type
   /// \return topic_id or -1 if one could not be produced
   public: int64_t InsertOrGetTopicId(
       const std::string &_name, const std::string &_type);
 
-  /// \brief Insert a message into the database
+  /// \brief Insert a message into the database, framing it first if the
+  /// log file uses the schema 0.2.0
   public: bool InsertMessage(const std::chrono::nanoseconds &_time,
       int64_t _topic, const void *_data, std::size_t _len);
 
+  /// \brief Insert a message as it is stored in the database: the message
+  /// itself, or its frame if the log file uses the schema 0.2.0
+  public: bool InsertFrame(const std::chrono::nanoseconds &_time,
+      int64_t _topic, const void *_data, std::size_t _len);
+
+  /// \brief Write the statistics of the messages inserted to the table
+  /// topic_summaries, so opening the log file doesn't need to go through
+  /// its messages. See kSummarySchema.
+  /// \return true if the table was written
+  public: bool WriteSummary();
+
+  /// \brief Get a statement that is compiled once and reused afterwards.
+  /// \param[in,out] _statement The cached statement
+  /// \param[in] _sql The statement to compile the first time
+  /// \return The statement, or nullptr if it could not be compiled
+  public: raii_sqlite3::Statement *CachedStatement(
+      std::unique_ptr<raii_sqlite3::Statement> &_statement,
+      const char *_sql);
+
   /// \brief Return true if enough time has passed since the last transaction
+  /// or if the transaction holds enough messages
   /// \return true if the transaction has lasted long enough
   public: bool TimeForNewTransaction() const;
 
+  /// \brief Keep the settings of a log file that was opened
+  /// \param[in] _file Name of the log file
+  /// \param[in] _options The settings
+  /// \param[in] _write True if the log file is open for writing
+  public: void Configure(const std::string &_file,
+      const LogOptions &_options, bool _write);
+
+  /// \brief Get the description of the last error
+  /// \return The description
+  public: const char *ErrorMessage() const;
+
+  /// \brief Apply the settings of the database
+  /// \param[in] _db The database
+  /// \param[in] _options The settings
+  /// \param[in] _write True if the database is open for writing
+  /// \return true if all the settings were applied
+  public: static bool ApplyOptions(raii_sqlite3::Database &_db,
+      const LogOptions &_options, bool _write);
+
+  /// \brief Open log files as the shards of this log, see shards
+  /// \param[in] _files Paths to the log files, opened with their parts
+  /// \param[in] _options Settings of the databases
+  /// \return true if all the log files were opened
+  public: bool OpenShards(const std::vector<std::string> &_files,
+      const LogOptions &_options);
+
   /// \brief SQLite3 database pointer wrapper
   public: std::shared_ptr<raii_sqlite3::Database> db;
 
+  /// \brief Writer of a chunked log file, instead of the database
+  public: std::unique_ptr<ChunkWriter> chunkWriter;
+
+  /// \brief Parts of a split recording, which is read through them instead
+  /// of db
+  public: std::vector<std::unique_ptr<Log>> parts;
+
+  /// \brief Log files of the topic groups of a recording, listed by a
+  /// manifest, or recordings merged by Log::OpenMerged(), which is read
+  /// through them instead of db
+  public: std::vector<std::unique_ptr<Log>> shards;
+
+  /// \brief Get the logs that this log is read through, if any.
+  /// \return The shards or the parts of the log
+  public: const std::vector<std::unique_ptr<Log>> &Children() const;
+
+  /// \brief Get the statements that query the messages of this log.
+  /// \param[in] _options The query
+  /// \param[out] _streams The streams to add the statements to, one per
+  /// shard
+  /// \param[in] _headersOnly True to leave out the data of the messages,
+  /// see Log::QueryHeaders()
+  /// \param[in] _newConnections True to query the log files through
+  /// connections of their own, see Connection()
+  /// \param[in] _ids Descriptor of the log that is queried, whose topic ids
+  /// the messages get, or nullptr for this log
+  /// \return false if the log hasn't been opened
+  public: bool AppendStreams(const QueryOptions &_options,
+      std::vector<BatchPrivate::Stream> &_streams,
+      const bool _headersOnly = false,
+      const bool _newConnections = false,
+      const log::Descriptor *_ids = nullptr) const;
+
+  /// \brief Get a connection to the database to query it.
+  /// \param[in] _new True for a connection of its own, which can be used
+  /// concurrently with the others. The log files that can't be opened
+  /// again, like the chunked log files, share their connection anyway.
+  /// \return The connection, or nullptr if it failed
+  public: std::shared_ptr<raii_sqlite3::Database> Connection(
+      const bool _new) const;
+
+  /// \brief Copy the messages of a query into a new log file, directly
+  /// between the databases, see Log::Extract().
+  /// \param[in] _file Path of the new log file, which has the schema and no
+  /// messages
+  /// \param[in] _options The query
+  /// \return true if the messages were copied
+  public: bool CopyRows(const std::string &_file,
+      const QueryOptions &_options) const;
+
+  /// \brief True if the log file can be opened again by other connections:
+  /// it's read only, and not a chunked log file
+  public: bool reopenable = false;
+
+  /// \brief Compiled statement to insert a message. The statements are
+  /// declared after the database, so they are finalized before it closes.
+  public: std::unique_ptr<raii_sqlite3::Statement> insertMessageStatement;
+
+  /// \brief Compiled statement to insert a message type
+  public: std::unique_ptr<raii_sqlite3::Statement> insertMessageTypeStatement;
+
+  /// \brief Compiled statement to insert a topic
+  public: std::unique_ptr<raii_sqlite3::Statement> insertTopicStatement;
+
   /// \brief True if a transaction is in progress
   public: bool inTransaction = false;
 
@@ -88,6 +210,42 @@ class ignition::transport::log::Log::Implementation
   /// \brief duration between transactions
   public: std::chrono::milliseconds transactionPeriod;
 
+  /// \brief Size of the messages that end a transaction, or 0 for no limit
+  public: std::size_t transactionMaxBytes = 0;
+
+  /// \brief Number of messages that end a transaction, or 0 for no limit
+  public: uint64_t transactionMaxMessages = 0;
+
+  /// \brief Size of the messages inserted in the current transaction
+  public: std::size_t transactionBytes = 0;
+
+  /// \brief Number of messages inserted in the current transaction
+  public: uint64_t transactionMessages = 0;
+
+  /// \brief True if the log was written using a write ahead log
+  public: bool wal = false;
+
+  /// \brief True if the messages are framed, in the log files of schema
+  /// 0.2.0. See Compression.hh.
+  public: bool framed = false;
+
+  /// \brief Compression of the messages inserted
+  public: LogOptions::Compression compression =
+    LogOptions::Compression::NONE;
+
+  /// \brief Compression level
+  public: int compressionLevel = 1;
+
+  /// \brief Size of the smallest message that is compressed
+  public: std::size_t compressionMinSize = 0;
+
+  /// \brief Threads compressing the messages inserted together
+  public: std::unique_ptr<WorkerPool> compressionPool;
+
+  /// \brief Frames of the messages being inserted, kept to reuse their
+  /// memory
+  public: std::vector<std::vector<char>> frames;
+
   /// \brief Flag to track whether we need to generate a new Descriptor
   private: mutable bool needNewDescriptor = true;
 
@@ -97,16 +255,381 @@ class ignition::transport::log::Log::Implementation
   /// \brief Name of the log file.
   public: std::string filename = "";
 
+  /// \brief Settings the log file was opened with
+  public: LogOptions options;
+
   /// \brief Time of the first message in the log file.
   public: std::chrono::nanoseconds startTime = std::chrono::nanoseconds(-1);
 
   /// \brief Time of the last message in the log file.
   public: std::chrono::nanoseconds endTime = std::chrono::nanoseconds(-1);
+
+  /// \brief Statistics of the messages of a topic
+  public: struct TopicStats
+  {
+    /// \brief Number of messages
+    uint64_t messages = 0;
+
+    /// \brief Size of the messages as stored
+    uint64_t bytes = 0;
+
+    /// \brief Time of the first message, in nanoseconds
+    int64_t firstTime = 0;
+
+    /// \brief Time of the last message, in nanoseconds
+    int64_t lastTime = 0;
+  };
+
+  /// \brief Statistics of the messages inserted, by topic id, written when
+  /// the log file closes
+  public: std::unordered_map<int64_t, TopicStats> insertedStats;
+
+  /// \brief True to write the table topic_summaries when the log closes
+  public: bool writeSummary = false;
+
+  /// \brief True if the log file has the table topic_summaries, which is
+  /// then used instead of the messages for their times and statistics
+  public: bool hasSummary = false;
+};
+
+/// \brief Table of the statistics of the messages of every topic, written
+/// when a log file closes. The log files recorded by older versions, or not
+/// closed properly, don't have it. It's not part of the schema files: it
+/// only exists once it's complete.
+static const char *const kSummarySchema =
+  "CREATE TABLE topic_summaries ("
+  " topic_id INTEGER PRIMARY KEY REFERENCES topics (id) ON DELETE CASCADE,"
+  " messages INTEGER NOT NULL,"
+  " bytes INTEGER NOT NULL,"
+  " first_time INTEGER NOT NULL,"
+  " last_time INTEGER NOT NULL);";
+
+//////////////////////////////////////////////////
+/// \brief Execute a statement that returns no data, and make it ready to be
+/// executed again.
+/// \param[in] _statement The statement
+/// \return The result of sqlite3_step()
+static int stepAndReset(sqlite3_stmt *_statement)
+{
+  int returnCode = sqlite3_step(_statement);
+  sqlite3_reset(_statement);
+  sqlite3_clear_bindings(_statement);
+  return returnCode;
+}
+
+//////////////////////////////////////////////////
+/// \brief Bind the parameters of a query to its compiled statement.
+/// \param[in] _statement The compiled statement
+/// \param[in] _query The query, with its parameters
+/// \return true if all the parameters were bound
+static bool bindParameters(sqlite3_stmt *_statement,
+    const SqlStatement &_query)
+{
+  int i = 1;
+  for (const SqlParameter &param : _query.parameters)
+  {
+    int returnCode = SQLITE_ERROR;
+    switch (param.Type())
+    {
+      case SqlParameter::ParamType::TEXT:
+        returnCode = sqlite3_bind_text(_statement, i,
+          param.QueryText()->c_str(), param.QueryText()->size(),
+          SQLITE_STATIC);
+        break;
+      case SqlParameter::ParamType::INTEGER:
+        returnCode = sqlite3_bind_int64(_statement, i, *param.QueryInteger());
+        break;
+      case SqlParameter::ParamType::REAL:
+        returnCode = sqlite3_bind_double(_statement, i, *param.QueryReal());
+        break;
+      default:
+        break;
+    }
+    if (returnCode != SQLITE_OK)
+      return false;
+    ++i;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the URI that opens a file read only, for ATTACH.
+/// \param[in] _file Path of the file
+/// \return The URI
+static std::string readOnlyUri(const std::string &_file)
+{
+  static const char *const kHex = "0123456789ABCDEF";
+  std::string uri = "file:";
+  for (const char c : _file)
+  {
+    // These characters would end the path of the URI
+    if (c == '%' || c == '?' || c == '#')
+    {
+      uri += '%';
+      uri += kHex[(c >> 4) & 0xF];
+      uri += kHex[c & 0xF];
+    }
+    else
+    {
+      uri += c;
+    }
+  }
+  return uri + "?mode=ro";
+}
+
+//////////////////////////////////////////////////
+/// \brief Insert a name before the extension of a file, e.g. to name the
+/// files of a recording.
+/// \param[in] _file Path of the file
+/// \param[in] _name The name to insert
+/// \return The new path, _file with ".<_name>" before its extension
+static std::string insertBeforeExtension(const std::string &_file,
+    const std::string &_name)
+{
+  // The extension is after the last dot of the file name, if any
+  std::size_t dot = _file.find_last_of('.');
+  const std::size_t separator = _file.find_last_of("/\\");
+  if (dot == std::string::npos ||
+      (separator != std::string::npos && dot < separator))
+  {
+    dot = _file.size();
+  }
+
+  return _file.substr(0, dot) + "." + _name + _file.substr(dot);
+}
+
+//////////////////////////////////////////////////
+/// \brief Read a file of the schema of the log files.
+/// \param[in] _name Name of the file, in the schema directory
+/// \param[out] _schema The SQL statements of the file
+/// \return true if the file was read
+static bool readSchemaFile(const std::string &_name, std::string &_schema)
+{
+  // Test hook so tests can be run before `make install`
+  std::string schemaFile;
+  const char *envPath = std::getenv(SchemaLocationEnvVar.c_str());
+  if (envPath)
+  {
+    schemaFile = envPath;
+  }
+  else
+  {
+    schemaFile = SCHEMA_INSTALL_PATH;
+  }
+  schemaFile += "/" + _name;
+
+  LDBG("Schema file: " << schemaFile << "\n");
+  std::ifstream fin(schemaFile, std::ifstream::in);
+  if (!fin)
+  {
+    LERR("Failed to open schema [" << schemaFile << "].\n"
+        << " Set " << SchemaLocationEnvVar << " to the schema location.\n");
+    return false;
+  }
+
+  // Read the schema file
+  _schema.clear();
+  char buffer[4096];
+  while (fin)
+  {
+    fin.read(buffer, sizeof(buffer));
+    _schema.insert(_schema.size(), buffer, fin.gcount());
+  }
+  if (_schema.empty())
+  {
+    LERR("Failed to read schema file [" << schemaFile << "]\n");
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Query of the messages of a slice of time, one of the partitions
+/// of Log::QueryPartitions(). The statements of another query are wrapped
+/// in a query that keeps the messages of the slice.
+class TimeSlice final : public QueryOptions
+{
+  /// \brief Constructor
+  /// \param[in] _options The query to slice, which must outlive this
+  /// \param[in] _begin Beginning of the slice, included
+  /// \param[in] _end End of the slice
+  /// \param[in] _last True if the end of the slice is included, for the last
+  /// slice
+  public: TimeSlice(const QueryOptions &_options,
+                    const std::chrono::nanoseconds &_begin,
+                    const std::chrono::nanoseconds &_end,
+                    const bool _last)
+    : options(_options), begin(_begin), end(_end), last(_last)
+  {
+  }
+
+  // Documentation inherited
+  public: std::vector<SqlStatement> GenerateStatements(
+      const log::Descriptor &_descriptor) const override
+  {
+    std::vector<SqlStatement> statements =
+      this->options.GenerateStatements(_descriptor);
+    for (SqlStatement &sql : statements)
+    {
+      // The messages stay sorted by the query that is wrapped
+      std::string &inner = sql.statement;
+      while (!inner.empty() && (inner.back() == ';' || inner.back() == ' '))
+        inner.pop_back();
+      inner = "SELECT * FROM (" + inner + ") WHERE time_recv >= ? AND"
+        " time_recv " + (this->last ? "<=" : "<") + " ?;";
+      sql.parameters.emplace_back(static_cast<int64_t>(this->begin.count()));
+      sql.parameters.emplace_back(static_cast<int64_t>(this->end.count()));
+    }
+    return statements;
+  }
+
+  /// \brief Get the query that is sliced.
+  /// \return The query
+  public: const QueryOptions &Options() const
+  {
+    return this->options;
+  }
+
+  /// \brief Get the beginning of the slice.
+  /// \return The time of the beginning
+  public: const std::chrono::nanoseconds &Begin() const
+  {
+    return this->begin;
+  }
+
+  /// \brief Get the end of the slice.
+  /// \return The time of the end
+  public: const std::chrono::nanoseconds &End() const
+  {
+    return this->end;
+  }
+
+  /// \brief The query to slice
+  private: const QueryOptions &options;
+
+  /// \brief Beginning of the slice
+  private: std::chrono::nanoseconds begin;
+
+  /// \brief End of the slice
+  private: std::chrono::nanoseconds end;
+
+  /// \brief True if the end of the slice is included
+  private: bool last;
 };
 
+//////////////////////////////////////////////////
+/// \brief Check if a log may have messages in the time range of a query.
+/// Uses the cached start and end times of the log, so the parts of a long
+/// split recording that a seek jumps over aren't queried at all.
+/// \param[in] _log The log
+/// \param[in] _options The query
+/// \return false if all the messages of the log are out of the time range
+static bool mayMatch(const Log &_log, const QueryOptions &_options)
+{
+  const TimeSlice *slice = dynamic_cast<const TimeSlice *>(&_options);
+  if (slice)
+  {
+    if (_log.EndTime() < slice->Begin() || _log.StartTime() > slice->End())
+      return false;
+    return mayMatch(_log, slice->Options());
+  }
+
+  const TimeRangeOption *timeOption =
+    dynamic_cast<const TimeRangeOption *>(&_options);
+  if (!timeOption)
+    return true;
+
+  const QualifiedTime &begin = timeOption->TimeRange().Beginning();
+  const QualifiedTime &end = timeOption->TimeRange().Ending();
+  if (!begin.IsIndeterminate() && _log.EndTime() < *begin.GetTime())
+    return false;
+  if (!end.IsIndeterminate() && _log.StartTime() > *end.GetTime())
+    return false;
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Map the topic ids of a log file to those of the log it's part of,
+/// see BatchPrivate::Segment::topicIds.
+/// \param[in] _from Descriptor of the log file
+/// \param[in] _to Descriptor of the log that is queried
+/// \return The ids of _to by the ids of _from, or empty if they are the same
+static std::unordered_map<int64_t, int64_t> topicIdMap(
+    const log::Descriptor &_from, const log::Descriptor &_to)
+{
+  std::unordered_map<int64_t, int64_t> ids;
+  bool same = true;
+  for (const auto &topic : _from.TopicsToMsgTypesToId())
+  {
+    for (const auto &type : topic.second)
+    {
+      const int64_t id = _to.TopicId(topic.first, type.first);
+      same = same && id == type.second;
+      ids.emplace(type.second, id);
+    }
+  }
+  if (same)
+    ids.clear();
+  return ids;
+}
+
+//////////////////////////////////////////////////
+/// \brief Make the queries of messages select NULL instead of the data of
+/// the messages, so SQLite doesn't load it. Only the queries that use
+/// QueryOptions::StandardMessageQueryPreamble() change.
+/// \param[in,out] _statements The queries
+static void dropMessageData(std::vector<SqlStatement> &_statements)
+{
+  static const std::string kDataColumn =
+    " messages.message, messages.topic_id FROM ";
+  static const std::string kNoData = " NULL, messages.topic_id FROM ";
+  for (SqlStatement &sql : _statements)
+  {
+    for (std::size_t pos = sql.statement.find(kDataColumn);
+         pos != std::string::npos;
+         pos = sql.statement.find(kDataColumn, pos + kNoData.size()))
+    {
+      sql.statement.replace(pos, kDataColumn.size(), kNoData);
+    }
+  }
+}
+
 //////////////////////////////////////////////////
 const log::Descriptor *Log::Implementation::Descriptor() const
 {
+  // A split or sharded recording has the topics of all its logs
+  const auto &children = this->Children();
+  if (!children.empty() && this->needNewDescriptor)
+  {
+    TopicKeyMap topicsInLog;
+    bool topicTimeIndex = true;
+    for (const auto &part : children)
+    {
+      const log::Descriptor *partDescriptor = part->Descriptor();
+      if (!partDescriptor)
+        return nullptr;
+      topicTimeIndex = topicTimeIndex && partDescriptor->HasTopicTimeIndex();
+
+      for (const auto &topic : partDescriptor->TopicsToMsgTypesToId())
+      {
+        for (const auto &type : topic.second)
+        {
+          TopicKey key;
+          key.topic = topic.first;
+          key.type = type.first;
+          topicsInLog.emplace(key, type.second);
+        }
+      }
+    }
+
+    this->needNewDescriptor = false;
+    descriptor.dataPtr->Reset(topicsInLog);
+    descriptor.dataPtr->topicTimeIndex = topicTimeIndex;
+  }
+
+  if (!children.empty())
+    return &this->descriptor;
+
   if (!this->db)
     return nullptr;
 
@@ -163,14 +686,122 @@ const log::Descriptor *Log::Implementation::Descriptor() const
       }
     } while (returnCode == SQLITE_ROW);
 
+    // The log files recorded before idx_topic_time_recv was added don't
+    // have it, see topic_time_index.sql
+    raii_sqlite3::Statement indexStatement(*(this->db),
+        "SELECT 1 FROM sqlite_master WHERE type = 'index'"
+        " AND name = 'idx_topic_time_recv';");
+    if (!indexStatement)
+    {
+      LERR("Failed to compile statement to find the topic index\n");
+      return nullptr;
+    }
+
     // Save the result into the descriptor
     this->needNewDescriptor = false;
     descriptor.dataPtr->Reset(topicsInLog);
+    descriptor.dataPtr->topicTimeIndex =
+      sqlite3_step(indexStatement.Handle()) == SQLITE_ROW;
   }
 
   return &this->descriptor;
 }
 
+//////////////////////////////////////////////////
+const std::vector<std::unique_ptr<Log>> &Log::Implementation::Children() const
+{
+  return this->shards.empty() ? this->parts : this->shards;
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::AppendStreams(const QueryOptions &_options,
+    std::vector<BatchPrivate::Stream> &_streams,
+    const bool _headersOnly, const bool _newConnections,
+    const log::Descriptor *_ids) const
+{
+  const log::Descriptor *ids = _ids ? _ids : this->Descriptor();
+  if (!ids)
+    return false;
+
+  // Every shard is a stream of its own
+  if (!this->shards.empty())
+  {
+    for (const auto &shard : this->shards)
+    {
+      if (!mayMatch(*shard, _options))
+        continue;
+      if (!shard->dataPtr->AppendStreams(
+            _options, _streams, _headersOnly, _newConnections, ids))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The parts of a split recording are queried one after the other, since
+  // their messages are in order
+  BatchPrivate::Stream stream;
+  if (!this->parts.empty())
+  {
+    for (const auto &part : this->parts)
+    {
+      const log::Descriptor *partDesc = part->Descriptor();
+      if (!partDesc)
+        return false;
+      if (!mayMatch(*part, _options))
+        continue;
+
+      BatchPrivate::Segment segment;
+      segment.db = part->dataPtr->Connection(_newConnections);
+      if (!segment.db)
+        return false;
+      segment.statements = _options.GenerateStatements(*partDesc);
+      if (_headersOnly)
+        dropMessageData(segment.statements);
+      segment.framed = part->dataPtr->framed;
+      segment.topicIds = topicIdMap(*partDesc, *ids);
+      stream.push_back(std::move(segment));
+    }
+  }
+  else
+  {
+    const log::Descriptor *desc = this->Descriptor();
+    if (!desc || !this->db)
+      return false;
+
+    BatchPrivate::Segment segment;
+    segment.db = this->Connection(_newConnections);
+    if (!segment.db)
+      return false;
+    segment.statements = _options.GenerateStatements(*desc);
+    if (_headersOnly)
+      dropMessageData(segment.statements);
+    segment.framed = this->framed;
+    if (ids != desc)
+      segment.topicIds = topicIdMap(*desc, *ids);
+    stream.push_back(std::move(segment));
+  }
+
+  _streams.push_back(std::move(stream));
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<raii_sqlite3::Database> Log::Implementation::Connection(
+    const bool _new) const
+{
+  if (!_new || !this->reopenable)
+    return this->db;
+
+  std::shared_ptr<raii_sqlite3::Database> connection(
+      new raii_sqlite3::Database(
+        this->filename, SQLITE_OPEN_URI | SQLITE_OPEN_READONLY));
+  if (!*connection || !ApplyOptions(*connection, this->options, false))
+    return nullptr;
+  return connection;
+}
+
 //////////////////////////////////////////////////
 int Log::Implementation::EndTransactionIfEnoughTimeHasPassed()
 {
@@ -186,6 +817,15 @@ int Log::Implementation::EndTransactionIfEnoughTimeHasPassed()
 //////////////////////////////////////////////////
 int Log::Implementation::EndTransaction()
 {
+  // The chunks of a chunked log file are its transactions
+  if (this->chunkWriter)
+  {
+    if (!this->chunkWriter->Flush())
+      return SQLITE_IOERR;
+    this->inTransaction = false;
+    return SQLITE_OK;
+  }
+
   // End the transaction
   int returnCode = sqlite3_exec(
       this->db->Handle(), "END;", NULL, 0, nullptr);
@@ -205,31 +845,132 @@ int Log::Implementation::BeginTransactionIfNotInOne()
   if (this->inTransaction)
     return SQLITE_OK;
 
-  int returnCode = sqlite3_exec(
-      this->db->Handle(), "BEGIN;", NULL, 0, nullptr);
-  if (returnCode != SQLITE_OK)
+  // The parts of a split recording are read only
+  if (!this->db && !this->chunkWriter)
+    return SQLITE_READONLY;
+
+  int returnCode = SQLITE_OK;
+  if (!this->chunkWriter)
   {
-    LERR("Failed to begin transaction" << returnCode << "\n");
-    return returnCode;
+    returnCode = sqlite3_exec(
+        this->db->Handle(), "BEGIN;", NULL, 0, nullptr);
+    if (returnCode != SQLITE_OK)
+    {
+      LERR("Failed to begin transaction" << returnCode << "\n");
+      return returnCode;
+    }
   }
   this->inTransaction = true;
   LDBG("Began transaction\n");
   this->lastTransaction = std::chrono::steady_clock::now();
+  this->transactionBytes = 0;
+  this->transactionMessages = 0;
   return returnCode;
 }
 
 //////////////////////////////////////////////////
 bool Log::Implementation::TimeForNewTransaction() const
 {
+  if (this->chunkWriter && this->chunkWriter->Full())
+    return true;
+
+  if (this->transactionMaxBytes > 0 &&
+      this->transactionBytes >= this->transactionMaxBytes)
+  {
+    return true;
+  }
+
+  if (this->transactionMaxMessages > 0 &&
+      this->transactionMessages >= this->transactionMaxMessages)
+  {
+    return true;
+  }
+
   auto now = std::chrono::steady_clock::now();
   return now - this->transactionPeriod > this->lastTransaction;
 }
 
+//////////////////////////////////////////////////
+bool Log::Implementation::ApplyOptions(raii_sqlite3::Database &_db,
+    const LogOptions &_options, bool _write)
+{
+  std::string pragmas;
+  if (_write)
+  {
+    // The page size must be set before the schema creates the tables, and
+    // before switching to WAL.
+    if (_options.PageSize() > 0)
+      pragmas += "PRAGMA page_size=" + std::to_string(_options.PageSize()) +
+        ";";
+
+    switch (_options.Journal())
+    {
+      case LogOptions::JournalMode::WAL:
+        pragmas += "PRAGMA journal_mode=WAL;";
+        break;
+      case LogOptions::JournalMode::MEMORY:
+        pragmas += "PRAGMA journal_mode=MEMORY;";
+        break;
+      case LogOptions::JournalMode::OFF:
+        pragmas += "PRAGMA journal_mode=OFF;";
+        break;
+      case LogOptions::JournalMode::DEFAULT:
+      default:
+        break;
+    }
+
+    switch (_options.Synchronous())
+    {
+      case LogOptions::SyncMode::OFF:
+        pragmas += "PRAGMA synchronous=OFF;";
+        break;
+      case LogOptions::SyncMode::NORMAL:
+        pragmas += "PRAGMA synchronous=NORMAL;";
+        break;
+      case LogOptions::SyncMode::FULL:
+        pragmas += "PRAGMA synchronous=FULL;";
+        break;
+      case LogOptions::SyncMode::DEFAULT:
+      default:
+        break;
+    }
+  }
+
+  // A negative cache size is in KiB instead of pages
+  if (_options.CacheSize() > 0)
+  {
+    pragmas += "PRAGMA cache_size=-" +
+      std::to_string(std::max<std::size_t>(_options.CacheSize() >> 10, 1)) +
+      ";";
+  }
+
+  if (_options.MmapSize() > 0)
+    pragmas += "PRAGMA mmap_size=" + std::to_string(_options.MmapSize()) + ";";
+
+  if (pragmas.empty())
+    return true;
+
+  int returnCode = sqlite3_exec(_db.Handle(), pragmas.c_str(), NULL, 0, NULL);
+  if (returnCode != SQLITE_OK)
+  {
+    LERR("Failed to apply the log options: " << sqlite3_errmsg(_db.Handle())
+         << "\n");
+    return false;
+  }
+  return true;
+}
+
 //////////////////////////////////////////////////
 int64_t Log::Implementation::InsertOrGetTopicId(
     const std::string &_name,
     const std::string &_type)
 {
+  if (this->chunkWriter)
+    return this->chunkWriter->TopicId(_name, _type);
+
+  if (!this->db)
+    return -1;
+
   // If the name and type is known, return a cached ID
   // Call method to get side effect of updating descriptor
   const log::Descriptor *desc = this->Descriptor();
@@ -244,25 +985,22 @@ int64_t Log::Implementation::InsertOrGetTopicId(
     return topicId;
   }
 
-  // Inserting a new topic invalidates the descriptor
-  this->needNewDescriptor = true;
-
   // Otherwise insert it into the database and return the new topic_id
-  const std::string sqlMessageType =
+  const char *sqlMessageType =
     "INSERT OR IGNORE INTO message_types (name) VALUES (?001);";
-  const std::string sqlTopic =
+  const char *sqlTopic =
     "INSERT INTO topics (name, message_type_id)"
     " SELECT ?002, id FROM message_types WHERE name = ?001 LIMIT 1;";
 
-  raii_sqlite3::Statement messageTypeStatement(
-      *(this->db), sqlMessageType);
+  raii_sqlite3::Statement *messageTypeStatement = this->CachedStatement(
+      this->insertMessageTypeStatement, sqlMessageType);
   if (!messageTypeStatement)
   {
     LERR("Failed to compile statement to insert message type\n");
     return -1;
   }
-  raii_sqlite3::Statement topicStatement(
-      *(this->db), sqlTopic);
+  raii_sqlite3::Statement *topicStatement = this->CachedStatement(
+      this->insertTopicStatement, sqlTopic);
   if (!topicStatement)
   {
     LERR("Failed to compile statement to insert topic\n");
@@ -276,21 +1014,21 @@ int64_t Log::Implementation::InsertOrGetTopicId(
   int returnCode;
   // Bind parameters
   returnCode = sqlite3_bind_text(
-      messageTypeStatement.Handle(), 1, _type.c_str(), _type.size(), nullptr);
+      messageTypeStatement->Handle(), 1, _type.c_str(), _type.size(), nullptr);
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind message type name(1): " << returnCode << "\n");
     return -1;
   }
   returnCode = sqlite3_bind_text(
-      topicStatement.Handle(), 1, _type.c_str(), _type.size(), nullptr);
+      topicStatement->Handle(), 1, _type.c_str(), _type.size(), nullptr);
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind message type name(2): " << returnCode << "\n");
     return -1;
   }
   returnCode = sqlite3_bind_text(
-      topicStatement.Handle(), 2, _name.c_str(), _name.size(), nullptr);
+      topicStatement->Handle(), 2, _name.c_str(), _name.size(), nullptr);
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind topic name: " << returnCode << "\n");
@@ -298,13 +1036,13 @@ int64_t Log::Implementation::InsertOrGetTopicId(
   }
 
   // Execute the statements
-  returnCode = sqlite3_step(messageTypeStatement.Handle());
+  returnCode = stepAndReset(messageTypeStatement->Handle());
   if (returnCode != SQLITE_DONE)
   {
     LERR("Failed to insert message type: " << returnCode << "\n");
     return -1;
   }
-  returnCode = sqlite3_step(topicStatement.Handle());
+  returnCode = stepAndReset(topicStatement->Handle());
   if (returnCode != SQLITE_DONE)
   {
     LERR("Faild to insert topic: " << returnCode << "\n");
@@ -314,6 +1052,13 @@ int64_t Log::Implementation::InsertOrGetTopicId(
   // topics.id is an alias for rowid
   int64_t id = sqlite3_last_insert_rowid(this->db->Handle());
   LDBG("Inserted '" << _name << "'[" << _type << "]\n");
+
+  // Add the new topic to the descriptor instead of querying all the topics
+  // again
+  TopicKey key;
+  key.topic = _name;
+  key.type = _type;
+  this->descriptor.dataPtr->Insert(key, id);
   return id;
 }
 
@@ -332,13 +1077,45 @@ bool Log::Implementation::InsertMessage(
   if (_len == 0)
     return false;
 
+  if (!this->framed)
+    return this->InsertFrame(_time, _topic, _data, _len);
+
+  if (this->frames.empty())
+    this->frames.resize(1);
+  EncodeMessage(_data, _len, this->compression, this->compressionLevel,
+      this->compressionMinSize, this->frames[0]);
+  return this->InsertFrame(
+      _time, _topic, this->frames[0].data(), this->frames[0].size());
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::InsertFrame(
+    const std::chrono::nanoseconds &_time,
+    const int64_t _topic,
+    const void *_data,
+    const std::size_t _len)
+{
+  if (this->chunkWriter)
+  {
+    if (!this->chunkWriter->Append(_time, _topic, _data, _len))
+    {
+      LERR("Failed to insert message. data[" << _data << "] len[" << _len
+          << "]\n");
+      return false;
+    }
+    this->transactionBytes += _len;
+    ++this->transactionMessages;
+    return true;
+  }
+
   int returnCode;
-  const std::string sql =
+  const char *sql =
     "INSERT INTO messages (time_recv, message, topic_id)"
     "VALUES (?001, ?002, ?003);";
 
-  // Compile the statement
-  raii_sqlite3::Statement statement(*(this->db), sql);
+  // Compile the statement, only the first time
+  raii_sqlite3::Statement *statement = this->CachedStatement(
+      this->insertMessageStatement, sql);
   if (!statement)
   {
     LERR("Failed to compile insert message statement\n");
@@ -346,19 +1123,19 @@ bool Log::Implementation::InsertMessage(
   }
 
   // Bind parameters
-  returnCode = sqlite3_bind_int64(statement.Handle(), 1, _time.count());
+  returnCode = sqlite3_bind_int64(statement->Handle(), 1, _time.count());
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind time received: " << returnCode << "\n");
     return false;
   }
-  returnCode = sqlite3_bind_blob(statement.Handle(), 2, _data, _len, nullptr);
+  returnCode = sqlite3_bind_blob(statement->Handle(), 2, _data, _len, nullptr);
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind message data: " << returnCode << "\n");
     return false;
   }
-  returnCode = sqlite3_bind_int(statement.Handle(), 3, _topic);
+  returnCode = sqlite3_bind_int64(statement->Handle(), 3, _topic);
   if (returnCode != SQLITE_OK)
   {
     LERR("Failed to bind topic_id: " << returnCode << "\n");
@@ -371,23 +1148,143 @@ bool Log::Implementation::InsertMessage(
 
 
   // Execute the statement
-  returnCode = sqlite3_step(statement.Handle());
+  returnCode = stepAndReset(statement->Handle());
   if (returnCode != SQLITE_DONE)
   {
     LERR("Failed to insert message. sqlite3 return code[" << returnCode
         << "] data[" << _data << "] len[" << _len << "]\n");
     return false;
   }
+  this->transactionBytes += _len;
+  ++this->transactionMessages;
+
+  TopicStats &stats = this->insertedStats[_topic];
+  if (stats.messages == 0 || _time.count() < stats.firstTime)
+    stats.firstTime = _time.count();
+  if (stats.messages == 0 || _time.count() > stats.lastTime)
+    stats.lastTime = _time.count();
+  ++stats.messages;
+  stats.bytes += _len;
   return true;
 }
 
 //////////////////////////////////////////////////
-Log::Log()
-  : dataPtr(new Implementation)
+bool Log::Implementation::WriteSummary()
 {
-  // Default to 2 transactions per second
-  this->dataPtr->transactionPeriod = std::chrono::milliseconds(500);
-}
+  if (SQLITE_OK != this->BeginTransactionIfNotInOne())
+    return false;
+
+  if (SQLITE_OK != sqlite3_exec(
+        this->db->Handle(), kSummarySchema, NULL, 0, nullptr))
+  {
+    LERR("Failed to create the topic summaries: " << this->ErrorMessage()
+         << "\n");
+    return false;
+  }
+
+  raii_sqlite3::Statement statement(*(this->db),
+      "INSERT INTO topic_summaries"
+      " (topic_id, messages, bytes, first_time, last_time)"
+      " VALUES (?001, ?002, ?003, ?004, ?005);");
+  if (!statement)
+  {
+    LERR("Failed to compile insert topic summary statement\n");
+    return false;
+  }
+
+  for (const auto &entry : this->insertedStats)
+  {
+    sqlite3_bind_int64(statement.Handle(), 1, entry.first);
+    sqlite3_bind_int64(statement.Handle(), 2, entry.second.messages);
+    sqlite3_bind_int64(statement.Handle(), 3, entry.second.bytes);
+    sqlite3_bind_int64(statement.Handle(), 4, entry.second.firstTime);
+    sqlite3_bind_int64(statement.Handle(), 5, entry.second.lastTime);
+    if (stepAndReset(statement.Handle()) != SQLITE_DONE)
+    {
+      LERR("Failed to insert topic summary: " << this->ErrorMessage()
+           << "\n");
+      return false;
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+raii_sqlite3::Statement *Log::Implementation::CachedStatement(
+    std::unique_ptr<raii_sqlite3::Statement> &_statement,
+    const char *_sql)
+{
+  if (!_statement)
+  {
+    _statement.reset(new raii_sqlite3::Statement(*(this->db), _sql));
+    if (!*_statement)
+    {
+      _statement.reset();
+      return nullptr;
+    }
+  }
+  return _statement.get();
+}
+
+//////////////////////////////////////////////////
+void Log::Implementation::Configure(const std::string &_file,
+    const LogOptions &_options, bool _write)
+{
+  this->filename = _file;
+  this->options = _options;
+  this->transactionPeriod = _options.TransactionPeriod();
+  this->transactionMaxBytes = _options.TransactionMaxBytes();
+  this->transactionMaxMessages = _options.TransactionMaxMessages();
+
+  if (this->framed && _write)
+  {
+    this->compression = _options.MessageCompression();
+    this->compressionLevel = _options.CompressionLevel();
+    this->compressionMinSize = _options.CompressionMinSize();
+
+    std::size_t threads = _options.CompressionThreads();
+    if (threads == 0)
+      threads = std::thread::hardware_concurrency();
+    this->compressionPool.reset(new WorkerPool(threads));
+  }
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::OpenShards(const std::vector<std::string> &_files,
+    const LogOptions &_options)
+{
+  std::vector<std::unique_ptr<Log>> opened;
+  for (const std::string &file : _files)
+  {
+    std::unique_ptr<Log> shard(new Log());
+    if (!shard->Open(SplitFiles(file), _options))
+    {
+      LERR("Failed to open [" << file << "]\n");
+      return false;
+    }
+    opened.push_back(std::move(shard));
+  }
+
+  this->shards = std::move(opened);
+  this->needNewDescriptor = true;
+  return true;
+}
+
+//////////////////////////////////////////////////
+const char *Log::Implementation::ErrorMessage() const
+{
+  if (!this->db)
+    return "failed to write the log file";
+  return sqlite3_errmsg(this->db->Handle());
+}
+
+//////////////////////////////////////////////////
+Log::Log()
+  : dataPtr(new Implementation)
+{
+  // Default to 2 transactions per second
+  this->dataPtr->transactionPeriod = std::chrono::milliseconds(500);
+}
 
 //////////////////////////////////////////////////
 Log::Log(Log &&_other)  // NOLINT
@@ -398,23 +1295,76 @@ Log::Log(Log &&_other)  // NOLINT
 //////////////////////////////////////////////////
 Log::~Log()
 {
+  // In the last transaction, so the messages and their summary are written
+  // together
+  if (this->dataPtr && this->dataPtr->writeSummary && this->Valid())
+    this->dataPtr->WriteSummary();
+
   if (this->dataPtr && this->dataPtr->inTransaction)
   {
     this->dataPtr->EndTransaction();
   }
+
+  // Leave the file in the default journal mode, so it can be read without
+  // creating the files of the write ahead log.
+  if (this->dataPtr && this->dataPtr->wal && this->Valid() &&
+      SQLITE_OK != sqlite3_exec(this->dataPtr->db->Handle(),
+        "PRAGMA journal_mode=DELETE;", NULL, 0, nullptr))
+  {
+    LWRN("Failed to leave the write ahead log mode: " << sqlite3_errmsg(
+        this->dataPtr->db->Handle()) << "\n");
+  }
+}
+
+//////////////////////////////////////////////////
+bool Log::OpenStream(const std::string &_name, const ChunkSink &_sink,
+    const LogOptions &_options)
+{
+  if (this->Valid())
+  {
+    LERR("A database is already open\n");
+    return false;
+  }
+  if (!CompressionAvailable(_options.MessageCompression()))
+  {
+    LERR("The requested compression is not available in this build\n");
+    return false;
+  }
+
+  const bool compressed =
+    _options.MessageCompression() != LogOptions::Compression::NONE;
+  std::unique_ptr<ChunkWriter> writer(new ChunkWriter);
+  if (!writer->Open(_sink, _options.ChunkSize(), compressed))
+  {
+    LERR("Invalid sink for log [" << _name << "]\n");
+    return false;
+  }
+
+  this->dataPtr->chunkWriter = std::move(writer);
+  this->dataPtr->framed = compressed;
+  this->dataPtr->Configure(_name, _options, true);
+  return true;
 }
 
 //////////////////////////////////////////////////
 bool Log::Valid() const
 {
-  return this->dataPtr && this->dataPtr->db && *(this->dataPtr->db);
+  return this->dataPtr && ((this->dataPtr->db && *(this->dataPtr->db)) ||
+      this->dataPtr->chunkWriter || !this->dataPtr->Children().empty());
 }
 
 //////////////////////////////////////////////////
 bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode)
+{
+  return this->Open(_file, _mode, LogOptions());
+}
+
+//////////////////////////////////////////////////
+bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode,
+    const LogOptions &_options)
 {
   // Open the SQLite3 database
-  if (this->dataPtr->db)
+  if (this->Valid())
   {
     LERR("A database is already open\n");
     return false;
@@ -422,15 +1372,60 @@ bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode)
   int64_t modeSQL = SQLITE_OPEN_URI;
   if (std::ios_base::out & _mode)
   {
+    if (!CompressionAvailable(_options.MessageCompression()))
+    {
+      LERR("The requested compression is not available in this build\n");
+      return false;
+    }
     modeSQL = modeSQL | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+    // The chunked log files are written without SQLite
+    if (_options.FileFormat() == LogOptions::Format::CHUNKED)
+    {
+      const bool compressed =
+        _options.MessageCompression() != LogOptions::Compression::NONE;
+      std::unique_ptr<ChunkWriter> writer(new ChunkWriter);
+      if (!writer->Open(_file, _options.ChunkSize(), compressed))
+        return false;
+
+      this->dataPtr->chunkWriter = std::move(writer);
+      this->dataPtr->framed = compressed;
+      this->dataPtr->Configure(_file, _options, true);
+      return true;
+    }
   }
   else if (std::ios_base::in & _mode)
   {
     modeSQL = modeSQL | SQLITE_OPEN_READONLY;
   }
 
-  std::unique_ptr<raii_sqlite3::Database> db(
-      new raii_sqlite3::Database(_file, modeSQL));
+  // The topic groups of a recording are read through their own log files
+  if (!(std::ios_base::out & _mode) && IsManifest(_file))
+  {
+    std::vector<std::string> files;
+    if (!ReadManifest(_file, files) ||
+        !this->dataPtr->OpenShards(files, _options))
+    {
+      return false;
+    }
+
+    this->dataPtr->Configure(_file, _options, false);
+    return true;
+  }
+
+  // The chunked log files are read through a temporary database
+  std::unique_ptr<raii_sqlite3::Database> db;
+  const bool chunked = !(std::ios_base::out & _mode) && IsChunkedLog(_file);
+  if (chunked)
+  {
+    db = OpenChunkedLog(_file);
+    if (!db)
+      return false;
+  }
+  else
+  {
+    db.reset(new raii_sqlite3::Database(_file, modeSQL));
+  }
   if (!*(db))
   {
     // The constructor of raii_sqlite3::Database will print out the reason that
@@ -438,44 +1433,41 @@ bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode)
     return false;
   }
 
+  if (!Implementation::ApplyOptions(
+        *db, _options, std::ios_base::out & _mode))
+  {
+    return false;
+  }
+
   // Don't need to create a schema if this is read only
   if (std::ios_base::out & _mode)
   {
-    // Test hook so tests can be run before `make install`
-    std::string schemaFile;
-    const char *envPath = std::getenv(SchemaLocationEnvVar.c_str());
-    if (envPath)
-    {
-      schemaFile = envPath;
-    }
-    else
-    {
-      schemaFile = SCHEMA_INSTALL_PATH;
-    }
-    schemaFile += "/0.1.0.sql";
-
     // Assume the database is uninitialized; use the schema to initialize it
-    LDBG("Schema file: " << schemaFile << "\n");
-    std::ifstream fin(schemaFile, std::ifstream::in);
-    if (!fin)
-    {
-      LERR("Failed to open schema [" << schemaFile << "].\n"
-          << " Set " << SchemaLocationEnvVar << " to the schema location.\n");
+    std::string schema;
+    if (!readSchemaFile("0.1.0.sql", schema))
       return false;
+
+    // The compressed messages are framed, which needs the schema 0.2.0
+    if (_options.MessageCompression() != LogOptions::Compression::NONE)
+    {
+      std::string migration;
+      if (!readSchemaFile("0.1.0_to_0.2.0.sql", migration))
+        return false;
+      schema += migration;
     }
 
-    // Read the schema file
-    std::string schema;
-    char buffer[4096];
-    while (fin)
+    // Index the messages by topic too, whatever the version, unless the
+    // indexes are built by Log::Finalize()
+    if (_options.DeferIndexes())
     {
-      fin.read(buffer, sizeof(buffer));
-      schema.insert(schema.size(), buffer, fin.gcount());
+      schema += "DROP INDEX idx_time_recv;";
     }
-    if (schema.empty())
+    else
     {
-      LERR("Failed to read schema file [" << schemaFile << "]\n");
-      return false;
+      std::string topicIndex;
+      if (!readSchemaFile("topic_time_index.sql", topicIndex))
+        return false;
+      schema += topicIndex;
     }
 
     // Apply the schema to the database
@@ -492,17 +1484,196 @@ bool Log::Open(const std::string &_file, const std::ios_base::openmode _mode)
   // Check the schema version
   // TODO(sloretz) handle multiple versions
   std::string version = this->Version();
-  if ("0.1.0" != this->Version())
+  if ("0.1.0" != version && "0.2.0" != version)
   {
     LERR("Log file Version '" << version << "' is unsupported by this tool\n");
     this->dataPtr->db.reset();
     return false;
   }
 
-  this->dataPtr->filename = _file;
+  this->dataPtr->wal = (std::ios_base::out & _mode) &&
+    _options.Journal() == LogOptions::JournalMode::WAL;
+  this->dataPtr->framed = "0.2.0" == version;
+  this->dataPtr->Configure(_file, _options, std::ios_base::out & _mode);
+
+  if (std::ios_base::out & _mode)
+  {
+    this->dataPtr->writeSummary = true;
+  }
+  else
+  {
+    this->dataPtr->reopenable = !chunked;
+
+    raii_sqlite3::Statement summaryStatement(*(this->dataPtr->db),
+        "SELECT 1 FROM sqlite_master WHERE type = 'table'"
+        " AND name = 'topic_summaries';");
+    this->dataPtr->hasSummary = summaryStatement &&
+      sqlite3_step(summaryStatement.Handle()) == SQLITE_ROW;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Log::Open(const std::vector<std::string> &_files)
+{
+  return this->Open(_files, LogOptions());
+}
+
+//////////////////////////////////////////////////
+bool Log::Open(const std::vector<std::string> &_files,
+    const LogOptions &_options)
+{
+  if (this->Valid())
+  {
+    LERR("A database is already open\n");
+    return false;
+  }
+
+  if (_files.empty())
+  {
+    LERR("No log file to open\n");
+    return false;
+  }
+
+  if (_files.size() == 1)
+    return this->Open(_files.front(), std::ios_base::in, _options);
+
+  std::vector<std::unique_ptr<Log>> parts;
+  for (const std::string &file : _files)
+  {
+    std::unique_ptr<Log> part(new Log());
+    if (!part->Open(file, std::ios_base::in, _options))
+    {
+      LERR("Failed to open part [" << file << "] of the log\n");
+      return false;
+    }
+    parts.push_back(std::move(part));
+  }
+
+  this->dataPtr->parts = std::move(parts);
+  this->dataPtr->Configure(_files.front(), _options, false);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Log::OpenMerged(const std::vector<std::string> &_files,
+    const LogOptions &_options)
+{
+  if (this->Valid())
+  {
+    LERR("A database is already open\n");
+    return false;
+  }
+
+  if (_files.empty())
+  {
+    LERR("No log file to open\n");
+    return false;
+  }
+
+  if (!this->dataPtr->OpenShards(_files, _options))
+    return false;
+
+  this->dataPtr->Configure(_files.front(), _options, false);
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string Log::PartFilename(const std::string &_file,
+    const std::size_t _part)
+{
+  if (_part == 0)
+    return _file;
+
+  return insertBeforeExtension(_file, std::to_string(_part));
+}
+
+//////////////////////////////////////////////////
+std::string Log::GroupFilename(const std::string &_file,
+    const std::string &_group)
+{
+  return insertBeforeExtension(_file, _group);
+}
+
+//////////////////////////////////////////////////
+bool Log::Finalize(const std::string &_file, const bool _vacuum)
+{
+  if (IsManifest(_file))
+  {
+    std::vector<std::string> files;
+    if (!ReadManifest(_file, files))
+      return false;
+    bool finalized = true;
+    for (const std::string &file : files)
+      finalized = Log::Finalize(file, _vacuum) && finalized;
+    return finalized;
+  }
+
+  // The index of a chunked log file is built when it's read
+  if (IsChunkedLog(_file))
+    return true;
+
+  raii_sqlite3::Database db(_file, SQLITE_OPEN_READWRITE);
+  if (!db)
+    return false;
+
+  std::string topicIndex;
+  if (!readSchemaFile("topic_time_index.sql", topicIndex))
+    return false;
+
+  // Like Log::Implementation::WriteSummary(), for a file that wasn't
+  // closed properly
+  std::string summary;
+  {
+    raii_sqlite3::Statement summaryStatement(db,
+        "SELECT 1 FROM sqlite_master WHERE type = 'table'"
+        " AND name = 'topic_summaries';");
+    if (!summaryStatement)
+    {
+      LERR("Failed to finalize [" << _file << "]: " << sqlite3_errmsg(
+          db.Handle()) << "\n");
+      return false;
+    }
+    if (sqlite3_step(summaryStatement.Handle()) != SQLITE_ROW)
+    {
+      summary = std::string(kSummarySchema) +
+        "INSERT INTO topic_summaries"
+        " (topic_id, messages, bytes, first_time, last_time)"
+        " SELECT topics.id, COUNT(messages.id),"
+        " COALESCE(SUM(LENGTH(messages.message)), 0),"
+        " COALESCE(MIN(messages.time_recv), 0),"
+        " COALESCE(MAX(messages.time_recv), 0)"
+        " FROM topics LEFT JOIN messages ON messages.topic_id = topics.id"
+        " GROUP BY topics.id;";
+    }
+  }
+
+  const std::string sql = "BEGIN;"
+    "CREATE INDEX IF NOT EXISTS idx_time_recv ON messages (time_recv);" +
+    topicIndex + summary + "COMMIT; ANALYZE;" + (_vacuum ? "VACUUM;" : "");
+  if (SQLITE_OK != sqlite3_exec(db.Handle(), sql.c_str(), NULL, 0, nullptr))
+  {
+    LERR("Failed to finalize [" << _file << "]: " << sqlite3_errmsg(
+        db.Handle()) << "\n");
+    return false;
+  }
   return true;
 }
 
+//////////////////////////////////////////////////
+std::vector<std::string> Log::SplitFiles(const std::string &_file)
+{
+  std::vector<std::string> files = {_file};
+  for (std::size_t part = 1; ; ++part)
+  {
+    std::string file = PartFilename(_file, part);
+    if (!std::ifstream(file).good())
+      break;
+    files.push_back(std::move(file));
+  }
+  return files;
+}
+
 //////////////////////////////////////////////////
 const log::Descriptor *Log::Descriptor() const
 {
@@ -543,8 +1714,8 @@ bool Log::InsertMessage(
   if (SQLITE_OK != this->dataPtr->EndTransactionIfEnoughTimeHasPassed())
   {
     // Something is really busted if this happens
-    LERR("Failed to end transcation: "<< sqlite3_errmsg(
-        this->dataPtr->db->Handle()) << "\n");
+    LERR("Failed to end transcation: " << this->dataPtr->ErrorMessage()
+        << "\n");
     return false;
   }
 
@@ -552,22 +1723,450 @@ bool Log::InsertMessage(
 }
 
 //////////////////////////////////////////////////
-Batch Log::QueryMessages(const QueryOptions &_options)
+int64_t Log::InsertOrGetTopicId(
+    const std::string &_topic, const std::string &_type)
 {
-  const log::Descriptor *desc = this->Descriptor();
+  if (!this->Valid())
+  {
+    return -1;
+  }
+
+  return this->dataPtr->InsertOrGetTopicId(_topic, _type);
+}
+
+//////////////////////////////////////////////////
+bool Log::InsertMessage(
+    const std::chrono::nanoseconds &_time, const int64_t _topicId,
+    const void *_data, const std::size_t _len)
+{
+  if (!this->Valid() || _topicId < 0)
+  {
+    return false;
+  }
+
+  // Need to insert multiple messages pertransaction for best performance
+  if (SQLITE_OK != this->dataPtr->BeginTransactionIfNotInOne())
+  {
+    return false;
+  }
+
+  // Insert the message into the database
+  if (!this->dataPtr->InsertMessage(_time, _topicId, _data, _len))
+  {
+    return false;
+  }
+
+  // Finish the transaction if enough time has passed
+  if (SQLITE_OK != this->dataPtr->EndTransactionIfEnoughTimeHasPassed())
+  {
+    // Something is really busted if this happens
+    LERR("Failed to end transcation: " << this->dataPtr->ErrorMessage()
+        << "\n");
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t Log::InsertMessages(const std::vector<MessageRecord> &_records)
+{
+  if (!this->Valid() || _records.empty())
+  {
+    return 0;
+  }
+
+  // All the messages go in the same transaction
+  if (SQLITE_OK != this->dataPtr->BeginTransactionIfNotInOne())
+  {
+    return 0;
+  }
+
+  // Compress the messages in parallel, before inserting them in order
+  Implementation *impl = this->dataPtr.get();
+  if (impl->framed)
+  {
+    impl->frames.resize(std::max(impl->frames.size(), _records.size()));
+    auto encode = [impl, &_records](std::size_t _i)
+    {
+      const MessageRecord &record = _records[_i];
+      if (record.len > 0)
+      {
+        EncodeMessage(record.data, record.len, impl->compression,
+            impl->compressionLevel, impl->compressionMinSize,
+            impl->frames[_i]);
+      }
+    };
 
+    // There are no compression threads if the log is read only
+    if (impl->compressionPool)
+    {
+      impl->compressionPool->Run(_records.size(), encode);
+    }
+    else
+    {
+      for (std::size_t i = 0; i < _records.size(); ++i)
+        encode(i);
+    }
+  }
+
+  auto insert = [impl, &_records](std::size_t _i, int64_t _topicId)
+  {
+    const MessageRecord &record = _records[_i];
+    if (!impl->framed || record.len == 0)
+    {
+      return impl->InsertMessage(
+          record.time, _topicId, record.data, record.len);
+    }
+    return impl->InsertFrame(record.time, _topicId,
+        impl->frames[_i].data(), impl->frames[_i].size());
+  };
+
+  std::size_t inserted = 0;
+  int64_t topicId = -1;
+  std::string_view topic;
+  std::string_view type;
+  for (std::size_t i = 0; i < _records.size(); ++i)
+  {
+    const MessageRecord &record = _records[i];
+    if (record.topicId >= 0)
+    {
+      if (insert(i, record.topicId))
+        ++inserted;
+      continue;
+    }
+
+    // Consecutive messages are usually on the same topic
+    if (topicId < 0 || record.topic != topic || record.type != type)
+    {
+      topic = record.topic;
+      type = record.type;
+      topicId = this->dataPtr->InsertOrGetTopicId(
+          std::string(topic), std::string(type));
+      if (topicId < 0)
+      {
+        continue;
+      }
+    }
+
+    if (insert(i, topicId))
+      ++inserted;
+  }
+
+  // Finish the transaction if enough time has passed
+  if (SQLITE_OK != this->dataPtr->EndTransactionIfEnoughTimeHasPassed())
+  {
+    // Something is really busted if this happens
+    LERR("Failed to end transcation: " << this->dataPtr->ErrorMessage()
+        << "\n");
+  }
+
+  return inserted;
+}
+
+//////////////////////////////////////////////////
+Batch Log::QueryMessages(const QueryOptions &_options)
+{
   // Make sure the log has been initialized.
   // TODO(anyone): Should we print a warning here?
-  if (!desc)
+  std::vector<BatchPrivate::Stream> streams;
+  if (!this->dataPtr->AppendStreams(_options, streams))
+    return Batch();
+
+  std::unique_ptr<BatchPrivate> batchPriv(
+        new BatchPrivate(std::move(streams)));
+
+  return Batch(std::move(batchPriv));
+}
+
+//////////////////////////////////////////////////
+Batch Log::QueryHeaders(const QueryOptions &_options)
+{
+  std::vector<BatchPrivate::Stream> streams;
+  if (!this->dataPtr->AppendStreams(_options, streams, true))
     return Batch();
 
   std::unique_ptr<BatchPrivate> batchPriv(
-        new BatchPrivate(this->dataPtr->db,
-                         _options.GenerateStatements(*desc)));
+        new BatchPrivate(std::move(streams)));
 
   return Batch(std::move(batchPriv));
 }
 
+//////////////////////////////////////////////////
+std::vector<Batch> Log::QueryPartitions(const QueryOptions &_options,
+    std::size_t _partitions)
+{
+  std::vector<Batch> batches;
+  if (!this->Valid())
+    return batches;
+
+  // The messages are between the first and the last ones of the log, and
+  // within the time range of the query
+  std::chrono::nanoseconds begin = this->StartTime();
+  std::chrono::nanoseconds end = this->EndTime();
+  const TimeRangeOption *timeOption =
+    dynamic_cast<const TimeRangeOption *>(&_options);
+  if (timeOption)
+  {
+    const QualifiedTime &first = timeOption->TimeRange().Beginning();
+    const QualifiedTime &last = timeOption->TimeRange().Ending();
+    if (!first.IsIndeterminate())
+      begin = std::max(begin, *first.GetTime());
+    if (!last.IsIndeterminate())
+      end = std::min(end, *last.GetTime());
+  }
+  if (end < begin)
+    end = begin;
+
+  if (_partitions == 0)
+    _partitions = std::max(1u, std::thread::hardware_concurrency());
+  const uint64_t span = static_cast<uint64_t>((end - begin).count());
+  if (span < _partitions)
+    _partitions = static_cast<std::size_t>(span) + 1;
+
+  for (std::size_t i = 0; i < _partitions; ++i)
+  {
+    const std::chrono::nanoseconds sliceBegin = begin +
+      std::chrono::nanoseconds(static_cast<int64_t>(span / _partitions * i +
+          span % _partitions * i / _partitions));
+    const bool lastSlice = i + 1 == _partitions;
+    const std::chrono::nanoseconds sliceEnd = lastSlice ? end : begin +
+      std::chrono::nanoseconds(static_cast<int64_t>(
+          span / _partitions * (i + 1) +
+          span % _partitions * (i + 1) / _partitions));
+
+    const TimeSlice slice(_options, sliceBegin, sliceEnd, lastSlice);
+    std::vector<BatchPrivate::Stream> streams;
+    if (!this->dataPtr->AppendStreams(slice, streams, false, true))
+      return std::vector<Batch>();
+
+    std::unique_ptr<BatchPrivate> batchPriv(
+          new BatchPrivate(std::move(streams)));
+    batches.push_back(Batch(std::move(batchPriv)));
+  }
+  return batches;
+}
+
+//////////////////////////////////////////////////
+bool Log::Implementation::CopyRows(const std::string &_file,
+    const QueryOptions &_options) const
+{
+  const log::Descriptor *desc = this->Descriptor();
+  if (!desc)
+    return false;
+
+  // Both logs are attached to an empty database, so the tables of the query
+  // are those of the source
+  raii_sqlite3::Database db(":memory:",
+      SQLITE_OPEN_URI | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+  if (!db)
+    return false;
+
+  const auto execute = [&db](const std::string &_sql) -> bool
+  {
+    if (SQLITE_OK != sqlite3_exec(db.Handle(), _sql.c_str(), NULL, 0, NULL))
+    {
+      LERR("Failed to copy the messages: " << sqlite3_errmsg(db.Handle())
+           << "\n");
+      return false;
+    }
+    return true;
+  };
+
+  raii_sqlite3::Statement attach(db, "ATTACH DATABASE ? AS src;");
+  const std::string source = readOnlyUri(this->filename);
+  if (!attach || SQLITE_OK != sqlite3_bind_text(attach.Handle(), 1,
+        source.c_str(), source.size(), SQLITE_STATIC) ||
+      sqlite3_step(attach.Handle()) != SQLITE_DONE)
+  {
+    LERR("Failed to attach [" << this->filename << "]: "
+         << sqlite3_errmsg(db.Handle()) << "\n");
+    return false;
+  }
+
+  raii_sqlite3::Statement attachCopy(db, "ATTACH DATABASE ? AS dst;");
+  if (!attachCopy || SQLITE_OK != sqlite3_bind_text(attachCopy.Handle(), 1,
+        _file.c_str(), _file.size(), SQLITE_STATIC) ||
+      sqlite3_step(attachCopy.Handle()) != SQLITE_DONE)
+  {
+    LERR("Failed to attach [" << _file << "]: "
+         << sqlite3_errmsg(db.Handle()) << "\n");
+    return false;
+  }
+
+  if (!execute("BEGIN TRANSACTION;"
+        "CREATE TEMP TABLE extract_ids (id INTEGER PRIMARY KEY);"))
+  {
+    return false;
+  }
+
+  // The ids of the messages that match
+  for (const SqlStatement &query : _options.GenerateStatements(*desc))
+  {
+    std::string inner = query.statement;
+    while (!inner.empty() && (inner.back() == ';' || inner.back() == ' '))
+      inner.pop_back();
+    raii_sqlite3::Statement select(db,
+        "INSERT OR IGNORE INTO temp.extract_ids SELECT id FROM (" + inner +
+        ");");
+    if (!select || !bindParameters(select.Handle(), query) ||
+        sqlite3_step(select.Handle()) != SQLITE_DONE)
+    {
+      LERR("Failed to query the messages to copy: "
+           << sqlite3_errmsg(db.Handle()) << "\n");
+      return false;
+    }
+  }
+
+  // The rows are copied as they are stored, keeping their ids, and the
+  // summary of the topics is computed again
+  return execute(
+      "CREATE TEMP TABLE extract_topics AS SELECT DISTINCT topic_id AS id"
+      " FROM src.messages WHERE id IN temp.extract_ids;"
+      "INSERT INTO dst.message_types SELECT * FROM src.message_types"
+      " WHERE id IN (SELECT message_type_id FROM src.topics"
+      " WHERE id IN temp.extract_topics);"
+      "INSERT INTO dst.topics SELECT * FROM src.topics"
+      " WHERE id IN temp.extract_topics;"
+      "INSERT INTO dst.messages (id, time_recv, topic_id, message)"
+      " SELECT id, time_recv, topic_id, message FROM src.messages"
+      " WHERE id IN temp.extract_ids;"
+      "DELETE FROM dst.topic_summaries;"
+      "INSERT INTO dst.topic_summaries"
+      " (topic_id, messages, bytes, first_time, last_time)"
+      " SELECT topic_id, COUNT(*), SUM(LENGTH(message)), MIN(time_recv),"
+      " MAX(time_recv) FROM dst.messages GROUP BY topic_id;"
+      "COMMIT;");
+}
+
+//////////////////////////////////////////////////
+bool Log::Extract(const std::string &_file, const QueryOptions &_options,
+    const LogOptions &_fileOptions)
+{
+  if (!this->Valid())
+  {
+    LERR("Cannot extract the messages of an invalid log.\n");
+    return false;
+  }
+
+  // The new log is created like any other, and closed before the copy
+  const bool framed =
+    _fileOptions.MessageCompression() != LogOptions::Compression::NONE;
+  const bool copyRows = this->dataPtr->reopenable && this->dataPtr->db &&
+    this->dataPtr->Children().empty() && framed == this->dataPtr->framed &&
+    _fileOptions.FileFormat() != LogOptions::Format::CHUNKED;
+  {
+    Log extracted;
+    if (!extracted.Open(_file, std::ios_base::out, _fileOptions))
+      return false;
+
+    if (!copyRows)
+    {
+      // The messages go through the query, e.g. to decompress or to merge
+      // them. There's no copy in the parts of a recording or a chunked log.
+      for (const Message &msg : this->QueryMessages(_options))
+      {
+        if (!extracted.InsertMessage(msg.TimeReceived(), msg.Topic(),
+              msg.Type(), msg.DataView().data(), msg.DataView().size()))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+
+  return this->dataPtr->CopyRows(_file, _options);
+}
+
+//////////////////////////////////////////////////
+std::vector<Log::TopicSummary> Log::TopicSummaries() const
+{
+  std::vector<TopicSummary> summaries;
+
+  // The topics of a split or sharded recording are summed over its logs
+  const auto &children = this->dataPtr->Children();
+  if (!children.empty())
+  {
+    std::map<std::pair<std::string, std::string>, TopicSummary> merged;
+    for (const auto &child : children)
+    {
+      for (const TopicSummary &summary : child->TopicSummaries())
+      {
+        auto inserted = merged.emplace(
+            std::make_pair(summary.topic, summary.type), summary);
+        if (inserted.second)
+          continue;
+
+        TopicSummary &total = inserted.first->second;
+        if (summary.messages > 0)
+        {
+          total.firstTime = total.messages > 0 ?
+            std::min(total.firstTime, summary.firstTime) : summary.firstTime;
+          total.lastTime = std::max(total.lastTime, summary.lastTime);
+        }
+        total.messages += summary.messages;
+        total.bytes += summary.bytes;
+      }
+    }
+    for (auto &entry : merged)
+      summaries.push_back(std::move(entry.second));
+    return summaries;
+  }
+
+  if (!this->Valid() || !this->dataPtr->db)
+  {
+    LERR("Cannot summarize the topics of an invalid log.\n");
+    return summaries;
+  }
+
+  // The table written when the log was closed has the statistics. Otherwise
+  // they are computed, and length() reads the size of the data from the
+  // header of the row, without loading the data itself.
+  const std::string stats = this->dataPtr->hasSummary ? "topic_summaries" :
+      "(SELECT topic_id, COUNT(*) AS messages,"
+      " SUM(LENGTH(message)) AS bytes, MIN(time_recv) AS first_time,"
+      " MAX(time_recv) AS last_time FROM messages GROUP BY topic_id)";
+  const std::string summaryStatement =
+      "SELECT topics.name, message_types.name, stats.messages, stats.bytes,"
+      " stats.first_time, stats.last_time FROM topics JOIN message_types ON"
+      " message_types.id = topics.message_type_id LEFT JOIN " + stats +
+      " AS stats ON stats.topic_id = topics.id"
+      " ORDER BY topics.name, message_types.name;";
+  raii_sqlite3::Statement statement(*(this->dataPtr->db), summaryStatement);
+  if (!statement)
+  {
+    LERR("Failed to compile topic summary statement\n");
+    return summaries;
+  }
+
+  int returnCode;
+  while ((returnCode = sqlite3_step(statement.Handle())) == SQLITE_ROW)
+  {
+    TopicSummary summary;
+    summary.topic = reinterpret_cast<const char *>(
+        sqlite3_column_text(statement.Handle(), 0));
+    summary.type = reinterpret_cast<const char *>(
+        sqlite3_column_text(statement.Handle(), 1));
+    // NULL, which is read as 0, for a topic without messages
+    summary.messages = sqlite3_column_int64(statement.Handle(), 2);
+    summary.bytes = sqlite3_column_int64(statement.Handle(), 3);
+    summary.firstTime = std::chrono::nanoseconds(
+        sqlite3_column_int64(statement.Handle(), 4));
+    summary.lastTime = std::chrono::nanoseconds(
+        sqlite3_column_int64(statement.Handle(), 5));
+    summaries.push_back(std::move(summary));
+  }
+
+  if (returnCode != SQLITE_DONE)
+  {
+    LERR("Failed to summarize the topics: " << sqlite3_errmsg(
+        this->dataPtr->db->Handle()) << "\n");
+    summaries.clear();
+  }
+  return summaries;
+}
+
 //////////////////////////////////////////////////
 std::chrono::nanoseconds Log::StartTime() const
 {
@@ -577,14 +2176,35 @@ std::chrono::nanoseconds Log::StartTime() const
 
   this->dataPtr->startTime = std::chrono::nanoseconds::zero();
 
-  if (!this->Valid())
+  if (!this->dataPtr->parts.empty())
+  {
+    this->dataPtr->startTime = this->dataPtr->parts.front()->StartTime();
+    return this->dataPtr->startTime;
+  }
+
+  // The shards overlap in time, skipping the ones without messages
+  if (!this->dataPtr->shards.empty())
+  {
+    std::chrono::nanoseconds startTime = std::chrono::nanoseconds::max();
+    for (const auto &shard : this->dataPtr->shards)
+    {
+      if (shard->EndTime() > std::chrono::nanoseconds::zero())
+        startTime = std::min(startTime, shard->StartTime());
+    }
+    if (startTime != std::chrono::nanoseconds::max())
+      this->dataPtr->startTime = startTime;
+    return this->dataPtr->startTime;
+  }
+
+  if (!this->Valid() || !this->dataPtr->db)
   {
     LERR("Cannot get start time of an invalid log.\n");
     return this->dataPtr->startTime;
   }
 
-  // Compile the statement
-  const char* const getStartTimeStatement =
+  // Compile the statement, reading the summary of the topics if there is one
+  const char* const getStartTimeStatement = this->dataPtr->hasSummary ?
+      "SELECT MIN(first_time) AS start_time FROM topic_summaries;" :
       "SELECT MIN(time_recv) AS start_time FROM messages;";
   raii_sqlite3::Statement statement(*(this->dataPtr->db),
                                     getStartTimeStatement);
@@ -621,14 +2241,31 @@ std::chrono::nanoseconds Log::EndTime() const
 
   this->dataPtr->endTime = std::chrono::nanoseconds::zero();
 
-  if (!this->Valid())
+  if (!this->dataPtr->parts.empty())
+  {
+    this->dataPtr->endTime = this->dataPtr->parts.back()->EndTime();
+    return this->dataPtr->endTime;
+  }
+
+  if (!this->dataPtr->shards.empty())
+  {
+    for (const auto &shard : this->dataPtr->shards)
+    {
+      this->dataPtr->endTime =
+        std::max(this->dataPtr->endTime, shard->EndTime());
+    }
+    return this->dataPtr->endTime;
+  }
+
+  if (!this->Valid() || !this->dataPtr->db)
   {
     LERR("Cannot get end time of an invalid log.\n");
     return this->dataPtr->endTime;
   }
 
-  // Compile the statement
-  const char* const getEndTimeStatement =
+  // Compile the statement, reading the summary of the topics if there is one
+  const char* const getEndTimeStatement = this->dataPtr->hasSummary ?
+      "SELECT MAX(last_time) AS end_time FROM topic_summaries;" :
       "SELECT MAX(time_recv) AS end_time FROM messages;";
   raii_sqlite3::Statement statement(*(this->dataPtr->db),
                                     getEndTimeStatement);
@@ -683,7 +2320,10 @@ std::chrono::nanoseconds Log::EndTime() const
 //////////////////////////////////////////////////
 std::string Log::Version() const
 {
-  if (!this->Valid())
+  if (!this->dataPtr->Children().empty())
+    return this->dataPtr->Children().front()->Version();
+
+  if (!this->Valid() || !this->dataPtr->db)
   {
     return "";
   }
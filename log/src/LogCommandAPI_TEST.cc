@@ -58,6 +58,34 @@ TEST(LogCommandAPI, RecordFailedToOpen)
   EXPECT_EQ(FAILED_TO_OPEN, recordTopics("!@#$%^&*(:;[{]})?/.'|", ".*"));
 }
 
+//////////////////////////////////////////////////
+TEST(LogCommandAPI, RecordInvalidOptions)
+{
+  EXPECT_EQ(BAD_REGEX, recordTopicsWithOptions(":memory:", "*", "sqlite",
+    "none", 0, 0, 0, 0, 0, "", ""));
+  EXPECT_EQ(INVALID_OPTION, recordTopicsWithOptions(":memory:", ".*", "csv",
+    "none", 0, 0, 0, 0, 0, "", ""));
+  EXPECT_EQ(INVALID_OPTION, recordTopicsWithOptions(":memory:", ".*",
+    "sqlite", "lz4", 0, 0, 0, 0, 0, "", ""));
+  EXPECT_EQ(INVALID_OPTION, recordTopicsWithOptions(":memory:", ".*",
+    "sqlite", "zlib", 10, 0, 0, 0, 0, "", ""));
+  EXPECT_EQ(INVALID_OPTION, recordTopicsWithOptions(":memory:", ".*",
+    "sqlite", "none", 0, -1, 0, 0, 0, "", ""));
+  EXPECT_EQ(INVALID_OPTION, recordTopicsWithOptions(":memory:", ".*",
+    "sqlite", "none", 0, 0, 0, -1, 0, "", ""));
+  EXPECT_EQ(INVALID_OPTION, recordTopicsWithOptions(":memory:", ".*",
+    "sqlite", "none", 0, 0, 0, 0, 1, "truncate", ""));
+  EXPECT_EQ(INVALID_OPTION, recordTopicsWithOptions(":memory:", ".*",
+    "sqlite", "none", 0, 0, 0, 0, 1, "wal", "extra"));
+}
+
+//////////////////////////////////////////////////
+TEST(LogCommandAPI, RecordOptionsFailedToOpen)
+{
+  EXPECT_EQ(FAILED_TO_OPEN, recordTopicsWithOptions("!@#$%^&*(:;[{]})?/.'|",
+    ".*", "chunked", "none", 0, 16, 100, 60, 1, "wal", "off"));
+}
+
 //////////////////////////////////////////////////
 TEST(LogCommandAPI, PlaybackFailedToOpen)
 {
@@ -65,6 +93,29 @@ TEST(LogCommandAPI, PlaybackFailedToOpen)
     playbackTopics("!@#$%^&*(:;[{]})?/.'|", ".*", 0, "", false));
 }
 
+//////////////////////////////////////////////////
+TEST(LogCommandAPI, InfoFailedToOpen)
+{
+  EXPECT_EQ(FAILED_TO_OPEN, printLogInfo("!@#$%^&*(:;[{]})?/.'|"));
+}
+
+//////////////////////////////////////////////////
+TEST(LogCommandAPI, ExtractErrors)
+{
+  EXPECT_EQ(BAD_REGEX, extractLog(":memory:", ":memory:", "*", -1, -1));
+  EXPECT_EQ(FAILED_TO_OPEN,
+    extractLog("!@#$%^&*(:;[{]})?/.'|", ":memory:", ".*", -1, -1));
+}
+
+//////////////////////////////////////////////////
+TEST(LogCommandAPI, ExportErrors)
+{
+  EXPECT_EQ(BAD_REGEX, exportLog(":memory:", ".", "*", 0));
+  EXPECT_EQ(INVALID_OPTION, exportLog(":memory:", ".", ".*", -1));
+  EXPECT_EQ(FAILED_TO_OPEN,
+    exportLog("!@#$%^&*(:;[{]})?/.'|", ".", ".*", 0));
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ignition/transport/log/LogOptions.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+/// \brief Private implementation
+class ignition::transport::log::LogOptions::Implementation
+{
+  /// \brief Journal mode
+  public: JournalMode journal = JournalMode::DEFAULT;
+
+  /// \brief Synchronous mode
+  public: SyncMode synchronous = SyncMode::DEFAULT;
+
+  /// \brief Page size in bytes
+  public: std::size_t pageSize = 0;
+
+  /// \brief Page cache size in bytes
+  public: std::size_t cacheSize = 0;
+
+  /// \brief Memory mapped size in bytes
+  public: std::size_t mmapSize = 0;
+
+  /// \brief Maximum duration of a transaction. Default to 2 transactions
+  /// per second
+  public: std::chrono::milliseconds transactionPeriod{500};
+
+  /// \brief Maximum size of the messages of a transaction
+  public: std::size_t transactionMaxBytes = 0;
+
+  /// \brief Maximum number of messages of a transaction
+  public: uint64_t transactionMaxMessages = 0;
+
+  /// \brief Format of the log files
+  public: Format format = Format::SQLITE;
+
+  /// \brief Size of the chunks
+  public: std::size_t chunkSize = 4 << 20;
+
+  /// \brief Compression of the messages
+  public: Compression compression = Compression::NONE;
+
+  /// \brief Compression level
+  public: int compressionLevel = 1;
+
+  /// \brief Size of the smallest message that is compressed
+  public: std::size_t compressionMinSize = 128;
+
+  /// \brief Number of threads compressing the messages
+  public: std::size_t compressionThreads = 0;
+
+  /// \brief True to create the indexes of the messages at finalization
+  public: bool deferIndexes = false;
+};
+
+//////////////////////////////////////////////////
+LogOptions::LogOptions()
+  : dataPtr(new Implementation)
+{
+}
+
+//////////////////////////////////////////////////
+LogOptions::LogOptions(const LogOptions &_other)
+  : dataPtr(new Implementation(*_other.dataPtr))
+{
+}
+
+//////////////////////////////////////////////////
+LogOptions &LogOptions::operator=(const LogOptions &_other)
+{
+  *this->dataPtr = *_other.dataPtr;
+  return *this;
+}
+
+//////////////////////////////////////////////////
+LogOptions::~LogOptions()
+{
+}
+
+//////////////////////////////////////////////////
+LogOptions LogOptions::HighThroughput()
+{
+  LogOptions options;
+  options.SetJournal(JournalMode::WAL);
+  options.SetSynchronous(SyncMode::OFF);
+  options.SetPageSize(65536);
+  options.SetCacheSize(64 << 20);
+  options.SetTransactionMaxBytes(64 << 20);
+  return options;
+}
+
+//////////////////////////////////////////////////
+LogOptions::JournalMode LogOptions::Journal() const
+{
+  return this->dataPtr->journal;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetJournal(const JournalMode _mode)
+{
+  this->dataPtr->journal = _mode;
+}
+
+//////////////////////////////////////////////////
+LogOptions::SyncMode LogOptions::Synchronous() const
+{
+  return this->dataPtr->synchronous;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetSynchronous(const SyncMode _mode)
+{
+  this->dataPtr->synchronous = _mode;
+}
+
+//////////////////////////////////////////////////
+std::size_t LogOptions::PageSize() const
+{
+  return this->dataPtr->pageSize;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetPageSize(const std::size_t _bytes)
+{
+  this->dataPtr->pageSize = _bytes;
+}
+
+//////////////////////////////////////////////////
+std::size_t LogOptions::CacheSize() const
+{
+  return this->dataPtr->cacheSize;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetCacheSize(const std::size_t _bytes)
+{
+  this->dataPtr->cacheSize = _bytes;
+}
+
+//////////////////////////////////////////////////
+std::size_t LogOptions::MmapSize() const
+{
+  return this->dataPtr->mmapSize;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetMmapSize(const std::size_t _bytes)
+{
+  this->dataPtr->mmapSize = _bytes;
+}
+
+//////////////////////////////////////////////////
+std::chrono::milliseconds LogOptions::TransactionPeriod() const
+{
+  return this->dataPtr->transactionPeriod;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetTransactionPeriod(
+    const std::chrono::milliseconds &_period)
+{
+  this->dataPtr->transactionPeriod = _period;
+}
+
+//////////////////////////////////////////////////
+std::size_t LogOptions::TransactionMaxBytes() const
+{
+  return this->dataPtr->transactionMaxBytes;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetTransactionMaxBytes(const std::size_t _bytes)
+{
+  this->dataPtr->transactionMaxBytes = _bytes;
+}
+
+//////////////////////////////////////////////////
+uint64_t LogOptions::TransactionMaxMessages() const
+{
+  return this->dataPtr->transactionMaxMessages;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetTransactionMaxMessages(const uint64_t _count)
+{
+  this->dataPtr->transactionMaxMessages = _count;
+}
+
+//////////////////////////////////////////////////
+LogOptions::Format LogOptions::FileFormat() const
+{
+  return this->dataPtr->format;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetFileFormat(const Format _format)
+{
+  this->dataPtr->format = _format;
+}
+
+//////////////////////////////////////////////////
+std::size_t LogOptions::ChunkSize() const
+{
+  return this->dataPtr->chunkSize;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetChunkSize(const std::size_t _bytes)
+{
+  this->dataPtr->chunkSize = _bytes;
+}
+
+//////////////////////////////////////////////////
+LogOptions::Compression LogOptions::MessageCompression() const
+{
+  return this->dataPtr->compression;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetMessageCompression(const Compression _compression)
+{
+  this->dataPtr->compression = _compression;
+}
+
+//////////////////////////////////////////////////
+int LogOptions::CompressionLevel() const
+{
+  return this->dataPtr->compressionLevel;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetCompressionLevel(const int _level)
+{
+  this->dataPtr->compressionLevel = _level;
+}
+
+//////////////////////////////////////////////////
+std::size_t LogOptions::CompressionMinSize() const
+{
+  return this->dataPtr->compressionMinSize;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetCompressionMinSize(const std::size_t _bytes)
+{
+  this->dataPtr->compressionMinSize = _bytes;
+}
+
+//////////////////////////////////////////////////
+std::size_t LogOptions::CompressionThreads() const
+{
+  return this->dataPtr->compressionThreads;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetCompressionThreads(const std::size_t _threads)
+{
+  this->dataPtr->compressionThreads = _threads;
+}
+
+//////////////////////////////////////////////////
+bool LogOptions::DeferIndexes() const
+{
+  return this->dataPtr->deferIndexes;
+}
+
+//////////////////////////////////////////////////
+void LogOptions::SetDeferIndexes(const bool _defer)
+{
+  this->dataPtr->deferIndexes = _defer;
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <ios>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/log/Log.hh"
+#include "ignition/transport/log/LogOptions.hh"
+#include "ignition/transport/test_config.h"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+TEST(LogOptions, Defaults)
+{
+  log::LogOptions options;
+  EXPECT_EQ(log::LogOptions::JournalMode::DEFAULT, options.Journal());
+  EXPECT_EQ(log::LogOptions::SyncMode::DEFAULT, options.Synchronous());
+  EXPECT_EQ(0u, options.PageSize());
+  EXPECT_EQ(0u, options.CacheSize());
+  EXPECT_EQ(0u, options.MmapSize());
+  EXPECT_EQ(500ms, options.TransactionPeriod());
+  EXPECT_EQ(0u, options.TransactionMaxBytes());
+  EXPECT_EQ(0u, options.TransactionMaxMessages());
+  EXPECT_EQ(log::LogOptions::Format::SQLITE, options.FileFormat());
+  EXPECT_EQ(4u << 20, options.ChunkSize());
+  EXPECT_EQ(log::LogOptions::Compression::NONE, options.MessageCompression());
+  EXPECT_EQ(1, options.CompressionLevel());
+  EXPECT_EQ(128u, options.CompressionMinSize());
+  EXPECT_EQ(0u, options.CompressionThreads());
+  EXPECT_FALSE(options.DeferIndexes());
+}
+
+//////////////////////////////////////////////////
+TEST(LogOptions, SetAndCopy)
+{
+  log::LogOptions options;
+  options.SetJournal(log::LogOptions::JournalMode::MEMORY);
+  options.SetSynchronous(log::LogOptions::SyncMode::NORMAL);
+  options.SetPageSize(8192);
+  options.SetCacheSize(1 << 20);
+  options.SetMmapSize(1 << 30);
+  options.SetTransactionPeriod(2s);
+  options.SetTransactionMaxBytes(1000);
+  options.SetTransactionMaxMessages(10);
+  options.SetFileFormat(log::LogOptions::Format::CHUNKED);
+  options.SetChunkSize(1 << 16);
+  options.SetMessageCompression(log::LogOptions::Compression::ZLIB);
+  options.SetCompressionLevel(6);
+  options.SetCompressionMinSize(10);
+  options.SetCompressionThreads(3);
+  options.SetDeferIndexes(true);
+
+  log::LogOptions copy(options);
+  log::LogOptions assigned;
+  assigned = options;
+  for (const auto &opts : {copy, assigned})
+  {
+    EXPECT_EQ(log::LogOptions::JournalMode::MEMORY, opts.Journal());
+    EXPECT_EQ(log::LogOptions::SyncMode::NORMAL, opts.Synchronous());
+    EXPECT_EQ(8192u, opts.PageSize());
+    EXPECT_EQ(1u << 20, opts.CacheSize());
+    EXPECT_EQ(1u << 30, opts.MmapSize());
+    EXPECT_EQ(2s, opts.TransactionPeriod());
+    EXPECT_EQ(1000u, opts.TransactionMaxBytes());
+    EXPECT_EQ(10u, opts.TransactionMaxMessages());
+    EXPECT_EQ(log::LogOptions::Format::CHUNKED, opts.FileFormat());
+    EXPECT_EQ(1u << 16, opts.ChunkSize());
+    EXPECT_EQ(log::LogOptions::Compression::ZLIB, opts.MessageCompression());
+    EXPECT_EQ(6, opts.CompressionLevel());
+    EXPECT_EQ(10u, opts.CompressionMinSize());
+    EXPECT_EQ(3u, opts.CompressionThreads());
+    EXPECT_TRUE(opts.DeferIndexes());
+  }
+
+  // The copies are independent.
+  options.SetPageSize(4096);
+  EXPECT_EQ(8192u, copy.PageSize());
+}
+
+//////////////////////////////////////////////////
+TEST(LogOptions, HighThroughput)
+{
+  const auto options = log::LogOptions::HighThroughput();
+  EXPECT_EQ(log::LogOptions::JournalMode::WAL, options.Journal());
+  EXPECT_EQ(log::LogOptions::SyncMode::OFF, options.Synchronous());
+  EXPECT_EQ(65536u, options.PageSize());
+  EXPECT_GT(options.CacheSize(), 0u);
+  EXPECT_GT(options.TransactionMaxBytes(), 0u);
+}
+
+//////////////////////////////////////////////////
+TEST(LogOptions, WriteAndRead)
+{
+  const std::string logName = "log_options_" + testing::getRandomNumber() +
+    ".tlog";
+
+  log::LogOptions options = log::LogOptions::HighThroughput();
+  options.SetMmapSize(1 << 20);
+  // End the transaction after every other message.
+  options.SetTransactionMaxMessages(2);
+
+  std::string data("some_data");
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out, options));
+    for (int i = 1; i <= 5; ++i)
+    {
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+        "/some/topic", "some.type", data.c_str(), data.size()));
+    }
+  }
+
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::in, options));
+    int count = 0;
+    for (const auto &msg : logFile.QueryMessages())
+    {
+      EXPECT_EQ(data, msg.Data());
+      ++count;
+    }
+    EXPECT_EQ(5, count);
+    EXPECT_EQ(5s, logFile.EndTime());
+  }
+
+  // The log is left in the default journal mode.
+  EXPECT_FALSE(std::ifstream(logName + "-wal").good());
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(LogOptions, TransactionMaxBytes)
+{
+  // Every message ends its transaction.
+  log::LogOptions options;
+  options.SetTransactionPeriod(1h);
+  options.SetTransactionMaxBytes(1);
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out, options));
+  std::string data("some_data");
+  EXPECT_TRUE(logFile.InsertMessage(1s, "/some/topic", "some.type",
+    data.c_str(), data.size()));
+  EXPECT_TRUE(logFile.InsertMessage(2s, "/some/topic", "some.type",
+    data.c_str(), data.size()));
+  EXPECT_EQ(2s, logFile.EndTime());
+}
+
+//////////////////////////////////////////////////
+TEST(LogOptions, Compression)
+{
+  log::LogOptions options;
+  options.SetMessageCompression(log::LogOptions::Compression::ZLIB);
+  options.SetCompressionThreads(4);
+
+  log::Log logFile;
+  if (!logFile.Open(":memory:", std::ios_base::out, options))
+  {
+    std::cerr << "Built without zlib, skipping test." << std::endl;
+    return;
+  }
+  // The compressed logs are framed.
+  EXPECT_EQ("0.2.0", logFile.Version());
+
+  const std::string small("small_data");
+  const std::string big(4096, 'x');
+  EXPECT_TRUE(logFile.InsertMessage(1s, "/some/topic", "some.type",
+    big.c_str(), big.size()));
+  EXPECT_TRUE(logFile.InsertMessage(2s, "/some/topic", "some.type",
+    small.c_str(), small.size()));
+
+  std::vector<log::Log::MessageRecord> records;
+  for (int i = 3; i <= 40; ++i)
+  {
+    const std::string &data = i % 2 ? big : small;
+    records.push_back({std::chrono::seconds(i), "/other/topic", "some.type",
+      data.c_str(), data.size()});
+  }
+  EXPECT_EQ(records.size(), logFile.InsertMessages(records));
+
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    ++count;
+    EXPECT_EQ(count % 2 ? big : small, msg.Data());
+    EXPECT_EQ(std::chrono::seconds(count), msg.TimeReceived());
+  }
+  EXPECT_EQ(40, count);
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/msgs/bytes.pb.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ignition/transport/log/LogServer.hh"
+#include "ignition/transport/Node.hh"
+#include "ChunkedLog.hh"
+#include "Console.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+/// \brief Private implementation
+class ignition::transport::log::LogServer::Implementation
+{
+  /// \brief Write a chunk received by the service.
+  /// \param[in] _req The file header followed by the chunk
+  /// \param[out] _rep True if the chunk was written
+  /// \return True, so the sender gets the reply
+  public: bool OnChunk(const ignition::msgs::Bytes &_req,
+                       ignition::msgs::Boolean &_rep);
+
+  /// \brief Protects all the members except the counters
+  public: std::mutex mutex;
+
+  /// \brief Node advertising the service
+  public: Node node;
+
+  /// \brief Name of the service, empty if the server isn't started
+  public: std::string service;
+
+  /// \brief Path of the log file
+  public: std::string file;
+
+  /// \brief Writer of the log file, nullptr until the first chunk
+  public: std::unique_ptr<ChunkWriter> writer;
+
+  /// \brief True if the messages of the log file are framed
+  public: bool framed = false;
+
+  /// \brief Chunks written
+  public: std::atomic<uint64_t> received{0};
+
+  /// \brief Chunks rejected
+  public: std::atomic<uint64_t> rejected{0};
+};
+
+//////////////////////////////////////////////////
+bool LogServer::Implementation::OnChunk(const ignition::msgs::Bytes &_req,
+    ignition::msgs::Boolean &_rep)
+{
+  const std::string &data = _req.data();
+  bool framed = false;
+  _rep.set_data(false);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->service.empty())
+    return true;
+
+  if (!ParseStreamedChunk(data.data(), data.size(), framed))
+  {
+    LERR("Received an invalid chunk on [" << this->service << "]\n");
+    ++this->rejected;
+    return true;
+  }
+
+  if (!this->writer)
+  {
+    std::unique_ptr<ChunkWriter> newWriter(new ChunkWriter);
+    if (!newWriter->Open(this->file, 0, framed))
+    {
+      ++this->rejected;
+      return true;
+    }
+    this->writer = std::move(newWriter);
+    this->framed = framed;
+    LMSG("Writing the log received on [" << this->service << "] to ["
+         << this->file << "]\n");
+  }
+  else if (framed != this->framed)
+  {
+    LERR("Received a chunk compressed unlike the log file [" << this->file
+         << "]\n");
+    ++this->rejected;
+    return true;
+  }
+
+  if (!this->writer->AppendChunk(data.data() + kStreamedChunkOffset,
+        data.size() - kStreamedChunkOffset))
+  {
+    ++this->rejected;
+    return true;
+  }
+
+  ++this->received;
+  _rep.set_data(true);
+  return true;
+}
+
+//////////////////////////////////////////////////
+LogServer::LogServer()
+  : dataPtr(new Implementation)
+{
+}
+
+//////////////////////////////////////////////////
+LogServer::~LogServer()
+{
+  this->Stop();
+}
+
+//////////////////////////////////////////////////
+bool LogServer::Start(const std::string &_service, const std::string &_file)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  if (!this->dataPtr->service.empty())
+  {
+    LERR("The log server is already receiving on ["
+         << this->dataPtr->service << "]\n");
+    return false;
+  }
+
+  Implementation *impl = this->dataPtr.get();
+  std::function<bool(const ignition::msgs::Bytes &,
+                     ignition::msgs::Boolean &)> cb =
+    [impl](const ignition::msgs::Bytes &_req, ignition::msgs::Boolean &_rep)
+    {
+      return impl->OnChunk(_req, _rep);
+    };
+
+  if (!this->dataPtr->node.Advertise(_service, cb))
+  {
+    LERR("Failed to advertise service [" << _service << "]\n");
+    return false;
+  }
+
+  this->dataPtr->service = _service;
+  this->dataPtr->file = _file;
+  this->dataPtr->received = 0;
+  this->dataPtr->rejected = 0;
+  return true;
+}
+
+//////////////////////////////////////////////////
+void LogServer::Stop()
+{
+  std::string service;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    service.swap(this->dataPtr->service);
+  }
+  if (service.empty())
+    return;
+
+  this->dataPtr->node.UnadvertiseSrv(service);
+
+  // A chunk being written finishes before the file is closed, and the
+  // next ones are refused
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->writer.reset();
+}
+
+//////////////////////////////////////////////////
+uint64_t LogServer::ReceivedChunks() const
+{
+  return this->dataPtr->received;
+}
+
+//////////////////////////////////////////////////
+uint64_t LogServer::RejectedChunks() const
+{
+  return this->dataPtr->rejected;
+}
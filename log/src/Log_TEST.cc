@@ -15,14 +15,24 @@
  *
 */
 
+#include <sqlite3.h>
+
 #include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <ios>
+#include <regex>
+#include <set>
 #include <string>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include "ignition/transport/log/Log.hh"
 #include "ignition/transport/test_config.h"
 #include "ignition/transport/log/test_config.h"
+#include "Compression.hh"
+#include "Manifest.hh"
 #include "gtest/gtest.h"
 
 using namespace ignition;
@@ -144,6 +154,90 @@ TEST(Log, InsertMessageGetMessages)
   EXPECT_EQ(log::MsgIter(), iter);
 }
 
+//////////////////////////////////////////////////
+TEST(Log, InsertMessagesGetMessages)
+{
+  log::Log logFile;
+  EXPECT_EQ(0u, logFile.InsertMessages({}));
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  std::string data1("first_data");
+  std::string data2("second_data");
+  std::string data3("third_data");
+  const std::string topic1 = "/some/topic/name";
+  const std::string topic2 = "/second/topic/name";
+  const std::string type = "some.message.type";
+
+  std::vector<log::Log::MessageRecord> records(4);
+  records[0] = {1s, topic1, type, data1.c_str(), data1.size()};
+  records[1] = {2s, topic2, type, data2.c_str(), data2.size()};
+  records[2] = {3s, topic2, type, data3.c_str(), data3.size()};
+  // Empty messages can't be recorded.
+  records[3] = {4s, topic1, type, data1.c_str(), 0u};
+  EXPECT_EQ(3u, logFile.InsertMessages(records));
+
+  auto batch = logFile.QueryMessages();
+  auto iter = batch.begin();
+  ASSERT_NE(batch.end(), iter);
+  EXPECT_EQ(data1, iter->Data());
+  EXPECT_EQ(topic1, iter->Topic());
+  ++iter;
+  ASSERT_NE(batch.end(), iter);
+  EXPECT_EQ(data2, iter->Data());
+  EXPECT_EQ(topic2, iter->Topic());
+  ++iter;
+  ASSERT_NE(batch.end(), iter);
+  EXPECT_EQ(data3, iter->Data());
+  ++iter;
+  EXPECT_EQ(log::MsgIter(), iter);
+
+  // The statements are reused by the following insertions.
+  EXPECT_TRUE(logFile.InsertMessage(
+      5s, topic1, type, reinterpret_cast<const void *>(data1.c_str()),
+      data1.size()));
+  EXPECT_EQ(2u, logFile.InsertMessages({records[0], records[1]}));
+}
+
+//////////////////////////////////////////////////
+TEST(Log, InsertMessageByTopicId)
+{
+  log::Log logFile;
+  EXPECT_EQ(-1, logFile.InsertOrGetTopicId("/some/topic", "some.type"));
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  const int64_t id1 = logFile.InsertOrGetTopicId("/some/topic", "some.type");
+  const int64_t id2 = logFile.InsertOrGetTopicId("/some/topic", "other.type");
+  EXPECT_GE(id1, 0);
+  EXPECT_GE(id2, 0);
+  EXPECT_NE(id1, id2);
+  EXPECT_EQ(id1, logFile.InsertOrGetTopicId("/some/topic", "some.type"));
+  EXPECT_EQ(id1, logFile.Descriptor()->TopicId("/some/topic", "some.type"));
+
+  std::string data1("first_data");
+  std::string data2("second_data");
+  EXPECT_FALSE(logFile.InsertMessage(1s, -1, data1.c_str(), data1.size()));
+  EXPECT_TRUE(logFile.InsertMessage(1s, id1, data1.c_str(), data1.size()));
+
+  log::Log::MessageRecord record;
+  record.time = 2s;
+  record.data = data2.c_str();
+  record.len = data2.size();
+  record.topicId = id2;
+  EXPECT_EQ(1u, logFile.InsertMessages({record}));
+
+  auto batch = logFile.QueryMessages();
+  auto iter = batch.begin();
+  ASSERT_NE(batch.end(), iter);
+  EXPECT_EQ(data1, iter->Data());
+  EXPECT_EQ("some.type", iter->Type());
+  ++iter;
+  ASSERT_NE(batch.end(), iter);
+  EXPECT_EQ(data2, iter->Data());
+  EXPECT_EQ("other.type", iter->Type());
+  ++iter;
+  EXPECT_EQ(batch.end(), iter);
+}
+
 //////////////////////////////////////////////////
 TEST(Log, QueryMessagesByTopicNone)
 {
@@ -203,6 +297,508 @@ TEST(Log, Insert2Get1MessageByTopic)
   }
 }
 
+//////////////////////////////////////////////////
+TEST(Log, QueryFewTopics)
+{
+  const std::string logName = "topics_" + testing::getRandomNumber() +
+    ".tlog";
+  const std::string type = "some.message.type";
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+
+    // A busy topic, and two rare ones
+    for (int i = 1; i <= 30; ++i)
+    {
+      const std::string topic = i % 10 == 0 ? "/rare/a" :
+        i % 7 == 0 ? "/rare/b" : "/busy";
+      const std::string data = "data_" + std::to_string(i);
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i), topic, type,
+          data.c_str(), data.size()));
+    }
+  }
+
+  // A log file recorded before the topic index was added
+  const std::string oldLogName = "old_" + logName;
+  {
+    std::ifstream in(logName, std::ios_base::binary);
+    std::ofstream out(oldLogName, std::ios_base::binary);
+    out << in.rdbuf();
+  }
+  {
+    sqlite3 *db = nullptr;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(oldLogName.c_str(), &db));
+    EXPECT_EQ(SQLITE_OK, sqlite3_exec(db,
+          "DROP INDEX idx_topic_time_recv;", nullptr, nullptr, nullptr));
+    sqlite3_close(db);
+  }
+
+  for (const std::string &name : {logName, oldLogName})
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(name, std::ios_base::in));
+    ASSERT_NE(nullptr, logFile.Descriptor());
+    EXPECT_EQ(name == logName, logFile.Descriptor()->HasTopicTimeIndex());
+
+    // The messages of the rare topics come in time order
+    std::vector<int> times;
+    for (const auto &msg : logFile.QueryMessages(
+           log::TopicPattern(std::regex("/rare/.*"),
+             log::QualifiedTimeRange(5s, 28s))))
+    {
+      times.push_back(static_cast<int>(
+            std::chrono::duration_cast<std::chrono::seconds>(
+              msg.TimeReceived()).count()));
+      EXPECT_EQ("data_" + std::to_string(times.back()), msg.Data());
+      EXPECT_EQ(times.back() % 10 == 0 ? "/rare/a" : "/rare/b", msg.Topic());
+    }
+    EXPECT_EQ(std::vector<int>({7, 10, 14, 20, 21, 28}), times);
+
+    int count = 0;
+    for (const auto &msg : logFile.QueryMessages(
+           log::TopicList(std::set<std::string>{"/busy", "/rare/a",
+             "/rare/b"})))
+    {
+      ++count;
+      EXPECT_EQ(std::chrono::seconds(count), msg.TimeReceived());
+    }
+    EXPECT_EQ(30, count);
+  }
+
+  std::remove(logName.c_str());
+  std::remove(oldLogName.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, QueryManyTopics)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+
+  // More topics than the parameters of a statement on older SQLite versions
+  const std::string type = "some.message.type";
+  std::set<std::string> topics;
+  for (int i = 0; i < 1200; ++i)
+  {
+    const std::string topic = "/topic_" + std::to_string(i);
+    const std::string data = std::to_string(i);
+    EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(1200 - i), topic,
+        type, data.c_str(), data.size()));
+    if (i % 3 != 0)
+      topics.insert(topic);
+  }
+  EXPECT_TRUE(logFile.InsertMessage(0s, "/other", type, "x", 1));
+
+  std::vector<int> received;
+  for (const auto &msg : logFile.QueryMessages(log::TopicList(topics)))
+    received.push_back(std::stoi(msg.Data()));
+
+  // A single query returns the messages in time order
+  ASSERT_EQ(800u, received.size());
+  EXPECT_EQ(1199, received.front());
+  EXPECT_EQ(1, received.back());
+  for (std::size_t i = 1; i < received.size(); ++i)
+    EXPECT_GT(received[i - 1], received[i]);
+
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages(
+         log::TopicPattern(std::regex("/topic_.*"))))
+  {
+    EXPECT_NE("/other", msg.Topic());
+    ++count;
+  }
+  EXPECT_EQ(1200, count);
+}
+
+//////////////////////////////////////////////////
+TEST(Log, HeadersAndSummaries)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(":memory:", std::ios_base::out));
+  EXPECT_GE(logFile.InsertOrGetTopicId("/empty", "some.type"), 0);
+  for (int i = 1; i <= 5; ++i)
+  {
+    const std::string data(i * 10, 'x');
+    EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+        i % 2 ? "/odd" : "/even", "some.type", data.c_str(), data.size()));
+  }
+
+  // The headers come without the data
+  int count = 0;
+  for (const auto &msg : logFile.QueryHeaders(log::TopicList("/odd")))
+  {
+    EXPECT_EQ(std::chrono::seconds(2 * count + 1), msg.TimeReceived());
+    EXPECT_EQ("/odd", msg.Topic());
+    EXPECT_EQ("some.type", msg.Type());
+    EXPECT_TRUE(msg.Data().empty());
+    ++count;
+  }
+  EXPECT_EQ(3, count);
+
+  const std::vector<log::Log::TopicSummary> summaries =
+    logFile.TopicSummaries();
+  ASSERT_EQ(3u, summaries.size());
+  EXPECT_EQ("/empty", summaries[0].topic);
+  EXPECT_EQ(0u, summaries[0].messages);
+  EXPECT_EQ(0u, summaries[0].bytes);
+  EXPECT_EQ("/even", summaries[1].topic);
+  EXPECT_EQ("some.type", summaries[1].type);
+  EXPECT_EQ(2u, summaries[1].messages);
+  EXPECT_EQ(60u, summaries[1].bytes);
+  EXPECT_EQ(2s, summaries[1].firstTime);
+  EXPECT_EQ(4s, summaries[1].lastTime);
+  EXPECT_EQ("/odd", summaries[2].topic);
+  EXPECT_EQ(3u, summaries[2].messages);
+  EXPECT_EQ(90u, summaries[2].bytes);
+  EXPECT_EQ(1s, summaries[2].firstTime);
+  EXPECT_EQ(5s, summaries[2].lastTime);
+
+  log::Log unopened;
+  EXPECT_TRUE(unopened.TopicSummaries().empty());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, PersistedSummaries)
+{
+  const std::string logName = "summaries_" + testing::getRandomNumber() +
+    ".tlog";
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+    EXPECT_GE(logFile.InsertOrGetTopicId("/empty", "some.type"), 0);
+    for (int i = 1; i <= 5; ++i)
+    {
+      const std::string data(i * 10, 'x');
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(6 - i),
+          i % 2 ? "/odd" : "/even", "some.type", data.c_str(), data.size()));
+    }
+  }
+
+  // The times and the statistics are read from the table written when the
+  // log was closed, so they stay the same without the messages
+  sqlite3 *db = nullptr;
+  ASSERT_EQ(SQLITE_OK, sqlite3_open(logName.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_exec(db,
+      "DELETE FROM messages WHERE time_recv = 1000000000;",
+      nullptr, nullptr, nullptr));
+  sqlite3_close(db);
+
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName));
+    EXPECT_EQ(1s, logFile.StartTime());
+    EXPECT_EQ(5s, logFile.EndTime());
+
+    const std::vector<log::Log::TopicSummary> summaries =
+      logFile.TopicSummaries();
+    ASSERT_EQ(3u, summaries.size());
+    EXPECT_EQ("/empty", summaries[0].topic);
+    EXPECT_EQ(0u, summaries[0].messages);
+    EXPECT_EQ("/even", summaries[1].topic);
+    EXPECT_EQ(2u, summaries[1].messages);
+    EXPECT_EQ(60u, summaries[1].bytes);
+    EXPECT_EQ(2s, summaries[1].firstTime);
+    EXPECT_EQ(4s, summaries[1].lastTime);
+    EXPECT_EQ("/odd", summaries[2].topic);
+    EXPECT_EQ(3u, summaries[2].messages);
+    EXPECT_EQ(90u, summaries[2].bytes);
+    EXPECT_EQ(1s, summaries[2].firstTime);
+    EXPECT_EQ(5s, summaries[2].lastTime);
+  }
+
+  // Without the table, like the logs of older versions, they come from the
+  // messages
+  ASSERT_EQ(SQLITE_OK, sqlite3_open(logName.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_exec(db, "DROP TABLE topic_summaries;",
+      nullptr, nullptr, nullptr));
+  sqlite3_close(db);
+
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName));
+    EXPECT_EQ(2s, logFile.StartTime());
+    EXPECT_EQ(5s, logFile.EndTime());
+
+    const std::vector<log::Log::TopicSummary> summaries =
+      logFile.TopicSummaries();
+    ASSERT_EQ(3u, summaries.size());
+    EXPECT_EQ(2u, summaries[2].messages);
+    EXPECT_EQ(3s, summaries[2].firstTime);
+  }
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Count the indexes of the messages of a log file.
+/// \param[in] _file Path of the log file
+/// \return The number of indexes, or -1 on error
+static int countMessageIndexes(const std::string &_file)
+{
+  sqlite3 *db = nullptr;
+  if (SQLITE_OK != sqlite3_open(_file.c_str(), &db))
+    return -1;
+  int count = -1;
+  sqlite3_exec(db, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index'"
+      " AND tbl_name = 'messages';",
+      [](void *_count, int, char **_values, char **)
+      {
+        *static_cast<int *>(_count) = std::stoi(_values[0]);
+        return 0;
+      }, &count, nullptr);
+  sqlite3_close(db);
+  return count;
+}
+
+//////////////////////////////////////////////////
+TEST(Log, DeferIndexes)
+{
+  const std::string logName = "deferred_" + testing::getRandomNumber() +
+    ".tlog";
+  log::LogOptions options;
+  options.SetDeferIndexes(true);
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out, options));
+    for (int i = 1; i <= 10; ++i)
+    {
+      const std::string data = "data_" + std::to_string(i);
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(11 - i),
+          i % 2 ? "/odd" : "/even", "some.type", data.c_str(), data.size()));
+    }
+  }
+  EXPECT_EQ(0, countMessageIndexes(logName));
+
+  // The queries work without the indexes, only slower
+  auto checkMessages = [&logName]()
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName));
+    int count = 0;
+    std::chrono::nanoseconds last{0};
+    for (const auto &msg : logFile.QueryMessages(log::TopicList("/odd")))
+    {
+      EXPECT_EQ("/odd", msg.Topic());
+      EXPECT_LT(last, msg.TimeReceived());
+      last = msg.TimeReceived();
+      ++count;
+    }
+    EXPECT_EQ(5, count);
+    EXPECT_EQ(1s, logFile.StartTime());
+    EXPECT_EQ(10s, logFile.EndTime());
+  };
+  checkMessages();
+
+  ASSERT_TRUE(log::Log::Finalize(logName));
+  EXPECT_EQ(2, countMessageIndexes(logName));
+  checkMessages();
+
+  // Finalizing again only analyzes the file, and so does vacuuming
+  EXPECT_TRUE(log::Log::Finalize(logName, true));
+  EXPECT_EQ(2, countMessageIndexes(logName));
+
+  // The summary of a file that wasn't closed properly is built too
+  sqlite3 *db = nullptr;
+  ASSERT_EQ(SQLITE_OK, sqlite3_open(logName.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_exec(db, "DROP TABLE topic_summaries;"
+      "DELETE FROM messages WHERE time_recv = 10000000000;",
+      nullptr, nullptr, nullptr));
+  sqlite3_close(db);
+  ASSERT_TRUE(log::Log::Finalize(logName));
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName));
+    const std::vector<log::Log::TopicSummary> summaries =
+      logFile.TopicSummaries();
+    ASSERT_EQ(2u, summaries.size());
+    EXPECT_EQ("/even", summaries[0].topic);
+    EXPECT_EQ(5u, summaries[0].messages);
+    EXPECT_EQ("/odd", summaries[1].topic);
+    EXPECT_EQ(4u, summaries[1].messages);
+    EXPECT_EQ(24u, summaries[1].bytes);
+    EXPECT_EQ(2s, summaries[1].firstTime);
+    EXPECT_EQ(8s, summaries[1].lastTime);
+  }
+
+  EXPECT_FALSE(log::Log::Finalize("/this/file/does/not/exist"));
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, QueryPartitions)
+{
+  const std::string logName = "partitions_" + testing::getRandomNumber() +
+    ".tlog";
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+    for (int i = 1; i <= 100; ++i)
+    {
+      const std::string data = std::to_string(i);
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+          i % 2 ? "/odd" : "/even", "some.type", data.c_str(), data.size()));
+    }
+
+    // The logs open for writing share their connection
+    EXPECT_EQ(3u, logFile.QueryPartitions(log::AllTopics(), 3).size());
+  }
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(logName));
+
+  // The batches are iterated concurrently, and cover disjoint slices of
+  // time in order
+  std::vector<log::Batch> batches =
+    logFile.QueryPartitions(log::AllTopics(), 4);
+  ASSERT_EQ(4u, batches.size());
+  std::vector<std::vector<int64_t>> times(batches.size());
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < batches.size(); ++i)
+  {
+    threads.emplace_back([&batches, &times, i]()
+    {
+      for (const auto &msg : batches[i])
+        times[i].push_back(msg.TimeReceived().count());
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  std::vector<int64_t> all;
+  for (const auto &batchTimes : times)
+  {
+    EXPECT_FALSE(batchTimes.empty());
+    all.insert(all.end(), batchTimes.begin(), batchTimes.end());
+  }
+  ASSERT_EQ(100u, all.size());
+  for (std::size_t i = 0; i < all.size(); ++i)
+    EXPECT_EQ(std::chrono::nanoseconds(std::chrono::seconds(i + 1)).count(),
+              all[i]);
+
+  // The slices are within the time range of the query
+  batches = logFile.QueryPartitions(
+      log::TopicList("/odd", log::QualifiedTimeRange(10s, 20s)), 2);
+  ASSERT_EQ(2u, batches.size());
+  int count = 0;
+  for (auto &batch : batches)
+  {
+    for (const auto &msg : batch)
+    {
+      EXPECT_EQ("/odd", msg.Topic());
+      EXPECT_EQ(std::chrono::seconds(11 + 2 * count), msg.TimeReceived());
+      ++count;
+    }
+  }
+  EXPECT_EQ(5, count);
+
+  // There are no more batches than nanoseconds in the slice of time
+  EXPECT_EQ(1u, logFile.QueryPartitions(
+      log::AllTopics(log::QualifiedTimeRange(5s, 5s)), 8).size());
+  EXPECT_FALSE(logFile.QueryPartitions(log::AllTopics()).empty());
+
+  log::Log unopened;
+  EXPECT_TRUE(unopened.QueryPartitions(log::AllTopics(), 2).empty());
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the messages extracted from the log of the Extract test.
+/// \param[in] _file Path of the extracted log
+static void checkExtracted(const std::string &_file)
+{
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(_file));
+  EXPECT_EQ(6s, logFile.StartTime());
+  EXPECT_EQ(10s, logFile.EndTime());
+  ASSERT_NE(nullptr, logFile.Descriptor());
+  EXPECT_EQ(1u, logFile.Descriptor()->TopicsToMsgTypesToId().size());
+
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    EXPECT_EQ("/even", msg.Topic());
+    EXPECT_EQ("some.type", msg.Type());
+    EXPECT_EQ(std::chrono::seconds(6 + 2 * count), msg.TimeReceived());
+    EXPECT_EQ(std::string(100, 'a' + 5 + 2 * count), msg.Data());
+    ++count;
+  }
+  EXPECT_EQ(3, count);
+
+  const std::vector<log::Log::TopicSummary> summaries =
+    logFile.TopicSummaries();
+  ASSERT_EQ(1u, summaries.size());
+  EXPECT_EQ(3u, summaries[0].messages);
+  EXPECT_EQ(6s, summaries[0].firstTime);
+  EXPECT_EQ(10s, summaries[0].lastTime);
+}
+
+//////////////////////////////////////////////////
+TEST(Log, Extract)
+{
+  const bool zlib =
+    log::CompressionAvailable(log::LogOptions::Compression::ZLIB);
+  for (const bool compressed : {false, true})
+  {
+    if (compressed && !zlib)
+      continue;
+
+    log::LogOptions options;
+    if (compressed)
+    {
+      options.SetMessageCompression(log::LogOptions::Compression::ZLIB);
+      options.SetCompressionMinSize(0);
+    }
+
+    const std::string logName = "extract_" + testing::getRandomNumber() +
+      ".tlog";
+    {
+      log::Log logFile;
+      ASSERT_TRUE(logFile.Open(logName, std::ios_base::out, options));
+      for (int i = 1; i <= 20; ++i)
+      {
+        const std::string data(100, 'a' + i - 1);
+        EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+            i % 2 ? "/odd" : "/even", "some.type", data.c_str(),
+            data.size()));
+      }
+      EXPECT_GE(logFile.InsertOrGetTopicId("/empty", "other.type"), 0);
+    }
+
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName));
+    const log::TopicList query("/even", log::QualifiedTimeRange(5s, 10s));
+
+    // The rows are copied when the messages are framed the same way, and
+    // the messages are decoded otherwise
+    for (const bool compressCopy : {false, true})
+    {
+      if (compressCopy && !zlib)
+        continue;
+
+      log::LogOptions extractOptions;
+      if (compressCopy)
+      {
+        extractOptions.SetMessageCompression(
+            log::LogOptions::Compression::ZLIB);
+      }
+      const std::string extractName = "extracted_" +
+        testing::getRandomNumber() + ".tlog";
+      EXPECT_TRUE(logFile.Extract(extractName, query, extractOptions));
+      checkExtracted(extractName);
+
+      // The new log must not exist
+      EXPECT_FALSE(logFile.Extract(extractName, query, extractOptions));
+      std::remove(extractName.c_str());
+    }
+
+    std::remove(logName.c_str());
+  }
+
+  log::Log unopened;
+  EXPECT_FALSE(unopened.Extract("extracted.tlog"));
+}
+
 //////////////////////////////////////////////////
 TEST(Log, CheckLogTimes)
 {
@@ -259,6 +855,343 @@ TEST(Log, OpenCorruptDatabase)
     << logFile.EndTime().count() << "ns";;
 }
 
+//////////////////////////////////////////////////
+TEST(Log, PartFilename)
+{
+  EXPECT_EQ("run.tlog", log::Log::PartFilename("run.tlog", 0));
+  EXPECT_EQ("run.1.tlog", log::Log::PartFilename("run.tlog", 1));
+  EXPECT_EQ("/a.b/run.12", log::Log::PartFilename("/a.b/run", 12));
+  EXPECT_EQ("run.2", log::Log::PartFilename("run", 2));
+}
+
+//////////////////////////////////////////////////
+TEST(Log, OpenSplitFiles)
+{
+  const std::string logName = "split_" + testing::getRandomNumber() +
+    ".tlog";
+  const std::string data = "some_data";
+  const std::string type = "some.message.type";
+
+  // Three parts, the last one with a topic of its own
+  for (std::size_t part = 0; part < 3; ++part)
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(log::Log::PartFilename(logName, part),
+          std::ios_base::out));
+    for (int i = 0; i < 2; ++i)
+    {
+      EXPECT_TRUE(logFile.InsertMessage(
+          std::chrono::seconds(2 * part + i + 1),
+          part == 2 && i == 1 ? "/topic/b" : "/topic/a", type,
+          data.c_str(), data.size()));
+    }
+  }
+
+  const std::vector<std::string> files = log::Log::SplitFiles(logName);
+  ASSERT_EQ(3u, files.size());
+  EXPECT_EQ(logName, files[0]);
+  EXPECT_EQ(log::Log::PartFilename(logName, 2), files[2]);
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(files));
+  EXPECT_TRUE(logFile.Valid());
+  EXPECT_EQ(logName, logFile.Filename());
+  EXPECT_EQ("0.1.0", logFile.Version());
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(6s, logFile.EndTime());
+  ASSERT_NE(nullptr, logFile.Descriptor());
+  EXPECT_EQ(2u, logFile.Descriptor()->TopicsToMsgTypesToId().size());
+
+  // The topic ids are those of the descriptor of the whole recording
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    ++count;
+    EXPECT_EQ(std::chrono::seconds(count), msg.TimeReceived());
+    EXPECT_EQ(data, msg.Data());
+    EXPECT_EQ(logFile.Descriptor()->TopicId(msg.Topic(), msg.Type()),
+              msg.TopicId());
+  }
+  EXPECT_EQ(6, count);
+
+  count = 0;
+  for (const auto &msg : logFile.QueryMessages(log::TopicList("/topic/a")))
+  {
+    EXPECT_EQ("/topic/a", msg.Topic());
+    ++count;
+  }
+  EXPECT_EQ(5, count);
+
+  // The statistics add up over the parts
+  const std::vector<log::Log::TopicSummary> summaries =
+    logFile.TopicSummaries();
+  ASSERT_EQ(2u, summaries.size());
+  EXPECT_EQ("/topic/a", summaries[0].topic);
+  EXPECT_EQ(5u, summaries[0].messages);
+  EXPECT_EQ(5 * data.size(), summaries[0].bytes);
+  EXPECT_EQ(1s, summaries[0].firstTime);
+  EXPECT_EQ(5s, summaries[0].lastTime);
+  EXPECT_EQ(1u, summaries[1].messages);
+  EXPECT_EQ(6s, summaries[1].firstTime);
+
+  count = 0;
+  for (const auto &msg : logFile.QueryHeaders())
+  {
+    ++count;
+    EXPECT_EQ(std::chrono::seconds(count), msg.TimeReceived());
+    EXPECT_TRUE(msg.Data().empty());
+    EXPECT_GE(msg.TopicId(), 0);
+  }
+  EXPECT_EQ(6, count);
+
+  // The parts out of the time range are skipped
+  count = 0;
+  for (const auto &msg : logFile.QueryMessages(log::AllTopics(
+         log::QualifiedTimeRange::From(log::QualifiedTime(4s)))))
+  {
+    EXPECT_EQ(std::chrono::seconds(count + 4), msg.TimeReceived());
+    ++count;
+  }
+  EXPECT_EQ(3, count);
+
+  count = 0;
+  for (const auto &msg : logFile.QueryMessages(log::TopicList("/topic/a",
+         log::QualifiedTimeRange(3s, 3s))))
+  {
+    EXPECT_EQ(3s, msg.TimeReceived());
+    ++count;
+  }
+  EXPECT_EQ(1, count);
+
+  count = 0;
+  for (const auto &msg : logFile.QueryMessages(log::AllTopics(
+         log::QualifiedTimeRange::From(log::QualifiedTime(7s)))))
+  {
+    (void)msg;
+    ++count;
+  }
+  EXPECT_EQ(0, count);
+
+  // A split recording is read only
+  EXPECT_FALSE(logFile.InsertMessage(
+      7s, "/topic/a", type, data.c_str(), data.size()));
+  EXPECT_FALSE(logFile.Open(files));
+
+  // The parts can be memory mapped
+  log::LogOptions options;
+  options.SetMmapSize(1 << 20);
+  log::Log mappedLog;
+  ASSERT_TRUE(mappedLog.Open(files, options));
+  count = 0;
+  for (const auto &msg : mappedLog.QueryMessages())
+  {
+    ++count;
+    EXPECT_EQ(data, msg.DataView());
+  }
+  EXPECT_EQ(6, count);
+
+  // All the parts must exist
+  log::Log missingPart;
+  EXPECT_FALSE(missingPart.Open({logName, "/this/file/does/not/exist"}));
+  EXPECT_FALSE(missingPart.Valid());
+
+  for (const std::string &file : files)
+    std::remove(file.c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, GroupFilename)
+{
+  EXPECT_EQ("run.camera.tlog", log::Log::GroupFilename("run.tlog", "camera"));
+  EXPECT_EQ("/a.b/run.imu", log::Log::GroupFilename("/a.b/run", "imu"));
+  EXPECT_EQ("run.tlog.manifest", log::ManifestFilename("run.tlog"));
+}
+
+//////////////////////////////////////////////////
+TEST(Log, OpenManifest)
+{
+  const std::string logName = "grouped_" + testing::getRandomNumber() +
+    ".tlog";
+  const std::string cameraName = log::Log::GroupFilename(logName, "camera");
+  const std::string type = "some.message.type";
+
+  // The default file has the odd seconds, the camera group is split in two
+  // parts and has the even ones.
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+    for (int i = 1; i <= 7; i += 2)
+    {
+      const std::string data = "data_" + std::to_string(i);
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+          "/topic/a", type, data.c_str(), data.size()));
+    }
+  }
+  for (int part = 0; part < 2; ++part)
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(log::Log::PartFilename(cameraName, part),
+          std::ios_base::out));
+    for (int i = 2 + 4 * part; i <= 4 + 4 * part; i += 2)
+    {
+      const std::string data = "data_" + std::to_string(i);
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+          "/camera", type, data.c_str(), data.size()));
+    }
+  }
+
+  const std::string manifest = log::ManifestFilename(logName);
+  EXPECT_FALSE(log::IsManifest(logName));
+  ASSERT_TRUE(log::WriteManifest(manifest, {logName, cameraName}));
+  EXPECT_TRUE(log::IsManifest(manifest));
+  std::vector<std::string> files;
+  ASSERT_TRUE(log::ReadManifest(manifest, files));
+  ASSERT_EQ(2u, files.size());
+  EXPECT_EQ(cameraName, files[1]);
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(manifest));
+  EXPECT_TRUE(logFile.Valid());
+  EXPECT_EQ("0.1.0", logFile.Version());
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(8s, logFile.EndTime());
+  ASSERT_NE(nullptr, logFile.Descriptor());
+  EXPECT_EQ(2u, logFile.Descriptor()->TopicsToMsgTypesToId().size());
+
+  // The files are merged in the order of the messages
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    ++count;
+    EXPECT_EQ(std::chrono::seconds(count), msg.TimeReceived());
+    EXPECT_EQ("data_" + std::to_string(count), msg.Data());
+    EXPECT_EQ(count % 2 ? "/topic/a" : "/camera", msg.Topic());
+    // Both files number their topics from 1, the ids are the merged ones.
+    EXPECT_EQ(logFile.Descriptor()->TopicId(msg.Topic(), msg.Type()),
+              msg.TopicId());
+  }
+  EXPECT_EQ(8, count);
+
+  count = 0;
+  for (const auto &msg : logFile.QueryMessages(log::TopicList("/camera")))
+  {
+    EXPECT_EQ("/camera", msg.Topic());
+    ++count;
+  }
+  EXPECT_EQ(4, count);
+
+  // A query after the end of a file reads the other ones only
+  count = 0;
+  for (const auto &msg : logFile.QueryMessages(log::AllTopics(
+         log::QualifiedTimeRange::From(log::QualifiedTime(8s)))))
+  {
+    EXPECT_EQ("/camera", msg.Topic());
+    ++count;
+  }
+  EXPECT_EQ(1, count);
+
+  // A manifest listing a missing file can't be opened
+  ASSERT_TRUE(log::WriteManifest(manifest, {logName, "missing.tlog"}));
+  log::Log missingFile;
+  EXPECT_FALSE(missingFile.Open(manifest));
+
+  std::remove(manifest.c_str());
+  std::remove(logName.c_str());
+  std::remove(cameraName.c_str());
+  std::remove(log::Log::PartFilename(cameraName, 1).c_str());
+}
+
+//////////////////////////////////////////////////
+TEST(Log, OpenMerged)
+{
+  const std::string prefix = "merged_" + testing::getRandomNumber();
+  const std::string type = "some.message.type";
+
+  // Robot i has the seconds i, i + 3, ..., and all of them have the
+  // second 10. The last one is split in two parts.
+  std::vector<std::string> files;
+  for (int robot = 1; robot <= 3; ++robot)
+  {
+    const std::string logName = prefix + "_" + std::to_string(robot) +
+      ".tlog";
+    const std::string topic = "/robot" + std::to_string(robot);
+    files.push_back(logName);
+
+    std::vector<int> seconds;
+    for (int i = robot; i <= 9; i += 3)
+      seconds.push_back(i);
+    seconds.push_back(10);
+
+    const int parts = robot == 3 ? 2 : 1;
+    const std::size_t perPart = seconds.size() / parts;
+    for (int part = 0; part < parts; ++part)
+    {
+      log::Log logFile;
+      ASSERT_TRUE(logFile.Open(log::Log::PartFilename(logName, part),
+            std::ios_base::out));
+      const std::size_t end =
+        part + 1 == parts ? seconds.size() : (part + 1) * perPart;
+      for (std::size_t i = part * perPart; i < end; ++i)
+      {
+        const std::string data = "data_" + std::to_string(seconds[i]);
+        EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(seconds[i]),
+            topic, type, data.c_str(), data.size()));
+      }
+    }
+  }
+
+  log::Log logFile;
+  EXPECT_FALSE(logFile.OpenMerged({}));
+  ASSERT_TRUE(logFile.OpenMerged(files));
+  EXPECT_TRUE(logFile.Valid());
+  EXPECT_FALSE(logFile.OpenMerged(files));
+  EXPECT_EQ(1s, logFile.StartTime());
+  EXPECT_EQ(10s, logFile.EndTime());
+  ASSERT_NE(nullptr, logFile.Descriptor());
+  EXPECT_EQ(3u, logFile.Descriptor()->TopicsToMsgTypesToId().size());
+
+  // The messages come in time order, and the first files win the ties
+  std::vector<std::string> topics;
+  std::chrono::nanoseconds last{0};
+  for (const auto &msg : logFile.QueryMessages())
+  {
+    EXPECT_LE(last, msg.TimeReceived());
+    last = msg.TimeReceived();
+    topics.push_back(msg.Topic());
+    if (msg.TimeReceived() < 10s)
+    {
+      const auto second = std::chrono::duration_cast<std::chrono::seconds>(
+          msg.TimeReceived()).count();
+      EXPECT_EQ("/robot" + std::to_string((second - 1) % 3 + 1), msg.Topic());
+    }
+    EXPECT_EQ(logFile.Descriptor()->TopicId(msg.Topic(), msg.Type()),
+              msg.TopicId());
+  }
+  ASSERT_EQ(12u, topics.size());
+  EXPECT_EQ("/robot1", topics[9]);
+  EXPECT_EQ("/robot2", topics[10]);
+  EXPECT_EQ("/robot3", topics[11]);
+
+  // A query over a range of time merges what's left of the files
+  int count = 0;
+  for (const auto &msg : logFile.QueryMessages(log::TopicList(
+         std::set<std::string>{"/robot2", "/robot3"},
+         log::QualifiedTimeRange::From(log::QualifiedTime(5s)))))
+  {
+    EXPECT_NE("/robot1", msg.Topic());
+    ++count;
+  }
+  EXPECT_EQ(6, count);
+
+  // A missing file fails the whole log
+  log::Log missingFile;
+  EXPECT_FALSE(missingFile.OpenMerged({files[0], "missing.tlog"}));
+  EXPECT_FALSE(missingFile.Valid());
+
+  for (const std::string &file : files)
+    std::remove(file.c_str());
+  std::remove(log::Log::PartFilename(files[2], 1).c_str());
+}
 
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
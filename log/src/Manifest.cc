@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Console.hh"
+#include "Manifest.hh"
+
+using namespace ignition::transport;
+using namespace ignition::transport::log;
+
+/// \brief First line of the manifests
+static const char kManifestHeader[] = "ignition-transport-log-manifest 1";
+
+//////////////////////////////////////////////////
+/// \brief Get the position after the directory of a path.
+/// \param[in] _path The path
+/// \return The position of the file name in the path
+static std::size_t fileNamePosition(const std::string &_path)
+{
+  const std::size_t separator = _path.find_last_of("/\\");
+  return separator == std::string::npos ? 0 : separator + 1;
+}
+
+//////////////////////////////////////////////////
+std::string log::ManifestFilename(const std::string &_file)
+{
+  return _file + ".manifest";
+}
+
+//////////////////////////////////////////////////
+bool log::IsManifest(const std::string &_file)
+{
+  std::ifstream in(_file);
+  std::string line;
+  return std::getline(in, line) && line == kManifestHeader;
+}
+
+//////////////////////////////////////////////////
+bool log::WriteManifest(const std::string &_manifest,
+    const std::vector<std::string> &_files)
+{
+  std::ofstream out(_manifest, std::ios_base::trunc);
+  out << kManifestHeader << "\n";
+  for (const std::string &file : _files)
+    out << file.substr(fileNamePosition(file)) << "\n";
+  out.close();
+
+  if (!out)
+  {
+    LERR("Failed to write manifest [" << _manifest << "]\n");
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool log::ReadManifest(const std::string &_manifest,
+    std::vector<std::string> &_files)
+{
+  _files.clear();
+  if (!IsManifest(_manifest))
+    return false;
+
+  // The log files are next to the manifest
+  const std::string directory =
+    _manifest.substr(0, fileNamePosition(_manifest));
+
+  std::ifstream in(_manifest);
+  std::string line;
+  std::getline(in, line);
+  while (std::getline(in, line))
+  {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (!line.empty())
+      _files.push_back(directory + line);
+  }
+
+  if (_files.empty())
+  {
+    LERR("Manifest [" << _manifest << "] doesn't list any log file\n");
+    return false;
+  }
+  return true;
+}
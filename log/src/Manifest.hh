@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGNITION_TRANSPORT_LOG_MANIFEST_HH_
+#define IGNITION_TRANSPORT_LOG_MANIFEST_HH_
+
+#include <string>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+/// \file Manifest.hh
+/// \brief A manifest ties together the log files of a recording whose topic
+/// groups were written to separate files, see Recorder::AddTopicGroup(). It's
+/// a text file with the line "ignition-transport-log-manifest 1", followed by
+/// the names of the log files, one per line, relative to the directory of the
+/// manifest. Each log file may be split, see Log::SplitFiles().
+
+namespace ignition
+{
+namespace transport
+{
+namespace log
+{
+// Inline bracket to help doxygen filtering.
+inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+{
+  /// \brief Get the name of the manifest of a recording.
+  /// \param[in] _file Path of the recording
+  /// \return The path of the manifest, _file followed by ".manifest"
+  std::string ManifestFilename(const std::string &_file);
+
+  /// \brief Check if a file is a manifest.
+  /// \param[in] _file Path of the file
+  /// \return true if the file starts like a manifest
+  bool IsManifest(const std::string &_file);
+
+  /// \brief Write a manifest.
+  /// \param[in] _manifest Path of the manifest
+  /// \param[in] _files Paths of the log files, which must be in the
+  /// directory of the manifest
+  /// \return true if the manifest was written
+  bool WriteManifest(const std::string &_manifest,
+                     const std::vector<std::string> &_files);
+
+  /// \brief Read a manifest.
+  /// \param[in] _manifest Path of the manifest
+  /// \param[out] _files Paths of the log files
+  /// \return true if the manifest lists at least one log file
+  bool ReadManifest(const std::string &_manifest,
+                    std::vector<std::string> &_files);
+}
+}
+}
+}
+
+#endif
@@ -17,6 +17,7 @@
 
 #include <chrono>
 #include <string>
+#include <string_view>
 
 #include "ignition/transport/log/Message.hh"
 
@@ -46,6 +47,9 @@ class ignition::transport::log::MessagePrivate
 
   /// \brief Length of message type
   public: std::size_t typeLen = 0;
+
+  /// \brief Id of the topic and message type
+  public: int64_t topicId = -1;
 };
 
 //////////////////////////////////////////////////
@@ -58,7 +62,8 @@ Message::Message()
 Message::Message(const std::chrono::nanoseconds &_timeRecv,
             const void *_data, std::size_t _dataLen,
             const char *_type, std::size_t _typeLen,
-            const char *_topic, std::size_t _topicLen)
+            const char *_topic, std::size_t _topicLen,
+            int64_t _topicId)
   : dataPtr(new MessagePrivate)
 {
   this->dataPtr->timeReceived = _timeRecv;
@@ -68,6 +73,7 @@ Message::Message(const std::chrono::nanoseconds &_timeRecv,
   this->dataPtr->typeLen = _typeLen;
   this->dataPtr->topic = _topic;
   this->dataPtr->topicLen = _topicLen;
+  this->dataPtr->topicId = _topicId;
 }
 
 //////////////////////////////////////////////////
@@ -94,6 +100,31 @@ std::string Message::Topic() const
   return std::string(this->dataPtr->topic, this->dataPtr->topicLen);
 }
 
+//////////////////////////////////////////////////
+std::string_view Message::DataView() const
+{
+  return std::string_view(reinterpret_cast<const char *>(this->dataPtr->data),
+      this->dataPtr->dataLen);
+}
+
+//////////////////////////////////////////////////
+std::string_view Message::TypeView() const
+{
+  return std::string_view(this->dataPtr->type, this->dataPtr->typeLen);
+}
+
+//////////////////////////////////////////////////
+std::string_view Message::TopicView() const
+{
+  return std::string_view(this->dataPtr->topic, this->dataPtr->topicLen);
+}
+
+//////////////////////////////////////////////////
+int64_t Message::TopicId() const
+{
+  return this->dataPtr->topicId;
+}
+
 //////////////////////////////////////////////////
 const std::chrono::nanoseconds &Message::TimeReceived() const
 {
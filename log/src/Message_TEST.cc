@@ -17,6 +17,7 @@
 
 #include <chrono>
 #include <string>
+#include <string_view>
 
 #include "ignition/transport/log/Log.hh"
 #include "gtest/gtest.h"
@@ -31,7 +32,11 @@ TEST(Message, DefaultConstructor)
   EXPECT_EQ(std::string(""), msg.Data());
   EXPECT_EQ(std::string(""), msg.Topic());
   EXPECT_EQ(std::string(""), msg.Type());
+  EXPECT_TRUE(msg.DataView().empty());
+  EXPECT_TRUE(msg.TopicView().empty());
+  EXPECT_TRUE(msg.TypeView().empty());
   EXPECT_EQ(0ns, msg.TimeReceived());
+  EXPECT_EQ(-1, msg.TopicId());
 }
 
 //////////////////////////////////////////////////
@@ -51,6 +56,19 @@ TEST(Message, DataConstructor)
   EXPECT_EQ(msgType, msg.Type());
   EXPECT_EQ(topic, msg.Topic());
   EXPECT_EQ(goldenTime, msg.TimeReceived());
+
+  // The views point to the borrowed memory
+  EXPECT_EQ(data, msg.DataView());
+  EXPECT_EQ(data.c_str(), msg.DataView().data());
+  EXPECT_EQ(msgType, msg.TypeView());
+  EXPECT_EQ(topic, msg.TopicView());
+  EXPECT_EQ(-1, msg.TopicId());
+
+  transport::log::Message withId(goldenTime,
+      data.c_str(), data.size(),
+      msgType.c_str(), msgType.size(),
+      topic.c_str(), topic.size(), 3);
+  EXPECT_EQ(3, withId.TopicId());
 }
 
 //////////////////////////////////////////////////
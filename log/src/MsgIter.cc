@@ -17,9 +17,11 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
+#include "Compression.hh"
 #include "Console.hh"
 #include "ignition/transport/log/MsgIter.hh"
 #include "MsgIterPrivate.hh"
@@ -35,11 +37,11 @@ MsgIterPrivate::MsgIterPrivate()
 
 //////////////////////////////////////////////////
 MsgIterPrivate::MsgIterPrivate(
-    const std::shared_ptr<raii_sqlite3::Database> &_db,
-    const std::shared_ptr<std::vector<SqlStatement>> &_statements)
-  : db(_db), statements(_statements)
+    const std::shared_ptr<std::vector<BatchPrivate::Stream>> &_streams)
+  : streams(_streams), cursors(_streams ? _streams->size() : 0)
 {
-  PrepareNextStatement();
+  for (std::size_t i = 0; i < this->cursors.size(); ++i)
+    this->PrepareNextStatement(i);
 }
 
 //////////////////////////////////////////////////
@@ -48,24 +50,36 @@ MsgIterPrivate::~MsgIterPrivate()
 }
 
 //////////////////////////////////////////////////
-bool MsgIterPrivate::PrepareNextStatement()
+bool MsgIterPrivate::PrepareNextStatement(std::size_t _index)
 {
-  if (this->statements != nullptr
-      && this->statementIndex >= this->statements->size())
+  Cursor &cursor = this->cursors[_index];
+  const BatchPrivate::Stream &stream = (*this->streams)[_index];
+
+  // Continue with the next segment once a segment has no more statements
+  while (cursor.segmentIndex < stream.size() &&
+         cursor.statementIndex >=
+           stream[cursor.segmentIndex].statements.size())
+  {
+    ++cursor.segmentIndex;
+    cursor.statementIndex = 0;
+  }
+
+  if (cursor.segmentIndex >= stream.size())
   {
     // No more statements
     return false;
   }
   // Get next statement in list
-  const SqlStatement & query = this->statements->at(this->statementIndex);
+  const BatchPrivate::Segment &segment = stream[cursor.segmentIndex];
+  const SqlStatement &query = segment.statements[cursor.statementIndex];
 
   // Compile the statement
   std::unique_ptr<raii_sqlite3::Statement> nextStatement(
-      new raii_sqlite3::Statement(*(this->db), query.statement));
+      new raii_sqlite3::Statement(*(segment.db), query.statement));
   if (!*nextStatement)
   {
     LERR("Failed to prepare query: "<< sqlite3_errmsg(
-        this->db->Handle()) << "\n");
+        segment.db->Handle()) << "\n");
     return false;
   }
 
@@ -95,57 +109,141 @@ bool MsgIterPrivate::PrepareNextStatement()
     if (returnCode != SQLITE_OK)
     {
       LERR("Failed to query messages: "<< sqlite3_errmsg(
-        this->db->Handle()) << "\n");
+        segment.db->Handle()) << "\n");
       return false;
     }
     ++i;
   }
 
-  this->statement = std::move(nextStatement);
+  cursor.statement = std::move(nextStatement);
   return true;
 }
 
 //////////////////////////////////////////////////
 void MsgIterPrivate::StepStatement()
 {
-  if (this->statement)
+  auto later = [this](std::size_t _a, std::size_t _b)
+  {
+    return this->Later(_a, _b);
+  };
+
+  // The first call moves all the cursors to their first message, the next
+  // ones the cursor whose message was returned.
+  if (!this->started)
+  {
+    for (std::size_t i = 0; i < this->cursors.size(); ++i)
+    {
+      this->StepCursor(i);
+      if (this->cursors[i].statement)
+        this->heap.push_back(i);
+    }
+    std::make_heap(this->heap.begin(), this->heap.end(), later);
+    this->started = true;
+  }
+  else if (!this->heap.empty())
+  {
+    std::pop_heap(this->heap.begin(), this->heap.end(), later);
+    this->StepCursor(this->heap.back());
+    if (this->cursors[this->heap.back()].statement)
+      std::push_heap(this->heap.begin(), this->heap.end(), later);
+    else
+      this->heap.pop_back();
+  }
+
+  // Return the oldest message of the streams
+  this->statement = nullptr;
+  this->message = nullptr;
+  if (this->heap.empty())
+    return;
+
+  this->current = this->heap.front();
+  Cursor &cursor = this->cursors[this->current];
+  this->statement = cursor.statement.get();
+  this->message = cursor.message.get();
+}
+
+//////////////////////////////////////////////////
+bool MsgIterPrivate::Later(std::size_t _a, std::size_t _b) const
+{
+  // The streams that come first win the ties
+  const auto timeA = this->cursors[_a].message->TimeReceived();
+  const auto timeB = this->cursors[_b].message->TimeReceived();
+  return timeA > timeB || (timeA == timeB && _a > _b);
+}
+
+//////////////////////////////////////////////////
+void MsgIterPrivate::StepCursor(std::size_t _index)
+{
+  Cursor &cursor = this->cursors[_index];
+  const BatchPrivate::Stream &stream = (*this->streams)[_index];
+  while (cursor.statement)
   {
     // Get the results from the statement
-    int returnCode = sqlite3_step(this->statement->Handle());
+    int returnCode = sqlite3_step(cursor.statement->Handle());
 
     if (returnCode == SQLITE_ROW)
     {
       // TODO(anyone) get data and create message in the dereference operators
       // Assumes statement has column order:
       // messages id (0), timeRecv(1), topics name(2),
-      // message_type name(3), message data(4)
+      // message_type name(3), message data(4), and optionally topic id(5)
       std::chrono::nanoseconds timeRecv;
 
       // Time received
       sqlite_int64 timeRecvInt = sqlite3_column_int64(
-          this->statement->Handle(), 1);
+          cursor.statement->Handle(), 1);
       timeRecv = std::chrono::nanoseconds(timeRecvInt);
 
       // Topic name
       const unsigned char *topic = sqlite3_column_text(
-          this->statement->Handle(), 2);
+          cursor.statement->Handle(), 2);
       std::size_t numTopic = sqlite3_column_bytes(
-          this->statement->Handle(), 2);
+          cursor.statement->Handle(), 2);
 
       // Message type name
       const unsigned char *type = sqlite3_column_text(
-          this->statement->Handle(), 3);
-      std::size_t numType = sqlite3_column_bytes(this->statement->Handle(), 3);
+          cursor.statement->Handle(), 3);
+      std::size_t numType = sqlite3_column_bytes(
+          cursor.statement->Handle(), 3);
+
+      // Message data, NULL if the query left it out, see Log::QueryHeaders()
+      const void *data = sqlite3_column_blob(cursor.statement->Handle(), 4);
+      std::size_t numData = sqlite3_column_bytes(
+          cursor.statement->Handle(), 4);
+      const bool noData =
+        sqlite3_column_type(cursor.statement->Handle(), 4) == SQLITE_NULL;
 
-      // Message data
-      const void *data = sqlite3_column_blob(this->statement->Handle(), 4);
-      std::size_t numData = sqlite3_column_bytes(this->statement->Handle(), 4);
+      // The framed messages may be compressed
+      const bool framed = stream[cursor.segmentIndex].framed;
+      if (framed && !noData && !DecodeMessage(
+            data, numData, cursor.decompressed, data, numData))
+      {
+        sqlite_int64 id = sqlite3_column_int64(cursor.statement->Handle(), 0);
+        LERR("Failed to decode message [" << id << "], skipping it\n");
+        continue;
+      }
+
+      // The topic ids of a part or a shard are those of the queried log
+      int64_t topicId = -1;
+      if (sqlite3_column_count(cursor.statement->Handle()) > 5 &&
+          sqlite3_column_type(cursor.statement->Handle(), 5) != SQLITE_NULL)
+      {
+        topicId = sqlite3_column_int64(cursor.statement->Handle(), 5);
+        const auto &topicIds = stream[cursor.segmentIndex].topicIds;
+        if (!topicIds.empty())
+        {
+          const auto it = topicIds.find(topicId);
+          topicId = it != topicIds.end() ? it->second : -1;
+        }
+      }
 
-      this->message.reset(new Message(
+      cursor.message.reset(new Message(
             timeRecv,
             data, numData,
             reinterpret_cast<const char*>(type), numType,
-            reinterpret_cast<const char*>(topic), numTopic));
+            reinterpret_cast<const char*>(topic), numTopic,
+            topicId));
+      return;
     }
     else
     {
@@ -153,10 +251,10 @@ void MsgIterPrivate::StepStatement()
       {
         LERR("Failed to get message [" << returnCode << "]\n");
       }
-      // Out of data
-      this->statement.reset();
-      ++this->statementIndex;
-      this->PrepareNextStatement();
+      // Out of data, continue with the next statement
+      cursor.statement.reset();
+      ++cursor.statementIndex;
+      this->PrepareNextStatement(_index);
     }
   }
 }
@@ -225,7 +323,7 @@ bool MsgIter::operator==(const MsgIter &_other) const
 {
   // TODO(anyone) this won't work once this class has a proper copy constructor
   // It's only good enough to compare this with an empty iterator
-  return this->dataPtr->statement.get() == _other.dataPtr->statement.get();
+  return this->dataPtr->statement == _other.dataPtr->statement;
 }
 
 //////////////////////////////////////////////////
@@ -243,5 +341,5 @@ const Message &MsgIter::operator*() const
 //////////////////////////////////////////////////
 const Message *MsgIter::operator->() const
 {
-  return this->dataPtr->message.get();
+  return this->dataPtr->message;
 }
@@ -23,6 +23,7 @@
 
 #include "ignition/transport/log/Message.hh"
 #include "ignition/transport/log/SqlStatement.hh"
+#include "BatchPrivate.hh"
 #include "raii-sqlite3.hh"
 
 using namespace ignition::transport;
@@ -39,40 +40,81 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
 {
   class MsgIterPrivate
   {
+    /// \brief The position of the iterator in one of the streams of its
+    /// batch, see BatchPrivate::Stream.
+    public: struct Cursor
+    {
+      /// \brief which segment the cursor is on
+      std::size_t segmentIndex = 0;
+
+      /// \brief which statement of the segment the cursor is on
+      std::size_t statementIndex = 0;
+
+      /// \brief a statement that is being stepped
+      std::unique_ptr<raii_sqlite3::Statement> statement;
+
+      /// \brief the message this cursor is at
+      std::unique_ptr<Message> message;
+
+      /// \brief Memory of the message, if it was decompressed
+      std::vector<char> decompressed;
+    };
+
     /// \brief constructor
     public: MsgIterPrivate();
 
     /// \brief constructor
-    /// \param[in] _db Shared reference to a database
-    /// \param[in] _statements A set of SQL statements that this message will
-    /// iterate through
-    public: MsgIterPrivate(const std::shared_ptr<raii_sqlite3::Database> &_db,
-        const std::shared_ptr<std::vector<SqlStatement>> &_statements);
+    /// \param[in] _streams The databases and the SQL statements that this
+    /// message will iterate through
+    public: explicit MsgIterPrivate(
+        const std::shared_ptr<std::vector<BatchPrivate::Stream>> &_streams);
 
     /// \brief destructor
     public: ~MsgIterPrivate();
 
-    /// \brief Executes the statement once
+    /// \brief Moves to the next message, which is the oldest message of the
+    /// cursors.
     public: void StepStatement();
 
-    /// \brief Prepares the next statement to be executed
+    /// \brief Compare the messages of two cursors, for the heap of the
+    /// cursors.
+    /// \param[in] _a Index of a cursor
+    /// \param[in] _b Index of another cursor
+    /// \return true if the message of _a comes after the message of _b
+    public: bool Later(std::size_t _a, std::size_t _b) const;
+
+    /// \brief Executes the statement of a cursor once
+    /// \param[in] _index Index of the cursor
+    public: void StepCursor(std::size_t _index);
+
+    /// \brief Prepares the next statement to be executed by a cursor
+    /// \param[in] _index Index of the cursor
     /// \return true if the statement was sucessfully prepared
-    public: bool PrepareNextStatement();
+    public: bool PrepareNextStatement(std::size_t _index);
+
+    /// \brief the statement of the current message, or nullptr if there are
+    /// no more messages
+    public: raii_sqlite3::Statement *statement = nullptr;
+
+    /// \brief databases and statements used to get messages
+    public: std::shared_ptr<std::vector<BatchPrivate::Stream>> streams;
 
-    /// \brief a statement that is being stepped
-    public: std::unique_ptr<raii_sqlite3::Statement> statement;
+    /// \brief One cursor per stream
+    public: std::vector<Cursor> cursors;
 
-    /// \brief which statement is the msg iterator iterating on
-    public: std::size_t statementIndex = 0;
+    /// \brief Index of the cursor of the current message
+    public: std::size_t current = 0;
 
-    /// \brief The database this iterator is getting its data from
-    public: std::shared_ptr<raii_sqlite3::Database> db;
+    /// \brief Indexes of the cursors that have a message, in a heap whose
+    /// front is the cursor of the oldest message, so the streams are merged
+    /// in logarithmic time, see Later()
+    public: std::vector<std::size_t> heap;
 
-    /// \brief statements used to get messages from the database
-    public: std::shared_ptr<std::vector<SqlStatement>> statements;
+    /// \brief True once the cursors are at their first message
+    public: bool started = false;
 
     /// \brief the message this iterator is at
-    public: std::unique_ptr<Message> message;
+    public: Message *message = nullptr;
   };
 }
 }
@@ -17,17 +17,28 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include <ignition/transport/Clock.hh>
+#include <ignition/transport/MessageInfo.hh>
 #include <ignition/transport/Node.hh>
+#include <ignition/transport/NodeShared.hh>
+#include <ignition/transport/TopicUtils.hh>
 #include <ignition/transport/log/Log.hh>
 #include <ignition/transport/log/Playback.hh>
 #include "Console.hh"
@@ -43,28 +54,73 @@ using namespace ignition::transport::log;
 // See: https://www.sqlite.org/threadsafe.html
 static const bool kSqlite3Threadsafe = (sqlite3_threadsafe() != 0);
 
+/// \brief Maximum number of messages read ahead of the playback
+static const std::size_t kPrefetchMessages = 1000;
+
+/// \brief Maximum size of the messages read ahead of the playback. A bigger
+/// message is still read once the queue is empty.
+static const std::size_t kPrefetchBytes = 64 << 20;
+
+/// \brief Slowest playback rate
+static const double kMinRate = 0.1;
+
+/// \brief How often a playback driven by a Clock checks the time, unless
+/// it's woken up by PlaybackHandle::NotifyClock()
+static const std::chrono::milliseconds kClockPollPeriod(1);
+
+/// \brief Fastest playback rate
+static const double kMaxRate = 100.0;
+
+//////////////////////////////////////////////////
+/// \brief Clamp a playback rate to the supported range.
+/// \param[in] _rate The requested rate
+/// \return The rate to use
+static double clampRate(const double _rate)
+{
+  // NaN goes to the slowest rate
+  if (!(_rate >= kMinRate))
+    return kMinRate;
+  return _rate > kMaxRate ? kMaxRate : _rate;
+}
+
 //////////////////////////////////////////////////
 /// \brief Private implementation of Playback
 class ignition::transport::log::Playback::Implementation
 {
   /// \brief Constructor. Creates and initializes the log file
-  /// \param[in] _file The full path of the file to open
+  /// \param[in] _files The full paths of the parts of the file to open
+  /// \param[in] _logOptions Settings of the log file
+  /// \param[in] _nodeOptions Options of the node that publishes
   public: Implementation(
-    const std::string &_file, const NodeOptions &_nodeOptions)
+    const std::vector<std::string> &_files, const LogOptions &_logOptions,
+    const NodeOptions &_nodeOptions)
     : logFile(std::make_shared<Log>()),
       addTopicWasUsed(false),
       nodeOptions(_nodeOptions)
   {
-    if (!this->logFile->Open(_file, std::ios_base::in))
+    const std::string file = _files.empty() ? "" : _files.front();
+    if (!this->logFile->Open(_files, _logOptions))
     {
-      LERR("Could not open file [" << _file << "]\n");
+      LERR("Could not open file [" << file << "]\n");
     }
     else
     {
-      LDBG("Playback opened file [" << _file << "]\n");
+      LDBG("Playback opened file [" << file << "] in " << _files.size()
+           << " part(s)\n");
     }
   }
 
+  /// \brief Constructor of a playback of a log that's already open
+  /// \param[in] _logFile The log file
+  /// \param[in] _nodeOptions Options of the node that publishes
+  public: Implementation(const std::shared_ptr<Log> &_logFile,
+    const NodeOptions &_nodeOptions)
+    : logFile(_logFile),
+      addTopicWasUsed(false),
+      nodeOptions(_nodeOptions)
+  {
+  }
+
   /// \brief This gets used by RemoveTopic(~) to make sure we follow the correct
   /// behavior.
   void DefaultToAllTopics()
@@ -81,6 +137,23 @@ class ignition::transport::log::Playback::Implementation
     }
   }
 
+  /// \brief Get the topics to play back.
+  /// \return The topics added, or all the topics of the log if neither
+  /// AddTopic() nor RemoveTopic() were called
+  public: std::unordered_set<std::string> SelectedTopics() const
+  {
+    if (this->addTopicWasUsed)
+      return this->topicNames;
+
+    LDBG("No topics added, defaulting to all topics\n");
+    std::unordered_set<std::string> topics;
+    const Descriptor *desc = this->logFile->Descriptor();
+    const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
+    for (const auto &entry : allTopics)
+      topics.insert(entry.first);
+    return topics;
+  }
+
   /// \brief log file to play from
   public: std::shared_ptr<Log> logFile;
 
@@ -97,12 +170,52 @@ class ignition::transport::log::Playback::Implementation
 
   /// \brief The node options.
   public: NodeOptions nodeOptions;
+
+  /// \brief Rate of the playbacks, see Playback::SetRate().
+  public: double rate = 1.0;
+
+  /// \brief Backpressure depth of the playbacks, see
+  /// Playback::SetBackpressure().
+  public: std::size_t backpressure = 0;
 };
 
 //////////////////////////////////////////////////
 /// \brief Private implementation of PlaybackHandle
 class PlaybackHandle::Implementation
 {
+  /// \brief A message read ahead of its publication
+  public: struct Prefetched
+  {
+    /// \brief Publisher of the topic and type of the message, or nullptr
+    /// if there is none
+    ignition::transport::Node::Publisher *publisher = nullptr;
+
+    /// \brief The serialized message, unless it's shared
+    std::string data;
+
+    /// \brief The serialized message read by a SharedReader, shared with
+    /// the other playbacks of the reader
+    std::shared_ptr<const std::string> shared;
+
+    /// \brief Name of the message type, the key of the publisher in
+    /// publishers, or nullptr if there is no publisher
+    const std::string *type = nullptr;
+
+    /// \brief Time when the message was received
+    std::chrono::nanoseconds time{0};
+
+    /// \brief Get the serialized message.
+    /// \return The message, shared or not
+    const std::string &Data() const
+    {
+      return this->shared ? *this->shared : this->data;
+    }
+  };
+
+  /// \brief Reader of a log shared by several playbacks, see
+  /// Playback::StartShared()
+  public: class SharedReader;
+
   /// \brief Constructor
   /// \param[in] _logFile A reference to the Log instance
   /// \param[in] _topics A set of all topics to publish
@@ -111,12 +224,24 @@ class PlaybackHandle::Implementation
   /// \param[in] _msgWaiting True to wait between publication of
   /// messages based on the message timestamps. False to playback
   /// messages as fast as possible. Default value is true.
+  /// \param[in] _rate Playback rate, see PlaybackHandle::SetRate()
+  /// \param[in] _backpressure Local queue depth of the publishers, see
+  /// Playback::SetBackpressure()
+  /// \param[in] _clock Clock that drives the playback, or nullptr for the
+  /// steady clock
+  /// \param[in] _reader Reader that hands the messages over to this
+  /// playback, or nullptr to read the log in its own thread. A playback
+  /// with a reader doesn't wait after advertising and doesn't start.
   public: Implementation(
       const std::shared_ptr<Log> &_logFile,
       const std::unordered_set<std::string> &_topics,
       const std::chrono::nanoseconds &_waitAfterAdvertising,
       const NodeOptions &_nodeOptions,
-      bool _msgWaiting);
+      bool _msgWaiting,
+      const double _rate,
+      const std::size_t _backpressure,
+      const Clock *_clock,
+      const std::shared_ptr<SharedReader> &_reader = nullptr);
 
   /// \brief Look through the types of data that _topic can publish and create
   /// a publisher for each type.
@@ -130,6 +255,15 @@ class PlaybackHandle::Implementation
       const std::string &_topic,
       const std::string &_type);
 
+  /// \brief Find the publisher of a message.
+  /// \param[in] _msg The message
+  /// \param[out] _message Its publisher and type are set, or left null if
+  /// the message isn't played back
+  /// \param[in,out] _topic Key reused to look up the messages without id
+  /// \param[in,out] _type Key reused to look up the messages without id
+  public: void FindPublisher(const Message &_msg, Prefetched &_message,
+      std::string &_topic, std::string &_type);
+
   /// \brief Begin playing messages in another thread
   public: void StartPlayback();
 
@@ -152,6 +286,15 @@ class PlaybackHandle::Implementation
   /// stop event interrupt it
   public: bool WaitUntil(const std::chrono::nanoseconds &_targetTime);
 
+  /// \brief Get the time of the realtime frame.
+  /// \return The time of the clock of the playback, or of the steady clock
+  public: std::chrono::nanoseconds Now() const;
+
+  /// \brief Wait until the clock of the playback is ready, see
+  /// Clock::IsReady().
+  /// \return False if the playback stopped meanwhile
+  public: bool WaitForClock();
+
   /// \brief Pauses the playback
   public: void Pause();
 
@@ -161,9 +304,39 @@ class PlaybackHandle::Implementation
   /// \brief Check pause status
   public: bool IsPaused() const;
 
+  /// \brief Change the playback rate
+  /// \param[in] _rate Playback rate
+  public: void SetRate(const double _rate);
+
+  /// \brief Convert a duration of the log to real time.
+  /// \param[in] _duration Duration in the playback frame
+  /// \return Duration in the realtime frame
+  public: std::chrono::nanoseconds ToRealTime(
+      const std::chrono::nanoseconds &_duration) const;
+
   /// \brief Wait until playback has finished playing
   public: void WaitUntilFinished();
 
+  /// \brief Worker thread function that reads the messages of the batch
+  /// ahead of the playback, so the playback thread doesn't wait for the disk
+  public: void PrefetchThread();
+
+  /// \brief Stop the prefetch thread
+  public: void StopPrefetch();
+
+  /// \brief Wait until the next message has been read.
+  /// \param[out] _time Time when the next message was received
+  /// \param[out] _generation Batch of the message, see prefetchGeneration
+  /// \return False if there are no more messages or the playback stopped
+  public: bool WaitForMessage(std::chrono::nanoseconds &_time,
+                              uint64_t &_generation);
+
+  /// \brief Take the next message, which was returned by WaitForMessage().
+  /// \param[in] _generation Batch of the message, from WaitForMessage()
+  /// \param[out] _message The message
+  /// \return False if a seek replaced the batch in the meantime
+  public: bool PopMessage(const uint64_t _generation, Prefetched &_message);
+
   /// \brief node used to create publishers
   /// \note This member needs to come before the publishers member so that they
   /// get destructed in the correct order
@@ -175,6 +348,12 @@ class PlaybackHandle::Implementation
           std::unordered_map<std::string,
             ignition::transport::Node::Publisher>> publishers;
 
+  /// \brief Publishers and their message types, by topic id, see
+  /// Message::TopicId(). Resolved once, so the messages don't look up their
+  /// publisher by name. Null for the ids that aren't played back.
+  public: std::vector<std::pair<ignition::transport::Node::Publisher *,
+          const std::string *>> publishersById;
+
   /// \brief a mutex to use when waiting for playback to finish
   public: std::mutex waitMutex;
 
@@ -239,9 +418,44 @@ class PlaybackHandle::Implementation
   // \brief Mutex to operate the batch variable in a thread-safe way
   public: std::mutex batchMutex;
 
-  // \brief Iterator to loop over the messages found in batch
+  // \brief Iterator to loop over the messages found in batch. Only used by
+  // the prefetch thread, and by Seek with batchMutex locked.
   public: Batch::iterator messageIter;
 
+  /// \brief Messages read from the batch, waiting to be published.
+  /// Protected by prefetchMutex.
+  public: std::deque<Prefetched> prefetched;
+
+  /// \brief Size of the messages in prefetched. Protected by prefetchMutex.
+  public: std::size_t prefetchedBytes = 0;
+
+  /// \brief True once the last message of the batch has been read.
+  /// Protected by prefetchMutex.
+  public: bool prefetchDone = false;
+
+  /// \brief True if the prefetch thread should be stopped. Protected by
+  /// prefetchMutex.
+  public: bool prefetchStop = false;
+
+  /// \brief Incremented when a seek replaces the batch, so a message of the
+  /// previous batch isn't published. Protected by prefetchMutex.
+  public: uint64_t prefetchGeneration = 0;
+
+  /// \brief Mutex of the queue of prefetched messages. When both are
+  /// locked, batchMutex is locked first.
+  public: std::mutex prefetchMutex;
+
+  /// \brief Condition variable to wake up the prefetch thread when there
+  /// is room in the queue
+  public: std::condition_variable prefetchSpace;
+
+  /// \brief Condition variable to wake up the playback thread when a
+  /// message has been read
+  public: std::condition_variable prefetchReady;
+
+  /// \brief thread reading the messages ahead of the playback
+  public: std::thread prefetchThread;
+
   // \brief The wall clock time of the first message in batch
   public: const std::chrono::nanoseconds firstMessageTime;
 
@@ -249,11 +463,250 @@ class PlaybackHandle::Implementation
   /// messages based on the message timestamps. False to playback
   /// messages as fast as possible.
   public: bool msgWaiting = true;
+
+  /// \brief Playback rate, the speed of the playback frame relative to the
+  /// realtime frame
+  public: std::atomic<double> rate{1.0};
+
+  /// \brief Set when the rate changes, so the playback thread stops waiting
+  /// for a time computed with the previous rate
+  public: std::atomic_bool rateChanged{false};
+
+  /// \brief Local queue depth of the publishers, 0 to drop messages instead
+  /// of waiting for the subscribers
+  public: std::size_t backpressure = 0;
+
+  /// \brief Clock of the realtime frame, or nullptr for the steady clock
+  public: const Clock *clock = nullptr;
+
+  /// \brief Reader shared with other playbacks, or nullptr. The playback
+  /// stays attached to it until it seeks or stops.
+  public: std::shared_ptr<SharedReader> reader;
+};
+
+//////////////////////////////////////////////////
+/// \brief Reader of a log shared by several playbacks, e.g. of different
+/// topics or into different partitions. It reads each message once, for
+/// the topics of all the playbacks, and hands it over to the queue of
+/// prefetched messages of every playback of its topic, without copying it
+/// again. It reads ahead as long as all the queues have room, so the
+/// slowest playback paces the others, until it seeks or stops.
+class PlaybackHandle::Implementation::SharedReader
+{
+  /// \brief Constructor. Queries the messages.
+  /// \param[in] _logFile The log file
+  /// \param[in] _topics The topics of all the playbacks
+  public: SharedReader(const std::shared_ptr<Log> &_logFile,
+      const std::unordered_set<std::string> &_topics)
+    : batch(_logFile->QueryMessages(TopicList::Create(_topics))),
+      messageIter(batch.begin()),
+      firstMessageTime(messageIter != batch.end() ?
+          messageIter->TimeReceived() : _logFile->StartTime())
+  {
+  }
+
+  /// \brief Destructor. Stops the reader thread.
+  public: ~SharedReader()
+  {
+    {
+      std::lock_guard<std::mutex> lk(this->mutex);
+      this->stop = true;
+    }
+    this->space.notify_all();
+    if (this->thread.joinable())
+      this->thread.join();
+  }
+
+  /// \brief Add a playback, before Start().
+  /// \param[in] _handle The playback
+  public: void Attach(Implementation *_handle)
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    this->handles.push_back(_handle);
+  }
+
+  /// \brief Remove a playback. The reader doesn't touch it once this
+  /// returns.
+  /// \param[in] _handle The playback
+  public: void Detach(Implementation *_handle)
+  {
+    {
+      std::lock_guard<std::mutex> lk(this->mutex);
+      this->handles.erase(
+          std::remove(this->handles.begin(), this->handles.end(), _handle),
+          this->handles.end());
+    }
+    this->space.notify_all();
+  }
+
+  /// \brief Start reading in another thread.
+  public: void Start()
+  {
+    this->thread = std::thread(&SharedReader::Run, this);
+  }
+
+  /// \brief Wake up the reader after a playback took a message.
+  public: void NotifySpace()
+  {
+    // Taking the mutex orders the notification after the check of the
+    // queues by the reader
+    {
+      std::lock_guard<std::mutex> lk(this->mutex);
+    }
+    this->space.notify_one();
+  }
+
+  /// \brief Get the time of the first message, the origin of the seeks
+  /// of all the playbacks.
+  /// \return The time of the first message of all the topics
+  public: std::chrono::nanoseconds FirstMessageTime() const
+  {
+    return this->firstMessageTime;
+  }
+
+  /// \brief Check if every queue has room for a message. mutex must be
+  /// locked.
+  /// \return True if the next message can be read
+  private: bool HasSpace() const
+  {
+    for (Implementation *handle : this->handles)
+    {
+      std::lock_guard<std::mutex> lk(handle->prefetchMutex);
+      // An oversized message is read once the queue is empty
+      if (!handle->prefetched.empty() &&
+          (handle->prefetched.size() >= kPrefetchMessages ||
+           handle->prefetchedBytes >= kPrefetchBytes))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// \brief Body of the reader thread.
+  private: void Run()
+  {
+    std::string topic;
+    std::string type;
+    while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lk(this->mutex);
+        this->space.wait(lk, [this]
+          {
+            return this->stop || this->handles.empty() || this->HasSpace();
+          });
+        if (this->stop || this->handles.empty())
+          return;
+      }
+
+      // The log is read without the lock, so the playbacks aren't blocked
+      // while they take their messages
+      std::shared_ptr<const std::string> data;
+      std::chrono::nanoseconds time{0};
+      const bool done = this->messageIter == this->batch.end();
+      if (!done)
+      {
+        const std::string_view view = this->messageIter->DataView();
+        data = std::make_shared<const std::string>(view.data(), view.size());
+        time = this->messageIter->TimeReceived();
+      }
+
+      std::lock_guard<std::mutex> lk(this->mutex);
+      for (Implementation *handle : this->handles)
+      {
+        Prefetched message;
+        if (!done)
+        {
+          handle->FindPublisher(*this->messageIter, message, topic, type);
+          if (!message.publisher)
+            continue;
+          message.time = time;
+          message.shared = data;
+        }
+
+        {
+          std::lock_guard<std::mutex> prefetchLk(handle->prefetchMutex);
+          if (done)
+          {
+            handle->prefetchDone = true;
+          }
+          else
+          {
+            handle->prefetchedBytes += data->size();
+            handle->prefetched.push_back(std::move(message));
+          }
+        }
+        handle->prefetchReady.notify_one();
+      }
+      if (done)
+        return;
+      ++this->messageIter;
+    }
+  }
+
+  /// \brief Messages of all the topics. Only used by the reader thread.
+  private: Batch batch;
+
+  /// \brief Next message to read. Only used by the reader thread.
+  private: Batch::iterator messageIter;
+
+  /// \brief Time of the first message
+  private: const std::chrono::nanoseconds firstMessageTime;
+
+  /// \brief The playbacks attached. Protected by mutex.
+  private: std::vector<Implementation *> handles;
+
+  /// \brief True to stop the reader thread. Protected by mutex.
+  private: bool stop = false;
+
+  /// \brief Mutex of the playbacks. When both are locked, it is locked
+  /// before the prefetchMutex of a playback.
+  private: std::mutex mutex;
+
+  /// \brief Condition variable to wake up the reader when there may be
+  /// room in the queues
+  private: std::condition_variable space;
+
+  /// \brief The reader thread
+  private: std::thread thread;
 };
 
 //////////////////////////////////////////////////
 Playback::Playback(const std::string &_file, const NodeOptions &_nodeOptions)
-  : dataPtr(new Implementation(_file, _nodeOptions))
+  : dataPtr(new Implementation({_file}, LogOptions(), _nodeOptions))
+{
+  // Do nothing
+}
+
+//////////////////////////////////////////////////
+Playback::Playback(const std::vector<std::string> &_files,
+    const NodeOptions &_nodeOptions)
+  : dataPtr(new Implementation(_files, LogOptions(), _nodeOptions))
+{
+  // Do nothing
+}
+
+//////////////////////////////////////////////////
+Playback::Playback(const std::vector<std::string> &_files,
+    const LogOptions &_logOptions, const NodeOptions &_nodeOptions)
+  : dataPtr(new Implementation(_files, _logOptions, _nodeOptions))
+{
+  // Do nothing
+}
+
+//////////////////////////////////////////////////
+Playback::Playback(const std::shared_ptr<Log> &_log,
+    const NodeOptions &_nodeOptions)
+  : dataPtr(new Implementation(_log ? _log : std::make_shared<Log>(),
+      _nodeOptions))
+{
+  // Do nothing
+}
+
+//////////////////////////////////////////////////
+Playback::Playback(const Playback &_other, const NodeOptions &_nodeOptions)
+  : dataPtr(new Implementation(_other.dataPtr->logFile, _nodeOptions))
 {
   // Do nothing
 }
@@ -275,6 +728,14 @@ Playback::~Playback()
 PlaybackHandlePtr Playback::Start(
     const std::chrono::nanoseconds &_waitAfterAdvertising,
     bool _msgWaiting) const
+{
+  return this->Start(nullptr, _waitAfterAdvertising, _msgWaiting);
+}
+
+//////////////////////////////////////////////////
+PlaybackHandlePtr Playback::Start(const Clock *_clock,
+    const std::chrono::nanoseconds &_waitAfterAdvertising,
+    bool _msgWaiting) const
 {
   if (!this->dataPtr->logFile->Valid())
   {
@@ -295,25 +756,15 @@ PlaybackHandlePtr Playback::Start(
     }
   }
 
-  std::unordered_set<std::string> topics;
-  if (!this->dataPtr->addTopicWasUsed)
-  {
-    LDBG("No topics added, defaulting to all topics\n");
-    const Descriptor *desc = this->dataPtr->logFile->Descriptor();
-    const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
-    for (const auto &entry : allTopics)
-      topics.insert(entry.first);
-  }
-  else
-  {
-    topics = this->dataPtr->topicNames;
-  }
+  const std::unordered_set<std::string> topics =
+    this->dataPtr->SelectedTopics();
 
   PlaybackHandlePtr newHandle(
         new PlaybackHandle(
           std::make_unique<PlaybackHandle::Implementation>(
             this->dataPtr->logFile, topics, _waitAfterAdvertising,
-            this->dataPtr->nodeOptions, _msgWaiting)));
+            this->dataPtr->nodeOptions, _msgWaiting, this->dataPtr->rate,
+            this->dataPtr->backpressure, _clock)));
 
   // We only need to store this if sqlite3 was not compiled in threadsafe mode.
   if (!kSqlite3Threadsafe)
@@ -322,6 +773,131 @@ PlaybackHandlePtr Playback::Start(
   return newHandle;
 }
 
+//////////////////////////////////////////////////
+std::vector<PlaybackHandlePtr> Playback::StartShared(
+    const std::vector<const Playback *> &_playbacks,
+    const std::chrono::nanoseconds &_waitAfterAdvertising,
+    bool _msgWaiting)
+{
+  std::vector<PlaybackHandlePtr> handles;
+  if (_playbacks.empty() || !_playbacks.front())
+    return handles;
+
+  const std::shared_ptr<Log> &logFile = _playbacks.front()->dataPtr->logFile;
+  if (!logFile->Valid())
+  {
+    LERR("Could not start: Failed to open log file\n");
+    return handles;
+  }
+
+  std::vector<std::unordered_set<std::string>> topics;
+  std::unordered_set<std::string> allTopics;
+  for (const Playback *playback : _playbacks)
+  {
+    if (!playback || playback->dataPtr->logFile != logFile)
+    {
+      LERR("Could not start: The playbacks don't share their log file\n");
+      return handles;
+    }
+    topics.push_back(playback->dataPtr->SelectedTopics());
+    allTopics.insert(topics.back().begin(), topics.back().end());
+  }
+
+  auto reader = std::make_shared<PlaybackHandle::Implementation::SharedReader>(
+      logFile, allTopics);
+  for (std::size_t i = 0; i < _playbacks.size(); ++i)
+  {
+    const Playback::Implementation &playback = *_playbacks[i]->dataPtr;
+    handles.emplace_back(
+        new PlaybackHandle(
+          std::make_unique<PlaybackHandle::Implementation>(
+            logFile, topics[i], _waitAfterAdvertising, playback.nodeOptions,
+            _msgWaiting, playback.rate, playback.backpressure, nullptr,
+            reader)));
+  }
+
+  std::this_thread::sleep_for(_waitAfterAdvertising);
+
+  for (const PlaybackHandlePtr &handle : handles)
+    handle->dataPtr->StartPlayback();
+  reader->Start();
+  return handles;
+}
+
+//////////////////////////////////////////////////
+int64_t Playback::PlayOffline() const
+{
+  if (!this->dataPtr->logFile->Valid())
+  {
+    LERR("Could not play: Failed to open log file\n");
+    return -1;
+  }
+
+  // The subscribers of a topic, and the info of its messages of each type,
+  // by topic id
+  struct Target
+  {
+    public: MessageInfo info;
+    public: std::shared_ptr<const NodeShared::HandlerInfo> handlers;
+  };
+  std::vector<Target> targets;
+
+  NodeShared *shared = NodeShared::Instance();
+  const NodeOptions &options = this->dataPtr->nodeOptions;
+  const std::unordered_set<std::string> topics =
+    this->dataPtr->SelectedTopics();
+  const Descriptor *desc = this->dataPtr->logFile->Descriptor();
+  const Descriptor::NameToMap &allTopics = desc->TopicsToMsgTypesToId();
+  for (const std::string &topic : topics)
+  {
+    std::string fullyQualifiedTopic;
+    if (!TopicUtils::FullyQualifiedName(options.Partition(),
+          options.NameSpace(), topic, fullyQualifiedTopic))
+    {
+      LERR("Topic [" << topic << "] is not valid\n");
+      continue;
+    }
+
+    auto handlers = std::make_shared<const NodeShared::HandlerInfo>(
+        shared->CheckHandlerInfo(fullyQualifiedTopic));
+    if (!handlers->haveLocal && !handlers->haveRaw)
+      continue;
+
+    for (const auto &type : allTopics.at(topic))
+    {
+      const int64_t id = type.second;
+      if (id < 0)
+        continue;
+      if (static_cast<std::size_t>(id) >= targets.size())
+        targets.resize(id + 1);
+      targets[id].info.SetTopicAndPartition(fullyQualifiedTopic);
+      targets[id].info.SetType(type.first);
+      targets[id].info.SetIntraProcess(true);
+      targets[id].handlers = handlers;
+    }
+  }
+
+  // The callbacks run in this thread, one message after the other
+  int64_t count = 0;
+  Batch batch = this->dataPtr->logFile->QueryMessages(
+      TopicList::Create(topics));
+  for (const Message &msg : batch)
+  {
+    const int64_t id = msg.TopicId();
+    if (id < 0 || static_cast<std::size_t>(id) >= targets.size() ||
+        !targets[id].handlers)
+    {
+      continue;
+    }
+
+    const std::string_view data = msg.DataView();
+    shared->TriggerCallbacks(targets[id].info, data.data(), data.size(),
+        *targets[id].handlers);
+    ++count;
+  }
+  return count;
+}
+
 //////////////////////////////////////////////////
 bool Playback::Valid() const
 {
@@ -420,22 +996,56 @@ int64_t Playback::RemoveTopic(const std::regex &_topic)
   return count;
 }
 
+//////////////////////////////////////////////////
+void Playback::SetRate(const double _rate)
+{
+  this->dataPtr->rate = clampRate(_rate);
+}
+
+//////////////////////////////////////////////////
+double Playback::Rate() const
+{
+  return this->dataPtr->rate;
+}
+
+//////////////////////////////////////////////////
+void Playback::SetBackpressure(const std::size_t _depth)
+{
+  this->dataPtr->backpressure = _depth;
+}
+
+//////////////////////////////////////////////////
+std::size_t Playback::Backpressure() const
+{
+  return this->dataPtr->backpressure;
+}
+
 //////////////////////////////////////////////////
 PlaybackHandle::Implementation::Implementation(
     const std::shared_ptr<Log> &_logFile,
     const std::unordered_set<std::string> &_topics,
     const std::chrono::nanoseconds &_waitAfterAdvertising,
     const NodeOptions &_nodeOptions,
-    bool _msgWaiting)
+    bool _msgWaiting,
+    const double _rate,
+    const std::size_t _backpressure,
+    const Clock *_clock,
+    const std::shared_ptr<SharedReader> &_reader)
   : stop(true),
     finished(false),
     paused(false),
     logFile(_logFile),
     trackedTopics(_topics),
-    batch(logFile->QueryMessages(TopicList::Create(_topics))),
+    batch(_reader ? Batch() :
+        logFile->QueryMessages(TopicList::Create(_topics))),
     messageIter(batch.begin()),
-    firstMessageTime(messageIter->TimeReceived()),
-    msgWaiting(_msgWaiting)
+    firstMessageTime(_reader ? _reader->FirstMessageTime() :
+        messageIter != batch.end() ?
+        messageIter->TimeReceived() : logFile->StartTime()),
+    msgWaiting(_msgWaiting),
+    rate(clampRate(_rate)),
+    backpressure(_backpressure),
+    clock(_clock)
 {
   this->node.reset(new transport::Node(_nodeOptions));
 
@@ -444,9 +1054,31 @@ PlaybackHandle::Implementation::Implementation(
     this->AddTopic(topic);
   }
 
+  const Descriptor *desc = this->logFile->Descriptor();
+  for (auto &topic : this->publishers)
+  {
+    for (auto &type : topic.second)
+    {
+      const int64_t id = desc->TopicId(topic.first, type.first);
+      if (id < 0)
+        continue;
+      if (static_cast<std::size_t>(id) >= this->publishersById.size())
+        this->publishersById.resize(id + 1, {nullptr, nullptr});
+      this->publishersById[id] = {&type.second, &type.first};
+    }
+  }
+
+  // The playbacks of a shared reader are started together
+  if (_reader)
+  {
+    this->reader = _reader;
+    this->reader->Attach(this);
+    return;
+  }
+
   std::this_thread::sleep_for(_waitAfterAdvertising);
 
-  if (this->batch.begin() == this->batch.end())
+  if (this->messageIter == this->batch.end())
   {
     LWRN("There are no messages to play\n");
   }
@@ -492,8 +1124,15 @@ void PlaybackHandle::Implementation::CreatePublisher(
     return;
   }
 
-  // Create a publisher for the topic and type combo
-  firstMapIter->second[_type] = this->node->Advertise(_topic, _type);
+  // Create a publisher for the topic and type combo. With backpressure, a
+  // publication waits for the local subscribers to catch up.
+  AdvertiseMessageOptions options;
+  if (this->backpressure > 0)
+  {
+    options.SetLocalQueueDepth(this->backpressure);
+    options.SetOverflowPolicy(QueueOverflowPolicy_t::BLOCK);
+  }
+  firstMapIter->second[_type] = this->node->Advertise(_topic, _type, options);
   LDBG("Creating publisher for " << _topic << " " << _type << "\n");
 }
 
@@ -522,13 +1161,28 @@ void PlaybackHandle::Implementation::StartPlayback()
   this->playbackTime = this->playbackStartTime;
   this->playbackEndTime = this->logFile->EndTime();
 
-  this->nextMessageTime = this->messageIter->TimeReceived();
+  this->nextMessageTime = this->firstMessageTime;
+
+  this->lastEventTime = this->Now();
 
-  this->lastEventTime = std::chrono::steady_clock::now().time_since_epoch();
+  // Reading the log file is left to another thread, so the disk latency
+  // doesn't delay the publication of the messages. The shared reader has
+  // its own.
+  if (!this->reader)
+  {
+    this->prefetchThread =
+      std::thread(&PlaybackHandle::Implementation::PrefetchThread, this);
+  }
 
   this->playbackThread = std::thread([this] () mutable
     {
-      while (!this->stop && (this->messageIter != this->batch.end())) {
+      // The log starts when the clock does
+      if (this->WaitForClock())
+        this->lastEventTime = this->Now();
+
+      uint64_t generation = 0;
+      while (!this->stop &&
+             this->WaitForMessage(this->nextMessageTime, generation)) {
         // Lock if paused
         if (this->paused)
         {
@@ -536,8 +1190,7 @@ void PlaybackHandle::Implementation::StartPlayback()
           // If paused, the thread will be blocked here
           this->pauseConditionVariable.wait(lk,
             [this]{return !this->paused.load();});
-          this->lastEventTime =
-              std::chrono::steady_clock::now().time_since_epoch();
+          this->lastEventTime = this->Now();
           // Abort current iteration after coming back from pause
           continue;
         }
@@ -545,31 +1198,30 @@ void PlaybackHandle::Implementation::StartPlayback()
         if (this->nextMessageTime <= this->boundaryTime)
         {
           // The timeDelta becomes the time remaining until next message
+          this->rateChanged = false;
           const std::chrono::nanoseconds timeDelta(
               this->nextMessageTime - this->playbackTime);
           const std::chrono::nanoseconds timeToWaitUntil(
-              this->lastEventTime + timeDelta);
+              this->lastEventTime + this->ToRealTime(timeDelta));
           // Wait until target time is reached or playback is stopped/paused
-          // In the latter case, break the iteration step
-          if (this->msgWaiting && !this->WaitUntil(timeToWaitUntil))
+          // In the latter case, break the iteration step. A new rate needs a
+          // new target time.
+          if (this->msgWaiting &&
+              (!this->WaitUntil(timeToWaitUntil) || this->rateChanged))
           {
             continue;
           }
-          // Publish the message
+          // Publish the message, unless a seek replaced it meanwhile
+          Prefetched message;
+          if (!this->PopMessage(generation, message))
           {
-          std::unique_lock<std::mutex> lk(this->batchMutex);
+            continue;
+          }
           LDBG("publishing\n");
-          this->publishers[
-            this->messageIter->Topic()][
-              this->messageIter->Type()].PublishRaw(
-                this->messageIter->Data(), this->messageIter->Type());
-          // Advance iterator to next message
-          ++this->messageIter;
+          if (message.publisher)
+            message.publisher->PublishRaw(message.Data(), *message.type);
           this->playbackTime = this->nextMessageTime;
-          this->lastEventTime =
-              std::chrono::steady_clock::now().time_since_epoch();
-          this->nextMessageTime = messageIter->TimeReceived();
-          }
+          this->lastEventTime = this->Now();
         }
         // If a custom step has been requested, always from a paused state,
         // playback gets resumed until the step requested is completed,
@@ -577,14 +1229,15 @@ void PlaybackHandle::Implementation::StartPlayback()
         else
         {
           // The timeDelta is equal to the step size passed to the step function
+          this->rateChanged = false;
           const std::chrono::nanoseconds timeDelta(
               this->boundaryTime - this->playbackTime);
           // Target time in the realtime frame
           const std::chrono::nanoseconds timeToWaitUntil(
-              this->lastEventTime + timeDelta);
+              this->lastEventTime + this->ToRealTime(timeDelta));
           // Wait until target time is reached or playback is stopped/paused
           // In the latter case, break the iteration step
-          if (!this->WaitUntil(timeToWaitUntil))
+          if (!this->WaitUntil(timeToWaitUntil) || this->rateChanged)
           {
             continue;
           }
@@ -596,19 +1249,154 @@ void PlaybackHandle::Implementation::StartPlayback()
   });
 }
 
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::FindPublisher(const Message &_msg,
+    Prefetched &_message, std::string &_topic, std::string &_type)
+{
+  const int64_t id = _msg.TopicId();
+  if (id >= 0 && static_cast<std::size_t>(id) < this->publishersById.size())
+  {
+    _message.publisher = this->publishersById[id].first;
+    _message.type = this->publishersById[id].second;
+  }
+  else if (id < 0)
+  {
+    // A message without id is looked up by name
+    _topic.assign(_msg.TopicView());
+    _type.assign(_msg.TypeView());
+    auto topicIt = this->publishers.find(_topic);
+    if (topicIt != this->publishers.end())
+    {
+      auto typeIt = topicIt->second.find(_type);
+      if (typeIt != topicIt->second.end())
+      {
+        _message.publisher = &typeIt->second;
+        _message.type = &typeIt->first;
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::PrefetchThread()
+{
+  // Keys to look up the publisher of a message, reused so finding it
+  // doesn't allocate
+  std::string topic;
+  std::string type;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lk(this->prefetchMutex);
+      // An oversized message is read once the queue is empty
+      this->prefetchSpace.wait(lk, [this]
+        {
+          return this->prefetchStop || (!this->prefetchDone &&
+              (this->prefetched.empty() ||
+               (this->prefetched.size() < kPrefetchMessages &&
+                this->prefetchedBytes < kPrefetchBytes)));
+        });
+      if (this->prefetchStop)
+        return;
+    }
+
+    // Seek doesn't replace the batch while a message is read
+    std::lock_guard<std::mutex> batchLk(this->batchMutex);
+    Prefetched message;
+    const bool done = this->messageIter == this->batch.end();
+    if (!done)
+    {
+      // The message is copied once, from the row into the queue
+      const Message &msg = *this->messageIter;
+      message.time = msg.TimeReceived();
+      const std::string_view data = msg.DataView();
+      message.data.assign(data.data(), data.size());
+      this->FindPublisher(msg, message, topic, type);
+      ++this->messageIter;
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(this->prefetchMutex);
+      if (done)
+      {
+        this->prefetchDone = true;
+      }
+      else
+      {
+        this->prefetchedBytes += message.Data().size();
+        this->prefetched.push_back(std::move(message));
+      }
+    }
+    this->prefetchReady.notify_one();
+  }
+}
+
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::StopPrefetch()
+{
+  if (this->reader)
+    this->reader->Detach(this);
+
+  {
+    std::lock_guard<std::mutex> lk(this->prefetchMutex);
+    this->prefetchStop = true;
+  }
+  this->prefetchSpace.notify_one();
+  this->prefetchReady.notify_all();
+
+  if (this->prefetchThread.joinable())
+    this->prefetchThread.join();
+}
+
+//////////////////////////////////////////////////
+bool PlaybackHandle::Implementation::WaitForMessage(
+    std::chrono::nanoseconds &_time, uint64_t &_generation)
+{
+  std::unique_lock<std::mutex> lk(this->prefetchMutex);
+  this->prefetchReady.wait(lk, [this]
+    {
+      return this->stop || this->prefetchStop || this->prefetchDone ||
+        !this->prefetched.empty();
+    });
+
+  if (this->stop || this->prefetchStop || this->prefetched.empty())
+    return false;
+
+  _time = this->prefetched.front().time;
+  _generation = this->prefetchGeneration;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool PlaybackHandle::Implementation::PopMessage(const uint64_t _generation,
+    Prefetched &_message)
+{
+  {
+    std::lock_guard<std::mutex> lk(this->prefetchMutex);
+    if (_generation != this->prefetchGeneration || this->prefetched.empty())
+      return false;
+
+    _message = std::move(this->prefetched.front());
+    this->prefetched.pop_front();
+    this->prefetchedBytes -= _message.Data().size();
+  }
+  if (this->reader)
+    this->reader->NotifySpace();
+  this->prefetchSpace.notify_one();
+  return true;
+}
+
 //////////////////////////////////////////////////
 bool PlaybackHandle::Implementation::WaitUntil(
     const std::chrono::nanoseconds &_targetTime)
 {
-  const auto waitStartTime =
-    std::chrono::steady_clock::now().time_since_epoch();
+  const auto waitStartTime = this->Now();
 
   // Lambda used as predicate below to check for spurious wake-ups
   auto FinishedWaiting = [this, &_targetTime]() -> bool
   {
-    const auto now =
-      std::chrono::steady_clock::now().time_since_epoch();
-    return _targetTime <= now || this->stop || this->paused;
+    return _targetTime <= this->Now() || this->stop || this->paused ||
+      this->rateChanged;
   };
 
   // Passing a lock to wait_for is just a formality (we don't actually
@@ -629,6 +1417,17 @@ bool PlaybackHandle::Implementation::WaitUntil(
   std::mutex tempMutex;
   std::unique_lock<std::mutex> tempLock(tempMutex);
 
+  // The time of a clock can't be waited for, e.g. the simulation time may
+  // run faster or slower than real time, so the clock is checked
+  // periodically, or when PlaybackHandle::NotifyClock() is called
+  if (this->clock)
+  {
+    while (!FinishedWaiting())
+      this->stopConditionVariable.wait_for(tempLock, kClockPollPeriod);
+    return _targetTime <= this->Now() && !this->stop && !this->paused &&
+      !this->rateChanged;
+  }
+
   // Wait until reaching _targetTime or until a stop signal is received.
   // The function will return true if the wait finished with a timeout state,
   // (having successfully achieved the time to wait) or false if the predicate
@@ -638,6 +1437,27 @@ bool PlaybackHandle::Implementation::WaitUntil(
       tempLock, _targetTime - waitStartTime, FinishedWaiting);
 }
 
+//////////////////////////////////////////////////
+std::chrono::nanoseconds PlaybackHandle::Implementation::Now() const
+{
+  if (this->clock)
+    return this->clock->Time();
+  return std::chrono::steady_clock::now().time_since_epoch();
+}
+
+//////////////////////////////////////////////////
+bool PlaybackHandle::Implementation::WaitForClock()
+{
+  if (!this->clock)
+    return true;
+
+  std::mutex tempMutex;
+  std::unique_lock<std::mutex> tempLock(tempMutex);
+  while (!this->clock->IsReady() && !this->stop)
+    this->stopConditionVariable.wait_for(tempLock, kClockPollPeriod);
+  return !this->stop;
+}
+
 //////////////////////////////////////////////////
 void PlaybackHandle::Implementation::Step(
     const std::chrono::nanoseconds &_stepDuration)
@@ -656,19 +1476,48 @@ void PlaybackHandle::Implementation::Seek(
     LERR("Seek can't be called from a stopped playback.\n");
     return;
   }
+
+  // A playback reads the log on its own after seeking
+  if (this->reader)
+    this->reader->Detach(this);
+
   const QualifiedTime beginTime(this->firstMessageTime + _newElapsedTime);
   const QualifiedTime endTime(std::chrono::nanoseconds::max());
   const QualifiedTimeRange timeRange(beginTime, endTime);
+  std::chrono::nanoseconds seekTime = this->firstMessageTime + _newElapsedTime;
+
+  // The query seeks through the time index of the log, and runs before
+  // taking the lock so the prefetch thread keeps reading meanwhile. The
+  // previous batch is released after the lock, at the end of the function.
+  Batch newBatch = this->logFile->QueryMessages(
+      TopicList::Create(this->trackedTopics, timeRange));
+  Batch::iterator newIter = newBatch.begin();
+  if (newIter != newBatch.end())
+    seekTime = newIter->TimeReceived();
   {
     std::unique_lock<std::mutex> lk(this->batchMutex);
-    this->batch = this->logFile->QueryMessages(
-        TopicList::Create(this->trackedTopics, timeRange));
-    this->messageIter = this->batch.begin();
+    std::swap(this->batch, newBatch);
+    std::swap(this->messageIter, newIter);
+
+    // The messages read ahead are those of the previous batch
+    {
+      std::lock_guard<std::mutex> prefetchLk(this->prefetchMutex);
+      this->prefetched.clear();
+      this->prefetchedBytes = 0;
+      this->prefetchDone = false;
+      ++this->prefetchGeneration;
+    }
+    this->prefetchSpace.notify_one();
+  }
+  if (!this->prefetchThread.joinable())
+  {
+    this->prefetchThread =
+      std::thread(&PlaybackHandle::Implementation::PrefetchThread, this);
   }
-  this->playbackTime = this->messageIter->TimeReceived();
-  this->nextMessageTime = this->messageIter->TimeReceived();
+  this->playbackTime = seekTime;
+  this->nextMessageTime = seekTime;
   this->boundaryTime = std::chrono::nanoseconds::max();
-  this->lastEventTime = std::chrono::steady_clock::now().time_since_epoch();
+  this->lastEventTime = this->Now();
 }
 
 //////////////////////////////////////////////////
@@ -681,6 +1530,7 @@ void PlaybackHandle::Implementation::Stop()
 
   this->stop = true;
   this->stopConditionVariable.notify_all();
+  this->StopPrefetch();
 
   if (this->paused)
   {
@@ -700,11 +1550,11 @@ void PlaybackHandle::Implementation::Pause()
   if (!this->paused)
   {
     this->paused = true;
-    std::chrono::nanoseconds now(
-        std::chrono::steady_clock::now().time_since_epoch());
+    const std::chrono::nanoseconds now = this->Now();
     // Advance time in the playback frame to the moment when pause started
     this->playbackTime = this->playbackTime +
-        now - this->lastEventTime;
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          (now - this->lastEventTime) * this->rate.load());
     // Update last event time in the realtime frame.
     this->lastEventTime = now;
     this->boundaryTime = std::chrono::nanoseconds::max();
@@ -728,6 +1578,33 @@ bool PlaybackHandle::Implementation::IsPaused() const
   return this->paused;
 }
 
+//////////////////////////////////////////////////
+void PlaybackHandle::Implementation::SetRate(const double _rate)
+{
+  std::unique_lock<std::mutex> lk(this->pauseMutex);
+  const double newRate = clampRate(_rate);
+  if (!this->paused && !this->stop)
+  {
+    // The time elapsed so far was played at the previous rate
+    const std::chrono::nanoseconds now = this->Now();
+    this->playbackTime = this->playbackTime +
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          (now - this->lastEventTime) * this->rate.load());
+    this->lastEventTime = now;
+  }
+  this->rate = newRate;
+  this->rateChanged = true;
+  this->stopConditionVariable.notify_all();
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds PlaybackHandle::Implementation::ToRealTime(
+    const std::chrono::nanoseconds &_duration) const
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      _duration / this->rate.load());
+}
+
 //////////////////////////////////////////////////
 PlaybackHandle::~PlaybackHandle()
 {
@@ -767,12 +1644,30 @@ void PlaybackHandle::Resume()
   this->dataPtr->Resume();
 }
 
+//////////////////////////////////////////////////
+void PlaybackHandle::SetRate(const double _rate)
+{
+  this->dataPtr->SetRate(_rate);
+}
+
+//////////////////////////////////////////////////
+double PlaybackHandle::Rate() const
+{
+  return this->dataPtr->rate;
+}
+
 //////////////////////////////////////////////////
 bool PlaybackHandle::IsPaused() const
 {
   return this->dataPtr->IsPaused();
 }
 
+//////////////////////////////////////////////////
+void PlaybackHandle::NotifyClock()
+{
+  this->dataPtr->stopConditionVariable.notify_all();
+}
+
 //////////////////////////////////////////////////
 void PlaybackHandle::WaitUntilFinished()
 {
@@ -29,6 +29,66 @@ TEST(Playback, PlaybackEmptyDatabase)
   EXPECT_FALSE(playback.AddTopic("/foo/bar"));
   EXPECT_EQ(-1, playback.AddTopic(std::regex(".*")));
   EXPECT_EQ(nullptr, playback.Start());
+  EXPECT_EQ(-1, playback.PlayOffline());
+}
+
+//////////////////////////////////////////////////
+TEST(Playback, RateAndBackpressure)
+{
+  log::Playback playback(":memory:");
+  EXPECT_DOUBLE_EQ(1.0, playback.Rate());
+  EXPECT_EQ(0u, playback.Backpressure());
+
+  playback.SetRate(4.5);
+  EXPECT_DOUBLE_EQ(4.5, playback.Rate());
+
+  // The rate is clamped to [0.1, 100]
+  playback.SetRate(0.0);
+  EXPECT_DOUBLE_EQ(0.1, playback.Rate());
+  playback.SetRate(-3.0);
+  EXPECT_DOUBLE_EQ(0.1, playback.Rate());
+  playback.SetRate(1000.0);
+  EXPECT_DOUBLE_EQ(100.0, playback.Rate());
+
+  playback.SetBackpressure(10);
+  EXPECT_EQ(10u, playback.Backpressure());
+}
+
+//////////////////////////////////////////////////
+TEST(Playback, LogOptions)
+{
+  log::LogOptions options;
+  options.SetMmapSize(1 << 20);
+  log::Playback playback(
+      std::vector<std::string>{"/this/file/does/not/exist"}, options);
+  EXPECT_FALSE(playback.Valid());
+  EXPECT_EQ(nullptr, playback.Start());
+}
+
+//////////////////////////////////////////////////
+TEST(Playback, StartShared)
+{
+  EXPECT_TRUE(log::Playback::StartShared({}).empty());
+
+  log::Playback invalid(":memory:");
+  log::Playback sharing(invalid, NodeOptions());
+  EXPECT_FALSE(sharing.Valid());
+  EXPECT_TRUE(log::Playback::StartShared({&invalid, &sharing}).empty());
+  EXPECT_TRUE(log::Playback::StartShared({&sharing, nullptr}).empty());
+}
+
+//////////////////////////////////////////////////
+TEST(Playback, OpenLog)
+{
+  log::Playback noLog(std::shared_ptr<log::Log>(nullptr));
+  EXPECT_FALSE(noLog.Valid());
+  EXPECT_EQ(nullptr, noLog.Start());
+
+  auto merged = std::make_shared<log::Log>();
+  EXPECT_FALSE(merged->OpenMerged({"/this/file/does/not/exist"}));
+  log::Playback playback(merged);
+  EXPECT_FALSE(playback.Valid());
+  EXPECT_EQ(nullptr, playback.Start());
 }
 
 
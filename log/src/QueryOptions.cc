@@ -26,8 +26,18 @@
 using namespace ignition::transport;
 using namespace ignition::transport::log;
 
+/// \brief Most topics whose queries are merged from one query per topic.
+/// Each message read compares the messages of all the topics, so more topics
+/// are read in time order from idx_time_recv instead.
+static const std::size_t kMaxMergedTopics = 16;
+
 //////////////////////////////////////////////////
 /// \brief Append a topic ID condition clause that specifies a list of Topic IDs
+///
+/// The ids are written in the statement instead of being bound, so a query
+/// over hundreds of topics doesn't run into SQLITE_MAX_VARIABLE_NUMBER (999
+/// before SQLite 3.32) and isn't split. SQLite builds a transient index of
+/// the list once, and each message looks its topic up in it.
 /// \param[in,out] _sql The SqlStatement to append the clause to
 /// \param[in] _ids The vector of Topic IDs to include in the list
 static void AppendTopicListClause(
@@ -37,20 +47,72 @@ static void AppendTopicListClause(
   bool first = true;
   for (const int64_t id : _ids)
   {
-    if (first)
-    {
-      _sql.statement += "?";
-      first = false;
-    }
-    else
+    if (!first)
+      _sql.statement += ", ";
+    _sql.statement += std::to_string(id);
+    first = false;
+  }
+
+  _sql.statement += ")";
+}
+
+//////////////////////////////////////////////////
+/// \brief Generate the query of the messages of some topics.
+///
+/// With the index idx_topic_time_recv, see topic_time_index.sql, a few topics
+/// out of many are queried one by one through the index, and SQLite merges
+/// the sorted results (a compound query ordered by time is merged, not
+/// sorted). Otherwise the messages are read in time order through
+/// idx_time_recv, and the "+" keeps SQLite from picking the topic index and
+/// sorting the whole result before returning the first message.
+/// \param[in] _descriptor The descriptor of the log
+/// \param[in] _ids The ids of the topics
+/// \param[in] _timeCondition The time range condition, or an empty statement
+/// \return The query
+static SqlStatement topicQuery(const Descriptor &_descriptor,
+    const std::vector<int64_t> &_ids, const SqlStatement &_timeCondition)
+{
+  std::size_t topicCount = 0;
+  for (const auto &topic : _descriptor.TopicsToMsgTypesToId())
+    topicCount += topic.second.size();
+
+  SqlStatement sql;
+  if (_descriptor.HasTopicTimeIndex() && _ids.size() > 1 &&
+      _ids.size() <= kMaxMergedTopics && _ids.size() < topicCount)
+  {
+    for (const int64_t id : _ids)
     {
-      _sql.statement += ", ?";
+      if (!sql.statement.empty())
+        sql.statement += " UNION ALL ";
+      sql.Append(QueryOptions::StandardMessageQueryPreamble());
+      sql.statement += " WHERE (topic_id = ?)";
+      sql.parameters.emplace_back(id);
+      if (!_timeCondition.statement.empty())
+      {
+        sql.statement += " AND (";
+        sql.Append(_timeCondition);
+        sql.statement += ")";
+      }
     }
-
-    _sql.parameters.emplace_back(id);
+    // A compound query is ordered by the names of its columns
+    sql.statement += " ORDER BY time_recv;";
+    return sql;
   }
 
-  _sql.statement += ")";
+  sql = QueryOptions::StandardMessageQueryPreamble();
+  sql.statement += " WHERE (";
+  if (_ids.size() > 1)
+    sql.statement += "+";
+  AppendTopicListClause(sql, _ids);
+  sql.statement += ")";
+  if (!_timeCondition.statement.empty())
+  {
+    sql.statement += " AND (";
+    sql.Append(_timeCondition);
+    sql.statement += ")";
+  }
+  sql.Append(QueryOptions::StandardMessageQueryClose());
+  return sql;
 }
 
 //////////////////////////////////////////////////
@@ -59,7 +121,8 @@ SqlStatement QueryOptions::StandardMessageQueryPreamble()
   SqlStatement sql;
   sql.statement =
       "SELECT messages.id, messages.time_recv, topics.name,"
-      " message_types.name, messages.message FROM messages JOIN topics ON"
+      " message_types.name, messages.message, messages.topic_id FROM messages"
+      " JOIN topics ON"
       " topics.id = messages.topic_id JOIN message_types ON"
       " message_types.id = topics.message_type_id ";
 
@@ -181,10 +244,10 @@ TimeRangeOption::~TimeRangeOption()
 //////////////////////////////////////////////////
 class TopicList::Implementation
 {
-  /// \brief Generate a WHERE clause for topics that exist in the requested list
+  /// \brief Find the ids of the topics that exist in the requested list
   /// \param[in] _descriptor The descriptor forwarded by the interface class
-  /// \return The desired WHERE clause
-  public: SqlStatement GenerateStatement(
+  /// \return The ids of the topics
+  public: std::vector<int64_t> TopicIds(
     const Descriptor &_descriptor)
   {
     const Descriptor::NameToMap &map = _descriptor.TopicsToMsgTypesToId();
@@ -203,12 +266,7 @@ class TopicList::Implementation
       }
     }
 
-    SqlStatement sql = QueryOptions::StandardMessageQueryPreamble();
-    sql.statement += " WHERE (";
-    AppendTopicListClause(sql, rowIDs);
-    sql.statement += ")";
-
-    return sql;
+    return rowIDs;
   }
 
   /// \brief Topics for this option
@@ -266,20 +324,8 @@ const std::set<std::string> &TopicList::Topics() const
 std::vector<SqlStatement> TopicList::GenerateStatements(
     const Descriptor &_descriptor) const
 {
-  SqlStatement sql = this->dataPtr->GenerateStatement(_descriptor);
-
-  // Add the time range condition
-  const SqlStatement &timeCondition = this->GenerateTimeConditions();
-  if (!timeCondition.statement.empty())
-  {
-    sql.statement += " AND (";
-    sql.Append(timeCondition);
-    sql.statement += ")";
-  }
-
-  sql.Append(QueryOptions::StandardMessageQueryClose());
-
-  return {sql};
+  return {topicQuery(_descriptor, this->dataPtr->TopicIds(_descriptor),
+                     this->GenerateTimeConditions())};
 }
 
 //////////////////////////////////////////////////
@@ -291,10 +337,10 @@ TopicList::~TopicList()
 //////////////////////////////////////////////////
 class TopicPattern::Implementation
 {
-  /// \brief Generate a WHERE clause for topics that match the requested pattern
+  /// \brief Find the ids of the topics that match the requested pattern
   /// \param[in] _descriptor The descriptor forwarded by the interface class
-  /// \return The desired WHERE clause
-  public: SqlStatement GenerateStatement(
+  /// \return The ids of the topics
+  public: std::vector<int64_t> TopicIds(
       const Descriptor &_descriptor)
   {
     const Descriptor::NameToMap &map = _descriptor.TopicsToMsgTypesToId();
@@ -315,12 +361,7 @@ class TopicPattern::Implementation
       }
     }
 
-    SqlStatement sql = QueryOptions::StandardMessageQueryPreamble();
-    sql.statement += " WHERE (";
-    AppendTopicListClause(sql, rowIDs);
-    sql.statement += ")";
-
-    return sql;
+    return rowIDs;
   }
 
   /// \brief Pattern for this option
@@ -370,20 +411,8 @@ const std::regex &TopicPattern::Pattern() const
 std::vector<SqlStatement> TopicPattern::GenerateStatements(
     const Descriptor &_descriptor) const
 {
-  SqlStatement sql = this->dataPtr->GenerateStatement(_descriptor);
-
-  // Add the time range condition
-  const SqlStatement &timeCondition = this->GenerateTimeConditions();
-  if (!timeCondition.statement.empty())
-  {
-    sql.statement += " AND (";
-    sql.Append(timeCondition);
-    sql.statement += ")";
-  }
-
-  sql.Append(QueryOptions::StandardMessageQueryClose());
-
-  return {sql};
+  return {topicQuery(_descriptor, this->dataPtr->TopicIds(_descriptor),
+                     this->GenerateTimeConditions())};
 }
 
 //////////////////////////////////////////////////
@@ -15,28 +15,39 @@
  *
 */
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <regex>
 #include <set>
+#include <string>
 #include <utility>
 #include <vector>
 #include <thread>
 
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
+
 #include <ignition/transport/Clock.hh>
-#include <ignition/transport/Discovery.hh>
+#include <ignition/transport/Helpers.hh>
 #include <ignition/transport/log/Log.hh>
 #include <ignition/transport/log/Recorder.hh>
 #include <ignition/transport/MessageInfo.hh>
 #include <ignition/transport/Node.hh>
+#include <ignition/transport/NodeShared.hh>
 #include <ignition/transport/TransportTypes.hh>
 
+#include "ChunkSender.hh"
 #include "Console.hh"
+#include "Manifest.hh"
 #include "raii-sqlite3.hh"
 #include "build_config.hh"
 
@@ -46,23 +57,125 @@ using namespace ignition::transport::log;
 /// \brief Private implementation
 class ignition::transport::log::Recorder::Implementation
 {
+  /// \brief Id of a subscribed topic in the log file. It's resolved the
+  /// first time a message of the topic is written, so the following messages
+  /// are inserted without looking the topic up. Only accessed with the mutex
+  /// of its writer locked.
+  public: struct TopicSlot
+  {
+    /// \brief Message type that the id was resolved for
+    std::string type;
+    /// \brief Id of the topic in the log file, or -1 if not resolved yet
+    int64_t id = -1;
+    /// \brief Log file that the id was resolved for, see logGenerations
+    uint64_t logGeneration = 0;
+    /// \brief Index of the writer of the topic, see Writer. Protected by
+    /// dataQueueMutex.
+    std::size_t group = 0;
+    /// \brief Topic name of the last message received, shared by the queued
+    /// messages. Protected by dataQueueMutex.
+    std::shared_ptr<const std::string> recvTopic;
+    /// \brief Message type of the last message received, shared by the
+    /// queued messages. Protected by dataQueueMutex.
+    std::shared_ptr<const std::string> recvType;
+    /// \brief True if the messages of the topic are dropped first when the
+    /// buffer is full. Protected by dataQueueMutex.
+    bool lowPriority = false;
+    /// \brief Counters of the topic. Protected by dataQueueMutex.
+    Recorder::TopicStatistics stats;
+  };
+
+  /// \brief A block of memory holding the data of consecutive messages. It's
+  /// reused once all its messages have been written or dropped.
+  public: struct Slab
+  {
+    /// \brief Memory of the slab
+    std::unique_ptr<char[]> bytes;
+    /// \brief Size of the memory
+    std::size_t capacity = 0;
+    /// \brief Bytes used by the messages
+    std::size_t used = 0;
+    /// \brief Messages of the slab that are still queued or being written
+    std::size_t pending = 0;
+  };
+
   /// \brief Data type stored in dataQueue
   public: struct LogData
   {
-    /// \brief Constructor
-    LogData(std::chrono::nanoseconds _stamp, std::vector<char> &&_msgData, // NOLINT
-            const transport::MessageInfo &_msgInfo)
-        : stamp(_stamp), msgData(std::move(_msgData)), msgInfo(_msgInfo)
-    {
-    }
     /// \brief Time stamp of when the message was received by the log recorder
-    std::chrono::nanoseconds stamp;
-    /// Serialized message data
-    std::vector<char> msgData;
-    /// Extra information about the message, such as its topic.
-    transport::MessageInfo msgInfo;
+    std::chrono::nanoseconds stamp{0};
+    /// \brief Order in which the messages were received
+    uint64_t sequence = 0;
+    /// Serialized message data, in a slab or in oversized
+    const char *data = nullptr;
+    /// Size of the serialized message data
+    std::size_t len = 0;
+    /// Slab holding the data, or nullptr if the data is in oversized
+    Slab *slab = nullptr;
+    /// Memory of a message that doesn't fit in a slab
+    std::unique_ptr<char[]> oversized;
+    /// Topic name of the message
+    std::shared_ptr<const std::string> topic;
+    /// Message type of the message
+    std::shared_ptr<const std::string> type;
+    /// Id of the topic of the message.
+    std::shared_ptr<TopicSlot> slot;
+  };
+
+  /// \brief A FIFO queue of messages. It's a ring of reused elements, so
+  /// queuing a message doesn't allocate memory.
+  public: struct Ring
+  {
+    /// \brief The elements of the ring
+    std::vector<LogData> items;
+    /// \brief Index of the oldest message
+    std::size_t head = 0;
+    /// \brief Number of messages
+    std::size_t count = 0;
+  };
+
+  /// \brief Writes the messages of a group of topics to a log file of its
+  /// own, in a thread of its own, see Recorder::AddTopicGroup(). The first
+  /// writer has the topics that are in no group.
+  public: struct Writer
+  {
+    /// \brief File of the group, which names the parts of a split
+    /// recording
+    std::string filename;
+    /// \brief log file or nullptr if not recording. Protected by mutex.
+    std::unique_ptr<Log> logFile;
+    /// \brief Unique number of the log file, so the topic ids of another
+    /// log file aren't used, see logGenerations. Protected by mutex.
+    uint64_t logGeneration = 0;
+    /// \brief Messages being inserted into the log file, kept to reuse its
+    /// memory. Protected by mutex.
+    std::vector<Log::MessageRecord> records;
+    /// \brief Number of the part being written. Protected by mutex.
+    std::size_t part = 0;
+    /// \brief Size of the messages of the part. Protected by mutex.
+    std::size_t partBytes = 0;
+    /// \brief Number of messages of the part. Protected by mutex.
+    uint64_t partMessages = 0;
+    /// \brief Time of the first message of the part. Protected by mutex.
+    std::chrono::nanoseconds partStart{0};
+    /// \brief mutex for thread safety with the log file
+    std::mutex mutex;
+    /// \brief Messages of the group waiting to be written, protected by
+    /// dataQueueMutex. See Implementation::dataQueueMutex.
+    Ring dataQueue;
+    /// \brief Messages of the low priority topics of the group, which are
+    /// dropped first. Protected by dataQueueMutex.
+    Ring lowPriorityQueue;
+    /// \brief Condition variable to signal new messages to the thread
+    std::condition_variable dataQueueCondVar;
+    /// \brief Handle to worker thread that writes the messages to the log
+    /// file
+    std::thread thread;
   };
 
+  /// \brief Size of the slabs. Messages that are bigger get their own memory.
+  public: static constexpr std::size_t kSlabSize = 4 << 20;
+
   /// \brief constructor
   public: Implementation();
 
@@ -73,47 +186,236 @@ class ignition::transport::log::Recorder::Implementation
   /// \param[in] _data Data of the message
   /// \param[in] _len The size of the message data
   /// \param[in] _info The meta-info of the message
+  /// \param[in] _slot Id of the topic in the log file
   public: void OnMessageReceived(
           const char *_data,
           std::size_t _len,
-          const transport::MessageInfo &_info);
+          const transport::MessageInfo &_info,
+          const std::shared_ptr<TopicSlot> &_slot);
 
   /// \brief Callback that listens for newly advertised topics
   /// \param[in] _publisher The Publisher that has advertised
   public: void OnAdvertisement(const Publisher &_publisher);
 
-  /// \sa Recorder::AddTopic(const std::string&)
-  public: RecorderError AddTopic(const std::string &_topic);
+  /// \sa Recorder::AddTopic(const std::string&, const uint64_t)
+  public: RecorderError AddTopic(const std::string &_topic,
+                                 const uint64_t _msgsPerSec = kUnthrottled);
 
-  /// \sa Recorder::AddTopic(const std::regex&)
-  public: int64_t AddTopic(const std::regex &_pattern);
+  /// \sa Recorder::AddTopic(const std::regex&, const uint64_t)
+  public: int64_t AddTopic(const std::regex &_pattern,
+                           const uint64_t _msgsPerSec = kUnthrottled);
 
-  /// \brief Worker thread function that writes data from the dataQueue to the
-  /// database
-  public: void DataWriterThread();
+  /// \brief Worker thread function that writes data from the queues of a
+  /// writer to its database
+  /// \param[in,out] _writer The writer
+  public: void DataWriterThread(Writer &_writer);
 
-  /// \brief Start the data writer thread
+  /// \brief Start the data writer threads
   public: void StartDataWriter();
 
-  /// \brief Stop the data writer thread
+  /// \brief Stop the data writer threads
   public: void StopDataWriter();
 
+  /// \brief Get the writer of a topic. The caller must hold dataQueueMutex.
+  /// \param[in] _topic The topic name
+  /// \return Index of the writer of the first group matching the topic, or
+  /// 0 if there is none
+  public: std::size_t GroupOf(const std::string &_topic) const;
+
   /// \brief Decrement buffer size by given amount
   /// \param[in] _len The amount to decrement
   public: void DecrementBufferSize(std::size_t _len);
 
-  /// \brief Write any data left in the queue to the log file
+  /// \brief Write any data left in the queues to the log files
   public: void FlushDataQueue();
 
-  /// \brief Write data to log file
-  /// \param[in] _logData data to be written
-  public: void WriteToLogFile(const LogData &_logData);
+  /// \brief Move the oldest messages of the queues of a writer to a batch.
+  /// The caller must hold dataQueueMutex.
+  /// \param[in,out] _writer The writer
+  /// \param[out] _batch The messages removed from the queue
+  public: void PopBatch(Writer &_writer, std::vector<LogData> &_batch);
+
+  /// \brief Add a message at the end of a queue, growing the ring if
+  /// it's full. The caller must hold dataQueueMutex.
+  /// \param[in,out] _ring The queue
+  /// \return The new message
+  public: LogData &PushData(Ring &_ring);
+
+  /// \brief Remove the oldest message of a queue, which must not be empty.
+  /// The caller must hold dataQueueMutex.
+  /// \param[in,out] _ring The queue
+  /// \param[out] _data The message
+  public: void PopData(Ring &_ring, LogData &_data);
+
+  /// \brief Get the queue holding the oldest message of a writer, of the
+  /// messages of both priorities. The caller must hold dataQueueMutex.
+  /// \param[in] _writer The writer
+  /// \return The queue, or nullptr if there are no messages
+  public: Ring *OldestRing(Writer &_writer);
+
+  /// \brief Get the queue holding the oldest message of a priority, of the
+  /// messages of all the writers. The caller must hold dataQueueMutex.
+  /// \param[in] _lowPriority The priority
+  /// \return The queue, or nullptr if there are no messages
+  public: Ring *OldestRing(bool _lowPriority);
+
+  /// \brief Get the queue holding the oldest message of all the writers.
+  /// The caller must hold dataQueueMutex.
+  /// \return The queue, or nullptr if there are no messages
+  public: Ring *OldestRing();
+
+  /// \brief Move the oldest messages of all the writers received before a
+  /// sequence number to a batch, see Recorder::Dump(). The caller must hold
+  /// dataQueueMutex.
+  /// \param[in] _end Sequence number of the first message left queued
+  /// \param[out] _batch The messages removed from the queues
+  public: void PopWindow(uint64_t _end, std::vector<LogData> &_batch);
+
+  /// \brief Release the messages left in the queues of the writers. The
+  /// caller must hold dataQueueMutex.
+  public: void ClearDataQueue();
+
+  /// \brief Drop the oldest message of a queue to make room for new ones.
+  /// The caller must hold dataQueueMutex.
+  /// \param[in,out] _ring The queue, which must not be empty
+  public: void DropData(Ring &_ring);
+
+  /// \brief Count a message that was dropped. The caller must hold
+  /// dataQueueMutex.
+  /// \param[in,out] _slot The topic of the message
+  /// \param[in] _len Size of the message
+  public: void CountDrop(TopicSlot &_slot, std::size_t _len);
+
+  /// \brief Copy the data of a message into a slab, or into its own memory
+  /// if it doesn't fit in one. The caller must hold dataQueueMutex.
+  /// \param[in] _data Data of the message
+  /// \param[in] _len Size of the data
+  /// \param[out] _logData The message that holds the data
+  public: void StoreData(const char *_data, std::size_t _len,
+                         LogData &_logData);
 
-  /// \brief log file or nullptr if not recording
-  public: std::unique_ptr<Log> logFile;
+  /// \brief Release the memory of a message that has been written or
+  /// dropped. The caller must hold dataQueueMutex.
+  /// \param[in,out] _logData The message
+  public: void ReleaseData(LogData &_logData);
 
-  /// \brief A set of topic patterns that we want to subscribe to
-  public: std::vector<std::regex> patterns;
+  /// \brief Write data to log file
+  /// \param[in,out] _writer The writer of the log file
+  /// \param[in] _batch data to be written
+  public: void WriteToLogFile(Writer &_writer,
+                              const std::vector<LogData> &_batch);
+
+  /// \brief Insert the records of a writer into its log file, and clear
+  /// them. The caller must hold the mutex of the writer.
+  /// \param[in,out] _writer The writer
+  public: void InsertRecords(Writer &_writer);
+
+  /// \brief Check if a message should start a new part of the recording,
+  /// see Recorder::SetSplitSize(). The caller must hold the mutex of the
+  /// writer.
+  /// \param[in] _writer The writer
+  /// \param[in] _logData The message
+  /// \return true if the current part is full
+  public: bool TimeToSplit(const Writer &_writer,
+                           const LogData &_logData) const;
+
+  /// \brief Write the records and continue the recording in its next
+  /// part. If the part can't be created, the recording goes on in the
+  /// current file. The caller must hold the mutex of the writer.
+  /// \param[in,out] _writer The writer
+  public: void Split(Writer &_writer);
+
+  /// \sa Recorder::Dump()
+  public: RecorderError Dump(const std::string &_file,
+                             const LogOptions &_options);
+
+  /// \brief Finalize a closed log file in the background, see
+  /// Log::Finalize(), if it was written with deferred indexes.
+  /// \param[in] _file Path of the log file
+  /// \param[in] _options Settings the log file was written with
+  public: void Finalize(const std::string &_file, const LogOptions &_options);
+
+  /// \brief Body of the thread finalizing the log files, which runs until
+  /// finalizeQueue is empty.
+  public: void FinalizeThread();
+
+  /// \sa Recorder::WaitUntilFinalized()
+  public: void WaitUntilFinalized();
+
+  /// \brief Log files waiting to be finalized. Protected by finalizeMutex.
+  public: std::deque<std::string> finalizeQueue;
+
+  /// \brief True while the finalize thread runs. Protected by
+  /// finalizeMutex.
+  public: bool finalizing = false;
+
+  /// \brief Mutex of the files to finalize
+  public: std::mutex finalizeMutex;
+
+  /// \brief Notified when the finalize thread is done
+  public: std::condition_variable finalizeDone;
+
+  /// \brief Thread finalizing the log files
+  public: std::thread finalizeThread;
+
+  /// \brief Maximum number of messages written to the log file at once
+  public: static constexpr std::size_t kWriteBatchSize = 256;
+
+  /// \brief The writers of the recording, the first one for the topics
+  /// that are in no group. Only changed by Recorder::Start while not
+  /// recording, with both logFileMutex and dataQueueMutex locked.
+  public: std::vector<std::unique_ptr<Writer>> writers;
+
+  /// \brief Topic groups with a log file of their own, by name. Protected
+  /// by dataQueueMutex.
+  public: std::vector<std::pair<std::string, std::regex>> groups;
+
+  /// \brief True between Recorder::Start and Recorder::Stop. Protected by
+  /// logFileMutex.
+  public: bool recording = false;
+
+  /// \brief True if the recording was started by Recorder::StartBlackBox,
+  /// so the messages are only written by Recorder::Dump. Changed with both
+  /// logFileMutex and dataQueueMutex locked, so either protects reading it.
+  public: bool blackBox = false;
+
+  /// \brief Time kept by the black box, 0 if it is only limited by size.
+  /// Protected like blackBox.
+  public: std::chrono::nanoseconds blackBoxWindow{0};
+
+  /// \brief Size kept by the black box (in bytes), 0 if it is only limited
+  /// by time. Protected like blackBox.
+  public: std::size_t blackBoxBytes{0};
+
+  /// \brief True if the recording was started by Recorder::StartRemote, so
+  /// the messages of all the groups are streamed by the first writer.
+  /// Protected like blackBox.
+  public: bool remote = false;
+
+  /// \brief Sends the chunks of a remote recording, kept after it stops
+  /// for its counters. Changed with both logFileMutex and dataQueueMutex
+  /// locked.
+  public: std::unique_ptr<ChunkSender> sender;
+
+  /// \brief Incremented every time a log file is opened, see
+  /// Writer::logGeneration
+  public: std::atomic<uint64_t> logGenerations{0};
+
+  /// \brief Settings of the log files, set by Recorder::Start before the
+  /// writers start.
+  public: LogOptions logOptions;
+
+  /// \brief Size of the messages of a part, 0 if the recording isn't split
+  /// by size
+  public: std::atomic<std::size_t> splitSize{0};
+
+  /// \brief Time spanned by a part, 0 if the recording isn't split by time
+  public: std::atomic<std::chrono::nanoseconds> splitDuration{
+    std::chrono::nanoseconds::zero()};
+
+  /// \brief A set of topic patterns that we want to subscribe to, with
+  /// the rate of their topics
+  public: std::vector<std::pair<std::regex, uint64_t>> patterns;
 
   /// \brief A set of topic names that we have already subscribed to. When new
   /// publishers advertise topics that we are already subscribed to, our
@@ -123,7 +425,7 @@ class ignition::transport::log::Recorder::Implementation
   /// \brief mutex for thread safety when evaluating newly advertised topics
   public: std::mutex topicMutex;
 
-  /// \brief mutex for thread safety with log file
+  /// \brief mutex for thread safety when starting and stopping recording
   public: std::mutex logFileMutex;
 
   /// \brief node used to create subscriptions
@@ -132,11 +434,9 @@ class ignition::transport::log::Recorder::Implementation
   /// \brief Clock to synchronize and stamp messages with.
   public: const Clock *clock;
 
-  /// \brief callback used on every subscriber
-  public: RawCallback rawCallback;
-
-  /// \brief Object for discovering new publishers as they advertise themselves
-  public: std::unique_ptr<MsgDiscovery> discovery;
+  /// \brief Id of the callback receiving the publishers discovered by
+  /// NodeShared, see NodeShared::AddConnectionsCb().
+  public: uint64_t connectionsCbId = 0;
 
   /// \brief Maximum size of the buffer (in bytes) that is used to store data
   /// from topic callbacks.
@@ -147,28 +447,57 @@ class ignition::transport::log::Recorder::Implementation
   /// `dataQueueMutex` to protect it.
   public: std::size_t bufferSize{0};
 
-  /// \brief This is a temporary FIFO queue that is used to store data from
-  /// callbacks until they are written to disk. If the queue fills up before
-  /// the dataWriter thread has a chance to process it, old data will be
-  /// overwritten. Thus, it is important to set the queue size appropriately for
-  /// your application. The maximum size of this queue is determined by
-  /// `maxBufferSize`. The current size of the buffer is calculated from
-  /// `msgData`.
-  public: std::deque<LogData> dataQueue;
+  /// \brief Number of messages in the queues of all the writers. The queues
+  /// are temporary FIFO queues that are used to store data from callbacks
+  /// until they are written to disk. If the queues fill up before the
+  /// writer threads have a chance to process them, old data will be
+  /// overwritten. Thus, it is important to set the buffer size appropriately
+  /// for your application. The maximum size of all the queues together is
+  /// determined by `maxBufferSize`. The current size of the buffer is
+  /// calculated from the `len` of the messages.
+  public: std::size_t queueCount{0};
 
-  /// \brief Mutex to synchronize access to dataQueue and bufferSize
-  public: std::mutex dataQueueMutex;
+  /// \brief Sequence number of the next message received, protected by
+  /// dataQueueMutex
+  public: uint64_t nextSequence{0};
+
+  /// \brief Slots of the subscribed topics, by topic name. Protected by
+  /// dataQueueMutex.
+  public: std::map<std::string, std::shared_ptr<TopicSlot>> slots;
+
+  /// \brief Topics whose messages are dropped first, protected by
+  /// dataQueueMutex
+  public: std::set<std::string> lowPriorityTopics;
+
+  /// \brief Counters of the recording, protected by dataQueueMutex, except
+  /// writtenMsgs and failedMsgs which are in the atomics below. The topics
+  /// are in slots.
+  public: Recorder::Statistics stats;
+
+  /// \brief Messages written to the log file
+  public: std::atomic<uint64_t> writtenMsgs{0};
 
-  /// \brief Condition variable to synchronize access to dataQueue
-  public: std::condition_variable dataQueueCondVar;
+  /// \brief Messages that couldn't be written to the log file
+  public: std::atomic<uint64_t> failedMsgs{0};
 
-  /// \brief Handle to worker thread that writes data from the dataQueue to the
-  /// database
-  public: std::thread dataWriter;
+  /// \brief All the slabs, protected by dataQueueMutex
+  public: std::vector<std::unique_ptr<Slab>> slabs;
 
-  /// \brief State of dataWriter thread.
-  /// True: Data writer thread has started or is starting.
-  /// False: Data writer thread has not started or is shutting down.
+  /// \brief Slabs without pending messages, protected by dataQueueMutex
+  public: std::vector<Slab *> freeSlabs;
+
+  /// \brief Slab where the next messages are stored, protected by
+  /// dataQueueMutex
+  public: Slab *currentSlab{nullptr};
+
+  /// \brief Mutex to synchronize access to the queues and bufferSize. It's
+  /// only held to queue and dequeue messages, not while writing them, so the
+  /// writers don't wait for each other.
+  public: std::mutex dataQueueMutex;
+
+  /// \brief State of the writer threads.
+  /// True: Data writer threads have started or are starting.
+  /// False: Data writer threads have not started or are shutting down.
   public: std::atomic<bool> dataWriterState{false};
 
   /// \brief Whether the OnMessageReceived should stop queuing received
@@ -181,38 +510,31 @@ Recorder::Implementation::Implementation()
 {
   // Use wall clock for synchronization by default.
   this->clock = ignition::transport::WallClock::Instance();
-  // Make a lambda to wrap a member function callback
-  this->rawCallback = [this](
-      const char *_data, std::size_t _len, const transport::MessageInfo &_info)
-  {
-    this->OnMessageReceived(_data, _len, _info);
-  };
-
-  auto shared = NodeShared::Instance();
 
-  this->discovery = std::make_unique<MsgDiscovery>(
-      Uuid().ToString(), shared->discoveryIP, shared->msgDiscPort);
-
-  DiscoveryCallback<Publisher> cb = [this](const Publisher &_publisher)
-  {
-    this->OnAdvertisement(_publisher);
-  };
-
-  this->discovery->ConnectionsCb(cb);
-  this->discovery->Start();
+  // Follow the topics that appear with the discovery of the process,
+  // instead of running another one.
+  this->connectionsCbId = NodeShared::Instance()->AddConnectionsCb(
+      [this](const MessagePublisher &_publisher)
+      {
+        this->OnAdvertisement(_publisher);
+      });
 }
 
 //////////////////////////////////////////////////
 Recorder::Implementation::~Implementation()
 {
+  // Waits for the callback if it's running
+  NodeShared::Instance()->RemoveConnectionsCb(this->connectionsCbId);
   this->StopDataWriter();
+  this->WaitUntilFinalized();
 }
 
 //////////////////////////////////////////////////
 void Recorder::Implementation::OnMessageReceived(
           const char *_data,
           std::size_t _len,
-          const ignition::transport::MessageInfo &_info)
+          const ignition::transport::MessageInfo &_info,
+          const std::shared_ptr<TopicSlot> &_slot)
 {
   LDBG("RX'" << _info.Topic() << "'[" << _info.Type() << "]\n");
 
@@ -224,27 +546,81 @@ void Recorder::Implementation::OnMessageReceived(
   // happens when Recorder::Start is called.
   if (this->dataWriterState)
   {
-    std::vector<char> tmp(_data, _data+_len);
-
     std::lock_guard<std::mutex> lock(this->dataQueueMutex);
-    // If the maxBufferSize is zero, we have an infinite queue
-    if (this->maxBufferSize > 0)
+    // The writers may have stopped while waiting for the lock
+    if (!this->dataWriterState || _slot->group >= this->writers.size())
+      return;
+    Writer &writer = *this->writers[_slot->group];
+
+    ++this->stats.receivedMsgs;
+    ++_slot->stats.receivedMsgs;
+
+    // If the maxBufferSize is zero, we have an infinite queue. The black box
+    // has a size of its own.
+    const std::size_t maxSize =
+      this->blackBox ? this->blackBoxBytes : this->maxBufferSize.load();
+    if (maxSize > 0)
     {
-      // Only pop if we have a message in the queue.
-      if ((this->bufferSize + _len > this->maxBufferSize) &&
-          !this->dataQueue.empty())
+      // Only pop if we have a message in the queue. The low priority messages
+      // go first, and a new one doesn't push out the other messages. The
+      // writers share the buffer, so the oldest message of any group goes.
+      while ((this->bufferSize + _len > maxSize) &&
+          this->queueCount > 0)
       {
-        this->DecrementBufferSize(this->dataQueue.front().msgData.size());
-        this->dataQueue.pop_front();
+        if (Ring *ring = this->OldestRing(true))
+        {
+          this->DropData(*ring);
+        }
+        else if (_slot->lowPriority)
+        {
+          this->CountDrop(*_slot, _len);
+          return;
+        }
+        else
+        {
+          this->DropData(*this->OldestRing(false));
+        }
       }
     }
 
+    // The queued messages of a topic share its name and type.
+    if (!_slot->recvTopic || *_slot->recvTopic != _info.Topic())
+      _slot->recvTopic = std::make_shared<const std::string>(_info.Topic());
+    if (!_slot->recvType || *_slot->recvType != _info.Type())
+      _slot->recvType = std::make_shared<const std::string>(_info.Type());
+
     this->bufferSize += _len;
     // If the message being added here is larger than maxBufferSize, it should
     // still be recorded. It just means that the buffer cannot hold another
     // message until it is recorded.
-    this->dataQueue.emplace_back(this->clock->Time(), std::move(tmp), _info);
-    this->dataQueueCondVar.notify_one();
+    LogData &logData = this->PushData(
+        _slot->lowPriority ? writer.lowPriorityQueue : writer.dataQueue);
+    logData.stamp = this->clock->Time();
+    logData.sequence = this->nextSequence++;
+    this->StoreData(_data, _len, logData);
+    logData.topic = _slot->recvTopic;
+    logData.type = _slot->recvType;
+    logData.slot = _slot;
+
+    // The black box only keeps the latest messages
+    if (this->blackBox &&
+        this->blackBoxWindow > std::chrono::nanoseconds::zero())
+    {
+      const std::chrono::nanoseconds cutoff =
+        logData.stamp - this->blackBoxWindow;
+      while (Ring *ring = this->OldestRing())
+      {
+        if (ring->items[ring->head].stamp >= cutoff)
+          break;
+        this->DropData(*ring);
+      }
+    }
+
+    this->stats.maxBufferedBytes =
+      std::max(this->stats.maxBufferedBytes, this->bufferSize);
+    this->stats.maxQueuedMsgs =
+      std::max(this->stats.maxQueuedMsgs, this->queueCount);
+    writer.dataQueueCondVar.notify_one();
   }
 }
 
@@ -273,26 +649,56 @@ void Recorder::Implementation::OnAdvertisement(const Publisher &_publisher)
   if (this->alreadySubscribed.find(topic) != this->alreadySubscribed.end())
     return;
 
-  for (const std::regex &pattern : this->patterns)
+  for (const auto &pattern : this->patterns)
   {
-    if (std::regex_match(topic, pattern))
+    if (std::regex_match(topic, pattern.first))
     {
-      this->AddTopic(topic);
+      this->AddTopic(topic, pattern.second);
     }
   }
 }
 
 //////////////////////////////////////////////////
-RecorderError Recorder::Implementation::AddTopic(const std::string &_topic)
+RecorderError Recorder::Implementation::AddTopic(const std::string &_topic,
+    const uint64_t _msgsPerSec)
 {
   // Do not subscribe to a topic if we are already subscribed.
   if (this->alreadySubscribed.find(_topic) == this->alreadySubscribed.end())
   {
     LDBG("Recording [" << _topic << "]\n");
+    // Make a lambda to wrap a member function callback. Every topic has its
+    // own slot for its id in the log file.
+    auto slot = std::make_shared<TopicSlot>();
+    {
+      std::lock_guard<std::mutex> lock(this->dataQueueMutex);
+      slot->lowPriority = this->lowPriorityTopics.count(_topic) > 0;
+      slot->group = this->GroupOf(_topic);
+      this->slots[_topic] = slot;
+    }
+
+    RawCallback cb = [this, slot](
+        const char *_data, std::size_t _len,
+        const transport::MessageInfo &_info)
+    {
+      this->OnMessageReceived(_data, _len, _info, slot);
+    };
+
+    // The messages above the rate are discarded before the callback, or
+    // not even sent by the publishers
+    SubscribeOptions opts;
+    if (_msgsPerSec != kUnthrottled)
+    {
+      LDBG("Recording [" << _topic << "] at " << _msgsPerSec
+           << " messages per second\n");
+      opts.SetMsgsPerSec(std::max<uint64_t>(_msgsPerSec, 1u));
+    }
+
     // Subscribe to the topic whether it exists or not
-    if (!this->node.SubscribeRaw(_topic, this->rawCallback))
+    if (!this->node.SubscribeRaw(_topic, cb, kGenericMessageType, opts))
     {
       LERR("Failed to subscribe to [" << _topic << "]\n");
+      std::lock_guard<std::mutex> lock(this->dataQueueMutex);
+      this->slots.erase(_topic);
       return RecorderError::FAILED_TO_SUBSCRIBE;
     }
     this->alreadySubscribed.insert(_topic);
@@ -303,7 +709,8 @@ RecorderError Recorder::Implementation::AddTopic(const std::string &_topic)
 }
 
 //////////////////////////////////////////////////
-int64_t Recorder::Implementation::AddTopic(const std::regex &_pattern)
+int64_t Recorder::Implementation::AddTopic(const std::regex &_pattern,
+    const uint64_t _msgsPerSec)
 {
   int numSubscriptions = 0;
   std::vector<std::string> allTopics;
@@ -313,7 +720,8 @@ int64_t Recorder::Implementation::AddTopic(const std::regex &_pattern)
     if (std::regex_match(topic, _pattern))
     {
       // Subscribe to the topic
-      if (this->AddTopic(topic) == RecorderError::FAILED_TO_SUBSCRIBE)
+      if (this->AddTopic(topic, _msgsPerSec) ==
+          RecorderError::FAILED_TO_SUBSCRIBE)
       {
         return static_cast<int64_t>(RecorderError::FAILED_TO_SUBSCRIBE);
       }
@@ -325,37 +733,43 @@ int64_t Recorder::Implementation::AddTopic(const std::regex &_pattern)
     }
   }
 
-  this->patterns.push_back(_pattern);
+  this->patterns.emplace_back(_pattern, _msgsPerSec);
 
   return numSubscriptions;
 }
 
 //////////////////////////////////////////////////
-void Recorder::Implementation::DataWriterThread()
+void Recorder::Implementation::DataWriterThread(Writer &_writer)
 {
+  std::vector<LogData> batch;
   while (this->dataWriterState)
   {
     std::unique_lock<std::mutex> lock(this->dataQueueMutex);
-    if (this->dataQueue.empty())
+    if (!this->OldestRing(_writer))
     {
-      this->dataQueueCondVar.wait(lock,
-        [this]
+      _writer.dataQueueCondVar.wait(lock,
+        [this, &_writer]
         {
-          return !this->dataQueue.empty() || !this->dataWriterState;
+          return this->OldestRing(_writer) || !this->dataWriterState;
         });
 
-      if (this->dataQueue.empty())
+      if (!this->OldestRing(_writer))
       {
         continue;
       }
     }
 
-    const auto logData = std::move(this->dataQueue.front());
-    this->dataQueue.pop_front();
+    // Drain the queue in chunks, so writing to disk doesn't keep the
+    // callbacks waiting.
+    this->PopBatch(_writer, batch);
     // Unlock before locking another mutex.
     lock.unlock();
 
-    this->WriteToLogFile(logData);
+    this->WriteToLogFile(_writer, batch);
+
+    lock.lock();
+    for (auto &logData : batch)
+      this->ReleaseData(logData);
   }
 }
 
@@ -364,19 +778,43 @@ void Recorder::Implementation::StartDataWriter()
 {
   this->dataWriterState = true;
 
-  this->dataWriter =
-      std::thread(&Recorder::Implementation::DataWriterThread, this);
+  for (auto &writer : this->writers)
+  {
+    writer->thread = std::thread(&Recorder::Implementation::DataWriterThread,
+        this, std::ref(*writer));
+  }
 }
 
 //////////////////////////////////////////////////
 void Recorder::Implementation::StopDataWriter()
 {
-  this->dataWriterState = false;
-  this->dataQueueCondVar.notify_one();
-  if (this->dataWriter.joinable())
   {
-    this->dataWriter.join();
+    // Hold the lock, so no writer misses the notification
+    std::lock_guard<std::mutex> lock(this->dataQueueMutex);
+    this->dataWriterState = false;
+  }
+  for (auto &writer : this->writers)
+  {
+    writer->dataQueueCondVar.notify_one();
+    if (writer->thread.joinable())
+    {
+      writer->thread.join();
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+std::size_t Recorder::Implementation::GroupOf(const std::string &_topic) const
+{
+  if (this->remote)
+    return 0;
+
+  for (std::size_t i = 0; i < this->groups.size(); ++i)
+  {
+    if (std::regex_match(_topic, this->groups[i].second))
+      return i + 1;
   }
+  return 0;
 }
 
 //////////////////////////////////////////////////
@@ -398,42 +836,468 @@ void Recorder::Implementation::DecrementBufferSize(std::size_t _len)
 //////////////////////////////////////////////////
 void Recorder::Implementation::FlushDataQueue()
 {
-  while (true)
+  std::vector<LogData> batch;
+  for (auto &writer : this->writers)
   {
-    std::unique_lock<std::mutex> lock(this->dataQueueMutex);
-    if (this->dataQueue.empty())
-      return;
+    while (true)
+    {
+      std::unique_lock<std::mutex> lock(this->dataQueueMutex);
+      if (!this->OldestRing(*writer))
+        break;
 
-    const auto logData = std::move(this->dataQueue.front());
-    this->dataQueue.pop_front();
-    // Unlock before locking another mutex.
-    lock.unlock();
+      this->PopBatch(*writer, batch);
+      // Unlock before locking another mutex.
+      lock.unlock();
+
+      this->WriteToLogFile(*writer, batch);
 
-    this->WriteToLogFile(logData);
+      lock.lock();
+      for (auto &logData : batch)
+        this->ReleaseData(logData);
+    }
   }
 }
 
 //////////////////////////////////////////////////
-void Recorder::Implementation::WriteToLogFile(const LogData &_logData)
+void Recorder::Implementation::PopBatch(Writer &_writer,
+    std::vector<LogData> &_batch)
+{
+  // Keep the elements of the batch, so its capacity is reused.
+  const std::size_t count = std::min(
+      _writer.dataQueue.count + _writer.lowPriorityQueue.count,
+      kWriteBatchSize);
+  _batch.resize(count);
+  for (auto &logData : _batch)
+  {
+    // Both queues are written in the order the messages were received
+    this->PopData(*this->OldestRing(_writer), logData);
+    this->DecrementBufferSize(logData.len);
+  }
+
+  // How long the oldest message waited to be written
+  if (!_batch.empty())
+  {
+    this->stats.maxWriterLag = std::max(this->stats.maxWriterLag,
+        this->clock->Time() - _batch.front().stamp);
+  }
+}
+
+//////////////////////////////////////////////////
+Recorder::Implementation::LogData &Recorder::Implementation::PushData(
+    Ring &_ring)
+{
+  if (_ring.count == _ring.items.size())
+  {
+    // Grow the ring, keeping the messages in order.
+    std::vector<LogData> items(std::max<std::size_t>(64, 2 * _ring.count));
+    for (std::size_t i = 0; i < _ring.count; ++i)
+    {
+      items[i] = std::move(
+        _ring.items[(_ring.head + i) % _ring.items.size()]);
+    }
+    _ring.items.swap(items);
+    _ring.head = 0;
+  }
+
+  const std::size_t tail = (_ring.head + _ring.count) % _ring.items.size();
+  ++_ring.count;
+  ++this->queueCount;
+  return _ring.items[tail];
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::PopData(Ring &_ring, LogData &_data)
+{
+  _data = std::move(_ring.items[_ring.head]);
+  _ring.head = (_ring.head + 1) % _ring.items.size();
+  --_ring.count;
+  --this->queueCount;
+}
+
+//////////////////////////////////////////////////
+Recorder::Implementation::Ring *Recorder::Implementation::OldestRing(
+    Writer &_writer)
 {
-  std::lock_guard<std::mutex> logLock(this->logFileMutex);
-  // Note: this->logFile will only be a nullptr before Start() has been
+  Ring &dataQueue = _writer.dataQueue;
+  Ring &lowPriorityQueue = _writer.lowPriorityQueue;
+  if (lowPriorityQueue.count == 0)
+    return dataQueue.count > 0 ? &dataQueue : nullptr;
+  if (dataQueue.count == 0)
+    return &lowPriorityQueue;
+
+  const LogData &data = dataQueue.items[dataQueue.head];
+  const LogData &lowPriority = lowPriorityQueue.items[lowPriorityQueue.head];
+  return data.sequence < lowPriority.sequence ?
+    &dataQueue : &lowPriorityQueue;
+}
+
+//////////////////////////////////////////////////
+Recorder::Implementation::Ring *Recorder::Implementation::OldestRing(
+    bool _lowPriority)
+{
+  Ring *oldest = nullptr;
+  for (auto &writer : this->writers)
+  {
+    Ring &ring = _lowPriority ? writer->lowPriorityQueue : writer->dataQueue;
+    if (ring.count > 0 && (!oldest ||
+          ring.items[ring.head].sequence <
+          oldest->items[oldest->head].sequence))
+    {
+      oldest = &ring;
+    }
+  }
+  return oldest;
+}
+
+//////////////////////////////////////////////////
+Recorder::Implementation::Ring *Recorder::Implementation::OldestRing()
+{
+  Ring *lowPriority = this->OldestRing(true);
+  Ring *normal = this->OldestRing(false);
+  if (!lowPriority || !normal)
+    return lowPriority ? lowPriority : normal;
+
+  return lowPriority->items[lowPriority->head].sequence <
+    normal->items[normal->head].sequence ? lowPriority : normal;
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::PopWindow(uint64_t _end,
+    std::vector<LogData> &_batch)
+{
+  // Keep the capacity of the batch
+  _batch.clear();
+  while (_batch.size() < kWriteBatchSize)
+  {
+    Ring *ring = this->OldestRing();
+    if (!ring || ring->items[ring->head].sequence >= _end)
+      break;
+
+    _batch.emplace_back();
+    this->PopData(*ring, _batch.back());
+    this->DecrementBufferSize(_batch.back().len);
+  }
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::ClearDataQueue()
+{
+  for (auto &writer : this->writers)
+  {
+    for (Ring *ring : {&writer->dataQueue, &writer->lowPriorityQueue})
+    {
+      while (ring->count > 0)
+      {
+        LogData logData;
+        this->PopData(*ring, logData);
+        this->DecrementBufferSize(logData.len);
+        this->ReleaseData(logData);
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::DropData(Ring &_ring)
+{
+  LogData dropped;
+  this->PopData(_ring, dropped);
+  this->DecrementBufferSize(dropped.len);
+  // The messages leaving the window of the black box aren't lost
+  if (!this->blackBox)
+    this->CountDrop(*dropped.slot, dropped.len);
+  this->ReleaseData(dropped);
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::CountDrop(TopicSlot &_slot, std::size_t _len)
+{
+  ++this->stats.droppedMsgs;
+  this->stats.droppedBytes += _len;
+  ++_slot.stats.droppedMsgs;
+  _slot.stats.droppedBytes += _len;
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::StoreData(const char *_data, std::size_t _len,
+    LogData &_logData)
+{
+  _logData.len = _len;
+  if (_len > kSlabSize)
+  {
+    _logData.slab = nullptr;
+    _logData.oversized.reset(new char[_len]);
+    memcpy(_logData.oversized.get(), _data, _len);
+    _logData.data = _logData.oversized.get();
+    return;
+  }
+
+  if (!this->currentSlab ||
+      this->currentSlab->capacity - this->currentSlab->used < _len)
+  {
+    // The current slab is reused once its pending messages are released.
+    if (this->currentSlab && this->currentSlab->pending == 0)
+    {
+      this->currentSlab->used = 0;
+      this->freeSlabs.push_back(this->currentSlab);
+    }
+
+    if (this->freeSlabs.empty())
+    {
+      auto slab = std::make_unique<Slab>();
+      slab->bytes.reset(new char[kSlabSize]);
+      slab->capacity = kSlabSize;
+      this->freeSlabs.push_back(slab.get());
+      this->slabs.push_back(std::move(slab));
+    }
+    this->currentSlab = this->freeSlabs.back();
+    this->freeSlabs.pop_back();
+  }
+
+  Slab *slab = this->currentSlab;
+  char *dst = slab->bytes.get() + slab->used;
+  memcpy(dst, _data, _len);
+  slab->used += _len;
+  ++slab->pending;
+
+  _logData.slab = slab;
+  _logData.oversized.reset();
+  _logData.data = dst;
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::ReleaseData(LogData &_logData)
+{
+  Slab *slab = _logData.slab;
+  _logData.slab = nullptr;
+  _logData.data = nullptr;
+  _logData.oversized.reset();
+  if (!slab || --slab->pending > 0)
+    return;
+
+  // The current slab is rewound in place, the others are reused later.
+  slab->used = 0;
+  if (slab != this->currentSlab)
+    this->freeSlabs.push_back(slab);
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::WriteToLogFile(Writer &_writer,
+    const std::vector<LogData> &_batch)
+{
+  std::lock_guard<std::mutex> logLock(_writer.mutex);
+  // Note: _writer.logFile will only be a nullptr before Start() has been
   // called or after Stop() has been called. If it is a nullptr, then we are
   // not recording anything yet, so we can just skip inserting the message.
-  if (this->logFile &&
-      !this->logFile->InsertMessage(
-        _logData.stamp, _logData.msgInfo.Topic(), _logData.msgInfo.Type(),
-        reinterpret_cast<const void *>(_logData.msgData.data()),
-        _logData.msgData.size()))
+  if (!_writer.logFile)
+    return;
+
+  _writer.records.clear();
+  for (const auto &logData : _batch)
   {
-    LWRN("Failed to insert message into log file\n");
+    if (this->TimeToSplit(_writer, logData))
+      this->Split(_writer);
+
+    if (_writer.partMessages++ == 0)
+      _writer.partStart = logData.stamp;
+    _writer.partBytes += logData.len;
+
+    // Resolve the id of the topic once per log file and message type.
+    TopicSlot &slot = *logData.slot;
+    if (slot.id < 0 || slot.logGeneration != _writer.logGeneration ||
+        slot.type != *logData.type)
+    {
+      slot.type = *logData.type;
+      slot.id = _writer.logFile->InsertOrGetTopicId(*logData.topic, slot.type);
+      slot.logGeneration = _writer.logGeneration;
+    }
+
+    Log::MessageRecord record;
+    record.time = logData.stamp;
+    record.topic = *logData.topic;
+    record.type = *logData.type;
+    record.data = reinterpret_cast<const void *>(logData.data);
+    record.len = logData.len;
+    record.topicId = slot.id;
+    _writer.records.push_back(record);
   }
+
+  this->InsertRecords(_writer);
   // TODO(anyone) It would be nice for testing to simulate long delays
   // associated with disk writes. In the mean time, a sleep can be added here
   // for testing.
   // std::this_thread::sleep_for(std::chrono::milliseconds(30));
 }
 
+//////////////////////////////////////////////////
+void Recorder::Implementation::InsertRecords(Writer &_writer)
+{
+  if (_writer.records.empty())
+    return;
+
+  const std::size_t inserted =
+    _writer.logFile->InsertMessages(_writer.records);
+  this->writtenMsgs += inserted;
+  this->failedMsgs += _writer.records.size() - inserted;
+  if (inserted < _writer.records.size())
+  {
+    LWRN("Failed to insert " << _writer.records.size() - inserted
+         << " messages into log file [" << _writer.filename << "]\n");
+  }
+  _writer.records.clear();
+}
+
+//////////////////////////////////////////////////
+bool Recorder::Implementation::TimeToSplit(const Writer &_writer,
+    const LogData &_logData) const
+{
+  // Every part has at least one message, and a stream has a single part
+  if (_writer.partMessages == 0 || this->remote)
+    return false;
+
+  const std::size_t size = this->splitSize;
+  if (size > 0 && _writer.partBytes + _logData.len > size)
+    return true;
+
+  const std::chrono::nanoseconds duration = this->splitDuration;
+  return duration > std::chrono::nanoseconds::zero() &&
+    _logData.stamp - _writer.partStart >= duration;
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::Split(Writer &_writer)
+{
+  this->InsertRecords(_writer);
+
+  // Start counting again even if the next part can't be created, so it's
+  // tried again once the current file reaches the limits.
+  _writer.partBytes = 0;
+  _writer.partMessages = 0;
+
+  const std::string file =
+    Log::PartFilename(_writer.filename, _writer.part + 1);
+  std::unique_ptr<Log> next(new Log());
+  if (!next->Open(file, std::ios_base::out, this->logOptions))
+  {
+    LERR("Failed to create file [" << file << "], recording continues in ["
+         << _writer.logFile->Filename() << "]\n");
+    return;
+  }
+
+  // Closing the previous part commits its last messages
+  const std::string previous = _writer.logFile->Filename();
+  ++_writer.part;
+  _writer.logFile = std::move(next);
+  _writer.logGeneration = ++this->logGenerations;
+  LMSG("Continued recording in [" << file << "]\n");
+  this->Finalize(previous, this->logOptions);
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::Finalize(const std::string &_file,
+    const LogOptions &_options)
+{
+  if (!_options.DeferIndexes() || this->remote ||
+      _options.FileFormat() != LogOptions::Format::SQLITE)
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(this->finalizeMutex);
+  this->finalizeQueue.push_back(_file);
+  if (this->finalizing)
+    return;
+
+  // The previous thread emptied the queue and is exiting
+  if (this->finalizeThread.joinable())
+    this->finalizeThread.join();
+  this->finalizing = true;
+  this->finalizeThread =
+    std::thread(&Recorder::Implementation::FinalizeThread, this);
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::FinalizeThread()
+{
+  std::unique_lock<std::mutex> lock(this->finalizeMutex);
+  while (!this->finalizeQueue.empty())
+  {
+    const std::string file = std::move(this->finalizeQueue.front());
+    this->finalizeQueue.pop_front();
+    lock.unlock();
+
+    LDBG("Finalizing [" << file << "]\n");
+    if (Log::Finalize(file))
+      LDBG("Finalized [" << file << "]\n");
+
+    lock.lock();
+  }
+  this->finalizing = false;
+  this->finalizeDone.notify_all();
+}
+
+//////////////////////////////////////////////////
+void Recorder::Implementation::WaitUntilFinalized()
+{
+  std::unique_lock<std::mutex> lock(this->finalizeMutex);
+  this->finalizeDone.wait(lock, [this]{return !this->finalizing;});
+  if (this->finalizeThread.joinable())
+    this->finalizeThread.join();
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::Implementation::Dump(const std::string &_file,
+    const LogOptions &_options)
+{
+  std::lock_guard<std::mutex> lock(this->logFileMutex);
+  if (!this->recording || !this->blackBox)
+  {
+    LERR("No black box recording is in progress\n");
+    return RecorderError::NOT_RECORDING;
+  }
+
+  Implementation::Writer writer;
+  writer.filename = _file;
+  writer.logFile.reset(new Log());
+  writer.logGeneration = ++this->logGenerations;
+  if (!writer.logFile->Open(_file, std::ios_base::out, _options))
+  {
+    LERR("Failed to open or create file [" << _file << "]\n");
+    return RecorderError::FAILED_TO_OPEN;
+  }
+  // The parts of a split dump have the same settings
+  this->logOptions = _options;
+
+  // The messages that keep arriving aren't part of the dump, so it ends
+  std::vector<Implementation::LogData> batch;
+  uint64_t end = 0;
+  {
+    std::lock_guard<std::mutex> queueLock(this->dataQueueMutex);
+    end = this->nextSequence;
+    this->PopWindow(end, batch);
+  }
+
+  const uint64_t written = this->writtenMsgs;
+  while (!batch.empty())
+  {
+    this->WriteToLogFile(writer, batch);
+
+    std::lock_guard<std::mutex> queueLock(this->dataQueueMutex);
+    for (auto &logData : batch)
+      this->ReleaseData(logData);
+    this->PopWindow(end, batch);
+  }
+
+  LMSG("Dumped " << this->writtenMsgs - written
+       << " messages to [" << writer.logFile->Filename() << "]\n");
+
+  // Closing the last part commits its messages
+  const std::string last = writer.logFile->Filename();
+  writer.logFile.reset();
+  this->Finalize(last, _options);
+  return RecorderError::SUCCESS;
+}
+
 //////////////////////////////////////////////////
 Recorder::Recorder()
   : dataPtr(new Implementation)
@@ -457,7 +1321,8 @@ Recorder::~Recorder()
 
 //////////////////////////////////////////////////
 RecorderError Recorder::Sync(const Clock *_clockIn) {
-  if (this->dataPtr->logFile)
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  if (this->dataPtr->recording)
   {
     LERR("Recording is already in progress\n");
     return RecorderError::ALREADY_RECORDING;
@@ -468,46 +1333,291 @@ RecorderError Recorder::Sync(const Clock *_clockIn) {
 
 //////////////////////////////////////////////////
 RecorderError Recorder::Start(const std::string &_file)
+{
+  return this->Start(_file, LogOptions());
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::Start(const std::string &_file,
+    const LogOptions &_options)
 {
   std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
-  if (this->dataPtr->logFile)
+  if (this->dataPtr->recording)
   {
     LWRN("Recording is already in progress\n");
     return RecorderError::ALREADY_RECORDING;
   }
 
-  this->dataPtr->logFile.reset(new Log());
-  if (!this->dataPtr->logFile->Open(_file, std::ios_base::out))
+  // The groups can't change while recording, see AddTopicGroup()
+  std::vector<std::string> files{_file};
   {
-    LERR("Failed to open or create file [" << _file << "]\n");
-    this->dataPtr->logFile.reset(nullptr);
+    std::lock_guard<std::mutex> queueLock(this->dataPtr->dataQueueMutex);
+    for (const auto &group : this->dataPtr->groups)
+      files.push_back(Log::GroupFilename(_file, group.first));
+  }
+
+  std::vector<std::unique_ptr<Implementation::Writer>> writers;
+  for (const std::string &file : files)
+  {
+    auto writer = std::make_unique<Implementation::Writer>();
+    writer->filename = file;
+    writer->logFile.reset(new Log());
+    writer->logGeneration = ++this->dataPtr->logGenerations;
+    if (!writer->logFile->Open(file, std::ios_base::out, _options))
+    {
+      LERR("Failed to open or create file [" << file << "]\n");
+      return RecorderError::FAILED_TO_OPEN;
+    }
+    writers.push_back(std::move(writer));
+  }
+
+  if (files.size() > 1 && !WriteManifest(ManifestFilename(_file), files))
+  {
+    LERR("Failed to write manifest [" << ManifestFilename(_file) << "]\n");
     return RecorderError::FAILED_TO_OPEN;
   }
 
+  this->dataPtr->logOptions = _options;
+
+  {
+    std::lock_guard<std::mutex> queueLock(this->dataPtr->dataQueueMutex);
+    // Nothing is left in the queues of the previous recording, unless it
+    // was never started
+    this->dataPtr->ClearDataQueue();
+    this->dataPtr->writers.swap(writers);
+    this->dataPtr->remote = false;
+
+    // The counters are those of the new recording
+    this->dataPtr->stats = Statistics();
+    for (auto &slot : this->dataPtr->slots)
+    {
+      slot.second->stats = TopicStatistics();
+      slot.second->group = this->dataPtr->GroupOf(slot.first);
+    }
+  }
+  this->dataPtr->writtenMsgs = 0;
+  this->dataPtr->failedMsgs = 0;
+
+  this->dataPtr->recording = true;
   this->dataPtr->StartDataWriter();
   LMSG("Started recording to [" << _file << "]\n");
 
   return RecorderError::SUCCESS;
 }
 
+//////////////////////////////////////////////////
+RecorderError Recorder::StartRemote(const std::string &_service,
+    const LogOptions &_options, std::size_t _spillSize)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  if (this->dataPtr->recording)
+  {
+    LWRN("Recording is already in progress\n");
+    return RecorderError::ALREADY_RECORDING;
+  }
+
+  LogOptions options = _options;
+  options.SetFileFormat(LogOptions::Format::CHUNKED);
+
+  // Shift by 20 to convert to bytes
+  auto sender = std::make_unique<ChunkSender>(_service, _spillSize << 20);
+  ChunkSender *chunkSender = sender.get();
+  auto writer = std::make_unique<Implementation::Writer>();
+  writer->filename = _service;
+  writer->logFile.reset(new Log());
+  writer->logGeneration = ++this->dataPtr->logGenerations;
+  if (!writer->logFile->OpenStream(_service,
+        [chunkSender](const char *_data, std::size_t _size)
+        {
+          return chunkSender->Push(_data, _size);
+        }, options))
+  {
+    LERR("Failed to create the log streamed to [" << _service << "]\n");
+    return RecorderError::FAILED_TO_OPEN;
+  }
+  std::vector<std::unique_ptr<Implementation::Writer>> writers;
+  writers.push_back(std::move(writer));
+
+  this->dataPtr->logOptions = options;
+
+  {
+    std::lock_guard<std::mutex> queueLock(this->dataPtr->dataQueueMutex);
+    // Nothing is left in the queues of the previous recording, unless it
+    // was never started
+    this->dataPtr->ClearDataQueue();
+    this->dataPtr->writers.swap(writers);
+    this->dataPtr->sender = std::move(sender);
+    this->dataPtr->remote = true;
+
+    // The counters are those of the new recording
+    this->dataPtr->stats = Statistics();
+    for (auto &slot : this->dataPtr->slots)
+    {
+      slot.second->stats = TopicStatistics();
+      slot.second->group = this->dataPtr->GroupOf(slot.first);
+    }
+  }
+  this->dataPtr->writtenMsgs = 0;
+  this->dataPtr->failedMsgs = 0;
+
+  this->dataPtr->recording = true;
+  this->dataPtr->StartDataWriter();
+  LMSG("Started recording to the log server [" << _service << "]\n");
+
+  return RecorderError::SUCCESS;
+}
+
 //////////////////////////////////////////////////
 void Recorder::Stop()
 {
+  bool blackBox = false;
   {
     std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
-    // If the logFile is null, the recorder has already stopped.
-    if (nullptr == this->dataPtr->logFile)
+    // If not recording, the recorder has already stopped.
+    if (!this->dataPtr->recording)
       return;
+    blackBox = this->dataPtr->blackBox;
   }
   this->dataPtr->stopQueue = true;
   this->dataPtr->StopDataWriter();
-  // If there is any data left in the dataQueue, write it all to disk
-  LMSG("Log Recorder finalizing log file. This might take some time...");
-  this->dataPtr->FlushDataQueue();
-  LMSG("Done\n");
+
+  if (blackBox)
+  {
+    // The window of the black box is only written by Dump()
+    std::lock_guard<std::mutex> queueLock(this->dataPtr->dataQueueMutex);
+    this->dataPtr->ClearDataQueue();
+  }
+  else
+  {
+    // If there is any data left in the queues, write it all to disk
+    LMSG("Log Recorder finalizing log file. This might take some time...");
+    this->dataPtr->FlushDataQueue();
+    LMSG("Done\n");
+  }
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  for (auto &writer : this->dataPtr->writers)
+  {
+    std::lock_guard<std::mutex> writerLock(writer->mutex);
+    const std::string file =
+      writer->logFile ? writer->logFile->Filename() : "";
+    writer->logFile.reset(nullptr);
+    if (!file.empty())
+      this->dataPtr->Finalize(file, this->dataPtr->logOptions);
+  }
+
+  // Closing the log queued its last chunk
+  if (this->dataPtr->remote && this->dataPtr->sender)
+  {
+    LMSG("Sending the last chunks to the log server...");
+    this->dataPtr->sender->Close(kRemoteCloseTimeout);
+    LMSG("Done\n");
+  }
+  {
+    std::lock_guard<std::mutex> queueLock(this->dataPtr->dataQueueMutex);
+    this->dataPtr->blackBox = false;
+  }
+  this->dataPtr->recording = false;
+}
+
+//////////////////////////////////////////////////
+void Recorder::WaitUntilFinalized()
+{
+  this->dataPtr->WaitUntilFinalized();
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::StartBlackBox(const std::chrono::nanoseconds &_window,
+    std::size_t _size)
+{
+  if (_window <= std::chrono::nanoseconds::zero() && _size == 0)
+  {
+    LERR("The black box needs a time or a size to keep\n");
+    return RecorderError::INVALID_TOPIC;
+  }
 
   std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
-  this->dataPtr->logFile.reset(nullptr);
+  if (this->dataPtr->recording)
+  {
+    LWRN("Recording is already in progress\n");
+    return RecorderError::ALREADY_RECORDING;
+  }
+
+  {
+    std::lock_guard<std::mutex> queueLock(this->dataPtr->dataQueueMutex);
+    this->dataPtr->ClearDataQueue();
+
+    // The writers only sort the topics in the groups, they have no file
+    std::vector<std::unique_ptr<Implementation::Writer>> writers;
+    for (std::size_t i = 0; i <= this->dataPtr->groups.size(); ++i)
+      writers.push_back(std::make_unique<Implementation::Writer>());
+    this->dataPtr->writers.swap(writers);
+    this->dataPtr->remote = false;
+
+    this->dataPtr->blackBox = true;
+    this->dataPtr->blackBoxWindow =
+      std::max(_window, std::chrono::nanoseconds::zero());
+    // Shift by 20 to convert to bytes
+    this->dataPtr->blackBoxBytes = _size << 20;
+
+    // Allocate the whole window now
+    while (this->dataPtr->slabs.size() * Implementation::kSlabSize <
+           this->dataPtr->blackBoxBytes)
+    {
+      auto slab = std::make_unique<Implementation::Slab>();
+      slab->bytes.reset(new char[Implementation::kSlabSize]);
+      slab->capacity = Implementation::kSlabSize;
+      this->dataPtr->freeSlabs.push_back(slab.get());
+      this->dataPtr->slabs.push_back(std::move(slab));
+    }
+
+    // The counters are those of the new recording
+    this->dataPtr->stats = Statistics();
+    for (auto &slot : this->dataPtr->slots)
+    {
+      slot.second->stats = TopicStatistics();
+      slot.second->group = this->dataPtr->GroupOf(slot.first);
+    }
+  }
+  this->dataPtr->writtenMsgs = 0;
+  this->dataPtr->failedMsgs = 0;
+
+  this->dataPtr->recording = true;
+  // Queue the messages without writer threads
+  this->dataPtr->dataWriterState = true;
+  LMSG("Started black box recording\n");
+
+  return RecorderError::SUCCESS;
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::Dump(const std::string &_file,
+    const LogOptions &_options)
+{
+  return this->dataPtr->Dump(_file, _options);
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::AdvertiseDumpService(const std::string &_service)
+{
+  // The implementation outlives a move of the recorder
+  Implementation *impl = this->dataPtr.get();
+  std::function<bool(const ignition::msgs::StringMsg &,
+                     ignition::msgs::Boolean &)> cb =
+    [impl](const ignition::msgs::StringMsg &_req,
+           ignition::msgs::Boolean &_rep)
+    {
+      _rep.set_data(
+        impl->Dump(_req.data(), LogOptions()) == RecorderError::SUCCESS);
+      return true;
+    };
+
+  if (!impl->node.Advertise(_service, cb))
+  {
+    LERR("Failed to advertise service [" << _service << "]\n");
+    return RecorderError::INVALID_TOPIC;
+  }
+  return RecorderError::SUCCESS;
 }
 
 //////////////////////////////////////////////////
@@ -522,11 +1632,63 @@ int64_t Recorder::AddTopic(const std::regex &_topic)
   return this->dataPtr->AddTopic(_topic);
 }
 
+//////////////////////////////////////////////////
+RecorderError Recorder::AddTopic(const std::string &_topic,
+    const uint64_t _msgsPerSec)
+{
+  return this->dataPtr->AddTopic(_topic, _msgsPerSec);
+}
+
+//////////////////////////////////////////////////
+int64_t Recorder::AddTopic(const std::regex &_topic,
+    const uint64_t _msgsPerSec)
+{
+  return this->dataPtr->AddTopic(_topic, _msgsPerSec);
+}
+
+//////////////////////////////////////////////////
+RecorderError Recorder::AddTopicGroup(const std::string &_name,
+    const std::regex &_topics)
+{
+  // The name must make a file name that no other part of a recording uses
+  if (_name.empty() || _name.find_first_of("/\\") != std::string::npos ||
+      _name.find_first_not_of("0123456789") == std::string::npos)
+  {
+    LERR("Invalid topic group name [" << _name << "]\n");
+    return RecorderError::INVALID_TOPIC;
+  }
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  if (this->dataPtr->recording)
+  {
+    LERR("Recording is already in progress\n");
+    return RecorderError::ALREADY_RECORDING;
+  }
+
+  std::lock_guard<std::mutex> queueLock(this->dataPtr->dataQueueMutex);
+  for (const auto &group : this->dataPtr->groups)
+  {
+    if (group.first == _name)
+    {
+      LERR("Topic group [" << _name << "] already exists\n");
+      return RecorderError::INVALID_TOPIC;
+    }
+  }
+  this->dataPtr->groups.emplace_back(_name, _topics);
+  return RecorderError::SUCCESS;
+}
+
 //////////////////////////////////////////////////
 std::string Recorder::Filename() const
 {
-  return this->dataPtr->logFile == nullptr ? "" :
-         this->dataPtr->logFile->Filename();
+  // The log file changes when the recording is split
+  std::lock_guard<std::mutex> lock(this->dataPtr->logFileMutex);
+  if (!this->dataPtr->recording)
+    return "";
+
+  Implementation::Writer &writer = *this->dataPtr->writers.front();
+  std::lock_guard<std::mutex> writerLock(writer.mutex);
+  return writer.logFile == nullptr ? "" : writer.logFile->Filename();
 }
 
 //////////////////////////////////////////////////
@@ -548,3 +1710,82 @@ void Recorder::SetBufferSize(std::size_t _size)
   // Shift by 20 to convert to bytes
   this->dataPtr->maxBufferSize = _size << 20;
 }
+
+//////////////////////////////////////////////////
+void Recorder::SetLowPriorityTopic(const std::string &_topic,
+    bool _lowPriority)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->dataQueueMutex);
+  if (_lowPriority)
+    this->dataPtr->lowPriorityTopics.insert(_topic);
+  else
+    this->dataPtr->lowPriorityTopics.erase(_topic);
+
+  // The messages already queued keep their priority
+  auto slot = this->dataPtr->slots.find(_topic);
+  if (slot != this->dataPtr->slots.end())
+    slot->second->lowPriority = _lowPriority;
+}
+
+//////////////////////////////////////////////////
+bool Recorder::IsLowPriorityTopic(const std::string &_topic) const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->dataQueueMutex);
+  return this->dataPtr->lowPriorityTopics.count(_topic) > 0;
+}
+
+//////////////////////////////////////////////////
+Recorder::Statistics Recorder::Stats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->dataQueueMutex);
+  Statistics stats = this->dataPtr->stats;
+  stats.writtenMsgs = this->dataPtr->writtenMsgs;
+  stats.failedMsgs = this->dataPtr->failedMsgs;
+  stats.bufferedBytes = this->dataPtr->bufferSize;
+  stats.queuedMsgs = this->dataPtr->queueCount;
+  if (this->dataPtr->sender)
+  {
+    stats.sentChunks = this->dataPtr->sender->Sent();
+    stats.droppedChunks = this->dataPtr->sender->Dropped();
+    stats.spilledBytes = this->dataPtr->sender->Spilled();
+  }
+
+  // The lag of the writer that is the furthest behind
+  for (auto &writer : this->dataPtr->writers)
+  {
+    Implementation::Ring *oldest = this->dataPtr->OldestRing(*writer);
+    if (oldest)
+    {
+      stats.writerLag = std::max(stats.writerLag,
+          this->dataPtr->clock->Time() - oldest->items[oldest->head].stamp);
+    }
+  }
+
+  for (const auto &slot : this->dataPtr->slots)
+    stats.topics[slot.first] = slot.second->stats;
+  return stats;
+}
+
+//////////////////////////////////////////////////
+std::size_t Recorder::SplitSize() const
+{
+  return this->dataPtr->splitSize;
+}
+
+//////////////////////////////////////////////////
+void Recorder::SetSplitSize(std::size_t _size)
+{
+  this->dataPtr->splitSize = _size;
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds Recorder::SplitDuration() const
+{
+  return this->dataPtr->splitDuration;
+}
+
+//////////////////////////////////////////////////
+void Recorder::SetSplitDuration(const std::chrono::nanoseconds &_duration)
+{
+  this->dataPtr->splitDuration = _duration;
+}
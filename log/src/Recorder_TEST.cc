@@ -15,6 +15,7 @@
  *
 */
 
+#include <chrono>
 #include <regex>
 #include <string>
 
@@ -103,6 +104,107 @@ TEST(Record, SetBufferSize)
   EXPECT_EQ(40u, recorder.BufferSize());
 }
 
+//////////////////////////////////////////////////
+TEST(Record, SetSplit)
+{
+  transport::log::Recorder recorder;
+  EXPECT_EQ(0u, recorder.SplitSize());
+  EXPECT_EQ(std::chrono::nanoseconds::zero(), recorder.SplitDuration());
+
+  recorder.SetSplitSize(1 << 20);
+  EXPECT_EQ(1u << 20, recorder.SplitSize());
+
+  recorder.SetSplitDuration(std::chrono::seconds(30));
+  EXPECT_EQ(std::chrono::seconds(30), recorder.SplitDuration());
+}
+
+//////////////////////////////////////////////////
+TEST(Record, LowPriorityTopic)
+{
+  transport::log::Recorder recorder;
+  EXPECT_FALSE(recorder.IsLowPriorityTopic("/foo"));
+
+  // Before and after subscribing
+  recorder.SetLowPriorityTopic("/foo");
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/foo")));
+  EXPECT_TRUE(recorder.IsLowPriorityTopic("/foo"));
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/bar")));
+  recorder.SetLowPriorityTopic("/bar");
+  EXPECT_TRUE(recorder.IsLowPriorityTopic("/bar"));
+
+  recorder.SetLowPriorityTopic("/foo", false);
+  EXPECT_FALSE(recorder.IsLowPriorityTopic("/foo"));
+}
+
+//////////////////////////////////////////////////
+TEST(Record, AddTopicGroup)
+{
+  transport::log::Recorder recorder;
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopicGroup("camera", std::regex("/camera/.*")));
+
+  // The names make file names of their own
+  EXPECT_EQ(transport::log::RecorderError::INVALID_TOPIC,
+      recorder.AddTopicGroup("camera", std::regex("/other")));
+  EXPECT_EQ(transport::log::RecorderError::INVALID_TOPIC,
+      recorder.AddTopicGroup("", std::regex("/other")));
+  EXPECT_EQ(transport::log::RecorderError::INVALID_TOPIC,
+      recorder.AddTopicGroup("a/b", std::regex("/other")));
+  EXPECT_EQ(transport::log::RecorderError::INVALID_TOPIC,
+      recorder.AddTopicGroup("12", std::regex("/other")));
+}
+
+//////////////////////////////////////////////////
+TEST(Record, Stats)
+{
+  transport::log::Recorder recorder;
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.AddTopic(std::string("/foo")));
+  EXPECT_EQ(
+      transport::log::RecorderError::SUCCESS, recorder.Start(":memory:"));
+
+  const auto stats = recorder.Stats();
+  EXPECT_EQ(0u, stats.receivedMsgs);
+  EXPECT_EQ(0u, stats.droppedMsgs);
+  EXPECT_EQ(0u, stats.queuedMsgs);
+  ASSERT_EQ(1u, stats.topics.size());
+  EXPECT_EQ(0u, stats.topics.at("/foo").droppedMsgs);
+}
+
+//////////////////////////////////////////////////
+TEST(Record, BlackBox)
+{
+  transport::log::Recorder recorder;
+  EXPECT_EQ(transport::log::RecorderError::NOT_RECORDING,
+      recorder.Dump(":memory:"));
+  EXPECT_EQ(transport::log::RecorderError::INVALID_TOPIC,
+      recorder.StartBlackBox(std::chrono::seconds(0), 0));
+
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.StartBlackBox(std::chrono::seconds(30), 8));
+  EXPECT_EQ(transport::log::RecorderError::ALREADY_RECORDING,
+      recorder.StartBlackBox(std::chrono::seconds(30), 8));
+  EXPECT_EQ(transport::log::RecorderError::ALREADY_RECORDING,
+      recorder.Start(":memory:"));
+  EXPECT_TRUE(recorder.Filename().empty());
+
+  EXPECT_EQ(transport::log::RecorderError::SUCCESS,
+      recorder.Dump(":memory:"));
+  EXPECT_EQ(transport::log::RecorderError::FAILED_TO_OPEN,
+      recorder.Dump("//////////"));
+
+  // A file recording doesn't dump
+  recorder.Stop();
+  EXPECT_EQ(transport::log::RecorderError::NOT_RECORDING,
+      recorder.Dump(":memory:"));
+  EXPECT_EQ(
+      transport::log::RecorderError::SUCCESS, recorder.Start(":memory:"));
+  EXPECT_EQ(transport::log::RecorderError::NOT_RECORDING,
+      recorder.Dump(":memory:"));
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -17,16 +17,25 @@
 
 #include "LogCommandAPI.hh"
 
+#include <chrono>
 #include <csignal>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
+#include <map>
 #include <regex>
 #include <string>
+#include <vector>
 
 #include <ignition/transport/log/Export.hh>
+#include <ignition/transport/log/Log.hh>
+#include <ignition/transport/log/LogOptions.hh>
+#include <ignition/transport/log/LogServer.hh>
 #include <ignition/transport/log/Playback.hh>
 #include <ignition/transport/log/Recorder.hh>
 #include <ignition/transport/Node.hh>
 #include <ignition/transport/NodeOptions.hh>
+#include "../ColumnExport.hh"
 #include "../Console.hh"
 
 using namespace ignition;
@@ -44,9 +53,55 @@ int verbosity(int _level)
   return SUCCESS;
 }
 
+//////////////////////////////////////////////////
+/// \brief Look up the value of an option by its name.
+/// \param[in] _name Name of the value given on the command line
+/// \param[in] _values Values by name
+/// \param[in] _option Name of the option, for the error message
+/// \param[out] _value The value
+/// \return true if the name is known
+template<typename T>
+static bool parseOption(const std::string &_name,
+    const std::map<std::string, T> &_values, const std::string &_option,
+    T &_value)
+{
+  auto it = _values.find(_name);
+  if (it == _values.end())
+  {
+    LERR("Invalid " << _option << " [" << _name << "]\n");
+    return false;
+  }
+  _value = it->second;
+  return true;
+}
+
 //////////////////////////////////////////////////
 int recordTopics(const char *_file, const char *_pattern)
 {
+  return recordTopicsWithOptions(_file, _pattern, "sqlite", "none", 0, 0, 0,
+    0, 0, "", "");
+}
+
+//////////////////////////////////////////////////
+int recordTopicsWithOptions(const char *_file, const char *_pattern,
+  const char *_format, const char *_compression, const int _compressionLevel,
+  const int _bufferSize, const double _splitSize, const double _splitDuration,
+  int _highThroughput, const char *_journal, const char *_sync)
+{
+  return recordTopicsWithRemote(_file, _pattern, _format, _compression,
+    _compressionLevel, _bufferSize, _splitSize, _splitDuration,
+    _highThroughput, _journal, _sync, "", 0, 0);
+}
+
+//////////////////////////////////////////////////
+int recordTopicsWithRemote(const char *_file, const char *_pattern,
+  const char *_format, const char *_compression, const int _compressionLevel,
+  const int _bufferSize, const double _splitSize, const double _splitDuration,
+  int _highThroughput, const char *_journal, const char *_sync,
+  const char *_remote, const int _spillSize, int _deferIndexes)
+{
+  using LogOptions = transport::log::LogOptions;
+
   std::regex regexPattern;
   try
   {
@@ -58,18 +113,98 @@ int recordTopics(const char *_file, const char *_pattern)
     return BAD_REGEX;
   }
 
+  LogOptions options;
+  if (_highThroughput > 0)
+    options = LogOptions::HighThroughput();
+
+  LogOptions::Format format;
+  LogOptions::Compression compression;
+  if (!parseOption(_format, {{"sqlite", LogOptions::Format::SQLITE},
+                             {"chunked", LogOptions::Format::CHUNKED}},
+                   "format", format) ||
+      !parseOption(_compression, {{"none", LogOptions::Compression::NONE},
+                                  {"zlib", LogOptions::Compression::ZLIB}},
+                   "compression", compression))
+  {
+    return INVALID_OPTION;
+  }
+  options.SetFileFormat(format);
+  options.SetMessageCompression(compression);
+
+  // The empty names keep the mode of the profile.
+  LogOptions::JournalMode journal = options.Journal();
+  LogOptions::SyncMode sync = options.Synchronous();
+  if (!parseOption(_journal, {{"", journal},
+                              {"wal", LogOptions::JournalMode::WAL},
+                              {"memory", LogOptions::JournalMode::MEMORY},
+                              {"off", LogOptions::JournalMode::OFF}},
+                   "journal mode", journal) ||
+      !parseOption(_sync, {{"", sync},
+                           {"off", LogOptions::SyncMode::OFF},
+                           {"normal", LogOptions::SyncMode::NORMAL},
+                           {"full", LogOptions::SyncMode::FULL}},
+                   "synchronous mode", sync))
+  {
+    return INVALID_OPTION;
+  }
+  options.SetJournal(journal);
+  options.SetSynchronous(sync);
+  options.SetDeferIndexes(_deferIndexes > 0);
+
+  if (_compressionLevel < 0 || _compressionLevel > 9)
+  {
+    LERR("Invalid compression level [" << _compressionLevel << "]\n");
+    return INVALID_OPTION;
+  }
+  if (_compressionLevel > 0)
+    options.SetCompressionLevel(_compressionLevel);
+
+  if (_bufferSize < 0 || _splitSize < 0 || _splitDuration < 0 ||
+      _spillSize < 0)
+  {
+    LERR("The buffer sizes and the split limits must not be negative\n");
+    return INVALID_OPTION;
+  }
+
   transport::log::Recorder recorder;
+  if (_bufferSize > 0)
+    recorder.SetBufferSize(static_cast<std::size_t>(_bufferSize));
+  // Like the buffer size, a MB is 2^20 bytes.
+  recorder.SetSplitSize(static_cast<std::size_t>(_splitSize * (1 << 20)));
+  recorder.SetSplitDuration(std::chrono::duration_cast<
+    std::chrono::nanoseconds>(std::chrono::duration<double>(_splitDuration)));
 
   if (recorder.AddTopic(regexPattern) < 0)
     return FAILED_TO_SUBSCRIBE;
 
-  if (recorder.Start(_file) != transport::log::RecorderError::SUCCESS)
+  const std::string remote = _remote;
+  const transport::log::RecorderError started = remote.empty() ?
+    recorder.Start(_file, options) :
+    recorder.StartRemote(remote, options,
+      _spillSize > 0 ? static_cast<std::size_t>(_spillSize) : 256u);
+  if (started != transport::log::RecorderError::SUCCESS)
     return FAILED_TO_OPEN;
 
   // Wait until signaled (SIGINT, SIGTERM)
   transport::waitForShutdown();
   LDBG("Shutting down\n");
   recorder.Stop();
+  recorder.WaitUntilFinalized();
+
+  const auto stats = recorder.Stats();
+  if (stats.droppedMsgs > 0 || stats.failedMsgs > 0)
+  {
+    LWRN("Dropped " << stats.droppedMsgs << " messages ("
+         << stats.droppedBytes << " bytes) and failed to write "
+         << stats.failedMsgs << " of " << stats.receivedMsgs
+         << " received messages\n");
+  }
+  if (stats.droppedChunks > 0)
+  {
+    LWRN("Dropped " << stats.droppedChunks << " of "
+         << stats.sentChunks + stats.droppedChunks
+         << " chunks streamed to the log server\n");
+  }
 
   return SUCCESS;
 }
@@ -83,6 +218,13 @@ void playbackSignHandler(int) // NOLINT
 //////////////////////////////////////////////////
 int playbackTopics(const char *_file, const char *_pattern, const int _wait_ms,
   const char *_remap, int _fast)
+{
+  return playbackTopicsAtRate(_file, _pattern, _wait_ms, _remap, _fast, 1.0);
+}
+
+//////////////////////////////////////////////////
+int playbackTopicsAtRate(const char *_file, const char *_pattern,
+  const int _wait_ms, const char *_remap, int _fast, const double _rate)
 {
   std::regex regexPattern;
   try
@@ -112,13 +254,17 @@ int playbackTopics(const char *_file, const char *_pattern, const int _wait_ms,
       return INVALID_REMAP;
   }
 
-  transport::log::Playback player(_file, nodeOptions);
+  // Play the following parts of a split recording too
+  transport::log::Playback player(
+      transport::log::Log::SplitFiles(_file), nodeOptions);
   if (!player.Valid())
     return FAILED_TO_OPEN;
 
   if (player.AddTopic(regexPattern) < 0)
     return FAILED_TO_ADVERTISE;
 
+  player.SetRate(_rate);
+
   std::this_thread::sleep_for(std::chrono::milliseconds(_wait_ms));
 
   std::signal(SIGINT, playbackSignHandler);
@@ -137,3 +283,161 @@ int playbackTopics(const char *_file, const char *_pattern, const int _wait_ms,
   LDBG("Shutting down\n");
   return SUCCESS;
 }
+
+//////////////////////////////////////////////////
+/// \brief Convert a time to seconds.
+/// \param[in] _time The time
+/// \return The time in seconds
+static double toSeconds(const std::chrono::nanoseconds &_time)
+{
+  return std::chrono::duration<double>(_time).count();
+}
+
+//////////////////////////////////////////////////
+int printLogInfo(const char *_file)
+{
+  transport::log::Log logFile;
+  if (!logFile.Open(transport::log::Log::SplitFiles(_file)))
+    return FAILED_TO_OPEN;
+
+  const std::vector<transport::log::Log::TopicSummary> summaries =
+    logFile.TopicSummaries();
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  for (const auto &summary : summaries)
+  {
+    messages += summary.messages;
+    bytes += summary.bytes;
+  }
+
+  const auto start = logFile.StartTime();
+  const auto end = logFile.EndTime();
+  std::cout << std::fixed << std::setprecision(3)
+            << "File:      " << logFile.Filename() << "\n"
+            << "Version:   " << logFile.Version() << "\n"
+            << "Start:     " << toSeconds(start) << " s\n"
+            << "End:       " << toSeconds(end) << " s\n"
+            << "Duration:  " << toSeconds(end - start) << " s\n"
+            << "Messages:  " << messages << " (" << bytes << " bytes)\n"
+            << "Topics:\n";
+
+  for (const auto &summary : summaries)
+  {
+    std::cout << "  " << summary.topic << " [" << summary.type << "]: "
+              << summary.messages << " messages, " << summary.bytes
+              << " bytes";
+    const double duration = toSeconds(summary.lastTime - summary.firstTime);
+    if (summary.messages > 1 && duration > 0)
+    {
+      std::cout << ", " << std::setprecision(1)
+                << (summary.messages - 1) / duration << " Hz"
+                << std::setprecision(3);
+    }
+    std::cout << "\n";
+  }
+  return SUCCESS;
+}
+
+//////////////////////////////////////////////////
+int extractLog(const char *_file, const char *_output, const char *_pattern,
+    const double _start, const double _end)
+{
+  std::regex regexPattern;
+  try
+  {
+    regexPattern = _pattern;
+  }
+  catch (const std::regex_error &e)
+  {
+    LERR("Regex pattern is invalid\n");
+    return BAD_REGEX;
+  }
+
+  transport::log::Log logFile;
+  if (!logFile.Open(transport::log::Log::SplitFiles(_file)))
+    return FAILED_TO_OPEN;
+
+  using transport::log::QualifiedTime;
+  const auto toTime = [](const double _seconds) -> QualifiedTime
+  {
+    if (_seconds < 0)
+      return QualifiedTime();
+    return QualifiedTime(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double>(_seconds)));
+  };
+  const transport::log::TopicPattern query(regexPattern,
+      transport::log::QualifiedTimeRange(toTime(_start), toTime(_end)));
+
+  if (!logFile.Extract(_output, query))
+    return FAILED_TO_EXTRACT;
+  return SUCCESS;
+}
+
+//////////////////////////////////////////////////
+int exportLog(const char *_file, const char *_output, const char *_pattern,
+    const int _threads)
+{
+  std::regex regexPattern;
+  try
+  {
+    regexPattern = _pattern;
+  }
+  catch (const std::regex_error &e)
+  {
+    LERR("Regex pattern is invalid\n");
+    return BAD_REGEX;
+  }
+
+  if (_threads < 0)
+  {
+    LERR("Invalid number of threads [" << _threads << "]\n");
+    return INVALID_OPTION;
+  }
+
+  transport::log::Log logFile;
+  if (!logFile.Open(transport::log::Log::SplitFiles(_file)))
+    return FAILED_TO_OPEN;
+
+  if (!transport::log::ExportColumns(logFile, _output, regexPattern,
+        static_cast<std::size_t>(_threads)))
+  {
+    return FAILED_TO_EXPORT;
+  }
+  return SUCCESS;
+}
+
+//////////////////////////////////////////////////
+int serveLog(const char *_file, const char *_service)
+{
+  transport::log::LogServer server;
+  if (!server.Start(_service, _file))
+    return FAILED_TO_ADVERTISE;
+
+  // Wait until signaled (SIGINT, SIGTERM)
+  transport::waitForShutdown();
+  LDBG("Shutting down\n");
+  server.Stop();
+
+  if (server.RejectedChunks() > 0)
+  {
+    LWRN("Rejected " << server.RejectedChunks() << " of "
+         << server.ReceivedChunks() + server.RejectedChunks()
+         << " chunks\n");
+  }
+  return SUCCESS;
+}
+
+//////////////////////////////////////////////////
+int finalizeLog(const char *_file, int _vacuum)
+{
+  bool finalized = true;
+  for (const std::string &file : transport::log::Log::SplitFiles(_file))
+  {
+    if (!transport::log::Log::Finalize(file, _vacuum > 0))
+    {
+      LERR("Failed to finalize [" << file << "]\n");
+      finalized = false;
+    }
+  }
+  return finalized ? SUCCESS : FAILED_TO_FINALIZE;
+}
@@ -27,6 +27,10 @@ extern "C"
     FAILED_TO_SUBSCRIBE = 4,
     INVALID_VERSION     = 5,
     INVALID_REMAP       = 6,
+    FAILED_TO_EXTRACT   = 7,
+    INVALID_OPTION      = 8,
+    FAILED_TO_EXPORT    = 9,
+    FAILED_TO_FINALIZE  = 10,
   };
 
   /// \brief Sets verbosity of library
@@ -40,6 +44,64 @@ extern "C"
     const char *_file,
     const char *_pattern);
 
+  /// \brief Record topics whose name matches the given pattern, with the
+  /// settings of the recorder and of the log file
+  /// \param[in] _file Path to the log file to record
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _format Format of the log file: "sqlite" or "chunked"
+  /// \param[in] _compression Compression of the messages: "none" or "zlib"
+  /// \param[in] _compressionLevel Compression level from 1 to 9, or 0 for the
+  /// default
+  /// \param[in] _bufferSize Size of the buffer of the recorder in MB, or 0 for
+  /// the default
+  /// \param[in] _splitSize Size of the messages of each file in MB, or 0 to
+  /// not split the recording by size
+  /// \param[in] _splitDuration Time spanned by each file in seconds, or 0 to
+  /// not split the recording by time
+  /// \param[in] _highThroughput Set to > 0 to start from
+  /// log::LogOptions::HighThroughput()
+  /// \param[in] _journal SQLite journal mode: "wal", "memory", "off", or an
+  /// empty string for the default
+  /// \param[in] _sync SQLite synchronous mode: "off", "normal", "full", or an
+  /// empty string for the default
+  int IGNITION_TRANSPORT_LOG_VISIBLE recordTopicsWithOptions(
+    const char *_file,
+    const char *_pattern,
+    const char *_format,
+    const char *_compression,
+    const int _compressionLevel,
+    const int _bufferSize,
+    const double _splitSize,
+    const double _splitDuration,
+    int _highThroughput,
+    const char *_journal,
+    const char *_sync);
+
+  /// \brief Record topics like recordTopicsWithOptions(), optionally
+  /// streaming the recording to a log server instead of a file
+  /// \param[in] _remote Service of the log server, see serveLog(), or an
+  /// empty string to record to _file
+  /// \param[in] _spillSize Size of the buffer of the chunks waiting to be
+  /// sent to the server in MB, or 0 for the default
+  /// \param[in] _deferIndexes Set to > 0 to build the indexes of the log
+  /// files once they are closed, see log::LogOptions::SetDeferIndexes()
+  /// \sa recordTopicsWithOptions
+  int IGNITION_TRANSPORT_LOG_VISIBLE recordTopicsWithRemote(
+    const char *_file,
+    const char *_pattern,
+    const char *_format,
+    const char *_compression,
+    const int _compressionLevel,
+    const int _bufferSize,
+    const double _splitSize,
+    const double _splitDuration,
+    int _highThroughput,
+    const char *_journal,
+    const char *_sync,
+    const char *_remote,
+    const int _spillSize,
+    int _deferIndexes);
+
   /// \brief Playback topics whose name matches the given pattern
   /// \param[in] _file Path to the log file to playback
   /// \param[in] _pattern ECMAScript regular expression to match against topics
@@ -52,4 +114,73 @@ extern "C"
     const int _wait_ms,
     const char *_remap,
     int _fast);
+
+  /// \brief Playback topics whose name matches the given pattern, at a
+  /// given rate
+  /// \param[in] _file Path to the log file to playback
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _wait_ms How long to wait before the publications begin after
+  /// advertising the topics that will be played back (milliseconds)
+  /// \param[in] _fast Set to > 0 to disable wait between messages.
+  /// \param[in] _rate Playback rate, see log::PlaybackHandle::SetRate()
+  int IGNITION_TRANSPORT_LOG_VISIBLE playbackTopicsAtRate(
+    const char *_file,
+    const char *_pattern,
+    const int _wait_ms,
+    const char *_remap,
+    int _fast,
+    const double _rate);
+
+  /// \brief Print the topics of a log file, with the number, size and time
+  /// range of their messages, without reading the messages themselves
+  /// \param[in] _file Path to the log file
+  int IGNITION_TRANSPORT_LOG_VISIBLE printLogInfo(const char *_file);
+
+  /// \brief Copy the messages of the topics whose name matches the given
+  /// pattern, over a range of time, to a new log file
+  /// \param[in] _file Path to the log file to copy from
+  /// \param[in] _output Path to the new log file
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _start Time of the first message to copy, in seconds, or
+  /// negative to start from the beginning of the log
+  /// \param[in] _end Time of the last message to copy, in seconds, or
+  /// negative to copy until the end of the log
+  int IGNITION_TRANSPORT_LOG_VISIBLE extractLog(
+    const char *_file,
+    const char *_output,
+    const char *_pattern,
+    const double _start,
+    const double _end);
+
+  /// \brief Export the fields of the messages of the topics whose name
+  /// matches the given pattern as columns, one file per topic, see
+  /// ColumnExport.hh
+  /// \param[in] _file Path to the log file to export
+  /// \param[in] _output Existing directory of the files
+  /// \param[in] _pattern ECMAScript regular expression to match against topics
+  /// \param[in] _threads Number of worker threads, or 0 for one per hardware
+  /// thread
+  int IGNITION_TRANSPORT_LOG_VISIBLE exportLog(
+    const char *_file,
+    const char *_output,
+    const char *_pattern,
+    const int _threads);
+
+  /// \brief Receive the recordings streamed to a service and write them
+  /// to a chunked log file, until signaled
+  /// \param[in] _file Path to the log file to write
+  /// \param[in] _service Service receiving the chunks
+  int IGNITION_TRANSPORT_LOG_VISIBLE serveLog(
+    const char *_file,
+    const char *_service);
+
+  /// \brief Build the indexes and the summaries of a log file recorded
+  /// with deferred indexes, see log::Log::Finalize()
+  /// \param[in] _file Path to the log file. The other parts of a split
+  /// recording are finalized too.
+  /// \param[in] _vacuum Set to > 0 to also rebuild the file without its
+  /// free pages
+  int IGNITION_TRANSPORT_LOG_VISIBLE finalizeLog(
+    const char *_file,
+    int _vacuum);
 }
@@ -17,6 +17,12 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
 #include <ignition/transport/log/Log.hh>
 #include <ignition/transport/log/Playback.hh>
 #include <ignition/transport/log/Recorder.hh>
@@ -175,6 +181,171 @@ TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayLog))
 }
 
 
+//////////////////////////////////////////////////
+/// \brief Record a log and then play it back with several playbacks, of
+/// different topics, sharing a reader. Verify that each one plays the
+/// messages of its topics.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayShared))
+{
+  std::vector<std::string> topics = {"/foo", "/bar", "/baz"};
+
+  std::vector<MessageInformation> incomingData;
+
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+
+  ignition::transport::Node node;
+  ignition::transport::log::Recorder recorder;
+
+  for (const std::string &topic : topics)
+  {
+    node.SubscribeRaw(topic, callback);
+    recorder.AddTopic(topic);
+  }
+
+  const std::string logName =
+    "file:playbackReplayShared?mode=memory&cache=shared";
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+    recorder.Start(logName));
+
+  const int numChirps = 50;
+  testing::forkHandlerType chirper =
+    ignition::transport::log::test::BeginChirps(topics, numChirps, partition);
+
+  // Wait for the chirping to finish
+  testing::waitAndCleanupFork(chirper);
+
+  // Wait to make sure our callbacks are done processing the incoming messages
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  // Create playback before stopping so sqlite memory database is shared
+  ignition::transport::log::Playback playback(logName);
+  ignition::transport::log::Playback other(playback,
+    ignition::transport::NodeOptions());
+  ignition::transport::log::Playback unstarted(logName);
+  recorder.Stop();
+
+  std::vector<MessageInformation> originalData = incomingData;
+  incomingData.clear();
+
+  EXPECT_TRUE(playback.AddTopic("/foo"));
+  EXPECT_TRUE(playback.AddTopic("/bar"));
+  EXPECT_TRUE(other.AddTopic("/baz"));
+
+  // The playbacks must share their log
+  EXPECT_TRUE(ignition::transport::log::Playback::StartShared(
+        {&playback, &unstarted}).empty());
+
+  const auto handles = ignition::transport::log::Playback::StartShared(
+      {&playback, &other});
+  ASSERT_EQ(2u, handles.size());
+  for (const auto &handle : handles)
+  {
+    ASSERT_NE(nullptr, handle);
+    handle->WaitUntilFinished();
+    EXPECT_EQ(handle->EndTime(), handle->CurrentTime());
+  }
+  for (const auto &handle : handles)
+    handle->Stop();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // The playbacks run in parallel, so only the order of each topic is kept
+  for (const std::string &topic : topics)
+  {
+    std::vector<MessageInformation> recorded;
+    std::vector<MessageInformation> played;
+    for (const MessageInformation &info : originalData)
+    {
+      if (info.topic == topic)
+        recorded.push_back(info);
+    }
+    for (const MessageInformation &info : incomingData)
+    {
+      if (info.topic == topic)
+        played.push_back(info);
+    }
+    EXPECT_EQ(static_cast<std::size_t>(numChirps), recorded.size());
+    EXPECT_TRUE(ExpectSameMessages(recorded, played)) << topic;
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Play a log straight into the callbacks of this process, in order
+/// and without waiting for the time stamps.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayOffline))
+{
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  // The messages are an hour apart. Closing the log commits them.
+  const std::string logName = "playbackReplayOffline_" + partition + ".tlog";
+  const int numMsgs = 50;
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName, std::ios_base::out));
+    for (int i = 0; i < numMsgs; ++i)
+    {
+      MsgType msg;
+      msg.set_data(i);
+      const std::string data = msg.SerializeAsString();
+      const std::string topic = i % 2 == 0 ? "/foo" : "/bar";
+      ASSERT_TRUE(log.InsertMessage(std::chrono::hours(i), topic,
+          msg.GetTypeName(), data.data(), data.size()));
+    }
+  }
+
+  std::vector<MessageInformation> rawData;
+  std::vector<int> fooData;
+  ignition::transport::Node node;
+  EXPECT_TRUE(node.SubscribeRaw("/bar",
+      [&rawData](const char *_data, std::size_t _len,
+                 const ignition::transport::MessageInfo &_msgInfo)
+      {
+        TrackMessages(rawData, _data, _len, _msgInfo);
+      }));
+  std::function<void(const MsgType &)> cb =
+    [&fooData](const MsgType &_msg)
+    {
+      fooData.push_back(_msg.data());
+    };
+  EXPECT_TRUE(node.Subscribe("/foo", cb));
+
+  ignition::transport::log::Playback playback(logName);
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(numMsgs, playback.PlayOffline());
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::seconds(10));
+
+  // The callbacks ran before PlayOffline() returned
+  ASSERT_EQ(static_cast<std::size_t>(numMsgs / 2), fooData.size());
+  ASSERT_EQ(static_cast<std::size_t>(numMsgs / 2), rawData.size());
+  for (int i = 0; i < numMsgs / 2; ++i)
+  {
+    EXPECT_EQ(2 * i, fooData[i]);
+
+    MsgType msg;
+    ASSERT_TRUE(msg.ParseFromString(rawData[i].data));
+    EXPECT_EQ(2 * i + 1, msg.data());
+    EXPECT_EQ("/bar", rawData[i].topic);
+    EXPECT_EQ(msg.GetTypeName(), rawData[i].type);
+  }
+
+  // Only the topics of the playback are delivered
+  fooData.clear();
+  rawData.clear();
+  EXPECT_TRUE(playback.AddTopic("/bar"));
+  EXPECT_EQ(numMsgs / 2, playback.PlayOffline());
+  EXPECT_TRUE(fooData.empty());
+  EXPECT_EQ(static_cast<std::size_t>(numMsgs / 2), rawData.size());
+
+  std::remove(logName.c_str());
+}
+
 //////////////////////////////////////////////////
 TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayNoSuchTopic))
 {
@@ -793,6 +964,249 @@ TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplaySeek))
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 }
 
+//////////////////////////////////////////////////
+/// \brief Play back a log written directly, in order, then seek past its
+/// end. The messages read ahead before the seek are not published.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplaySeekPastEnd))
+{
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+  const std::string topic = "/foo";
+  const std::string logName = "playbackSeekPastEnd_" + partition + ".tlog";
+
+  const int numMsgs = 20;
+  {
+    ignition::transport::log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+    for (int i = 0; i < numMsgs; ++i)
+    {
+      MsgType msg;
+      msg.set_data(i + 1);
+      std::string data;
+      ASSERT_TRUE(msg.SerializeToString(&data));
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::milliseconds(50 * i),
+          topic, msg.GetTypeName(), data.c_str(), data.size()));
+    }
+  }
+
+  std::vector<MessageInformation> incomingData;
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+
+  ignition::transport::Node node;
+  node.SubscribeRaw(topic, callback);
+
+  {
+    ignition::transport::log::Playback playback(logName);
+    EXPECT_TRUE(playback.AddTopic(topic));
+    const auto handle = playback.Start();
+    ASSERT_NE(nullptr, handle);
+
+    // Play a few messages, then jump past the last one
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    handle->Pause();
+    handle->Seek(std::chrono::hours(1));
+    handle->Resume();
+    handle->WaitUntilFinished();
+    EXPECT_TRUE(handle->Finished());
+    handle->Stop();
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  std::unique_lock<std::mutex> lock(dataMutex);
+  EXPECT_FALSE(incomingData.empty());
+  EXPECT_LT(incomingData.size(), static_cast<std::size_t>(numMsgs));
+
+  // The messages were played in order
+  for (std::size_t i = 0; i < incomingData.size(); ++i)
+  {
+    MsgType msg;
+    ASSERT_TRUE(msg.ParseFromString(incomingData[i].data));
+    EXPECT_EQ(static_cast<int>(i) + 1, msg.data());
+  }
+  lock.unlock();
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Play a log ten times faster than it was recorded, then change the
+/// rate while it plays.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayRate))
+{
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+  const std::string topic = "/foo";
+  const std::string logName = "playbackRate_" + partition + ".tlog";
+
+  // 20 messages over 2 seconds
+  const int numMsgs = 20;
+  {
+    ignition::transport::log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+    for (int i = 0; i < numMsgs; ++i)
+    {
+      MsgType msg;
+      msg.set_data(i + 1);
+      std::string data;
+      ASSERT_TRUE(msg.SerializeToString(&data));
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::milliseconds(100 * i),
+          topic, msg.GetTypeName(), data.c_str(), data.size()));
+    }
+  }
+
+  std::vector<MessageInformation> incomingData;
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+
+  ignition::transport::Node node;
+  node.SubscribeRaw(topic, callback);
+
+  {
+    ignition::transport::log::Playback playback(logName);
+    EXPECT_TRUE(playback.AddTopic(topic));
+    playback.SetRate(10.0);
+    const auto start = std::chrono::steady_clock::now();
+    const auto handle = playback.Start(std::chrono::milliseconds(100));
+    ASSERT_NE(nullptr, handle);
+    EXPECT_DOUBLE_EQ(10.0, handle->Rate());
+    handle->WaitUntilFinished();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // About 200 ms of playback, after 100 ms of waiting for the subscribers
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1200));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  std::unique_lock<std::mutex> lock(dataMutex);
+  EXPECT_EQ(static_cast<std::size_t>(numMsgs), incomingData.size());
+  incomingData.clear();
+  lock.unlock();
+
+  {
+    // Speed up a real time playback once it started
+    ignition::transport::log::Playback playback(logName);
+    EXPECT_TRUE(playback.AddTopic(topic));
+    const auto start = std::chrono::steady_clock::now();
+    const auto handle = playback.Start(std::chrono::milliseconds(100));
+    ASSERT_NE(nullptr, handle);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    handle->SetRate(100.0);
+    EXPECT_DOUBLE_EQ(100.0, handle->Rate());
+    handle->WaitUntilFinished();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1500));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  lock.lock();
+  EXPECT_EQ(static_cast<std::size_t>(numMsgs), incomingData.size());
+  lock.unlock();
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief A clock set by the test, like the clock of a simulator
+class ManualClock : public ignition::transport::Clock
+{
+  // Documentation inherited
+  public: std::chrono::nanoseconds Time() const override
+  {
+    return std::chrono::nanoseconds(this->time.load());
+  }
+
+  // Documentation inherited
+  public: bool IsReady() const override
+  {
+    return this->ready;
+  }
+
+  /// \brief Time of the clock, in nanoseconds
+  public: std::atomic<int64_t> time{0};
+
+  /// \brief True once the clock is ready
+  public: std::atomic_bool ready{false};
+};
+
+//////////////////////////////////////////////////
+/// \brief Playback driven by a clock publishes the messages as the clock
+/// advances, whatever the real time.
+TEST(playback, IGN_UTILS_TEST_DISABLED_ON_MAC(ReplayWithClock))
+{
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+  const std::string topic = "/foo";
+  const std::string logName = "playbackClock_" + partition + ".tlog";
+
+  // 20 messages over 19 seconds
+  const int numMsgs = 20;
+  {
+    ignition::transport::log::Log logFile;
+    ASSERT_TRUE(logFile.Open(logName, std::ios_base::out));
+    for (int i = 0; i < numMsgs; ++i)
+    {
+      MsgType msg;
+      msg.set_data(i + 1);
+      std::string data;
+      ASSERT_TRUE(msg.SerializeToString(&data));
+      EXPECT_TRUE(logFile.InsertMessage(std::chrono::seconds(i),
+          topic, msg.GetTypeName(), data.c_str(), data.size()));
+    }
+  }
+
+  std::vector<MessageInformation> incomingData;
+  auto callback = [&incomingData](
+      const char *_data,
+      std::size_t _len,
+      const ignition::transport::MessageInfo &_msgInfo)
+  {
+    TrackMessages(incomingData, _data, _len, _msgInfo);
+  };
+
+  ignition::transport::Node node;
+  node.SubscribeRaw(topic, callback);
+
+  const auto received = [&incomingData]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::lock_guard<std::mutex> lock(dataMutex);
+    return incomingData.size();
+  };
+
+  ManualClock clock;
+  ignition::transport::log::Playback playback(logName);
+  EXPECT_TRUE(playback.AddTopic(topic));
+  const auto handle =
+    playback.Start(&clock, std::chrono::milliseconds(100));
+  ASSERT_NE(nullptr, handle);
+
+  // Nothing is published until the clock is ready
+  EXPECT_EQ(0u, received());
+  clock.time = std::chrono::nanoseconds(std::chrono::seconds(100)).count();
+  clock.ready = true;
+  EXPECT_EQ(1u, received());
+
+  // Ten seconds of the log are replayed at once
+  clock.time += std::chrono::nanoseconds(std::chrono::seconds(9)).count();
+  handle->NotifyClock();
+  EXPECT_EQ(10u, received());
+  EXPECT_FALSE(handle->Finished());
+
+  clock.time += std::chrono::nanoseconds(std::chrono::seconds(10)).count();
+  handle->WaitUntilFinished();
+  EXPECT_EQ(static_cast<std::size_t>(numMsgs), received());
+
+  std::remove(logName.c_str());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -17,10 +17,19 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
 #include <optional>
 #include <numeric>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
 
 #include <ignition/transport/log/Log.hh>
+#include <ignition/transport/log/LogServer.hh>
 #include <ignition/transport/log/Recorder.hh>
 #include <ignition/transport/Node.hh>
 #include <ignition/utilities/ExtraTestMacros.hh>
@@ -530,6 +539,437 @@ TEST(recorder, DataWriterQueueLargeMessages)
   TestBufferSizeSettings(1, 1);
 }
 
+//////////////////////////////////////////////////
+/// Test that a recording split in several files holds all the messages
+TEST(recorder, SplitBySize)
+{
+  std::string topic{"/foo"};
+
+  ignition::transport::log::Recorder recorder;
+  // A few messages per file
+  recorder.SetSplitSize(20);
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(topic));
+
+  const std::string logName = "recorderSplit_" + partition + ".tlog";
+  EXPECT_EQ(recorder.Start(logName),
+            ignition::transport::log::RecorderError::SUCCESS);
+
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  ignition::transport::Node node;
+  auto pub = node.Advertise<MsgType>(topic);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  const int numChirps = 50;
+  for (int i = 0; i < numChirps; ++i)
+  {
+    MsgType msg;
+    msg.set_data(i+1);
+    pub.Publish(msg);
+  }
+
+  // Sleep so data writer can get the message
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  recorder.Stop();
+
+  // The recording is complete
+  const auto stats = recorder.Stats();
+  EXPECT_EQ(static_cast<uint64_t>(numChirps), stats.receivedMsgs);
+  EXPECT_EQ(static_cast<uint64_t>(numChirps), stats.writtenMsgs);
+  EXPECT_EQ(0u, stats.droppedMsgs);
+  EXPECT_EQ(0u, stats.failedMsgs);
+  EXPECT_EQ(0u, stats.queuedMsgs);
+  EXPECT_GT(stats.maxQueuedMsgs, 0u);
+
+  const std::vector<std::string> files =
+    ignition::transport::log::Log::SplitFiles(logName);
+  EXPECT_GT(files.size(), 1u);
+
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(files));
+
+    int count = 0;
+    for (const auto &msg : log.QueryMessages())
+    {
+      VerifyMessage(msg, count, 1,
+          [&](const std::string &_topic)
+          {
+          return topic == _topic;
+          });
+      ++count;
+    }
+    EXPECT_EQ(numChirps, count);
+  }
+
+  for (const std::string &file : files)
+    std::remove(file.c_str());
+}
+
+//////////////////////////////////////////////////
+/// Test that the topic groups are written to files of their own, which are
+/// read back as one log through the manifest
+TEST(recorder, TopicGroups)
+{
+  const std::string fooTopic{"/foo"};
+  const std::string barTopic{"/bar"};
+
+  ignition::transport::log::Recorder recorder;
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopicGroup("bar", std::regex(barTopic)));
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(fooTopic));
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(barTopic));
+
+  const std::string logName = "recorderGroups_" + partition + ".tlog";
+  const std::string barName =
+    ignition::transport::log::Log::GroupFilename(logName, "bar");
+  const std::string manifest = logName + ".manifest";
+  EXPECT_EQ(recorder.Start(logName),
+            ignition::transport::log::RecorderError::SUCCESS);
+  EXPECT_EQ(ignition::transport::log::RecorderError::ALREADY_RECORDING,
+            recorder.AddTopicGroup("foo", std::regex(fooTopic)));
+
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  ignition::transport::Node node;
+  auto fooPub = node.Advertise<MsgType>(fooTopic);
+  auto barPub = node.Advertise<MsgType>(barTopic);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  const int numChirps = 50;
+  for (int i = 0; i < numChirps; ++i)
+  {
+    MsgType msg;
+    msg.set_data(i+1);
+    fooPub.Publish(msg);
+    barPub.Publish(msg);
+  }
+
+  // Sleep so data writer can get the message
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  recorder.Stop();
+  EXPECT_EQ(static_cast<uint64_t>(2 * numChirps),
+            recorder.Stats().writtenMsgs);
+
+  // Each file has the topics of its group
+  for (const auto &file : {std::make_pair(logName, fooTopic),
+                           std::make_pair(barName, barTopic)})
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(file.first));
+
+    int count = 0;
+    for (const auto &msg : log.QueryMessages())
+    {
+      VerifyMessage(msg, count, 1,
+          [&](const std::string &_topic)
+          {
+          return file.second == _topic;
+          });
+      ++count;
+    }
+    EXPECT_EQ(numChirps, count);
+  }
+
+  // The manifest merges the files in the order of the messages
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(manifest));
+
+    int count = 0;
+    std::chrono::nanoseconds last{0};
+    for (const auto &msg : log.QueryMessages())
+    {
+      EXPECT_GE(msg.TimeReceived(), last);
+      last = msg.TimeReceived();
+      ++count;
+    }
+    EXPECT_EQ(2 * numChirps, count);
+  }
+
+  std::remove(manifest.c_str());
+  std::remove(logName.c_str());
+  std::remove(barName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// Test that the black box only dumps the messages of its window, through
+/// its service
+TEST(recorder, BlackBox)
+{
+  const std::string fooTopic{"/foo"};
+  const std::string barTopic{"/bar"};
+  const std::string service{"/recorder/dump"};
+
+  ignition::transport::log::Recorder recorder;
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopicGroup("bar", std::regex(barTopic)));
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(fooTopic));
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(barTopic));
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AdvertiseDumpService(service));
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.StartBlackBox(std::chrono::milliseconds(200), 1));
+
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  ignition::transport::Node node;
+  auto fooPub = node.Advertise<MsgType>(fooTopic);
+  auto barPub = node.Advertise<MsgType>(barTopic);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // The first messages leave the window before the last ones arrive
+  MsgType msg;
+  const int numChirps = 10;
+  for (int i = 0; i < numChirps; ++i)
+  {
+    msg.set_data(0);
+    fooPub.Publish(msg);
+    barPub.Publish(msg);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  for (int i = 0; i < numChirps; ++i)
+  {
+    msg.set_data(i+1);
+    fooPub.Publish(msg);
+    barPub.Publish(msg);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  const std::string logName = "recorderBlackBox_" + partition + ".tlog";
+  ignition::msgs::StringMsg req;
+  req.set_data(logName);
+  ignition::msgs::Boolean rep;
+  bool result = false;
+  ASSERT_TRUE(node.Request(service, req, 5000, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_TRUE(rep.data());
+
+  // Nothing was dropped, and the groups are dumped to one file
+  const auto stats = recorder.Stats();
+  EXPECT_EQ(static_cast<uint64_t>(4 * numChirps), stats.receivedMsgs);
+  EXPECT_EQ(0u, stats.droppedMsgs);
+  EXPECT_EQ(static_cast<uint64_t>(2 * numChirps), stats.writtenMsgs);
+  EXPECT_EQ(0u, stats.queuedMsgs);
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName));
+
+    int count = 0;
+    for (const auto &logMsg : log.QueryMessages())
+    {
+      VerifyMessage(logMsg, count, 2,
+          [&](const std::string &_topic)
+          {
+          return _topic == fooTopic || _topic == barTopic;
+          });
+      ++count;
+    }
+    EXPECT_EQ(2 * numChirps, count);
+  }
+  std::remove(logName.c_str());
+
+  // The dumped messages left the window
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.Dump(logName));
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName));
+    auto batch = log.QueryMessages();
+    EXPECT_EQ(batch.end(), batch.begin());
+  }
+  recorder.Stop();
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// Test that a topic added with a rate is recorded at that rate, and the
+/// others at the rate they are published
+TEST(recorder, RecordAtRate)
+{
+  const std::string fooTopic{"/foo"};
+  const std::string barTopic{"/bar"};
+  const std::string logName = "recorderRate_" + partition + ".tlog";
+
+  ignition::transport::log::Recorder recorder;
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(fooTopic, 10));
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(barTopic));
+  EXPECT_EQ(
+      ignition::transport::log::RecorderError::ALREADY_SUBSCRIBED_TO_TOPIC,
+      recorder.AddTopic(fooTopic, 100));
+
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  ignition::transport::Node node;
+  auto fooPub = node.Advertise<MsgType>(fooTopic);
+  auto barPub = node.Advertise<MsgType>(barTopic);
+
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.Start(logName));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // 100 messages per second for half a second
+  MsgType msg;
+  const int numChirps = 50;
+  for (int i = 0; i < numChirps; ++i)
+  {
+    msg.set_data(i+1);
+    fooPub.Publish(msg);
+    barPub.Publish(msg);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  recorder.Stop();
+
+  // The discarded messages are not even received
+  const auto stats = recorder.Stats();
+  EXPECT_EQ(0u, stats.droppedMsgs);
+  EXPECT_EQ(stats.receivedMsgs, stats.writtenMsgs);
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName));
+
+    int fooCount = 0;
+    int barCount = 0;
+    for (const auto &logMsg : log.QueryMessages())
+    {
+      if (logMsg.Topic() == fooTopic)
+        ++fooCount;
+      else if (logMsg.Topic() == barTopic)
+        ++barCount;
+    }
+    EXPECT_GE(fooCount, 1);
+    EXPECT_LE(fooCount, 10);
+    EXPECT_EQ(numChirps, barCount);
+  }
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// Test that a recording with deferred indexes is finalized once stopped
+TEST(recorder, DeferIndexes)
+{
+  const std::string fooTopic{"/foo"};
+  const std::string logName = "recorderDeferred_" + partition + ".tlog";
+
+  ignition::transport::log::Recorder recorder;
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(fooTopic));
+
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  ignition::transport::Node node;
+  auto fooPub = node.Advertise<MsgType>(fooTopic);
+
+  ignition::transport::log::LogOptions options;
+  options.SetDeferIndexes(true);
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.Start(logName, options));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  MsgType msg;
+  const int numChirps = 20;
+  for (int i = 0; i < numChirps; ++i)
+  {
+    msg.set_data(i+1);
+    fooPub.Publish(msg);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  recorder.Stop();
+  recorder.WaitUntilFinalized();
+
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName));
+    const auto summaries = log.TopicSummaries();
+    ASSERT_EQ(1u, summaries.size());
+    EXPECT_EQ(fooTopic, summaries[0].topic);
+    EXPECT_EQ(static_cast<uint64_t>(numChirps), summaries[0].messages);
+  }
+
+  // Finalizing again is harmless
+  EXPECT_TRUE(ignition::transport::log::Log::Finalize(logName));
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// Test that a recording streamed to a log server is written to its file
+TEST(recorder, StreamToServer)
+{
+  const std::string fooTopic{"/foo"};
+  const std::string service{"/log/stream"};
+  const std::string logName = "recorderStream_" + partition + ".tlog";
+
+  ignition::transport::log::LogServer server;
+  ASSERT_TRUE(server.Start(service, logName));
+  EXPECT_FALSE(server.Start(service, logName));
+
+  ignition::transport::log::Recorder recorder;
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.AddTopic(fooTopic));
+
+  ignition::transport::log::LogOptions options;
+  options.SetChunkSize(64);
+  EXPECT_EQ(ignition::transport::log::RecorderError::SUCCESS,
+            recorder.StartRemote(service, options));
+
+  using MsgType = ignition::transport::log::test::ChirpMsgType;
+
+  ignition::transport::Node node;
+  auto fooPub = node.Advertise<MsgType>(fooTopic);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  MsgType msg;
+  const int numChirps = 100;
+  for (int i = 0; i < numChirps; ++i)
+  {
+    msg.set_data(i+1);
+    fooPub.Publish(msg);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Stopping sends the last chunk
+  recorder.Stop();
+  const auto stats = recorder.Stats();
+  EXPECT_EQ(static_cast<uint64_t>(numChirps), stats.writtenMsgs);
+  EXPECT_GT(stats.sentChunks, 1u);
+  EXPECT_EQ(0u, stats.droppedChunks);
+  EXPECT_EQ(0u, stats.spilledBytes);
+  EXPECT_EQ(stats.sentChunks, server.ReceivedChunks());
+  EXPECT_EQ(0u, server.RejectedChunks());
+  server.Stop();
+
+  {
+    ignition::transport::log::Log log;
+    ASSERT_TRUE(log.Open(logName));
+
+    int count = 0;
+    for (const auto &logMsg : log.QueryMessages())
+    {
+      VerifyMessage(logMsg, count, 1,
+          [&](const std::string &_topic)
+          {
+          return _topic == fooTopic;
+          });
+      ++count;
+    }
+    EXPECT_EQ(numChirps, count);
+  }
+  std::remove(logName.c_str());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ios>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/log/Log.hh"
+#include "ignition/transport/log/LogOptions.hh"
+#include "ignition/transport/test_config.h"
+#include "Benchmark.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+
+//////////////////////////////////////////////////
+/// \brief Time log::Log::InsertMessage() with small and big messages on a
+/// few topics, with some settings of the log file.
+/// \param[in] _name Name of the settings, used in the name of the results
+/// \param[in] _options Settings of the log file
+static void benchmarkInsert(const std::string &_name,
+    const log::LogOptions &_options)
+{
+  const std::vector<std::string> topics = {"/a", "/b", "/c", "/d"};
+  for (const std::size_t size : {64u, 4096u})
+  {
+    const std::string logName = "bench_" + testing::getRandomNumber() +
+      ".tlog";
+    const std::string data(size, 'x');
+    int64_t time = 0;
+    bool inserted = true;
+    {
+      log::Log logFile;
+      ASSERT_TRUE(logFile.Open(logName, std::ios_base::out, _options));
+      testing::benchmark("insert_message_" + _name + "_" +
+        std::to_string(size), [&]
+        {
+          ++time;
+          inserted &= logFile.InsertMessage(std::chrono::nanoseconds(time),
+            topics[time % topics.size()], "some.type", data.data(),
+            data.size());
+        });
+    }
+    EXPECT_TRUE(inserted);
+    std::remove(logName.c_str());
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(LogPerformance, InsertMessage)
+{
+  benchmarkInsert("default", log::LogOptions());
+  benchmarkInsert("high_throughput", log::LogOptions::HighThroughput());
+
+  log::LogOptions chunked;
+  chunked.SetFileFormat(log::LogOptions::Format::CHUNKED);
+  benchmarkInsert("chunked", chunked);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
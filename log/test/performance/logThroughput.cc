@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ios>
+#include <random>
+#include <string>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/log/Batch.hh"
+#include "ignition/transport/log/Log.hh"
+#include "ignition/transport/log/LogOptions.hh"
+#include "ignition/transport/log/Playback.hh"
+#include "ignition/transport/log/QualifiedTime.hh"
+#include "ignition/transport/log/QueryOptions.hh"
+#include "ignition/transport/log/Recorder.hh"
+#include "ignition/transport/test_config.h"
+#include "Benchmark.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace ignition::transport;
+
+/// \brief Sizes of the messages of the synthetic streams, in the order
+/// they are repeated.
+static const std::vector<std::size_t> kSizes = {64, 256, 1024, 4096, 65536};
+
+/// \brief Topics of the synthetic streams.
+static const std::vector<std::string> kTopics =
+  {"/bench_log_a", "/bench_log_b", "/bench_log_c", "/bench_log_d"};
+
+/// \brief Number of messages of the generated logs.
+static const int kMessages = 10000;
+
+//////////////////////////////////////////////////
+/// \brief Seconds elapsed since a time.
+/// \param[in] _start The time.
+/// \return The seconds.
+static double secondsSince(const std::chrono::steady_clock::time_point &_start)
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - _start).count();
+}
+
+//////////////////////////////////////////////////
+/// \brief Report the throughput of a run.
+/// \param[in] _name Name of the results, "_mbps" and "_msgps" are appended.
+/// \param[in] _bytes Bytes processed.
+/// \param[in] _msgs Messages processed.
+/// \param[in] _seconds Duration of the run.
+static void reportThroughput(const std::string &_name, const uint64_t _bytes,
+    const uint64_t _msgs, const double _seconds)
+{
+  testing::reportBenchmark(_name + "_mbps", _bytes / 1e6 / _seconds, "MB/s");
+  testing::reportBenchmark(_name + "_msgps", _msgs / _seconds, "msg/s");
+}
+
+//////////////////////////////////////////////////
+/// \brief Write a log of kMessages messages of the synthetic stream, one
+/// by one or in batches of 100 messages, and report the throughput.
+/// \param[in] _name Name of the results.
+/// \param[in] _file Name of the log file.
+/// \param[in] _options Settings of the log file.
+/// \param[in] _batch True to insert in batches.
+static void writeLog(const std::string &_name, const std::string &_file,
+    const log::LogOptions &_options, const bool _batch)
+{
+  const std::string data(kSizes.back(), 'x');
+  const std::string type = msgs::Bytes().GetTypeName();
+  uint64_t bytes = 0;
+  std::size_t inserted = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    log::Log logFile;
+    ASSERT_TRUE(logFile.Open(_file, std::ios_base::out, _options));
+    std::vector<log::Log::MessageRecord> records;
+    for (int i = 0; i < kMessages; ++i)
+    {
+      const std::size_t size = kSizes[i % kSizes.size()];
+      const std::chrono::nanoseconds time(1000000 * (i + 1));
+      const std::string &topic = kTopics[i % kTopics.size()];
+      bytes += size;
+      if (!_batch)
+      {
+        inserted += logFile.InsertMessage(time, topic, type, data.data(),
+          size);
+        continue;
+      }
+
+      records.push_back({time, topic, type, data.data(), size});
+      if (records.size() == 100u || i + 1 == kMessages)
+      {
+        inserted += logFile.InsertMessages(records);
+        records.clear();
+      }
+    }
+  }
+  // Includes closing the file, which flushes it.
+  reportThroughput(_name, bytes, kMessages, secondsSince(start));
+  EXPECT_EQ(static_cast<std::size_t>(kMessages), inserted);
+}
+
+//////////////////////////////////////////////////
+/// \brief Write throughput of log::Log, with some settings of the log file.
+TEST(LogPerformance, WriteThroughput)
+{
+  log::LogOptions chunked;
+  chunked.SetFileFormat(log::LogOptions::Format::CHUNKED);
+
+  for (const bool batch : {false, true})
+  {
+    const std::string prefix = batch ? "insert_messages_" : "insert_message_";
+    for (const auto &[name, options] :
+           {std::make_pair("default", log::LogOptions()),
+            std::make_pair("high_throughput",
+              log::LogOptions::HighThroughput()),
+            std::make_pair("chunked", chunked)})
+    {
+      const std::string logName = "bench_write_" +
+        testing::getRandomNumber() + ".tlog";
+      writeLog(prefix + name, logName, options, batch);
+      std::remove(logName.c_str());
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Sustained throughput of log::Recorder, recording publications of
+/// this process as fast as they are made, and the messages it dropped.
+TEST(LogPerformance, RecorderThroughput)
+{
+  Node node;
+  std::vector<Node::Publisher> publishers;
+  for (const auto &topic : kTopics)
+  {
+    publishers.push_back(node.Advertise<msgs::Bytes>(topic));
+    ASSERT_TRUE(publishers.back());
+  }
+
+  const std::string logName = "bench_record_" + testing::getRandomNumber() +
+    ".tlog";
+  log::Recorder recorder;
+  for (const auto &topic : kTopics)
+    EXPECT_EQ(log::RecorderError::SUCCESS, recorder.AddTopic(topic));
+  ASSERT_EQ(log::RecorderError::SUCCESS,
+    recorder.Start(logName, log::LogOptions::HighThroughput()));
+
+  std::vector<msgs::Bytes> msgs(kSizes.size());
+  for (std::size_t i = 0; i < kSizes.size(); ++i)
+    msgs[i].set_data(std::string(kSizes[i], 'x'));
+
+  uint64_t bytes = 0;
+  uint64_t published = 0;
+  const auto start = std::chrono::steady_clock::now();
+  while (secondsSince(start) < 2.0)
+  {
+    const std::size_t size = published % kSizes.size();
+    publishers[published % publishers.size()].Publish(msgs[size]);
+    bytes += kSizes[size];
+    ++published;
+  }
+  // Stopping waits for the buffered messages to be written.
+  const log::Recorder::Statistics stats = recorder.Stats();
+  recorder.Stop();
+  const double seconds = secondsSince(start);
+
+  reportThroughput("record_published", bytes, published, seconds);
+  reportThroughput("record_written", bytes - std::min(bytes,
+    stats.droppedBytes), stats.writtenMsgs, seconds);
+  testing::reportBenchmark("record_dropped_msgs",
+    static_cast<double>(stats.droppedMsgs), "msgs");
+  testing::reportBenchmark("record_failed_msgs",
+    static_cast<double>(stats.failedMsgs), "msgs");
+  testing::reportBenchmark("record_max_buffered_mb",
+    stats.maxBufferedBytes / 1e6, "MB");
+  EXPECT_GT(stats.receivedMsgs, 0u);
+  EXPECT_EQ(0u, stats.failedMsgs);
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief Read throughput of log::Log::QueryMessages() and of
+/// log::Playback, and latency of the queries starting at a random time.
+TEST(LogPerformance, ReadThroughput)
+{
+  const std::string logName = "bench_read_" + testing::getRandomNumber() +
+    ".tlog";
+  writeLog("generate", logName, log::LogOptions::HighThroughput(), true);
+
+  log::Log logFile;
+  ASSERT_TRUE(logFile.Open(logName));
+
+  // Sequential read.
+  uint64_t bytes = 0;
+  uint64_t read = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const log::Message &msg : logFile.QueryMessages())
+  {
+    bytes += msg.DataView().size();
+    ++read;
+  }
+  reportThroughput("query_messages", bytes, read, secondsSince(start));
+  EXPECT_EQ(static_cast<uint64_t>(kMessages), read);
+
+  // Seek: time to the first message of a query starting at a random time.
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> index(1, kMessages);
+  const int seeks = 100;
+  double total = 0;
+  double longest = 0;
+  for (int i = 0; i < seeks; ++i)
+  {
+    const std::chrono::nanoseconds time(1000000 * index(random));
+    start = std::chrono::steady_clock::now();
+    log::Batch batch = logFile.QueryMessages(log::AllTopics(
+      log::QualifiedTimeRange::From(log::QualifiedTime(time))));
+    auto it = batch.begin();
+    const double seconds = secondsSince(start);
+    EXPECT_TRUE(it != batch.end());
+    EXPECT_EQ(time, it->TimeReceived());
+    total += seconds;
+    longest = std::max(longest, seconds);
+  }
+  testing::reportBenchmark("query_seek_us", 1e6 * total / seeks, "us");
+  testing::reportBenchmark("query_seek_max_us", 1e6 * longest, "us");
+
+  // Playback as fast as possible to a subscriber of this process.
+  std::atomic<uint64_t> playedBytes{0};
+  std::atomic<uint64_t> played{0};
+  Node node;
+  for (const auto &topic : kTopics)
+  {
+    EXPECT_TRUE(node.SubscribeRaw(topic,
+      [&](const char *, const std::size_t _size, const MessageInfo &)
+      {
+        playedBytes += _size;
+        ++played;
+      }));
+  }
+
+  log::Playback playback(logName);
+  playback.SetBackpressure(64);
+  start = std::chrono::steady_clock::now();
+  const auto handle = playback.Start(std::chrono::nanoseconds(0), false);
+  ASSERT_NE(nullptr, handle);
+  handle->WaitUntilFinished();
+  reportThroughput("playback", playedBytes, played, secondsSince(start));
+  EXPECT_EQ(static_cast<uint64_t>(kMessages), played);
+
+  std::remove(logName.c_str());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Keep the publications of the benchmarks away from the other programs.
+  setenv("IGN_PARTITION", testing::getRandomNumber().c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
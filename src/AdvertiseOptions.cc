@@ -15,9 +15,12 @@
  *
 */
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <string>
 
 #include "ignition/transport/AdvertiseOptions.hh"
 #include "ignition/transport/Helpers.hh"
@@ -57,6 +60,46 @@ namespace ignition
 
       /// \brief Default message publication rate.
       public: uint64_t msgsPerSec = kUnthrottled;
+
+      /// \brief Maximum number of messages pending local delivery.
+      public: uint64_t localQueueDepth = 0;
+
+      /// \brief Policy applied when the local queue is full.
+      public: QueueOverflowPolicy_t overflowPolicy =
+        QueueOverflowPolicy_t::DROP_OLDEST;
+
+      /// \brief Multicast group of the data, empty if not used.
+      public: std::string multicastGroup;
+
+      /// \brief Whether best effort delivery is offered.
+      public: bool bestEffort = false;
+
+      /// \brief Whether the last message is kept for the late subscribers.
+      public: bool latched = false;
+
+      /// \brief Rate wanted by a subscriber process, 0 if unknown.
+      public: uint64_t subscriberMsgsPerSec = 0;
+
+      /// \brief Whether a subscriber process accepts the compact header.
+      public: bool compactHeader = false;
+
+      /// \brief Traffic class of the topic.
+      public: TrafficClass_t trafficClass = TrafficClass_t::DEFAULT;
+
+      /// \brief Size of the fragments, 0 if not fragmented.
+      public: uint64_t fragmentSize = 0;
+
+      /// \brief Compression of the remote messages.
+      public: Compression_t compression = Compression_t::NONE;
+
+      /// \brief Size above which the messages are compressed.
+      public: uint64_t compressionThreshold = 1024;
+
+      /// \brief Number of slots of the real-time queue, 0 if disabled.
+      public: uint64_t realtimeSlots = 0;
+
+      /// \brief Size of the slots of the real-time queue.
+      public: uint64_t realtimeSlotSize = 0;
     };
 
     /// \internal
@@ -68,6 +111,12 @@ namespace ignition
 
       /// \brief Destructor.
       public: virtual ~AdvertiseServiceOptionsPrivate() = default;
+
+      /// \brief Maximum number of calls running at the same time.
+      public: uint32_t maxConcurrentCalls = 0;
+
+      /// \brief Time to live of the cached responses.
+      public: std::chrono::nanoseconds replyCacheTtl{0};
     };
     }
   }
@@ -148,6 +197,17 @@ AdvertiseMessageOptions &AdvertiseMessageOptions::operator=(
 {
   AdvertiseOptions::operator=(_other);
   this->SetMsgsPerSec(_other.MsgsPerSec());
+  this->SetLocalQueueDepth(_other.LocalQueueDepth());
+  this->SetOverflowPolicy(_other.OverflowPolicy());
+  this->SetMulticastGroup(_other.MulticastGroup());
+  this->SetBestEffort(_other.BestEffort());
+  this->SetLatched(_other.Latched());
+  this->SetSubscriberMsgsPerSec(_other.SubscriberMsgsPerSec());
+  this->SetCompactHeader(_other.CompactHeader());
+  this->SetTrafficClass(_other.TrafficClass());
+  this->SetFragmentSize(_other.FragmentSize());
+  this->SetCompression(_other.Compression(), _other.CompressionThreshold());
+  this->SetRealtimeQueue(_other.RealtimeSlots(), _other.RealtimeSlotSize());
   return *this;
 }
 
@@ -156,7 +216,20 @@ bool AdvertiseMessageOptions::operator==(
   const AdvertiseMessageOptions &_other) const
 {
   return AdvertiseOptions::operator==(_other) &&
-         this->MsgsPerSec() == _other.MsgsPerSec();
+         this->MsgsPerSec() == _other.MsgsPerSec() &&
+         this->LocalQueueDepth() == _other.LocalQueueDepth() &&
+         this->OverflowPolicy() == _other.OverflowPolicy() &&
+         this->MulticastGroup() == _other.MulticastGroup() &&
+         this->BestEffort() == _other.BestEffort() &&
+         this->Latched() == _other.Latched() &&
+         this->SubscriberMsgsPerSec() == _other.SubscriberMsgsPerSec() &&
+         this->CompactHeader() == _other.CompactHeader() &&
+         this->TrafficClass() == _other.TrafficClass() &&
+         this->FragmentSize() == _other.FragmentSize() &&
+         this->Compression() == _other.Compression() &&
+         this->CompressionThreshold() == _other.CompressionThreshold() &&
+         this->RealtimeSlots() == _other.RealtimeSlots() &&
+         this->RealtimeSlotSize() == _other.RealtimeSlotSize();
 }
 
 //////////////////////////////////////////////////
@@ -184,6 +257,163 @@ void AdvertiseMessageOptions::SetMsgsPerSec(const uint64_t _newMsgsPerSec)
   this->dataPtr->msgsPerSec = _newMsgsPerSec;
 }
 
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::LocalQueueDepth() const
+{
+  return this->dataPtr->localQueueDepth;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetLocalQueueDepth(const uint64_t _depth)
+{
+  this->dataPtr->localQueueDepth = _depth;
+}
+
+//////////////////////////////////////////////////
+QueueOverflowPolicy_t AdvertiseMessageOptions::OverflowPolicy() const
+{
+  return this->dataPtr->overflowPolicy;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetOverflowPolicy(
+  const QueueOverflowPolicy_t _policy)
+{
+  this->dataPtr->overflowPolicy = _policy;
+}
+
+//////////////////////////////////////////////////
+const std::string &AdvertiseMessageOptions::MulticastGroup() const
+{
+  return this->dataPtr->multicastGroup;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetMulticastGroup(const std::string &_group)
+{
+  this->dataPtr->multicastGroup = _group;
+}
+
+//////////////////////////////////////////////////
+bool AdvertiseMessageOptions::BestEffort() const
+{
+  return this->dataPtr->bestEffort;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetBestEffort(const bool _bestEffort)
+{
+  this->dataPtr->bestEffort = _bestEffort;
+}
+
+//////////////////////////////////////////////////
+bool AdvertiseMessageOptions::Latched() const
+{
+  return this->dataPtr->latched;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetLatched(const bool _latched)
+{
+  this->dataPtr->latched = _latched;
+}
+
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::SubscriberMsgsPerSec() const
+{
+  return this->dataPtr->subscriberMsgsPerSec;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetSubscriberMsgsPerSec(
+    const uint64_t _msgsPerSec)
+{
+  this->dataPtr->subscriberMsgsPerSec = _msgsPerSec;
+}
+
+//////////////////////////////////////////////////
+bool AdvertiseMessageOptions::CompactHeader() const
+{
+  return this->dataPtr->compactHeader;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetCompactHeader(const bool _compact)
+{
+  this->dataPtr->compactHeader = _compact;
+}
+
+//////////////////////////////////////////////////
+TrafficClass_t AdvertiseMessageOptions::TrafficClass() const
+{
+  return this->dataPtr->trafficClass;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetTrafficClass(const TrafficClass_t _class)
+{
+  this->dataPtr->trafficClass = _class;
+}
+
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::FragmentSize() const
+{
+  return this->dataPtr->fragmentSize;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetFragmentSize(const uint64_t _size)
+{
+  this->dataPtr->fragmentSize = _size;
+}
+
+//////////////////////////////////////////////////
+Compression_t AdvertiseMessageOptions::Compression() const
+{
+  return this->dataPtr->compression;
+}
+
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::CompressionThreshold() const
+{
+  return this->dataPtr->compressionThreshold;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetCompression(
+  const Compression_t _compression, const uint64_t _threshold)
+{
+  this->dataPtr->compression = _compression;
+  this->dataPtr->compressionThreshold = _threshold;
+}
+
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::RealtimeSlots() const
+{
+  return this->dataPtr->realtimeSlots;
+}
+
+//////////////////////////////////////////////////
+uint64_t AdvertiseMessageOptions::RealtimeSlotSize() const
+{
+  return this->dataPtr->realtimeSlotSize;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseMessageOptions::SetRealtimeQueue(const uint64_t _slots,
+  const uint64_t _slotSize)
+{
+  if (_slots == 0 || _slotSize == 0)
+  {
+    this->dataPtr->realtimeSlots = 0;
+    this->dataPtr->realtimeSlotSize = 0;
+    return;
+  }
+
+  this->dataPtr->realtimeSlots = _slots;
+  this->dataPtr->realtimeSlotSize = _slotSize;
+}
+
 //////////////////////////////////////////////////
 AdvertiseServiceOptions::AdvertiseServiceOptions()
   : AdvertiseOptions(),
@@ -209,6 +439,8 @@ AdvertiseServiceOptions &AdvertiseServiceOptions::operator=(
   const AdvertiseServiceOptions &_other)
 {
   AdvertiseOptions::operator=(_other);
+  this->SetMaxConcurrentCalls(_other.MaxConcurrentCalls());
+  this->SetReplyCacheTtl(_other.ReplyCacheTtl());
   return *this;
 }
 
@@ -216,7 +448,9 @@ AdvertiseServiceOptions &AdvertiseServiceOptions::operator=(
 bool AdvertiseServiceOptions::operator==(
   const AdvertiseServiceOptions &_other) const
 {
-  return AdvertiseOptions::operator==(_other);
+  return AdvertiseOptions::operator==(_other) &&
+         this->MaxConcurrentCalls() == _other.MaxConcurrentCalls() &&
+         this->ReplyCacheTtl() == _other.ReplyCacheTtl();
 }
 
 //////////////////////////////////////////////////
@@ -225,3 +459,29 @@ bool AdvertiseServiceOptions::operator!=(
 {
   return !(*this == _other);
 }
+
+//////////////////////////////////////////////////
+uint32_t AdvertiseServiceOptions::MaxConcurrentCalls() const
+{
+  return this->dataPtr->maxConcurrentCalls;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseServiceOptions::SetMaxConcurrentCalls(const uint32_t _maxCalls)
+{
+  this->dataPtr->maxConcurrentCalls = _maxCalls;
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds AdvertiseServiceOptions::ReplyCacheTtl() const
+{
+  return this->dataPtr->replyCacheTtl;
+}
+
+//////////////////////////////////////////////////
+void AdvertiseServiceOptions::SetReplyCacheTtl(
+  const std::chrono::nanoseconds &_ttl)
+{
+  this->dataPtr->replyCacheTtl =
+    std::max(_ttl, std::chrono::nanoseconds::zero());
+}
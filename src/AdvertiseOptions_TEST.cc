@@ -15,8 +15,10 @@
  *
 */
 
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "ignition/transport/AdvertiseOptions.hh"
@@ -166,6 +168,38 @@ TEST(AdvertiseOptionsTest, msgStreamInsertion)
     "\tThrottled? Yes\n"
     "\tRate: 10 msgs/sec\n";
   EXPECT_EQ(output.str(), expectedOutput);
+
+  // Each option adds its own line, and only when it is set.
+  std::vector<std::pair<AdvertiseMessageOptions, std::string>> cases(10,
+    {opts, ""});
+  cases[0].first.SetLocalQueueDepth(5u);
+  cases[0].first.SetOverflowPolicy(QueueOverflowPolicy_t::BLOCK);
+  cases[0].second = "\tLocal queue depth: 5\n\tOverflow policy: Block\n";
+  cases[1].first.SetMulticastGroup("239.255.0.8:11320");
+  cases[1].second = "\tMulticast group: 239.255.0.8:11320\n";
+  cases[2].first.SetBestEffort(true);
+  cases[2].second = "\tBest effort: Yes\n";
+  cases[3].first.SetLatched(true);
+  cases[3].second = "\tLatched: Yes\n";
+  cases[4].first.SetSubscriberMsgsPerSec(kUnthrottled);
+  cases[5].first.SetSubscriberMsgsPerSec(5u);
+  cases[5].second = "\tSubscriber rate: 5 msgs/sec\n";
+  cases[6].first.SetTrafficClass(TrafficClass_t::BULK);
+  cases[6].second = "\tTraffic class: Bulk\n";
+  cases[7].first.SetFragmentSize(1048576u);
+  cases[7].second = "\tFragment size: 1048576 bytes\n";
+  cases[8].first.SetRealtimeQueue(16u, 512u);
+  cases[8].second = "\tReal-time queue: 16 slots of 512 bytes\n";
+  cases[9].first.SetCompression(Compression_t::ZLIB, 2048u);
+  cases[9].second = "\tCompression: zlib, above 2048 bytes\n";
+
+  for (const auto &c : cases)
+  {
+    output.clear();
+    output.str("");
+    output << c.first;
+    EXPECT_EQ(output.str(), expectedOutput + c.second);
+  }
 }
 
 //////////////////////////////////////////////////
@@ -184,6 +218,73 @@ TEST(AdvertiseOptionsTest, msgAccessors)
   opts.SetMsgsPerSec(10u);
   EXPECT_EQ(opts.MsgsPerSec(), 10u);
   EXPECT_TRUE(opts.Throttled());
+
+  // Local queue.
+  EXPECT_EQ(opts.LocalQueueDepth(), 0u);
+  EXPECT_EQ(opts.OverflowPolicy(), QueueOverflowPolicy_t::DROP_OLDEST);
+  opts.SetLocalQueueDepth(3u);
+  opts.SetOverflowPolicy(QueueOverflowPolicy_t::DROP_NEWEST);
+  EXPECT_EQ(opts.LocalQueueDepth(), 3u);
+  EXPECT_EQ(opts.OverflowPolicy(), QueueOverflowPolicy_t::DROP_NEWEST);
+
+  // Multicast group.
+  EXPECT_TRUE(opts.MulticastGroup().empty());
+  opts.SetMulticastGroup("239.255.0.8:11320");
+  EXPECT_EQ(opts.MulticastGroup(), "239.255.0.8:11320");
+
+  // Best effort.
+  EXPECT_FALSE(opts.BestEffort());
+  opts.SetBestEffort(true);
+  EXPECT_TRUE(opts.BestEffort());
+
+  // Latched.
+  EXPECT_FALSE(opts.Latched());
+  opts.SetLatched(true);
+  EXPECT_TRUE(opts.Latched());
+
+  // Subscriber rate.
+  EXPECT_EQ(opts.SubscriberMsgsPerSec(), 0u);
+  opts.SetSubscriberMsgsPerSec(5u);
+  EXPECT_EQ(opts.SubscriberMsgsPerSec(), 5u);
+
+  // Compact header.
+  EXPECT_FALSE(opts.CompactHeader());
+  opts.SetCompactHeader(true);
+  EXPECT_TRUE(opts.CompactHeader());
+
+  // Traffic class.
+  EXPECT_EQ(opts.TrafficClass(), TrafficClass_t::DEFAULT);
+  opts.SetTrafficClass(TrafficClass_t::BULK);
+  EXPECT_EQ(opts.TrafficClass(), TrafficClass_t::BULK);
+
+  // Fragment size.
+  EXPECT_EQ(opts.FragmentSize(), 0u);
+  opts.SetFragmentSize(65536u);
+  EXPECT_EQ(opts.FragmentSize(), 65536u);
+
+  // Compression.
+  EXPECT_EQ(opts.Compression(), Compression_t::NONE);
+  EXPECT_EQ(opts.CompressionThreshold(), 1024u);
+  opts.SetCompression(Compression_t::ZLIB);
+  EXPECT_EQ(opts.Compression(), Compression_t::ZLIB);
+  EXPECT_EQ(opts.CompressionThreshold(), 1024u);
+  opts.SetCompression(Compression_t::ZLIB, 256u);
+  EXPECT_EQ(opts.CompressionThreshold(), 256u);
+
+  // Real-time queue.
+  EXPECT_EQ(opts.RealtimeSlots(), 0u);
+  EXPECT_EQ(opts.RealtimeSlotSize(), 0u);
+  opts.SetRealtimeQueue(8u, 0u);
+  EXPECT_EQ(opts.RealtimeSlots(), 0u);
+  EXPECT_EQ(opts.RealtimeSlotSize(), 0u);
+  opts.SetRealtimeQueue(8u, 256u);
+  EXPECT_EQ(opts.RealtimeSlots(), 8u);
+  EXPECT_EQ(opts.RealtimeSlotSize(), 256u);
+
+  AdvertiseMessageOptions other;
+  EXPECT_NE(opts, other);
+  other = opts;
+  EXPECT_EQ(opts, other);
 }
 
 //////////////////////////////////////////////////
@@ -251,6 +352,33 @@ TEST(AdvertiseOptionsTest, srvAccessors)
   EXPECT_EQ(opts.Scope(), Scope_t::ALL);
   opts.SetScope(Scope_t::HOST);
   EXPECT_EQ(opts.Scope(), Scope_t::HOST);
+
+  // Concurrent calls.
+  EXPECT_EQ(opts.MaxConcurrentCalls(), 0u);
+  opts.SetMaxConcurrentCalls(4u);
+  EXPECT_EQ(opts.MaxConcurrentCalls(), 4u);
+
+  // Reply cache.
+  EXPECT_EQ(opts.ReplyCacheTtl(), std::chrono::nanoseconds::zero());
+  opts.SetReplyCacheTtl(-std::chrono::seconds(1));
+  EXPECT_EQ(opts.ReplyCacheTtl(), std::chrono::nanoseconds::zero());
+  opts.SetReplyCacheTtl(std::chrono::milliseconds(2500));
+  EXPECT_EQ(opts.ReplyCacheTtl(), std::chrono::milliseconds(2500));
+
+  AdvertiseServiceOptions other;
+  other.SetScope(Scope_t::HOST);
+  EXPECT_NE(opts, other);
+  other = opts;
+  EXPECT_EQ(opts, other);
+
+  std::ostringstream output;
+  output << opts;
+  std::string expectedOutput =
+    "Advertise options:\n"
+    "\tScope: Host\n"
+    "\tMax concurrent calls: 4\n"
+    "\tReply cache TTL: 2.5 s\n";
+  EXPECT_EQ(output.str(), expectedOutput);
 }
 
 //////////////////////////////////////////////////
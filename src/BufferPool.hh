@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_BUFFERPOOL_HH_
+#define IGN_TRANSPORT_BUFFERPOOL_HH_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "CopyCounters.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class BufferPool BufferPool.hh
+    /// \brief A pool of reference counted byte buffers grouped in power of two
+    /// size classes. When the last reference to a buffer goes away, the buffer
+    /// is returned to the pool instead of being deallocated, so steady state
+    /// publication of similarly sized messages doesn't hit the heap for the
+    /// payload. Buffers can outlive the pool, in which case they are simply
+    /// deallocated. This class is thread safe.
+    class BufferPool
+    {
+      /// \brief Size of the smallest size class (bytes).
+      public: static constexpr std::size_t kMinClassSize = 64;
+
+      /// \brief Number of size classes. Requests bigger than the largest
+      /// class (4 MiB) are not pooled.
+      public: static constexpr std::size_t kNumClasses = 17;
+
+      /// \brief Default maximum number of cached buffers per size class.
+      public: static constexpr std::size_t kDefaultCapacity = 16;
+
+      /// \brief Maximum number of bytes cached per size class. This limits
+      /// the number of cached buffers in the largest classes.
+      public: static constexpr std::size_t kMaxClassBytes = 4 * 1024 * 1024;
+
+      /// \brief Constructor.
+      /// \param[in] _capacity Maximum number of cached buffers per size class.
+      /// A value of 0 disables pooling.
+      public: explicit BufferPool(std::size_t _capacity = kDefaultCapacity)
+        : storage(std::make_shared<Storage>(_capacity))
+      {
+      }
+
+      /// \brief Get a buffer of at least _size bytes.
+      /// \param[in] _size Requested size (bytes).
+      /// \return The buffer. Never null.
+      public: std::shared_ptr<char[]> Acquire(std::size_t _size)
+      {
+        const std::size_t idx = ClassIndex(_size);
+        if (idx >= kNumClasses || this->storage->capacity == 0)
+        {
+          IGN_TRANSPORT_COUNT_ALLOCATION(_size);
+          return std::shared_ptr<char[]>(new char[std::max<size_t>(_size, 1)]);
+        }
+
+        char *block = this->storage->Take(idx);
+        if (!block)
+        {
+          IGN_TRANSPORT_COUNT_ALLOCATION(ClassSize(idx));
+          block = new char[ClassSize(idx)];
+        }
+
+        std::weak_ptr<Storage> weak = this->storage;
+        return std::shared_ptr<char[]>(block, [weak, idx](char *_block)
+        {
+          auto s = weak.lock();
+          if (!s || !s->Give(idx, _block))
+            delete[] _block;
+        });
+      }
+
+      /// \brief Get the number of buffers currently cached by the pool.
+      /// \return Number of cached buffers.
+      public: std::size_t CachedCount() const
+      {
+        return this->storage->CachedCount();
+      }
+
+      /// \brief Get the size class that serves a request.
+      /// \param[in] _size Requested size (bytes).
+      /// \return The class index, or kNumClasses if the size is not pooled.
+      public: static std::size_t ClassIndex(std::size_t _size)
+      {
+        std::size_t idx = 0;
+        std::size_t classSize = kMinClassSize;
+        while (classSize < _size && idx < kNumClasses)
+        {
+          classSize <<= 1;
+          ++idx;
+        }
+        return idx;
+      }
+
+      /// \brief Get the size of the buffers of a size class.
+      /// \param[in] _idx Class index.
+      /// \return Size of the buffers (bytes).
+      public: static std::size_t ClassSize(std::size_t _idx)
+      {
+        return kMinClassSize << _idx;
+      }
+
+      /// \brief Cached buffers, shared with the deleters of the buffers handed
+      /// out so that they can be recycled while the pool is alive.
+      private: class Storage
+      {
+        /// \brief Constructor.
+        /// \param[in] _capacity Maximum number of cached buffers per class.
+        public: explicit Storage(std::size_t _capacity)
+          : capacity(_capacity)
+        {
+        }
+
+        /// \brief Destructor. Deallocates all the cached buffers.
+        public: ~Storage()
+        {
+          for (auto &sizeClass : this->classes)
+          {
+            for (char *block : sizeClass.blocks)
+              delete[] block;
+          }
+        }
+
+        /// \brief Take a cached buffer.
+        /// \param[in] _idx Class index.
+        /// \return The buffer or nullptr if none is cached.
+        public: char *Take(std::size_t _idx)
+        {
+          auto &sizeClass = this->classes[_idx];
+          std::lock_guard<std::mutex> lk(sizeClass.mutex);
+          if (sizeClass.blocks.empty())
+            return nullptr;
+
+          char *block = sizeClass.blocks.back();
+          sizeClass.blocks.pop_back();
+          return block;
+        }
+
+        /// \brief Return a buffer to the pool.
+        /// \param[in] _idx Class index.
+        /// \param[in] _block The buffer.
+        /// \return True if the buffer was cached, false if the class is full
+        /// and the caller must deallocate the buffer.
+        public: bool Give(std::size_t _idx, char *_block)
+        {
+          const std::size_t limit = std::min(this->capacity,
+            std::max<std::size_t>(1u, kMaxClassBytes / ClassSize(_idx)));
+
+          auto &sizeClass = this->classes[_idx];
+          std::lock_guard<std::mutex> lk(sizeClass.mutex);
+          if (sizeClass.blocks.size() >= limit)
+            return false;
+
+          sizeClass.blocks.push_back(_block);
+          return true;
+        }
+
+        /// \brief Get the number of cached buffers.
+        /// \return Number of cached buffers.
+        public: std::size_t CachedCount()
+        {
+          std::size_t count = 0;
+          for (auto &sizeClass : this->classes)
+          {
+            std::lock_guard<std::mutex> lk(sizeClass.mutex);
+            count += sizeClass.blocks.size();
+          }
+          return count;
+        }
+
+        /// \brief Cached buffers of a size class.
+        public: struct SizeClass
+        {
+          /// \brief Protects the blocks.
+          public: std::mutex mutex;
+
+          /// \brief Cached buffers.
+          public: std::vector<char *> blocks;
+        };
+
+        /// \brief Maximum number of cached buffers per class.
+        public: const std::size_t capacity;
+
+        /// \brief All the size classes.
+        public: std::array<SizeClass, kNumClasses> classes;
+      };
+
+      /// \brief Cached buffers.
+      private: std::shared_ptr<Storage> storage;
+    };
+    }
+  }
+}
+#endif
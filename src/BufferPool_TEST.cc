@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstring>
+#include <memory>
+
+#include "BufferPool.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Check the size classes.
+TEST(BufferPoolTest, ClassIndex)
+{
+  EXPECT_EQ(0u, BufferPool::ClassIndex(0));
+  EXPECT_EQ(0u, BufferPool::ClassIndex(64));
+  EXPECT_EQ(1u, BufferPool::ClassIndex(65));
+  EXPECT_EQ(1u, BufferPool::ClassIndex(128));
+  EXPECT_EQ(BufferPool::kNumClasses - 1,
+    BufferPool::ClassIndex(4 * 1024 * 1024));
+  EXPECT_EQ(BufferPool::kNumClasses,
+    BufferPool::ClassIndex(4 * 1024 * 1024 + 1));
+  EXPECT_EQ(128u, BufferPool::ClassSize(1));
+}
+
+//////////////////////////////////////////////////
+/// \brief Buffers are recycled once released.
+TEST(BufferPoolTest, Recycle)
+{
+  BufferPool pool;
+  EXPECT_EQ(0u, pool.CachedCount());
+
+  char *first;
+  {
+    auto buffer = pool.Acquire(100);
+    ASSERT_NE(nullptr, buffer);
+    first = buffer.get();
+    memset(buffer.get(), 0, 100);
+
+    // It is still in use by this copy.
+    auto copy = buffer;
+    buffer.reset();
+    EXPECT_EQ(0u, pool.CachedCount());
+  }
+  EXPECT_EQ(1u, pool.CachedCount());
+
+  // A request in the same size class gets the same buffer back.
+  auto buffer = pool.Acquire(120);
+  EXPECT_EQ(first, buffer.get());
+  EXPECT_EQ(0u, pool.CachedCount());
+}
+
+//////////////////////////////////////////////////
+/// \brief Large and disabled pools don't cache anything.
+TEST(BufferPoolTest, NotPooled)
+{
+  BufferPool pool;
+  pool.Acquire(8 * 1024 * 1024).reset();
+  EXPECT_EQ(0u, pool.CachedCount());
+
+  BufferPool disabled(0);
+  disabled.Acquire(100).reset();
+  EXPECT_EQ(0u, disabled.CachedCount());
+}
+
+//////////////////////////////////////////////////
+/// \brief The number of cached buffers is limited.
+TEST(BufferPoolTest, Capacity)
+{
+  BufferPool pool(2);
+  {
+    auto b1 = pool.Acquire(10);
+    auto b2 = pool.Acquire(10);
+    auto b3 = pool.Acquire(10);
+  }
+  EXPECT_EQ(2u, pool.CachedCount());
+
+  // Only one 4 MiB buffer fits in the class budget.
+  {
+    auto b1 = pool.Acquire(4 * 1024 * 1024);
+    auto b2 = pool.Acquire(4 * 1024 * 1024);
+  }
+  EXPECT_EQ(3u, pool.CachedCount());
+}
+
+//////////////////////////////////////////////////
+/// \brief Buffers can outlive their pool.
+TEST(BufferPoolTest, OutlivePool)
+{
+  std::shared_ptr<char[]> buffer;
+  {
+    BufferPool pool;
+    buffer = pool.Acquire(10);
+  }
+  buffer[0] = 'a';
+  EXPECT_EQ('a', buffer[0]);
+  buffer.reset();
+}
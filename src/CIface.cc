@@ -15,8 +15,11 @@
  *
 */
 
+#include <chrono>
+#include <cstring>
 #include <map>
 #include <memory>
+#include <string>
 
 #include "ignition/transport/Node.hh"
 #include "ignition/transport/SubscribeOptions.hh"
@@ -32,6 +35,23 @@ struct IgnTransportNode
   std::map<std::string, ignition::transport::Node::Publisher> publishers;
 };
 
+/// \brief The data of a message loaned to a C callback.
+struct IgnTransportLoan
+{
+  /// \brief The data.
+  std::unique_ptr<char[]> data;
+};
+
+/// \brief A wrapper to store a publisher and its message type.
+struct IgnTransportPublisher
+{
+  /// \brief The publisher.
+  ignition::transport::Node::Publisher publisher;
+
+  /// \brief Name of the message type of the publisher.
+  std::string msgType;
+};
+
 /////////////////////////////////////////////////
 IgnTransportNode *ignTransportNodeCreate(const char *_partition)
 {
@@ -70,6 +90,17 @@ int ignTransportAdvertise(IgnTransportNode *_node, const char *_topic,
 /////////////////////////////////////////////////
 int ignTransportPublish(IgnTransportNode *_node, const char *_topic,
     const void *_data, const char *_msgType)
+{
+  if (!_data)
+    return 1;
+
+  return ignTransportPublishData(_node, _topic, _data,
+    strlen(static_cast<const char *>(_data)), _msgType);
+}
+
+/////////////////////////////////////////////////
+int ignTransportPublishData(IgnTransportNode *_node, const char *_topic,
+    const void *_data, size_t _size, const char *_msgType)
 {
   if (!_node)
     return 1;
@@ -78,13 +109,51 @@ int ignTransportPublish(IgnTransportNode *_node, const char *_topic,
   if (ignTransportAdvertise(_node, _topic, _msgType) == 0)
   {
     // Publish the message.
-    return _node->publishers[_topic].PublishRaw(
-      reinterpret_cast<const char*>(_data), _msgType) ? 0 : 1;
+    return _node->publishers[_topic].PublishRaw(_data, _size, _msgType) ?
+      0 : 1;
   }
 
   return 1;
 }
 
+/////////////////////////////////////////////////
+IgnTransportPublisher *ignTransportAdvertisePublisher(
+    IgnTransportNode *_node, const char *_topic, const char *_msgType)
+{
+  if (!_node || !_topic || !_msgType ||
+      ignTransportAdvertise(_node, _topic, _msgType) != 0)
+  {
+    return nullptr;
+  }
+
+  // Share the publisher of the node, which might already exist.
+  const auto &publisher = _node->publishers[_topic];
+  if (!publisher)
+    return nullptr;
+
+  return new IgnTransportPublisher{publisher, _msgType};
+}
+
+/////////////////////////////////////////////////
+int ignTransportPublisherPublish(IgnTransportPublisher *_pub,
+    const void *_data, size_t _size)
+{
+  if (!_pub)
+    return 1;
+
+  return _pub->publisher.PublishRaw(_data, _size, _pub->msgType) ? 0 : 1;
+}
+
+/////////////////////////////////////////////////
+void ignTransportPublisherDestroy(IgnTransportPublisher **_pub)
+{
+  if (*_pub)
+  {
+    delete *_pub;
+    *_pub = nullptr;
+  }
+}
+
 /////////////////////////////////////////////////
 int ignTransportSubscribe(IgnTransportNode *_node, const char *_topic,
     void (*_callback)(const char *, size_t, const char *, void *),
@@ -145,6 +214,54 @@ int ignTransportSubscribeNonConst(IgnTransportNode *_node, char *_topic,
                   }) ? 0 : 1;
 }
 
+/////////////////////////////////////////////////
+int ignTransportSubscribeInfo(IgnTransportNode *_node, const char *_topic,
+    int _loan,
+    void (*_callback)(const char *, size_t, const IgnTransportMessageInfo *,
+      IgnTransportLoan *, void *),
+    void *_userData)
+{
+  if (!_node || !_callback)
+    return 1;
+
+  const bool loan = _loan != 0;
+  return _node->nodePtr->SubscribeRaw(_topic,
+      [_callback, _userData, loan](const char *_msg,
+                  const size_t _size,
+                  const ignition::transport::MessageInfo &_info) -> void
+                  {
+                    IgnTransportMessageInfo info;
+                    info.topic = _info.Topic().c_str();
+                    info.partition = _info.Partition().c_str();
+                    info.msgType = _info.Type().c_str();
+                    info.publisherAddress = _info.PublisherAddress().c_str();
+                    info.intraProcess = _info.IntraProcess() ? 1 : 0;
+                    info.receptionTime = std::chrono::duration_cast<
+                      std::chrono::nanoseconds>(
+                        _info.ReceptionTime().time_since_epoch()).count();
+
+                    if (!loan)
+                    {
+                      _callback(_msg, _size, &info, nullptr, _userData);
+                      return;
+                    }
+
+                    // The data only outlives the dispatch as a copy.
+                    IgnTransportLoan *msgLoan = new IgnTransportLoan;
+                    msgLoan->data.reset(new char[_size > 0 ? _size : 1]);
+                    if (_size > 0)
+                      memcpy(msgLoan->data.get(), _msg, _size);
+                    _callback(msgLoan->data.get(), _size, &info, msgLoan,
+                              _userData);
+                  }) ? 0 : 1;
+}
+
+/////////////////////////////////////////////////
+void ignTransportLoanRelease(IgnTransportLoan *_loan)
+{
+  delete _loan;
+}
+
 /////////////////////////////////////////////////
 int ignTransportUnsubscribe(IgnTransportNode *_node, const char *_topic)
 {
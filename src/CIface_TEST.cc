@@ -14,6 +14,10 @@
  * limitations under the License.
  *
 */
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <ignition/msgs/stringmsg.pb.h>
 
 #include "gtest/gtest.h"
@@ -54,6 +58,56 @@ void cbNonConst(char *_data, size_t _size, char *_msgType, void *_userData)
   ++count;
 }
 
+//////////////////////////////////////////////////
+/// \brief Function called each time a message with null bytes is received.
+void cbData(const char *_data, size_t _size, const char *_msgType,
+    void *_userData)
+{
+  int *userData = static_cast<int*>(_userData);
+
+  ASSERT_NE(nullptr, userData);
+  EXPECT_EQ(42, *userData);
+
+  ignition::msgs::StringMsg msg;
+  EXPECT_TRUE(msg.ParseFromArray(_data, _size));
+  EXPECT_STREQ("ignition.msgs.StringMsg", _msgType);
+  EXPECT_EQ(msg.data(), std::string("HEL\0LO", 6));
+  ++count;
+}
+
+//////////////////////////////////////////////////
+/// \brief Data of the messages loaned to cbInfo.
+static std::vector<std::pair<IgnTransportLoan *, const char *>> g_loans;
+
+//////////////////////////////////////////////////
+/// \brief Function called each time a topic update is received, with the
+/// information about the message.
+void cbInfo(const char *_data, size_t _size,
+    const IgnTransportMessageInfo *_info, IgnTransportLoan *_loan,
+    void *_userData)
+{
+  int *userData = static_cast<int*>(_userData);
+
+  ASSERT_NE(nullptr, userData);
+  ASSERT_NE(nullptr, _info);
+
+  ignition::msgs::StringMsg msg;
+  EXPECT_TRUE(msg.ParseFromArray(_data, _size));
+  EXPECT_EQ(msg.data(), "HELLO");
+  EXPECT_STREQ("/foo_info", _info->topic);
+  EXPECT_NE(nullptr, _info->partition);
+  EXPECT_STREQ("ignition.msgs.StringMsg", _info->msgType);
+  EXPECT_STREQ("", _info->publisherAddress);
+  EXPECT_EQ(1, _info->intraProcess);
+  EXPECT_GT(_info->receptionTime, 0);
+
+  // The loans are requested by the subscription with the user data 1.
+  EXPECT_EQ(*userData == 1, _loan != nullptr);
+  if (_loan)
+    g_loans.emplace_back(_loan, _data);
+  ++count;
+}
+
 //////////////////////////////////////////////////
 TEST(CIfaceTest, PubSub)
 {
@@ -110,6 +164,115 @@ TEST(CIfaceTest, PubSub)
   EXPECT_EQ(nullptr, node);
 }
 
+//////////////////////////////////////////////////
+TEST(CIfaceTest, PubSubData)
+{
+  count = 0;
+  IgnTransportNode *node = ignTransportNodeCreate(nullptr);
+  EXPECT_NE(nullptr, node);
+
+  const char *topic = "/foo_data";
+  int userData = 42;
+  ASSERT_EQ(0, ignTransportSubscribe(node, topic, cbData, &userData));
+
+  // The serialized message contains null bytes.
+  ignition::msgs::StringMsg msg;
+  msg.set_data(std::string("HEL\0LO", 6));
+  const std::string buffer = msg.SerializeAsString();
+
+  EXPECT_EQ(0, ignTransportPublishData(node, topic, buffer.data(),
+    buffer.size(), msg.GetTypeName().c_str()));
+  EXPECT_EQ(1, count);
+
+  EXPECT_NE(0, ignTransportPublishData(nullptr, topic, buffer.data(),
+    buffer.size(), msg.GetTypeName().c_str()));
+  EXPECT_NE(0, ignTransportPublish(node, topic, nullptr,
+    msg.GetTypeName().c_str()));
+
+  ignTransportNodeDestroy(&node);
+  EXPECT_EQ(nullptr, node);
+}
+
+//////////////////////////////////////////////////
+TEST(CIfaceTest, Publisher)
+{
+  count = 0;
+  IgnTransportNode *node = ignTransportNodeCreate(nullptr);
+  EXPECT_NE(nullptr, node);
+
+  const char *topic = "/foo_publisher";
+  int userData = 42;
+  ASSERT_EQ(0, ignTransportSubscribe(node, topic, cb, &userData));
+
+  ignition::msgs::StringMsg msg;
+  msg.set_data("HELLO");
+  const std::string buffer = msg.SerializeAsString();
+
+  EXPECT_EQ(nullptr, ignTransportAdvertisePublisher(nullptr, topic,
+    msg.GetTypeName().c_str()));
+  EXPECT_EQ(nullptr, ignTransportAdvertisePublisher(node, "invalid topic",
+    msg.GetTypeName().c_str()));
+  EXPECT_NE(0, ignTransportPublisherPublish(nullptr, buffer.data(),
+    buffer.size()));
+
+  IgnTransportPublisher *pub = ignTransportAdvertisePublisher(node, topic,
+    msg.GetTypeName().c_str());
+  ASSERT_NE(nullptr, pub);
+  EXPECT_EQ(0, ignTransportPublisherPublish(pub, buffer.data(),
+    buffer.size()));
+  EXPECT_EQ(1, count);
+
+  // The publisher is shared with the node.
+  EXPECT_EQ(0, ignTransportPublishData(node, topic, buffer.data(),
+    buffer.size(), msg.GetTypeName().c_str()));
+  EXPECT_EQ(2, count);
+
+  ignTransportPublisherDestroy(&pub);
+  EXPECT_EQ(nullptr, pub);
+  ignTransportNodeDestroy(&node);
+  EXPECT_EQ(nullptr, node);
+}
+
+//////////////////////////////////////////////////
+TEST(CIfaceTest, SubscribeInfo)
+{
+  count = 0;
+  g_loans.clear();
+  IgnTransportNode *node = ignTransportNodeCreate(nullptr);
+  EXPECT_NE(nullptr, node);
+
+  const char *topic = "/foo_info";
+  int borrowed = 0;
+  int loaned = 1;
+  EXPECT_NE(0, ignTransportSubscribeInfo(node, topic, 0, nullptr, &borrowed));
+  ASSERT_EQ(0, ignTransportSubscribeInfo(node, topic, 0, cbInfo, &borrowed));
+  IgnTransportNode *loanNode = ignTransportNodeCreate(nullptr);
+  ASSERT_EQ(0, ignTransportSubscribeInfo(loanNode, topic, 1, cbInfo,
+    &loaned));
+
+  ignition::msgs::StringMsg msg;
+  msg.set_data("HELLO");
+  std::string buffer = msg.SerializeAsString();
+  EXPECT_EQ(0, ignTransportPublishData(node, topic, buffer.data(),
+    buffer.size(), msg.GetTypeName().c_str()));
+  EXPECT_EQ(2, count);
+
+  // The loaned data is still valid after the callback.
+  const int size = static_cast<int>(buffer.size());
+  buffer.assign(buffer.size(), '\0');
+  ASSERT_EQ(1u, g_loans.size());
+  ignition::msgs::StringMsg loanedMsg;
+  EXPECT_TRUE(loanedMsg.ParseFromArray(g_loans[0].second, size));
+  EXPECT_EQ("HELLO", loanedMsg.data());
+  ignTransportLoanRelease(g_loans[0].first);
+  ignTransportLoanRelease(nullptr);
+  g_loans.clear();
+
+  ignTransportNodeDestroy(&loanNode);
+  ignTransportNodeDestroy(&node);
+  EXPECT_EQ(nullptr, node);
+}
+
 //////////////////////////////////////////////////
 TEST(CIfaceTest, PubSubPartitions)
 {
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/CallbackTrace.hh"
+
+using namespace ignition;
+using namespace transport;
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+/// \brief Totals and maximums of the callback executions.
+TEST(CallbackTraceTest, Record)
+{
+  CallbackTrace trace;
+  EXPECT_EQ(0u, trace.Count());
+  EXPECT_EQ(0ns, trace.TotalDuration());
+  EXPECT_EQ(0ns, trace.MaxDelay());
+
+  trace.Record(2ms, 1ms);
+  trace.Record(5ms, 0ms);
+  trace.Record(1ms, 3ms);
+
+  EXPECT_EQ(3u, trace.Count());
+  EXPECT_EQ(8ms, trace.TotalDuration());
+  EXPECT_EQ(5ms, trace.MaxDuration());
+  EXPECT_EQ(4ms, trace.TotalDelay());
+  EXPECT_EQ(3ms, trace.MaxDelay());
+}
+
+//////////////////////////////////////////////////
+/// \brief Record from several threads.
+TEST(CallbackTraceTest, Concurrent)
+{
+  CallbackTrace trace;
+  std::vector<std::thread> threads;
+  for (int i = 1; i <= 4; ++i)
+  {
+    threads.emplace_back([&trace, i]()
+    {
+      for (int j = 0; j < 1000; ++j)
+        trace.Record(std::chrono::nanoseconds(i), std::chrono::nanoseconds(j));
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(4000u, trace.Count());
+  EXPECT_EQ(10000ns, trace.TotalDuration());
+  EXPECT_EQ(4ns, trace.MaxDuration());
+  EXPECT_EQ(999ns, trace.MaxDelay());
+}
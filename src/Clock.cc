@@ -15,10 +15,11 @@
  *
 */
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <ctime>
 #include <iostream>
-#include <mutex>
 
 #include <ignition/msgs.hh>
 #include <ignition/transport/Clock.hh>
@@ -39,7 +40,7 @@ class ignition::transport::NetworkClock::Implementation
 
   /// \brief Gets clock time
   /// \return Current clock time, in nanoseconds
-  /// \remarks Reads are synchronized
+  /// \remarks Reads are wait-free
   public: std::chrono::nanoseconds Time();
 
   /// \brief Sets and distributes the given clock time
@@ -49,22 +50,20 @@ class ignition::transport::NetworkClock::Implementation
 
   /// \brief Updates current clock time from a message
   /// \param[in] _msg Message to update clock time from
-  /// \remarks Writes are synchronized
+  /// \remarks Writes are atomic
   public: void UpdateTimeFromMessage(const ignition::msgs::Time &_msg);
 
   /// \brief Clock message subscriber callback.
   /// \param[in] _msg Received clock message
   public: void OnClockMessageReceived(const ignition::msgs::Clock &_msg);
 
-  /// \brief Current clock time, in nanoseconds.
-  public: std::chrono::nanoseconds clockTimeNS;
+  /// \brief Current clock time, in nanoseconds. A single word, so the
+  /// clock is read without locking, e.g.: by a recorder for every message.
+  public: std::atomic<int64_t> clockTimeNS{0};
 
   /// \brief Time base to use for the clock.
   public: NetworkClock::TimeBase clockTimeBase;
 
-  /// \brief Lock to synchronize clock accesses.
-  public: std::mutex clockMutex;
-
   /// \brief Node to publish/subscribe clock messages.
   public: Node node;
 
@@ -75,8 +74,7 @@ class ignition::transport::NetworkClock::Implementation
 //////////////////////////////////////////////////
 NetworkClock::Implementation::Implementation(const std::string& _topicName,
                                              NetworkClock::TimeBase _timeBase)
-    : clockTimeNS(std::chrono::nanoseconds::zero()),
-      clockTimeBase(_timeBase)
+    : clockTimeBase(_timeBase)
 {
   if (!node.Subscribe(
           _topicName, &Implementation::OnClockMessageReceived, this))
@@ -89,8 +87,8 @@ NetworkClock::Implementation::Implementation(const std::string& _topicName,
 //////////////////////////////////////////////////
 std::chrono::nanoseconds NetworkClock::Implementation::Time()
 {
-  std::lock_guard<std::mutex> lock(this->clockMutex);
-  return this->clockTimeNS;
+  return std::chrono::nanoseconds(
+    this->clockTimeNS.load(std::memory_order_acquire));
 }
 
 //////////////////////////////////////////////////
@@ -130,9 +128,9 @@ void NetworkClock::Implementation::SetTime(std::chrono::nanoseconds _time)
 void NetworkClock::Implementation::UpdateTimeFromMessage(
     const ignition::msgs::Time& msg)
 {
-  std::lock_guard<std::mutex> lock(this->clockMutex);
-  this->clockTimeNS = std::chrono::seconds(msg.sec()) +
-                      std::chrono::nanoseconds(msg.nsec());
+  const std::chrono::nanoseconds time = std::chrono::seconds(msg.sec()) +
+    std::chrono::nanoseconds(msg.nsec());
+  this->clockTimeNS.store(time.count(), std::memory_order_release);
 }
 
 //////////////////////////////////////////////////
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_CONNECTIONCACHE_HH_
+#define IGN_TRANSPORT_CONNECTIONCACHE_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class ConnectionCache ConnectionCache.hh
+    /// \brief Bookkeeping of the endpoints that a socket is connected to,
+    /// with the time each one was last used. Endpoints that stay idle longer
+    /// than a timeout can be evicted, so peers that went away don't leave
+    /// connections behind. This class is not thread safe, its user must
+    /// protect it together with the socket.
+    class ConnectionCache
+    {
+      /// \brief Clock used to measure idle times.
+      public: using Clock = std::chrono::steady_clock;
+
+      /// \brief Constructor.
+      /// \param[in] _idleTimeout Time after which an unused endpoint is
+      /// evicted. A value of 0 disables eviction.
+      public: explicit ConnectionCache(
+        const Clock::duration _idleTimeout = Clock::duration::zero())
+        : idleTimeout(_idleTimeout)
+      {
+      }
+
+      /// \brief Mark an endpoint as used.
+      /// \param[in] _addr The endpoint.
+      /// \param[in] _now Current time.
+      /// \return True if the endpoint wasn't in the cache, and the socket has
+      /// to connect to it.
+      public: bool Use(const std::string &_addr,
+                       const Clock::time_point _now = Clock::now())
+      {
+        auto res = this->lastUse.emplace(_addr, _now);
+        if (!res.second)
+          res.first->second = _now;
+        return res.second;
+      }
+
+      /// \brief Check if an endpoint is in the cache.
+      /// \param[in] _addr The endpoint.
+      /// \return True if the socket is connected to the endpoint.
+      public: bool Contains(const std::string &_addr) const
+      {
+        return this->lastUse.find(_addr) != this->lastUse.end();
+      }
+
+      /// \brief Remove an endpoint, e.g.: because the peer went away.
+      /// \param[in] _addr The endpoint.
+      /// \return True if the endpoint was in the cache, and the socket has to
+      /// disconnect from it.
+      public: bool Remove(const std::string &_addr)
+      {
+        return this->lastUse.erase(_addr) > 0;
+      }
+
+      /// \brief Remove the endpoints that have been idle for longer than the
+      /// timeout.
+      /// \param[in] _now Current time.
+      /// \return The removed endpoints, which the socket has to disconnect
+      /// from.
+      public: std::vector<std::string> Expire(
+        const Clock::time_point _now = Clock::now())
+      {
+        std::vector<std::string> expired;
+        if (this->idleTimeout == Clock::duration::zero())
+          return expired;
+
+        for (auto it = this->lastUse.begin(); it != this->lastUse.end();)
+        {
+          if (_now - it->second > this->idleTimeout)
+          {
+            expired.push_back(it->first);
+            it = this->lastUse.erase(it);
+          }
+          else
+            ++it;
+        }
+        return expired;
+      }
+
+      /// \brief Get the number of endpoints in the cache.
+      /// \return The number of endpoints.
+      public: std::size_t Size() const
+      {
+        return this->lastUse.size();
+      }
+
+      /// \brief Time after which an unused endpoint is evicted.
+      private: Clock::duration idleTimeout;
+
+      /// \brief Last time each endpoint was used.
+      private: std::unordered_map<std::string, Clock::time_point> lastUse;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ConnectionCache.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Add and remove endpoints.
+TEST(ConnectionCacheTest, UseAndRemove)
+{
+  ConnectionCache cache;
+  EXPECT_EQ(0u, cache.Size());
+  EXPECT_FALSE(cache.Contains("tcp://a"));
+
+  EXPECT_TRUE(cache.Use("tcp://a"));
+  EXPECT_FALSE(cache.Use("tcp://a"));
+  EXPECT_TRUE(cache.Use("tcp://b"));
+  EXPECT_TRUE(cache.Contains("tcp://a"));
+  EXPECT_EQ(2u, cache.Size());
+
+  EXPECT_TRUE(cache.Remove("tcp://a"));
+  EXPECT_FALSE(cache.Remove("tcp://a"));
+  EXPECT_FALSE(cache.Contains("tcp://a"));
+  EXPECT_EQ(1u, cache.Size());
+
+  // Eviction is disabled by default.
+  const auto later = ConnectionCache::Clock::now() + std::chrono::hours(1);
+  EXPECT_TRUE(cache.Expire(later).empty());
+  EXPECT_TRUE(cache.Contains("tcp://b"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Only the endpoints idle for longer than the timeout are evicted.
+TEST(ConnectionCacheTest, Expire)
+{
+  ConnectionCache cache(std::chrono::seconds(10));
+  const auto t0 = ConnectionCache::Clock::now();
+
+  EXPECT_TRUE(cache.Use("tcp://a", t0));
+  EXPECT_TRUE(cache.Use("tcp://b", t0));
+  EXPECT_TRUE(cache.Expire(t0 + std::chrono::seconds(5)).empty());
+
+  // Using an endpoint keeps it alive.
+  EXPECT_FALSE(cache.Use("tcp://b", t0 + std::chrono::seconds(8)));
+
+  std::vector<std::string> expired =
+    cache.Expire(t0 + std::chrono::seconds(11));
+  ASSERT_EQ(1u, expired.size());
+  EXPECT_EQ("tcp://a", expired.front());
+  EXPECT_FALSE(cache.Contains("tcp://a"));
+  EXPECT_TRUE(cache.Contains("tcp://b"));
+
+  // An evicted endpoint has to be connected again.
+  EXPECT_TRUE(cache.Use("tcp://a", t0 + std::chrono::seconds(12)));
+
+  expired = cache.Expire(t0 + std::chrono::seconds(30));
+  EXPECT_EQ(2u, expired.size());
+  EXPECT_EQ(0u, cache.Size());
+}
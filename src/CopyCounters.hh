@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_COPYCOUNTERS_HH_
+#define IGN_TRANSPORT_COPYCOUNTERS_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/Export.hh"
+
+#ifdef IGN_TRANSPORT_COPY_COUNTERS
+/// \brief Count a heap allocation of a message path. The argument is only
+/// evaluated in the builds with IGN_TRANSPORT_COPY_COUNTERS; otherwise it
+/// expands to nothing.
+#define IGN_TRANSPORT_COUNT_ALLOCATION(_bytes) \
+  ignition::transport::copyCounters().CountAllocation(_bytes)
+
+/// \brief Count a copy of message data, see IGN_TRANSPORT_COUNT_ALLOCATION.
+#define IGN_TRANSPORT_COUNT_COPY(_bytes) \
+  ignition::transport::copyCounters().CountCopy(_bytes)
+#else
+#define IGN_TRANSPORT_COUNT_ALLOCATION(_bytes) do {} while (false)
+#define IGN_TRANSPORT_COUNT_COPY(_bytes) do {} while (false)
+#endif
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class CopyCounters CopyCounters.hh
+    /// \brief Counters of the heap allocations and of the copies of message
+    /// data made on the publication and reception paths. They are only
+    /// updated in the builds configured with
+    /// -DIGN_TRANSPORT_COPY_COUNTERS=ON, so the tests can assert a budget
+    /// per message and catch the changes that bring copies back. This class
+    /// is thread safe.
+    class CopyCounters
+    {
+      /// \brief The values of the counters at some point.
+      public: struct Counts
+      {
+        /// \brief Number of allocations.
+        public: uint64_t allocations = 0;
+
+        /// \brief Bytes allocated.
+        public: uint64_t allocatedBytes = 0;
+
+        /// \brief Number of copies.
+        public: uint64_t copies = 0;
+
+        /// \brief Bytes copied.
+        public: uint64_t copiedBytes = 0;
+      };
+
+      /// \brief Count an allocation.
+      /// \param[in] _bytes Bytes allocated.
+      public: void CountAllocation(const std::size_t _bytes)
+      {
+        this->allocations.fetch_add(1, std::memory_order_relaxed);
+        this->allocatedBytes.fetch_add(_bytes, std::memory_order_relaxed);
+      }
+
+      /// \brief Count a copy.
+      /// \param[in] _bytes Bytes copied.
+      public: void CountCopy(const std::size_t _bytes)
+      {
+        this->copies.fetch_add(1, std::memory_order_relaxed);
+        this->copiedBytes.fetch_add(_bytes, std::memory_order_relaxed);
+      }
+
+      /// \brief Get the current values.
+      /// \return The values.
+      public: Counts Snapshot() const
+      {
+        Counts counts;
+        counts.allocations = this->allocations.load(std::memory_order_relaxed);
+        counts.allocatedBytes =
+          this->allocatedBytes.load(std::memory_order_relaxed);
+        counts.copies = this->copies.load(std::memory_order_relaxed);
+        counts.copiedBytes = this->copiedBytes.load(std::memory_order_relaxed);
+        return counts;
+      }
+
+      /// \brief Set all the counters to zero.
+      public: void Reset()
+      {
+        this->allocations = 0;
+        this->allocatedBytes = 0;
+        this->copies = 0;
+        this->copiedBytes = 0;
+      }
+
+      /// \brief Number of allocations.
+      private: std::atomic<uint64_t> allocations{0};
+
+      /// \brief Bytes allocated.
+      private: std::atomic<uint64_t> allocatedBytes{0};
+
+      /// \brief Number of copies.
+      private: std::atomic<uint64_t> copies{0};
+
+      /// \brief Bytes copied.
+      private: std::atomic<uint64_t> copiedBytes{0};
+    };
+
+    /// \brief Get the counters of the process.
+    /// \return The counters.
+    IGNITION_TRANSPORT_VISIBLE CopyCounters &copyCounters();
+    }
+  }
+}
+
+#endif
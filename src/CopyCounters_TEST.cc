@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "CopyCounters.hh"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Messages published by each test of the budgets.
+static const uint64_t kMsgs = 100;
+
+//////////////////////////////////////////////////
+TEST(CopyCountersTest, CountAndReset)
+{
+  CopyCounters counters;
+  counters.CountAllocation(10);
+  counters.CountAllocation(20);
+  counters.CountCopy(5);
+
+  CopyCounters::Counts counts = counters.Snapshot();
+  EXPECT_EQ(2u, counts.allocations);
+  EXPECT_EQ(30u, counts.allocatedBytes);
+  EXPECT_EQ(1u, counts.copies);
+  EXPECT_EQ(5u, counts.copiedBytes);
+
+  counters.Reset();
+  counts = counters.Snapshot();
+  EXPECT_EQ(0u, counts.allocations);
+  EXPECT_EQ(0u, counts.allocatedBytes);
+  EXPECT_EQ(0u, counts.copies);
+  EXPECT_EQ(0u, counts.copiedBytes);
+}
+
+#ifdef IGN_TRANSPORT_COPY_COUNTERS
+//////////////////////////////////////////////////
+/// \brief Publish kMsgs messages, waiting for each one to be received, and
+/// get the counters of the publications.
+/// \param[in] _publish Publish a message.
+/// \param[in] _received Messages received so far.
+/// \return The counters.
+static CopyCounters::Counts countPublications(
+    const std::function<void()> &_publish,
+    const std::atomic<uint64_t> &_received)
+{
+  // Warm up the pools and the caches of the subscribers.
+  _publish();
+  for (int i = 0; i < 200 && _received < 1; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  copyCounters().Reset();
+  for (uint64_t i = 0; i < kMsgs; ++i)
+  {
+    const uint64_t expected = _received + 1;
+    _publish();
+    for (int j = 0; j < 200 && _received < expected; ++j)
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  EXPECT_EQ(kMsgs + 1, _received);
+  return copyCounters().Snapshot();
+}
+
+//////////////////////////////////////////////////
+/// \brief A typed local subscriber gets a single copy of the message.
+TEST(CopyCountersTest, LocalBudget)
+{
+  Node node;
+  std::atomic<uint64_t> received{0};
+  std::function<void(const msgs::Bytes &)> cb =
+    [&received](const msgs::Bytes &) {++received;};
+  auto pub = node.Advertise<msgs::Bytes>("/copy_counters_local");
+  ASSERT_TRUE(pub);
+  ASSERT_TRUE(node.Subscribe("/copy_counters_local", cb));
+
+  msgs::Bytes msg;
+  msg.set_data(std::string(4096, 'x'));
+  const CopyCounters::Counts counts =
+    countPublications([&]{pub.Publish(msg);}, received);
+
+  // The copy handed to the subscriber, and no serialization.
+  EXPECT_EQ(kMsgs, counts.copies);
+  EXPECT_LE(counts.allocations, 2 * kMsgs);
+}
+
+//////////////////////////////////////////////////
+/// \brief A message handed over to the publisher is not copied.
+TEST(CopyCountersTest, LocalOwnedBudget)
+{
+  Node node;
+  std::atomic<uint64_t> received{0};
+  std::function<void(const msgs::Bytes &)> cb =
+    [&received](const msgs::Bytes &) {++received;};
+  auto pub = node.Advertise<msgs::Bytes>("/copy_counters_owned");
+  ASSERT_TRUE(pub);
+  ASSERT_TRUE(node.Subscribe("/copy_counters_owned", cb));
+
+  const CopyCounters::Counts counts = countPublications([&]
+    {
+      auto msg = std::make_unique<msgs::Bytes>();
+      msg->set_data(std::string(4096, 'x'));
+      pub.Publish(std::move(msg));
+    }, received);
+
+  EXPECT_EQ(0u, counts.copies);
+  EXPECT_LE(counts.allocations, kMsgs);
+}
+
+//////////////////////////////////////////////////
+/// \brief A raw local subscriber shares the serialized message, whose
+/// buffer is recycled by the pool.
+TEST(CopyCountersTest, RawBudget)
+{
+  Node node;
+  std::atomic<uint64_t> received{0};
+  auto pub = node.Advertise<msgs::Bytes>("/copy_counters_raw");
+  ASSERT_TRUE(pub);
+  ASSERT_TRUE(node.SubscribeRaw("/copy_counters_raw",
+    [&received](const char *, const std::size_t, const MessageInfo &)
+    {
+      ++received;
+    }, msgs::Bytes().GetTypeName()));
+
+  msgs::Bytes msg;
+  msg.set_data(std::string(4096, 'x'));
+  const CopyCounters::Counts counts =
+    countPublications([&]{pub.Publish(msg);}, received);
+
+  // The serialization only.
+  EXPECT_EQ(kMsgs, counts.copies);
+  EXPECT_EQ(kMsgs * msg.ByteSizeLong(), counts.copiedBytes);
+
+  // No buffer per message, only the bookkeeping of the publications.
+  EXPECT_LT(counts.allocatedBytes, kMsgs * msg.ByteSizeLong() / 2);
+}
+
+//////////////////////////////////////////////////
+/// \brief Raw publications to raw local subscribers are free.
+TEST(CopyCountersTest, RawToRawBudget)
+{
+  Node node;
+  std::atomic<uint64_t> received{0};
+  auto pub = node.Advertise<msgs::Bytes>("/copy_counters_raw_raw");
+  ASSERT_TRUE(pub);
+  ASSERT_TRUE(node.SubscribeRaw("/copy_counters_raw_raw",
+    [&received](const char *, const std::size_t, const MessageInfo &)
+    {
+      ++received;
+    }, msgs::Bytes().GetTypeName()));
+
+  msgs::Bytes msg;
+  msg.set_data(std::string(4096, 'x'));
+  const std::string data = msg.SerializeAsString();
+  const CopyCounters::Counts counts = countPublications([&]
+    {
+      pub.PublishRaw(data, msg.GetTypeName());
+    }, received);
+
+  EXPECT_EQ(0u, counts.copies);
+  EXPECT_EQ(0u, counts.allocations);
+}
+#endif
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Keep the publications away from the other tests.
+  setenv("IGN_PARTITION", testing::getRandomNumber().c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
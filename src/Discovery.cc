@@ -23,6 +23,15 @@
 #pragma warning(pop)
 #endif
 
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "ignition/transport/Discovery.hh"
@@ -62,6 +71,497 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
     // Return if we got a reply.
     return items[0].revents & ZMQ_POLLIN;
   }
+
+  /////////////////////////////////////////////////
+  bool pollSockets(const std::vector<int> &_sockets, const int _timeout,
+    std::vector<bool> &_ready)
+  {
+    std::vector<zmq::pollitem_t> items;
+    for (const auto sock : _sockets)
+    {
+#ifdef _WIN32
+// Disable warning C4838
+#pragma warning(push)
+#pragma warning(disable: 4838)
+#endif
+      items.push_back({0, sock, ZMQ_POLLIN, 0});
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+    }
+
+    _ready.assign(_sockets.size(), false);
+    try
+    {
+      zmq::poll(items.data(), items.size(),
+          std::chrono::milliseconds(_timeout));
+    }
+    catch(...)
+    {
+      return false;
+    }
+
+    bool received = false;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+      _ready[i] = (items[i].revents & ZMQ_POLLIN) != 0;
+      received = received || _ready[i];
+    }
+    return received;
+  }
+
+  /////////////////////////////////////////////////
+  /// \brief Compare a field of two messages.
+  /// \param[in] _a First message.
+  /// \param[in] _b Second message, of the same type.
+  /// \param[in] _field The field.
+  /// \param[in] _index Index of the element for repeated fields, or -1.
+  /// \return True if the field has the same value in both messages.
+  static bool fieldEqual(const google::protobuf::Message &_a,
+                         const google::protobuf::Message &_b,
+                         const google::protobuf::FieldDescriptor *_field,
+                         const int _index)
+  {
+    using google::protobuf::FieldDescriptor;
+    const auto *ra = _a.GetReflection();
+    const auto *rb = _b.GetReflection();
+    const bool rep = _index >= 0;
+
+    switch (_field->cpp_type())
+    {
+      case FieldDescriptor::CPPTYPE_INT32:
+        return rep ? ra->GetRepeatedInt32(_a, _field, _index) ==
+                     rb->GetRepeatedInt32(_b, _field, _index) :
+                     ra->GetInt32(_a, _field) == rb->GetInt32(_b, _field);
+      case FieldDescriptor::CPPTYPE_INT64:
+        return rep ? ra->GetRepeatedInt64(_a, _field, _index) ==
+                     rb->GetRepeatedInt64(_b, _field, _index) :
+                     ra->GetInt64(_a, _field) == rb->GetInt64(_b, _field);
+      case FieldDescriptor::CPPTYPE_UINT32:
+        return rep ? ra->GetRepeatedUInt32(_a, _field, _index) ==
+                     rb->GetRepeatedUInt32(_b, _field, _index) :
+                     ra->GetUInt32(_a, _field) == rb->GetUInt32(_b, _field);
+      case FieldDescriptor::CPPTYPE_UINT64:
+        return rep ? ra->GetRepeatedUInt64(_a, _field, _index) ==
+                     rb->GetRepeatedUInt64(_b, _field, _index) :
+                     ra->GetUInt64(_a, _field) == rb->GetUInt64(_b, _field);
+      case FieldDescriptor::CPPTYPE_DOUBLE:
+        return rep ? ra->GetRepeatedDouble(_a, _field, _index) ==
+                     rb->GetRepeatedDouble(_b, _field, _index) :
+                     ra->GetDouble(_a, _field) == rb->GetDouble(_b, _field);
+      case FieldDescriptor::CPPTYPE_FLOAT:
+        return rep ? ra->GetRepeatedFloat(_a, _field, _index) ==
+                     rb->GetRepeatedFloat(_b, _field, _index) :
+                     ra->GetFloat(_a, _field) == rb->GetFloat(_b, _field);
+      case FieldDescriptor::CPPTYPE_BOOL:
+        return rep ? ra->GetRepeatedBool(_a, _field, _index) ==
+                     rb->GetRepeatedBool(_b, _field, _index) :
+                     ra->GetBool(_a, _field) == rb->GetBool(_b, _field);
+      case FieldDescriptor::CPPTYPE_ENUM:
+        return rep ? ra->GetRepeatedEnumValue(_a, _field, _index) ==
+                     rb->GetRepeatedEnumValue(_b, _field, _index) :
+                     ra->GetEnumValue(_a, _field) ==
+                     rb->GetEnumValue(_b, _field);
+      case FieldDescriptor::CPPTYPE_STRING:
+        return rep ? ra->GetRepeatedString(_a, _field, _index) ==
+                     rb->GetRepeatedString(_b, _field, _index) :
+                     ra->GetString(_a, _field) == rb->GetString(_b, _field);
+      case FieldDescriptor::CPPTYPE_MESSAGE:
+        return rep ?
+          ra->GetRepeatedMessage(_a, _field, _index).SerializeAsString() ==
+          rb->GetRepeatedMessage(_b, _field, _index).SerializeAsString() :
+          ra->GetMessage(_a, _field).SerializeAsString() ==
+          rb->GetMessage(_b, _field).SerializeAsString();
+      default:
+        return false;
+    }
+  }
+
+  /////////////////////////////////////////////////
+  bool diffMessage(const google::protobuf::Message &_prev,
+                   google::protobuf::Message &_msg)
+  {
+    if (_prev.GetDescriptor() != _msg.GetDescriptor())
+      return false;
+
+    const auto *prevRefl = _prev.GetReflection();
+    const auto *refl = _msg.GetReflection();
+
+    // A merge can't unset a field, so every field of the previous message has
+    // to be present, unless another member of its oneof replaces it.
+    std::vector<const google::protobuf::FieldDescriptor *> prevFields;
+    prevRefl->ListFields(_prev, &prevFields);
+    for (const auto *field : prevFields)
+    {
+      if (field->is_repeated())
+      {
+        // A merge appends the repeated fields, so they have to match.
+        const int size = prevRefl->FieldSize(_prev, field);
+        if (refl->FieldSize(_msg, field) != size)
+          return false;
+
+        for (int i = 0; i < size; ++i)
+        {
+          if (!fieldEqual(_prev, _msg, field, i))
+            return false;
+        }
+        refl->ClearField(&_msg, field);
+      }
+      else if (!refl->HasField(_msg, field))
+      {
+        const auto *oneof = field->containing_oneof();
+        if (!oneof || !refl->HasOneof(_msg, oneof))
+          return false;
+      }
+      else if (field->cpp_type() ==
+               google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE)
+      {
+        auto *sub = refl->MutableMessage(&_msg, field);
+        if (!diffMessage(prevRefl->GetMessage(_prev, field), *sub))
+          return false;
+
+        std::vector<const google::protobuf::FieldDescriptor *> subFields;
+        sub->GetReflection()->ListFields(*sub, &subFields);
+        if (subFields.empty())
+          refl->ClearField(&_msg, field);
+      }
+      else if (fieldEqual(_prev, _msg, field, -1))
+        refl->ClearField(&_msg, field);
+    }
+
+    return true;
+  }
+
+  /// \brief Largest datagram built when packing several discovery messages
+  /// together. Fits in an Ethernet MTU, so batches aren't fragmented.
+  static const size_t kMaxBatchSize = 1400;
+
+  /// \brief Flag of the frame delimiter of a frame encoded as the
+  /// difference with the previous message in the datagram.
+  static const uint16_t kDeltaFrame = 0x8000;
+
+  /// \brief Frame delimiter that starts the partition tag of a datagram.
+  /// Older processes reject it, since the frame body would be larger than
+  /// any datagram.
+  static const uint16_t kPartitionTag = 0xFFFF;
+
+  /// \brief Size of the partition tag: the delimiter and the hash.
+  static const size_t kPartitionTagSize =
+    sizeof(kPartitionTag) + sizeof(uint32_t);
+
+  /////////////////////////////////////////////////
+  uint32_t partitionHash(const std::string &_topic)
+  {
+    if (_topic.empty() || _topic.front() != '@')
+      return 0;
+
+    const auto end = _topic.find('@', 1);
+    if (end == std::string::npos)
+      return 0;
+
+    // 32 bit FNV-1a, so all the processes compute the same hash.
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i <= end; ++i)
+    {
+      hash ^= static_cast<unsigned char>(_topic[i]);
+      hash *= 16777619u;
+    }
+    return hash == 0 ? 1 : hash;
+  }
+
+  /////////////////////////////////////////////////
+  uint32_t partitionHash(const msgs::Discovery &_msg)
+  {
+    if (_msg.has_pub())
+      return partitionHash(_msg.pub().topic());
+    if (_msg.has_sub())
+      return partitionHash(_msg.sub().topic());
+    return 0;
+  }
+
+  /////////////////////////////////////////////////
+  void tagPartition(const uint32_t _hash, std::string &_datagram)
+  {
+    char tag[kPartitionTagSize];
+    memcpy(tag, &kPartitionTag, sizeof(kPartitionTag));
+    for (size_t i = 0; i < sizeof(_hash); ++i)
+    {
+      tag[sizeof(kPartitionTag) + i] =
+        static_cast<char>((_hash >> (8 * (sizeof(_hash) - 1 - i))) & 0xFF);
+    }
+    _datagram.insert(0, tag, sizeof(tag));
+  }
+
+  /////////////////////////////////////////////////
+  bool readPartitionTag(const char *_data, const size_t _size,
+                        uint32_t &_hash)
+  {
+    uint16_t len;
+    if (_size < kPartitionTagSize)
+      return false;
+
+    memcpy(&len, _data, sizeof(len));
+    if (len != kPartitionTag)
+      return false;
+
+    _hash = 0;
+    for (size_t i = 0; i < sizeof(_hash); ++i)
+    {
+      _hash = (_hash << 8) |
+        static_cast<unsigned char>(_data[sizeof(kPartitionTag) + i]);
+    }
+    return true;
+  }
+
+  /////////////////////////////////////////////////
+  bool appendDiscoveryFrame(const msgs::Discovery &_msg,
+                            std::string &_buffer)
+  {
+    uint16_t msgSize;
+
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+    size_t msgSizeFull = _msg.ByteSizeLong();
+#else
+    int msgSizeFull = _msg.ByteSize();
+#endif
+    if (msgSizeFull + sizeof(msgSize) + _buffer.size() >
+        std::numeric_limits<uint16_t>::max())
+    {
+      std::cerr << "Discovery message too large to send. Discovery won't "
+        << "work. This shouldn't happen.\n";
+      return false;
+    }
+    msgSize = static_cast<uint16_t>(msgSizeFull);
+
+    const size_t offset = _buffer.size();
+    _buffer.resize(offset + sizeof(msgSize) + msgSize);
+    memcpy(&_buffer[offset], &msgSize, sizeof(msgSize));
+
+    if (!_msg.SerializeToArray(&_buffer[offset + sizeof(msgSize)], msgSize))
+    {
+      std::cerr << "Discovery: Error serializing data." << std::endl;
+      _buffer.resize(offset);
+      return false;
+    }
+
+    return true;
+  }
+
+  /////////////////////////////////////////////////
+  std::vector<std::string> packDiscoveryMsgs(
+    const std::vector<msgs::Discovery> &_msgs, const bool _compact,
+    const std::function<void(msgs::Discovery &_msg)> &_tag,
+    const bool _partitionTags)
+  {
+    std::vector<std::string> datagrams;
+    // Partition of the messages of each datagram, or 0 if they don't share
+    // one.
+    std::vector<uint32_t> partitions;
+    std::string frame;
+    std::string deltaFrame;
+    msgs::Discovery delta;
+    msgs::Discovery first;
+    const msgs::Discovery *prev = nullptr;
+    for (const auto &msg : _msgs)
+    {
+      frame.clear();
+      if (!appendDiscoveryFrame(msg, frame))
+        continue;
+
+      // The addresses and UUIDs of the messages of a process are the same,
+      // so the difference with the previous message is usually much smaller.
+      if (_compact && prev)
+      {
+        delta = msg;
+        deltaFrame.clear();
+        if (diffMessage(*prev, delta) &&
+            appendDiscoveryFrame(delta, deltaFrame) &&
+            deltaFrame.size() < frame.size() &&
+            datagrams.back().size() + deltaFrame.size() <= kMaxBatchSize)
+        {
+          if (partitions.back() != partitionHash(msg))
+            partitions.back() = 0;
+          uint16_t len;
+          memcpy(&len, &deltaFrame[0], sizeof(len));
+          len = static_cast<uint16_t>(len | kDeltaFrame);
+          memcpy(&deltaFrame[0], &len, sizeof(len));
+          datagrams.back() += deltaFrame;
+          prev = &msg;
+          continue;
+        }
+      }
+
+      if (datagrams.empty() ||
+          datagrams.back().size() + frame.size() > kMaxBatchSize)
+      {
+        // The next message can't be a difference with the tagged one, since
+        // it would inherit the tag.
+        if (_tag)
+        {
+          first = msg;
+          _tag(first);
+          frame.clear();
+          if (!appendDiscoveryFrame(first, frame))
+            continue;
+          datagrams.push_back(frame);
+          partitions.push_back(partitionHash(msg));
+          prev = &first;
+          continue;
+        }
+        datagrams.push_back(frame);
+        partitions.push_back(partitionHash(msg));
+      }
+      else
+      {
+        datagrams.back() += frame;
+        if (partitions.back() != partitionHash(msg))
+          partitions.back() = 0;
+      }
+      prev = &msg;
+    }
+
+    if (_partitionTags)
+    {
+      for (size_t i = 0; i < datagrams.size(); ++i)
+      {
+        if (partitions[i] != 0)
+          tagPartition(partitions[i], datagrams[i]);
+      }
+    }
+    return datagrams;
+  }
+
+  /////////////////////////////////////////////////
+  bool unpackDiscoveryMsgs(const char *_data, const size_t _size,
+                           std::vector<msgs::Discovery> &_msgs,
+                           size_t &_count)
+  {
+    // Ignition Transport delimits each discovery message with a
+    // frame_delimiter that contains byte size information.
+    // A discovery message has the form:
+    //
+    // <frame_delimiter><frame_body>
+    //
+    // Ignition Transport version < 8 sends a frame delimiter that
+    // contains the value of sizeof(frame_delimiter)
+    // + sizeof(frame_body). In other words, the frame_delimiter
+    // contains a value that represents the total size of the
+    // frame_body and frame_delimiter in bytes.
+    //
+    // Ignition Transport version >= 8 sends a frame_delimiter
+    // that contains the value of sizeof(frame_body). In other
+    // words, the frame_delimiter contains a value that represents
+    // the total size of only the frame_body.
+    //
+    // It is possible that two incompatible versions of Ignition
+    // Transport exist on the same network. If we receive an
+    // unexpected size, then we ignore the message.
+    //
+    // Ignition Transport may also pack several discovery messages in
+    // a single datagram, one frame after the other:
+    //
+    // <frame_delimiter><frame_body><frame_delimiter><frame_body>...
+    //
+    // The datagram is only accepted if its frames fill it exactly.
+    //
+    // When the compact encoding is used, the highest bit of the
+    // frame_delimiter of all the frames but the first one tells if
+    // the frame_body is the difference with the previous message.
+    //
+    // The frames may be preceded by a partition tag, when all of them
+    // belong to the same partition:
+    //
+    // <0xFFFF><partition_hash><frame_delimiter><frame_body>...
+    //
+    // See readPartitionTag().
+    uint32_t hash;
+    if (readPartitionTag(_data, _size, hash))
+    {
+      return unpackDiscoveryMsgs(_data + kPartitionTagSize,
+        _size - kPartitionTagSize, _msgs, _count);
+    }
+
+    struct Frame
+    {
+      public: size_t offset;
+      public: uint16_t size;
+      public: bool delta;
+    };
+
+    // Scratch objects of the receiving thread, whose allocations are reused
+    // by the next datagrams.
+    thread_local std::vector<Frame> frames;
+    thread_local msgs::Discovery delta;
+
+    frames.clear();
+    size_t offset = 0;
+    uint16_t len = 0;
+    while (offset + sizeof(len) <= _size)
+    {
+      memcpy(&len, &_data[offset], sizeof(len));
+      offset += sizeof(len);
+
+      bool isDelta = false;
+      if (!frames.empty() && (len & kDeltaFrame))
+      {
+        isDelta = true;
+        len = static_cast<uint16_t>(len & ~kDeltaFrame);
+      }
+
+      if (offset + len > _size)
+        break;
+
+      frames.push_back({offset, len, isDelta});
+      offset += len;
+    }
+
+    _count = 0;
+    if (frames.empty() || offset != _size)
+      return false;
+
+    // Index of the previous message, if it was parsed.
+    size_t prev = std::numeric_limits<size_t>::max();
+    for (const auto &frame : frames)
+    {
+      if (_count == _msgs.size())
+        _msgs.emplace_back();
+      msgs::Discovery &msg = _msgs[_count];
+
+      // Parse the message, and skip it if parsing failed. Parsing could
+      // fail when another discovery node is publishing messages using
+      // an older (or newer) format.
+      if (frame.delta)
+      {
+        if (prev == std::numeric_limits<size_t>::max() ||
+            !delta.ParseFromArray(_data + frame.offset, frame.size))
+        {
+          break;
+        }
+
+        msg.CopyFrom(_msgs[prev]);
+        msg.MergeFrom(delta);
+      }
+      else if (!msg.ParseFromArray(_data + frame.offset, frame.size))
+      {
+        prev = std::numeric_limits<size_t>::max();
+        continue;
+      }
+
+      prev = _count++;
+    }
+
+    return true;
+  }
+
+  /////////////////////////////////////////////////
+  bool unpackDiscoveryMsgs(const char *_data, const size_t _size,
+                           std::vector<msgs::Discovery> &_msgs)
+  {
+    size_t count;
+    const bool wellFormed = unpackDiscoveryMsgs(_data, _size, _msgs, count);
+    _msgs.resize(count);
+    return wellFormed;
+  }
 }
 }
 }
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_DISCOVERYKEYS_HH_
+#define IGN_TRANSPORT_DISCOVERYKEYS_HH_
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Key of the header entry of a discovery message with the
+    /// multicast group of a message publisher. Older versions ignore it, and
+    /// keep sending the data over TCP.
+    static constexpr char kMulticastGroupKey[] = "mcast";
+
+    /// \brief Key of the header entry of a discovery message present when a
+    /// message publisher offers best effort delivery, or when a subscriber
+    /// registers for it. Older versions ignore it, and keep using TCP.
+    static constexpr char kBestEffortKey[] = "udp";
+
+    /// \brief Key of the header entry of a discovery message with the rate
+    /// that a subscriber process wants, or present in the advertisement of
+    /// a message publisher able to send it. Older versions ignore it, and
+    /// keep sending all the messages.
+    static constexpr char kSubscriberRateKey[] = "rate";
+
+    /// \brief Key of the header entry of a discovery message present when a
+    /// subscriber registers with a process that reads the compact header,
+    /// and the optional metadata frame. Older versions ignore it, and the
+    /// publisher keeps the default framing while they are subscribed.
+    static constexpr char kCompactHeaderKey[] = "hdr";
+
+    /// \brief Key of the header entry of a discovery message with the
+    /// traffic class of a message publisher other than the default one. The
+    /// address of the publisher is already the one of the socket of the
+    /// class, so older versions can ignore it.
+    static constexpr char kTrafficClassKey[] = "class";
+
+    /// \brief Values of the traffic class entry.
+    static constexpr char kBulkClass[] = "bulk";
+    static constexpr char kControlClass[] = "control";
+
+    /// \brief Key of the header entry of a discovery message with the size
+    /// of the fragments of a message publisher. The registrations of the
+    /// subscribers copy it, so its presence tells the publisher that the
+    /// subscriber reassembles the fragments. Older versions ignore it, and
+    /// the publisher doesn't fragment the messages while they are
+    /// subscribed.
+    static constexpr char kFragmentSizeKey[] = "frag";
+
+    /// \brief Key of the header entry of a discovery message with the
+    /// compression method and threshold of a message publisher. The
+    /// registrations of the subscribers able to decompress the messages
+    /// copy it. Older versions ignore it, and the publisher doesn't compress
+    /// the messages while they are subscribed.
+    static constexpr char kCompressionKey[] = "comp";
+
+    /// \brief Value of the compression entry for zlib.
+    static constexpr char kZlibCompression[] = "zlib";
+
+    /// \brief Key of the header entry of the registration of a subscriber
+    /// that collects topic statistics. \sa Discovery::Register().
+    static constexpr char kStatsKey[] = "stats";
+    }
+  }
+}
+#endif
@@ -0,0 +1,1027 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/discovery.pb.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/Discovery.hh"
+#include "ignition/transport/DiscoveryServer.hh"
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/NetUtils.hh"
+#include "ignition/transport/NodeShared.hh"
+#include "ignition/transport/ThreadConfig.hh"
+#include "ignition/transport/Uuid.hh"
+
+#include "DiscoveryKeys.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Keys of the header entries understood by the discovery clients.
+/// \sa Discovery.
+static const char kBatchKey[] = "batch";
+static const char kCompactKey[] = "compact";
+static const char kEpochKey[] = "epoch";
+static const char kResyncKey[] = "resync";
+static const char kAllKey[] = "all";
+static const char kAnyPeer[] = "*";
+
+/// \brief Interval between two heartbeats sent to each client.
+static const std::chrono::milliseconds kHeartbeatInterval{1000};
+
+/// \brief A client is removed after this time without any message from it.
+static const std::chrono::milliseconds kSilenceInterval{3000};
+
+/// \brief Maximum size of a discovery datagram.
+static const int kMaxRcvStr = 65535;
+
+/// \brief Destination of the messages sent to the multicast group, in
+/// bridge mode. It can't be the UUID of a process.
+static const char kMulticast[] = "";
+
+using SteadyClock = std::chrono::steady_clock;
+
+/// \brief Identifies a publisher: topic and node UUID.
+using PubKey = std::pair<std::string, std::string>;
+
+//////////////////////////////////////////////////
+/// \brief Find an entry in the header of a discovery message.
+/// \param[in] _msg Discovery message.
+/// \param[in] _key Key of the entry.
+/// \return The entry or nullptr if not found.
+static const msgs::Header::Map *findHeader(const msgs::Discovery &_msg,
+                                           const std::string &_key)
+{
+  for (const auto &data : _msg.header().data())
+  {
+    if (data.key() == _key)
+      return &data;
+  }
+  return nullptr;
+}
+
+//////////////////////////////////////////////////
+/// \brief Read an environment variable with a port number.
+/// \param[in] _envVar Name of the environment variable.
+/// \param[in] _defaultValue Value used if the variable isn't set or valid.
+/// \return The port.
+static int portEnvVar(const std::string &_envVar, const int _defaultValue)
+{
+  std::string strVal;
+  if (!env(_envVar, strVal))
+    return _defaultValue;
+
+  try
+  {
+    const int port = std::stoi(strVal);
+    if (port >= 0)
+      return port;
+  }
+  catch (std::exception &)
+  {
+  }
+
+  std::cerr << "Unable to convert " << _envVar << " value [" << strVal
+            << "] to a port number. Using [" << _defaultValue << "] instead."
+            << std::endl;
+  return _defaultValue;
+}
+
+namespace ignition
+{
+namespace transport
+{
+inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+{
+//////////////////////////////////////////////////
+/// \brief A process using the discovery server.
+struct DiscoveryClient
+{
+  /// \brief Address used to reach the process.
+  public: sockaddr_in addr;
+
+  /// \brief IP address of the process.
+  public: std::string ip;
+
+  /// \brief Discovery wire version of the process.
+  public: uint32_t version = 0;
+
+  /// \brief True if the process accepts batched datagrams.
+  public: bool batch = false;
+
+  /// \brief True if the process accepts the compact encoding.
+  public: bool compact = false;
+
+  /// \brief Last time we received a message from the process.
+  public: SteadyClock::time_point lastSeen;
+
+  /// \brief Epoch of the process state that we're tracking.
+  public: uint64_t epoch = 0;
+
+  /// \brief True once our copy of the epoch is complete.
+  public: bool synced = false;
+
+  /// \brief Publishers of the epoch received so far.
+  public: std::set<PubKey> received;
+
+  /// \brief Last time we asked the process for its full state.
+  public: SteadyClock::time_point lastResync;
+
+  /// \brief ADVERTISE messages of the publishers of the process.
+  public: std::map<PubKey, msgs::Discovery> pubs;
+
+  /// \brief Topics that the process subscribed to.
+  public: std::set<std::string> topics;
+
+  /// \brief True if the process asked for all the topics.
+  public: bool all = false;
+
+  /// \brief True for a process on another host, that we hear from through
+  /// the multicast group in bridge mode. We never send anything to it
+  /// directly.
+  public: bool remote = false;
+};
+
+//////////////////////////////////////////////////
+/// \brief The discovery traffic of one port of the discovery server.
+class DiscoveryChannel
+{
+  /// \brief Constructor.
+  /// \param[in] _port Discovery port.
+  /// \param[in] _mcastGroup Multicast group bridged with the clients, or
+  /// empty for not bridging.
+  /// \param[in] _verbose True for enabling verbose mode.
+  public: DiscoveryChannel(const int _port, const std::string &_mcastGroup,
+                           const bool _verbose)
+    : port(_port), mcastGroup(_mcastGroup), verbose(_verbose)
+  {
+  }
+
+  /// \brief Destructor.
+  public: ~DiscoveryChannel()
+  {
+    this->Stop();
+  }
+
+  /// \brief Bind the port and start the reception thread.
+  /// \return True on success.
+  public: bool Start()
+  {
+    this->sock = static_cast<int>(socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    if (this->sock < 0)
+    {
+      std::cerr << "Socket creation failed." << std::endl;
+      return false;
+    }
+
+    sockaddr_in localAddr;
+    memset(&localAddr, 0, sizeof(localAddr));
+    localAddr.sin_family = AF_INET;
+    localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    localAddr.sin_port = htons(static_cast<u_short>(this->port));
+    if (bind(this->sock, reinterpret_cast<sockaddr *>(&localAddr),
+          sizeof(sockaddr_in)) < 0)
+    {
+      std::cerr << "Binding the discovery server to port [" << this->port
+                << "] failed." << std::endl;
+      this->CloseSocket();
+      return false;
+    }
+
+    if (!this->mcastGroup.empty() && !this->JoinMulticastGroup())
+    {
+      this->CloseSocket();
+      return false;
+    }
+
+    this->running = true;
+    this->thread = std::thread(&DiscoveryChannel::Run, this);
+    return true;
+  }
+
+  /// \brief Stop the reception thread and close the socket.
+  public: void Stop()
+  {
+    this->running = false;
+    if (this->thread.joinable())
+      this->thread.join();
+    this->CloseSocket();
+  }
+
+  /// \brief Get the UUIDs of the clients.
+  /// \param[in,out] _pUuids The UUIDs are added here.
+  public: void Clients(std::set<std::string> &_pUuids) const
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (const auto &client : this->clients)
+    {
+      if (!client.second.remote)
+        _pUuids.insert(client.first);
+    }
+  }
+
+  /// \brief Join the multicast group on the interface of the host, like a
+  /// regular discovery instance, and send the multicast traffic of the
+  /// clients through it.
+  /// \return True on success.
+  private: bool JoinMulticastGroup()
+  {
+    this->hostAddr = determineHost();
+
+    in_addr ifAddr;
+    ifAddr.s_addr = inet_addr(this->hostAddr.c_str());
+    if (setsockopt(this->sock, IPPROTO_IP, IP_MULTICAST_IF,
+          reinterpret_cast<const char*>(&ifAddr), sizeof(ifAddr)) != 0)
+    {
+      std::cerr << "Error setting socket option (IP_MULTICAST_IF)."
+                << std::endl;
+      return false;
+    }
+
+    ip_mreq group;
+    group.imr_multiaddr.s_addr = inet_addr(this->mcastGroup.c_str());
+    group.imr_interface.s_addr = ifAddr.s_addr;
+    if (setsockopt(this->sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+          reinterpret_cast<const char*>(&group), sizeof(group)) != 0)
+    {
+      std::cerr << "Error setting socket option (IP_ADD_MEMBERSHIP)."
+                << std::endl;
+      return false;
+    }
+
+    memset(&this->mcastAddr, 0, sizeof(this->mcastAddr));
+    this->mcastAddr.sin_family = AF_INET;
+    this->mcastAddr.sin_addr.s_addr = inet_addr(this->mcastGroup.c_str());
+    this->mcastAddr.sin_port = htons(static_cast<u_short>(this->port));
+    return true;
+  }
+
+  /// \brief Close the socket.
+  private: void CloseSocket()
+  {
+    if (this->sock < 0)
+      return;
+#ifdef _WIN32
+    closesocket(this->sock);
+#else
+    close(this->sock);
+#endif
+    this->sock = -1;
+  }
+
+  /// \brief Reception thread.
+  private: void Run()
+  {
+    ThreadConfig::Global().Apply("ign-disc-server");
+
+    std::vector<int> sockets = {this->sock};
+    auto nextHeartbeat = SteadyClock::now();
+    while (this->running)
+    {
+      if (pollSockets(sockets, 100))
+        this->Recv();
+
+      const auto now = SteadyClock::now();
+      if (now >= nextHeartbeat)
+      {
+        this->Heartbeat(now);
+        nextHeartbeat = now + kHeartbeatInterval;
+      }
+    }
+  }
+
+  /// \brief Receive and process a datagram.
+  private: void Recv()
+  {
+    char rcvStr[kMaxRcvStr];
+    sockaddr_in clntAddr;
+    socklen_t addrLen = sizeof(clntAddr);
+    const auto bytes = recvfrom(this->sock,
+      reinterpret_cast<raw_type *>(rcvStr), kMaxRcvStr, 0,
+      reinterpret_cast<sockaddr *>(&clntAddr), &addrLen);
+    if (bytes <= 0)
+      return;
+
+    // In bridge mode, the clients run on this host and reach us through the
+    // loopback interface. Anything else comes from the multicast group.
+    const std::string srcAddr = inet_ntoa(clntAddr.sin_addr);
+    bool remote = false;
+    if (!this->mcastGroup.empty())
+    {
+      // Our own multicast traffic.
+      if (srcAddr == this->hostAddr &&
+          ntohs(clntAddr.sin_port) == this->port)
+      {
+        return;
+      }
+      remote = srcAddr.find("127.") != 0;
+    }
+
+    std::vector<msgs::Discovery> requests;
+    if (!unpackDiscoveryMsgs(rcvStr, static_cast<size_t>(bytes), requests))
+      return;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::map<std::string, std::vector<msgs::Discovery>> out;
+    for (auto &msg : requests)
+      this->Dispatch(clntAddr, remote, msg, out);
+    this->Send(out);
+  }
+
+  /// \brief Process a discovery message from a client.
+  /// \param[in] _addr Address of the client.
+  /// \param[in] _remote True if the message comes from the multicast group.
+  /// \param[in] _msg The message.
+  /// \param[in,out] _out Messages to send, by client UUID.
+  private: void Dispatch(const sockaddr_in &_addr, const bool _remote,
+    msgs::Discovery &_msg,
+    std::map<std::string, std::vector<msgs::Discovery>> &_out)
+  {
+    const std::string pUuid = _msg.process_uuid();
+    if (pUuid.empty() || pUuid == this->pUuid)
+      return;
+
+    // In bridge mode, the rest of the network sees what our clients send.
+    if (!this->mcastGroup.empty() && !_remote && SharedWithNetwork(_msg))
+      _out[kMulticast].push_back(_msg);
+
+    if (_msg.type() == msgs::Discovery::BYE)
+    {
+      if (this->clients.erase(pUuid) > 0)
+        this->Broadcast(pUuid, _msg, _out);
+      return;
+    }
+
+    auto &client = this->clients[pUuid];
+    if (this->verbose && client.lastSeen == SteadyClock::time_point())
+    {
+      std::cout << "New discovery " << (_remote ? "peer" : "client") << " ["
+                << pUuid << "] on port [" << this->port << "]" << std::endl;
+    }
+    client.addr = _addr;
+    client.ip = inet_ntoa(_addr.sin_addr);
+    client.version = _msg.version();
+    client.lastSeen = SteadyClock::now();
+    client.remote = _remote;
+
+    // A peer asking some of our clients for their full state.
+    if (_remote && _msg.type() == msgs::Discovery::SUBSCRIBE)
+    {
+      auto resync = findHeader(_msg, kResyncKey);
+      if (resync)
+      {
+        for (const auto &target : this->clients)
+        {
+          if (target.second.remote)
+            continue;
+
+          for (const auto &value : resync->value())
+          {
+            if (value == target.first || value == kAnyPeer)
+            {
+              _out[target.first].push_back(_msg);
+              break;
+            }
+          }
+        }
+        return;
+      }
+    }
+
+    // The flags and the header are only meaningful between a client and us,
+    // keep the header apart.
+    msgs::Discovery tagged;
+    tagged.mutable_header()->Swap(_msg.mutable_header());
+    _msg.clear_header();
+    _msg.clear_flags();
+
+    // Except for the multicast group, the best effort delivery, the
+    // subscriber rate, the traffic class and the fragment size, which are
+    // part of the publisher.
+    if (const auto *group = findHeader(tagged, kMulticastGroupKey))
+      *_msg.mutable_header()->add_data() = *group;
+    if (const auto *bestEffort = findHeader(tagged, kBestEffortKey))
+      *_msg.mutable_header()->add_data() = *bestEffort;
+    if (const auto *rate = findHeader(tagged, kSubscriberRateKey))
+      *_msg.mutable_header()->add_data() = *rate;
+    if (const auto *trafficClass = findHeader(tagged, kTrafficClassKey))
+      *_msg.mutable_header()->add_data() = *trafficClass;
+    if (const auto *fragmentSize = findHeader(tagged, kFragmentSizeKey))
+      *_msg.mutable_header()->add_data() = *fragmentSize;
+
+    switch (_msg.type())
+    {
+      case msgs::Discovery::ADVERTISE:
+      {
+        if (!_msg.has_pub() ||
+            _msg.pub().scope() == msgs::Discovery::Publisher::PROCESS ||
+            (_remote &&
+             _msg.pub().scope() == msgs::Discovery::Publisher::HOST))
+        {
+          break;
+        }
+
+        const PubKey key(_msg.pub().topic(), _msg.pub().node_uuid());
+        auto it = client.pubs.find(key);
+        if (it == client.pubs.end() ||
+            it->second.SerializeAsString() != _msg.SerializeAsString())
+        {
+          client.pubs[key] = _msg;
+          this->Forward(pUuid, _msg, _out);
+        }
+
+        // Part of the full state of the client.
+        uint64_t epoch = 0;
+        uint64_t count = 0;
+        if (ReadState(tagged, epoch, count))
+          this->UpdateState(pUuid, client, epoch, count, &key, _out);
+        break;
+      }
+      case msgs::Discovery::UNADVERTISE:
+      {
+        if (!_msg.has_pub())
+          break;
+
+        const PubKey key(_msg.pub().topic(), _msg.pub().node_uuid());
+        if (client.pubs.erase(key) > 0)
+          this->Forward(pUuid, _msg, _out);
+        break;
+      }
+      case msgs::Discovery::SUBSCRIBE:
+      {
+        // We track the state of the clients ourselves.
+        if (findHeader(tagged, kResyncKey))
+          break;
+
+        // Answer a peer on behalf of our clients.
+        if (_remote)
+        {
+          if (!_msg.has_sub())
+            break;
+
+          for (const auto &other : this->clients)
+          {
+            if (other.second.remote)
+              continue;
+
+            for (const auto &pub : other.second.pubs)
+            {
+              if (pub.first.first == _msg.sub().topic() &&
+                  SharedWithNetwork(pub.second))
+              {
+                _out[kMulticast].push_back(pub.second);
+              }
+            }
+          }
+          break;
+        }
+
+        const bool all = findHeader(tagged, kAllKey) != nullptr;
+        if (all)
+          client.all = true;
+        else if (_msg.has_sub() && !_msg.sub().topic().empty())
+          client.topics.insert(_msg.sub().topic());
+        else
+          break;
+
+        // Answer with the publishers that we know.
+        for (const auto &other : this->clients)
+        {
+          if (other.first == pUuid)
+            continue;
+
+          for (const auto &pub : other.second.pubs)
+          {
+            if ((all || pub.first.first == _msg.sub().topic()) &&
+                Visible(other.second, pub.second, client))
+            {
+              _out[pUuid].push_back(pub.second);
+            }
+          }
+        }
+
+        // Let the client know that it has everything.
+        if (all)
+          _out[pUuid].push_back(this->HeartbeatMsg(client));
+        break;
+      }
+      case msgs::Discovery::NEW_CONNECTION:
+      case msgs::Discovery::END_CONNECTION:
+      {
+        if (!_msg.has_pub())
+          break;
+
+        // The statistics preference of the subscriber is for the publisher.
+        if (findHeader(tagged, kStatsKey))
+          _msg.mutable_header()->add_data()->set_key(kStatsKey);
+
+        // Only the publishers of the topic care.
+        for (const auto &other : this->clients)
+        {
+          if (other.first == pUuid || other.second.remote)
+            continue;
+
+          for (const auto &pub : other.second.pubs)
+          {
+            if (pub.first.first == _msg.pub().topic())
+            {
+              _out[other.first].push_back(_msg);
+              break;
+            }
+          }
+        }
+        break;
+      }
+      case msgs::Discovery::HEARTBEAT:
+      {
+        client.batch = findHeader(tagged, kBatchKey) != nullptr;
+        client.compact = findHeader(tagged, kCompactKey) != nullptr;
+
+        uint64_t epoch = 0;
+        uint64_t count = 0;
+        if (ReadState(tagged, epoch, count))
+          this->UpdateState(pUuid, client, epoch, count, nullptr, _out);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  /// \brief Update our copy of the state of a client. Mirrors what the
+  /// multicast peers do, see Discovery.
+  /// \param[in] _pUuid UUID of the client.
+  /// \param[in,out] _client The client.
+  /// \param[in] _epoch Epoch of the state of the client.
+  /// \param[in] _count Number of publishers in the state of the client.
+  /// \param[in] _key The publisher of the state that was received, or
+  /// nullptr.
+  /// \param[in,out] _out Messages to send, by client UUID.
+  private: void UpdateState(const std::string &_pUuid,
+    DiscoveryClient &_client, const uint64_t _epoch, const uint64_t _count,
+    const PubKey *_key,
+    std::map<std::string, std::vector<msgs::Discovery>> &_out)
+  {
+    if (_client.epoch != _epoch)
+    {
+      _client.epoch = _epoch;
+      _client.synced = false;
+      _client.received.clear();
+    }
+
+    if (_client.synced)
+      return;
+
+    if (_key)
+      _client.received.insert(*_key);
+
+    if (_client.received.size() < _count)
+    {
+      // Ask for the full state, at most once per heartbeat.
+      const auto now = SteadyClock::now();
+      if (!_key && now - _client.lastResync >= kHeartbeatInterval)
+      {
+        _client.lastResync = now;
+        msgs::Discovery msg = this->BaseMsg(msgs::Discovery::SUBSCRIBE,
+          _client);
+        auto data = msg.mutable_header()->add_data();
+        data->set_key(kResyncKey);
+        data->add_value(_pUuid);
+        _out[_client.remote ? kMulticast : _pUuid].push_back(msg);
+      }
+      return;
+    }
+
+    // Drop the publishers that aren't part of the state anymore.
+    _client.synced = true;
+    for (auto it = _client.pubs.begin(); it != _client.pubs.end();)
+    {
+      if (_client.received.count(it->first) == 0)
+      {
+        msgs::Discovery msg = it->second;
+        msg.set_type(msgs::Discovery::UNADVERTISE);
+        this->Forward(_pUuid, msg, _out);
+        it = _client.pubs.erase(it);
+      }
+      else
+        ++it;
+    }
+    _client.received.clear();
+  }
+
+  /// \brief Send a publisher update to the clients interested in its topic.
+  /// \param[in] _pUuid UUID of the publisher's process.
+  /// \param[in] _msg ADVERTISE or UNADVERTISE message.
+  /// \param[in,out] _out Messages to send, by client UUID.
+  private: void Forward(const std::string &_pUuid,
+    const msgs::Discovery &_msg,
+    std::map<std::string, std::vector<msgs::Discovery>> &_out) const
+  {
+    const auto &origin = this->clients.at(_pUuid);
+    for (const auto &other : this->clients)
+    {
+      if (other.first == _pUuid || other.second.remote)
+        continue;
+
+      if ((other.second.all || other.second.topics.count(_msg.pub().topic()))
+          && Visible(origin, _msg, other.second))
+      {
+        _out[other.first].push_back(_msg);
+      }
+    }
+  }
+
+  /// \brief Send a message to all the clients but its sender.
+  /// \param[in] _pUuid UUID of the sender.
+  /// \param[in] _msg The message.
+  /// \param[in,out] _out Messages to send, by client UUID.
+  private: void Broadcast(const std::string &_pUuid,
+    const msgs::Discovery &_msg,
+    std::map<std::string, std::vector<msgs::Discovery>> &_out) const
+  {
+    for (const auto &other : this->clients)
+    {
+      if (other.first != _pUuid && !other.second.remote)
+        _out[other.first].push_back(_msg);
+    }
+  }
+
+  /// \brief Check the scope of a publisher.
+  /// \param[in] _origin The publisher's process.
+  /// \param[in] _msg ADVERTISE or UNADVERTISE message.
+  /// \param[in] _dest The process that would receive the message.
+  /// \return True if _dest can use the publisher.
+  private: bool Visible(const DiscoveryClient &_origin,
+    const msgs::Discovery &_msg, const DiscoveryClient &_dest) const
+  {
+    if (_msg.pub().scope() != msgs::Discovery::Publisher::HOST)
+      return true;
+
+    // In bridge mode, all the clients run on this host.
+    return !_origin.remote && !_dest.remote &&
+      (!this->mcastGroup.empty() || _origin.ip == _dest.ip);
+  }
+
+  /// \brief Check if a message of a client has to reach the other hosts in
+  /// bridge mode.
+  /// \param[in] _msg The message.
+  /// \return True unless it's about a publisher that isn't visible outside
+  /// of its host, or a request that only we answer.
+  private: static bool SharedWithNetwork(const msgs::Discovery &_msg)
+  {
+    switch (_msg.type())
+    {
+      case msgs::Discovery::ADVERTISE:
+      case msgs::Discovery::UNADVERTISE:
+      case msgs::Discovery::NEW_CONNECTION:
+      case msgs::Discovery::END_CONNECTION:
+        return _msg.has_pub() &&
+          _msg.pub().scope() == msgs::Discovery::Publisher::ALL;
+      case msgs::Discovery::SUBSCRIBE:
+        return _msg.has_sub() && !_msg.sub().topic().empty() &&
+          !findHeader(_msg, kAllKey) && !findHeader(_msg, kResyncKey);
+      case msgs::Discovery::HEARTBEAT:
+      case msgs::Discovery::BYE:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  /// \brief Check if all the peers reached through the multicast group
+  /// support a feature.
+  /// \param[in] _feature The feature.
+  /// \return True if all of them support it.
+  private: bool AllRemote(bool DiscoveryClient::*_feature) const
+  {
+    for (const auto &client : this->clients)
+    {
+      if (client.second.remote && !(client.second.*_feature))
+        return false;
+    }
+    return true;
+  }
+
+  /// \brief Send heartbeats and remove the silent clients.
+  /// \param[in] _now Current time.
+  private: void Heartbeat(const SteadyClock::time_point _now)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::map<std::string, std::vector<msgs::Discovery>> out;
+    for (auto it = this->clients.begin(); it != this->clients.end();)
+    {
+      if (_now - it->second.lastSeen <= kSilenceInterval)
+      {
+        ++it;
+        continue;
+      }
+
+      if (this->verbose)
+      {
+        std::cout << "Discovery client [" << it->first << "] on port ["
+                  << this->port << "] expired" << std::endl;
+      }
+
+      // Let the other clients know, on behalf of the silent one.
+      msgs::Discovery bye;
+      bye.set_version(it->second.version);
+      bye.set_type(msgs::Discovery::BYE);
+      bye.set_process_uuid(it->first);
+      const std::string pUuid = it->first;
+      if (!this->mcastGroup.empty() && !it->second.remote)
+        out[kMulticast].push_back(bye);
+      it = this->clients.erase(it);
+      this->Broadcast(pUuid, bye, out);
+    }
+
+    for (const auto &client : this->clients)
+    {
+      if (!client.second.remote)
+        out[client.first].push_back(this->HeartbeatMsg(client.second));
+    }
+
+    this->Send(out);
+  }
+
+  /// \brief Build a message sent by the server itself.
+  /// \param[in] _type Message type.
+  /// \param[in] _client The destination.
+  /// \return The message.
+  private: msgs::Discovery BaseMsg(const msgs::Discovery::Type _type,
+    const DiscoveryClient &_client) const
+  {
+    msgs::Discovery msg;
+    msg.set_version(_client.version);
+    msg.set_type(_type);
+    msg.set_process_uuid(this->pUuid);
+    return msg;
+  }
+
+  /// \brief Build a heartbeat of the server. It advertises the features
+  /// that we support and an empty state, so the clients don't send periodic
+  /// advertisements.
+  /// \param[in] _client The destination.
+  /// \return The message.
+  private: msgs::Discovery HeartbeatMsg(const DiscoveryClient &_client) const
+  {
+    msgs::Discovery msg = this->BaseMsg(msgs::Discovery::HEARTBEAT, _client);
+    auto data = msg.mutable_header()->add_data();
+    data->set_key(kBatchKey);
+    data->add_value("1");
+    data = msg.mutable_header()->add_data();
+    data->set_key(kCompactKey);
+    data->add_value("1");
+    data = msg.mutable_header()->add_data();
+    data->set_key(kEpochKey);
+    data->add_value("0");
+    data->add_value("0");
+    return msg;
+  }
+
+  /// \brief Read the epoch of the state of a client.
+  /// \param[in] _msg Message with the header of the client.
+  /// \param[out] _epoch Epoch of the state.
+  /// \param[out] _count Number of publishers in the state.
+  /// \return True if the message was tagged with the epoch.
+  private: static bool ReadState(const msgs::Discovery &_msg,
+    uint64_t &_epoch, uint64_t &_count)
+  {
+    auto data = findHeader(_msg, kEpochKey);
+    if (!data || data->value_size() != 2)
+      return false;
+
+    try
+    {
+      _epoch = std::stoull(data->value(0));
+      _count = std::stoull(data->value(1));
+    }
+    catch (...)
+    {
+      return false;
+    }
+    return true;
+  }
+
+  /// \brief Send messages to the clients.
+  /// \param[in] _out Messages to send, by client UUID.
+  private: void Send(
+    const std::map<std::string, std::vector<msgs::Discovery>> &_out) const
+  {
+    for (const auto &dest : _out)
+    {
+      if (dest.second.empty())
+        continue;
+
+      // Batching and the compact encoding are only used if all the
+      // receivers support them.
+      const sockaddr_in *addr = &this->mcastAddr;
+      bool batch = this->AllRemote(&DiscoveryClient::batch);
+      bool compact = this->AllRemote(&DiscoveryClient::compact);
+      if (dest.first != kMulticast)
+      {
+        auto client = this->clients.find(dest.first);
+        if (client == this->clients.end() || client->second.remote)
+          continue;
+
+        addr = &client->second.addr;
+        batch = client->second.batch;
+        compact = client->second.compact;
+      }
+
+      std::vector<std::string> datagrams;
+      if (batch)
+      {
+        datagrams = packDiscoveryMsgs(dest.second, compact);
+      }
+      else
+      {
+        for (const auto &msg : dest.second)
+        {
+          datagrams.emplace_back();
+          if (!appendDiscoveryFrame(msg, datagrams.back()))
+            datagrams.pop_back();
+        }
+      }
+
+      for (const auto &datagram : datagrams)
+      {
+        if (sendto(this->sock, reinterpret_cast<const raw_type *>(
+              reinterpret_cast<const unsigned char*>(datagram.data())),
+              static_cast<uint16_t>(datagram.size()), 0,
+              reinterpret_cast<const sockaddr *>(addr), sizeof(*addr)) < 0)
+        {
+          std::cerr << "Exception sending a message to the discovery client ["
+                    << dest.first << "]" << std::endl;
+        }
+      }
+    }
+  }
+
+  /// \brief Discovery port.
+  private: int port;
+
+  /// \brief Multicast group bridged with the clients, or empty.
+  private: std::string mcastGroup;
+
+  /// \brief Address of the multicast group.
+  private: sockaddr_in mcastAddr;
+
+  /// \brief IP address of the interface that joined the multicast group.
+  private: std::string hostAddr;
+
+  /// \brief Verbose mode.
+  private: bool verbose;
+
+  /// \brief UUID of the server in this port.
+  private: std::string pUuid = Uuid().ToString();
+
+  /// \brief Socket bound to the port.
+  private: int sock = -1;
+
+  /// \brief True while the reception thread runs.
+  private: std::atomic<bool> running{false};
+
+  /// \brief Reception thread.
+  private: std::thread thread;
+
+  /// \brief Protects the clients.
+  private: mutable std::mutex mutex;
+
+  /// \brief Clients, by process UUID.
+  private: std::map<std::string, DiscoveryClient> clients;
+};
+}
+}
+}
+
+//////////////////////////////////////////////////
+class ignition::transport::DiscoveryServer::Implementation
+{
+  /// \brief Verbose mode.
+  public: bool verbose;
+
+  /// \brief True for bridging the clients with the multicast discovery.
+  public: bool bridge = false;
+
+  /// \brief Discovery of topics and services.
+  public: std::vector<std::unique_ptr<DiscoveryChannel>> channels;
+};
+
+//////////////////////////////////////////////////
+DiscoveryServer::DiscoveryServer(const bool _verbose)
+  : dataPtr(new Implementation)
+{
+  this->dataPtr->verbose = _verbose;
+
+#ifdef _WIN32
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    std::cerr << "Unable to load WinSock DLL" << std::endl;
+#endif
+}
+
+//////////////////////////////////////////////////
+DiscoveryServer::~DiscoveryServer()
+{
+  this->Stop();
+
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+//////////////////////////////////////////////////
+bool DiscoveryServer::Start()
+{
+  if (!this->dataPtr->channels.empty())
+    return false;
+
+  // Same ports as the clients, see NodeShared.
+  const int msgPort = portEnvVar("IGN_DISCOVERY_MSG_PORT",
+    NodeShared::kDefaultMsgDiscPort);
+  int srvPort = portEnvVar("IGN_DISCOVERY_SRV_PORT",
+    NodeShared::kDefaultSrvDiscPort);
+  if (msgPort == srvPort)
+    srvPort = msgPort < 65535 ? msgPort + 1 : msgPort - 1;
+
+  // Same multicast group as the processes using multicast discovery.
+  std::string mcastGroup;
+  if (this->dataPtr->bridge &&
+      (!env("IGN_DISCOVERY_MULTICAST_IP", mcastGroup) || mcastGroup.empty()))
+  {
+    mcastGroup = "239.255.0.7";
+  }
+
+  for (const int port : {msgPort, srvPort})
+  {
+    this->dataPtr->channels.emplace_back(
+      new DiscoveryChannel(port, mcastGroup, this->dataPtr->verbose));
+    if (!this->dataPtr->channels.back()->Start())
+    {
+      this->Stop();
+      return false;
+    }
+  }
+
+  if (this->dataPtr->verbose)
+  {
+    std::cout << "Discovery server listening on ports [" << msgPort
+              << "] and [" << srvPort << "]" << std::endl;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+void DiscoveryServer::SetMulticastBridge(const bool _enabled)
+{
+  this->dataPtr->bridge = _enabled;
+}
+
+//////////////////////////////////////////////////
+bool DiscoveryServer::MulticastBridge() const
+{
+  return this->dataPtr->bridge;
+}
+
+//////////////////////////////////////////////////
+void DiscoveryServer::Stop()
+{
+  this->dataPtr->channels.clear();
+}
+
+//////////////////////////////////////////////////
+std::size_t DiscoveryServer::ClientCount() const
+{
+  // A process uses the same UUID for topics and services.
+  std::set<std::string> pUuids;
+  for (const auto &channel : this->dataPtr->channels)
+    channel->Clients(pUuids);
+  return pUuids.size();
+}
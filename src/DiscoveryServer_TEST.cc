@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef _WIN32
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+#else
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+  #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/Discovery.hh"
+#include "ignition/transport/DiscoveryServer.hh"
+#include "ignition/transport/NetUtils.hh"
+#include "ignition/transport/Publisher.hh"
+#include "ignition/transport/Uuid.hh"
+#include "ignition/msgs/discovery.pb.h"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+using namespace transport;
+
+// Global constants used for multiple tests.
+static const int MaxIters = 300;
+static const int Nap = 10;
+static const int g_msgPort = 11329;
+static const int g_srvPort = 11330;
+static const std::string g_ip = "224.0.0.7"; // NOLINT(*)
+static std::string addr1 = "tcp://127.0.0.1:12345"; // NOLINT(*)
+static std::string ctrl1 = "tcp://127.0.0.1:12346"; // NOLINT(*)
+static std::string addr2 = "tcp://192.0.2.1:12347"; // NOLINT(*)
+static std::string ctrl2 = "tcp://192.0.2.1:12348"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Wait until a condition holds.
+/// \param[in] _cond The condition.
+/// \return True if the condition holds.
+template<typename T>
+static bool waitFor(T _cond)
+{
+  for (int i = 0; i < MaxIters && !_cond(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  return _cond();
+}
+
+//////////////////////////////////////////////////
+/// \brief Start and stop the server.
+TEST(DiscoveryServerTest, StartStop)
+{
+  setenv("IGN_DISCOVERY_MSG_PORT", std::to_string(g_msgPort).c_str(), 1);
+  setenv("IGN_DISCOVERY_SRV_PORT", std::to_string(g_srvPort).c_str(), 1);
+
+  DiscoveryServer server;
+  EXPECT_TRUE(server.Start());
+  EXPECT_FALSE(server.Start());
+  EXPECT_EQ(0u, server.ClientCount());
+
+  // The server owns its ports.
+  DiscoveryServer server2;
+  EXPECT_FALSE(server2.Start());
+
+  server.Stop();
+  EXPECT_TRUE(server2.Start());
+}
+
+//////////////////////////////////////////////////
+/// \brief Discover a topic through the server, without multicast.
+TEST(DiscoveryServerTest, Discover)
+{
+  setenv("IGN_DISCOVERY_MSG_PORT", std::to_string(g_msgPort).c_str(), 1);
+  setenv("IGN_DISCOVERY_SRV_PORT", std::to_string(g_srvPort).c_str(), 1);
+  DiscoveryServer server;
+  ASSERT_TRUE(server.Start());
+
+  setenv("IGN_DISCOVERY_SERVER", "127.0.0.1", 1);
+  const std::string topic = "/server_" + testing::getRandomNumber();
+  const std::string pUuid1 = Uuid().ToString();
+  const std::string pUuid2 = Uuid().ToString();
+  const std::string nUuid1 = Uuid().ToString();
+
+  std::atomic<int> connections{0};
+  std::atomic<int> disconnections{0};
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  unsetenv("IGN_DISCOVERY_SERVER");
+
+  discovery2.ConnectionsCb(
+    [&](const MessagePublisher &_publisher)
+    {
+      if (_publisher.Topic() == topic)
+        ++connections;
+    });
+  discovery2.DisconnectionsCb(
+    [&](const MessagePublisher &_publisher)
+    {
+      if (_publisher.Topic() == topic)
+        ++disconnections;
+    });
+
+  discovery1.Start();
+  discovery2.Start();
+
+  MessagePublisher publisher(topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+  EXPECT_TRUE(waitFor([&] { return server.ClientCount() == 2u; }));
+
+  EXPECT_TRUE(discovery2.Discover(topic));
+  EXPECT_TRUE(waitFor([&] { return connections > 0; }));
+
+  std::vector<std::string> topics;
+  discovery2.TopicList(topics);
+  EXPECT_NE(topics.end(), std::find(topics.begin(), topics.end(), topic));
+
+  // Only the subscribers of the topic are notified.
+  EXPECT_TRUE(discovery1.Unadvertise(topic, nUuid1));
+  EXPECT_TRUE(waitFor([&] { return disconnections > 0; }));
+
+  unsetenv("IGN_DISCOVERY_MSG_PORT");
+  unsetenv("IGN_DISCOVERY_SRV_PORT");
+}
+
+//////////////////////////////////////////////////
+/// \brief Send a discovery message to the server as if it was multicast
+/// traffic from another host.
+/// \param[in] _msg The message.
+/// \return True if the message was sent.
+static bool sendFromNetwork(const msgs::Discovery &_msg)
+{
+  std::string datagram;
+  if (!appendDiscoveryFrame(_msg, datagram))
+    return false;
+
+  // Any address but the loopback one is another host for the server.
+  const std::string host = determineHost();
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(host.c_str());
+  addr.sin_port = 0;
+
+  const auto sock = socket(AF_INET, SOCK_DGRAM, 0);
+  bool sent = bind(sock, reinterpret_cast<sockaddr *>(&addr),
+    sizeof(addr)) == 0;
+
+  addr.sin_port = htons(static_cast<u_short>(g_msgPort));
+  sent = sent && sendto(sock, datagram.data(),
+    static_cast<int>(datagram.size()), 0,
+    reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) > 0;
+#ifdef _WIN32
+  closesocket(sock);
+#else
+  close(sock);
+#endif
+  return sent;
+}
+
+//////////////////////////////////////////////////
+/// \brief Discover a publisher of another host through the server running
+/// as the discovery daemon of this host.
+TEST(DiscoveryServerTest, MulticastBridge)
+{
+  if (determineHost().find("127.") == 0)
+  {
+    std::cerr << "No network interface, skipping test." << std::endl;
+    return;
+  }
+
+  setenv("IGN_DISCOVERY_MSG_PORT", std::to_string(g_msgPort).c_str(), 1);
+  setenv("IGN_DISCOVERY_SRV_PORT", std::to_string(g_srvPort).c_str(), 1);
+  setenv("IGN_DISCOVERY_MULTICAST_IP", g_ip.c_str(), 1);
+  DiscoveryServer server;
+  EXPECT_FALSE(server.MulticastBridge());
+  server.SetMulticastBridge(true);
+  EXPECT_TRUE(server.MulticastBridge());
+  ASSERT_TRUE(server.Start());
+
+  setenv("IGN_DISCOVERY_SERVER", "127.0.0.1", 1);
+  const std::string topic = "/bridge_" + testing::getRandomNumber();
+  const std::string pUuid1 = Uuid().ToString();
+  const std::string pUuid2 = Uuid().ToString();
+  const std::string nUuid2 = Uuid().ToString();
+
+  std::atomic<int> connections{0};
+  std::atomic<int> disconnections{0};
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  unsetenv("IGN_DISCOVERY_SERVER");
+
+  discovery1.ConnectionsCb(
+    [&](const MessagePublisher &_publisher)
+    {
+      if (_publisher.Topic() == topic && _publisher.PUuid() == pUuid2)
+        ++connections;
+    });
+  discovery1.DisconnectionsCb(
+    [&](const MessagePublisher &_publisher)
+    {
+      if (_publisher.PUuid() == pUuid2)
+        ++disconnections;
+    });
+  discovery1.Start();
+  EXPECT_TRUE(discovery1.Discover(topic));
+  EXPECT_TRUE(waitFor([&] { return server.ClientCount() == 1u; }));
+
+  // A publisher of another host, only reachable through multicast.
+  MessagePublisher publisher(topic, addr2, ctrl2, pUuid2, nUuid2, "t",
+    AdvertiseMessageOptions());
+  msgs::Discovery msg;
+  msg.set_version(10);
+  msg.set_process_uuid(pUuid2);
+  msg.set_type(msgs::Discovery::ADVERTISE);
+  publisher.FillDiscovery(msg);
+  EXPECT_TRUE(sendFromNetwork(msg));
+  EXPECT_TRUE(waitFor([&] { return connections > 0; }));
+
+  // The remote process isn't a client of the server.
+  EXPECT_EQ(1u, server.ClientCount());
+
+  msg.Clear();
+  msg.set_version(10);
+  msg.set_process_uuid(pUuid2);
+  msg.set_type(msgs::Discovery::BYE);
+  EXPECT_TRUE(sendFromNetwork(msg));
+  EXPECT_TRUE(waitFor([&] { return disconnections > 0; }));
+
+  unsetenv("IGN_DISCOVERY_MULTICAST_IP");
+  unsetenv("IGN_DISCOVERY_MSG_PORT");
+  unsetenv("IGN_DISCOVERY_SRV_PORT");
+}
@@ -14,12 +14,25 @@
  * limitations under the License.
  *
 */
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
+#include <algorithm>
+
+#include <atomic>
 #include <chrono>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "ignition/transport/AdvertiseOptions.hh"
@@ -488,6 +501,828 @@ TEST(DiscoveryTest, TestTwoPublishersSameTopic)
   EXPECT_EQ(g_counter, 2);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check that many publishers are discovered when their
+/// advertisements are packed in a few datagrams.
+TEST(DiscoveryTest, TestBatchedAdvertise)
+{
+  const int kNumTopics = 100;
+  const std::string prefix = "/batch_" + testing::getRandomNumber() + "_";
+  std::vector<std::string> topics;
+  for (int i = 0; i < kNumTopics; ++i)
+    topics.push_back(prefix + std::to_string(i));
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.Start();
+  for (const auto &topic : topics)
+  {
+    MessagePublisher publisher(topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+      AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+  }
+
+  // Nobody listened to the advertisements. Discover() also notifies the
+  // publishers already known, so a topic might be notified twice.
+  std::mutex counterMutex;
+  std::set<std::string> discoveredTopics;
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.ConnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      if (_publisher.Topic().find(prefix) != 0)
+        return;
+
+      std::lock_guard<std::mutex> lk(counterMutex);
+      discoveredTopics.insert(_publisher.Topic());
+    });
+  discovery2.Start();
+
+  // The answers to the discovery requests are batched.
+  EXPECT_TRUE(discovery2.Discover(topics));
+
+  int i = 0;
+  int discovered = 0;
+  while (i < MaxIters && discovered < kNumTopics)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    std::lock_guard<std::mutex> lk(counterMutex);
+    discovered = static_cast<int>(discoveredTopics.size());
+    ++i;
+  }
+  EXPECT_EQ(kNumTopics, discovered);
+
+  Addresses_M<MessagePublisher> addresses;
+  EXPECT_TRUE(discovery2.Publishers(topics.back(), addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the topics unadvertised together are removed from the
+/// other discovery nodes.
+TEST(DiscoveryTest, TestBatchedUnadvertise)
+{
+  const int kNumTopics = 50;
+  const std::string prefix = "/unadv_" + testing::getRandomNumber() + "_";
+  std::vector<std::string> topics;
+  for (int i = 0; i < kNumTopics; ++i)
+    topics.push_back(prefix + std::to_string(i));
+
+  std::mutex counterMutex;
+  std::set<std::string> connected;
+  std::set<std::string> disconnected;
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.ConnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lk(counterMutex);
+      if (_publisher.Topic().find(prefix) == 0)
+        connected.insert(_publisher.Topic());
+    });
+  discovery2.DisconnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lk(counterMutex);
+      if (_publisher.Topic().find(prefix) == 0)
+        disconnected.insert(_publisher.Topic());
+    });
+  discovery1.Start();
+  discovery2.Start();
+  EXPECT_TRUE(discovery2.Discover(topics));
+
+  for (const auto &topic : topics)
+  {
+    MessagePublisher publisher(topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+      AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+  }
+
+  auto waitFor = [&](const std::set<std::string> &_topics)
+  {
+    for (int i = 0; i < MaxIters; ++i)
+    {
+      {
+        std::lock_guard<std::mutex> lk(counterMutex);
+        if (static_cast<int>(_topics.size()) == kNumTopics)
+          return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    }
+  };
+  waitFor(connected);
+
+  // The topics of another node and the unknown topics are skipped.
+  std::vector<std::string> unadvertised = topics;
+  unadvertised.push_back(prefix + "unknown");
+  EXPECT_TRUE(discovery1.Unadvertise(unadvertised, nUuid2));
+  EXPECT_TRUE(discovery1.Unadvertise(unadvertised, nUuid1));
+  waitFor(disconnected);
+
+  std::lock_guard<std::mutex> lk(counterMutex);
+  EXPECT_EQ(static_cast<size_t>(kNumTopics), disconnected.size());
+  MsgAddresses_M addresses;
+  EXPECT_FALSE(discovery1.Publishers(topics.front(), addresses));
+  EXPECT_FALSE(discovery2.Publishers(topics.back(), addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief A burst of unadvertisements of single topics is queued and sent
+/// in a few datagrams.
+TEST(DiscoveryTest, TestQueuedUnadvertise)
+{
+  const int kNumTopics = 50;
+  const std::string prefix = "/queued_" + testing::getRandomNumber() + "_";
+  std::vector<std::string> topics;
+  for (int i = 0; i < kNumTopics; ++i)
+    topics.push_back(prefix + std::to_string(i));
+
+  std::mutex counterMutex;
+  std::set<std::string> connected;
+  std::set<std::string> disconnected;
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.ConnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lk(counterMutex);
+      if (_publisher.Topic().find(prefix) == 0)
+        connected.insert(_publisher.Topic());
+    });
+  discovery2.DisconnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lk(counterMutex);
+      if (_publisher.Topic().find(prefix) == 0)
+        disconnected.insert(_publisher.Topic());
+    });
+  discovery1.Start();
+  discovery2.Start();
+  EXPECT_TRUE(discovery2.Discover(topics));
+
+  for (const auto &topic : topics)
+  {
+    MessagePublisher publisher(topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+      AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+  }
+
+  auto waitFor = [&](const std::set<std::string> &_topics)
+  {
+    for (int i = 0; i < MaxIters; ++i)
+    {
+      {
+        std::lock_guard<std::mutex> lk(counterMutex);
+        if (static_cast<int>(_topics.size()) == kNumTopics)
+          return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    }
+  };
+  waitFor(connected);
+
+  uint64_t sentBefore, sentBytes, recvDatagrams, recvBytes;
+  discovery1.Traffic(sentBefore, sentBytes, recvDatagrams, recvBytes);
+  for (const auto &topic : topics)
+    EXPECT_TRUE(discovery1.Unadvertise(topic, nUuid1));
+  waitFor(disconnected);
+
+  uint64_t sentAfter;
+  discovery1.Traffic(sentAfter, sentBytes, recvDatagrams, recvBytes);
+  EXPECT_LT(sentAfter - sentBefore, static_cast<uint64_t>(kNumTopics));
+
+  std::lock_guard<std::mutex> lk(counterMutex);
+  EXPECT_EQ(static_cast<size_t>(kNumTopics), disconnected.size());
+  MsgAddresses_M addresses;
+  EXPECT_FALSE(discovery2.Publishers(topics.back(), addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief A state change is followed by a few heartbeats, long before the
+/// next periodic one.
+TEST(DiscoveryTest, TestStateBeacons)
+{
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.SetHeartbeatInterval(10000);
+  discovery1.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  uint64_t sentBefore, sentBytes, recvDatagrams, recvBytes;
+  discovery1.Traffic(sentBefore, sentBytes, recvDatagrams, recvBytes);
+  MessagePublisher publisher("/beacons_" + testing::getRandomNumber(), addr1,
+    ctrl1, pUuid1, nUuid1, "t", AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  // The advertisement and, at least, two beacons.
+  uint64_t sentAfter;
+  discovery1.Traffic(sentAfter, sentBytes, recvDatagrams, recvBytes);
+  EXPECT_GE(sentAfter - sentBefore, 3u);
+}
+
+//////////////////////////////////////////////////
+/// \brief Only the topics of interest are tracked in interest mode.
+TEST(DiscoveryTest, TestInterestOnly)
+{
+  const std::string prefix = "/interest_" + testing::getRandomNumber();
+  const std::string wanted = prefix + "_wanted";
+  const std::string ignored = prefix + "_ignored";
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.Start();
+
+  std::mutex topicsMutex;
+  std::set<std::string> connected;
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  EXPECT_FALSE(discovery2.InterestOnly());
+  discovery2.SetInterestOnly(true);
+  EXPECT_TRUE(discovery2.InterestOnly());
+  discovery2.ConnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lk(topicsMutex);
+      connected.insert(_publisher.Topic());
+    });
+  discovery2.Start();
+  EXPECT_TRUE(discovery2.Discover(wanted));
+
+  for (const auto &topic : {wanted, ignored})
+  {
+    MessagePublisher publisher(topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+      AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+  }
+
+  int i = 0;
+  bool found = false;
+  while (i < MaxIters && !found)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    std::lock_guard<std::mutex> lk(topicsMutex);
+    found = connected.count(wanted) > 0;
+    ++i;
+  }
+  EXPECT_TRUE(found);
+
+  // The other topic was advertised at the same time.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(topicsMutex);
+    EXPECT_EQ(0u, connected.count(ignored));
+  }
+  Addresses_M<MessagePublisher> addresses;
+  EXPECT_TRUE(discovery2.Publishers(wanted, addresses));
+  EXPECT_FALSE(discovery2.Publishers(ignored, addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief The topics under a prefix of interest are tracked in interest
+/// mode, and the ones already known are reported right away.
+TEST(DiscoveryTest, TestDiscoverPrefix)
+{
+  const std::string prefix = "/prefix_" + testing::getRandomNumber();
+  const std::string under = prefix + "/scan";
+  const std::string ignored = prefix + "_ignored";
+  const std::string later = prefix + "/arm/joint";
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.Start();
+
+  std::mutex topicsMutex;
+  std::set<std::string> connected;
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.SetInterestOnly(true);
+  discovery2.ConnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lk(topicsMutex);
+      connected.insert(_publisher.Topic());
+    });
+  EXPECT_FALSE(discovery2.DiscoverPrefix(prefix));
+  discovery2.Start();
+  EXPECT_TRUE(discovery2.DiscoverPrefix(prefix));
+
+  for (const auto &topic : {under, ignored})
+  {
+    MessagePublisher publisher(topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+      AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+  }
+
+  int i = 0;
+  bool found = false;
+  while (i < MaxIters && !found)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    std::lock_guard<std::mutex> lk(topicsMutex);
+    found = connected.count(under) > 0;
+    ++i;
+  }
+  EXPECT_TRUE(found);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(topicsMutex);
+    EXPECT_EQ(0u, connected.count(ignored));
+    connected.clear();
+  }
+
+  // The known topics are reported again for a new prefix.
+  EXPECT_TRUE(discovery2.DiscoverPrefix(prefix + "/"));
+  {
+    std::lock_guard<std::mutex> lk(topicsMutex);
+    EXPECT_EQ(1u, connected.count(under));
+  }
+
+  MessagePublisher publisher(later, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+
+  i = 0;
+  found = false;
+  while (i < MaxIters && !found)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    std::lock_guard<std::mutex> lk(topicsMutex);
+    found = connected.count(later) > 0;
+    ++i;
+  }
+  EXPECT_TRUE(found);
+}
+
+//////////////////////////////////////////////////
+/// \brief A discovery instance asks for the state of its peers when it
+/// starts, so it doesn't wait for their next heartbeat.
+TEST(DiscoveryTest, TestSnapshotOnStart)
+{
+  const std::string topic = "/snapshot_" + testing::getRandomNumber();
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.SetHeartbeatInterval(10000);
+  discovery1.Start();
+  MessagePublisher publisher(topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+
+  // Let the advertisement go.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::atomic<bool> found{false};
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.ConnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      if (_publisher.Topic() == topic)
+        found = true;
+    });
+  discovery2.Start();
+
+  int i = 0;
+  while (i < MaxIters && !found)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    ++i;
+  }
+  EXPECT_TRUE(found);
+}
+
+//////////////////////////////////////////////////
+/// \brief TopicList() returns once the peers have answered the snapshot
+/// request, without waiting for the two heartbeats of the initialization.
+TEST(DiscoveryTest, TestTopicListWithoutInitDelay)
+{
+  const std::string topic = "/topic_list_" + testing::getRandomNumber();
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.SetHeartbeatInterval(10000);
+  discovery1.Start();
+  MessagePublisher publisher(topic, addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  EXPECT_TRUE(discovery1.Advertise(publisher));
+
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.SetHeartbeatInterval(10000);
+  discovery2.Start();
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::string> topics;
+  discovery2.TopicList(topics);
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+    std::chrono::seconds(5));
+  EXPECT_NE(std::find(topics.begin(), topics.end(), topic), topics.end());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the differences between messages used by the compact
+/// encoding.
+TEST(DiscoveryTest, DiffMessage)
+{
+  MessagePublisher publisher1("/foo", addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+  MessagePublisher publisher2("/bar", addr1, ctrl1, pUuid1, nUuid1, "t",
+    AdvertiseMessageOptions());
+
+  ignition::msgs::Discovery msg1;
+  msg1.set_version(10);
+  msg1.set_process_uuid(pUuid1);
+  msg1.set_type(ignition::msgs::Discovery::ADVERTISE);
+  publisher1.FillDiscovery(msg1);
+
+  ignition::msgs::Discovery msg2 = msg1;
+  publisher2.FillDiscovery(msg2);
+
+  // Only the topic is different.
+  ignition::msgs::Discovery delta = msg2;
+  ASSERT_TRUE(transport::diffMessage(msg1, delta));
+  EXPECT_LT(delta.SerializeAsString().size(),
+            msg2.SerializeAsString().size() / 2);
+
+  ignition::msgs::Discovery restored = msg1;
+  restored.MergeFrom(delta);
+  EXPECT_EQ(msg2.SerializeAsString(), restored.SerializeAsString());
+
+  // A merge can't clear a field.
+  ignition::msgs::Discovery msg3 = msg1;
+  msg3.clear_process_uuid();
+  EXPECT_FALSE(transport::diffMessage(msg1, msg3));
+
+  // Nor remove entries from a repeated field.
+  msg1.mutable_header()->add_data()->set_key("a");
+  ignition::msgs::Discovery msg4 = msg2;
+  EXPECT_FALSE(transport::diffMessage(msg1, msg4));
+}
+
+//////////////////////////////////////////////////
+/// \brief Only the first message of each datagram is tagged when packing.
+TEST(DiscoveryTest, PackTag)
+{
+  std::vector<ignition::msgs::Discovery> msgs;
+  for (int i = 0; i < 200; ++i)
+  {
+    MessagePublisher publisher("/tag_" + std::to_string(i), addr1, ctrl1,
+      pUuid1, nUuid1, "t", AdvertiseMessageOptions());
+    msgs.emplace_back();
+    msgs.back().set_version(10);
+    msgs.back().set_process_uuid(pUuid1);
+    msgs.back().set_type(ignition::msgs::Discovery::ADVERTISE);
+    publisher.FillDiscovery(msgs.back());
+  }
+
+  int tags = 0;
+  auto datagrams = transport::packDiscoveryMsgs(msgs, true,
+    [&](ignition::msgs::Discovery &_msg)
+    {
+      _msg.mutable_header()->add_data()->set_key(std::to_string(tags++));
+    });
+  ASSERT_GT(datagrams.size(), 1u);
+  EXPECT_EQ(static_cast<int>(datagrams.size()), tags);
+
+  size_t count = 0;
+  for (size_t i = 0; i < datagrams.size(); ++i)
+  {
+    std::vector<ignition::msgs::Discovery> unpacked;
+    ASSERT_TRUE(transport::unpackDiscoveryMsgs(datagrams[i].data(),
+      datagrams[i].size(), unpacked));
+    ASSERT_FALSE(unpacked.empty());
+    ASSERT_EQ(1, unpacked.front().header().data_size());
+    EXPECT_EQ(std::to_string(i), unpacked.front().header().data(0).key());
+    for (size_t j = 1; j < unpacked.size(); ++j)
+    {
+      EXPECT_EQ(0, unpacked[j].header().data_size());
+      EXPECT_EQ(msgs[count + j].SerializeAsString(),
+                unpacked[j].SerializeAsString());
+    }
+    count += unpacked.size();
+  }
+  EXPECT_EQ(msgs.size(), count);
+}
+
+//////////////////////////////////////////////////
+/// \brief The messages of a datagram can be unpacked into the ones of a
+/// previous datagram.
+TEST(DiscoveryTest, UnpackReuse)
+{
+  std::vector<ignition::msgs::Discovery> msgs;
+  for (int i = 0; i < 20; ++i)
+  {
+    MessagePublisher publisher("/reuse_" + std::to_string(i), addr1, ctrl1,
+      pUuid1, nUuid1, "t", AdvertiseMessageOptions());
+    msgs.emplace_back();
+    msgs.back().set_version(10);
+    msgs.back().set_process_uuid(pUuid1);
+    msgs.back().set_type(ignition::msgs::Discovery::ADVERTISE);
+    publisher.FillDiscovery(msgs.back());
+  }
+  const auto batch = transport::packDiscoveryMsgs(msgs, true);
+  const auto single = transport::packDiscoveryMsgs({msgs[3]}, true);
+  ASSERT_EQ(1u, batch.size());
+  ASSERT_EQ(1u, single.size());
+
+  std::vector<ignition::msgs::Discovery> unpacked;
+  size_t count = 0;
+  ASSERT_TRUE(transport::unpackDiscoveryMsgs(batch[0].data(),
+    batch[0].size(), unpacked, count));
+  ASSERT_EQ(msgs.size(), count);
+
+  // The spare messages are kept, and the reused ones don't keep any field
+  // of the previous datagram.
+  ASSERT_TRUE(transport::unpackDiscoveryMsgs(single[0].data(),
+    single[0].size(), unpacked, count));
+  ASSERT_EQ(1u, count);
+  EXPECT_EQ(msgs.size(), unpacked.size());
+  EXPECT_EQ(msgs[3].SerializeAsString(), unpacked[0].SerializeAsString());
+
+  ASSERT_TRUE(transport::unpackDiscoveryMsgs(batch[0].data(),
+    batch[0].size(), unpacked, count));
+  ASSERT_EQ(msgs.size(), count);
+  for (size_t i = 0; i < count; ++i)
+    EXPECT_EQ(msgs[i].SerializeAsString(), unpacked[i].SerializeAsString());
+
+  EXPECT_FALSE(transport::unpackDiscoveryMsgs(batch[0].data(),
+    batch[0].size() - 1, unpacked, count));
+  EXPECT_EQ(0u, count);
+}
+
+//////////////////////////////////////////////////
+/// \brief The datagrams whose messages share a partition are tagged with it.
+TEST(DiscoveryTest, PackPartitionTag)
+{
+  std::vector<ignition::msgs::Discovery> msgs(3);
+  for (size_t i = 0; i < msgs.size(); ++i)
+  {
+    MessagePublisher publisher("@/lab@/topic_" + std::to_string(i), addr1,
+      ctrl1, pUuid1, nUuid1, "t", AdvertiseMessageOptions());
+    msgs[i].set_version(10);
+    msgs[i].set_process_uuid(pUuid1);
+    msgs[i].set_type(ignition::msgs::Discovery::ADVERTISE);
+    publisher.FillDiscovery(msgs[i]);
+  }
+
+  auto datagrams = transport::packDiscoveryMsgs(msgs, true, nullptr, true);
+  ASSERT_EQ(1u, datagrams.size());
+  uint32_t hash = 0;
+  ASSERT_TRUE(transport::readPartitionTag(datagrams[0].data(),
+    datagrams[0].size(), hash));
+  EXPECT_EQ(transport::partitionHash("@/lab@/other"), hash);
+  EXPECT_NE(transport::partitionHash("@/lab2@/topic_0"), hash);
+
+  std::vector<ignition::msgs::Discovery> unpacked;
+  ASSERT_TRUE(transport::unpackDiscoveryMsgs(datagrams[0].data(),
+    datagrams[0].size(), unpacked));
+  ASSERT_EQ(msgs.size(), unpacked.size());
+  EXPECT_EQ(msgs[2].SerializeAsString(), unpacked[2].SerializeAsString());
+
+  // Messages of several partitions, or of none, aren't tagged.
+  msgs[1].mutable_pub()->set_topic("@/lab2@/topic_1");
+  datagrams = transport::packDiscoveryMsgs(msgs, true, nullptr, true);
+  ASSERT_EQ(1u, datagrams.size());
+  EXPECT_FALSE(transport::readPartitionTag(datagrams[0].data(),
+    datagrams[0].size(), hash));
+  EXPECT_EQ(0u, transport::partitionHash(ignition::msgs::Discovery()));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a process joining late gets the state of the existing
+/// processes, and that it's kept up to date as it changes.
+TEST(DiscoveryTest, TestStateResync)
+{
+  const int kNumTopics = 20;
+  const std::string prefix = "/resync_" + testing::getRandomNumber() + "_";
+
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.Start();
+  for (int i = 0; i < kNumTopics; ++i)
+  {
+    MessagePublisher publisher(prefix + std::to_string(i), addr1, ctrl1,
+      pUuid1, nUuid1, "t", AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+  }
+
+  std::mutex counterMutex;
+  int connections = 0;
+  int disconnections = 0;
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery2.ConnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lk(counterMutex);
+      if (_publisher.Topic().find(prefix) == 0)
+        ++connections;
+    });
+  discovery2.DisconnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      std::lock_guard<std::mutex> lk(counterMutex);
+      if (_publisher.Topic().find(prefix) == 0)
+        ++disconnections;
+    });
+  discovery2.Start();
+
+  // The state is received without asking for any topic.
+  auto waitFor = [&](const int &_counter, const int _expected)
+  {
+    for (int i = 0; i < MaxIters * 3; ++i)
+    {
+      {
+        std::lock_guard<std::mutex> lk(counterMutex);
+        if (_counter >= _expected)
+          return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    }
+  };
+  waitFor(connections, kNumTopics);
+  {
+    std::lock_guard<std::mutex> lk(counterMutex);
+    EXPECT_EQ(kNumTopics, connections);
+  }
+
+  // Changes of the state are propagated.
+  EXPECT_TRUE(discovery1.Unadvertise(prefix + "0", nUuid1));
+  waitFor(disconnections, 1);
+  {
+    std::lock_guard<std::mutex> lk(counterMutex);
+    EXPECT_EQ(1, disconnections);
+  }
+
+  Addresses_M<MessagePublisher> addresses;
+  EXPECT_FALSE(discovery2.Publishers(prefix + "0", addresses));
+  EXPECT_TRUE(discovery2.Publishers(prefix + "1", addresses));
+
+  // A lost connection drops the publishers at once, and the state is
+  // requested again since the process is still alive.
+  {
+    std::lock_guard<std::mutex> lk(counterMutex);
+    connections = 0;
+  }
+  discovery2.Disconnected(addr1);
+  {
+    std::lock_guard<std::mutex> lk(counterMutex);
+    EXPECT_EQ(kNumTopics, disconnections);
+  }
+  EXPECT_FALSE(discovery2.Publishers(prefix + "1", addresses));
+
+  waitFor(connections, kNumTopics - 1);
+  {
+    std::lock_guard<std::mutex> lk(counterMutex);
+    EXPECT_EQ(kNumTopics - 1, connections);
+  }
+  EXPECT_TRUE(discovery2.Publishers(prefix + "1", addresses));
+}
+
+//////////////////////////////////////////////////
+/// \brief Send a discovery message to the discovery port of this host.
+/// \param[in] _msg The message.
+/// \param[in] _seq Sequence number of the message, or empty.
+static void sendRaw(ignition::msgs::Discovery _msg, const std::string &_seq)
+{
+  if (!_seq.empty())
+  {
+    auto data = _msg.mutable_header()->add_data();
+    data->set_key("seq");
+    data->add_value(_seq);
+  }
+
+  std::string datagram;
+  ASSERT_TRUE(transport::appendDiscoveryFrame(_msg, datagram));
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  addr.sin_port = htons(static_cast<u_short>(g_msgPort));
+
+  const auto sock = socket(AF_INET, SOCK_DGRAM, 0);
+  EXPECT_GT(sendto(sock, datagram.data(), static_cast<int>(datagram.size()),
+    0, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+#ifdef _WIN32
+  closesocket(sock);
+#else
+  close(sock);
+#endif
+}
+
+//////////////////////////////////////////////////
+/// \brief The copies of a datagram received through several interfaces are
+/// only processed once.
+TEST(DiscoveryTest, TestDuplicates)
+{
+  const std::string topic = "/dup_" + testing::getRandomNumber();
+  const std::string remoteUuid = transport::Uuid().ToString();
+
+  std::atomic<int> connections{0};
+  std::atomic<int> disconnections{0};
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  discovery1.ConnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      if (_publisher.Topic() == topic)
+        ++connections;
+    });
+  discovery1.DisconnectionsCb(
+    [&](const transport::MessagePublisher &_publisher)
+    {
+      if (_publisher.Topic() == topic)
+        ++disconnections;
+    });
+  discovery1.Start();
+
+  MessagePublisher publisher(topic, addr2, ctrl2, remoteUuid, nUuid2, "t",
+    AdvertiseMessageOptions());
+  ignition::msgs::Discovery advertise;
+  advertise.set_version(10);
+  advertise.set_process_uuid(remoteUuid);
+  advertise.set_type(ignition::msgs::Discovery::ADVERTISE);
+  publisher.FillDiscovery(advertise);
+  ignition::msgs::Discovery unadvertise = advertise;
+  unadvertise.set_type(ignition::msgs::Discovery::UNADVERTISE);
+
+  sendRaw(advertise, "1");
+  sendRaw(advertise, "1");
+  sendRaw(unadvertise, "2");
+
+  // A late copy of the first datagram.
+  sendRaw(advertise, "1");
+
+  for (int i = 0; i < MaxIters && disconnections < 1; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(1, connections);
+  EXPECT_EQ(1, disconnections);
+  MsgAddresses_M addresses;
+  EXPECT_FALSE(discovery1.Publishers(topic, addresses));
+
+  // Messages without a sequence number are always processed.
+  sendRaw(advertise, "");
+  for (int i = 0; i < MaxIters && connections < 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  EXPECT_EQ(2, connections);
+}
+
+//////////////////////////////////////////////////
+/// \brief A subscriber tells the publisher whether it collects statistics
+/// each time it registers, and unregisters once it's gone.
+TEST(DiscoveryTest, TestStatsRegistration)
+{
+  const std::string topic = "/stats_" + testing::getRandomNumber();
+
+  std::mutex mutex;
+  std::vector<bool> stats;
+  std::atomic<int> unregistrations{0};
+  MsgDiscovery discovery1(pUuid1, g_ip, g_msgPort);
+  MsgDiscovery discovery2(pUuid2, g_ip, g_msgPort);
+  discovery1.StatsRegistrationsCb(
+    [&](const transport::MessagePublisher &_sub, const bool _stats)
+    {
+      if (_sub.Topic() != topic)
+        return;
+      std::lock_guard<std::mutex> lock(mutex);
+      stats.push_back(_stats);
+    });
+  discovery1.UnregistrationsCb(
+    [&](const transport::MessagePublisher &_sub)
+    {
+      if (_sub.Topic() == topic)
+        ++unregistrations;
+    });
+  discovery1.Start();
+  discovery2.Start();
+
+  auto waitForStats = [&](const size_t _count)
+  {
+    for (int i = 0; i < MaxIters; ++i)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stats.size() >= _count)
+          return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+    }
+  };
+
+  // The registration of a subscriber of discovery2 with the publisher of
+  // discovery1.
+  MessagePublisher registration(topic, addr2, pUuid1, pUuid2, nUuid2, "t",
+    AdvertiseMessageOptions());
+
+  discovery2.Register(registration, true);
+  waitForStats(1);
+
+  // EnableStats(false) registers the subscriber again.
+  discovery2.Register(registration, false);
+  waitForStats(2);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_TRUE(stats[0]);
+    EXPECT_FALSE(stats[1]);
+  }
+
+  discovery2.Unregister(registration);
+  for (int i = 0; i < MaxIters && unregistrations < 1; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(Nap));
+  EXPECT_EQ(1, unregistrations);
+}
+
 //////////////////////////////////////////////////
 /// \brief Check that a discovery service sends messages if there are
 /// topics or services advertised in its process.
@@ -548,3 +1383,112 @@ TEST(DiscoveryTest, WrongIgnIp)
   if (!ignIp.empty())
     setenv("IGN_IP", ignIp.c_str(), 1);
 }
+
+#ifdef __linux__
+//////////////////////////////////////////////////
+/// \brief The messages of other processes forwarded to a unicast relay are
+/// sent together once the batch is flushed, and a message superseded by a
+/// later one about the same thing isn't forwarded.
+TEST(DiscoveryTest, TestRelayBatching)
+{
+  const int port = 11421;
+  const std::string relayIp = "127.0.0.2";
+
+  // The relay listens on another loopback address, with the discovery port.
+  const int relay = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(relay, 0);
+  int reuseAddr = 1;
+  setsockopt(relay, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
+  sockaddr_in relayAddr;
+  memset(&relayAddr, 0, sizeof(relayAddr));
+  relayAddr.sin_family = AF_INET;
+  relayAddr.sin_addr.s_addr = inet_addr(relayIp.c_str());
+  relayAddr.sin_port = htons(static_cast<uint16_t>(port));
+  ASSERT_EQ(0, bind(relay, reinterpret_cast<sockaddr *>(&relayAddr),
+    sizeof(relayAddr)));
+
+  setenv("IGN_RELAY", relayIp.c_str(), 1);
+  MsgDiscovery discovery1(pUuid1, g_ip, port);
+  unsetenv("IGN_RELAY");
+  discovery1.Start();
+
+  // Another process of the network, heard twice about the same things.
+  const std::string otherPUuid = transport::Uuid().ToString();
+  std::vector<ignition::msgs::Discovery> msgs(2);
+  msgs[0].set_version(10);
+  msgs[0].set_process_uuid(otherPUuid);
+  msgs[0].set_type(ignition::msgs::Discovery::HEARTBEAT);
+  auto data = msgs[0].mutable_header()->add_data();
+  data->set_key("batch");
+  data->add_value("1");
+  msgs[1].set_version(10);
+  msgs[1].set_process_uuid(otherPUuid);
+  msgs[1].set_type(ignition::msgs::Discovery::ADVERTISE);
+  MessagePublisher publisher(g_topic, addr2, ctrl2, otherPUuid, nUuid2,
+    "t", AdvertiseMessageOptions());
+  publisher.FillDiscovery(msgs[1]);
+  msgs.push_back(msgs[0]);
+  msgs.push_back(msgs[1]);
+
+  const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(sender, 0);
+  sockaddr_in discoveryAddr;
+  memset(&discoveryAddr, 0, sizeof(discoveryAddr));
+  discoveryAddr.sin_family = AF_INET;
+  discoveryAddr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  discoveryAddr.sin_port = htons(static_cast<uint16_t>(port));
+  for (const auto &datagram : transport::packDiscoveryMsgs(msgs, false))
+  {
+    ASSERT_EQ(static_cast<ssize_t>(datagram.size()), sendto(sender,
+      datagram.data(), datagram.size(), 0,
+      reinterpret_cast<const sockaddr *>(&discoveryAddr),
+      sizeof(discoveryAddr)));
+  }
+  close(sender);
+
+  // Collect what the relay receives about the other process. The messages
+  // of discovery1 itself are sent to the relay as well.
+  int datagrams = 0;
+  int heartbeats = 0;
+  int advertisements = 0;
+  const auto deadline =
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(1000);
+  std::vector<char> buffer(65536);
+  while (std::chrono::steady_clock::now() < deadline)
+  {
+    pollfd item;
+    item.fd = relay;
+    item.events = POLLIN;
+    item.revents = 0;
+    if (poll(&item, 1, 50) != 1)
+      continue;
+
+    const ssize_t size = recv(relay, buffer.data(), buffer.size(), 0);
+    std::vector<ignition::msgs::Discovery> received;
+    if (size <= 0 || !transport::unpackDiscoveryMsgs(buffer.data(),
+          static_cast<size_t>(size), received))
+    {
+      continue;
+    }
+
+    bool fromOther = false;
+    for (const auto &msg : received)
+    {
+      if (msg.process_uuid() != otherPUuid)
+        continue;
+      fromOther = true;
+      EXPECT_TRUE(msg.flags().relay());
+      if (msg.type() == ignition::msgs::Discovery::HEARTBEAT)
+        ++heartbeats;
+      else if (msg.type() == ignition::msgs::Discovery::ADVERTISE)
+        ++advertisements;
+    }
+    datagrams += fromOther;
+  }
+  close(relay);
+
+  EXPECT_EQ(1, datagrams);
+  EXPECT_EQ(1, heartbeats);
+  EXPECT_EQ(1, advertisements);
+}
+#endif
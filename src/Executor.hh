@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_EXECUTOR_HH_
+#define IGN_TRANSPORT_EXECUTOR_HH_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/ThreadConfig.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class Executor Executor.hh
+    /// \brief A pool of threads running tasks grouped by key. Tasks posted
+    /// with the same key (e.g.: a topic name or a handler UUID) run one at a
+    /// time in the order in which they were posted, while tasks with
+    /// different keys run concurrently. Keys take turns, so a busy key
+    /// can't starve the rest. This class is thread safe.
+    class Executor
+    {
+      /// \brief Constructor.
+      /// \param[in] _numThreads Number of worker threads. At least one thread
+      /// is always created.
+      /// \param[in] _name Name of the worker threads, configured with
+      /// ThreadConfig::Global().
+      public: explicit Executor(std::size_t _numThreads,
+                                const std::string &_name = "ign-executor")
+      {
+        if (_numThreads == 0)
+          _numThreads = 1;
+
+        const ThreadConfig config = ThreadConfig::Global();
+        for (std::size_t i = 0; i < _numThreads; ++i)
+        {
+          this->workers.emplace_back([this, config, _name]
+            {
+              config.Apply(_name);
+              this->Run();
+            });
+        }
+      }
+
+      /// \brief Destructor. Waits for the tasks currently running and
+      /// discards the pending ones.
+      public: ~Executor()
+      {
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          this->stop = true;
+        }
+        this->newTask.notify_all();
+
+        for (auto &worker : this->workers)
+          worker.join();
+      }
+
+      /// \brief Post a task.
+      /// \param[in] _key Tasks with the same key are serialized.
+      /// \param[in] _task The task.
+      /// \param[in] _keepLast If not 0, maximum number of tasks of this key
+      /// and queue waiting to run. When there are more, the oldest ones are
+      /// discarded without running them. The task currently running is not
+      /// counted.
+      /// \param[in] _queue Tasks of a key sharing _keepLast, e.g.: the
+      /// handler UUID when several handlers share a key. Empty for all the
+      /// tasks of the key.
+      /// \return Number of tasks discarded.
+      public: std::size_t Post(const std::string &_key,
+                               std::function<void()> _task,
+                               std::size_t _keepLast = 0,
+                               const std::string &_queue = std::string())
+      {
+        std::size_t discarded = 0;
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          if (this->stop)
+            return 0;
+
+          Strand &strand = this->strands[_key];
+          strand.tasks.push_back({std::move(_task), _queue});
+          ++this->pending;
+
+          if (_keepLast > 0)
+          {
+            // The running task, if any, is always the first one. The
+            // waiting tasks of the queue are discarded from the oldest.
+            const std::size_t first = strand.running ? 1 : 0;
+            std::size_t waiting = 0;
+            for (std::size_t i = first; i < strand.tasks.size(); ++i)
+              waiting += strand.tasks[i].queue == _queue ? 1 : 0;
+
+            for (std::size_t i = first;
+                 waiting > _keepLast && i < strand.tasks.size();)
+            {
+              if (strand.tasks[i].queue != _queue)
+              {
+                ++i;
+                continue;
+              }
+              strand.tasks.erase(strand.tasks.begin() +
+                static_cast<std::ptrdiff_t>(i));
+              --waiting;
+              --this->pending;
+              ++discarded;
+            }
+          }
+
+          // Only one task per key can be scheduled at a time.
+          if (strand.active)
+            return discarded;
+
+          strand.active = true;
+          this->ready.push_back(_key);
+        }
+        this->newTask.notify_one();
+        return discarded;
+      }
+
+      /// \brief Block until all the posted tasks have been executed.
+      public: void Wait()
+      {
+        std::unique_lock<std::mutex> lk(this->mutex);
+        this->idle.wait(lk, [this]{return this->pending == 0 || this->stop;});
+      }
+
+      /// \brief Get the number of pending tasks for a key, including the one
+      /// currently running.
+      /// \param[in] _key The key.
+      /// \return Number of tasks.
+      public: std::size_t Pending(const std::string &_key) const
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        auto it = this->strands.find(_key);
+        if (it == this->strands.end())
+          return 0;
+        return it->second.tasks.size();
+      }
+
+      /// \brief Get the number of worker threads.
+      /// \return Number of threads.
+      public: std::size_t ThreadCount() const
+      {
+        return this->workers.size();
+      }
+
+      /// \brief Worker thread loop.
+      private: void Run()
+      {
+        std::unique_lock<std::mutex> lk(this->mutex);
+        while (true)
+        {
+          this->newTask.wait(lk,
+            [this]{return this->stop || !this->ready.empty();});
+
+          if (this->stop)
+            return;
+
+          std::string key = std::move(this->ready.front());
+          this->ready.pop_front();
+
+          // The task stays in the strand while running, so Pending() counts
+          // it and new tasks for the same key are queued behind it.
+          Strand &strand = this->strands[key];
+          std::function<void()> task = std::move(strand.tasks.front().run);
+          strand.running = true;
+
+          lk.unlock();
+          try
+          {
+            task();
+          }
+          catch (...)
+          {
+            std::cerr << "Exception occurred in a task posted with key ["
+                      << key << "]" << std::endl;
+          }
+          lk.lock();
+
+          auto it = this->strands.find(key);
+          it->second.tasks.pop_front();
+          it->second.running = false;
+          if (it->second.tasks.empty())
+          {
+            this->strands.erase(it);
+          }
+          else
+          {
+            // Go to the end of the line to let the other keys run.
+            this->ready.push_back(std::move(key));
+            this->newTask.notify_one();
+          }
+
+          if (--this->pending == 0)
+            this->idle.notify_all();
+        }
+      }
+
+      /// \brief A posted task.
+      private: struct Task
+      {
+        /// \brief The task.
+        public: std::function<void()> run;
+
+        /// \brief Queue of the task within its key, see Post().
+        public: std::string queue;
+      };
+
+      /// \brief Tasks for a key.
+      private: struct Strand
+      {
+        /// \brief Pending tasks. The first one might be running.
+        public: std::deque<Task> tasks;
+
+        /// \brief True if the strand is scheduled or running.
+        public: bool active = false;
+
+        /// \brief True while the first task is running.
+        public: bool running = false;
+      };
+
+      /// \brief Protects all the members below.
+      private: mutable std::mutex mutex;
+
+      /// \brief Signaled when a new key is ready or when stopping.
+      private: std::condition_variable newTask;
+
+      /// \brief Signaled when there are no pending tasks.
+      private: std::condition_variable idle;
+
+      /// \brief Strands indexed by key.
+      private: std::unordered_map<std::string, Strand> strands;
+
+      /// \brief Keys whose next task is ready to run.
+      private: std::deque<std::string> ready;
+
+      /// \brief Number of tasks posted and not yet finished.
+      private: std::size_t pending = 0;
+
+      /// \brief True when the executor is being destroyed.
+      private: bool stop = false;
+
+      /// \brief Worker threads.
+      private: std::vector<std::thread> workers;
+    };
+    }
+  }
+}
+#endif
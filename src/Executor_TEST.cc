@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Executor.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Tasks with the same key run in order and never concurrently.
+TEST(ExecutorTest, SameKeyInOrder)
+{
+  Executor executor(4);
+  EXPECT_EQ(4u, executor.ThreadCount());
+
+  std::mutex mutex;
+  std::vector<int> order;
+  std::atomic<int> running{0};
+  bool overlapped = false;
+
+  for (int i = 0; i < 100; ++i)
+  {
+    executor.Post("/foo", [&, i]()
+    {
+      if (++running > 1)
+        overlapped = true;
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        order.push_back(i);
+      }
+      --running;
+    });
+  }
+  executor.Wait();
+
+  EXPECT_FALSE(overlapped);
+  ASSERT_EQ(100u, order.size());
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(i, order[i]);
+  EXPECT_EQ(0u, executor.Pending("/foo"));
+}
+
+//////////////////////////////////////////////////
+/// \brief A slow key doesn't block the others.
+TEST(ExecutorTest, DifferentKeysConcurrent)
+{
+  Executor executor(2);
+
+  std::atomic<bool> release{false};
+  std::atomic<bool> fastDone{false};
+
+  executor.Post("/slow", [&]()
+  {
+    while (!release)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  executor.Post("/fast", [&]()
+  {
+    fastDone = true;
+  });
+
+  for (int i = 0; i < 1000 && !fastDone; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_TRUE(fastDone);
+  EXPECT_EQ(1u, executor.Pending("/slow"));
+
+  release = true;
+  executor.Wait();
+  EXPECT_EQ(0u, executor.Pending("/slow"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Exceptions thrown by tasks don't stop the executor.
+TEST(ExecutorTest, Exception)
+{
+  Executor executor(0);
+  EXPECT_EQ(1u, executor.ThreadCount());
+
+  bool executed = false;
+  executor.Post("/foo", []() {throw 1;});
+  executor.Post("/foo", [&]() {executed = true;});
+  executor.Wait();
+  EXPECT_TRUE(executed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Only the newest tasks are kept when a key falls behind.
+TEST(ExecutorTest, KeepLast)
+{
+  Executor executor(1);
+
+  std::atomic<bool> started{false};
+  std::atomic<bool> release{false};
+  std::vector<int> executed;
+
+  executor.Post("/foo", [&]()
+  {
+    started = true;
+    while (!release)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }, 2);
+
+  for (int i = 0; i < 1000 && !started; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  ASSERT_TRUE(started);
+
+  // The running task is not discarded.
+  std::size_t discarded = 0;
+  for (int i = 0; i < 5; ++i)
+    discarded += executor.Post("/foo", [&, i]() {executed.push_back(i);}, 2);
+  EXPECT_EQ(3u, discarded);
+  EXPECT_EQ(3u, executor.Pending("/foo"));
+
+  release = true;
+  executor.Wait();
+
+  ASSERT_EQ(2u, executed.size());
+  EXPECT_EQ(3, executed[0]);
+  EXPECT_EQ(4, executed[1]);
+}
+
+//////////////////////////////////////////////////
+/// \brief The tasks of different queues of a key are discarded separately,
+/// and still run one at a time, in order.
+TEST(ExecutorTest, KeepLastPerQueue)
+{
+  Executor executor(2);
+
+  std::atomic<bool> started{false};
+  std::atomic<bool> release{false};
+  std::vector<std::string> executed;
+
+  executor.Post("group", [&]()
+  {
+    started = true;
+    while (!release)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+
+  for (int i = 0; i < 1000 && !started; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  ASSERT_TRUE(started);
+
+  std::size_t discarded = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    for (const std::string queue : {"a", "b"})
+    {
+      discarded += executor.Post("group", [&executed, queue, i]()
+        {
+          executed.push_back(queue + std::to_string(i));
+        }, queue == "a" ? 1 : 0, queue);
+    }
+  }
+  EXPECT_EQ(2u, discarded);
+
+  release = true;
+  executor.Wait();
+
+  EXPECT_EQ(std::vector<std::string>({"b0", "b1", "a2", "b2"}), executed);
+}
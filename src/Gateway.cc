@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/Gateway.hh"
+#include "ignition/transport/MessageInfo.hh"
+#include "ignition/transport/Node.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \internal
+    /// \brief A topic forwarded by the gateway.
+    class GatewayRoute
+    {
+      /// \brief Forward a message downstream. Called by the upstream
+      /// subscription.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message (bytes).
+      /// \param[in] _info Information about the message.
+      public: void OnMessage(const char *_data, const std::size_t _size,
+                             const MessageInfo &_info)
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        if (this->stopped)
+          return;
+
+        // The type is only known once a message arrives.
+        if (!this->publisher)
+        {
+          this->publisher = this->downstream->Advertise(this->downstreamTopic,
+            _info.Type(), this->advOpts);
+          if (!this->publisher)
+          {
+            this->failed.fetch_add(1, std::memory_order_relaxed);
+            return;
+          }
+          this->type = _info.Type();
+        }
+
+        if (_info.Type() != this->type ||
+            !this->publisher.PublishRaw(_data, _size, _info.Type()))
+        {
+          this->failed.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+        this->forwarded.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      /// \brief Stop forwarding and unadvertise the topic downstream.
+      public: void Stop()
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->stopped = true;
+        this->publisher = Node::Publisher();
+      }
+
+      /// \brief Node republishing the messages.
+      public: Node *downstream = nullptr;
+
+      /// \brief Name of the topic downstream.
+      public: std::string downstreamTopic;
+
+      /// \brief Options of the publisher downstream.
+      public: AdvertiseMessageOptions advOpts;
+
+      /// \brief Publisher downstream, advertised with the first message.
+      public: Node::Publisher publisher;
+
+      /// \brief Type of the messages, set with the first message.
+      public: std::string type;
+
+      /// \brief True once the topic isn't forwarded anymore.
+      public: bool stopped = false;
+
+      /// \brief Protects the publisher and the type.
+      public: std::mutex mutex;
+
+      /// \brief Messages forwarded.
+      public: std::atomic<uint64_t> forwarded{0};
+
+      /// \brief Messages that couldn't be forwarded.
+      public: std::atomic<uint64_t> failed{0};
+    };
+
+    /// \internal
+    /// \brief Private data for the Gateway class.
+    class GatewayPrivate
+    {
+      /// \brief Node republishing the messages. Declared first, so it
+      /// outlives the subscriptions of the upstream node.
+      public: std::unique_ptr<Node> downstream;
+
+      /// \brief Node subscribing to the topics.
+      public: std::unique_ptr<Node> upstream;
+
+      /// \brief Topics forwarded, indexed by their name upstream.
+      public: std::map<std::string, std::shared_ptr<GatewayRoute>> routes;
+
+      /// \brief Protects the routes.
+      public: mutable std::mutex mutex;
+    };
+    }
+  }
+}
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+Gateway::Gateway(const NodeOptions &_upstream, const NodeOptions &_downstream)
+  : dataPtr(new GatewayPrivate())
+{
+  this->dataPtr->downstream.reset(new Node(_downstream));
+  this->dataPtr->upstream.reset(new Node(_upstream));
+}
+
+//////////////////////////////////////////////////
+Gateway::~Gateway()
+{
+  for (const std::string &topic : this->Topics())
+    this->Stop(topic);
+}
+
+//////////////////////////////////////////////////
+bool Gateway::Forward(const std::string &_topic,
+    const std::string &_downstreamTopic, const SubscribeOptions &_subOpts,
+    const AdvertiseMessageOptions &_advOpts)
+{
+  const std::string &downstreamTopic =
+    _downstreamTopic.empty() ? _topic : _downstreamTopic;
+
+  const TopicName up = this->dataPtr->upstream->Resolve(_topic);
+  const TopicName down = this->dataPtr->downstream->Resolve(downstreamTopic);
+  if (!up.Valid() || !down.Valid())
+  {
+    std::cerr << "Gateway::Forward(): Invalid topic [" << _topic << "] or ["
+              << downstreamTopic << "]" << std::endl;
+    return false;
+  }
+
+  if (up.FullyQualifiedName() == down.FullyQualifiedName())
+  {
+    std::cerr << "Gateway::Forward(): Topic [" << _topic << "] would be "
+              << "forwarded to itself" << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  if (this->dataPtr->routes.count(_topic) > 0)
+  {
+    std::cerr << "Gateway::Forward(): Topic [" << _topic << "] is already "
+              << "forwarded" << std::endl;
+    return false;
+  }
+
+  auto route = std::make_shared<GatewayRoute>();
+  route->downstream = this->dataPtr->downstream.get();
+  route->downstreamTopic = downstreamTopic;
+  route->advOpts = _advOpts;
+
+  // A single subscription upstream, whatever the number of subscribers
+  // downstream.
+  if (!this->dataPtr->upstream->SubscribeRaw(up,
+        [route](const char *_data, const std::size_t _size,
+                const MessageInfo &_info)
+        {
+          route->OnMessage(_data, _size, _info);
+        }, kGenericMessageType, _subOpts))
+  {
+    return false;
+  }
+
+  this->dataPtr->routes[_topic] = std::move(route);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Gateway::Stop(const std::string &_topic)
+{
+  std::shared_ptr<GatewayRoute> route;
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+    auto it = this->dataPtr->routes.find(_topic);
+    if (it == this->dataPtr->routes.end())
+      return false;
+    route = std::move(it->second);
+    this->dataPtr->routes.erase(it);
+  }
+
+  this->dataPtr->upstream->Unsubscribe(_topic);
+  route->Stop();
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> Gateway::Topics() const
+{
+  std::vector<std::string> topics;
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  topics.reserve(this->dataPtr->routes.size());
+  for (const auto &route : this->dataPtr->routes)
+    topics.push_back(route.first);
+  return topics;
+}
+
+//////////////////////////////////////////////////
+uint64_t Gateway::Forwarded(const std::string &_topic) const
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  auto it = this->dataPtr->routes.find(_topic);
+  if (it == this->dataPtr->routes.end())
+    return 0;
+  return it->second->forwarded.load(std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////
+uint64_t Gateway::Failed(const std::string &_topic) const
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->mutex);
+  auto it = this->dataPtr->routes.find(_topic);
+  if (it == this->dataPtr->routes.end())
+    return 0;
+  return it->second->failed.load(std::memory_order_relaxed);
+}
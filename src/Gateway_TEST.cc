@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Gateway.hh"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Partition of the tests.
+static std::string g_partition; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief The topics can't be forwarded to themselves or twice.
+TEST(GatewayTest, InvalidTopics)
+{
+  NodeOptions opts;
+  opts.SetPartition(g_partition + "_up");
+
+  Gateway loop(opts, opts);
+  EXPECT_FALSE(loop.Forward("invalid topic"));
+  EXPECT_FALSE(loop.Forward("/foo"));
+  EXPECT_TRUE(loop.Forward("/foo", "/bar"));
+  EXPECT_FALSE(loop.Forward("/foo", "/baz"));
+  EXPECT_EQ(std::vector<std::string>{"/foo"}, loop.Topics());
+
+  EXPECT_FALSE(loop.Stop("/bar"));
+  EXPECT_TRUE(loop.Stop("/foo"));
+  EXPECT_TRUE(loop.Topics().empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief The messages of a partition are republished in another one.
+TEST(GatewayTest, Forward)
+{
+  NodeOptions upOpts;
+  upOpts.SetPartition(g_partition + "_up");
+  NodeOptions downOpts;
+  downOpts.SetPartition(g_partition + "_down");
+
+  Gateway gateway(upOpts, downOpts);
+  EXPECT_TRUE(gateway.Forward("/foo"));
+  EXPECT_EQ(0u, gateway.Forwarded("/foo"));
+
+  std::atomic<int> received{0};
+  std::atomic<int> lastData{0};
+  std::function<void(const msgs::Int32 &)> cb =
+    [&](const msgs::Int32 &_msg)
+    {
+      lastData = _msg.data();
+      ++received;
+    };
+
+  Node subscriber(downOpts);
+  EXPECT_TRUE(subscriber.Subscribe("/foo", cb));
+
+  // The subscribers of the upstream partition are still served directly.
+  Node upSubscriber(upOpts);
+  std::atomic<int> upReceived{0};
+  std::function<void(const msgs::Int32 &)> upCb =
+    [&](const msgs::Int32 &)
+    {
+      ++upReceived;
+    };
+  EXPECT_TRUE(upSubscriber.Subscribe("/foo", upCb));
+
+  Node publisher(upOpts);
+  auto pub = publisher.Advertise<msgs::Int32>("/foo");
+  ASSERT_TRUE(pub);
+
+  msgs::Int32 msg;
+  msg.set_data(7);
+  for (int i = 0; i < 100 && received == 0; ++i)
+  {
+    EXPECT_TRUE(pub.Publish(msg));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  EXPECT_GT(received, 0);
+  EXPECT_EQ(7, lastData);
+  EXPECT_GE(upReceived, received);
+  EXPECT_GE(gateway.Forwarded("/foo"), static_cast<uint64_t>(received));
+  EXPECT_EQ(0u, gateway.Failed("/foo"));
+
+  // Nothing is forwarded once the gateway stops.
+  EXPECT_TRUE(gateway.Stop("/foo"));
+  EXPECT_EQ(0u, gateway.Forwarded("/foo"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const int before = received;
+  EXPECT_TRUE(pub.Publish(msg));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(before, received);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Keep the publications away from the other tests.
+  g_partition = testing::getRandomNumber();
+  setenv("IGN_PARTITION", g_partition.c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
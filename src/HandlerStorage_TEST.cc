@@ -15,13 +15,16 @@
  *
 */
 
+#include <chrono>
 #include <map>
 #include <string>
+#include <vector>
 #include <ignition/msgs.hh>
 
 #include "ignition/transport/HandlerStorage.hh"
 #include "ignition/transport/MessageInfo.hh"
 #include "ignition/transport/RepHandler.hh"
+#include "ignition/transport/ReqHandler.hh"
 #include "ignition/transport/SubscriptionHandler.hh"
 #include "ignition/transport/TransportTypes.hh"
 #include "gtest/gtest.h"
@@ -104,6 +107,11 @@ TEST(RepStorageTest, RepStorageAPI)
   EXPECT_EQ(m.size(), 1u);
   EXPECT_EQ(m.begin()->first, nUuid1);
 
+  std::vector<std::string> topics;
+  reps.TopicList(topics);
+  ASSERT_EQ(1u, topics.size());
+  EXPECT_EQ(topic, topics.front());
+
   reset();
 
   // Check the handler operations.
@@ -239,6 +247,174 @@ TEST(RepStorageTest, SubStorageNoCallbacks)
   EXPECT_EQ(handler->HandlerUuid(), sub1HandlerPtr->HandlerUuid());
 }
 
+//////////////////////////////////////////////////
+/// \brief Check that requests are serialized when their message is set.
+TEST(RepStorageTest, ReqHandlerSerializedRequest)
+{
+  ignition::msgs::Int32 reqMsg;
+  reqMsg.set_data(intResult);
+  std::string expected;
+  ASSERT_TRUE(reqMsg.SerializeToString(&expected));
+
+  transport::ReqHandler<ignition::msgs::Int32, ignition::msgs::StringMsg>
+    handler(nUuid1);
+  EXPECT_EQ(nullptr, handler.SerializedRequest());
+  std::string data;
+  EXPECT_FALSE(handler.Serialize(data));
+
+  handler.SetMessage(&reqMsg);
+
+  // Changing the message after making the request has no effect.
+  reqMsg.set_data(intResult + 1);
+  ASSERT_NE(nullptr, handler.SerializedRequest());
+  EXPECT_EQ(expected, *handler.SerializedRequest());
+  EXPECT_TRUE(handler.Serialize(data));
+  EXPECT_EQ(expected, data);
+
+  // Same for generic messages.
+  transport::ReqHandler<google::protobuf::Message, google::protobuf::Message>
+    genericHandler(nUuid1);
+  EXPECT_EQ(nullptr, genericHandler.SerializedRequest());
+  reqMsg.set_data(intResult);
+  genericHandler.SetMessage(&reqMsg);
+  reqMsg.set_data(intResult + 1);
+  ASSERT_NE(nullptr, genericHandler.SerializedRequest());
+  EXPECT_EQ(expected, *genericHandler.SerializedRequest());
+  EXPECT_EQ(reqMsg.GetTypeName(), genericHandler.ReqTypeName());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the deadline of a request handler.
+TEST(RepStorageTest, ReqHandlerDeadline)
+{
+  transport::ReqHandler<ignition::msgs::Int32, ignition::msgs::StringMsg>
+    handler(nUuid1);
+  std::chrono::steady_clock::time_point deadline;
+  EXPECT_FALSE(handler.Deadline(deadline));
+
+  const auto before = std::chrono::steady_clock::now();
+  handler.SetTimeout(500);
+  const auto after = std::chrono::steady_clock::now();
+  ASSERT_TRUE(handler.Deadline(deadline));
+  EXPECT_GE(deadline, before + std::chrono::milliseconds(500));
+  EXPECT_LE(deadline, after + std::chrono::milliseconds(500));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the streaming reply and request handlers.
+TEST(RepStorageTest, StreamHandlers)
+{
+  transport::StreamRepHandler<ignition::msgs::Int32, ignition::msgs::Int32>
+    repHandler;
+  EXPECT_TRUE(repHandler.Streaming());
+  repHandler.SetCallback(
+    [](const ignition::msgs::Int32 &_req,
+       const transport::ServiceStream<ignition::msgs::Int32> &_stream)
+    {
+      ignition::msgs::Int32 rep;
+      for (int i = 0; i < _req.data(); ++i)
+      {
+        rep.set_data(i);
+        if (!_stream.Write(rep))
+          break;
+      }
+      EXPECT_TRUE(_stream.Close());
+      EXPECT_FALSE(_stream.Close());
+      EXPECT_FALSE(_stream.Write(rep));
+    });
+
+  ignition::msgs::Int32 reqMsg;
+  reqMsg.set_data(3);
+  std::string req;
+  ASSERT_TRUE(reqMsg.SerializeToString(&req));
+
+  // All the responses are streamed.
+  transport::StreamReqHandler<ignition::msgs::Int32, ignition::msgs::Int32>
+    reqHandler(nUuid1);
+  EXPECT_GT(reqHandler.StreamWindow(), 0u);
+  std::vector<int> replies;
+  int done = 0;
+  bool result = false;
+  reqHandler.SetCallbacks(
+    [&replies](const ignition::msgs::Int32 &_rep)
+    {
+      replies.push_back(_rep.data());
+    },
+    [&done, &result](const bool _result)
+    {
+      ++done;
+      result = _result;
+    });
+
+  repHandler.RunStreamCallback(req,
+    [&reqHandler](const std::string &_rep)
+    {
+      reqHandler.NotifyPartial(_rep);
+      return true;
+    },
+    [&reqHandler](const bool _result)
+    {
+      if (_result)
+        reqHandler.NotifyStreamEnd();
+      else
+        reqHandler.NotifyResult("", false);
+    });
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), replies);
+  EXPECT_EQ(1, done);
+  EXPECT_TRUE(result);
+  EXPECT_TRUE(reqHandler.repAvailable);
+
+  // Requests that don't stream only receive the first response.
+  std::string rep;
+  EXPECT_TRUE(repHandler.RunCallback(req, rep));
+  ignition::msgs::Int32 repMsg;
+  ASSERT_TRUE(repMsg.ParseFromString(rep));
+  EXPECT_EQ(0, repMsg.data());
+
+  // An empty stream fails.
+  reqMsg.set_data(0);
+  ASSERT_TRUE(reqMsg.SerializeToString(&req));
+  EXPECT_FALSE(repHandler.RunCallback(req, rep));
+
+  // A responder that doesn't stream sends a single response.
+  repMsg.set_data(7);
+  ASSERT_TRUE(repMsg.SerializeToString(&rep));
+  replies.clear();
+  done = 0;
+  reqHandler.NotifyResult(rep, true);
+  EXPECT_EQ((std::vector<int>{7}), replies);
+  EXPECT_EQ(1, done);
+  EXPECT_TRUE(result);
+}
+
+//////////////////////////////////////////////////
+/// \brief A stream that is dropped without closing it fails.
+TEST(RepStorageTest, ServiceStreamDestructor)
+{
+  int closed = 0;
+  bool result = true;
+  {
+    transport::ServiceStream<ignition::msgs::Int32> stream(
+      [](const ignition::msgs::Int32 &) { return true; },
+      [&closed, &result](const bool _result)
+      {
+        ++closed;
+        result = _result;
+      });
+    EXPECT_TRUE(stream.Valid());
+    EXPECT_FALSE(stream.Closed());
+    EXPECT_TRUE(stream.Write(ignition::msgs::Int32()));
+  }
+  EXPECT_EQ(1, closed);
+  EXPECT_FALSE(result);
+
+  transport::ServiceStream<ignition::msgs::Int32> empty;
+  EXPECT_FALSE(empty.Valid());
+  EXPECT_TRUE(empty.Closed());
+  EXPECT_FALSE(empty.Write(ignition::msgs::Int32()));
+  EXPECT_FALSE(empty.Close());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
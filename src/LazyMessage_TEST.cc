@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/LazyMessage.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief An empty handle.
+TEST(LazyMessageTest, Empty)
+{
+  transport::LazyMessage<msgs::Int32> lazy;
+  EXPECT_FALSE(lazy.Valid());
+  EXPECT_TRUE(lazy.Data().empty());
+  EXPECT_TRUE(lazy.Type().empty());
+  EXPECT_EQ(nullptr, lazy.Get());
+}
+
+//////////////////////////////////////////////////
+/// \brief The message is parsed once and shared by the copies.
+TEST(LazyMessageTest, Get)
+{
+  msgs::Int32 msg;
+  msg.set_data(7);
+  std::string data;
+  ASSERT_TRUE(msg.SerializeToString(&data));
+
+  transport::LazyMessage<msgs::Int32> lazy(data.data(), data.size(),
+    msg.GetTypeName());
+  EXPECT_TRUE(lazy.Valid());
+  EXPECT_EQ(data, lazy.Data());
+  EXPECT_EQ(msg.GetTypeName(), lazy.Type());
+
+  // Parse from another thread through a copy.
+  transport::LazyMessage<msgs::Int32> copy = lazy;
+  std::shared_ptr<const msgs::Int32> parsed;
+  std::thread t([&copy, &parsed]() {parsed = copy.Get();});
+  t.join();
+
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_EQ(7, parsed->data());
+  EXPECT_EQ(parsed.get(), lazy.Get().get());
+}
+
+//////////////////////////////////////////////////
+/// \brief Invalid data can't be parsed.
+TEST(LazyMessageTest, InvalidData)
+{
+  const std::string data = "\xff\xff\xff";
+  transport::LazyMessage<msgs::Int32> lazy(data.data(), data.size(),
+    "ignition.msgs.Int32");
+  EXPECT_TRUE(lazy.Valid());
+  EXPECT_EQ(nullptr, lazy.Get());
+  EXPECT_EQ(nullptr, lazy.Get());
+}
+
+//////////////////////////////////////////////////
+/// \brief A borrowed message is copied only if a handle outlives the data.
+TEST(LazyMessageTest, Borrow)
+{
+  msgs::Int32 msg;
+  msg.set_data(7);
+  std::string data;
+  ASSERT_TRUE(msg.SerializeToString(&data));
+
+  transport::LazyMessage<msgs::Int32> kept;
+  {
+    std::string buffer = data;
+    auto lazy = transport::LazyMessage<msgs::Int32>::Borrow(buffer.data(),
+      buffer.size(), msg.GetTypeName());
+    EXPECT_TRUE(lazy.Valid());
+    kept = lazy;
+    lazy.Detach();
+
+    // The data was copied, so the buffer can change.
+    buffer.assign(buffer.size(), '\xff');
+  }
+
+  EXPECT_EQ(data, kept.Data());
+  auto parsed = kept.Get();
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_EQ(7, parsed->data());
+}
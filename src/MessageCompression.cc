@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <limits>
+
+#include "ignition/transport/config.hh"
+#include "MessageCompression.hh"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+bool transport::CompressionAvailable(const Compression_t _compression)
+{
+  switch (_compression)
+  {
+    case Compression_t::NONE:
+      return true;
+    case Compression_t::ZLIB:
+#ifdef HAVE_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+//////////////////////////////////////////////////
+std::size_t transport::CompressBound(const Compression_t _compression,
+    const std::size_t _size)
+{
+#ifdef HAVE_ZLIB
+  if (_compression == Compression_t::ZLIB &&
+      _size <= std::numeric_limits<uLong>::max())
+  {
+    return compressBound(static_cast<uLong>(_size));
+  }
+#else
+  (void)_compression;
+#endif
+  return _size;
+}
+
+//////////////////////////////////////////////////
+bool transport::Compress(const Compression_t _compression,
+    const char *_data, const std::size_t _size, char *_out,
+    const std::size_t _outCapacity, std::size_t &_outSize)
+{
+#ifdef HAVE_ZLIB
+  if (_compression != Compression_t::ZLIB ||
+      _size > std::numeric_limits<uLong>::max())
+  {
+    return false;
+  }
+
+  uLongf compressedLen = static_cast<uLongf>(_outCapacity);
+  if (compress2(reinterpret_cast<Bytef *>(_out), &compressedLen,
+        reinterpret_cast<const Bytef *>(_data), static_cast<uLong>(_size),
+        Z_BEST_SPEED) != Z_OK)
+  {
+    return false;
+  }
+
+  // The messages that don't get smaller are sent as they are.
+  if (compressedLen + kCompressionHeaderSize >= _size)
+    return false;
+
+  _outSize = compressedLen;
+  return true;
+#else
+  (void)_compression;
+  (void)_data;
+  (void)_size;
+  (void)_out;
+  (void)_outCapacity;
+  (void)_outSize;
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool transport::Decompress(const Compression_t _compression,
+    const char *_data, const std::size_t _size, char *_out,
+    const std::size_t _outSize)
+{
+#ifdef HAVE_ZLIB
+  if (_compression != Compression_t::ZLIB ||
+      _outSize > std::numeric_limits<uLongf>::max())
+  {
+    return false;
+  }
+
+  uLongf decompressedLen = static_cast<uLongf>(_outSize);
+  return uncompress(reinterpret_cast<Bytef *>(_out), &decompressedLen,
+      reinterpret_cast<const Bytef *>(_data),
+      static_cast<uLong>(_size)) == Z_OK &&
+    decompressedLen == _outSize;
+#else
+  (void)_compression;
+  (void)_data;
+  (void)_size;
+  (void)_out;
+  (void)_outSize;
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+void transport::PackCompressionHeader(const CompressionHeader &_header,
+    char *_out)
+{
+  _out[0] = static_cast<char>(_header.method);
+  uint64_t size = _header.size;
+  for (std::size_t i = 1; i < kCompressionHeaderSize; ++i)
+  {
+    _out[i] = static_cast<char>(size & 0xFF);
+    size >>= 8;
+  }
+}
+
+//////////////////////////////////////////////////
+bool transport::UnpackCompressionHeader(const char *_data,
+    const std::size_t _size, CompressionHeader &_header)
+{
+  if (_size < kCompressionHeaderSize)
+    return false;
+
+  const unsigned char *data = reinterpret_cast<const unsigned char *>(_data);
+  _header.method = data[0];
+  _header.size = 0;
+  for (std::size_t i = kCompressionHeaderSize - 1; i > 0; --i)
+    _header.size = (_header.size << 8) | data[i];
+  return true;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_MESSAGECOMPRESSION_HH_
+#define IGN_TRANSPORT_MESSAGECOMPRESSION_HH_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \brief Frame trailing the data of a compressed message on the wire:
+    /// the compression method and the size of the original message.
+    class CompressionHeader
+    {
+      /// \brief Compression method, see Compression_t.
+      public: uint8_t method = 0;
+
+      /// \brief Number of bytes of the original message.
+      public: uint64_t size = 0;
+    };
+
+    /// \brief Size of a serialized CompressionHeader (bytes).
+    static constexpr std::size_t kCompressionHeaderSize =
+      sizeof(uint8_t) + sizeof(uint64_t);
+
+    /// \brief Maximum ratio between the sizes of a message and its
+    /// compressed data, used to reject the headers of corrupt messages
+    /// before allocating their buffer. zlib can't exceed 1032:1.
+    static constexpr uint64_t kMaxCompressionRatio = 1032;
+
+    /// \brief Check if a compression method can be used by this build.
+    /// \param[in] _compression The compression method.
+    /// \return True if the messages can be compressed with it.
+    bool CompressionAvailable(const Compression_t _compression);
+
+    /// \brief Get the size of the buffer needed to compress a message.
+    /// \param[in] _compression The compression method.
+    /// \param[in] _size Number of bytes of the message.
+    /// \return The size of the buffer (bytes).
+    std::size_t CompressBound(const Compression_t _compression,
+                              const std::size_t _size);
+
+    /// \brief Compress a message, as fast as possible.
+    /// \param[in] _compression The compression method.
+    /// \param[in] _data The serialized message.
+    /// \param[in] _size Number of bytes of the message.
+    /// \param[out] _out The buffer, of CompressBound() bytes at least.
+    /// \param[in] _outCapacity Size of the buffer (bytes).
+    /// \param[out] _outSize Number of bytes of the compressed data.
+    /// \return False if the message couldn't be compressed, or if it
+    /// didn't get smaller, in which case it's sent as it is.
+    bool Compress(const Compression_t _compression, const char *_data,
+                  const std::size_t _size, char *_out,
+                  const std::size_t _outCapacity, std::size_t &_outSize);
+
+    /// \brief Decompress a message.
+    /// \param[in] _compression The compression method.
+    /// \param[in] _data The compressed data.
+    /// \param[in] _size Number of bytes of the compressed data.
+    /// \param[out] _out The buffer, of the size of the original message.
+    /// \param[in] _outSize Number of bytes of the original message.
+    /// \return False if the data is corrupt or if the method isn't
+    /// available.
+    bool Decompress(const Compression_t _compression, const char *_data,
+                    const std::size_t _size, char *_out,
+                    const std::size_t _outSize);
+
+    /// \brief Write a compression header in its wire format, little
+    /// endian.
+    /// \param[in] _header The header.
+    /// \param[out] _out The buffer, of kCompressionHeaderSize bytes.
+    void PackCompressionHeader(const CompressionHeader &_header, char *_out);
+
+    /// \brief Read a compression header.
+    /// \param[in] _data The frame.
+    /// \param[in] _size Number of bytes of the frame.
+    /// \param[out] _header The header.
+    /// \return False if the frame is malformed.
+    bool UnpackCompressionHeader(const char *_data, const std::size_t _size,
+                                 CompressionHeader &_header);
+    }
+  }
+}
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+#include <vector>
+
+#include "MessageCompression.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief The compression header round trips.
+TEST(MessageCompressionTest, Header)
+{
+  CompressionHeader header;
+  header.method = static_cast<uint8_t>(Compression_t::ZLIB);
+  header.size = 0x0102030405060708u;
+
+  char frame[kCompressionHeaderSize];
+  PackCompressionHeader(header, frame);
+
+  CompressionHeader other;
+  ASSERT_TRUE(UnpackCompressionHeader(frame, sizeof(frame), other));
+  EXPECT_EQ(header.method, other.method);
+  EXPECT_EQ(header.size, other.size);
+
+  EXPECT_FALSE(UnpackCompressionHeader(frame, sizeof(frame) - 1, other));
+}
+
+//////////////////////////////////////////////////
+/// \brief A message is compressed only if it gets smaller, and it's
+/// decompressed as it was.
+TEST(MessageCompressionTest, RoundTrip)
+{
+  EXPECT_TRUE(CompressionAvailable(Compression_t::NONE));
+  if (!CompressionAvailable(Compression_t::ZLIB))
+  {
+    const std::string msg(4096, 'a');
+    std::vector<char> out(CompressBound(Compression_t::ZLIB, msg.size()));
+    std::size_t outSize = 0;
+    EXPECT_FALSE(Compress(Compression_t::ZLIB, msg.data(), msg.size(),
+      out.data(), out.size(), outSize));
+    return;
+  }
+
+  std::string msg;
+  for (int i = 0; i < 512; ++i)
+    msg += "sample " + std::to_string(i % 16) + ";";
+
+  std::vector<char> out(CompressBound(Compression_t::ZLIB, msg.size()));
+  ASSERT_GE(out.size(), msg.size());
+  std::size_t outSize = 0;
+  ASSERT_TRUE(Compress(Compression_t::ZLIB, msg.data(), msg.size(),
+    out.data(), out.size(), outSize));
+  EXPECT_LT(outSize, msg.size());
+
+  std::string decompressed(msg.size(), '\0');
+  ASSERT_TRUE(Decompress(Compression_t::ZLIB, out.data(), outSize,
+    &decompressed[0], decompressed.size()));
+  EXPECT_EQ(msg, decompressed);
+
+  // The size of the original message is checked.
+  std::string wrongSize(msg.size() + 1, '\0');
+  EXPECT_FALSE(Decompress(Compression_t::ZLIB, out.data(), outSize,
+    &wrongSize[0], wrongSize.size()));
+
+  // Corrupt data is rejected.
+  out[outSize / 2] = static_cast<char>(~out[outSize / 2]);
+  EXPECT_FALSE(Decompress(Compression_t::ZLIB, out.data(), outSize,
+    &decompressed[0], decompressed.size()));
+  EXPECT_FALSE(Decompress(Compression_t::NONE, out.data(), outSize,
+    &decompressed[0], decompressed.size()));
+
+  // Data that doesn't get smaller is sent as it is.
+  const std::string tiny = "x";
+  std::vector<char> tinyOut(CompressBound(Compression_t::ZLIB, tiny.size()));
+  EXPECT_FALSE(Compress(Compression_t::ZLIB, tiny.data(), tiny.size(),
+    tinyOut.data(), tinyOut.size(), outSize));
+  EXPECT_FALSE(Compress(Compression_t::NONE, msg.data(), msg.size(),
+    out.data(), out.size(), outSize));
+}
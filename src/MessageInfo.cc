@@ -15,7 +15,11 @@
  *
 */
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <string>
+#include <string_view>
 
 #include "ignition/transport/MessageInfo.hh"
 #include "ignition/transport/TopicUtils.hh"
@@ -23,6 +27,38 @@
 using namespace ignition;
 using namespace transport;
 
+namespace
+{
+  //////////////////////////////////////////////////
+  /// \brief Check a partition or a topic name of a fully qualified name in
+  /// place, with the rules of TopicUtils::IsValidNamespace().
+  /// \param[in] _name The name.
+  /// \param[in] _allowEmpty Whether an empty name is valid.
+  /// \return True if the name is valid.
+  bool validName(const std::string_view _name, const bool _allowEmpty)
+  {
+    if (_name.empty())
+      return _allowEmpty;
+
+    if (_name.size() > TopicUtils::kMaxNameLength || _name == "/")
+      return false;
+
+    char previous = '\0';
+    for (const char c : _name)
+    {
+      if (c == '~' || c == ' ' || c == '@')
+        return false;
+
+      if ((c == '/' && previous == '/') || (c == '=' && previous == ':'))
+        return false;
+
+      previous = c;
+    }
+
+    return true;
+  }
+}
+
 namespace ignition
 {
   namespace transport
@@ -39,17 +75,93 @@ namespace ignition
       /// \brief Destructor.
       public: virtual ~MessageInfoPrivate() = default;
 
-      /// \brief Topic name.
-      public: std::string topic = "";
+      /// \brief Assignment operator. The topic name of _other is copied as
+      /// it is, decomposed or not.
+      /// \param[in] _other The private data to copy.
+      /// \return Reference to this object.
+      public: MessageInfoPrivate &operator=(const MessageInfoPrivate &_other)
+      {
+        if (_other.decomposed.load(std::memory_order_acquire))
+        {
+          this->topic = _other.topic;
+          this->partition = _other.partition;
+          this->decomposed.store(true, std::memory_order_relaxed);
+        }
+        else
+        {
+          this->fullyQualifiedTopic = _other.fullyQualifiedTopic;
+          this->lastAt = _other.lastAt;
+          this->decomposed.store(false, std::memory_order_relaxed);
+        }
+        this->type = _other.type;
+        this->isIntraProcess = _other.isIntraProcess;
+        this->publisherAddress = _other.publisherAddress;
+        this->receptionTime = _other.receptionTime;
+        this->receptionSystemTime = _other.receptionSystemTime;
+        this->sendTime = _other.sendTime;
+        this->sendSystemTime = _other.sendSystemTime;
+        return *this;
+      }
+
+      /// \brief Split the fully qualified topic name into the topic and
+      /// the partition, the first time that one of them is needed. Several
+      /// callbacks may read the same message information at once.
+      public: void Decompose() const
+      {
+        if (this->decomposed.load(std::memory_order_acquire))
+          return;
+
+        std::lock_guard<std::mutex> lk(this->mutex);
+        if (this->decomposed.load(std::memory_order_relaxed))
+          return;
+
+        this->partition.assign(this->fullyQualifiedTopic, 1,
+          this->lastAt - 1);
+        this->topic.assign(this->fullyQualifiedTopic, this->lastAt + 1,
+          std::string::npos);
+        this->decomposed.store(true, std::memory_order_release);
+      }
+
+      /// \brief Topic name. Only valid once decomposed.
+      public: mutable std::string topic = "";
 
       /// \brief Message type name.
       public: std::string type = "";
 
-      /// \brief Partition name.
-      public: std::string partition = "";
+      /// \brief Partition name. Only valid once decomposed.
+      public: mutable std::string partition = "";
+
+      /// \brief Fully qualified topic name set by SetTopicAndPartition(),
+      /// until it is decomposed.
+      public: std::string fullyQualifiedTopic;
+
+      /// \brief Position of the '@' that precedes the topic in
+      /// fullyQualifiedTopic.
+      public: std::size_t lastAt = 0;
+
+      /// \brief Whether topic and partition are up to date.
+      public: mutable std::atomic<bool> decomposed{true};
+
+      /// \brief Protects the decomposition.
+      public: mutable std::mutex mutex;
 
       /// \brief Was the message sent via intra-process?
       public: bool isIntraProcess = false;
+
+      /// \brief Address of the publisher process.
+      public: std::string publisherAddress = "";
+
+      /// \brief Time when the message was received.
+      public: std::chrono::steady_clock::time_point receptionTime;
+
+      /// \brief Time when the message was received, on the system clock.
+      public: std::chrono::system_clock::time_point receptionSystemTime;
+
+      /// \brief Time when the message was published.
+      public: std::chrono::steady_clock::time_point sendTime;
+
+      /// \brief Time when the message was published, on the system clock.
+      public: std::chrono::system_clock::time_point sendSystemTime;
     };
     }
   }
@@ -82,12 +194,14 @@ MessageInfo::~MessageInfo()
 //////////////////////////////////////////////////
 const std::string &MessageInfo::Topic() const
 {
+  this->dataPtr->Decompose();
   return this->dataPtr->topic;
 }
 
 //////////////////////////////////////////////////
 void MessageInfo::SetTopic(const std::string &_topic)
 {
+  this->dataPtr->Decompose();
   this->dataPtr->topic = _topic;
 }
 
@@ -106,22 +220,41 @@ void MessageInfo::SetType(const std::string &_type)
 //////////////////////////////////////////////////
 const std::string &MessageInfo::Partition() const
 {
+  this->dataPtr->Decompose();
   return this->dataPtr->partition;
 }
 
 //////////////////////////////////////////////////
 void MessageInfo::SetPartition(const std::string &_partition)
 {
+  this->dataPtr->Decompose();
   this->dataPtr->partition = _partition;
 }
 
 //////////////////////////////////////////////////
 bool MessageInfo::SetTopicAndPartition(const std::string &_fullyQualifiedName)
 {
-  return TopicUtils::DecomposeFullyQualifiedTopic(
-        _fullyQualifiedName,
-        this->dataPtr->partition,
-        this->dataPtr->topic);
+  // The name is validated now, like TopicUtils::DecomposeFullyQualifiedTopic()
+  // does, but only split into topic and partition if a callback asks for
+  // them. Most callbacks don't.
+  const std::string_view name(_fullyQualifiedName);
+  const std::size_t lastAt = name.find_last_of('@');
+  if (name.empty() || name.front() != '@' || lastAt == 0 ||
+      lastAt == name.size() - 1)
+  {
+    return false;
+  }
+
+  if (!validName(name.substr(1, lastAt - 1), true) ||
+      !validName(name.substr(lastAt + 1), false))
+  {
+    return false;
+  }
+
+  this->dataPtr->fullyQualifiedTopic = _fullyQualifiedName;
+  this->dataPtr->lastAt = lastAt;
+  this->dataPtr->decomposed.store(false, std::memory_order_relaxed);
+  return true;
 }
 
 //////////////////////////////////////////////////
@@ -135,3 +268,67 @@ void MessageInfo::SetIntraProcess(bool _value)
 {
   this->dataPtr->isIntraProcess = _value;
 }
+
+//////////////////////////////////////////////////
+const std::string &MessageInfo::PublisherAddress() const
+{
+  return this->dataPtr->publisherAddress;
+}
+
+//////////////////////////////////////////////////
+void MessageInfo::SetPublisherAddress(const std::string &_address)
+{
+  this->dataPtr->publisherAddress = _address;
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::time_point MessageInfo::ReceptionTime() const
+{
+  return this->dataPtr->receptionTime;
+}
+
+//////////////////////////////////////////////////
+void MessageInfo::SetReceptionTime(
+    const std::chrono::steady_clock::time_point &_time)
+{
+  this->dataPtr->receptionTime = _time;
+}
+
+//////////////////////////////////////////////////
+std::chrono::system_clock::time_point MessageInfo::ReceptionSystemTime() const
+{
+  return this->dataPtr->receptionSystemTime;
+}
+
+//////////////////////////////////////////////////
+void MessageInfo::SetReceptionSystemTime(
+    const std::chrono::system_clock::time_point &_time)
+{
+  this->dataPtr->receptionSystemTime = _time;
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::time_point MessageInfo::SendTime() const
+{
+  return this->dataPtr->sendTime;
+}
+
+//////////////////////////////////////////////////
+void MessageInfo::SetSendTime(
+    const std::chrono::steady_clock::time_point &_time)
+{
+  this->dataPtr->sendTime = _time;
+}
+
+//////////////////////////////////////////////////
+std::chrono::system_clock::time_point MessageInfo::SendSystemTime() const
+{
+  return this->dataPtr->sendSystemTime;
+}
+
+//////////////////////////////////////////////////
+void MessageInfo::SetSendSystemTime(
+    const std::chrono::system_clock::time_point &_time)
+{
+  this->dataPtr->sendSystemTime = _time;
+}
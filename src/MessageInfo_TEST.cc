@@ -15,7 +15,10 @@
  *
 */
 
+#include <chrono>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "ignition/transport/MessageInfo.hh"
 #include "gtest/gtest.h"
@@ -111,6 +114,50 @@ TEST(MessageInfoTest, InterProcess)
   EXPECT_FALSE(info.IntraProcess());
 }
 
+//////////////////////////////////////////////////
+/// \brief Check [Set]PublisherAddress() and [Set]ReceptionTime().
+TEST(MessageInfoTest, Publisher)
+{
+  transport::MessageInfo info;
+  EXPECT_TRUE(info.PublisherAddress().empty());
+  EXPECT_EQ(std::chrono::steady_clock::time_point(), info.ReceptionTime());
+
+  const auto now = std::chrono::steady_clock::now();
+  info.SetPublisherAddress("tcp://127.0.0.1:12345");
+  info.SetReceptionTime(now);
+  EXPECT_EQ("tcp://127.0.0.1:12345", info.PublisherAddress());
+  EXPECT_EQ(now, info.ReceptionTime());
+
+  transport::MessageInfo infoCopy(info);
+  EXPECT_EQ("tcp://127.0.0.1:12345", infoCopy.PublisherAddress());
+  EXPECT_EQ(now, infoCopy.ReceptionTime());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the send and reception timestamps.
+TEST(MessageInfoTest, Timestamps)
+{
+  transport::MessageInfo info;
+  EXPECT_EQ(std::chrono::steady_clock::time_point(), info.SendTime());
+  EXPECT_EQ(std::chrono::system_clock::time_point(), info.SendSystemTime());
+  EXPECT_EQ(std::chrono::system_clock::time_point(),
+    info.ReceptionSystemTime());
+
+  const auto steadyNow = std::chrono::steady_clock::now();
+  const auto systemNow = std::chrono::system_clock::now();
+  info.SetSendTime(steadyNow - std::chrono::milliseconds(1));
+  info.SetSendSystemTime(systemNow - std::chrono::milliseconds(1));
+  info.SetReceptionSystemTime(systemNow);
+  EXPECT_EQ(steadyNow - std::chrono::milliseconds(1), info.SendTime());
+  EXPECT_EQ(systemNow - std::chrono::milliseconds(1), info.SendSystemTime());
+  EXPECT_EQ(systemNow, info.ReceptionSystemTime());
+
+  transport::MessageInfo infoCopy(info);
+  EXPECT_EQ(info.SendTime(), infoCopy.SendTime());
+  EXPECT_EQ(info.SendSystemTime(), infoCopy.SendSystemTime());
+  EXPECT_EQ(info.ReceptionSystemTime(), infoCopy.ReceptionSystemTime());
+}
+
 //////////////////////////////////////////////////
 /// \brief Check Copy constructor.
 TEST(MessageInfoTest, CopyConstructor)
@@ -127,6 +174,42 @@ TEST(MessageInfoTest, CopyConstructor)
   EXPECT_TRUE(infoCopy.IntraProcess());
 }
 
+//////////////////////////////////////////////////
+/// \brief The topic and the partition set together can be changed and
+/// read from several threads once set.
+TEST(MessageInfoTest, DeferredTopicAndPartition)
+{
+  transport::MessageInfo info;
+  ASSERT_TRUE(info.SetTopicAndPartition("@/a_partition@/b_topic"));
+  ASSERT_TRUE(info.SetTopicAndPartition("@/c_partition@/d_topic"));
+
+  // A failure keeps the previous names.
+  EXPECT_FALSE(info.SetTopicAndPartition("@/a partition@/b_topic"));
+  EXPECT_FALSE(info.SetTopicAndPartition("@/a_partition@/b//topic"));
+
+  std::vector<std::thread> readers;
+  std::vector<transport::MessageInfo> copies(4, info);
+  for (auto &copy : copies)
+  {
+    readers.emplace_back([&info, &copy]()
+    {
+      EXPECT_EQ("/c_partition", info.Partition());
+      EXPECT_EQ("/d_topic", info.Topic());
+      EXPECT_EQ("/d_topic", copy.Topic());
+    });
+  }
+  for (auto &reader : readers)
+    reader.join();
+
+  // Each name can still be set on its own.
+  info.SetTopic("/e_topic");
+  EXPECT_EQ("/c_partition", info.Partition());
+  EXPECT_EQ("/e_topic", info.Topic());
+  info.SetPartition("/f_partition");
+  EXPECT_EQ("/f_partition", info.Partition());
+  EXPECT_EQ("/e_topic", info.Topic());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "ignition/transport/MessageLoan.hh"
+#include "ignition/transport/TransportTypes.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \internal
+    /// \brief Private data for the MessageLoan class.
+    class MessageLoanPrivate
+    {
+      /// \brief The buffer.
+      public: std::shared_ptr<char[]> buffer;
+
+      /// \brief Size of the buffer (bytes).
+      public: std::size_t capacity = 0;
+
+      /// \brief Size of the message (bytes).
+      public: std::size_t size = 0;
+
+      /// \brief Type of the message, empty for the advertised type.
+      public: std::string type;
+    };
+    }
+  }
+}
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+MessageLoan::MessageLoan()
+  : dataPtr(new MessageLoanPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+MessageLoan::MessageLoan(std::shared_ptr<char[]> _buffer,
+    const std::size_t _capacity)
+  : dataPtr(new MessageLoanPrivate())
+{
+  if (!_buffer)
+    return;
+
+  this->dataPtr->buffer = std::move(_buffer);
+  this->dataPtr->capacity = _capacity;
+  this->dataPtr->size = _capacity;
+}
+
+//////////////////////////////////////////////////
+MessageLoan::MessageLoan(MessageLoan &&_other)
+  : dataPtr(new MessageLoanPrivate())
+{
+  std::swap(this->dataPtr, _other.dataPtr);
+}
+
+//////////////////////////////////////////////////
+MessageLoan &MessageLoan::operator=(MessageLoan &&_other)
+{
+  if (this != &_other)
+  {
+    *this->dataPtr = MessageLoanPrivate();
+    std::swap(this->dataPtr, _other.dataPtr);
+  }
+  return *this;
+}
+
+//////////////////////////////////////////////////
+MessageLoan::~MessageLoan()
+{
+}
+
+//////////////////////////////////////////////////
+bool MessageLoan::Valid() const
+{
+  return this->dataPtr->buffer != nullptr;
+}
+
+//////////////////////////////////////////////////
+char *MessageLoan::Data()
+{
+  return this->dataPtr->buffer.get();
+}
+
+//////////////////////////////////////////////////
+const char *MessageLoan::Data() const
+{
+  return this->dataPtr->buffer.get();
+}
+
+//////////////////////////////////////////////////
+std::size_t MessageLoan::Capacity() const
+{
+  return this->dataPtr->capacity;
+}
+
+//////////////////////////////////////////////////
+std::size_t MessageLoan::Size() const
+{
+  return this->dataPtr->size;
+}
+
+//////////////////////////////////////////////////
+bool MessageLoan::Resize(const std::size_t _size)
+{
+  if (_size > this->dataPtr->capacity)
+    return false;
+
+  this->dataPtr->size = _size;
+  return true;
+}
+
+//////////////////////////////////////////////////
+const std::string &MessageLoan::Type() const
+{
+  return this->dataPtr->type;
+}
+
+//////////////////////////////////////////////////
+void MessageLoan::SetType(const std::string &_type)
+{
+  this->dataPtr->type = _type;
+}
+
+//////////////////////////////////////////////////
+bool MessageLoan::Serialize(const ProtoMsg &_msg)
+{
+  if (!this->Valid())
+    return false;
+
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+  const std::size_t msgSize = static_cast<std::size_t>(_msg.ByteSizeLong());
+#else
+  const std::size_t msgSize = static_cast<std::size_t>(_msg.ByteSize());
+#endif
+
+  if (msgSize > this->dataPtr->capacity)
+  {
+    std::cerr << "MessageLoan::Serialize(): Message of " << msgSize
+              << " bytes exceeds the capacity of the loan ("
+              << this->dataPtr->capacity << " bytes)" << std::endl;
+    return false;
+  }
+
+  if (!_msg.SerializeToArray(this->dataPtr->buffer.get(),
+        static_cast<int>(msgSize)))
+  {
+    std::cerr << "MessageLoan::Serialize(): Error serializing data"
+              << std::endl;
+    return false;
+  }
+
+  this->dataPtr->size = msgSize;
+  this->dataPtr->type = _msg.GetDescriptor()->full_name();
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<const char[]> MessageLoan::Release()
+{
+  std::shared_ptr<const char[]> buffer = std::move(this->dataPtr->buffer);
+  *this->dataPtr = MessageLoanPrivate();
+  return buffer;
+}
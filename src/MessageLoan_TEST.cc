@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <ignition/msgs/int32.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "ignition/transport/MessageLoan.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief A loan gives access to its buffer until it is released.
+TEST(MessageLoanTest, Buffer)
+{
+  MessageLoan invalid;
+  EXPECT_FALSE(invalid.Valid());
+  EXPECT_EQ(nullptr, invalid.Data());
+  EXPECT_EQ(0u, invalid.Capacity());
+  EXPECT_FALSE(invalid.Resize(1));
+
+  std::shared_ptr<char[]> buffer(new char[16]);
+  MessageLoan loan(buffer, 16);
+  EXPECT_TRUE(loan.Valid());
+  EXPECT_EQ(buffer.get(), loan.Data());
+  EXPECT_EQ(16u, loan.Capacity());
+  EXPECT_EQ(16u, loan.Size());
+  EXPECT_TRUE(loan.Type().empty());
+
+  EXPECT_TRUE(loan.Resize(4));
+  EXPECT_EQ(4u, loan.Size());
+  EXPECT_FALSE(loan.Resize(17));
+  EXPECT_EQ(4u, loan.Size());
+
+  // Moving transfers the buffer.
+  MessageLoan moved(std::move(loan));
+  EXPECT_FALSE(loan.Valid());
+  EXPECT_TRUE(moved.Valid());
+  EXPECT_EQ(4u, moved.Size());
+
+  loan = std::move(moved);
+  EXPECT_TRUE(loan.Valid());
+  EXPECT_FALSE(moved.Valid());
+
+  // Releasing leaves the loan invalid.
+  std::shared_ptr<const char[]> released = loan.Release();
+  EXPECT_EQ(buffer.get(), released.get());
+  EXPECT_FALSE(loan.Valid());
+  EXPECT_EQ(0u, loan.Size());
+}
+
+//////////////////////////////////////////////////
+/// \brief A message is serialized in place, if it fits.
+TEST(MessageLoanTest, Serialize)
+{
+  msgs::StringMsg msg;
+  msg.set_data("a message serialized in place");
+  const std::string serialized = msg.SerializeAsString();
+
+  MessageLoan invalid;
+  EXPECT_FALSE(invalid.Serialize(msg));
+
+  MessageLoan small(std::shared_ptr<char[]>(new char[4]), 4);
+  EXPECT_FALSE(small.Serialize(msg));
+  EXPECT_EQ(4u, small.Size());
+
+  MessageLoan loan(std::shared_ptr<char[]>(new char[256]), 256);
+  ASSERT_TRUE(loan.Serialize(msg));
+  EXPECT_EQ(serialized.size(), loan.Size());
+  EXPECT_EQ(serialized, std::string(loan.Data(), loan.Size()));
+  EXPECT_EQ(msg.GetTypeName(), loan.Type());
+
+  loan.SetType(msgs::Int32().GetTypeName());
+  EXPECT_EQ(msgs::Int32().GetTypeName(), loan.Type());
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_METRICS_HH_
+#define IGN_TRANSPORT_METRICS_HH_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class MetricsRegistry Metrics.hh
+    /// \brief A registry of the metrics of the transport internals. Counters
+    /// are registered once and then updated lock free from any thread. The
+    /// values that are already tracked somewhere else, like a queue depth,
+    /// are read by collectors when the metrics are exported. This class is
+    /// thread safe.
+    class MetricsRegistry
+    {
+      /// \brief Number of stripes of a counter.
+      public: static constexpr std::size_t kStripes = 8;
+
+      /// \brief Kind of a metric.
+      public: enum class Type
+      {
+        /// \brief A value that only goes up.
+        COUNTER,
+
+        /// \brief A value that can go up and down.
+        GAUGE
+      };
+
+      /// \brief A monotonic counter. Every thread updates its own stripe, in
+      /// its own cache line, so concurrent updates don't contend.
+      public: class Counter
+      {
+        /// \brief Increase the counter.
+        /// \param[in] _value The increment.
+        public: void Add(const uint64_t _value = 1)
+        {
+          this->stripes[Stripe()].value.fetch_add(_value,
+            std::memory_order_relaxed);
+        }
+
+        /// \brief Get the value of the counter.
+        /// \return The sum of all the stripes.
+        public: uint64_t Value() const
+        {
+          uint64_t value = 0;
+          for (const auto &stripe : this->stripes)
+            value += stripe.value.load(std::memory_order_relaxed);
+          return value;
+        }
+
+        /// \brief Get the stripe of the calling thread.
+        /// \return The stripe index.
+        private: static std::size_t Stripe()
+        {
+          static std::atomic<std::size_t> next{0};
+          thread_local const std::size_t stripe =
+            next.fetch_add(1, std::memory_order_relaxed) % kStripes;
+          return stripe;
+        }
+
+        /// \brief A stripe, padded to a cache line.
+        private: struct alignas(64) Slot
+        {
+          /// \brief The partial value.
+          std::atomic<uint64_t> value{0};
+        };
+
+        /// \brief The stripes.
+        private: std::array<Slot, kStripes> stripes;
+      };
+
+      /// \brief A value of a metric.
+      public: struct Sample
+      {
+        /// \brief Name of the metric.
+        std::string name;
+
+        /// \brief Labels of the value, in the Prometheus format, e.g.
+        /// topic="/foo". Empty if the metric has a single value.
+        std::string labels;
+
+        /// \brief The value.
+        double value = 0;
+      };
+
+      /// \brief A function that appends the current values of some metrics.
+      public: using Collector = std::function<void(std::vector<Sample> &)>;
+
+      /// \brief Describe a metric.
+      /// \param[in] _name Name of the metric.
+      /// \param[in] _type Kind of the metric.
+      /// \param[in] _help Description of the metric.
+      public: void Describe(const std::string &_name, const Type _type,
+                            const std::string &_help)
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->families[_name] = {_type, _help};
+      }
+
+      /// \brief Get a counter, registering it the first time. The reference
+      /// is valid for the lifetime of the registry, so the callers should
+      /// keep it instead of looking the counter up on every update.
+      /// \param[in] _name Name of the metric.
+      /// \param[in] _labels Labels of the counter, see Label().
+      /// \return The counter.
+      public: Counter &GetCounter(const std::string &_name,
+                                  const std::string &_labels = "")
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        auto &counter = this->counters[{_name, _labels}];
+        if (!counter)
+          counter = std::make_unique<Counter>();
+        return *counter;
+      }
+
+      /// \brief Add a collector, called each time that the metrics are
+      /// exported. The collectors run without the registry locked.
+      /// \param[in] _collector The collector.
+      public: void AddCollector(const Collector &_collector)
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        this->collectors.push_back(_collector);
+      }
+
+      /// \brief Get the current values of all the metrics.
+      /// \return The values, sorted by name.
+      public: std::vector<Sample> Collect() const
+      {
+        std::vector<Sample> samples;
+        std::vector<Collector> currentCollectors;
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          for (const auto &counter : this->counters)
+          {
+            samples.push_back({counter.first.first, counter.first.second,
+              static_cast<double>(counter.second->Value())});
+          }
+          currentCollectors = this->collectors;
+        }
+
+        for (const auto &collector : currentCollectors)
+          collector(samples);
+
+        std::stable_sort(samples.begin(), samples.end(),
+          [](const Sample &_a, const Sample &_b)
+          {
+            return _a.name < _b.name;
+          });
+        return samples;
+      }
+
+      /// \brief Get the current values of all the metrics in the Prometheus
+      /// text exposition format.
+      /// \return The metrics.
+      public: std::string PrometheusText() const
+      {
+        const auto samples = this->Collect();
+        std::map<std::string, std::pair<Type, std::string>> currentFamilies;
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          currentFamilies = this->families;
+        }
+
+        std::ostringstream out;
+        std::string last;
+        for (const auto &sample : samples)
+        {
+          if (sample.name != last)
+          {
+            last = sample.name;
+            auto it = currentFamilies.find(sample.name);
+            if (it != currentFamilies.end())
+            {
+              out << "# HELP " << sample.name << " " << it->second.second
+                  << "\n# TYPE " << sample.name << " "
+                  << (it->second.first == Type::COUNTER ? "counter" : "gauge")
+                  << "\n";
+            }
+          }
+
+          out << sample.name;
+          if (!sample.labels.empty())
+            out << "{" << sample.labels << "}";
+          out << " " << sample.value << "\n";
+        }
+        return out.str();
+      }
+
+      /// \brief Format a label, escaping its value.
+      /// \param[in] _name Name of the label.
+      /// \param[in] _value Value of the label.
+      /// \return The label, e.g. topic="/foo".
+      public: static std::string Label(const std::string &_name,
+                                       const std::string &_value)
+      {
+        std::string label = _name + "=\"";
+        for (const char c : _value)
+        {
+          if (c == '\\' || c == '"')
+            label += '\\';
+          if (c == '\n')
+          {
+            label += "\\n";
+            continue;
+          }
+          label += c;
+        }
+        return label + "\"";
+      }
+
+      /// \brief Protects the families, counters and collectors.
+      private: mutable std::mutex mutex;
+
+      /// \brief Kind and description of the metrics, indexed by name.
+      private: std::map<std::string, std::pair<Type, std::string>> families;
+
+      /// \brief Counters, indexed by name and labels.
+      private: std::map<std::pair<std::string, std::string>,
+                        std::unique_ptr<Counter>> counters;
+
+      /// \brief Collectors.
+      private: std::vector<Collector> collectors;
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Metrics.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Counters updated from several threads.
+TEST(MetricsTest, Counter)
+{
+  MetricsRegistry registry;
+  auto &counter = registry.GetCounter("foo_total");
+  EXPECT_EQ(0u, counter.Value());
+
+  // The same counter is returned.
+  EXPECT_EQ(&counter, &registry.GetCounter("foo_total"));
+  EXPECT_NE(&counter, &registry.GetCounter("foo_total", "topic=\"/a\""));
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+  {
+    threads.emplace_back([&counter]()
+    {
+      for (int j = 0; j < 1000; ++j)
+        counter.Add();
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  counter.Add(10);
+  EXPECT_EQ(4010u, counter.Value());
+}
+
+//////////////////////////////////////////////////
+/// \brief Label values are escaped.
+TEST(MetricsTest, Label)
+{
+  EXPECT_EQ("topic=\"/foo\"", MetricsRegistry::Label("topic", "/foo"));
+  EXPECT_EQ("topic=\"a\\\"b\\\\c\\n\"",
+    MetricsRegistry::Label("topic", "a\"b\\c\n"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Export counters and collected values.
+TEST(MetricsTest, PrometheusText)
+{
+  MetricsRegistry registry;
+  registry.Describe("b_total", MetricsRegistry::Type::COUNTER, "Bees.");
+  registry.Describe("a_depth", MetricsRegistry::Type::GAUGE, "Depth.");
+  registry.GetCounter("b_total", MetricsRegistry::Label("topic", "/x")).Add(3);
+
+  int depth = 2;
+  registry.AddCollector(
+    [&depth](std::vector<MetricsRegistry::Sample> &_samples)
+    {
+      _samples.push_back({"a_depth", "", static_cast<double>(depth)});
+    });
+
+  const auto samples = registry.Collect();
+  ASSERT_EQ(2u, samples.size());
+  EXPECT_EQ("a_depth", samples[0].name);
+  EXPECT_DOUBLE_EQ(2.0, samples[0].value);
+  EXPECT_EQ("b_total", samples[1].name);
+  EXPECT_EQ("topic=\"/x\"", samples[1].labels);
+  EXPECT_DOUBLE_EQ(3.0, samples[1].value);
+
+  depth = 5;
+  EXPECT_EQ(
+    "# HELP a_depth Depth.\n"
+    "# TYPE a_depth gauge\n"
+    "a_depth 5\n"
+    "# HELP b_total Bees.\n"
+    "# TYPE b_total counter\n"
+    "b_total{topic=\"/x\"} 3\n", registry.PrometheusText());
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_MPSCQUEUE_HH_
+#define IGN_TRANSPORT_MPSCQUEUE_HH_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class MpscQueue MpscQueue.hh
+    /// \brief A lock-free multi-producer single-consumer FIFO queue. Any
+    /// thread can push elements without taking a lock, and only one thread
+    /// (the consumer) can pop them. Elements pushed by the same producer are
+    /// popped in the same order.
+    ///
+    /// The consumer spins for a while before going to sleep, and producers
+    /// only signal the consumer when it's actually sleeping. When messages
+    /// are published at a high rate the consumer rarely sleeps, so a whole
+    /// burst of pushes costs no system calls, while an idle queue doesn't
+    /// burn CPU.
+    ///
+    /// \tparam T Type of the elements. It must be default constructible and
+    /// movable.
+    template <typename T>
+    class MpscQueue
+    {
+      /// \brief Number of times that the consumer polls the queue before
+      /// yielding the CPU.
+      public: static constexpr int kSpinCount = 64;
+
+      /// \brief Number of times that the consumer yields the CPU before
+      /// going to sleep.
+      public: static constexpr int kYieldCount = 16;
+
+      /// \brief Constructor.
+      public: MpscQueue()
+        : head(new Node()),
+          tail(head.load())
+      {
+      }
+
+      /// \brief Destructor. Destroys the elements still in the queue.
+      public: ~MpscQueue()
+      {
+        while (this->tail)
+        {
+          Node *next = this->tail->next.load();
+          delete this->tail;
+          this->tail = next;
+        }
+      }
+
+      /// \brief No copy constructor.
+      public: MpscQueue(const MpscQueue &) = delete;
+
+      /// \brief No assignment operator.
+      public: MpscQueue &operator=(const MpscQueue &) = delete;
+
+      /// \brief Push an element. Can be called from any thread.
+      /// \param[in] _value The element.
+      public: void Push(T _value)
+      {
+        Node *node = new Node(std::move(_value));
+
+        // Link the node. Between the exchange and the store the consumer
+        // sees the queue as empty, which is fine: the consumer is woken up
+        // below if it decided to go to sleep in the meantime.
+        Node *prev = this->head.exchange(node);
+        prev->next.store(node);
+
+        // Both the store above and this load are sequentially consistent, so
+        // either the consumer sees the new node before sleeping or we see
+        // that the consumer is sleeping.
+        if (this->sleeping.load())
+        {
+          {
+            std::lock_guard<std::mutex> lk(this->mutex);
+          }
+          this->wakeUp.notify_one();
+        }
+      }
+
+      /// \brief Pop the oldest element. Must only be called by the consumer.
+      /// \param[out] _value The element.
+      /// \return True if an element was popped or false if the queue was
+      /// empty.
+      public: bool Pop(T &_value)
+      {
+        Node *next = this->tail->next.load(std::memory_order_acquire);
+        if (!next)
+          return false;
+
+        // The popped node becomes the new dummy node.
+        _value = std::move(next->value);
+        delete this->tail;
+        this->tail = next;
+        return true;
+      }
+
+      /// \brief Block until the queue is not empty, the queue is closed or the
+      /// timeout expires. Must only be called by the consumer.
+      /// \param[in] _timeout Maximum time to sleep.
+      /// \return True if the queue is not empty.
+      public: bool Wait(std::chrono::milliseconds _timeout)
+      {
+        for (int i = 0; i < kSpinCount + kYieldCount; ++i)
+        {
+          if (!this->Empty() || this->closed.load())
+            return !this->Empty();
+
+          if (i >= kSpinCount)
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lk(this->mutex);
+        this->sleeping.store(true);
+        this->wakeUp.wait_for(lk, _timeout,
+          [this]{return !this->Empty() || this->closed.load();});
+        this->sleeping.store(false);
+        return !this->Empty();
+      }
+
+      /// \brief Close the queue, waking up the consumer. Elements can still be
+      /// pushed and popped, but Wait() won't block anymore.
+      public: void Close()
+      {
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          this->closed.store(true);
+        }
+        this->wakeUp.notify_all();
+      }
+
+      /// \brief Check if the queue is empty. Must only be called by the
+      /// consumer.
+      /// \return True if the queue is empty.
+      public: bool Empty() const
+      {
+        return this->tail->next.load() == nullptr;
+      }
+
+      /// \brief A node of the linked list.
+      private: struct Node
+      {
+        /// \brief Default constructor, used for the dummy node.
+        public: Node() = default;
+
+        /// \brief Constructor.
+        /// \param[in] _value The element.
+        public: explicit Node(T &&_value)
+          : value(std::move(_value))
+        {
+        }
+
+        /// \brief The element.
+        public: T value{};
+
+        /// \brief Next node or nullptr.
+        public: std::atomic<Node *> next{nullptr};
+      };
+
+      /// \brief Last node pushed. Shared by the producers.
+      private: std::atomic<Node *> head;
+
+      /// \brief Dummy node preceding the oldest element. Only used by the
+      /// consumer.
+      private: Node *tail;
+
+      /// \brief True while the consumer is sleeping.
+      private: std::atomic<bool> sleeping{false};
+
+      /// \brief True when the queue has been closed.
+      private: std::atomic<bool> closed{false};
+
+      /// \brief Mutex used to sleep.
+      private: std::mutex mutex;
+
+      /// \brief Used to wake up the consumer.
+      private: std::condition_variable wakeUp;
+    };
+    }
+  }
+}
+#endif
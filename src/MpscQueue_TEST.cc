@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MpscQueue.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Push and pop from a single thread.
+TEST(MpscQueueTest, SingleThread)
+{
+  MpscQueue<std::unique_ptr<int>> queue;
+  EXPECT_TRUE(queue.Empty());
+
+  std::unique_ptr<int> value;
+  EXPECT_FALSE(queue.Pop(value));
+
+  for (int i = 0; i < 10; ++i)
+    queue.Push(std::make_unique<int>(i));
+  EXPECT_FALSE(queue.Empty());
+
+  for (int i = 0; i < 10; ++i)
+  {
+    ASSERT_TRUE(queue.Pop(value));
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(i, *value);
+  }
+  EXPECT_TRUE(queue.Empty());
+  EXPECT_FALSE(queue.Pop(value));
+
+  // Elements left in the queue are destroyed with the queue.
+  queue.Push(std::make_unique<int>(10));
+}
+
+//////////////////////////////////////////////////
+/// \brief Elements of each producer are popped in order.
+TEST(MpscQueueTest, MultipleProducers)
+{
+  const int kProducers = 4;
+  const int kElements = 10000;
+
+  MpscQueue<std::pair<int, int>> queue;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p)
+  {
+    producers.emplace_back([&queue, p]()
+    {
+      for (int i = 0; i < kElements; ++i)
+        queue.Push(std::make_pair(p, i));
+    });
+  }
+
+  std::vector<int> next(kProducers, 0);
+  int received = 0;
+  while (received < kProducers * kElements)
+  {
+    if (!queue.Wait(std::chrono::milliseconds(1000)))
+      break;
+
+    std::pair<int, int> value;
+    while (queue.Pop(value))
+    {
+      EXPECT_EQ(next[value.first], value.second);
+      next[value.first] = value.second + 1;
+      ++received;
+    }
+  }
+
+  for (auto &producer : producers)
+    producer.join();
+
+  EXPECT_EQ(kProducers * kElements, received);
+}
+
+//////////////////////////////////////////////////
+/// \brief Wait() times out on an empty queue and returns right away once the
+/// queue is closed.
+TEST(MpscQueueTest, WaitAndClose)
+{
+  MpscQueue<int> queue;
+  EXPECT_FALSE(queue.Wait(std::chrono::milliseconds(10)));
+
+  std::thread producer([&queue]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    queue.Push(1);
+  });
+  EXPECT_TRUE(queue.Wait(std::chrono::milliseconds(5000)));
+  producer.join();
+
+  int value = 0;
+  EXPECT_TRUE(queue.Pop(value));
+  EXPECT_EQ(1, value);
+
+  queue.Close();
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(queue.Wait(std::chrono::milliseconds(5000)));
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+    std::chrono::milliseconds(1000));
+}
@@ -18,6 +18,7 @@
 
 #ifdef _WIN32
   #include <Winsock2.h>
+  #include <Ws2tcpip.h>
   #include <iphlpapi.h>
   #include <windows.h>
   #include <Lmcons.h>
@@ -30,10 +31,15 @@
 #endif
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -61,6 +67,28 @@ namespace transport
 {
 inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
 {
+  /// \brief Maximum time to wait for the resolution of the hostname. A
+  /// misconfigured DNS can block the resolution for seconds, the interface
+  /// search is used instead.
+  static constexpr std::chrono::milliseconds kHostnameResolutionTimeout{500};
+
+  /// \brief Result of a hostname resolution, shared with the thread that
+  /// resolves it, which might outlive the caller on timeout.
+  struct HostnameResolution
+  {
+    /// \brief Protects the rest of the members.
+    public: std::mutex mutex;
+
+    /// \brief Notified when the resolution is done.
+    public: std::condition_variable cv;
+
+    /// \brief Whether the resolution is done.
+    public: bool done = false;
+
+    /// \brief The first IPv4 address of the hostname, empty on error.
+    public: std::string ip;
+  };
+
   /// \brief Get the preferred local IP address.
   /// Note that we don't consider private IP addresses.
   /// \param[out] _ip The preferred local IP address.
@@ -109,39 +137,59 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
   //////////////////////////////////////////////////
   int hostnameToIp(char *_hostname, std::string &_ip)
   {
-    struct hostent *he;
-    struct in_addr **addr_list;
-    int i;
-
-    if ((he = gethostbyname(_hostname)) == nullptr)
-      return 1;
+    // getaddrinfo() doesn't have a timeout, so it runs in its own thread.
+    auto resolution = std::make_shared<HostnameResolution>();
+    std::thread([resolution, hostname = std::string(_hostname)]()
+      {
+        std::string ip;
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo *info = nullptr;
+        if (getaddrinfo(hostname.c_str(), nullptr, &hints, &info) == 0)
+        {
+          // Return the first one.
+          char buffer[INET_ADDRSTRLEN] = {0};
+          if (info && getnameinfo(info->ai_addr,
+                static_cast<socklen_t>(info->ai_addrlen), buffer,
+                sizeof(buffer), nullptr, 0, NI_NUMERICHOST) == 0)
+          {
+            ip = buffer;
+          }
+          freeaddrinfo(info);
+        }
 
-    addr_list = (struct in_addr **) he->h_addr_list;
+        std::lock_guard<std::mutex> lk(resolution->mutex);
+        resolution->ip = ip;
+        resolution->done = true;
+        resolution->cv.notify_all();
+      }).detach();
 
-    for (i = 0; addr_list[i] != nullptr; ++i)
+    std::unique_lock<std::mutex> lk(resolution->mutex);
+    if (!resolution->cv.wait_for(lk, kHostnameResolutionTimeout,
+          [&resolution]{return resolution->done;}) ||
+        resolution->ip.empty())
     {
-      // Return the first one;
-      _ip = std::string(inet_ntoa(*addr_list[i]));
-      return 0;
+      return 1;
     }
 
-    return 1;
+    _ip = resolution->ip;
+    return 0;
   }
 
   //////////////////////////////////////////////////
-  std::string determineHost()
+  /// \brief Find the IP address of this host, without IGN_IP.
+  /// \return The preferred public IP address, or the first IP address of
+  /// the interfaces, public ones first.
+  static std::string findHost()
   {
-    // First, did the user set IGN_IP?
-    std::string ignIp;
-    if (env("IGN_IP", ignIp) && !ignIp.empty())
-      return ignIp;
-
-    // Second, try the preferred local and public IP address.
+    // First, try the preferred local and public IP address.
     std::string hostIP;
     if (preferredPublicIP(hostIP))
       return hostIP;
 
-    // Third, fall back on interface search, which will yield an IP address
+    // Second, fall back on interface search, which will yield an IP address
     auto interfaces = determineInterfaces();
     for (const auto &ip : interfaces)
     {
@@ -154,7 +202,23 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
   }
 
   //////////////////////////////////////////////////
-  std::vector<std::string> determineInterfaces()
+  std::string determineHost()
+  {
+    // First, did the user set IGN_IP?
+    std::string ignIp;
+    if (env("IGN_IP", ignIp) && !ignIp.empty())
+      return ignIp;
+
+    // The search is done once per process, every node and discovery
+    // instance shares its result.
+    static const std::string host = findHost();
+    return host;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Search the network interfaces of this machine.
+  /// \return The list of network interfaces.
+  static std::vector<std::string> findInterfaces()
   {
 #ifdef HAVE_IFADDRS
     std::vector<std::string> result;
@@ -351,6 +415,14 @@ inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
 #endif
   }
 
+  //////////////////////////////////////////////////
+  std::vector<std::string> determineInterfaces()
+  {
+    // The interfaces are searched once per process.
+    static const std::vector<std::string> interfaces = findInterfaces();
+    return interfaces;
+  }
+
   //////////////////////////////////////////////////
   std::string hostname()
   {
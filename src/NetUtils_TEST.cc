@@ -15,6 +15,8 @@
  *
 */
 
+#include <string>
+
 #include "ignition/transport/NetUtils.hh"
 #include "gtest/gtest.h"
 
@@ -34,6 +36,32 @@ TEST(NetUtilsTest, username)
   EXPECT_TRUE(!transport::username().empty());
 }
 
+//////////////////////////////////////////////////
+/// \brief Check the hostnameToIp() function.
+TEST(NetUtilsTest, hostnameToIp)
+{
+  std::string ip;
+  char localhost[] = "localhost";
+  EXPECT_EQ(0, transport::hostnameToIp(localhost, ip));
+  EXPECT_EQ(0u, ip.compare(0, 4, "127."));
+
+  char invalid[] = "invalid..host..name";
+  EXPECT_NE(0, transport::hostnameToIp(invalid, ip));
+}
+
+//////////////////////////////////////////////////
+/// \brief The host and the interfaces are determined once per process.
+TEST(NetUtilsTest, determineHostAndInterfaces)
+{
+  const auto interfaces = transport::determineInterfaces();
+  EXPECT_FALSE(interfaces.empty());
+  EXPECT_EQ(interfaces, transport::determineInterfaces());
+
+  const std::string host = transport::determineHost();
+  EXPECT_FALSE(host.empty());
+  EXPECT_EQ(host, transport::determineHost());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -18,7 +18,9 @@
 #include <ignition/msgs/statistic.pb.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <csignal>
 #include <condition_variable>
 #include <iostream>
@@ -38,8 +40,12 @@
 #include "ignition/transport/TransportTypes.hh"
 #include "ignition/transport/Uuid.hh"
 
+#include "CopyCounters.hh"
+#include "MessageCompression.hh"
 #include "NodePrivate.hh"
 #include "NodeSharedPrivate.hh"
+#include "RealtimeQueue.hh"
+#include "Tracing.hh"
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4503)
@@ -78,6 +84,32 @@ namespace ignition
       }
     }
 
+    //////////////////////////////////////////////////
+    /// \brief Get the fully qualified name of a prefix of topics.
+    /// \param[in] _options Options of the node.
+    /// \param[in] _prefix The prefix. "/" stands for all the topics of the
+    /// partition.
+    /// \param[out] _name The fully qualified prefix.
+    /// \return False if the prefix is not valid.
+    static bool qualifyPrefix(const NodeOptions &_options,
+        const std::string &_prefix, std::string &_name)
+    {
+      if (_prefix != "/")
+      {
+        return TopicUtils::FullyQualifiedName(_options.Partition(),
+          _options.NameSpace(), _prefix, _name);
+      }
+
+      // The name of any absolute topic, without the topic.
+      if (!TopicUtils::FullyQualifiedName(_options.Partition(), "", "/_",
+            _name))
+      {
+        return false;
+      }
+      _name.pop_back();
+      return true;
+    }
+
     //////////////////////////////////////////////////
     int rcvHwm()
     {
@@ -90,6 +122,24 @@ namespace ignition
       return NodeShared::Instance()->SndHwm();
     }
 
+    //////////////////////////////////////////////////
+    NodeShared::SocketStatistics socketStats()
+    {
+      return NodeShared::Instance()->SocketStats();
+    }
+
+    //////////////////////////////////////////////////
+    bool spinOnce(const std::chrono::milliseconds &_timeout)
+    {
+      return NodeShared::Instance()->SpinOnce(_timeout);
+    }
+
+    //////////////////////////////////////////////////
+    std::vector<int> spinDescriptors()
+    {
+      return NodeShared::Instance()->SpinDescriptors();
+    }
+
     //////////////////////////////////////////////////
     void waitForShutdown()
     {
@@ -115,7 +165,8 @@ namespace ignition
       /// \brief Constructor
       /// \param[in] _publisher The message publisher.
       public: explicit PublisherPrivate(const MessagePublisher &_publisher)
-        : shared(NodeShared::Instance()),
+        : shared(NodeSharedPrivate::InstanceByProcessUuid(
+            _publisher.PUuid())),
           publisher(_publisher)
       {
       }
@@ -167,7 +218,49 @@ namespace ignition
       /// \brief Destructor.
       public: virtual ~PublisherPrivate()
       {
+        // Publish the messages left in the real-time queue and stop its
+        // thread, which uses this object.
+        this->realtime.reset();
+
         std::lock_guard<std::recursive_mutex> lk(this->shared->mutex);
+        this->shared->dataPtr->RemovePublisherFrames(this->id);
+        if (!this->publisher.Options().MulticastGroup().empty())
+        {
+          this->shared->dataPtr->RemoveMulticastTopic(
+            this->publisher.Topic());
+        }
+        if (this->publisher.Options().BestEffort())
+        {
+          this->shared->dataPtr->RemoveBestEffortTopic(
+            this->publisher.Topic());
+        }
+        if (this->publisher.Options().TrafficClass() !=
+              TrafficClass_t::DEFAULT)
+        {
+          this->shared->dataPtr->RemoveLaneTopic(this->publisher.Topic());
+        }
+        if (this->publisher.Options().FragmentSize() != 0)
+        {
+          this->shared->dataPtr->RemoveFragmentTopic(
+            this->publisher.Topic());
+        }
+        if (this->publisher.Options().Compression() != Compression_t::NONE)
+        {
+          this->shared->dataPtr->RemoveCompressedTopic(
+            this->publisher.Topic());
+        }
+        if (this->publisher.Options().Latched())
+        {
+          auto &latchedTopics = this->shared->dataPtr->latchedTopics;
+          auto topicIt = latchedTopics.find(this->publisher.Topic());
+          if (topicIt != latchedTopics.end())
+          {
+            topicIt->second.msgs.erase(this->id);
+            if (--topicIt->second.publishers <= 0)
+              latchedTopics.erase(topicIt);
+          }
+        }
+
         // Notify the discovery service to unregister and unadvertise my topic.
         if (!this->shared->dataPtr->msgDiscovery->Unadvertise(
                this->publisher.Topic(), this->publisher.NUuid()))
@@ -175,6 +268,13 @@ namespace ignition
           std::cerr << "~PublisherPrivate() Error unadvertising topic ["
                     << this->publisher.Topic() << "]" << std::endl;
         }
+
+        // The discovery doesn't report the topics of this process.
+        if (!this->publisher.Topic().empty())
+        {
+          this->shared->dataPtr->NotifyDiscoveryChange(
+            DiscoveryChange_t::REMOVED, this->publisher);
+        }
       }
 
       /// \brief Create a MessageInfo object for this Publisher
@@ -191,6 +291,316 @@ namespace ignition
         return info;
       }
 
+      /// \brief Queue a message for the local and raw subscribers.
+      /// \param[in] _subscribers The current subscribers.
+      /// \param[in] _msg The message.
+      /// \param[in] _owned Optional ownership of _msg. When set, it is handed
+      /// to the local subscribers instead of a copy of _msg.
+      /// \param[in] _msgBuffer The serialized message, if available.
+      /// \param[in] _msgSize Size of the serialized message.
+      public: void PublishLocal(
+        const std::shared_ptr<const NodeShared::SubscriberInfo> &_subscribers,
+        const ProtoMsg &_msg,
+        std::unique_ptr<ProtoMsg> _owned,
+        const std::shared_ptr<char[]> &_msgBuffer,
+        const std::size_t _msgSize)
+      {
+        IGN_TRANSPORT_COUNT_ALLOCATION(
+          sizeof(NodeSharedPrivate::PublishMsgDetails));
+        std::unique_ptr<NodeSharedPrivate::PublishMsgDetails> pubMsgDetails(
+          new NodeSharedPrivate::PublishMsgDetails);
+        pubMsgDetails->traceId = currentTraceId();
+
+        // Populate the message information object.
+        pubMsgDetails->info.SetTopicAndPartition(this->publisher.Topic());
+        pubMsgDetails->info.SetType(this->publisher.MsgTypeName());
+        pubMsgDetails->info.SetIntraProcess(true);
+        // Sent and received at once.
+        const auto now = std::chrono::steady_clock::now();
+        const auto systemNow = std::chrono::system_clock::now();
+        pubMsgDetails->info.SetReceptionTime(now);
+        pubMsgDetails->info.SetSendTime(now);
+        pubMsgDetails->info.SetReceptionSystemTime(systemNow);
+        pubMsgDetails->info.SetSendSystemTime(systemNow);
+
+        // The handlers that accept the message, sorted by delivery.
+        const std::shared_ptr<const FanOut> fanOut =
+          this->CurrentFanOut(_subscribers, _msg);
+
+        // Handlers that run in this thread, see
+        // SubscribeOptions::SetInlineDelivery.
+        std::vector<ISubscriptionHandlerPtr> inlineHandlers;
+        std::vector<RawSubscriptionHandlerPtr> inlineRawHandlers;
+
+        // The throttled handlers skip the message before it's copied.
+        auto select = [&fanOut](const auto &_from, auto &_to)
+        {
+          if (!fanOut->throttled)
+          {
+            _to = _from;
+            return;
+          }
+          for (const auto &handler : _from)
+          {
+            if (handler->ThrottledUpdateReady())
+              _to.push_back(handler);
+          }
+        };
+        select(fanOut->localHandlers, pubMsgDetails->localHandlers);
+        select(fanOut->inlineHandlers, inlineHandlers);
+        select(fanOut->rawHandlers, pubMsgDetails->rawHandlers);
+        select(fanOut->inlineRawHandlers, inlineRawHandlers);
+
+        // Share the serialized data with the raw handlers, no copy is
+        // needed.
+        if (!pubMsgDetails->rawHandlers.empty() || !inlineRawHandlers.empty())
+        {
+          pubMsgDetails->msgSize = _msgSize;
+          pubMsgDetails->sharedBuffer = _msgBuffer;
+        }
+
+        pubMsgDetails->published = NodeSharedPrivate::TraceNow();
+
+        // The inline handlers run now, in this thread, with the message of
+        // the publisher itself.
+        if (!inlineHandlers.empty() || !inlineRawHandlers.empty())
+        {
+          // The message filters need the serialized message.
+          if (fanOut->inlineFiltered && !pubMsgDetails->sharedBuffer)
+            this->shared->dataPtr->SerializeDetails(*pubMsgDetails, _msg);
+
+          for (auto &handler : inlineHandlers)
+          {
+            NodeSharedPrivate::RunLocalHandler(*handler, *pubMsgDetails,
+              _msg);
+          }
+          for (auto &handler : inlineRawHandlers)
+            NodeSharedPrivate::RunRawHandler(*handler, *pubMsgDetails);
+        }
+
+        if (pubMsgDetails->localHandlers.empty() &&
+            pubMsgDetails->rawHandlers.empty())
+        {
+          return;
+        }
+
+        // Reserve room for the message in the local queue, if it's bounded.
+        if (this->localQueue &&
+            !this->localQueue->Reserve(this->shared->dataPtr->exit,
+              this->shared->dataPtr->manualSpin))
+        {
+          return;
+        }
+        pubMsgDetails->queueState = this->localQueue;
+
+        // Only the typed subscribers need the message itself, the raw ones
+        // share the serialized data. Hand it over if we own it, otherwise
+        // make a copy.
+        if (!pubMsgDetails->localHandlers.empty())
+        {
+          if (_owned)
+          {
+            pubMsgDetails->msgCopy = std::move(_owned);
+          }
+          else
+          {
+            IGN_TRANSPORT_COUNT_ALLOCATION(_msg.ByteSizeLong());
+            IGN_TRANSPORT_COUNT_COPY(_msg.ByteSizeLong());
+            pubMsgDetails->msgCopy.reset(_msg.New());
+            pubMsgDetails->msgCopy->CopyFrom(_msg);
+          }
+        }
+
+        // Add the publish message details to the publish queue. The message
+        // will be published asynchronously to the local and raw callbacks.
+        // Note that _msg must not be used after this point, since it might be
+        // owned by the details.
+        if (this->localQueue)
+          this->localQueue->Track(pubMsgDetails.get());
+        this->shared->dataPtr->localQueued->Add();
+        this->shared->dataPtr->pubQueue.Push(std::move(pubMsgDetails));
+
+        // Make the descriptors of an application that spins readable.
+        if (this->shared->dataPtr->manualSpin)
+          this->shared->dataPtr->WakeUpReception();
+      }
+
+      /// \brief Local and raw handlers of a subscriber snapshot that accept
+      /// the messages of a descriptor, sorted by delivery.
+      public: struct FanOut
+      {
+        /// \brief The snapshot, which identifies the set of subscribers.
+        public: std::shared_ptr<const NodeShared::SubscriberInfo> subscribers;
+
+        /// \brief Descriptor of the messages.
+        public: const google::protobuf::Descriptor *descriptor = nullptr;
+
+        /// \brief Local handlers that run in the publish thread or the
+        /// executors.
+        public: std::vector<ISubscriptionHandlerPtr> localHandlers;
+
+        /// \brief Local handlers that run in the publishing thread.
+        public: std::vector<ISubscriptionHandlerPtr> inlineHandlers;
+
+        /// \brief Raw handlers that run in the publish thread or the
+        /// executors.
+        public: std::vector<RawSubscriptionHandlerPtr> rawHandlers;
+
+        /// \brief Raw handlers that run in the publishing thread.
+        public: std::vector<RawSubscriptionHandlerPtr> inlineRawHandlers;
+
+        /// \brief Whether any handler is throttled.
+        public: bool throttled = false;
+
+        /// \brief Whether any inline local handler has a message filter.
+        public: bool inlineFiltered = false;
+      };
+
+      /// \brief Get the handlers that accept a message. They are only
+      /// gathered again when the subscribers of the topic change, which
+      /// gives a new snapshot, or when the messages have another
+      /// descriptor, e.g. dynamic messages.
+      /// \param[in] _subscribers The current subscribers.
+      /// \param[in] _msg The message.
+      /// \return The handlers. Never null.
+      public: std::shared_ptr<const FanOut> CurrentFanOut(
+        const std::shared_ptr<const NodeShared::SubscriberInfo> &_subscribers,
+        const ProtoMsg &_msg)
+      {
+        const google::protobuf::Descriptor *descriptor = _msg.GetDescriptor();
+        std::shared_ptr<const FanOut> current = std::atomic_load(&this->fanOut);
+        if (current && current->subscribers == _subscribers &&
+            current->descriptor == descriptor)
+        {
+          return current;
+        }
+
+        auto next = std::make_shared<FanOut>();
+        next->subscribers = _subscribers;
+        next->descriptor = descriptor;
+        for (const auto &node : _subscribers->localHandlers)
+        {
+          for (const auto &handler : node.second)
+          {
+            if (!handler.second)
+            {
+              std::cerr << "Node::Publisher::Publish(): "
+                        << "NULL local subscription handler" << std::endl;
+              continue;
+            }
+
+            if (!handler.second->Accepts(_msg))
+              continue;
+
+            next->throttled |= handler.second->MsgsPerSec() != kUnthrottled;
+            if (handler.second->Inline())
+            {
+              next->inlineHandlers.push_back(handler.second);
+              next->inlineFiltered |= handler.second->HasFilter();
+            }
+            else
+            {
+              next->localHandlers.push_back(handler.second);
+            }
+          }
+        }
+
+        for (const auto &node : _subscribers->rawHandlers)
+        {
+          for (const auto &handler : node.second)
+          {
+            if (!handler.second)
+            {
+              std::cerr << "Node::Publisher::Publish(): "
+                        << "NULL raw subscription handler" << std::endl;
+              continue;
+            }
+
+            if (!handler.second->Accepts(_msg))
+              continue;
+
+            next->throttled |= handler.second->MsgsPerSec() != kUnthrottled;
+            if (handler.second->Inline())
+              next->inlineRawHandlers.push_back(handler.second);
+            else
+              next->rawHandlers.push_back(handler.second);
+          }
+        }
+
+        current = next;
+        std::atomic_store(&this->fanOut, current);
+        return current;
+      }
+
+      /// \brief Write a message in the real-time queue, without allocating,
+      /// locking or printing.
+      /// \param[in] _size Size of the serialized message (bytes).
+      /// \param[in] _msgType Name of the message type.
+      /// \param[in] _write Callable that writes the message in a slot.
+      /// \return True if the message was queued.
+      public: template<typename WriteT>
+              bool PublishRealtime(const std::size_t _size,
+                                   const std::string &_msgType,
+                                   WriteT &&_write)
+      {
+        if (_msgType != this->publisher.MsgTypeName())
+        {
+          this->realtime->CountFailure();
+          return false;
+        }
+        return this->realtime->Push(_size, std::forward<WriteT>(_write));
+      }
+
+      /// \brief Copy a serialized message in the real-time queue.
+      /// \param[in] _msgData The serialized message.
+      /// \param[in] _size Size of the serialized message (bytes).
+      /// \param[in] _msgType Name of the message type.
+      /// \return True if the message was queued.
+      public: bool PublishRealtimeRaw(const char *_msgData,
+                                      const std::size_t _size,
+                                      const std::string &_msgType)
+      {
+        if (!_msgData && _size > 0)
+        {
+          this->realtime->CountFailure();
+          return false;
+        }
+        return this->PublishRealtime(_size, _msgType,
+          [_msgData, _size](char *_slot)
+          {
+            if (_size > 0)
+              memcpy(_slot, _msgData, _size);
+            return true;
+          });
+      }
+
+      /// \brief Keep the last message of a latched publisher, so it can be
+      /// delivered to the subscribers that come later. NodeShared::mutex must
+      /// be held since the remote publication of the message.
+      /// \param[in] _buffer The serialized message.
+      /// \param[in] _size Size of the serialized message.
+      /// \param[in] _msgType Type of the message.
+      /// \param[in] _sent Whether the message was sent to remote
+      /// subscribers, which gave it the current sequence number.
+      public: void Latch(std::shared_ptr<const char[]> _buffer,
+                         const std::size_t _size,
+                         const std::string &_msgType,
+                         const bool _sent)
+      {
+        // The late subscribers must not drop the message as a duplicate of
+        // the previous one.
+        if (!_sent)
+          ++this->seq;
+
+        NodeSharedPrivate::LatchedMsg &msg =
+          this->shared->dataPtr->latchedTopics[
+            this->publisher.Topic()].msgs[this->id];
+        msg.buffer = std::move(_buffer);
+        msg.size = _size;
+        msg.msgType = _msgType;
+        msg.seq = this->seq;
+      }
+
       /// \brief Pointer to the object shared between all the nodes within the
       /// same process.
       public: NodeShared *shared = nullptr;
@@ -207,6 +617,34 @@ namespace ignition
 
       /// \brief Mutex to protect the node::publisher from race conditions.
       public: mutable std::mutex mutex;
+
+      /// \brief Bounded queue of messages pending local delivery or nullptr
+      /// if the local queue depth is unlimited.
+      public: std::shared_ptr<NodeSharedPrivate::LocalQueueState> localQueue;
+
+      /// \brief Queue of the messages published from a real-time thread, or
+      /// nullptr if the publisher doesn't have one.
+      /// \sa AdvertiseMessageOptions::SetRealtimeQueue
+      public: std::unique_ptr<RealtimeQueue> realtime;
+
+      /// \brief Id of the publisher, unique in the process.
+      public: const uint64_t id = NextId();
+
+      /// \brief Sequence number of the last message sent to the remote
+      /// subscribers. Protected by NodeShared::mutex.
+      public: uint64_t seq = 0;
+
+      /// \brief Handlers of the last local publication, see CurrentFanOut().
+      /// Accessed with std::atomic_load() and std::atomic_store().
+      public: std::shared_ptr<const FanOut> fanOut;
+
+      /// \brief Get a new publisher id.
+      /// \return The id.
+      private: static uint64_t NextId()
+      {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+      }
     };
     }
   }
@@ -227,6 +665,37 @@ Node::Publisher::Publisher(const MessagePublisher &_publisher)
     this->dataPtr->periodNs =
       1e9 / this->dataPtr->publisher.Options().MsgsPerSec();
   }
+
+  const AdvertiseMessageOptions &opts = this->dataPtr->publisher.Options();
+  if (opts.LocalQueueDepth() != 0)
+  {
+    this->dataPtr->localQueue =
+      std::make_shared<NodeSharedPrivate::LocalQueueState>(
+        opts.LocalQueueDepth(), opts.OverflowPolicy());
+  }
+
+  if (opts.RealtimeSlots() != 0)
+  {
+    // The queue is destroyed before the rest of the private data, so its
+    // thread publishes without owning it.
+    PublisherPrivate *priv = this->dataPtr.get();
+    this->dataPtr->realtime = std::make_unique<RealtimeQueue>(
+      static_cast<std::size_t>(opts.RealtimeSlots()),
+      static_cast<std::size_t>(opts.RealtimeSlotSize()),
+      [priv](const char *_data, const std::size_t _size)
+      {
+        Publisher pub(std::shared_ptr<PublisherPrivate>(
+          std::shared_ptr<PublisherPrivate>(), priv));
+        pub.PublishRawHelper(_data, _size, priv->publisher.MsgTypeName(),
+          nullptr);
+      });
+  }
+}
+
+//////////////////////////////////////////////////
+Node::Publisher::Publisher(std::shared_ptr<PublisherPrivate> _dataPtr)
+  : dataPtr(std::move(_dataPtr))
+{
 }
 
 //////////////////////////////////////////////////
@@ -271,16 +740,148 @@ bool Node::Publisher::HasConnections() const
      this->dataPtr->shared->remoteSubscribers.HasTopic(topic, msgType));
 }
 
+//////////////////////////////////////////////////
+uint64_t Node::Publisher::DroppedLocalMessages() const
+{
+  if (!this->dataPtr->localQueue)
+    return 0;
+  return this->dataPtr->localQueue->dropped;
+}
+
+//////////////////////////////////////////////////
+uint64_t Node::Publisher::DroppedRealtimeMessages() const
+{
+  if (!this->dataPtr->realtime)
+    return 0;
+  return this->dataPtr->realtime->Dropped();
+}
+
+//////////////////////////////////////////////////
+uint64_t Node::Publisher::FailedRealtimeMessages() const
+{
+  if (!this->dataPtr->realtime)
+    return 0;
+  return this->dataPtr->realtime->Failed();
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::Realtime() const
+{
+  return this->dataPtr->realtime != nullptr;
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishRealtime(const std::size_t _size,
+    bool (*_write)(const void *_msg, char *_data, const std::size_t _size),
+    const void *_msg, const std::string &_msgType)
+{
+  return this->dataPtr->PublishRealtime(_size, _msgType,
+    [_write, _msg, _size](char *_slot)
+    {
+      return _write(_msg, _slot, _size);
+    });
+}
+
 //////////////////////////////////////////////////
 bool Node::Publisher::Publish(const ProtoMsg &_msg)
 {
+  return this->PublishHelper(_msg, nullptr);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::Publish(std::unique_ptr<ProtoMsg> _msg)
+{
+  if (!_msg)
+  {
+    std::cerr << "Node::Publisher::Publish() NULL message" << std::endl;
+    return false;
+  }
+
+  const ProtoMsg &msg = *_msg;
+  return this->PublishHelper(msg, std::move(_msg));
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::Publish(ProtoMsg &&_msg)
+{
+  // The real-time queue serializes the message, no need to allocate another
+  // one.
+  if (this->dataPtr->realtime)
+    return this->PublishHelper(_msg, nullptr);
+
+  // Steal the content of the message. Swap() only exchanges the internal
+  // pointers of the fields, so no deep copy is done.
+  std::unique_ptr<ProtoMsg> owned(_msg.New());
+  owned->GetReflection()->Swap(owned.get(), &_msg);
+  return this->Publish(std::move(owned));
+}
+
+//////////////////////////////////////////////////
+std::future<bool> Node::Publisher::PublishAsync(
+    std::unique_ptr<ProtoMsg> _msg, std::function<void(const bool)> _done)
+{
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> result = promise->get_future();
+
+  if (!_msg || !this->Valid())
+  {
+    if (!_msg)
+      std::cerr << "Node::Publisher::PublishAsync() NULL message" << std::endl;
+    promise->set_value(false);
+    if (_done)
+      _done(false);
+    return result;
+  }
+
+  // The task keeps the publisher alive, so the messages published before
+  // destroying it are still sent. The key keeps them in order.
+  Publisher self(this->dataPtr);
+  this->dataPtr->shared->dataPtr->PublishExecutor().Post(
+    "pub_" + std::to_string(this->dataPtr->id),
+    [self, promise, done = std::move(_done),
+     holder = std::make_shared<std::unique_ptr<ProtoMsg>>(std::move(_msg))]()
+    mutable
+    {
+      std::unique_ptr<ProtoMsg> owned = std::move(*holder);
+      const ProtoMsg &msg = *owned;
+      const bool ok = self.PublishHelper(msg, std::move(owned));
+      promise->set_value(ok);
+      if (done)
+        done(ok);
+    });
+  return result;
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishHelper(const ProtoMsg &_msg,
+    std::unique_ptr<ProtoMsg> _owned, const bool _typeChecked)
+{
+  // From a real-time thread, the message is only serialized into a slot of
+  // the queue, and published by the transport thread.
+  if (this->dataPtr->realtime)
+  {
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+    const std::size_t size = static_cast<std::size_t>(_msg.ByteSizeLong());
+#else
+    const std::size_t size = static_cast<std::size_t>(_msg.ByteSize());
+#endif
+    const std::string &msgType = _typeChecked ?
+      this->dataPtr->publisher.MsgTypeName() :
+      _msg.GetDescriptor()->full_name();
+    return this->dataPtr->PublishRealtime(size, msgType,
+      [&_msg, size](char *_slot)
+      {
+        return _msg.SerializeToArray(_slot, static_cast<int>(size));
+      });
+  }
+
   if (!this->Valid())
     return false;
 
   const std::string &publisherMsgType = this->dataPtr->publisher.MsgTypeName();
 
   // Check that the msg type matches the topic type previously advertised.
-  if (publisherMsgType != _msg.GetTypeName())
+  if (!_typeChecked && publisherMsgType != _msg.GetDescriptor()->full_name())
   {
     std::cerr << "Node::Publisher::Publish() Type mismatch.\n"
               << "\t* Type advertised: "
@@ -295,9 +896,10 @@ bool Node::Publisher::Publish(const ProtoMsg &_msg)
 
   const std::string &publisherTopic = this->dataPtr->publisher.Topic();
 
-  const NodeShared::SubscriberInfo &subscribers =
-      this->dataPtr->shared->CheckSubscriberInfo(
+  // Lock-free lookup of the current subscribers.
+  const auto subscribersPtr = this->dataPtr->shared->SubscriberSnapshot(
         publisherTopic, publisherMsgType);
+  const NodeShared::SubscriberInfo &subscribers = *subscribersPtr;
 
   // The serialized message size and buffer.
 #if GOOGLE_PROTOBUF_VERSION >= 3004000
@@ -305,193 +907,405 @@ bool Node::Publisher::Publish(const ProtoMsg &_msg)
 #else
   const std::size_t msgSize = static_cast<std::size_t>(_msg.ByteSize());
 #endif
-  char *msgBuffer = nullptr;
+
+  // The id follows the message down to the local and remote publications.
+  TraceIdScope traceScope(nextTraceId());
+  IGN_TRANSPORT_TRACEPOINT(publish, publisherTopic.c_str(), currentTraceId(),
+    msgSize);
+
+  // The message is serialized only once into this reference counted buffer,
+  // which is shared by the raw subscribers and the remote publication.
+  std::shared_ptr<char[]> msgBuffer;
 
   // Only serialize the message if we have a raw subscriber or a remote
-  // subscriber.
-  if (subscribers.haveRaw || subscribers.haveRemote)
+  // subscriber, or if it must be kept for the late subscribers.
+  const bool latched = this->dataPtr->publisher.Options().Latched();
+  if (subscribers.haveRaw || subscribers.haveRemote || latched)
   {
-    // Allocate the buffer to store the serialized data.
-    msgBuffer = static_cast<char *>(new char[msgSize]);
+    // Get a buffer to store the serialized data.
+    msgBuffer = this->dataPtr->shared->dataPtr->bufferPool->Acquire(msgSize);
 
     // Fail out early if we are unable to serialize the message. We do not
     // want to send a corrupt/bad message to some subscribers and not others.
-    if (!_msg.SerializeToArray(msgBuffer, msgSize))
+    if (!_msg.SerializeToArray(msgBuffer.get(), static_cast<int>(msgSize)))
     {
-      delete[] msgBuffer;
       std::cerr << "Node::Publisher::Publish(): Error serializing data"
                 << std::endl;
       return false;
     }
+    IGN_TRANSPORT_COUNT_COPY(msgSize);
   }
 
-  // Local and raw subscribers.
+  // Local and raw subscribers. Note that _msg must not be used after this
+  // point, since it might be owned by the local publication.
   if (subscribers.haveLocal || subscribers.haveRaw)
   {
-    std::unique_ptr<NodeSharedPrivate::PublishMsgDetails> pubMsgDetails(
-      new NodeSharedPrivate::PublishMsgDetails);
-
-    // Create and populate the message information object.
-    // This must be a shared pointer so that we can pass it to
-    // multiple threads below, and then allow this function to go
-    // out of scope.
-    pubMsgDetails->info.SetTopicAndPartition(this->dataPtr->publisher.Topic());
-    pubMsgDetails->info.SetType(this->dataPtr->publisher.MsgTypeName());
-    pubMsgDetails->info.SetIntraProcess(true);
-
-    pubMsgDetails->msgCopy.reset(_msg.New());
-    pubMsgDetails->msgCopy->CopyFrom(_msg);
-
-    if (subscribers.haveLocal)
-    {
-      for (const std::pair<std::string, ISubscriptionHandler_M> &node :
-           subscribers.localHandlers)
-      {
-        for (const std::pair<std::string, ISubscriptionHandlerPtr> &handler :
-             node.second)
-        {
-          if (!handler.second)
-          {
-            std::cerr << "Node::Publisher::Publish(): "
-                      << "NULL local subscription handler" << std::endl;
-            continue;
-          }
-
-          if (handler.second->TypeName() != kGenericMessageType &&
-              handler.second->TypeName() != _msg.GetTypeName())
-          {
-            continue;
-          }
-
-          pubMsgDetails->localHandlers.push_back(handler.second);
-        }
-      }
-    }
-
-    if (subscribers.haveRaw)
-    {
-      for (auto &node : subscribers.rawHandlers)
-      {
-        for (auto &handler : node.second)
-        {
-          const RawSubscriptionHandlerPtr &rawHandler = handler.second;
-
-          if (!rawHandler)
-          {
-            std::cerr << "Node::Publisher::Publish(): "
-                      << "NULL raw subscription handler" << std::endl;
-            continue;
-          }
-
-          if (rawHandler->TypeName() != kGenericMessageType &&
-              rawHandler->TypeName() != _msg.GetTypeName())
-          {
-            continue;
-          }
-
-          if (!pubMsgDetails->sharedBuffer)
-          {
-            pubMsgDetails->msgSize = msgSize;
-            // If the sharedBuffer has not been created, do so now.
-            pubMsgDetails->sharedBuffer.reset(new char[msgSize]);
-            memcpy(pubMsgDetails->sharedBuffer.get(), msgBuffer, msgSize);
-          }
-          pubMsgDetails->rawHandlers.push_back(rawHandler);
-        }
-      }
-    }
-
-    // Add the publish message details to the publish queue. The message
-    // will be published asynchronously to the local and raw callbacks.
-    {
-      std::unique_lock<std::mutex> queueLock(
-          this->dataPtr->shared->dataPtr->pubThreadMutex);
-      this->dataPtr->shared->dataPtr->pubQueue.push(std::move(pubMsgDetails));
-    }
-
-    this->dataPtr->shared->dataPtr->signalNewPub.notify_one();
+    this->dataPtr->PublishLocal(subscribersPtr, _msg, std::move(_owned),
+      msgBuffer, msgSize);
   }
 
+  // The latched message and its sequence number are updated together.
+  std::unique_lock<std::recursive_mutex> lk(this->dataPtr->shared->mutex,
+    std::defer_lock);
+  if (latched)
+    lk.lock();
+
   // Handle remote subscribers.
   if (subscribers.haveRemote)
   {
     // Zmq will call this lambda when the message is published.
-    // We use it to deallocate the buffer.
-    auto myDeallocator = [](void *_buffer, void *)
+    // We use it to release our reference to the shared buffer, which is
+    // passed as the hint.
+    auto myDeallocator = [](void *, void *_hint)
     {
-      delete[] reinterpret_cast<char*>(_buffer);
+      delete static_cast<std::shared_ptr<char[]> *>(_hint);
     };
 
+    // Publish() releases the hint on every path, even if it fails.
+    auto hint = std::make_unique<std::shared_ptr<char[]>>(msgBuffer);
     if (!this->dataPtr->shared->Publish(this->dataPtr->publisher.Topic(),
-          msgBuffer, msgSize, myDeallocator, _msg.GetTypeName()))
+          msgBuffer.get(), msgSize, myDeallocator, publisherMsgType,
+          hint.release(), this->dataPtr->id, this->dataPtr->seq))
     {
       return false;
     }
   }
-  else
+
+  if (latched)
   {
-    delete[] msgBuffer;
+    this->dataPtr->Latch(std::move(msgBuffer), msgSize, publisherMsgType,
+      subscribers.haveRemote);
   }
 
   return true;
 }
 
 //////////////////////////////////////////////////
-bool Node::Publisher::PublishRaw(
-    const std::string &_msgData,
-    const std::string &_msgType)
+bool Node::Publisher::PublishBatch(const std::vector<const ProtoMsg *> &_msgs)
 {
-  if (!this->dataPtr->Valid())
+  if (!this->Valid())
     return false;
 
   const std::string &publisherMsgType = this->dataPtr->publisher.MsgTypeName();
 
-  if (publisherMsgType  != _msgType && publisherMsgType != kGenericMessageType)
+  // Validate the whole batch before publishing anything.
+  for (const ProtoMsg *msg : _msgs)
   {
-    std::cerr << "Node::Publisher::PublishRaw() type mismatch.\n"
-              << "\t* Type advertised: "
-              << this->dataPtr->publisher.MsgTypeName()
-              << "\n\t* Type published: " << _msgType << std::endl;
-    return false;
+    if (!msg)
+    {
+      std::cerr << "Node::Publisher::PublishBatch() NULL message" << std::endl;
+      return false;
+    }
+
+    if (publisherMsgType != msg->GetDescriptor()->full_name())
+    {
+      std::cerr << "Node::Publisher::PublishBatch() Type mismatch.\n"
+                << "\t* Type advertised: " << publisherMsgType
+                << "\n\t* Type published: " << msg->GetTypeName()
+                << std::endl;
+      return false;
+    }
   }
 
-  if (!this->dataPtr->UpdateThrottling())
+  if (_msgs.empty())
     return true;
 
-  const std::string &topic = this->dataPtr->publisher.Topic();
-
-  const NodeShared::SubscriberInfo &subscribers =
-      this->dataPtr->shared->CheckSubscriberInfo(topic, _msgType);
-
-  MessageInfo info;
-  info.SetTopicAndPartition(topic);
-  info.SetType(_msgType);
-  info.SetIntraProcess(true);
+  // The batch is throttled as a whole.
+  if (!this->UpdateThrottling())
+    return true;
 
-  // Trigger local subscribers.
-  this->dataPtr->shared->TriggerCallbacks(info, _msgData, subscribers);
+  const std::string &publisherTopic = this->dataPtr->publisher.Topic();
 
-  // Remote subscribers. Note that the data is already presumed to be
-  // serialized, so we just pass it along for publication.
-  if (subscribers.haveRemote)
+  const auto subscribersPtr = this->dataPtr->shared->SubscriberSnapshot(
+        publisherTopic, publisherMsgType);
+  const NodeShared::SubscriberInfo &subscribers = *subscribersPtr;
+
+  // Serialize all the messages into a single buffer. Each message gets a
+  // slice of the buffer, which stays alive while any slice is in use.
+  std::vector<std::size_t> offsets;
+  std::vector<std::size_t> sizes;
+  std::shared_ptr<char[]> batchBuffer;
+  const bool latched = this->dataPtr->publisher.Options().Latched();
+  if (subscribers.haveRaw || subscribers.haveRemote || latched)
   {
-    const std::size_t msgSize = _msgData.size();
-    char *msgBuffer = static_cast<char *>(new char[msgSize]);
-    memcpy(msgBuffer, _msgData.c_str(), msgSize);
-    auto myDeallocator = [](void *_buffer, void * /*_hint*/)
+    offsets.reserve(_msgs.size());
+    sizes.reserve(_msgs.size());
+    std::size_t totalSize = 0;
+    for (const ProtoMsg *msg : _msgs)
     {
-      delete[] reinterpret_cast<char*>(_buffer);
-    };
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+      const std::size_t msgSize = static_cast<std::size_t>(msg->ByteSizeLong());
+#else
+      const std::size_t msgSize = static_cast<std::size_t>(msg->ByteSize());
+#endif
+      offsets.push_back(totalSize);
+      sizes.push_back(msgSize);
+      totalSize += msgSize;
+    }
 
-    // Note: This will copy _msgData (i.e. not zero copy)
+    batchBuffer = this->dataPtr->shared->dataPtr->bufferPool->Acquire(
+      totalSize);
+
+    for (std::size_t i = 0; i < _msgs.size(); ++i)
+    {
+      if (!_msgs[i]->SerializeToArray(batchBuffer.get() + offsets[i],
+            static_cast<int>(sizes[i])))
+      {
+        std::cerr << "Node::Publisher::PublishBatch(): Error serializing data"
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+
+  // Consecutive ids for the messages of the batch.
+  const uint64_t firstTraceId = nextTraceId(_msgs.size());
+  for (std::size_t i = 0; i < _msgs.size(); ++i)
+  {
+    IGN_TRANSPORT_TRACEPOINT(publish, publisherTopic.c_str(),
+      firstTraceId + i, sizes.empty() ? 0 : sizes[i]);
+  }
+
+  // Local and raw subscribers.
+  if (subscribers.haveLocal || subscribers.haveRaw)
+  {
+    for (std::size_t i = 0; i < _msgs.size(); ++i)
+    {
+      TraceIdScope traceScope(firstTraceId + i);
+      std::shared_ptr<char[]> slice;
+      std::size_t msgSize = 0;
+      if (batchBuffer)
+      {
+        slice = std::shared_ptr<char[]>(batchBuffer,
+          batchBuffer.get() + offsets[i]);
+        msgSize = sizes[i];
+      }
+      this->dataPtr->PublishLocal(subscribersPtr, *_msgs[i], nullptr, slice,
+        msgSize);
+    }
+  }
+
+  // Remote subscribers. The lock is taken once for the whole batch, so the
+  // messages are sent back to back.
+  if (subscribers.haveRemote)
+  {
+    auto myDeallocator = [](void *, void *_hint)
+    {
+      delete static_cast<std::shared_ptr<char[]> *>(_hint);
+    };
+
+    std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+    for (std::size_t i = 0; i < _msgs.size(); ++i)
+    {
+      TraceIdScope traceScope(firstTraceId + i);
+      char *data = batchBuffer.get() + offsets[i];
+      auto hint = std::make_unique<std::shared_ptr<char[]>>(batchBuffer,
+        data);
+      if (!this->dataPtr->shared->Publish(publisherTopic, data, sizes[i],
+            myDeallocator, publisherMsgType, hint.release(),
+            this->dataPtr->id, this->dataPtr->seq))
+      {
+        return false;
+      }
+    }
+  }
+
+  // Only the last message of the batch is kept.
+  if (latched)
+  {
+    std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+    const std::size_t last = _msgs.size() - 1;
+    this->dataPtr->Latch(std::shared_ptr<char[]>(batchBuffer,
+      batchBuffer.get() + offsets[last]), sizes[last], publisherMsgType,
+      subscribers.haveRemote);
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishRaw(
+    const std::string &_msgData,
+    const std::string &_msgType)
+{
+  if (this->dataPtr->realtime)
+  {
+    return this->dataPtr->PublishRealtimeRaw(_msgData.data(),
+      _msgData.size(), _msgType);
+  }
+
+  return this->PublishRawHelper(_msgData.data(), _msgData.size(), _msgType,
+    nullptr);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishRaw(
+    const void *_msgData,
+    const std::size_t _size,
+    const std::string &_msgType)
+{
+  if (this->dataPtr->realtime)
+  {
+    return this->dataPtr->PublishRealtimeRaw(
+      static_cast<const char *>(_msgData), _size, _msgType);
+  }
+
+  return this->PublishRawHelper(static_cast<const char *>(_msgData), _size,
+    _msgType, nullptr);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishRaw(
+    const std::shared_ptr<const char[]> &_msgData,
+    const std::size_t _size,
+    const std::string &_msgType)
+{
+  if (this->dataPtr->realtime)
+  {
+    return this->dataPtr->PublishRealtimeRaw(_msgData.get(), _size,
+      _msgType);
+  }
+
+  return this->PublishRawHelper(_msgData.get(), _size, _msgType, _msgData);
+}
+
+//////////////////////////////////////////////////
+MessageLoan Node::Publisher::Loan(const std::size_t _size)
+{
+  if (!this->Valid())
+    return MessageLoan();
+
+  return MessageLoan(
+    this->dataPtr->shared->dataPtr->bufferPool->Acquire(_size), _size);
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::Publish(MessageLoan &&_loan)
+{
+  if (!_loan.Valid())
+  {
+    std::cerr << "Node::Publisher::Publish() Invalid loan" << std::endl;
+    return false;
+  }
+
+  const std::string msgType = _loan.Type().empty() ?
+    this->dataPtr->publisher.MsgTypeName() : _loan.Type();
+  const std::size_t size = _loan.Size();
+  std::shared_ptr<const char[]> buffer = _loan.Release();
+  const char *data = buffer.get();
+
+  // The loan is copied into the real-time queue.
+  if (this->dataPtr->realtime)
+    return this->dataPtr->PublishRealtimeRaw(data, size, msgType);
+
+  return this->PublishRawHelper(data, size, msgType, std::move(buffer));
+}
+
+//////////////////////////////////////////////////
+bool Node::Publisher::PublishRawHelper(
+    const char *_msgData,
+    const std::size_t _size,
+    const std::string &_msgType,
+    std::shared_ptr<const char[]> _buffer)
+{
+  if (!this->dataPtr->Valid())
+    return false;
+
+  if (!_msgData && _size > 0)
+  {
+    std::cerr << "Node::Publisher::PublishRaw() NULL data" << std::endl;
+    return false;
+  }
+
+  const std::string &publisherMsgType = this->dataPtr->publisher.MsgTypeName();
+
+  if (publisherMsgType  != _msgType && publisherMsgType != kGenericMessageType)
+  {
+    std::cerr << "Node::Publisher::PublishRaw() type mismatch.\n"
+              << "\t* Type advertised: "
+              << this->dataPtr->publisher.MsgTypeName()
+              << "\n\t* Type published: " << _msgType << std::endl;
+    return false;
+  }
+
+  if (!this->dataPtr->UpdateThrottling())
+    return true;
+
+  const std::string &topic = this->dataPtr->publisher.Topic();
+
+  const auto subscribersPtr =
+      this->dataPtr->shared->SubscriberSnapshot(topic, _msgType);
+  const NodeShared::SubscriberInfo &subscribers = *subscribersPtr;
+
+  TraceIdScope traceScope(nextTraceId());
+  IGN_TRANSPORT_TRACEPOINT(publish, topic.c_str(), currentTraceId(), _size);
+
+  MessageInfo info;
+  info.SetTopicAndPartition(topic);
+  info.SetType(_msgType);
+  info.SetIntraProcess(true);
+
+  // Sent and received at once.
+  const auto now = std::chrono::steady_clock::now();
+  const auto systemNow = std::chrono::system_clock::now();
+  info.SetReceptionTime(now);
+  info.SetSendTime(now);
+  info.SetReceptionSystemTime(systemNow);
+  info.SetSendSystemTime(systemNow);
+
+  // Trigger local subscribers.
+  this->dataPtr->shared->TriggerCallbacks(info, _msgData, _size, subscribers);
+
+  // The latched message and its sequence number are updated together.
+  const bool latched = this->dataPtr->publisher.Options().Latched();
+  std::unique_lock<std::recursive_mutex> lk(this->dataPtr->shared->mutex,
+    std::defer_lock);
+  if (latched)
+    lk.lock();
+
+  // Remote subscribers. Note that the data is already presumed to be
+  // serialized, so we just pass it along for publication.
+  if (subscribers.haveRemote || latched)
+  {
+    // Without a shared buffer, the data is copied (i.e. not zero copy).
+    if (!_buffer)
+    {
+      std::shared_ptr<char[]> copy =
+        this->dataPtr->shared->dataPtr->bufferPool->Acquire(_size);
+      if (_size > 0)
+        memcpy(copy.get(), _msgData, _size);
+      IGN_TRANSPORT_COUNT_COPY(_size);
+      _buffer = std::move(copy);
+    }
+  }
+
+  if (subscribers.haveRemote)
+  {
+    // Zmq will call this lambda when the message is published, to release
+    // our reference to the buffer, which is passed as the hint.
+    auto myDeallocator = [](void *, void *_hint)
+    {
+      delete static_cast<std::shared_ptr<const char[]> *>(_hint);
+    };
+
+    // ZMQ only reads the data.
+    char *data = const_cast<char *>(_buffer.get());
+    auto hint = std::make_unique<std::shared_ptr<const char[]>>(_buffer);
     if (!this->dataPtr->shared->Publish(
           this->dataPtr->publisher.Topic(),
-          msgBuffer, msgSize, myDeallocator, _msgType))
+          data, _size, myDeallocator, _msgType, hint.release(),
+          this->dataPtr->id, this->dataPtr->seq))
     {
       return false;
     }
   }
 
+  if (latched)
+  {
+    this->dataPtr->Latch(std::move(_buffer), _size, _msgType,
+      subscribers.haveRemote);
+  }
+
   return true;
 }
 
@@ -509,40 +1323,92 @@ bool Node::Publisher::UpdateThrottling()
 
 //////////////////////////////////////////////////
 Node::Node(const NodeOptions &_options)
-  : dataPtr(new NodePrivate())
+  : dataPtr(new NodePrivate(_options))
 {
   // Generate the node UUID.
   Uuid uuid;
   this->dataPtr->nUuid = uuid.ToString();
 
-  // Save the options.
-  this->dataPtr->options = _options;
+  // The discovery ignores the processes of other partitions.
+  this->dataPtr->shared->AddPartition(this->Options().Partition());
 }
 
 //////////////////////////////////////////////////
 Node::~Node()
 {
-  // Unsubscribe from all the topics.
-  auto subsTopics = this->SubscribedTopics();
-  for (auto const &topic : subsTopics)
-    this->Unsubscribe(topic);
+  // The statistics callbacks publish through this node.
+  for (const std::string &topic : this->dataPtr->statsTopics)
+    this->dataPtr->shared->EnableStats(topic, false, nullptr);
+
+  // The discovery callbacks may capture this node. They are removed
+  // without holding discoveryCbsMutex, since removing waits for them.
+  std::unordered_set<uint64_t> discoveryCbs;
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->discoveryCbsMutex);
+    discoveryCbs.swap(this->dataPtr->discoveryCbs);
+  }
+  for (const uint64_t id : discoveryCbs)
+    this->dataPtr->shared->RemoveDiscoveryCb(id);
+
+  // A node that never subscribed or advertised a service has nothing to
+  // notify.
+  if (this->dataPtr->topicsSubscribed.empty() &&
+      this->dataPtr->prefixesSubscribed.empty() &&
+      this->dataPtr->srvsAdvertised.empty())
+  {
+    return;
+  }
 
-  // The list of subscribed topics should be empty.
-  assert(this->SubscribedTopics().empty());
+  // The discovery messages of all the topics and services are collected
+  // and sent together, packed in as few datagrams as possible.
+  std::vector<MessagePublisher> unregistrations;
+  std::vector<std::string> services;
+  {
+    std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+
+    // Unsubscribe from all the topics.
+    const std::vector<std::string> subsTopics(
+      this->dataPtr->topicsSubscribed.begin(),
+      this->dataPtr->topicsSubscribed.end());
+    for (auto const &topic : subsTopics)
+      this->dataPtr->UnsubscribeHelper(topic, unregistrations);
+
+    // The list of subscribed topics should be empty.
+    assert(this->dataPtr->topicsSubscribed.empty());
+
+    // Unsubscribe from all the prefixes.
+    for (auto const &prefix : this->dataPtr->prefixesSubscribed)
+    {
+      this->dataPtr->shared->RemovePrefixSubscription(prefix,
+        this->dataPtr->nUuid);
+    }
+    this->dataPtr->prefixesSubscribed.clear();
+  }
 
-  // Unadvertise all my services.
-  auto advServices = this->AdvertisedServices();
-  for (auto const &service : advServices)
   {
-    if (!this->UnadvertiseSrv(service))
+    std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->srvMutex);
+
+    // Remove the REP handlers of all my services.
+    services.assign(this->dataPtr->srvsAdvertised.begin(),
+      this->dataPtr->srvsAdvertised.end());
+    for (auto const &service : services)
     {
-      std::cerr << "Node::~Node(): Error unadvertising service ["
-                << service << "]" << std::endl;
+      this->dataPtr->shared->repliers.RemoveHandlersForNode(
+        service, this->dataPtr->nUuid);
+      this->dataPtr->shared->dataPtr->replyCache.Clear(service);
     }
+    this->dataPtr->srvsAdvertised.clear();
   }
 
-  // The list of advertised services should be empty.
-  assert(this->AdvertisedServices().empty());
+  this->dataPtr->shared->dataPtr->msgDiscovery->Unregister(unregistrations);
+
+  // Unadvertise all my services.
+  if (!services.empty() &&
+      !this->dataPtr->shared->dataPtr->srvDiscovery->Unadvertise(
+        services, this->dataPtr->nUuid))
+  {
+    std::cerr << "Node::~Node(): Error unadvertising services" << std::endl;
+  }
 }
 
 //////////////////////////////////////////////////
@@ -609,44 +1475,12 @@ bool Node::Unsubscribe(const std::string &_topic)
 
   std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
 
-  // Remove the subscribers for the given topic that belong to this node.
-  this->dataPtr->shared->localSubscribers.RemoveHandlersForNode(
-        fullyQualifiedTopic, this->dataPtr->nUuid);
-
-  // Remove the topic from the list of subscribed topics in this node.
-  this->dataPtr->topicsSubscribed.erase(fullyQualifiedTopic);
-
-  // Remove the filter for this topic if I am the last subscriber.
-  if (!this->dataPtr->shared->localSubscribers
-      .HasSubscriber(fullyQualifiedTopic))
-  {
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->dataPtr->shared->dataPtr->subscriber->set(
-      zmq::sockopt::unsubscribe, fullyQualifiedTopic);
-#else
-    this->dataPtr->shared->dataPtr->subscriber->setsockopt(
-      ZMQ_UNSUBSCRIBE, fullyQualifiedTopic.data(), fullyQualifiedTopic.size());
-#endif
-  }
-
-  // Notify to the publishers that I am no longer interested in the topic.
-  MsgAddresses_M addresses;
-  if (!this->dataPtr->shared->dataPtr->msgDiscovery->Publishers(
-        fullyQualifiedTopic, addresses))
-  {
+  std::vector<MessagePublisher> unregistrations;
+  if (!this->dataPtr->UnsubscribeHelper(fullyQualifiedTopic, unregistrations))
     return false;
-  }
-
-  for (auto &proc : addresses)
-  {
-    std::string dstPUuid = proc.first;
-    MessagePublisher pub(fullyQualifiedTopic, this->dataPtr->shared->myAddress,
-      dstPUuid, this->dataPtr->shared->pUuid, this->dataPtr->nUuid,
-      kGenericMessageType, AdvertiseMessageOptions());
-
-    this->Shared()->dataPtr->msgDiscovery->Unregister(pub);
-  }
 
+  // Notify to the publishers that I am no longer interested in the topic.
+  this->Shared()->dataPtr->msgDiscovery->Unregister(unregistrations);
   return true;
 }
 
@@ -655,7 +1489,7 @@ std::vector<std::string> Node::AdvertisedServices() const
 {
   std::vector<std::string> v;
 
-  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->srvMutex);
 
   for (auto service : this->dataPtr->srvsAdvertised)
   {
@@ -682,7 +1516,7 @@ bool Node::UnadvertiseSrv(const std::string &_topic)
     return false;
   }
 
-  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->srvMutex);
 
   // Remove the topic from the list of advertised topics in this node.
   this->dataPtr->srvsAdvertised.erase(fullyQualifiedTopic);
@@ -690,9 +1524,12 @@ bool Node::UnadvertiseSrv(const std::string &_topic)
   // Remove all the REP handlers for this node.
   this->dataPtr->shared->repliers.RemoveHandlersForNode(
     fullyQualifiedTopic, this->dataPtr->nUuid);
+  this->dataPtr->shared->dataPtr->replyCache.Clear(fullyQualifiedTopic);
 
   // Notify the discovery service to unregister and unadvertise my services.
-  if (!this->dataPtr->shared->dataPtr->srvDiscovery->Unadvertise(
+  // Nothing was advertised if the services were never used.
+  if (this->dataPtr->shared->dataPtr->servicesInitialized &&
+      !this->dataPtr->shared->dataPtr->srvDiscovery->Unadvertise(
         fullyQualifiedTopic, this->dataPtr->nUuid))
   {
     return false;
@@ -703,11 +1540,20 @@ bool Node::UnadvertiseSrv(const std::string &_topic)
 
 //////////////////////////////////////////////////
 void Node::TopicList(std::vector<std::string> &_topics) const
+{
+  this->TopicList(_topics, std::chrono::milliseconds(2 *
+    this->dataPtr->shared->dataPtr->msgDiscovery->HeartbeatInterval()));
+}
+
+//////////////////////////////////////////////////
+void Node::TopicList(std::vector<std::string> &_topics,
+    const std::chrono::milliseconds &_timeout) const
 {
   std::vector<std::string> allTopics;
   _topics.clear();
 
-  this->dataPtr->shared->dataPtr->msgDiscovery->TopicList(allTopics);
+  this->dataPtr->shared->dataPtr->msgDiscovery->TopicList(allTopics,
+    _timeout);
 
   for (const auto &fullyQualifiedTopic : allTopics)
   {
@@ -730,11 +1576,28 @@ void Node::TopicList(std::vector<std::string> &_topics) const
 
 //////////////////////////////////////////////////
 void Node::ServiceList(std::vector<std::string> &_services) const
+{
+  _services.clear();
+  if (!this->dataPtr->shared->InitializeServices())
+    return;
+
+  this->ServiceList(_services, std::chrono::milliseconds(2 *
+    this->dataPtr->shared->dataPtr->srvDiscovery->HeartbeatInterval()));
+}
+
+//////////////////////////////////////////////////
+void Node::ServiceList(std::vector<std::string> &_services,
+    const std::chrono::milliseconds &_timeout) const
 {
   std::vector<std::string> allServices;
   _services.clear();
 
-  this->dataPtr->shared->dataPtr->srvDiscovery->TopicList(allServices);
+  // Listing the services needs their discovery.
+  if (!this->dataPtr->shared->InitializeServices())
+    return;
+
+  this->dataPtr->shared->dataPtr->srvDiscovery->TopicList(allServices,
+    _timeout);
 
   for (auto &service : allServices)
   {
@@ -762,18 +1625,22 @@ bool Node::SubscribeRaw(
     const std::string &_msgType,
     const SubscribeOptions &_opts)
 {
-  // Topic remapping.
-  std::string topic = _topic;
-  this->Options().TopicRemap(_topic, topic);
+  return this->SubscribeRaw(this->Resolve(_topic), _callback, _msgType, _opts);
+}
 
-  std::string fullyQualifiedTopic;
-  if (!TopicUtils::FullyQualifiedName(this->dataPtr->options.Partition(),
-                                      this->dataPtr->options.NameSpace(),
-                                      _topic, fullyQualifiedTopic))
+//////////////////////////////////////////////////
+bool Node::SubscribeRaw(
+    const TopicName &_topic,
+    const RawCallback &_callback,
+    const std::string &_msgType,
+    const SubscribeOptions &_opts)
+{
+  if (!_topic.Valid())
   {
-    std::cerr << "Topic [" << _topic << "] is not valid." << std::endl;
+    std::cerr << "Topic [" << _topic.Topic() << "] is not valid." << std::endl;
     return false;
   }
+  const std::string &fullyQualifiedTopic = _topic.FullyQualifiedName();
 
   const std::shared_ptr<RawSubscriptionHandler> handlerPtr =
       std::make_shared<RawSubscriptionHandler>(
@@ -786,7 +1653,85 @@ bool Node::SubscribeRaw(
   this->dataPtr->shared->localSubscribers.raw.AddHandler(
         fullyQualifiedTopic, this->dataPtr->nUuid, handlerPtr);
 
-  return this->dataPtr->SubscribeHelper(fullyQualifiedTopic);
+  if (!this->dataPtr->SubscribeHelper(fullyQualifiedTopic))
+    return false;
+
+  // Hand over the last messages of the latched publishers of this process.
+  this->dataPtr->shared->DeliverLatched(fullyQualifiedTopic, handlerPtr);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Node::SubscribeRawPrefix(
+    const std::string &_prefix,
+    const RawCallback &_callback,
+    const SubscribeOptions &_opts)
+{
+  std::string fullyQualifiedPrefix;
+  if (!qualifyPrefix(this->Options(), _prefix, fullyQualifiedPrefix))
+  {
+    std::cerr << "Prefix [" << _prefix << "] is not valid." << std::endl;
+    return false;
+  }
+
+  const std::shared_ptr<RawSubscriptionHandler> handlerPtr =
+      std::make_shared<RawSubscriptionHandler>(
+        this->dataPtr->nUuid, kGenericMessageType, _opts);
+
+  handlerPtr->SetCallback(_callback);
+
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+
+  this->dataPtr->shared->AddPrefixSubscription(fullyQualifiedPrefix,
+    this->dataPtr->nUuid, handlerPtr);
+  this->dataPtr->prefixesSubscribed.insert(fullyQualifiedPrefix);
+
+  // The topics already known are attached as their publishers are reported.
+  if (!this->dataPtr->shared->dataPtr->msgDiscovery->DiscoverPrefix(
+        fullyQualifiedPrefix))
+  {
+    std::cerr << "Node::SubscribeRawPrefix(): Error discovering prefix ["
+              << fullyQualifiedPrefix
+              << "]. Did you forget to start the discovery service?"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> Node::SubscribedPrefixes() const
+{
+  std::vector<std::string> v;
+
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+
+  for (auto prefix : this->dataPtr->prefixesSubscribed)
+  {
+    // Remove the partition information from the prefix.
+    prefix.erase(0, prefix.find_last_of("@") + 1);
+    v.push_back(prefix);
+  }
+
+  return v;
+}
+
+//////////////////////////////////////////////////
+bool Node::UnsubscribePrefix(const std::string &_prefix)
+{
+  std::string fullyQualifiedPrefix;
+  if (!qualifyPrefix(this->Options(), _prefix, fullyQualifiedPrefix))
+  {
+    std::cerr << "Prefix [" << _prefix << "] is not valid." << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+
+  this->dataPtr->prefixesSubscribed.erase(fullyQualifiedPrefix);
+  return this->dataPtr->shared->RemovePrefixSubscription(
+    fullyQualifiedPrefix, this->dataPtr->nUuid);
 }
 
 //////////////////////////////////////////////////
@@ -795,6 +1740,67 @@ const NodeOptions &Node::Options() const
   return this->dataPtr->options;
 }
 
+//////////////////////////////////////////////////
+uint64_t Node::SubscribeDiscovery(const DiscoveryChangeCallback &_callback,
+    const bool _replay)
+{
+  // The fully qualified names of the partition start with this prefix.
+  std::string prefix;
+  TopicUtils::FullyQualifiedName(this->Options().Partition(), "", "/p",
+    prefix);
+  prefix.resize(prefix.size() - 2);
+
+  const uint64_t id = this->dataPtr->shared->AddDiscoveryCb(
+    [prefix, _callback](const DiscoveryChange_t _change,
+                        const MessagePublisher &_pub)
+    {
+      if (_change == DiscoveryChange_t::PROCESS_REMOVED ||
+          _pub.Topic().compare(0, prefix.size(), prefix) == 0)
+      {
+        _callback(_change, _pub);
+      }
+    }, _replay);
+
+  std::lock_guard<std::mutex> lk(this->dataPtr->discoveryCbsMutex);
+  this->dataPtr->discoveryCbs.insert(id);
+  return id;
+}
+
+//////////////////////////////////////////////////
+bool Node::UnsubscribeDiscovery(const uint64_t _id)
+{
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->discoveryCbsMutex);
+    if (this->dataPtr->discoveryCbs.erase(_id) == 0)
+      return false;
+  }
+
+  this->dataPtr->shared->RemoveDiscoveryCb(_id);
+  return true;
+}
+
+//////////////////////////////////////////////////
+TopicName Node::Resolve(const std::string &_topic) const
+{
+  std::lock_guard<std::mutex> lk(this->dataPtr->resolvedMutex);
+  auto it = this->dataPtr->resolved.find(_topic);
+  if (it != this->dataPtr->resolved.end())
+    return it->second;
+
+  // Topic remapping.
+  std::string topic = _topic;
+  this->Options().TopicRemap(_topic, topic);
+
+  TopicName name(this->Options().Partition(), this->Options().NameSpace(),
+    topic);
+
+  // A node that makes up names on the fly doesn't grow without bounds.
+  if (this->dataPtr->resolved.size() >= NodePrivate::kMaxResolvedNames)
+    this->dataPtr->resolved.clear();
+  this->dataPtr->resolved.emplace(_topic, name);
+  return name;
+}
+
 //////////////////////////////////////////////////
 std::optional<TopicStatistics> Node::TopicStats(
     const std::string &_topic) const
@@ -813,6 +1819,49 @@ std::optional<TopicStatistics> Node::TopicStats(
   return this->dataPtr->shared->TopicStats(fullyQualifiedTopic);
 }
 
+//////////////////////////////////////////////////
+uint64_t Node::DroppedMsgCount(const std::string &_topic) const
+{
+  std::string fullyQualifiedTopic;
+  std::string topic = _topic;
+  this->Options().TopicRemap(_topic, topic);
+
+  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
+    this->Options().NameSpace(), topic, fullyQualifiedTopic))
+  {
+    return 0;
+  }
+
+  uint64_t dropped = 0;
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+
+  std::map<std::string, ISubscriptionHandler_M> handlers;
+  if (this->dataPtr->shared->localSubscribers.normal.Handlers(
+        fullyQualifiedTopic, handlers))
+  {
+    auto it = handlers.find(this->dataPtr->nUuid);
+    if (it != handlers.end())
+    {
+      for (const auto &handler : it->second)
+        dropped += handler.second->DroppedMsgCount();
+    }
+  }
+
+  std::map<std::string, RawSubscriptionHandler_M> rawHandlers;
+  if (this->dataPtr->shared->localSubscribers.raw.Handlers(
+        fullyQualifiedTopic, rawHandlers))
+  {
+    auto it = rawHandlers.find(this->dataPtr->nUuid);
+    if (it != rawHandlers.end())
+    {
+      for (const auto &handler : it->second)
+        dropped += handler.second->DroppedMsgCount();
+    }
+  }
+
+  return dropped;
+}
+
 //////////////////////////////////////////////////
 bool Node::EnableStats(const std::string &_topic, bool _enable,
     const std::string &_publicationTopic, uint64_t _publicationRate)
@@ -827,26 +1876,35 @@ bool Node::EnableStats(const std::string &_topic, bool _enable,
     return false;
   }
 
-  AdvertiseMessageOptions opts;
-  opts.SetMsgsPerSec(_publicationRate);
+  if (!_enable)
+  {
+    this->dataPtr->shared->EnableStats(fullyQualifiedTopic, false, nullptr);
+    this->dataPtr->statsTopics.erase(fullyQualifiedTopic);
+    return true;
+  }
+
+  // The callback is paced by NodeShared, so the publisher isn't throttled.
   this->dataPtr->statPub = this->Advertise(_publicationTopic,
-      "ignition.msgs.Metric", opts);
+      "ignition.msgs.Metric");
 
   // Callback used to publish a statistics message.
   // cppcheck-suppress unreadVariable
   std::function<void(const TopicStatistics &_stats)> statCb =
     [=](const TopicStatistics &_stats) mutable
     {
-      if (this->dataPtr->statPub.ThrottledUpdateReady())
-      {
-        msgs::Metric msg;
-        _stats.FillMessage(msg);
-        this->dataPtr->statPub.Publish(msg);
-      }
+      msgs::Metric msg;
+      _stats.FillMessage(msg);
+      this->dataPtr->statPub.Publish(msg);
     };
 
-  this->dataPtr->shared->EnableStats(fullyQualifiedTopic, _enable,
-      statCb);
+  // The statistics are aggregated, and published at the publication rate
+  // by a thread of NodeShared instead of once per message.
+  const std::chrono::nanoseconds period(_publicationRate == 0 ?
+    std::nano::den :
+    std::nano::den / std::min<uint64_t>(_publicationRate, std::nano::den));
+  this->dataPtr->shared->EnableStats(fullyQualifiedTopic, true, statCb,
+      period);
+  this->dataPtr->statsTopics.insert(fullyQualifiedTopic);
 
   return true;
 }
@@ -869,6 +1927,82 @@ std::unordered_set<std::string> &Node::TopicsSubscribed() const
   return this->dataPtr->topicsSubscribed;
 }
 
+//////////////////////////////////////////////////
+void Node::WaitForDiscovery(const std::chrono::milliseconds &_timeout) const
+{
+  // Both discoveries sent their requests when they started, so they are
+  // answered concurrently.
+  const auto start = std::chrono::steady_clock::now();
+  this->dataPtr->shared->dataPtr->msgDiscovery->WaitForSnapshot(_timeout);
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start);
+  // The services are discovered once they are used.
+  if (this->dataPtr->shared->dataPtr->servicesInitialized)
+  {
+    this->dataPtr->shared->dataPtr->srvDiscovery->WaitForSnapshot(
+      std::max(std::chrono::milliseconds::zero(), _timeout - elapsed));
+  }
+}
+
+//////////////////////////////////////////////////
+bool Node::WaitForPublishers(const std::string &_topic,
+    const std::size_t _count, const std::chrono::milliseconds &_timeout) const
+{
+  std::string fullyQualifiedTopic;
+  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
+    this->Options().NameSpace(), _topic, fullyQualifiedTopic))
+  {
+    std::cerr << "Topic [" << _topic << "] is not valid." << std::endl;
+    return false;
+  }
+
+  auto shared = this->dataPtr->shared;
+  if (_count > 0)
+    shared->dataPtr->msgDiscovery->Discover(fullyQualifiedTopic);
+
+  return shared->dataPtr->WaitForPeers([&]
+    {
+      MsgAddresses_M pubs;
+      if (!shared->dataPtr->msgDiscovery->Publishers(fullyQualifiedTopic, pubs))
+        return _count == 0;
+
+      std::size_t count = 0;
+      for (const auto &proc : pubs)
+      {
+        if (proc.first != shared->pUuid)
+          count += proc.second.size();
+      }
+      return count >= _count;
+    }, _timeout);
+}
+
+//////////////////////////////////////////////////
+bool Node::WaitForSubscribers(const std::string &_topic,
+    const std::size_t _count, const std::chrono::milliseconds &_timeout) const
+{
+  std::string fullyQualifiedTopic;
+  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
+    this->Options().NameSpace(), _topic, fullyQualifiedTopic))
+  {
+    std::cerr << "Topic [" << _topic << "] is not valid." << std::endl;
+    return false;
+  }
+
+  auto shared = this->dataPtr->shared;
+  return shared->dataPtr->WaitForPeers([&]
+    {
+      std::lock_guard<std::recursive_mutex> lk(shared->mutex);
+      MsgAddresses_M subs;
+      if (!shared->remoteSubscribers.Publishers(fullyQualifiedTopic, subs))
+        return _count == 0;
+
+      std::size_t count = 0;
+      for (const auto &proc : subs)
+        count += proc.second.size();
+      return count >= _count;
+    }, _timeout);
+}
+
 //////////////////////////////////////////////////
 std::unordered_set<std::string> &Node::SrvsAdvertised() const
 {
@@ -923,6 +2057,10 @@ bool Node::TopicInfo(const std::string &_topic,
 bool Node::ServiceInfo(const std::string &_service,
                        std::vector<ServicePublisher> &_publishers) const
 {
+  // Getting the information of a service needs their discovery.
+  if (!this->dataPtr->shared->InitializeServices())
+    return false;
+
   this->dataPtr->shared->dataPtr->srvDiscovery->WaitForInit();
 
   // Construct a topic name with the partition and namespace
@@ -933,7 +2071,7 @@ bool Node::ServiceInfo(const std::string &_service,
     return false;
   }
 
-  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->mutex);
+  std::lock_guard<std::recursive_mutex> lk(this->dataPtr->shared->srvMutex);
 
   // Get all the publishers on the given service.
   SrvAddresses_M pubs;
@@ -967,17 +2105,20 @@ bool Node::ServiceInfo(const std::string &_service,
 Node::Publisher Node::Advertise(const std::string &_topic,
     const std::string &_msgTypeName, const AdvertiseMessageOptions &_options)
 {
-  // Topic remapping.
-  std::string topic = _topic;
-  this->Options().TopicRemap(_topic, topic);
+  return this->Advertise(this->Resolve(_topic), _msgTypeName, _options);
+}
 
-  std::string fullyQualifiedTopic;
-  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
-        this->Options().NameSpace(), topic, fullyQualifiedTopic))
+/////////////////////////////////////////////////
+Node::Publisher Node::Advertise(const TopicName &_topic,
+    const std::string &_msgTypeName, const AdvertiseMessageOptions &_options)
+{
+  const std::string &topic = _topic.Topic();
+  if (!_topic.Valid())
   {
     std::cerr << "Topic [" << topic << "] is not valid." << std::endl;
     return Publisher();
   }
+  const std::string &fullyQualifiedTopic = _topic.FullyQualifiedName();
 
   auto currentTopics = this->AdvertisedTopics();
 
@@ -991,8 +2132,6 @@ Node::Publisher Node::Advertise(const std::string &_topic,
     return Publisher();
   }
 
-  std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
-
   // Notify the discovery service to register and advertise my topic.
   MessagePublisher publisher(fullyQualifiedTopic,
       this->Shared()->myAddress,
@@ -1000,15 +2139,94 @@ Node::Publisher Node::Advertise(const std::string &_topic,
       "unused",
       this->Shared()->pUuid, this->NodeUuid(), _msgTypeName, _options);
 
-  if (!this->Shared()->dataPtr->msgDiscovery->Advertise(publisher))
   {
-    std::cerr << "Node::Advertise(): Error advertising topic ["
-      << topic
-      << "]. Did you forget to start the discovery service?"
-      << std::endl;
-    return Publisher();
+    std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+
+    // The subscribers learn the multicast group and the best effort delivery
+    // from the advertisement, so they are only announced if they can be used.
+    AdvertiseMessageOptions opts(_options);
+    std::string group = _options.MulticastGroup();
+    if (!group.empty())
+    {
+      if (!this->Shared()->dataPtr->AddMulticastTopic(fullyQualifiedTopic,
+            group, this->Shared()->hostAddr,
+            this->Shared()->remoteSubscribers))
+      {
+        group.clear();
+      }
+      opts.SetMulticastGroup(group);
+    }
+    if (_options.BestEffort() &&
+        !this->Shared()->dataPtr->AddBestEffortTopic(fullyQualifiedTopic,
+          this->Shared()->remoteSubscribers))
+    {
+      opts.SetBestEffort(false);
+    }
+
+    // The topics of a traffic class are sent through its own socket, so
+    // the subscribers connect to it.
+    TrafficClass_t trafficClass = _options.TrafficClass();
+    std::string address = this->Shared()->myAddress;
+    this->Shared()->dataPtr->AddLaneTopic(fullyQualifiedTopic,
+      this->Shared()->pUuid, this->Shared()->hostAddr, trafficClass, address);
+    opts.SetTrafficClass(trafficClass);
+    publisher.SetAddr(address);
+
+    // The subscribers can ask for fewer messages.
+    opts.SetSubscriberMsgsPerSec(kUnthrottled);
+
+    // The subscribers only ask for the compression if this build offers it.
+    if (!CompressionAvailable(opts.Compression()))
+    {
+      std::cerr << "Node::Advertise(): The compression of topic [" << topic
+                << "] isn't available in this build. The messages are sent "
+                << "as they are." << std::endl;
+      opts.SetCompression(Compression_t::NONE);
+    }
+    publisher.SetOptions(opts);
+
+    if (opts.FragmentSize() != 0)
+    {
+      this->Shared()->dataPtr->AddFragmentTopic(fullyQualifiedTopic,
+        opts.FragmentSize());
+    }
+    if (opts.Compression() != Compression_t::NONE)
+    {
+      this->Shared()->dataPtr->AddCompressedTopic(fullyQualifiedTopic,
+        opts.Compression(), opts.CompressionThreshold());
+    }
+
+    if (!this->Shared()->dataPtr->msgDiscovery->Advertise(publisher))
+    {
+      if (!group.empty())
+        this->Shared()->dataPtr->RemoveMulticastTopic(fullyQualifiedTopic);
+      if (opts.BestEffort())
+        this->Shared()->dataPtr->RemoveBestEffortTopic(fullyQualifiedTopic);
+      if (trafficClass != TrafficClass_t::DEFAULT)
+        this->Shared()->dataPtr->RemoveLaneTopic(fullyQualifiedTopic);
+      if (opts.FragmentSize() != 0)
+        this->Shared()->dataPtr->RemoveFragmentTopic(fullyQualifiedTopic);
+      if (opts.Compression() != Compression_t::NONE)
+        this->Shared()->dataPtr->RemoveCompressedTopic(fullyQualifiedTopic);
+
+      std::cerr << "Node::Advertise(): Error advertising topic ["
+        << topic
+        << "]. Did you forget to start the discovery service?"
+        << std::endl;
+      return Publisher();
+    }
+
+    // The prefix subscriptions of this process receive the topic too.
+    this->Shared()->AttachPrefixHandlers(fullyQualifiedTopic);
+
+    if (_options.Latched())
+      ++this->Shared()->dataPtr->latchedTopics[fullyQualifiedTopic].publishers;
   }
 
+  // The discovery doesn't report the topics of this process.
+  this->Shared()->dataPtr->NotifyDiscoveryChange(DiscoveryChange_t::ADDED,
+    publisher);
+
   return Publisher(publisher);
 }
 
@@ -1018,6 +2236,9 @@ bool NodePrivate::SubscribeHelper(const std::string &_fullyQualifiedTopic)
   // Add the topic to the list of subscribed topics (if it was not before).
   this->topicsSubscribed.insert(_fullyQualifiedTopic);
 
+  // The handler has just been stored, so cached snapshots are stale.
+  this->shared->InvalidateSubscriberSnapshot(_fullyQualifiedTopic);
+
   // Discover the list of nodes that publish on the topic.
   if (!this->shared->dataPtr->msgDiscovery->Discover(_fullyQualifiedTopic))
   {
@@ -1031,8 +2252,184 @@ bool NodePrivate::SubscribeHelper(const std::string &_fullyQualifiedTopic)
   return true;
 }
 
+//////////////////////////////////////////////////
+bool NodePrivate::UnsubscribeHelper(const std::string &_fullyQualifiedTopic,
+  std::vector<MessagePublisher> &_unregistrations)
+{
+  // Remove the subscribers for the given topic that belong to this node.
+  this->shared->localSubscribers.RemoveHandlersForNode(
+        _fullyQualifiedTopic, this->nUuid);
+  this->shared->InvalidateSubscriberSnapshot(_fullyQualifiedTopic);
+
+  // Remove the topic from the list of subscribed topics in this node.
+  this->topicsSubscribed.erase(_fullyQualifiedTopic);
+
+  // The prefix subscriptions of this node keep the topic.
+  const bool prefixed = this->shared->AttachPrefixHandlers(
+    _fullyQualifiedTopic, this->nUuid);
+
+  // Remove the filter for this topic if I am the last subscriber. Otherwise
+  // the remaining subscribers may want the topic at another rate.
+  this->shared->UpdateSubscriberRate(_fullyQualifiedTopic);
+  if (prefixed)
+    return true;
+
+  // The publishers have to know that I am no longer interested in the topic.
+  MsgAddresses_M addresses;
+  if (!this->shared->dataPtr->msgDiscovery->Publishers(
+        _fullyQualifiedTopic, addresses))
+  {
+    return false;
+  }
+
+  for (auto &proc : addresses)
+  {
+    _unregistrations.emplace_back(_fullyQualifiedTopic,
+      this->shared->myAddress, proc.first, this->shared->pUuid, this->nUuid,
+      kGenericMessageType, AdvertiseMessageOptions());
+  }
+
+  return true;
+}
+
 /////////////////////////////////////////////////
 bool Node::SubscribeHelper(const std::string &_fullyQualifiedTopic)
 {
   return this->dataPtr->SubscribeHelper(_fullyQualifiedTopic);
 }
+
+/////////////////////////////////////////////////
+bool Node::SubscribeHandler(const std::string &_fullyQualifiedTopic,
+    const ISubscriptionHandlerPtr &_handler)
+{
+  std::lock_guard<std::recursive_mutex> lk(this->Shared()->mutex);
+
+  // Store the subscription handler. Each subscription handler is
+  // associated with a topic. When the receiving thread gets new data,
+  // it will recover the subscription handler associated to the topic and
+  // will invoke the callback.
+  this->Shared()->localSubscribers.normal.AddHandler(
+    _fullyQualifiedTopic, this->NodeUuid(), _handler);
+
+  if (!this->SubscribeHelper(_fullyQualifiedTopic))
+    return false;
+
+  // Hand over the last messages of the latched publishers of this
+  // process.
+  this->Shared()->DeliverLatched(_fullyQualifiedTopic, _handler);
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool Node::RequestStreamHelper(const std::string &_topic,
+    const IReqHandlerPtr &_handler)
+{
+  // Topic remapping.
+  std::string topic = _topic;
+  this->Options().TopicRemap(_topic, topic);
+
+  std::string fullyQualifiedTopic;
+  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
+    this->Options().NameSpace(), topic, fullyQualifiedTopic))
+  {
+    std::cerr << "Service [" << topic << "] is not valid." << std::endl;
+    return false;
+  }
+
+  if (!_handler->SerializedRequest())
+    return false;
+
+  // The services are created the first time they are used.
+  if (!this->Shared()->InitializeServices())
+    return false;
+
+  const std::string reqType = _handler->ReqTypeName();
+  const std::string repType = _handler->RepTypeName();
+
+  std::lock_guard<std::recursive_mutex> lk(this->Shared()->srvMutex);
+
+  // If the responser is within my process.
+  IRepHandlerPtr repHandler;
+  if (this->Shared()->repliers.FirstHandler(fullyQualifiedTopic, reqType,
+        repType, repHandler))
+  {
+    this->Shared()->dataPtr->RunLocalStream(repHandler, _handler);
+    return true;
+  }
+
+  // Store the request handler.
+  this->Shared()->requests.AddHandler(
+    fullyQualifiedTopic, this->NodeUuid(), _handler);
+
+  // If the responser's address is known, make the request.
+  SrvAddresses_M addresses;
+  if (this->Shared()->TopicPublishers(fullyQualifiedTopic, addresses))
+  {
+    this->Shared()->SendPendingRemoteReqs(fullyQualifiedTopic, reqType,
+      repType);
+  }
+  else if (!this->Shared()->DiscoverService(fullyQualifiedTopic))
+  {
+    std::cerr << "Node::RequestStream(): Error discovering service ["
+              << topic
+              << "]. Did you forget to start the discovery service?"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool Node::AdvertiseHelper(const std::string &_topic,
+    const IRepHandlerPtr &_handler, const AdvertiseServiceOptions &_options)
+{
+  // Topic remapping.
+  std::string topic = _topic;
+  this->Options().TopicRemap(_topic, topic);
+
+  std::string fullyQualifiedTopic;
+  if (!TopicUtils::FullyQualifiedName(this->Options().Partition(),
+    this->Options().NameSpace(), topic, fullyQualifiedTopic))
+  {
+    std::cerr << "Service [" << topic << "] is not valid." << std::endl;
+    return false;
+  }
+
+  _handler->SetMaxConcurrentCalls(_options.MaxConcurrentCalls());
+  _handler->SetReplyCacheTtl(_options.ReplyCacheTtl());
+
+  // The services are created the first time they are used.
+  if (!this->Shared()->InitializeServices())
+    return false;
+
+  std::lock_guard<std::recursive_mutex> lk(this->Shared()->srvMutex);
+
+  // Add the topic to the list of advertised services.
+  this->SrvsAdvertised().insert(fullyQualifiedTopic);
+
+  // Store the replier handler. Each replier handler is
+  // associated with a topic. When the receiving thread gets new requests,
+  // it will recover the replier handler associated to the topic and
+  // will invoke the service call.
+  this->Shared()->repliers.AddHandler(
+    fullyQualifiedTopic, this->NodeUuid(), _handler);
+
+  // Notify the discovery service to register and advertise my responser.
+  ServicePublisher publisher(fullyQualifiedTopic,
+    this->Shared()->myReplierAddress,
+    this->Shared()->replierId.ToString(),
+    this->Shared()->pUuid, this->NodeUuid(),
+    _handler->ReqTypeName(), _handler->RepTypeName(), _options);
+
+  if (!this->Shared()->AdvertisePublisher(publisher))
+  {
+    std::cerr << "Node::Advertise(): Error advertising service ["
+              << topic
+              << "]. Did you forget to start the discovery service?"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
@@ -15,7 +15,11 @@
  *
 */
 
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "ignition/transport/Helpers.hh"
@@ -27,6 +31,113 @@
 using namespace ignition;
 using namespace transport;
 
+using TopicRemaps = NodeOptionsPrivate::TopicRemaps;
+
+//////////////////////////////////////////////////
+/// \brief Add a topic remapping to a table.
+/// \param[in] _fromTopic Original topic to be renamed.
+/// \param[in] _toTopic New topic to be used.
+/// \param[in,out] _remaps The table.
+/// \return True if the topic remap is possible or false otherwise.
+static bool addTopicRemap(const std::string &_fromTopic,
+  const std::string &_toTopic, TopicRemaps &_remaps)
+{
+  // Sanity check: Make sure that both topics are valid.
+  for (const auto &topic : {_fromTopic, _toTopic})
+  {
+    if (!TopicUtils::IsValidTopic(topic))
+    {
+      std::cerr << "Invalid topic name [" << topic << "]" << std::endl;
+      return false;
+    }
+  }
+
+  // Sanity check: Make sure that the orignal topic hasn't been remapped
+  // already.
+  auto inserted = _remaps.emplace(_fromTopic, _toTopic);
+  if (!inserted.second)
+  {
+    std::cerr << "Topic name [" << _fromTopic << "] has already been "
+              << "remapped to [" << inserted.first->second << "]"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Remove the leading and trailing whitespaces of a string.
+/// \param[in] _str The string.
+/// \return The trimmed string.
+static std::string trim(const std::string &_str)
+{
+  const char *whitespaces = " \t\r\n";
+  const auto first = _str.find_first_not_of(whitespaces);
+  if (first == std::string::npos)
+    return "";
+  return _str.substr(first, _str.find_last_not_of(whitespaces) - first + 1);
+}
+
+//////////////////////////////////////////////////
+/// \brief Add the topic remappings of a file to a table.
+/// \param[in] _filename Path to the file.
+/// \param[in,out] _remaps The table.
+/// \return True if all the remappings were added or false otherwise.
+static bool loadTopicRemaps(const std::string &_filename, TopicRemaps &_remaps)
+{
+  std::ifstream file(_filename);
+  if (!file)
+  {
+    std::cerr << "Unable to open topic remapping file [" << _filename << "]"
+              << std::endl;
+    return false;
+  }
+
+  bool result = true;
+  std::string line;
+  for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+  {
+    line = trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    const auto separator = line.find(":=");
+    if (separator == std::string::npos ||
+        !addTopicRemap(trim(line.substr(0, separator)),
+          trim(line.substr(separator + 2)), _remaps))
+    {
+      std::cerr << "Invalid topic remapping [" << line << "] at ["
+                << _filename << ":" << lineNumber << "]" << std::endl;
+      result = false;
+    }
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the remappings of the file set in the
+/// IGN_TRANSPORT_TOPIC_REMAPS environment variable. The file is loaded
+/// once per process, all the options share the same table.
+/// \return The table, or nullptr if the variable isn't set.
+static std::shared_ptr<TopicRemaps> envTopicRemaps()
+{
+  std::string filename;
+  if (!env("IGN_TRANSPORT_TOPIC_REMAPS", filename) || filename.empty())
+    return nullptr;
+
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<TopicRemaps>> loaded;
+  std::lock_guard<std::mutex> lk(mutex);
+  auto &remaps = loaded[filename];
+  if (!remaps)
+  {
+    remaps = std::make_shared<TopicRemaps>();
+    loadTopicRemaps(filename, *remaps);
+  }
+  return remaps;
+}
+
 //////////////////////////////////////////////////
 NodeOptions::NodeOptions()
   : dataPtr(new NodeOptionsPrivate())
@@ -35,13 +146,17 @@ NodeOptions::NodeOptions()
   std::string ignPartition;
   if (env("IGN_PARTITION", ignPartition))
     this->SetPartition(ignPartition);
+
+  // Check if the environment variable IGN_TRANSPORT_TOPIC_REMAPS is present.
+  auto remaps = envTopicRemaps();
+  if (remaps)
+    this->dataPtr->topicsRemap = remaps;
 }
 
 //////////////////////////////////////////////////
 NodeOptions::NodeOptions(const NodeOptions &_other)
-  : dataPtr(new NodeOptionsPrivate())
+  : dataPtr(new NodeOptionsPrivate(*_other.dataPtr))
 {
-  (*this) = _other;
 }
 
 //////////////////////////////////////////////////
@@ -52,9 +167,8 @@ NodeOptions::~NodeOptions()
 //////////////////////////////////////////////////
 NodeOptions &NodeOptions::operator=(const NodeOptions &_other)
 {
-  this->SetNameSpace(_other.NameSpace());
-  this->SetPartition(_other.Partition());
-  this->dataPtr->topicsRemap = _other.dataPtr->topicsRemap;
+  // The values of _other are valid already.
+  *this->dataPtr = *_other.dataPtr;
   return *this;
 }
 
@@ -82,6 +196,18 @@ const std::string &NodeOptions::Partition() const
   return this->dataPtr->partition;
 }
 
+//////////////////////////////////////////////////
+const std::string &NodeOptions::Context() const
+{
+  return this->dataPtr->context;
+}
+
+//////////////////////////////////////////////////
+void NodeOptions::SetContext(const std::string &_context)
+{
+  this->dataPtr->context = _context;
+}
+
 //////////////////////////////////////////////////
 bool NodeOptions::SetPartition(const std::string &_partition)
 {
@@ -98,39 +224,28 @@ bool NodeOptions::SetPartition(const std::string &_partition)
 bool NodeOptions::AddTopicRemap(const std::string &_fromTopic,
                                 const std::string &_toTopic)
 {
-  // Sanity check: Make sure that both topics are valid.
-  for (auto topic : {_fromTopic, _toTopic})
-  {
-    if (!TopicUtils::IsValidTopic(topic))
-    {
-      std::cerr << "Invalid topic name [" << topic << "]" << std::endl;
-      return false;
-    }
-  }
-
-  // Sanity check: Make sure that the orignal topic hasn't been remapped already
-  if (this->dataPtr->topicsRemap.find(_fromTopic) !=
-      this->dataPtr->topicsRemap.end())
-  {
-    std::cerr << "Topic name [" << _fromTopic << "] has already been remapped"
-              << "to [" << this->dataPtr->topicsRemap.at(_fromTopic) << "]"
-              << std::endl;
-    return false;
-  }
-
-  this->dataPtr->topicsRemap[_fromTopic] = _toTopic;
+  return addTopicRemap(_fromTopic, _toTopic,
+    this->dataPtr->MutableTopicsRemap());
+}
 
-  return true;
+//////////////////////////////////////////////////
+bool NodeOptions::LoadTopicRemaps(const std::string &_filename)
+{
+  return loadTopicRemaps(_filename, this->dataPtr->MutableTopicsRemap());
 }
 
 //////////////////////////////////////////////////
 bool NodeOptions::TopicRemap(const std::string &_fromTopic,
   std::string &_toTopic) const
 {
+  const auto &remaps = *this->dataPtr->topicsRemap;
+  if (remaps.empty())
+    return false;
+
   // Is there any remap for this topic?
-  auto topicIt = this->dataPtr->topicsRemap.find(_fromTopic);
-  if (topicIt != this->dataPtr->topicsRemap.end())
+  auto topicIt = remaps.find(_fromTopic);
+  if (topicIt != remaps.end())
     _toTopic = topicIt->second;
 
-  return topicIt != this->dataPtr->topicsRemap.end();
+  return topicIt != remaps.end();
 }
@@ -18,8 +18,9 @@
 #ifndef IGN_TRANSPORT_NODEOPTIONSPRIVATE_HH_
 #define IGN_TRANSPORT_NODEOPTIONSPRIVATE_HH_
 
-#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "ignition/transport/config.hh"
 #include "ignition/transport/NetUtils.hh"
@@ -38,6 +39,16 @@ namespace ignition
       /// \brief Constructor.
       public: NodeOptionsPrivate() = default;
 
+      /// \brief Copy constructor.
+      /// \param[in] _other The options to copy.
+      public: NodeOptionsPrivate(const NodeOptionsPrivate &_other) = default;
+
+      /// \brief Assignment operator.
+      /// \param[in] _other The options to copy.
+      /// \return Reference to these options.
+      public: NodeOptionsPrivate &operator=(
+        const NodeOptionsPrivate &_other) = default;
+
       /// \brief Destructor.
       public: virtual ~NodeOptionsPrivate() = default;
 
@@ -45,11 +56,48 @@ namespace ignition
       public: std::string ns = "";
 
       /// \brief Partition for this node.
-      public: std::string partition = hostname() + ":" + username();
+      public: std::string partition = DefaultPartition();
+
+      /// \brief Transport context of this node.
+      public: std::string context;
+
+      /// \brief Get the default partition, "<hostname>:<username>". It is
+      /// computed once per process, the lookup of the user can be slow.
+      /// \return The default partition.
+      public: static const std::string &DefaultPartition()
+      {
+        static const std::string defaultPartition =
+          hostname() + ":" + username();
+        return defaultPartition;
+      }
 
       /// \brief Table of remappings. The key is the original topic name and
       /// its value is the new topic name to be used instead.
-      public: std::map<std::string, std::string> topicsRemap;
+      public: using TopicRemaps = std::unordered_map<std::string, std::string>;
+
+      /// \brief Get the table of remappings to modify it. The copies of the
+      /// options share the table until one of them modifies it, so copying
+      /// options with large tables, as every Node does, is cheap.
+      /// \return The table, owned only by these options.
+      public: TopicRemaps &MutableTopicsRemap()
+      {
+        if (this->topicsRemap.use_count() > 1)
+          this->topicsRemap = std::make_shared<TopicRemaps>(*this->topicsRemap);
+        return *this->topicsRemap;
+      }
+
+      /// \brief The remappings, see MutableTopicsRemap(). All the options
+      /// without remappings share an empty table.
+      public: std::shared_ptr<TopicRemaps> topicsRemap = EmptyTopicsRemap();
+
+      /// \brief Get the empty table of remappings.
+      /// \return The table, never modified.
+      public: static const std::shared_ptr<TopicRemaps> &EmptyTopicsRemap()
+      {
+        static const std::shared_ptr<TopicRemaps> empty =
+          std::make_shared<TopicRemaps>();
+        return empty;
+      }
     };
     }
   }
@@ -15,6 +15,8 @@
  *
 */
 
+#include <cstdio>
+#include <fstream>
 #include <string>
 
 #include "ignition/transport/NetUtils.hh"
@@ -74,6 +76,85 @@ TEST(NodeOptionsTest, accessors)
   EXPECT_EQ(opts.Partition(), aPartition);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check the topic remappings.
+TEST(NodeOptionsTest, topicRemaps)
+{
+  transport::NodeOptions opts;
+  std::string topic;
+  EXPECT_FALSE(opts.TopicRemap("/foo", topic));
+  EXPECT_TRUE(opts.AddTopicRemap("/foo", "/bar"));
+  EXPECT_FALSE(opts.AddTopicRemap("/foo", "/baz"));
+  EXPECT_FALSE(opts.AddTopicRemap("invalid topic", "/baz"));
+  EXPECT_TRUE(opts.TopicRemap("/foo", topic));
+  EXPECT_EQ("/bar", topic);
+
+  // The copies don't share the changes made after copying.
+  transport::NodeOptions opts2(opts);
+  EXPECT_TRUE(opts2.AddTopicRemap("/qux", "/quux"));
+  EXPECT_FALSE(opts.TopicRemap("/qux", topic));
+  EXPECT_TRUE(opts2.TopicRemap("/foo", topic));
+  EXPECT_EQ("/bar", topic);
+
+  // Load a file with some invalid lines.
+  const std::string filename = "remaps_" + testing::getRandomNumber() +
+    ".txt";
+  {
+    std::ofstream file(filename);
+    file << "# Comment\n"
+         << "\n"
+         << "  /a := /b  \n"
+         << "c:=d\n"
+         << "/no_separator\n"
+         << "/foo := /baz\n";
+  }
+  EXPECT_FALSE(opts2.LoadTopicRemaps(filename));
+  EXPECT_TRUE(opts2.TopicRemap("/a", topic));
+  EXPECT_EQ("/b", topic);
+  EXPECT_TRUE(opts2.TopicRemap("c", topic));
+  EXPECT_EQ("d", topic);
+  EXPECT_TRUE(opts2.TopicRemap("/foo", topic));
+  EXPECT_EQ("/bar", topic);
+  EXPECT_FALSE(opts2.LoadTopicRemaps("/non_existing_file"));
+
+  // The file set in IGN_TRANSPORT_TOPIC_REMAPS is loaded by all the options.
+  setenv("IGN_TRANSPORT_TOPIC_REMAPS", filename.c_str(), 1);
+  transport::NodeOptions opts3;
+  EXPECT_TRUE(opts3.TopicRemap("/a", topic));
+  EXPECT_EQ("/b", topic);
+  EXPECT_TRUE(opts3.AddTopicRemap("/e", "/f"));
+  unsetenv("IGN_TRANSPORT_TOPIC_REMAPS");
+  std::remove(filename.c_str());
+
+  // The file is loaded once and the changes of opts3 don't modify it.
+  setenv("IGN_TRANSPORT_TOPIC_REMAPS", filename.c_str(), 1);
+  transport::NodeOptions opts4;
+  EXPECT_TRUE(opts4.TopicRemap("/a", topic));
+  EXPECT_FALSE(opts4.TopicRemap("/e", topic));
+  unsetenv("IGN_TRANSPORT_TOPIC_REMAPS");
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the transport context of the options.
+TEST(NodeOptionsTest, Context)
+{
+  transport::NodeOptions opts;
+  EXPECT_TRUE(opts.Context().empty());
+
+  opts.SetContext("planning");
+  EXPECT_EQ("planning", opts.Context());
+
+  // The copies keep the context.
+  transport::NodeOptions copy(opts);
+  EXPECT_EQ("planning", copy.Context());
+  transport::NodeOptions assigned;
+  assigned = opts;
+  EXPECT_EQ("planning", assigned.Context());
+
+  opts.SetContext("");
+  EXPECT_TRUE(opts.Context().empty());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -18,13 +18,19 @@
 #ifndef IGN_TRANSPORT_NODEPRIVATE_HH_
 #define IGN_TRANSPORT_NODEPRIVATE_HH_
 
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
-#include "ignition/transport/NetUtils.hh"
 #include "ignition/transport/NodeOptions.hh"
 #include "ignition/transport/Node.hh"
 #include "ignition/transport/NodeShared.hh"
+#include "ignition/transport/Publisher.hh"
+#include "ignition/transport/TopicName.hh"
 
 namespace ignition
 {
@@ -39,7 +45,12 @@ namespace ignition
     class NodePrivate
     {
       /// \brief Constructor.
-      public: NodePrivate() = default;
+      /// \param[in] _options Custom options of the node.
+      public: explicit NodePrivate(const NodeOptions &_options)
+        : shared(NodeShared::Instance(_options.Context())),
+          options(_options)
+      {
+      }
 
       /// \brief Destructor.
       public: virtual ~NodePrivate() = default;
@@ -50,9 +61,34 @@ namespace ignition
       /// \sa TopicUtils::FullyQualifiedName
       public: bool SubscribeHelper(const std::string &_fullyQualifiedTopic);
 
+      /// \brief Helper function for Unsubscribe. The caller must hold the
+      /// mutex of the shared object and notify the publishers.
+      /// \param[in] _fullyQualifiedTopic Fully qualified topic name.
+      /// \param[in,out] _unregistrations The registrations of this node on
+      /// the remote publishers of the topic are appended here, to be
+      /// passed to Discovery::Unregister().
+      /// \return True on success or false if the publishers of the topic
+      /// are unknown.
+      public: bool UnsubscribeHelper(const std::string &_fullyQualifiedTopic,
+        std::vector<MessagePublisher> &_unregistrations);
+
       /// \brief The list of topics subscribed by this node.
       public: std::unordered_set<std::string> topicsSubscribed;
 
+      /// \brief The fully qualified prefixes subscribed by this node.
+      /// \sa Node::SubscribeRawPrefix
+      public: std::unordered_set<std::string> prefixesSubscribed;
+
+      /// \brief Cache of Node::Resolve(), indexed by the name as given.
+      /// Protected by resolvedMutex.
+      public: std::unordered_map<std::string, TopicName> resolved;
+
+      /// \brief Mutex of the resolved names.
+      public: std::mutex resolvedMutex;
+
+      /// \brief Maximum number of names in the cache of Node::Resolve().
+      public: static constexpr std::size_t kMaxResolvedNames = 1024;
+
       /// \brief The list of service calls advertised by this node.
       public: std::unordered_set<std::string> srvsAdvertised;
 
@@ -60,20 +96,26 @@ namespace ignition
       public: std::string nUuid;
 
       /// \brief Pointer to the object shared between all the nodes within the
-      /// same process.
-      public: NodeShared *shared = NodeShared::Instance();
-
-      /// \brief Partition for this node.
-      public: std::string partition = hostname() + ":" + username();
-
-      /// \brief Default namespace for this node.
-      public: std::string ns = "";
+      /// same process and transport context, see NodeOptions::SetContext().
+      public: NodeShared *shared;
 
       /// \brief Custom options for this node.
       public: NodeOptions options;
 
       /// \brief Statistics publisher.
       public: Node::Publisher statPub;
+
+      /// \brief Fully qualified topics whose statistics are published by
+      /// this node, disabled when the node is destroyed.
+      public: std::unordered_set<std::string> statsTopics;
+
+      /// \brief Ids of the callbacks of Node::SubscribeDiscovery(),
+      /// removed when the node is destroyed. Protected by
+      /// discoveryCbsMutex.
+      public: std::unordered_set<uint64_t> discoveryCbs;
+
+      /// \brief Mutex of discoveryCbs.
+      public: std::mutex discoveryCbsMutex;
     };
     }
   }
@@ -23,11 +23,27 @@
 #pragma warning(pop)
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <chrono>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <mutex>
+#include <set>
 #include <shared_mutex>  //NOLINT
 #include <string>
 #include <thread>
@@ -50,10 +66,15 @@
 #include "ignition/transport/RepHandler.hh"
 #include "ignition/transport/ReqHandler.hh"
 #include "ignition/transport/SubscriptionHandler.hh"
+#include "ignition/transport/ThreadConfig.hh"
+#include "ignition/transport/TopicUtils.hh"
 #include "ignition/transport/TransportTypes.hh"
 #include "ignition/transport/Uuid.hh"
 
+#include "CopyCounters.hh"
+#include "MessageCompression.hh"
 #include "NodeSharedPrivate.hh"
+#include "Tracing.hh"
 
 #ifdef _MSC_VER
 # pragma warning(disable: 4503)
@@ -65,6 +86,29 @@ using namespace transport;
 
 const char kIgnAuthDomain[] = "ign-auth";
 
+/// \brief First byte of the best effort datagrams, which tells them apart
+/// from any other traffic reaching the UDP socket.
+static const uint8_t kDatagramMagic = 0x1D;
+
+/// \brief Size of the publication metadata of the older versions, without
+/// the system time. The receivers accept both sizes, and the datagrams keep
+/// the older one, since their layout is fixed.
+static const size_t kLegacyMetadataSize =
+  offsetof(PublicationMetadata, systemStamp);
+
+/// \brief Maximum size of a best effort datagram, the largest UDP payload
+/// over IPv4. Larger messages are sent over TCP.
+static const size_t kMaxDatagramSize = 65507;
+
+/// \brief First character of the filters of the copies of a topic sent to
+/// a subscriber process at the rate it asked for. The fully qualified topic
+/// names start with '@', so the filters of the topics never match them.
+static const char kRateLimitedPrefix[] = "\x01";
+
+/// \brief First character of the filters of the fragments of the large
+/// messages, so only the subscribers that reassemble them receive them.
+static const char kFragmentPrefix[] = "\x02";
+
 // Enum that encapsulates the possible values for ZeroMQ's setsocketopt
 // for ZMQ_PLAIN_SERVER. A value of 1 enables
 // plain authentication server, and a value of 0 disables.
@@ -149,73 +193,432 @@ std::string receiveHelper(zmq::socket_t &_socket)
 }
 
 //////////////////////////////////////////////////
-// Helper to send an authentication error. This is used by basic
-// authentication.
-void sendAuthErrorHelper(zmq::socket_t &_socket, const std::string &_err)
+/// \brief Number of frames of a ZAP request before the credentials.
+static const std::ptrdiff_t kZapRequestFrames = 6;
+
+//////////////////////////////////////////////////
+/// \brief Receive all the frames of a message, if one is ready.
+/// \param[in] _socket The socket.
+/// \param[out] _frames The frames of the message.
+/// \return True if a message was received or false otherwise.
+static bool receiveFrames(zmq::socket_t &_socket,
+    std::vector<std::string> &_frames)
 {
-  std::cerr << _err << std::endl;
+  _frames.clear();
+  zmq::message_t msg;
+  do
+  {
+    // The frames of a message are delivered together, so only the first
+    // one can be missing.
 #ifdef IGN_ZMQ_POST_4_3_1
-  sendHelper(_socket, "400", zmq::send_flags::sndmore);
-  sendHelper(_socket, _err, zmq::send_flags::sndmore);
-  sendHelper(_socket, "", zmq::send_flags::sndmore);
-  sendHelper(_socket, "", zmq::send_flags::none);
-#else
-  sendHelper(_socket, "400", ZMQ_SNDMORE);
-  sendHelper(_socket, _err, ZMQ_SNDMORE);
-  sendHelper(_socket, "", ZMQ_SNDMORE);
+    if (!_socket.recv(msg, zmq::recv_flags::dontwait))
+#else
+    if (!_socket.recv(&msg, ZMQ_DONTWAIT))
+#endif
+      return false;
+    _frames.emplace_back(reinterpret_cast<char *>(msg.data()), msg.size());
+  } while (msg.more());
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Compare a secret in constant time, so the time taken doesn't
+/// tell how much of it was right.
+/// \param[in] _given The secret received.
+/// \param[in] _expected The right secret.
+/// \return True if both are equal.
+static bool equalSecrets(const std::string &_given,
+    const std::string &_expected)
+{
+  unsigned char diff = _given.size() == _expected.size() ? 0 : 1;
+  for (std::size_t i = 0; i < _given.size(); ++i)
+  {
+    diff |= static_cast<unsigned char>(
+      _given[i] ^ (i < _expected.size() ? _expected[i] : '\0'));
+  }
+  return diff == 0;
+}
+
+//////////////////////////////////////////////////
+/// \brief Send the reply of a ZAP request through a ROUTER socket.
+/// \param[in] _socket The socket.
+/// \param[in] _envelope Routing frames of the request, including the empty
+/// delimiter.
+/// \param[in] _version Version of the request.
+/// \param[in] _sequence Sequence number of the request.
+/// \param[in] _error Why the peer isn't authenticated, or empty to accept
+/// it.
+static void sendZapReply(zmq::socket_t &_socket,
+    const std::vector<std::string> &_envelope, const std::string &_version,
+    const std::string &_sequence, const std::string &_error)
+{
+  for (const auto &frame : _envelope)
+    sendHelper(_socket, frame, ZMQ_SNDMORE);
+  sendHelper(_socket, _version, ZMQ_SNDMORE);
+  sendHelper(_socket, _sequence, ZMQ_SNDMORE);
+  sendHelper(_socket, _error.empty() ? "200" : "400", ZMQ_SNDMORE);
+  sendHelper(_socket, _error.empty() ? "OK" : _error, ZMQ_SNDMORE);
+  sendHelper(_socket, _error.empty() ? "anonymous" : "", ZMQ_SNDMORE);
   sendHelper(_socket, "", 0);
+}
+
+//////////////////////////////////////////////////
+/// \brief Run the callback of a handler, recording its execution times if
+/// the callbacks are traced. The callback_start and callback_end tracepoints
+/// carry the id of the message handled by the calling thread.
+/// \param[in] _handler The handler.
+/// \param[in] _received Reception time of the message, if known.
+/// \param[in] _callback Function running the callback.
+template <typename HandlerT, typename CallbackT>
+static void tracedCallback(const HandlerT &_handler,
+    const std::chrono::steady_clock::time_point &_received,
+    const CallbackT &_callback)
+{
+  IGN_TRANSPORT_TRACEPOINT(callback_start, _handler.HandlerUuid().c_str(),
+    currentTraceId());
+  if (!NodeSharedPrivate::callbackTracing)
+  {
+    _callback();
+    IGN_TRANSPORT_TRACEPOINT(callback_end, _handler.HandlerUuid().c_str(),
+      currentTraceId());
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  _callback();
+  const auto end = std::chrono::steady_clock::now();
+  IGN_TRANSPORT_TRACEPOINT(callback_end, _handler.HandlerUuid().c_str(),
+    currentTraceId());
+  const bool known = _received != std::chrono::steady_clock::time_point();
+  _handler.Trace().Record(end - start,
+    known ? start - _received : std::chrono::nanoseconds(0));
+}
+
+//////////////////////////////////////////////////
+/// \brief Set the publication times of a message.
+/// \param[in,out] _meta Publication metadata of the message.
+static void stampMetadata(PublicationMetadata &_meta)
+{
+  _meta.stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+  _meta.systemStamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+//////////////////////////////////////////////////
+/// \brief Owner of the buffer of a message being published. The buffer is
+/// released when the owner goes out of scope, e.g.: if publishing fails,
+/// unless it has been handed over to a ZMQ message before.
+class PublishedBuffer
+{
+  /// \brief Constructor.
+  /// \param[in] _data The buffer.
+  /// \param[in] _ffn Function releasing the buffer, null if it isn't owned.
+  /// \param[in] _hint Argument of _ffn.
+  public: PublishedBuffer(char *_data, DeallocFunc *_ffn, void *_hint)
+    : data(_data), ffn(_ffn), hint(_hint)
+  {
+  }
+
+  /// \brief Destructor. Releases the buffer if it's still owned.
+  public: ~PublishedBuffer()
+  {
+    this->Free();
+  }
+
+  /// \brief Release the buffer now.
+  public: void Free()
+  {
+    DeallocFunc *releaseFn = this->ffn;
+    this->ffn = nullptr;
+    if (releaseFn)
+      releaseFn(this->data, this->hint);
+  }
+
+  /// \brief Hand the buffer over to another owner.
+  public: void Release()
+  {
+    this->ffn = nullptr;
+  }
+
+  /// \brief Release the buffer and own another one.
+  /// \param[in] _data The new buffer.
+  /// \param[in] _ffn Function releasing it.
+  /// \param[in] _hint Argument of _ffn.
+  public: void Reset(char *_data, DeallocFunc *_ffn, void *_hint)
+  {
+    this->Free();
+    this->data = _data;
+    this->ffn = _ffn;
+    this->hint = _hint;
+  }
+
+  /// \brief The buffer.
+  private: char *data;
+
+  /// \brief Function releasing the buffer, null once it's not owned.
+  private: DeallocFunc *ffn;
+
+  /// \brief Argument of ffn.
+  private: void *hint;
+};
+
+//////////////////////////////////////////////////
+/// \brief Account for messages lost before reaching the subscribers.
+/// \param[in] _handlerInfo The subscribers of the topic.
+/// \param[in] _msgType Type of the messages.
+/// \param[in] _count Number of messages lost.
+static void addDroppedMsgs(const NodeShared::HandlerInfo &_handlerInfo,
+    const std::string &_msgType, const uint64_t _count)
+{
+  for (const auto &node : _handlerInfo.localHandlers)
+  {
+    for (const auto &handler : node.second)
+    {
+      if (handler.second && handler.second->AcceptsType(_msgType))
+        handler.second->AddDroppedMsgs(_count);
+    }
+  }
+
+  for (const auto &node : _handlerInfo.rawHandlers)
+  {
+    for (const auto &handler : node.second)
+    {
+      if (handler.second && handler.second->AcceptsType(_msgType))
+        handler.second->AddDroppedMsgs(_count);
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the process and node UUIDs of an entry of a set of
+/// subscribers.
+/// \param[in] _entry The entry.
+/// \return The UUIDs.
+static const std::pair<std::string, std::string> &subscriberKey(
+  const std::pair<std::string, std::string> &_entry)
+{
+  return _entry;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the process and node UUIDs of an entry of a map of
+/// subscribers.
+/// \param[in] _entry The entry.
+/// \return The UUIDs.
+template<typename V>
+static const std::pair<std::string, std::string> &subscriberKey(
+  const std::pair<const std::pair<std::string, std::string>, V> &_entry)
+{
+  return _entry.first;
+}
+
+//////////////////////////////////////////////////
+/// \brief Clear the compression of a registration if this process can't
+/// decompress the messages, so the publisher sends them as they are.
+/// \param[in,out] _registration The registration, a copy of the
+/// advertisement.
+static void acceptCompression(MessagePublisher &_registration)
+{
+  if (CompressionAvailable(_registration.Options().Compression()))
+    return;
+
+  AdvertiseMessageOptions opts = _registration.Options();
+  opts.SetCompression(Compression_t::NONE);
+  _registration.SetOptions(opts);
+}
+
+//////////////////////////////////////////////////
+/// \brief Let the publisher know that this process reads the compact
+/// header, see AdvertiseMessageOptions::SetCompactHeader().
+/// \param[in,out] _registration The registration, a copy of the
+/// advertisement.
+static void acceptCompactHeader(MessagePublisher &_registration)
+{
+  AdvertiseMessageOptions opts = _registration.Options();
+  opts.SetCompactHeader(true);
+  _registration.SetOptions(opts);
+}
+
+#ifdef HAVE_LTTNG
+//////////////////////////////////////////////////
+/// \brief Get the request id of a service call for the tracepoints.
+/// \param[in] _reqUuid The request id frame of the call.
+/// \return The request id or 0 if the requester doesn't send one.
+static uint64_t traceRequestId(const std::string &_reqUuid)
+{
+  uint64_t id = 0;
+  if (_reqUuid.size() == sizeof(id) || _reqUuid.size() == 2 * sizeof(id) ||
+      _reqUuid.size() == 3 * sizeof(id))
+  {
+    memcpy(&id, _reqUuid.data(), sizeof(id));
+  }
+  return id;
+}
 #endif
+
+namespace
+{
+  /// \brief The NodeShared instances of the processes, one per transport
+  /// context, see NodeOptions::SetContext().
+  struct ContextRegistry
+  {
+    /// \brief Protects the instances and the ports.
+    std::shared_mutex mutex;
+
+    /// \brief The instances, indexed by process ID and context. There is
+    /// an instance per process so the ZMQ context is not shared between
+    /// different processes.
+    std::map<std::pair<unsigned int, std::string>, NodeShared*> instances;
+
+    /// \brief Discovery ports of the contexts not created yet, see
+    /// NodeShared::ConfigureContext().
+    std::map<std::string, std::pair<int, int>> ports;
+  };
+
+  //////////////////////////////////////////////////
+  /// \brief Get the registry of the NodeShared instances.
+  /// \return The registry.
+  ContextRegistry &contextRegistry()
+  {
+    static ContextRegistry registry;
+    return registry;
+  }
 }
 
 //////////////////////////////////////////////////
 NodeShared *NodeShared::Instance()
 {
-  // Create an instance of NodeShared per process so the ZMQ context
-  // is not shared between different processes.
+  return Instance("");
+}
 
-  static std::shared_mutex mutex;
-  static std::unordered_map<unsigned int, NodeShared*> nodeSharedMap;
+//////////////////////////////////////////////////
+NodeShared *NodeShared::Instance(const std::string &_context)
+{
+  ContextRegistry &registry = contextRegistry();
 
   // Get current process ID.
-  auto pid = getProcessId();
+  const auto key = std::make_pair(getProcessId(), _context);
 
   // Check if there's already a NodeShared instance for this process.
   // Use a shared_lock so multiple threads can read simultaneously.
   // This will only block if there's another thread locking exclusively
   // for writing. Since most of the time threads will be reading,
   // we make the read operation faster at the expense of making the write
-  // operation slower. Use exceptions for their zero-cost when successful.
-  try
+  // operation slower.
+  {
+    std::shared_lock readLock(registry.mutex);
+    auto iter = registry.instances.find(key);
+    if (iter != registry.instances.end())
+      return iter->second;
+  }
+
+  // Multiple threads from the same process could have arrived here
+  // simultaneously, so after locking, we need to make sure that there's
+  // not an already constructed NodeShared instance for this process.
+  std::lock_guard writeLock(registry.mutex);
+
+  auto iter = registry.instances.find(key);
+  if (iter != registry.instances.end())
   {
-    std::shared_lock readLock(mutex);
-    return nodeSharedMap.at(pid);
+    // There's already an instance for this process, return it.
+    return iter->second;
   }
-  catch (...)
+
+  // No instance, construct a new one.
+  auto ret = registry.instances.insert({key, new NodeShared(_context)});
+  assert(ret.second);  // Insert operation should be successful.
+
+  // The instances are never destroyed. Send the unadvertisements still
+  // queued when the process exits, e.g.: of the publishers destroyed at
+  // the end of main().
+  static bool flushAtExit = false;
+  if (!flushAtExit)
+  {
+    flushAtExit = true;
+    std::atexit([]
+      {
+        ContextRegistry &reg = contextRegistry();
+        std::shared_lock readLock(reg.mutex);
+        const unsigned int pid = getProcessId();
+        for (const auto &instance : reg.instances)
+        {
+          if (instance.first.first != pid)
+            continue;
+
+          NodeShared *shared = instance.second;
+          shared->dataPtr->msgDiscovery->FlushUnadvertisements();
+          if (shared->dataPtr->servicesInitialized)
+            shared->dataPtr->srvDiscovery->FlushUnadvertisements();
+          shared->dataPtr->UnlinkIpcEndpoints();
+        }
+      });
+  }
+  return ret.first->second;
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::ConfigureContext(const std::string &_context,
+    const int _msgDiscPort, const int _srvDiscPort)
+{
+  if (_context.empty() || _msgDiscPort < 0 || _msgDiscPort > 65535 ||
+      _srvDiscPort < 0 || _srvDiscPort > 65535)
   {
-    // Multiple threads from the same process could have arrived here
-    // simultaneously, so after locking, we need to make sure that there's
-    // not an already constructed NodeShared instance for this process.
-    std::lock_guard writeLock(mutex);
+    std::cerr << "NodeShared::ConfigureContext(): Invalid context ["
+              << _context << "] or ports [" << _msgDiscPort << ", "
+              << _srvDiscPort << "]" << std::endl;
+    return false;
+  }
+
+  ContextRegistry &registry = contextRegistry();
+  std::lock_guard writeLock(registry.mutex);
+  if (registry.instances.count({getProcessId(), _context}) > 0)
+  {
+    std::cerr << "NodeShared::ConfigureContext(): Context [" << _context
+              << "] already in use" << std::endl;
+    return false;
+  }
+
+  registry.ports[_context] = {_msgDiscPort, _srvDiscPort};
+  return true;
+}
+
+//////////////////////////////////////////////////
+const std::string &NodeShared::Context() const
+{
+  return this->dataPtr->contextName;
+}
 
-    auto iter = nodeSharedMap.find(pid);
-    if (iter != nodeSharedMap.end())
+//////////////////////////////////////////////////
+NodeShared *NodeSharedPrivate::InstanceByProcessUuid(
+    const std::string &_pUuid)
+{
+  ContextRegistry &registry = contextRegistry();
+  {
+    std::shared_lock readLock(registry.mutex);
+    const unsigned int pid = getProcessId();
+    for (const auto &instance : registry.instances)
     {
-      // There's already an instance for this process, return it.
-      return iter->second;
+      if (instance.first.first == pid && instance.second->pUuid == _pUuid)
+        return instance.second;
     }
-
-    // No instance, construct a new one.
-    auto ret = nodeSharedMap.insert({pid, new NodeShared});
-    assert(ret.second);  // Insert operation should be successful.
-    return ret.first->second;
   }
+  return NodeShared::Instance();
 }
 
 //////////////////////////////////////////////////
 NodeShared::NodeShared()
+  : NodeShared("")
+{
+}
+
+//////////////////////////////////////////////////
+NodeShared::NodeShared(const std::string &_context)
   : verbose(false),
     dataPtr(new NodeSharedPrivate)
 {
+  this->dataPtr->contextName = _context;
+
   // If IGN_VERBOSE=1 enable the verbose mode.
   std::string ignVerbose;
   this->verbose = (env("IGN_VERBOSE", ignVerbose) && ignVerbose == "1");
@@ -236,6 +639,15 @@ NodeShared::NodeShared()
   this->srvDiscPort = this->dataPtr->NonNegativeEnvVar(
     "IGN_DISCOVERY_SRV_PORT", this->kDefaultSrvDiscPort);
 
+  // The ports of a context, if any. Instance() holds the registry locked.
+  const auto &ports = contextRegistry().ports;
+  auto contextPorts = ports.find(_context);
+  if (contextPorts != ports.end())
+  {
+    this->msgDiscPort = contextPorts->second.first;
+    this->srvDiscPort = contextPorts->second.second;
+  }
+
   // Sanity check: the discovery ports should be unique.
   if (this->msgDiscPort == this->srvDiscPort)
   {
@@ -253,38 +665,133 @@ NodeShared::NodeShared()
   this->dataPtr->topicStatsEnabled =
     (env("IGN_TRANSPORT_TOPIC_STATISTICS", ignStats) && ignStats == "1");
 
+  std::string ignTracing;
+  NodeSharedPrivate::callbackTracing =
+    (env("IGN_TRANSPORT_CALLBACK_TRACING", ignTracing) && ignTracing == "1");
+
+  const int receptionThreads = this->dataPtr->NonNegativeEnvVar(
+    "IGN_TRANSPORT_RECEPTION_THREADS", 0);
+  if (receptionThreads > 0)
+  {
+    this->dataPtr->receptionExecutor = std::make_unique<Executor>(
+      static_cast<std::size_t>(receptionThreads), "ign-recv-exec");
+  }
+
+  const int localThreads = this->dataPtr->NonNegativeEnvVar(
+    "IGN_TRANSPORT_LOCAL_DELIVERY_THREADS", 0);
+  if (localThreads > 0)
+  {
+    this->dataPtr->localExecutor = std::make_unique<Executor>(
+      static_cast<std::size_t>(localThreads), "ign-local-exec");
+  }
+
+  this->dataPtr->bufferPool = std::make_unique<BufferPool>(
+    static_cast<std::size_t>(this->dataPtr->NonNegativeEnvVar(
+      "IGN_TRANSPORT_BUFFER_POOL_SIZE",
+      static_cast<int>(BufferPool::kDefaultCapacity))));
+
+  this->dataPtr->maxReassemblySize = static_cast<uint64_t>(
+    this->dataPtr->NonNegativeEnvVar("IGN_TRANSPORT_MAX_FRAGMENTED_SIZE",
+      static_cast<int>(NodeSharedPrivate::kDefaultMaxReassemblySize /
+        (1024 * 1024)))) * 1024 * 1024;
+
+  std::string ignCompact;
+  this->dataPtr->compactHeaderEnabled =
+    (env("IGN_TRANSPORT_COMPACT_HEADER", ignCompact) && ignCompact == "1");
+
+  std::string ignHwmDrops;
+  this->dataPtr->countHwmDrops =
+    (env("IGN_TRANSPORT_COUNT_HWM_DROPS", ignHwmDrops) && ignHwmDrops == "1");
+
+  const std::chrono::seconds idleTimeout(this->dataPtr->NonNegativeEnvVar(
+    "IGN_TRANSPORT_CONNECTION_IDLE_TIMEOUT", 60));
+  this->dataPtr->requesterConnections = ConnectionCache(idleTimeout);
+  this->dataPtr->replierConnections = ConnectionCache(idleTimeout);
+  this->dataPtr->replySenderConnections = ConnectionCache(idleTimeout);
+  this->dataPtr->evictionEnabled = idleTimeout.count() > 0;
+
+  std::string ignBalancing;
+  if (env("IGN_TRANSPORT_SERVICE_BALANCING", ignBalancing))
+  {
+    using Balancing = NodeSharedPrivate::ServiceBalancing;
+    if (ignBalancing == "first")
+      this->dataPtr->serviceBalancing = Balancing::FIRST;
+    else if (ignBalancing == "round_robin")
+      this->dataPtr->serviceBalancing = Balancing::ROUND_ROBIN;
+    else if (ignBalancing == "least_outstanding")
+      this->dataPtr->serviceBalancing = Balancing::LEAST_OUTSTANDING;
+    else if (ignBalancing == "latency")
+      this->dataPtr->serviceBalancing = Balancing::LATENCY;
+    else
+    {
+      std::cerr << "Unknown IGN_TRANSPORT_SERVICE_BALANCING value ["
+                << ignBalancing << "]. Using [first]" << std::endl;
+    }
+  }
+
   // My process UUID.
   Uuid uuid;
   this->pUuid = uuid.ToString();
+  this->dataPtr->responseReceiverId = this->responseReceiverId.ToString();
 
   // Initialize my discovery services.
   this->dataPtr->msgDiscovery.reset(
       new MsgDiscovery(this->pUuid, this->discoveryIP, this->msgDiscPort));
-  this->dataPtr->srvDiscovery.reset(
-      new SrvDiscovery(this->pUuid, this->discoveryIP, this->srvDiscPort));
+
+  this->dataPtr->InitMetrics(*this);
 
   // Initialize the 0MQ objects.
   if (!this->InitializeSockets())
     return;
 
+  // The high water marks don't change once the sockets are initialized.
+  const int sndHwm = this->SndHwm();
+  const int rcvHwm = this->RcvHwm();
+  this->dataPtr->metrics.Describe("ign_transport_sndhwm",
+    MetricsRegistry::Type::GAUGE, "High water mark of the publisher socket.");
+  this->dataPtr->metrics.Describe("ign_transport_rcvhwm",
+    MetricsRegistry::Type::GAUGE, "High water mark of the subscriber socket.");
+  this->dataPtr->metrics.Describe("ign_transport_subscriber_connections",
+    MetricsRegistry::Type::GAUGE,
+    "Remote subscribers connected to the publisher socket.");
+  this->dataPtr->metrics.Describe("ign_transport_publisher_connections",
+    MetricsRegistry::Type::GAUGE,
+    "Remote publishers that the subscriber socket is connected to.");
+  this->dataPtr->metrics.Describe("ign_transport_hwm_dropped_messages_total",
+    MetricsRegistry::Type::COUNTER,
+    "Messages dropped at the send high water mark, if "
+    "IGN_TRANSPORT_COUNT_HWM_DROPS is set.");
+  this->dataPtr->metrics.AddCollector(
+    [sndHwm, rcvHwm, this](std::vector<MetricsRegistry::Sample> &_samples)
+    {
+      _samples.push_back({"ign_transport_sndhwm", "",
+        static_cast<double>(sndHwm)});
+      _samples.push_back({"ign_transport_rcvhwm", "",
+        static_cast<double>(rcvHwm)});
+
+      const SocketStatistics stats = this->SocketStats();
+      _samples.push_back({"ign_transport_subscriber_connections", "",
+        static_cast<double>(stats.subscriberConnections)});
+      _samples.push_back({"ign_transport_publisher_connections", "",
+        static_cast<double>(stats.publisherConnections)});
+    });
+
   if (this->verbose)
   {
     std::cout << "Current host address: " << this->hostAddr << std::endl;
     std::cout << "Process UUID: " << this->pUuid << std::endl;
     std::cout << "Bind at: [udp://" << this->discoveryIP << ":"
               << this->msgDiscPort << "] for msg discovery\n";
-    std::cout << "Bind at: [udp://" << this->discoveryIP << ":"
-              << this->srvDiscPort << "] for srv discovery\n";
-    std::cout << "Bind at: [" << this->myAddress << "] for pub/sub\n";
-    std::cout << "Bind at: [" << this->myReplierAddress << "] for srv. calls\n";
-    std::cout << "Identity for receiving srv. requests: ["
-              << this->replierId.ToString() << "]" << std::endl;
-    std::cout << "Identity for receiving srv. responses: ["
-              << this->responseReceiverId.ToString() << "]" << std::endl;
+    std::cout << "Bind at: [" << this->myAddress << "] for pub/sub"
+              << std::endl;
   }
 
-  // Start the service thread.
-  this->threadReception = std::thread(&NodeShared::RunReceptionTask, this);
+  // Start the service thread, unless the application spins.
+  this->dataPtr->manualSpin = ThreadConfig::Global().ManualSpin();
+  if (!this->dataPtr->manualSpin)
+  {
+    this->threadReception = std::thread(&NodeShared::RunReceptionTask, this);
+  }
 
   // Set the callback to notify discovery updates (new topics).
   this->dataPtr->msgDiscovery->ConnectionsCb(
@@ -300,37 +807,81 @@ NodeShared::NodeShared()
   this->dataPtr->msgDiscovery->UnregistrationsCb(
       std::bind(&NodeShared::OnEndRegistration, this, std::placeholders::_1));
 
-  // Set the callback to notify svc discovery updates (new services).
-  this->dataPtr->srvDiscovery->ConnectionsCb(
-      std::bind(&NodeShared::OnNewSrvConnection, this, std::placeholders::_1));
-
-  // Set the callback to notify svc discovery updates (invalid services).
-  this->dataPtr->srvDiscovery->DisconnectionsCb(
-      std::bind(&NodeShared::OnNewSrvDisconnection,
-        this, std::placeholders::_1));
+  this->dataPtr->msgDiscovery->StatsRegistrationsCb(
+      std::bind(&NodeShared::OnStatsRegistration, this, std::placeholders::_1,
+        std::placeholders::_2));
 
   // Start the discovery services.
   this->dataPtr->msgDiscovery->Start();
-  this->dataPtr->srvDiscovery->Start();
+
+  // The descriptors polled by an application that spins can't change, so
+  // the services are not created on demand.
+  if (this->dataPtr->manualSpin)
+    this->InitializeServices();
 
   // Create the local publish thread.
-  this->dataPtr->pubThread = std::thread(&NodeSharedPrivate::PublishThread,
-      this->dataPtr.get());
+  if (!this->dataPtr->manualSpin)
+  {
+    this->dataPtr->pubThread = std::thread(&NodeSharedPrivate::PublishThread,
+        this->dataPtr.get());
+  }
+
+  std::string metricsTopic;
+  if (env("IGN_TRANSPORT_METRICS_TOPIC", metricsTopic) &&
+      !metricsTopic.empty())
+  {
+    this->dataPtr->metricsThread = std::thread(
+      &NodeSharedPrivate::MetricsExporter, this->dataPtr.get(), metricsTopic);
+  }
 }
 
 //////////////////////////////////////////////////
 NodeShared::~NodeShared()
 {
-  // Tell the service thread to terminate.
+  // Tell the service thread to terminate, and the rest of the threads
+  // polling sockets. They don't wait for a timeout to see it.
   this->dataPtr->exit = true;
+  this->dataPtr->WakeUpReception();
+  if (this->dataPtr->controlWakeupSender)
+    NodeSharedPrivate::SendWakeup(*this->dataPtr->controlWakeupSender);
+  if (this->dataPtr->accessWakeupSender)
+    NodeSharedPrivate::SendWakeup(*this->dataPtr->accessWakeupSender);
+
+  // Stop publishing the metrics.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->metricsMutex);
+    this->dataPtr->metricsCondition.notify_all();
+  }
+  if (this->dataPtr->metricsThread.joinable())
+    this->dataPtr->metricsThread.join();
+
+  // Stop reporting the statistics.
+  {
+    std::lock_guard<std::mutex> lk(this->dataPtr->statsMutex);
+    this->dataPtr->statsCondition.notify_all();
+  }
+  if (this->dataPtr->statsThread.joinable())
+    this->dataPtr->statsThread.join();
 
   // Notify the local pubthread and join.
-  this->dataPtr->signalNewPub.notify_all();
-  this->dataPtr->pubThread.join();
+  this->dataPtr->pubQueue.Close();
+  if (this->dataPtr->pubThread.joinable())
+    this->dataPtr->pubThread.join();
+
+  // No more local messages can be posted, stop running callbacks.
+  this->dataPtr->localExecutor.reset();
 
   // Wait for the service thread before exit.
   if (this->threadReception.joinable())
     this->threadReception.join();
+  if (this->dataPtr->controlReceptionThread.joinable())
+    this->dataPtr->controlReceptionThread.join();
+  this->dataPtr->CloseUdpSocket();
+
+  // No more messages can be posted, stop running callbacks.
+  this->dataPtr->receptionExecutor.reset();
+  this->dataPtr->queueExecutor.reset();
+  this->dataPtr->replyExecutor.reset();
 
   // Wait for the authentication thread before exit.
   if (this->dataPtr->accessControlThread.joinable())
@@ -340,89 +891,499 @@ NodeShared::~NodeShared()
 //////////////////////////////////////////////////
 void NodeShared::RunReceptionTask()
 {
+  ThreadConfig::Global().Apply("ign-reception");
+
+  // Nothing to do until some data arrives, idle connections have to be
+  // evicted, or we are woken up.
   while (!this->dataPtr->exit)
+    this->ReceiveOnce(this->dataPtr->ReceptionTimeout());
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::ReceiveOnce(const std::chrono::milliseconds &_timeout)
+{
+  // Poll socket for a reply, with timeout.
+  zmq::pollitem_t items[] =
   {
-    // Poll socket for a reply, with timeout.
-    zmq::pollitem_t items[] =
+    {static_cast<void*>(*this->dataPtr->subscriber), 0, ZMQ_POLLIN, 0},
+    {static_cast<void*>(*this->dataPtr->wakeupReceiver), 0, ZMQ_POLLIN, 0},
+    {static_cast<void*>(*this->dataPtr->publisherMonitor), 0, ZMQ_POLLIN, 0},
+    {static_cast<void*>(*this->dataPtr->subscriberMonitor), 0, ZMQ_POLLIN, 0},
+    {nullptr, 0, ZMQ_POLLIN, 0},
+    {nullptr, 0, ZMQ_POLLIN, 0},
+    {nullptr, 0, ZMQ_POLLIN, 0}
+  };
+  size_t itemCount = 4;
+
+  // The sockets of the services are polled once they exist. The reception
+  // is woken up when they are created.
+  const bool services = this->dataPtr->servicesInitialized;
+  if (services)
+  {
+    items[itemCount++].socket = static_cast<void*>(*this->dataPtr->replier);
+    items[itemCount++].socket =
+      static_cast<void*>(*this->dataPtr->responseReceiver);
+  }
+  const size_t udpItem = itemCount;
+#ifndef _WIN32
+  // The socket of the best effort datagrams, if any.
+  if (this->dataPtr->udpSocket >= 0)
+  {
+    items[itemCount].fd = this->dataPtr->udpSocket;
+    ++itemCount;
+  }
+#endif
+  int ready = 0;
+  try
+  {
+    ready = zmq::poll(&items[0], itemCount, _timeout);
+  }
+  catch(...)
+  {
+    return false;
+  }
+
+  //  If we got a reply, process it.
+  if (items[0].revents & ZMQ_POLLIN)
+    this->RecvMsgUpdate();
+  if (items[1].revents & ZMQ_POLLIN)
+    receiveHelper(*this->dataPtr->wakeupReceiver);
+  if (items[2].revents & ZMQ_POLLIN)
+  {
+    NodeSharedPrivate::RecvMonitorEvent(*this->dataPtr->publisherMonitor,
+      this->dataPtr->subscriberConnections);
+  }
+  if (items[3].revents & ZMQ_POLLIN)
+  {
+    std::string endpoint;
+    if (NodeSharedPrivate::RecvMonitorEvent(*this->dataPtr->subscriberMonitor,
+          this->dataPtr->publisherConnections, &endpoint))
     {
-      {static_cast<void*>(*this->dataPtr->subscriber), 0, ZMQ_POLLIN, 0},
-      {static_cast<void*>(*this->dataPtr->replier), 0, ZMQ_POLLIN, 0},
-      {static_cast<void*>(*this->dataPtr->responseReceiver), 0, ZMQ_POLLIN, 0}
-    };
-    try
+      this->OnDataDisconnection(endpoint);
+    }
+  }
+  if (services && (items[4].revents & ZMQ_POLLIN))
+    this->RecvSrvRequest();
+  if (services && (items[5].revents & ZMQ_POLLIN))
+    this->RecvSrvResponse();
+  if (itemCount > udpItem && (items[udpItem].revents & ZMQ_POLLIN))
+    this->RecvDatagram();
+
+  this->dataPtr->EvictIdleConnections(this->srvMutex, this->verbose);
+
+  // The requests without responses are expired even if no other request is
+  // sent.
+  if (this->dataPtr->inFlightDeadlinesPending)
+  {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= this->dataPtr->nextRequestExpiry)
     {
-      zmq::poll(&items[0], sizeof(items) / sizeof(items[0]),
-          std::chrono::milliseconds(NodeSharedPrivate::Timeout));
+      this->dataPtr->nextRequestExpiry =
+        now + NodeSharedPrivate::kRequestExpiryPeriod;
+      std::lock_guard<std::recursive_mutex> lock(this->srvMutex);
+      this->ExpireRequests(now);
     }
-    catch(...)
+  }
+
+  this->SendPendingLatched();
+  this->dataPtr->SendPendingFragments(this->mutex, this->myAddress);
+  return ready > 0;
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::SpinOnce(const std::chrono::milliseconds &_timeout)
+{
+  if (!this->dataPtr->manualSpin)
+  {
+    // It's likely called in a loop, so it's reported once.
+    static std::atomic<bool> reported{false};
+    if (!reported.exchange(true))
     {
-      continue;
+      std::cerr << "NodeShared::SpinOnce(): The reception runs in a thread "
+                << "of the transport. See IGN_TRANSPORT_MANUAL_SPIN"
+                << std::endl;
     }
+    return false;
+  }
 
-    //  If we got a reply, process it.
-    if (items[0].revents & ZMQ_POLLIN)
-      this->RecvMsgUpdate();
-    if (items[1].revents & ZMQ_POLLIN)
-      this->RecvSrvRequest();
-    if (items[2].revents & ZMQ_POLLIN)
-      this->RecvSrvResponse();
+  // The local messages are dispatched first. They were published before
+  // the call, so the network isn't waited for if there are any.
+  int dispatched = 0;
+  while (dispatched < NodeSharedPrivate::kMaxLocalMsgsPerSpin &&
+         this->dataPtr->DispatchLocalMsg())
+  {
+    ++dispatched;
   }
+
+  std::chrono::milliseconds timeout = dispatched > 0 ?
+    std::chrono::milliseconds(0) : _timeout;
+  const auto internalTimeout = this->dataPtr->ReceptionTimeout();
+  if (internalTimeout.count() >= 0)
+    timeout = std::min(timeout, internalTimeout);
+
+  const bool received = this->ReceiveOnce(timeout);
+  return received || dispatched > 0;
 }
 
 //////////////////////////////////////////////////
-bool NodeShared::Publish(
-    const std::string &_topic,
-    char *_data,
-    const size_t _dataSize, DeallocFunc *_ffn,
-    const std::string &_msgType)
+std::vector<int> NodeShared::SpinDescriptors()
 {
-  try
+  std::vector<int> fds;
+  if (!this->dataPtr->manualSpin)
+    return fds;
+
+  for (zmq::socket_t *socket : {this->dataPtr->subscriber.get(),
+         this->dataPtr->replier.get(), this->dataPtr->responseReceiver.get(),
+         this->dataPtr->wakeupReceiver.get(),
+         this->dataPtr->publisherMonitor.get(),
+         this->dataPtr->subscriberMonitor.get()})
   {
-    // Create the messages.
-    // Note that we use zero copy for passing the message data (msg2).
-    zmq::message_t msg0(_topic.data(), _topic.size()),
-                   msg1(this->myAddress.data(), this->myAddress.size()),
-                   msg2(_data, _dataSize, _ffn, nullptr),
-                   msg3(_msgType.data(), _msgType.size());
-
-    // Send the messages
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    // The services are created with the node shared in this mode, unless
+    // they failed.
+    if (!socket)
+      continue;
 
-#ifdef IGN_ZMQ_POST_4_3_1
-    this->dataPtr->publisher->send(msg0, zmq::send_flags::sndmore);
-    this->dataPtr->publisher->send(msg1, zmq::send_flags::sndmore);
-    this->dataPtr->publisher->send(msg2, zmq::send_flags::sndmore);
+    try
+    {
+#ifdef IGN_CPPZMQ_POST_4_7_0
+      fds.push_back(static_cast<int>(socket->get(zmq::sockopt::fd)));
 #else
-    this->dataPtr->publisher->send(msg0, ZMQ_SNDMORE);
-    this->dataPtr->publisher->send(msg1, ZMQ_SNDMORE);
-    this->dataPtr->publisher->send(msg2, ZMQ_SNDMORE);
+#ifdef _WIN32
+      SOCKET fd;
+#else
+      int fd;
 #endif
-
-    if (this->dataPtr->topicStatsEnabled)
+      size_t fdSize = sizeof(fd);
+      socket->getsockopt(ZMQ_FD, &fd, &fdSize);
+      fds.push_back(static_cast<int>(fd));
+#endif
+    }
+    catch (const zmq::error_t &_e)
+    {
+      std::cerr << "NodeShared::SpinDescriptors(): " << _e.what()
+                << std::endl;
+    }
+  }
+
+#ifndef _WIN32
+  if (this->dataPtr->udpSocket >= 0)
+    fds.push_back(this->dataPtr->udpSocket);
+#endif
+  return fds;
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::Publish(
+    const std::string &_topic,
+    char *_data,
+    const size_t _dataSize, DeallocFunc *_ffn,
+    const std::string &_msgType,
+    void *_hint)
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  return this->Publish(_topic, _data, _dataSize, _ffn, _msgType, _hint, 0,
+    this->dataPtr->topicPubSeq[_topic]);
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::Publish(
+    const std::string &_topic,
+    char *_data,
+    const size_t _dataSize, DeallocFunc *_ffn,
+    const std::string &_msgType,
+    void *_hint,
+    const uint64_t _publisherId,
+    uint64_t &_seq)
+{
+  // The buffer is released on every path, including the errors.
+  PublishedBuffer owner(_data, _ffn, _hint);
+
+  try
+  {
+    // Topics advertised with a multicast group are sent once to the group,
+    // whatever the number of subscribers in it, and the best effort topics
+    // are sent as datagrams to the subscribers that asked for them. The
+    // publisher socket only carries them to the subscribers that receive
+    // them over TCP. The lock is held until all the copies are sent, so they
+    // have the same sequence number.
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    // The topics of a traffic class have a publisher socket of their own.
+    zmq::socket_t &socket = this->dataPtr->TopicSocket(_topic);
+    {
+      auto topicIt = this->dataPtr->dataTopics.find(_topic);
+      if (topicIt != this->dataPtr->dataTopics.end())
+      {
+        const auto &dataTopic = topicIt->second;
+
+        // All the copies carry the same sequence number.
+        PublicationMetadata meta;
+        meta.seq = _seq + 1;
+        meta.publisher = _publisherId;
+        stampMetadata(meta);
+
+        // The messages too big for a datagram go over TCP.
+        bool tcp = !dataTopic.tcpSubscribers.empty();
+        if (!dataTopic.udpSubscribers.empty() &&
+            !this->dataPtr->PublishDatagrams(dataTopic, _topic,
+              this->myAddress, _data, _dataSize, _msgType, meta))
+        {
+          tcp = true;
+        }
+
+        if (!tcp && dataTopic.socket)
+        {
+          zmq::message_t dataMsg(_data, _dataSize, _ffn, _hint);
+          owner.Release();
+          ++_seq;
+          this->dataPtr->PublishMulticast(*dataTopic.socket, _topic,
+            this->myAddress, dataMsg, _msgType, meta);
+          return true;
+        }
+
+        if (!tcp)
+        {
+          // The datagrams are copies, nobody else takes the buffer.
+          ++_seq;
+          owner.Free();
+          return true;
+        }
+
+        // The publisher socket releases the buffer, so this copy can't
+        // share it. The buffer must be handed to the publisher socket even
+        // if the group fails.
+        if (dataTopic.socket)
+        {
+          try
+          {
+            zmq::message_t dataMsg(_data, _dataSize);
+            this->dataPtr->PublishMulticast(*dataTopic.socket, _topic,
+              this->myAddress, dataMsg, _msgType, meta);
+          }
+          catch(const zmq::error_t &_error)
+          {
+            std::cerr << "NodeShared::Publish() Error: " << _error.what()
+                      << std::endl;
+          }
+        }
+      }
+    }
+
+    // The subscriber processes that asked for fewer messages get copies of
+    // their own, the publisher socket only sends the message to the rest.
+    auto limitedIt = this->dataPtr->rateLimitedTopics.find(_topic);
+    if (limitedIt != this->dataPtr->rateLimitedTopics.end())
+    {
+      PublicationMetadata meta;
+      meta.seq = _seq + 1;
+      meta.publisher = _publisherId;
+      stampMetadata(meta);
+      this->dataPtr->PublishRateLimited(limitedIt->second, _topic,
+        this->myAddress, _data, _dataSize, _msgType, meta);
+
+      if (!limitedIt->second.plainSubscribers)
+      {
+        ++_seq;
+        owner.Free();
+        return true;
+      }
+    }
+
+    // The large messages are sent in fragments by the reception thread. The
+    // buffer must outlive the call, so only the owned ones are fragmented.
+    const uint64_t fragmentSize = _ffn ?
+      this->dataPtr->FragmentSize(_topic, _dataSize) : 0;
+    if (fragmentSize != 0)
+    {
+      NodeSharedPrivate::FragmentedMsg msg;
+      msg.topic = _topic;
+      msg.msgType = _msgType;
+      msg.meta.seq = ++_seq;
+      msg.meta.publisher = _publisherId;
+      stampMetadata(msg.meta);
+      msg.buffer = std::make_shared<NodeSharedPrivate::FragmentBuffer>();
+      msg.buffer->data = _data;
+      msg.buffer->size = _dataSize;
+      msg.buffer->ffn = _ffn;
+      msg.buffer->hint = _hint;
+      owner.Release();
+      msg.fragmentSize = fragmentSize;
+
+      IGN_TRANSPORT_TRACEPOINT(send, _topic.c_str(), this->myAddress.c_str(),
+        msg.meta.seq, currentTraceId(), _dataSize);
+      this->dataPtr->QueueFragments(std::move(msg));
+      return true;
+    }
+
+    // The messages of the topics advertised with compression are compressed
+    // once for all the remote subscribers, in a pooled buffer that replaces
+    // the one of the message. The local subscribers already got the
+    // message as it is.
+    char *data = _data;
+    size_t dataSize = _dataSize;
+    DeallocFunc *ffn = _ffn;
+    void *hint = _hint;
+    CompressionHeader compression;
+    const Compression_t method = this->dataPtr->Compression(_topic, _dataSize);
+    if (method != Compression_t::NONE)
+    {
+      const std::size_t bound = CompressBound(method, _dataSize);
+      auto buffer = this->dataPtr->bufferPool->Acquire(bound);
+      std::size_t compressedSize = 0;
+      if (Compress(method, _data, _dataSize, buffer.get(), bound,
+            compressedSize))
+      {
+        compression.method = static_cast<uint8_t>(method);
+        compression.size = _dataSize;
+        data = buffer.get();
+        dataSize = compressedSize;
+        ffn = [](void *, void *_bufferHint)
+        {
+          delete static_cast<std::shared_ptr<char[]> *>(_bufferHint);
+        };
+        hint = new std::shared_ptr<char[]>(std::move(buffer));
+        owner.Reset(data, ffn, hint);
+      }
+    }
+    const bool compressed = compression.method != 0;
+    char compressionFrame[kCompressionHeaderSize];
+    PackCompressionHeader(compression, compressionFrame);
+
+    // The frames of the publisher are shared, only the data and the
+    // metadata are built for each message.
+    NodeSharedPrivate::HeaderFrames &frames = this->dataPtr->PublisherFrames(
+      _publisherId, _topic, _msgType, this->myAddress);
+
+    if (this->dataPtr->CompactHeader(_topic) && !frames.compactHeader.empty())
+    {
+      // Note that we use zero copy for passing the message data.
+      zmq::message_t topicMsg,
+                     dataMsg(data, dataSize, ffn, hint),
+                     headerMsg;
+      owner.Release();
+      NodeSharedPrivate::CopyFrame(frames.topicFrame, topicMsg);
+
+      // The compact header always carries the metadata, so the subscribers
+      // can detect the messages lost on any topic.
+      PublicationMetadata meta;
+      meta.seq = ++_seq;
+      meta.publisher = _publisherId;
+      stampMetadata(meta);
+
+      NodeSharedPrivate::PackHeader(frames, meta, headerMsg);
+
+      IGN_TRANSPORT_TRACEPOINT(send, _topic.c_str(), this->myAddress.c_str(),
+        meta.seq, currentTraceId(), _dataSize);
+
+      // The sequence number was consumed anyway, so the subscribers see
+      // the drop.
+      if (!this->dataPtr->SendFirstFrame(socket, topicMsg, _topic))
+        return true;
+
+      this->dataPtr->CountTraffic(this->dataPtr->sentTraffic,
+        "ign_transport_sent", _topic, dataSize);
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      socket.send(headerMsg, zmq::send_flags::sndmore);
+      if (compressed)
+      {
+        zmq::message_t compressionMsg(compressionFrame,
+          sizeof(compressionFrame));
+        socket.send(dataMsg, zmq::send_flags::sndmore);
+        socket.send(compressionMsg, zmq::send_flags::none);
+      }
+      else
+        socket.send(dataMsg, zmq::send_flags::none);
+#else
+      socket.send(headerMsg, ZMQ_SNDMORE);
+      if (compressed)
+      {
+        zmq::message_t compressionMsg(compressionFrame,
+          sizeof(compressionFrame));
+        socket.send(dataMsg, ZMQ_SNDMORE);
+        socket.send(compressionMsg, 0);
+      }
+      else
+        socket.send(dataMsg, 0);
+#endif
+      return true;
+    }
+
+    // Create the messages.
+    // Note that we use zero copy for passing the message data (msg2).
+    zmq::message_t msg0, msg1, msg2(data, dataSize, ffn, hint), msg3;
+    owner.Release();
+    NodeSharedPrivate::CopyFrame(frames.topicFrame, msg0);
+    NodeSharedPrivate::CopyFrame(frames.addressFrame, msg1);
+    NodeSharedPrivate::CopyFrame(frames.typeFrame, msg3);
+
+    // Send the messages
+    if (!this->dataPtr->SendFirstFrame(socket, msg0, _topic))
+    {
+      ++_seq;
+      return true;
+    }
+
+    this->dataPtr->CountTraffic(this->dataPtr->sentTraffic,
+      "ign_transport_sent", _topic, dataSize);
+
+#ifdef IGN_ZMQ_POST_4_3_1
+    socket.send(msg1, zmq::send_flags::sndmore);
+    socket.send(msg2, zmq::send_flags::sndmore);
+#else
+    socket.send(msg1, ZMQ_SNDMORE);
+    socket.send(msg2, ZMQ_SNDMORE);
+#endif
+
+    // Older subscribers don't expect an extra frame, so the metadata is only
+    // sent when all of them read it. The compression frame follows it, so
+    // the compressed messages always carry it.
+    if (compressed || this->dataPtr->SendMetadata(_topic))
     {
       // Create publication metadata.
       PublicationMetadata meta;
       // Send the sequence number, which can be used to detect dropped
       // messages.
-      meta.seq = this->dataPtr->topicPubSeq[_topic]++;
+      meta.seq = ++_seq;
+      meta.publisher = _publisherId;
       // Send the publication time.
-      meta.stamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::steady_clock::now().time_since_epoch()).count();
+      stampMetadata(meta);
       zmq::message_t msg4(&meta, sizeof(meta));
+      IGN_TRANSPORT_TRACEPOINT(send, _topic.c_str(), this->myAddress.c_str(),
+        meta.seq, currentTraceId(), _dataSize);
 #ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->publisher->send(msg3, zmq::send_flags::sndmore);
-      this->dataPtr->publisher->send(msg4, zmq::send_flags::none);
+      socket.send(msg3, zmq::send_flags::sndmore);
+      if (compressed)
+      {
+        zmq::message_t msg5(compressionFrame, sizeof(compressionFrame));
+        socket.send(msg4, zmq::send_flags::sndmore);
+        socket.send(msg5, zmq::send_flags::none);
+      }
+      else
+        socket.send(msg4, zmq::send_flags::none);
 #else
-      this->dataPtr->publisher->send(msg3, ZMQ_SNDMORE);
-      this->dataPtr->publisher->send(msg4, 0);
+      socket.send(msg3, ZMQ_SNDMORE);
+      if (compressed)
+      {
+        zmq::message_t msg5(compressionFrame, sizeof(compressionFrame));
+        socket.send(msg4, ZMQ_SNDMORE);
+        socket.send(msg5, 0);
+      }
+      else
+        socket.send(msg4, 0);
 #endif
     }
     else
     {
+      // Keep counting, so the gaps seen by the subscribers that ask for the
+      // metadata later are real losses.
+      ++_seq;
+      IGN_TRANSPORT_TRACEPOINT(send, _topic.c_str(), this->myAddress.c_str(),
+        _seq, currentTraceId(), _dataSize);
 #ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->publisher->send(msg3, zmq::send_flags::none);
+      socket.send(msg3, zmq::send_flags::none);
 #else
-      this->dataPtr->publisher->send(msg3, 0);
+      socket.send(msg3, 0);
 #endif
     }
   }
@@ -438,193 +1399,710 @@ bool NodeShared::Publish(
 //////////////////////////////////////////////////
 void NodeShared::RecvMsgUpdate()
 {
-  zmq::message_t msg(0);
-  std::string topic;
-  std::string sender;
-  std::string data;
-  std::string msgType;
-  HandlerInfo handlerInfo;
+  ReceivedMessage received;
 
   {
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    // Only the subscriber socket needs to be protected while we receive and
+    // decode the frames. NodeShared::mutex is not held here.
+    std::lock_guard<std::mutex> lock(this->dataPtr->subscriberMutex);
+    if (!this->dataPtr->RecvMessage(*this->dataPtr->subscriber, this->pUuid,
+          received))
+    {
+      return;
+    }
+  }
+
+  this->DeliverMsg(received);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::RunControlReceptionTask()
+{
+  ThreadConfig::Global().Apply("ign-control");
 
+  while (!this->dataPtr->exit)
+  {
+    zmq::pollitem_t items[] =
+    {
+      {static_cast<void*>(*this->dataPtr->controlSubscriber), 0, ZMQ_POLLIN,
+        0},
+      {static_cast<void*>(*this->dataPtr->controlWakeupReceiver), 0,
+        ZMQ_POLLIN, 0}
+    };
     try
     {
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->subscriber->recv(msg))
-#else
-      if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-        return;
-      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
-
-      // TODO(caguero): Use this as extra metadata for the subscriber.
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->subscriber->recv(msg))
-#else
-      if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-        return;
-      sender = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      // Woken up when it's time to exit.
+      zmq::poll(&items[0], 2, std::chrono::milliseconds(-1));
+    }
+    catch(...)
+    {
+      continue;
+    }
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->subscriber->recv(msg))
-#else
-      if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-        return;
-      data = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+    if (items[1].revents & ZMQ_POLLIN)
+      receiveHelper(*this->dataPtr->controlWakeupReceiver);
 
-#ifdef IGN_ZMQ_POST_4_3_1
-      if (!this->dataPtr->subscriber->recv(msg))
-#else
-      if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-        return;
-      msgType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+    if (!(items[0].revents & ZMQ_POLLIN))
+      continue;
 
-      if (this->dataPtr->topicStatsEnabled)
+    ReceivedMessage received;
+    received.control = true;
+    {
+      std::lock_guard<std::mutex> lock(this->dataPtr->subscriberMutex);
+      if (!this->dataPtr->RecvMessage(*this->dataPtr->controlSubscriber,
+            this->pUuid, received))
       {
-#ifdef IGN_ZMQ_POST_4_3_1
-        if (!this->dataPtr->subscriber->recv(msg))
-#else
-        if (!this->dataPtr->subscriber->recv(&msg, 0))
-#endif
-          return;
-        PublicationMetadata *meta =
-          reinterpret_cast<PublicationMetadata *>(msg.data());
-
-        // Update topic statistics.
-        if (this->dataPtr->enabledTopicStatistics.find(topic) !=
-            this->dataPtr->enabledTopicStatistics.end())
-        {
-          this->dataPtr->topicStats[topic].Update(sender,
-              meta->stamp, meta->seq);
-          this->dataPtr->enabledTopicStatistics[topic](
-              this->dataPtr->topicStats[topic]);
-        }
+        continue;
       }
     }
-    catch(const zmq::error_t &_error)
-    {
-      std::cerr << "Error: " << _error.what() << std::endl;
-      return;
-    }
 
-    handlerInfo = this->CheckHandlerInfo(topic);
+    this->DeliverMsg(received);
   }
-
-  MessageInfo info;
-  info.SetTopicAndPartition(topic);
-  info.SetType(msgType);
-  this->TriggerCallbacks(info, data, handlerInfo);
 }
 
 //////////////////////////////////////////////////
-NodeShared::HandlerInfo NodeShared::CheckHandlerInfo(
-    const std::string &_topic) const
+void NodeShared::RecvDatagram()
 {
-  HandlerInfo info;
+  auto &buffer = this->dataPtr->datagramIn;
+  buffer.resize(kMaxDatagramSize);
 
-  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+  // Drain the socket, the datagrams don't wake up the poll one by one.
+  for (;;)
+  {
+    ReceivedMessage received;
+    received.receptionSystemTime = std::chrono::system_clock::now();
+#ifndef _WIN32
+    iovec iov;
+    iov.iov_base = buffer.data();
+    iov.iov_len = buffer.size();
+    msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+#ifdef SO_TIMESTAMPNS
+    // The kernel tells when the datagram arrived.
+    char control[CMSG_SPACE(sizeof(timespec))];
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+#endif
+    const ssize_t size = recvmsg(this->dataPtr->udpSocket, &header,
+      MSG_DONTWAIT);
+#else
+    const int size = -1;
+#endif
+    if (size <= 0)
+      return;
 
-  info.haveLocal = this->localSubscribers.normal.Handlers(
-        _topic, info.localHandlers);
+#if !defined(_WIN32) && defined(SO_TIMESTAMPNS)
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&header); cmsg;
+         cmsg = CMSG_NXTHDR(&header, cmsg))
+    {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS)
+        continue;
+      timespec stamp;
+      memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+      received.receptionSystemTime = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::seconds(stamp.tv_sec) +
+          std::chrono::nanoseconds(stamp.tv_nsec)));
+    }
+#endif
 
-  info.haveRaw = this->localSubscribers.raw.Handlers(
-        _topic, info.rawHandlers);
+    received.receptionTime = std::chrono::steady_clock::now();
+    if (NodeSharedPrivate::callbackTracing)
+      received.received = received.receptionTime;
 
-  return info;
+    if (!NodeSharedPrivate::UnpackDatagram(buffer.data(),
+          static_cast<size_t>(size), received.topic, received.sender,
+          received.msgType, received.meta, received.payload))
+    {
+      continue;
+    }
+    received.haveMeta = true;
+
+    this->dataPtr->receivedMsgs.fetch_add(1, std::memory_order_relaxed);
+    this->dataPtr->CountTraffic(this->dataPtr->recvTraffic,
+      "ign_transport_received", received.topic, received.payload.size());
+    this->DeliverMsg(received);
+  }
 }
 
 //////////////////////////////////////////////////
-NodeShared::SubscriberInfo NodeShared::CheckSubscriberInfo(
-    const std::string &_topic,
-    const std::string &_msgType) const
+void NodeShared::DeliverMsg(ReceivedMessage &_msg)
 {
-  SubscriberInfo info;
+  const std::string &topic = _msg.topic;
+  const std::string &sender = _msg.sender;
+  const std::string &msgType = _msg.msgType;
+  const PublicationMetadata &meta = _msg.meta;
+  const bool haveMeta = _msg.haveMeta;
+  const auto received = _msg.received;
+
+  // The fragments of a large message are delivered once it's complete.
+  if (_msg.fragment)
+  {
+    const auto handlerInfo = this->SubscriberSnapshot(topic, msgType);
+    if (!handlerInfo->haveLocal && !handlerInfo->haveRaw)
+      return;
 
-  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+    const uint64_t total = _msg.fragmentHeader.total;
+    uint64_t receivedBytes = 0;
+    const bool complete = this->dataPtr->Reassemble(_msg, receivedBytes);
+    if (receivedBytes > 0)
+    {
+      MessageInfo info;
+      info.SetTopicAndPartition(topic);
+      info.SetType(msgType);
+      info.SetPublisherAddress(sender);
+      for (const auto &node : handlerInfo->localHandlers)
+      {
+        for (const auto &handler : node.second)
+          handler.second->ReportProgress(info, receivedBytes, total);
+      }
+      for (const auto &node : handlerInfo->rawHandlers)
+      {
+        for (const auto &handler : node.second)
+          handler.second->ReportProgress(info, receivedBytes, total);
+      }
+    }
 
-  info.haveLocal = this->localSubscribers.normal.Handlers(
-        _topic, info.localHandlers);
+    if (!complete)
+      return;
+  }
 
-  info.haveRaw = this->localSubscribers.raw.Handlers(
-        _topic, info.rawHandlers);
+  const uint64_t traceId = nextTraceId();
+  IGN_TRANSPORT_TRACEPOINT(receive, topic.c_str(), sender.c_str(),
+    haveMeta ? meta.seq : 0, traceId, _msg.payload.size());
 
-  info.haveRemote = this->remoteSubscribers.HasTopic(
-        _topic, _msgType);
+  if (haveMeta)
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
 
-  return info;
-}
+    // Update topic statistics. Their callback is run by statsThread.
+    auto statsIt = this->dataPtr->enabledTopicStatistics.find(topic);
+    if (statsIt != this->dataPtr->enabledTopicStatistics.end())
+    {
+      // The sequence numbers are counted by each publisher of the sender.
+      this->dataPtr->topicStats[topic].Update(meta.publisher == 0 ? sender :
+        sender + "#" + std::to_string(meta.publisher), meta.stamp, meta.seq);
+      this->dataPtr->NotifyStats(statsIt->second);
+    }
+  }
 
-//////////////////////////////////////////////////
-void NodeShared::TriggerCallbacks(
-    const MessageInfo &_info,
-    const std::string &_msgData,
-    const HandlerInfo &_handlerInfo)
-{
-  if (!_handlerInfo.haveLocal && !_handlerInfo.haveRaw)
+  const auto handlerInfo = this->SubscriberSnapshot(topic, msgType);
+  if (!handlerInfo->haveLocal && !handlerInfo->haveRaw)
     return;
 
-  if (_handlerInfo.haveRaw)
+  // Reuse the message information previously decomposed for this topic.
+  // Each reception thread has its own.
+  auto &recvInfoCache = _msg.control ?
+    this->dataPtr->controlRecvInfoCache : this->dataPtr->recvInfoCache;
+
+  // Forget the topics whose local subscribers are gone.
+  uint64_t &swept = _msg.control ?
+    this->dataPtr->controlRecvInfoSwept : this->dataPtr->recvInfoSwept;
+  const uint64_t generation = this->dataPtr->recvInfoGeneration;
+  if (swept != generation)
   {
-    for (const auto &node : _handlerInfo.rawHandlers)
+    swept = generation;
+    std::lock_guard<std::recursive_mutex> lk(this->mutex);
+    for (auto it = recvInfoCache.begin(); it != recvInfoCache.end();)
     {
-      for (const auto &handler : node.second)
+      if (this->localSubscribers.normal.HasHandlersForTopic(it->first) ||
+          this->localSubscribers.raw.HasHandlersForTopic(it->first))
       {
-        const RawSubscriptionHandlerPtr &rawHandler = handler.second;
-        if (rawHandler)
-        {
-          if (rawHandler->TypeName() == _info.Type() ||
-              rawHandler->TypeName() == kGenericMessageType)
-          {
-            rawHandler->RunRawCallback(_msgData.c_str(), _msgData.size(),
-                _info);
-          }
-        }
-        else
-          std::cerr << "Raw subscription handler is NULL" << std::endl;
+        ++it;
+      }
+      else
+      {
+        it = recvInfoCache.erase(it);
       }
     }
   }
 
-  if (_handlerInfo.haveLocal)
+  auto infoIt = recvInfoCache.find(topic);
+  if (infoIt == recvInfoCache.end())
   {
-    // This will be instantiated by the first suitable handler that we
-    // encounter. If there is no suitable handler, then we can avoid
-    // deserializing the message altogether.
-    std::shared_ptr<ProtoMsg> msg;
-
-    for (const auto &node : _handlerInfo.localHandlers)
+    NodeSharedPrivate::RecvTopic newTopic;
+    newTopic.info.SetTopicAndPartition(topic);
+    newTopic.info.SetType(msgType);
+    infoIt = recvInfoCache.emplace(topic, std::move(newTopic)).first;
+  }
+  else if (infoIt->second.info.Type() != msgType)
+  {
+    infoIt->second.info.SetType(msgType);
+  }
+  if (infoIt->second.info.PublisherAddress() != sender)
+    infoIt->second.info.SetPublisherAddress(sender);
+  infoIt->second.info.SetReceptionTime(_msg.receptionTime);
+  infoIt->second.info.SetReceptionSystemTime(_msg.receptionSystemTime);
+
+  // The publication times travel with the metadata.
+  infoIt->second.info.SetSendTime(std::chrono::steady_clock::time_point(
+    std::chrono::nanoseconds(haveMeta ? meta.stamp : 0)));
+  infoIt->second.info.SetSendSystemTime(std::chrono::system_clock::time_point(
+    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+      std::chrono::nanoseconds(haveMeta ? meta.systemStamp : 0))));
+
+  // Detect the messages lost since the previous one of the same publisher.
+  if (haveMeta && meta.publisher != 0)
+  {
+    auto &lastSeqs = infoIt->second.lastSeq;
+    auto &subscribers = infoIt->second.subscribers;
+    if (subscribers.owner_before(handlerInfo) ||
+        handlerInfo.owner_before(subscribers))
     {
-      for (const auto &handler : node.second)
-      {
-        const ISubscriptionHandlerPtr &localHandler = handler.second;
-        if (localHandler)
-        {
-          if (localHandler->TypeName() == _info.Type() ||
-              localHandler->TypeName() == kGenericMessageType)
-          {
-            if (!msg)
-            {
-              // If the message has not been deserialized yet, do it now since
-              // we have allegedly found a subscriber which should be able to
-              // do it.
-              msg = localHandler->CreateMsg(_msgData, _info.Type());
+      lastSeqs.clear();
+      subscribers = handlerInfo;
+    }
 
-              if (!msg)
-              {
-                // If the message could not be created, then none of the
-                // handlers in this process will be able to create it, because
-                // protobuf has access to all message types that the current
-                // process is linked to. If CreateMsg(~,~) fails, then we may
-                // as well quit.
+    auto senderIt = lastSeqs.find(sender);
+    if (senderIt == lastSeqs.end())
+      senderIt = lastSeqs.emplace(sender, std::map<uint64_t, uint64_t>()).first;
+
+    uint64_t &lastSeq = senderIt->second[meta.publisher];
+
+    // A copy of a message already received, e.g.: from the multicast group
+    // of the topic and over TCP, or a datagram overtaken by a newer one.
+    if (lastSeq != 0 && meta.seq <= lastSeq)
+      return;
+
+    if (lastSeq != 0 && meta.seq > lastSeq + 1)
+      addDroppedMsgs(*handlerInfo, msgType, meta.seq - lastSeq - 1);
+    lastSeq = meta.seq;
+  }
+
+  if (this->dataPtr->receptionExecutor)
+  {
+    // Run the callbacks in the executor. The payload and message information
+    // must be kept alive until then.
+    auto payloadPtr = std::make_shared<zmq::message_t>(
+      std::move(_msg.payload));
+    MessageInfo info(infoIt->second.info);
+    this->dataPtr->receptionExecutor->Post(topic,
+      [this, payloadPtr, info, handlerInfo, received, traceId]()
+      {
+        TraceIdScope traceScope(traceId);
+        this->TriggerCallbacks(info,
+          reinterpret_cast<const char *>(payloadPtr->data()),
+          payloadPtr->size(), *handlerInfo, received);
+      });
+    return;
+  }
+
+  TraceIdScope traceScope(traceId);
+  this->TriggerCallbacks(infoIt->second.info,
+    reinterpret_cast<const char *>(_msg.payload.data()), _msg.payload.size(),
+    *handlerInfo, received);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::DeliverLatched(const std::string &_topic,
+    const ISubscriptionHandlerPtr &_handler)
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  auto topicIt = this->dataPtr->latchedTopics.find(_topic);
+  if (!_handler || topicIt == this->dataPtr->latchedTopics.end())
+    return;
+
+  for (const auto &latched : topicIt->second.msgs)
+  {
+    const NodeSharedPrivate::LatchedMsg &msg = latched.second;
+    if (!_handler->AcceptsType(msg.msgType))
+      continue;
+
+    auto parsed = _handler->CreateMsg(msg.buffer.get(), msg.size,
+      msg.msgType);
+    if (!parsed)
+      continue;
+
+    std::unique_ptr<NodeSharedPrivate::PublishMsgDetails> details(
+      new NodeSharedPrivate::PublishMsgDetails);
+    details->traceId = nextTraceId();
+    details->info.SetTopicAndPartition(_topic);
+    details->info.SetType(msg.msgType);
+    details->info.SetIntraProcess(true);
+    details->info.SetReceptionTime(std::chrono::steady_clock::now());
+    details->sharedBuffer = std::const_pointer_cast<char[]>(msg.buffer);
+    details->msgSize = msg.size;
+
+    details->msgCopy = std::move(parsed);
+    details->localHandlers.push_back(_handler);
+
+    details->published = NodeSharedPrivate::TraceNow();
+    this->dataPtr->localQueued->Add();
+    this->dataPtr->pubQueue.Push(std::move(details));
+    if (this->dataPtr->manualSpin)
+      this->dataPtr->WakeUpReception();
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::DeliverLatched(const std::string &_topic,
+    const RawSubscriptionHandlerPtr &_handler)
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  auto topicIt = this->dataPtr->latchedTopics.find(_topic);
+  if (!_handler || topicIt == this->dataPtr->latchedTopics.end())
+    return;
+
+  for (const auto &latched : topicIt->second.msgs)
+  {
+    const NodeSharedPrivate::LatchedMsg &msg = latched.second;
+    if (!_handler->AcceptsType(msg.msgType))
+      continue;
+
+    std::unique_ptr<NodeSharedPrivate::PublishMsgDetails> details(
+      new NodeSharedPrivate::PublishMsgDetails);
+    details->traceId = nextTraceId();
+    details->info.SetTopicAndPartition(_topic);
+    details->info.SetType(msg.msgType);
+    details->info.SetIntraProcess(true);
+    details->info.SetReceptionTime(std::chrono::steady_clock::now());
+
+    // The raw handlers only read the buffer.
+    details->sharedBuffer = std::const_pointer_cast<char[]>(msg.buffer);
+    details->msgSize = msg.size;
+    details->rawHandlers.push_back(_handler);
+
+    details->published = NodeSharedPrivate::TraceNow();
+    this->dataPtr->localQueued->Add();
+    this->dataPtr->pubQueue.Push(std::move(details));
+    if (this->dataPtr->manualSpin)
+      this->dataPtr->WakeUpReception();
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::SendLatched(const std::string &_topic)
+{
+  auto topicIt = this->dataPtr->latchedTopics.find(_topic);
+  if (topicIt == this->dataPtr->latchedTopics.end())
+    return;
+
+  // Zmq will call this lambda when the message is published, to release
+  // our reference to the buffer, which is passed as the hint.
+  auto myDeallocator = [](void *, void *_hint)
+  {
+    delete static_cast<std::shared_ptr<const char[]> *>(_hint);
+  };
+
+  for (const auto &latched : topicIt->second.msgs)
+  {
+    const NodeSharedPrivate::LatchedMsg &msg = latched.second;
+
+    // Publish() sends the next sequence number.
+    uint64_t seq = msg.seq - 1;
+    auto *hint = new std::shared_ptr<const char[]>(msg.buffer);
+    this->Publish(_topic, const_cast<char *>(msg.buffer.get()), msg.size,
+      myDeallocator, msg.msgType, hint, latched.first, seq);
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::SendPendingLatched()
+{
+  if (!this->dataPtr->latchedResendsPending)
+    return;
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  const auto now = std::chrono::steady_clock::now();
+  auto &resends = this->dataPtr->latchedResends;
+  for (auto it = resends.begin(); it != resends.end();)
+  {
+    if (it->due > now)
+    {
+      ++it;
+      continue;
+    }
+
+    this->SendLatched(it->topic);
+    it = resends.erase(it);
+  }
+  this->dataPtr->latchedResendsPending = !resends.empty();
+}
+
+//////////////////////////////////////////////////
+NodeShared::HandlerInfo NodeShared::CheckHandlerInfo(
+    const std::string &_topic) const
+{
+  HandlerInfo info;
+
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+
+  info.haveLocal = this->localSubscribers.normal.Handlers(
+        _topic, info.localHandlers);
+
+  info.haveRaw = this->localSubscribers.raw.Handlers(
+        _topic, info.rawHandlers);
+
+  return info;
+}
+
+//////////////////////////////////////////////////
+NodeShared::SubscriberInfo NodeShared::CheckSubscriberInfo(
+    const std::string &_topic,
+    const std::string &_msgType) const
+{
+  SubscriberInfo info;
+
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+
+  info.haveLocal = this->localSubscribers.normal.Handlers(
+        _topic, info.localHandlers);
+
+  info.haveRaw = this->localSubscribers.raw.Handlers(
+        _topic, info.rawHandlers);
+
+  info.haveRemote = this->remoteSubscribers.HasTopic(
+        _topic, _msgType);
+
+  return info;
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<const NodeShared::SubscriberInfo>
+NodeShared::SubscriberSnapshot(
+    const std::string &_topic,
+    const std::string &_msgType) const
+{
+  // Fast path: the snapshot is already cached.
+  {
+    const auto snapshots = std::atomic_load(
+      &this->dataPtr->subscriberSnapshots);
+    const auto topicIt = snapshots->find(_topic);
+    if (topicIt != snapshots->end())
+      return topicIt->second.Get(_msgType);
+  }
+
+  // Slow path: build the snapshot of the topic, whatever the type. Holding
+  // the mutex guarantees that no subscriber is added or removed in the
+  // meantime.
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+
+  // Another thread may have built it while we waited for the mutex.
+  const auto current = std::atomic_load(&this->dataPtr->subscriberSnapshots);
+  const auto topicIt = current->find(_topic);
+  if (topicIt != current->end())
+    return topicIt->second.Get(_msgType);
+
+  NodeSharedPrivate::TopicSnapshot snapshot;
+  SubscriberInfo info;
+  info.haveLocal = this->localSubscribers.normal.Handlers(
+        _topic, info.localHandlers);
+  info.haveRaw = this->localSubscribers.raw.Handlers(
+        _topic, info.rawHandlers);
+  info.haveRemote = false;
+
+  std::map<std::string, std::vector<MessagePublisher>> remotes;
+  if (this->remoteSubscribers.Publishers(_topic, remotes))
+  {
+    for (const auto &proc : remotes)
+    {
+      for (const auto &pub : proc.second)
+      {
+        if (pub.MsgTypeName() == kGenericMessageType)
+          snapshot.anyRemoteType = true;
+        else
+          snapshot.remoteTypes.insert(pub.MsgTypeName());
+      }
+    }
+  }
+
+  if (snapshot.anyRemoteType || !snapshot.remoteTypes.empty())
+  {
+    SubscriberInfo remoteInfo = info;
+    remoteInfo.haveRemote = true;
+    snapshot.withRemote =
+      std::make_shared<const SubscriberInfo>(std::move(remoteInfo));
+  }
+  snapshot.withoutRemote = std::make_shared<const SubscriberInfo>(
+    std::move(info));
+
+  auto updated =
+    std::make_shared<NodeSharedPrivate::SubscriberSnapshots>(*current);
+  auto &entry = (*updated)[_topic];
+  entry = std::move(snapshot);
+  const auto result = entry.Get(_msgType);
+  std::atomic_store(&this->dataPtr->subscriberSnapshots,
+    std::shared_ptr<const NodeSharedPrivate::SubscriberSnapshots>(
+      std::move(updated)));
+
+  return result;
+}
+
+//////////////////////////////////////////////////
+void NodeShared::InvalidateSubscriberSnapshot(const std::string &_topic)
+{
+  std::lock_guard<std::recursive_mutex> lk(this->mutex);
+
+  // The reception threads keep the state of the topics received while
+  // they have local subscribers.
+  if (!this->localSubscribers.normal.HasHandlersForTopic(_topic) &&
+      !this->localSubscribers.raw.HasHandlersForTopic(_topic))
+  {
+    ++this->dataPtr->recvInfoGeneration;
+  }
+
+  const auto current = std::atomic_load(&this->dataPtr->subscriberSnapshots);
+  if (current->find(_topic) == current->end())
+    return;
+
+  auto updated =
+    std::make_shared<NodeSharedPrivate::SubscriberSnapshots>(*current);
+  updated->erase(_topic);
+  std::atomic_store(&this->dataPtr->subscriberSnapshots,
+    std::shared_ptr<const NodeSharedPrivate::SubscriberSnapshots>(
+      std::move(updated)));
+}
+
+//////////////////////////////////////////////////
+void NodeShared::TriggerCallbacks(
+    const MessageInfo &_info,
+    const std::string &_msgData,
+    const HandlerInfo &_handlerInfo)
+{
+  this->TriggerCallbacks(_info, _msgData.data(), _msgData.size(),
+    _handlerInfo);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::TriggerCallbacks(
+    const MessageInfo &_info,
+    const char *_msgData,
+    const size_t _size,
+    const HandlerInfo &_handlerInfo,
+    const std::chrono::steady_clock::time_point &_received)
+{
+  if (!_handlerInfo.haveLocal && !_handlerInfo.haveRaw)
+    return;
+
+  // The deferred callbacks carry the id of the message with them.
+  const uint64_t traceId = currentTraceId();
+  IGN_TRANSPORT_TRACEPOINT(trigger_callbacks, _info.Topic().c_str(), traceId);
+
+  if (_handlerInfo.haveRaw)
+  {
+    // Copy of the data for the raw handlers with a keep last queue.
+    std::shared_ptr<const std::string> rawData;
+
+    for (const auto &node : _handlerInfo.rawHandlers)
+    {
+      for (const auto &handler : node.second)
+      {
+        const RawSubscriptionHandlerPtr &rawHandler = handler.second;
+        if (rawHandler)
+        {
+          // The throttled handlers skip the message before it's copied.
+          if (rawHandler->AcceptsType(_info.Type()) &&
+              rawHandler->ThrottledUpdateReady() &&
+              !rawHandler->Expired(_info) &&
+              rawHandler->Filter(_msgData, _size, _info))
+          {
+            if (rawHandler->Deferred())
+            {
+              // The data has to outlive this call.
+              if (!rawData)
+              {
+                IGN_TRANSPORT_COUNT_ALLOCATION(_size);
+                IGN_TRANSPORT_COUNT_COPY(_size);
+                rawData = std::make_shared<std::string>(_msgData, _size);
+              }
+
+              this->dataPtr->QueueExecutor().Post(rawHandler->ExecutorKey(),
+                [rawHandler, rawData, _info, _received, traceId]()
+                {
+                  // The message may have expired while it was queued.
+                  if (rawHandler->Expired(_info))
+                    return;
+                  TraceIdScope traceScope(traceId);
+                  tracedCallback(*rawHandler, _received, [&]
+                  {
+                    rawHandler->RunRawCallback(rawData->data(),
+                      rawData->size(), _info);
+                  });
+                }, static_cast<std::size_t>(rawHandler->QueueSize()),
+                rawHandler->HandlerUuid());
+            }
+            else
+            {
+              tracedCallback(*rawHandler, _received, [&]
+              {
+                rawHandler->RunRawCallback(_msgData, _size, _info);
+              });
+            }
+          }
+        }
+        else
+          std::cerr << "Raw subscription handler is NULL" << std::endl;
+      }
+    }
+  }
+
+  if (_handlerInfo.haveLocal)
+  {
+    // This will be instantiated by the first suitable handler that we
+    // encounter. If there is no suitable handler, then we can avoid
+    // deserializing the message altogether.
+    std::shared_ptr<ProtoMsg> msg;
+
+    for (const auto &node : _handlerInfo.localHandlers)
+    {
+      for (const auto &handler : node.second)
+      {
+        const ISubscriptionHandlerPtr &localHandler = handler.second;
+        if (localHandler)
+        {
+          // The throttling and the filter are evaluated before deserializing
+          // the message, so it's not parsed if no handler wants it. The
+          // callback still checks the throttling, which may have changed.
+          if (localHandler->AcceptsType(_info.Type()) &&
+              localHandler->ThrottledUpdateReady() &&
+              !localHandler->Expired(_info) &&
+              localHandler->Filter(_msgData, _size, _info))
+          {
+            if (!msg)
+            {
+              // If the message has not been deserialized yet, do it now since
+              // we have allegedly found a subscriber which should be able to
+              // do it.
+              IGN_TRANSPORT_COUNT_ALLOCATION(_size);
+              msg = localHandler->CreateMsg(_msgData, _size, _info.Type());
+
+              if (!msg)
+              {
+                // If the message could not be created, then none of the
+                // handlers in this process will be able to create it, because
+                // protobuf has access to all message types that the current
+                // process is linked to. If CreateMsg(~,~) fails, then we may
+                // as well quit.
                 return;
               }
             }
 
-            localHandler->RunLocalCallback(*msg, _info);
+            if (localHandler->Deferred())
+            {
+              this->dataPtr->QueueExecutor().Post(
+                localHandler->ExecutorKey(),
+                [localHandler, msg, _info, _received, traceId]()
+                {
+                  // The message may have expired while it was queued.
+                  if (localHandler->Expired(_info))
+                    return;
+                  TraceIdScope traceScope(traceId);
+                  tracedCallback(*localHandler, _received, [&]
+                  {
+                    localHandler->RunLocalSharedCallback(msg, _info);
+                  });
+                }, static_cast<std::size_t>(localHandler->QueueSize()),
+                localHandler->HandlerUuid());
+            }
+            else
+            {
+              tracedCallback(*localHandler, _received, [&]
+              {
+                localHandler->RunLocalSharedCallback(msg, _info);
+              });
+            }
           }
         }
         else
@@ -646,22 +2124,15 @@ void NodeShared::RecvSrvRequest()
     std::cout << "Message received requesting a service call" << std::endl;
 
   zmq::message_t msg(0);
-  std::string topic;
-  std::string sender;
-  std::string nodeUuid;
-  std::string reqUuid;
-  std::string req;
-  std::string rep;
-  std::string resultStr;
-  std::string dstId;
+  NodeSharedPrivate::ServiceCall call;
   std::string reqType;
-  std::string repType;
 
   IRepHandlerPtr repHandler;
   bool hasHandler;
+  bool batch = false;
 
   {
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    std::lock_guard<std::recursive_mutex> lock(this->srvMutex);
 
     try
     {
@@ -678,7 +2149,7 @@ void NodeShared::RecvSrvRequest()
       if (!this->dataPtr->replier->recv(&msg, 0))
 #endif
         return;
-      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      call.topic.assign(reinterpret_cast<char *>(msg.data()), msg.size());
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->replier->recv(msg))
@@ -686,7 +2157,7 @@ void NodeShared::RecvSrvRequest()
       if (!this->dataPtr->replier->recv(&msg, 0))
 #endif
         return;
-      sender = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      call.sender.assign(reinterpret_cast<char *>(msg.data()), msg.size());
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->replier->recv(msg))
@@ -694,7 +2165,7 @@ void NodeShared::RecvSrvRequest()
       if (!this->dataPtr->replier->recv(&msg, 0))
 #endif
         return;
-      dstId = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      call.dstId.assign(reinterpret_cast<char *>(msg.data()), msg.size());
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->replier->recv(msg))
@@ -702,7 +2173,7 @@ void NodeShared::RecvSrvRequest()
       if (!this->dataPtr->replier->recv(&msg, 0))
 #endif
         return;
-      nodeUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      call.nodeUuid.assign(reinterpret_cast<char *>(msg.data()), msg.size());
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->replier->recv(msg))
@@ -710,7 +2181,16 @@ void NodeShared::RecvSrvRequest()
       if (!this->dataPtr->replier->recv(&msg, 0))
 #endif
         return;
-      reqUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      call.reqUuid.assign(reinterpret_cast<char *>(msg.data()), msg.size());
+
+      // The deadline is relative to now. Time spent in transit isn't known,
+      // so the call might still start shortly after the requester gave up.
+      uint64_t timeout;
+      if (NodeSharedPrivate::UnpackRequestTimeout(call.reqUuid, timeout))
+      {
+        call.deadline = std::chrono::steady_clock::now() +
+          std::chrono::milliseconds(timeout);
+      }
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->replier->recv(msg))
@@ -718,7 +2198,7 @@ void NodeShared::RecvSrvRequest()
       if (!this->dataPtr->replier->recv(&msg, 0))
 #endif
         return;
-      req = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      call.req.assign(reinterpret_cast<char *>(msg.data()), msg.size());
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->replier->recv(msg))
@@ -726,7 +2206,7 @@ void NodeShared::RecvSrvRequest()
       if (!this->dataPtr->replier->recv(&msg, 0))
 #endif
         return;
-      reqType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      reqType.assign(reinterpret_cast<char *>(msg.data()), msg.size());
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->replier->recv(msg))
@@ -734,7 +2214,7 @@ void NodeShared::RecvSrvRequest()
       if (!this->dataPtr->replier->recv(&msg, 0))
 #endif
         return;
-      repType = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      call.repType.assign(reinterpret_cast<char *>(msg.data()), msg.size());
     }
     catch(const zmq::error_t &_error)
     {
@@ -743,110 +2223,143 @@ void NodeShared::RecvSrvRequest()
       return;
     }
 
-    hasHandler =
-      this->repliers.FirstHandler(topic, reqType, repType, repHandler);
+    IGN_TRANSPORT_TRACEPOINT(srv_request_receive, call.topic.c_str(),
+      call.dstId.c_str(), traceRequestId(call.reqUuid));
+
+    // Credits granted to one of the streams of responses that I'm sending.
+    if (reqType == NodeSharedPrivate::kStreamCreditsType)
+    {
+      this->dataPtr->AddStreamCredits(call);
+      return;
+    }
+
+    // A batch of oneway requests runs the oneway replier of the service.
+    batch = call.repType == kOnewayBatchType;
+    if (batch)
+      call.repType = ignition::msgs::Empty().GetTypeName();
+
+    hasHandler = this->repliers.FirstHandler(
+      call.topic, reqType, call.repType, repHandler);
   }
 
   // Get the REP handler.
-  if (hasHandler)
+  if (!hasHandler)
   {
-    // Run the service call and get the results.
-    bool result = repHandler->RunCallback(req, rep);
+    // std::cerr << "I do not have a service call registered for topic ["
+    //           << call.topic << "]\n";
+    return;
+  }
 
-    // If 'reptype' is msgs::Empty", this is a oneway request
-    // and we don't send response
-    if (repType == ignition::msgs::Empty().GetTypeName())
+  // The requester accepts a stream of responses.
+  uint64_t window;
+  const bool stream =
+    NodeSharedPrivate::UnpackRequestWindow(call.reqUuid, window);
+
+  // Answer a repeated request to an idempotent service from the cache. The
+  // oneway requests always run the callback.
+  if (!stream &&
+      repHandler->ReplyCacheTtl() > std::chrono::nanoseconds::zero() &&
+      call.repType != ignition::msgs::Empty().GetTypeName())
+  {
+    std::string rep;
+    if (this->dataPtr->replyCache.Find(call.topic,
+          ReplyCache::Key(repHandler->HandlerUuid(), call.req), rep))
     {
+      NodeSharedPrivate::SendServiceResponse(call, rep, "1",
+        *this->dataPtr->replier, this->dataPtr->replierConnections,
+        this->srvMutex, this->verbose);
       return;
     }
+  }
 
-    if (result)
-      resultStr = "1";
-    else
-      resultStr = "0";
+  call.received = NodeSharedPrivate::TraceNow();
 
+  // The requests of a batch are run one after the other, in order.
+  std::vector<std::shared_ptr<const NodeSharedPrivate::ServiceCall>> calls;
+  if (batch)
+  {
+    std::vector<std::string> reqs;
+    if (!NodeSharedPrivate::UnpackOnewayBatch(call.req, reqs))
     {
-      std::lock_guard<std::recursive_mutex> lock(this->mutex);
-      // I am still not connected to this address.
-      if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
-            sender) == this->srvConnections.end())
-      {
-        this->dataPtr->replier->connect(sender.c_str());
-        this->srvConnections.push_back(sender);
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-        if (this->verbose)
-        {
-          std::cout << "\t* Connected to [" << sender
-                    << "] for sending a response" << std::endl;
-        }
-      }
+      std::cerr << "NodeShared::RecvSrvRequest() error parsing a batch of "
+                << "requests to [" << call.topic << "]" << std::endl;
+      return;
     }
+    call.req.clear();
 
-    // Send the reply.
-    try
+    calls.reserve(reqs.size());
+    for (std::string &req : reqs)
     {
-      std::lock_guard<std::recursive_mutex> lock(this->mutex);
-      zmq::message_t response;
-
-      response.rebuild(dstId.size());
-      memcpy(response.data(), dstId.data(), dstId.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
+      auto batchCall = std::make_shared<NodeSharedPrivate::ServiceCall>(call);
+      batchCall->req = std::move(req);
+      calls.push_back(std::move(batchCall));
+    }
+  }
+  else
+  {
+    calls.push_back(
+      std::make_shared<const NodeSharedPrivate::ServiceCall>(std::move(call)));
+  }
 
-      response.rebuild(topic.size());
-      memcpy(response.data(), topic.data(), topic.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
+  if (stream && !batch)
+  {
+    this->dataPtr->StartStream(repHandler, calls.front(),
+      static_cast<uint32_t>(std::min<uint64_t>(window,
+        std::numeric_limits<uint32_t>::max())), this->srvMutex, this->verbose);
+    return;
+  }
 
-      response.rebuild(nodeUuid.size());
-      memcpy(response.data(), nodeUuid.data(), nodeUuid.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
-
-      response.rebuild(reqUuid.size());
-      memcpy(response.data(), reqUuid.data(), reqUuid.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
-
-      response.rebuild(rep.size());
-      memcpy(response.data(), rep.data(), rep.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::sndmore);
-#else
-      this->dataPtr->replier->send(response, ZMQ_SNDMORE);
-#endif
-
-      response.rebuild(resultStr.size());
-      memcpy(response.data(), resultStr.data(), resultStr.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-      this->dataPtr->replier->send(response, zmq::send_flags::none);
-#else
-      this->dataPtr->replier->send(response, 0);
-#endif
+  const uint32_t maxCalls = repHandler->MaxConcurrentCalls();
+  if (maxCalls == 0)
+  {
+    // The response of asynchronous repliers can be sent from any thread,
+    // where the replier socket can't be used.
+    for (const auto &callPtr : calls)
+    {
+      if (repHandler->Asynchronous())
+      {
+        this->dataPtr->RunServiceCall(*repHandler, callPtr,
+          *this->dataPtr->replySender, this->dataPtr->replySenderConnections,
+          this->srvMutex, this->verbose, &this->dataPtr->replyCache);
+      }
+      else
+      {
+        this->dataPtr->RunServiceCall(*repHandler, callPtr,
+          *this->dataPtr->replier, this->dataPtr->replierConnections,
+          this->srvMutex, this->verbose, &this->dataPtr->replyCache);
+      }
     }
-    catch(const zmq::error_t &_error)
+    return;
+  }
+
+  // Run the call in the reply executor. Calls to the same replier are spread
+  // over at most maxCalls strands, so no more than maxCalls of them run at
+  // the same time. More strands than threads wouldn't add any concurrency.
+  Executor &executor = this->dataPtr->ReplyExecutor();
+  const std::size_t numSlots =
+    std::min<std::size_t>(maxCalls, executor.ThreadCount());
+  std::string key;
+  std::size_t minPending = std::numeric_limits<std::size_t>::max();
+  for (std::size_t i = 0; i < numSlots && minPending > 0; ++i)
+  {
+    std::string slotKey = repHandler->HandlerUuid() + "#" + std::to_string(i);
+    const std::size_t pending = executor.Pending(slotKey);
+    if (pending < minPending)
     {
-      std::cerr << "NodeShared::RecvSrvRequest() error sending response: "
-                << _error.what() << std::endl;
-      return;
+      minPending = pending;
+      key = std::move(slotKey);
     }
   }
-  // else
-  //   std::cerr << "I do not have a service call registered for topic ["
-  //             << topic << "]\n";
+
+  executor.Post(key, [this, repHandler, calls]()
+  {
+    for (const auto &callPtr : calls)
+    {
+      this->dataPtr->RunServiceCall(*repHandler, callPtr,
+        *this->dataPtr->replySender, this->dataPtr->replySenderConnections,
+        this->srvMutex, this->verbose, &this->dataPtr->replyCache);
+    }
+  });
 }
 
 //////////////////////////////////////////////////
@@ -856,18 +2369,18 @@ void NodeShared::RecvSrvResponse()
     std::cout << "Message received containing a service call REP" << std::endl;
 
   zmq::message_t msg(0);
-  std::string topic;
-  std::string nodeUuid;
-  std::string reqUuid;
   std::string rep;
   std::string resultStr;
   bool result;
 
-  IReqHandlerPtr reqHandlerPtr;
-  bool hasHandler;
+  uint64_t reqId;
+  bool hasReqId;
+  NodeSharedPrivate::InFlightRequest req;
+  bool hasHandler = false;
+  bool partial = false;
 
   {
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    std::lock_guard<std::recursive_mutex> lock(this->srvMutex);
 
     try
     {
@@ -884,7 +2397,15 @@ void NodeShared::RecvSrvResponse()
       if (!this->dataPtr->responseReceiver->recv(&msg, 0))
 #endif
         return;
-      topic = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+
+      // Service name and node UUID. The request id is enough to find the
+      // request.
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!this->dataPtr->responseReceiver->recv(msg))
+#else
+      if (!this->dataPtr->responseReceiver->recv(&msg, 0))
+#endif
+        return;
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->responseReceiver->recv(msg))
@@ -892,7 +2413,6 @@ void NodeShared::RecvSrvResponse()
       if (!this->dataPtr->responseReceiver->recv(&msg, 0))
 #endif
         return;
-      nodeUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->responseReceiver->recv(msg))
@@ -900,7 +2420,7 @@ void NodeShared::RecvSrvResponse()
       if (!this->dataPtr->responseReceiver->recv(&msg, 0))
 #endif
         return;
-      reqUuid = std::string(reinterpret_cast<char *>(msg.data()), msg.size());
+      hasReqId = NodeSharedPrivate::UnpackRequestId(msg, reqId);
 
 #ifdef IGN_ZMQ_POST_4_3_1
       if (!this->dataPtr->responseReceiver->recv(msg))
@@ -926,87 +2446,113 @@ void NodeShared::RecvSrvResponse()
       return;
     }
 
-    hasHandler =
-      this->requests.Handler(topic, nodeUuid, reqUuid, reqHandlerPtr);
+    if (hasReqId)
+    {
+      auto it = this->dataPtr->inFlightRequests.find(reqId);
+      if (it != this->dataPtr->inFlightRequests.end())
+      {
+        partial = resultStr == NodeSharedPrivate::kPartialReply;
+        if (partial)
+          req = it->second;
+        else
+        {
+          req = std::move(it->second);
+          this->dataPtr->inFlightRequests.erase(it);
+          this->dataPtr->RequestFinished(req,
+            std::chrono::steady_clock::now());
+        }
+        hasHandler = true;
+        IGN_TRANSPORT_TRACEPOINT(srv_response_receive, req.topic.c_str(),
+          this->dataPtr->responseReceiverId.c_str(), reqId);
+      }
+    }
   }
 
-  if (hasHandler)
+  if (hasHandler && partial)
+  {
+    req.handler->NotifyPartial(rep);
+
+    // Grant more credits once half of the window has been consumed, so the
+    // responder doesn't stall.
+    std::lock_guard<std::recursive_mutex> lock(this->srvMutex);
+    auto it = this->dataPtr->inFlightRequests.find(reqId);
+    if (it != this->dataPtr->inFlightRequests.end() &&
+        ++it->second.consumed >=
+          std::max<uint32_t>(1, req.handler->StreamWindow() / 2))
+    {
+      this->dataPtr->SendStreamCredits(it->second, reqId,
+        it->second.consumed, this->myRequesterAddress,
+        this->dataPtr->responseReceiverId);
+      it->second.consumed = 0;
+    }
+  }
+  else if (hasHandler)
   {
     // Notify the result.
-    reqHandlerPtr->NotifyResult(rep, result);
+    if (resultStr == NodeSharedPrivate::kStreamEndReply)
+      req.handler->NotifyStreamEnd();
+    else
+      req.handler->NotifyResult(rep, result);
 
     // Remove the handler.
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    std::lock_guard<std::recursive_mutex> lock(this->srvMutex);
     {
-      if (!this->requests.RemoveHandler(topic, nodeUuid, reqUuid))
+      if (!this->requests.RemoveHandler(req.topic, req.nodeUuid,
+            req.handler->HandlerUuid()))
       {
         std::cerr << "NodeShare::RecvSrvResponse(): "
                   << "Error removing request handler" << std::endl;
       }
     }
   }
-  else
+  else if (this->verbose)
   {
+    // E.g.: the response arrived after the deadline of the request.
     std::cerr << "Received a service call response but I don't have a handler"
               << " for it" << std::endl;
   }
 }
 
+//////////////////////////////////////////////////
+void NodeShared::ExpireRequests(
+    const std::chrono::steady_clock::time_point &_now)
+{
+  for (const auto &expired : this->dataPtr->ExpireInFlightRequests(_now))
+  {
+    this->requests.RemoveHandler(expired.topic, expired.nodeUuid,
+      expired.handler->HandlerUuid());
+  }
+}
+
 //////////////////////////////////////////////////
 void NodeShared::SendPendingRemoteReqs(const std::string &_topic,
   const std::string &_reqType, const std::string &_repType)
 {
-  std::string responserAddr;
-  std::string responserId;
   SrvAddresses_M addresses;
   this->dataPtr->srvDiscovery->Publishers(_topic, addresses);
   if (addresses.empty())
     return;
 
-  // Find a publisher that offers this service with a particular pair of REQ/REP
-  // types.
-  bool found = false;
+  // Find the publishers that offer this service with a particular pair of
+  // REQ/REP types.
+  std::vector<ServicePublisher> responders;
   for (auto &proc : addresses)
   {
-    auto &v = proc.second;
-    for (auto &pub : v)
+    for (auto &pub : proc.second)
     {
       if (pub.ReqTypeName() == _reqType && pub.RepTypeName() == _repType)
-      {
-        found = true;
-        responserAddr = pub.Addr();
-        responserId = pub.SocketId();
-        break;
-      }
+        responders.push_back(pub);
     }
-    if (found)
-      break;
   }
 
-  if (!found)
+  if (responders.empty())
     return;
 
-  if (verbose)
-  {
-    std::cout << "Found a service call responser at ["
-              << responserAddr << "]" << std::endl;
-  }
-
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  std::lock_guard<std::recursive_mutex> lock(this->srvMutex);
 
-  // I am still not connected to this address.
-  if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
-        responserAddr) == this->srvConnections.end())
-  {
-    this->dataPtr->requester->connect(responserAddr.c_str());
-    this->srvConnections.push_back(responserAddr);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    if (this->verbose)
-    {
-      std::cout << "\t* Connected to [" << responserAddr
-                << "] for service requests" << std::endl;
-    }
-  }
+  // Forget the requests that nobody waits for anymore, so they don't count
+  // as outstanding.
+  this->ExpireRequests(std::chrono::steady_clock::now());
 
   // Send all the pending REQs.
   IReqHandler_M reqs;
@@ -1022,8 +2568,12 @@ void NodeShared::SendPendingRemoteReqs(const std::string &_topic,
         continue;
 
       // Check that the pending service call has types that match the responser.
+      // Batches of oneway requests go to the oneway responders.
+      const std::string repType = req.second->RepTypeName();
+      const bool batch = repType == kOnewayBatchType &&
+        _repType == ignition::msgs::Empty().GetTypeName();
       if (req.second->ReqTypeName() != _reqType ||
-          req.second->RepTypeName() != _repType)
+          (repType != _repType && !batch))
       {
         continue;
       }
@@ -1031,24 +2581,86 @@ void NodeShared::SendPendingRemoteReqs(const std::string &_topic,
       // Mark the handler as requested.
       req.second->Requested(true);
 
-      std::string data;
-      if (!req.second->Serialize(data))
+      // The request was serialized when it was made.
+      const std::string *data = req.second->SerializedRequest();
+      if (!data)
         continue;
 
+      // Send the time left until the requester gives up, so the responder
+      // can drop the request if it can't start it in time. There is no
+      // point in sending a request that already expired.
+      uint64_t timeout = 0;
+      std::chrono::steady_clock::time_point deadline;
+      if (req.second->Deadline(deadline))
+      {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0)
+          continue;
+        timeout = static_cast<uint64_t>(left);
+      }
+
+      // Each request may go to a different responder.
+      const ServicePublisher &responder =
+        responders[this->dataPtr->SelectResponder(_topic, responders)];
+      const std::string responserAddr =
+        NodeSharedPrivate::ResponderEndpoint(responder);
+      const std::string &responserId = responder.SocketId();
+
+      // A responder reached through IPC sends the response back through IPC
+      // too, if I have an IPC endpoint.
+      const std::string &myAddress =
+        responserAddr != responder.Addr() &&
+        !this->dataPtr->responseReceiverIpc.empty() ?
+          this->dataPtr->responseReceiverIpc : this->myRequesterAddress;
+
+      if (verbose)
+      {
+        std::cout << "Found a service call responser at ["
+                  << responserAddr << "]" << std::endl;
+      }
+
+      // I am still not connected to this address, or the connection was
+      // evicted.
+      const bool newConnection =
+        this->dataPtr->requesterConnections.Use(responserAddr);
+      if (newConnection)
+      {
+        this->dataPtr->requester->connect(responserAddr.c_str());
+        if (this->verbose)
+        {
+          std::cout << "\t* Connected to [" << responserAddr
+                    << "] for service requests" << std::endl;
+        }
+      }
+
       auto nodeUuid = req.second->NodeUuid();
       auto reqUuid = req.second->HandlerUuid();
 
+      // Responses are matched by a compact request id. Oneway requests don't
+      // receive a response, so they aren't tracked.
+      const bool oneway = batch ||
+        _repType == ignition::msgs::Empty().GetTypeName();
+      const uint64_t reqId = this->dataPtr->nextRequestId++;
+      if (!oneway)
+      {
+        this->dataPtr->inFlightRequests[reqId] =
+          NodeSharedPrivate::InFlightRequest{_topic, nodeUuid, req.second,
+            responserId, std::chrono::steady_clock::now()};
+        ++this->dataPtr->responderStats[responserId].outstanding;
+        if (timeout > 0)
+        {
+          this->dataPtr->inFlightDeadlines.emplace(deadline, reqId);
+          this->dataPtr->inFlightDeadlinesPending = true;
+        }
+      }
+
       try
       {
         zmq::message_t msg;
 
-        msg.rebuild(responserId.size());
-        memcpy(msg.data(), responserId.data(), responserId.size());
-#ifdef IGN_ZMQ_POST_4_3_1
-        this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
-#else
-        this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
-#endif
+        NodeSharedPrivate::SendRoutingId(*this->dataPtr->requester,
+          responserId, newConnection);
 
         msg.rebuild(_topic.size());
         memcpy(msg.data(), _topic.data(), _topic.size());
@@ -1058,16 +2670,15 @@ void NodeShared::SendPendingRemoteReqs(const std::string &_topic,
         this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
 #endif
 
-        msg.rebuild(this->myRequesterAddress.size());
-        memcpy(msg.data(), this->myRequesterAddress.data(),
-          this->myRequesterAddress.size());
+        msg.rebuild(myAddress.size());
+        memcpy(msg.data(), myAddress.data(), myAddress.size());
 #ifdef IGN_ZMQ_POST_4_3_1
         this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
 #else
         this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
 #endif
 
-        std::string myId = this->responseReceiverId.ToString();
+        const std::string &myId = this->dataPtr->responseReceiverId;
         msg.rebuild(myId.size());
         memcpy(msg.data(), myId.data(), myId.size());
 #ifdef IGN_ZMQ_POST_4_3_1
@@ -1084,16 +2695,16 @@ void NodeShared::SendPendingRemoteReqs(const std::string &_topic,
         this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
 #endif
 
-        msg.rebuild(reqUuid.size());
-        memcpy(msg.data(), reqUuid.data(), reqUuid.size());
+        NodeSharedPrivate::PackRequestId(reqId, timeout,
+          req.second->StreamWindow(), msg);
 #ifdef IGN_ZMQ_POST_4_3_1
         this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
 #else
         this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
 #endif
 
-        msg.rebuild(data.size());
-        memcpy(msg.data(), data.data(), data.size());
+        msg.rebuild(data->size());
+        memcpy(msg.data(), data->data(), data->size());
 #ifdef IGN_ZMQ_POST_4_3_1
         this->dataPtr->requester->send(msg, zmq::send_flags::sndmore);
 #else
@@ -1108,23 +2719,31 @@ void NodeShared::SendPendingRemoteReqs(const std::string &_topic,
         this->dataPtr->requester->send(msg, ZMQ_SNDMORE);
 #endif
 
-        msg.rebuild(_repType.size());
-        memcpy(msg.data(), _repType.data(), _repType.size());
+        msg.rebuild(repType.size());
+        memcpy(msg.data(), repType.data(), repType.size());
 #ifdef IGN_ZMQ_POST_4_3_1
         this->dataPtr->requester->send(msg, zmq::send_flags::none);
 #else
         this->dataPtr->requester->send(msg, 0);
 #endif
+        IGN_TRANSPORT_TRACEPOINT(srv_request_send, _topic.c_str(),
+          myId.c_str(), reqId);
       }
       catch(const zmq::error_t& /*ze*/)
       {
         // Debug output.
         // std::cerr << "Error connecting [" << ze.what() << "]\n";
+        auto it = this->dataPtr->inFlightRequests.find(reqId);
+        if (it != this->dataPtr->inFlightRequests.end())
+        {
+          --this->dataPtr->responderStats[responserId].outstanding;
+          this->dataPtr->inFlightRequests.erase(it);
+        }
       }
 
       // Remove the handler associated to this service request. We won't
       // receive a response because this is a oneway request.
-      if (_repType == ignition::msgs::Empty().GetTypeName())
+      if (oneway)
       {
         this->requests.RemoveHandler(_topic, nodeUuid, reqUuid);
       }
@@ -1145,8 +2764,15 @@ void NodeShared::OnNewConnection(const MessagePublisher &_pub)
     std::cout << _pub;
   }
 
+  // A new publisher in the discovery information.
+  this->dataPtr->NotifyPeersChanged();
+  this->dataPtr->NotifyDiscoveryChange(DiscoveryChange_t::ADDED, _pub);
+
   std::lock_guard<std::recursive_mutex> lock(this->mutex);
 
+  // The topic may be under the prefix of a subscription.
+  this->AttachPrefixHandlers(topic);
+
   // Check if we are interested in this topic.
   if (this->localSubscribers.HasSubscriber(topic) &&
       this->pUuid.compare(procUuid) != 0)
@@ -1154,25 +2780,84 @@ void NodeShared::OnNewConnection(const MessagePublisher &_pub)
     // Handle security
     this->dataPtr->SecurityOnNewConnection();
 
-    // I am not connected to the process.
-    if (!this->connections.HasPublisher(addr))
-      this->dataPtr->subscriber->connect(addr.c_str());
+    // The publisher tells us how we receive the topic.
+    MessagePublisher connection(_pub);
+    bool multicast = false;
 
-    // Add a new filter for the topic.
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->dataPtr->subscriber->set(zmq::sockopt::subscribe, topic);
-#else
-    this->dataPtr->subscriber->setsockopt(ZMQ_SUBSCRIBE,
-        topic.data(), topic.size());
-#endif
+    {
+      std::lock_guard<std::mutex> subLock(this->dataPtr->subscriberMutex);
+
+      // Join the multicast group of the topic, if any. Not from the same
+      // host, since ZeroMQ doesn't loop the multicast data back.
+      const std::string &group = _pub.Options().MulticastGroup();
+      const std::string hostPrefix = "tcp://" + this->hostAddr + ":";
+      if (!group.empty() && addr.compare(0, hostPrefix.size(), hostPrefix) != 0)
+      {
+        multicast = this->dataPtr->JoinMulticastGroup(group, this->hostAddr);
+        if (multicast && this->verbose)
+          std::cout << "\t* Using multicast group [" << group << "] for data\n";
+      }
+
+      if (!multicast)
+      {
+        AdvertiseMessageOptions opts(connection.Options());
+        opts.SetMulticastGroup("");
+        connection.SetOptions(opts);
+      }
+
+      // I am not connected to the process. Prefer the IPC endpoint of the
+      // publisher if it lives in the same host and exposes one. The control
+      // topics have a socket and a thread of their own.
+      if (!multicast && (!this->connections.HasPublisher(addr) ||
+            this->dataPtr->dataConnections.count(addr) == 0))
+      {
+        const TrafficClass_t trafficClass = _pub.Options().TrafficClass();
+        zmq::socket_t &socket = trafficClass == TrafficClass_t::CONTROL ?
+          this->dataPtr->ControlSubscriber() : *this->dataPtr->subscriber;
+        if (trafficClass == TrafficClass_t::CONTROL &&
+            !this->dataPtr->controlReceptionThread.joinable())
+        {
+          this->dataPtr->controlWakeupReceiver.reset(
+            new zmq::socket_t(*this->dataPtr->context, ZMQ_PAIR));
+          this->dataPtr->controlWakeupSender.reset(
+            new zmq::socket_t(*this->dataPtr->context, ZMQ_PAIR));
+          NodeSharedPrivate::ConnectWakeup(
+            *this->dataPtr->controlWakeupReceiver,
+            *this->dataPtr->controlWakeupSender,
+            "inproc://wakeup_control_" + this->pUuid);
+          this->dataPtr->controlReceptionThread =
+            std::thread(&NodeShared::RunControlReceptionTask, this);
+        }
+
+        std::string endpoint;
+        if (NodeSharedPrivate::LocalIpcEndpoint(procUuid, endpoint,
+              NodeSharedPrivate::LaneName(trafficClass)))
+        {
+          if (this->verbose)
+            std::cout << "\t* Using [" << endpoint << "] for data\n";
+        }
+        else
+          endpoint = addr;
+        socket.connect(endpoint.c_str());
+        this->dataPtr->dataConnections.insert(addr);
+
+        // Only the subscriber socket is monitored.
+        if (&socket == this->dataPtr->subscriber.get())
+          this->dataPtr->dataEndpoints[endpoint] = addr;
+      }
+    }
 
     // Register the new connection with the publisher.
-    this->connections.AddPublisher(_pub);
+    this->connections.AddPublisher(connection);
 
-    if (this->verbose)
+    // Add the filter for the topic, which depends on the publishers.
+    this->UpdateSubscriberRate(topic);
+
+    if (this->verbose && !multicast)
       std::cout << "\t* Connected to [" << addr << "] for data\n";
 
-    MessagePublisher pub(_pub);
+    // Without a multicast group, the publisher sends us the topic over TCP.
+    MessagePublisher pub(connection);
     pub.SetPUuid(this->pUuid);
 
     // Hack: We use this field to store the PUuid of the topic publisher.
@@ -1182,11 +2867,19 @@ void NodeShared::OnNewConnection(const MessagePublisher &_pub)
         this->localSubscribers.NodeUuids(topic, _pub.MsgTypeName());
     for (const std::string &nodeUuid : handlerNodeUuids)
     {
-      pub.SetNUuid(nodeUuid);
+      // The nodes that asked for best effort delivery receive datagrams, if
+      // the publisher offers them.
+      MessagePublisher registration(pub);
+      registration.SetNUuid(nodeUuid);
+      this->dataPtr->SetDataEndpoint(registration,
+        this->localSubscribers.BestEffort(topic, nodeUuid));
+      acceptCompression(registration);
+      acceptCompactHeader(registration);
 
       // Send a message to the publisher notify it
       // about all my remoteSubscribers.
-      this->dataPtr->msgDiscovery->Register(pub);
+      this->dataPtr->msgDiscovery->Register(registration,
+        this->dataPtr->StatsWanted(topic));
     }
   }
 }
@@ -1206,10 +2899,20 @@ void NodeShared::OnNewDisconnection(const MessagePublisher &_pub)
     std::cout << "\tProcess UUID: " << procUuid << std::endl;
   }
 
+  this->dataPtr->NotifyDiscoveryChange(topic.empty() ?
+    DiscoveryChange_t::PROCESS_REMOVED : DiscoveryChange_t::REMOVED, _pub);
+
   // A remote subscriber[s] has been disconnected.
   if (topic != "" && nUuid != "")
   {
     this->remoteSubscribers.DelPublisherByNode(topic, procUuid, nUuid);
+    this->InvalidateSubscriberSnapshot(topic);
+    this->dataPtr->UpdateStatsSubscriber(_pub, false);
+    this->dataPtr->UpdateDataSubscriber(_pub, false);
+    this->dataPtr->UpdateRateLimit(_pub, false);
+    this->dataPtr->UpdateFragmentSubscriber(_pub, false);
+    this->dataPtr->UpdateCompressionSubscriber(_pub, false);
+    this->dataPtr->UpdateHeaderSubscriber(_pub, false);
 
     MessagePublisher connection;
     if (!this->connections.Publisher(topic, procUuid, nUuid, connection))
@@ -1223,7 +2926,9 @@ void NodeShared::OnNewDisconnection(const MessagePublisher &_pub)
     // Note: We deliberately don't remove the list of remote subscribers
     // for this process. Remote nodes might suffer package delays (due to WiFi
     // or traffic load) and if we remove them, they won't be able to receive
-    // data anymore.
+    // data anymore. What they negotiated is forgotten, they register again
+    // when they come back.
+    this->dataPtr->RemoveSubscriberProcess(procUuid);
 
     MsgAddresses_M info;
     if (!this->connections.Publishers(topic, info))
@@ -1242,7 +2947,7 @@ void NodeShared::OnNewSrvConnection(const ServicePublisher &_pub)
   std::string reqType = _pub.ReqTypeName();
   std::string repType = _pub.RepTypeName();
 
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  std::lock_guard<std::recursive_mutex> lock(this->srvMutex);
 
   if (this->verbose)
   {
@@ -1250,16 +2955,16 @@ void NodeShared::OnNewSrvConnection(const ServicePublisher &_pub)
     std::cout << _pub;
   }
 
-  // I am still not connected to this address.
-  if (std::find(this->srvConnections.begin(), this->srvConnections.end(),
-        addr) == this->srvConnections.end())
+  // Connect as soon as the responder is discovered, so the first request
+  // doesn't wait for the connection to be established. The handshake
+  // completes in the background.
+  const std::string endpoint = NodeSharedPrivate::ResponderEndpoint(_pub);
+  if (this->dataPtr->requesterConnections.Use(endpoint))
   {
-    this->dataPtr->requester->connect(addr.c_str());
-    this->srvConnections.push_back(addr);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    this->dataPtr->requester->connect(endpoint.c_str());
     if (this->verbose)
     {
-      std::cout << "\t* Connected to [" << addr
+      std::cout << "\t* Connected to [" << endpoint
                 << "] for service requests" << std::endl;
     }
   }
@@ -1267,7 +2972,9 @@ void NodeShared::OnNewSrvConnection(const ServicePublisher &_pub)
   // Check if there's a pending service request with this specific combination
   // of request and response types.
   IReqHandlerPtr handler;
-  if (this->requests.FirstHandler(topic, reqType, repType, handler))
+  if (this->requests.FirstHandler(topic, reqType, repType, handler) ||
+      (repType == ignition::msgs::Empty().GetTypeName() &&
+       this->requests.FirstHandler(topic, reqType, kOnewayBatchType, handler)))
   {
     // Request all pending service calls for this topic and req/rep types.
     this->SendPendingRemoteReqs(topic, reqType, repType);
@@ -1277,20 +2984,34 @@ void NodeShared::OnNewSrvConnection(const ServicePublisher &_pub)
 //////////////////////////////////////////////////
 void NodeShared::OnNewSrvDisconnection(const ServicePublisher &_pub)
 {
-  std::string addr = _pub.Addr();
+  std::vector<NodeSharedPrivate::InFlightRequest> dropped;
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->srvMutex);
 
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    // The connection is kept, since other services of the same process
+    // share the address. It's evicted once it stays idle. The statistics
+    // start from scratch if the responder comes back.
+    this->dataPtr->responderStats.erase(_pub.SocketId());
 
-  // Remove the address from the list of connected addresses.
-  this->srvConnections.erase(std::remove(std::begin(this->srvConnections),
-    std::end(this->srvConnections), addr.c_str()),
-    std::end(this->srvConnections));
+    // The responses of the requests sent to the responder will never
+    // arrive.
+    dropped = this->dataPtr->DropInFlightRequests(_pub.SocketId());
+    for (const auto &req : dropped)
+    {
+      this->requests.RemoveHandler(req.topic, req.nodeUuid,
+        req.handler->HandlerUuid());
+    }
+  }
 
   if (this->verbose)
   {
     std::cout << "Service call disconnection callback" << std::endl;
     std::cout << _pub;
   }
+
+  // The requesters don't wait for them anymore.
+  for (const auto &req : dropped)
+    req.handler->NotifyResult("", false);
 }
 
 //////////////////////////////////////////////////
@@ -1311,8 +3032,26 @@ void NodeShared::OnNewRegistration(const MessagePublisher &_pub)
   }
 
   // Add a remote subscriber.
-  std::lock_guard<std::recursive_mutex> lock(this->mutex);
-  this->remoteSubscribers.AddPublisher(_pub);
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    this->remoteSubscribers.AddPublisher(_pub);
+    this->InvalidateSubscriberSnapshot(_pub.Topic());
+    this->dataPtr->UpdateDataSubscriber(_pub, true);
+    this->dataPtr->UpdateRateLimit(_pub, true);
+    this->dataPtr->UpdateFragmentSubscriber(_pub, true);
+    this->dataPtr->UpdateCompressionSubscriber(_pub, true);
+    this->dataPtr->UpdateHeaderSubscriber(_pub, true);
+
+    // The late subscriber needs the last message of the latched publishers.
+    auto latchedIt = this->dataPtr->latchedTopics.find(_pub.Topic());
+    if (latchedIt != this->dataPtr->latchedTopics.end() &&
+        !latchedIt->second.msgs.empty())
+    {
+      this->SendLatched(_pub.Topic());
+      this->dataPtr->ScheduleLatchedResends(_pub.Topic());
+    }
+  }
+  this->dataPtr->NotifyPeersChanged();
 }
 
 //////////////////////////////////////////////////
@@ -1334,8 +3073,30 @@ void NodeShared::OnEndRegistration(const MessagePublisher &_pub)
   }
 
   // Delete a remote subscriber.
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    this->remoteSubscribers.DelPublisherByNode(topic, procUuid, nodeUuid);
+    this->InvalidateSubscriberSnapshot(topic);
+    this->OnStatsRegistration(_pub, false);
+    this->dataPtr->UpdateDataSubscriber(_pub, false);
+    this->dataPtr->UpdateRateLimit(_pub, false);
+    this->dataPtr->UpdateFragmentSubscriber(_pub, false);
+    this->dataPtr->UpdateCompressionSubscriber(_pub, false);
+    this->dataPtr->UpdateHeaderSubscriber(_pub, false);
+  }
+  this->dataPtr->NotifyPeersChanged();
+}
+
+//////////////////////////////////////////////////
+void NodeShared::OnStatsRegistration(const MessagePublisher &_pub,
+    const bool _stats)
+{
+  // Discard the message if the destination PUUID is not me.
+  if (_pub.Ctrl() != this->pUuid)
+    return;
+
   std::lock_guard<std::recursive_mutex> lock(this->mutex);
-  this->remoteSubscribers.DelPublisherByNode(topic, procUuid, nodeUuid);
+  this->dataPtr->UpdateStatsSubscriber(_pub, _stats);
 }
 
 //////////////////////////////////////////////////
@@ -1360,6 +3121,12 @@ bool NodeShared::InitializeSockets()
         &lingerVal, sizeof(lingerVal));
 #endif
 
+    // The connections to dead peers are closed early, instead of filling
+    // the queues of the publisher. The subscriber socket tells the
+    // discovery about them, see OnDataDisconnection().
+    this->dataPtr->EnableHeartbeats(*this->dataPtr->publisher);
+    this->dataPtr->EnableHeartbeats(*this->dataPtr->subscriber);
+
     // Set the capacity of the buffer for receiving messages.
     int rcvQueueVal = this->dataPtr->NonNegativeEnvVar(
       "IGN_TRANSPORT_RCVHWM", kDefaultRcvHwm);
@@ -1375,6 +3142,25 @@ bool NodeShared::InitializeSockets()
     int sndQueueVal = this->dataPtr->NonNegativeEnvVar(
       "IGN_TRANSPORT_SNDHWM", kDefaultSndHwm);
 
+    // Make the publisher socket report when the send buffer of a subscriber
+    // is full, instead of dropping the message silently for it.
+    if (this->dataPtr->countHwmDrops)
+    {
+#ifdef ZMQ_XPUB_NODROP
+      int noDrop = 1;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+      this->dataPtr->publisher->set(zmq::sockopt::xpub_nodrop, noDrop);
+#else
+      this->dataPtr->publisher->setsockopt(ZMQ_XPUB_NODROP,
+          &noDrop, sizeof(noDrop));
+#endif
+#else
+      std::cerr << "IGN_TRANSPORT_COUNT_HWM_DROPS requires ZeroMQ 4.1 or "
+                << "newer" << std::endl;
+      this->dataPtr->countHwmDrops = false;
+#endif
+    }
+
 #ifdef IGN_CPPZMQ_POST_4_7_0
     this->dataPtr->publisher->set(zmq::sockopt::sndhwm, sndQueueVal);
 
@@ -1382,6 +3168,89 @@ bool NodeShared::InitializeSockets()
     this->myAddress =
         this->dataPtr->publisher->get(zmq::sockopt::last_endpoint);
 
+#else
+    char bindEndPoint[1024];
+    this->dataPtr->publisher->setsockopt(ZMQ_SNDHWM,
+        &sndQueueVal, sizeof(sndQueueVal));
+
+    this->dataPtr->publisher->bind(anyTcpEp.c_str());
+    size_t size = sizeof(bindEndPoint);
+    this->dataPtr->publisher->getsockopt(ZMQ_LAST_ENDPOINT,
+        &bindEndPoint, &size);
+    this->myAddress = bindEndPoint;
+#endif
+
+    // Same host subscribers can also connect through a local IPC endpoint.
+    std::string ignIpc;
+    if (env("IGN_TRANSPORT_IPC", ignIpc) && ignIpc == "1")
+    {
+#ifndef _WIN32
+      this->dataPtr->BindIpc(*this->dataPtr->publisher,
+        NodeSharedPrivate::IpcEndpoint(this->pUuid));
+#else
+      std::cerr << "IGN_TRANSPORT_IPC is not supported on Windows" << std::endl;
+#endif
+    }
+
+    // Lets other threads wake up the reception thread.
+    NodeSharedPrivate::ConnectWakeup(*this->dataPtr->wakeupReceiver,
+      *this->dataPtr->wakeupSender, "inproc://wakeup_" + this->pUuid);
+
+    // Count the connections of the sockets used for the topics.
+    NodeSharedPrivate::MonitorSocket(*this->dataPtr->publisher,
+      *this->dataPtr->publisherMonitor, "inproc://monitor_pub_" + this->pUuid,
+      ZMQ_EVENT_ACCEPTED | ZMQ_EVENT_DISCONNECTED);
+    NodeSharedPrivate::MonitorSocket(*this->dataPtr->subscriber,
+      *this->dataPtr->subscriberMonitor,
+      "inproc://monitor_sub_" + this->pUuid,
+      ZMQ_EVENT_CONNECTED | ZMQ_EVENT_DISCONNECTED);
+
+    // Without it, the topics are never sent nor received as datagrams.
+    this->dataPtr->InitializeUdpSocket(this->hostAddr);
+  }
+  catch(const zmq::error_t& ze)
+  {
+    std::cerr << "InitializeSockets() Error: " << ze.what() << std::endl;
+    std::cerr << "Ignition Transport has not been correctly initialized"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::InitializeServices()
+{
+  if (this->dataPtr->servicesInitialized)
+    return true;
+
+  std::lock_guard<std::mutex> lk(this->dataPtr->servicesMutex);
+  if (this->dataPtr->servicesInitialized)
+    return true;
+
+  auto &context = *this->dataPtr->context;
+  try
+  {
+    this->dataPtr->requester.reset(new zmq::socket_t(context, ZMQ_ROUTER));
+    this->dataPtr->responseReceiver.reset(
+      new zmq::socket_t(context, ZMQ_ROUTER));
+    this->dataPtr->replier.reset(new zmq::socket_t(context, ZMQ_ROUTER));
+    this->dataPtr->replySender.reset(new zmq::socket_t(context, ZMQ_ROUTER));
+
+    // Sockets listening in a random port.
+    std::string anyTcpEp = "tcp://" + this->hostAddr + ":*";
+    int lingerVal = 0;
+
+    // The connections to dead peers are closed early.
+    for (auto *socket : {this->dataPtr->requester.get(),
+           this->dataPtr->responseReceiver.get(),
+           this->dataPtr->replier.get(), this->dataPtr->replySender.get()})
+    {
+      this->dataPtr->EnableHeartbeats(*socket);
+    }
+
+#ifdef IGN_CPPZMQ_POST_4_7_0
     // ResponseReceiver socket listening in a random port.
     std::string id = this->responseReceiverId.ToString();
     this->dataPtr->responseReceiver->set(zmq::sockopt::routing_id, id);
@@ -1401,16 +3270,13 @@ bool NodeShared::InitializeSockets()
 
     this->dataPtr->requester->set(zmq::sockopt::linger, lingerVal);
     this->dataPtr->requester->set(zmq::sockopt::router_mandatory, routeOn);
+
+    // Responses of the calls running in the reply executor.
+    this->dataPtr->replySender->set(zmq::sockopt::linger, lingerVal);
+    this->dataPtr->replySender->set(zmq::sockopt::router_mandatory, routeOn);
 #else
     char bindEndPoint[1024];
-    this->dataPtr->publisher->setsockopt(ZMQ_SNDHWM,
-        &sndQueueVal, sizeof(sndQueueVal));
-
-    this->dataPtr->publisher->bind(anyTcpEp.c_str());
     size_t size = sizeof(bindEndPoint);
-    this->dataPtr->publisher->getsockopt(ZMQ_LAST_ENDPOINT,
-        &bindEndPoint, &size);
-    this->myAddress = bindEndPoint;
 
     // ResponseReceiver socket listening in a random port.
     std::string id = this->responseReceiverId.ToString();
@@ -1430,6 +3296,7 @@ bool NodeShared::InitializeSockets()
     this->dataPtr->replier->setsockopt(ZMQ_ROUTER_MANDATORY,
         &RouteOn, sizeof(RouteOn));
     this->dataPtr->replier->bind(anyTcpEp.c_str());
+    size = sizeof(bindEndPoint);
     this->dataPtr->replier->getsockopt(ZMQ_LAST_ENDPOINT, &bindEndPoint, &size);
     this->myReplierAddress = bindEndPoint;
 
@@ -1437,36 +3304,141 @@ bool NodeShared::InitializeSockets()
         &lingerVal, sizeof(lingerVal));
     this->dataPtr->requester->setsockopt(ZMQ_ROUTER_MANDATORY, &RouteOn,
       sizeof(RouteOn));
+
+    // Responses of the calls running in the reply executor.
+    this->dataPtr->replySender->setsockopt(ZMQ_LINGER,
+        &lingerVal, sizeof(lingerVal));
+    this->dataPtr->replySender->setsockopt(ZMQ_ROUTER_MANDATORY, &RouteOn,
+      sizeof(RouteOn));
+#endif
+
+    // Same host requesters can also call the services through a local IPC
+    // endpoint, and receive their responses through another one.
+    std::string ignIpc;
+    if (env("IGN_TRANSPORT_IPC", ignIpc) && ignIpc == "1")
+    {
+#ifndef _WIN32
+      this->dataPtr->BindIpc(*this->dataPtr->replier,
+        NodeSharedPrivate::IpcEndpoint(this->pUuid,
+          NodeSharedPrivate::kReplierLane));
+      const std::string responseEp = NodeSharedPrivate::IpcEndpoint(
+        this->pUuid, NodeSharedPrivate::kResponseLane);
+      if (this->dataPtr->BindIpc(*this->dataPtr->responseReceiver,
+            responseEp))
+      {
+        this->dataPtr->responseReceiverIpc = responseEp;
+      }
 #endif
+    }
   }
   catch(const zmq::error_t& ze)
   {
-    std::cerr << "InitializeSockets() Error: " << ze.what() << std::endl;
-    std::cerr << "Ignition Transport has not been correctly initialized"
-              << std::endl;
+    std::cerr << "InitializeServices() Error: " << ze.what() << std::endl;
+    std::cerr << "The services of Ignition Transport have not been correctly "
+              << "initialized" << std::endl;
+    this->dataPtr->requester.reset();
+    this->dataPtr->responseReceiver.reset();
+    this->dataPtr->replier.reset();
+    this->dataPtr->replySender.reset();
     return false;
   }
 
+  this->dataPtr->srvDiscovery.reset(
+      new SrvDiscovery(this->pUuid, this->discoveryIP, this->srvDiscPort));
+
+  // Set the callback to notify svc discovery updates (new services).
+  this->dataPtr->srvDiscovery->ConnectionsCb(
+      std::bind(&NodeShared::OnNewSrvConnection, this, std::placeholders::_1));
+
+  // Set the callback to notify svc discovery updates (invalid services).
+  this->dataPtr->srvDiscovery->DisconnectionsCb(
+      std::bind(&NodeShared::OnNewSrvDisconnection,
+        this, std::placeholders::_1));
+
+  for (const auto &partition : this->dataPtr->partitions)
+    this->dataPtr->srvDiscovery->AddPartition(partition);
+
+  this->dataPtr->srvDiscovery->Start();
+
+  if (this->verbose)
+  {
+    std::cout << "Bind at: [udp://" << this->discoveryIP << ":"
+              << this->srvDiscPort << "] for srv discovery\n";
+    std::cout << "Bind at: [" << this->myReplierAddress << "] for srv. calls\n";
+    std::cout << "Identity for receiving srv. requests: ["
+              << this->replierId.ToString() << "]" << std::endl;
+    std::cout << "Identity for receiving srv. responses: ["
+              << this->responseReceiverId.ToString() << "]" << std::endl;
+  }
+
+  // Let the reception thread poll the new sockets.
+  this->dataPtr->servicesInitialized = true;
+  this->dataPtr->WakeUpReception();
   return true;
 }
 
 /////////////////////////////////////////////////
-bool NodeShared::TopicPublishers(const std::string &_topic,
-                                 SrvAddresses_M &_publishers) const
+void NodeShared::OnDataDisconnection(const std::string &_endpoint)
 {
-  return this->dataPtr->srvDiscovery->Publishers(_topic, _publishers);
-}
+  std::string addr;
+  {
+    std::lock_guard<std::mutex> subLock(this->dataPtr->subscriberMutex);
+    auto it = this->dataPtr->dataEndpoints.find(_endpoint);
+    if (it == this->dataPtr->dataEndpoints.end())
+      return;
+    addr = it->second;
+    this->dataPtr->dataEndpoints.erase(it);
+    this->dataPtr->dataConnections.erase(addr);
 
-/////////////////////////////////////////////////
+    // The next advertisement of the publisher connects again.
+    try
+    {
+      this->dataPtr->subscriber->disconnect(_endpoint.c_str());
+    }
+    catch(const zmq::error_t &/*_error*/)
+    {
+      // Already disconnected.
+    }
+  }
+
+  if (this->verbose)
+    std::cout << "\t* Lost the connection to [" << addr << "]" << std::endl;
+
+  this->dataPtr->msgDiscovery->Disconnected(addr);
+}
+
+/////////////////////////////////////////////////
+void NodeShared::AddPartition(const std::string &_partition)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->servicesMutex);
+  if (!this->dataPtr->partitions.insert(_partition).second)
+    return;
+
+  this->dataPtr->msgDiscovery->AddPartition(_partition);
+  if (this->dataPtr->servicesInitialized)
+    this->dataPtr->srvDiscovery->AddPartition(_partition);
+}
+
+/////////////////////////////////////////////////
+bool NodeShared::TopicPublishers(const std::string &_topic,
+                                 SrvAddresses_M &_publishers) const
+{
+  return this->dataPtr->servicesInitialized &&
+    this->dataPtr->srvDiscovery->Publishers(_topic, _publishers);
+}
+
+/////////////////////////////////////////////////
 bool NodeShared::DiscoverService(const std::string &_topic) const
 {
-  return this->dataPtr->srvDiscovery->Discover(_topic);
+  return this->dataPtr->servicesInitialized &&
+    this->dataPtr->srvDiscovery->Discover(_topic);
 }
 
 /////////////////////////////////////////////////
 bool NodeShared::AdvertisePublisher(const ServicePublisher &_publisher)
 {
-  return this->dataPtr->srvDiscovery->Advertise(_publisher);
+  return this->InitializeServices() &&
+    this->dataPtr->srvDiscovery->Advertise(_publisher);
 }
 
 /////////////////////////////////////////////////
@@ -1505,372 +3477,3968 @@ int NodeShared::SndHwm()
   }
   catch (zmq::error_t &_e)
   {
-    return -1;
+    return -1;
+  }
+
+  return sndHwm;
+}
+
+//////////////////////////////////////////////////
+uint64_t NodeShared::AddConnectionsCb(
+    std::function<void(const MessagePublisher &_pub)> _cb)
+{
+  return this->AddDiscoveryCb(
+    [cb = std::move(_cb)](const DiscoveryChange_t _change,
+                          const MessagePublisher &_pub)
+    {
+      if (_change == DiscoveryChange_t::ADDED)
+        cb(_pub);
+    });
+}
+
+//////////////////////////////////////////////////
+void NodeShared::RemoveConnectionsCb(const uint64_t _id)
+{
+  this->RemoveDiscoveryCb(_id);
+}
+
+//////////////////////////////////////////////////
+uint64_t NodeShared::AddDiscoveryCb(DiscoveryChangeCallback _cb,
+    const bool _replay)
+{
+  uint64_t id;
+  {
+    std::lock_guard<std::recursive_mutex> lock(
+        this->dataPtr->connectionsCbMutex);
+    id = this->dataPtr->nextConnectionsCbId++;
+    this->dataPtr->connectionsCbs[id] = std::move(_cb);
+    this->dataPtr->connectionsCbCount = this->dataPtr->connectionsCbs.size();
+  }
+
+  if (_replay)
+    this->dataPtr->ReplayDiscovery(id);
+  return id;
+}
+
+//////////////////////////////////////////////////
+void NodeShared::RemoveDiscoveryCb(const uint64_t _id)
+{
+  std::lock_guard<std::recursive_mutex> lock(
+      this->dataPtr->connectionsCbMutex);
+  this->dataPtr->connectionsCbs.erase(_id);
+  this->dataPtr->connectionsCbCount = this->dataPtr->connectionsCbs.size();
+}
+
+//////////////////////////////////////////////////
+NodeShared::SocketStatistics NodeShared::SocketStats() const
+{
+  SocketStatistics stats;
+  stats.sentMsgs = this->dataPtr->sentMsgs.load(std::memory_order_relaxed);
+  stats.hwmDroppedMsgs =
+    this->dataPtr->hwmDroppedMsgs.load(std::memory_order_relaxed);
+  stats.hwmDropsCounted = this->dataPtr->countHwmDrops;
+  stats.receivedMsgs =
+    this->dataPtr->receivedMsgs.load(std::memory_order_relaxed);
+  stats.subscriberConnections =
+    this->dataPtr->subscriberConnections.load(std::memory_order_relaxed);
+  stats.publisherConnections =
+    this->dataPtr->publisherConnections.load(std::memory_order_relaxed);
+  return stats;
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::HandlerWrapper::HasSubscriber(
+    const std::string &_fullyQualifiedTopic,
+    const std::string &_msgType) const
+{
+  std::shared_ptr<ISubscriptionHandler> normalSubscriberPtr;
+  std::shared_ptr<RawSubscriptionHandler> rawSubscriberPtr;
+
+  return this->normal.FirstHandler(
+            _fullyQualifiedTopic, _msgType, normalSubscriberPtr)
+         || this->raw.FirstHandler(
+            _fullyQualifiedTopic, _msgType, rawSubscriberPtr);
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::HandlerWrapper::HasSubscriber(
+    const std::string &_fullyQualifiedTopic) const
+{
+  return this->normal.HasHandlersForTopic(_fullyQualifiedTopic)
+      || this->raw.HasHandlersForTopic(_fullyQualifiedTopic);
+}
+
+//////////////////////////////////////////////////
+template <typename HandlerT>
+static void AppendNodeUuids(const HandlerStorage<HandlerT> &_handlerStorage,
+                            const std::string &_fullyQualifiedTopic,
+                            const std::string &_msgTypeName,
+                            std::vector<std::string> &_uuids)
+{
+  using HandlerTPtr = std::shared_ptr<HandlerT>;
+  std::map<std::string, std::map<std::string, HandlerTPtr>> handlers;
+
+  _handlerStorage.Handlers(_fullyQualifiedTopic, handlers);
+  for (const auto &collection : handlers)
+  {
+    for (const auto &collectionEntry : collection.second)
+    {
+      const HandlerTPtr &handler = collectionEntry.second;
+      const std::string &handlerMsgType = handler->TypeName();
+      if (handlerMsgType == _msgTypeName
+          || handlerMsgType == kGenericMessageType)
+      {
+        _uuids.push_back(handler->NodeUuid());
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> NodeShared::HandlerWrapper::NodeUuids(
+    const std::string &_fullyQualifiedTopic,
+    const std::string &_msgTypeName) const
+{
+  std::vector<std::string> uuids;
+  AppendNodeUuids(this->normal, _fullyQualifiedTopic, _msgTypeName, uuids);
+  AppendNodeUuids(this->raw, _fullyQualifiedTopic, _msgTypeName, uuids);
+
+  return uuids;
+}
+
+//////////////////////////////////////////////////
+template <typename HandlerT>
+static bool AnyBestEffort(const HandlerStorage<HandlerT> &_handlerStorage,
+                          const std::string &_fullyQualifiedTopic,
+                          const std::string &_nUuid)
+{
+  using HandlerTPtr = std::shared_ptr<HandlerT>;
+  std::map<std::string, std::map<std::string, HandlerTPtr>> handlers;
+
+  _handlerStorage.Handlers(_fullyQualifiedTopic, handlers);
+  auto nodeIt = handlers.find(_nUuid);
+  if (nodeIt == handlers.end())
+    return false;
+
+  return std::any_of(nodeIt->second.begin(), nodeIt->second.end(),
+    [](const std::pair<const std::string, HandlerTPtr> &_handler)
+    {
+      return _handler.second->BestEffort();
+    });
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::HandlerWrapper::BestEffort(
+    const std::string &_fullyQualifiedTopic,
+    const std::string &_nUuid) const
+{
+  return AnyBestEffort(this->normal, _fullyQualifiedTopic, _nUuid) ||
+    AnyBestEffort(this->raw, _fullyQualifiedTopic, _nUuid);
+}
+
+//////////////////////////////////////////////////
+template <typename HandlerT>
+static uint64_t MaxMsgsPerSec(const HandlerStorage<HandlerT> &_handlerStorage,
+                              const std::string &_fullyQualifiedTopic)
+{
+  using HandlerTPtr = std::shared_ptr<HandlerT>;
+  std::map<std::string, std::map<std::string, HandlerTPtr>> handlers;
+
+  uint64_t msgsPerSec = 0;
+  _handlerStorage.Handlers(_fullyQualifiedTopic, handlers);
+  for (const auto &node : handlers)
+  {
+    for (const auto &handler : node.second)
+      msgsPerSec = std::max(msgsPerSec, handler.second->MsgsPerSec());
+  }
+  return msgsPerSec;
+}
+
+//////////////////////////////////////////////////
+uint64_t NodeShared::HandlerWrapper::MsgsPerSec(
+    const std::string &_fullyQualifiedTopic) const
+{
+  const uint64_t msgsPerSec = std::max(
+    MaxMsgsPerSec(this->normal, _fullyQualifiedTopic),
+    MaxMsgsPerSec(this->raw, _fullyQualifiedTopic));
+  return msgsPerSec == 0 ? kUnthrottled : msgsPerSec;
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::HandlerWrapper::RemoveHandlersForNode(
+    const std::string &_fullyQualifiedTopic,
+    const std::string &_nUuid)
+{
+  bool removed = false;
+  removed |= this->normal.RemoveHandlersForNode(_fullyQualifiedTopic, _nUuid);
+  removed |= this->raw.RemoveHandlersForNode(_fullyQualifiedTopic, _nUuid);
+
+  return removed;
+}
+
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SecurityOnNewConnection()
+{
+  std::string user, pass;
+
+  // Set username and pass if they exist
+  // \todo(anyone): This will cause the subscriber to connect only to secure
+  // connections. Would be nice if the subscriber could still connect to
+  // unsecure connections. This might require an unsecure and secure
+  // subscriber.
+  // See issue #74
+  if (!userPass(user, pass))
+    return;
+
+  for (zmq::socket_t *socket :
+         {this->subscriber.get(), this->controlSubscriber.get()})
+  {
+    if (!socket)
+      continue;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    socket->set(zmq::sockopt::plain_username, user);
+    socket->set(zmq::sockopt::plain_password, pass);
+#else
+    socket->setsockopt(ZMQ_PLAIN_USERNAME, user.c_str(), user.size());
+    socket->setsockopt(ZMQ_PLAIN_PASSWORD, pass.c_str(), pass.size());
+#endif
+  }
+}
+
+//////////////////////////////////////////////////
+zmq::context_t *NodeSharedPrivate::NewContext()
+{
+  const ThreadConfig config = ThreadConfig::Global();
+  auto context = new zmq::context_t(config.IoThreads());
+  void *handle = static_cast<void *>(*context);
+
+  // Older versions of 0MQ can't configure the scheduling of their threads.
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+  for (const auto cpu : config.CpuAffinity())
+    zmq_ctx_set(handle, ZMQ_THREAD_AFFINITY_CPU_ADD, static_cast<int>(cpu));
+#endif
+#if defined(ZMQ_THREAD_SCHED_POLICY) && defined(ZMQ_THREAD_PRIORITY) && \
+    !defined(_WIN32)
+  if (config.Priority() > 0)
+  {
+    zmq_ctx_set(handle, ZMQ_THREAD_SCHED_POLICY, SCHED_FIFO);
+    zmq_ctx_set(handle, ZMQ_THREAD_PRIORITY, config.Priority());
+  }
+#endif
+  static_cast<void>(handle);
+
+  return context;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SecurityInit()
+{
+  // Check if a username and password has been set. If so, then
+  // setup a PLAIN authentication server.
+  std::string user, pass;
+  if (userPass(user, pass))
+  {
+    // Create the access control thread.
+    this->accessWakeupReceiver.reset(
+      new zmq::socket_t(*this->context, ZMQ_PAIR));
+    this->accessWakeupSender.reset(new zmq::socket_t(*this->context, ZMQ_PAIR));
+    ConnectWakeup(*this->accessWakeupReceiver, *this->accessWakeupSender,
+      "inproc://wakeup_access_" + Uuid().ToString());
+    this->accessControlThread = std::thread(
+        &NodeSharedPrivate::AccessControlHandler, this);
+
+    SecurePublisher(*this->publisher);
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SecurePublisher(zmq::socket_t &_socket)
+{
+  int asPlainSecurityServer = static_cast<int>(
+      ZmqPlainSecurityServerOptions::ZMQ_PLAIN_SECURITY_SERVER_ENABLED);
+
+#ifdef IGN_CPPZMQ_POST_4_7_0
+  _socket.set(zmq::sockopt::plain_server, asPlainSecurityServer);
+  _socket.set(zmq::sockopt::zap_domain, kIgnAuthDomain);
+#else
+  _socket.setsockopt(ZMQ_PLAIN_SERVER,
+      &asPlainSecurityServer, sizeof(asPlainSecurityServer));
+  _socket.setsockopt(ZMQ_ZAP_DOMAIN, kIgnAuthDomain,
+      std::strlen(kIgnAuthDomain));
+#endif
+}
+
+//////////////////////////////////////////////////
+// Access control handler for plain security.
+// This function is designed to be run in a thread.
+void NodeSharedPrivate::AccessControlHandler()
+{
+  ThreadConfig::Global().Apply("ign-access");
+
+  // A ROUTER socket, instead of a REP one, doesn't have to answer a request
+  // before reading the next, so all the handshakes waiting are answered at
+  // once, e.g.: when many peers reconnect together.
+  zmq::socket_t *sock = new zmq::socket_t(*this->context, ZMQ_ROUTER);
+
+  try
+  {
+    // Bind to the zap address
+    sock->bind("inproc://zeromq.zap.01");
+
+    // Get the username and password
+    std::string user, pass;
+    if (!userPass(user, pass))
+    {
+      std::cerr << "Username and password not set. "
+                << "Authentication is disabled\n";
+      sock->close();
+      delete sock;
+      return;
+    }
+
+    zmq::pollitem_t items[] =
+    {
+      {static_cast<void*>(*sock), 0, ZMQ_POLLIN, 0},
+      {static_cast<void*>(*this->accessWakeupReceiver), 0, ZMQ_POLLIN, 0},
+    };
+
+    std::vector<std::string> frames;
+
+    // Process
+    while (!this->exit)
+    {
+      try
+      {
+        // Woken up when it's time to exit.
+        zmq::poll(&items[0], sizeof(items) / sizeof(items[0]),
+            std::chrono::milliseconds(-1));
+      }
+      catch(...)
+      {
+        continue;
+      }
+
+      if (items[1].revents & ZMQ_POLLIN)
+        receiveHelper(*this->accessWakeupReceiver);
+
+      if (!(items[0].revents & ZMQ_POLLIN))
+        continue;
+
+      while (receiveFrames(*sock, frames))
+      {
+        // The request is the routing envelope, an empty delimiter and the
+        // ZAP frames: version, sequence, domain, address, routing id,
+        // mechanism and, for PLAIN, the username and password.
+        auto delimiter = std::find(frames.begin(), frames.end(), "");
+        if (delimiter == frames.end() ||
+            frames.end() - delimiter < 1 + kZapRequestFrames)
+        {
+          continue;
+        }
+        const std::vector<std::string> envelope(frames.begin(), delimiter + 1);
+        const std::string *zap = &*(delimiter + 1);
+        const std::string &version = zap[0];
+        const std::string &sequence = zap[1];
+        const std::string &domain = zap[2];
+        const std::string &address = zap[3];
+        const std::string &mechanism = zap[5];
+        const bool plain = mechanism == "PLAIN" &&
+          frames.end() - delimiter == 1 + kZapRequestFrames + 2;
+
+        // The address could be used in the future to only accept connections
+        // from specific addresses. Both credentials are compared, so the
+        // time taken doesn't tell which one was wrong.
+        std::string error;
+        if (address.empty())
+          error = "Invalid address";
+        else if (version != "1.0")
+          error = "Invalid version";
+        else if (!plain)
+          error = "Invalid mechanism";
+        else if (std::strcmp(domain.c_str(), kIgnAuthDomain) != 0)
+          error = "Invalid domain";
+        else if (!equalSecrets(zap[6], user) | !equalSecrets(zap[7], pass))
+          error = "Invalid username or password";
+
+        if (!error.empty())
+          std::cerr << error << std::endl;
+        sendZapReply(*sock, envelope, version, sequence, error);
+      }
+    }
+  }
+  catch (...)
+  {
+    // This catch can be triggered when ctrl-c is pressed and the context is
+    // deleted. Capture this case, and quit gracefully.
+  }
+
+  sock->close();
+  delete sock;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::PublishThread()
+{
+  ThreadConfig::Global().Apply("ign-publish");
+
+  // Loop until exits
+  while (!this->exit)
+  {
+    // Wait for more messages if the queue is empty.
+    if (!this->pubQueue.Wait(500ms))
+      continue;
+
+    // Stop early on exit.
+    if (this->exit)
+      break;
+
+    this->DispatchLocalMsg();
+  }
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::LocalQueueState::Track(PublishMsgDetails *_details)
+{
+  if (this->policy != QueueOverflowPolicy_t::DROP_OLDEST)
+    return;
+
+  // Free the payload of the superseded messages outside of the lock.
+  std::vector<std::shared_ptr<ProtoMsg>> msgs;
+  std::vector<std::shared_ptr<char[]>> buffers;
+  {
+    std::lock_guard<std::mutex> lk(this->mutex);
+    _details->tracked = true;
+    this->live.push_back(_details);
+    while (this->live.size() > this->depth)
+    {
+      PublishMsgDetails *oldest = this->live.front();
+      this->live.pop_front();
+      oldest->tracked = false;
+      oldest->evicted = true;
+      msgs.push_back(std::move(oldest->msgCopy));
+      buffers.push_back(std::move(oldest->sharedBuffer));
+      oldest->localHandlers.clear();
+      oldest->rawHandlers.clear();
+      ++this->dropped;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::LocalQueueState::Claim(PublishMsgDetails *_details)
+{
+  if (this->policy != QueueOverflowPolicy_t::DROP_OLDEST)
+    return true;
+
+  std::lock_guard<std::mutex> lk(this->mutex);
+  if (_details->evicted)
+    return false;
+
+  if (_details->tracked)
+  {
+    auto it = std::find(this->live.begin(), this->live.end(), _details);
+    if (it != this->live.end())
+      this->live.erase(it);
+    _details->tracked = false;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::LocalQueueState::Forget(PublishMsgDetails *_details)
+{
+  if (this->policy != QueueOverflowPolicy_t::DROP_OLDEST)
+    return;
+
+  std::lock_guard<std::mutex> lk(this->mutex);
+  if (!_details->tracked)
+    return;
+
+  auto it = std::find(this->live.begin(), this->live.end(), _details);
+  if (it != this->live.end())
+    this->live.erase(it);
+  _details->tracked = false;
+}
+
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::DispatchLocalMsg()
+{
+  // Get the message.
+  std::unique_ptr<PublishMsgDetails> msgDetails;
+  if (!this->pubQueue.Pop(msgDetails))
+    return false;
+  this->localDequeued->Add();
+
+  // Discard the messages superseded by newer ones in a full local queue.
+  if (msgDetails->queueState &&
+      !msgDetails->queueState->Claim(msgDetails.get()))
+  {
+    this->localDropped->Add();
+    return true;
+  }
+
+  IGN_TRANSPORT_TRACEPOINT(local_dispatch,
+    msgDetails->info.Topic().c_str(), msgDetails->traceId);
+
+  // Handlers with a keep last queue or a callback group always run in the
+  // queue executor. The rest run in the local executor if there's one or in
+  // this thread. Each handler gets its own strand, or the one of its group,
+  // so the callbacks of a handler run in order while different handlers run
+  // in parallel. The message details are shared by all the tasks.
+  std::shared_ptr<PublishMsgDetails> details(std::move(msgDetails));
+
+  // The message filters need the serialized message.
+  if (!details->sharedBuffer)
+  {
+    for (auto &handler : details->localHandlers)
+    {
+      if (handler->HasFilter())
+      {
+        this->SerializeDetails(*details, *details->msgCopy);
+        break;
+      }
+    }
+  }
+
+  // Send the message to all the local handlers.
+  for (auto &handler : details->localHandlers)
+  {
+    const bool deferred = handler->Deferred();
+    if (!deferred && !this->localExecutor)
+    {
+      RunLocalHandler(*handler, *details);
+      continue;
+    }
+
+    Executor &executor =
+      deferred ? this->QueueExecutor() : *this->localExecutor;
+    executor.Post(handler->ExecutorKey(), [details, handler]()
+    {
+      RunLocalHandler(*handler, *details);
+    }, static_cast<std::size_t>(handler->QueueSize()), handler->HandlerUuid());
+  }
+
+  // Send the message to all the raw handlers.
+  for (auto &handler : details->rawHandlers)
+  {
+    const bool deferred = handler->Deferred();
+    if (!deferred && !this->localExecutor)
+    {
+      RunRawHandler(*handler, *details);
+      continue;
+    }
+
+    Executor &executor =
+      deferred ? this->QueueExecutor() : *this->localExecutor;
+    executor.Post(handler->ExecutorKey(), [details, handler]()
+    {
+      RunRawHandler(*handler, *details);
+    }, static_cast<std::size_t>(handler->QueueSize()), handler->HandlerUuid());
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+Executor &NodeSharedPrivate::QueueExecutor()
+{
+  std::call_once(this->queueExecutorOnce, [this]()
+  {
+    this->queueExecutor = std::make_unique<Executor>(
+      std::max(1u, std::thread::hardware_concurrency()), "ign-queue-exec");
+  });
+  return *this->queueExecutor;
+}
+
+/////////////////////////////////////////////////
+Executor &NodeSharedPrivate::PublishExecutor()
+{
+  std::call_once(this->publishExecutorOnce, [this]()
+  {
+    this->publishExecutor = std::make_unique<Executor>(
+      std::max(1u, std::thread::hardware_concurrency()), "ign-pub-exec");
+  });
+  return *this->publishExecutor;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RunServiceCall(IRepHandler &_handler,
+    const std::shared_ptr<const ServiceCall> &_call, zmq::socket_t &_socket,
+    ConnectionCache &_connections, std::recursive_mutex &_mutex,
+    const bool _verbose, ReplyCache *_cache)
+{
+  // Nobody is waiting for the response anymore, e.g.: because the call
+  // spent too long waiting for a free slot in the reply executor.
+  if (std::chrono::steady_clock::now() >= _call->deadline)
+  {
+    if (_verbose)
+    {
+      std::cout << "Dropping expired service call to [" << _call->topic
+                << "]" << std::endl;
+    }
+    return;
+  }
+
+  // Run the service call. The response is sent as soon as it's available,
+  // which can be after returning for asynchronous repliers.
+  // The successful responses of an idempotent service are cached.
+  const std::chrono::nanoseconds ttl = _handler.ReplyCacheTtl();
+  if (ttl <= std::chrono::nanoseconds::zero())
+    _cache = nullptr;
+  const std::string handlerUuid = _cache ? _handler.HandlerUuid() : "";
+
+  tracedCallback(_handler, _call->received, [&]
+  {
+    _handler.RunCallbackAsync(_call->req,
+      [_call, &_socket, &_connections, &_mutex, _verbose, _cache, ttl,
+       handlerUuid](const std::string &_rep, const bool _result)
+      {
+        if (_cache && _result)
+        {
+          _cache->Store(_call->topic, ReplyCache::Key(handlerUuid,
+            _call->req), _rep, std::chrono::duration_cast<
+              ReplyCache::Clock::duration>(ttl));
+        }
+        SendServiceResponse(*_call, _rep, _result ? "1" : "0", _socket,
+          _connections, _mutex, _verbose);
+      });
+  });
+}
+
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::SendServiceResponse(const ServiceCall &_call,
+    const std::string &_rep, const std::string &_status,
+    zmq::socket_t &_socket, ConnectionCache &_connections,
+    std::recursive_mutex &_mutex, const bool _verbose)
+{
+  // If 'reptype' is msgs::Empty", this is a oneway request
+  // and we don't send response
+  if (_call.repType == ignition::msgs::Empty().GetTypeName())
+    return false;
+
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+  // I am still not connected to this address, or the connection was
+  // evicted.
+  const bool newConnection = _connections.Use(_call.sender);
+  if (newConnection)
+  {
+    _socket.connect(_call.sender.c_str());
+
+    if (_verbose)
+    {
+      std::cout << "\t* Connected to [" << _call.sender
+                << "] for sending a response" << std::endl;
+    }
+  }
+
+  // Send the reply.
+  try
+  {
+    zmq::message_t response;
+
+    SendRoutingId(_socket, _call.dstId, newConnection);
+
+    response.rebuild(_call.topic.size());
+    memcpy(response.data(), _call.topic.data(), _call.topic.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    _socket.send(response, zmq::send_flags::sndmore);
+#else
+    _socket.send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_call.nodeUuid.size());
+    memcpy(response.data(), _call.nodeUuid.data(), _call.nodeUuid.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    _socket.send(response, zmq::send_flags::sndmore);
+#else
+    _socket.send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_call.reqUuid.size());
+    memcpy(response.data(), _call.reqUuid.data(), _call.reqUuid.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    _socket.send(response, zmq::send_flags::sndmore);
+#else
+    _socket.send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_rep.size());
+    memcpy(response.data(), _rep.data(), _rep.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    _socket.send(response, zmq::send_flags::sndmore);
+#else
+    _socket.send(response, ZMQ_SNDMORE);
+#endif
+
+    response.rebuild(_status.size());
+    memcpy(response.data(), _status.data(), _status.size());
+#ifdef IGN_ZMQ_POST_4_3_1
+    _socket.send(response, zmq::send_flags::none);
+#else
+    _socket.send(response, 0);
+#endif
+    IGN_TRANSPORT_TRACEPOINT(srv_response_send, _call.topic.c_str(),
+      _call.dstId.c_str(), traceRequestId(_call.reqUuid));
+  }
+  catch(const zmq::error_t &_error)
+  {
+    std::cerr << "NodeShared::RecvSrvRequest() error sending response: "
+              << _error.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+std::string NodeSharedPrivate::StreamKey(const std::string &_dstId,
+    const std::string &_reqUuid)
+{
+  // Only the request id identifies the stream, the rest of the frame may
+  // differ between the request and the credits.
+  return _dstId + _reqUuid.substr(0, sizeof(uint64_t));
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::StartStream(const IRepHandlerPtr &_handler,
+    const std::shared_ptr<const ServiceCall> &_call, const uint32_t _window,
+    std::recursive_mutex &_mutex, const bool _verbose)
+{
+  auto state = std::make_shared<StreamState>();
+  state->credits = _window;
+  const std::string key = StreamKey(_call->dstId, _call->reqUuid);
+  {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    this->streams[key] = state;
+  }
+
+  // Writing may block until the requester grants more credits, which are
+  // received by the reception thread. Each stream runs in its own strand.
+  this->ReplyExecutor().Post("stream#" + key,
+    [this, _handler, _call, state, key, &_mutex, _verbose]()
+  {
+    auto close = [this, _call, state, key, &_mutex, _verbose](
+      const bool _result)
+    {
+      {
+        std::lock_guard<std::mutex> lk(state->mutex);
+        if (state->closed)
+          return;
+        state->closed = true;
+      }
+      state->condition.notify_all();
+
+      {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        this->streams.erase(key);
+      }
+
+      SendServiceResponse(*_call, "", _result ? kStreamEndReply : "0",
+        *this->replySender, this->replySenderConnections, _mutex, _verbose);
+    };
+
+    // Nobody is waiting for the responses anymore.
+    if (std::chrono::steady_clock::now() >= _call->deadline)
+    {
+      {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        this->streams.erase(key);
+      }
+
+      if (_verbose)
+      {
+        std::cout << "Dropping expired service call to [" << _call->topic
+                  << "]" << std::endl;
+      }
+      return;
+    }
+
+    auto write = [this, _call, state, &_mutex, _verbose](
+      const std::string &_rep)
+    {
+      {
+        std::unique_lock<std::mutex> lk(state->mutex);
+        const auto until = std::min(_call->deadline,
+          std::chrono::steady_clock::now() + kStreamStallTimeout);
+        if (!state->condition.wait_until(lk, until, [&state]
+              {
+                return state->credits > 0 || state->closed;
+              }) || state->closed)
+        {
+          return false;
+        }
+        --state->credits;
+      }
+
+      return SendServiceResponse(*_call, _rep, kPartialReply,
+        *this->replySender, this->replySenderConnections, _mutex, _verbose);
+    };
+
+    tracedCallback(*_handler, _call->received, [&]
+    {
+      _handler->RunStreamCallback(_call->req, write, close);
+    });
+  });
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::AddStreamCredits(const ServiceCall &_msg)
+{
+  uint64_t credits;
+  if (_msg.req.size() != sizeof(credits))
+    return;
+  memcpy(&credits, _msg.req.data(), sizeof(credits));
+
+  auto it = this->streams.find(StreamKey(_msg.dstId, _msg.reqUuid));
+  if (it == this->streams.end())
+    return;
+
+  StreamState &state = *it->second;
+  {
+    std::lock_guard<std::mutex> lk(state.mutex);
+    state.credits += credits;
+  }
+  state.condition.notify_all();
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::SendStreamCredits(const InFlightRequest &_req,
+    const uint64_t _reqId, const uint64_t _credits,
+    const std::string &_myAddress, const std::string &_myId)
+{
+  auto send = [this](const void *_data, const std::size_t _size,
+    const bool _more)
+  {
+    zmq::message_t msg(_data, _size);
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->requester->send(msg,
+      _more ? zmq::send_flags::sndmore : zmq::send_flags::none);
+#else
+    this->requester->send(msg, _more ? ZMQ_SNDMORE : 0);
+#endif
+  };
+
+  // Same layout as a request, so older responders can parse and ignore it.
+  try
+  {
+    SendRoutingId(*this->requester, _req.responderId, false);
+    send(_req.topic.data(), _req.topic.size(), true);
+    send(_myAddress.data(), _myAddress.size(), true);
+    send(_myId.data(), _myId.size(), true);
+    send(_req.nodeUuid.data(), _req.nodeUuid.size(), true);
+
+    zmq::message_t id;
+    PackRequestId(_reqId, 0, 0, id);
+#ifdef IGN_ZMQ_POST_4_3_1
+    this->requester->send(id, zmq::send_flags::sndmore);
+#else
+    this->requester->send(id, ZMQ_SNDMORE);
+#endif
+
+    send(&_credits, sizeof(_credits), true);
+    send(kStreamCreditsType.data(), kStreamCreditsType.size(), true);
+    send(kStreamCreditsType.data(), kStreamCreditsType.size(), false);
+  }
+  catch(const zmq::error_t &_error)
+  {
+    std::cerr << "NodeShared::RecvSrvResponse() error granting stream "
+              << "credits: " << _error.what() << std::endl;
+  }
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RunLocalStream(const IRepHandlerPtr &_repHandler,
+    const IReqHandlerPtr &_reqHandler)
+{
+  const std::string *data = _reqHandler->SerializedRequest();
+  if (!data)
+  {
+    _reqHandler->NotifyResult("", false);
+    return;
+  }
+
+  // The responses are consumed as they are written, so there is no need
+  // for flow control.
+  this->ReplyExecutor().Post("stream#" + _reqHandler->HandlerUuid(),
+    [_repHandler, _reqHandler, req = *data]()
+  {
+    auto closed = std::make_shared<std::atomic<bool>>(false);
+    _repHandler->RunStreamCallback(req,
+      [_reqHandler, closed](const std::string &_rep)
+      {
+        if (closed->load())
+          return false;
+
+        _reqHandler->NotifyPartial(_rep);
+        return true;
+      },
+      [_reqHandler, closed](const bool _result)
+      {
+        if (closed->exchange(true))
+          return;
+
+        if (_result)
+          _reqHandler->NotifyStreamEnd();
+        else
+          _reqHandler->NotifyResult("", false);
+      });
+  });
+}
+
+/////////////////////////////////////////////////
+Executor &NodeSharedPrivate::ReplyExecutor()
+{
+  std::call_once(this->replyExecutorOnce, [this]()
+  {
+    this->replyExecutor = std::make_unique<Executor>(
+      std::max(1u, std::thread::hardware_concurrency()), "ign-reply-exec");
+  });
+  return *this->replyExecutor;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::SerializeDetails(PublishMsgDetails &_details,
+    const ProtoMsg &_msg)
+{
+#if GOOGLE_PROTOBUF_VERSION >= 3004000
+  const std::size_t msgSize = static_cast<std::size_t>(_msg.ByteSizeLong());
+#else
+  const std::size_t msgSize = static_cast<std::size_t>(_msg.ByteSize());
+#endif
+  auto buffer = this->bufferPool->Acquire(msgSize);
+  if (!_msg.SerializeToArray(buffer.get(),
+        static_cast<int>(msgSize)))
+  {
+    std::cerr << "NodeSharedPrivate::SerializeDetails(): Error serializing "
+              << "data" << std::endl;
+    return;
+  }
+  IGN_TRANSPORT_COUNT_COPY(msgSize);
+
+  _details.sharedBuffer = std::move(buffer);
+  _details.msgSize = msgSize;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RunLocalHandler(ISubscriptionHandler &_handler,
+    const PublishMsgDetails &_details)
+{
+  RunLocalHandler(_handler, _details, *_details.msgCopy);
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RunLocalHandler(ISubscriptionHandler &_handler,
+    const PublishMsgDetails &_details, const ProtoMsg &_msg)
+{
+  if (_handler.Expired(_details.info) ||
+      !_handler.Filter(_details.sharedBuffer.get(), _details.msgSize,
+        _details.info))
+  {
+    return;
+  }
+
+  // The inline handlers can run inside another callback.
+  const bool nested = inLocalCallback;
+  inLocalCallback = true;
+  TraceIdScope traceScope(_details.traceId);
+  try
+  {
+    tracedCallback(_handler, _details.published, [&]
+    {
+      // The callbacks can share the copy of the message, not the message
+      // of a publisher delivered inline.
+      if (_details.msgCopy.get() == &_msg)
+        _handler.RunLocalSharedCallback(_details.msgCopy, _details.info);
+      else
+        _handler.RunLocalCallback(_msg, _details.info);
+    });
+  }
+  catch (...)
+  {
+    std::cerr << "Exception occurred in a local callback "
+      << "on topic [" << _details.info.Topic() << "] with message ["
+      << _msg.DebugString() << "]" << std::endl;
+  }
+  inLocalCallback = nested;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::RunRawHandler(RawSubscriptionHandler &_handler,
+    const PublishMsgDetails &_details)
+{
+  if (_handler.Expired(_details.info) ||
+      !_handler.Filter(_details.sharedBuffer.get(), _details.msgSize,
+        _details.info))
+  {
+    return;
+  }
+
+  const bool nested = inLocalCallback;
+  inLocalCallback = true;
+  TraceIdScope traceScope(_details.traceId);
+  try
+  {
+    tracedCallback(_handler, _details.published, [&]
+    {
+      _handler.RunRawCallback(_details.sharedBuffer.get(),
+          _details.msgSize, _details.info);
+    });
+  }
+  catch (...)
+  {
+    std::cerr << "Exception occured in a local raw callback "
+      << "on topic [" << _details.info.Topic() << "] with a message of "
+      << _details.msgSize << " bytes" << std::endl;
+  }
+  inLocalCallback = nested;
+}
+
+//////////////////////////////////////////////////
+std::optional<transport::TopicStatistics> NodeShared::TopicStats(
+    const std::string &_topic) const
+{
+  if (this->dataPtr->topicStats.find(_topic) != this->dataPtr->topicStats.end())
+    return this->dataPtr->topicStats.at(_topic);
+  return std::nullopt;
+}
+
+//////////////////////////////////////////////////
+void NodeShared::EnableStats(const std::string &_topic, bool _enable,
+    std::function<void(const TopicStatistics &_stats)> _statCb)
+{
+  this->EnableStats(_topic, _enable, std::move(_statCb),
+    std::chrono::seconds(1));
+}
+
+//////////////////////////////////////////////////
+void NodeShared::EnableStats(const std::string &_topic, bool _enable,
+    std::function<void(const TopicStatistics &_stats)> _statCb,
+    const std::chrono::nanoseconds &_period)
+{
+  // Once disabled, the callback isn't running and won't run again.
+  std::lock_guard<std::mutex> cbLock(this->dataPtr->statsCbMutex);
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  if (_enable)
+  {
+    NodeSharedPrivate::StatsReport report;
+    report.cb = std::move(_statCb);
+    report.period = std::max<std::chrono::nanoseconds>(_period,
+      std::chrono::milliseconds(1));
+    this->dataPtr->enabledTopicStatistics[_topic] = std::move(report);
+
+    if (!this->dataPtr->statsThread.joinable())
+    {
+      this->dataPtr->statsThread = std::thread(
+        &NodeSharedPrivate::StatsReporter, this->dataPtr.get(),
+        std::ref(*this));
+    }
+  }
+  else
+  {
+    this->dataPtr->enabledTopicStatistics.extract(_topic);
+    // \todo Also cleanup topicStats.
+  }
+
+  if (!this->dataPtr->topicStatsEnabled)
+    return;
+
+  // Let the publishers that we are connected to know, so they start or stop
+  // sending the publication metadata.
+  this->RegisterWithPublishers(_topic, _enable);
+}
+
+//////////////////////////////////////////////////
+void NodeShared::RegisterWithPublishers(const std::string &_topic,
+    const bool _stats)
+{
+  MsgAddresses_M info;
+  if (!this->connections.Publishers(_topic, info))
+    return;
+
+  for (const auto &proc : info)
+  {
+    for (const auto &publisher : proc.second)
+    {
+      MessagePublisher pub(publisher);
+      pub.SetPUuid(this->pUuid);
+      pub.SetCtrl(publisher.PUuid());
+      for (const std::string &nodeUuid :
+             this->localSubscribers.NodeUuids(_topic, publisher.MsgTypeName()))
+      {
+        MessagePublisher registration(pub);
+        registration.SetNUuid(nodeUuid);
+        this->dataPtr->SetDataEndpoint(registration,
+          this->localSubscribers.BestEffort(_topic, nodeUuid));
+        acceptCompression(registration);
+        acceptCompactHeader(registration);
+        this->dataPtr->msgDiscovery->Register(registration, _stats);
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeShared::UpdateSubscriberRate(const std::string &_topic)
+{
+  const bool subscribed = this->localSubscribers.HasSubscriber(_topic);
+  uint64_t msgsPerSec = kUnthrottled;
+  if (subscribed)
+    msgsPerSec = this->localSubscribers.MsgsPerSec(_topic);
+
+  // The filter of a prefix already brings all the messages of the topics
+  // under it. A rate limited copy would be a duplicate.
+  const bool covered = this->dataPtr->prefixTrie.Covers(_topic);
+  const bool prefixFilter =
+    covered && this->dataPtr->prefixTrie.Contains(_topic);
+  if (covered)
+    msgsPerSec = kUnthrottled;
+
+  // The publishers of older versions send all the messages to the filter of
+  // the topic. So do the multicast groups.
+  MsgAddresses_M info;
+  if (msgsPerSec != kUnthrottled && this->connections.Publishers(_topic, info))
+  {
+    for (const auto &proc : info)
+    {
+      for (const auto &publisher : proc.second)
+      {
+        if (publisher.Options().SubscriberMsgsPerSec() == 0 ||
+            !publisher.Options().MulticastGroup().empty())
+        {
+          msgsPerSec = kUnthrottled;
+        }
+      }
+    }
+  }
+
+  // Add the new filter before removing the old one.
+  // The rate limited copies are never fragmented.
+  const std::string rateLimitedFilter =
+    NodeSharedPrivate::RateLimitedFilter(this->pUuid, _topic);
+  const std::string fragmentFilter =
+    NodeSharedPrivate::FragmentFilter(_topic);
+  {
+    std::lock_guard<std::mutex> subLock(this->dataPtr->subscriberMutex);
+    if (!subscribed || covered)
+    {
+      if (!prefixFilter)
+      {
+        this->dataPtr->RemoveFilter(_topic);
+        this->dataPtr->RemoveFilter(fragmentFilter);
+      }
+      this->dataPtr->RemoveFilter(rateLimitedFilter);
+    }
+    else if (msgsPerSec == kUnthrottled)
+    {
+      this->dataPtr->AddFilter(_topic);
+      this->dataPtr->AddFilter(fragmentFilter);
+      this->dataPtr->RemoveFilter(rateLimitedFilter);
+    }
+    else
+    {
+      this->dataPtr->AddFilter(rateLimitedFilter);
+      this->dataPtr->RemoveFilter(_topic);
+      this->dataPtr->RemoveFilter(fragmentFilter);
+    }
+  }
+
+  auto &rates = this->dataPtr->subscribedRates;
+  auto rateIt = rates.find(_topic);
+  const uint64_t previous =
+    rateIt == rates.end() ? kUnthrottled : rateIt->second;
+  if (msgsPerSec == kUnthrottled)
+  {
+    if (rateIt != rates.end())
+      rates.erase(rateIt);
+  }
+  else
+  {
+    rates[_topic] = msgsPerSec;
+  }
+
+  // The nodes that unsubscribed have already unregistered.
+  if (subscribed && msgsPerSec != previous)
+    this->RegisterWithPublishers(_topic, this->dataPtr->StatsWanted(_topic));
+}
+
+//////////////////////////////////////////////////
+void NodeShared::AddPrefixSubscription(const std::string &_prefix,
+    const std::string &_nUuid, const RawSubscriptionHandlerPtr &_handler)
+{
+  auto &subscription = this->dataPtr->prefixSubscriptions[_prefix][_nUuid];
+  subscription.handlers.push_back(_handler);
+
+  // The topics found for the previous handlers of the node.
+  for (const auto &topic : subscription.topics)
+  {
+    this->localSubscribers.raw.AddHandler(topic, _nUuid, _handler);
+    this->InvalidateSubscriberSnapshot(topic);
+  }
+
+  if (!this->dataPtr->prefixTrie.Insert(_prefix))
+    return;
+
+  {
+    std::lock_guard<std::mutex> subLock(this->dataPtr->subscriberMutex);
+    this->dataPtr->AddFilter(_prefix);
+    this->dataPtr->AddFilter(NodeSharedPrivate::FragmentFilter(_prefix));
+  }
+
+  // The throttled topics under the prefix are received in full from now on.
+  std::vector<std::string> throttled;
+  for (const auto &rate : this->dataPtr->subscribedRates)
+  {
+    if (TopicUtils::MatchesPrefix(rate.first, _prefix))
+      throttled.push_back(rate.first);
+  }
+  for (const auto &topic : throttled)
+    this->UpdateSubscriberRate(topic);
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::RemovePrefixSubscription(const std::string &_prefix,
+    const std::string &_nUuid)
+{
+  auto prefixIt = this->dataPtr->prefixSubscriptions.find(_prefix);
+  if (prefixIt == this->dataPtr->prefixSubscriptions.end())
+    return false;
+
+  auto nodeIt = prefixIt->second.find(_nUuid);
+  if (nodeIt == prefixIt->second.end())
+    return false;
+
+  const NodeSharedPrivate::PrefixSubscription subscription =
+    std::move(nodeIt->second);
+  prefixIt->second.erase(nodeIt);
+
+  if (prefixIt->second.empty())
+  {
+    this->dataPtr->prefixSubscriptions.erase(prefixIt);
+    this->dataPtr->prefixTrie.Remove(_prefix);
+
+    std::lock_guard<std::mutex> subLock(this->dataPtr->subscriberMutex);
+    this->dataPtr->RemoveFilter(_prefix);
+    this->dataPtr->RemoveFilter(NodeSharedPrivate::FragmentFilter(_prefix));
+  }
+
+  for (const auto &topic : subscription.topics)
+  {
+    for (const auto &handler : subscription.handlers)
+    {
+      this->localSubscribers.raw.RemoveHandler(topic, _nUuid,
+        handler->HandlerUuid());
+    }
+    this->InvalidateSubscriberSnapshot(topic);
+
+    // The topic gets its own filter back if it still has subscribers.
+    this->UpdateSubscriberRate(topic);
+
+    // The node may still want the topic through another subscription.
+    if (this->localSubscribers.normal.HasHandlersForNode(topic, _nUuid) ||
+        this->localSubscribers.raw.HasHandlersForNode(topic, _nUuid))
+    {
+      continue;
+    }
+
+    // Notify to the publishers that the node is no longer interested.
+    MsgAddresses_M addresses;
+    if (!this->dataPtr->msgDiscovery->Publishers(topic, addresses))
+      continue;
+
+    for (const auto &proc : addresses)
+    {
+      MessagePublisher pub(topic, this->myAddress, proc.first, this->pUuid,
+        _nUuid, kGenericMessageType, AdvertiseMessageOptions());
+      this->dataPtr->msgDiscovery->Unregister(pub);
+    }
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool NodeShared::AttachPrefixHandlers(const std::string &_topic,
+    const std::string &_nUuid)
+{
+  if (this->dataPtr->prefixTrie.Empty())
+    return false;
+
+  bool attached = false;
+  for (const auto &prefix : this->dataPtr->prefixTrie.Match(_topic))
+  {
+    for (auto &node : this->dataPtr->prefixSubscriptions[prefix])
+    {
+      if (!_nUuid.empty() && node.first != _nUuid)
+        continue;
+
+      node.second.topics.insert(_topic);
+      for (const auto &handler : node.second.handlers)
+        this->localSubscribers.raw.AddHandler(_topic, node.first, handler);
+      attached = true;
+    }
+  }
+
+  if (attached)
+    this->InvalidateSubscriberSnapshot(_topic);
+  return attached;
+}
+
+//////////////////////////////////////////////////
+std::string NodeShared::MetricsText() const
+{
+  return this->dataPtr->metrics.PrometheusText();
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::CountTraffic(
+    std::unordered_map<std::string, TopicTraffic> &_cache,
+    const char *_prefix, const std::string &_topic, const std::size_t _size)
+{
+  auto it = _cache.find(_topic);
+  if (it == _cache.end())
+  {
+    const std::string prefix = _prefix;
+    const std::string label = MetricsRegistry::Label("topic", _topic);
+    TopicTraffic traffic;
+    traffic.messages =
+      &this->metrics.GetCounter(prefix + "_messages_total", label);
+    traffic.bytes = &this->metrics.GetCounter(prefix + "_bytes_total", label);
+    it = _cache.emplace(_topic, traffic).first;
+  }
+
+  it->second.messages->Add();
+  it->second.bytes->Add(_size);
+}
+
+//////////////////////////////////////////////////
+/// \brief Append the callback metrics of the handlers of a storage.
+/// \param[in] _storage The handlers.
+/// \param[out] _samples The metrics.
+template <typename HandlerT>
+static void appendCallbackMetrics(const HandlerStorage<HandlerT> &_storage,
+    std::vector<MetricsRegistry::Sample> &_samples)
+{
+  std::vector<std::string> topics;
+  _storage.TopicList(topics);
+  for (const auto &topic : topics)
+  {
+    std::map<std::string, std::map<std::string, std::shared_ptr<HandlerT>>>
+      handlers;
+    if (!_storage.Handlers(topic, handlers))
+      continue;
+
+    for (const auto &node : handlers)
+    {
+      for (const auto &handler : node.second)
+      {
+        if (!handler.second)
+          continue;
+
+        using Seconds = std::chrono::duration<double>;
+        const CallbackTrace &trace = handler.second->Trace();
+        const std::string labels = MetricsRegistry::Label("topic", topic) +
+          "," + MetricsRegistry::Label("handler", handler.first);
+        _samples.push_back({"ign_transport_callback_calls_total", labels,
+          static_cast<double>(trace.Count())});
+        _samples.push_back({"ign_transport_callback_seconds_total", labels,
+          Seconds(trace.TotalDuration()).count()});
+        _samples.push_back({"ign_transport_callback_max_seconds", labels,
+          Seconds(trace.MaxDuration()).count()});
+        _samples.push_back({"ign_transport_callback_delay_seconds_total",
+          labels, Seconds(trace.TotalDelay()).count()});
+        _samples.push_back({"ign_transport_callback_max_delay_seconds",
+          labels, Seconds(trace.MaxDelay()).count()});
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::InitMetrics(NodeShared &_shared)
+{
+  using Type = MetricsRegistry::Type;
+  const std::pair<const char *, const char *> counters[] =
+  {
+    {"ign_transport_sent_messages_total", "Messages sent to other processes."},
+    {"ign_transport_sent_bytes_total",
+     "Payload bytes sent to other processes."},
+    {"ign_transport_received_messages_total", "Messages received."},
+    {"ign_transport_received_bytes_total", "Payload bytes received."},
+    {"ign_transport_local_queued_total", "Local publications queued."},
+    {"ign_transport_local_dequeued_total",
+     "Local publications taken from the queue."},
+    {"ign_transport_local_dropped_total",
+     "Local publications superseded in a full keep last queue."},
+    {"ign_transport_callback_calls_total",
+     "Callbacks executed, if IGN_TRANSPORT_CALLBACK_TRACING is set."},
+    {"ign_transport_callback_seconds_total", "Time spent in the callbacks."},
+    {"ign_transport_callback_delay_seconds_total",
+     "Time from the reception of the messages until their callbacks start."},
+    {"ign_transport_discovery_sent_datagrams_total",
+     "Discovery datagrams sent."},
+    {"ign_transport_discovery_sent_bytes_total", "Discovery bytes sent."},
+    {"ign_transport_discovery_received_datagrams_total",
+     "Discovery datagrams received."},
+    {"ign_transport_discovery_received_bytes_total",
+     "Discovery bytes received."},
+  };
+  for (const auto &counter : counters)
+    this->metrics.Describe(counter.first, Type::COUNTER, counter.second);
+  this->metrics.Describe("ign_transport_local_queue_depth", Type::GAUGE,
+    "Local publications waiting in the queue.");
+  this->metrics.Describe("ign_transport_callback_max_seconds", Type::GAUGE,
+    "Longest time spent in a callback.");
+  this->metrics.Describe("ign_transport_callback_max_delay_seconds",
+    Type::GAUGE, "Longest time that a message waited for its callback.");
+
+  this->localQueued =
+    &this->metrics.GetCounter("ign_transport_local_queued_total");
+  this->localDropped =
+    &this->metrics.GetCounter("ign_transport_local_dropped_total");
+  this->localDequeued =
+    &this->metrics.GetCounter("ign_transport_local_dequeued_total");
+
+  this->metrics.AddCollector(
+    [this, &_shared](std::vector<MetricsRegistry::Sample> &_samples)
+    {
+      // Take the popped count first, so the depth is never negative.
+      const uint64_t dequeued = this->localDequeued->Value();
+      _samples.push_back({"ign_transport_local_queue_depth", "",
+        static_cast<double>(this->localQueued->Value() - dequeued)});
+
+      uint64_t traffic[4];
+      this->msgDiscovery->Traffic(traffic[0], traffic[1], traffic[2],
+        traffic[3]);
+      uint64_t srvTraffic[4] = {0, 0, 0, 0};
+      if (this->servicesInitialized)
+      {
+        this->srvDiscovery->Traffic(srvTraffic[0], srvTraffic[1],
+          srvTraffic[2], srvTraffic[3]);
+      }
+
+      const char *names[] =
+      {
+        "ign_transport_discovery_sent_datagrams_total",
+        "ign_transport_discovery_sent_bytes_total",
+        "ign_transport_discovery_received_datagrams_total",
+        "ign_transport_discovery_received_bytes_total"
+      };
+      for (int i = 0; i < 4; ++i)
+      {
+        _samples.push_back({names[i], MetricsRegistry::Label("discovery",
+          "msg"), static_cast<double>(traffic[i])});
+        _samples.push_back({names[i], MetricsRegistry::Label("discovery",
+          "srv"), static_cast<double>(srvTraffic[i])});
+      }
+
+      {
+        std::lock_guard<std::recursive_mutex> lk(_shared.mutex);
+        appendCallbackMetrics(_shared.localSubscribers.normal, _samples);
+        appendCallbackMetrics(_shared.localSubscribers.raw, _samples);
+      }
+      std::lock_guard<std::recursive_mutex> lk(_shared.srvMutex);
+      appendCallbackMetrics(_shared.repliers, _samples);
+    });
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::MetricsExporter(const std::string &_topic)
+{
+  ThreadConfig::Global().Apply("ign-metrics");
+
+  Node node;
+  auto pub = node.Advertise<msgs::Metric>(_topic);
+  if (!pub)
+  {
+    std::cerr << "Unable to advertise the metrics on topic [" << _topic
+              << "]" << std::endl;
+    return;
+  }
+
+  std::unique_lock<std::mutex> lk(this->metricsMutex);
+  while (!this->exit)
+  {
+    this->metricsCondition.wait_for(lk, 1s);
+    if (this->exit)
+      break;
+
+    // One group per metric, with the labels of each value as its name.
+    msgs::Metric msg;
+    std::string last;
+    msgs::StatisticsGroup *group = nullptr;
+    for (const auto &sample : this->metrics.Collect())
+    {
+      if (!group || sample.name != last)
+      {
+        last = sample.name;
+        group = msg.add_statistics_groups();
+        group->set_name(sample.name);
+      }
+      msgs::Statistic *stat = group->add_statistics();
+      stat->set_name(sample.labels.empty() ? sample.name : sample.labels);
+      stat->set_value(sample.value);
+    }
+    pub.Publish(msg);
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::NotifyStats(StatsReport &_report)
+{
+  // The thread is woken up once per report at most.
+  if (_report.updated)
+    return;
+
+  _report.updated = true;
+  {
+    std::lock_guard<std::mutex> lk(this->statsMutex);
+    this->statsWakeUp = true;
+  }
+  this->statsCondition.notify_one();
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::StatsReporter(NodeShared &_shared)
+{
+  ThreadConfig::Global().Apply("ign-stats");
+
+  using Clock = std::chrono::steady_clock;
+  std::vector<std::pair<std::function<void(const TopicStatistics &)>,
+    TopicStatistics>> due;
+  while (!this->exit)
+  {
+    // The reports that are due, and the time of the next one.
+    Clock::time_point next = Clock::time_point::max();
+    {
+      std::lock_guard<std::mutex> cbLock(this->statsCbMutex);
+      {
+        std::lock_guard<std::recursive_mutex> lk(_shared.mutex);
+        const Clock::time_point now = Clock::now();
+        for (auto &entry : this->enabledTopicStatistics)
+        {
+          StatsReport &report = entry.second;
+          if (!report.updated)
+            continue;
+
+          if (report.next <= now)
+          {
+            due.emplace_back(report.cb, this->topicStats[entry.first]);
+            report.updated = false;
+            report.next = now + std::chrono::duration_cast<
+              Clock::duration>(report.period);
+          }
+          else
+          {
+            next = std::min(next, report.next);
+          }
+        }
+      }
+
+      // The callbacks run without NodeShared::mutex, e.g. to publish.
+      for (const auto &report : due)
+      {
+        try
+        {
+          report.first(report.second);
+        }
+        catch(...)
+        {
+          std::cerr << "Exception occured in a statistics callback"
+                    << std::endl;
+        }
+      }
+      due.clear();
+    }
+
+    std::unique_lock<std::mutex> lk(this->statsMutex);
+    auto ready = [this]{return this->statsWakeUp || this->exit;};
+    if (next == Clock::time_point::max())
+      this->statsCondition.wait(lk, ready);
+    else
+      this->statsCondition.wait_until(lk, next, ready);
+    this->statsWakeUp = false;
+  }
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::PublishStats(const std::string &_topic) const
+{
+  return this->topicStatsEnabled &&
+    this->statsSubscribers.find(_topic) != this->statsSubscribers.end();
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::StatsWanted(const std::string &_topic) const
+{
+  return this->topicStatsEnabled &&
+    this->enabledTopicStatistics.find(_topic) !=
+      this->enabledTopicStatistics.end();
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UpdateStatsSubscriber(const MessagePublisher &_sub,
+    const bool _stats)
+{
+  const auto key = std::make_pair(_sub.PUuid(), _sub.NUuid());
+  if (_stats)
+  {
+    this->statsSubscribers[_sub.Topic()].insert(key);
+    return;
+  }
+
+  auto it = this->statsSubscribers.find(_sub.Topic());
+  if (it == this->statsSubscribers.end())
+    return;
+
+  it->second.erase(key);
+  if (it->second.empty())
+    this->statsSubscribers.erase(it);
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveSubscriberProcess(const std::string &_pUuid)
+{
+  // The registrations of the nodes of the process, as pairs of topic and
+  // node UUID.
+  std::set<std::pair<std::string, std::string>> registrations;
+  auto collect = [&](const auto &_topic, const auto &_subscribers)
+  {
+    for (const auto &entry : _subscribers)
+    {
+      const auto &key = subscriberKey(entry);
+      if (key.first == _pUuid)
+        registrations.emplace(_topic, key.second);
+    }
+  };
+
+  for (const auto &topic : this->statsSubscribers)
+    collect(topic.first, topic.second);
+  for (const auto &topic : this->remoteSubscriberRates)
+    collect(topic.first, topic.second);
+  for (const auto &topic : this->unfragmentedSubscribers)
+    collect(topic.first, topic.second);
+  for (const auto &topic : this->uncompressedSubscribers)
+    collect(topic.first, topic.second);
+  for (const auto &topic : this->headerSubscribers)
+    collect(topic.first, topic.second.subscribers);
+  for (const auto &topic : this->dataTopics)
+  {
+    collect(topic.first, topic.second.tcpSubscribers);
+    collect(topic.first, topic.second.udpSubscribers);
+  }
+
+  // A subscriber that crashed or timed out never sends its END_CONNECTION,
+  // and would pin the whole, uncompressed messages with the default framing
+  // for the life of the publisher.
+  for (const auto &registration : registrations)
+  {
+    MessagePublisher sub;
+    sub.SetTopic(registration.first);
+    sub.SetPUuid(_pUuid);
+    sub.SetNUuid(registration.second);
+    this->UpdateStatsSubscriber(sub, false);
+    this->UpdateDataSubscriber(sub, false);
+    this->UpdateRateLimit(sub, false);
+    this->UpdateFragmentSubscriber(sub, false);
+    this->UpdateCompressionSubscriber(sub, false);
+    this->UpdateHeaderSubscriber(sub, false);
+  }
+}
+
+//////////////////////////////////////////////////
+std::string NodeSharedPrivate::IpcEndpoint(const std::string &_pUuid,
+    const std::string &_lane)
+{
+  std::string dir;
+  if (!env("IGN_TRANSPORT_IPC_DIR", dir) || dir.empty())
+    dir = "/tmp";
+
+  return "ipc://" + dir + "/ign-transport-" + _pUuid +
+    (_lane.empty() ? "" : "-" + _lane) + ".pub";
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::BindIpc(zmq::socket_t &_socket,
+    const std::string &_endpoint)
+{
+#ifndef _WIN32
+  // ZeroMQ throws a cryptic error when the path doesn't fit in the address.
+  const std::string path = _endpoint.substr(std::strlen("ipc://"));
+  if (path.size() >= sizeof(sockaddr_un::sun_path))
+  {
+    std::cerr << "The IPC endpoint [" << _endpoint << "] is longer than "
+              << sizeof(sockaddr_un::sun_path) - 1 << " characters. Use a "
+              << "shorter IGN_TRANSPORT_IPC_DIR. The IPC endpoint is disabled."
+              << std::endl;
+    return false;
+  }
+
+  _socket.bind(_endpoint.c_str());
+
+  std::lock_guard<std::mutex> lock(this->ipcMutex);
+  this->ipcPaths.push_back(path);
+  return true;
+#else
+  (void)_socket;
+  (void)_endpoint;
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UnlinkIpcEndpoints()
+{
+#ifndef _WIN32
+  // The sockets belong to the threads still running, so they are left
+  // bound. Without their files, no one else connects to them.
+  std::lock_guard<std::mutex> lock(this->ipcMutex);
+  for (const std::string &path : this->ipcPaths)
+    unlink(path.c_str());
+  this->ipcPaths.clear();
+#endif
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::LocalIpcEndpoint(const std::string &_pUuid,
+    std::string &_endpoint, const std::string &_lane)
+{
+#ifndef _WIN32
+  const std::string endpoint = IpcEndpoint(_pUuid, _lane);
+
+  // The socket file only exists if the publisher is running on this host and
+  // bound the IPC endpoint.
+  struct stat info;
+  const std::string path = endpoint.substr(std::strlen("ipc://"));
+  if (stat(path.c_str(), &info) != 0 || !S_ISSOCK(info.st_mode) ||
+      path.size() >= sizeof(sockaddr_un::sun_path))
+  {
+    return false;
+  }
+
+  // The file of a process that didn't exit normally is left behind. Nobody
+  // listens on it, which a connection attempt tells right away. It doesn't
+  // wait if the listener is busy.
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return false;
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size());
+  const bool listening =
+    ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 ||
+    errno == EAGAIN || errno == EINPROGRESS;
+  ::close(fd);
+  if (!listening)
+    return false;
+
+  _endpoint = endpoint;
+  return true;
+#else
+  (void)_pUuid;
+  (void)_endpoint;
+  (void)_lane;
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+std::string NodeSharedPrivate::ResponderEndpoint(const ServicePublisher &_pub)
+{
+  std::string endpoint;
+  if (!LocalIpcEndpoint(_pub.PUuid(), endpoint, kReplierLane))
+    endpoint = _pub.Addr();
+  return endpoint;
+}
+
+//////////////////////////////////////////////////
+std::string NodeSharedPrivate::MulticastEndpoint(const std::string &_hostAddr,
+    const std::string &_group)
+{
+  return "epgm://" + _hostAddr + ";" + _group;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SetMulticastOptions(zmq::socket_t &_socket) const
+{
+  // PGM paces the sender at this rate, in kbit/s, and keeps the data of the
+  // recovery interval for the retransmissions, at both ends. The default of
+  // ZeroMQ, 100 kbit/s, is far too low for sensor data.
+  const int rate = this->NonNegativeEnvVar(
+    "IGN_TRANSPORT_MULTICAST_RATE", kDefaultMulticastRate);
+  const int recoveryIvl = 1000;
+  const int lingerVal = 0;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+  _socket.set(zmq::sockopt::rate, rate);
+  _socket.set(zmq::sockopt::recovery_ivl, recoveryIvl);
+  _socket.set(zmq::sockopt::linger, lingerVal);
+#else
+  _socket.setsockopt(ZMQ_RATE, &rate, sizeof(rate));
+  _socket.setsockopt(ZMQ_RECOVERY_IVL, &recoveryIvl, sizeof(recoveryIvl));
+  _socket.setsockopt(ZMQ_LINGER, &lingerVal, sizeof(lingerVal));
+#endif
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::AddMulticastTopic(const std::string &_topic,
+    std::string &_group, const std::string &_hostAddr,
+    const TopicStorage<MessagePublisher> &_remoteSubscribers)
+{
+  auto topicIt = this->dataTopics.find(_topic);
+  if (topicIt != this->dataTopics.end() && topicIt->second.socket)
+  {
+    // The messages of a topic are sent to a single group.
+    if (topicIt->second.group != _group)
+    {
+      std::cerr << "Topic [" << _topic << "] already uses the multicast group ["
+                << topicIt->second.group << "]" << std::endl;
+      _group = topicIt->second.group;
+    }
+    ++topicIt->second.multicastPublishers;
+    return true;
+  }
+
+  auto &socket = this->multicastPublishers[_group];
+  if (!socket)
+  {
+    try
+    {
+      std::unique_ptr<zmq::socket_t> newSocket(
+        new zmq::socket_t(*this->context, ZMQ_PUB));
+      this->SetMulticastOptions(*newSocket);
+      newSocket->bind(MulticastEndpoint(_hostAddr, _group).c_str());
+      socket = std::move(newSocket);
+    }
+    catch(const zmq::error_t &_error)
+    {
+      // E.g.: ZeroMQ is built without PGM support.
+      std::cerr << "Unable to send to the multicast group [" << _group
+                << "]: " << _error.what() << ". Using TCP instead."
+                << std::endl;
+      this->multicastPublishers.erase(_group);
+      return false;
+    }
+  }
+
+  DataTopic &topic = this->dataTopics[_topic];
+  topic.group = _group;
+  topic.socket = socket.get();
+  topic.multicastPublishers = 1;
+
+  // The subscribers registered with a previous publisher of the topic.
+  this->UpdateDataSubscribers(_topic, _remoteSubscribers);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveMulticastTopic(const std::string &_topic)
+{
+  auto topicIt = this->dataTopics.find(_topic);
+  if (topicIt == this->dataTopics.end() || !topicIt->second.socket ||
+      --topicIt->second.multicastPublishers > 0)
+  {
+    return;
+  }
+
+  const std::string group = topicIt->second.group;
+  if (topicIt->second.bestEffortPublishers <= 0)
+  {
+    this->dataTopics.erase(topicIt);
+  }
+  else
+  {
+    topicIt->second.group.clear();
+    topicIt->second.socket = nullptr;
+  }
+
+  // Leave the group once no topic is sent to it.
+  const bool used = std::any_of(this->dataTopics.begin(),
+    this->dataTopics.end(),
+    [&group](const std::pair<const std::string, DataTopic> &_topic)
+    {
+      return _topic.second.group == group;
+    });
+  if (!used)
+    this->multicastPublishers.erase(group);
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::AddBestEffortTopic(const std::string &_topic,
+    const TopicStorage<MessagePublisher> &_remoteSubscribers)
+{
+  if (this->udpSocket < 0)
+    return false;
+
+  DataTopic &topic = this->dataTopics[_topic];
+  if (topic.bestEffortPublishers++ == 0)
+    this->UpdateDataSubscribers(_topic, _remoteSubscribers);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveBestEffortTopic(const std::string &_topic)
+{
+  auto topicIt = this->dataTopics.find(_topic);
+  if (topicIt == this->dataTopics.end() ||
+      topicIt->second.bestEffortPublishers <= 0 ||
+      --topicIt->second.bestEffortPublishers > 0)
+  {
+    return;
+  }
+
+  if (!topicIt->second.socket)
+  {
+    this->dataTopics.erase(topicIt);
+    return;
+  }
+
+  // The subscribers that received datagrams need the messages over TCP.
+  for (const auto &sub : topicIt->second.udpSubscribers)
+    topicIt->second.tcpSubscribers.insert(sub.first);
+  topicIt->second.udpSubscribers.clear();
+}
+
+//////////////////////////////////////////////////
+std::string NodeSharedPrivate::LaneName(const TrafficClass_t _class)
+{
+  switch (_class)
+  {
+    case TrafficClass_t::BULK:
+      return "bulk";
+    case TrafficClass_t::CONTROL:
+      return "control";
+    default:
+      return "";
+  }
+}
+
+//////////////////////////////////////////////////
+std::string NodeSharedPrivate::LaneEnvVar(const TrafficClass_t _class,
+    const std::string &_option)
+{
+  std::string name = LaneName(_class);
+  std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+  return "IGN_TRANSPORT_" + name + "_" + _option;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::AddLaneTopic(const std::string &_topic,
+    const std::string &_pUuid, const std::string &_hostAddr,
+    TrafficClass_t &_class, std::string &_address)
+{
+  auto topicIt = this->laneTopics.find(_topic);
+  if (topicIt != this->laneTopics.end())
+  {
+    // The subscribers of the topic are connected to the socket of its class.
+    if (topicIt->second.trafficClass != _class)
+    {
+      std::cerr << "Topic [" << _topic << "] already uses the traffic class "
+                << "of its first publisher" << std::endl;
+    }
+    _class = topicIt->second.trafficClass;
+    _address = this->lanes[_class].address;
+    ++topicIt->second.publishers;
+    return true;
+  }
+
+  if (_class == TrafficClass_t::DEFAULT)
+    return false;
+
+  MsgAddresses_M publishers;
+  if (this->msgDiscovery->Publishers(_topic, publishers) &&
+      !publishers[_pUuid].empty())
+  {
+    std::cerr << "Topic [" << _topic << "] already uses the traffic class "
+              << "of its first publisher" << std::endl;
+    _class = TrafficClass_t::DEFAULT;
+    return false;
+  }
+
+  Lane &lane = this->lanes[_class];
+  if (!lane.socket)
+  {
+    const std::string name = LaneName(_class);
+    try
+    {
+      std::unique_ptr<zmq::socket_t> socket(
+        new zmq::socket_t(*this->context, ZMQ_PUB));
+
+      // The send buffers of the class are sized independently of the
+      // default ones.
+      int lingerVal = 0;
+      int sndQueueVal = this->NonNegativeEnvVar(
+        LaneEnvVar(_class, "SNDHWM"), kDefaultSndHwm);
+#ifdef IGN_CPPZMQ_POST_4_7_0
+      socket->set(zmq::sockopt::linger, lingerVal);
+      socket->set(zmq::sockopt::sndhwm, sndQueueVal);
+#else
+      socket->setsockopt(ZMQ_LINGER, &lingerVal, sizeof(lingerVal));
+      socket->setsockopt(ZMQ_SNDHWM, &sndQueueVal, sizeof(sndQueueVal));
+#endif
+      this->EnableHeartbeats(*socket);
+#ifdef ZMQ_XPUB_NODROP
+      if (this->countHwmDrops)
+      {
+        int noDrop = 1;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+        socket->set(zmq::sockopt::xpub_nodrop, noDrop);
+#else
+        socket->setsockopt(ZMQ_XPUB_NODROP, &noDrop, sizeof(noDrop));
+#endif
+      }
+#endif
+      this->SetDscp(*socket, _class);
+      std::string user, pass;
+      if (userPass(user, pass))
+        SecurePublisher(*socket);
+
+      const std::string anyTcpEp = "tcp://" + _hostAddr + ":*";
+      socket->bind(anyTcpEp.c_str());
+#ifdef IGN_CPPZMQ_POST_4_7_0
+      lane.address = socket->get(zmq::sockopt::last_endpoint);
+#else
+      char bindEndPoint[1024];
+      size_t size = sizeof(bindEndPoint);
+      socket->getsockopt(ZMQ_LAST_ENDPOINT, &bindEndPoint, &size);
+      lane.address = bindEndPoint;
+#endif
+
+#ifndef _WIN32
+      std::string ignIpc;
+      if (env("IGN_TRANSPORT_IPC", ignIpc) && ignIpc == "1")
+        this->BindIpc(*socket, IpcEndpoint(_pUuid, name));
+#endif
+      lane.socket = std::move(socket);
+    }
+    catch(const zmq::error_t &_error)
+    {
+      std::cerr << "Unable to create the publisher socket of the " << name
+                << " traffic class: " << _error.what()
+                << ". Using the default one instead." << std::endl;
+      this->lanes.erase(_class);
+      _class = TrafficClass_t::DEFAULT;
+      return false;
+    }
+  }
+
+  LaneTopic &topic = this->laneTopics[_topic];
+  topic.trafficClass = _class;
+  topic.socket = lane.socket.get();
+  topic.publishers = 1;
+  _address = lane.address;
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveLaneTopic(const std::string &_topic)
+{
+  auto topicIt = this->laneTopics.find(_topic);
+  if (topicIt == this->laneTopics.end() || --topicIt->second.publishers > 0)
+    return;
+
+  // The socket stays bound, for the next topic of the class.
+  this->laneTopics.erase(topicIt);
+}
+
+//////////////////////////////////////////////////
+zmq::socket_t &NodeSharedPrivate::ControlSubscriber()
+{
+  if (this->controlSubscriber)
+    return *this->controlSubscriber;
+
+  std::unique_ptr<zmq::socket_t> socket(
+    new zmq::socket_t(*this->context, ZMQ_SUB));
+  int lingerVal = 0;
+  int rcvQueueVal = this->NonNegativeEnvVar(
+    "IGN_TRANSPORT_RCVHWM", kDefaultRcvHwm);
+#ifdef IGN_CPPZMQ_POST_4_7_0
+  socket->set(zmq::sockopt::linger, lingerVal);
+  socket->set(zmq::sockopt::rcvhwm, rcvQueueVal);
+#else
+  socket->setsockopt(ZMQ_LINGER, &lingerVal, sizeof(lingerVal));
+  socket->setsockopt(ZMQ_RCVHWM, &rcvQueueVal, sizeof(rcvQueueVal));
+#endif
+  this->EnableHeartbeats(*socket);
+  this->SetDscp(*socket, TrafficClass_t::CONTROL);
+  this->controlSubscriber = std::move(socket);
+
+  // The same filters as the subscriber socket, since a process may send a
+  // topic through any of its sockets.
+  for (const auto &filter : this->filters)
+  {
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    this->controlSubscriber->set(zmq::sockopt::subscribe, filter);
+#else
+    this->controlSubscriber->setsockopt(ZMQ_SUBSCRIBE, filter.data(),
+      filter.size());
+#endif
+  }
+  this->SecurityOnNewConnection();
+  return *this->controlSubscriber;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SetDscp(zmq::socket_t &_socket,
+    const TrafficClass_t _class) const
+{
+#ifdef ZMQ_TOS
+  // Expedited forwarding for the control topics, unmarked otherwise.
+  const int dscp = this->NonNegativeEnvVar(LaneEnvVar(_class, "DSCP"),
+    _class == TrafficClass_t::CONTROL ? kDefaultControlDscp : 0);
+  if (dscp <= 0 || dscp > 63)
+    return;
+
+  // The DSCP value is in the upper 6 bits of the TOS byte.
+  int tos = dscp << 2;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+  _socket.set(zmq::sockopt::tos, tos);
+#else
+  _socket.setsockopt(ZMQ_TOS, &tos, sizeof(tos));
+#endif
+#else
+  (void)_socket;
+  (void)_class;
+#endif
+}
+
+//////////////////////////////////////////////////
+zmq::socket_t &NodeSharedPrivate::TopicSocket(const std::string &_topic) const
+{
+  if (!this->laneTopics.empty())
+  {
+    auto topicIt = this->laneTopics.find(_topic);
+    if (topicIt != this->laneTopics.end())
+      return *topicIt->second.socket;
+  }
+  return *this->publisher;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UpdateDataSubscribers(const std::string &_topic,
+    const TopicStorage<MessagePublisher> &_remoteSubscribers)
+{
+  MsgAddresses_M subscribers;
+  if (_remoteSubscribers.Publishers(_topic, subscribers))
+  {
+    for (const auto &proc : subscribers)
+    {
+      for (const auto &sub : proc.second)
+        this->UpdateDataSubscriber(sub, true);
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UpdateDataSubscriber(const MessagePublisher &_sub,
+    const bool _registered)
+{
+  auto topicIt = this->dataTopics.find(_sub.Topic());
+  if (topicIt == this->dataTopics.end())
+    return;
+
+  DataTopic &topic = topicIt->second;
+  const auto key = std::make_pair(_sub.PUuid(), _sub.NUuid());
+  topic.tcpSubscribers.erase(key);
+  topic.udpSubscribers.erase(key);
+  if (!_registered)
+    return;
+
+  // The subscribers that asked for datagrams, see SetDataEndpoint().
+  const std::string kUdpScheme = "udp://";
+  const std::string &addr = _sub.Addr();
+  if (topic.bestEffortPublishers > 0 && _sub.Options().BestEffort() &&
+      addr.compare(0, kUdpScheme.size(), kUdpScheme) == 0)
+  {
+    const auto colon = addr.rfind(':');
+    const std::string ip =
+      addr.substr(kUdpScheme.size(), colon - kUdpScheme.size());
+    const int port =
+      colon == std::string::npos ? 0 : std::atoi(addr.c_str() + colon + 1);
+    sockaddr_in endpoint;
+    memset(&endpoint, 0, sizeof(endpoint));
+    endpoint.sin_family = AF_INET;
+    if (port > 0 && port < 65536 &&
+        inet_pton(AF_INET, ip.c_str(), &endpoint.sin_addr) == 1)
+    {
+      endpoint.sin_port = htons(static_cast<uint16_t>(port));
+      topic.udpSubscribers[key] = endpoint;
+      return;
+    }
+  }
+
+  if (!topic.socket || _sub.Options().MulticastGroup().empty())
+    topic.tcpSubscribers.insert(key);
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::JoinMulticastGroup(const std::string &_group,
+    const std::string &_hostAddr)
+{
+  auto groupIt = this->multicastSubscriptions.find(_group);
+  if (groupIt != this->multicastSubscriptions.end())
+    return groupIt->second;
+
+  bool joined = true;
+  try
+  {
+    this->SetMulticastOptions(*this->subscriber);
+    this->subscriber->connect(MulticastEndpoint(_hostAddr, _group).c_str());
+  }
+  catch(const zmq::error_t &_error)
+  {
+    std::cerr << "Unable to join the multicast group [" << _group << "]: "
+              << _error.what() << ". Using TCP instead." << std::endl;
+    joined = false;
+  }
+
+  this->multicastSubscriptions[_group] = joined;
+  return joined;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::PublishMulticast(zmq::socket_t &_socket,
+    const std::string &_topic, const std::string &_sender,
+    zmq::message_t &_data, const std::string &_msgType,
+    const PublicationMetadata &_meta)
+{
+  this->SendMessage(_socket, _topic, _topic, _sender, _data, _msgType, _meta);
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SendMessage(zmq::socket_t &_socket,
+    const std::string &_frame, const std::string &_topic,
+    const std::string &_sender, zmq::message_t &_data,
+    const std::string &_msgType, const PublicationMetadata &_meta)
+{
+  zmq::message_t topicMsg(_frame.data(), _frame.size());
+  this->CountTraffic(this->sentTraffic, "ign_transport_sent", _topic,
+    _data.size());
+
+  zmq::message_t headerMsg;
+  if (this->CompactHeader(_topic) &&
+      PackHeader(_sender, _msgType, &_meta, headerMsg))
+  {
+#ifdef IGN_ZMQ_POST_4_3_1
+    _socket.send(topicMsg, zmq::send_flags::sndmore);
+    _socket.send(headerMsg, zmq::send_flags::sndmore);
+    _socket.send(_data, zmq::send_flags::none);
+#else
+    _socket.send(topicMsg, ZMQ_SNDMORE);
+    _socket.send(headerMsg, ZMQ_SNDMORE);
+    _socket.send(_data, 0);
+#endif
+    return;
+  }
+
+  zmq::message_t senderMsg(_sender.data(), _sender.size()),
+                 typeMsg(_msgType.data(), _msgType.size()),
+                 metaMsg(&_meta, sizeof(_meta));
+#ifdef IGN_ZMQ_POST_4_3_1
+  _socket.send(topicMsg, zmq::send_flags::sndmore);
+  _socket.send(senderMsg, zmq::send_flags::sndmore);
+  _socket.send(_data, zmq::send_flags::sndmore);
+  _socket.send(typeMsg, zmq::send_flags::sndmore);
+  _socket.send(metaMsg, zmq::send_flags::none);
+#else
+  _socket.send(topicMsg, ZMQ_SNDMORE);
+  _socket.send(senderMsg, ZMQ_SNDMORE);
+  _socket.send(_data, ZMQ_SNDMORE);
+  _socket.send(typeMsg, ZMQ_SNDMORE);
+  _socket.send(metaMsg, 0);
+#endif
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::InitializeUdpSocket(const std::string &_hostAddr)
+{
+#ifndef _WIN32
+  // The datagrams aren't authenticated.
+  std::string user, pass;
+  if (userPass(user, pass))
+    return;
+
+  const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0)
+  {
+    std::cerr << "Unable to open the socket of the best effort datagrams: "
+              << strerror(errno) << std::endl;
+    return;
+  }
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  socklen_t addrLen = sizeof(addr);
+  if (inet_pton(AF_INET, _hostAddr.c_str(), &addr.sin_addr) != 1 ||
+      bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &addrLen) != 0)
+  {
+    std::cerr << "Unable to bind the socket of the best effort datagrams to ["
+              << _hostAddr << "]: " << strerror(errno) << std::endl;
+    close(sock);
+    return;
+  }
+
+#ifdef SO_TIMESTAMPNS
+  // Kernel timestamps of the datagrams received.
+  const int timestamps = 1;
+  setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &timestamps,
+    sizeof(timestamps));
+#endif
+
+  this->udpSocket = sock;
+  this->udpEndpoint = "udp://" + _hostAddr + ":" +
+    std::to_string(ntohs(addr.sin_port));
+#else
+  (void)_hostAddr;
+#endif
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::CloseUdpSocket()
+{
+#ifndef _WIN32
+  if (this->udpSocket >= 0)
+    close(this->udpSocket);
+#endif
+  this->udpSocket = -1;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SetDataEndpoint(MessagePublisher &_registration,
+    const bool _bestEffort) const
+{
+  // The publisher announces that it can limit the rate.
+  if (_registration.Options().SubscriberMsgsPerSec() != 0)
+  {
+    auto rateIt = this->subscribedRates.find(_registration.Topic());
+    AdvertiseMessageOptions opts(_registration.Options());
+    opts.SetSubscriberMsgsPerSec(
+      rateIt == this->subscribedRates.end() ? kUnthrottled : rateIt->second);
+    _registration.SetOptions(opts);
+  }
+
+  if (!_registration.Options().BestEffort())
+    return;
+
+  if (_bestEffort && this->udpSocket >= 0)
+  {
+    _registration.SetAddr(this->udpEndpoint);
+    return;
+  }
+
+  AdvertiseMessageOptions opts(_registration.Options());
+  opts.SetBestEffort(false);
+  _registration.SetOptions(opts);
+}
+
+//////////////////////////////////////////////////
+std::string NodeSharedPrivate::RateLimitedFilter(const std::string &_pUuid,
+    const std::string &_topic)
+{
+  return kRateLimitedPrefix + _pUuid + _topic;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::StripRateLimitedFilter(const std::string &_pUuid,
+    std::string &_topic)
+{
+  if (!_topic.empty() && _topic[0] == kRateLimitedPrefix[0])
+    _topic.erase(0, sizeof(kRateLimitedPrefix) - 1 + _pUuid.size());
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::AddFilter(const std::string &_filter)
+{
+  if (!this->filters.insert(_filter).second)
+    return;
+
+  for (zmq::socket_t *socket :
+         {this->subscriber.get(), this->controlSubscriber.get()})
+  {
+    if (!socket)
+      continue;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    socket->set(zmq::sockopt::subscribe, _filter);
+#else
+    socket->setsockopt(ZMQ_SUBSCRIBE, _filter.data(), _filter.size());
+#endif
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveFilter(const std::string &_filter)
+{
+  if (this->filters.erase(_filter) == 0)
+    return;
+
+  for (zmq::socket_t *socket :
+         {this->subscriber.get(), this->controlSubscriber.get()})
+  {
+    if (!socket)
+      continue;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    socket->set(zmq::sockopt::unsubscribe, _filter);
+#else
+    socket->setsockopt(ZMQ_UNSUBSCRIBE, _filter.data(), _filter.size());
+#endif
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UpdateRateLimit(const MessagePublisher &_sub,
+    const bool _registered)
+{
+  const std::string &topic = _sub.Topic();
+  auto &rates = this->remoteSubscriberRates[topic];
+  const auto key = std::make_pair(_sub.PUuid(), _sub.NUuid());
+  if (_registered)
+    rates[key] = _sub.Options().SubscriberMsgsPerSec();
+  else
+    rates.erase(key);
+
+  // All the registrations of a process carry its rate. The subscribers of
+  // older versions don't send any (0), and receive all the messages.
+  std::map<std::string, uint64_t> processRates;
+  for (const auto &rate : rates)
+  {
+    const uint64_t msgsPerSec = rate.second == 0 ? kUnthrottled : rate.second;
+    uint64_t &processRate = processRates[rate.first.first];
+    processRate = std::max(processRate, msgsPerSec);
+  }
+
+  RateLimitedTopic limited;
+  auto limitedIt = this->rateLimitedTopics.find(topic);
+  for (const auto &processRate : processRates)
+  {
+    if (processRate.second == kUnthrottled)
+    {
+      limited.plainSubscribers = true;
+      continue;
+    }
+
+    RateLimitedProcess &process = limited.processes[processRate.first];
+    process.period = std::chrono::nanoseconds(
+      static_cast<int64_t>(1e9 / static_cast<double>(processRate.second)));
+
+    // Keep the pace of the process across the updates.
+    if (limitedIt != this->rateLimitedTopics.end())
+    {
+      auto processIt = limitedIt->second.processes.find(processRate.first);
+      if (processIt != limitedIt->second.processes.end())
+        process.last = processIt->second.last;
+    }
+  }
+
+  if (rates.empty())
+    this->remoteSubscriberRates.erase(topic);
+
+  if (limited.processes.empty())
+  {
+    if (limitedIt != this->rateLimitedTopics.end())
+      this->rateLimitedTopics.erase(limitedIt);
+    return;
+  }
+
+  this->rateLimitedTopics[topic] = std::move(limited);
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::PublishRateLimited(RateLimitedTopic &_topic,
+    const std::string &_topicName, const std::string &_sender,
+    const char *_data, const size_t _dataSize, const std::string &_msgType,
+    const PublicationMetadata &_meta)
+{
+  const auto now = std::chrono::steady_clock::now();
+  for (auto &process : _topic.processes)
+  {
+    if (now - process.second.last < process.second.period)
+      continue;
+    process.second.last = now;
+
+    // The publisher socket releases the buffer of the message sent to all
+    // the subscribers, so the copies can't share it.
+    zmq::message_t dataMsg(_data, _dataSize);
+    IGN_TRANSPORT_COUNT_COPY(_dataSize);
+    try
+    {
+      this->SendMessage(this->TopicSocket(_topicName),
+        RateLimitedFilter(process.first, _topicName), _topicName, _sender,
+        dataMsg, _msgType, _meta);
+    }
+    catch(const zmq::error_t &_error)
+    {
+      std::cerr << "NodeShared::Publish() Error: " << _error.what()
+                << std::endl;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+NodeSharedPrivate::FragmentBuffer::~FragmentBuffer()
+{
+  if (this->ffn)
+    this->ffn(this->data, this->hint);
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::AddFragmentTopic(const std::string &_topic,
+    const uint64_t _size)
+{
+  FragmentTopic &topic = this->fragmentTopics[_topic];
+  if (topic.publishers++ == 0)
+    topic.fragmentSize = _size;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveFragmentTopic(const std::string &_topic)
+{
+  auto topicIt = this->fragmentTopics.find(_topic);
+  if (topicIt != this->fragmentTopics.end() &&
+      --topicIt->second.publishers <= 0)
+  {
+    this->fragmentTopics.erase(topicIt);
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UpdateFragmentSubscriber(const MessagePublisher &_sub,
+    const bool _registered)
+{
+  // The registrations of the subscribers that reassemble the fragments copy
+  // the fragment size of the advertisement.
+  const auto key = std::make_pair(_sub.PUuid(), _sub.NUuid());
+  if (_registered && _sub.Options().FragmentSize() == 0)
+  {
+    this->unfragmentedSubscribers[_sub.Topic()].insert(key);
+    return;
+  }
+
+  auto topicIt = this->unfragmentedSubscribers.find(_sub.Topic());
+  if (topicIt == this->unfragmentedSubscribers.end())
+    return;
+
+  topicIt->second.erase(key);
+  if (topicIt->second.empty())
+    this->unfragmentedSubscribers.erase(topicIt);
+}
+
+//////////////////////////////////////////////////
+uint64_t NodeSharedPrivate::FragmentSize(const std::string &_topic,
+    const size_t _dataSize) const
+{
+  auto topicIt = this->fragmentTopics.find(_topic);
+  if (topicIt == this->fragmentTopics.end() ||
+      _dataSize <= topicIt->second.fragmentSize)
+  {
+    return 0;
+  }
+
+  // A single subscriber that can't reassemble them needs whole messages.
+  if (this->unfragmentedSubscribers.count(_topic) > 0)
+    return 0;
+
+  return topicIt->second.fragmentSize;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::QueueFragments(FragmentedMsg &&_msg)
+{
+  auto &queue = this->pendingFragments[
+    std::make_pair(_msg.topic, _msg.meta.publisher)];
+
+  // The subscribers see the sequence number of the message dropped.
+  if (queue.size() > 1)
+    queue.pop_back();
+  queue.push_back(std::move(_msg));
+
+  if (!this->fragmentsPending)
+  {
+    this->fragmentsPending = true;
+    this->fragmentsBlocked = false;
+    this->WakeUpReception();
+  }
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::SendFragment(FragmentedMsg &_msg,
+    const std::string &_sender)
+{
+  zmq::socket_t &socket = this->TopicSocket(_msg.topic);
+  const std::string filter = FragmentFilter(_msg.topic);
+  zmq::message_t filterMsg(filter.data(), filter.size());
+
+  // With ZMQ_XPUB_NODROP, the fragment waits for room in the send buffers
+  // instead of being dropped. Otherwise, that's the only way to know.
+#ifdef IGN_ZMQ_POST_4_3_1
+  if (!socket.send(filterMsg,
+        zmq::send_flags::sndmore | zmq::send_flags::dontwait).has_value())
+#else
+  if (!socket.send(filterMsg, ZMQ_SNDMORE | ZMQ_DONTWAIT))
+#endif
+  {
+    return false;
+  }
+
+  FragmentHeader header;
+  header.total = _msg.buffer->size;
+  header.offset = _msg.offset;
+  const uint64_t size = std::min(_msg.fragmentSize,
+    header.total - header.offset);
+
+  // Zero copy: each fragment keeps a reference to the buffer.
+  auto releaseFragment = [](void *, void *_hint)
+  {
+    delete static_cast<std::shared_ptr<FragmentBuffer> *>(_hint);
+  };
+  zmq::message_t senderMsg(_sender.data(), _sender.size()),
+                 typeMsg(_msg.msgType.data(), _msg.msgType.size()),
+                 metaMsg(&_msg.meta, sizeof(_msg.meta)),
+                 headerMsg(&header, sizeof(header)),
+                 dataMsg(_msg.buffer->data + header.offset, size,
+                   releaseFragment,
+                   new std::shared_ptr<FragmentBuffer>(_msg.buffer));
+#ifdef IGN_ZMQ_POST_4_3_1
+  socket.send(senderMsg, zmq::send_flags::sndmore);
+  socket.send(typeMsg, zmq::send_flags::sndmore);
+  socket.send(metaMsg, zmq::send_flags::sndmore);
+  socket.send(headerMsg, zmq::send_flags::sndmore);
+  socket.send(dataMsg, zmq::send_flags::none);
+#else
+  socket.send(senderMsg, ZMQ_SNDMORE);
+  socket.send(typeMsg, ZMQ_SNDMORE);
+  socket.send(metaMsg, ZMQ_SNDMORE);
+  socket.send(headerMsg, ZMQ_SNDMORE);
+  socket.send(dataMsg, 0);
+#endif
+
+  if (header.offset == 0)
+    this->sentMsgs.fetch_add(1, std::memory_order_relaxed);
+  this->CountTraffic(this->sentTraffic, "ign_transport_sent", _msg.topic,
+    size);
+  _msg.offset += size;
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SendPendingFragments(std::recursive_mutex &_mutex,
+    const std::string &_sender)
+{
+  if (!this->fragmentsPending)
+    return;
+
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  this->fragmentsBlocked = false;
+  for (auto it = this->pendingFragments.begin();
+       it != this->pendingFragments.end();)
+  {
+    FragmentedMsg &msg = it->second.front();
+    try
+    {
+      if (!this->SendFragment(msg, _sender))
+        this->fragmentsBlocked = true;
+    }
+    catch(const zmq::error_t &_error)
+    {
+      std::cerr << "NodeShared::Publish() Error: " << _error.what()
+                << std::endl;
+      msg.offset = msg.buffer->size;
+    }
+
+    if (msg.offset >= msg.buffer->size)
+      it->second.pop_front();
+
+    if (it->second.empty())
+      it = this->pendingFragments.erase(it);
+    else
+      ++it;
+  }
+  this->fragmentsPending = !this->pendingFragments.empty();
+}
+
+//////////////////////////////////////////////////
+std::string NodeSharedPrivate::FragmentFilter(const std::string &_topic)
+{
+  return kFragmentPrefix + _topic;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::Reassemble(ReceivedMessage &_msg, uint64_t &_received)
+{
+  _received = 0;
+  const std::string key = _msg.sender + "#" +
+    std::to_string(_msg.meta.publisher) + _msg.topic;
+  const FragmentHeader &header = _msg.fragmentHeader;
+  const auto now = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(this->reassemblyMutex);
+  auto it = this->reassemblies.find(key);
+  if (header.offset == 0)
+  {
+    // Don't trust the size announced by the first fragment: nothing is
+    // allocated for a message bigger than the limit, or made of more
+    // fragments than allowed.
+    const uint64_t fragmentSize = _msg.payload.size();
+    if (header.total == 0 || fragmentSize == 0 ||
+        header.total > this->maxReassemblySize ||
+        (header.total - 1) / fragmentSize >= kMaxFragments)
+    {
+      std::cerr << "NodeShared::RecvMsgUpdate(): Malformed fragment "
+                << "received on topic [" << _msg.topic << "]: message of "
+                << header.total << " bytes in fragments of " << fragmentSize
+                << " bytes" << std::endl;
+      if (it != this->reassemblies.end())
+        this->reassemblies.erase(it);
+      return false;
+    }
+
+    // Forget the messages whose publishers stopped sending them.
+    if (it == this->reassemblies.end())
+    {
+      for (auto staleIt = this->reassemblies.begin();
+           staleIt != this->reassemblies.end();)
+      {
+        if (now - staleIt->second.last > kReassemblyTimeout)
+          staleIt = this->reassemblies.erase(staleIt);
+        else
+          ++staleIt;
+      }
+      it = this->reassemblies.emplace(key, Reassembly()).first;
+    }
+
+    // An incomplete message of the same publisher lost a fragment.
+    try
+    {
+      it->second.payload.rebuild(header.total);
+    }
+    catch(const zmq::error_t &_error)
+    {
+      std::cerr << "NodeShared::RecvMsgUpdate() Error: " << _error.what()
+                << std::endl;
+      this->reassemblies.erase(it);
+      return false;
+    }
+    it->second.seq = _msg.meta.seq;
+    it->second.received = 0;
+  }
+  else if (it == this->reassemblies.end() ||
+           it->second.seq != _msg.meta.seq ||
+           it->second.received != header.offset)
+  {
+    // A fragment was lost, and the message with it.
+    if (it != this->reassemblies.end())
+      this->reassemblies.erase(it);
+    return false;
+  }
+
+  Reassembly &reassembly = it->second;
+  const size_t size = _msg.payload.size();
+  if (header.total != reassembly.payload.size() ||
+      size > header.total - reassembly.received)
+  {
+    this->reassemblies.erase(it);
+    return false;
+  }
+
+  memcpy(static_cast<char *>(reassembly.payload.data()) + reassembly.received,
+    _msg.payload.data(), size);
+  IGN_TRANSPORT_COUNT_COPY(size);
+  reassembly.received += size;
+  reassembly.last = now;
+  _received = reassembly.received;
+
+  if (reassembly.received < header.total)
+    return false;
+
+  _msg.payload = std::move(reassembly.payload);
+  _msg.fragment = false;
+  this->reassemblies.erase(it);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::AddCompressedTopic(const std::string &_topic,
+    const Compression_t _compression, const uint64_t _threshold)
+{
+  CompressedTopic &topic = this->compressedTopics[_topic];
+  if (topic.publishers++ == 0)
+  {
+    topic.compression = _compression;
+    topic.threshold = _threshold;
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::RemoveCompressedTopic(const std::string &_topic)
+{
+  auto topicIt = this->compressedTopics.find(_topic);
+  if (topicIt != this->compressedTopics.end() &&
+      --topicIt->second.publishers <= 0)
+  {
+    this->compressedTopics.erase(topicIt);
+  }
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UpdateCompressionSubscriber(
+    const MessagePublisher &_sub, const bool _registered)
+{
+  // The registrations of the subscribers that decompress the messages copy
+  // the compression of the advertisement.
+  const auto key = std::make_pair(_sub.PUuid(), _sub.NUuid());
+  if (_registered && _sub.Options().Compression() == Compression_t::NONE)
+  {
+    this->uncompressedSubscribers[_sub.Topic()].insert(key);
+    return;
+  }
+
+  auto topicIt = this->uncompressedSubscribers.find(_sub.Topic());
+  if (topicIt == this->uncompressedSubscribers.end())
+    return;
+
+  topicIt->second.erase(key);
+  if (topicIt->second.empty())
+    this->uncompressedSubscribers.erase(topicIt);
+}
+
+//////////////////////////////////////////////////
+Compression_t NodeSharedPrivate::Compression(const std::string &_topic,
+    const size_t _dataSize) const
+{
+  auto topicIt = this->compressedTopics.find(_topic);
+  if (topicIt == this->compressedTopics.end() ||
+      _dataSize < topicIt->second.threshold)
+  {
+    return Compression_t::NONE;
+  }
+
+  // A single subscriber that can't decompress them needs them as they are.
+  if (this->uncompressedSubscribers.count(_topic) > 0)
+    return Compression_t::NONE;
+
+  return topicIt->second.compression;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::UpdateHeaderSubscriber(const MessagePublisher &_sub,
+    const bool _registered)
+{
+  const auto key = std::make_pair(_sub.PUuid(), _sub.NUuid());
+  auto &topic = this->headerSubscribers[_sub.Topic()];
+
+  // Forget the previous registration of the subscriber, if any.
+  auto subIt = topic.subscribers.find(key);
+  if (subIt != topic.subscribers.end())
+  {
+    if (!subIt->second)
+      --topic.legacy;
+    topic.subscribers.erase(subIt);
+  }
+
+  if (_registered)
+  {
+    const bool compact = _sub.Options().CompactHeader();
+    topic.subscribers.emplace(key, compact);
+    if (!compact)
+      ++topic.legacy;
+  }
+
+  if (topic.subscribers.empty())
+    this->headerSubscribers.erase(_sub.Topic());
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::CompactHeader(const std::string &_topic) const
+{
+  if (!this->compactHeaderEnabled)
+    return false;
+
+  // Until a subscriber is registered we don't know what it reads, and a
+  // single subscriber of an older version needs the default framing.
+  return this->MetadataAccepted(_topic);
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::MetadataAccepted(const std::string &_topic) const
+{
+  auto topicIt = this->headerSubscribers.find(_topic);
+  return topicIt != this->headerSubscribers.end() &&
+    topicIt->second.legacy == 0;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::SendMetadata(const std::string &_topic) const
+{
+  if (this->PublishStats(_topic))
+    return true;
+
+  // The subscribers discard the copies of a latched message sent again with
+  // it, or of a message also received from the multicast group or as a
+  // datagram, but a subscriber of an older version reads exactly four
+  // frames. The ones that fall back to TCP register without the group or
+  // the best effort delivery, so they can't be told apart by them.
+  return (this->dataTopics.count(_topic) > 0 ||
+          this->latchedTopics.count(_topic) > 0) &&
+    this->MetadataAccepted(_topic);
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::DecompressPayload(const zmq::message_t &_frame,
+    ReceivedMessage &_msg)
+{
+  CompressionHeader header;
+  if (!UnpackCompressionHeader(reinterpret_cast<const char *>(_frame.data()),
+        _frame.size(), header) ||
+      header.size / kMaxCompressionRatio > _msg.payload.size())
+  {
+    std::cerr << "NodeShared::RecvMsgUpdate(): Malformed compression "
+              << "header received on topic [" << _msg.topic << "]"
+              << std::endl;
+    return false;
+  }
+
+  zmq::message_t compressed(std::move(_msg.payload));
+  _msg.payload.rebuild(static_cast<size_t>(header.size));
+  if (!Decompress(static_cast<Compression_t>(header.method),
+        reinterpret_cast<const char *>(compressed.data()), compressed.size(),
+        reinterpret_cast<char *>(_msg.payload.data()), _msg.payload.size()))
+  {
+    std::cerr << "NodeShared::RecvMsgUpdate(): Can't decompress the message "
+              << "received on topic [" << _msg.topic << "]" << std::endl;
+    return false;
+  }
+  IGN_TRANSPORT_COUNT_COPY(_msg.payload.size());
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::PublishDatagrams(const DataTopic &_topic,
+    const std::string &_topicName, const std::string &_sender,
+    const char *_data, const size_t _dataSize, const std::string &_msgType,
+    const PublicationMetadata &_meta)
+{
+  // Layout: <magic:uint8> <topic length:uint16> <topic>
+  //         <sender length:uint16> <sender> <type length:uint16> <type>
+  //         <PublicationMetadata without systemStamp> <data>
+  const uint16_t topicLen = static_cast<uint16_t>(_topicName.size());
+  const uint16_t senderLen = static_cast<uint16_t>(_sender.size());
+  const uint16_t typeLen = static_cast<uint16_t>(_msgType.size());
+  const size_t size = sizeof(kDatagramMagic) +
+    sizeof(topicLen) + topicLen +
+    sizeof(senderLen) + senderLen +
+    sizeof(typeLen) + typeLen +
+    kLegacyMetadataSize + _dataSize;
+  if (size > kMaxDatagramSize)
+    return false;
+
+  this->datagramOut.resize(size);
+  char *p = this->datagramOut.data();
+  auto write = [&p](const void *_src, const size_t _len)
+  {
+    memcpy(p, _src, _len);
+    p += _len;
+  };
+  write(&kDatagramMagic, sizeof(kDatagramMagic));
+  write(&topicLen, sizeof(topicLen));
+  write(_topicName.data(), topicLen);
+  write(&senderLen, sizeof(senderLen));
+  write(_sender.data(), senderLen);
+  write(&typeLen, sizeof(typeLen));
+  write(_msgType.data(), typeLen);
+  write(&_meta, kLegacyMetadataSize);
+  write(_data, _dataSize);
+  IGN_TRANSPORT_COUNT_COPY(_dataSize);
+
+  this->CountTraffic(this->sentTraffic, "ign_transport_sent", _topicName,
+    _dataSize);
+
+  // The nodes of a process share the endpoint, send a single datagram.
+  std::vector<const sockaddr_in *> sent;
+  for (const auto &sub : _topic.udpSubscribers)
+  {
+    const sockaddr_in &endpoint = sub.second;
+    if (std::any_of(sent.begin(), sent.end(),
+          [&endpoint](const sockaddr_in *_other)
+          {
+            return _other->sin_addr.s_addr == endpoint.sin_addr.s_addr &&
+              _other->sin_port == endpoint.sin_port;
+          }))
+    {
+      continue;
+    }
+    sent.push_back(&endpoint);
+
+#ifndef _WIN32
+    // A full socket buffer drops the datagram, like the network would.
+    sendto(this->udpSocket, this->datagramOut.data(), size, MSG_DONTWAIT,
+      reinterpret_cast<const sockaddr *>(&endpoint), sizeof(endpoint));
+#endif
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::UnpackDatagram(const char *_datagram,
+    const size_t _size, std::string &_topic, std::string &_sender,
+    std::string &_msgType, PublicationMetadata &_meta,
+    zmq::message_t &_payload)
+{
+  const char *p = _datagram;
+  const char *end = p + _size;
+
+  auto readString = [&p, end](std::string &_str) -> bool
+  {
+    uint16_t len;
+    if (static_cast<size_t>(end - p) < sizeof(len))
+      return false;
+    memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    if (static_cast<size_t>(end - p) < len)
+      return false;
+    _str.assign(p, len);
+    IGN_TRANSPORT_COUNT_COPY(len);
+    p += len;
+    return true;
+  };
+
+  if (_size < sizeof(kDatagramMagic) ||
+      memcmp(p, &kDatagramMagic, sizeof(kDatagramMagic)) != 0)
+  {
+    return false;
+  }
+  p += sizeof(kDatagramMagic);
+
+  if (!readString(_topic) || !readString(_sender) || !readString(_msgType) ||
+      static_cast<size_t>(end - p) < kLegacyMetadataSize)
+  {
+    return false;
+  }
+  memcpy(static_cast<void *>(&_meta), p, kLegacyMetadataSize);
+  p += kLegacyMetadataSize;
+
+  _payload.rebuild(p, static_cast<size_t>(end - p));
+  IGN_TRANSPORT_COUNT_COPY(_payload.size());
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::ScheduleLatchedResends(const std::string &_topic)
+{
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto &delay : kLatchedResendDelays)
+    this->latchedResends.push_back({_topic, now + delay});
+  this->latchedResendsPending = true;
+
+  // The reception thread may be waiting without timeout.
+  this->WakeUpReception();
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::PackHeader(const std::string &_sender,
+    const std::string &_msgType, const PublicationMetadata *_meta,
+    zmq::message_t &_header)
+{
+  // Layout: <flags:uint8> <sender length:uint16> <sender>
+  //         <type length:uint16> <type> [<PublicationMetadata>]
+  if (_sender.size() > std::numeric_limits<uint16_t>::max() ||
+      _msgType.size() > std::numeric_limits<uint16_t>::max())
+  {
+    return false;
+  }
+
+  const uint16_t senderLen = static_cast<uint16_t>(_sender.size());
+  const uint16_t typeLen = static_cast<uint16_t>(_msgType.size());
+  const size_t size = sizeof(uint8_t) +
+    sizeof(senderLen) + senderLen +
+    sizeof(typeLen) + typeLen +
+    (_meta ? sizeof(PublicationMetadata) : 0u);
+
+  _header.rebuild(size);
+  char *p = static_cast<char *>(_header.data());
+
+  const uint8_t flags = _meta ? 1u : 0u;
+  memcpy(p, &flags, sizeof(flags));
+  p += sizeof(flags);
+  memcpy(p, &senderLen, sizeof(senderLen));
+  p += sizeof(senderLen);
+  memcpy(p, _sender.data(), senderLen);
+  p += senderLen;
+  memcpy(p, &typeLen, sizeof(typeLen));
+  p += sizeof(typeLen);
+  memcpy(p, _msgType.data(), typeLen);
+  p += typeLen;
+  if (_meta)
+    memcpy(p, _meta, sizeof(PublicationMetadata));
+  return true;
+}
+
+//////////////////////////////////////////////////
+NodeSharedPrivate::HeaderFrames &NodeSharedPrivate::PublisherFrames(
+    const uint64_t _publisherId, const std::string &_topic,
+    const std::string &_msgType, const std::string &_sender)
+{
+  // The address of the process doesn't change once the publishers exist.
+  HeaderFrames &frames = this->headerFrames[_publisherId];
+  if (frames.topic == _topic && frames.msgType == _msgType)
+    return frames;
+
+  frames.topic = _topic;
+  frames.msgType = _msgType;
+  frames.topicFrame.rebuild(_topic.data(), _topic.size());
+  frames.addressFrame.rebuild(_sender.data(), _sender.size());
+  frames.typeFrame.rebuild(_msgType.data(), _msgType.size());
+
+  zmq::message_t header;
+  if (PackHeader(_sender, _msgType, nullptr, header))
+  {
+    frames.compactHeader.assign(static_cast<const char *>(header.data()),
+      header.size());
+  }
+  else
+  {
+    frames.compactHeader.clear();
+  }
+  return frames;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::RemovePublisherFrames(const uint64_t _publisherId)
+{
+  this->headerFrames.erase(_publisherId);
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::CopyFrame(zmq::message_t &_cached,
+    zmq::message_t &_frame)
+{
+#ifdef IGN_ZMQ_POST_4_3_1
+  _frame.copy(_cached);
+#else
+  _frame.copy(&_cached);
+#endif
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::PackHeader(const HeaderFrames &_frames,
+    const PublicationMetadata &_meta, zmq::message_t &_header)
+{
+  const std::string &prefix = _frames.compactHeader;
+  _header.rebuild(prefix.size() + sizeof(PublicationMetadata));
+  char *p = static_cast<char *>(_header.data());
+  memcpy(p, prefix.data(), prefix.size());
+  memcpy(p + prefix.size(), &_meta, sizeof(PublicationMetadata));
+
+  // The flags tell that the metadata follows.
+  p[0] = 1;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::UnpackHeader(const zmq::message_t &_header,
+    std::string &_sender, std::string &_msgType, PublicationMetadata &_meta,
+    bool &_haveMeta)
+{
+  const char *p = static_cast<const char *>(_header.data());
+  const char *end = p + _header.size();
+
+  auto readLen = [&p, end](uint16_t &_len) -> bool
+  {
+    if (static_cast<size_t>(end - p) < sizeof(_len))
+      return false;
+    memcpy(&_len, p, sizeof(_len));
+    p += sizeof(_len);
+    return static_cast<size_t>(end - p) >= _len;
+  };
+
+  uint8_t flags;
+  if (p == end)
+    return false;
+  memcpy(&flags, p, sizeof(flags));
+  p += sizeof(flags);
+
+  uint16_t len;
+  if (!readLen(len))
+    return false;
+  _sender.assign(p, len);
+  IGN_TRANSPORT_COUNT_COPY(len);
+  p += len;
+
+  if (!readLen(len))
+    return false;
+  _msgType.assign(p, len);
+  IGN_TRANSPORT_COUNT_COPY(len);
+  p += len;
+
+  _haveMeta = (flags & 1u) != 0;
+  if (_haveMeta)
+  {
+    // The metadata of the older versions is shorter.
+    const size_t metaSize = static_cast<size_t>(end - p);
+    if (metaSize < kLegacyMetadataSize)
+      return false;
+    memcpy(&_meta, p, std::min(metaSize, sizeof(PublicationMetadata)));
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+void NodeSharedPrivate::PackRequestId(uint64_t _id, uint64_t _timeout,
+    uint64_t _window, zmq::message_t &_frame)
+{
+  // Fixed sizes, so it can't be confused with a handler UUID.
+  std::size_t size = sizeof(_id);
+  if (_window > 0)
+    size += sizeof(_timeout) + sizeof(_window);
+  else if (_timeout > 0)
+    size += sizeof(_timeout);
+
+  _frame.rebuild(size);
+  char *p = static_cast<char *>(_frame.data());
+  memcpy(p, &_id, sizeof(_id));
+  if (size > sizeof(_id))
+    memcpy(p + sizeof(_id), &_timeout, sizeof(_timeout));
+  if (_window > 0)
+    memcpy(p + sizeof(_id) + sizeof(_timeout), &_window, sizeof(_window));
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::UnpackRequestId(const zmq::message_t &_frame,
+    uint64_t &_id)
+{
+  if (_frame.size() != sizeof(_id) && _frame.size() != 2 * sizeof(_id) &&
+      _frame.size() != 3 * sizeof(_id))
+  {
+    return false;
+  }
+
+  memcpy(&_id, _frame.data(), sizeof(_id));
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::UnpackRequestTimeout(const std::string &_reqId,
+    uint64_t &_timeout)
+{
+  // Requests without a deadline, or sent by older requesters, carry a
+  // request id of a different size.
+  if (_reqId.size() != 2 * sizeof(uint64_t) &&
+      _reqId.size() != 3 * sizeof(uint64_t))
+  {
+    return false;
+  }
+
+  memcpy(&_timeout, _reqId.data() + sizeof(uint64_t), sizeof(_timeout));
+  return _timeout > 0;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::UnpackOnewayBatch(const std::string &_data,
+    std::vector<std::string> &_requests)
+{
+  _requests.clear();
+  std::size_t offset = 0;
+  while (offset < _data.size())
+  {
+    uint32_t size;
+    if (_data.size() - offset < sizeof(size))
+      return false;
+    memcpy(&size, _data.data() + offset, sizeof(size));
+    offset += sizeof(size);
+
+    if (_data.size() - offset < size)
+      return false;
+    _requests.emplace_back(_data, offset, size);
+    offset += size;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool NodeSharedPrivate::UnpackRequestWindow(const std::string &_reqId,
+    uint64_t &_window)
+{
+  if (_reqId.size() != 3 * sizeof(uint64_t))
+    return false;
+
+  memcpy(&_window, _reqId.data() + 2 * sizeof(uint64_t), sizeof(_window));
+  return _window > 0;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::MonitorSocket(zmq::socket_t &_socket,
+    zmq::socket_t &_monitor, const std::string &_endpoint, const int _events)
+{
+  if (zmq_socket_monitor(static_cast<void *>(_socket), _endpoint.c_str(),
+        _events) != 0)
+  {
+    std::cerr << "Unable to monitor a socket: " << zmq_strerror(zmq_errno())
+              << std::endl;
+    return;
+  }
+
+  int lingerVal = 0;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+  _monitor.set(zmq::sockopt::linger, lingerVal);
+#else
+  _monitor.setsockopt(ZMQ_LINGER, &lingerVal, sizeof(lingerVal));
+#endif
+  _monitor.connect(_endpoint.c_str());
+}
+
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::RecvMonitorEvent(zmq::socket_t &_monitor,
+    std::atomic<uint64_t> &_connections, std::string *_endpoint)
+{
+  // Each event has two frames: the event id and value, and the endpoint.
+  zmq::message_t event;
+  zmq::message_t endpoint;
+  try
+  {
+#ifdef IGN_ZMQ_POST_4_3_1
+    if (!_monitor.recv(event) || !event.more() || !_monitor.recv(endpoint))
+#else
+    if (!_monitor.recv(&event, 0) || !event.more() ||
+        !_monitor.recv(&endpoint, 0))
+#endif
+    {
+      return false;
+    }
+  }
+  catch(const zmq::error_t &)
+  {
+    return false;
+  }
+
+  uint16_t id;
+  if (event.size() < sizeof(id))
+    return false;
+  memcpy(&id, event.data(), sizeof(id));
+
+  // Only the reception thread updates the connections.
+  if (id != ZMQ_EVENT_DISCONNECTED)
+  {
+    _connections.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (_connections.load(std::memory_order_relaxed) > 0)
+    _connections.fetch_sub(1, std::memory_order_relaxed);
+  if (_endpoint)
+  {
+    _endpoint->assign(reinterpret_cast<const char *>(endpoint.data()),
+      endpoint.size());
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+void NodeSharedPrivate::EnableHeartbeats(zmq::socket_t &_socket) const
+{
+#ifdef ZMQ_HEARTBEAT_IVL
+  const int interval = this->NonNegativeEnvVar(
+    "IGN_TRANSPORT_CONNECTION_HEARTBEAT", kDefaultConnectionHeartbeat);
+  if (interval == 0)
+    return;
+
+  // A connection is closed after missing a few heartbeats, and the peer
+  // closes it as well if it doesn't hear from us.
+  const int timeout = 3 * interval;
+  try
+  {
+#ifdef IGN_CPPZMQ_POST_4_7_0
+    _socket.set(zmq::sockopt::heartbeat_ivl, interval);
+    _socket.set(zmq::sockopt::heartbeat_timeout, timeout);
+    _socket.set(zmq::sockopt::heartbeat_ttl, timeout);
+#else
+    _socket.setsockopt(ZMQ_HEARTBEAT_IVL, &interval, sizeof(interval));
+    _socket.setsockopt(ZMQ_HEARTBEAT_TIMEOUT, &timeout, sizeof(timeout));
+    _socket.setsockopt(ZMQ_HEARTBEAT_TTL, &timeout, sizeof(timeout));
+#endif
+  }
+  catch(const zmq::error_t &_error)
+  {
+    std::cerr << "Unable to enable the heartbeats of a socket: "
+              << _error.what() << std::endl;
+  }
+#else
+  (void)_socket;
+#endif
+}
+
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::RecvMessage(zmq::socket_t &_socket,
+    const std::string &_pUuid, ReceivedMessage &_received)
+{
+  zmq::message_t msg(0);
+  try
+  {
+#ifdef IGN_ZMQ_POST_4_3_1
+    if (!_socket.recv(msg))
+#else
+    if (!_socket.recv(&msg, 0))
+#endif
+      return false;
+    _received.receptionTime = std::chrono::steady_clock::now();
+    _received.receptionSystemTime = std::chrono::system_clock::now();
+    if (callbackTracing)
+      _received.received = _received.receptionTime;
+    _received.topic = std::string(reinterpret_cast<char *>(msg.data()),
+      msg.size());
+    IGN_TRANSPORT_COUNT_COPY(msg.size());
+    StripRateLimitedFilter(_pUuid, _received.topic);
+
+    if (!_received.topic.empty() && _received.topic[0] == kFragmentPrefix[0])
+    {
+      // Fragment framing: filter, sender, type, metadata, position and
+      // data, whatever the framing of the other messages.
+      std::array<zmq::message_t, 4> frames;
+      for (auto &frame : frames)
+      {
+#ifdef IGN_ZMQ_POST_4_3_1
+        if (!_socket.recv(frame))
+#else
+        if (!_socket.recv(&frame, 0))
+#endif
+          return false;
+      }
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!_socket.recv(_received.payload))
+#else
+      if (!_socket.recv(&_received.payload, 0))
+#endif
+        return false;
+
+      if (frames[2].size() < kLegacyMetadataSize ||
+          frames[3].size() < sizeof(FragmentHeader))
+      {
+        std::cerr << "NodeShared::RecvMsgUpdate(): Malformed fragment "
+                  << "received on topic [" << _received.topic << "]"
+                  << std::endl;
+        return false;
+      }
+
+      _received.topic.erase(0, sizeof(kFragmentPrefix) - 1);
+      _received.sender = std::string(
+        reinterpret_cast<char *>(frames[0].data()), frames[0].size());
+      _received.msgType = std::string(
+        reinterpret_cast<char *>(frames[1].data()), frames[1].size());
+      memcpy(&_received.meta, frames[2].data(),
+        std::min(frames[2].size(), sizeof(PublicationMetadata)));
+      memcpy(&_received.fragmentHeader, frames[3].data(),
+        sizeof(FragmentHeader));
+      _received.haveMeta = true;
+      _received.fragment = true;
+
+      // A message is counted once, with its first fragment.
+      if (_received.fragmentHeader.offset == 0)
+        this->receivedMsgs.fetch_add(1, std::memory_order_relaxed);
+      this->CountTraffic(this->recvTraffic, "ign_transport_received",
+        _received.topic, _received.payload.size());
+      return true;
+    }
+
+    // The frame after the topic is the compact header or, with the default
+    // framing, the address of the publisher. The flags of the compact
+    // header, its first byte, are never the first character of an address.
+#ifdef IGN_ZMQ_POST_4_3_1
+    if (!_socket.recv(msg))
+#else
+    if (!_socket.recv(&msg, 0))
+#endif
+      return false;
+    const bool compactHeader = msg.size() > 0 &&
+      static_cast<const uint8_t *>(msg.data())[0] <= 1u;
+
+    // Whether a compression frame follows the data.
+    bool compressed = false;
+    if (compactHeader)
+    {
+      // Compact framing: topic, header, data and, if the message is
+      // compressed, the compression frame.
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!_socket.recv(_received.payload))
+#else
+      if (!_socket.recv(&_received.payload, 0))
+#endif
+        return false;
+
+      if (!UnpackHeader(msg, _received.sender,
+            _received.msgType, _received.meta, _received.haveMeta))
+      {
+        std::cerr << "NodeShared::RecvMsgUpdate(): Malformed header "
+                  << "received on topic [" << _received.topic << "]"
+                  << std::endl;
+        return false;
+      }
+      compressed = _received.payload.more();
+    }
+    else
+    {
+      // TODO(caguero): Use this as extra metadata for the subscriber.
+      _received.sender = std::string(reinterpret_cast<char *>(msg.data()),
+        msg.size());
+      IGN_TRANSPORT_COUNT_COPY(msg.size());
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!_socket.recv(_received.payload))
+#else
+      if (!_socket.recv(&_received.payload, 0))
+#endif
+        return false;
+
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!_socket.recv(msg))
+#else
+      if (!_socket.recv(&msg, 0))
+#endif
+        return false;
+      _received.msgType = std::string(reinterpret_cast<char *>(msg.data()),
+        msg.size());
+      IGN_TRANSPORT_COUNT_COPY(msg.size());
+
+      // The publisher only attaches the metadata if some subscriber
+      // collects statistics on the topic, or if all of them read it.
+      if (msg.more())
+      {
+#ifdef IGN_ZMQ_POST_4_3_1
+        if (!_socket.recv(msg))
+#else
+        if (!_socket.recv(&msg, 0))
+#endif
+          return false;
+
+        // Older publishers don't send the publisher id.
+        if (msg.size() >= sizeof(_received.meta.stamp) +
+              sizeof(_received.meta.seq))
+        {
+          memcpy(&_received.meta, msg.data(),
+            std::min(msg.size(), sizeof(PublicationMetadata)));
+          _received.haveMeta = true;
+        }
+        compressed = msg.more();
+      }
+    }
+
+    this->receivedMsgs.fetch_add(1, std::memory_order_relaxed);
+    this->CountTraffic(this->recvTraffic, "ign_transport_received",
+      _received.topic, _received.payload.size());
+
+    // The compressed messages end with a compression frame, see
+    // AdvertiseMessageOptions::SetCompression().
+    if (compressed)
+    {
+#ifdef IGN_ZMQ_POST_4_3_1
+      if (!_socket.recv(msg))
+#else
+      if (!_socket.recv(&msg, 0))
+#endif
+        return false;
+      if (!this->DecompressPayload(msg, _received))
+        return false;
+    }
+  }
+  catch(const zmq::error_t &_error)
+  {
+    std::cerr << "Error: " << _error.what() << std::endl;
+    return false;
   }
 
-  return sndHwm;
+  return true;
 }
 
-//////////////////////////////////////////////////
-bool NodeShared::HandlerWrapper::HasSubscriber(
-    const std::string &_fullyQualifiedTopic,
-    const std::string &_msgType) const
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::SendFirstFrame(zmq::socket_t &_socket,
+    zmq::message_t &_frame, const std::string &_topic)
 {
-  std::shared_ptr<ISubscriptionHandler> normalSubscriberPtr;
-  std::shared_ptr<RawSubscriptionHandler> rawSubscriberPtr;
-
-  return this->normal.FirstHandler(
-            _fullyQualifiedTopic, _msgType, normalSubscriberPtr)
-         || this->raw.FirstHandler(
-            _fullyQualifiedTopic, _msgType, rawSubscriberPtr);
-}
+  if (!this->countHwmDrops)
+  {
+#ifdef IGN_ZMQ_POST_4_3_1
+    _socket.send(_frame, zmq::send_flags::sndmore);
+#else
+    _socket.send(_frame, ZMQ_SNDMORE);
+#endif
+  }
+  else
+  {
+    // With ZMQ_XPUB_NODROP, the socket refuses the message if the send
+    // buffer of any subscriber is full. It can only happen on the first
+    // frame of a message.
+#ifdef IGN_ZMQ_POST_4_3_1
+    const bool sent = _socket.send(_frame,
+      zmq::send_flags::sndmore | zmq::send_flags::dontwait).has_value();
+#else
+    const bool sent = _socket.send(_frame, ZMQ_SNDMORE | ZMQ_DONTWAIT);
+#endif
+    if (!sent)
+    {
+      this->hwmDroppedMsgs.fetch_add(1, std::memory_order_relaxed);
+      this->metrics.GetCounter("ign_transport_hwm_dropped_messages_total",
+        MetricsRegistry::Label("topic", _topic)).Add();
+      return false;
+    }
+  }
 
-//////////////////////////////////////////////////
-bool NodeShared::HandlerWrapper::HasSubscriber(
-    const std::string &_fullyQualifiedTopic) const
-{
-  return this->normal.HasHandlersForTopic(_fullyQualifiedTopic)
-      || this->raw.HasHandlersForTopic(_fullyQualifiedTopic);
+  this->sentMsgs.fetch_add(1, std::memory_order_relaxed);
+  return true;
 }
 
-//////////////////////////////////////////////////
-template <typename HandlerT>
-static void AppendNodeUuids(const HandlerStorage<HandlerT> &_handlerStorage,
-                            const std::string &_fullyQualifiedTopic,
-                            const std::string &_msgTypeName,
-                            std::vector<std::string> &_uuids)
+/////////////////////////////////////////////////
+void NodeSharedPrivate::SendRoutingId(zmq::socket_t &_socket,
+    const std::string &_id, const bool _newConnection)
 {
-  using HandlerTPtr = std::shared_ptr<HandlerT>;
-  std::map<std::string, std::map<std::string, HandlerTPtr>> handlers;
-
-  _handlerStorage.Handlers(_fullyQualifiedTopic, handlers);
-  for (const auto &collection : handlers)
+  const auto giveUp =
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+  while (true)
   {
-    for (const auto &collectionEntry : collection.second)
+    zmq::message_t msg(_id.data(), _id.size());
+    try
     {
-      const HandlerTPtr &handler = collectionEntry.second;
-      const std::string &handlerMsgType = handler->TypeName();
-      if (handlerMsgType == _msgTypeName
-          || handlerMsgType == kGenericMessageType)
+#ifdef IGN_ZMQ_POST_4_3_1
+      _socket.send(msg, zmq::send_flags::sndmore);
+#else
+      _socket.send(msg, ZMQ_SNDMORE);
+#endif
+      return;
+    }
+    catch(const zmq::error_t &_error)
+    {
+      // The peer is unknown until the handshake completes.
+      if (!_newConnection || _error.num() != EHOSTUNREACH ||
+          std::chrono::steady_clock::now() >= giveUp)
       {
-        _uuids.push_back(handler->NodeUuid());
+        throw;
       }
     }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
   }
 }
 
-//////////////////////////////////////////////////
-std::vector<std::string> NodeShared::HandlerWrapper::NodeUuids(
-    const std::string &_fullyQualifiedTopic,
-    const std::string &_msgTypeName) const
+/////////////////////////////////////////////////
+void NodeSharedPrivate::NotifyPeersChanged()
 {
-  std::vector<std::string> uuids;
-  AppendNodeUuids(this->normal, _fullyQualifiedTopic, _msgTypeName, uuids);
-  AppendNodeUuids(this->raw, _fullyQualifiedTopic, _msgTypeName, uuids);
-
-  return uuids;
+  {
+    std::lock_guard<std::mutex> lock(this->peersMutex);
+    ++this->peersVersion;
+  }
+  this->peersChanged.notify_all();
 }
 
-//////////////////////////////////////////////////
-bool NodeShared::HandlerWrapper::RemoveHandlersForNode(
-    const std::string &_fullyQualifiedTopic,
-    const std::string &_nUuid)
+/////////////////////////////////////////////////
+void NodeSharedPrivate::NotifyDiscoveryChange(
+    const DiscoveryChange_t _change, const MessagePublisher &_pub)
 {
-  bool removed = false;
-  removed |= this->normal.RemoveHandlersForNode(_fullyQualifiedTopic, _nUuid);
-  removed |= this->raw.RemoveHandlersForNode(_fullyQualifiedTopic, _nUuid);
+  if (this->connectionsCbCount == 0)
+    return;
 
-  return removed;
-}
+  // The callbacks run in the queue executor, one at a time and in order, so
+  // they can subscribe to the topic without holding any lock of the caller.
+  this->QueueExecutor().Post(kDiscoveryLane, [this, _change, _pub]()
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->connectionsCbMutex);
 
+    // A callback may remove itself, so iterate over a copy of the ids.
+    std::vector<uint64_t> ids;
+    for (const auto &cb : this->connectionsCbs)
+      ids.push_back(cb.first);
 
-//////////////////////////////////////////////////
-void NodeSharedPrivate::SecurityOnNewConnection()
-{
-  std::string user, pass;
+    for (const uint64_t id : ids)
+    {
+      auto it = this->connectionsCbs.find(id);
+      if (it == this->connectionsCbs.end())
+        continue;
 
-  // Set username and pass if they exist
-  // \todo(anyone): This will cause the subscriber to connect only to secure
-  // connections. Would be nice if the subscriber could still connect to
-  // unsecure connections. This might require an unsecure and secure
-  // subscriber.
-  // See issue #74
-  if (userPass(user, pass))
-  {
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->subscriber->set(zmq::sockopt::plain_username, user);
-    this->subscriber->set(zmq::sockopt::plain_password, pass);
-#else
-    this->subscriber->setsockopt(ZMQ_PLAIN_USERNAME, user.c_str(), user.size());
-    this->subscriber->setsockopt(ZMQ_PLAIN_PASSWORD, pass.c_str(), pass.size());
-#endif
-  }
+      // The callback may be removed while it runs
+      const auto cb = it->second;
+      cb(_change, _pub);
+    }
+  });
 }
 
-//////////////////////////////////////////////////
-void NodeSharedPrivate::SecurityInit()
+/////////////////////////////////////////////////
+void NodeSharedPrivate::ReplayDiscovery(const uint64_t _id)
 {
-  // Check if a username and password has been set. If so, then
-  // setup a PLAIN authentication server.
-  std::string user, pass;
-  if (userPass(user, pass))
+  // The snapshot is taken in the lane of the changes: the ones queued
+  // before were applied to it, the ones queued after weren't.
+  this->QueueExecutor().Post(kDiscoveryLane, [this, _id]()
   {
-    // Create the access control thread.
-    this->accessControlThread = std::thread(
-        &NodeSharedPrivate::AccessControlHandler, this);
+    std::vector<MessagePublisher> publishers;
+    std::vector<std::string> topics;
+    this->msgDiscovery->TopicList(topics, std::chrono::milliseconds(0));
+    for (const auto &topic : topics)
+    {
+      MsgAddresses_M pubs;
+      if (!this->msgDiscovery->Publishers(topic, pubs))
+        continue;
+      for (auto &proc : pubs)
+      {
+        publishers.insert(publishers.end(), proc.second.begin(),
+          proc.second.end());
+      }
+    }
 
-    int asPlainSecurityServer = static_cast<int>(
-        ZmqPlainSecurityServerOptions::ZMQ_PLAIN_SECURITY_SERVER_ENABLED);
+    std::lock_guard<std::recursive_mutex> lock(this->connectionsCbMutex);
+    for (const auto &pub : publishers)
+    {
+      auto it = this->connectionsCbs.find(_id);
+      if (it == this->connectionsCbs.end())
+        return;
 
-#ifdef IGN_CPPZMQ_POST_4_7_0
-    this->publisher->set(zmq::sockopt::plain_server, asPlainSecurityServer);
-    this->publisher->set(zmq::sockopt::zap_domain, kIgnAuthDomain);
-#else
-    this->publisher->setsockopt(ZMQ_PLAIN_SERVER,
-        &asPlainSecurityServer, sizeof(asPlainSecurityServer));
-    this->publisher->setsockopt(ZMQ_ZAP_DOMAIN, kIgnAuthDomain,
-        std::strlen(kIgnAuthDomain));
-#endif
-  }
+      const auto cb = it->second;
+      cb(DiscoveryChange_t::ADDED, pub);
+    }
+  });
 }
 
-//////////////////////////////////////////////////
-// Access control handler for plain security.
-// This function is designed to be run in a thread.
-void NodeSharedPrivate::AccessControlHandler()
+/////////////////////////////////////////////////
+bool NodeSharedPrivate::WaitForPeers(const std::function<bool()> &_done,
+    const std::chrono::milliseconds &_timeout)
 {
-  zmq::socket_t *sock = new zmq::socket_t(*this->context, ZMQ_REP);
-
-  try
+  const auto deadline = std::chrono::steady_clock::now() + _timeout;
+  std::unique_lock<std::mutex> lock(this->peersMutex);
+  while (true)
   {
-    // Bind to the zap address
-    sock->bind("inproc://zeromq.zap.01");
-
-    // Get the username and password
-    std::string user, pass;
-    if (!userPass(user, pass))
+    const uint64_t version = this->peersVersion;
+    lock.unlock();
+    if (_done())
+      return true;
+    lock.lock();
+
+    if (!this->peersChanged.wait_until(lock, deadline,
+          [&] { return this->peersVersion != version; }))
     {
-      std::cerr << "Username and password not set. "
-                << "Authentication is disabled\n";
-      sock->close();
-      delete sock;
-      return;
+      return false;
     }
+  }
+}
 
-    std::string sequence;
-    std::string domain;
-    std::string address;
-    std::string routingId;
-    std::string mechanism;
-    std::string givenUsername;
-    std::string givenPassword;
-    std::string version;
-
-    zmq::pollitem_t items[] =
-    {
-      {static_cast<void*>(*sock), 0, ZMQ_POLLIN, 0},
-    };
+/////////////////////////////////////////////////
+void NodeSharedPrivate::EvictIdleConnections(std::recursive_mutex &_mutex,
+    const bool _verbose)
+{
+  const auto now = ConnectionCache::Clock::now();
+  if (now < this->nextEviction)
+    return;
+  this->nextEviction = now + std::chrono::seconds(1);
 
-    // Process
-    while (!this->exit)
+  auto evict = [_verbose](zmq::socket_t &_socket, ConnectionCache &_cache,
+    const ConnectionCache::Clock::time_point &_now)
+  {
+    for (const auto &addr : _cache.Expire(_now))
     {
       try
       {
-        zmq::poll(&items[0], sizeof(items) / sizeof(items[0]),
-            std::chrono::milliseconds(NodeSharedPrivate::Timeout));
+        _socket.disconnect(addr.c_str());
       }
-      catch(...)
+      catch(const zmq::error_t &/*_error*/)
       {
-        continue;
+        // Already disconnected.
       }
 
-      if (items[0].revents & ZMQ_POLLIN)
-      {
-        // Get the version.
-        version = receiveHelper(*sock);
-        if (version.empty())
-          break;
-
-        // Get remaining data
-        sequence = receiveHelper(*sock);
-        domain = receiveHelper(*sock);
-        address = receiveHelper(*sock);
-        routingId = receiveHelper(*sock);
-        mechanism = receiveHelper(*sock);
-        givenUsername = receiveHelper(*sock);
-        givenPassword = receiveHelper(*sock);
-
-        // eliminate unused variable warning when debug statements are commented
-        (void)routingId;
-
-        // Debug statements
-        // std::cout << "Version[" << version << "]\n";
-        // std::cout << "Sequence[" << sequence << "]\n";
-        // std::cout << "Domain[" << domain << "]\n";
-        // std::cout << "Address[" << address << "]\n";
-        // std::cout << "Routing Id[" << routingId << "]\n";
-        // std::cout << "Mechanism[" << mechanism << "]\n";
-        // std::cout << "Username[" << givenUsername << "] [" << user << "]\n";
-        // std::cout << "Pass[" << givenPassword << "] [" << pass << "]\n";
-
-        // Check that we received some kind of address. This could be used
-        // in the future to only accept connections from specific addresses.
-        if (address.empty())
-        {
-          sendAuthErrorHelper(*sock, "Invalid address");
-          continue;
-        }
+      if (_verbose)
+        std::cout << "\t* Disconnected idle [" << addr << "]" << std::endl;
+    }
+  };
 
-        // Check the version
-        if (version != "1.0")
-        {
-          sendAuthErrorHelper(*sock, "Invalid version");
-          continue;
-        }
+  // Nothing is connected before the services are initialized.
+  if (!this->servicesInitialized)
+    return;
 
-        // Check the mechanism
-        if (mechanism != "PLAIN")
-        {
-          sendAuthErrorHelper(*sock, "Invalid mechanism");
-          continue;
-        }
+  std::lock_guard<std::recursive_mutex> lock(_mutex);
+  evict(*this->requester, this->requesterConnections, now);
+  evict(*this->replier, this->replierConnections, now);
+  evict(*this->replySender, this->replySenderConnections, now);
+}
 
-        // Check the domain
-        if (std::strcmp(domain.c_str(), kIgnAuthDomain) != 0)
-        {
-          sendAuthErrorHelper(*sock, "Invalid domain");
-          continue;
-        }
+//////////////////////////////////////////////////
+void NodeSharedPrivate::WakeUpReception()
+{
+  std::lock_guard<std::mutex> lk(this->wakeupMutex);
+  SendWakeup(*this->wakeupSender);
+}
 
-#ifdef IGN_ZMQ_POST_4_3_1
-        sendHelper(*sock, version, zmq::send_flags::sndmore);
-        sendHelper(*sock, sequence, zmq::send_flags::sndmore);
+//////////////////////////////////////////////////
+void NodeSharedPrivate::ConnectWakeup(zmq::socket_t &_receiver,
+    zmq::socket_t &_sender, const std::string &_endpoint)
+{
+  int lingerVal = 0;
+#ifdef IGN_CPPZMQ_POST_4_7_0
+  _receiver.set(zmq::sockopt::linger, lingerVal);
+  _sender.set(zmq::sockopt::linger, lingerVal);
 #else
-        sendHelper(*sock, version, ZMQ_SNDMORE);
-        sendHelper(*sock, sequence, ZMQ_SNDMORE);
+  _receiver.setsockopt(ZMQ_LINGER, &lingerVal, sizeof(lingerVal));
+  _sender.setsockopt(ZMQ_LINGER, &lingerVal, sizeof(lingerVal));
 #endif
+  _receiver.bind(_endpoint.c_str());
+  _sender.connect(_endpoint.c_str());
+}
 
-        // Check the username and password
-        if (givenUsername == user && givenPassword == pass)
-        {
-#ifdef IGN_ZMQ_POST_4_3_1
-          sendHelper(*sock, "200", zmq::send_flags::sndmore);
-          sendHelper(*sock, "OK", zmq::send_flags::sndmore);
-          sendHelper(*sock, "anonymous", zmq::send_flags::sndmore);
-          sendHelper(*sock, "", zmq::send_flags::none);
-#else
-          sendHelper(*sock, "200", ZMQ_SNDMORE);
-          sendHelper(*sock, "OK", ZMQ_SNDMORE);
-          sendHelper(*sock, "anonymous", ZMQ_SNDMORE);
-          sendHelper(*sock, "", 0);
-#endif
-        }
-        else
-        {
-          sendAuthErrorHelper(*sock, "Invalid username or password");
-        }
-      }
-    }
+//////////////////////////////////////////////////
+void NodeSharedPrivate::SendWakeup(zmq::socket_t &_sender)
+{
+  try
+  {
+    sendHelper(_sender, "", ZMQ_DONTWAIT);
   }
-  catch (...)
+  catch(const zmq::error_t &/*_error*/)
   {
-    // This catch can be triggered when ctrl-c is pressed and the context is
-    // deleted. Capture this case, and quit gracefully.
+    // The thread will see it when it wakes up on its own.
   }
+}
 
-  sock->close();
-  delete sock;
+//////////////////////////////////////////////////
+std::chrono::milliseconds NodeSharedPrivate::ReceptionTimeout() const
+{
+  // Check the copies of the latched messages and the deadlines of the
+  // service requests often enough.
+  std::chrono::milliseconds periodicTimeout(-1);
+  if (this->latchedResendsPending)
+    periodicTimeout = std::chrono::milliseconds(50);
+  else if (this->inFlightDeadlinesPending)
+    periodicTimeout = kRequestExpiryPeriod;
+
+  // Keep sending the fragments, a bit later if the send buffers are full.
+  if (this->fragmentsPending)
+    return std::chrono::milliseconds(this->fragmentsBlocked ? 1 : 0);
+
+  if (!this->evictionEnabled)
+    return periodicTimeout;
+
+  const auto now = ConnectionCache::Clock::now();
+  if (now >= this->nextEviction)
+    return std::chrono::milliseconds(0);
+
+  const auto evictionTimeout = std::chrono::ceil<std::chrono::milliseconds>(
+    this->nextEviction - now);
+  if (periodicTimeout.count() >= 0)
+    return std::min(periodicTimeout, evictionTimeout);
+  return evictionTimeout;
 }
 
-/////////////////////////////////////////////////
-void NodeSharedPrivate::PublishThread()
+//////////////////////////////////////////////////
+std::size_t NodeSharedPrivate::SelectResponder(const std::string &_topic,
+    const std::vector<ServicePublisher> &_responders)
 {
-  // Loop until exits
-  while (!this->exit)
+  const std::size_t n = _responders.size();
+  if (this->serviceBalancing == ServiceBalancing::FIRST || n == 1)
+    return 0;
+
+  // Ties are broken by rotating the first candidate, so idle responders
+  // share the load too.
+  const std::size_t start = this->nextResponder[_topic]++ % n;
+  if (this->serviceBalancing == ServiceBalancing::ROUND_ROBIN)
+    return start;
+
+  // Responders without samples yet are assumed to be as slow as the
+  // slowest candidate with samples, so the ones that never reply (e.g.:
+  // hung, or requests without timeout) don't keep taking every request.
+  double worstLatency = 0;
+  if (this->serviceBalancing == ServiceBalancing::LATENCY)
   {
-    std::unique_ptr<PublishMsgDetails> msgDetails = nullptr;
-    // Lock the mutex, and acquire the next message to be published.
+    for (const auto &responder : _responders)
     {
-      std::unique_lock<std::mutex> queueLock(this->pubThreadMutex);
-
-      // Wait for more messages if the queue is empty. Otherwise get the
-      // next message and continue.
-      if (this->pubQueue.empty())
-      {
-        auto now = std::chrono::system_clock::now();
-        this->signalNewPub.wait_until(queueLock, now + 500ms,
-          [&]{return !this->pubQueue.empty() || this->exit;});
-      }
-
-      if (this->pubQueue.empty())
-        continue;
-
-      // Stop early on exit.
-      if (this->exit)
-        break;
-
-      // Get the message
-      msgDetails = std::move(this->pubQueue.front());
-      this->pubQueue.pop();
+      auto it = this->responderStats.find(responder.SocketId());
+      if (it != this->responderStats.end() && it->second.hasLatency)
+        worstLatency = std::max(worstLatency, it->second.latency);
     }
+  }
 
-    // Send the message to all the local handlers.
-    for (auto &handler : msgDetails->localHandlers)
+  std::size_t best = start;
+  double bestCost = std::numeric_limits<double>::max();
+  for (std::size_t k = 0; k < n; ++k)
+  {
+    const std::size_t i = (start + k) % n;
+    double cost = 0;
+    auto it = this->responderStats.find(_responders[i].SocketId());
+    if (it != this->responderStats.end())
     {
-      try
-      {
-        handler->RunLocalCallback(*(msgDetails->msgCopy.get()),
-            msgDetails->info);
-      }
-      catch (...)
+      const ResponderStats &stats = it->second;
+      cost = static_cast<double>(stats.outstanding);
+
+      // Idle responders without samples yet are tried first. If none of
+      // the candidates has samples, fall back to the outstanding requests.
+      if (this->serviceBalancing == ServiceBalancing::LATENCY)
       {
-        std::cerr << "Exception occurred in a local callback "
-          << "on topic [" << msgDetails->info.Topic() << "] with message ["
-          << msgDetails->msgCopy->DebugString() << "]" << std::endl;
+        if (stats.hasLatency)
+          cost = stats.latency * (cost + 1);
+        else if (worstLatency > 0)
+          cost *= worstLatency;
       }
     }
 
-    // Send the message to all the raw handlers.
-    for (auto &handler : msgDetails->rawHandlers)
+    if (cost < bestCost)
     {
-      try
-      {
-        handler->RunRawCallback(msgDetails->sharedBuffer.get(),
-            msgDetails->msgSize, msgDetails->info);
-      }
-      catch (...)
-      {
-        std::cerr << "Exception occured in a local raw callback "
-          << "on topic [" << msgDetails->info.Topic() << "] with "
-          << "message [" << msgDetails->msgCopy->DebugString() << "]"
-          << std::endl;
-      }
+      bestCost = cost;
+      best = i;
     }
   }
+  return best;
 }
 
 //////////////////////////////////////////////////
-std::optional<transport::TopicStatistics> NodeShared::TopicStats(
-    const std::string &_topic) const
+void NodeSharedPrivate::RequestFinished(const InFlightRequest &_req,
+    const std::chrono::steady_clock::time_point &_now)
 {
-  if (this->dataPtr->topicStats.find(_topic) != this->dataPtr->topicStats.end())
-    return this->dataPtr->topicStats.at(_topic);
-  return std::nullopt;
+  auto it = this->responderStats.find(_req.responderId);
+  if (it == this->responderStats.end())
+    return;
+
+  // Weight of the last sample in the moving average.
+  const double kWeight = 0.25;
+  const double elapsed =
+    std::chrono::duration<double, std::milli>(_now - _req.sentAt).count();
+
+  ResponderStats &stats = it->second;
+  if (stats.outstanding > 0)
+    --stats.outstanding;
+  stats.latency = stats.hasLatency ?
+    stats.latency + kWeight * (elapsed - stats.latency) : elapsed;
+  stats.hasLatency = true;
 }
 
 //////////////////////////////////////////////////
-void NodeShared::EnableStats(const std::string &_topic, bool _enable,
-    std::function<void(const TopicStatistics &_stats)> _statCb)
+std::vector<NodeSharedPrivate::InFlightRequest>
+  NodeSharedPrivate::ExpireInFlightRequests(
+    const std::chrono::steady_clock::time_point &_now)
 {
-  if (_enable)
+  std::vector<InFlightRequest> expired;
+  auto end = this->inFlightDeadlines.upper_bound(_now);
+  for (auto d = this->inFlightDeadlines.begin(); d != end; ++d)
   {
-    this->dataPtr->enabledTopicStatistics.insert({_topic, _statCb});
+    auto it = this->inFlightRequests.find(d->second);
+    if (it == this->inFlightRequests.end())
+      continue;
+
+    // A request that timed out counts as a slow response.
+    this->RequestFinished(it->second, _now);
+    expired.push_back(std::move(it->second));
+    this->inFlightRequests.erase(it);
   }
-  else
+  this->inFlightDeadlines.erase(this->inFlightDeadlines.begin(), end);
+  this->inFlightDeadlinesPending = !this->inFlightDeadlines.empty();
+  return expired;
+}
+
+//////////////////////////////////////////////////
+std::vector<NodeSharedPrivate::InFlightRequest>
+  NodeSharedPrivate::DropInFlightRequests(const std::string &_responderId)
+{
+  // The deadlines of the requests dropped are skipped when they expire.
+  std::vector<InFlightRequest> dropped;
+  for (auto it = this->inFlightRequests.begin();
+       it != this->inFlightRequests.end();)
   {
-    this->dataPtr->enabledTopicStatistics.extract(_topic);
-    // \todo Also cleanup topicStats.
+    if (it->second.responderId != _responderId)
+    {
+      ++it;
+      continue;
+    }
+    dropped.push_back(std::move(it->second));
+    it = this->inFlightRequests.erase(it);
   }
+  return dropped;
 }
 
 /////////////////////////////////////////////////
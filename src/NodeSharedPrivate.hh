@@ -26,16 +26,33 @@
 #pragma warning(pop)
 #endif
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
-#include <queue>
+#include <mutex>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "ignition/transport/Discovery.hh"
 #include "ignition/transport/Node.hh"
 
+#include "BufferPool.hh"
+#include "ConnectionCache.hh"
+#include "Executor.hh"
+#include "Metrics.hh"
+#include "MpscQueue.hh"
+#include "ReplyCache.hh"
+#include "TopicPrefixTrie.hh"
+
 namespace ignition
 {
   namespace transport
@@ -43,32 +60,104 @@ namespace ignition
     // Inline bracket to help doxygen filtering.
     inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE {
     //
-    /// \brief Metadata for a publication. This is sent as part of the ZMQ
-    /// message for topic statistics.
+    /// \brief Metadata for a publication. It's part of every message with
+    /// the compact header. With the default framing, it's sent in an extra
+    /// frame, only on the topics with remote subscribers collecting topic
+    /// statistics.
     class PublicationMetadata
     {
-      /// \brief Publication timestamp.
+      /// \brief Publication timestamp, in nanoseconds of the steady clock.
       public: uint64_t stamp = 0;
 
-      /// \brief Sequence number, used to detect dropped messages.
+      /// \brief Sequence number of the message in its publisher, starting
+      /// at 1, used to detect dropped messages.
       public: uint64_t seq = 0;
+
+      /// \brief Id of the publisher, unique in its process. Older versions
+      /// don't send it, nor the sequence numbers of each publisher.
+      public: uint64_t publisher = 0;
+
+      /// \brief Publication timestamp, in nanoseconds of the system clock.
+      /// Older versions don't send it.
+      public: uint64_t systemStamp = 0;
+    };
+
+    /// \brief Position of a fragment in a large message sent in fragments,
+    /// see AdvertiseMessageOptions::SetFragmentSize().
+    class FragmentHeader
+    {
+      /// \brief Number of bytes of the whole message.
+      public: uint64_t total = 0;
+
+      /// \brief Position of the first byte of the fragment in the message.
+      public: uint64_t offset = 0;
+    };
+
+    /// \brief A message received from a remote publisher, decoded from the
+    /// frames of the subscriber socket or from a datagram.
+    class ReceivedMessage
+    {
+      /// \brief Fully qualified topic name.
+      public: std::string topic;
+
+      /// \brief Address of the publisher.
+      public: std::string sender;
+
+      /// \brief Message type.
+      public: std::string msgType;
+
+      /// \brief Publication metadata, if haveMeta is true.
+      public: PublicationMetadata meta;
+
+      /// \brief Whether the publisher sent the metadata.
+      public: bool haveMeta = false;
+
+      /// \brief The serialized message. It's kept alive until all the
+      /// callbacks are executed, so raw subscribers and CreateMsg() can read
+      /// straight from the ZMQ buffer.
+      public: zmq::message_t payload;
+
+      /// \brief Whether it was received by the control reception thread.
+      public: bool control = false;
+
+      /// \brief Whether the payload is only a fragment of the message.
+      public: bool fragment = false;
+
+      /// \brief Position of the fragment, if fragment is true.
+      public: FragmentHeader fragmentHeader;
+
+      /// \brief Time of reception.
+      public: std::chrono::steady_clock::time_point receptionTime;
+
+      /// \brief Time of reception, on the system clock.
+      public: std::chrono::system_clock::time_point receptionSystemTime;
+
+      /// \brief Time of reception if the callbacks are traced.
+      public: std::chrono::steady_clock::time_point received;
     };
 
     //
-    // Private data class for NodeShared.
-    class NodeSharedPrivate
+    // Private data class for NodeShared. Visible for the unit tests.
+    class IGNITION_TRANSPORT_VISIBLE NodeSharedPrivate
     {
       // Constructor
       public: NodeSharedPrivate() :
-                context(new zmq::context_t(1)),
+                context(NewContext()),
                 publisher(new zmq::socket_t(*context, ZMQ_PUB)),
                 subscriber(new zmq::socket_t(*context, ZMQ_SUB)),
-                requester(new zmq::socket_t(*context, ZMQ_ROUTER)),
-                responseReceiver(new zmq::socket_t(*context, ZMQ_ROUTER)),
-                replier(new zmq::socket_t(*context, ZMQ_ROUTER))
+                wakeupReceiver(new zmq::socket_t(*context, ZMQ_PAIR)),
+                wakeupSender(new zmq::socket_t(*context, ZMQ_PAIR)),
+                publisherMonitor(new zmq::socket_t(*context, ZMQ_PAIR)),
+                subscriberMonitor(new zmq::socket_t(*context, ZMQ_PAIR))
       {
       }
 
+      /// \brief Create the 0MQ context, with the I/O threads configured by
+      /// ThreadConfig::Global(). The I/O threads start with the first socket,
+      /// so the context is configured before creating any socket.
+      /// \return The new context.
+      public: static zmq::context_t *NewContext();
+
       /// \brief Initialize security
       public: void SecurityInit();
 
@@ -107,6 +196,32 @@ namespace ignition
       /// \brief ZMQ socket to receive topic updates.
       public: std::unique_ptr<zmq::socket_t> subscriber;
 
+      /// \brief Mutex to guarantee exclusive access to the subscriber socket.
+      /// The reception thread reads frames holding only this mutex, so
+      /// publishers contending on NodeShared::mutex are not blocked by it.
+      /// When both are needed, NodeShared::mutex must be locked first.
+      public: std::mutex subscriberMutex;
+
+      /// \brief ZMQ socket to receive the topics of the control traffic
+      /// class, created when the first publisher of one is connected.
+      /// Protected by subscriberMutex. \sa ControlSubscriber().
+      public: std::unique_ptr<zmq::socket_t> controlSubscriber;
+
+      /// \brief Thread receiving from the controlSubscriber, so the control
+      /// topics don't wait for the messages received by the reception
+      /// thread.
+      public: std::thread controlReceptionThread;
+
+      /// \brief ZMQ socket polled by the controlReceptionThread, so it sees
+      /// at once that it has to exit. Created with the thread.
+      public: std::unique_ptr<zmq::socket_t> controlWakeupReceiver;
+
+      /// \brief ZMQ socket connected to the controlWakeupReceiver.
+      public: std::unique_ptr<zmq::socket_t> controlWakeupSender;
+
+      // The sockets of the services are created by
+      // NodeShared::InitializeServices(), the first time they are used.
+
       /// \brief ZMQ socket for sending service call requests.
       public: std::unique_ptr<zmq::socket_t> requester;
 
@@ -116,9 +231,129 @@ namespace ignition
       /// \brief ZMQ socket to receive service call requests.
       public: std::unique_ptr<zmq::socket_t> replier;
 
+      /// \brief ZMQ socket to send the responses of the service calls that
+      /// run in the replyExecutor or are completed asynchronously. The
+      /// replier can't be used because it's polled by the reception thread.
+      /// Protected by NodeShared::srvMutex.
+      public: std::unique_ptr<zmq::socket_t> replySender;
+
+      /// \brief ZMQ socket polled by the reception thread, so it can be
+      /// woken up without a timeout. \sa WakeUpReception.
+      public: std::unique_ptr<zmq::socket_t> wakeupReceiver;
+
+      /// \brief ZMQ socket connected to the wakeupReceiver. Protected by
+      /// wakeupMutex, it's used from any thread.
+      public: std::unique_ptr<zmq::socket_t> wakeupSender;
+
+      /// \brief Mutex protecting the wakeupSender.
+      public: std::mutex wakeupMutex;
+
+      /// \brief ZMQ socket receiving the connection events of the
+      /// publisher socket. Polled by the reception thread.
+      public: std::unique_ptr<zmq::socket_t> publisherMonitor;
+
+      /// \brief ZMQ socket receiving the connection events of the
+      /// subscriber socket. Polled by the reception thread.
+      public: std::unique_ptr<zmq::socket_t> subscriberMonitor;
+
+      /// \brief Start monitoring the connections of a socket.
+      /// \param[in] _socket The socket monitored.
+      /// \param[in] _monitor The socket receiving the events.
+      /// \param[in] _endpoint Endpoint of the monitor.
+      /// \param[in] _events Events monitored.
+      public: static void MonitorSocket(zmq::socket_t &_socket,
+                                        zmq::socket_t &_monitor,
+                                        const std::string &_endpoint,
+                                        const int _events);
+
+      /// \brief Connect the sockets used to wake up a thread: the thread
+      /// polls the receiver, the other threads send through the sender.
+      /// \param[in] _receiver ZMQ_PAIR socket polled by the thread.
+      /// \param[in] _sender ZMQ_PAIR socket connected to _receiver.
+      /// \param[in] _endpoint Inproc endpoint bound by _receiver.
+      public: static void ConnectWakeup(zmq::socket_t &_receiver,
+                                        zmq::socket_t &_sender,
+                                        const std::string &_endpoint);
+
+      /// \brief Wake up the thread polling the receiver of a wakeup pair,
+      /// without blocking. \sa ConnectWakeup.
+      /// \param[in] _sender The sender of the pair.
+      public: static void SendWakeup(zmq::socket_t &_sender);
+
+      /// \brief Receive a connection event of a monitored socket, and
+      /// update its number of connections.
+      /// \param[in] _monitor The socket receiving the events.
+      /// \param[in, out] _connections Number of connections of the socket.
+      /// \param[out] _endpoint Optional endpoint of the connection lost.
+      /// \return True if the event is the loss of a connection.
+      public: static bool RecvMonitorEvent(zmq::socket_t &_monitor,
+                                           std::atomic<uint64_t> &_connections,
+                                           std::string *_endpoint = nullptr);
+
+      /// \brief Send the first frame of a message through a publisher
+      /// socket. When the HWM drops are counted, the message is dropped if
+      /// the send buffer of any subscriber is full.
+      /// \param[in] _socket The publisher socket of the topic.
+      /// \param[in] _frame The frame.
+      /// \param[in] _topic Topic of the message.
+      /// \return False if the message was dropped.
+      public: bool SendFirstFrame(zmq::socket_t &_socket,
+                                  zmq::message_t &_frame,
+                                  const std::string &_topic);
+
+      /// \brief True if the messages dropped at the send HWM are counted,
+      /// see IGN_TRANSPORT_COUNT_HWM_DROPS.
+      public: bool countHwmDrops = false;
+
+      /// \brief Messages handed to the publisher socket.
+      public: std::atomic<uint64_t> sentMsgs{0};
+
+      /// \brief Messages dropped at the send HWM, if counted.
+      public: std::atomic<uint64_t> hwmDroppedMsgs{0};
+
+      /// \brief Messages received by the subscriber socket.
+      public: std::atomic<uint64_t> receivedMsgs{0};
+
+      /// \brief Remote subscribers connected to the publisher socket.
+      public: std::atomic<uint64_t> subscriberConnections{0};
+
+      /// \brief Remote publishers that the subscriber socket is connected
+      /// to.
+      public: std::atomic<uint64_t> publisherConnections{0};
+
+      /// \brief Responders that the requester is connected to. Protected
+      /// by NodeShared::srvMutex.
+      public: ConnectionCache requesterConnections;
+
+      /// \brief Requesters that the replier is connected to. Protected by
+      /// NodeShared::srvMutex.
+      public: ConnectionCache replierConnections;
+
+      /// \brief Requesters that the replySender is connected to. Protected
+      /// by NodeShared::srvMutex.
+      public: ConnectionCache replySenderConnections;
+
+      /// \brief Responses of the services advertised as cacheable, see
+      /// AdvertiseServiceOptions::SetReplyCacheTtl().
+      public: ReplyCache replyCache;
+
+      /// \brief Next time that idle connections are evicted. Only used by
+      /// the reception thread.
+      public: ConnectionCache::Clock::time_point nextEviction;
+
+      /// \brief True if idle connections are evicted.
+      public: bool evictionEnabled = false;
+
       /// \brief Thread the handle access control
       public: std::thread accessControlThread;
 
+      /// \brief ZMQ socket polled by the accessControlThread, so it sees at
+      /// once that it has to exit. Created with the thread.
+      public: std::unique_ptr<zmq::socket_t> accessWakeupReceiver;
+
+      /// \brief ZMQ socket connected to the accessWakeupReceiver.
+      public: std::unique_ptr<zmq::socket_t> accessWakeupSender;
+
       //////////////////////////////////////////////////
       /////// Declare here the discovery object  ///////
       //////////////////////////////////////////////////
@@ -126,9 +361,23 @@ namespace ignition
       /// \brief Discovery service (messages).
       public: std::unique_ptr<MsgDiscovery> msgDiscovery;
 
-      /// \brief Discovery service (services).
+      /// \brief Discovery service (services). Only created with the sockets
+      /// of the services, see servicesInitialized.
       public: std::unique_ptr<SrvDiscovery> srvDiscovery;
 
+      /// \brief Whether NodeShared::InitializeServices() has created the
+      /// sockets and the discovery of the services. They are used without
+      /// more synchronization once it is set.
+      public: std::atomic<bool> servicesInitialized{false};
+
+      /// \brief Serializes NodeShared::InitializeServices().
+      public: std::mutex servicesMutex;
+
+      /// \brief Partitions of the nodes of the process, passed to the
+      /// discovery of the services when it's created. Protected by
+      /// servicesMutex. \sa NodeShared::AddPartition.
+      public: std::set<std::string> partitions;
+
       //////////////////////////////////////////////////
       /////// Other private member variables     ///////
       //////////////////////////////////////////////////
@@ -136,14 +385,149 @@ namespace ignition
       /// \brief When true, the reception thread will finish.
       public: std::atomic<bool> exit = false;
 
-      /// \brief Timeout used for receiving messages (ms.).
-      public: inline static const int Timeout = 250;
+      /// \brief Wake up the reception thread, e.g.: to let it see that it
+      /// has to exit.
+      public: void WakeUpReception();
+
+      /// \brief Time that the reception thread can wait for incoming data.
+      /// \return The time until the next eviction of idle connections, or
+      /// -1 (no timeout) if eviction is disabled.
+      public: std::chrono::milliseconds ReceptionTimeout() const;
 
       ////////////////////////////////////////////////////////////////
       /////// The following is for asynchronous publication of ///////
       /////// messages to local subscribers.                    ///////
       ////////////////////////////////////////////////////////////////
 
+      public: struct PublishMsgDetails;
+
+      /// \brief State of the local queue of a publisher that limits the
+      /// number of messages pending local delivery. See
+      /// AdvertiseMessageOptions::SetLocalQueueDepth().
+      public: struct LocalQueueState
+              {
+                /// \brief Constructor.
+                /// \param[in] _depth Maximum number of pending messages.
+                /// \param[in] _policy Policy applied when the queue is full.
+                public: LocalQueueState(uint64_t _depth,
+                                        QueueOverflowPolicy_t _policy)
+                  : depth(_depth),
+                    policy(_policy)
+                {
+                }
+
+                /// \brief Reserve room in the queue for a new message.
+                /// \param[in] _exit Flag set when the process is shutting
+                /// down. A blocked publisher gives up when it's set.
+                /// \param[in] _manualSpin Whether the application drains the
+                /// queue by spinning. The publisher could be the thread that
+                /// spins, so it never blocks and the message is dropped
+                /// instead when the queue is full.
+                /// \return True if the message has to be queued or false if
+                /// it has to be dropped.
+                public: bool Reserve(const std::atomic<bool> &_exit,
+                                     const bool _manualSpin)
+                {
+                  if (this->policy == QueueOverflowPolicy_t::BLOCK &&
+                      !inLocalCallback && !_manualSpin)
+                  {
+                    std::unique_lock<std::mutex> lk(this->mutex);
+                    while (this->pending.load() >= this->depth)
+                    {
+                      if (_exit)
+                      {
+                        ++this->dropped;
+                        return false;
+                      }
+                      this->drained.wait_for(lk,
+                        std::chrono::milliseconds(100));
+                    }
+                    ++this->pending;
+                    return true;
+                  }
+
+                  if (this->policy == QueueOverflowPolicy_t::DROP_NEWEST ||
+                      (this->policy == QueueOverflowPolicy_t::BLOCK &&
+                       _manualSpin))
+                  {
+                    uint64_t current = this->pending.load();
+                    do
+                    {
+                      if (current >= this->depth)
+                      {
+                        ++this->dropped;
+                        return false;
+                      }
+                    } while (!this->pending.compare_exchange_weak(
+                               current, current + 1));
+                    return true;
+                  }
+
+                  ++this->pending;
+                  return true;
+                }
+
+                /// \brief Register a message pushed onto the publish queue.
+                /// With the DROP_OLDEST policy, the payload of the oldest
+                /// messages beyond the depth of the queue is freed right away
+                /// and they are discarded when they reach the head of the
+                /// queue.
+                /// \param[in] _details The message queued.
+                public: void Track(PublishMsgDetails *_details);
+
+                /// \brief Take a message out of the queue for its delivery.
+                /// \param[in] _details The message to deliver.
+                /// \return True if the message has to be delivered or false
+                /// if it has been superseded by newer ones.
+                public: bool Claim(PublishMsgDetails *_details);
+
+                /// \brief Unregister a message destroyed before its
+                /// delivery.
+                /// \param[in] _details The message destroyed.
+                public: void Forget(PublishMsgDetails *_details);
+
+                /// \brief Release the room of a message that has been
+                /// delivered or dropped.
+                public: void Release()
+                {
+                  if (this->policy != QueueOverflowPolicy_t::BLOCK)
+                  {
+                    --this->pending;
+                    return;
+                  }
+
+                  {
+                    std::lock_guard<std::mutex> lk(this->mutex);
+                    --this->pending;
+                  }
+                  this->drained.notify_one();
+                }
+
+                /// \brief Maximum number of pending messages.
+                public: const uint64_t depth;
+
+                /// \brief Policy applied when the queue is full.
+                public: const QueueOverflowPolicy_t policy;
+
+                /// \brief Number of messages reserved and not released yet.
+                public: std::atomic<uint64_t> pending{0};
+
+                /// \brief Messages queued and not delivered yet, from the
+                /// oldest to the newest. Only used by the DROP_OLDEST policy
+                /// and protected by the mutex.
+                public: std::deque<PublishMsgDetails *> live;
+
+                /// \brief Number of messages dropped.
+                public: std::atomic<uint64_t> dropped{0};
+
+                /// \brief Used by blocked publishers to wait for room, and
+                /// to protect the messages tracked.
+                public: std::mutex mutex;
+
+                /// \brief Signaled when a message is released.
+                public: std::condition_variable drained;
+              };
+
       /// \brief Encapsulates information needed to publish a message. An
       /// instance of this class is pushed onto a publish queue, pubQueue, when
       /// a message is published through Node::Publisher::Publish.
@@ -155,17 +539,44 @@ namespace ignition
       /// local subscriber callbacks.
       public: struct PublishMsgDetails
               {
+                /// \brief Destructor. Releases the room of the message in the
+                /// local queue of its publisher, if any.
+                public: ~PublishMsgDetails()
+                {
+                  if (this->queueState)
+                  {
+                    this->queueState->Forget(this);
+                    this->queueState->Release();
+                  }
+                }
+
+                /// \brief Local queue of the publisher or nullptr if the
+                /// queue is unbounded.
+                public: std::shared_ptr<LocalQueueState> queueState;
+
+                /// \brief True while the message is tracked by its local
+                /// queue, see LocalQueueState::Track().
+                // cppcheck-suppress unusedStructMember
+                public: bool tracked = false;
+
+                /// \brief True if the message was superseded by newer ones
+                /// and its payload freed.
+                // cppcheck-suppress unusedStructMember
+                public: bool evicted = false;
+
                 /// \brief All the local subscription handlers.
                 public: std::vector<ISubscriptionHandlerPtr> localHandlers;
 
                 /// \brief All the raw handlers.
                 public: std::vector<RawSubscriptionHandlerPtr> rawHandlers;
 
-                /// \brief Buffer for the raw handlers.
-                public: std::unique_ptr<char[]> sharedBuffer = nullptr;
+                /// \brief Buffer for the raw handlers. The buffer might be
+                /// shared with a pending remote publication of the message.
+                public: std::shared_ptr<char[]> sharedBuffer = nullptr;
 
-                /// \brief Msg copy for the local handlers.
-                public: std::unique_ptr<ProtoMsg> msgCopy = nullptr;
+                /// \brief Msg copy for the local handlers, shared with the
+                /// callbacks that keep it, see SharedMsgCallback.
+                public: std::shared_ptr<ProtoMsg> msgCopy = nullptr;
 
                 /// \brief Message size.
                 // cppcheck-suppress unusedStructMember
@@ -173,38 +584,1828 @@ namespace ignition
 
                 /// \brief Information about the topic and type.
                 public: MessageInfo info;
+
+                /// \brief Publication time, only set if the callbacks are
+                /// traced.
+                public: std::chrono::steady_clock::time_point published;
+
+                /// \brief Id of the message in the tracepoints, 0 if the
+                /// tracepoints are not available.
+                // cppcheck-suppress unusedStructMember
+                public: uint64_t traceId = 0;
+              };
+
+      /// \brief State of a topic in the reception thread.
+      public: struct RecvTopic
+              {
+                /// \brief Message information of the topic.
+                public: MessageInfo info;
+
+                /// \brief Last sequence number received from each remote
+                /// publisher, indexed by the address of its process and by
+                /// publisher id.
+                public: std::map<std::string, std::map<uint64_t, uint64_t>>
+                          lastSeq;
+
+                /// \brief Subscribers when lastSeq was last updated. The
+                /// messages sent while there were no subscribers aren't
+                /// received, so lastSeq is cleared when they change.
+                public: std::weak_ptr<const NodeShared::SubscriberInfo>
+                          subscribers;
               };
 
+      /// \brief State of the topics received by the reception thread,
+      /// indexed by fully qualified topic name. Decomposing the topic
+      /// name into topic and partition is only done the first time that a
+      /// topic is received. Only accessed from the reception thread.
+      public: std::unordered_map<std::string, RecvTopic> recvInfoCache;
+
+      /// \brief Same as recvInfoCache, for the topics received by the
+      /// control reception thread. Only accessed from that thread.
+      public: std::unordered_map<std::string, RecvTopic>
+                controlRecvInfoCache;
+
+      /// \brief Incremented when the last local subscriber of a topic may
+      /// be gone, so the reception threads forget the topics without
+      /// subscribers from their caches.
+      public: std::atomic<uint64_t> recvInfoGeneration{0};
+
+      /// \brief Value of recvInfoGeneration when recvInfoCache was last
+      /// swept. Only accessed from the reception thread.
+      public: uint64_t recvInfoSwept = 0;
+
+      /// \brief Same as recvInfoSwept, for controlRecvInfoCache.
+      public: uint64_t controlRecvInfoSwept = 0;
+
+      /// \brief Receive the frames of a message from a subscriber socket
+      /// and decode them. Must be called with subscriberMutex locked.
+      /// \param[in] _socket The subscriber socket.
+      /// \param[in] _pUuid UUID of this process.
+      /// \param[out] _received The message.
+      /// \return False if no valid message was received.
+      public: bool RecvMessage(zmq::socket_t &_socket,
+                               const std::string &_pUuid,
+                               ReceivedMessage &_received);
+
+      /// \brief Cached subscriber snapshot of a topic. The local handlers
+      /// don't depend on the message type, so there is one snapshot with
+      /// and one without remote subscribers, picked by the type of the
+      /// message.
+      public: struct TopicSnapshot
+              {
+                /// \brief Get the snapshot for a message type.
+                /// \param[in] _msgType The message type.
+                /// \return The snapshot.
+                public: const std::shared_ptr<const NodeShared::SubscriberInfo>
+                  &Get(const std::string &_msgType) const
+                {
+                  if (this->withRemote &&
+                      (this->anyRemoteType ||
+                       this->remoteTypes.count(_msgType) > 0))
+                  {
+                    return this->withRemote;
+                  }
+                  return this->withoutRemote;
+                }
+
+                /// \brief Snapshot for the types without remote subscribers.
+                public: std::shared_ptr<const NodeShared::SubscriberInfo>
+                  withoutRemote;
+
+                /// \brief Snapshot for the types of the remote subscribers,
+                /// or nullptr if there are none.
+                public: std::shared_ptr<const NodeShared::SubscriberInfo>
+                  withRemote;
+
+                /// \brief Message types of the remote subscribers.
+                public: std::set<std::string> remoteTypes;
+
+                /// \brief True if a remote subscriber accepts any type.
+                public: bool anyRemoteType = false;
+              };
+
+      /// \brief Cached subscriber snapshots, by topic name.
+      public: using SubscriberSnapshots =
+        std::unordered_map<std::string, TopicSnapshot>;
+
+      /// \brief Current table of subscriber snapshots. The table itself is
+      /// never modified once published: writers copy it, update the copy and
+      /// swap it in with std::atomic_store() while holding NodeShared::mutex.
+      /// Readers only need std::atomic_load().
+      public: std::shared_ptr<const SubscriberSnapshots> subscriberSnapshots =
+        std::make_shared<const SubscriberSnapshots>();
+
       /// \brief Publish thread used to process the pubQueue.
       public: std::thread pubThread;
 
-      /// \brief Mutex to protect the pubThread and pubQueue.
-      public: std::mutex pubThreadMutex;
-
       /// \brief Queue onto which new messages are pushed. The pubThread
       /// will pop off the messages and send them to local subscribers.
-      public: std::queue<std::unique_ptr<PublishMsgDetails>> pubQueue;
-
-      /// \brief used to signal when new work is available
-      public: std::condition_variable signalNewPub;
+      /// Publishers don't take any lock to push a message.
+      public: MpscQueue<std::unique_ptr<PublishMsgDetails>> pubQueue;
 
       /// \brief Handles local publication of messages on the pubQueue.
       public: void PublishThread();
 
-      /// \brief Topic publication sequence numbers.
+      /// \brief Dispatch the oldest message of the pubQueue to its local
+      /// handlers. Must only be called by the consumer of the queue.
+      /// \return True if a message was dispatched or discarded, or false if
+      /// the queue was empty.
+      public: bool DispatchLocalMsg();
+
+      /// \brief True if the application runs the reception and the local
+      /// dispatch with spinOnce() instead of the reception and publish
+      /// threads. \sa ThreadConfig::ManualSpin.
+      public: bool manualSpin = false;
+
+      /// \brief Maximum number of local messages dispatched by a call to
+      /// NodeShared::SpinOnce(), so callbacks that publish locally can't
+      /// keep it running forever.
+      public: static constexpr int kMaxLocalMsgsPerSpin = 1000;
+
+      /// \brief Default interval of the heartbeats of the connections of the
+      /// topics and services (milliseconds). \sa EnableHeartbeats.
+      public: static constexpr int kDefaultConnectionHeartbeat = 100;
+
+      /// \brief Make a socket exchange heartbeats with its peers, so the
+      /// connection to a dead or unreachable peer is closed after a few
+      /// missed heartbeats, instead of when the operating system notices.
+      /// The interval is set with IGN_TRANSPORT_CONNECTION_HEARTBEAT, and 0
+      /// disables them. It requires ZeroMQ 4.2. Must be called before the
+      /// socket connects or binds.
+      /// \param[in] _socket The socket.
+      public: void EnableHeartbeats(zmq::socket_t &_socket) const;
+
+      /// \brief True on the threads while they run a local or raw callback.
+      public: inline static thread_local bool inLocalCallback = false;
+
+      /// \brief True if the execution times of the callbacks are recorded,
+      /// set with IGN_TRANSPORT_CALLBACK_TRACING. It is set once, before any
+      /// callback runs.
+      /// \sa CallbackTrace
+      public: inline static bool callbackTracing = false;
+
+      /// \brief Get the current time if the callbacks are traced.
+      /// \return The current time, or a default time point if the callbacks
+      /// are not traced.
+      public: static std::chrono::steady_clock::time_point TraceNow()
+      {
+        return callbackTracing ? std::chrono::steady_clock::now() :
+          std::chrono::steady_clock::time_point();
+      }
+
+      /// \brief Serialize the message of a local publication into a pooled
+      /// buffer, for the handlers that need the serialized data.
+      /// \param[in, out] _details The publication.
+      /// \param[in] _msg The message of the publication.
+      public: void SerializeDetails(PublishMsgDetails &_details,
+                                    const ProtoMsg &_msg);
+
+      /// \brief Run the callback of a local handler, logging exceptions. The
+      /// message filter of the handler is evaluated first.
+      /// \param[in] _handler The handler.
+      /// \param[in] _details The message to deliver.
+      public: static void RunLocalHandler(ISubscriptionHandler &_handler,
+                  const PublishMsgDetails &_details);
+
+      /// \brief Run the callback of a local handler with a message that
+      /// isn't the copy of the publication, e.g. the message of the
+      /// publisher for the inline handlers.
+      /// \param[in] _handler The handler.
+      /// \param[in] _details The publication.
+      /// \param[in] _msg The message to deliver.
+      public: static void RunLocalHandler(ISubscriptionHandler &_handler,
+                  const PublishMsgDetails &_details, const ProtoMsg &_msg);
+
+      /// \brief Run the callback of a raw handler, logging exceptions. The
+      /// message filter of the handler is evaluated first.
+      /// \param[in] _handler The handler.
+      /// \param[in] _details The message to deliver.
+      public: static void RunRawHandler(RawSubscriptionHandler &_handler,
+                  const PublishMsgDetails &_details);
+
+      /// \brief Executor running the callbacks of the local subscribers, set
+      /// with IGN_TRANSPORT_LOCAL_DELIVERY_THREADS. Callbacks of the same
+      /// handler run in order, one at a time. When null, the callbacks run in
+      /// the pubThread.
+      public: std::unique_ptr<Executor> localExecutor;
+
+      /// \brief Get the executor running the callbacks of the subscriptions
+      /// with a keep last queue (see SubscribeOptions::SetQueueSize()). The
+      /// executor is created the first time that it's needed.
+      /// \return The executor.
+      public: Executor &QueueExecutor();
+
+      /// \brief Executor returned by QueueExecutor().
+      public: std::unique_ptr<Executor> queueExecutor;
+
+      /// \brief Used to create the queueExecutor only once.
+      public: std::once_flag queueExecutorOnce;
+
+      /// \brief Get the executor that serializes and sends the messages of
+      /// Node::Publisher::PublishAsync(), with a key per publisher. The
+      /// executor is created the first time that it's needed.
+      /// \return The executor.
+      public: Executor &PublishExecutor();
+
+      /// \brief Executor returned by PublishExecutor().
+      public: std::unique_ptr<Executor> publishExecutor;
+
+      /// \brief Used to create the publishExecutor only once.
+      public: std::once_flag publishExecutorOnce;
+
+      /// \brief A service call received from another process.
+      public: struct ServiceCall
+      {
+        /// \brief Service name.
+        public: std::string topic;
+
+        /// \brief Address of the requester, where the response is sent.
+        public: std::string sender;
+
+        /// \brief Routing id of the requester.
+        public: std::string dstId;
+
+        /// \brief UUID of the node that made the request.
+        public: std::string nodeUuid;
+
+        /// \brief Request id, echoed back with the response.
+        public: std::string reqUuid;
+
+        /// \brief The serialized request.
+        public: std::string req;
+
+        /// \brief Response type name.
+        public: std::string repType;
+
+        /// \brief Time after which the requester doesn't wait for the
+        /// response anymore. The call is dropped if it didn't start by then.
+        public: std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::time_point::max();
+
+        /// \brief Reception time, only set if the callbacks are traced.
+        public: std::chrono::steady_clock::time_point received;
+      };
+
+      /// \brief Run the callback of a service call and send the response
+      /// when it's available.
+      /// \param[in] _handler The replier handler.
+      /// \param[in] _call The service call.
+      /// \param[in] _socket Socket used to send the response.
+      /// \param[in, out] _connections Addresses that _socket is connected to.
+      /// \param[in] _mutex Mutex protecting _socket and _connections. It
+      /// isn't locked while the callback runs.
+      /// \param[in] _verbose True to print debug information.
+      /// \param[in] _cache Cache of the responses of the handler, if it has
+      /// a time to live, see IRepHandler::ReplyCacheTtl().
+      public: static void RunServiceCall(IRepHandler &_handler,
+        const std::shared_ptr<const ServiceCall> &_call,
+        zmq::socket_t &_socket, ConnectionCache &_connections,
+        std::recursive_mutex &_mutex, const bool _verbose,
+        ReplyCache *_cache = nullptr);
+
+      /// \brief Send the response of a service call.
+      /// \param[in] _call The service call.
+      /// \param[in] _rep The serialized response.
+      /// \param[in] _status "1" if the service call succeeded, "0" if it
+      /// failed, or one of kPartialReply and kStreamEndReply.
+      /// \param[in] _socket Socket used to send the response.
+      /// \param[in, out] _connections Addresses that _socket is connected to.
+      /// \param[in] _mutex Mutex protecting _socket and _connections.
+      /// \param[in] _verbose True to print debug information.
+      /// \return True if the response was sent.
+      public: static bool SendServiceResponse(const ServiceCall &_call,
+        const std::string &_rep, const std::string &_status,
+        zmq::socket_t &_socket, ConnectionCache &_connections,
+        std::recursive_mutex &_mutex, const bool _verbose);
+
+      /// \brief Flow control state of a stream of responses being sent.
+      public: struct StreamState
+      {
+        /// \brief Protects the members below.
+        public: std::mutex mutex;
+
+        /// \brief Notified when credits arrive or the stream is closed.
+        public: std::condition_variable condition;
+
+        /// \brief Number of responses that can be sent before the requester
+        /// grants more.
+        public: uint64_t credits = 0;
+
+        /// \brief True once the stream has been closed.
+        public: bool closed = false;
+      };
+
+      /// \brief Get the key of a stream of responses in streams.
+      /// \param[in] _dstId Routing id of the requester.
+      /// \param[in] _reqUuid Request id, as received by the responder.
+      /// \return The key.
+      public: static std::string StreamKey(const std::string &_dstId,
+                                           const std::string &_reqUuid);
+
+      /// \brief Run a service call that accepts a stream of responses in
+      /// the reply executor. Responses are only sent while the requester has
+      /// granted credits, so a slow requester slows down the responder.
+      /// \param[in] _handler The replier handler.
+      /// \param[in] _call The service call.
+      /// \param[in] _window Responses that can be sent before the requester
+      /// grants more credits.
+      /// \param[in] _mutex NodeShared::srvMutex.
+      /// \param[in] _verbose True to print debug information.
+      public: void StartStream(const IRepHandlerPtr &_handler,
+        const std::shared_ptr<const ServiceCall> &_call,
+        const uint32_t _window, std::recursive_mutex &_mutex,
+        const bool _verbose);
+
+      /// \brief Add the credits granted by a requester to one of the streams
+      /// being sent. Must be called with NodeShared::srvMutex locked.
+      /// \param[in] _msg The message with the credits. Its request contains
+      /// the number of credits.
+      public: void AddStreamCredits(const ServiceCall &_msg);
+
+      /// \brief Run a streaming service call whose responder lives in this
+      /// process, in the reply executor. The responses are handed over to
+      /// the request handler as soon as they are written.
+      /// \param[in] _repHandler The replier handler.
+      /// \param[in] _reqHandler The request handler.
+      public: void RunLocalStream(const IRepHandlerPtr &_repHandler,
+                                  const IReqHandlerPtr &_reqHandler);
+
+      /// \brief Status of a response that is part of a stream, with more
+      /// responses to follow.
+      public: inline static const std::string kPartialReply = "2";
+
+      /// \brief Status of the successful end of a stream of responses.
+      public: inline static const std::string kStreamEndReply = "3";
+
+      /// \brief Request type of the messages granting credits to the
+      /// responder of a stream. Older responders don't have a replier with
+      /// this type, so they ignore the messages.
+      public: inline static const std::string kStreamCreditsType =
+        "ignition.transport.StreamCredits";
+
+      /// \brief Maximum time that a stream waits for credits before giving
+      /// up, e.g.: because the requester went away.
+      public: inline static const std::chrono::seconds kStreamStallTimeout{10};
+
+      /// \brief Send the routing id frame of a message through a ROUTER
+      /// socket. Sending to a peer whose connection isn't established yet
+      /// fails, so new connections are given some time to complete the
+      /// handshake, instead of always sleeping after connecting.
+      /// \param[in] _socket The ROUTER socket.
+      /// \param[in] _id Routing id of the peer.
+      /// \param[in] _newConnection True if the socket just connected to the
+      /// peer.
+      /// \throws zmq::error_t if the frame can't be sent.
+      public: static void SendRoutingId(zmq::socket_t &_socket,
+        const std::string &_id, const bool _newConnection);
+
+      /// \brief Disconnect the sockets from the endpoints that haven't been
+      /// used for a while. Checked at most once per second. Must be called
+      /// from the reception thread, which owns the replier.
+      /// \param[in] _mutex NodeShared::srvMutex.
+      /// \param[in] _verbose True to print debug information.
+      public: void EvictIdleConnections(std::recursive_mutex &_mutex,
+                                        const bool _verbose);
+
+      /// \brief Get the executor running the service calls from other
+      /// processes of the repliers with a concurrency limit (see
+      /// AdvertiseServiceOptions::SetMaxConcurrentCalls()). The executor is
+      /// created the first time that it's needed.
+      /// \return The executor.
+      public: Executor &ReplyExecutor();
+
+      /// \brief Executor returned by ReplyExecutor().
+      public: std::unique_ptr<Executor> replyExecutor;
+
+      /// \brief Used to create the replyExecutor only once.
+      public: std::once_flag replyExecutorOnce;
+
+      /// \brief Executor running the callbacks of the messages received from
+      /// other processes, set with IGN_TRANSPORT_RECEPTION_THREADS. Callbacks
+      /// of the same topic run in order, one at a time. When null, the
+      /// callbacks run in the reception thread.
+      public: std::unique_ptr<Executor> receptionExecutor;
+
+      /// \brief Pool of buffers used to serialize published messages. The
+      /// number of cached buffers per size class is set with the
+      /// IGN_TRANSPORT_BUFFER_POOL_SIZE environment variable.
+      public: std::unique_ptr<BufferPool> bufferPool =
+        std::make_unique<BufferPool>();
+
+      /// \brief Metrics of the transport internals.
+      /// \sa NodeShared::MetricsText
+      public: MetricsRegistry metrics;
+
+      /// \brief Traffic counters of a topic.
+      public: class TopicTraffic
+      {
+        /// \brief Number of messages.
+        public: MetricsRegistry::Counter *messages = nullptr;
+
+        /// \brief Number of payload bytes.
+        public: MetricsRegistry::Counter *bytes = nullptr;
+      };
+
+      /// \brief Account for a message of a topic, registering the counters
+      /// of the topic the first time.
+      /// \param[in, out] _cache Counters already registered, by topic.
+      /// \param[in] _prefix Prefix of the metric names, e.g.
+      /// "ign_transport_sent".
+      /// \param[in] _topic The topic.
+      /// \param[in] _size Size of the payload (bytes).
+      public: void CountTraffic(
+                  std::unordered_map<std::string, TopicTraffic> &_cache,
+                  const char *_prefix, const std::string &_topic,
+                  const std::size_t _size);
+
+      /// \brief Traffic counters of the messages sent, by topic. Protected by
+      /// NodeShared::mutex.
+      public: std::unordered_map<std::string, TopicTraffic> sentTraffic;
+
+      /// \brief Traffic counters of the messages received, by topic.
+      /// Protected by subscriberMutex.
+      public: std::unordered_map<std::string, TopicTraffic> recvTraffic;
+
+      /// \brief Number of local publications queued.
+      public: MetricsRegistry::Counter *localQueued = nullptr;
+
+      /// \brief Number of local publications taken from the queue.
+      public: MetricsRegistry::Counter *localDequeued = nullptr;
+
+      /// \brief Number of local publications superseded in a full keep last
+      /// queue.
+      public: MetricsRegistry::Counter *localDropped = nullptr;
+
+      /// \brief Register the metrics of the transport internals.
+      /// \param[in] _shared The owner of this object.
+      public: void InitMetrics(NodeShared &_shared);
+
+      /// \brief Publish the metrics periodically, as ignition.msgs.Metric
+      /// messages. This function is designed to be run in a thread.
+      /// \param[in] _topic The topic, from IGN_TRANSPORT_METRICS_TOPIC.
+      public: void MetricsExporter(const std::string &_topic);
+
+      /// \brief Thread publishing the metrics, if IGN_TRANSPORT_METRICS_TOPIC
+      /// is set.
+      public: std::thread metricsThread;
+
+      /// \brief Mutex used to wake up the metricsThread on exit.
+      public: std::mutex metricsMutex;
+
+      /// \brief Condition used to wake up the metricsThread on exit.
+      public: std::condition_variable metricsCondition;
+
+      /// \brief Publication sequence numbers of the callers of
+      /// NodeShared::Publish() without a publisher id, indexed by topic.
       public: std::map<std::string, uint64_t> topicPubSeq;
 
       /// \brief True if topic statistics have been enabled.
       public: bool topicStatsEnabled = false;
 
+      /// \brief True if the compact wire header is used for data messages.
+      /// When enabled, the sender address, message type and publication
+      /// metadata are packed in a single frame sent after the topic, instead
+      /// of one frame each. It's only used on the topics whose remote
+      /// subscribers all read it, see CompactHeader(). The messages of both
+      /// framings are always accepted.
+      public: bool compactHeaderEnabled = false;
+
+      /// \brief String representation of NodeShared::responseReceiverId,
+      /// sent with every service request.
+      public: std::string responseReceiverId;
+
+      /// \brief IPC endpoint of the response receiver, sent with the service
+      /// requests to the responders of the same host instead of
+      /// NodeShared::myRequesterAddress. Empty if IGN_TRANSPORT_IPC isn't
+      /// enabled.
+      public: std::string responseReceiverIpc;
+
+      /// \brief Name of the IPC endpoint of the replier socket.
+      /// \sa IpcEndpoint().
+      public: inline static const std::string kReplierLane = "replier";
+
+      /// \brief Name of the IPC endpoint of the response receiver socket.
+      /// \sa IpcEndpoint().
+      public: inline static const std::string kResponseLane = "response";
+
+      /// \brief Get the IPC endpoint that a process binds a publisher
+      /// socket to when IGN_TRANSPORT_IPC is enabled.
+      /// \param[in] _pUuid Process UUID of the publisher.
+      /// \param[in] _lane Name of the traffic class of the socket, empty for
+      /// the default one. \sa LaneName().
+      /// \return The endpoint.
+      public: static std::string IpcEndpoint(const std::string &_pUuid,
+                                             const std::string &_lane = "");
+
+      /// \brief Bind a socket to an IPC endpoint. Its socket file is
+      /// unlinked when the process exits, see UnlinkIpcEndpoints().
+      /// \param[in] _socket The socket.
+      /// \param[in] _endpoint The endpoint, see IpcEndpoint().
+      /// \return False if the path of the endpoint is too long for a Unix
+      /// domain socket, e.g.: because of IGN_TRANSPORT_IPC_DIR. The socket
+      /// isn't bound then.
+      public: bool BindIpc(zmq::socket_t &_socket,
+                           const std::string &_endpoint);
+
+      /// \brief Unlink the socket files of the endpoints bound with
+      /// BindIpc(), so they aren't left behind once the process is gone.
+      /// Called when the process exits. The connections established are
+      /// kept, but no other process can connect anymore.
+      public: void UnlinkIpcEndpoints();
+
+      /// \brief Paths of the socket files bound with BindIpc(). Protected
+      /// by ipcMutex.
+      public: std::vector<std::string> ipcPaths;
+
+      /// \brief Protects ipcPaths.
+      public: std::mutex ipcMutex;
+
+      /// \brief Get the IPC endpoint of a publisher if it is reachable from
+      /// this host. This is the case when the publisher runs on the same host
+      /// and is listening on its IPC endpoint. The socket files left behind
+      /// by the processes that didn't exit normally are ignored.
+      /// \param[in] _pUuid Process UUID of the publisher.
+      /// \param[out] _endpoint The IPC endpoint.
+      /// \param[in] _lane Name of the traffic class of the socket, empty for
+      /// the default one. \sa LaneName().
+      /// \return True if the IPC endpoint can be used.
+      public: static bool LocalIpcEndpoint(const std::string &_pUuid,
+                                           std::string &_endpoint,
+                                           const std::string &_lane = "");
+
+      /// \brief Get the endpoint that the requester connects to for calling
+      /// the services of a responder: its IPC endpoint if it runs on the same
+      /// host and exposes one, its TCP address otherwise.
+      /// \param[in] _pub The responder.
+      /// \return The endpoint.
+      public: static std::string ResponderEndpoint(
+                  const ServicePublisher &_pub);
+
+      /// \brief State of a topic advertised by this process with a multicast
+      /// group or with best effort delivery, see
+      /// AdvertiseMessageOptions::SetMulticastGroup() and
+      /// AdvertiseMessageOptions::SetBestEffort().
+      public: struct DataTopic
+              {
+                /// \brief Multicast group of the topic, empty if none.
+                public: std::string group;
+
+                /// \brief Socket sending to the group, owned by
+                /// multicastPublishers, or nullptr if the topic has no group.
+                public: zmq::socket_t *socket = nullptr;
+
+                /// \brief Publishers of this process advertising the topic
+                /// with the group.
+                public: int multicastPublishers = 0;
+
+                /// \brief Publishers of this process advertising the topic
+                /// with best effort delivery.
+                public: int bestEffortPublishers = 0;
+
+                /// \brief Remote subscribers of the topic that receive it
+                /// over TCP, as pairs of process and node UUIDs. The
+                /// messages are only sent over TCP while there is one.
+                public: std::set<std::pair<std::string, std::string>>
+                          tcpSubscribers;
+
+                /// \brief Remote subscribers of the topic that receive it
+                /// as datagrams, with their UDP endpoint. The nodes of a
+                /// process share the endpoint.
+                public: std::map<std::pair<std::string, std::string>,
+                          sockaddr_in> udpSubscribers;
+              };
+
+      /// \brief Topics advertised by this process with a multicast group or
+      /// with best effort delivery, indexed by fully qualified topic name.
+      /// Protected by NodeShared::mutex.
+      public: std::unordered_map<std::string, DataTopic> dataTopics;
+
+      /// \brief Sockets sending to the multicast groups, indexed by group.
+      /// Protected by NodeShared::mutex.
+      public: std::map<std::string, std::unique_ptr<zmq::socket_t>>
+                multicastPublishers;
+
+      /// \brief Multicast groups that the subscriber socket joined (true) or
+      /// failed to join (false). Protected by subscriberMutex.
+      public: std::map<std::string, bool> multicastSubscriptions;
+
+      /// \brief Addresses of the publishers that the subscriber socket is
+      /// connected to over TCP or IPC. The publishers only reached through
+      /// their multicast group are not. Protected by subscriberMutex.
+      public: std::set<std::string> dataConnections;
+
+      /// \brief Address of the publisher of each endpoint that the
+      /// subscriber socket is connected to, to tell the discovery about the
+      /// connections lost. Protected by subscriberMutex.
+      /// \sa NodeShared::OnDataDisconnection.
+      public: std::map<std::string, std::string> dataEndpoints;
+
+      /// \brief Get the endpoint of a multicast group.
+      /// \param[in] _hostAddr Address of the interface used.
+      /// \param[in] _group Multicast group and port.
+      /// \return The endpoint.
+      public: static std::string MulticastEndpoint(const std::string &_hostAddr,
+                                                   const std::string &_group);
+
+      /// \brief Set the options of a socket sending to or receiving from a
+      /// multicast group, before it binds or connects to the group.
+      /// \param[in] _socket The socket.
+      public: void SetMulticastOptions(zmq::socket_t &_socket) const;
+
+      /// \brief Send the messages of a topic to its multicast group. Must be
+      /// called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in,out] _group The group requested. It is replaced by the
+      /// group in use if the topic was already advertised with another one.
+      /// \param[in] _hostAddr Address of the interface used.
+      /// \param[in] _remoteSubscribers The remote subscribers registered.
+      /// \return False if the messages can't be sent to the group.
+      public: bool AddMulticastTopic(const std::string &_topic,
+                  std::string &_group, const std::string &_hostAddr,
+                  const TopicStorage<MessagePublisher> &_remoteSubscribers);
+
+      /// \brief Release a topic added with AddMulticastTopic(), when one of
+      /// its publishers is gone. The socket of the group is closed, leaving
+      /// the group, once no topic is sent to it. Must be called with
+      /// NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void RemoveMulticastTopic(const std::string &_topic);
+
+      /// \brief Offer best effort delivery of a topic to its remote
+      /// subscribers. Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _remoteSubscribers The remote subscribers registered.
+      /// \return False if the datagrams can't be sent.
+      public: bool AddBestEffortTopic(const std::string &_topic,
+                  const TopicStorage<MessagePublisher> &_remoteSubscribers);
+
+      /// \brief Release a topic added with AddBestEffortTopic(), when one of
+      /// its publishers is gone. Must be called with NodeShared::mutex
+      /// locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void RemoveBestEffortTopic(const std::string &_topic);
+
+      /// \brief Reclassify the registered remote subscribers of a topic,
+      /// after a change in the way that the topic is sent. Must be called
+      /// with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _remoteSubscribers The remote subscribers registered.
+      public: void UpdateDataSubscribers(const std::string &_topic,
+                  const TopicStorage<MessagePublisher> &_remoteSubscribers);
+
+      /// \brief Track how a remote subscriber of a topic in dataTopics
+      /// receives it: as datagrams, from the multicast group or over TCP.
+      /// Must be called with NodeShared::mutex locked.
+      /// \param[in] _sub The registration of the subscriber. Its multicast
+      /// group is empty if it doesn't receive the topic from the group, and
+      /// its address is its UDP endpoint if it receives it as datagrams.
+      /// \param[in] _registered False if the subscriber is gone.
+      public: void UpdateDataSubscriber(const MessagePublisher &_sub,
+                                        const bool _registered);
+
+      /// \brief Publisher socket of a traffic class other than
+      /// TrafficClass_t::DEFAULT, see
+      /// AdvertiseMessageOptions::SetTrafficClass().
+      public: struct Lane
+              {
+                /// \brief The publisher socket.
+                public: std::unique_ptr<zmq::socket_t> socket;
+
+                /// \brief TCP endpoint of the socket, advertised as the
+                /// address of the topics of the class.
+                public: std::string address;
+              };
+
+      /// \brief A topic advertised by this process with a traffic class
+      /// other than TrafficClass_t::DEFAULT.
+      public: struct LaneTopic
+              {
+                /// \brief Traffic class of the topic.
+                public: TrafficClass_t trafficClass;
+
+                /// \brief Socket of the class, owned by lanes.
+                public: zmq::socket_t *socket = nullptr;
+
+                /// \brief Publishers of this process advertising the topic.
+                public: int publishers = 0;
+              };
+
+      /// \brief Sockets of the traffic classes, created with the first
+      /// topic of their class. Protected by NodeShared::mutex.
+      public: std::map<TrafficClass_t, Lane> lanes;
+
+      /// \brief Topics sent through the socket of their traffic class,
+      /// indexed by fully qualified topic name. Protected by
+      /// NodeShared::mutex.
+      public: std::unordered_map<std::string, LaneTopic> laneTopics;
+
+      /// \brief Get the name of a traffic class, used in its environment
+      /// variables and IPC endpoint.
+      /// \param[in] _class The traffic class.
+      /// \return The name, empty for TrafficClass_t::DEFAULT.
+      public: static std::string LaneName(const TrafficClass_t _class);
+
+      /// \brief Get the name of an environment variable of a traffic class.
+      /// \param[in] _class The traffic class.
+      /// \param[in] _option Name of the option, e.g.: "SNDHWM".
+      /// \return The name, e.g.: "IGN_TRANSPORT_BULK_SNDHWM".
+      public: static std::string LaneEnvVar(const TrafficClass_t _class,
+                                            const std::string &_option);
+
+      /// \brief Send a topic advertised with a traffic class through the
+      /// socket of the class, creating the socket if needed. A topic keeps
+      /// the class of its first publisher in this process. Must be called
+      /// with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _pUuid UUID of this process.
+      /// \param[in] _hostAddr Address of the interface used.
+      /// \param[in, out] _class The traffic class requested, replaced by
+      /// the class used.
+      /// \param[in, out] _address Address of the default publisher socket,
+      /// replaced by the address of the socket used.
+      /// \return True if the topic uses the socket of its class, which has
+      /// to be released with RemoveLaneTopic().
+      public: bool AddLaneTopic(const std::string &_topic,
+                                const std::string &_pUuid,
+                                const std::string &_hostAddr,
+                                TrafficClass_t &_class,
+                                std::string &_address);
+
+      /// \brief Release a topic added with AddLaneTopic(), when one of its
+      /// publishers is gone. Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void RemoveLaneTopic(const std::string &_topic);
+
+      /// \brief Get the publisher socket of a topic. Must be called with
+      /// NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return The socket of the traffic class of the topic.
+      public: zmq::socket_t &TopicSocket(const std::string &_topic) const;
+
+      /// \brief Get the socket receiving the control topics, creating it if
+      /// needed with the filters of the subscriber socket. Must be called
+      /// with subscriberMutex locked.
+      /// \return The socket.
+      public: zmq::socket_t &ControlSubscriber();
+
+      /// \brief Set the DSCP value of the packets sent by a socket of a
+      /// traffic class, from the environment variable of the class.
+      /// \param[in] _socket The socket.
+      /// \param[in] _class The traffic class.
+      public: void SetDscp(zmq::socket_t &_socket,
+                           const TrafficClass_t _class) const;
+
+      /// \brief Let only the authenticated subscribers connect to a
+      /// publisher socket.
+      /// \param[in] _socket The publisher socket.
+      public: static void SecurePublisher(zmq::socket_t &_socket);
+
+      /// \brief Open the UDP socket of the best effort datagrams, bound to
+      /// an ephemeral port of an interface. It isn't opened when the
+      /// authentication is enabled, since the datagrams aren't
+      /// authenticated, nor on Windows.
+      /// \param[in] _hostAddr Address of the interface used.
+      public: void InitializeUdpSocket(const std::string &_hostAddr);
+
+      /// \brief Close the UDP socket of the best effort datagrams.
+      public: void CloseUdpSocket();
+
+      /// \brief Prepare the registration of the nodes of this process with
+      /// a publisher. The registration of a node that asks for best effort
+      /// delivery of a topic offered with it carries our UDP endpoint as
+      /// address. The best effort option is cleared in the other ones. The
+      /// registrations with a publisher able to limit the rate carry the
+      /// rate of this process, see subscribedRates.
+      /// \param[in,out] _registration The registration.
+      /// \param[in] _bestEffort True if the node asks for best effort.
+      public: void SetDataEndpoint(MessagePublisher &_registration,
+                                   const bool _bestEffort) const;
+
+      /// \brief Send a message as one datagram to each UDP endpoint of the
+      /// best effort subscribers of a topic. Must be called with
+      /// NodeShared::mutex locked.
+      /// \param[in] _topic State of the topic.
+      /// \param[in] _topicName Fully qualified topic name.
+      /// \param[in] _sender Address of the publisher.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _dataSize Number of bytes of the message.
+      /// \param[in] _msgType Message type.
+      /// \param[in] _meta Publication metadata.
+      /// \return False if the message doesn't fit in a datagram.
+      public: bool PublishDatagrams(const DataTopic &_topic,
+                                    const std::string &_topicName,
+                                    const std::string &_sender,
+                                    const char *_data,
+                                    const size_t _dataSize,
+                                    const std::string &_msgType,
+                                    const PublicationMetadata &_meta);
+
+      /// \brief Decode a datagram received by the UDP socket.
+      /// \param[in] _datagram The datagram.
+      /// \param[in] _size Number of bytes of the datagram.
+      /// \param[out] _topic Fully qualified topic name.
+      /// \param[out] _sender Address of the publisher.
+      /// \param[out] _msgType Message type.
+      /// \param[out] _meta Publication metadata.
+      /// \param[out] _payload The serialized message.
+      /// \return True if the datagram was correctly decoded.
+      public: static bool UnpackDatagram(const char *_datagram,
+                                         const size_t _size,
+                                         std::string &_topic,
+                                         std::string &_sender,
+                                         std::string &_msgType,
+                                         PublicationMetadata &_meta,
+                                         zmq::message_t &_payload);
+
+      /// \brief UDP socket sending and receiving the best effort datagrams,
+      /// or -1 if it isn't available.
+      public: int udpSocket = -1;
+
+      /// \brief Endpoint of udpSocket, e.g. "udp://10.0.0.2:42817", which
+      /// the registrations for best effort delivery carry as address.
+      public: std::string udpEndpoint;
+
+      /// \brief Buffer of the datagrams sent, reused from one publication to
+      /// the next. Protected by NodeShared::mutex.
+      public: std::vector<char> datagramOut;
+
+      /// \brief Buffer of the datagrams received, only used by the
+      /// reception thread.
+      public: std::vector<char> datagramIn;
+
+      /// \brief Last message of a latched publisher, see
+      /// AdvertiseMessageOptions::SetLatched().
+      public: struct LatchedMsg
+              {
+                /// \brief The serialized message.
+                public: std::shared_ptr<const char[]> buffer;
+
+                /// \brief Number of bytes of the message.
+                public: std::size_t size = 0;
+
+                /// \brief Message type.
+                public: std::string msgType;
+
+                /// \brief Sequence number of the message in its publisher.
+                /// The copies sent to the late subscribers keep it, so the
+                /// subscribers that already have the message drop them.
+                public: uint64_t seq = 0;
+              };
+
+      /// \brief Latched publishers of a topic in this process.
+      public: struct LatchedTopic
+              {
+                /// \brief Number of latched publishers of the topic.
+                public: int publishers = 0;
+
+                /// \brief Last message of each publisher that published
+                /// one, indexed by publisher id.
+                public: std::map<uint64_t, LatchedMsg> msgs;
+              };
+
+      /// \brief Topics with latched publishers in this process, indexed by
+      /// fully qualified topic name. Protected by NodeShared::mutex.
+      public: std::unordered_map<std::string, LatchedTopic> latchedTopics;
+
+      /// \brief Delays after a registration at which the latched messages
+      /// are sent again, since the first copy can reach the publisher socket
+      /// before the subscription of the new subscriber does.
+      public: static constexpr std::array<std::chrono::milliseconds, 2>
+                kLatchedResendDelays = {{std::chrono::milliseconds(100),
+                                         std::chrono::milliseconds(1000)}};
+
+      /// \brief A pending copy of the latched messages of a topic.
+      public: struct LatchedResend
+              {
+                /// \brief Fully qualified topic name.
+                public: std::string topic;
+
+                /// \brief When to send the copy.
+                public: std::chrono::steady_clock::time_point due;
+              };
+
+      /// \brief Pending copies of latched messages. Protected by
+      /// NodeShared::mutex.
+      public: std::vector<LatchedResend> latchedResends;
+
+      /// \brief Whether latchedResends has elements, checked by the
+      /// reception thread without locking.
+      public: std::atomic<bool> latchedResendsPending{false};
+
+      /// \brief Schedule the copies of the latched messages of a topic sent
+      /// after a registration. Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void ScheduleLatchedResends(const std::string &_topic);
+
+      /// \brief Join a multicast group with the subscriber socket. A group
+      /// that couldn't be joined once isn't tried again. Must be called with
+      /// subscriberMutex locked.
+      /// \param[in] _group Multicast group and port.
+      /// \param[in] _hostAddr Address of the interface used.
+      /// \return True if the subscriber socket receives from the group.
+      public: bool JoinMulticastGroup(const std::string &_group,
+                                      const std::string &_hostAddr);
+
+      /// \brief Send a message to a multicast group, with the framing of the
+      /// publisher socket. The publication metadata is always attached, so
+      /// the subscribers drop the copies also received over TCP.
+      /// \param[in] _socket Socket of the group.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _sender Address of the publisher.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _msgType Message type.
+      /// \param[in] _meta Publication metadata.
+      public: void PublishMulticast(zmq::socket_t &_socket,
+                                    const std::string &_topic,
+                                    const std::string &_sender,
+                                    zmq::message_t &_data,
+                                    const std::string &_msgType,
+                                    const PublicationMetadata &_meta);
+
+      /// \brief Send a message with the framing of the publisher socket and
+      /// the publication metadata attached.
+      /// \param[in] _socket Socket used.
+      /// \param[in] _frame First frame of the message, matched by the
+      /// filters of the subscribers.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _sender Address of the publisher.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _msgType Message type.
+      /// \param[in] _meta Publication metadata.
+      public: void SendMessage(zmq::socket_t &_socket,
+                               const std::string &_frame,
+                               const std::string &_topic,
+                               const std::string &_sender,
+                               zmq::message_t &_data,
+                               const std::string &_msgType,
+                               const PublicationMetadata &_meta);
+
+      /// \brief Get the filter of the copies of a topic sent to a subscriber
+      /// process at the rate it asked for. The messages sent to all the
+      /// subscribers start with the topic name instead, so they never match
+      /// it.
+      /// \param[in] _pUuid UUID of the subscriber process.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return The filter.
+      /// \sa AdvertiseMessageOptions::SetSubscriberMsgsPerSec
+      public: static std::string RateLimitedFilter(const std::string &_pUuid,
+                                                   const std::string &_topic);
+
+      /// \brief Remove the prefix of the messages received with a filter
+      /// returned by RateLimitedFilter().
+      /// \param[in] _pUuid UUID of this process.
+      /// \param[in,out] _topic The first frame of a message, replaced by
+      /// the topic name.
+      public: static void StripRateLimitedFilter(const std::string &_pUuid,
+                                                 std::string &_topic);
+
+      /// \brief Add a filter to the subscriber socket, unless it's already
+      /// there. Must be called with subscriberMutex locked.
+      /// \param[in] _filter The filter.
+      public: void AddFilter(const std::string &_filter);
+
+      /// \brief Remove a filter added with AddFilter(), if present. Must be
+      /// called with subscriberMutex locked.
+      /// \param[in] _filter The filter.
+      public: void RemoveFilter(const std::string &_filter);
+
+      /// \brief Filters of the subscriber socket. ZeroMQ counts the times
+      /// that a filter is added, so each one is only added once. Protected
+      /// by subscriberMutex.
+      public: std::set<std::string> filters;
+
+      /// \brief Rates at which this process receives the topics that it
+      /// subscribes to, for the topics not received at full rate. Protected
+      /// by NodeShared::mutex.
+      /// \sa NodeShared::UpdateSubscriberRate
+      public: std::unordered_map<std::string, uint64_t> subscribedRates;
+
+      /// \brief The subscriptions of a node to the topics under a prefix.
+      /// \sa Node::SubscribeRawPrefix
+      public: class PrefixSubscription
+      {
+        /// \brief Callbacks of the node, shared by all the topics.
+        public: std::vector<RawSubscriptionHandlerPtr> handlers;
+
+        /// \brief Fully qualified topics whose subscribers include the
+        /// handlers, see NodeShared::AttachPrefixHandlers().
+        public: std::set<std::string> topics;
+      };
+
+      /// \brief Prefix subscriptions of the nodes of this process, indexed
+      /// by fully qualified prefix and node UUID. Protected by
+      /// NodeShared::mutex.
+      public: std::map<std::string, std::map<std::string, PrefixSubscription>>
+        prefixSubscriptions;
+
+      /// \brief The prefixes of prefixSubscriptions, matched against the
+      /// topics of the new publishers. Each prefix is also a filter of the
+      /// subscriber sockets, which makes the filters of the topics under it
+      /// redundant. Protected by NodeShared::mutex.
+      public: TopicPrefixTrie prefixTrie;
+
+      /// \brief Track the rate asked by a remote subscriber of a topic, see
+      /// AdvertiseMessageOptions::SetSubscriberMsgsPerSec(). Must be called
+      /// with NodeShared::mutex locked.
+      /// \param[in] _sub The registration of the subscriber.
+      /// \param[in] _registered False if the subscriber is gone.
+      public: void UpdateRateLimit(const MessagePublisher &_sub,
+                                   const bool _registered);
+
+      /// \brief A remote subscriber process that asked for fewer messages
+      /// of a topic than the ones published.
+      public: struct RateLimitedProcess
+              {
+                /// \brief Minimum time between two messages.
+                public: std::chrono::nanoseconds period{0};
+
+                /// \brief When the last message was sent to the process.
+                public: std::chrono::steady_clock::time_point last;
+              };
+
+      /// \brief Remote subscriber processes of a topic published by this
+      /// process that asked for fewer messages.
+      public: struct RateLimitedTopic
+              {
+                /// \brief Whether other remote subscribers want all the
+                /// messages.
+                public: bool plainSubscribers = false;
+
+                /// \brief The rate limited processes, by process UUID.
+                public: std::map<std::string, RateLimitedProcess> processes;
+              };
+
+      /// \brief Rates asked by the remote subscribers of the topics published
+      /// by this process, indexed by topic and then by process and node
+      /// UUIDs. Protected by NodeShared::mutex.
+      public: std::unordered_map<std::string,
+              std::map<std::pair<std::string, std::string>, uint64_t>>
+                remoteSubscriberRates;
+
+      /// \brief Topics with rate limited remote subscribers, derived from
+      /// remoteSubscriberRates. Protected by NodeShared::mutex.
+      public: std::unordered_map<std::string, RateLimitedTopic>
+                rateLimitedTopics;
+
+      /// \brief Send a message to the rate limited subscriber processes of a
+      /// topic that are due for one. Must be called with NodeShared::mutex
+      /// locked.
+      /// \param[in,out] _topic State of the topic.
+      /// \param[in] _topicName Fully qualified topic name.
+      /// \param[in] _sender Address of the publisher.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _dataSize Number of bytes of the message.
+      /// \param[in] _msgType Message type.
+      /// \param[in] _meta Publication metadata.
+      public: void PublishRateLimited(RateLimitedTopic &_topic,
+                                      const std::string &_topicName,
+                                      const std::string &_sender,
+                                      const char *_data,
+                                      const size_t _dataSize,
+                                      const std::string &_msgType,
+                                      const PublicationMetadata &_meta);
+
+      /// \brief Topic published by this process with fragmentation.
+      public: struct FragmentTopic
+              {
+                /// \brief Size of the fragments, of the first publisher.
+                public: uint64_t fragmentSize = 0;
+
+                /// \brief Number of publishers of the topic that fragment
+                /// the messages.
+                public: int publishers = 0;
+              };
+
+      /// \brief Topics published by this process with fragmentation,
+      /// indexed by fully qualified topic name. Protected by
+      /// NodeShared::mutex.
+      public: std::unordered_map<std::string, FragmentTopic> fragmentTopics;
+
+      /// \brief Remote subscribers that can't reassemble the fragments, by
+      /// topic and then by process and node UUIDs. Protected by
+      /// NodeShared::mutex.
+      public: std::unordered_map<std::string,
+              std::set<std::pair<std::string, std::string>>>
+                unfragmentedSubscribers;
+
+      /// \brief Buffer of a message sent in fragments. The fragments share
+      /// it, and the last one released releases the buffer.
+      public: struct FragmentBuffer
+              {
+                /// \brief Destructor. Releases the buffer.
+                public: ~FragmentBuffer();
+
+                /// \brief The serialized message.
+                public: char *data = nullptr;
+
+                /// \brief Number of bytes of the message.
+                public: size_t size = 0;
+
+                /// \brief Function releasing the buffer.
+                public: DeallocFunc *ffn = nullptr;
+
+                /// \brief Argument of ffn.
+                public: void *hint = nullptr;
+              };
+
+      /// \brief A message waiting to be sent in fragments.
+      public: struct FragmentedMsg
+              {
+                /// \brief Fully qualified topic name.
+                public: std::string topic;
+
+                /// \brief Message type.
+                public: std::string msgType;
+
+                /// \brief Publication metadata, attached to each fragment.
+                public: PublicationMetadata meta;
+
+                /// \brief The serialized message.
+                public: std::shared_ptr<FragmentBuffer> buffer;
+
+                /// \brief Size of the fragments.
+                public: uint64_t fragmentSize = 0;
+
+                /// \brief Position of the next fragment to send.
+                public: uint64_t offset = 0;
+              };
+
+      /// \brief Messages waiting to be sent in fragments, by topic and
+      /// publisher id. The first message of each publisher is being sent,
+      /// the next one waits behind it. Protected by NodeShared::mutex.
+      public: std::map<std::pair<std::string, uint64_t>,
+              std::deque<FragmentedMsg>> pendingFragments;
+
+      /// \brief Whether pendingFragments has elements, checked by the
+      /// reception thread without locking.
+      public: std::atomic<bool> fragmentsPending{false};
+
+      /// \brief Whether a fragment couldn't be sent in the last round
+      /// because the send buffers were full. Only used by the reception
+      /// thread.
+      public: bool fragmentsBlocked = false;
+
+      /// \brief Count a publisher of a topic that fragments the messages.
+      /// Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _size Size of the fragments.
+      public: void AddFragmentTopic(const std::string &_topic,
+                                    const uint64_t _size);
+
+      /// \brief Release a topic added with AddFragmentTopic(), when one of
+      /// its publishers is gone. Must be called with NodeShared::mutex
+      /// locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void RemoveFragmentTopic(const std::string &_topic);
+
+      /// \brief Track whether a remote subscriber of a topic reassembles
+      /// fragments. Must be called with NodeShared::mutex locked.
+      /// \param[in] _sub The registration of the subscriber.
+      /// \param[in] _registered False if the subscriber is gone.
+      public: void UpdateFragmentSubscriber(const MessagePublisher &_sub,
+                                            const bool _registered);
+
+      /// \brief Get the size of the fragments of a message. Must be called
+      /// with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _dataSize Number of bytes of the message.
+      /// \return The size of the fragments, or 0 if the message is sent
+      /// whole.
+      public: uint64_t FragmentSize(const std::string &_topic,
+                                    const size_t _dataSize) const;
+
+      /// \brief Queue a message to be sent in fragments by the reception
+      /// thread. A message already waiting behind the one being sent on the
+      /// same publisher is dropped. Must be called with NodeShared::mutex
+      /// locked.
+      /// \param[in] _msg The message, whose buffer is released once all the
+      /// fragments are sent.
+      public: void QueueFragments(FragmentedMsg &&_msg);
+
+      /// \brief Send the next fragment of a message. Must be called with
+      /// NodeShared::mutex locked.
+      /// \param[in,out] _msg The message, whose offset is advanced.
+      /// \param[in] _sender Address of the publisher.
+      /// \return False if the send buffers were full, and the fragment has
+      /// to be sent again later.
+      public: bool SendFragment(FragmentedMsg &_msg,
+                                const std::string &_sender);
+
+      /// \brief Send one fragment of each message being sent in fragments,
+      /// so the other messages go through the publisher sockets between
+      /// them. Called by the reception thread.
+      /// \param[in] _mutex NodeShared::mutex.
+      /// \param[in] _sender Address of the publisher.
+      public: void SendPendingFragments(std::recursive_mutex &_mutex,
+                                        const std::string &_sender);
+
+      /// \brief Get the filter of the fragments of a topic.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return The filter.
+      public: static std::string FragmentFilter(const std::string &_topic);
+
+      /// \brief A message received in fragments, being reassembled.
+      public: struct Reassembly
+              {
+                /// \brief Sequence number of the message.
+                public: uint64_t seq = 0;
+
+                /// \brief The whole message.
+                public: zmq::message_t payload;
+
+                /// \brief Number of bytes received.
+                public: uint64_t received = 0;
+
+                /// \brief Time of the last fragment.
+                public: std::chrono::steady_clock::time_point last;
+              };
+
+      /// \brief Messages being reassembled, by sender, publisher id and
+      /// topic. Protected by reassemblyMutex.
+      public: std::unordered_map<std::string, Reassembly> reassemblies;
+
+      /// \brief Mutex protecting reassemblies, shared by the reception
+      /// threads.
+      public: std::mutex reassemblyMutex;
+
+      /// \brief Time after which a message that stopped receiving fragments
+      /// is discarded.
+      public: static constexpr std::chrono::seconds kReassemblyTimeout{10};
+
+      /// \brief Maximum number of bytes of a message received in
+      /// fragments, see IGN_TRANSPORT_MAX_FRAGMENTED_SIZE. The messages
+      /// announcing a bigger size are discarded before anything is
+      /// allocated for them.
+      public: uint64_t maxReassemblySize = kDefaultMaxReassemblySize;
+
+      /// \brief Default value of maxReassemblySize, 1 GiB.
+      public: static constexpr uint64_t kDefaultMaxReassemblySize =
+                1024ull * 1024 * 1024;
+
+      /// \brief Maximum number of fragments of a message, of the size of
+      /// its first one.
+      public: static constexpr uint64_t kMaxFragments = 65536;
+
+      /// \brief Add a fragment to the message that it belongs to. The
+      /// message is discarded if a fragment was lost, or if the first
+      /// fragment announces more than maxReassemblySize bytes or more than
+      /// kMaxFragments fragments.
+      /// \param[in,out] _msg The fragment. When the message is complete,
+      /// it's replaced by the whole message.
+      /// \param[out] _received Number of bytes of the message received so
+      /// far, 0 if the message was discarded.
+      /// \return True if the message is complete.
+      public: bool Reassemble(ReceivedMessage &_msg, uint64_t &_received);
+
+      /// \brief Topic published by this process with compression.
+      public: struct CompressedTopic
+              {
+                /// \brief Compression method, of the first publisher.
+                public: Compression_t compression = Compression_t::NONE;
+
+                /// \brief Smaller messages are sent as they are, of the
+                /// first publisher.
+                public: uint64_t threshold = 0;
+
+                /// \brief Number of publishers of the topic that compress
+                /// the messages.
+                public: int publishers = 0;
+              };
+
+      /// \brief Topics published by this process with compression, indexed
+      /// by fully qualified topic name. Protected by NodeShared::mutex.
+      public: std::unordered_map<std::string, CompressedTopic>
+                compressedTopics;
+
+      /// \brief Remote subscribers that can't decompress the messages, by
+      /// topic and then by process and node UUIDs. Protected by
+      /// NodeShared::mutex.
+      public: std::unordered_map<std::string,
+              std::set<std::pair<std::string, std::string>>>
+                uncompressedSubscribers;
+
+      /// \brief Count a publisher of a topic that compresses the messages.
+      /// Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _compression Compression method.
+      /// \param[in] _threshold Smaller messages are sent as they are.
+      public: void AddCompressedTopic(const std::string &_topic,
+                                      const Compression_t _compression,
+                                      const uint64_t _threshold);
+
+      /// \brief Release a topic added with AddCompressedTopic(), when one
+      /// of its publishers is gone. Must be called with NodeShared::mutex
+      /// locked.
+      /// \param[in] _topic Fully qualified topic name.
+      public: void RemoveCompressedTopic(const std::string &_topic);
+
+      /// \brief Track whether a remote subscriber of a topic decompresses
+      /// the messages. Must be called with NodeShared::mutex locked.
+      /// \param[in] _sub The registration of the subscriber.
+      /// \param[in] _registered False if the subscriber is gone.
+      public: void UpdateCompressionSubscriber(const MessagePublisher &_sub,
+                                               const bool _registered);
+
+      /// \brief Get the compression method of a message sent through the
+      /// publisher socket. Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \param[in] _dataSize Number of bytes of the message.
+      /// \return The compression method, NONE if the message is sent as it
+      /// is.
+      public: Compression_t Compression(const std::string &_topic,
+                                        const size_t _dataSize) const;
+
+      /// \brief Registered remote subscribers of a topic, by process and
+      /// node UUIDs, and whether they read the compact header.
+      public: struct HeaderSubscribers
+              {
+                /// \brief True for the subscribers that read the compact
+                /// header.
+                public: std::map<std::pair<std::string, std::string>, bool>
+                          subscribers;
+
+                /// \brief Number of subscribers that don't read it.
+                public: size_t legacy = 0;
+              };
+
+      /// \brief Registered remote subscribers, by topic. Protected by
+      /// NodeShared::mutex.
+      public: std::unordered_map<std::string, HeaderSubscribers>
+                headerSubscribers;
+
+      /// \brief Track whether a remote subscriber of a topic reads the
+      /// compact header. Must be called with NodeShared::mutex locked.
+      /// \param[in] _sub The registration of the subscriber.
+      /// \param[in] _registered False if the subscriber is gone.
+      public: void UpdateHeaderSubscriber(const MessagePublisher &_sub,
+                                          const bool _registered);
+
+      /// \brief Check if the messages of a topic are sent with the compact
+      /// header. Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return True if the compact header is enabled, at least one remote
+      /// subscriber of the topic is registered and all the registered ones
+      /// read it. A subscriber may be connected before its registration is
+      /// processed, so the default framing is used until then.
+      public: bool CompactHeader(const std::string &_topic) const;
+
+      /// \brief Check if the remote subscribers of a topic read the optional
+      /// metadata frame, as the ones that read the compact header do. Must
+      /// be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return True if at least one remote subscriber of the topic is
+      /// registered and all the registered ones read it.
+      public: bool MetadataAccepted(const std::string &_topic) const;
+
+      /// \brief Check if the messages of a topic sent by the publisher
+      /// socket with the default framing carry the publication metadata.
+      /// Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic Fully qualified topic name.
+      /// \return True if a remote subscriber collects statistics on the
+      /// topic, or if the subscribers need it to discard the copies of a
+      /// message and all of them read it.
+      public: bool SendMetadata(const std::string &_topic) const;
+
+      /// \brief Decompress a message received with a compression frame.
+      /// \param[in] _frame The compression frame.
+      /// \param[in,out] _msg The message, whose payload is replaced by the
+      /// original message.
+      /// \return False if the message is malformed or can't be
+      /// decompressed.
+      public: bool DecompressPayload(const zmq::message_t &_frame,
+                                     ReceivedMessage &_msg);
+
+      /// \brief Pack the compact header of a data message.
+      /// \param[in] _sender Address of the publisher.
+      /// \param[in] _msgType Message type.
+      /// \param[in] _meta Publication metadata or nullptr if not used.
+      /// \param[out] _header The packed header.
+      /// \return False if the address or the type are too long for the
+      /// compact header, and the default framing must be used.
+      public: static bool PackHeader(const std::string &_sender,
+                                     const std::string &_msgType,
+                                     const PublicationMetadata *_meta,
+                                     zmq::message_t &_header);
+
+      /// \brief Frames sent with every message of a publisher, built once
+      /// and shared by the messages. ZMQ reference counts the frames that
+      /// don't fit in a zmq::message_t, so they aren't copied.
+      public: struct HeaderFrames
+      {
+        /// \brief Topic of the frames.
+        public: std::string topic;
+
+        /// \brief Message type of the frames.
+        public: std::string msgType;
+
+        /// \brief Frame with the topic.
+        public: zmq::message_t topicFrame;
+
+        /// \brief Frame with the address of the publisher.
+        public: zmq::message_t addressFrame;
+
+        /// \brief Frame with the message type.
+        public: zmq::message_t typeFrame;
+
+        /// \brief Compact header without the metadata, see PackHeader(),
+        /// or empty if the compact header can't be used.
+        public: std::string compactHeader;
+      };
+
+      /// \brief Get the frames of a publisher, building them if the topic
+      /// or the type changed. NodeShared::mutex must be held.
+      /// \param[in] _publisherId Id of the publisher, or 0.
+      /// \param[in] _topic Topic of the message.
+      /// \param[in] _msgType Type of the message.
+      /// \param[in] _sender Address of the publisher.
+      /// \return The frames.
+      public: HeaderFrames &PublisherFrames(const uint64_t _publisherId,
+                                            const std::string &_topic,
+                                            const std::string &_msgType,
+                                            const std::string &_sender);
+
+      /// \brief Forget the frames of a publisher once it's destroyed.
+      /// NodeShared::mutex must be held.
+      /// \param[in] _publisherId Id of the publisher.
+      public: void RemovePublisherFrames(const uint64_t _publisherId);
+
+      /// \brief Share a cached frame.
+      /// \param[in] _cached The cached frame.
+      /// \param[out] _frame The frame to send.
+      public: static void CopyFrame(zmq::message_t &_cached,
+                                    zmq::message_t &_frame);
+
+      /// \brief Pack the compact header of a data message from the cached
+      /// frames of its publisher.
+      /// \param[in] _frames The frames of the publisher.
+      /// \param[in] _meta Publication metadata.
+      /// \param[out] _header The packed header.
+      public: static void PackHeader(const HeaderFrames &_frames,
+                                     const PublicationMetadata &_meta,
+                                     zmq::message_t &_header);
+
+      /// \brief Frames of the publishers, by publisher id. Protected by
+      /// NodeShared::mutex.
+      public: std::unordered_map<uint64_t, HeaderFrames> headerFrames;
+
+      /// \brief Unpack the compact header of a data message.
+      /// \param[in] _header The packed header.
+      /// \param[out] _sender Address of the publisher.
+      /// \param[out] _msgType Message type.
+      /// \param[out] _meta Publication metadata, if present.
+      /// \param[out] _haveMeta True if the header contained metadata.
+      /// \return True if the header was correctly decoded.
+      public: static bool UnpackHeader(const zmq::message_t &_header,
+                                       std::string &_sender,
+                                       std::string &_msgType,
+                                       PublicationMetadata &_meta,
+                                       bool &_haveMeta);
+
+      /// \brief A service request sent to a responder and waiting for its
+      /// response.
+      public: struct InFlightRequest
+      {
+        /// \brief Service name.
+        public: std::string topic;
+
+        /// \brief UUID of the node that made the request.
+        public: std::string nodeUuid;
+
+        /// \brief The request handler.
+        public: IReqHandlerPtr handler;
+
+        /// \brief Socket id of the responder that received the request.
+        public: std::string responderId;
+
+        /// \brief Time when the request was sent.
+        public: std::chrono::steady_clock::time_point sentAt;
+
+        /// \brief Responses of a stream consumed since credits were last
+        /// granted.
+        public: uint32_t consumed = 0;
+      };
+
+      /// \brief Grant more credits to the responder of a stream. Must be
+      /// called with NodeShared::srvMutex locked.
+      /// \param[in] _req The streaming request.
+      /// \param[in] _reqId Id of the request.
+      /// \param[in] _credits Number of credits.
+      /// \param[in] _myAddress Address of this process' response receiver.
+      /// \param[in] _myId Routing id of this process' response receiver.
+      public: void SendStreamCredits(const InFlightRequest &_req,
+        const uint64_t _reqId, const uint64_t _credits,
+        const std::string &_myAddress, const std::string &_myId);
+
+      /// \brief Policies used to pick one of the responders of a service.
+      public: enum class ServiceBalancing
+      {
+        /// \brief Always the first responder found.
+        FIRST,
+
+        /// \brief Each responder in turn.
+        ROUND_ROBIN,
+
+        /// \brief The responder with fewer requests waiting for a response.
+        LEAST_OUTSTANDING,
+
+        /// \brief The responder expected to reply sooner, according to its
+        /// recent response times and its requests waiting for a response.
+        LATENCY
+      };
+
+      /// \brief Statistics of a service responder, used to balance requests.
+      public: struct ResponderStats
+      {
+        /// \brief Requests sent and waiting for a response.
+        public: uint64_t outstanding = 0;
+
+        /// \brief Moving average of the response time, in milliseconds.
+        public: double latency = 0;
+
+        /// \brief True once latency contains at least one sample.
+        public: bool hasLatency = false;
+      };
+
+      /// \brief Pick the responder of a service call according to
+      /// serviceBalancing. Must be called with NodeShared::srvMutex locked.
+      /// \param[in] _topic Service name.
+      /// \param[in] _responders Responders offering the service. Can't be
+      /// empty.
+      /// \return Index of the responder in _responders.
+      public: std::size_t SelectResponder(const std::string &_topic,
+                  const std::vector<ServicePublisher> &_responders);
+
+      /// \brief Update the statistics of a responder when one of its
+      /// requests finishes. Must be called with NodeShared::srvMutex locked.
+      /// \param[in] _req The request that finished.
+      /// \param[in] _now Current time.
+      public: void RequestFinished(const InFlightRequest &_req,
+                  const std::chrono::steady_clock::time_point &_now);
+
+      /// \brief Stop waiting for the responses of the requests whose
+      /// deadline passed. Must be called with NodeShared::srvMutex locked.
+      /// \param[in] _now Current time.
+      /// \return The expired requests.
+      public: std::vector<InFlightRequest> ExpireInFlightRequests(
+                  const std::chrono::steady_clock::time_point &_now);
+
+      /// \brief Stop waiting for the responses of the requests sent to a
+      /// responder that is gone. Must be called with NodeShared::srvMutex
+      /// locked.
+      /// \param[in] _responderId Socket id of the responder.
+      /// \return The requests dropped.
+      public: std::vector<InFlightRequest> DropInFlightRequests(
+                  const std::string &_responderId);
+
+      /// \brief Encode a request id in the frame that the responder echoes
+      /// back with the response. The time left until the requester gives up
+      /// is appended when the request has a deadline, followed by the stream
+      /// window when the request accepts a stream of responses. Responders
+      /// treat the frame as opaque, so older ones simply ignore them.
+      /// \param[in] _id The request id.
+      /// \param[in] _timeout Milliseconds left until the deadline of the
+      /// request, or 0 if it doesn't have a deadline.
+      /// \param[in] _window Stream window, or 0 if the request only accepts
+      /// one response.
+      /// \param[out] _frame The encoded id.
+      public: static void PackRequestId(uint64_t _id, uint64_t _timeout,
+                                        uint64_t _window,
+                                        zmq::message_t &_frame);
+
+      /// \brief Decode a request id echoed back by a responder.
+      /// \param[in] _frame The encoded id.
+      /// \param[out] _id The request id.
+      /// \return True if the frame contains a request id.
+      public: static bool UnpackRequestId(const zmq::message_t &_frame,
+                                          uint64_t &_id);
+
+      /// \brief Decode the time left until the deadline of a request from
+      /// the frame encoded by PackRequestId().
+      /// \param[in] _reqId The encoded id, as received by the responder.
+      /// \param[out] _timeout Milliseconds left until the deadline.
+      /// \return True if the request has a deadline.
+      public: static bool UnpackRequestTimeout(const std::string &_reqId,
+                                               uint64_t &_timeout);
+
+      /// \brief Decode the stream window of a request from the frame encoded
+      /// by PackRequestId().
+      /// \param[in] _reqId The encoded id, as received by the responder.
+      /// \param[out] _window The stream window.
+      /// \return True if the request accepts a stream of responses.
+      public: static bool UnpackRequestWindow(const std::string &_reqId,
+                                              uint64_t &_window);
+
+      /// \brief Split a batch of oneway requests packed by BatchReqHandler.
+      /// \param[in] _data The batch.
+      /// \param[out] _requests The serialized requests, in order.
+      /// \return False if the batch is truncated.
+      public: static bool UnpackOnewayBatch(const std::string &_data,
+                  std::vector<std::string> &_requests);
+
+      /// \brief Service requests already sent and waiting for a response,
+      /// indexed by request id. Responses are matched in constant time no
+      /// matter how many requests are in flight. Protected by
+      /// NodeShared::srvMutex.
+      public: std::unordered_map<uint64_t, InFlightRequest> inFlightRequests;
+
+      /// \brief Id of the next service request sent. Protected by
+      /// NodeShared::srvMutex.
+      public: uint64_t nextRequestId = 0;
+
+      /// \brief Deadlines of the requests in inFlightRequests, if any.
+      /// Entries of requests that already finished are skipped when they
+      /// expire. Protected by NodeShared::srvMutex.
+      public: std::multimap<std::chrono::steady_clock::time_point, uint64_t>
+                inFlightDeadlines;
+
+      /// \brief Whether inFlightDeadlines has elements, checked by the
+      /// reception thread without locking.
+      public: std::atomic<bool> inFlightDeadlinesPending{false};
+
+      /// \brief Next time that the reception thread expires the requests
+      /// whose deadline passed. Only used by the reception thread.
+      public: std::chrono::steady_clock::time_point nextRequestExpiry;
+
+      /// \brief Period of the expiration of the requests by the reception
+      /// thread.
+      public: static constexpr std::chrono::milliseconds
+                kRequestExpiryPeriod{100};
+
+      /// \brief Policy used to pick one of the responders of a service.
+      public: ServiceBalancing serviceBalancing = ServiceBalancing::FIRST;
+
+      /// \brief Statistics of the responders, indexed by socket id.
+      /// Protected by NodeShared::srvMutex.
+      public: std::unordered_map<std::string, ResponderStats> responderStats;
+
+      /// \brief Round robin position of each service. Protected by
+      /// NodeShared::srvMutex.
+      public: std::unordered_map<std::string, std::size_t> nextResponder;
+
+      /// \brief Streams of responses being sent, indexed by StreamKey().
+      /// Protected by NodeShared::srvMutex.
+      public: std::unordered_map<std::string, std::shared_ptr<StreamState>>
+                streams;
+
       /// \brief Statistics for a topic. The key in the map is the topic
       /// name and the value contains the topic statistics.
       public: std::map<std::string, TopicStatistics> topicStats;
 
-      /// \brief Set of topics that have statistics enabled.
-      public: std::map<std::string,
-              std::function<void(const TopicStatistics &_stats)>>
-                enabledTopicStatistics;
+      /// \brief Callback of the statistics of a topic, run by statsThread
+      /// at most once per period, see StatsReporter().
+      public: struct StatsReport
+      {
+        /// \brief The callback.
+        std::function<void(const TopicStatistics &_stats)> cb;
+
+        /// \brief Minimum time between two calls of the callback.
+        std::chrono::nanoseconds period{std::chrono::seconds(1)};
+
+        /// \brief Earliest time of the next call.
+        std::chrono::steady_clock::time_point next;
+
+        /// \brief True if a message was received since the last call.
+        bool updated = false;
+      };
+
+      /// \brief Topics that have statistics enabled, with their callbacks.
+      /// Protected by NodeShared::mutex.
+      public: std::map<std::string, StatsReport> enabledTopicStatistics;
+
+      /// \brief Run the callbacks of the statistics of the topics that
+      /// received messages, each one at most once per period, so the
+      /// reception threads only update the statistics. This function is
+      /// designed to be run in a thread, started by the first call to
+      /// NodeShared::EnableStats().
+      /// \param[in] _shared The owner of this object.
+      public: void StatsReporter(NodeShared &_shared);
+
+      /// \brief Wake up statsThread to report an update. Must be called
+      /// with NodeShared::mutex locked.
+      /// \param[in] _report The report of the updated topic.
+      public: void NotifyStats(StatsReport &_report);
+
+      /// \brief Thread running the callbacks of the statistics.
+      public: std::thread statsThread;
+
+      /// \brief Held by statsThread while it runs the callbacks, and by
+      /// NodeShared::EnableStats(), so a callback isn't called once its
+      /// topic is disabled. Taken before NodeShared::mutex.
+      public: std::mutex statsCbMutex;
+
+      /// \brief Mutex of statsWakeUp.
+      public: std::mutex statsMutex;
+
+      /// \brief Used to wake up statsThread.
+      public: std::condition_variable statsCondition;
+
+      /// \brief True when statsThread has a report to run. Protected by
+      /// statsMutex.
+      public: bool statsWakeUp = false;
+
+      /// \brief Remote subscribers collecting statistics on the topics that
+      /// we publish. The key is the topic and the values are the process and
+      /// node UUIDs of the subscribers. The publication metadata is only
+      /// attached to the messages of these topics.
+      public: std::unordered_map<std::string,
+              std::set<std::pair<std::string, std::string>>> statsSubscribers;
+
+      /// \brief Track whether a remote subscriber of a topic collects
+      /// statistics. Must be called with NodeShared::mutex locked.
+      /// \param[in] _sub The registration of the subscriber.
+      /// \param[in] _stats False if the subscriber stopped collecting them
+      /// or is gone.
+      public: void UpdateStatsSubscriber(const MessagePublisher &_sub,
+                                         const bool _stats);
+
+      /// \brief Forget the registrations of all the nodes of a remote
+      /// process, once the discovery reports it gone. Must be called with
+      /// NodeShared::mutex locked.
+      /// \param[in] _pUuid Process UUID of the subscribers.
+      public: void RemoveSubscriberProcess(const std::string &_pUuid);
+
+      /// \brief Check if a topic has remote subscribers collecting
+      /// statistics. Must be called with NodeShared::mutex locked.
+      /// \param[in] _topic The topic.
+      /// \return True if the messages of the topic carry the publication
+      /// metadata.
+      public: bool PublishStats(const std::string &_topic) const;
+
+      /// \brief Check if we collect statistics on a topic, so the
+      /// publishers should attach the publication metadata.
+      /// \param[in] _topic The topic.
+      /// \return True if statistics are enabled for the topic.
+      public: bool StatsWanted(const std::string &_topic) const;
+
+      /// \brief Wake up the threads waiting in WaitForPeers(). Called by the
+      /// discovery callbacks, when a publisher or a remote subscriber comes or
+      /// goes.
+      public: void NotifyPeersChanged();
+
+      /// \brief Block until a condition on the publishers or the remote
+      /// subscribers holds. The condition is checked again each time that
+      /// NotifyPeersChanged() is called.
+      /// \param[in] _done The condition. It's called without holding
+      /// peersMutex.
+      /// \param[in] _timeout Maximum time to wait.
+      /// \return True if the condition holds, false on timeout.
+      public: bool WaitForPeers(const std::function<bool()> &_done,
+                                const std::chrono::milliseconds &_timeout);
+
+      /// \brief Queue the execution of the callbacks registered with
+      /// NodeShared::AddDiscoveryCb(), see QueueExecutor().
+      /// \param[in] _change Kind of change.
+      /// \param[in] _pub The publisher.
+      public: void NotifyDiscoveryChange(const DiscoveryChange_t _change,
+                                         const MessagePublisher &_pub);
+
+      /// \brief Queue the report of the publishers known now to a callback
+      /// registered with NodeShared::AddDiscoveryCb(), after the changes
+      /// queued before.
+      /// \param[in] _id Id of the callback.
+      public: void ReplayDiscovery(const uint64_t _id);
+
+      /// \brief Get the NodeShared instance of this process with a process
+      /// UUID, e.g. the one of a publisher advertised by a node.
+      /// \param[in] _pUuid The process UUID.
+      /// \return The instance of the transport context with that UUID, or
+      /// the default instance if there's none.
+      public: static NodeShared *InstanceByProcessUuid(
+                  const std::string &_pUuid);
+
+      /// \brief Name of the transport context, see NodeShared::Instance().
+      public: std::string contextName;
+
+      /// \brief Lane of the queue executor used by the discovery callbacks.
+      public: inline static const std::string kDiscoveryLane =
+        "_connections_";
+
+      /// \brief Protects connectionsCbs. It's held while the callbacks run,
+      /// so removing a callback waits for it to finish. Recursive, so a
+      /// callback can remove itself.
+      public: std::recursive_mutex connectionsCbMutex;
+
+      /// \brief Size of connectionsCbs, so the publishers aren't queued
+      /// when there is no callback.
+      public: std::atomic<std::size_t> connectionsCbCount{0};
+
+      /// \brief Callbacks registered with NodeShared::AddDiscoveryCb() and
+      /// NodeShared::AddConnectionsCb(), indexed by id.
+      public: std::map<uint64_t, DiscoveryChangeCallback> connectionsCbs;
+
+      /// \brief Id of the next callback registered with
+      /// NodeShared::AddDiscoveryCb().
+      public: uint64_t nextConnectionsCbId = 1;
+
+      /// \brief Protects peersVersion.
+      public: std::mutex peersMutex;
+
+      /// \brief Signaled by NotifyPeersChanged().
+      public: std::condition_variable peersChanged;
+
+      /// \brief Incremented by NotifyPeersChanged(), so a change that
+      /// happens while a condition is evaluated isn't missed.
+      public: uint64_t peersVersion = 0;
     };
     }
   }
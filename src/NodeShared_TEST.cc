@@ -0,0 +1,1335 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/AdvertiseOptions.hh"
+#include "ignition/transport/Publisher.hh"
+#include "ignition/transport/test_config.h"
+#include "NodeSharedPrivate.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+using namespace std::chrono_literals;
+
+using Balancing = NodeSharedPrivate::ServiceBalancing;
+
+static const std::string kService = "/srv"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Create the responders of a service, with the given socket ids.
+/// \param[in] _ids Socket ids.
+/// \return The responders.
+static std::vector<ServicePublisher> Responders(
+  const std::vector<std::string> &_ids)
+{
+  std::vector<ServicePublisher> responders;
+  for (const auto &id : _ids)
+  {
+    responders.emplace_back(kService, "tcp://127.0.0.1:1234", id, "pUuid",
+      "nUuid", "ignition.msgs.Int32", "ignition.msgs.Int32",
+      AdvertiseServiceOptions());
+  }
+  return responders;
+}
+
+//////////////////////////////////////////////////
+/// \brief Set the statistics of a responder.
+/// \param[in, out] _shared Shared data of the process.
+/// \param[in] _id Socket id of the responder.
+/// \param[in] _outstanding Requests waiting for a response.
+/// \param[in] _latency Response time (ms), negative if there's no sample.
+static void SetStats(NodeSharedPrivate &_shared, const std::string &_id,
+  const uint64_t _outstanding, const double _latency)
+{
+  auto &stats = _shared.responderStats[_id];
+  stats.outstanding = _outstanding;
+  stats.hasLatency = _latency >= 0;
+  stats.latency = stats.hasLatency ? _latency : 0;
+}
+
+//////////////////////////////////////////////////
+/// \brief The first responder is always picked, whatever its load.
+TEST(NodeSharedTest, SelectResponderFirst)
+{
+  NodeSharedPrivate shared;
+  shared.serviceBalancing = Balancing::FIRST;
+  const auto responders = Responders({"a", "b", "c"});
+  SetStats(shared, "a", 10, 100);
+  SetStats(shared, "b", 0, 1);
+
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(0u, shared.SelectResponder(kService, responders));
+}
+
+//////////////////////////////////////////////////
+/// \brief Each responder is picked in turn.
+TEST(NodeSharedTest, SelectResponderRoundRobin)
+{
+  NodeSharedPrivate shared;
+  shared.serviceBalancing = Balancing::ROUND_ROBIN;
+  const auto responders = Responders({"a", "b", "c"});
+  SetStats(shared, "a", 10, 100);
+
+  EXPECT_EQ(0u, shared.SelectResponder(kService, responders));
+  EXPECT_EQ(1u, shared.SelectResponder(kService, responders));
+  EXPECT_EQ(2u, shared.SelectResponder(kService, responders));
+  EXPECT_EQ(0u, shared.SelectResponder(kService, responders));
+
+  // A single responder is always picked.
+  EXPECT_EQ(0u, shared.SelectResponder("/other", Responders({"a"})));
+}
+
+//////////////////////////////////////////////////
+/// \brief The responder with fewer requests waiting is picked, and the
+/// idle responders share the load.
+TEST(NodeSharedTest, SelectResponderLeastOutstanding)
+{
+  NodeSharedPrivate shared;
+  shared.serviceBalancing = Balancing::LEAST_OUTSTANDING;
+  const auto responders = Responders({"a", "b", "c"});
+  SetStats(shared, "a", 3, 1);
+  SetStats(shared, "b", 1, 100);
+  SetStats(shared, "c", 2, -1);
+
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(1u, shared.SelectResponder(kService, responders));
+
+  SetStats(shared, "a", 0, -1);
+  SetStats(shared, "b", 0, -1);
+  SetStats(shared, "c", 0, -1);
+  std::vector<int> picks(responders.size(), 0);
+  for (int i = 0; i < 6; ++i)
+    ++picks[shared.SelectResponder(kService, responders)];
+  EXPECT_EQ(std::vector<int>({2, 2, 2}), picks);
+}
+
+//////////////////////////////////////////////////
+/// \brief The responder expected to reply sooner is picked. Responders
+/// without samples are tried first only while they are idle.
+TEST(NodeSharedTest, SelectResponderLatency)
+{
+  NodeSharedPrivate shared;
+  shared.serviceBalancing = Balancing::LATENCY;
+  const auto responders = Responders({"a", "b", "c"});
+
+  // "b" has no samples and nothing outstanding: it's tried first.
+  SetStats(shared, "a", 0, 10);
+  SetStats(shared, "b", 0, -1);
+  SetStats(shared, "c", 0, 40);
+  EXPECT_EQ(1u, shared.SelectResponder(kService, responders));
+
+  // "b" didn't reply yet: it costs as much as the slowest responder with
+  // samples for each outstanding request, 40 ms.
+  SetStats(shared, "b", 1, -1);
+  EXPECT_EQ(0u, shared.SelectResponder(kService, responders));
+  SetStats(shared, "a", 4, 10);
+  SetStats(shared, "c", 1, 40);
+  EXPECT_EQ(1u, shared.SelectResponder(kService, responders));
+
+  // A hung responder doesn't keep taking the requests.
+  SetStats(shared, "b", 5, -1);
+  for (int i = 0; i < 3; ++i)
+    EXPECT_NE(1u, shared.SelectResponder(kService, responders));
+
+  // Without samples at all, the outstanding requests are compared.
+  SetStats(shared, "a", 2, -1);
+  SetStats(shared, "b", 1, -1);
+  SetStats(shared, "c", 3, -1);
+  EXPECT_EQ(1u, shared.SelectResponder(kService, responders));
+}
+
+//////////////////////////////////////////////////
+/// \brief The statistics of a responder are updated when its requests
+/// finish.
+TEST(NodeSharedTest, RequestFinished)
+{
+  NodeSharedPrivate shared;
+  SetStats(shared, "a", 2, -1);
+
+  const auto now = std::chrono::steady_clock::now();
+  NodeSharedPrivate::InFlightRequest req;
+  req.topic = kService;
+  req.responderId = "a";
+  req.sentAt = now - 20ms;
+
+  shared.RequestFinished(req, now);
+  const auto &stats = shared.responderStats["a"];
+  EXPECT_EQ(1u, stats.outstanding);
+  EXPECT_TRUE(stats.hasLatency);
+  EXPECT_DOUBLE_EQ(20.0, stats.latency);
+
+  // The last sample weights a quarter of the average.
+  req.sentAt = now - 100ms;
+  shared.RequestFinished(req, now);
+  EXPECT_EQ(0u, stats.outstanding);
+  EXPECT_DOUBLE_EQ(40.0, stats.latency);
+
+  // The count doesn't wrap around.
+  shared.RequestFinished(req, now);
+  EXPECT_EQ(0u, stats.outstanding);
+
+  // Responders that are gone are ignored.
+  req.responderId = "gone";
+  shared.RequestFinished(req, now);
+  EXPECT_EQ(0u, shared.responderStats.count("gone"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Create the registration of a remote subscriber.
+/// \param[in] _topic Fully qualified topic name.
+/// \param[in] _nUuid Node UUID of the subscriber.
+/// \param[in] _opts Options announced by the subscriber.
+/// \return The registration.
+static MessagePublisher Registration(const std::string &_topic,
+  const std::string &_nUuid, const AdvertiseMessageOptions &_opts)
+{
+  return MessagePublisher(_topic, "tcp://127.0.0.1:1234",
+    "tcp://127.0.0.1:1235", "pUuid", _nUuid, "ignition.msgs.Int32", _opts);
+}
+
+//////////////////////////////////////////////////
+/// \brief The compact header is only used once all the remote subscribers
+/// of a topic are registered and read it. A subscriber may be connected
+/// before its registration is processed.
+TEST(NodeSharedTest, CompactHeaderNegotiation)
+{
+  const std::string topic = "@/partition@/topic";
+  NodeSharedPrivate shared;
+  shared.compactHeaderEnabled = true;
+
+  AdvertiseMessageOptions compactOpts;
+  compactOpts.SetCompactHeader(true);
+  const auto compact = Registration(topic, "compact", compactOpts);
+  const auto legacy = Registration(topic, "legacy",
+    AdvertiseMessageOptions());
+
+  // The subscription arrived, but there is no registration yet.
+  EXPECT_FALSE(shared.CompactHeader(topic));
+
+  // The legacy subscriber is registered.
+  shared.UpdateHeaderSubscriber(legacy, true);
+  EXPECT_FALSE(shared.CompactHeader(topic));
+
+  shared.UpdateHeaderSubscriber(compact, true);
+  EXPECT_FALSE(shared.CompactHeader(topic));
+
+  // Only the subscribers that read the compact header are left.
+  shared.UpdateHeaderSubscriber(legacy, false);
+  EXPECT_TRUE(shared.CompactHeader(topic));
+
+  // Other topics still wait for their registrations.
+  EXPECT_FALSE(shared.CompactHeader("@/partition@/other"));
+
+  // A registration seen twice is only counted once.
+  shared.UpdateHeaderSubscriber(legacy, true);
+  shared.UpdateHeaderSubscriber(legacy, true);
+  shared.UpdateHeaderSubscriber(legacy, false);
+  EXPECT_TRUE(shared.CompactHeader(topic));
+
+  // No subscriber is left.
+  shared.UpdateHeaderSubscriber(compact, false);
+  EXPECT_FALSE(shared.CompactHeader(topic));
+  EXPECT_TRUE(shared.headerSubscribers.empty());
+
+  // Never used when it's disabled.
+  shared.compactHeaderEnabled = false;
+  shared.UpdateHeaderSubscriber(compact, true);
+  EXPECT_FALSE(shared.CompactHeader(topic));
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the content of a frame.
+/// \param[in] _frame The frame.
+/// \return The content.
+static std::string frameData(const zmq::message_t &_frame)
+{
+  return std::string(static_cast<const char *>(_frame.data()),
+    _frame.size());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the cached frames of a publisher.
+/// \param[in] _frames The frames.
+/// \param[in] _topic Expected topic.
+/// \param[in] _msgType Expected type.
+/// \param[in] _sender Expected address.
+static void checkFrames(const NodeSharedPrivate::HeaderFrames &_frames,
+  const std::string &_topic, const std::string &_msgType,
+  const std::string &_sender)
+{
+  EXPECT_EQ(_topic, _frames.topic);
+  EXPECT_EQ(_msgType, _frames.msgType);
+  EXPECT_EQ(_topic, frameData(_frames.topicFrame));
+  EXPECT_EQ(_sender, frameData(_frames.addressFrame));
+  EXPECT_EQ(_msgType, frameData(_frames.typeFrame));
+
+  PublicationMetadata meta;
+  meta.seq = 7;
+  zmq::message_t header;
+  NodeSharedPrivate::PackHeader(_frames, meta, header);
+
+  std::string sender;
+  std::string msgType;
+  PublicationMetadata unpacked;
+  bool haveMeta = false;
+  ASSERT_TRUE(NodeSharedPrivate::UnpackHeader(header, sender, msgType,
+    unpacked, haveMeta));
+  EXPECT_EQ(_sender, sender);
+  EXPECT_EQ(_msgType, msgType);
+  EXPECT_TRUE(haveMeta);
+  EXPECT_EQ(7u, unpacked.seq);
+}
+
+//////////////////////////////////////////////////
+/// \brief The frames of a publisher are built once, rebuilt when its topic
+/// or its type change, and forgotten once the publisher is destroyed.
+TEST(NodeSharedTest, PublisherFrames)
+{
+  const std::string sender = "tcp://127.0.0.1:1234";
+  const std::string topic = "@/partition@/topic";
+  const std::string other = "@/partition@/other";
+  NodeSharedPrivate shared;
+
+  auto &frames = shared.PublisherFrames(5, topic, "ignition.msgs.Int32",
+    sender);
+  checkFrames(frames, topic, "ignition.msgs.Int32", sender);
+
+  // The same entry is reused while nothing changes.
+  const void *topicData = frames.topicFrame.data();
+  auto &same = shared.PublisherFrames(5, topic, "ignition.msgs.Int32",
+    sender);
+  EXPECT_EQ(&frames, &same);
+  EXPECT_EQ(topicData, same.topicFrame.data());
+  checkFrames(same, topic, "ignition.msgs.Int32", sender);
+
+  // A different topic, as with the publishers without an id.
+  auto &topicChanged = shared.PublisherFrames(5, other,
+    "ignition.msgs.Int32", sender);
+  checkFrames(topicChanged, other, "ignition.msgs.Int32", sender);
+
+  // A different type, as with the generic publishers.
+  auto &typeChanged = shared.PublisherFrames(5, other,
+    "ignition.msgs.StringMsg", sender);
+  checkFrames(typeChanged, other, "ignition.msgs.StringMsg", sender);
+
+  // The frames of each publisher are independent.
+  auto &second = shared.PublisherFrames(6, topic, "ignition.msgs.Int32",
+    sender);
+  checkFrames(second, topic, "ignition.msgs.Int32", sender);
+  EXPECT_EQ(2u, shared.headerFrames.size());
+
+  // The publisher is destroyed.
+  shared.RemovePublisherFrames(5);
+  EXPECT_EQ(1u, shared.headerFrames.size());
+  EXPECT_EQ(0u, shared.headerFrames.count(5));
+  checkFrames(shared.headerFrames.at(6), topic, "ignition.msgs.Int32",
+    sender);
+
+  // Forgetting an unknown publisher does nothing.
+  shared.RemovePublisherFrames(5);
+  EXPECT_EQ(1u, shared.headerFrames.size());
+
+  shared.RemovePublisherFrames(6);
+  EXPECT_TRUE(shared.headerFrames.empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief The latched messages only carry the metadata while all the
+/// registered subscribers read it. A subscriber of an older version
+/// negotiates neither the statistics nor the compact header.
+TEST(NodeSharedTest, LatchedMetadataNegotiation)
+{
+  const std::string topic = "@/partition@/latched";
+  NodeSharedPrivate shared;
+  shared.topicStatsEnabled = true;
+  shared.latchedTopics[topic];
+
+  AdvertiseMessageOptions compactOpts;
+  compactOpts.SetCompactHeader(true);
+  const auto current = Registration(topic, "current", compactOpts);
+  const auto legacy = Registration(topic, "legacy",
+    AdvertiseMessageOptions());
+
+  // Nobody is registered yet.
+  EXPECT_FALSE(shared.SendMetadata(topic));
+
+  shared.UpdateHeaderSubscriber(current, true);
+  EXPECT_TRUE(shared.SendMetadata(topic));
+
+  // The legacy subscriber would take the frame for the topic of its next
+  // message.
+  shared.UpdateHeaderSubscriber(legacy, true);
+  EXPECT_FALSE(shared.SendMetadata(topic));
+
+  shared.UpdateHeaderSubscriber(legacy, false);
+  EXPECT_TRUE(shared.SendMetadata(topic));
+
+  // The topics that aren't latched don't need it.
+  shared.latchedTopics.erase(topic);
+  EXPECT_FALSE(shared.SendMetadata(topic));
+
+  // Unless a subscriber collecting statistics asked for it.
+  shared.statsSubscribers[topic].insert({"pUuid", "current"});
+  EXPECT_TRUE(shared.SendMetadata(topic));
+}
+
+//////////////////////////////////////////////////
+/// \brief A subscriber collecting statistics registers again when it stops
+/// collecting them, and is forgotten once it's gone.
+TEST(NodeSharedTest, StatsNegotiation)
+{
+  const std::string topic = "@/partition@/stats";
+  NodeSharedPrivate shared;
+  shared.topicStatsEnabled = true;
+
+  const auto node1 = Registration(topic, "node1", AdvertiseMessageOptions());
+  const auto node2 = Registration(topic, "node2", AdvertiseMessageOptions());
+
+  shared.UpdateStatsSubscriber(node1, true);
+  EXPECT_TRUE(shared.PublishStats(topic));
+
+  // EnableStats(false) registers the node again without the "stats" entry.
+  shared.UpdateStatsSubscriber(node1, false);
+  EXPECT_FALSE(shared.PublishStats(topic));
+  EXPECT_TRUE(shared.statsSubscribers.empty());
+
+  shared.UpdateStatsSubscriber(node1, true);
+  shared.UpdateStatsSubscriber(node2, true);
+
+  // The END_CONNECTION of a node.
+  shared.UpdateStatsSubscriber(node1, false);
+  EXPECT_TRUE(shared.PublishStats(topic));
+
+  // The process of the subscribers is gone.
+  shared.UpdateStatsSubscriber(node1, true);
+  shared.RemoveSubscriberProcess("other");
+  EXPECT_TRUE(shared.PublishStats(topic));
+  shared.RemoveSubscriberProcess("pUuid");
+  EXPECT_FALSE(shared.PublishStats(topic));
+  EXPECT_TRUE(shared.statsSubscribers.empty());
+}
+
+static const std::string kFragTopic = "@/partition@/frag"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Create a fragment of a message.
+/// \param[in] _data The whole message.
+/// \param[in] _offset Position of the fragment in the message.
+/// \param[in] _size Number of bytes of the fragment.
+/// \param[in] _seq Sequence number of the message.
+/// \return The fragment, as received.
+static ReceivedMessage Fragment(const std::string &_data,
+  const uint64_t _offset, const uint64_t _size, const uint64_t _seq)
+{
+  ReceivedMessage msg;
+  msg.topic = kFragTopic;
+  msg.sender = "tcp://127.0.0.1:1234";
+  msg.msgType = "ignition.msgs.StringMsg";
+  msg.meta.seq = _seq;
+  msg.meta.publisher = 1;
+  msg.haveMeta = true;
+  msg.fragment = true;
+  msg.fragmentHeader.total = _data.size();
+  msg.fragmentHeader.offset = _offset;
+  msg.payload.rebuild(_data.data() + _offset, _size);
+  return msg;
+}
+
+//////////////////////////////////////////////////
+/// \brief The fragments received in order give the whole message.
+TEST(NodeSharedTest, ReassembleInOrder)
+{
+  NodeSharedPrivate shared;
+  const std::string data = "0123456789";
+  uint64_t received = 0;
+
+  auto first = Fragment(data, 0, 4, 1);
+  EXPECT_FALSE(shared.Reassemble(first, received));
+  EXPECT_EQ(4u, received);
+
+  auto second = Fragment(data, 4, 4, 1);
+  EXPECT_FALSE(shared.Reassemble(second, received));
+  EXPECT_EQ(8u, received);
+
+  auto last = Fragment(data, 8, 2, 1);
+  ASSERT_TRUE(shared.Reassemble(last, received));
+  EXPECT_EQ(10u, received);
+  EXPECT_FALSE(last.fragment);
+  EXPECT_EQ(data, std::string(static_cast<const char *>(last.payload.data()),
+    last.payload.size()));
+  EXPECT_TRUE(shared.reassemblies.empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief A message that lost a fragment is discarded, and the next one is
+/// reassembled.
+TEST(NodeSharedTest, ReassembleLostFragment)
+{
+  NodeSharedPrivate shared;
+  const std::string data = "0123456789";
+  uint64_t received = 0;
+
+  auto first = Fragment(data, 0, 4, 1);
+  EXPECT_FALSE(shared.Reassemble(first, received));
+
+  // The middle fragment is lost.
+  auto last = Fragment(data, 8, 2, 1);
+  EXPECT_FALSE(shared.Reassemble(last, received));
+  EXPECT_EQ(0u, received);
+  EXPECT_TRUE(shared.reassemblies.empty());
+
+  // The fragments left of the message are ignored too.
+  auto late = Fragment(data, 4, 4, 1);
+  EXPECT_FALSE(shared.Reassemble(late, received));
+  EXPECT_EQ(0u, received);
+
+  // The next message is complete.
+  for (uint64_t offset = 0; offset < data.size(); offset += 4)
+  {
+    auto fragment = Fragment(data, offset,
+      std::min<uint64_t>(4, data.size() - offset), 2);
+    EXPECT_EQ(offset + 4 >= data.size(),
+      shared.Reassemble(fragment, received));
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief A message whose publisher starts sending another one before the
+/// end is discarded.
+TEST(NodeSharedTest, ReassembleSequenceChange)
+{
+  NodeSharedPrivate shared;
+  const std::string data = "0123456789";
+  uint64_t received = 0;
+
+  auto first = Fragment(data, 0, 4, 1);
+  EXPECT_FALSE(shared.Reassemble(first, received));
+
+  // A fragment of the next message, whose first fragment was lost.
+  auto other = Fragment(data, 4, 4, 2);
+  EXPECT_FALSE(shared.Reassemble(other, received));
+  EXPECT_EQ(0u, received);
+  EXPECT_TRUE(shared.reassemblies.empty());
+
+  // The first fragment of the next message replaces the incomplete one.
+  first = Fragment(data, 0, 4, 3);
+  EXPECT_FALSE(shared.Reassemble(first, received));
+  auto newer = Fragment(data, 0, 4, 4);
+  EXPECT_FALSE(shared.Reassemble(newer, received));
+  EXPECT_EQ(4u, received);
+  auto stale = Fragment(data, 4, 4, 3);
+  EXPECT_FALSE(shared.Reassemble(stale, received));
+  EXPECT_EQ(0u, received);
+}
+
+//////////////////////////////////////////////////
+/// \brief The fragments with a malformed position are discarded, and
+/// nothing is allocated for the messages over the limits.
+TEST(NodeSharedTest, ReassembleMalformedHeader)
+{
+  NodeSharedPrivate shared;
+  shared.maxReassemblySize = 1024;
+  uint64_t received = 0;
+
+  // Bigger than the maximum size.
+  auto huge = Fragment(std::string(16, 'x'), 0, 16, 1);
+  huge.fragmentHeader.total = 1025;
+  EXPECT_FALSE(shared.Reassemble(huge, received));
+  EXPECT_EQ(0u, received);
+  EXPECT_TRUE(shared.reassemblies.empty());
+
+  huge.fragmentHeader.total = std::numeric_limits<uint64_t>::max();
+  EXPECT_FALSE(shared.Reassemble(huge, received));
+  EXPECT_TRUE(shared.reassemblies.empty());
+
+  // Too many fragments of the size of the first one.
+  shared.maxReassemblySize = NodeSharedPrivate::kDefaultMaxReassemblySize;
+  auto tiny = Fragment(std::string(1, 'x'), 0, 1, 1);
+  tiny.fragmentHeader.total = NodeSharedPrivate::kMaxFragments + 1;
+  EXPECT_FALSE(shared.Reassemble(tiny, received));
+  EXPECT_TRUE(shared.reassemblies.empty());
+  tiny.fragmentHeader.total = NodeSharedPrivate::kMaxFragments;
+  EXPECT_FALSE(shared.Reassemble(tiny, received));
+  EXPECT_EQ(1u, received);
+  shared.reassemblies.clear();
+
+  // Empty.
+  auto empty = Fragment(std::string(), 0, 0, 1);
+  EXPECT_FALSE(shared.Reassemble(empty, received));
+  EXPECT_TRUE(shared.reassemblies.empty());
+
+  // The total changes in the middle of the message.
+  const std::string data = "0123456789";
+  auto first = Fragment(data, 0, 4, 1);
+  EXPECT_FALSE(shared.Reassemble(first, received));
+  auto resized = Fragment(data, 4, 4, 1);
+  resized.fragmentHeader.total = 20;
+  EXPECT_FALSE(shared.Reassemble(resized, received));
+  EXPECT_EQ(0u, received);
+  EXPECT_TRUE(shared.reassemblies.empty());
+
+  // A fragment going past the end of the message.
+  first = Fragment(data, 0, 4, 2);
+  EXPECT_FALSE(shared.Reassemble(first, received));
+  auto overflow = Fragment(data + "AB", 4, 8, 2);
+  overflow.fragmentHeader.total = data.size();
+  EXPECT_FALSE(shared.Reassemble(overflow, received));
+  EXPECT_TRUE(shared.reassemblies.empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief The messages are sent whole while a registered subscriber can't
+/// reassemble the fragments.
+TEST(NodeSharedTest, FragmentFallback)
+{
+  NodeSharedPrivate shared;
+  shared.AddFragmentTopic(kFragTopic, 100);
+
+  // Small messages are always sent whole.
+  EXPECT_EQ(0u, shared.FragmentSize(kFragTopic, 100));
+  EXPECT_EQ(100u, shared.FragmentSize(kFragTopic, 1000));
+
+  AdvertiseMessageOptions fragOpts;
+  fragOpts.SetFragmentSize(100);
+  const auto reassembling = Registration(kFragTopic, "frag", fragOpts);
+  const auto legacy = Registration(kFragTopic, "legacy",
+    AdvertiseMessageOptions());
+
+  shared.UpdateFragmentSubscriber(reassembling, true);
+  EXPECT_EQ(100u, shared.FragmentSize(kFragTopic, 1000));
+
+  // The registration lacks "frag".
+  shared.UpdateFragmentSubscriber(legacy, true);
+  EXPECT_EQ(0u, shared.FragmentSize(kFragTopic, 1000));
+
+  shared.UpdateFragmentSubscriber(legacy, false);
+  EXPECT_EQ(100u, shared.FragmentSize(kFragTopic, 1000));
+
+  // Not fragmented once the publisher is gone.
+  shared.RemoveFragmentTopic(kFragTopic);
+  EXPECT_EQ(0u, shared.FragmentSize(kFragTopic, 1000));
+}
+
+//////////////////////////////////////////////////
+/// \brief Register a remote subscriber as NodeShared::OnNewRegistration()
+/// does, or forget it as NodeShared::OnEndRegistration() does.
+/// \param[in, out] _shared Shared data of the process.
+/// \param[in] _sub The registration of the subscriber.
+/// \param[in] _registered False if the subscriber is gone.
+static void updateSubscriber(NodeSharedPrivate &_shared,
+  const MessagePublisher &_sub, const bool _registered)
+{
+  _shared.UpdateDataSubscriber(_sub, _registered);
+  _shared.UpdateRateLimit(_sub, _registered);
+  _shared.UpdateFragmentSubscriber(_sub, _registered);
+  _shared.UpdateCompressionSubscriber(_sub, _registered);
+  _shared.UpdateHeaderSubscriber(_sub, _registered);
+}
+
+//////////////////////////////////////////////////
+/// \brief An older subscriber that crashes never unregisters. Its process
+/// is forgotten once the discovery reports it gone, instead of pinning the
+/// fallbacks for the life of the publisher.
+TEST(NodeSharedTest, SubscriberProcessGone)
+{
+  NodeSharedPrivate shared;
+  shared.compactHeaderEnabled = true;
+  shared.AddFragmentTopic(kFragTopic, 100);
+  shared.AddCompressedTopic(kFragTopic, Compression_t::ZLIB, 10);
+  shared.dataTopics[kFragTopic].bestEffortPublishers = 1;
+
+  AdvertiseMessageOptions currentOpts;
+  currentOpts.SetFragmentSize(100);
+  currentOpts.SetCompression(Compression_t::ZLIB, 10);
+  currentOpts.SetCompactHeader(true);
+  auto current = Registration(kFragTopic, "current", currentOpts);
+  current.SetPUuid("current");
+
+  // Two nodes of an older process, one of them rate limited.
+  AdvertiseMessageOptions limitedOpts;
+  limitedOpts.SetSubscriberMsgsPerSec(5u);
+  const auto legacy1 = Registration(kFragTopic, "legacy1",
+    AdvertiseMessageOptions());
+  const auto legacy2 = Registration(kFragTopic, "legacy2", limitedOpts);
+
+  updateSubscriber(shared, current, true);
+  updateSubscriber(shared, legacy1, true);
+  updateSubscriber(shared, legacy2, true);
+  EXPECT_EQ(0u, shared.FragmentSize(kFragTopic, 1000));
+  EXPECT_EQ(Compression_t::NONE, shared.Compression(kFragTopic, 1000));
+  EXPECT_FALSE(shared.CompactHeader(kFragTopic));
+  EXPECT_EQ(1u, shared.rateLimitedTopics.count(kFragTopic));
+  EXPECT_EQ(3u, shared.dataTopics[kFragTopic].tcpSubscribers.size());
+
+  // Another process is gone.
+  shared.RemoveSubscriberProcess("other");
+  EXPECT_EQ(0u, shared.FragmentSize(kFragTopic, 1000));
+
+  shared.RemoveSubscriberProcess("pUuid");
+  EXPECT_EQ(100u, shared.FragmentSize(kFragTopic, 1000));
+  EXPECT_EQ(Compression_t::ZLIB, shared.Compression(kFragTopic, 1000));
+  EXPECT_TRUE(shared.CompactHeader(kFragTopic));
+  EXPECT_EQ(0u, shared.rateLimitedTopics.count(kFragTopic));
+  EXPECT_EQ(1u, shared.remoteSubscriberRates[kFragTopic].size());
+  ASSERT_EQ(1u, shared.dataTopics[kFragTopic].tcpSubscribers.size());
+  EXPECT_EQ("current",
+    shared.dataTopics[kFragTopic].tcpSubscribers.begin()->first);
+  ASSERT_EQ(1u, shared.headerSubscribers.count(kFragTopic));
+  EXPECT_EQ(0u, shared.headerSubscribers[kFragTopic].legacy);
+}
+
+static const std::string kMcastTopic = "@/partition@/mcast"; // NOLINT(*)
+static const std::string kGroup = "239.255.0.7:11320"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Replace the socket of a multicast group with one bound to an
+/// inproc endpoint, since PGM isn't always available nor looped back.
+/// \param[in, out] _shared Shared data of the process.
+/// \param[in] _endpoint The inproc endpoint.
+static void FakeMulticastGroup(NodeSharedPrivate &_shared,
+  const std::string &_endpoint)
+{
+  std::unique_ptr<zmq::socket_t> socket(
+    new zmq::socket_t(*_shared.context, ZMQ_PUB));
+  socket->bind(_endpoint.c_str());
+  _shared.multicastPublishers[kGroup] = std::move(socket);
+}
+
+//////////////////////////////////////////////////
+/// \brief A message sent to the group of a topic is decoded by the
+/// subscribers of the group, with its metadata.
+TEST(NodeSharedTest, MulticastDelivery)
+{
+  NodeSharedPrivate shared;
+  const std::string endpoint = "inproc://mcast_delivery";
+  FakeMulticastGroup(shared, endpoint);
+  std::string group = kGroup;
+  ASSERT_TRUE(shared.AddMulticastTopic(kMcastTopic, group, "127.0.0.1",
+    TopicStorage<MessagePublisher>()));
+  EXPECT_EQ(kGroup, group);
+  ASSERT_NE(nullptr, shared.dataTopics[kMcastTopic].socket);
+
+  zmq::socket_t subscriber(*shared.context, ZMQ_SUB);
+  const int timeout = 5000;
+  zmq_setsockopt(static_cast<void *>(subscriber), ZMQ_RCVTIMEO, &timeout,
+    sizeof(timeout));
+  zmq_setsockopt(static_cast<void *>(subscriber), ZMQ_SUBSCRIBE,
+    kMcastTopic.data(), kMcastTopic.size());
+  subscriber.connect(endpoint.c_str());
+
+  // The subscription reaches the publisher asynchronously.
+  std::this_thread::sleep_for(100ms);
+
+  const std::string data = "serialized message";
+  zmq::message_t dataMsg(data.data(), data.size());
+  PublicationMetadata meta;
+  meta.seq = 4;
+  meta.publisher = 2;
+  shared.PublishMulticast(*shared.dataTopics[kMcastTopic].socket,
+    kMcastTopic, "tcp://127.0.0.1:1234", dataMsg, "ignition.msgs.Int32",
+    meta);
+
+  ReceivedMessage received;
+  ASSERT_TRUE(shared.RecvMessage(subscriber, "pUuid", received));
+  EXPECT_EQ(kMcastTopic, received.topic);
+  EXPECT_EQ("tcp://127.0.0.1:1234", received.sender);
+  EXPECT_EQ("ignition.msgs.Int32", received.msgType);
+  ASSERT_TRUE(received.haveMeta);
+  EXPECT_EQ(4u, received.meta.seq);
+  EXPECT_EQ(2u, received.meta.publisher);
+  EXPECT_EQ(data, std::string(received.payload.data<char>(),
+    received.payload.size()));
+}
+
+//////////////////////////////////////////////////
+/// \brief Send the frames of a message.
+/// \param[in] _socket The publisher socket.
+/// \param[in] _frames The frames.
+static void sendFrames(zmq::socket_t &_socket,
+  const std::vector<std::string> &_frames)
+{
+  for (size_t i = 0; i < _frames.size(); ++i)
+  {
+    zmq_send(static_cast<void *>(_socket), _frames[i].data(),
+      _frames[i].size(), i + 1 < _frames.size() ? ZMQ_SNDMORE : 0);
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief The metadata frame of the default framing is optional, and a
+/// message without it doesn't change how the next one is read.
+TEST(NodeSharedTest, OptionalMetadataFrame)
+{
+  NodeSharedPrivate shared;
+  const std::string endpoint = "inproc://optional_metadata";
+  const std::string topic = "@/partition@/topic";
+  zmq::socket_t publisher(*shared.context, ZMQ_PUB);
+  publisher.bind(endpoint.c_str());
+
+  zmq::socket_t subscriber(*shared.context, ZMQ_SUB);
+  const int timeout = 5000;
+  zmq_setsockopt(static_cast<void *>(subscriber), ZMQ_RCVTIMEO, &timeout,
+    sizeof(timeout));
+  zmq_setsockopt(static_cast<void *>(subscriber), ZMQ_SUBSCRIBE,
+    topic.data(), topic.size());
+  subscriber.connect(endpoint.c_str());
+
+  // The subscription reaches the publisher asynchronously.
+  std::this_thread::sleep_for(100ms);
+
+  PublicationMetadata meta;
+  meta.seq = 7;
+  meta.publisher = 3;
+  const std::string metaFrame(reinterpret_cast<const char *>(&meta),
+    sizeof(meta));
+  const std::string addr = "tcp://127.0.0.1:1234";
+  const std::string type = "ignition.msgs.Int32";
+  sendFrames(publisher, {topic, addr, "first", type});
+  sendFrames(publisher, {topic, addr, "second", type, metaFrame});
+  sendFrames(publisher, {topic, addr, "third", type});
+
+  ReceivedMessage first;
+  ASSERT_TRUE(shared.RecvMessage(subscriber, "pUuid", first));
+  EXPECT_EQ(topic, first.topic);
+  EXPECT_EQ(type, first.msgType);
+  EXPECT_FALSE(first.haveMeta);
+  EXPECT_EQ("first", std::string(first.payload.data<char>(),
+    first.payload.size()));
+
+  ReceivedMessage second;
+  ASSERT_TRUE(shared.RecvMessage(subscriber, "pUuid", second));
+  EXPECT_EQ(topic, second.topic);
+  ASSERT_TRUE(second.haveMeta);
+  EXPECT_EQ(7u, second.meta.seq);
+  EXPECT_EQ(3u, second.meta.publisher);
+  EXPECT_EQ("second", std::string(second.payload.data<char>(),
+    second.payload.size()));
+
+  ReceivedMessage third;
+  ASSERT_TRUE(shared.RecvMessage(subscriber, "pUuid", third));
+  EXPECT_EQ(topic, third.topic);
+  EXPECT_EQ(addr, third.sender);
+  EXPECT_EQ(type, third.msgType);
+  EXPECT_FALSE(third.haveMeta);
+  EXPECT_EQ("third", std::string(third.payload.data<char>(),
+    third.payload.size()));
+}
+
+//////////////////////////////////////////////////
+/// \brief The publisher leaves a group once the last publisher of the last
+/// topic sent to it is gone.
+TEST(NodeSharedTest, MulticastGroupLeft)
+{
+  NodeSharedPrivate shared;
+  FakeMulticastGroup(shared, "inproc://mcast_left");
+  const std::string other = "@/partition@/mcast_other";
+  TopicStorage<MessagePublisher> remote;
+
+  // Two publishers of a topic and a second topic in the group.
+  std::string group = kGroup;
+  ASSERT_TRUE(shared.AddMulticastTopic(kMcastTopic, group, "127.0.0.1",
+    remote));
+  ASSERT_TRUE(shared.AddMulticastTopic(kMcastTopic, group, "127.0.0.1",
+    remote));
+  ASSERT_TRUE(shared.AddMulticastTopic(other, group, "127.0.0.1", remote));
+
+  shared.RemoveMulticastTopic(kMcastTopic);
+  EXPECT_EQ(1u, shared.dataTopics.count(kMcastTopic));
+  shared.RemoveMulticastTopic(kMcastTopic);
+  EXPECT_EQ(0u, shared.dataTopics.count(kMcastTopic));
+  EXPECT_EQ(1u, shared.multicastPublishers.count(kGroup));
+
+  // A best effort topic keeps its state, but not the group.
+  ASSERT_TRUE(shared.AddMulticastTopic(kMcastTopic, group, "127.0.0.1",
+    remote));
+  shared.dataTopics[kMcastTopic].bestEffortPublishers = 1;
+  shared.RemoveMulticastTopic(kMcastTopic);
+  ASSERT_EQ(1u, shared.dataTopics.count(kMcastTopic));
+  EXPECT_TRUE(shared.dataTopics[kMcastTopic].group.empty());
+  EXPECT_EQ(nullptr, shared.dataTopics[kMcastTopic].socket);
+  EXPECT_EQ(1u, shared.multicastPublishers.count(kGroup));
+
+  shared.RemoveMulticastTopic(other);
+  EXPECT_EQ(0u, shared.dataTopics.count(other));
+  EXPECT_TRUE(shared.multicastPublishers.empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief The TCP copies of a topic sent to a multicast group only carry
+/// the metadata while all the registered subscribers read it. A subscriber
+/// of an older version ignores the group and registers without it.
+TEST(NodeSharedTest, MulticastMetadataNegotiation)
+{
+  NodeSharedPrivate shared;
+  FakeMulticastGroup(shared, "inproc://mcast_metadata");
+  std::string group = kGroup;
+  ASSERT_TRUE(shared.AddMulticastTopic(kMcastTopic, group, "127.0.0.1",
+    TopicStorage<MessagePublisher>()));
+
+  AdvertiseMessageOptions compactOpts;
+  compactOpts.SetCompactHeader(true);
+  const auto current = Registration(kMcastTopic, "current", compactOpts);
+  const auto legacy = Registration(kMcastTopic, "legacy",
+    AdvertiseMessageOptions());
+
+  shared.UpdateHeaderSubscriber(current, true);
+  EXPECT_TRUE(shared.SendMetadata(kMcastTopic));
+
+  shared.UpdateHeaderSubscriber(legacy, true);
+  EXPECT_FALSE(shared.SendMetadata(kMcastTopic));
+
+  shared.UpdateHeaderSubscriber(legacy, false);
+  EXPECT_TRUE(shared.SendMetadata(kMcastTopic));
+
+  // Not needed once the topic left the group.
+  shared.RemoveMulticastTopic(kMcastTopic);
+  EXPECT_FALSE(shared.SendMetadata(kMcastTopic));
+}
+
+#ifndef _WIN32
+//////////////////////////////////////////////////
+/// \brief Check if a file exists.
+/// \param[in] _path Path of the file.
+/// \return True if it exists.
+static bool fileExists(const std::string &_path)
+{
+  struct stat info;
+  return stat(_path.c_str(), &info) == 0;
+}
+
+//////////////////////////////////////////////////
+/// \brief The socket files of the IPC endpoints are unlinked at exit, and
+/// the endpoints aren't found anymore.
+TEST(NodeSharedTest, IpcEndpointUnlinked)
+{
+  NodeSharedPrivate shared;
+  const std::string pUuid = "test-" + testing::getRandomNumber();
+  const std::string endpoint = NodeSharedPrivate::IpcEndpoint(pUuid);
+  const std::string path = endpoint.substr(std::strlen("ipc://"));
+
+  zmq::socket_t socket(*shared.context, ZMQ_PUB);
+  ASSERT_TRUE(shared.BindIpc(socket, endpoint));
+  EXPECT_TRUE(fileExists(path));
+  std::string found;
+  EXPECT_TRUE(NodeSharedPrivate::LocalIpcEndpoint(pUuid, found));
+  EXPECT_EQ(endpoint, found);
+
+  shared.UnlinkIpcEndpoints();
+  EXPECT_FALSE(fileExists(path));
+  EXPECT_FALSE(NodeSharedPrivate::LocalIpcEndpoint(pUuid, found));
+  EXPECT_TRUE(shared.ipcPaths.empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief The requests to a responder of the same host that listens on its
+/// IPC endpoint take the IPC path. Otherwise, or if its socket file was left
+/// behind, they go to its TCP address.
+TEST(NodeSharedTest, ResponderEndpointIpc)
+{
+  NodeSharedPrivate shared;
+  const std::string pUuid = "test-" + testing::getRandomNumber();
+  const std::string endpoint = NodeSharedPrivate::IpcEndpoint(pUuid,
+    NodeSharedPrivate::kReplierLane);
+  const std::string path = endpoint.substr(std::strlen("ipc://"));
+  const ServicePublisher responder(kService, "tcp://127.0.0.1:1234", "id",
+    pUuid, "nUuid", "ignition.msgs.Int32", "ignition.msgs.Int32",
+    AdvertiseServiceOptions());
+
+  // Not listening yet.
+  EXPECT_EQ(responder.Addr(), NodeSharedPrivate::ResponderEndpoint(responder));
+
+  zmq::socket_t replier(*shared.context, ZMQ_ROUTER);
+  ASSERT_TRUE(shared.BindIpc(replier, endpoint));
+  ASSERT_EQ(endpoint, NodeSharedPrivate::ResponderEndpoint(responder));
+
+  // A request sent to the endpoint selected reaches the replier.
+  zmq::socket_t requester(*shared.context, ZMQ_DEALER);
+  requester.connect(endpoint.c_str());
+  const int timeout = 5000;
+  zmq_setsockopt(static_cast<void *>(replier), ZMQ_RCVTIMEO, &timeout,
+    sizeof(timeout));
+  ASSERT_EQ(3, zmq_send(static_cast<void *>(requester), "req", 3, 0));
+  char buffer[256];
+  // The identity of the requester comes first.
+  ASSERT_GT(zmq_recv(static_cast<void *>(replier), buffer, sizeof(buffer), 0),
+    0);
+  ASSERT_EQ(3, zmq_recv(static_cast<void *>(replier), buffer, sizeof(buffer),
+    0));
+  EXPECT_EQ("req", std::string(buffer, 3));
+
+  shared.UnlinkIpcEndpoints();
+  EXPECT_EQ(responder.Addr(), NodeSharedPrivate::ResponderEndpoint(responder));
+
+  // The socket file of a process that didn't exit normally.
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size());
+  ASSERT_EQ(0, bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)));
+  close(fd);
+  EXPECT_TRUE(fileExists(path));
+  EXPECT_EQ(responder.Addr(), NodeSharedPrivate::ResponderEndpoint(responder));
+  unlink(path.c_str());
+}
+
+//////////////////////////////////////////////////
+/// \brief An IPC endpoint too long for a Unix domain socket isn't bound.
+TEST(NodeSharedTest, IpcEndpointTooLong)
+{
+  NodeSharedPrivate shared;
+  zmq::socket_t socket(*shared.context, ZMQ_PUB);
+  const std::string endpoint =
+    "ipc:///tmp/" + std::string(200, 'x') + "/ign-transport.pub";
+  EXPECT_FALSE(shared.BindIpc(socket, endpoint));
+  EXPECT_TRUE(shared.ipcPaths.empty());
+}
+//////////////////////////////////////////////////
+/// \brief Wait for a datagram.
+/// \param[in] _socket UDP socket.
+/// \param[in] _timeoutMs Maximum time to wait (ms).
+/// \return The datagram, empty if none arrived.
+static std::string recvDatagram(const int _socket, const int _timeoutMs)
+{
+  pollfd item;
+  item.fd = _socket;
+  item.events = POLLIN;
+  item.revents = 0;
+  if (poll(&item, 1, _timeoutMs) != 1)
+    return "";
+
+  std::vector<char> buffer(65536);
+  const ssize_t size = recv(_socket, buffer.data(), buffer.size(), 0);
+  return size > 0 ? std::string(buffer.data(), size) : "";
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the address of a UDP socket.
+/// \param[in] _socket UDP socket.
+/// \return The address.
+static sockaddr_in udpAddress(const int _socket)
+{
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  socklen_t addrLen = sizeof(addr);
+  getsockname(_socket, reinterpret_cast<sockaddr *>(&addr), &addrLen);
+  return addr;
+}
+
+static const std::string kDatagramTopic = "@/partition@/udp"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief A message sent as a datagram is decoded by the subscriber. The
+/// nodes of a process share its endpoint and receive a single datagram.
+TEST(NodeSharedTest, DatagramDelivery)
+{
+  NodeSharedPrivate pub;
+  NodeSharedPrivate sub;
+  pub.InitializeUdpSocket("127.0.0.1");
+  sub.InitializeUdpSocket("127.0.0.1");
+  ASSERT_GE(pub.udpSocket, 0);
+  ASSERT_GE(sub.udpSocket, 0);
+  EXPECT_EQ(0u, sub.udpEndpoint.find("udp://127.0.0.1:"));
+
+  NodeSharedPrivate::DataTopic topic;
+  topic.bestEffortPublishers = 1;
+  topic.udpSubscribers[{"pUuid", "node1"}] = udpAddress(sub.udpSocket);
+  topic.udpSubscribers[{"pUuid", "node2"}] = udpAddress(sub.udpSocket);
+
+  const std::string data = "serialized message";
+  PublicationMetadata meta;
+  meta.stamp = 1;
+  meta.seq = 7;
+  meta.publisher = 3;
+  ASSERT_TRUE(pub.PublishDatagrams(topic, kDatagramTopic,
+    "tcp://127.0.0.1:1234", data.data(), data.size(), "ignition.msgs.Int32",
+    meta));
+
+  const std::string datagram = recvDatagram(sub.udpSocket, 5000);
+  ASSERT_FALSE(datagram.empty());
+  EXPECT_TRUE(recvDatagram(sub.udpSocket, 100).empty());
+
+  std::string topicName, sender, msgType;
+  PublicationMetadata received;
+  zmq::message_t payload;
+  ASSERT_TRUE(NodeSharedPrivate::UnpackDatagram(datagram.data(),
+    datagram.size(), topicName, sender, msgType, received, payload));
+  EXPECT_EQ(kDatagramTopic, topicName);
+  EXPECT_EQ("tcp://127.0.0.1:1234", sender);
+  EXPECT_EQ("ignition.msgs.Int32", msgType);
+  EXPECT_EQ(1u, received.stamp);
+  EXPECT_EQ(7u, received.seq);
+  EXPECT_EQ(3u, received.publisher);
+  EXPECT_EQ(data, std::string(payload.data<char>(), payload.size()));
+
+  pub.CloseUdpSocket();
+  sub.CloseUdpSocket();
+}
+
+//////////////////////////////////////////////////
+/// \brief The TCP copies of a best effort topic only carry the metadata
+/// while all the registered subscribers read it. A subscriber of an older
+/// version ignores the best effort delivery and registers without it.
+TEST(NodeSharedTest, DatagramMetadataNegotiation)
+{
+  NodeSharedPrivate shared;
+  shared.dataTopics[kDatagramTopic].bestEffortPublishers = 1;
+
+  AdvertiseMessageOptions udpOpts;
+  udpOpts.SetCompactHeader(true);
+  udpOpts.SetBestEffort(true);
+  const auto current = Registration(kDatagramTopic, "current", udpOpts);
+  const auto legacy = Registration(kDatagramTopic, "legacy",
+    AdvertiseMessageOptions());
+
+  shared.UpdateHeaderSubscriber(current, true);
+  EXPECT_TRUE(shared.SendMetadata(kDatagramTopic));
+
+  shared.UpdateHeaderSubscriber(legacy, true);
+  EXPECT_FALSE(shared.SendMetadata(kDatagramTopic));
+
+  shared.UpdateHeaderSubscriber(legacy, false);
+  EXPECT_TRUE(shared.SendMetadata(kDatagramTopic));
+}
+
+//////////////////////////////////////////////////
+/// \brief A message too big for a datagram isn't sent, the caller sends it
+/// over TCP instead.
+TEST(NodeSharedTest, DatagramOversize)
+{
+  NodeSharedPrivate pub;
+  NodeSharedPrivate sub;
+  pub.InitializeUdpSocket("127.0.0.1");
+  sub.InitializeUdpSocket("127.0.0.1");
+  ASSERT_GE(pub.udpSocket, 0);
+  ASSERT_GE(sub.udpSocket, 0);
+
+  NodeSharedPrivate::DataTopic topic;
+  topic.bestEffortPublishers = 1;
+  topic.udpSubscribers[{"pUuid", "nUuid"}] = udpAddress(sub.udpSocket);
+
+  const std::string data(65507, 'x');
+  EXPECT_FALSE(pub.PublishDatagrams(topic, kDatagramTopic,
+    "tcp://127.0.0.1:1234", data.data(), data.size(), "ignition.msgs.Bytes",
+    PublicationMetadata()));
+  EXPECT_TRUE(recvDatagram(sub.udpSocket, 100).empty());
+
+  // The largest datagram fits, headers included.
+  const std::string fits(60000, 'x');
+  EXPECT_TRUE(pub.PublishDatagrams(topic, kDatagramTopic,
+    "tcp://127.0.0.1:1234", fits.data(), fits.size(), "ignition.msgs.Bytes",
+    PublicationMetadata()));
+  EXPECT_LT(fits.size(), recvDatagram(sub.udpSocket, 5000).size());
+
+  pub.CloseUdpSocket();
+  sub.CloseUdpSocket();
+}
+
+//////////////////////////////////////////////////
+/// \brief The datagrams truncated or without the magic byte are rejected.
+TEST(NodeSharedTest, DatagramMalformed)
+{
+  NodeSharedPrivate pub;
+  NodeSharedPrivate sub;
+  pub.InitializeUdpSocket("127.0.0.1");
+  sub.InitializeUdpSocket("127.0.0.1");
+  ASSERT_GE(pub.udpSocket, 0);
+  ASSERT_GE(sub.udpSocket, 0);
+
+  NodeSharedPrivate::DataTopic topic;
+  topic.bestEffortPublishers = 1;
+  topic.udpSubscribers[{"pUuid", "nUuid"}] = udpAddress(sub.udpSocket);
+  const std::string data = "1234";
+  ASSERT_TRUE(pub.PublishDatagrams(topic, kDatagramTopic,
+    "tcp://127.0.0.1:1234", data.data(), data.size(), "ignition.msgs.Int32",
+    PublicationMetadata()));
+  const std::string datagram = recvDatagram(sub.udpSocket, 5000);
+  ASSERT_GT(datagram.size(), data.size());
+
+  std::string topicName, sender, msgType;
+  PublicationMetadata meta;
+  zmq::message_t payload;
+
+  // Truncated anywhere before the payload.
+  for (size_t size = 0; size < datagram.size() - data.size(); ++size)
+  {
+    EXPECT_FALSE(NodeSharedPrivate::UnpackDatagram(datagram.data(), size,
+      topicName, sender, msgType, meta, payload)) << size;
+  }
+
+  // Truncated payload, the datagram carries its own size.
+  EXPECT_TRUE(NodeSharedPrivate::UnpackDatagram(datagram.data(),
+    datagram.size() - 1, topicName, sender, msgType, meta, payload));
+  EXPECT_EQ("123", std::string(payload.data<char>(), payload.size()));
+
+  // Wrong magic byte.
+  std::string wrong = datagram;
+  wrong[0] = static_cast<char>(wrong[0] + 1);
+  EXPECT_FALSE(NodeSharedPrivate::UnpackDatagram(wrong.data(), wrong.size(),
+    topicName, sender, msgType, meta, payload));
+
+  // A topic length beyond the end of the datagram.
+  wrong = datagram;
+  const uint16_t tooLong = std::numeric_limits<uint16_t>::max();
+  std::memcpy(&wrong[1], &tooLong, sizeof(tooLong));
+  EXPECT_FALSE(NodeSharedPrivate::UnpackDatagram(wrong.data(), wrong.size(),
+    topicName, sender, msgType, meta, payload));
+
+  pub.CloseUdpSocket();
+  sub.CloseUdpSocket();
+}
+
+//////////////////////////////////////////////////
+/// \brief Receive all the frames of a message.
+/// \param[in] _socket The socket, with a reception timeout.
+/// \param[out] _frames The frames.
+/// \return False if the timeout expired.
+static bool recvFrames(zmq::socket_t &_socket,
+  std::vector<std::string> &_frames)
+{
+  _frames.clear();
+  int more = 0;
+  do
+  {
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    if (zmq_msg_recv(&msg, static_cast<void *>(_socket), 0) < 0)
+    {
+      zmq_msg_close(&msg);
+      return false;
+    }
+    _frames.emplace_back(static_cast<const char *>(zmq_msg_data(&msg)),
+      zmq_msg_size(&msg));
+    more = zmq_msg_more(&msg);
+    zmq_msg_close(&msg);
+  } while (more);
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief The access control handler answers all the handshakes waiting,
+/// whatever their result. Every reply echoes the version and the sequence
+/// of its request, the early rejections too.
+TEST(NodeSharedTest, AccessControlHandshakes)
+{
+  setenv("IGN_TRANSPORT_USERNAME", "user", 1);
+  setenv("IGN_TRANSPORT_PASSWORD", "pass", 1);
+
+  NodeSharedPrivate shared;
+  shared.SecurityInit();
+  ASSERT_TRUE(shared.accessControlThread.joinable());
+
+  // Plays the part of the sockets of 0MQ authenticating their peers.
+  zmq::socket_t zap(*shared.context, ZMQ_DEALER);
+  const int timeout = 5000;
+  zmq_setsockopt(static_cast<void *>(zap), ZMQ_RCVTIMEO, &timeout,
+    sizeof(timeout));
+  zap.connect("inproc://zeromq.zap.01");
+
+  auto request = [](const std::string &_version, const std::string &_seq,
+    const std::string &_domain, const std::string &_address,
+    const std::string &_mechanism, const std::string &_pass)
+  {
+    std::vector<std::string> frames = {"", _version, _seq, _domain,
+      _address, "", _mechanism};
+    if (_mechanism == "PLAIN")
+    {
+      frames.push_back("user");
+      frames.push_back(_pass);
+    }
+    return frames;
+  };
+
+  // The expected status of each sequence number.
+  const std::vector<std::pair<std::string, std::string>> expected =
+  {
+    {"1", "200"}, {"2", "200"}, {"3", "200"}, {"4", "400"},
+    {"5", "400"}, {"6", "400"}, {"7", "400"}, {"8", "400"}
+  };
+
+  // All the handshakes are pending before the handler reads any. A
+  // malformed request in the middle is dropped without a reply.
+  sendFrames(zap, request("1.0", "1", "ign-auth", "127.0.0.1", "PLAIN",
+    "pass"));
+  sendFrames(zap, request("1.0", "2", "ign-auth", "127.0.0.1", "PLAIN",
+    "pass"));
+  sendFrames(zap, {"", "1.0"});
+  sendFrames(zap, request("1.0", "3", "ign-auth", "127.0.0.1", "PLAIN",
+    "pass"));
+  sendFrames(zap, request("1.0", "4", "ign-auth", "127.0.0.1", "PLAIN",
+    "wrong"));
+  // Rejected before the credentials are checked.
+  sendFrames(zap, request("2.0", "5", "ign-auth", "127.0.0.1", "PLAIN",
+    "pass"));
+  sendFrames(zap, request("1.0", "6", "ign-auth", "127.0.0.1", "NULL", ""));
+  sendFrames(zap, request("1.0", "7", "ign-auth", "", "PLAIN", "pass"));
+  sendFrames(zap, request("1.0", "8", "other", "127.0.0.1", "PLAIN",
+    "pass"));
+
+  std::vector<std::string> frames;
+  for (const auto &seqStatus : expected)
+  {
+    ASSERT_TRUE(recvFrames(zap, frames)) << seqStatus.first;
+
+    // Delimiter, version, sequence, status, text, user id and metadata.
+    ASSERT_EQ(7u, frames.size());
+    EXPECT_TRUE(frames[0].empty());
+    EXPECT_EQ(seqStatus.first == "5" ? "2.0" : "1.0", frames[1]);
+    EXPECT_EQ(seqStatus.first, frames[2]);
+    EXPECT_EQ(seqStatus.second, frames[3]) << seqStatus.first;
+    if (seqStatus.second == "200")
+      EXPECT_EQ("anonymous", frames[5]);
+    else
+      EXPECT_TRUE(frames[5].empty());
+  }
+
+  // Nothing else is answered.
+  const int shortTimeout = 100;
+  zmq_setsockopt(static_cast<void *>(zap), ZMQ_RCVTIMEO, &shortTimeout,
+    sizeof(shortTimeout));
+  EXPECT_FALSE(recvFrames(zap, frames));
+
+  shared.exit = true;
+  NodeSharedPrivate::SendWakeup(*shared.accessWakeupSender);
+  shared.accessControlThread.join();
+
+  unsetenv("IGN_TRANSPORT_USERNAME");
+  unsetenv("IGN_TRANSPORT_PASSWORD");
+}
+#endif
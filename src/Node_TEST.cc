@@ -15,13 +15,25 @@
  *
 */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <csignal>
+#include <cstring>
 #include <cstdlib>
 #include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
 #include <ignition/msgs.hh>
 
 #include "gtest/gtest.h"
@@ -29,6 +41,7 @@
 #include "ignition/transport/MessageInfo.hh"
 #include "ignition/transport/Node.hh"
 #include "ignition/transport/NodeOptions.hh"
+#include "ignition/transport/NodeShared.hh"
 #include "ignition/transport/TopicStatistics.hh"
 #include "ignition/transport/TopicUtils.hh"
 #include "ignition/transport/TransportTypes.hh"
@@ -614,8 +627,9 @@ TEST(NodeTest, PubSubSameThread)
 }
 
 //////////////////////////////////////////////////
-/// \brief A thread can create a node, and send and receive messages.
-TEST(NodeTest, PubSubSameThreadGenericCb)
+/// \brief A subscriber that comes after the last publication of a latched
+/// publisher receives it, while no message is kept once it's destroyed.
+TEST(NodeTest, PubSubLatched)
 {
   reset();
 
@@ -623,43 +637,36 @@ TEST(NodeTest, PubSubSameThreadGenericCb)
   msg.set_data(data);
 
   transport::Node node;
+  {
+    transport::AdvertiseMessageOptions opts;
+    opts.SetLatched(true);
+    auto pub = node.Advertise<ignition::msgs::Int32>(g_topic, opts);
+    ASSERT_TRUE(pub);
+    EXPECT_TRUE(pub.Publish(msg));
 
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub);
-
-  EXPECT_TRUE(node.Subscribe(g_topic, genericCb));
-
-  // Wait some time before publishing.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Publish a first message.
-  EXPECT_TRUE(pub.Publish(msg));
-
-  // Give some time to the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_TRUE(node.Subscribe(g_topic, cb));
 
-  // Check that the message was received.
-  EXPECT_TRUE(genericCbExecuted);
+    // Give some time to the subscribers.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_TRUE(cbExecuted);
+    EXPECT_EQ(1, counter);
+    EXPECT_TRUE(node.Unsubscribe(g_topic));
+  }
 
   reset();
 
-  // Publish a second message on topic.
-  EXPECT_TRUE(pub.Publish(msg));
-
-  // Give some time to the subscribers.
+  // The publisher is gone, so is its message.
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Check that the data was received.
-  EXPECT_TRUE(genericCbExecuted);
+  EXPECT_FALSE(cbExecuted);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief A thread can create a node, and send and receive messages.
-/// This test uses a callback that accepts a parameter with the message
-/// information.
-TEST(NodeTest, PubSubSameThreadMessageInfo)
+/// \brief Subscribing and unsubscribing between publications must be
+/// reflected by the publisher, even though it caches its subscribers.
+TEST(NodeTest, PubSubSameThreadResubscribe)
 {
   reset();
 
@@ -670,939 +677,2600 @@ TEST(NodeTest, PubSubSameThreadMessageInfo)
   auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
   EXPECT_TRUE(pub);
 
-  EXPECT_TRUE(node.Subscribe(g_topic, cbInfo));
-
-  // Wait some time before publishing.
+  // Publish without subscribers.
+  EXPECT_TRUE(pub.Publish(msg));
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(cbExecuted);
 
-  // Publish a first message.
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
   EXPECT_TRUE(pub.Publish(msg));
-
-  // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Check that the message was received.
   EXPECT_TRUE(cbExecuted);
 
   reset();
 
-  // Publish a second message on topic.
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
   EXPECT_TRUE(pub.Publish(msg));
-
-  // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(cbExecuted);
 
-  // Check that the data was received.
-  EXPECT_TRUE(cbExecuted);
+  EXPECT_TRUE(node.Subscribe(g_topic, cb2));
+  EXPECT_TRUE(pub.Publish(msg));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(cbExecuted);
+  EXPECT_TRUE(cb2Executed);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-TEST(NodeTest, RawPubSubSameThreadMessageInfo)
+/// \brief Publish messages handing over their ownership.
+TEST(NodeTest, PubSubSameThreadOwnedMsg)
 {
   reset();
 
-  ignition::msgs::Int32 msg;
-  msg.set_data(data);
-
   transport::Node node;
   auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
   EXPECT_TRUE(pub);
-
-  EXPECT_TRUE(node.Subscribe(g_topic, cbInfo));
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
 
   // Wait some time before publishing.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  // Publish a first message.
-  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+  auto msgPtr = std::make_unique<ignition::msgs::Int32>();
+  msgPtr->set_data(data);
+  EXPECT_TRUE(pub.Publish(std::move(msgPtr)));
 
-  // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Check that the message was received.
   EXPECT_TRUE(cbExecuted);
+  EXPECT_EQ(1, counter);
 
   reset();
 
-  // Publish a second message on topic.
-  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  EXPECT_TRUE(pub.Publish(std::move(msg)));
 
-  // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Check that the data was received.
   EXPECT_TRUE(cbExecuted);
+  EXPECT_EQ(1, counter);
+
+  // A null message can't be published.
+  EXPECT_FALSE(pub.Publish(std::unique_ptr<ignition::msgs::Int32>()));
+
+  // Neither a message of the wrong type.
+  auto wrongPtr = std::make_unique<ignition::msgs::StringMsg>();
+  EXPECT_FALSE(pub.Publish(std::move(wrongPtr)));
 
   reset();
 }
 
 //////////////////////////////////////////////////
-TEST(NodeTest, RawPubRawSubSameThreadMessageInfo)
+/// \brief The inline subscriptions run in the publishing thread, before
+/// Publish() returns.
+TEST(NodeTest, PubSubInlineDelivery)
 {
   reset();
 
-  ignition::msgs::Int32 msg;
-  msg.set_data(data);
-
   transport::Node node;
   auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
   EXPECT_TRUE(pub);
 
-  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
-
-  // Wait some time before publishing.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Publish a first message.
-  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+  transport::SubscribeOptions opts;
+  opts.SetInlineDelivery(true);
 
-  // Give some time to the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const auto publishingThread = std::this_thread::get_id();
+  int typedCalls = 0;
+  int rawCalls = 0;
+  std::function<void(const ignition::msgs::Int32 &)> typedCb =
+    [&](const ignition::msgs::Int32 &_msg)
+    {
+      EXPECT_EQ(data, _msg.data());
+      EXPECT_EQ(publishingThread, std::this_thread::get_id());
+      ++typedCalls;
+    };
+  EXPECT_TRUE(node.Subscribe(g_topic, typedCb, opts));
+  EXPECT_TRUE(node.SubscribeRaw(g_topic,
+    [&](const char *_data, const size_t _size,
+        const transport::MessageInfo &)
+    {
+      ignition::msgs::Int32 msg;
+      EXPECT_TRUE(msg.ParseFromArray(_data, static_cast<int>(_size)));
+      EXPECT_EQ(publishingThread, std::this_thread::get_id());
+      ++rawCalls;
+    }, ignition::msgs::Int32().GetTypeName(), opts));
 
-  // Check that the message was received.
-  EXPECT_TRUE(cbExecuted);
+  // A regular subscription still runs in the transport thread.
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
 
-  reset();
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  EXPECT_TRUE(pub.Publish(msg));
+  EXPECT_EQ(1, typedCalls);
+  EXPECT_EQ(1, rawCalls);
 
-  // Publish a second message on topic.
-  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+  // The moved messages are delivered inline before they are handed over.
+  ignition::msgs::Int32 moved;
+  moved.set_data(data);
+  EXPECT_TRUE(pub.Publish(std::move(moved)));
+  EXPECT_EQ(2, typedCalls);
+  EXPECT_EQ(2, rawCalls);
 
-  // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Check that the data was received.
-  EXPECT_TRUE(cbExecuted);
+  EXPECT_EQ(2, counter);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-TEST(NodeTest, PubRawSubSameThreadMessageInfo)
+/// \brief The handlers of a publisher are gathered again when a subscriber
+/// comes or goes between two publications.
+TEST(NodeTest, PubSubFanOutSubscribersChange)
 {
   reset();
 
+  transport::Node pubNode;
+  transport::Node node1;
+  transport::Node node2;
+  auto pub = pubNode.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  transport::SubscribeOptions opts;
+  opts.SetInlineDelivery(true);
+
+  int calls1 = 0;
+  int calls2 = 0;
+  std::function<void(const ignition::msgs::Int32 &)> cb1 =
+    [&](const ignition::msgs::Int32 &) {++calls1;};
+  std::function<void(const ignition::msgs::Int32 &)> cb2 =
+    [&](const ignition::msgs::Int32 &) {++calls2;};
+
   ignition::msgs::Int32 msg;
   msg.set_data(data);
 
-  transport::Node node;
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub);
+  EXPECT_TRUE(node1.Subscribe(g_topic, cb1, opts));
+  EXPECT_TRUE(pub.Publish(msg));
+  EXPECT_EQ(1, calls1);
+  EXPECT_EQ(0, calls2);
 
-  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+  EXPECT_TRUE(node2.Subscribe(g_topic, cb2, opts));
+  EXPECT_TRUE(pub.Publish(msg));
+  EXPECT_EQ(2, calls1);
+  EXPECT_EQ(1, calls2);
 
-  // Wait some time before publishing.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(node1.Unsubscribe(g_topic));
+  EXPECT_TRUE(pub.Publish(msg));
+  EXPECT_EQ(2, calls1);
+  EXPECT_EQ(2, calls2);
 
-  // Publish a first message.
+  EXPECT_TRUE(node1.Subscribe(g_topic, cb1, opts));
   EXPECT_TRUE(pub.Publish(msg));
+  EXPECT_EQ(3, calls1);
+  EXPECT_EQ(3, calls2);
 
-  // Give some time to the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  reset();
+}
 
-  // Check that the message was received.
-  EXPECT_TRUE(cbExecuted);
+//////////////////////////////////////////////////
+/// \brief Copy a file and its dependencies to a pool, so its messages have
+/// descriptors of their own, as the dynamic messages do.
+/// \param[in, out] _pool The pool.
+/// \param[in] _file The file.
+/// \return The copy or nullptr if it can't be built.
+static const google::protobuf::FileDescriptor *copyFile(
+  google::protobuf::DescriptorPool &_pool,
+  const google::protobuf::FileDescriptor *_file)
+{
+  if (const auto *copied = _pool.FindFileByName(_file->name()))
+    return copied;
 
+  for (int i = 0; i < _file->dependency_count(); ++i)
+    copyFile(_pool, _file->dependency(i));
+
+  google::protobuf::FileDescriptorProto proto;
+  _file->CopyTo(&proto);
+  return _pool.BuildFile(proto);
+}
+
+//////////////////////////////////////////////////
+/// \brief The handlers of a publisher are gathered again when it publishes
+/// a message with another descriptor, and the subscribers get each message
+/// as it was published.
+TEST(NodeTest, PubSubFanOutDynamicMessage)
+{
   reset();
 
-  // Publish a second message on topic.
-  EXPECT_TRUE(pub.Publish(msg));
+  ignition::msgs::Int32 compiled;
+  compiled.set_data(data);
 
-  // Give some time to the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  google::protobuf::DescriptorPool pool;
+  ASSERT_NE(nullptr, copyFile(pool, compiled.GetDescriptor()->file()));
+  const google::protobuf::Descriptor *dynamicDescriptor =
+    pool.FindMessageTypeByName(compiled.GetTypeName());
+  ASSERT_NE(nullptr, dynamicDescriptor);
+  ASSERT_NE(compiled.GetDescriptor(), dynamicDescriptor);
+  google::protobuf::DynamicMessageFactory factory(&pool);
+  std::unique_ptr<transport::ProtoMsg> dynamic(
+    factory.GetPrototype(dynamicDescriptor)->New());
+  ASSERT_TRUE(dynamic->ParseFromString(compiled.SerializeAsString()));
 
-  // Check that the data was received.
-  EXPECT_TRUE(cbExecuted);
+  transport::Node node;
+  auto pub = node.Advertise(g_topic, compiled.GetTypeName());
+  EXPECT_TRUE(pub);
+
+  transport::SubscribeOptions opts;
+  opts.SetInlineDelivery(true);
+
+  std::vector<const google::protobuf::Descriptor *> descriptors;
+  std::function<void(const transport::ProtoMsg &)> descriptorCb =
+    [&](const transport::ProtoMsg &_msg)
+    {
+      descriptors.push_back(_msg.GetDescriptor());
+    };
+  EXPECT_TRUE(node.Subscribe(g_topic, descriptorCb, opts));
+
+  int rawCalls = 0;
+  EXPECT_TRUE(node.SubscribeRaw(g_topic,
+    [&](const char *_data, const size_t _size,
+        const transport::MessageInfo &)
+    {
+      ignition::msgs::Int32 msg;
+      EXPECT_TRUE(msg.ParseFromArray(_data, static_cast<int>(_size)));
+      EXPECT_EQ(data, msg.data());
+      ++rawCalls;
+    }, compiled.GetTypeName(), opts));
+
+  EXPECT_TRUE(pub.Publish(compiled));
+  EXPECT_TRUE(pub.Publish(*dynamic));
+  EXPECT_TRUE(pub.Publish(compiled));
+
+  ASSERT_EQ(3u, descriptors.size());
+  EXPECT_EQ(compiled.GetDescriptor(), descriptors[0]);
+  EXPECT_EQ(dynamicDescriptor, descriptors[1]);
+  EXPECT_EQ(compiled.GetDescriptor(), descriptors[2]);
+  EXPECT_EQ(3, rawCalls);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Subscribe to a topic using a lambda function.
-TEST(NodeTest, PubSubSameThreadLambda)
+/// \brief A typed publisher is also an untyped one, checked at runtime.
+TEST(NodeTest, PubTypedPublisher)
 {
   reset();
 
+  transport::Node::TypedPublisher<ignition::msgs::Int32> invalid;
+  EXPECT_FALSE(invalid);
+  EXPECT_FALSE(invalid.Publish(ignition::msgs::Int32()));
+
+  transport::Node node;
+  transport::Node::TypedPublisher<ignition::msgs::Int32> typed =
+    node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(typed);
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
   ignition::msgs::Int32 msg;
   msg.set_data(data);
+  transport::Node::Publisher untyped = typed;
+  EXPECT_TRUE(untyped.Publish(msg));
+  EXPECT_FALSE(untyped.Publish(ignition::msgs::StringMsg()));
+  EXPECT_TRUE(typed.Publish(msg));
 
-  transport::Node node;
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(2, counter);
 
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub);
+  reset();
+}
 
+//////////////////////////////////////////////////
+/// \brief The message filters are evaluated before the callbacks.
+TEST(NodeTest, PubSubSameThreadFilter)
+{
   std::mutex mutex;
-  std::condition_variable condition;
+  std::vector<int> received;
+  std::vector<int> rawReceived;
 
-  bool executed = false;
-  std::function<void(const ignition::msgs::Int32&)> subCb =
-    [&executed, &mutex, &condition](const ignition::msgs::Int32 &_msg)
-  {
-    EXPECT_EQ(_msg.data(), data);
-    std::lock_guard<std::mutex> lk(mutex);
-    executed = true;
-    condition.notify_all();
-  };
+  std::function<void(const ignition::msgs::Int32 &)> filteredCb =
+    [&](const ignition::msgs::Int32 &_msg)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      received.push_back(_msg.data());
+    };
 
-  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
+  transport::RawCallback rawCb =
+    [&](const char *_msgData, const size_t _size,
+        const transport::MessageInfo &)
+    {
+      ignition::msgs::Int32 msg;
+      EXPECT_TRUE(msg.ParseFromArray(_msgData, static_cast<int>(_size)));
+      std::lock_guard<std::mutex> lk(mutex);
+      rawReceived.push_back(msg.data());
+    };
+
+  // Only accept even numbers.
+  transport::SubscribeOptions opts;
+  opts.SetFilter([](const char *_msgData, const size_t _size,
+                    const transport::MessageInfo &_info)
+    {
+      EXPECT_EQ(ignition::msgs::Int32().GetTypeName(), _info.Type());
+      ignition::msgs::Int32 msg;
+      return msg.ParseFromArray(_msgData, static_cast<int>(_size)) &&
+             msg.data() % 2 == 0;
+    });
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+  EXPECT_TRUE(node.Subscribe(g_topic, filteredCb, opts));
 
-  // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  // Publish a first message.
-  EXPECT_TRUE(pub.Publish(msg));
+  ignition::msgs::Int32 msg;
+  for (int i = 0; i < 4; ++i)
+  {
+    msg.set_data(i);
+    EXPECT_TRUE(pub.Publish(msg));
+  }
 
-  // The local publish is asynchronous, which means we need to wait
-  // for the callback.
-  std::unique_lock<std::mutex> lk(mutex);
-  condition.wait(lk, [&executed]{return executed;});
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    ASSERT_EQ(2u, received.size());
+    EXPECT_EQ(0, received[0]);
+    EXPECT_EQ(2, received[1]);
+  }
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
 
-  EXPECT_TRUE(executed);
+  // Raw subscriptions are filtered too.
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCb,
+    ignition::msgs::Int32().GetTypeName(), opts));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  reset();
+  for (int i = 0; i < 4; ++i)
+  {
+    msg.set_data(i);
+    EXPECT_TRUE(pub.Publish(msg));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    ASSERT_EQ(2u, rawReceived.size());
+    EXPECT_EQ(0, rawReceived[0]);
+    EXPECT_EQ(2, rawReceived[1]);
+  }
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
 }
 
 //////////////////////////////////////////////////
-/// \brief Subscribe to a topic using a lambda function.
-/// This test uses a callback that accepts a parameter with the message
-/// information.
-TEST(NodeTest, PubSubSameThreadLambdaMessageInfo)
+/// \brief Subscribe with a callback that receives lazy messages.
+TEST(NodeTest, PubSubSameThreadLazy)
 {
-  reset();
+  std::mutex mutex;
+  std::vector<transport::LazyMessage<ignition::msgs::Int32>> received;
 
-  ignition::msgs::Int32 msg;
-  msg.set_data(data);
+  std::function<void(const transport::LazyMessage<ignition::msgs::Int32> &,
+                     const transport::MessageInfo &)> lazyCb =
+    [&](const transport::LazyMessage<ignition::msgs::Int32> &_msg,
+        const transport::MessageInfo &_info)
+    {
+      EXPECT_EQ(g_topic, _info.Topic());
+      std::lock_guard<std::mutex> lk(mutex);
+      received.push_back(_msg);
+    };
 
   transport::Node node;
-
   auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
   EXPECT_TRUE(pub);
+  EXPECT_TRUE(node.SubscribeLazy(g_topic, lazyCb));
 
-  bool executed = false;
-  std::function<void(const ignition::msgs::Int32&,
-                     const ignition::transport::MessageInfo &)> subCb =
-    [&executed](const ignition::msgs::Int32 &_msg,
-                const ignition::transport::MessageInfo &_info)
-  {
-    EXPECT_EQ(_info.Topic(), g_topic);
-    EXPECT_EQ(_msg.data(), data);
-    EXPECT_EQ(g_FQNPartition, _info.Partition());
-    EXPECT_EQ(_msg.GetTypeName(), _info.Type());
-    EXPECT_TRUE(_info.IntraProcess());
-    std::lock_guard<std::mutex> lk(cbMutex);
-    executed = true;
-    cbCondition.notify_all();
-  };
-
-  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
-
-  // Give some time to the subscribers.
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  // Publish a first message.
-  std::unique_lock<std::mutex> lk(cbMutex);
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
   EXPECT_TRUE(pub.Publish(msg));
-  cbCondition.wait(lk, [&executed]{return executed;});
 
-  EXPECT_TRUE(executed);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    ASSERT_EQ(1u, received.size());
+    EXPECT_EQ(msg.GetTypeName(), received[0].Type());
 
-  reset();
+    // The handle outlives the callback.
+    auto parsed = received[0].Get();
+    ASSERT_NE(nullptr, parsed);
+    EXPECT_EQ(data, parsed->data());
+  }
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
 }
 
 //////////////////////////////////////////////////
-/// \brief Advertise two topics with the same name. It's not possible to do it
-/// within the same node but it's valid on separate nodes.
-TEST(NodeTest, AdvertiseTwoEqualTopics)
+/// \brief Subscribe with callbacks that share the messages.
+TEST(NodeTest, PubSubSameThreadShared)
 {
-  transport::Node node1;
-  transport::Node node2;
+  std::mutex mutex;
+  std::vector<std::shared_ptr<const ignition::msgs::Int32>> received;
 
-  auto pub1 = node1.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub1);
-  auto pub2 = node1.Advertise<ignition::msgs::StringMsg>(g_topic);
-  EXPECT_FALSE(pub2);
-  auto pub3 = node2.Advertise<ignition::msgs::StringMsg>(g_topic);
-  EXPECT_TRUE(pub3);
-}
+  transport::SharedMsgCallback<ignition::msgs::Int32> sharedCb =
+    [&](const std::shared_ptr<const ignition::msgs::Int32> &_msg,
+        const transport::MessageInfo &_info)
+    {
+      EXPECT_EQ(g_topic, _info.Topic());
+      std::lock_guard<std::mutex> lk(mutex);
+      received.push_back(_msg);
+    };
 
-//////////////////////////////////////////////////
-/// \brief Use two threads using their own transport nodes. One thread
-/// will publish a message, whereas the other thread is subscribed to the topic.
-TEST(NodeTest, PubSubTwoThreadsSameTopic)
-{
-  transport::NodeOptions options;
-  CreatePubSubTwoThreads(options);
-}
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+  EXPECT_TRUE(node.SubscribeShared(g_topic, sharedCb));
+  EXPECT_TRUE(node.SubscribeShared(g_topic, sharedCb));
+  EXPECT_FALSE(node.SubscribeShared(g_topic,
+    transport::SharedMsgCallback<ignition::msgs::Int32>()));
 
-//////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "Process" scope.
-TEST(NodeTest, ScopeProcess)
-{
-  transport::NodeOptions options;
-  CreatePubSubTwoThreads(options, transport::Scope_t::PROCESS);
-}
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-//////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "Host" scope.
-TEST(NodeTest, ScopeHost)
-{
-  transport::NodeOptions options;
-  CreatePubSubTwoThreads(options, transport::Scope_t::HOST);
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  EXPECT_TRUE(pub.Publish(msg));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    ASSERT_EQ(2u, received.size());
+
+    // Both subscribers share the copy of the transport, which outlives the
+    // callbacks.
+    ASSERT_NE(nullptr, received[0]);
+    EXPECT_EQ(received[0].get(), received[1].get());
+    EXPECT_NE(&msg, received[0].get());
+    EXPECT_EQ(data, received[0]->data());
+  }
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "All" scope.
-TEST(NodeTest, ScopeAll)
+/// \brief Publish a batch of messages.
+TEST(NodeTest, PubSubSameThreadBatch)
 {
-  transport::NodeOptions options;
-  CreatePubSubTwoThreads(options, transport::Scope_t::ALL);
+  reset();
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::vector<ignition::msgs::Int32> msgs(3);
+  for (auto &msg : msgs)
+    msg.set_data(data);
+  EXPECT_TRUE(pub.PublishBatch(msgs));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(cbExecuted);
+  EXPECT_EQ(3, counter);
+
+  reset();
+
+  // An empty batch is fine.
+  EXPECT_TRUE(pub.PublishBatch(std::vector<ignition::msgs::Int32>()));
+
+  // A single message of the wrong type invalidates the batch.
+  ignition::msgs::Int32 good;
+  good.set_data(data);
+  ignition::msgs::StringMsg wrong;
+  EXPECT_FALSE(pub.PublishBatch({&good, &wrong}));
+  EXPECT_FALSE(pub.PublishBatch({&good, nullptr}));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(cbExecuted);
+  EXPECT_EQ(0, counter);
+
+  reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Use two threads using their own transport nodes. One thread
-/// will publish a message, whereas the other thread is subscribed to the topic.
-/// Topic remapping is enabled.
-TEST(NodeTest, PubSubTwoThreadsSameTopicRemap)
+/// \brief A bounded local queue drops the messages published while it's
+/// full.
+TEST(NodeTest, PubSubSameThreadLocalQueueDropNewest)
 {
-  transport::NodeOptions options;
-  options.AddTopicRemap(g_topic, g_topic_remap);
-  CreatePubSubTwoThreads(options);
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool release = false;
+  int received = 0;
+
+  std::function<void(const ignition::msgs::Int32 &)> slowCb =
+    [&](const ignition::msgs::Int32 &)
+    {
+      std::unique_lock<std::mutex> lk(mutex);
+      ++received;
+      condition.wait(lk, [&]{return release;});
+    };
+
+  transport::AdvertiseMessageOptions opts;
+  opts.SetLocalQueueDepth(2u);
+  opts.SetOverflowPolicy(transport::QueueOverflowPolicy_t::DROP_NEWEST);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic, opts);
+  EXPECT_TRUE(pub);
+  EXPECT_TRUE(node.Subscribe(g_topic, slowCb));
+  EXPECT_EQ(0u, pub.DroppedLocalMessages());
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  // The first message blocks the callback, so it takes one slot until it's
+  // released.
+  EXPECT_TRUE(pub.Publish(msg));
+  for (int i = 0; i < 100; ++i)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      if (received > 0)
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // Only one more message fits.
+  for (int i = 0; i < 10; ++i)
+    EXPECT_TRUE(pub.Publish(msg));
+  EXPECT_EQ(9u, pub.DroppedLocalMessages());
+
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    release = true;
+  }
+  condition.notify_all();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    EXPECT_EQ(2, received);
+  }
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "Process" scope.
-/// Topic remapping is enabled.
-TEST(NodeTest, ScopeProcessRemap)
+/// \brief A bounded local queue with the default policy discards the
+/// oldest messages, as soon as they are superseded.
+TEST(NodeTest, PubSubSameThreadLocalQueueDropOldest)
 {
-  transport::NodeOptions options;
-  options.AddTopicRemap(g_topic, g_topic_remap);
-  CreatePubSubTwoThreads(options, transport::Scope_t::PROCESS);
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool release = false;
+  std::vector<int> received;
+
+  std::function<void(const ignition::msgs::Int32 &)> slowCb =
+    [&](const ignition::msgs::Int32 &_msg)
+    {
+      std::unique_lock<std::mutex> lk(mutex);
+      received.push_back(_msg.data());
+      condition.wait(lk, [&]{return release;});
+    };
+
+  transport::AdvertiseMessageOptions opts;
+  opts.SetLocalQueueDepth(2u);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic, opts);
+  EXPECT_TRUE(pub);
+  EXPECT_TRUE(node.Subscribe(g_topic, slowCb));
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(0);
+
+  // The first message blocks the callback.
+  EXPECT_TRUE(pub.Publish(msg));
+  for (int i = 0; i < 100; ++i)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      if (!received.empty())
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // Only the two newest messages are kept.
+  for (int i = 1; i <= 10; ++i)
+  {
+    msg.set_data(i);
+    EXPECT_TRUE(pub.Publish(msg));
+  }
+  EXPECT_EQ(8u, pub.DroppedLocalMessages());
+
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    release = true;
+  }
+  condition.notify_all();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    EXPECT_EQ(std::vector<int>({0, 9, 10}), received);
+  }
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "Host" scope.
-/// Topic remapping is enabled.
-TEST(NodeTest, ScopeHostRemap)
+/// \brief A subscriber with a keep last queue skips the stale messages.
+TEST(NodeTest, PubSubSameThreadKeepLast)
 {
-  transport::NodeOptions options;
-  options.AddTopicRemap(g_topic, g_topic_remap);
-  CreatePubSubTwoThreads(options, transport::Scope_t::HOST);
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool release = false;
+  std::vector<int> received;
+
+  std::function<void(const ignition::msgs::Int32 &)> slowCb =
+    [&](const ignition::msgs::Int32 &_msg)
+    {
+      std::unique_lock<std::mutex> lk(mutex);
+      received.push_back(_msg.data());
+      condition.wait(lk, [&]{return release;});
+    };
+
+  transport::SubscribeOptions opts;
+  opts.SetQueueSize(1u);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+  EXPECT_TRUE(node.Subscribe(g_topic, slowCb, opts));
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(0);
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // Wait until the first callback is blocked.
+  for (int i = 0; i < 100; ++i)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      if (!received.empty())
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  for (int i = 1; i <= 5; ++i)
+  {
+    msg.set_data(i);
+    EXPECT_TRUE(pub.Publish(msg));
+  }
+
+  // Let the publish thread queue all the messages.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    release = true;
+  }
+  condition.notify_all();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    ASSERT_EQ(2u, received.size());
+    EXPECT_EQ(0, received[0]);
+    EXPECT_EQ(5, received[1]);
+  }
+  EXPECT_TRUE(node.Unsubscribe(g_topic));
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that two nodes in different threads are able to communicate
-/// advertising a topic with "All" scope.
-/// Topic remapping is enabled.
-TEST(NodeTest, ScopeAllRemap)
+/// \brief A thread can create a node, and send and receive messages.
+TEST(NodeTest, PubSubSameThreadGenericCb)
 {
-  transport::NodeOptions options;
-  options.AddTopicRemap(g_topic, g_topic_remap);
-  CreatePubSubTwoThreads(options, transport::Scope_t::ALL);
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.Subscribe(g_topic, genericCb));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the message was received.
+  EXPECT_TRUE(genericCbExecuted);
+
+  reset();
+
+  // Publish a second message on topic.
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the data was received.
+  EXPECT_TRUE(genericCbExecuted);
+
+  reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Use two different transport nodes on the same thread. Check that
-/// both receive the updates when they are subscribed to the same topic. Check
-/// also that when one of the nodes unsubscribes, no longer receives updates.
-TEST(NodeTest, PubSubOneThreadTwoSubs)
+/// \brief A thread can create a node, and send and receive messages.
+/// This test uses a callback that accepts a parameter with the message
+/// information.
+TEST(NodeTest, PubSubSameThreadMessageInfo)
 {
   reset();
 
   ignition::msgs::Int32 msg;
   msg.set_data(data);
 
-  transport::Node node1;
-  transport::Node node2;
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
 
-  {
-    auto pub1 = node1.Advertise<ignition::msgs::Int32>(g_topic);
-    EXPECT_TRUE(pub1);
+  EXPECT_TRUE(node.Subscribe(g_topic, cbInfo));
 
-    // Subscribe to topic in node1.
-    EXPECT_TRUE(node1.Subscribe(g_topic, cb));
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the message was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+
+  // Publish a second message on topic.
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the data was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+TEST(NodeTest, RawPubSubSameThreadMessageInfo)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.Subscribe(g_topic, cbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the message was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+
+  // Publish a second message on topic.
+  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the data was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+TEST(NodeTest, RawPubRawSubSameThreadMessageInfo)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the message was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+
+  // Publish a second message on topic.
+  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the data was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+TEST(NodeTest, RawPubBufferOverloads)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  const std::string serialized = msg.SerializeAsString();
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish from a byte array.
+  EXPECT_TRUE(pub.PublishRaw(serialized.data(), serialized.size(),
+    msg.GetTypeName()));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+
+  // Publish from a shared buffer, which is released with its own deleter.
+  bool released = false;
+  {
+    std::shared_ptr<const char[]> buffer(new char[serialized.size()],
+      [&released](const char *_p)
+      {
+        released = true;
+        delete[] _p;
+      });
+    memcpy(const_cast<char *>(buffer.get()), serialized.data(),
+      serialized.size());
+    EXPECT_TRUE(pub.PublishRaw(buffer, serialized.size(),
+      msg.GetTypeName()));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(cbExecuted);
+  EXPECT_TRUE(released);
+
+  // The type is checked, and the data can't be missing.
+  EXPECT_FALSE(pub.PublishRaw(serialized.data(), serialized.size(),
+    "ignition.msgs.StringMsg"));
+  EXPECT_FALSE(pub.PublishRaw(nullptr, serialized.size(),
+    msg.GetTypeName()));
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish loans, filled as raw bytes or serialized in place.
+TEST(NodeTest, PubLoan)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  const std::string serialized = msg.SerializeAsString();
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Raw bytes, with the advertised type.
+  auto loan = pub.Loan(serialized.size());
+  ASSERT_TRUE(loan.Valid());
+  EXPECT_EQ(serialized.size(), loan.Capacity());
+  memcpy(loan.Data(), serialized.data(), serialized.size());
+  EXPECT_TRUE(pub.Publish(std::move(loan)));
+  EXPECT_FALSE(loan.Valid());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+
+  // A message serialized in place.
+  loan = pub.Loan(64);
+  ASSERT_TRUE(loan.Serialize(msg));
+  EXPECT_TRUE(pub.Publish(std::move(loan)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(cbExecuted);
+
+  // A loan is published once, and its type is checked.
+  EXPECT_FALSE(pub.Publish(std::move(loan)));
+  loan = pub.Loan(64);
+  ignition::msgs::StringMsg other;
+  ASSERT_TRUE(loan.Serialize(other));
+  EXPECT_FALSE(pub.Publish(std::move(loan)));
+
+  // The loans of an invalid publisher are invalid.
+  transport::Node::Publisher invalid;
+  EXPECT_FALSE(invalid.Loan(64).Valid());
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief A publisher with a real-time queue hands its messages over to a
+/// transport thread, and counts the ones it can't queue.
+TEST(NodeTest, PubRealtime)
+{
+  std::mutex mutex;
+  std::vector<int> received;
+  std::function<void(const ignition::msgs::Int32 &)> cbRealtime =
+    [&mutex, &received](const ignition::msgs::Int32 &_msg)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      received.push_back(_msg.data());
+    };
+
+  transport::Node node;
+  transport::AdvertiseMessageOptions opts;
+  opts.SetRealtimeQueue(64u, 16u);
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic, opts);
+  ASSERT_TRUE(pub);
+  EXPECT_TRUE(node.Subscribe(g_topic, cbRealtime));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  ignition::msgs::Int32 msg;
+  for (int i = 0; i < 10; ++i)
+  {
+    msg.set_data(i);
+    EXPECT_TRUE(pub.Publish(msg));
+  }
+  msg.set_data(10);
+  EXPECT_TRUE(pub.Publish(std::move(msg)));
+  msg.set_data(11);
+  EXPECT_TRUE(pub.PublishRaw(msg.SerializeAsString(), msg.GetTypeName()));
+
+  // Wrong type, and too big for a slot.
+  ignition::msgs::StringMsg other;
+  EXPECT_FALSE(pub.Publish(other));
+  other.set_data(std::string(32, 'a'));
+  EXPECT_FALSE(pub.PublishRaw(other.SerializeAsString(), msg.GetTypeName()));
+
+  for (int i = 0; i < 50; ++i)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      if (received.size() >= 12u)
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    ASSERT_EQ(12u, received.size());
+    for (int i = 0; i < 12; ++i)
+      EXPECT_EQ(i, received[i]);
+  }
+  EXPECT_EQ(0u, pub.DroppedRealtimeMessages());
+  EXPECT_EQ(2u, pub.FailedRealtimeMessages());
+
+  // Publishers without a real-time queue don't count anything.
+  auto regular = node.Advertise<ignition::msgs::Int32>(g_topic_remap);
+  EXPECT_EQ(0u, regular.DroppedRealtimeMessages());
+  EXPECT_EQ(0u, regular.FailedRealtimeMessages());
+}
+
+/// \brief A fixed layout message, published as its bytes.
+struct ImuSample
+{
+  /// \brief The sample time (ns).
+  int64_t stamp;
+
+  /// \brief Angular velocity (rad/s).
+  double angularVelocity[3];
+
+  /// \brief Linear acceleration (m/s^2).
+  double linearAcceleration[3];
+};
+
+namespace ignition
+{
+  namespace transport
+  {
+    /// \brief Serialization of ImuSample.
+    template<>
+    class Serializer<ImuSample> : public TrivialSerializer<ImuSample>
+    {
+      /// \brief Get the name of the type.
+      /// \return The name of the type.
+      public: static std::string TypeName()
+      {
+        return "test.ImuSample";
+      }
+    };
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Publish and subscribe to a type that isn't protobuf.
+TEST(NodeTest, PubSubCustomSerializer)
+{
+  static_assert(transport::IsCustomSerialized<ImuSample>::value, "");
+  static_assert(
+    !transport::IsCustomSerialized<ignition::msgs::Int32>::value, "");
+
+  reset();
+
+  ImuSample sample;
+  sample.stamp = 42;
+  for (int i = 0; i < 3; ++i)
+  {
+    sample.angularVelocity[i] = i;
+    sample.linearAcceleration[i] = -i;
+  }
+
+  transport::Node node;
+  auto pub = node.Advertise<ImuSample>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::function<void(const ImuSample &,
+    const transport::MessageInfo &)> imuCb =
+    [&sample](const ImuSample &_msg, const transport::MessageInfo &_info)
+    {
+      EXPECT_EQ(sample.stamp, _msg.stamp);
+      EXPECT_DOUBLE_EQ(sample.angularVelocity[2], _msg.angularVelocity[2]);
+      EXPECT_DOUBLE_EQ(sample.linearAcceleration[1],
+        _msg.linearAcceleration[1]);
+      EXPECT_EQ("test.ImuSample", _info.Type());
+      cbExecuted = true;
+    };
+  EXPECT_TRUE(node.Subscribe(g_topic, imuCb));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  EXPECT_TRUE(pub.Publish(sample));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(cbExecuted);
+
+  // The protobuf messages of the topic don't match.
+  reset();
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  EXPECT_FALSE(pub.Publish(msg));
+  EXPECT_FALSE(cbExecuted);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+TEST(NodeTest, PubRawSubSameThreadMessageInfo)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.SubscribeRaw(g_topic, rawCbInfo));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the message was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+
+  // Publish a second message on topic.
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Check that the data was received.
+  EXPECT_TRUE(cbExecuted);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscribe to a topic using a lambda function.
+TEST(NodeTest, PubSubSameThreadLambda)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  bool executed = false;
+  std::function<void(const ignition::msgs::Int32&)> subCb =
+    [&executed, &mutex, &condition](const ignition::msgs::Int32 &_msg)
+  {
+    EXPECT_EQ(_msg.data(), data);
+    std::lock_guard<std::mutex> lk(mutex);
+    executed = true;
+    condition.notify_all();
+  };
+
+  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  EXPECT_TRUE(pub.Publish(msg));
+
+  // The local publish is asynchronous, which means we need to wait
+  // for the callback.
+  std::unique_lock<std::mutex> lk(mutex);
+  condition.wait(lk, [&executed]{return executed;});
+
+  EXPECT_TRUE(executed);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscribe to a topic using a lambda function.
+/// This test uses a callback that accepts a parameter with the message
+/// information.
+TEST(NodeTest, PubSubSameThreadLambdaMessageInfo)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node;
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  bool executed = false;
+  std::function<void(const ignition::msgs::Int32&,
+                     const ignition::transport::MessageInfo &)> subCb =
+    [&executed](const ignition::msgs::Int32 &_msg,
+                const ignition::transport::MessageInfo &_info)
+  {
+    EXPECT_EQ(_info.Topic(), g_topic);
+    EXPECT_EQ(_msg.data(), data);
+    EXPECT_EQ(g_FQNPartition, _info.Partition());
+    EXPECT_EQ(_msg.GetTypeName(), _info.Type());
+    EXPECT_TRUE(_info.IntraProcess());
+    std::lock_guard<std::mutex> lk(cbMutex);
+    executed = true;
+    cbCondition.notify_all();
+  };
+
+  EXPECT_TRUE(node.Subscribe(g_topic, subCb));
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Publish a first message.
+  std::unique_lock<std::mutex> lk(cbMutex);
+  EXPECT_TRUE(pub.Publish(msg));
+  cbCondition.wait(lk, [&executed]{return executed;});
+
+  EXPECT_TRUE(executed);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Advertise two topics with the same name. It's not possible to do it
+/// within the same node but it's valid on separate nodes.
+TEST(NodeTest, AdvertiseTwoEqualTopics)
+{
+  transport::Node node1;
+  transport::Node node2;
+
+  auto pub1 = node1.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub1);
+  auto pub2 = node1.Advertise<ignition::msgs::StringMsg>(g_topic);
+  EXPECT_FALSE(pub2);
+  auto pub3 = node2.Advertise<ignition::msgs::StringMsg>(g_topic);
+  EXPECT_TRUE(pub3);
+}
+
+//////////////////////////////////////////////////
+/// \brief Use two threads using their own transport nodes. One thread
+/// will publish a message, whereas the other thread is subscribed to the topic.
+TEST(NodeTest, PubSubTwoThreadsSameTopic)
+{
+  transport::NodeOptions options;
+  CreatePubSubTwoThreads(options);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "Process" scope.
+TEST(NodeTest, ScopeProcess)
+{
+  transport::NodeOptions options;
+  CreatePubSubTwoThreads(options, transport::Scope_t::PROCESS);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "Host" scope.
+TEST(NodeTest, ScopeHost)
+{
+  transport::NodeOptions options;
+  CreatePubSubTwoThreads(options, transport::Scope_t::HOST);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "All" scope.
+TEST(NodeTest, ScopeAll)
+{
+  transport::NodeOptions options;
+  CreatePubSubTwoThreads(options, transport::Scope_t::ALL);
+}
+
+//////////////////////////////////////////////////
+/// \brief Use two threads using their own transport nodes. One thread
+/// will publish a message, whereas the other thread is subscribed to the topic.
+/// Topic remapping is enabled.
+TEST(NodeTest, PubSubTwoThreadsSameTopicRemap)
+{
+  transport::NodeOptions options;
+  options.AddTopicRemap(g_topic, g_topic_remap);
+  CreatePubSubTwoThreads(options);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "Process" scope.
+/// Topic remapping is enabled.
+TEST(NodeTest, ScopeProcessRemap)
+{
+  transport::NodeOptions options;
+  options.AddTopicRemap(g_topic, g_topic_remap);
+  CreatePubSubTwoThreads(options, transport::Scope_t::PROCESS);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "Host" scope.
+/// Topic remapping is enabled.
+TEST(NodeTest, ScopeHostRemap)
+{
+  transport::NodeOptions options;
+  options.AddTopicRemap(g_topic, g_topic_remap);
+  CreatePubSubTwoThreads(options, transport::Scope_t::HOST);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that two nodes in different threads are able to communicate
+/// advertising a topic with "All" scope.
+/// Topic remapping is enabled.
+TEST(NodeTest, ScopeAllRemap)
+{
+  transport::NodeOptions options;
+  options.AddTopicRemap(g_topic, g_topic_remap);
+  CreatePubSubTwoThreads(options, transport::Scope_t::ALL);
+}
+
+//////////////////////////////////////////////////
+/// \brief Use two different transport nodes on the same thread. Check that
+/// both receive the updates when they are subscribed to the same topic. Check
+/// also that when one of the nodes unsubscribes, no longer receives updates.
+TEST(NodeTest, PubSubOneThreadTwoSubs)
+{
+  reset();
+
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+
+  transport::Node node1;
+  transport::Node node2;
+
+  {
+    auto pub1 = node1.Advertise<ignition::msgs::Int32>(g_topic);
+    EXPECT_TRUE(pub1);
+
+    // Subscribe to topic in node1.
+    EXPECT_TRUE(node1.Subscribe(g_topic, cb));
+
+    // Subscribe to topic in node2.
+    EXPECT_TRUE(node2.Subscribe(g_topic, cb2));
+
+    // Wait some time before publishing.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    EXPECT_TRUE(pub1.Publish(msg));
+
+    // Give some time to the subscribers.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Check that the msg was received by node1.
+    EXPECT_TRUE(cbExecuted);
+    // Check that the msg was received by node2.
+    EXPECT_TRUE(cb2Executed);
+
+    auto subscribedTopics = node1.SubscribedTopics();
+    ASSERT_EQ(subscribedTopics.size(), 1u);
+    EXPECT_EQ(subscribedTopics.at(0), g_topic);
+
+    reset();
+
+    // Try to unsubscribe from an invalid topic.
+    EXPECT_FALSE(node1.Unsubscribe("invalid topic"));
+
+    // Node1 is not interested in the topic anymore.
+    EXPECT_TRUE(node1.Unsubscribe(g_topic));
+
+    // Give some time to receive the unsubscription.
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    // Publish a second message.
+    EXPECT_TRUE(pub1.Publish(msg));
+
+    // Give some time to the subscribers.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Check that the msg was not received by node1.
+    EXPECT_FALSE(cbExecuted);
+    // Check that the msg was received by node2.
+    EXPECT_TRUE(cb2Executed);
+
+    ASSERT_TRUE(node1.SubscribedTopics().empty());
+
+    reset();
+  }
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  auto advertisedTopics = node1.AdvertisedTopics();
+  ASSERT_TRUE(advertisedTopics.empty());
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Use the transport inside a class and check advertise, subscribe and
+/// publish.
+TEST(NodeTest, ClassMemberCallbackMessage)
+{
+  MyTestClass client;
+  client.Subscribe();
+
+  // Wait for the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  client.SendSomeData();
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(client.callbackExecuted);
+}
+
+//////////////////////////////////////////////////
+/// \brief Use the transport inside a class and check advertise, subscribe and
+/// publish. This test uses a callback that accepts message information.
+TEST(NodeTest, ClassMemberCallbackMessageInfo)
+{
+  MyTestClass client;
+  client.SubscribeWithMessageInfo();
+
+  // Wait for the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  client.SendSomeData();
+
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(client.callbackExecuted);
+}
+
+//////////////////////////////////////////////////
+/// \brief Make an asynchronous and synchronous service calls using member
+/// function.
+TEST(NodeTest, ClassMemberCallbackService)
+{
+  MyTestClass client;
+  client.TestServiceCall();
+}
+
+//////////////////////////////////////////////////
+/// \brief Make an asynchronous and synchronous service calls without input
+/// using member function.
+TEST(NodeTest, ClassMemberCallbackServiceWithoutInput)
+{
+  MyTestClass client;
+  client.TestServiceCallWithoutInput();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the types advertised and published match.
+TEST(NodeTest, TypeMismatch)
+{
+  reset();
+
+  ignition::msgs::Int32 rightMsg;
+  ignition::msgs::Vector3d wrongMsg;
+  rightMsg.set_data(1);
+  wrongMsg.set_x(1);
+  wrongMsg.set_y(2);
+  wrongMsg.set_z(3);
+
+  transport::Node node;
+
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_FALSE(pub.Publish(wrongMsg));
+  EXPECT_TRUE(pub.Publish(rightMsg));
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Make an asynchronous service call using free function.
+TEST(NodeTest, ServiceCallAsync)
+{
+  reset();
+
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+
+  transport::Node node;
+
+  // Advertise an invalid service name.
+  EXPECT_FALSE(node.Advertise("invalid service", srvEcho));
+
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+
+  auto advertisedServices = node.AdvertisedServices();
+  ASSERT_EQ(advertisedServices.size(), 1u);
+  EXPECT_EQ(advertisedServices.at(0), g_topic);
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", req, response));
+
+  EXPECT_TRUE(node.Request(g_topic, req, response));
+
+  int i = 0;
+  while (i < 100 && !srvExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
+
+  // Make another request.
+  reset();
+
+  EXPECT_TRUE(node.Request(g_topic, req, response));
+
+  i = 0;
+  while (i < 100 && !responseExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
+
+  // Try to unadvertise an invalid service.
+  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+
+  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+
+  ASSERT_TRUE(node.AdvertisedServices().empty());
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Make an asynchronous service call without input using free function.
+TEST(NodeTest, ServiceCallWithoutInputAsync)
+{
+  reset();
+
+  transport::Node node;
+
+  // Advertise an invalid service name.
+  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutInput));
+
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+
+  auto advertisedServices = node.AdvertisedServices();
+  ASSERT_EQ(advertisedServices.size(), 1u);
+  EXPECT_EQ(advertisedServices.at(0), g_topic);
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", response));
+
+  EXPECT_TRUE(node.Request(g_topic, response));
+
+  int i = 0;
+  while (i < 100 && !srvExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
+
+  // Make another request.
+  reset();
+
+  EXPECT_TRUE(node.Request(g_topic, response));
+
+  i = 0;
+  while (i < 100 && !responseExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
+
+  // Try to unadvertise an invalid service.
+  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+
+  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+
+  ASSERT_TRUE(node.AdvertisedServices().empty());
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Make an asynchronous service call without waiting for a response
+/// \using free function.
+TEST(NodeTest, ServiceWithoutOutputCallAsync)
+{
+  reset();
+
+  transport::Node node;
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+
+  // Advertise an invalid service name.
+  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutOutput));
+
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutOutput));
+
+  auto advertisedServices = node.AdvertisedServices();
+  ASSERT_EQ(advertisedServices.size(), 1u);
+  EXPECT_EQ(advertisedServices.at(0), g_topic);
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", req));
+
+  EXPECT_TRUE(node.Request(g_topic, req));
+
+  int i = 0;
+  while (i < 100 && !srvExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call was executed.
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
+
+  // Try to unadvertise an invalid service.
+  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+
+  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+
+  ASSERT_TRUE(node.AdvertisedServices().empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief Make an asynchronous service call using lambdas.
+TEST(NodeTest, ServiceCallAsyncLambda)
+{
+  reset();
+
+  std::function<bool(const ignition::msgs::Int32 &, ignition::msgs::Int32 &)>
+    advCb = [](const ignition::msgs::Int32 &_req, ignition::msgs::Int32 &_rep)
+    -> bool
+  {
+    EXPECT_EQ(_req.data(), data);
+    _rep.set_data(_req.data());
+    return true;
+  };
+
+  transport::Node node;
+  EXPECT_TRUE((node.Advertise<ignition::msgs::Int32,
+        ignition::msgs::Int32>(g_topic, advCb)));
+
+  bool executed = false;
+  std::function<void(const ignition::msgs::Int32 &, const bool)> reqCb =
+    [&executed](const ignition::msgs::Int32 &_rep, const bool _result)
+  {
+    EXPECT_EQ(_rep.data(), data);
+    EXPECT_TRUE(_result);
+    executed = true;
+  };
+
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+
+  EXPECT_TRUE((node.Request(g_topic, req, reqCb)));
+
+  EXPECT_TRUE(executed);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Make an asynchronous service call without input using lambdas.
+TEST(NodeTest, ServiceCallWithoutInputAsyncLambda)
+{
+  reset();
+
+  std::function<bool(ignition::msgs::Int32 &)> advCb =
+    [](ignition::msgs::Int32 &_rep) -> bool
+  {
+    _rep.set_data(data);
+    return true;
+  };
+
+  transport::Node node;
+  EXPECT_TRUE((node.Advertise<ignition::msgs::Int32>(g_topic, advCb)));
+
+  bool executed = false;
+  std::function<void(const ignition::msgs::Int32 &, const bool)> reqCb =
+    [&executed](const ignition::msgs::Int32 &_rep, const bool _result)
+  {
+    EXPECT_EQ(_rep.data(), data);
+    EXPECT_TRUE(_result);
+    executed = true;
+  };
+
+  EXPECT_TRUE((node.Request(g_topic, reqCb)));
+
+  EXPECT_TRUE(executed);
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \Make an asynchronous service call without waiting for response using
+/// \lambdas.
+TEST(NodeTest, ServiceCallWithoutOutputAsyncLambda)
+{
+  bool executed = false;
+
+  std::function<void(const ignition::msgs::Int32 &)> advCb =
+    [&executed](const ignition::msgs::Int32 &_req)
+  {
+    EXPECT_EQ(_req.data(), data);
+    executed = true;
+  };
+
+  transport::Node node;
+  EXPECT_TRUE((node.Advertise<ignition::msgs::Int32>(g_topic, advCb)));
+
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+
+  EXPECT_TRUE(node.Request(g_topic, req));
+  EXPECT_TRUE(executed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Make a batch of service calls without waiting for responses.
+TEST(NodeTest, ServiceCallWithoutOutputBatch)
+{
+  std::vector<int> received;
+
+  std::function<void(const ignition::msgs::Int32 &)> advCb =
+    [&received](const ignition::msgs::Int32 &_req)
+  {
+    received.push_back(_req.data());
+  };
+
+  transport::Node node;
+  EXPECT_TRUE((node.Advertise<ignition::msgs::Int32>(g_topic, advCb)));
+
+  std::vector<ignition::msgs::Int32> reqs(10);
+  for (int i = 0; i < 10; ++i)
+    reqs[i].set_data(i);
+
+  EXPECT_FALSE(node.RequestBatch("invalid service", reqs));
+  EXPECT_TRUE(node.RequestBatch(g_topic, std::vector<ignition::msgs::Int32>()));
+  EXPECT_TRUE(received.empty());
+
+  // The requests are run in order.
+  EXPECT_TRUE(node.RequestBatch(g_topic, reqs));
+  ASSERT_EQ(10u, received.size());
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(i, received[i]);
+}
+
+//////////////////////////////////////////////////
+/// \brief Request multiple service calls at the same time.
+TEST(NodeTest, MultipleServiceCallAsync)
+{
+  reset();
+
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+
+  transport::Node node;
+
+  // Advertise an invalid service name.
+  EXPECT_FALSE(node.Advertise("invalid service", srvEcho));
+
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", req, response));
+
+  EXPECT_TRUE(node.Request(g_topic, req, response));
+
+  int i = 0;
+  while (i < 100 && !srvExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
+
+  // Make another request.
+  reset();
+
+  EXPECT_TRUE(node.Request(g_topic, req, response));
+  EXPECT_TRUE(node.Request(g_topic, req, response));
+  EXPECT_TRUE(node.Request(g_topic, req, response));
+
+  i = 0;
+  while (i < 100 && counter < 3)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 3);
+
+  // Try to unadvertise an invalid service.
+  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+
+  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+
+  reset();
+}
+
+//////////////////////////////////////////////////
+/// \brief Request multiple service calls without input at the same time.
+TEST(NodeTest, MultipleServiceCallWithoutInputAsync)
+{
+  reset();
+
+  transport::Node node;
+
+  // Advertise an invalid service name.
+  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutInput));
+
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", response));
+
+  EXPECT_TRUE(node.Request(g_topic, response));
+
+  int i = 0;
+  while (i < 100 && !srvExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
+
+  // Make another request.
+  reset();
+
+  EXPECT_TRUE(node.Request(g_topic, response));
+  EXPECT_TRUE(node.Request(g_topic, response));
+  EXPECT_TRUE(node.Request(g_topic, response));
+
+  i = 0;
+  while (i < 100 && counter < 3)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
+
+  // Check that the service call response was executed.
+  EXPECT_TRUE(responseExecuted);
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 3);
+
+  // Try to unadvertise an invalid service.
+  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+
+  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+
+  reset();
+}
+
+/// \brief Request multiple service calls without without waiting for a response
+/// \ at the same time.
+TEST(NodeTest, MultipleServiceWithoutOutputCallAsync)
+{
+  reset();
+
+  transport::Node node;
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+
+  // Advertise an invalid service name.
+  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutOutput));
 
-    // Subscribe to topic in node2.
-    EXPECT_TRUE(node2.Subscribe(g_topic, cb2));
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutOutput));
 
-    // Wait some time before publishing.
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", req));
 
-    EXPECT_TRUE(pub1.Publish(msg));
+  EXPECT_TRUE(node.Request(g_topic, req));
 
-    // Give some time to the subscribers.
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  int i = 0;
+  while (i < 100 && !srvExecuted)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
 
-    // Check that the msg was received by node1.
-    EXPECT_TRUE(cbExecuted);
-    // Check that the msg was received by node2.
-    EXPECT_TRUE(cb2Executed);
+  // Check that the service call was executed.
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 1);
 
-    auto subscribedTopics = node1.SubscribedTopics();
-    ASSERT_EQ(subscribedTopics.size(), 1u);
-    EXPECT_EQ(subscribedTopics.at(0), g_topic);
+  // Make another request.
+  reset();
+  EXPECT_TRUE(node.Request(g_topic, req));
+  EXPECT_TRUE(node.Request(g_topic, req));
+  EXPECT_TRUE(node.Request(g_topic, req));
 
-    reset();
+  i = 0;
+  while (i < 100 && counter < 3)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++i;
+  }
 
-    // Try to unsubscribe from an invalid topic.
-    EXPECT_FALSE(node1.Unsubscribe("invalid topic"));
+  // Check that the service call was executed.
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_EQ(counter, 3);
 
-    // Node1 is not interested in the topic anymore.
-    EXPECT_TRUE(node1.Unsubscribe(g_topic));
+  // Try to unadvertise an invalid service.
+  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
 
-    // Give some time to receive the unsubscription.
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+}
 
-    // Publish a second message.
-    EXPECT_TRUE(pub1.Publish(msg));
+//////////////////////////////////////////////////
+/// \brief Make a synchronous service call.
+TEST(NodeTest, ServiceCallSync)
+{
+  reset();
 
-    // Give some time to the subscribers.
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ignition::msgs::Int32 req;
+  ignition::msgs::Int32 rep;
+  bool result;
+  unsigned int timeout = 1000;
 
-    // Check that the msg was not received by node1.
-    EXPECT_FALSE(cbExecuted);
-    // Check that the msg was received by node2.
-    EXPECT_TRUE(cb2Executed);
+  req.set_data(data);
 
-    ASSERT_TRUE(node1.SubscribedTopics().empty());
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
 
-    reset();
-  }
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", req, timeout, rep, result));
 
-  // Give some time to the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(node.Request(g_topic, req, timeout, rep, result));
 
-  auto advertisedTopics = node1.AdvertisedTopics();
-  ASSERT_TRUE(advertisedTopics.empty());
+  // Check that the service call response was executed.
+  EXPECT_TRUE(result);
+  EXPECT_EQ(rep.data(), req.data());
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Use the transport inside a class and check advertise, subscribe and
-/// publish.
-TEST(NodeTest, ClassMemberCallbackMessage)
+/// \brief Check that synchronous calls to a replier of the same process can
+/// run concurrently.
+TEST(NodeTest, ServiceCallSyncConcurrentLocal)
 {
-  MyTestClass client;
-  client.Subscribe();
+  reset();
 
-  // Wait for the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  // Each call waits until the other one is running too.
+  std::mutex m;
+  std::condition_variable cv;
+  int running = 0;
+  std::function<bool(const ignition::msgs::Int32 &, ignition::msgs::Int32 &)>
+    cb = [&](const ignition::msgs::Int32 &_req, ignition::msgs::Int32 &_rep)
+    {
+      std::unique_lock<std::mutex> lk(m);
+      ++running;
+      cv.notify_all();
+      bool both = cv.wait_for(lk, std::chrono::milliseconds(2000),
+        [&running]{return running >= 2;});
+      _rep.set_data(_req.data());
+      return both;
+    };
 
-  client.SendSomeData();
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, cb));
 
-  // Give some time to the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  EXPECT_TRUE(client.callbackExecuted);
+  auto call = [&node]()
+  {
+    ignition::msgs::Int32 req;
+    ignition::msgs::Int32 rep;
+    bool result = false;
+    req.set_data(data);
+    EXPECT_TRUE(node.Request(g_topic, req, 3000, rep, result));
+    EXPECT_TRUE(result);
+    EXPECT_EQ(rep.data(), data);
+  };
+
+  std::thread t1(call);
+  std::thread t2(call);
+  t1.join();
+  t2.join();
+
+  reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Use the transport inside a class and check advertise, subscribe and
-/// publish. This test uses a callback that accepts message information.
-TEST(NodeTest, ClassMemberCallbackMessageInfo)
+/// \brief Make several service calls returning futures.
+TEST(NodeTest, ServiceCallFuture)
 {
-  MyTestClass client;
-  client.SubscribeWithMessageInfo();
+  reset();
 
-  // Wait for the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
 
-  client.SendSomeData();
+  ignition::msgs::Int32 req;
+  req.set_data(data);
 
-  // Give some time to the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  EXPECT_TRUE(client.callbackExecuted);
-}
+  // Request an invalid service name.
+  auto invalid = node.RequestFuture<ignition::msgs::Int32,
+    ignition::msgs::Int32>("invalid service", req);
+  EXPECT_FALSE(invalid.valid());
 
-//////////////////////////////////////////////////
-/// \brief Make an asynchronous and synchronous service calls using member
-/// function.
-TEST(NodeTest, ClassMemberCallbackService)
-{
-  MyTestClass client;
-  client.TestServiceCall();
-}
+  std::vector<std::future<std::optional<ignition::msgs::Int32>>> futures;
+  for (int i = 0; i < 5; ++i)
+  {
+    futures.push_back(node.RequestFuture<ignition::msgs::Int32,
+      ignition::msgs::Int32>(g_topic, req));
+  }
 
-//////////////////////////////////////////////////
-/// \brief Make an asynchronous and synchronous service calls without input
-/// using member function.
-TEST(NodeTest, ClassMemberCallbackServiceWithoutInput)
-{
-  MyTestClass client;
-  client.TestServiceCallWithoutInput();
+  for (auto &future : futures)
+  {
+    ASSERT_TRUE(future.valid());
+    ASSERT_EQ(std::future_status::ready,
+      future.wait_for(std::chrono::milliseconds(1000)));
+    auto rep = future.get();
+    ASSERT_TRUE(rep.has_value());
+    EXPECT_EQ(rep->data(), data);
+  }
+
+  EXPECT_TRUE(srvExecuted);
+
+  reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that the types advertised and published match.
-TEST(NodeTest, TypeMismatch)
+/// \brief Request a stream of responses from a streaming replier.
+TEST(NodeTest, ServiceCallStream)
 {
   reset();
 
-  ignition::msgs::Int32 rightMsg;
-  ignition::msgs::Vector3d wrongMsg;
-  rightMsg.set_data(1);
-  wrongMsg.set_x(1);
-  wrongMsg.set_y(2);
-  wrongMsg.set_z(3);
+  std::function<void(const ignition::msgs::Int32 &,
+    const transport::ServiceStream<ignition::msgs::Int32> &)> cb =
+    [](const ignition::msgs::Int32 &_req,
+      const transport::ServiceStream<ignition::msgs::Int32> &_stream)
+    {
+      srvExecuted = true;
+      ignition::msgs::Int32 rep;
+      for (int i = 0; i < _req.data(); ++i)
+      {
+        rep.set_data(i);
+        if (!_stream.Write(rep))
+          return;
+      }
+      _stream.Close();
+    };
 
   transport::Node node;
+  EXPECT_TRUE(node.AdvertiseStream(g_topic, cb));
 
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub);
+  ignition::msgs::Int32 req;
+  req.set_data(100);
+
+  std::mutex m;
+  std::condition_variable cv;
+  std::vector<int> replies;
+  bool done = false;
+  bool result = false;
+  EXPECT_TRUE((node.RequestStream<ignition::msgs::Int32,
+    ignition::msgs::Int32>(g_topic, req,
+    [&](const ignition::msgs::Int32 &_rep)
+    {
+      std::lock_guard<std::mutex> lk(m);
+      replies.push_back(_rep.data());
+    },
+    [&](const bool _result)
+    {
+      std::lock_guard<std::mutex> lk(m);
+      done = true;
+      result = _result;
+      cv.notify_all();
+    })));
 
-  EXPECT_FALSE(pub.Publish(wrongMsg));
-  EXPECT_TRUE(pub.Publish(rightMsg));
+  {
+    std::unique_lock<std::mutex> lk(m);
+    ASSERT_TRUE(cv.wait_for(lk, std::chrono::milliseconds(5000),
+      [&done] { return done; }));
+    EXPECT_TRUE(result);
+    ASSERT_EQ(100u, replies.size());
+    for (int i = 0; i < 100; ++i)
+      EXPECT_EQ(i, replies[i]);
+  }
+  EXPECT_TRUE(srvExecuted);
+
+  // A regular request only receives the first response.
+  ignition::msgs::Int32 rep;
+  bool callResult = false;
+  EXPECT_TRUE(node.Request(g_topic, req, 1000, rep, callResult));
+  EXPECT_TRUE(callResult);
+  EXPECT_EQ(0, rep.data());
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Make an asynchronous service call using free function.
-TEST(NodeTest, ServiceCallAsync)
+/// \brief Make a synchronous service call to a replier that completes the
+/// calls asynchronously.
+TEST(NodeTest, ServiceCallSyncAsyncReplier)
 {
   reset();
 
   ignition::msgs::Int32 req;
+  ignition::msgs::Int32 rep;
+  bool result;
+  unsigned int timeout = 1000;
+
   req.set_data(data);
 
+  std::vector<std::thread> workers;
+  std::function<void(const ignition::msgs::Int32 &,
+    const transport::ServiceCompletion<ignition::msgs::Int32> &)> cb =
+    [&workers](const ignition::msgs::Int32 &_req,
+      const transport::ServiceCompletion<ignition::msgs::Int32> &_completion)
+    {
+      srvExecuted = true;
+
+      // Complete the call from another thread, after the callback returns.
+      workers.emplace_back([_req, _completion]()
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ignition::msgs::Int32 response;
+        response.set_data(_req.data());
+        EXPECT_TRUE(_completion.Complete(response));
+        EXPECT_FALSE(_completion.Complete(response));
+      });
+    };
+
+  // This replier drops the handle without completing the call.
+  std::function<void(const ignition::msgs::Int32 &,
+    const transport::ServiceCompletion<ignition::msgs::Int32> &)> dropCb =
+    [](const ignition::msgs::Int32 &,
+      const transport::ServiceCompletion<ignition::msgs::Int32> &_completion)
+    {
+      EXPECT_TRUE(_completion.Valid());
+      EXPECT_FALSE(_completion.Completed());
+    };
+
   transport::Node node;
+  EXPECT_TRUE(node.AdvertiseAsync(g_topic, cb));
+  EXPECT_TRUE(node.AdvertiseAsync(g_topic + "_drop", dropCb));
 
-  // Advertise an invalid service name.
-  EXPECT_FALSE(node.Advertise("invalid service", srvEcho));
+  EXPECT_TRUE(node.Request(g_topic, req, timeout, rep, result));
+  EXPECT_TRUE(srvExecuted);
+  EXPECT_TRUE(result);
+  EXPECT_EQ(rep.data(), req.data());
 
-  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+  EXPECT_TRUE(node.Request(g_topic + "_drop", req, timeout, rep, result));
+  EXPECT_FALSE(result);
 
-  auto advertisedServices = node.AdvertisedServices();
-  ASSERT_EQ(advertisedServices.size(), 1u);
-  EXPECT_EQ(advertisedServices.at(0), g_topic);
+  for (auto &worker : workers)
+    worker.join();
 
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", req, response));
+  reset();
+}
 
-  EXPECT_TRUE(node.Request(g_topic, req, response));
+//////////////////////////////////////////////////
+/// \brief Make a synchronous service call without input.
+TEST(NodeTest, ServiceCallWithoutInputSync)
+{
+  reset();
 
-  int i = 0;
-  while (i < 100 && !srvExecuted)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+  ignition::msgs::Int32 rep;
+  bool result;
+  unsigned int timeout = 1000;
+
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+
+  // Request an invalid service name.
+  EXPECT_FALSE(node.Request("invalid service", timeout, rep, result));
+
+  EXPECT_TRUE(node.Request(g_topic, timeout, rep, result));
 
   // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
+  EXPECT_TRUE(result);
+  EXPECT_EQ(rep.data(), data);
 
-  // Make another request.
   reset();
+}
 
-  EXPECT_TRUE(node.Request(g_topic, req, response));
+//////////////////////////////////////////////////
+/// \brief Check a timeout in a synchronous service call.
+TEST(NodeTest, ServiceCallSyncTimeout)
+{
+  reset();
 
-  i = 0;
-  while (i < 100 && !responseExecuted)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+  ignition::msgs::Int32 req;
+  ignition::msgs::Int32 rep;
+  bool result;
+  int64_t timeout = 1000;
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
+  req.set_data(data);
 
-  // Try to unadvertise an invalid service.
-  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+  transport::Node node;
+
+  auto t1 = std::chrono::steady_clock::now();
+  bool executed = node.Request(g_topic, req, static_cast<unsigned int>(timeout),
+      rep, result);
+  auto t2 = std::chrono::steady_clock::now();
+
+  int64_t elapsed =
+    std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
 
-  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+  // Check if the elapsed time was close to the timeout.
+  auto diff = std::max(elapsed, timeout) - std::min(elapsed, timeout);
+  EXPECT_LE(diff, 200);
 
-  ASSERT_TRUE(node.AdvertisedServices().empty());
+  // Check that the service call response was not executed.
+  EXPECT_FALSE(executed);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Make an asynchronous service call without input using free function.
-TEST(NodeTest, ServiceCallWithoutInputAsync)
+/// \brief Check a timeout in a synchronous service call without input.
+TEST(NodeTest, ServiceCallWithoutInputSyncTimeout)
 {
   reset();
 
-  transport::Node node;
-
-  // Advertise an invalid service name.
-  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutInput));
+  ignition::msgs::Int32 rep;
+  bool result;
+  int64_t timeout = 1000;
 
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+  transport::Node node;
 
-  auto advertisedServices = node.AdvertisedServices();
-  ASSERT_EQ(advertisedServices.size(), 1u);
-  EXPECT_EQ(advertisedServices.at(0), g_topic);
+  auto t1 = std::chrono::steady_clock::now();
+  bool executed = node.Request(g_topic, static_cast<unsigned int>(timeout),
+      rep, result);
+  auto t2 = std::chrono::steady_clock::now();
 
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", response));
+  int64_t elapsed =
+    std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
 
-  EXPECT_TRUE(node.Request(g_topic, response));
+  // Check if the elapsed time was close to the timeout.
+  auto diff = std::max(elapsed, timeout) - std::min(elapsed, timeout);
+  EXPECT_LE(diff, 200);
 
-  int i = 0;
-  while (i < 100 && !srvExecuted)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+  // Check that the service call response was not executed.
+  EXPECT_FALSE(executed);
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
+  reset();
+}
 
-  // Make another request.
+//////////////////////////////////////////////////
+/// \brief Create a publisher that sends messages "forever". This function will
+/// be used emiting a SIGINT or SIGTERM signal, to make sure that the transport
+/// library captures the signals, stop all the tasks and signal the event with
+/// the method Interrupted().
+void createInfinitePublisher()
+{
   reset();
 
-  EXPECT_TRUE(node.Request(g_topic, response));
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  transport::Node node;
 
-  i = 0;
-  while (i < 100 && !responseExecuted)
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
+
+  auto i = 0;
+  bool exitLoop = false;
+  while (!exitLoop)
   {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_TRUE(pub.Publish(msg));
     ++i;
-  }
-
-  // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
-
-  // Try to unadvertise an invalid service.
-  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
-  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+    {
+      std::lock_guard<std::mutex> lock(exitMutex);
+      if (terminatePub)
+        exitLoop = true;
+    }
+  }
 
-  ASSERT_TRUE(node.AdvertisedServices().empty());
+  EXPECT_LT(i, 200);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Make an asynchronous service call without waiting for a response
-/// \using free function.
-TEST(NodeTest, ServiceWithoutOutputCallAsync)
+/// \brief Capture SIGINT and SIGTERM and flag that we want to exit.
+void signal_handler(int _signal)
 {
-  reset();
-
-  transport::Node node;
-  ignition::msgs::Int32 req;
-  req.set_data(data);
+  std::lock_guard<std::mutex> lock(exitMutex);
+  if (_signal == SIGINT || _signal == SIGTERM)
+    terminatePub = true;
+}
 
-  // Advertise an invalid service name.
-  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutOutput));
+//////////////////////////////////////////////////
+/// \brief Check that an external program can capture a SIGINT and terminate
+/// the program without problems.
+TEST(NodeTest, SigIntTermination)
+{
+  reset();
 
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutOutput));
+  // Install a signal handler for SIGINT.
+  std::signal(SIGINT, signal_handler);
 
-  auto advertisedServices = node.AdvertisedServices();
-  ASSERT_EQ(advertisedServices.size(), 1u);
-  EXPECT_EQ(advertisedServices.at(0), g_topic);
+  auto thread = std::thread(createInfinitePublisher);
 
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", req));
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  std::raise(SIGINT);
 
-  EXPECT_TRUE(node.Request(g_topic, req));
+  if (thread.joinable())
+    thread.join();
+}
 
-  int i = 0;
-  while (i < 100 && !srvExecuted)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+//////////////////////////////////////////////////
+/// \brief Check that an external program can capture a SIGTERM and terminate
+/// the program without problems.
+TEST(NodeTest, SigTermTermination)
+{
+  reset();
 
-  // Check that the service call was executed.
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
+  // Install a signal handler for SIGTERM.
+  std::signal(SIGTERM, signal_handler);
 
-  // Try to unadvertise an invalid service.
-  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+  auto thread = std::thread(createInfinitePublisher);
 
-  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  std::raise(SIGTERM);
 
-  ASSERT_TRUE(node.AdvertisedServices().empty());
+  if (thread.joinable())
+    thread.join();
 }
 
 //////////////////////////////////////////////////
-/// \brief Make an asynchronous service call using lambdas.
-TEST(NodeTest, ServiceCallAsyncLambda)
+/// \brief Check that a message is not published if the type does not match
+/// the type advertised.
+TEST(NodeTest, PubSubWrongTypesOnPublish)
 {
   reset();
 
-  std::function<bool(const ignition::msgs::Int32 &, ignition::msgs::Int32 &)>
-    advCb = [](const ignition::msgs::Int32 &_req, ignition::msgs::Int32 &_rep)
-    -> bool
-  {
-    EXPECT_EQ(_req.data(), data);
-    _rep.set_data(_req.data());
-    return true;
-  };
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  ignition::msgs::Vector3d msgV;
+  msgV.set_x(1);
+  msgV.set_y(2);
+  msgV.set_z(3);
 
   transport::Node node;
-  EXPECT_TRUE((node.Advertise<ignition::msgs::Int32,
-        ignition::msgs::Int32>(g_topic, advCb)));
 
-  bool executed = false;
-  std::function<void(const ignition::msgs::Int32 &, const bool)> reqCb =
-    [&executed](const ignition::msgs::Int32 &_rep, const bool _result)
-  {
-    EXPECT_EQ(_rep.data(), data);
-    EXPECT_TRUE(_result);
-    executed = true;
-  };
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
 
-  ignition::msgs::Int32 req;
-  req.set_data(data);
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
 
-  EXPECT_TRUE((node.Request(g_topic, req, reqCb)));
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  EXPECT_TRUE(executed);
+  // Send a message with a wrong type.
+  EXPECT_FALSE(pub.Publish(msgV));
 
-  reset();
-}
+  // Check that the message was not received.
+  EXPECT_FALSE(cbExecuted);
 
-//////////////////////////////////////////////////
-/// \brief Make an asynchronous service call without input using lambdas.
-TEST(NodeTest, ServiceCallWithoutInputAsyncLambda)
-{
   reset();
 
-  std::function<bool(ignition::msgs::Int32 &)> advCb =
-    [](ignition::msgs::Int32 &_rep) -> bool
-  {
-    _rep.set_data(data);
-    return true;
-  };
-
-  transport::Node node;
-  EXPECT_TRUE((node.Advertise<ignition::msgs::Int32>(g_topic, advCb)));
-
-  bool executed = false;
-  std::function<void(const ignition::msgs::Int32 &, const bool)> reqCb =
-    [&executed](const ignition::msgs::Int32 &_rep, const bool _result)
-  {
-    EXPECT_EQ(_rep.data(), data);
-    EXPECT_TRUE(_result);
-    executed = true;
-  };
+  // Publish a second message on topic.
+  EXPECT_TRUE(pub.Publish(msg));
 
-  EXPECT_TRUE((node.Request(g_topic, reqCb)));
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  EXPECT_TRUE(executed);
+  // Check that the data was received.
+  EXPECT_TRUE(cbExecuted);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \Make an asynchronous service call without waiting for response using
-/// \lambdas.
-TEST(NodeTest, ServiceCallWithoutOutputAsyncLambda)
+/// \brief Check that a message is not received if the callback does not use
+/// the advertised types.
+TEST(NodeTest, PubSubWrongTypesOnSubscription)
 {
-  bool executed = false;
+  reset();
 
-  std::function<void(const ignition::msgs::Int32 &)> advCb =
-    [&executed](const ignition::msgs::Int32 &_req)
-  {
-    EXPECT_EQ(_req.data(), data);
-    executed = true;
-  };
+  ignition::msgs::Vector3d msgV;
+  msgV.set_x(1);
+  msgV.set_y(2);
+  msgV.set_z(3);
+
+  transport::Node node;
+
+  auto pub = node.Advertise<ignition::msgs::Vector3d>(g_topic);
+  EXPECT_TRUE(pub);
+
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  transport::Node node;
-  EXPECT_TRUE((node.Advertise<ignition::msgs::Int32>(g_topic, advCb)));
+  // Send a message with a wrong type.
+  EXPECT_TRUE(pub.Publish(msgV));
 
-  ignition::msgs::Int32 req;
-  req.set_data(data);
+  // Check that the message was not received.
+  EXPECT_FALSE(cbExecuted);
 
-  EXPECT_TRUE(node.Request(g_topic, req));
-  EXPECT_TRUE(executed);
+  reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Request multiple service calls at the same time.
-TEST(NodeTest, MultipleServiceCallAsync)
+/// \brief This test spawns two subscribers on the same topic. One of the
+/// subscribers has a wrong callback (types in the callback does not match the
+/// advertised type). Check that only the good callback is executed.
+TEST(NodeTest, PubSubWrongTypesTwoSubscribers)
 {
   reset();
 
-  ignition::msgs::Int32 req;
-  req.set_data(data);
-
-  transport::Node node;
-
-  // Advertise an invalid service name.
-  EXPECT_FALSE(node.Advertise("invalid service", srvEcho));
-
-  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
-
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", req, response));
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
 
-  EXPECT_TRUE(node.Request(g_topic, req, response));
+  transport::Node node1;
+  transport::Node node2;
 
-  int i = 0;
-  while (i < 100 && !srvExecuted)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+  auto pub1 = node1.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub1);
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
+  // Good subscriber.
+  EXPECT_TRUE(node1.Subscribe(g_topic, cb));
 
-  // Make another request.
-  reset();
+  // Bad subscriber: cbVector does not match the types advertised by node1.
+  EXPECT_TRUE(node2.Subscribe(g_topic, cbVector));
 
-  EXPECT_TRUE(node.Request(g_topic, req, response));
-  EXPECT_TRUE(node.Request(g_topic, req, response));
-  EXPECT_TRUE(node.Request(g_topic, req, response));
+  // Wait some time before publishing.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  i = 0;
-  while (i < 100 && counter < 3)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+  EXPECT_TRUE(pub1.Publish(msg));
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 3);
+  // Give some time to the subscribers.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  // Try to unadvertise an invalid service.
-  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+  // Check that the message was received by node1.
+  EXPECT_TRUE(cbExecuted);
 
-  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+  // Check that the message was not received by node2.
+  EXPECT_FALSE(cbVectorExecuted);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Request multiple service calls without input at the same time.
-TEST(NodeTest, MultipleServiceCallWithoutInputAsync)
+/// \brief This test creates one publisher and one subscriber. The publisher
+/// publishes at higher frequency than the rate set by the subscriber.
+TEST(NodeTest, SubThrottled)
 {
   reset();
 
-  transport::Node node;
-
-  // Advertise an invalid service name.
-  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutInput));
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
 
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+  transport::Node node;
 
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", response));
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  EXPECT_TRUE(pub);
 
-  EXPECT_TRUE(node.Request(g_topic, response));
+  ignition::transport::SubscribeOptions opts;
+  opts.SetMsgsPerSec(1u);
+  EXPECT_TRUE(node.Subscribe(g_topic, cb, opts));
 
-  int i = 0;
-  while (i < 100 && !srvExecuted)
+  for (auto i = 0; i < 3; ++i)
   {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
-
-  // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
-
-  // Make another request.
-  reset();
-
-  EXPECT_TRUE(node.Request(g_topic, response));
-  EXPECT_TRUE(node.Request(g_topic, response));
-  EXPECT_TRUE(node.Request(g_topic, response));
+    // Should always be true, because this is unthrottled.
+    EXPECT_TRUE(pub.ThrottledUpdateReady());
+    EXPECT_TRUE(pub.Publish(msg));
 
-  i = 0;
-  while (i < 100 && counter < 3)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
+    // Rate: 10 msgs/sec.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(responseExecuted);
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 3);
-
-  // Try to unadvertise an invalid service.
-  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
-
-  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+  // Node published 3 messages in ~0.3 sec. We should only receive 1 message.
+  EXPECT_EQ(1, counter);
 
   reset();
 }
 
-/// \brief Request multiple service calls without without waiting for a response
-/// \ at the same time.
-TEST(NodeTest, MultipleServiceWithoutOutputCallAsync)
+//////////////////////////////////////////////////
+/// \brief This test creates one publisher and one subscriber. The publisher
+/// publishes at a throttled frequency .
+TEST(NodeTest, PubThrottled)
 {
   reset();
 
-  transport::Node node;
-  ignition::msgs::Int32 req;
-  req.set_data(data);
-
-  // Advertise an invalid service name.
-  EXPECT_FALSE(node.Advertise("invalid service", srvWithoutOutput));
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
 
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutOutput));
+  transport::Node node;
 
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", req));
+  ignition::transport::AdvertiseMessageOptions opts;
+  opts.SetMsgsPerSec(1u);
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic, opts);
+  EXPECT_TRUE(pub);
 
-  EXPECT_TRUE(node.Request(g_topic, req));
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
 
-  int i = 0;
-  while (i < 100 && !srvExecuted)
+  // Should be true the first time
+  EXPECT_TRUE(pub.ThrottledUpdateReady());
+  for (auto i = 0; i < 3; ++i)
   {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
+    EXPECT_TRUE(pub.Publish(msg));
+    // False afterwards, because targeting 1 msg/second.
+    EXPECT_FALSE(pub.ThrottledUpdateReady());
+
+    // Rate: 10 msgs/sec.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
 
-  // Check that the service call was executed.
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 1);
+  // Node published 3 messages in ~0.3 sec. We should only receive 1 message.
+  EXPECT_EQ(1, counter);
 
-  // Make another request.
   reset();
-  EXPECT_TRUE(node.Request(g_topic, req));
-  EXPECT_TRUE(node.Request(g_topic, req));
-  EXPECT_TRUE(node.Request(g_topic, req));
+}
 
-  i = 0;
-  while (i < 100 && counter < 3)
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    ++i;
-  }
+//////////////////////////////////////////////////
+/// \brief This test spawns a service responser and a service requester. The
+/// requester uses a wrong type for the request argument. The test should verify
+/// that the service call does not succeed.
+TEST(NodeTest, SrvRequestWrongReq)
+{
+  reset();
 
-  // Check that the service call was executed.
-  EXPECT_TRUE(srvExecuted);
-  EXPECT_EQ(counter, 3);
+  ignition::msgs::Vector3d wrongReq;
+  ignition::msgs::Int32 rep;
+  bool result;
+  unsigned int timeout = 1000;
 
-  // Try to unadvertise an invalid service.
-  EXPECT_FALSE(node.UnadvertiseSrv("invalid service"));
+  wrongReq.set_x(1);
+  wrongReq.set_y(2);
+  wrongReq.set_z(3);
 
-  EXPECT_TRUE(node.UnadvertiseSrv(g_topic));
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+
+  // Request an asynchronous service call with wrong type in the request.
+  EXPECT_TRUE(node.Request(g_topic, wrongReq, response));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_FALSE(responseExecuted);
+
+  // Request a synchronous service call with wrong type in the request.
+  EXPECT_FALSE(node.Request(g_topic, wrongReq, timeout, rep, result));
+
+  reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Make a synchronous service call.
-TEST(NodeTest, ServiceCallSync)
+/// \brief This test spawns a service responser and a service requester. The
+/// requester uses a wrong type for the response argument. The test should
+/// verify that the service call does not succeed.
+TEST(NodeTest, SrvRequestWrongRep)
 {
   reset();
 
   ignition::msgs::Int32 req;
-  ignition::msgs::Int32 rep;
+  ignition::msgs::Vector3d wrongRep;
   bool result;
   unsigned int timeout = 1000;
 
@@ -1611,695 +3279,1135 @@ TEST(NodeTest, ServiceCallSync)
   transport::Node node;
   EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
 
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", req, timeout, rep, result));
-
-  EXPECT_TRUE(node.Request(g_topic, req, timeout, rep, result));
+  // Request an asynchronous service call with wrong type in the response.
+  EXPECT_TRUE(node.Request(g_topic, req, wrongResponse));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_FALSE(wrongResponseExecuted);
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(result);
-  EXPECT_EQ(rep.data(), req.data());
+  // Request a synchronous service call with wrong type in the response.
+  EXPECT_FALSE(node.Request(g_topic, req, timeout, wrongRep, result));
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Make a synchronous service call without input.
-TEST(NodeTest, ServiceCallWithoutInputSync)
+/// \brief This test spawns a service that doesn't accept input parameters. The
+/// service requester uses a wrong type for the response argument. The test
+/// should verify that the service call does not succeed.
+TEST(NodeTest, SrvWithoutInputRequestWrongRep)
 {
   reset();
 
-  ignition::msgs::Int32 rep;
+  ignition::msgs::Vector3d wrongRep;
   bool result;
   unsigned int timeout = 1000;
 
   transport::Node node;
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
-
-  // Request an invalid service name.
-  EXPECT_FALSE(node.Request("invalid service", timeout, rep, result));
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
 
-  EXPECT_TRUE(node.Request(g_topic, timeout, rep, result));
+  // Request an asynchronous service call with wrong type in the response.
+  EXPECT_TRUE(node.Request(g_topic, wrongResponse));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_FALSE(wrongResponseExecuted);
 
-  // Check that the service call response was executed.
-  EXPECT_TRUE(result);
-  EXPECT_EQ(rep.data(), data);
+  // Request a synchronous service call with wrong type in the response.
+  EXPECT_FALSE(node.Request(g_topic, timeout, wrongRep, result));
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Check a timeout in a synchronous service call.
-TEST(NodeTest, ServiceCallSyncTimeout)
+/// \brief This test spawns a service responser and two service requesters. The
+/// service requesters use incorrect types in some of the requests. The test
+/// should verify that a response is received only when the appropriate types
+/// are used.
+TEST(NodeTest, SrvTwoRequestsOneWrong)
 {
   reset();
 
   ignition::msgs::Int32 req;
-  ignition::msgs::Int32 rep;
+  ignition::msgs::Int32 goodRep;
+  ignition::msgs::Vector3d badRep;
   bool result;
-  int64_t timeout = 1000;
+  unsigned int timeout = 1000;
 
   req.set_data(data);
 
   transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
 
-  auto t1 = std::chrono::steady_clock::now();
-  bool executed = node.Request(g_topic, req, static_cast<unsigned int>(timeout),
-      rep, result);
-  auto t2 = std::chrono::steady_clock::now();
-
-  int64_t elapsed =
-    std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-
-  // Check if the elapsed time was close to the timeout.
-  auto diff = std::max(elapsed, timeout) - std::min(elapsed, timeout);
-  EXPECT_LE(diff, 200);
+  // Request service calls with wrong types in the response.
+  EXPECT_FALSE(node.Request(g_topic, req, timeout, badRep, result));
+  EXPECT_TRUE(node.Request(g_topic, req, wrongResponse));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_FALSE(wrongResponseExecuted);
 
-  // Check that the service call response was not executed.
-  EXPECT_FALSE(executed);
+  // Valid service requests.
+  EXPECT_TRUE(node.Request(g_topic, req, timeout, goodRep, result));
+  EXPECT_TRUE(node.Request(g_topic, req, response));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_TRUE(responseExecuted);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Check a timeout in a synchronous service call without input.
-TEST(NodeTest, ServiceCallWithoutInputSyncTimeout)
+/// \brief This test spawns a service that doesn't accept input parameters. The
+/// service requesters use incorrect types in some of the requests. The test
+/// should verify that a response is received only when the appropriate types
+/// are used.
+TEST(NodeTest, SrvWithoutInputTwoRequestsOneWrong)
 {
   reset();
 
-  ignition::msgs::Int32 rep;
+  ignition::msgs::Int32 goodRep;
+  ignition::msgs::Vector3d badRep;
   bool result;
-  int64_t timeout = 1000;
+  unsigned int timeout = 1000;
 
   transport::Node node;
+  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
 
-  auto t1 = std::chrono::steady_clock::now();
-  bool executed = node.Request(g_topic, static_cast<unsigned int>(timeout),
-      rep, result);
-  auto t2 = std::chrono::steady_clock::now();
-
-  int64_t elapsed =
-    std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-
-  // Check if the elapsed time was close to the timeout.
-  auto diff = std::max(elapsed, timeout) - std::min(elapsed, timeout);
-  EXPECT_LE(diff, 200);
+  // Request service calls with wrong types in the response.
+  EXPECT_FALSE(node.Request(g_topic, timeout, badRep, result));
+  EXPECT_TRUE(node.Request(g_topic, wrongResponse));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_FALSE(wrongResponseExecuted);
 
-  // Check that the service call response was not executed.
-  EXPECT_FALSE(executed);
+  // Valid service requests.
+  EXPECT_TRUE(node.Request(g_topic, timeout, goodRep, result));
+  EXPECT_TRUE(node.Request(g_topic, response));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_TRUE(responseExecuted);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief Create a publisher that sends messages "forever". This function will
-/// be used emiting a SIGINT or SIGTERM signal, to make sure that the transport
-/// library captures the signals, stop all the tasks and signal the event with
-/// the method Interrupted().
-void createInfinitePublisher()
+/// \brief This test creates two nodes and advertises some topics. The test
+/// verifies that TopicList() returns the list of all the topics advertised.
+TEST(NodeTest, TopicList)
 {
-  reset();
-
-  ignition::msgs::Int32 msg;
-  msg.set_data(data);
-  transport::Node node;
-
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub);
-
-  auto i = 0;
-  bool exitLoop = false;
-  while (!exitLoop)
-  {
-    EXPECT_TRUE(pub.Publish(msg));
-    ++i;
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::vector<std::string> topics;
+  transport::Node node1;
+  transport::Node node2;
 
-    {
-      std::lock_guard<std::mutex> lock(exitMutex);
-      if (terminatePub)
-        exitLoop = true;
-    }
-  }
+  auto pub1 = node1.Advertise<ignition::msgs::Int32>("topic1");
+  auto pub2 = node2.Advertise<ignition::msgs::Int32>("topic2");
 
-  EXPECT_LT(i, 200);
+  node1.TopicList(topics);
+  EXPECT_EQ(topics.size(), 2u);
+  topics.clear();
 
-  reset();
-}
+  auto start = std::chrono::steady_clock::now();
+  node1.TopicList(topics);
+  auto end = std::chrono::steady_clock::now();
+  EXPECT_EQ(topics.size(), 2u);
 
-//////////////////////////////////////////////////
-/// \brief Capture SIGINT and SIGTERM and flag that we want to exit.
-void signal_handler(int _signal)
-{
-  std::lock_guard<std::mutex> lock(exitMutex);
-  if (_signal == SIGINT || _signal == SIGTERM)
-    terminatePub = true;
+  // The first TopicList() call might block if the discovery is still
+  // initializing (it may happen if we run this test alone).
+  // However, the second call should never block.
+  auto elapsed = end - start;
+  EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>
+      (elapsed).count(), 2);
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that an external program can capture a SIGINT and terminate
-/// the program without problems.
-TEST(NodeTest, SigIntTermination)
+/// \brief WaitForDiscovery() returns within its timeout, and afterwards the
+/// one-shot queries don't wait for the initialization of the discovery.
+TEST(NodeTest, WaitForDiscovery)
 {
-  reset();
-
-  // Install a signal handler for SIGINT.
-  std::signal(SIGINT, signal_handler);
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>("topic_snapshot");
 
-  auto thread = std::thread(createInfinitePublisher);
+  auto start = std::chrono::steady_clock::now();
+  node.WaitForDiscovery(std::chrono::milliseconds(300));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>
+      (elapsed).count(), 1000);
 
-  std::this_thread::sleep_for(std::chrono::milliseconds(500));
-  std::raise(SIGINT);
+  std::vector<std::string> topics;
+  start = std::chrono::steady_clock::now();
+  node.TopicList(topics);
+  std::vector<transport::MessagePublisher> publishers;
+  EXPECT_TRUE(node.TopicInfo("topic_snapshot", publishers));
+  elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>
+      (elapsed).count(), 100);
 
-  if (thread.joinable())
-    thread.join();
+  EXPECT_NE(topics.end(),
+    std::find(topics.begin(), topics.end(), "/topic_snapshot"));
+  EXPECT_EQ(1u, publishers.size());
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that an external program can capture a SIGTERM and terminate
-/// the program without problems.
-TEST(NodeTest, SigTermTermination)
+/// \brief This test creates two nodes and advertises some topics. The test
+/// verifies that TopicList() returns the list of all the topics advertised.
+/// Topic remapping is enabled.
+TEST(NodeTest, TopicListRemap)
 {
-  reset();
-
-  // Install a signal handler for SIGTERM.
-  std::signal(SIGTERM, signal_handler);
+  std::vector<std::string> topics;
+  transport::NodeOptions nodeOptions;
+  nodeOptions.AddTopicRemap(g_topic, g_topic_remap);
+  transport::Node node(nodeOptions);
 
-  auto thread = std::thread(createInfinitePublisher);
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
 
-  std::this_thread::sleep_for(std::chrono::milliseconds(500));
-  std::raise(SIGTERM);
+  node.TopicList(topics);
+  ASSERT_EQ(1u, topics.size());
 
-  if (thread.joinable())
-    thread.join();
+  // The topic advertised should be remapped.
+  EXPECT_EQ(g_topic_remap, topics.at(0));
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that a message is not published if the type does not match
-/// the type advertised.
-TEST(NodeTest, PubSubWrongTypesOnPublish)
+/// \brief This test creates two nodes and advertises some services. The test
+/// verifies that ServiceList() returns the list of all the services advertised.
+TEST(NodeTest, ServiceList)
 {
-  reset();
-
-  ignition::msgs::Int32 msg;
-  msg.set_data(data);
-  ignition::msgs::Vector3d msgV;
-  msgV.set_x(1);
-  msgV.set_y(2);
-  msgV.set_z(3);
-
+  std::vector<std::string> services;
   transport::Node node;
 
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub);
-
-  EXPECT_TRUE(node.Subscribe(g_topic, cb));
-
-  // Wait some time before publishing.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Send a message with a wrong type.
-  EXPECT_FALSE(pub.Publish(msgV));
-
-  // Check that the message was not received.
-  EXPECT_FALSE(cbExecuted);
-
-  reset();
-
-  // Publish a second message on topic.
-  EXPECT_TRUE(pub.Publish(msg));
+  node.Advertise(g_topic, srvEcho);
 
-  // Give some time to the subscribers.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  node.ServiceList(services);
+  EXPECT_EQ(services.size(), 1u);
+  services.clear();
 
-  // Check that the data was received.
-  EXPECT_TRUE(cbExecuted);
+  auto start = std::chrono::steady_clock::now();
+  node.ServiceList(services);
+  auto end = std::chrono::steady_clock::now();
+  EXPECT_EQ(services.size(), 1u);
 
-  reset();
+  // The first TopicList() call might block if the discovery is still
+  // initializing (it may happen if we run this test alone).
+  // However, the second call should never block.
+  auto elapsed = end - start;
+  EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>
+      (elapsed).count(), 2);
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that a message is not received if the callback does not use
-/// the advertised types.
-TEST(NodeTest, PubSubWrongTypesOnSubscription)
+/// \brief This test creates two nodes and advertises some services. The test
+/// verifies that ServiceList() returns the list of all the services advertised.
+/// Topic remapping is enabled.
+TEST(NodeTest, ServiceListRemap)
 {
-  reset();
-
-  ignition::msgs::Vector3d msgV;
-  msgV.set_x(1);
-  msgV.set_y(2);
-  msgV.set_z(3);
-
-  transport::Node node;
-
-  auto pub = node.Advertise<ignition::msgs::Vector3d>(g_topic);
-  EXPECT_TRUE(pub);
+  std::vector<std::string> services;
+  transport::NodeOptions nodeOptions;
+  nodeOptions.AddTopicRemap(g_topic, g_topic_remap);
+  transport::Node node(nodeOptions);
 
-  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+  node.Advertise(g_topic, srvEcho);
 
-  // Wait some time before publishing.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  node.ServiceList(services);
+  ASSERT_EQ(1u, services.size());
+  EXPECT_EQ(g_topic_remap, services.at(0));
+}
 
-  // Send a message with a wrong type.
-  EXPECT_TRUE(pub.Publish(msgV));
+//////////////////////////////////////////////////
+/// \brief Check bad topic remap use cases.
+TEST(NodeTest, WrongTopicRemap)
+{
+  transport::NodeOptions nodeOptions;
 
-  // Check that the message was not received.
-  EXPECT_FALSE(cbExecuted);
+  // Invalid topics.
+  EXPECT_FALSE(nodeOptions.AddTopicRemap("  ", g_topic_remap));
+  EXPECT_FALSE(nodeOptions.AddTopicRemap(g_topic, "  "));
 
-  reset();
+  // Repeated topic.
+  EXPECT_TRUE(nodeOptions.AddTopicRemap(g_topic, g_topic_remap));
+  EXPECT_FALSE(nodeOptions.AddTopicRemap(g_topic, g_topic_remap));
 }
 
 //////////////////////////////////////////////////
-/// \brief This test spawns two subscribers on the same topic. One of the
-/// subscribers has a wrong callback (types in the callback does not match the
-/// advertised type). Check that only the good callback is executed.
-TEST(NodeTest, PubSubWrongTypesTwoSubscribers)
+/// \brief Resolve names with the remapping, partition and namespace of a
+/// node, and use them to publish and subscribe.
+TEST(NodeTest, ResolveTopicName)
 {
+  transport::NodeOptions nodeOptions;
+  nodeOptions.SetPartition(partition);
+  nodeOptions.SetNameSpace("/ns");
+  EXPECT_TRUE(nodeOptions.AddTopicRemap("/remapped", g_topic));
+  transport::Node node(nodeOptions);
+
+  const transport::TopicName name = node.Resolve("/remapped");
+  ASSERT_TRUE(name.Valid());
+  EXPECT_EQ("@/" + partition + "@" + g_topic, name.FullyQualifiedName());
+  EXPECT_EQ(name, node.Resolve("/remapped"));
+  EXPECT_EQ("@/" + partition + "@/ns/relative",
+    node.Resolve("relative").FullyQualifiedName());
+  EXPECT_FALSE(node.Resolve("bad topic").Valid());
+  EXPECT_FALSE(node.Advertise<ignition::msgs::Int32>(
+    node.Resolve("bad topic")));
+
   reset();
+  std::function<void(const ignition::msgs::Int32 &,
+                     const transport::MessageInfo &)> infoCb = cbInfo;
+  auto pub = node.Advertise<ignition::msgs::Int32>(name);
+  EXPECT_TRUE(pub);
+  EXPECT_TRUE(node.Subscribe(name, infoCb));
+  EXPECT_TRUE(node.SubscribeRaw(node.Resolve(g_topic),
+    [](const char *, const size_t, const transport::MessageInfo &){}));
 
   ignition::msgs::Int32 msg;
   msg.set_data(data);
-
-  transport::Node node1;
-  transport::Node node2;
-
-  auto pub1 = node1.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub1);
-
-  // Good subscriber.
-  EXPECT_TRUE(node1.Subscribe(g_topic, cb));
-
-  // Bad subscriber: cbVector does not match the types advertised by node1.
-  EXPECT_TRUE(node2.Subscribe(g_topic, cbVector));
-
-  // Wait some time before publishing.
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  EXPECT_TRUE(pub1.Publish(msg));
-
-  // Give some time to the subscribers.
+  EXPECT_TRUE(pub.Publish(msg));
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-  // Check that the message was received by node1.
   EXPECT_TRUE(cbExecuted);
+  reset();
+}
 
-  // Check that the message was not received by node2.
-  EXPECT_FALSE(cbVectorExecuted);
+/////////////////////////////////////////////////
+/// \brief Check the high water mark of the receiving message buffer.
+TEST(NodeTest, RcvHwm)
+{
+  EXPECT_EQ(ignition::transport::kDefaultRcvHwm, ignition::transport::rcvHwm());
+}
 
-  reset();
+//////////////////////////////////////////////////
+/// \brief Check the high water mark of the sending message buffer.
+TEST(NodeTest, SndHwm)
+{
+  EXPECT_EQ(ignition::transport::kDefaultSndHwm, ignition::transport::sndHwm());
 }
 
 //////////////////////////////////////////////////
-/// \brief This test creates one publisher and one subscriber. The publisher
-/// publishes at higher frequency than the rate set by the subscriber.
-TEST(NodeTest, SubThrottled)
+/// \brief Check the statistics of the sockets. The in-process messages
+/// don't go through the sockets and the HWM drops aren't counted by default.
+TEST(NodeTest, socketStats)
 {
-  reset();
+  const auto before = ignition::transport::socketStats();
+  EXPECT_FALSE(before.hwmDropsCounted);
+  EXPECT_EQ(0u, before.hwmDroppedMsgs);
+
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  ASSERT_TRUE(pub);
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
 
   ignition::msgs::Int32 msg;
   msg.set_data(data);
+  EXPECT_TRUE(pub.Publish(msg));
 
-  transport::Node node;
-
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
-  EXPECT_TRUE(pub);
+  const auto after = ignition::transport::socketStats();
+  EXPECT_EQ(before.sentMsgs, after.sentMsgs);
+  EXPECT_EQ(0u, after.hwmDroppedMsgs);
+  EXPECT_GE(after.receivedMsgs, before.receivedMsgs);
+}
 
-  ignition::transport::SubscribeOptions opts;
-  opts.SetMsgsPerSec(1u);
-  EXPECT_TRUE(node.Subscribe(g_topic, cb, opts));
+//////////////////////////////////////////////////
+/// \brief Check that we destruct a Node object before a Node::Publisher.
+TEST(NodePubTest, DestructionOrder)
+{
+  transport::Node::Publisher pub;
 
-  for (auto i = 0; i < 3; ++i)
   {
-    // Should always be true, because this is unthrottled.
-    EXPECT_TRUE(pub.ThrottledUpdateReady());
-    EXPECT_TRUE(pub.Publish(msg));
-
-    // Rate: 10 msgs/sec.
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    transport::Node node;
+    pub = node.Advertise<ignition::msgs::Vector3d>(g_topic);
   }
+}
 
-  // Node published 3 messages in ~0.3 sec. We should only receive 1 message.
-  EXPECT_EQ(1, counter);
+//////////////////////////////////////////////////
+/// \brief Create a separate thread, block it calling waitForShutdown() and
+/// emit a SIGINT signal. Check that the transport library captures the signal
+/// and is able to terminate.
+TEST(NodeTest, waitForShutdownSIGINT)
+{
+  std::thread aThread([]{ignition::transport::waitForShutdown();});
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  raise(SIGINT);
+  aThread.join();
+}
 
-  reset();
+//////////////////////////////////////////////////
+/// \brief Create a separate thread, block it calling waitForShutdown() and
+/// emit a SIGTERM signal. Check that the transport library captures the signal
+/// and is able to terminate.
+TEST(NodeTest, waitForShutdownSIGTERM)
+{
+  std::thread aThread([]{ignition::transport::waitForShutdown();});
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  raise(SIGTERM);
+  aThread.join();
 }
 
 //////////////////////////////////////////////////
-/// \brief This test creates one publisher and one subscriber. The publisher
-/// publishes at a throttled frequency .
-TEST(NodeTest, PubThrottled)
+/// \brief Test topic statistics with no statistics available.
+TEST(NodeTest, statistics)
 {
-  reset();
+  transport::Node node;
+  EXPECT_TRUE(node.EnableStats("/test", true));
+  EXPECT_EQ(std::nullopt, node.TopicStats("/test"));
 
-  ignition::msgs::Int32 msg;
-  msg.set_data(data);
+  // Any rate is accepted, the statistics are published at 1 kHz at most
+  EXPECT_TRUE(node.EnableStats("/test", true, "/statistics", 0));
+  EXPECT_TRUE(node.EnableStats("/test", true, "/statistics",
+    transport::kUnthrottled));
+  EXPECT_TRUE(node.EnableStats("/test", false));
+  EXPECT_FALSE(node.EnableStats("invalid topic", false));
 
-  transport::Node node;
+  // The node disables the statistics that it publishes when destroyed
+  {
+    transport::Node other;
+    EXPECT_TRUE(other.EnableStats("/other", true, "/statistics", 100));
+  }
+  EXPECT_EQ(std::nullopt, node.TopicStats("/other"));
+}
 
-  ignition::transport::AdvertiseMessageOptions opts;
-  opts.SetMsgsPerSec(1u);
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic, opts);
-  EXPECT_TRUE(pub);
+//////////////////////////////////////////////////
+/// \brief No message is lost by an in-process subscription.
+TEST(NodeTest, DroppedMsgCount)
+{
+  transport::Node node;
+  EXPECT_EQ(0u, node.DroppedMsgCount(g_topic));
+  EXPECT_EQ(0u, node.DroppedMsgCount("invalid topic"));
 
+  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  ASSERT_TRUE(pub);
   EXPECT_TRUE(node.Subscribe(g_topic, cb));
 
-  // Should be true the first time
-  EXPECT_TRUE(pub.ThrottledUpdateReady());
-  for (auto i = 0; i < 3; ++i)
-  {
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  for (int i = 0; i < 10; ++i)
     EXPECT_TRUE(pub.Publish(msg));
-    // False afterwards, because targeting 1 msg/second.
-    EXPECT_FALSE(pub.ThrottledUpdateReady());
-
-    // Rate: 10 msgs/sec.
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  }
-
-  // Node published 3 messages in ~0.3 sec. We should only receive 1 message.
-  EXPECT_EQ(1, counter);
 
-  reset();
+  EXPECT_EQ(0u, node.DroppedMsgCount(g_topic));
 }
 
 //////////////////////////////////////////////////
-/// \brief This test spawns a service responser and a service requester. The
-/// requester uses a wrong type for the request argument. The test should verify
-/// that the service call does not succeed.
-TEST(NodeTest, SrvRequestWrongReq)
+/// \brief The topics advertised in the process are reported to the
+/// callbacks registered with NodeShared::AddConnectionsCb().
+TEST(NodeTest, ConnectionsCb)
 {
-  reset();
-
-  ignition::msgs::Vector3d wrongReq;
-  ignition::msgs::Int32 rep;
-  bool result;
-  unsigned int timeout = 1000;
-
-  wrongReq.set_x(1);
-  wrongReq.set_y(2);
-  wrongReq.set_z(3);
+  const std::string topic = "/connections_cb";
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool reported = false;
+
+  auto shared = transport::NodeShared::Instance();
+  const uint64_t id = shared->AddConnectionsCb(
+      [&](const transport::MessagePublisher &_pub)
+      {
+        if (_pub.Topic() != "@" + g_FQNPartition + "@" + topic)
+          return;
+        EXPECT_EQ("ignition.msgs.Int32", _pub.MsgTypeName());
+        std::lock_guard<std::mutex> lk(mutex);
+        reported = true;
+        condition.notify_all();
+      });
 
   transport::Node node;
-  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
-
-  // Request an asynchronous service call with wrong type in the request.
-  EXPECT_TRUE(node.Request(g_topic, wrongReq, response));
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
-  EXPECT_FALSE(responseExecuted);
+  auto pub = node.Advertise<ignition::msgs::Int32>(topic);
+  ASSERT_TRUE(pub);
 
-  // Request a synchronous service call with wrong type in the request.
-  EXPECT_FALSE(node.Request(g_topic, wrongReq, timeout, rep, result));
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(5),
+        [&reported]{return reported;}));
+  }
 
-  reset();
+  // Nothing is reported once the callback is removed.
+  shared->RemoveConnectionsCb(id);
+  reported = false;
+  transport::Node other;
+  auto otherPub = other.Advertise<ignition::msgs::Int32>(topic);
+  ASSERT_TRUE(otherPub);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(reported);
 }
 
 //////////////////////////////////////////////////
-/// \brief This test spawns a service responser and a service requester. The
-/// requester uses a wrong type for the response argument. The test should
-/// verify that the service call does not succeed.
-TEST(NodeTest, SrvRequestWrongRep)
+/// \brief The publishers added and removed are reported to the callbacks
+/// of Node::SubscribeDiscovery(), starting with the ones known already.
+TEST(NodeTest, SubscribeDiscovery)
 {
-  reset();
+  const std::string existing = "/discovery_existing";
+  const std::string topic = "/discovery_changes";
+  const std::string fqnExisting = "@" + g_FQNPartition + "@" + existing;
+  const std::string fqnTopic = "@" + g_FQNPartition + "@" + topic;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<std::pair<transport::DiscoveryChange_t, std::string>> changes;
 
-  ignition::msgs::Int32 req;
-  ignition::msgs::Vector3d wrongRep;
-  bool result;
-  unsigned int timeout = 1000;
+  transport::Node node;
+  auto existingPub = node.Advertise<ignition::msgs::Int32>(existing);
+  ASSERT_TRUE(existingPub);
 
-  req.set_data(data);
+  auto hasChange = [&](const transport::DiscoveryChange_t _change,
+                       const std::string &_topic)
+  {
+    return std::find(changes.begin(), changes.end(),
+      std::make_pair(_change, _topic)) != changes.end();
+  };
 
-  transport::Node node;
-  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
+  const uint64_t id = node.SubscribeDiscovery(
+      [&](const transport::DiscoveryChange_t _change,
+          const transport::MessagePublisher &_pub)
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        changes.emplace_back(_change, _pub.Topic());
+        condition.notify_all();
+      });
 
-  // Request an asynchronous service call with wrong type in the response.
-  EXPECT_TRUE(node.Request(g_topic, req, wrongResponse));
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
-  EXPECT_FALSE(wrongResponseExecuted);
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(5), [&]
+      {return hasChange(transport::DiscoveryChange_t::ADDED, fqnExisting);}));
+  }
 
-  // Request a synchronous service call with wrong type in the response.
-  EXPECT_FALSE(node.Request(g_topic, req, timeout, wrongRep, result));
+  {
+    auto pub = node.Advertise<ignition::msgs::Int32>(topic);
+    ASSERT_TRUE(pub);
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(5), [&]
+      {return hasChange(transport::DiscoveryChange_t::ADDED, fqnTopic);}));
+  }
 
-  reset();
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(5), [&]
+      {return hasChange(transport::DiscoveryChange_t::REMOVED, fqnTopic);}));
+  }
+
+  // Nothing is reported once the node unsubscribes.
+  EXPECT_TRUE(node.UnsubscribeDiscovery(id));
+  EXPECT_FALSE(node.UnsubscribeDiscovery(id));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    changes.clear();
+  }
+  auto otherPub = node.Advertise<ignition::msgs::Int32>(topic);
+  ASSERT_TRUE(otherPub);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  std::lock_guard<std::mutex> lk(mutex);
+  EXPECT_TRUE(changes.empty());
 }
 
 //////////////////////////////////////////////////
-/// \brief This test spawns a service that doesn't accept input parameters. The
-/// service requester uses a wrong type for the response argument. The test
-/// should verify that the service call does not succeed.
-TEST(NodeTest, SrvWithoutInputRequestWrongRep)
+/// \brief The messages published asynchronously are delivered in order,
+/// and their results are reported through the futures and the callbacks.
+TEST(NodeTest, PublishAsync)
 {
-  reset();
-
-  ignition::msgs::Vector3d wrongRep;
-  bool result;
-  unsigned int timeout = 1000;
+  const std::string topic = "/publish_async";
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<int> received;
+  std::atomic<int> done{0};
 
   transport::Node node;
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+  auto pub = node.Advertise<ignition::msgs::Int32>(topic);
+  ASSERT_TRUE(pub);
+  std::function<void(const ignition::msgs::Int32 &)> subCb =
+    [&](const ignition::msgs::Int32 &_msg)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      received.push_back(_msg.data());
+      condition.notify_all();
+    };
+  EXPECT_TRUE(node.Subscribe(topic, subCb));
+
+  std::vector<std::future<bool>> results;
+  for (int i = 0; i < 20; ++i)
+  {
+    auto msg = std::make_unique<ignition::msgs::Int32>();
+    msg->set_data(i);
+    results.push_back(pub.PublishAsync(std::move(msg),
+      [&done](const bool _result)
+      {
+        EXPECT_TRUE(_result);
+        ++done;
+      }));
+  }
 
-  // Request an asynchronous service call with wrong type in the response.
-  EXPECT_TRUE(node.Request(g_topic, wrongResponse));
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
-  EXPECT_FALSE(wrongResponseExecuted);
+  for (auto &result : results)
+  {
+    ASSERT_EQ(std::future_status::ready,
+      result.wait_for(std::chrono::seconds(5)));
+    EXPECT_TRUE(result.get());
+  }
+  EXPECT_EQ(20, done);
 
-  // Request a synchronous service call with wrong type in the response.
-  EXPECT_FALSE(node.Request(g_topic, timeout, wrongRep, result));
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(condition.wait_for(lk, std::chrono::seconds(5),
+      [&received]{return received.size() == 20u;}));
+    for (int i = 0; i < static_cast<int>(received.size()); ++i)
+      EXPECT_EQ(i, received[i]);
+  }
 
-  reset();
+  // The failures are reported too.
+  EXPECT_FALSE(pub.PublishAsync(nullptr).get());
+  auto wrongType = std::make_unique<ignition::msgs::StringMsg>();
+  EXPECT_FALSE(pub.PublishAsync(std::move(wrongType)).get());
+  bool reported = true;
+  EXPECT_FALSE(transport::Node::Publisher().PublishAsync(
+    std::make_unique<ignition::msgs::Int32>(),
+    [&reported](const bool _result) {reported = _result;}).get());
+  EXPECT_FALSE(reported);
 }
 
 //////////////////////////////////////////////////
-/// \brief This test spawns a service responser and two service requesters. The
-/// service requesters use incorrect types in some of the requests. The test
-/// should verify that a response is received only when the appropriate types
-/// are used.
-TEST(NodeTest, SrvTwoRequestsOneWrong)
+/// \brief The nodes of different transport contexts have their own
+/// NodeShared, and communicate as if they lived in different processes.
+TEST(NodeTest, Contexts)
 {
+  const std::string topic = "/contexts";
   reset();
 
-  ignition::msgs::Int32 req;
-  ignition::msgs::Int32 goodRep;
-  ignition::msgs::Vector3d badRep;
-  bool result;
-  unsigned int timeout = 1000;
-
-  req.set_data(data);
-
-  transport::Node node;
-  EXPECT_TRUE(node.Advertise(g_topic, srvEcho));
-
-  // Request service calls with wrong types in the response.
-  EXPECT_FALSE(node.Request(g_topic, req, timeout, badRep, result));
-  EXPECT_TRUE(node.Request(g_topic, req, wrongResponse));
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
-  EXPECT_FALSE(wrongResponseExecuted);
+  transport::NodeOptions optsA;
+  optsA.SetContext("context_a");
+  transport::NodeOptions optsB;
+  optsB.SetContext("context_b");
+
+  transport::Node nodeA(optsA);
+  transport::Node nodeB(optsB);
+
+  auto sharedA = transport::NodeShared::Instance("context_a");
+  auto sharedB = transport::NodeShared::Instance("context_b");
+  EXPECT_EQ(transport::NodeShared::Instance(),
+    transport::NodeShared::Instance(""));
+  EXPECT_NE(sharedA, sharedB);
+  EXPECT_NE(transport::NodeShared::Instance(), sharedA);
+  EXPECT_NE(sharedA->pUuid, sharedB->pUuid);
+  EXPECT_EQ("context_a", sharedA->Context());
+  EXPECT_TRUE(transport::NodeShared::Instance()->Context().empty());
+
+  // A context in use can't change its ports.
+  EXPECT_FALSE(transport::NodeShared::ConfigureContext("context_a", 1, 2));
+  EXPECT_FALSE(transport::NodeShared::ConfigureContext("", 1, 2));
+  EXPECT_FALSE(transport::NodeShared::ConfigureContext("context_c", -1, 2));
+  EXPECT_TRUE(transport::NodeShared::ConfigureContext("context_c", 11321,
+    11322));
+
+  auto pub = nodeA.Advertise<ignition::msgs::Int32>(topic);
+  ASSERT_TRUE(pub);
+  EXPECT_TRUE(nodeB.Subscribe(topic, cb));
+  ASSERT_TRUE(nodeB.WaitForPublishers(topic, 1, std::chrono::seconds(5)));
 
-  // Valid service requests.
-  EXPECT_TRUE(node.Request(g_topic, req, timeout, goodRep, result));
-  EXPECT_TRUE(node.Request(g_topic, req, response));
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
-  EXPECT_TRUE(responseExecuted);
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  for (int i = 0; i < 50 && !cbExecuted; ++i)
+  {
+    EXPECT_TRUE(pub.Publish(msg));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  EXPECT_TRUE(cbExecuted);
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief This test spawns a service that doesn't accept input parameters. The
-/// service requesters use incorrect types in some of the requests. The test
-/// should verify that a response is received only when the appropriate types
-/// are used.
-TEST(NodeTest, SrvWithoutInputTwoRequestsOneWrong)
+/// \brief The sockets of the services are only created once a service is
+/// advertised or requested. The reception thread, blocked polling the
+/// sockets of the messages, is woken up to poll the new ones.
+TEST(NodeTest, ServicesLazyInitialization)
 {
+  const std::string topic = "/lazy_services";
   reset();
 
-  ignition::msgs::Int32 goodRep;
-  ignition::msgs::Vector3d badRep;
-  bool result;
-  unsigned int timeout = 1000;
+  transport::NodeOptions optsA;
+  optsA.SetContext("lazy_services_a");
+  transport::NodeOptions optsB;
+  optsB.SetContext("lazy_services_b");
 
-  transport::Node node;
-  EXPECT_TRUE(node.Advertise(g_topic, srvWithoutInput));
+  transport::Node nodeA(optsA);
+  transport::Node nodeB(optsB);
+  auto sharedA = transport::NodeShared::Instance("lazy_services_a");
+  auto sharedB = transport::NodeShared::Instance("lazy_services_b");
 
-  // Request service calls with wrong types in the response.
-  EXPECT_FALSE(node.Request(g_topic, timeout, badRep, result));
-  EXPECT_TRUE(node.Request(g_topic, wrongResponse));
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
-  EXPECT_FALSE(wrongResponseExecuted);
+  // Only messages are exchanged.
+  auto pub = nodeA.Advertise<ignition::msgs::Int32>(topic);
+  ASSERT_TRUE(pub);
+  EXPECT_TRUE(nodeB.Subscribe(topic, cb));
+  ASSERT_TRUE(nodeB.WaitForPublishers(topic, 1, std::chrono::seconds(5)));
 
-  // Valid service requests.
-  EXPECT_TRUE(node.Request(g_topic, timeout, goodRep, result));
-  EXPECT_TRUE(node.Request(g_topic, response));
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
-  EXPECT_TRUE(responseExecuted);
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  for (int i = 0; i < 50 && !cbExecuted; ++i)
+  {
+    EXPECT_TRUE(pub.Publish(msg));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  EXPECT_TRUE(cbExecuted);
+
+  for (auto *shared : {sharedA, sharedB})
+  {
+    EXPECT_TRUE(shared->myReplierAddress.empty());
+    EXPECT_TRUE(shared->myRequesterAddress.empty());
+  }
+
+  // The first service advertised creates the sockets of its process only.
+  EXPECT_TRUE(nodeA.Advertise(g_topic, srvEcho));
+  EXPECT_FALSE(sharedA->myReplierAddress.empty());
+  EXPECT_FALSE(sharedA->myRequesterAddress.empty());
+  EXPECT_TRUE(sharedB->myReplierAddress.empty());
+  EXPECT_TRUE(sharedB->myRequesterAddress.empty());
+
+  // The first request creates the sockets of the requester. The request
+  // only gets its response if the reception thread of the responder polls
+  // the new sockets, nothing else wakes it up.
+  ignition::msgs::Int32 req;
+  ignition::msgs::Int32 rep;
+  bool result = false;
+  req.set_data(data);
+  EXPECT_TRUE(nodeB.Request(g_topic, req, 5000, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(data, rep.data());
+  EXPECT_FALSE(sharedB->myRequesterAddress.empty());
 
   reset();
 }
 
 //////////////////////////////////////////////////
-/// \brief This test creates two nodes and advertises some topics. The test
-/// verifies that TopicList() returns the list of all the topics advertised.
-TEST(NodeTest, TopicList)
+/// \brief Messages published with best effort delivery reach a subscriber
+/// of another context that asks for it. The messages too big for a
+/// datagram arrive too, over TCP.
+TEST(NodeTest, PubSubBestEffort)
 {
-  std::vector<std::string> topics;
-  transport::Node node1;
-  transport::Node node2;
+  const std::string topic = "/best_effort";
 
-  auto pub1 = node1.Advertise<ignition::msgs::Int32>("topic1");
-  auto pub2 = node2.Advertise<ignition::msgs::Int32>("topic2");
+  transport::NodeOptions pubOpts;
+  pubOpts.SetContext("best_effort_pub");
+  transport::NodeOptions subOpts;
+  subOpts.SetContext("best_effort_sub");
+  transport::Node pubNode(pubOpts);
+  transport::Node subNode(subOpts);
 
-  node1.TopicList(topics);
-  EXPECT_EQ(topics.size(), 2u);
-  topics.clear();
+  std::mutex mutex;
+  std::vector<size_t> sizes;
+  std::function<void(const ignition::msgs::StringMsg &)> stringCb =
+    [&mutex, &sizes](const ignition::msgs::StringMsg &_msg)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      sizes.push_back(_msg.data().size());
+    };
+  auto received = [&mutex, &sizes](const size_t _size)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::find(sizes.begin(), sizes.end(), _size) != sizes.end();
+  };
 
-  auto start = std::chrono::steady_clock::now();
-  node1.TopicList(topics);
-  auto end = std::chrono::steady_clock::now();
-  EXPECT_EQ(topics.size(), 2u);
+  transport::AdvertiseMessageOptions advOpts;
+  advOpts.SetBestEffort(true);
+  auto pub = pubNode.Advertise<ignition::msgs::StringMsg>(topic, advOpts);
+  ASSERT_TRUE(pub);
+  transport::SubscribeOptions opts;
+  opts.SetBestEffort(true);
+  EXPECT_TRUE(subNode.Subscribe(topic, stringCb, opts));
+  ASSERT_TRUE(subNode.WaitForPublishers(topic, 1, std::chrono::seconds(5)));
 
-  // The first TopicList() call might block if the discovery is still
-  // initializing (it may happen if we run this test alone).
-  // However, the second call should never block.
-  auto elapsed = end - start;
-  EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>
-      (elapsed).count(), 2);
+  for (const size_t size : {size_t(100), size_t(100000)})
+  {
+    ignition::msgs::StringMsg msg;
+    msg.set_data(std::string(size, 'x'));
+    for (int i = 0; i < 50 && !received(size); ++i)
+    {
+      EXPECT_TRUE(pub.Publish(msg));
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    EXPECT_TRUE(received(size)) << size;
+  }
 }
 
 //////////////////////////////////////////////////
-/// \brief This test creates two nodes and advertises some topics. The test
-/// verifies that TopicList() returns the list of all the topics advertised.
-/// Topic remapping is enabled.
-TEST(NodeTest, TopicListRemap)
+/// \brief A topic advertised with a multicast group reaches a subscriber of
+/// another context, over TCP in the same host. The group is left when the
+/// topic is unadvertised, and the topic can be advertised again.
+TEST(NodeTest, PubSubMulticastGroup)
 {
-  std::vector<std::string> topics;
-  transport::NodeOptions nodeOptions;
-  nodeOptions.AddTopicRemap(g_topic, g_topic_remap);
-  transport::Node node(nodeOptions);
+  const std::string topic = "/multicast";
+  reset();
 
-  auto pub = node.Advertise<ignition::msgs::Int32>(g_topic);
+  transport::NodeOptions pubOpts;
+  pubOpts.SetContext("multicast_pub");
+  transport::NodeOptions subOpts;
+  subOpts.SetContext("multicast_sub");
+  transport::Node pubNode(pubOpts);
+  transport::Node subNode(subOpts);
 
-  node.TopicList(topics);
-  ASSERT_EQ(1u, topics.size());
+  transport::AdvertiseMessageOptions advOpts;
+  advOpts.SetMulticastGroup("239.255.0.9:11320");
+  EXPECT_TRUE(subNode.Subscribe(topic, cb));
 
-  // The topic advertised should be remapped.
-  EXPECT_EQ(g_topic_remap, topics.at(0));
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  for (int round = 0; round < 2; ++round)
+  {
+    auto pub = pubNode.Advertise<ignition::msgs::Int32>(topic, advOpts);
+    ASSERT_TRUE(pub);
+    ASSERT_TRUE(subNode.WaitForPublishers(topic, 1, std::chrono::seconds(5)));
+    for (int i = 0; i < 50 && !cbExecuted; ++i)
+    {
+      EXPECT_TRUE(pub.Publish(msg));
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    EXPECT_TRUE(cbExecuted) << round;
+    reset();
+  }
 }
 
 //////////////////////////////////////////////////
-/// \brief This test creates two nodes and advertises some services. The test
-/// verifies that ServiceList() returns the list of all the services advertised.
-TEST(NodeTest, ServiceList)
+/// \brief A subscriber limited to a rate receives at most that rate, while
+/// an unlimited subscriber of the same topic in another context receives
+/// every message.
+TEST(NodeTest, PubSubRateLimitedSubscriber)
 {
-  std::vector<std::string> services;
-  transport::Node node;
-
-  node.Advertise(g_topic, srvEcho);
+  const std::string topic = "/rate_limited";
+  const uint64_t kRate = 5;
+  const int kMsgs = 100;
+
+  transport::NodeOptions pubOpts;
+  pubOpts.SetContext("rate_pub");
+  transport::NodeOptions limitedOpts;
+  limitedOpts.SetContext("rate_limited");
+  transport::NodeOptions unlimitedOpts;
+  unlimitedOpts.SetContext("rate_unlimited");
+  transport::Node pubNode(pubOpts);
+  transport::Node limitedNode(limitedOpts);
+  transport::Node unlimitedNode(unlimitedOpts);
+
+  std::atomic<int> limited{0};
+  std::atomic<int> unlimited{0};
+  std::function<void(const ignition::msgs::Int32 &)> limitedCb =
+    [&limited](const ignition::msgs::Int32 &)
+    {
+      ++limited;
+    };
+  std::function<void(const ignition::msgs::Int32 &)> unlimitedCb =
+    [&unlimited](const ignition::msgs::Int32 &)
+    {
+      ++unlimited;
+    };
+
+  auto pub = pubNode.Advertise<ignition::msgs::Int32>(topic);
+  ASSERT_TRUE(pub);
+  transport::SubscribeOptions opts;
+  opts.SetMsgsPerSec(kRate);
+  EXPECT_TRUE(limitedNode.Subscribe(topic, limitedCb, opts));
+  EXPECT_TRUE(unlimitedNode.Subscribe(topic, unlimitedCb));
+  ASSERT_TRUE(limitedNode.WaitForPublishers(topic, 1,
+    std::chrono::seconds(5)));
+  ASSERT_TRUE(unlimitedNode.WaitForPublishers(topic, 1,
+    std::chrono::seconds(5)));
+
+  // Wait until both subscribers are connected.
+  ignition::msgs::Int32 msg;
+  msg.set_data(data);
+  for (int i = 0; i < 50 && (limited == 0 || unlimited == 0); ++i)
+  {
+    EXPECT_TRUE(pub.Publish(msg));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  ASSERT_GT(limited, 0);
+  ASSERT_GT(unlimited, 0);
 
-  node.ServiceList(services);
-  EXPECT_EQ(services.size(), 1u);
-  services.clear();
+  // Let the window of the limited subscriber expire.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000 / kRate + 50));
+  limited = 0;
+  unlimited = 0;
 
-  auto start = std::chrono::steady_clock::now();
-  node.ServiceList(services);
-  auto end = std::chrono::steady_clock::now();
-  EXPECT_EQ(services.size(), 1u);
+  // 100 messages over one second.
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kMsgs; ++i)
+  {
+    EXPECT_TRUE(pub.Publish(msg));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  const double elapsed = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+  for (int i = 0; i < 50 && unlimited < kMsgs; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-  // The first TopicList() call might block if the discovery is still
-  // initializing (it may happen if we run this test alone).
-  // However, the second call should never block.
-  auto elapsed = end - start;
-  EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>
-      (elapsed).count(), 2);
+  EXPECT_EQ(kMsgs, unlimited);
+  EXPECT_GT(limited, 0);
+  EXPECT_LE(limited, static_cast<int>(kRate * elapsed) + 1);
 }
 
 //////////////////////////////////////////////////
-/// \brief This test creates two nodes and advertises some services. The test
-/// verifies that ServiceList() returns the list of all the services advertised.
-/// Topic remapping is enabled.
-TEST(NodeTest, ServiceListRemap)
+/// \brief Publish a flood of large messages on a topic of a traffic class,
+/// followed by a message on a topic of another class, to a subscriber of
+/// another context. Each class is advertised with the address of its own
+/// publisher socket.
+/// \param[in] _name Name of the contexts and topics.
+/// \param[in] _floodClass Traffic class of the flooded topic.
+/// \param[in] _otherClass Traffic class of the other topic.
+/// \return Number of flood messages received when the other message
+/// arrived, or -1 if it didn't arrive.
+static int laneOvertaken(const std::string &_name,
+  const transport::TrafficClass_t _floodClass,
+  const transport::TrafficClass_t _otherClass)
 {
-  std::vector<std::string> services;
-  transport::NodeOptions nodeOptions;
-  nodeOptions.AddTopicRemap(g_topic, g_topic_remap);
-  transport::Node node(nodeOptions);
-
-  node.Advertise(g_topic, srvEcho);
-
-  node.ServiceList(services);
-  ASSERT_EQ(1u, services.size());
-  EXPECT_EQ(g_topic_remap, services.at(0));
-}
+  const int kFloodMsgs = 50;
+  const std::string floodTopic = "/" + _name + "_flood";
+  const std::string otherTopic = "/" + _name + "_other";
+
+  transport::NodeOptions pubOpts;
+  pubOpts.SetContext(_name + "_pub");
+  transport::NodeOptions subOpts;
+  subOpts.SetContext(_name + "_sub");
+  transport::Node pubNode(pubOpts);
+  transport::Node subNode(subOpts);
+
+  std::atomic<bool> floodReady{false};
+  std::atomic<bool> otherReady{false};
+  std::atomic<int> floodMsgs{0};
+  std::atomic<int> overtaken{-1};
+  std::function<void(const ignition::msgs::StringMsg &)> floodCb =
+    [&floodReady, &floodMsgs](const ignition::msgs::StringMsg &_msg)
+    {
+      if (_msg.data().empty())
+      {
+        floodReady = true;
+        return;
+      }
+      ++floodMsgs;
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    };
+  std::function<void(const ignition::msgs::StringMsg &)> otherCb =
+    [&otherReady, &floodMsgs, &overtaken](
+      const ignition::msgs::StringMsg &_msg)
+    {
+      if (_msg.data().empty())
+        otherReady = true;
+      else
+        overtaken = floodMsgs.load();
+    };
+
+  transport::AdvertiseMessageOptions floodOpts;
+  floodOpts.SetTrafficClass(_floodClass);
+  transport::AdvertiseMessageOptions otherOpts;
+  otherOpts.SetTrafficClass(_otherClass);
+  auto floodPub =
+    pubNode.Advertise<ignition::msgs::StringMsg>(floodTopic, floodOpts);
+  auto otherPub =
+    pubNode.Advertise<ignition::msgs::StringMsg>(otherTopic, otherOpts);
+  EXPECT_TRUE(floodPub);
+  EXPECT_TRUE(otherPub);
+  EXPECT_TRUE(subNode.Subscribe(floodTopic, floodCb));
+  EXPECT_TRUE(subNode.Subscribe(otherTopic, otherCb));
+  EXPECT_TRUE(subNode.WaitForPublishers(floodTopic, 1,
+    std::chrono::seconds(5)));
+  EXPECT_TRUE(subNode.WaitForPublishers(otherTopic, 1,
+    std::chrono::seconds(5)));
+
+  std::vector<transport::MessagePublisher> floodInfo;
+  std::vector<transport::MessagePublisher> otherInfo;
+  EXPECT_TRUE(subNode.TopicInfo(floodTopic, floodInfo));
+  EXPECT_TRUE(subNode.TopicInfo(otherTopic, otherInfo));
+  if (floodInfo.size() != 1u || otherInfo.size() != 1u)
+  {
+    ADD_FAILURE() << "Publishers not discovered";
+    return -1;
+  }
+  EXPECT_EQ(_floodClass, floodInfo[0].Options().TrafficClass());
+  EXPECT_EQ(_otherClass, otherInfo[0].Options().TrafficClass());
+  EXPECT_NE(floodInfo[0].Addr(), otherInfo[0].Addr());
 
-//////////////////////////////////////////////////
-/// \brief Check bad topic remap use cases.
-TEST(NodeTest, WrongTopicRemap)
-{
-  transport::NodeOptions nodeOptions;
+  // Wait until the subscriber is connected to both sockets.
+  ignition::msgs::StringMsg msg;
+  for (int i = 0; i < 50 && (!floodReady || !otherReady); ++i)
+  {
+    EXPECT_TRUE(floodPub.Publish(msg));
+    EXPECT_TRUE(otherPub.Publish(msg));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  EXPECT_TRUE(floodReady);
+  EXPECT_TRUE(otherReady);
 
-  // Invalid topics.
-  EXPECT_FALSE(nodeOptions.AddTopicRemap("  ", g_topic_remap));
-  EXPECT_FALSE(nodeOptions.AddTopicRemap(g_topic, "  "));
+  msg.set_data(std::string(1024 * 1024, 'x'));
+  for (int i = 0; i < kFloodMsgs; ++i)
+    EXPECT_TRUE(floodPub.Publish(msg));
+  msg.set_data("other");
+  EXPECT_TRUE(otherPub.Publish(msg));
 
-  // Repeated topic.
-  EXPECT_TRUE(nodeOptions.AddTopicRemap(g_topic, g_topic_remap));
-  EXPECT_FALSE(nodeOptions.AddTopicRemap(g_topic, g_topic_remap));
+  for (int i = 0; i < 100 && (overtaken < 0 || floodMsgs < kFloodMsgs); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(kFloodMsgs, floodMsgs);
+  EXPECT_LT(overtaken, kFloodMsgs);
+  return overtaken;
 }
 
-/////////////////////////////////////////////////
-/// \brief Check the high water mark of the receiving message buffer.
-TEST(NodeTest, RcvHwm)
+//////////////////////////////////////////////////
+/// \brief A bulk topic is sent through a socket of its own, and a topic of
+/// the default class published after a flood of bulk messages doesn't wait
+/// behind them.
+TEST(NodeTest, PubSubBulkLane)
 {
-  EXPECT_EQ(ignition::transport::kDefaultRcvHwm, ignition::transport::rcvHwm());
+  EXPECT_GE(laneOvertaken("bulk_lane", transport::TrafficClass_t::BULK,
+    transport::TrafficClass_t::DEFAULT), 0);
 }
 
 //////////////////////////////////////////////////
-/// \brief Check the high water mark of the sending message buffer.
-TEST(NodeTest, SndHwm)
+/// \brief A control topic is received while the default lane is saturated
+/// by a flood of large messages, without waiting behind them.
+TEST(NodeTest, PubSubControlLane)
 {
-  EXPECT_EQ(ignition::transport::kDefaultSndHwm, ignition::transport::sndHwm());
+  EXPECT_GE(laneOvertaken("control_lane", transport::TrafficClass_t::DEFAULT,
+    transport::TrafficClass_t::CONTROL), 0);
 }
 
 //////////////////////////////////////////////////
-/// \brief Check that we destruct a Node object before a Node::Publisher.
-TEST(NodePubTest, DestructionOrder)
+/// \brief Calls to a service with a worker pool run concurrently, up to
+/// the limit set. The calls of a service limited to one run one at a time
+/// and are answered in order.
+TEST(NodeTest, ServiceCallWorkerPool)
 {
-  transport::Node::Publisher pub;
+  const std::string service = "/worker_pool";
+  const std::string ordered = "/worker_pool_ordered";
+  const int kCalls = 4;
+
+  transport::NodeOptions repOpts;
+  repOpts.SetContext("pool_rep");
+  transport::NodeOptions reqOpts;
+  reqOpts.SetContext("pool_req");
+  transport::Node repNode(repOpts);
+  transport::Node reqNode(reqOpts);
+
+  std::atomic<int> running{0};
+  std::atomic<int> maxRunning{0};
+  std::mutex mutex;
+  std::vector<int> calls;
+  std::function<bool(const ignition::msgs::Int32 &, ignition::msgs::Int32 &)>
+    slowCb = [&](const ignition::msgs::Int32 &_req,
+      ignition::msgs::Int32 &_rep) -> bool
+    {
+      const int now = ++running;
+      int max = maxRunning.load();
+      while (now > max && !maxRunning.compare_exchange_weak(max, now))
+      {
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        calls.push_back(_req.data());
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      _rep.set_data(_req.data());
+      --running;
+      return true;
+    };
+
+  transport::AdvertiseServiceOptions concurrentOpts;
+  concurrentOpts.SetMaxConcurrentCalls(2);
+  transport::AdvertiseServiceOptions orderedOpts;
+  orderedOpts.SetMaxConcurrentCalls(1);
+  EXPECT_TRUE((repNode.Advertise<ignition::msgs::Int32,
+        ignition::msgs::Int32>(service, slowCb, concurrentOpts)));
+  EXPECT_TRUE((repNode.Advertise<ignition::msgs::Int32,
+        ignition::msgs::Int32>(ordered, slowCb, orderedOpts)));
+
+  std::vector<int> responses;
+  std::function<void(const ignition::msgs::Int32 &, const bool)> reqCb =
+    [&mutex, &responses](const ignition::msgs::Int32 &_rep,
+      const bool _result)
+    {
+      EXPECT_TRUE(_result);
+      std::lock_guard<std::mutex> lock(mutex);
+      responses.push_back(_rep.data());
+    };
+  auto waitResponses = [&mutex, &responses](const size_t _count)
+  {
+    for (int i = 0; i < 100; ++i)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (responses.size() >= _count)
+          return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  };
 
+  ignition::msgs::Int32 req;
+  for (int i = 0; i < kCalls; ++i)
   {
-    transport::Node node;
-    pub = node.Advertise<ignition::msgs::Vector3d>(g_topic);
+    req.set_data(i);
+    EXPECT_TRUE(reqNode.Request(service, req, reqCb));
   }
-}
+  waitResponses(kCalls);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(static_cast<size_t>(kCalls), responses.size());
+    std::sort(responses.begin(), responses.end());
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), responses);
+  }
+  const int expected = static_cast<int>(
+    std::min(2u, std::max(1u, std::thread::hardware_concurrency())));
+  EXPECT_EQ(expected, maxRunning);
 
-//////////////////////////////////////////////////
-/// \brief Create a separate thread, block it calling waitForShutdown() and
-/// emit a SIGINT signal. Check that the transport library captures the signal
-/// and is able to terminate.
-TEST(NodeTest, waitForShutdownSIGINT)
-{
-  std::thread aThread([]{ignition::transport::waitForShutdown();});
-  std::this_thread::sleep_for(std::chrono::milliseconds(50));
-  raise(SIGINT);
-  aThread.join();
+  // One call at a time, answered in the order that they run. The pending
+  // requests aren't sent in a particular order.
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    calls.clear();
+    responses.clear();
+  }
+  maxRunning = 0;
+  for (int i = 0; i < kCalls; ++i)
+  {
+    req.set_data(i);
+    EXPECT_TRUE(reqNode.Request(ordered, req, reqCb));
+  }
+  waitResponses(kCalls);
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(1, maxRunning);
+  EXPECT_EQ(calls, responses);
+  std::sort(calls.begin(), calls.end());
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), calls);
 }
 
 //////////////////////////////////////////////////
-/// \brief Create a separate thread, block it calling waitForShutdown() and
-/// emit a SIGTERM signal. Check that the transport library captures the signal
-/// and is able to terminate.
-TEST(NodeTest, waitForShutdownSIGTERM)
+/// \brief A node with a service running in the worker pool can be destroyed
+/// while a call is running. The call completes and the service is gone.
+TEST(NodeTest, ServiceCallWorkerPoolShutdown)
 {
-  std::thread aThread([]{ignition::transport::waitForShutdown();});
-  std::this_thread::sleep_for(std::chrono::milliseconds(50));
-  raise(SIGTERM);
-  aThread.join();
-}
+  const std::string service = "/worker_pool_shutdown";
 
-//////////////////////////////////////////////////
-/// \brief Test topic statistics with no statistics available.
-TEST(NodeTest, statistics)
-{
-  transport::Node node;
-  EXPECT_TRUE(node.EnableStats("/test", true));
-  EXPECT_EQ(std::nullopt, node.TopicStats("/test"));
+  transport::NodeOptions repOpts;
+  repOpts.SetContext("pool_shutdown_rep");
+  transport::NodeOptions reqOpts;
+  reqOpts.SetContext("pool_shutdown_req");
+  auto repNode = std::make_unique<transport::Node>(repOpts);
+  transport::Node reqNode(reqOpts);
+
+  std::atomic<bool> started{false};
+  std::atomic<bool> finished{false};
+  std::function<bool(const ignition::msgs::Int32 &, ignition::msgs::Int32 &)>
+    slowCb = [&started, &finished](const ignition::msgs::Int32 &_req,
+      ignition::msgs::Int32 &_rep) -> bool
+    {
+      started = true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      _rep.set_data(_req.data());
+      finished = true;
+      return true;
+    };
+  transport::AdvertiseServiceOptions opts;
+  opts.SetMaxConcurrentCalls(2);
+  EXPECT_TRUE((repNode->Advertise<ignition::msgs::Int32,
+        ignition::msgs::Int32>(service, slowCb, opts)));
+
+  std::function<void(const ignition::msgs::Int32 &, const bool)> reqCb =
+    [](const ignition::msgs::Int32 &, const bool)
+    {
+    };
+  ignition::msgs::Int32 req;
+  req.set_data(data);
+  EXPECT_TRUE(reqNode.Request(service, req, reqCb));
+  for (int i = 0; i < 100 && !started; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_TRUE(started);
+
+  repNode.reset();
+  for (int i = 0; i < 100 && !finished; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_TRUE(finished);
+
+  // Nobody answers anymore.
+  ignition::msgs::Int32 rep;
+  bool result = false;
+  const bool executed = reqNode.Request(service, req, 500, rep, result);
+  EXPECT_FALSE(executed && result);
 }
 
 //////////////////////////////////////////////////
@@ -16,6 +16,7 @@
 */
 
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <string>
@@ -26,6 +27,8 @@
 #include "ignition/transport/NodeShared.hh"
 #include "ignition/transport/SubscriptionHandler.hh"
 
+#include "DiscoveryKeys.hh"
+
 using namespace ignition;
 using namespace transport;
 
@@ -230,6 +233,50 @@ void MessagePublisher::FillDiscovery(msgs::Discovery &_msg) const
   pub->mutable_msg_pub()->set_msg_type(this->MsgTypeName());
   pub->mutable_msg_pub()->set_throttled(this->msgOpts.Throttled());
   pub->mutable_msg_pub()->set_msgs_per_sec(this->msgOpts.MsgsPerSec());
+
+  // The discovery message has no field for it.
+  if (!this->msgOpts.MulticastGroup().empty())
+  {
+    auto data = _msg.mutable_header()->add_data();
+    data->set_key(kMulticastGroupKey);
+    data->add_value(this->msgOpts.MulticastGroup());
+  }
+
+  if (this->msgOpts.BestEffort())
+    _msg.mutable_header()->add_data()->set_key(kBestEffortKey);
+
+  if (this->msgOpts.SubscriberMsgsPerSec() != 0)
+  {
+    auto data = _msg.mutable_header()->add_data();
+    data->set_key(kSubscriberRateKey);
+    data->add_value(std::to_string(this->msgOpts.SubscriberMsgsPerSec()));
+  }
+
+  if (this->msgOpts.CompactHeader())
+    _msg.mutable_header()->add_data()->set_key(kCompactHeaderKey);
+
+  if (this->msgOpts.TrafficClass() != TrafficClass_t::DEFAULT)
+  {
+    auto data = _msg.mutable_header()->add_data();
+    data->set_key(kTrafficClassKey);
+    data->add_value(this->msgOpts.TrafficClass() == TrafficClass_t::BULK ?
+      kBulkClass : kControlClass);
+  }
+
+  if (this->msgOpts.FragmentSize() != 0)
+  {
+    auto data = _msg.mutable_header()->add_data();
+    data->set_key(kFragmentSizeKey);
+    data->add_value(std::to_string(this->msgOpts.FragmentSize()));
+  }
+
+  if (this->msgOpts.Compression() == Compression_t::ZLIB)
+  {
+    auto data = _msg.mutable_header()->add_data();
+    data->set_key(kCompressionKey);
+    data->add_value(kZlibCompression);
+    data->add_value(std::to_string(this->msgOpts.CompressionThreshold()));
+  }
 }
 
 //////////////////////////////////////////////////
@@ -243,6 +290,46 @@ void MessagePublisher::SetFromDiscovery(const msgs::Discovery &_msg)
     this->msgOpts.SetMsgsPerSec(kUnthrottled);
   else
     this->msgOpts.SetMsgsPerSec(_msg.pub().msg_pub().msgs_per_sec());
+
+  this->msgOpts.SetMulticastGroup("");
+  this->msgOpts.SetBestEffort(false);
+  this->msgOpts.SetSubscriberMsgsPerSec(0);
+  this->msgOpts.SetCompactHeader(false);
+  this->msgOpts.SetTrafficClass(TrafficClass_t::DEFAULT);
+  this->msgOpts.SetFragmentSize(0);
+  this->msgOpts.SetCompression(Compression_t::NONE);
+  for (const auto &data : _msg.header().data())
+  {
+    if (data.key() == kMulticastGroupKey && data.value_size() > 0)
+      this->msgOpts.SetMulticastGroup(data.value(0));
+    else if (data.key() == kBestEffortKey)
+      this->msgOpts.SetBestEffort(true);
+    else if (data.key() == kSubscriberRateKey && data.value_size() > 0)
+    {
+      this->msgOpts.SetSubscriberMsgsPerSec(
+        std::strtoull(data.value(0).c_str(), nullptr, 10));
+    }
+    else if (data.key() == kCompactHeaderKey)
+      this->msgOpts.SetCompactHeader(true);
+    else if (data.key() == kTrafficClassKey && data.value_size() > 0)
+    {
+      if (data.value(0) == kBulkClass)
+        this->msgOpts.SetTrafficClass(TrafficClass_t::BULK);
+      else if (data.value(0) == kControlClass)
+        this->msgOpts.SetTrafficClass(TrafficClass_t::CONTROL);
+    }
+    else if (data.key() == kFragmentSizeKey && data.value_size() > 0)
+    {
+      this->msgOpts.SetFragmentSize(
+        std::strtoull(data.value(0).c_str(), nullptr, 10));
+    }
+    else if (data.key() == kCompressionKey && data.value_size() > 1 &&
+             data.value(0) == kZlibCompression)
+    {
+      this->msgOpts.SetCompression(Compression_t::ZLIB,
+        std::strtoull(data.value(1).c_str(), nullptr, 10));
+    }
+  }
 }
 
 //////////////////////////////////////////////////
@@ -18,6 +18,7 @@
 #include <cstdint>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "ignition/transport/AdvertiseOptions.hh"
 #include "ignition/transport/Publisher.hh"
@@ -221,6 +222,33 @@ TEST(PublisherTest, MessagePublisherIO)
   EXPECT_EQ(publisher.NUuid(),       otherPublisher.NUuid());
   EXPECT_EQ(publisher.MsgTypeName(), otherPublisher.MsgTypeName());
   EXPECT_EQ(publisher.Options(),     otherPublisher.Options());
+
+  // Each option travels in the header of the message.
+  std::vector<AdvertiseMessageOptions> optionSets(8, g_msgOpts2);
+  optionSets[0].SetMulticastGroup("239.255.0.8:11320");
+  optionSets[1].SetBestEffort(true);
+  optionSets[2].SetSubscriberMsgsPerSec(5u);
+  optionSets[3].SetCompactHeader(true);
+  optionSets[4].SetTrafficClass(TrafficClass_t::BULK);
+  optionSets[5].SetTrafficClass(TrafficClass_t::CONTROL);
+  optionSets[6].SetFragmentSize(65536u);
+  optionSets[7].SetCompression(Compression_t::ZLIB, 512u);
+
+  for (const auto &opts : optionSets)
+  {
+    publisher.SetOptions(opts);
+    msg.Clear();
+    publisher.FillDiscovery(msg);
+    otherPublisher.SetFromDiscovery(msg);
+    EXPECT_EQ(opts, otherPublisher.Options());
+
+    // And is cleared by a message without it.
+    publisher.SetOptions(g_msgOpts2);
+    msg.Clear();
+    publisher.FillDiscovery(msg);
+    otherPublisher.SetFromDiscovery(msg);
+    EXPECT_EQ(g_msgOpts2, otherPublisher.Options());
+  }
 }
 
 //////////////////////////////////////////////////
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_REALTIMEQUEUE_HH_
+#define IGN_TRANSPORT_REALTIMEQUEUE_HH_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "ignition/transport/config.hh"
+#include "ignition/transport/ThreadConfig.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class RealtimeQueue RealtimeQueue.hh
+    /// \brief A ring of preallocated slots that hands serialized messages
+    /// over from a real-time thread to a transport thread. Push() doesn't
+    /// allocate, doesn't take any lock and doesn't wait: when the ring is
+    /// full, when the message doesn't fit in a slot or when another thread
+    /// is pushing at the same time, the message is dropped and counted.
+    /// The transport thread, created with the queue, runs the consumer
+    /// callback for each message in order, and it is the one that takes
+    /// the locks of the transport.
+    ///
+    /// The transport thread spins for a while before going to sleep, and
+    /// Push() only signals it when it's sleeping, without taking its mutex.
+    /// A signal lost in the instant the thread is going to sleep only
+    /// delays the message until the next poll, see kPollPeriod.
+    class RealtimeQueue
+    {
+      /// \brief Callback that publishes a message.
+      /// \param[in] _data The serialized message.
+      /// \param[in] _size Size of the serialized message (bytes).
+      public: using Consumer =
+        std::function<void(const char *_data, const std::size_t _size)>;
+
+      /// \brief Number of times that the transport thread polls the ring
+      /// before going to sleep.
+      public: static constexpr int kSpinCount = 64;
+
+      /// \brief Maximum time that the transport thread sleeps.
+      public: static constexpr std::chrono::milliseconds kPollPeriod{1};
+
+      /// \brief Constructor. Allocates all the slots and starts the
+      /// transport thread.
+      /// \param[in] _slots Number of slots, at least 1.
+      /// \param[in] _slotSize Size of each slot (bytes), at least 1.
+      /// \param[in] _consumer Callback run by the transport thread.
+      public: RealtimeQueue(const std::size_t _slots,
+                            const std::size_t _slotSize,
+                            Consumer _consumer)
+        : slots(std::max<std::size_t>(_slots, 1u)),
+          slotSize(std::max<std::size_t>(_slotSize, 1u)),
+          storage(new char[this->slots * this->slotSize]),
+          sizes(new std::size_t[this->slots]()),
+          consumer(std::move(_consumer))
+      {
+        this->thread = std::thread(&RealtimeQueue::Run, this);
+      }
+
+      /// \brief Destructor. Publishes the messages still in the ring and
+      /// stops the transport thread. Push() must not be called anymore.
+      public: ~RealtimeQueue()
+      {
+        {
+          std::lock_guard<std::mutex> lk(this->mutex);
+          this->closed.store(true);
+        }
+        this->wakeUp.notify_all();
+        if (this->thread.joinable())
+          this->thread.join();
+      }
+
+      /// \brief No copy constructor.
+      public: RealtimeQueue(const RealtimeQueue &) = delete;
+
+      /// \brief No assignment operator.
+      public: RealtimeQueue &operator=(const RealtimeQueue &) = delete;
+
+      /// \brief Write a message in a free slot and hand it over to the
+      /// transport thread. Safe to call from a real-time thread.
+      /// \param[in] _size Size of the serialized message (bytes).
+      /// \param[in] _write Callable that writes the message in the slot
+      /// passed as a char pointer, returning false on error. It must not
+      /// allocate or block either.
+      /// \return True if the message was queued.
+      public: template<typename WriteT>
+              bool Push(const std::size_t _size, WriteT &&_write)
+      {
+        if (_size > this->slotSize)
+        {
+          this->failed.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+
+        // A single producer writes at a time. The others don't wait for it.
+        if (this->busy.test_and_set(std::memory_order_acquire))
+        {
+          this->dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+
+        const uint64_t index = this->tail.load(std::memory_order_relaxed);
+        if (index - this->head.load(std::memory_order_acquire) >= this->slots)
+        {
+          this->busy.clear(std::memory_order_release);
+          this->dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+
+        const std::size_t slot = static_cast<std::size_t>(index % this->slots);
+        if (!_write(this->storage.get() + slot * this->slotSize))
+        {
+          this->busy.clear(std::memory_order_release);
+          this->failed.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        this->sizes[slot] = _size;
+
+        // Both the store and the load are sequentially consistent, so
+        // either the transport thread sees the message before sleeping or
+        // we see that it is sleeping.
+        this->tail.store(index + 1);
+        this->busy.clear(std::memory_order_release);
+        if (this->sleeping.load())
+          this->wakeUp.notify_one();
+        return true;
+      }
+
+      /// \brief Count a message that was rejected before Push(), e.g. one
+      /// that can't be serialized.
+      public: void CountFailure()
+      {
+        this->failed.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      /// \brief Get the number of messages dropped because the ring was
+      /// full or because another thread was pushing.
+      /// \return The number of messages.
+      public: uint64_t Dropped() const
+      {
+        return this->dropped.load(std::memory_order_relaxed);
+      }
+
+      /// \brief Get the number of messages that failed, because they were
+      /// too big for a slot or couldn't be serialized.
+      /// \return The number of messages.
+      public: uint64_t Failed() const
+      {
+        return this->failed.load(std::memory_order_relaxed);
+      }
+
+      /// \brief Get the size of the slots.
+      /// \return The size (bytes).
+      public: std::size_t SlotSize() const
+      {
+        return this->slotSize;
+      }
+
+      /// \brief Run the consumer callback with the oldest message. Only
+      /// called by the transport thread.
+      /// \return False if the ring was empty.
+      private: bool Pop()
+      {
+        const uint64_t index = this->head.load(std::memory_order_relaxed);
+        if (index == this->tail.load(std::memory_order_acquire))
+          return false;
+
+        const std::size_t slot = static_cast<std::size_t>(index % this->slots);
+        this->consumer(this->storage.get() + slot * this->slotSize,
+          this->sizes[slot]);
+
+        // The slot can be written again.
+        this->head.store(index + 1, std::memory_order_release);
+        return true;
+      }
+
+      /// \brief Check if the ring is empty. Only called by the transport
+      /// thread.
+      /// \return True if the ring is empty.
+      private: bool Empty() const
+      {
+        return this->head.load(std::memory_order_relaxed) ==
+          this->tail.load();
+      }
+
+      /// \brief Body of the transport thread.
+      private: void Run()
+      {
+        ThreadConfig::Global().Apply("ign-rt-publish");
+
+        while (!this->closed.load())
+        {
+          bool popped = false;
+          for (int i = 0; i < kSpinCount && !popped; ++i)
+            popped = this->Pop();
+          if (popped)
+          {
+            while (this->Pop())
+              continue;
+            continue;
+          }
+
+          std::unique_lock<std::mutex> lk(this->mutex);
+          this->sleeping.store(true);
+          this->wakeUp.wait_for(lk, kPollPeriod,
+            [this]{return !this->Empty() || this->closed.load();});
+          this->sleeping.store(false);
+        }
+
+        // Flush the ring.
+        while (this->Pop())
+          continue;
+      }
+
+      /// \brief Number of slots.
+      private: const std::size_t slots;
+
+      /// \brief Size of each slot (bytes).
+      private: const std::size_t slotSize;
+
+      /// \brief Memory of all the slots.
+      private: std::unique_ptr<char[]> storage;
+
+      /// \brief Size of the message in each slot (bytes).
+      private: std::unique_ptr<std::size_t[]> sizes;
+
+      /// \brief Callback that publishes the messages.
+      private: Consumer consumer;
+
+      /// \brief Index of the next message to publish. Only written by the
+      /// transport thread.
+      private: std::atomic<uint64_t> head{0};
+
+      /// \brief Index of the next slot to write. Only written by the
+      /// producer holding busy.
+      private: std::atomic<uint64_t> tail{0};
+
+      /// \brief Set while a producer is writing a slot.
+      private: std::atomic_flag busy = ATOMIC_FLAG_INIT;
+
+      /// \brief Messages dropped by Push().
+      private: std::atomic<uint64_t> dropped{0};
+
+      /// \brief Messages that failed.
+      private: std::atomic<uint64_t> failed{0};
+
+      /// \brief True while the transport thread is sleeping.
+      private: std::atomic<bool> sleeping{false};
+
+      /// \brief True when the queue is being destroyed.
+      private: std::atomic<bool> closed{false};
+
+      /// \brief Mutex used to sleep. Never taken by Push().
+      private: std::mutex mutex;
+
+      /// \brief Used to wake up the transport thread.
+      private: std::condition_variable wakeUp;
+
+      /// \brief The transport thread.
+      private: std::thread thread;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RealtimeQueue.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Write a string in a slot.
+/// \param[in] _str The string.
+/// \return The writer passed to RealtimeQueue::Push().
+auto Writer(const std::string &_str)
+{
+  return [&_str](char *_slot)
+  {
+    std::memcpy(_slot, _str.data(), _str.size());
+    return true;
+  };
+}
+
+//////////////////////////////////////////////////
+/// \brief The messages are published in order by the transport thread.
+TEST(RealtimeQueueTest, Order)
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::string> received;
+  std::thread::id consumerId;
+
+  {
+    RealtimeQueue queue(4, 16,
+      [&](const char *_data, const std::size_t _size)
+      {
+        std::lock_guard<std::mutex> lk(mutex);
+        consumerId = std::this_thread::get_id();
+        received.emplace_back(_data, _size);
+        cv.notify_all();
+      });
+    EXPECT_EQ(16u, queue.SlotSize());
+
+    for (int i = 0; i < 100; ++i)
+    {
+      const std::string msg = "msg " + std::to_string(i);
+
+      // Wait for a free slot, so nothing is dropped.
+      while (!queue.Push(msg.size(), Writer(msg)))
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(cv.wait_for(lk, std::chrono::seconds(5),
+      [&received]{return received.size() == 100u;}));
+    EXPECT_EQ(0u, queue.Failed());
+  }
+
+  ASSERT_EQ(100u, received.size());
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ("msg " + std::to_string(i), received[i]);
+  EXPECT_NE(std::this_thread::get_id(), consumerId);
+}
+
+//////////////////////////////////////////////////
+/// \brief The messages that don't fit are dropped and counted.
+TEST(RealtimeQueueTest, Failures)
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool consuming = false;
+  bool release = false;
+  std::atomic<int> received{0};
+
+  RealtimeQueue queue(2, 8,
+    [&](const char *, const std::size_t)
+    {
+      std::unique_lock<std::mutex> lk(mutex);
+      consuming = true;
+      cv.notify_all();
+      cv.wait(lk, [&release]{return release;});
+      ++received;
+    });
+
+  const std::string msg = "msg";
+  const std::string big = "a message too big";
+
+  EXPECT_FALSE(queue.Push(big.size(), Writer(big)));
+  EXPECT_EQ(1u, queue.Failed());
+
+  EXPECT_FALSE(queue.Push(msg.size(), [](char *) {return false;}));
+  EXPECT_EQ(2u, queue.Failed());
+
+  queue.CountFailure();
+  EXPECT_EQ(3u, queue.Failed());
+  EXPECT_EQ(0u, queue.Dropped());
+
+  // The first message holds its slot while the consumer is busy with it.
+  EXPECT_TRUE(queue.Push(msg.size(), Writer(msg)));
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    ASSERT_TRUE(cv.wait_for(lk, std::chrono::seconds(5),
+      [&consuming]{return consuming;}));
+  }
+  EXPECT_TRUE(queue.Push(msg.size(), Writer(msg)));
+  EXPECT_FALSE(queue.Push(msg.size(), Writer(msg)));
+  EXPECT_EQ(1u, queue.Dropped());
+
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    release = true;
+  }
+  cv.notify_all();
+
+  // The ring drains and accepts messages again.
+  for (int i = 0; i < 500 && received < 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_TRUE(queue.Push(msg.size(), Writer(msg)));
+  for (int i = 0; i < 500 && received < 3; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(3, received);
+  EXPECT_EQ(1u, queue.Dropped());
+  EXPECT_EQ(3u, queue.Failed());
+}
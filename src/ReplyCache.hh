@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#ifndef IGN_TRANSPORT_REPLYCACHE_HH_
+#define IGN_TRANSPORT_REPLYCACHE_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class ReplyCache ReplyCache.hh
+    /// \brief The responses of the services advertised as cacheable, see
+    /// AdvertiseServiceOptions::SetReplyCacheTtl(), indexed by the bytes of
+    /// their requests. A request that was already answered is served from
+    /// the cache, without running the callback of the service, until its
+    /// response expires. The least recently stored responses are evicted
+    /// once the cache holds too many bytes. This class is thread safe.
+    class ReplyCache
+    {
+      /// \brief Clock used to expire the responses.
+      public: using Clock = std::chrono::steady_clock;
+
+      /// \brief Default maximum size of the responses (bytes).
+      public: static constexpr std::size_t kDefaultMaxBytes = 64u << 20;
+
+      /// \brief Constructor.
+      /// \param[in] _maxBytes Maximum size of the cached responses (bytes).
+      public: explicit ReplyCache(
+        const std::size_t _maxBytes = kDefaultMaxBytes)
+        : maxBytes(_maxBytes)
+      {
+      }
+
+      /// \brief Get the cached response of a request.
+      /// \param[in] _topic Service name.
+      /// \param[in] _key The replier handler and the serialized request, see
+      /// Key().
+      /// \param[out] _rep The serialized response.
+      /// \param[in] _now Current time.
+      /// \return True if the response was found and hasn't expired.
+      public: bool Find(const std::string &_topic, const std::string &_key,
+                        std::string &_rep,
+                        const Clock::time_point _now = Clock::now())
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        auto topicIt = this->topics.find(_topic);
+        if (topicIt == this->topics.end())
+          return false;
+
+        auto entryIt = topicIt->second.find(_key);
+        if (entryIt == topicIt->second.end())
+          return false;
+
+        if (_now >= entryIt->second.expiry)
+        {
+          this->Erase(topicIt, entryIt);
+          return false;
+        }
+
+        _rep = entryIt->second.rep;
+        return true;
+      }
+
+      /// \brief Store the response of a request.
+      /// \param[in] _topic Service name.
+      /// \param[in] _key The replier handler and the serialized request, see
+      /// Key().
+      /// \param[in] _rep The serialized response.
+      /// \param[in] _ttl Time during which the response is served.
+      /// \param[in] _now Current time.
+      public: void Store(const std::string &_topic, const std::string &_key,
+                         const std::string &_rep, const Clock::duration _ttl,
+                         const Clock::time_point _now = Clock::now())
+      {
+        const std::size_t entryBytes = _key.size() + _rep.size();
+        if (_ttl <= Clock::duration::zero() || entryBytes > this->maxBytes)
+          return;
+
+        std::lock_guard<std::mutex> lk(this->mutex);
+        auto &entries = this->topics[_topic];
+        auto entryIt = entries.find(_key);
+        if (entryIt != entries.end())
+        {
+          this->bytes -= entryIt->second.rep.size();
+          this->order.erase(entryIt->second.position);
+        }
+        else
+        {
+          entryIt = entries.emplace(_key, Entry()).first;
+          this->bytes += _key.size();
+        }
+
+        entryIt->second.rep = _rep;
+        entryIt->second.expiry = _now + _ttl;
+        entryIt->second.position =
+          this->order.insert(this->order.end(), {_topic, &entryIt->first});
+        this->bytes += _rep.size();
+
+        // Evict the oldest responses, which may include this one's topic.
+        while (this->bytes > this->maxBytes)
+        {
+          const auto oldest = this->order.front();
+          auto topicIt = this->topics.find(oldest.first);
+          this->Erase(topicIt, topicIt->second.find(*oldest.second));
+        }
+      }
+
+      /// \brief Remove the responses of a service, e.g.: because it was
+      /// unadvertised.
+      /// \param[in] _topic Service name.
+      public: void Clear(const std::string &_topic)
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        auto topicIt = this->topics.find(_topic);
+        if (topicIt == this->topics.end())
+          return;
+
+        for (const auto &entry : topicIt->second)
+        {
+          this->bytes -= entry.first.size() + entry.second.rep.size();
+          this->order.erase(entry.second.position);
+        }
+        this->topics.erase(topicIt);
+      }
+
+      /// \brief Get the number of cached responses.
+      /// \return The number of responses.
+      public: std::size_t Size() const
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        return this->order.size();
+      }
+
+      /// \brief Get the size of the cached responses and of their keys.
+      /// \return The size (bytes).
+      public: std::size_t Bytes() const
+      {
+        std::lock_guard<std::mutex> lk(this->mutex);
+        return this->bytes;
+      }
+
+      /// \brief Build the key of a request.
+      /// \param[in] _handlerUuid UUID of the replier handler, which also
+      /// identifies the request and response types.
+      /// \param[in] _req The serialized request.
+      /// \return The key.
+      public: static std::string Key(const std::string &_handlerUuid,
+                                     const std::string &_req)
+      {
+        std::string key;
+        key.reserve(_handlerUuid.size() + 1 + _req.size());
+        key.append(_handlerUuid).append(1, '\0').append(_req);
+        return key;
+      }
+
+      /// \brief A cached response.
+      private: struct Entry
+      {
+        /// \brief The serialized response.
+        std::string rep;
+
+        /// \brief Time after which the response isn't served.
+        Clock::time_point expiry;
+
+        /// \brief Position of the entry in order.
+        std::list<std::pair<std::string, const std::string *>>::iterator
+          position;
+      };
+
+      /// \brief Responses of each service, indexed by their keys.
+      private: using Entries = std::unordered_map<std::string, Entry>;
+
+      /// \brief Remove a response. Must be called with mutex locked.
+      /// \param[in] _topicIt The service of the response.
+      /// \param[in] _entryIt The response.
+      private: void Erase(
+        std::unordered_map<std::string, Entries>::iterator _topicIt,
+        Entries::iterator _entryIt)
+      {
+        this->bytes -= _entryIt->first.size() + _entryIt->second.rep.size();
+        this->order.erase(_entryIt->second.position);
+        _topicIt->second.erase(_entryIt);
+        if (_topicIt->second.empty())
+          this->topics.erase(_topicIt);
+      }
+
+      /// \brief Maximum size of the responses and their keys (bytes).
+      private: const std::size_t maxBytes;
+
+      /// \brief Protects the members below.
+      private: mutable std::mutex mutex;
+
+      /// \brief Responses of each service.
+      private: std::unordered_map<std::string, Entries> topics;
+
+      /// \brief Service and key of the responses, from the least recently
+      /// stored. The keys point into topics, whose nodes don't move.
+      private: std::list<std::pair<std::string, const std::string *>> order;
+
+      /// \brief Size of the responses and their keys (bytes).
+      private: std::size_t bytes = 0;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <chrono>
+#include <string>
+
+#include "ReplyCache.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+/// \brief The responses are served until they expire.
+TEST(ReplyCacheTest, Expiry)
+{
+  ReplyCache cache;
+  const auto now = ReplyCache::Clock::now();
+  const std::string key = ReplyCache::Key("handler", "request");
+  EXPECT_NE(ReplyCache::Key("handler", "request2"), key);
+  EXPECT_NE(ReplyCache::Key("handler2", "request"), key);
+
+  std::string rep;
+  EXPECT_FALSE(cache.Find("/srv", key, rep, now));
+
+  // A response without a time to live isn't stored.
+  cache.Store("/srv", key, "response", 0s, now);
+  EXPECT_EQ(0u, cache.Size());
+
+  cache.Store("/srv", key, "response", 1s, now);
+  EXPECT_EQ(1u, cache.Size());
+  EXPECT_EQ(key.size() + 8u, cache.Bytes());
+  ASSERT_TRUE(cache.Find("/srv", key, rep, now + 999ms));
+  EXPECT_EQ("response", rep);
+  EXPECT_FALSE(cache.Find("/other", key, rep, now));
+
+  // Storing again replaces the response and its expiry.
+  cache.Store("/srv", key, "new", 2s, now);
+  EXPECT_EQ(1u, cache.Size());
+  EXPECT_EQ(key.size() + 3u, cache.Bytes());
+  ASSERT_TRUE(cache.Find("/srv", key, rep, now + 1500ms));
+  EXPECT_EQ("new", rep);
+
+  // The expired responses are removed when they are looked up.
+  EXPECT_FALSE(cache.Find("/srv", key, rep, now + 2s));
+  EXPECT_EQ(0u, cache.Size());
+  EXPECT_EQ(0u, cache.Bytes());
+}
+
+//////////////////////////////////////////////////
+/// \brief The oldest responses are evicted to respect the maximum size,
+/// and the responses of a service are cleared together.
+TEST(ReplyCacheTest, Eviction)
+{
+  ReplyCache cache(30);
+  const auto now = ReplyCache::Clock::now();
+  std::string rep;
+
+  // Too big to be cached at all.
+  cache.Store("/srv", "key", std::string(28, 'x'), 1s, now);
+  EXPECT_EQ(0u, cache.Size());
+
+  cache.Store("/a", "k1", "0123456789", 1s, now);
+  cache.Store("/b", "k2", "0123456789", 1s, now);
+  EXPECT_EQ(2u, cache.Size());
+  EXPECT_EQ(24u, cache.Bytes());
+
+  cache.Store("/a", "k3", "0123456789", 1s, now);
+  EXPECT_EQ(2u, cache.Size());
+  EXPECT_FALSE(cache.Find("/a", "k1", rep, now));
+  EXPECT_TRUE(cache.Find("/b", "k2", rep, now));
+  EXPECT_TRUE(cache.Find("/a", "k3", rep, now));
+
+  cache.Clear("/a");
+  cache.Clear("/missing");
+  EXPECT_EQ(1u, cache.Size());
+  EXPECT_EQ(12u, cache.Bytes());
+  EXPECT_FALSE(cache.Find("/a", "k3", rep, now));
+  EXPECT_TRUE(cache.Find("/b", "k2", rep, now));
+}
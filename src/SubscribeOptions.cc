@@ -15,7 +15,10 @@
  *
 */
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <string>
 
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/SubscribeOptions.hh"
@@ -36,6 +39,13 @@ SubscribeOptions::SubscribeOptions(const SubscribeOptions &_otherSubscribeOpts)
   : dataPtr(new SubscribeOptionsPrivate())
 {
   this->SetMsgsPerSec(_otherSubscribeOpts.MsgsPerSec());
+  this->SetQueueSize(_otherSubscribeOpts.QueueSize());
+  this->SetFilter(_otherSubscribeOpts.Filter());
+  this->SetProgressCallback(_otherSubscribeOpts.ProgressCallback());
+  this->SetBestEffort(_otherSubscribeOpts.BestEffort());
+  this->SetCallbackGroup(_otherSubscribeOpts.CallbackGroup());
+  this->SetInlineDelivery(_otherSubscribeOpts.InlineDelivery());
+  this->SetLifespan(_otherSubscribeOpts.Lifespan());
 }
 
 //////////////////////////////////////////////////
@@ -60,3 +70,88 @@ void SubscribeOptions::SetMsgsPerSec(const uint64_t _newMsgsPerSec)
 {
   this->dataPtr->msgsPerSec = _newMsgsPerSec;
 }
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetQueueSize(const uint64_t _size)
+{
+  this->dataPtr->queueSize = _size;
+}
+
+//////////////////////////////////////////////////
+uint64_t SubscribeOptions::QueueSize() const
+{
+  return this->dataPtr->queueSize;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetFilter(const MessageFilter &_filter)
+{
+  this->dataPtr->filter = _filter;
+}
+
+//////////////////////////////////////////////////
+const MessageFilter &SubscribeOptions::Filter() const
+{
+  return this->dataPtr->filter;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetProgressCallback(const MessageProgressCallback &_cb)
+{
+  this->dataPtr->progressCb = _cb;
+}
+
+//////////////////////////////////////////////////
+const MessageProgressCallback &SubscribeOptions::ProgressCallback() const
+{
+  return this->dataPtr->progressCb;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetBestEffort(const bool _bestEffort)
+{
+  this->dataPtr->bestEffort = _bestEffort;
+}
+
+//////////////////////////////////////////////////
+bool SubscribeOptions::BestEffort() const
+{
+  return this->dataPtr->bestEffort;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetCallbackGroup(const std::string &_group)
+{
+  this->dataPtr->callbackGroup = _group;
+}
+
+//////////////////////////////////////////////////
+const std::string &SubscribeOptions::CallbackGroup() const
+{
+  return this->dataPtr->callbackGroup;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetInlineDelivery(const bool _inline)
+{
+  this->dataPtr->inlineDelivery = _inline;
+}
+
+//////////////////////////////////////////////////
+bool SubscribeOptions::InlineDelivery() const
+{
+  return this->dataPtr->inlineDelivery;
+}
+
+//////////////////////////////////////////////////
+void SubscribeOptions::SetLifespan(const std::chrono::nanoseconds &_lifespan)
+{
+  this->dataPtr->lifespan =
+    std::max(_lifespan, std::chrono::nanoseconds::zero());
+}
+
+//////////////////////////////////////////////////
+std::chrono::nanoseconds SubscribeOptions::Lifespan() const
+{
+  return this->dataPtr->lifespan;
+}
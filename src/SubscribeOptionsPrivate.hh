@@ -18,9 +18,12 @@
 #ifndef IGN_TRANSPORT_SUBSCRIBEOPTIONSPRIVATE_HH_
 #define IGN_TRANSPORT_SUBSCRIBEOPTIONSPRIVATE_HH_
 
+#include <chrono>
 #include <cstdint>
+#include <string>
 
 #include "ignition/transport/Helpers.hh"
+#include "ignition/transport/SubscribeOptions.hh"
 
 namespace ignition
 {
@@ -41,6 +44,28 @@ namespace ignition
 
       /// \brief Default message subscription rate.
       public: uint64_t msgsPerSec = kUnthrottled;
+
+      /// \brief Size of the keep last queue. 0 means no queue.
+      public: uint64_t queueSize = 0;
+
+      /// \brief Message filter. Empty if all the messages are accepted.
+      public: MessageFilter filter;
+
+      /// \brief Progress callback of the fragmented messages. Empty if not
+      /// reported.
+      public: MessageProgressCallback progressCb;
+
+      /// \brief Whether best effort delivery is requested.
+      public: bool bestEffort = false;
+
+      /// \brief Name of the callback group, empty for none.
+      public: std::string callbackGroup;
+
+      /// \brief Whether the local messages are delivered inline.
+      public: bool inlineDelivery = false;
+
+      /// \brief Lifespan of the messages, zero if they don't expire.
+      public: std::chrono::nanoseconds lifespan{0};
     };
     }
   }
@@ -15,6 +15,8 @@
  *
 */
 
+#include <chrono>
+
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/SubscribeOptions.hh"
 #include "ignition/transport/test_config.h"
@@ -43,6 +45,80 @@ TEST(SubscribeOptionsTest, accessors)
   EXPECT_EQ(opts.MsgsPerSec(), kUnthrottled);
   opts.SetMsgsPerSec(3u);
   EXPECT_EQ(opts.MsgsPerSec(), 3u);
+
+  // QueueSize.
+  EXPECT_EQ(opts.QueueSize(), 0u);
+  opts.SetQueueSize(1u);
+  EXPECT_EQ(opts.QueueSize(), 1u);
+
+  SubscribeOptions opts2(opts);
+  EXPECT_EQ(opts2.QueueSize(), 1u);
+
+  // Filter.
+  EXPECT_FALSE(opts.Filter());
+  opts.SetFilter([](const char *, const size_t _size, const MessageInfo &)
+    {
+      return _size > 1u;
+    });
+  ASSERT_TRUE(opts.Filter());
+  MessageInfo info;
+  EXPECT_FALSE(opts.Filter()("a", 1u, info));
+  EXPECT_TRUE(opts.Filter()("ab", 2u, info));
+
+  SubscribeOptions opts3(opts);
+  ASSERT_TRUE(opts3.Filter());
+  EXPECT_TRUE(opts3.Filter()("ab", 2u, info));
+
+  // Progress callback.
+  EXPECT_FALSE(opts.ProgressCallback());
+  uint64_t progress = 0;
+  opts.SetProgressCallback(
+    [&progress](const MessageInfo &, const uint64_t _received,
+      const uint64_t)
+    {
+      progress = _received;
+    });
+  ASSERT_TRUE(opts.ProgressCallback());
+
+  SubscribeOptions opts5(opts);
+  ASSERT_TRUE(opts5.ProgressCallback());
+  opts5.ProgressCallback()(info, 10u, 20u);
+  EXPECT_EQ(10u, progress);
+
+  // Best effort.
+  EXPECT_FALSE(opts.BestEffort());
+  opts.SetBestEffort(true);
+  EXPECT_TRUE(opts.BestEffort());
+
+  SubscribeOptions opts4(opts);
+  EXPECT_TRUE(opts4.BestEffort());
+
+  // Callback group.
+  EXPECT_TRUE(opts.CallbackGroup().empty());
+  opts.SetCallbackGroup("planning");
+  EXPECT_EQ("planning", opts.CallbackGroup());
+
+  SubscribeOptions opts6(opts);
+  EXPECT_EQ("planning", opts6.CallbackGroup());
+
+  // Inline delivery.
+  EXPECT_FALSE(opts.InlineDelivery());
+  opts.SetInlineDelivery(true);
+  EXPECT_TRUE(opts.InlineDelivery());
+
+  SubscribeOptions opts7(opts);
+  EXPECT_TRUE(opts7.InlineDelivery());
+
+  // Lifespan.
+  EXPECT_EQ(std::chrono::nanoseconds::zero(), opts.Lifespan());
+  opts.SetLifespan(std::chrono::milliseconds(200));
+  EXPECT_EQ(std::chrono::milliseconds(200), opts.Lifespan());
+
+  SubscribeOptions opts8(opts);
+  EXPECT_EQ(std::chrono::milliseconds(200), opts8.Lifespan());
+
+  opts.SetLifespan(std::chrono::seconds(-1));
+  EXPECT_EQ(std::chrono::nanoseconds::zero(), opts.Lifespan());
 }
 
 //////////////////////////////////////////////////
@@ -15,6 +15,17 @@
  *
 */
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>  //NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "ignition/transport/SubscriptionHandler.hh"
 
 namespace ignition
@@ -30,13 +41,30 @@ namespace ignition
       : opts(_opts),
         periodNs(0.0),
         hUuid(Uuid().ToString()),
-        lastCbTimestamp(std::chrono::seconds{0}),
         nUuid(_nUuid)
     {
       if (this->opts.Throttled())
         this->periodNs = 1e9 / this->opts.MsgsPerSec();
     }
 
+    /////////////////////////////////////////////////
+    CallbackTrace &SubscriptionHandlerBase::Trace() const
+    {
+      return this->trace;
+    }
+
+    /////////////////////////////////////////////////
+    uint64_t SubscriptionHandlerBase::DroppedMsgCount() const
+    {
+      return this->droppedMsgs.load(std::memory_order_relaxed);
+    }
+
+    /////////////////////////////////////////////////
+    void SubscriptionHandlerBase::AddDroppedMsgs(const uint64_t _count) const
+    {
+      this->droppedMsgs.fetch_add(_count, std::memory_order_relaxed);
+    }
+
     /////////////////////////////////////////////////
     std::string SubscriptionHandlerBase::NodeUuid() const
     {
@@ -50,24 +78,176 @@ namespace ignition
     }
 
     /////////////////////////////////////////////////
-    bool SubscriptionHandlerBase::UpdateThrottling()
+    uint64_t SubscriptionHandlerBase::QueueSize() const
     {
-      if (!this->opts.Throttled())
+      return this->opts.QueueSize();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::Deferred() const
+    {
+      return this->opts.QueueSize() > 0 || !this->opts.CallbackGroup().empty();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::Inline() const
+    {
+      return this->opts.InlineDelivery() && !this->Deferred();
+    }
+
+    /////////////////////////////////////////////////
+    std::string SubscriptionHandlerBase::ExecutorKey() const
+    {
+      // The prefix keeps the groups apart from the handler UUIDs.
+      if (!this->opts.CallbackGroup().empty())
+        return "group#" + this->opts.CallbackGroup();
+      return this->hUuid;
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::BestEffort() const
+    {
+      return this->opts.BestEffort();
+    }
+
+    /////////////////////////////////////////////////
+    uint64_t SubscriptionHandlerBase::MsgsPerSec() const
+    {
+      return this->opts.MsgsPerSec();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::AcceptsType(const std::string &_type) const
+    {
+      return this->generic || _type == this->typeName;
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::Accepts(const ProtoMsg &_msg) const
+    {
+      if (this->generic)
         return true;
 
-      Timestamp now = std::chrono::steady_clock::now();
+      const google::protobuf::Descriptor *desc = _msg.GetDescriptor();
+      if (desc == this->descriptor)
+        return true;
 
-      // Elapsed time since the last callback execution.
-      auto elapsed = now - this->lastCbTimestamp;
+      // Dynamic messages have their own descriptors.
+      return desc && desc->full_name() == this->typeName;
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::HasFilter() const
+    {
+      return static_cast<bool>(this->opts.Filter());
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::Expired(const MessageInfo &_info) const
+    {
+      const std::chrono::nanoseconds lifespan = this->opts.Lifespan();
+      if (lifespan == std::chrono::nanoseconds::zero())
+        return false;
 
-      if (std::chrono::duration_cast<std::chrono::nanoseconds>(
-            elapsed).count() < this->periodNs)
+      // Publishers of older versions don't send the publication time.
+      const std::chrono::system_clock::time_point sent =
+        _info.SendSystemTime();
+      if (sent == std::chrono::system_clock::time_point() ||
+          std::chrono::system_clock::now() - sent <= lifespan)
       {
         return false;
       }
 
-      // Update the last callback execution.
-      this->lastCbTimestamp = now;
+      this->AddDroppedMsgs(1);
+      return true;
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::Filter(const char *_msgData,
+        const size_t _size, const MessageInfo &_info) const
+    {
+      const MessageFilter &filter = this->opts.Filter();
+      if (!filter)
+        return true;
+
+      try
+      {
+        return filter(_msgData, _size, _info);
+      }
+      catch (...)
+      {
+        std::cerr << "Exception occurred in a message filter on topic ["
+                  << _info.Topic() << "]" << std::endl;
+        return false;
+      }
+    }
+
+    /////////////////////////////////////////////////
+    void SubscriptionHandlerBase::ReportProgress(const MessageInfo &_info,
+        const uint64_t _received, const uint64_t _total) const
+    {
+      const MessageProgressCallback &cb = this->opts.ProgressCallback();
+      if (!cb)
+        return;
+
+      try
+      {
+        cb(_info, _received, _total);
+      }
+      catch (...)
+      {
+        std::cerr << "Exception occurred in a progress callback on topic ["
+                  << _info.Topic() << "]" << std::endl;
+      }
+    }
+
+    /////////////////////////////////////////////////
+    void SubscriptionHandlerBase::SetType(const std::string &_typeName,
+        const google::protobuf::Descriptor *_descriptor)
+    {
+      this->typeName = _typeName;
+      this->descriptor = _descriptor;
+      this->generic = (_typeName == kGenericMessageType);
+    }
+
+    /////////////////////////////////////////////////
+    /// \brief Get the current time of the steady clock in nanoseconds.
+    /// \return The time.
+    static int64_t steadyNowNs()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::ThrottledUpdateReady() const
+    {
+      if (!this->opts.Throttled())
+        return true;
+
+      const int64_t elapsed = steadyNowNs() -
+        this->lastCbTimestamp.load(std::memory_order_relaxed);
+      return static_cast<double>(elapsed) >= this->periodNs;
+    }
+
+    /////////////////////////////////////////////////
+    bool SubscriptionHandlerBase::UpdateThrottling()
+    {
+      if (!this->opts.Throttled())
+        return true;
+
+      const int64_t now = steadyNowNs();
+
+      // Update the last callback execution, unless another thread ran the
+      // callback within the period.
+      int64_t last = this->lastCbTimestamp.load(std::memory_order_relaxed);
+      do
+      {
+        if (static_cast<double>(now - last) < this->periodNs)
+          return false;
+      }
+      while (!this->lastCbTimestamp.compare_exchange_weak(last, now,
+               std::memory_order_relaxed));
       return true;
     }
 
@@ -80,6 +260,58 @@ namespace ignition
       // Do nothing
     }
 
+    /////////////////////////////////////////////////
+    const ProtoMsg *ISubscriptionHandler::Prototype(const std::string &_type)
+    {
+      // Prototypes indexed by type name. Unknown types aren't cached: they
+      // may be registered later (e.g. by a plugin), and the names received
+      // from the wire would grow the cache without limit.
+      static std::unordered_map<std::string, const ProtoMsg *> prototypes;
+      // Prototypes created with the Ignition Msgs factory, owned by us.
+      static std::vector<std::unique_ptr<ProtoMsg>> owned;
+      static std::shared_mutex mutex;
+
+      {
+        std::shared_lock<std::shared_mutex> lk(mutex);
+        auto it = prototypes.find(_type);
+        if (it != prototypes.end())
+          return it->second;
+      }
+
+      std::unique_lock<std::shared_mutex> lk(mutex);
+      auto it = prototypes.find(_type);
+      if (it != prototypes.end())
+        return it->second;
+
+      const ProtoMsg *prototype = nullptr;
+
+      // First, check if we have the descriptor from the generated proto
+      // classes.
+      const google::protobuf::Descriptor *desc =
+        google::protobuf::DescriptorPool::generated_pool()
+          ->FindMessageTypeByName(_type);
+      if (desc)
+      {
+        prototype =
+          google::protobuf::MessageFactory::generated_factory()->GetPrototype(
+            desc);
+      }
+      else
+      {
+        // Fallback on Ignition Msgs if the message type is not found.
+        auto msg = ignition::msgs::Factory::New(_type);
+        if (msg)
+        {
+          prototype = msg.get();
+          owned.push_back(std::move(msg));
+        }
+      }
+
+      if (prototype)
+        prototypes.emplace(_type, prototype);
+      return prototype;
+    }
+
     /////////////////////////////////////////////////
     class RawSubscriptionHandler::Implementation
     {
@@ -102,7 +334,7 @@ namespace ignition
       : SubscriptionHandlerBase(_nUuid, _opts),
         pimpl(new Implementation(_msgType))
     {
-      // Do nothing
+      this->SetType(_msgType);
     }
 
     /////////////////////////////////////////////////
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/SubscriptionHandler.hh"
+#include "ignition/transport/TransportTypes.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+static const std::string g_nUuid = "node-UUID"; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Check that a typed handler can create a message from a view of
+/// its serialized data.
+TEST(SubscriptionHandlerTest, CreateMsgFromBuffer)
+{
+  transport::SubscriptionHandler<msgs::Int32> handler(g_nUuid);
+
+  msgs::Int32 msg;
+  msg.set_data(42);
+  std::string data;
+  ASSERT_TRUE(msg.SerializeToString(&data));
+
+  auto created = handler.CreateMsg(data.data(), data.size(),
+    msg.GetTypeName());
+  ASSERT_NE(nullptr, created);
+  auto typed = std::dynamic_pointer_cast<msgs::Int32>(created);
+  ASSERT_NE(nullptr, typed);
+  EXPECT_EQ(42, typed->data());
+
+  // The std::string overload should produce the same message.
+  created = handler.CreateMsg(data, msg.GetTypeName());
+  typed = std::dynamic_pointer_cast<msgs::Int32>(created);
+  ASSERT_NE(nullptr, typed);
+  EXPECT_EQ(42, typed->data());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a generic handler can create a message from a view of
+/// its serialized data.
+TEST(SubscriptionHandlerTest, GenericCreateMsgFromBuffer)
+{
+  transport::SubscriptionHandler<transport::ProtoMsg> handler(g_nUuid);
+
+  msgs::StringMsg msg;
+  msg.set_data("hello");
+  std::string data;
+  ASSERT_TRUE(msg.SerializeToString(&data));
+
+  auto created = handler.CreateMsg(data.data(), data.size(),
+    msg.GetTypeName());
+  ASSERT_NE(nullptr, created);
+  EXPECT_EQ(msg.GetTypeName(), created->GetTypeName());
+  EXPECT_EQ(msg.DebugString(), created->DebugString());
+
+  // The message is an instance of the generated class, so it can be shared
+  // with typed handlers.
+  auto typed = std::dynamic_pointer_cast<msgs::StringMsg>(created);
+  ASSERT_NE(nullptr, typed);
+  EXPECT_EQ("hello", typed->data());
+
+  // The second creation uses the cached prototype and returns a new message.
+  auto again = handler.CreateMsg(data.data(), data.size(), msg.GetTypeName());
+  ASSERT_NE(nullptr, again);
+  EXPECT_NE(created.get(), again.get());
+  EXPECT_EQ(msg.DebugString(), again->DebugString());
+
+  // Unknown types can't be created, not even once cached.
+  for (int i = 0; i < 2; ++i)
+  {
+    EXPECT_EQ(nullptr, handler.CreateMsg(data.data(), data.size(),
+      "ignition.msgs.DoesNotExist"));
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the message type matching of the handlers.
+TEST(SubscriptionHandlerTest, AcceptsType)
+{
+  msgs::Int32 intMsg;
+  msgs::StringMsg strMsg;
+
+  transport::SubscriptionHandler<msgs::Int32> typed(g_nUuid);
+  EXPECT_EQ(intMsg.GetTypeName(), typed.TypeName());
+  EXPECT_TRUE(typed.AcceptsType(intMsg.GetTypeName()));
+  EXPECT_FALSE(typed.AcceptsType(strMsg.GetTypeName()));
+  EXPECT_FALSE(typed.AcceptsType(transport::kGenericMessageType));
+  EXPECT_TRUE(typed.Accepts(intMsg));
+  EXPECT_FALSE(typed.Accepts(strMsg));
+
+  transport::SubscriptionHandler<transport::ProtoMsg> generic(g_nUuid);
+  EXPECT_EQ(transport::kGenericMessageType, generic.TypeName());
+  EXPECT_TRUE(generic.AcceptsType(intMsg.GetTypeName()));
+  EXPECT_TRUE(generic.AcceptsType(strMsg.GetTypeName()));
+  EXPECT_TRUE(generic.Accepts(intMsg));
+
+  transport::RawSubscriptionHandler raw(g_nUuid, strMsg.GetTypeName());
+  EXPECT_TRUE(raw.AcceptsType(strMsg.GetTypeName()));
+  EXPECT_FALSE(raw.AcceptsType(intMsg.GetTypeName()));
+  EXPECT_TRUE(raw.Accepts(strMsg));
+  EXPECT_FALSE(raw.Accepts(intMsg));
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the count of the messages lost by a handler.
+TEST(SubscriptionHandlerTest, DroppedMsgCount)
+{
+  transport::SubscriptionHandler<msgs::Int32> handler(g_nUuid);
+  EXPECT_EQ(0u, handler.DroppedMsgCount());
+
+  handler.AddDroppedMsgs(3);
+  handler.AddDroppedMsgs(1);
+  EXPECT_EQ(4u, handler.DroppedMsgCount());
+
+  transport::RawSubscriptionHandler raw(g_nUuid);
+  EXPECT_EQ(0u, raw.DroppedMsgCount());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the executor keys of the handlers with and without a
+/// callback group.
+TEST(SubscriptionHandlerTest, CallbackGroup)
+{
+  transport::SubscriptionHandler<msgs::Int32> handler(g_nUuid);
+  EXPECT_FALSE(handler.Deferred());
+  EXPECT_EQ(handler.HandlerUuid(), handler.ExecutorKey());
+
+  transport::SubscribeOptions opts;
+  opts.SetQueueSize(2);
+  transport::SubscriptionHandler<msgs::Int32> queued(g_nUuid, opts);
+  EXPECT_TRUE(queued.Deferred());
+  EXPECT_EQ(queued.HandlerUuid(), queued.ExecutorKey());
+
+  // The handlers of a group share their key, whatever their node.
+  opts.SetQueueSize(0);
+  opts.SetCallbackGroup("planning");
+  transport::SubscriptionHandler<msgs::Int32> grouped1(g_nUuid, opts);
+  transport::RawSubscriptionHandler grouped2("other-node-UUID",
+    transport::kGenericMessageType, opts);
+  EXPECT_TRUE(grouped1.Deferred());
+  EXPECT_TRUE(grouped2.Deferred());
+  EXPECT_EQ(grouped1.ExecutorKey(), grouped2.ExecutorKey());
+  EXPECT_NE(grouped1.HandlerUuid(), grouped1.ExecutorKey());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the throttling can be checked before a message is
+/// deserialized, without counting it.
+TEST(SubscriptionHandlerTest, ThrottledUpdateReady)
+{
+  transport::SubscribeOptions opts;
+  opts.SetMsgsPerSec(1u);
+  transport::SubscriptionHandler<msgs::Int32> handler(g_nUuid, opts);
+  int executed = 0;
+  auto cb = [&executed](const msgs::Int32 &, const transport::MessageInfo &)
+    {
+      ++executed;
+    };
+  handler.SetCallback(cb);
+
+  msgs::Int32 msg;
+  transport::MessageInfo info;
+  EXPECT_TRUE(handler.ThrottledUpdateReady());
+  EXPECT_TRUE(handler.ThrottledUpdateReady());
+  EXPECT_TRUE(handler.RunLocalCallback(msg, info));
+  EXPECT_EQ(1, executed);
+
+  // The period hasn't elapsed.
+  EXPECT_FALSE(handler.ThrottledUpdateReady());
+  EXPECT_TRUE(handler.RunLocalCallback(msg, info));
+  EXPECT_EQ(1, executed);
+
+  transport::SubscriptionHandler<msgs::Int32> unthrottled(g_nUuid);
+  unthrottled.SetCallback(cb);
+  EXPECT_TRUE(unthrottled.RunLocalCallback(msg, info));
+  EXPECT_TRUE(unthrottled.ThrottledUpdateReady());
+  EXPECT_EQ(2, executed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the messages older than the lifespan expire, and are
+/// counted as dropped.
+TEST(SubscriptionHandlerTest, Expired)
+{
+  transport::SubscribeOptions opts;
+  opts.SetLifespan(std::chrono::milliseconds(100));
+  transport::SubscriptionHandler<msgs::Int32> handler(g_nUuid, opts);
+  transport::RawSubscriptionHandler raw(g_nUuid,
+    transport::kGenericMessageType, opts);
+  transport::SubscriptionHandler<msgs::Int32> forever(g_nUuid);
+
+  // Without publication time.
+  transport::MessageInfo info;
+  EXPECT_FALSE(handler.Expired(info));
+
+  info.SetSendSystemTime(std::chrono::system_clock::now());
+  EXPECT_FALSE(handler.Expired(info));
+  EXPECT_FALSE(raw.Expired(info));
+  EXPECT_EQ(0u, handler.DroppedMsgCount());
+
+  info.SetSendSystemTime(
+    std::chrono::system_clock::now() - std::chrono::seconds(2));
+  EXPECT_TRUE(handler.Expired(info));
+  EXPECT_TRUE(raw.Expired(info));
+  EXPECT_FALSE(forever.Expired(info));
+  EXPECT_EQ(1u, handler.DroppedMsgCount());
+  EXPECT_EQ(1u, raw.DroppedMsgCount());
+  EXPECT_EQ(0u, forever.DroppedMsgCount());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that the shared callbacks share the messages owned by the
+/// transport and get a copy of the others.
+TEST(SubscriptionHandlerTest, SharedCallback)
+{
+  transport::MessageInfo info;
+  std::shared_ptr<const msgs::Int32> received;
+
+  transport::SubscriptionHandler<msgs::Int32> handler(g_nUuid);
+  handler.SetSharedCallback(
+    [&received](const std::shared_ptr<const msgs::Int32> &_msg,
+                const transport::MessageInfo &)
+    {
+      received = _msg;
+    });
+
+  auto msg = std::make_shared<msgs::Int32>();
+  msg->set_data(42);
+  EXPECT_TRUE(handler.RunLocalSharedCallback(msg, info));
+  EXPECT_EQ(msg.get(), received.get());
+
+  EXPECT_TRUE(handler.RunLocalCallback(*msg, info));
+  ASSERT_NE(nullptr, received);
+  EXPECT_NE(msg.get(), received.get());
+  EXPECT_EQ(42, received->data());
+
+  // The generic handlers share the messages as they are.
+  std::shared_ptr<const transport::ProtoMsg> genericReceived;
+  transport::SubscriptionHandler<transport::ProtoMsg> generic(g_nUuid);
+  generic.SetSharedCallback(
+    [&genericReceived](
+      const std::shared_ptr<const transport::ProtoMsg> &_msg,
+      const transport::MessageInfo &)
+    {
+      genericReceived = _msg;
+    });
+  EXPECT_TRUE(generic.RunLocalSharedCallback(msg, info));
+  EXPECT_EQ(msg.get(), genericReceived.get());
+  EXPECT_TRUE(generic.RunLocalCallback(*msg, info));
+  ASSERT_NE(nullptr, genericReceived);
+  EXPECT_NE(msg.get(), genericReceived.get());
+  EXPECT_EQ(msg->DebugString(), genericReceived->DebugString());
+
+  // The other callbacks still get a reference.
+  int data = 0;
+  transport::SubscriptionHandler<msgs::Int32> plain(g_nUuid);
+  plain.SetCallback(
+    [&data](const msgs::Int32 &_msg, const transport::MessageInfo &)
+    {
+      data = _msg.data();
+    });
+  EXPECT_TRUE(plain.RunLocalSharedCallback(msg, info));
+  EXPECT_EQ(42, data);
+}
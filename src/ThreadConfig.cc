@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2016 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef _WIN32
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/Helpers.hh"
+#include "ignition/transport/ThreadConfig.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \internal
+    /// \brief Private data for the ThreadConfig class.
+    class ThreadConfigPrivate
+    {
+      /// \brief CPUs on which the threads run, empty for any CPU.
+      public: std::vector<unsigned int> cpus;
+
+      /// \brief SCHED_FIFO priority, 0 for the default scheduling.
+      public: int priority = 0;
+
+      /// \brief Number of I/O threads of 0MQ.
+      public: int ioThreads = 1;
+
+      /// \brief True if the application spins the reception.
+      public: bool manualSpin = false;
+    };
+    }
+  }
+}
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Maximum SCHED_FIFO priority accepted.
+static const int kMaxPriority = 99;
+
+//////////////////////////////////////////////////
+/// \brief Parse a list of CPUs, e.g.: "0,2-3".
+/// \param[in] _str The list, with indices and ranges separated by commas.
+/// \param[out] _cpus The CPU indices.
+/// \return True if the list is valid or false otherwise.
+static bool parseCpuList(const std::string &_str,
+    std::vector<unsigned int> &_cpus)
+{
+  std::vector<unsigned int> cpus;
+  for (const auto &item : split(_str, ','))
+  {
+    const auto dash = item.find('-');
+    try
+    {
+      std::size_t pos = 0;
+      const unsigned long first = std::stoul(item.substr(0, dash), &pos);
+      if (pos != item.substr(0, dash).size())
+        return false;
+
+      unsigned long last = first;
+      if (dash != std::string::npos)
+      {
+        const std::string lastStr = item.substr(dash + 1);
+        last = std::stoul(lastStr, &pos);
+        if (pos != lastStr.size() || last < first)
+          return false;
+      }
+
+      for (unsigned long cpu = first; cpu <= last; ++cpu)
+        cpus.push_back(static_cast<unsigned int>(cpu));
+    }
+    catch (...)
+    {
+      return false;
+    }
+  }
+
+  if (cpus.empty())
+    return false;
+
+  _cpus = cpus;
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the value of an integer environment variable.
+/// \param[in] _name Name of the environment variable.
+/// \param[in] _min Minimum value accepted.
+/// \param[in] _max Maximum value accepted.
+/// \param[out] _value The value, unchanged if the variable isn't set or
+/// isn't valid.
+static void intEnvVar(const std::string &_name, const int _min,
+    const int _max, int &_value)
+{
+  std::string str;
+  if (!env(_name, str))
+    return;
+
+  try
+  {
+    std::size_t pos = 0;
+    const int value = std::stoi(str, &pos);
+    if (pos == str.size() && value >= _min && value <= _max)
+    {
+      _value = value;
+      return;
+    }
+  }
+  catch (...)
+  {
+  }
+
+  std::cerr << "Invalid value [" << str << "] of " << _name << ". It must "
+            << "be an integer between " << _min << " and " << _max
+            << std::endl;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the mutex of the global configuration.
+/// \return The mutex.
+static std::mutex &globalMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the global configuration, read from the environment the first
+/// time. Protected by globalMutex().
+/// \return The configuration.
+static ThreadConfig &globalConfig()
+{
+  static ThreadConfig config;
+  return config;
+}
+
+//////////////////////////////////////////////////
+ThreadConfig::ThreadConfig()
+  : dataPtr(new ThreadConfigPrivate())
+{
+  std::string cpus;
+  if (env("IGN_TRANSPORT_CPU_AFFINITY", cpus) && !cpus.empty() &&
+      !parseCpuList(cpus, this->dataPtr->cpus))
+  {
+    std::cerr << "Invalid value [" << cpus << "] of "
+              << "IGN_TRANSPORT_CPU_AFFINITY. It must be a list of CPUs, "
+              << "e.g.: [0,2-3]" << std::endl;
+  }
+
+  intEnvVar("IGN_TRANSPORT_THREAD_PRIORITY", 0, kMaxPriority,
+    this->dataPtr->priority);
+  intEnvVar("IGN_TRANSPORT_IO_THREADS", 1, 1024, this->dataPtr->ioThreads);
+
+  std::string manualSpin;
+  this->dataPtr->manualSpin =
+    env("IGN_TRANSPORT_MANUAL_SPIN", manualSpin) && manualSpin == "1";
+}
+
+//////////////////////////////////////////////////
+ThreadConfig::ThreadConfig(const ThreadConfig &_other)
+  : dataPtr(new ThreadConfigPrivate(*_other.dataPtr))
+{
+}
+
+//////////////////////////////////////////////////
+ThreadConfig::~ThreadConfig()
+{
+}
+
+//////////////////////////////////////////////////
+ThreadConfig &ThreadConfig::operator=(const ThreadConfig &_other)
+{
+  *this->dataPtr = *_other.dataPtr;
+  return *this;
+}
+
+//////////////////////////////////////////////////
+const std::vector<unsigned int> &ThreadConfig::CpuAffinity() const
+{
+  return this->dataPtr->cpus;
+}
+
+//////////////////////////////////////////////////
+void ThreadConfig::SetCpuAffinity(const std::vector<unsigned int> &_cpus)
+{
+  this->dataPtr->cpus = _cpus;
+}
+
+//////////////////////////////////////////////////
+int ThreadConfig::Priority() const
+{
+  return this->dataPtr->priority;
+}
+
+//////////////////////////////////////////////////
+bool ThreadConfig::SetPriority(const int _priority)
+{
+  if (_priority < 0 || _priority > kMaxPriority)
+    return false;
+
+  this->dataPtr->priority = _priority;
+  return true;
+}
+
+//////////////////////////////////////////////////
+int ThreadConfig::IoThreads() const
+{
+  return this->dataPtr->ioThreads;
+}
+
+//////////////////////////////////////////////////
+bool ThreadConfig::SetIoThreads(const int _threads)
+{
+  if (_threads < 1)
+    return false;
+
+  this->dataPtr->ioThreads = _threads;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ThreadConfig::ManualSpin() const
+{
+  return this->dataPtr->manualSpin;
+}
+
+//////////////////////////////////////////////////
+void ThreadConfig::SetManualSpin(const bool _manual)
+{
+  this->dataPtr->manualSpin = _manual;
+}
+
+//////////////////////////////////////////////////
+bool ThreadConfig::Apply(const std::string &_name) const
+{
+  std::string error;
+
+#ifdef __linux__
+  // The names are limited to 16 bytes, including the terminating null.
+  pthread_setname_np(pthread_self(), _name.substr(0, 15).c_str());
+
+  if (!this->dataPtr->cpus.empty())
+  {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (const auto cpu : this->dataPtr->cpus)
+    {
+      if (cpu < CPU_SETSIZE)
+        CPU_SET(cpu, &cpuSet);
+    }
+
+    const int res = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet),
+      &cpuSet);
+    if (res != 0)
+      error = std::string("Unable to set the CPU affinity: ") + strerror(res);
+  }
+#else
+#ifdef __APPLE__
+  pthread_setname_np(_name.substr(0, 15).c_str());
+#endif
+  if (!this->dataPtr->cpus.empty())
+    error = "The CPU affinity is only supported on Linux";
+#endif
+
+  if (this->dataPtr->priority > 0)
+  {
+#ifndef _WIN32
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = this->dataPtr->priority;
+    const int res = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (res != 0)
+    {
+      error = std::string("Unable to set the SCHED_FIFO priority: ") +
+        strerror(res);
+    }
+#else
+    error = "The SCHED_FIFO priority isn't supported on Windows";
+#endif
+  }
+
+  if (error.empty())
+    return true;
+
+  // Threads are started with the same configuration, so the same failure
+  // would be reported once per thread.
+  static std::atomic<bool> reported{false};
+  if (!reported.exchange(true))
+  {
+    std::cerr << "ThreadConfig::Apply(): " << error << " for thread ["
+              << _name << "]" << std::endl;
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+ThreadConfig ThreadConfig::Global()
+{
+  std::lock_guard<std::mutex> lk(globalMutex());
+  return globalConfig();
+}
+
+//////////////////////////////////////////////////
+void ThreadConfig::SetGlobal(const ThreadConfig &_config)
+{
+  std::lock_guard<std::mutex> lk(globalMutex());
+  globalConfig() = _config;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2016 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef __linux__
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/transport/ThreadConfig.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief Check the default values and the accessors.
+TEST(ThreadConfigTest, Accessors)
+{
+  transport::ThreadConfig config;
+  EXPECT_TRUE(config.CpuAffinity().empty());
+  EXPECT_EQ(0, config.Priority());
+  EXPECT_EQ(1, config.IoThreads());
+
+  config.SetCpuAffinity({1, 3});
+  EXPECT_EQ(std::vector<unsigned int>({1, 3}), config.CpuAffinity());
+
+  EXPECT_FALSE(config.SetPriority(-1));
+  EXPECT_FALSE(config.SetPriority(100));
+  EXPECT_TRUE(config.SetPriority(10));
+  EXPECT_EQ(10, config.Priority());
+
+  EXPECT_FALSE(config.SetIoThreads(0));
+  EXPECT_TRUE(config.SetIoThreads(4));
+  EXPECT_EQ(4, config.IoThreads());
+
+  EXPECT_FALSE(config.ManualSpin());
+  config.SetManualSpin(true);
+  EXPECT_TRUE(config.ManualSpin());
+
+  transport::ThreadConfig copy(config);
+  EXPECT_EQ(config.CpuAffinity(), copy.CpuAffinity());
+  EXPECT_EQ(10, copy.Priority());
+  EXPECT_EQ(4, copy.IoThreads());
+  EXPECT_TRUE(copy.ManualSpin());
+
+  transport::ThreadConfig assigned;
+  assigned = copy;
+  EXPECT_EQ(4, assigned.IoThreads());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the environment variables.
+TEST(ThreadConfigTest, EnvVariables)
+{
+  setenv("IGN_TRANSPORT_CPU_AFFINITY", "0,2-4,7", 1);
+  setenv("IGN_TRANSPORT_THREAD_PRIORITY", "20", 1);
+  setenv("IGN_TRANSPORT_IO_THREADS", "2", 1);
+  setenv("IGN_TRANSPORT_MANUAL_SPIN", "1", 1);
+  {
+    transport::ThreadConfig config;
+    EXPECT_EQ(std::vector<unsigned int>({0, 2, 3, 4, 7}),
+      config.CpuAffinity());
+    EXPECT_EQ(20, config.Priority());
+    EXPECT_EQ(2, config.IoThreads());
+    EXPECT_TRUE(config.ManualSpin());
+  }
+
+  // The invalid values are ignored.
+  for (const std::string cpus : {"a", "1,", "3-1", "1-2x", "-1"})
+  {
+    setenv("IGN_TRANSPORT_CPU_AFFINITY", cpus.c_str(), 1);
+    transport::ThreadConfig config;
+    EXPECT_TRUE(config.CpuAffinity().empty()) << cpus;
+  }
+  setenv("IGN_TRANSPORT_THREAD_PRIORITY", "100", 1);
+  setenv("IGN_TRANSPORT_IO_THREADS", "0", 1);
+  setenv("IGN_TRANSPORT_MANUAL_SPIN", "yes", 1);
+  {
+    transport::ThreadConfig config;
+    EXPECT_EQ(0, config.Priority());
+    EXPECT_EQ(1, config.IoThreads());
+    EXPECT_FALSE(config.ManualSpin());
+  }
+
+  unsetenv("IGN_TRANSPORT_CPU_AFFINITY");
+  unsetenv("IGN_TRANSPORT_THREAD_PRIORITY");
+  unsetenv("IGN_TRANSPORT_IO_THREADS");
+  unsetenv("IGN_TRANSPORT_MANUAL_SPIN");
+}
+
+//////////////////////////////////////////////////
+/// \brief Check the global configuration.
+TEST(ThreadConfigTest, Global)
+{
+  transport::ThreadConfig config;
+  EXPECT_TRUE(config.SetIoThreads(3));
+  transport::ThreadConfig::SetGlobal(config);
+  EXPECT_EQ(3, transport::ThreadConfig::Global().IoThreads());
+
+  transport::ThreadConfig::SetGlobal(transport::ThreadConfig());
+  EXPECT_EQ(1, transport::ThreadConfig::Global().IoThreads());
+}
+
+#ifdef __linux__
+//////////////////////////////////////////////////
+/// \brief Check that the name and the affinity are applied to a thread.
+TEST(ThreadConfigTest, Apply)
+{
+  // Pin the thread to the last CPU that the test can use.
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  unsigned int cpu = 0;
+  for (unsigned int i = 0; i < CPU_SETSIZE; ++i)
+  {
+    if (CPU_ISSET(i, &allowed))
+      cpu = i;
+  }
+
+  transport::ThreadConfig config;
+  config.SetCpuAffinity({cpu});
+
+  std::thread thread([&]
+    {
+      EXPECT_TRUE(config.Apply("ign-test-thread-long-name"));
+
+      char name[16];
+      EXPECT_EQ(0, pthread_getname_np(pthread_self(), name, sizeof(name)));
+      EXPECT_EQ("ign-test-thread", std::string(name));
+
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      EXPECT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(cpus),
+        &cpus));
+      EXPECT_EQ(1, CPU_COUNT(&cpus));
+      EXPECT_TRUE(CPU_ISSET(cpu, &cpus));
+    });
+  thread.join();
+}
+#endif
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
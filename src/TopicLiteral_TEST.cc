@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <string>
+#include <string_view>
+
+#include "ignition/transport/TopicLiteral.hh"
+#include "ignition/transport/TopicUtils.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+// The names are checked at compile time.
+static_assert(ConstexprTopicUtils::IsValidTopic("/abc/de"));
+static_assert(!ConstexprTopicUtils::IsValidTopic(""));
+static_assert(!ConstexprTopicUtils::IsValidTopic("abc//def"));
+static_assert(ConstexprTopicUtils::IsValidNamespace(""));
+static_assert(!ConstexprTopicUtils::IsValidNamespace("/"));
+static_assert(!ConstexprTopicUtils::IsValidPartition("a@b"));
+static_assert(MakeTopicLiteral("/echo").Name() == "@@/echo");
+static_assert(!MakeTopicLiteral("topic:=").Valid());
+
+//////////////////////////////////////////////////
+/// \brief The constant expressions follow the rules of TopicUtils.
+TEST(TopicLiteralTest, Validation)
+{
+  for (const std::string name :
+    {"", "/", "abc", "/abc/", "a b", "~a", "@p", "a//b", "a:=b", "a:b", "//"})
+  {
+    EXPECT_EQ(TopicUtils::IsValidNamespace(name),
+      ConstexprTopicUtils::IsValidNamespace(name)) << name;
+    EXPECT_EQ(TopicUtils::IsValidTopic(name),
+      ConstexprTopicUtils::IsValidTopic(name)) << name;
+    EXPECT_EQ(TopicUtils::IsValidPartition(name),
+      ConstexprTopicUtils::IsValidPartition(name)) << name;
+  }
+
+  EXPECT_FALSE(ConstexprTopicUtils::IsValidTopic(
+    std::string(TopicUtils::kMaxNameLength + 1, 'a')));
+}
+
+//////////////////////////////////////////////////
+/// \brief The literals are qualified like TopicUtils::FullyQualifiedName().
+TEST(TopicLiteralTest, Qualification)
+{
+  constexpr auto kEcho = MakeTopicLiteral("robot/", "ns", "echo/");
+  static_assert(kEcho.Valid());
+  static_assert(kEcho.Name() == "@/robot@/ns/echo");
+  static_assert(kEcho.Partition() == "/robot");
+  static_assert(kEcho.Topic() == "/ns/echo");
+
+  const char *partitions[] = {"", "p", "/p", "/p/"};
+  const char *namespaces[] = {"", "ns", "/ns", "ns/", "/ns/"};
+  const char *topics[] = {"t", "/t", "t/", "/t/", "a/b"};
+  for (const auto partition : partitions)
+  {
+    for (const auto ns : namespaces)
+    {
+      for (const auto topic : topics)
+      {
+        std::string expected;
+        ASSERT_TRUE(
+          TopicUtils::FullyQualifiedName(partition, ns, topic, expected));
+        const TopicLiteral<32> literal(partition, ns, topic);
+        EXPECT_TRUE(literal.Valid());
+        EXPECT_EQ(expected, literal.Name());
+      }
+    }
+  }
+
+  constexpr auto kInvalid = MakeTopicLiteral("p", "n s", "/t");
+  static_assert(!kInvalid.Valid());
+  EXPECT_TRUE(kInvalid.Name().empty());
+  EXPECT_TRUE(kInvalid.Partition().empty());
+  EXPECT_TRUE(kInvalid.Topic().empty());
+
+  // A buffer too small for the name.
+  EXPECT_FALSE(TopicLiteral<4>("", "", "/topic").Valid());
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2016 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "ignition/transport/TopicName.hh"
+#include "ignition/transport/TopicUtils.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \internal
+    /// \brief Private data for the TopicName class.
+    class TopicNamePrivate
+    {
+      /// \brief Fully qualified name, empty if not valid.
+      public: std::string fullyQualifiedName;
+
+      /// \brief Partition of the name.
+      public: std::string partition;
+
+      /// \brief Namespace and topic.
+      public: std::string topic;
+    };
+    }
+  }
+}
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+TopicName::TopicName()
+{
+  // All the invalid default names share the same empty strings.
+  static const std::shared_ptr<const TopicNamePrivate> kInvalid =
+    std::make_shared<const TopicNamePrivate>();
+  this->dataPtr = kInvalid;
+}
+
+//////////////////////////////////////////////////
+TopicName::TopicName(const std::string &_partition, const std::string &_ns,
+    const std::string &_topic)
+{
+  auto data = std::make_shared<TopicNamePrivate>();
+  if (TopicUtils::FullyQualifiedName(_partition, _ns, _topic,
+        data->fullyQualifiedName))
+  {
+    // "@<PARTITION>@<NAMESPACE>/<TOPIC>", already validated.
+    const auto &name = data->fullyQualifiedName;
+    const std::size_t lastAt = name.find('@', 1);
+    data->partition = name.substr(1, lastAt - 1);
+    data->topic = name.substr(lastAt + 1);
+  }
+  else
+  {
+    data->fullyQualifiedName.clear();
+    data->topic = _topic;
+  }
+  this->dataPtr = std::move(data);
+}
+
+//////////////////////////////////////////////////
+TopicName::TopicName(const std::string_view _fullyQualifiedName,
+    const std::size_t _partitionEnd)
+{
+  auto data = std::make_shared<TopicNamePrivate>();
+  if (!_fullyQualifiedName.empty())
+  {
+    data->fullyQualifiedName = std::string(_fullyQualifiedName);
+    data->partition = std::string(_fullyQualifiedName.substr(1,
+      _partitionEnd - 1));
+    data->topic = std::string(_fullyQualifiedName.substr(_partitionEnd + 1));
+  }
+  this->dataPtr = std::move(data);
+}
+
+//////////////////////////////////////////////////
+bool TopicName::Valid() const
+{
+  return !this->dataPtr->fullyQualifiedName.empty();
+}
+
+//////////////////////////////////////////////////
+const std::string &TopicName::FullyQualifiedName() const
+{
+  return this->dataPtr->fullyQualifiedName;
+}
+
+//////////////////////////////////////////////////
+const std::string &TopicName::Partition() const
+{
+  return this->dataPtr->partition;
+}
+
+//////////////////////////////////////////////////
+const std::string &TopicName::Topic() const
+{
+  return this->dataPtr->topic;
+}
+
+//////////////////////////////////////////////////
+bool TopicName::operator==(const TopicName &_other) const
+{
+  return this->dataPtr == _other.dataPtr ||
+    this->dataPtr->fullyQualifiedName == _other.dataPtr->fullyQualifiedName;
+}
+
+//////////////////////////////////////////////////
+bool TopicName::operator!=(const TopicName &_other) const
+{
+  return !(*this == _other);
+}
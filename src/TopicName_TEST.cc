@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <string>
+
+#include "ignition/transport/TopicName.hh"
+#include "ignition/transport/TopicUtils.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Resolve valid and invalid names.
+TEST(TopicNameTest, Resolve)
+{
+  TopicName name("partition", "ns", "topic");
+  EXPECT_TRUE(name.Valid());
+  EXPECT_EQ("@/partition@/ns/topic", name.FullyQualifiedName());
+  EXPECT_EQ("/partition", name.Partition());
+  EXPECT_EQ("/ns/topic", name.Topic());
+
+  std::string expected;
+  for (const std::string topic : {"topic", "/abs", "a/b/", "~x", ""})
+  {
+    TopicName other("p", "/ns", topic);
+    const bool valid =
+      TopicUtils::FullyQualifiedName("p", "/ns", topic, expected);
+    EXPECT_EQ(valid, other.Valid()) << topic;
+    if (valid)
+      EXPECT_EQ(expected, other.FullyQualifiedName());
+    else
+      EXPECT_EQ(topic, other.Topic());
+  }
+
+  TopicName invalid("p", "", "a b");
+  EXPECT_FALSE(invalid.Valid());
+  EXPECT_TRUE(invalid.FullyQualifiedName().empty());
+  EXPECT_EQ("a b", invalid.Topic());
+
+  TopicName empty;
+  EXPECT_FALSE(empty.Valid());
+  EXPECT_TRUE(empty.Topic().empty());
+}
+
+//////////////////////////////////////////////////
+/// \brief The copies share the resolved strings.
+TEST(TopicNameTest, CopyAndCompare)
+{
+  TopicName name("p", "", "/topic");
+  TopicName copy(name);
+  EXPECT_EQ(&name.FullyQualifiedName(), &copy.FullyQualifiedName());
+  EXPECT_TRUE(name == copy);
+
+  TopicName same("/p", "/other", "/topic");
+  EXPECT_TRUE(name == same);
+  EXPECT_FALSE(name != same);
+
+  TopicName different("p", "", "/other");
+  EXPECT_TRUE(name != different);
+
+  copy = different;
+  EXPECT_EQ("@/p@/other", copy.FullyQualifiedName());
+  EXPECT_EQ("@/p@/topic", name.FullyQualifiedName());
+  EXPECT_TRUE(TopicName() == TopicName());
+}
+
+//////////////////////////////////////////////////
+/// \brief A name created from a literal qualified at compile time.
+TEST(TopicNameTest, Literal)
+{
+  constexpr auto kEcho = MakeTopicLiteral("p", "ns", "echo");
+  const TopicName name(kEcho);
+  EXPECT_TRUE(name.Valid());
+  EXPECT_EQ("@/p@/ns/echo", name.FullyQualifiedName());
+  EXPECT_EQ("/p", name.Partition());
+  EXPECT_EQ("/ns/echo", name.Topic());
+  EXPECT_TRUE(name == TopicName("p", "ns", "echo"));
+
+  const TopicName invalid(MakeTopicLiteral("p", "", "a b"));
+  EXPECT_FALSE(invalid.Valid());
+  EXPECT_TRUE(invalid.FullyQualifiedName().empty());
+}
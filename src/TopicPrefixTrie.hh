@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef IGN_TRANSPORT_TOPICPREFIXTRIE_HH_
+#define IGN_TRANSPORT_TOPICPREFIXTRIE_HH_
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ignition/transport/config.hh"
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+    /// \class TopicPrefixTrie TopicPrefixTrie.hh
+    /// \brief Set of topic prefixes, stored as a tree of the segments of
+    /// their names, so the prefixes that match a topic are found in a single
+    /// walk over the topic name, whatever the number of prefixes. The
+    /// prefixes match as in TopicUtils::MatchesPrefix(). This class is not
+    /// thread safe.
+    class TopicPrefixTrie
+    {
+      /// \brief Add a prefix.
+      /// \param[in] _prefix The prefix.
+      /// \return True if the prefix wasn't in the set.
+      public: bool Insert(const std::string &_prefix)
+      {
+        TrieNode *node = &this->root;
+        for (const std::string_view segment : Segments(_prefix))
+        {
+          auto it = node->children.find(segment);
+          if (it == node->children.end())
+          {
+            it = node->children.emplace(std::string(segment),
+              std::make_unique<TrieNode>()).first;
+          }
+          node = it->second.get();
+        }
+
+        if (!node->prefixes.insert(_prefix).second)
+          return false;
+
+        ++this->size;
+        return true;
+      }
+
+      /// \brief Remove a prefix. The branches left empty are pruned.
+      /// \param[in] _prefix The prefix.
+      /// \return True if the prefix was in the set.
+      public: bool Remove(const std::string &_prefix)
+      {
+        std::vector<std::pair<TrieNode *, std::string_view>> path;
+        TrieNode *node = &this->root;
+        for (const std::string_view segment : Segments(_prefix))
+        {
+          auto it = node->children.find(segment);
+          if (it == node->children.end())
+            return false;
+          path.emplace_back(node, segment);
+          node = it->second.get();
+        }
+
+        if (node->prefixes.erase(_prefix) == 0)
+          return false;
+        --this->size;
+
+        for (auto it = path.rbegin(); it != path.rend(); ++it)
+        {
+          auto child = it->first->children.find(it->second);
+          if (!child->second->prefixes.empty() ||
+              !child->second->children.empty())
+          {
+            break;
+          }
+          it->first->children.erase(child);
+        }
+        return true;
+      }
+
+      /// \brief Check if a prefix is in the set.
+      /// \param[in] _prefix The prefix.
+      /// \return True if the prefix was inserted and not removed.
+      public: bool Contains(const std::string &_prefix) const
+      {
+        const TrieNode *node = &this->root;
+        for (const std::string_view segment : Segments(_prefix))
+        {
+          auto it = node->children.find(segment);
+          if (it == node->children.end())
+            return false;
+          node = it->second.get();
+        }
+        return node->prefixes.count(_prefix) > 0;
+      }
+
+      /// \brief Get the prefixes that match a topic.
+      /// \param[in] _topic The topic.
+      /// \return The matching prefixes, from the shortest to the longest.
+      public: std::vector<std::string> Match(const std::string &_topic) const
+      {
+        std::vector<std::string> result;
+        this->Walk(_topic, [&result](const std::set<std::string> &_prefixes)
+          {
+            result.insert(result.end(), _prefixes.begin(), _prefixes.end());
+            return false;
+          });
+        return result;
+      }
+
+      /// \brief Check if at least one prefix matches a topic.
+      /// \param[in] _topic The topic.
+      /// \return True if Match() isn't empty.
+      public: bool Covers(const std::string &_topic) const
+      {
+        return this->Walk(_topic, [](const std::set<std::string> &)
+          {
+            return true;
+          });
+      }
+
+      /// \brief Get the number of prefixes.
+      /// \return The number of prefixes in the set.
+      public: std::size_t Size() const
+      {
+        return this->size;
+      }
+
+      /// \brief Check if the set is empty.
+      /// \return True if there are no prefixes.
+      public: bool Empty() const
+      {
+        return this->size == 0;
+      }
+
+      /// \brief A node of the tree, i.e. a segment of the prefixes.
+      private: struct TrieNode
+      {
+        /// \brief Next segments.
+        public: std::map<std::string, std::unique_ptr<TrieNode>, std::less<>>
+          children;
+
+        /// \brief Prefixes that end at this segment. More than one when they
+        /// only differ in a trailing "/".
+        public: std::set<std::string> prefixes;
+      };
+
+      /// \brief Split a name into its segments. A trailing "/" doesn't start
+      /// a new segment.
+      /// \param[in] _name The name.
+      /// \return Views of the segments of _name.
+      private: static std::vector<std::string_view> Segments(
+        const std::string &_name)
+      {
+        std::vector<std::string_view> segments;
+        std::string_view rest(_name);
+        while (!rest.empty())
+        {
+          const auto slash = rest.find('/');
+          segments.push_back(rest.substr(0, slash));
+          if (slash == std::string_view::npos)
+            break;
+          rest.remove_prefix(slash + 1);
+        }
+        return segments;
+      }
+
+      /// \brief Visit the prefixes that match a topic.
+      /// \param[in] _topic The topic.
+      /// \param[in] _visit Called with the prefixes of each matching
+      /// segment, returns true to stop the walk.
+      /// \return True if the walk was stopped.
+      private: bool Walk(const std::string &_topic,
+        const std::function<bool(const std::set<std::string> &)> &_visit)
+        const
+      {
+        const TrieNode *node = &this->root;
+        std::string_view rest(_topic);
+        while (!rest.empty())
+        {
+          const auto slash = rest.find('/');
+          auto it = node->children.find(rest.substr(0, slash));
+          if (it == node->children.end())
+            return false;
+          node = it->second.get();
+          if (!node->prefixes.empty() && _visit(node->prefixes))
+            return true;
+          if (slash == std::string_view::npos)
+            break;
+          rest.remove_prefix(slash + 1);
+        }
+        return false;
+      }
+
+      /// \brief First segment of the prefixes.
+      private: TrieNode root;
+
+      /// \brief Number of prefixes.
+      private: std::size_t size = 0;
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ignition/transport/TopicUtils.hh"
+#include "TopicPrefixTrie.hh"
+#include "gtest/gtest.h"
+
+using namespace ignition;
+using namespace transport;
+
+//////////////////////////////////////////////////
+/// \brief Add and remove prefixes.
+TEST(TopicPrefixTrieTest, InsertAndRemove)
+{
+  TopicPrefixTrie trie;
+  EXPECT_TRUE(trie.Empty());
+
+  EXPECT_TRUE(trie.Insert("@/p@/robot"));
+  EXPECT_FALSE(trie.Insert("@/p@/robot"));
+  EXPECT_TRUE(trie.Insert("@/p@/robot/arm"));
+  EXPECT_TRUE(trie.Insert("@/p@/"));
+  EXPECT_EQ(3u, trie.Size());
+  EXPECT_TRUE(trie.Contains("@/p@/robot"));
+  EXPECT_FALSE(trie.Contains("@/p@/rob"));
+  EXPECT_FALSE(trie.Contains("@/p@"));
+
+  EXPECT_TRUE(trie.Remove("@/p@/robot"));
+  EXPECT_FALSE(trie.Remove("@/p@/robot"));
+  EXPECT_FALSE(trie.Remove("@/p@/robot/leg"));
+  EXPECT_FALSE(trie.Contains("@/p@/robot"));
+  EXPECT_TRUE(trie.Contains("@/p@/robot/arm"));
+
+  EXPECT_TRUE(trie.Remove("@/p@/robot/arm"));
+  EXPECT_TRUE(trie.Remove("@/p@/"));
+  EXPECT_TRUE(trie.Empty());
+  EXPECT_FALSE(trie.Covers("@/p@/robot/arm"));
+}
+
+//////////////////////////////////////////////////
+/// \brief Find the prefixes of a topic.
+TEST(TopicPrefixTrieTest, Match)
+{
+  TopicPrefixTrie trie;
+  trie.Insert("@/p@/robot");
+  trie.Insert("@/p@/robot/arm");
+  trie.Insert("@/q@/");
+
+  EXPECT_EQ(std::vector<std::string>({"@/p@/robot"}),
+    trie.Match("@/p@/robot"));
+  EXPECT_EQ(std::vector<std::string>({"@/p@/robot", "@/p@/robot/arm"}),
+    trie.Match("@/p@/robot/arm/joint"));
+  EXPECT_EQ(std::vector<std::string>({"@/q@/"}), trie.Match("@/q@/a/b"));
+  EXPECT_TRUE(trie.Match("@/p@/robotic").empty());
+  EXPECT_TRUE(trie.Match("@/p@/ro").empty());
+  EXPECT_TRUE(trie.Match("@/r@/robot").empty());
+
+  EXPECT_TRUE(trie.Covers("@/p@/robot/scan"));
+  EXPECT_FALSE(trie.Covers("@/p@/robotic/scan"));
+
+  // The trie agrees with TopicUtils::MatchesPrefix().
+  for (const std::string topic : {"@/p@/robot", "@/p@/robot/arm",
+         "@/p@/robots", "@/q@/x", "@/p@/rob/arm"})
+  {
+    const auto matches = trie.Match(topic);
+    for (const std::string prefix : {"@/p@/robot", "@/p@/robot/arm", "@/q@/"})
+    {
+      EXPECT_EQ(TopicUtils::MatchesPrefix(topic, prefix),
+        std::find(matches.begin(), matches.end(), prefix) != matches.end())
+        << topic << " " << prefix;
+    }
+  }
+}
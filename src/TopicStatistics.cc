@@ -16,15 +16,88 @@
 */
 #include <ignition/msgs/statistic.pb.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <limits>
 #include <sstream>
+#include <string>
+#include <utility>
 
 #include "ignition/transport/TopicStatistics.hh"
 
 using namespace ignition;
 using namespace transport;
 
+/// \brief Log2 of the number of linear sub-buckets of every power of two of
+/// the histogram. 32 sub-buckets bound the relative error to 1/64 when
+/// reporting the middle of a bucket.
+static const int kSubBucketBits = 5;
+
+/// \brief Number of linear sub-buckets of every power of two.
+static const uint64_t kSubBuckets = 1u << kSubBucketBits;
+
+/// \brief Largest value of the histogram, in thousandths of the unit.
+static const uint64_t kMaxHistogramValue = (1ull << 32) - 1;
+
+//////////////////////////////////////////////////
+/// \brief Get the bucket of a value in the histogram. The values below
+/// 2 * kSubBuckets have their own bucket, then every power of two is split
+/// in kSubBuckets buckets.
+/// \param[in] _value The value, in thousandths of the unit.
+/// \return The index of the bucket.
+static std::size_t bucketIndex(uint64_t _value)
+{
+  _value = std::min(_value, kMaxHistogramValue);
+  if (_value < 2 * kSubBuckets)
+    return static_cast<std::size_t>(_value);
+
+  int msb = 0;
+  while ((_value >> (msb + 1)) != 0)
+    ++msb;
+
+  const int shift = msb - kSubBucketBits;
+  return static_cast<std::size_t>(
+    kSubBuckets * static_cast<uint64_t>(shift) + (_value >> shift));
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the value in the middle of a bucket of the histogram.
+/// \param[in] _index The index of the bucket.
+/// \return The value, in thousandths of the unit.
+static double bucketValue(std::size_t _index)
+{
+  if (_index < 2 * kSubBuckets)
+    return static_cast<double>(_index);
+
+  const uint64_t shift = _index / kSubBuckets - 1;
+  const uint64_t sub = _index % kSubBuckets + kSubBuckets;
+  const uint64_t lower = sub << shift;
+  const uint64_t upper = ((sub + 1) << shift) - 1;
+  return (static_cast<double>(lower) + static_cast<double>(upper)) / 2.0;
+}
+
+//////////////////////////////////////////////////
+/// \brief Add the tail percentiles of a set of samples to a group.
+/// \param[in] _stats The samples.
+/// \param[in] _suffix Suffix of the statistic names, e.g. "period".
+/// \param[out] _group The group.
+static void addPercentiles(const Statistics &_stats,
+    const std::string &_suffix, msgs::StatisticsGroup *_group)
+{
+  // The Statistic message doesn't have a type for percentiles, they are
+  // identified by their name.
+  const std::pair<const char *, double> percentiles[] =
+    {{"p50_", 50.0}, {"p99_", 99.0}, {"p999_", 99.9}};
+  for (const auto &percentile : percentiles)
+  {
+    msgs::Statistic *stat = _group->add_statistics();
+    stat->set_type(msgs::Statistic::UNINITIALIZED);
+    stat->set_name(percentile.first + _suffix);
+    stat->set_value(_stats.Percentile(percentile.second));
+  }
+}
+
 class ignition::transport::TopicStatisticsPrivate
 {
   /// \brief Default constructor
@@ -86,6 +159,13 @@ void Statistics::Update(double _stat)
   // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Welford%27s_online_algorithm
   this->sumSquareMeanDist += (_stat - currentAvg) *
     (_stat - this->average);
+
+  // Update the histogram, in thousandths of the unit.
+  const double scaled = std::min(std::max(_stat * 1000.0, 0.0),
+    static_cast<double>(kMaxHistogramValue));
+  auto &bucket = this->histogram[bucketIndex(static_cast<uint64_t>(scaled))];
+  if (bucket < std::numeric_limits<uint32_t>::max())
+    ++bucket;
 }
 
 //////////////////////////////////////////////////
@@ -118,6 +198,32 @@ uint64_t Statistics::Count() const
   return this->count;
 }
 
+//////////////////////////////////////////////////
+double Statistics::Percentile(double _percentile) const
+{
+  if (this->count == 0)
+    return 0;
+
+  _percentile = std::min(std::max(_percentile, 0.0), 100.0);
+  const uint64_t rank = std::max<uint64_t>(1u, static_cast<uint64_t>(
+    std::ceil(_percentile / 100.0 * static_cast<double>(this->count))));
+
+  uint64_t seen = 0;
+  double value = this->max;
+  for (std::size_t i = 0; i < this->histogram.size(); ++i)
+  {
+    seen += this->histogram[i];
+    if (seen >= rank)
+    {
+      value = bucketValue(i) / 1000.0;
+      break;
+    }
+  }
+
+  // The middle of the bucket might fall outside the samples.
+  return std::min(std::max(value, this->min), this->max);
+}
+
 //////////////////////////////////////////////////
 TopicStatistics::TopicStatistics()
   : dataPtr(new TopicStatisticsPrivate)
@@ -141,16 +247,19 @@ void TopicStatistics::Update(const std::string &_sender,
 {
   // Current wall time
   uint64_t now =
-    std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
         std::chrono::steady_clock::now().time_since_epoch()).count();
 
+  // The stamps are in nanoseconds, the statistics in milliseconds.
+  auto toMs = [](uint64_t _ns) {return static_cast<double>(_ns) / 1e6;};
+
   if (this->dataPtr->prevPublicationStamp != 0)
   {
-    this->dataPtr->publication.Update(static_cast<double>(_stamp -
+    this->dataPtr->publication.Update(toMs(_stamp -
         this->dataPtr->prevPublicationStamp));
-    this->dataPtr->reception.Update(static_cast<double>(now -
+    this->dataPtr->reception.Update(toMs(now -
           this->dataPtr->prevReceptionStamp));
-    this->dataPtr->age.Update(static_cast<double>(now - _stamp));
+    this->dataPtr->age.Update(toMs(now - _stamp));
 
     if (this->dataPtr->seq[_sender] + 1 != _seq)
     {
@@ -196,6 +305,8 @@ void TopicStatistics::FillMessage(msgs::Metric &_msg) const
   stat->set_name("period_standard_devation");
   stat->set_value(this->dataPtr->publication.StdDev());
 
+  addPercentiles(this->dataPtr->publication, "period", statGroup);
+
   // Reception statistics
   statGroup = _msg.add_statistics_groups();
   statGroup->set_name("reception_statistics");
@@ -220,6 +331,8 @@ void TopicStatistics::FillMessage(msgs::Metric &_msg) const
   stat->set_name("period_standard_devation");
   stat->set_value(this->dataPtr->reception.StdDev());
 
+  addPercentiles(this->dataPtr->reception, "period", statGroup);
+
   // Age statistics
   statGroup = _msg.add_statistics_groups();
   statGroup->set_name("age_statistics");
@@ -243,6 +356,8 @@ void TopicStatistics::FillMessage(msgs::Metric &_msg) const
   stat->set_type(msgs::Statistic::STDDEV);
   stat->set_name("age_standard_devation");
   stat->set_value(this->dataPtr->age.StdDev());
+
+  addPercentiles(this->dataPtr->age, "age", statGroup);
 }
 
 //////////////////////////////////////////////////
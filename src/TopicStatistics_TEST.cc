@@ -102,6 +102,58 @@ TEST(TopicsStatistics, AvgStdDev)
   EXPECT_NEAR(0.816, stats.StdDev(), 1e-3);
 }
 
+//////////////////////////////////////////////////
+TEST(TopicsStatistics, Percentile)
+{
+  Statistics stats;
+  EXPECT_DOUBLE_EQ(0.0, stats.Percentile(50));
+
+  // 1000 samples from 0.01 to 10 and a single outlier.
+  for (int i = 1; i <= 1000; ++i)
+    stats.Update(i / 100.0);
+  stats.Update(250.0);
+
+  EXPECT_NEAR(5.0, stats.Percentile(50), 5.0 * 0.02);
+  EXPECT_NEAR(9.9, stats.Percentile(99), 9.9 * 0.02);
+  EXPECT_NEAR(10.0, stats.Percentile(99.9), 10.0 * 0.02);
+  EXPECT_DOUBLE_EQ(250.0, stats.Percentile(100));
+  EXPECT_DOUBLE_EQ(0.01, stats.Percentile(0));
+
+  // The histogram is copied with the statistics.
+  Statistics copy = stats;
+  EXPECT_DOUBLE_EQ(stats.Percentile(99), copy.Percentile(99));
+
+  // Negative samples are counted as zero.
+  Statistics clamped;
+  clamped.Update(-1.0);
+  EXPECT_NEAR(0.0, clamped.Percentile(50), 1e-9);
+}
+
+//////////////////////////////////////////////////
+TEST(TopicsStatistics, FillMessagePercentiles)
+{
+  TopicStatistics topicStats;
+  for (uint64_t i = 0; i < 10; ++i)
+    topicStats.Update("foo", (i + 1) * 1000000u, i);
+
+  msgs::Metric msg;
+  topicStats.FillMessage(msg);
+  ASSERT_EQ(3, msg.statistics_groups_size());
+
+  const std::string names[] = {"period", "period", "age"};
+  for (int g = 0; g < msg.statistics_groups_size(); ++g)
+  {
+    const auto &group = msg.statistics_groups(g);
+    ASSERT_EQ(7, group.statistics_size());
+    EXPECT_EQ("p50_" + names[g], group.statistics(4).name());
+    EXPECT_EQ("p99_" + names[g], group.statistics(5).name());
+    EXPECT_EQ("p999_" + names[g], group.statistics(6).name());
+  }
+
+  // The publications are one millisecond apart.
+  EXPECT_NEAR(1.0, msg.statistics_groups(0).statistics(4).value(), 0.02);
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
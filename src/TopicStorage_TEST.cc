@@ -479,6 +479,62 @@ TEST(TopicStorageTest, PublishersByNode)
   EXPECT_EQ(pubs.at(0).Addr(), g_addr1);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check that the queries by process and node stay consistent when
+/// publishers are removed.
+TEST(TopicStorageTest, RemoveByProcAndNode)
+{
+  init();
+
+  Publisher publisher1(g_topic1, g_addr1, g_pUuid1, g_nUuid1, g_opts1);
+  Publisher publisher2(g_topic2, g_addr1, g_pUuid1, g_nUuid1, g_opts1);
+  Publisher publisher3(g_topic2, g_addr1, g_pUuid1, g_nUuid2, g_opts2);
+  Publisher publisher4(g_topic2, g_addr2, g_pUuid2, g_nUuid3, g_opts3);
+
+  TopicStorage<Publisher> test;
+  EXPECT_TRUE(test.AddPublisher(publisher1));
+  EXPECT_TRUE(test.AddPublisher(publisher2));
+  EXPECT_TRUE(test.AddPublisher(publisher3));
+  EXPECT_TRUE(test.AddPublisher(publisher4));
+
+  std::vector<Publisher> nodePubs;
+  test.PublishersByNode(g_pUuid1, g_nUuid1, nodePubs);
+  EXPECT_EQ(2u, nodePubs.size());
+
+  // The node keeps its other topic.
+  EXPECT_TRUE(test.DelPublisherByNode(g_topic1, g_pUuid1, g_nUuid1));
+  test.PublishersByNode(g_pUuid1, g_nUuid1, nodePubs);
+  ASSERT_EQ(1u, nodePubs.size());
+  EXPECT_EQ(g_topic2, nodePubs.at(0).Topic());
+  EXPECT_FALSE(test.HasTopic(g_topic1));
+
+  std::map<std::string, std::vector<Publisher>> procPubs;
+  test.PublishersByProc(g_pUuid1, procPubs);
+  EXPECT_EQ(2u, procPubs.size());
+
+  // Only the publishers of the process go away.
+  EXPECT_TRUE(test.DelPublishersByProc(g_pUuid1));
+  EXPECT_FALSE(test.DelPublishersByProc(g_pUuid1));
+  test.PublishersByProc(g_pUuid1, procPubs);
+  EXPECT_TRUE(procPubs.empty());
+  test.PublishersByNode(g_pUuid1, g_nUuid2, nodePubs);
+  EXPECT_TRUE(nodePubs.empty());
+  EXPECT_TRUE(test.HasAnyPublishers(g_topic2, g_pUuid2));
+  test.PublishersByNode(g_pUuid2, g_nUuid3, nodePubs);
+  EXPECT_EQ(1u, nodePubs.size());
+
+  // A publisher can come back.
+  EXPECT_TRUE(test.AddPublisher(publisher1));
+  test.PublishersByProc(g_pUuid1, procPubs);
+  EXPECT_EQ(1u, procPubs.size());
+
+  EXPECT_TRUE(test.DelPublishersByProc(g_pUuid2));
+  EXPECT_TRUE(test.DelPublisherByNode(g_topic1, g_pUuid1, g_nUuid1));
+  std::vector<std::string> topics;
+  test.TopicList(topics);
+  EXPECT_TRUE(topics.empty());
+}
+
 //////////////////////////////////////////////////
 /// \brief Check HasTopic(<topic>, <type>).
 TEST(TopicStorageTest, HasTopicWithType)
@@ -17,7 +17,10 @@
 
 #include <regex>
 #include <string>
+#include <string_view>
+#include <utility>
 
+#include "ignition/transport/TopicLiteral.hh"
 #include "ignition/transport/TopicUtils.hh"
 
 using namespace ignition;
@@ -26,39 +29,10 @@ using namespace transport;
 //////////////////////////////////////////////////
 bool TopicUtils::IsValidNamespace(const std::string &_ns)
 {
-  // An empty namespace is valid, so take a shortcut here.
-  if (_ns.empty())
-    return true;
-
-  // Too long string is not valid.
-  if (_ns.size() > kMaxNameLength)
-    return false;
-
-  // "/" is not valid.
-  if (_ns == "/")
-    return false;
-
-  // If the topic name has a '~' is not valid.
-  if (_ns.find("~") != std::string::npos)
-    return false;
-
-  // If the topic name has a white space is not valid.
-  if (_ns.find(" ") != std::string::npos)
-    return false;
-
-  // It is not allowed to have two consecutive slashes.
-  if (_ns.find("//") != std::string::npos)
-    return false;
-
-  // It the topic name has a '@' is not valid.
-  if (_ns.find("@") != std::string::npos)
-    return false;
-
-  // If the topic name has a ':=' is not valid.
-  if (_ns.find(":=") != std::string::npos)
-    return false;
-
-  return true;
+  // A single pass over the name, which is checked for every subscription,
+  // advertisement and service request. The rules are shared with the names
+  // checked at compile time.
+  return ConstexprTopicUtils::IsValidNamespace(_ns);
 }
 
 //////////////////////////////////////////////////
@@ -85,39 +59,43 @@ bool TopicUtils::FullyQualifiedName(const std::string &_partition,
     return false;
   }
 
-  std::string partition = _partition;
-  std::string ns = _ns;
-  std::string topic = _topic;
-
-  // If partition is not empty and does not start with slash, add it.
-  if (!partition.empty() && partition.front() != '/')
-    partition.insert(0, 1, '/');
+  // The pieces are appended to a single string, without temporaries.
+  std::string_view partition(_partition);
+  std::string_view topic(_topic);
 
   // If the partition contains a trailing slash, remove it.
   if (!partition.empty() && partition.back() == '/')
-    partition.pop_back();
-
-  // If the namespace does not contain a trailing slash, append it.
-  if (ns.empty() || ns.back() != '/')
-    ns.push_back('/');
-
-  // If the namespace does not start with slash, add it.
-  if (ns.empty() || ns.front() != '/')
-    ns.insert(0, 1, '/');
+    partition.remove_suffix(1);
 
   // If the topic ends in "/", remove it.
   if (!topic.empty() && topic.back() == '/')
-    topic.pop_back();
+    topic.remove_suffix(1);
+
+  std::string name;
+  name.reserve(_partition.size() + _ns.size() + _topic.size() + 5);
+
+  // Add the partition prefix. If the partition is not empty and does not
+  // start with slash, add it.
+  name.push_back('@');
+  if (!partition.empty() && partition.front() != '/')
+    name.push_back('/');
+  name.append(partition);
+  name.push_back('@');
 
   // If the topic does starts with '/' is considered an absolute topic and the
-  // namespace will not be prefixed.
-  if (!topic.empty() && topic.front() == '/')
-    _name = topic;
-  else
-    _name = ns + topic;
+  // namespace will not be prefixed. The namespace starts and ends with a
+  // slash.
+  if (topic.empty() || topic.front() != '/')
+  {
+    if (_ns.empty() || _ns.front() != '/')
+      name.push_back('/');
+    name.append(_ns);
+    if (!_ns.empty() && _ns.back() != '/')
+      name.push_back('/');
+  }
+  name.append(topic);
 
-  // Add the partition prefix.
-  _name.insert(0, "@" + partition + "@");
+  _name = std::move(name);
 
   // Too long string is not valid.
   if (_name.size() > kMaxNameLength)
@@ -156,6 +134,17 @@ bool TopicUtils::DecomposeFullyQualifiedTopic(
   return true;
 }
 
+//////////////////////////////////////////////////
+bool TopicUtils::MatchesPrefix(const std::string &_topic,
+  const std::string &_prefix)
+{
+  if (_prefix.empty() || _topic.compare(0, _prefix.size(), _prefix) != 0)
+    return false;
+
+  return _topic.size() == _prefix.size() || _prefix.back() == '/' ||
+    _topic[_prefix.size()] == '/';
+}
+
 //////////////////////////////////////////////////
 std::string TopicUtils::AsValidTopic(const std::string &_topic)
 {
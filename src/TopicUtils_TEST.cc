@@ -291,6 +291,21 @@ TEST(TopicUtilsTest, asValidTopic)
   }
 }
 
+//////////////////////////////////////////////////
+/// \brief Check the matching of topic prefixes.
+TEST(TopicUtilsTest, MatchesPrefix)
+{
+  using transport::TopicUtils;
+  EXPECT_TRUE(TopicUtils::MatchesPrefix("@/p@/robot", "@/p@/robot"));
+  EXPECT_TRUE(TopicUtils::MatchesPrefix("@/p@/robot/scan", "@/p@/robot"));
+  EXPECT_TRUE(TopicUtils::MatchesPrefix("@/p@/robot/a/b", "@/p@/robot"));
+  EXPECT_TRUE(TopicUtils::MatchesPrefix("@/p@/robot", "@/p@/"));
+  EXPECT_FALSE(TopicUtils::MatchesPrefix("@/p@/robotic", "@/p@/robot"));
+  EXPECT_FALSE(TopicUtils::MatchesPrefix("@/p@/rob", "@/p@/robot"));
+  EXPECT_FALSE(TopicUtils::MatchesPrefix("@/q@/robot", "@/p@/"));
+  EXPECT_FALSE(TopicUtils::MatchesPrefix("@/p@/robot", ""));
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+// LTTng-UST tracepoint provider of the message flow. This header is read
+// several times by lttng/tracepoint-event.h, so it doesn't use a regular
+// include guard. Include Tracing.hh instead of this file.
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER ign_transport
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "TracepointProvider.hh"
+
+#if !defined(IGN_TRANSPORT_TRACEPOINTPROVIDER_HH_) || \
+    defined(TRACEPOINT_HEADER_MULTI_READ)
+#define IGN_TRANSPORT_TRACEPOINTPROVIDER_HH_
+
+#include <lttng/tracepoint.h>
+
+/// \brief A message is published by a Node::Publisher.
+TRACEPOINT_EVENT(ign_transport, publish,
+  TP_ARGS(const char *, _topic, uint64_t, _id, uint64_t, _size),
+  TP_FIELDS(
+    ctf_string(topic, _topic)
+    ctf_integer(uint64_t, id, _id)
+    ctf_integer(uint64_t, size, _size)))
+
+/// \brief A message is sent to the remote subscribers, with the sequence
+/// number of the message in its publisher.
+TRACEPOINT_EVENT(ign_transport, send,
+  TP_ARGS(const char *, _topic, const char *, _sender, uint64_t, _seq,
+          uint64_t, _id, uint64_t, _size),
+  TP_FIELDS(
+    ctf_string(topic, _topic)
+    ctf_string(sender, _sender)
+    ctf_integer(uint64_t, seq, _seq)
+    ctf_integer(uint64_t, id, _id)
+    ctf_integer(uint64_t, size, _size)))
+
+/// \brief A message is received from a remote publisher. The sender and
+/// the sequence number match the ones of the send event of the publisher.
+/// The sequence number is 0 if it's not on the wire.
+TRACEPOINT_EVENT(ign_transport, receive,
+  TP_ARGS(const char *, _topic, const char *, _sender, uint64_t, _seq,
+          uint64_t, _id, uint64_t, _size),
+  TP_FIELDS(
+    ctf_string(topic, _topic)
+    ctf_string(sender, _sender)
+    ctf_integer(uint64_t, seq, _seq)
+    ctf_integer(uint64_t, id, _id)
+    ctf_integer(uint64_t, size, _size)))
+
+/// \brief A local message is taken from the publication queue.
+TRACEPOINT_EVENT(ign_transport, local_dispatch,
+  TP_ARGS(const char *, _topic, uint64_t, _id),
+  TP_FIELDS(
+    ctf_string(topic, _topic)
+    ctf_integer(uint64_t, id, _id)))
+
+/// \brief The callbacks of a message are triggered.
+TRACEPOINT_EVENT(ign_transport, trigger_callbacks,
+  TP_ARGS(const char *, _topic, uint64_t, _id),
+  TP_FIELDS(
+    ctf_string(topic, _topic)
+    ctf_integer(uint64_t, id, _id)))
+
+/// \brief A callback of a handler starts.
+TRACEPOINT_EVENT(ign_transport, callback_start,
+  TP_ARGS(const char *, _handler, uint64_t, _id),
+  TP_FIELDS(
+    ctf_string(handler, _handler)
+    ctf_integer(uint64_t, id, _id)))
+
+/// \brief A callback of a handler ends.
+TRACEPOINT_EVENT(ign_transport, callback_end,
+  TP_ARGS(const char *, _handler, uint64_t, _id),
+  TP_FIELDS(
+    ctf_string(handler, _handler)
+    ctf_integer(uint64_t, id, _id)))
+
+/// \brief Events of a service call. A call is identified by the id of the
+/// response receiver of the requester and the request id.
+TRACEPOINT_EVENT_CLASS(ign_transport, service,
+  TP_ARGS(const char *, _topic, const char *, _requester, uint64_t, _id),
+  TP_FIELDS(
+    ctf_string(topic, _topic)
+    ctf_string(requester, _requester)
+    ctf_integer(uint64_t, id, _id)))
+
+/// \brief A request is sent to a remote responser.
+TRACEPOINT_EVENT_INSTANCE(ign_transport, service, srv_request_send,
+  TP_ARGS(const char *, _topic, const char *, _requester, uint64_t, _id))
+
+/// \brief A request is received from a remote requester.
+TRACEPOINT_EVENT_INSTANCE(ign_transport, service, srv_request_receive,
+  TP_ARGS(const char *, _topic, const char *, _requester, uint64_t, _id))
+
+/// \brief A response is sent to a remote requester.
+TRACEPOINT_EVENT_INSTANCE(ign_transport, service, srv_response_send,
+  TP_ARGS(const char *, _topic, const char *, _requester, uint64_t, _id))
+
+/// \brief A response is received from a remote responser.
+TRACEPOINT_EVENT_INSTANCE(ign_transport, service, srv_response_receive,
+  TP_ARGS(const char *, _topic, const char *, _requester, uint64_t, _id))
+
+#endif
+
+#include <lttng/tracepoint-event.h>
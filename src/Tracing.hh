@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#ifndef IGN_TRANSPORT_TRACING_HH_
+#define IGN_TRANSPORT_TRACING_HH_
+
+#include <atomic>
+#include <cstdint>
+
+#include "ignition/transport/config.hh"
+
+#ifdef HAVE_LTTNG
+#include "TracepointProvider.hh"
+
+/// \brief Emit a static tracepoint of the ign_transport provider. The
+/// arguments are only evaluated while the event is enabled in a tracing
+/// session. Without LTTng, it expands to nothing.
+#define IGN_TRANSPORT_TRACEPOINT(_event, ...) \
+  tracepoint(ign_transport, _event, __VA_ARGS__)
+#else
+#define IGN_TRANSPORT_TRACEPOINT(_event, ...) do {} while (false)
+#endif
+
+namespace ignition
+{
+  namespace transport
+  {
+    inline namespace IGNITION_TRANSPORT_VERSION_NAMESPACE
+    {
+#ifdef HAVE_LTTNG
+    /// \brief Id of the message handled by the calling thread.
+    /// \return A reference to the id.
+    inline uint64_t &currentTraceId()
+    {
+      thread_local uint64_t id = 0;
+      return id;
+    }
+
+    /// \brief Get new message ids, unique in the process.
+    /// \param[in] _count Number of consecutive ids.
+    /// \return The first id.
+    inline uint64_t nextTraceId(const uint64_t _count = 1)
+    {
+      static std::atomic<uint64_t> next{1};
+      return next.fetch_add(_count, std::memory_order_relaxed);
+    }
+#else
+    inline uint64_t currentTraceId()
+    {
+      return 0;
+    }
+
+    inline uint64_t nextTraceId(const uint64_t = 1)
+    {
+      return 0;
+    }
+#endif
+
+    /// \brief Set the id of the message handled by the calling thread
+    /// during the lifetime of the scope, so the tracepoints of the code
+    /// further down the path of the message can get it without passing it
+    /// around. The previous id is restored on destruction.
+    class TraceIdScope
+    {
+      /// \brief Constructor.
+      /// \param[in] _id The id of the message.
+#ifdef HAVE_LTTNG
+      public: explicit TraceIdScope(const uint64_t _id)
+        : previous(currentTraceId())
+      {
+        currentTraceId() = _id;
+      }
+
+      /// \brief Destructor.
+      public: ~TraceIdScope()
+      {
+        currentTraceId() = this->previous;
+      }
+
+      /// \brief The id to restore.
+      private: uint64_t previous;
+#else
+      public: explicit TraceIdScope(const uint64_t)
+      {
+      }
+#endif
+
+      /// \brief No copy constructor.
+      public: TraceIdScope(const TraceIdScope &) = delete;
+
+      /// \brief No assignment operator.
+      public: TraceIdScope &operator=(const TraceIdScope &) = delete;
+    };
+    }
+  }
+}
+
+#endif
@@ -15,8 +15,9 @@
  *
 */
 
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <vector>
 
 #include "ignition/transport/Uuid.hh"
 
@@ -43,18 +44,32 @@ Uuid::~Uuid()
 }
 
 //////////////////////////////////////////////////
-std::string Uuid::ToString() const
+void Uuid::Octets(unsigned char (&_octets)[UuidBinaryLen]) const
 {
-  std::string uuidStr;
-  char* szUuid = NULL;
-  if (::UuidToStringA(&this->data, reinterpret_cast<RPC_CSTR*>(&szUuid)) ==
-    RPC_S_OK)
+  // The first fields are integers in host order.
+  for (int i = 0; i < 4; ++i)
+    _octets[i] = static_cast<unsigned char>(this->data.Data1 >> (24 - 8 * i));
+  for (int i = 0; i < 2; ++i)
   {
-        uuidStr = szUuid;
-        ::RpcStringFreeA(reinterpret_cast<RPC_CSTR*>(&szUuid));
+    _octets[4 + i] =
+      static_cast<unsigned char>(this->data.Data2 >> (8 - 8 * i));
+    _octets[6 + i] =
+      static_cast<unsigned char>(this->data.Data3 >> (8 - 8 * i));
   }
+  memcpy(&_octets[8], this->data.Data4, 8);
+}
 
-  return uuidStr;
+//////////////////////////////////////////////////
+void Uuid::SetOctets(const unsigned char (&_octets)[UuidBinaryLen])
+{
+  this->data.Data1 = 0;
+  for (int i = 0; i < 4; ++i)
+    this->data.Data1 = (this->data.Data1 << 8) | _octets[i];
+  this->data.Data2 = static_cast<unsigned short>((_octets[4] << 8) |
+    _octets[5]);
+  this->data.Data3 = static_cast<unsigned short>((_octets[6] << 8) |
+    _octets[7]);
+  memcpy(this->data.Data4, &_octets[8], 8);
 }
 #else
 /* Unix implementation using libuuid library */
@@ -71,20 +86,125 @@ Uuid::~Uuid()
   uuid_clear(this->data);
 }
 
+//////////////////////////////////////////////////
+void Uuid::Octets(unsigned char (&_octets)[UuidBinaryLen]) const
+{
+  memcpy(_octets, this->data, UuidBinaryLen);
+}
+
+//////////////////////////////////////////////////
+void Uuid::SetOctets(const unsigned char (&_octets)[UuidBinaryLen])
+{
+  memcpy(this->data, _octets, UuidBinaryLen);
+}
+#endif
+
 //////////////////////////////////////////////////
 std::string Uuid::ToString() const
 {
-  std::vector<char> uuidStr(Uuid::UuidStrLen);
+  static const char kHexDigits[] = "0123456789abcdef";
 
-  snprintf(&uuidStr[0], Uuid::UuidStrLen,
-    "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-    this->data[0], this->data[1], this->data[2], this->data[3],
-    this->data[4], this->data[5], this->data[6], this->data[7],
-    this->data[8], this->data[9], this->data[10], this->data[11],
-    this->data[12], this->data[13], this->data[14], this->data[15]);
+  unsigned char octets[UuidBinaryLen];
+  this->Octets(octets);
 
   // Do not include the \0 in the string.
-  return std::string(uuidStr.begin(), uuidStr.end() - 1);
+  std::string uuidStr(Uuid::UuidStrLen - 1, '-');
+  std::size_t pos = 0;
+  for (std::size_t i = 0; i < UuidBinaryLen; ++i)
+  {
+    // Hyphens before the octets 4, 6, 8 and 10.
+    if (i == 4 || i == 6 || i == 8 || i == 10)
+      ++pos;
+    uuidStr[pos++] = kHexDigits[octets[i] >> 4];
+    uuidStr[pos++] = kHexDigits[octets[i] & 0x0f];
+  }
+  return uuidStr;
 }
 
-#endif
+//////////////////////////////////////////////////
+std::string Uuid::ToBinary() const
+{
+  unsigned char octets[UuidBinaryLen];
+  this->Octets(octets);
+  return std::string(reinterpret_cast<const char *>(octets), UuidBinaryLen);
+}
+
+//////////////////////////////////////////////////
+bool Uuid::Parse(const std::string &_str, Uuid &_uuid)
+{
+  unsigned char octets[UuidBinaryLen];
+  if (_str.size() == UuidBinaryLen)
+  {
+    memcpy(octets, _str.data(), UuidBinaryLen);
+    _uuid.SetOctets(octets);
+    return true;
+  }
+
+  if (_str.size() != static_cast<std::size_t>(Uuid::UuidStrLen - 1))
+    return false;
+
+  auto hexValue = [](const char _c) -> int
+  {
+    if (_c >= '0' && _c <= '9')
+      return _c - '0';
+    if (_c >= 'a' && _c <= 'f')
+      return _c - 'a' + 10;
+    if (_c >= 'A' && _c <= 'F')
+      return _c - 'A' + 10;
+    return -1;
+  };
+
+  std::size_t pos = 0;
+  for (std::size_t i = 0; i < UuidBinaryLen; ++i)
+  {
+    if (i == 4 || i == 6 || i == 8 || i == 10)
+    {
+      if (_str[pos++] != '-')
+        return false;
+    }
+    const int high = hexValue(_str[pos++]);
+    const int low = hexValue(_str[pos++]);
+    if (high < 0 || low < 0)
+      return false;
+    octets[i] = static_cast<unsigned char>((high << 4) | low);
+  }
+
+  _uuid.SetOctets(octets);
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t Uuid::Hash() const
+{
+  // The octets are random, so folding them is enough.
+  unsigned char octets[UuidBinaryLen];
+  this->Octets(octets);
+  uint64_t high, low;
+  memcpy(&high, &octets[0], sizeof(high));
+  memcpy(&low, &octets[8], sizeof(low));
+  return static_cast<std::size_t>(high ^ low);
+}
+
+//////////////////////////////////////////////////
+bool Uuid::operator==(const Uuid &_other) const
+{
+  unsigned char octets[UuidBinaryLen], otherOctets[UuidBinaryLen];
+  this->Octets(octets);
+  _other.Octets(otherOctets);
+  return memcmp(octets, otherOctets, UuidBinaryLen) == 0;
+}
+
+//////////////////////////////////////////////////
+bool Uuid::operator!=(const Uuid &_other) const
+{
+  return !(*this == _other);
+}
+
+//////////////////////////////////////////////////
+bool Uuid::operator<(const Uuid &_other) const
+{
+  unsigned char octets[UuidBinaryLen], otherOctets[UuidBinaryLen];
+  this->Octets(octets);
+  _other.Octets(otherOctets);
+  return memcmp(octets, otherOctets, UuidBinaryLen) < 0;
+}
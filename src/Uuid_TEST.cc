@@ -52,6 +52,57 @@ TEST(UuidTest, testToString)
     EXPECT_GT(isxdigit(output.str()[i]), 0);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check the binary representation and the parsing of UUIDs.
+TEST(UuidTest, testBinary)
+{
+  transport::Uuid uuid1;
+  transport::Uuid uuid2;
+  EXPECT_TRUE(uuid1 == uuid1);
+  EXPECT_TRUE(uuid1 != uuid2);
+  EXPECT_NE(uuid1 < uuid2, uuid2 < uuid1);
+  EXPECT_EQ(uuid1 < uuid2, uuid1.ToBinary() < uuid2.ToBinary());
+
+  const std::string binary = uuid1.ToBinary();
+  ASSERT_EQ(16u, binary.size());
+  EXPECT_NE(uuid1.ToBinary(), uuid2.ToBinary());
+
+  // The binary representation has the octets of the string one.
+  const std::string str = uuid1.ToString();
+  for (auto i = 0; i < 4; ++i)
+  {
+    EXPECT_EQ(std::stoul(str.substr(2 * i, 2), nullptr, 16),
+      static_cast<unsigned char>(binary[i]));
+  }
+  EXPECT_EQ(std::stoul(str.substr(34, 2), nullptr, 16),
+    static_cast<unsigned char>(binary[15]));
+
+  // Parse both representations.
+  transport::Uuid parsed;
+  EXPECT_TRUE(transport::Uuid::Parse(binary, parsed));
+  EXPECT_EQ(uuid1, parsed);
+  EXPECT_EQ(std::hash<transport::Uuid>()(uuid1),
+    std::hash<transport::Uuid>()(parsed));
+
+  EXPECT_TRUE(transport::Uuid::Parse(uuid2.ToString(), parsed));
+  EXPECT_EQ(uuid2, parsed);
+  EXPECT_EQ(uuid2.ToString(), parsed.ToString());
+
+  std::string upper = uuid1.ToString();
+  for (auto &c : upper)
+    c = static_cast<char>(toupper(c));
+  EXPECT_TRUE(transport::Uuid::Parse(upper, parsed));
+  EXPECT_EQ(uuid1, parsed);
+
+  // Invalid UUIDs leave the output unchanged.
+  for (const std::string &invalid : {std::string(""), std::string("1234"),
+         str.substr(0, 35) + "g", str.substr(0, 8) + "+" + str.substr(9)})
+  {
+    EXPECT_FALSE(transport::Uuid::Parse(invalid, parsed));
+    EXPECT_EQ(uuid1, parsed);
+  }
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -15,24 +15,45 @@
  *
 */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _MSC_VER
 #pragma warning(push, 0)
 #endif
 #include <ignition/msgs.hh>
+#include <google/protobuf/util/json_util.h>
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 #include "ign.hh"
 #include "ignition/transport/config.hh"
 #include "ignition/transport/Helpers.hh"
 #include "ignition/transport/Node.hh"
+#include "ignition/transport/NodeShared.hh"
+#include "ignition/transport/TopicStatistics.hh"
+#include "ignition/transport/TopicUtils.hh"
 
 #ifdef _MSC_VER
 # pragma warning(disable: 4503)
@@ -45,6 +66,7 @@ using namespace transport;
 extern "C" void cmdTopicList()
 {
   Node node;
+  node.WaitForDiscovery();
 
   std::vector<std::string> topics;
   node.TopicList(topics);
@@ -63,6 +85,7 @@ extern "C" void cmdTopicInfo(const char *_topic)
   }
 
   Node node;
+  node.WaitForDiscovery();
 
   // Get the publishers on the requested topic
   std::vector<MessagePublisher> publishers;
@@ -92,6 +115,7 @@ extern "C" void cmdTopicInfo(const char *_topic)
 extern "C" void cmdServiceList()
 {
   Node node;
+  node.WaitForDiscovery();
 
   std::vector<std::string> services;
   node.ServiceList(services);
@@ -110,6 +134,7 @@ extern "C" void cmdServiceInfo(const char *_service)
   }
 
   Node node;
+  node.WaitForDiscovery();
 
   // Get the publishers on the requested topic
   std::vector<ServicePublisher> publishers;
@@ -136,102 +161,150 @@ extern "C" void cmdServiceInfo(const char *_service)
 }
 
 //////////////////////////////////////////////////
-extern "C" void cmdTopicPub(const char *_topic,
+/// \brief Create the message of 'ign topic -p', printing the errors.
+/// \param[in] _topic Topic name.
+/// \param[in] _msgType Message type.
+/// \param[in] _msgData Message data, in the format of DebugString().
+/// \return The message, or nullptr on error.
+static std::unique_ptr<ProtoMsg> newPubMessage(const char *_topic,
   const char *_msgType, const char *_msgData)
 {
   if (!_topic)
   {
     std::cerr << "Topic name is null\n";
-    return;
+    return nullptr;
   }
 
   if (!_msgType)
   {
     std::cerr << "Message type is null\n";
-    return;
+    return nullptr;
   }
 
   if (!_msgData)
   {
     std::cerr << "Message data is null\n";
-    return;
+    return nullptr;
   }
 
   // Create the message, and populate the field with _msgData
   auto msg = ignition::msgs::Factory::New(_msgType, _msgData);
-  if (msg)
-  {
-    // Create the node and advertise the topic
-    ignition::transport::Node node;
-    auto pub = node.Advertise(_topic, msg->GetTypeName());
-
-    // Publish the message
-    if (pub)
-    {
-      // \todo(anyone) Change this sleep to a WaitForSubscribers() call.
-      // See issue #47.
-      std::this_thread::sleep_for(std::chrono::milliseconds(800));
-      pub.Publish(*msg);
-    }
-    else
-    {
-      std::cerr << "Unable to publish on topic[" << _topic << "] "
-        << "with message type[" << _msgType << "].\n";
-    }
-  }
-  else
+  if (!msg)
   {
     std::cerr << "Unable to create message of type[" << _msgType << "] "
       << "with data[" << _msgData << "].\n";
   }
+  return msg;
 }
 
 //////////////////////////////////////////////////
-extern "C" void cmdServiceReq(const char *_service,
-  const char *_reqType, const char *_repType, const int _timeout,
-  const char *_reqData)
+/// \brief Advertise the topic of 'ign topic -p', printing the errors.
+/// \param[in] _node The node.
+/// \param[in] _topic Topic name.
+/// \param[in] _msg The message to publish.
+/// \param[in] _msgType Message type, as given by the user.
+/// \return The publisher, valid if the topic was advertised.
+static Node::Publisher advertisePub(Node &_node, const char *_topic,
+  const ProtoMsg &_msg, const char *_msgType)
+{
+  auto pub = _node.Advertise(_topic, _msg.GetTypeName());
+  if (!pub)
+  {
+    std::cerr << "Unable to publish on topic[" << _topic << "] "
+      << "with message type[" << _msgType << "].\n";
+    return pub;
+  }
+
+  // \todo(anyone) Change this sleep to a WaitForSubscribers() call.
+  // See issue #47.
+  std::this_thread::sleep_for(std::chrono::milliseconds(800));
+  return pub;
+}
+
+//////////////////////////////////////////////////
+extern "C" void cmdTopicPub(const char *_topic,
+  const char *_msgType, const char *_msgData)
+{
+  auto msg = newPubMessage(_topic, _msgType, _msgData);
+  if (!msg)
+    return;
+
+  // Create the node and advertise the topic
+  ignition::transport::Node node;
+  auto pub = advertisePub(node, _topic, *msg, _msgType);
+
+  // Publish the message
+  if (pub)
+    pub.Publish(*msg);
+}
+
+//////////////////////////////////////////////////
+/// \brief Create the messages of 'ign service -r', printing the errors.
+/// \param[in] _service Service name.
+/// \param[in] _reqType Message type of the request.
+/// \param[in] _repType Message type of the response.
+/// \param[in] _reqData Request data, in the format of DebugString().
+/// \param[out] _req The request.
+/// \param[out] _rep The response.
+/// \return True if the messages were created.
+static bool newServiceMessages(const char *_service, const char *_reqType,
+  const char *_repType, const char *_reqData, std::unique_ptr<ProtoMsg> &_req,
+  std::unique_ptr<ProtoMsg> &_rep)
 {
   if (!_service)
   {
     std::cerr << "Service name is null\n";
-    return;
+    return false;
   }
 
   if (!_reqType)
   {
     std::cerr << "Request type is null\n";
-    return;
+    return false;
   }
 
   if (!_repType)
   {
     std::cerr << "Response type is null\n";
-    return;
+    return false;
   }
 
   if (!_reqData)
   {
     std::cerr << "Request data is null\n";
-    return;
+    return false;
   }
 
   // Create the request, and populate the field with _reqData
-  auto req = ignition::msgs::Factory::New(_reqType, _reqData);
-  if (!req)
+  _req = ignition::msgs::Factory::New(_reqType, _reqData);
+  if (!_req)
   {
     std::cerr << "Unable to create request of type[" << _reqType << "] "
               << "with data[" << _reqData << "].\n";
-    return;
+    return false;
   }
 
   // Create the response.
-  auto rep = ignition::msgs::Factory::New(_repType);
-  if (!rep)
+  _rep = ignition::msgs::Factory::New(_repType);
+  if (!_rep)
   {
     std::cerr << "Unable to create response of type[" << _repType << "].\n";
-    return;
+    return false;
   }
 
+  return true;
+}
+
+//////////////////////////////////////////////////
+extern "C" void cmdServiceReq(const char *_service,
+  const char *_reqType, const char *_repType, const int _timeout,
+  const char *_reqData)
+{
+  std::unique_ptr<ProtoMsg> req;
+  std::unique_ptr<ProtoMsg> rep;
+  if (!newServiceMessages(_service, _reqType, _repType, _reqData, req, rep))
+    return;
+
   // Create the node.
   ignition::transport::Node node;
   bool result;
@@ -249,9 +322,130 @@ extern "C" void cmdServiceReq(const char *_service,
     std::cerr << "Service call timed out" << std::endl;
 }
 
+//////////////////////////////////////////////////
+extern "C" void cmdServiceReqRepeat(const char *_service,
+  const char *_reqType, const char *_repType, const int _timeout,
+  const char *_reqData, const int _count, const int _concurrency)
+{
+  std::unique_ptr<ProtoMsg> req;
+  std::unique_ptr<ProtoMsg> rep;
+  if (!newServiceMessages(_service, _reqType, _repType, _reqData, req, rep))
+    return;
+
+  if (_count <= 0 || _concurrency <= 0)
+  {
+    std::cerr << "The number of requests and the concurrency must be "
+              << "positive.\n";
+    return;
+  }
+
+  std::mutex mutex;
+  Statistics latency;
+  uint64_t succeeded = 0;
+  uint64_t failed = 0;
+  uint64_t timedOut = 0;
+  std::atomic<int> next{0};
+
+  // Each worker issues blocking requests with its own node and response,
+  // until all the requests are issued.
+  auto work = [&]()
+  {
+    Node node;
+    std::unique_ptr<ProtoMsg> response(rep->New());
+    while (next.fetch_add(1) < _count)
+    {
+      bool result = false;
+      const auto start = std::chrono::steady_clock::now();
+      const bool executed = node.Request(_service, *req, _timeout,
+        *response, result);
+      const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!executed)
+      {
+        ++timedOut;
+        continue;
+      }
+      latency.Update(elapsed.count());
+      if (result)
+        ++succeeded;
+      else
+        ++failed;
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int i = 1; i < std::min(_concurrency, _count); ++i)
+    workers.emplace_back(work);
+  work();
+  for (auto &worker : workers)
+    worker.join();
+  const double elapsed = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "Requests: " << _count << ", succeeded " << succeeded
+            << ", failed " << failed << ", timed out " << timedOut << "\n"
+            << "Time: " << elapsed << " s, throughput "
+            << (elapsed > 0 ? _count / elapsed : 0.0) << " requests/s\n";
+  if (latency.Count() > 0)
+  {
+    std::cout << std::setprecision(3)
+              << "Latency: min " << latency.Min()
+              << " ms, p50 " << latency.Percentile(50)
+              << " ms, p90 " << latency.Percentile(90)
+              << " ms, p99 " << latency.Percentile(99)
+              << " ms, p99.9 " << latency.Percentile(99.9)
+              << " ms, max " << latency.Max() << " ms\n";
+  }
+  std::cout << std::flush;
+}
+
+//////////////////////////////////////////////////
+/// \brief Wait until an echo ends.
+/// \param[in] _duration Duration (seconds) to run, a negative value means
+/// until _count messages are received.
+/// \param[in] _count Number of messages to wait for, a value <= 0 means
+/// until a SIGINT or SIGTERM is received.
+/// \param[in] _mutex Mutex protecting _received.
+/// \param[in] _condition Notified when a message is received.
+/// \param[in] _received Number of messages received.
+static void waitForEcho(const double _duration, const int _count,
+    std::mutex &_mutex, std::condition_variable &_condition,
+    const int &_received)
+{
+  if (_duration >= 0)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(
+      static_cast<int64_t>(_duration * 1000)));
+    return;
+  }
+
+  // Wait forever if _count <= 0. Otherwise wait for a specific number of
+  // messages.
+  if (_count <= 0)
+  {
+    ignition::transport::waitForShutdown();
+  }
+  else
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [&]{return _received >= _count;});
+  }
+}
+
 //////////////////////////////////////////////////
 extern "C" void cmdTopicEcho(const char *_topic,
   const double _duration, int _count)
+{
+  cmdTopicEchoFormat(_topic, _duration, _count, kTopicEchoText);
+}
+
+//////////////////////////////////////////////////
+extern "C" void cmdTopicEchoFormat(const char *_topic,
+  const double _duration, int _count, const int _format)
 {
   if (!_topic || std::string(_topic).empty())
   {
@@ -259,43 +453,522 @@ extern "C" void cmdTopicEcho(const char *_topic,
     return;
   }
 
+  if (_format < kTopicEchoText || _format > kTopicEchoJson)
+  {
+    std::cerr << "Invalid echo format [" << _format << "].\n";
+    return;
+  }
+
   std::mutex mutex;
   std::condition_variable condition;
   int count = 0;
 
-  std::function<void(const ProtoMsg&)> cb = [&](const ProtoMsg &_msg)
+  Node node;
+  if (_format == kTopicEchoText)
+  {
+    std::function<void(const ProtoMsg&)> cb = [&](const ProtoMsg &_msg)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::cout << _msg.DebugString() << std::endl;
+      ++count;
+      condition.notify_one();
+    };
+
+    if (!node.Subscribe(_topic, cb))
+      return;
+
+    waitForEcho(_duration, _count, mutex, condition, count);
+    return;
+  }
+
+#ifdef _WIN32
+  if (_format != kTopicEchoJson)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  // Messages reused to convert the data to JSON, indexed by type.
+  std::map<std::string, std::unique_ptr<ProtoMsg>> jsonMsgs;
+  std::string json;
+  google::protobuf::util::JsonPrintOptions jsonOptions;
+  jsonOptions.add_whitespace = false;
+
+  auto lastFlush = std::chrono::steady_clock::now();
+  auto cb = [&](const char *_data, const size_t _size,
+                const MessageInfo &_info)
   {
     std::lock_guard<std::mutex> lock(mutex);
-    std::cout << _msg.DebugString() << std::endl;
+    if (_count > 0 && count >= _count)
+      return;
+
+    if (_format == kTopicEchoJson)
+    {
+      auto &msg = jsonMsgs[_info.Type()];
+      if (!msg)
+      {
+        msg = ignition::msgs::Factory::New(_info.Type());
+        if (!msg)
+        {
+          std::cerr << "Unable to create message of type["
+                    << _info.Type() << "].\n";
+          return;
+        }
+      }
+
+      json.clear();
+      if (!msg->ParseFromArray(_data, static_cast<int>(_size)) ||
+          !google::protobuf::util::MessageToJsonString(
+            *msg, &json, jsonOptions).ok())
+      {
+        std::cerr << "Unable to convert a message of type["
+                  << _info.Type() << "] to JSON.\n";
+        return;
+      }
+      json += '\n';
+      std::cout.write(json.data(), json.size());
+    }
+    else
+    {
+      if (_format == kTopicEchoFramed)
+      {
+        char header[4];
+        uint32_t size = static_cast<uint32_t>(_size);
+        for (char &byte : header)
+        {
+          byte = static_cast<char>(size & 0xFF);
+          size >>= 8;
+        }
+        std::cout.write(header, sizeof(header));
+      }
+      std::cout.write(_data, _size);
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastFlush >= std::chrono::milliseconds(100))
+    {
+      std::cout.flush();
+      lastFlush = now;
+    }
+
     ++count;
     condition.notify_one();
   };
 
+  if (!node.SubscribeRaw(_topic, cb))
+    return;
+
+  waitForEcho(_duration, _count, mutex, condition, count);
+
+  // Stop the callbacks before flushing the last messages.
+  node.Unsubscribe(_topic);
+  std::lock_guard<std::mutex> lock(mutex);
+  std::cout.flush();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check if a topic name matches a pattern, where '*' matches any
+/// sequence of characters and '?' any character.
+/// \param[in] _pattern The pattern.
+/// \param[in] _topic The topic name.
+/// \return True if the topic matches.
+static bool matchTopic(const std::string &_pattern, const std::string &_topic)
+{
+  std::size_t p = 0;
+  std::size_t t = 0;
+  std::size_t star = std::string::npos;
+  std::size_t starMatch = 0;
+  while (t < _topic.size())
+  {
+    if (p < _pattern.size() && (_pattern[p] == '?' || _pattern[p] == _topic[t]))
+    {
+      ++p;
+      ++t;
+    }
+    else if (p < _pattern.size() && _pattern[p] == '*')
+    {
+      star = p++;
+      starMatch = t;
+    }
+    else if (star != std::string::npos)
+    {
+      // Let the last '*' match one more character.
+      p = star + 1;
+      t = ++starMatch;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  while (p < _pattern.size() && _pattern[p] == '*')
+    ++p;
+  return p == _pattern.size();
+}
+
+//////////////////////////////////////////////////
+/// \brief Format a number of bytes with a binary prefix.
+/// \param[in] _bytes The number of bytes.
+/// \return The formatted value, e.g. "1.50 KB".
+static std::string formatBytes(double _bytes)
+{
+  static const char *kUnits[] = {"B", "KB", "MB", "GB"};
+  std::size_t unit = 0;
+  while (_bytes >= 1024 && unit < 3)
+  {
+    _bytes /= 1024;
+    ++unit;
+  }
+
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.2f %s", _bytes, kUnits[unit]);
+  return buffer;
+}
+
+//////////////////////////////////////////////////
+extern "C" void cmdTopicStats(const char *_topic, const double _duration,
+  const int _fields)
+{
+  if (!_topic || std::string(_topic).empty())
+  {
+    std::cerr << "Invalid topic. Topic must not be empty.\n";
+    return;
+  }
+
+  const std::string pattern = _topic;
+  const bool wildcard = pattern.find_first_of("*?") != std::string::npos;
+
+  /// \brief Statistics of a topic.
+  struct TopicState
+  {
+    /// \brief Messages received in the current period.
+    uint64_t msgs = 0;
+
+    /// \brief Bytes received in the current period.
+    uint64_t bytes = 0;
+
+    /// \brief Sizes of all the messages received.
+    Statistics sizes;
+  };
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool done = false;
+  std::map<std::string, TopicState> topics;
+
   Node node;
-  if (!node.Subscribe(_topic, cb))
+  const bool latency = _fields & kTopicStatsLatency;
+
+  // Subscribe to a topic, without parsing its messages.
+  auto subscribe = [&](const std::string &_name) -> bool
+  {
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      if (!topics.emplace(_name, TopicState()).second)
+        return true;
+    }
+
+    RawCallback cb = [&mutex, &topics, _name](const char *, const size_t _size,
+      const MessageInfo &)
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      auto &state = topics[_name];
+      ++state.msgs;
+      state.bytes += _size;
+      state.sizes.Update(static_cast<double>(_size));
+    };
+
+    if (!node.SubscribeRaw(_name, cb))
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      topics.erase(_name);
+      return false;
+    }
+
+    // The latency comes from the publication metadata, only sent when the
+    // topic statistics are enabled. Enable them without republishing them.
+    std::string fullyQualifiedTopic;
+    if (latency && TopicUtils::FullyQualifiedName(node.Options().Partition(),
+          node.Options().NameSpace(), _name, fullyQualifiedTopic))
+    {
+      NodeShared::Instance()->EnableStats(fullyQualifiedTopic, true,
+        [](const TopicStatistics &){});
+    }
+    return true;
+  };
+
+  // Subscribe to the topics matching the pattern that aren't subscribed.
+  auto discover = [&]()
+  {
+    std::vector<std::string> names;
+    node.TopicList(names);
+    for (const auto &name : names)
+    {
+      if (matchTopic(pattern, name))
+        subscribe(name);
+    }
+  };
+
+  if (wildcard)
+    discover();
+  else if (!subscribe(pattern))
     return;
 
+  // Print the statistics every second, until the end of the command.
+  std::thread reporter([&]()
+  {
+    auto last = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lk(mutex);
+    while (!condition.wait_for(lk, std::chrono::seconds(1),
+                               [&]{return done;}))
+    {
+      const auto now = std::chrono::steady_clock::now();
+      const double elapsed =
+        std::chrono::duration<double>(now - last).count();
+      last = now;
+
+      for (auto &entry : topics)
+      {
+        auto &state = entry.second;
+        std::cout << entry.first << "\n";
+        if (_fields & kTopicStatsRate)
+        {
+          std::cout << "  rate: " << std::fixed << std::setprecision(2)
+                    << state.msgs / elapsed << " Hz\n";
+        }
+        if (_fields & kTopicStatsBandwidth)
+        {
+          std::cout << "  bandwidth: " << formatBytes(state.bytes / elapsed)
+                    << "/s\n";
+        }
+        if ((_fields & kTopicStatsSize) && state.sizes.Count() > 0)
+        {
+          std::cout << "  size: min " << formatBytes(state.sizes.Min())
+                    << ", avg " << formatBytes(state.sizes.Avg())
+                    << ", max " << formatBytes(state.sizes.Max())
+                    << ", p50 " << formatBytes(state.sizes.Percentile(50))
+                    << ", p99 " << formatBytes(state.sizes.Percentile(99))
+                    << "\n";
+        }
+        if (latency)
+        {
+          const auto stats = node.TopicStats(entry.first);
+          if (stats && stats->AgeStatistics().Count() > 0)
+          {
+            const auto age = stats->AgeStatistics();
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  latency: p50 " << age.Percentile(50)
+                      << " ms, p90 " << age.Percentile(90)
+                      << " ms, p99 " << age.Percentile(99)
+                      << " ms, p99.9 " << age.Percentile(99.9)
+                      << " ms, max " << age.Max() << " ms\n";
+          }
+          else
+          {
+            std::cout << "  latency: not available, set "
+                      << "IGN_TRANSPORT_TOPIC_STATISTICS=1 in the publisher "
+                      << "and in this command\n";
+          }
+        }
+        std::cout << std::flush;
+        state.msgs = 0;
+        state.bytes = 0;
+      }
+
+      if (wildcard)
+      {
+        lk.unlock();
+        discover();
+        lk.lock();
+      }
+    }
+  });
+
   if (_duration >= 0)
   {
     std::this_thread::sleep_for(std::chrono::milliseconds(
       static_cast<int64_t>(_duration * 1000)));
+  }
+  else
+  {
+    ignition::transport::waitForShutdown();
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    done = true;
+  }
+  condition.notify_one();
+  reporter.join();
+}
+
+//////////////////////////////////////////////////
+/// \brief Field number of the padding of cmdTopicPubRepeat(), the largest
+/// one allowed by protobuf, so it's unknown to the messages.
+static const uint64_t kPaddingField = (1u << 29) - 1;
+
+/// \brief Set when cmdTopicPubRepeat() is interrupted by a signal.
+static std::atomic<bool> g_pubInterrupted{false};
+
+//////////////////////////////////////////////////
+/// \brief Signal handler of cmdTopicPubRepeat().
+/// \param[in] _signal The signal.
+static void pubSignalHandler(int _signal)
+{
+  if (_signal == SIGINT || _signal == SIGTERM)
+    g_pubInterrupted = true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Append a protobuf varint to a string.
+/// \param[in] _value The value.
+/// \param[in, out] _out The string.
+static void appendVarint(uint64_t _value, std::string &_out)
+{
+  while (_value >= 0x80)
+  {
+    _out.push_back(static_cast<char>((_value & 0x7F) | 0x80));
+    _value >>= 7;
+  }
+  _out.push_back(static_cast<char>(_value));
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the size of a protobuf varint.
+/// \param[in] _value The value.
+/// \return The number of bytes of the varint.
+static std::size_t varintSize(uint64_t _value)
+{
+  std::size_t size = 1;
+  for (; _value >= 0x80; _value >>= 7)
+    ++size;
+  return size;
+}
+
+//////////////////////////////////////////////////
+/// \brief Pad a serialized message to a size with unknown fields, which the
+/// subscribers skip when they parse it.
+/// \param[in] _size The size of the padded message.
+/// \param[in, out] _data The serialized message.
+/// \return False if the message is too big to be padded to _size.
+static bool padMessage(const std::size_t _size, std::string &_data)
+{
+  if (_data.size() == _size)
+    return true;
+
+  const uint64_t bytesTag = (kPaddingField << 3) | 2;
+  const uint64_t varintTag = kPaddingField << 3;
+  const std::size_t tagSize = varintSize(bytesTag);
+  if (_data.size() + tagSize + 1 > _size)
+    return false;
+
+  // Some sizes, e.g. 129 bytes after the tag, can't be reached by a single
+  // length delimited field. A varint field takes 6 bytes of them first.
+  std::size_t room = _size - _data.size() - tagSize;
+  std::size_t len = room - 1;
+  while (len > 0 && varintSize(len) + len > room)
+    --len;
+  if (varintSize(len) + len != room)
+  {
+    appendVarint(varintTag, _data);
+    appendVarint(0, _data);
+    return padMessage(_size, _data);
+  }
+
+  appendVarint(bytesTag, _data);
+  appendVarint(len, _data);
+  _data.append(len, '\0');
+  return true;
+}
+
+//////////////////////////////////////////////////
+extern "C" void cmdTopicPubRepeat(const char *_topic,
+  const char *_msgType, const char *_msgData, const double _rate,
+  const int _count, const double _duration, const int _size)
+{
+  auto msg = newPubMessage(_topic, _msgType, _msgData);
+  if (!msg)
+    return;
+
+  std::string data;
+  if (!msg->SerializeToString(&data))
+  {
+    std::cerr << "Unable to serialize the message.\n";
     return;
   }
 
-  // Wait forever if _count <= 0. Otherwise wait for a specific number of
-  // messages.
-  if (_count <= 0)
+  if (_size > 0 && !padMessage(static_cast<std::size_t>(_size), data))
   {
-    ignition::transport::waitForShutdown();
+    std::cerr << "The message is too big for a size of [" << _size
+              << "] bytes.\n";
+    return;
   }
-  else
+
+  ignition::transport::Node node;
+  auto pub = advertisePub(node, _topic, *msg, _msgType);
+  if (!pub)
+    return;
+
+  // The message is parsed and serialized once, and all the publications
+  // share its buffer.
+  std::shared_ptr<char[]> buffer(new char[std::max<std::size_t>(
+    data.size(), 1)]);
+  memcpy(buffer.get(), data.data(), data.size());
+  const std::shared_ptr<const char[]> sharedData = buffer;
+  const std::string msgType = msg->GetTypeName();
+
+  g_pubInterrupted = false;
+  auto prevIntHandler = std::signal(SIGINT, pubSignalHandler);
+  auto prevTermHandler = std::signal(SIGTERM, pubSignalHandler);
+
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point end = _duration < 0 ? Clock::time_point::max() :
+    start + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(_duration));
+  const std::chrono::duration<double> period(_rate > 0 ? 1.0 / _rate : 0.0);
+
+  uint64_t published = 0;
+  while (!g_pubInterrupted &&
+         (_count <= 0 || published < static_cast<uint64_t>(_count)))
   {
-    while (count < _count)
+    if (_rate > 0)
     {
-      std::unique_lock<std::mutex> lock(mutex);
-      condition.wait(lock, [&]{return count >= _count;});
+      // Sleep in short steps to handle the signals.
+      const Clock::time_point next = start +
+        std::chrono::duration_cast<Clock::duration>(period * published);
+      for (Clock::time_point now = Clock::now();
+           now < next && now < end && !g_pubInterrupted; now = Clock::now())
+      {
+        std::this_thread::sleep_for(std::min<Clock::duration>(next - now,
+          std::chrono::milliseconds(100)));
+      }
     }
+
+    if (g_pubInterrupted || Clock::now() >= end)
+      break;
+
+    if (!pub.PublishRaw(sharedData, data.size(), msgType))
+    {
+      std::cerr << "Unable to publish on topic[" << _topic << "].\n";
+      break;
+    }
+    ++published;
+  }
+
+  const double elapsed =
+    std::chrono::duration<double>(Clock::now() - start).count();
+  std::signal(SIGINT, prevIntHandler);
+  std::signal(SIGTERM, prevTermHandler);
+
+  std::cout << "Published " << published << " messages of "
+            << formatBytes(static_cast<double>(data.size())) << " in "
+            << std::fixed << std::setprecision(2) << elapsed << " s";
+  if (elapsed > 0)
+  {
+    std::cout << ": " << published / elapsed << " msgs/s, "
+              << formatBytes(published * data.size() / elapsed) << "/s";
   }
+  std::cout << std::endl;
 }
 
 //////////////////////////////////////////////////
@@ -47,6 +47,27 @@ extern "C" void cmdTopicPub(const char *_topic,
                                                        const char *_msgType,
                                                        const char *_msgData);
 
+/// \brief External hook to execute 'ign topic -p' with --rate, --num,
+/// --size or --flood from the command line. The message is parsed once and
+/// published repeatedly, and the achieved throughput is printed at the end.
+/// \param[in] _topic Topic name.
+/// \param[in] _msgType Message type.
+/// \param[in] _msgData The message, see cmdTopicPub().
+/// \param[in] _rate Messages per second. A value <= 0 publishes as fast as
+/// possible.
+/// \param[in] _count Number of messages to publish. A value <= 0 indicates
+/// no limit.
+/// \param[in] _duration Duration (seconds) to run. A value < 0 indicates no
+/// time limit. Without any limit, the messages are published until a SIGINT
+/// or SIGTERM is received.
+/// \param[in] _size Size (bytes) of the serialized message, which is padded
+/// with a field unknown to the subscribers. A value <= 0 publishes the
+/// message as it is.
+extern "C" void cmdTopicPubRepeat(const char *_topic, const char *_msgType,
+                                  const char *_msgData, const double _rate,
+                                  const int _count, const double _duration,
+                                  const int _size);
+
 /// \brief External hook to execute 'ign service -r' from the command line.
 /// \param[in] _service Service name.
 /// \param[in] _reqType Message type used in the request.
@@ -63,6 +84,26 @@ extern "C" void cmdServiceReq(const char *_service,
                                                          const int _timeout,
                                                          const char *_reqData);
 
+/// \brief External hook to execute 'ign service -r' with --num from the
+/// command line. The requests are issued by _concurrency threads, each one
+/// waiting for the response of its request before issuing the next one.
+/// The outcome of the requests, the throughput and the percentiles of the
+/// latency of the responses are printed at the end.
+/// \param[in] _service Service name.
+/// \param[in] _reqType Message type used in the request.
+/// \param[in] _repType Message type used in the response.
+/// \param[in] _timeout Timeout of each request (ms).
+/// \param[in] _reqData Input data sent in the requests, see cmdServiceReq().
+/// \param[in] _count Number of requests.
+/// \param[in] _concurrency Number of requests issued at the same time.
+extern "C" void cmdServiceReqRepeat(const char *_service,
+                                    const char *_reqType,
+                                    const char *_repType,
+                                    const int _timeout,
+                                    const char *_reqData,
+                                    const int _count,
+                                    const int _concurrency);
+
 /// \brief External hook to execute 'ign topic -e' from the command line.
 /// The _duration parameter overrides the _count parameter.
 /// \param[in] _topic Topic name.
@@ -75,6 +116,69 @@ extern "C" void cmdTopicEcho(const char *_topic,
                                                         const double _duration,
                                                         int _count);
 
+/// \brief Output formats of cmdTopicEchoFormat().
+enum TopicEchoFormat
+{
+  /// \brief Protobuf DebugString() of each message.
+  kTopicEchoText = 0,
+
+  /// \brief The serialized messages, back to back.
+  kTopicEchoRaw = 1,
+
+  /// \brief Each serialized message after its size, as a little endian
+  /// 32 bit unsigned integer.
+  kTopicEchoFramed = 2,
+
+  /// \brief One JSON object per message and per line.
+  kTopicEchoJson = 3
+};
+
+/// \brief External hook to execute 'ign topic -e --format' from the command
+/// line. Except in the text format, the topic is subscribed without parsing
+/// the messages, which are only parsed to convert them to JSON, and the
+/// output is buffered: it's flushed at most every 100 ms while messages
+/// arrive, and when the echo ends.
+/// \param[in] _topic Topic name.
+/// \param[in] _duration Duration (seconds) to run, see cmdTopicEcho().
+/// \param[in] _count Number of messages to echo, see cmdTopicEcho().
+/// \param[in] _format The output format, one of TopicEchoFormat.
+extern "C" void cmdTopicEchoFormat(const char *_topic,
+                                   const double _duration, int _count,
+                                   const int _format);
+
+/// \brief Fields printed by cmdTopicStats().
+enum TopicStatsFields
+{
+  /// \brief Rate of the messages.
+  kTopicStatsRate = 1 << 0,
+
+  /// \brief Bandwidth used by the messages.
+  kTopicStatsBandwidth = 1 << 1,
+
+  /// \brief Distribution of the message sizes.
+  kTopicStatsSize = 1 << 2,
+
+  /// \brief Percentiles of the message latency.
+  kTopicStatsLatency = 1 << 3,
+
+  /// \brief All the fields.
+  kTopicStatsAll = kTopicStatsRate | kTopicStatsBandwidth | kTopicStatsSize |
+                   kTopicStatsLatency
+};
+
+/// \brief External hook to execute 'ign topic --stats', 'ign topic --hz' and
+/// 'ign topic --bw' from the command line. The topics are subscribed without
+/// parsing their messages, and their statistics are printed every second.
+/// \param[in] _topic Topic name. A name with '*' (any sequence of
+/// characters) or '?' (any character) selects all the matching topics, and
+/// the topics that appear while running are added.
+/// \param[in] _duration Duration (seconds) to run. A value < 0 indicates
+/// no time limit.
+/// \param[in] _fields The fields to print, a combination of
+/// TopicStatsFields.
+extern "C" void cmdTopicStats(const char *_topic, const double _duration,
+                              const int _fields);
+
 /// \brief External hook to read the library version.
 /// \return C-string representing the version. Ex.: 0.1.2
 extern "C" const char *ignitionVersion();
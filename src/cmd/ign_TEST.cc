@@ -415,6 +415,37 @@ TEST(ignTest, TopicEcho)
   testing::waitAndCleanupFork(pi);
 }
 
+//////////////////////////////////////////////////
+/// \brief Check 'ign topic --hz' and 'ign topic --stats' with a pattern,
+/// running the publisher on a separate process.
+TEST(ignTest, TopicStats)
+{
+  // Launch a new publisher process that advertises a topic.
+  std::string publisher_path = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_twoProcsPublisher_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(publisher_path.c_str(),
+    g_partition.c_str());
+
+  std::string ign = std::string(IGN_PATH) + "/ign";
+  std::string output = custom_exec_str(
+    ign + " topic --hz -t /foo -d 2.5 " + g_ignVersion);
+  EXPECT_NE(std::string::npos, output.find("/foo\n"));
+  EXPECT_NE(std::string::npos, output.find("rate: "));
+  EXPECT_EQ(std::string::npos, output.find("bandwidth: "));
+
+  output = custom_exec_str(
+    ign + " topic --stats -t \"/f*\" -d 2.5 " + g_ignVersion);
+  EXPECT_NE(std::string::npos, output.find("/foo\n"));
+  EXPECT_NE(std::string::npos, output.find("rate: "));
+  EXPECT_NE(std::string::npos, output.find("bandwidth: "));
+  EXPECT_NE(std::string::npos, output.find("latency: "));
+
+  // Wait for the child process to return.
+  testing::waitAndCleanupFork(pi);
+}
+
 //////////////////////////////////////////////////
 /// \brief Check 'ign topic -e -n 2' running the publisher on a separate
 /// process.
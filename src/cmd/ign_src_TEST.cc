@@ -15,9 +15,13 @@
  *
 */
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <ignition/msgs.hh>
 
 #include "gtest/gtest.h"
@@ -145,6 +149,66 @@ TEST(ignTest, cmdTopicPub)
   restoreIO();
 }
 
+//////////////////////////////////////////////////
+/// \brief Check cmdTopicPubRepeat running the subscriber on the same process.
+TEST(ignTest, cmdTopicPubRepeat)
+{
+  std::stringstream stdOutBuffer;
+  std::stringstream stdErrBuffer;
+  redirectIO(stdOutBuffer, stdErrBuffer);
+
+  // The errors are the ones of cmdTopicPub.
+  cmdTopicPubRepeat(g_topic.c_str(), nullptr, g_reqData.c_str(), 0, 1, -1, 0);
+  EXPECT_EQ(stdErrBuffer.str(), "Message type is null\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  cmdTopicPubRepeat(g_topic.c_str(), g_intType.c_str(), g_reqData.c_str(),
+    0, 1, -1, 3);
+  EXPECT_EQ(stdErrBuffer.str(),
+    "The message is too big for a size of [3] bytes.\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  std::atomic<int> received{0};
+  std::atomic<bool> valid{true};
+  std::function<void(const char *, const size_t,
+    const transport::MessageInfo &)> cb =
+    [&](const char *_data, const size_t _size,
+        const transport::MessageInfo &)
+    {
+      // The padding is skipped by the parser.
+      msgs::Int32 msg;
+      if (_size != 100 || !msg.ParseFromArray(_data, static_cast<int>(_size))
+          || msg.data() != 10)
+      {
+        valid = false;
+      }
+      ++received;
+    };
+  transport::Node node;
+  ASSERT_TRUE(node.SubscribeRaw(g_topic, cb));
+
+  // Flood with padded messages.
+  cmdTopicPubRepeat(g_topic.c_str(), g_intType.c_str(), g_reqData.c_str(),
+    0, 50, -1, 100);
+  for (int i = 0; i < 50 && received < 50; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(50, received);
+  EXPECT_TRUE(valid);
+  EXPECT_EQ(0u, stdOutBuffer.str().find("Published 50 messages of 100.00 B"));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  // The rate is kept for the duration.
+  received = 0;
+  cmdTopicPubRepeat(g_topic.c_str(), g_intType.c_str(), g_reqData.c_str(),
+    20, 0, 0.5, 100);
+  EXPECT_GE(received, 8);
+  EXPECT_LE(received, 11);
+  EXPECT_TRUE(valid);
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  restoreIO();
+}
+
 //////////////////////////////////////////////////
 /// \brief Check cmdServiceReq running the advertiser on a the same process.
 TEST(ignTest, cmdServiceReq)
@@ -218,6 +282,47 @@ TEST(ignTest, cmdServiceReq)
   restoreIO();
 }
 
+//////////////////////////////////////////////////
+/// \brief Check cmdServiceReqRepeat running the advertiser on the same
+/// process.
+TEST(ignTest, cmdServiceReqRepeat)
+{
+  std::stringstream  stdOutBuffer;
+  std::stringstream  stdErrBuffer;
+  redirectIO(stdOutBuffer, stdErrBuffer);
+
+  const int kTimeout = 1000;
+
+  // The errors are the ones of cmdServiceReq.
+  cmdServiceReqRepeat(nullptr, g_intType.c_str(), g_intType.c_str(),
+    kTimeout, g_reqData.c_str(), 10, 2);
+  EXPECT_EQ(stdErrBuffer.str(), "Service name is null\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  cmdServiceReqRepeat(g_service.c_str(), g_intType.c_str(), g_intType.c_str(),
+    kTimeout, g_reqData.c_str(), 0, 2);
+  EXPECT_EQ(stdErrBuffer.str(),
+    "The number of requests and the concurrency must be positive.\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  // srvEcho fails all the requests.
+  const std::string service = g_service + "_repeat";
+  transport::Node node;
+  EXPECT_TRUE(node.Advertise(service, srvEcho));
+
+  cmdServiceReqRepeat(service.c_str(), g_intType.c_str(), g_intType.c_str(),
+    kTimeout, g_reqData.c_str(), 20, 4);
+  const std::string output = stdOutBuffer.str();
+  EXPECT_EQ(0u, output.find(
+    "Requests: 20, succeeded 0, failed 20, timed out 0\n"));
+  EXPECT_NE(std::string::npos, output.find(" requests/s\n"));
+  EXPECT_NE(std::string::npos, output.find("Latency: min "));
+  EXPECT_NE(std::string::npos, output.find(" ms, p99.9 "));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  restoreIO();
+}
+
 //////////////////////////////////////////////////
 /// \brief Check cmdTopicEcho running the advertiser on a the same process.
 TEST(ignTest, cmdTopicEcho)
@@ -241,6 +346,112 @@ TEST(ignTest, cmdTopicEcho)
   restoreIO();
 }
 
+//////////////////////////////////////////////////
+/// \brief Check the output formats of cmdTopicEchoFormat.
+TEST(ignTest, cmdTopicEchoFormat)
+{
+  std::stringstream  stdOutBuffer;
+  std::stringstream  stdErrBuffer;
+  redirectIO(stdOutBuffer, stdErrBuffer);
+
+  cmdTopicEchoFormat(g_topic.c_str(), 0.0, 0, 42);
+  EXPECT_EQ(stdErrBuffer.str(), "Invalid echo format [42].\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  transport::Node node;
+  auto pub = node.Advertise<msgs::Int32>(g_topic);
+  ASSERT_TRUE(pub);
+
+  msgs::Int32 msg;
+  msg.set_data(10);
+  const std::string serialized = msg.SerializeAsString();
+
+  for (int format : {kTopicEchoRaw, kTopicEchoFramed, kTopicEchoJson})
+  {
+    std::atomic<bool> running{true};
+    std::thread publisher([&]()
+    {
+      while (running)
+      {
+        pub.Publish(msg);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    });
+
+    cmdTopicEchoFormat(g_topic.c_str(), -1, 3, format);
+    running = false;
+    publisher.join();
+
+    const std::string output = stdOutBuffer.str();
+    if (format == kTopicEchoRaw)
+    {
+      EXPECT_EQ(serialized + serialized + serialized, output);
+    }
+    else if (format == kTopicEchoFramed)
+    {
+      const std::string frame =
+        std::string(1, static_cast<char>(serialized.size())) +
+        std::string(3, '\0') + serialized;
+      EXPECT_EQ(frame + frame + frame, output);
+    }
+    else
+    {
+      EXPECT_EQ("{\"data\":10}\n{\"data\":10}\n{\"data\":10}\n", output);
+    }
+    EXPECT_TRUE(stdErrBuffer.str().empty());
+    clearIOStreams(stdOutBuffer, stdErrBuffer);
+  }
+
+  restoreIO();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check cmdTopicStats running the publisher on the same process.
+TEST(ignTest, cmdTopicStats)
+{
+  std::stringstream  stdOutBuffer;
+  std::stringstream  stdErrBuffer;
+  redirectIO(stdOutBuffer, stdErrBuffer);
+
+  // Requesting a null topic should trigger an error message.
+  cmdTopicStats(nullptr, 1.0, kTopicStatsAll);
+  EXPECT_EQ(stdErrBuffer.str(), "Invalid topic. Topic must not be empty.\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  cmdTopicStats("/", 1.0, kTopicStatsAll);
+  EXPECT_EQ(stdErrBuffer.str(), "Topic [/] is not valid.\n");
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  transport::Node node;
+  auto pub = node.Advertise<msgs::Int32>(g_topic);
+  ASSERT_TRUE(pub);
+
+  std::atomic<bool> running{true};
+  std::thread publisher([&]()
+  {
+    msgs::Int32 msg;
+    msg.set_data(10);
+    while (running)
+    {
+      pub.Publish(msg);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+
+  cmdTopicStats(g_topic.c_str(), 1.5, kTopicStatsRate | kTopicStatsSize);
+  running = false;
+  publisher.join();
+
+  const std::string output = stdOutBuffer.str();
+  EXPECT_NE(std::string::npos, output.find(g_topic + "\n"));
+  EXPECT_NE(std::string::npos, output.find("rate: "));
+  EXPECT_NE(std::string::npos, output.find("size: min 2.00 B"));
+  EXPECT_EQ(std::string::npos, output.find("bandwidth: "));
+  clearIOStreams(stdOutBuffer, stdErrBuffer);
+
+  restoreIO();
+}
+
 /////////////////////////////////////////////////
 /// Main
 int main(int argc, char **argv)
@@ -52,6 +52,12 @@ struct ServiceOptions
 
   /// \brief Timeout to use when requesting (in milliseconds)
   int timeout{-1};
+
+  /// \brief Number of requests to issue and time
+  int count{0};
+
+  /// \brief Number of requests issued at the same time
+  int concurrency{1};
 };
 
 //////////////////////////////////////////////////
@@ -67,9 +73,19 @@ void runServiceCommand(const ServiceOptions &_opt)
       cmdServiceInfo(_opt.service.c_str());
       break;
     case ServiceCommand::kServiceReq:
-      cmdServiceReq(_opt.service.c_str(),
-          _opt.reqType.c_str(), _opt.repType.c_str(),
-          _opt.timeout, _opt.reqData.c_str());
+      if (_opt.count > 0)
+      {
+        cmdServiceReqRepeat(_opt.service.c_str(),
+            _opt.reqType.c_str(), _opt.repType.c_str(),
+            _opt.timeout, _opt.reqData.c_str(), _opt.count,
+            _opt.concurrency);
+      }
+      else
+      {
+        cmdServiceReq(_opt.service.c_str(),
+            _opt.reqType.c_str(), _opt.repType.c_str(),
+            _opt.timeout, _opt.reqData.c_str());
+      }
       break;
     case ServiceCommand::kNone:
     default:
@@ -92,6 +108,12 @@ void addServiceFlags(CLI::App &_app)
                                     opt->repType, "Type of a response.");
   auto timeoutOpt = _app.add_option("--timeout",
                                     opt->timeout, "Timeout in milliseconds.");
+  auto countOpt = _app.add_option("-n,--num", opt->count,
+    "Number of requests to issue, printing their latency and throughput "
+    "instead of the response.");
+  _app.add_option("-c,--concurrency", opt->concurrency,
+    "Number of requests issued at the same time with --num.")
+    ->needs(countOpt);
 
   auto command = _app.add_option_group("command", "Command to be executed");
   command->add_flag_callback("-l,--list",
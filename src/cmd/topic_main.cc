@@ -29,7 +29,8 @@ enum class TopicCommand
   kTopicList,
   kTopicInfo,
   kTopicPub,
-  kTopicEcho
+  kTopicEcho,
+  kTopicStats
 };
 
 //////////////////////////////////////////////////
@@ -53,6 +54,21 @@ struct TopicOptions
 
   /// \brief Number of messages to echo
   int count{-1};
+
+  /// \brief Statistics to print, a combination of TopicStatsFields
+  int statsFields{kTopicStatsAll};
+
+  /// \brief Output format of the echo, one of TopicEchoFormat
+  int echoFormat{kTopicEchoText};
+
+  /// \brief Messages per second to publish repeatedly
+  double rate{0};
+
+  /// \brief Size of the messages to publish repeatedly
+  int size{0};
+
+  /// \brief Publish repeatedly as fast as possible
+  bool flood{false};
 };
 
 //////////////////////////////////////////////////
@@ -68,12 +84,28 @@ void runTopicCommand(const TopicOptions &_opt)
       cmdTopicInfo(_opt.topic.c_str());
       break;
     case TopicCommand::kTopicPub:
-      cmdTopicPub(_opt.topic.c_str(),
-                  _opt.msgType.c_str(),
-                  _opt.msgData.c_str());
+      if (_opt.flood || _opt.rate > 0 || _opt.count > 0 || _opt.size > 0)
+      {
+        // Without --flood, the messages are published at 1 Hz by default.
+        cmdTopicPubRepeat(_opt.topic.c_str(),
+                          _opt.msgType.c_str(),
+                          _opt.msgData.c_str(),
+                          _opt.flood ? 0 : (_opt.rate > 0 ? _opt.rate : 1),
+                          _opt.count, _opt.duration, _opt.size);
+      }
+      else
+      {
+        cmdTopicPub(_opt.topic.c_str(),
+                    _opt.msgType.c_str(),
+                    _opt.msgData.c_str());
+      }
       break;
     case TopicCommand::kTopicEcho:
-      cmdTopicEcho(_opt.topic.c_str(), _opt.duration, _opt.count);
+      cmdTopicEchoFormat(_opt.topic.c_str(), _opt.duration, _opt.count,
+                         _opt.echoFormat);
+      break;
+    case TopicCommand::kTopicStats:
+      cmdTopicStats(_opt.topic.c_str(), _opt.duration, _opt.statsFields);
       break;
     case TopicCommand::kNone:
     default:
@@ -87,8 +119,9 @@ void addTopicFlags(CLI::App &_app)
 {
   auto opt = std::make_shared<TopicOptions>();
 
-  auto topicOpt = _app.add_option("-t,--topic",
-                                  opt->topic, "Name of a topic");
+  auto topicOpt = _app.add_option("-t,--topic", opt->topic,
+    "Name of a topic, or a pattern with '*' and '?' for --stats, --hz and "
+    "--bw");
   auto msgTypeOpt = _app.add_option("-m,--msgtype",
                                     opt->msgType, "Type of message to publish");
   auto durationOpt = _app.add_option("-d,--duration",
@@ -96,7 +129,32 @@ void addTopicFlags(CLI::App &_app)
                                      "Duration (seconds) to run");
   auto countOpt = _app.add_option("-n,--num",
                                   opt->count,
-                                  "Numer of messages to echo and then exit");
+                                  "Numer of messages to echo or publish and "
+                                  "then exit");
+  auto rateOpt = _app.add_option("-r,--rate", opt->rate,
+    "Messages per second to publish with --pub, which publishes repeatedly");
+  _app.add_option("-s,--size", opt->size,
+    "Size (bytes) of the messages of --pub, which publishes repeatedly. The "
+    "messages are padded with a field unknown to the subscribers");
+  auto floodOpt = _app.add_flag("--flood", opt->flood,
+    "Publish --pub repeatedly as fast as possible and print the throughput");
+  floodOpt->excludes(rateOpt);
+
+  _app.add_option_function<std::string>("-f,--format",
+      [opt](const std::string &_format){
+        if (_format == "raw")
+          opt->echoFormat = kTopicEchoRaw;
+        else if (_format == "framed")
+          opt->echoFormat = kTopicEchoFramed;
+        else if (_format == "json")
+          opt->echoFormat = kTopicEchoJson;
+        else
+          opt->echoFormat = kTopicEchoText;
+      },
+      "Output format of --echo: text, raw (serialized messages), framed "
+      "(serialized messages after their 32 bit little endian size) or json "
+      "(one object per line)")
+    ->check(CLI::IsMember({"text", "raw", "framed", "json"}));
 
   durationOpt->excludes(countOpt);
   countOpt->excludes(durationOpt);
@@ -119,6 +177,30 @@ void addTopicFlags(CLI::App &_app)
       opt->command = TopicCommand::kTopicEcho;
     });
 
+  command->add_flag_callback("--stats",
+    [opt](){
+      opt->command = TopicCommand::kTopicStats;
+      opt->statsFields = kTopicStatsAll;
+    })
+    ->needs(topicOpt)
+    ->excludes(countOpt);
+
+  command->add_flag_callback("--hz",
+    [opt](){
+      opt->command = TopicCommand::kTopicStats;
+      opt->statsFields = kTopicStatsRate;
+    })
+    ->needs(topicOpt)
+    ->excludes(countOpt);
+
+  command->add_flag_callback("--bw",
+    [opt](){
+      opt->command = TopicCommand::kTopicStats;
+      opt->statsFields = kTopicStatsBandwidth | kTopicStatsSize;
+    })
+    ->needs(topicOpt)
+    ->excludes(countOpt);
+
   command->add_option_function<std::string>("-p,--pub",
       [opt](const std::string &_msgData){
         opt->command = TopicCommand::kTopicPub;
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <poll.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "gtest/gtest.h"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+static std::string partition; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief With IGN_TRANSPORT_MANUAL_SPIN, the callbacks only run when the
+/// application spins, in its own thread.
+TEST(ManualSpinTest, LocalPubSub)
+{
+  transport::Node node;
+  int received = 0;
+  std::thread::id callbackThread;
+  std::function<void(const msgs::Int32 &)> cb =
+    [&](const msgs::Int32 &)
+    {
+      ++received;
+      callbackThread = std::this_thread::get_id();
+    };
+
+  auto pub = node.Advertise<msgs::Int32>("/manual_spin");
+  ASSERT_TRUE(pub);
+  ASSERT_TRUE(node.Subscribe("/manual_spin", cb));
+
+  msgs::Int32 msg;
+  msg.set_data(5);
+  EXPECT_TRUE(pub.Publish(msg));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(0, received);
+
+  // The local message is dispatched right away.
+  EXPECT_TRUE(transport::spinOnce(std::chrono::milliseconds(1000)));
+  EXPECT_EQ(1, received);
+  EXPECT_EQ(std::this_thread::get_id(), callbackThread);
+
+  // Nothing else to do.
+  while (transport::spinOnce())
+    ;
+  EXPECT_EQ(1, received);
+}
+
+//////////////////////////////////////////////////
+/// \brief The descriptors become readable when there is something to spin,
+/// such as a message published by another thread.
+TEST(ManualSpinTest, Descriptors)
+{
+  const std::vector<int> fds = transport::spinDescriptors();
+  ASSERT_FALSE(fds.empty());
+
+  transport::Node node;
+  int received = 0;
+  std::function<void(const msgs::Int32 &)> cb =
+    [&received](const msgs::Int32 &) {++received;};
+  auto pub = node.Advertise<msgs::Int32>("/manual_spin_fds");
+  ASSERT_TRUE(pub);
+  ASSERT_TRUE(node.Subscribe("/manual_spin_fds", cb));
+  while (transport::spinOnce())
+    ;
+
+  std::thread publisher([&pub]()
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      msgs::Int32 msg;
+      msg.set_data(5);
+      pub.Publish(msg);
+    });
+
+  std::vector<pollfd> items;
+  for (const int fd : fds)
+    items.push_back({fd, POLLIN, 0});
+
+  const auto deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (received == 0 && std::chrono::steady_clock::now() < deadline)
+  {
+    poll(items.data(), items.size(), 100);
+    while (transport::spinOnce())
+      ;
+  }
+  publisher.join();
+  EXPECT_EQ(1, received);
+}
+
+//////////////////////////////////////////////////
+/// \brief A publisher with a full local queue and the BLOCK policy doesn't
+/// wait for the queue to drain when the application spins, since it's the
+/// thread that drains it. The messages beyond the depth are dropped.
+TEST(ManualSpinTest, BlockingQueueDoesNotDeadlock)
+{
+  transport::Node node;
+  int received = 0;
+  std::function<void(const msgs::Int32 &)> cb =
+    [&received](const msgs::Int32 &) {++received;};
+
+  transport::AdvertiseMessageOptions opts;
+  opts.SetLocalQueueDepth(2);
+  opts.SetOverflowPolicy(transport::QueueOverflowPolicy_t::BLOCK);
+  auto pub = node.Advertise<msgs::Int32>("/manual_spin_block", opts);
+  ASSERT_TRUE(pub);
+  ASSERT_TRUE(node.Subscribe("/manual_spin_block", cb));
+  while (transport::spinOnce())
+    ;
+
+  // Publish past the depth from the thread that spins.
+  const auto start = std::chrono::steady_clock::now();
+  msgs::Int32 msg;
+  for (int i = 0; i < 5; ++i)
+  {
+    msg.set_data(i);
+    EXPECT_TRUE(pub.Publish(msg));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+    std::chrono::seconds(1));
+  EXPECT_EQ(3u, pub.DroppedLocalMessages());
+
+  while (transport::spinOnce())
+    ;
+  EXPECT_EQ(2, received);
+
+  // There is room again once the queue is drained.
+  EXPECT_TRUE(pub.Publish(msg));
+  while (transport::spinOnce())
+    ;
+  EXPECT_EQ(3, received);
+  EXPECT_EQ(3u, pub.DroppedLocalMessages());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  // The application spins, it has to be set before the first node.
+  setenv("IGN_TRANSPORT_MANUAL_SPIN", "1", 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
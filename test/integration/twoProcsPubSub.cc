@@ -15,8 +15,13 @@
  *
 */
 
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
 #include <chrono>
 #include <string>
+#include <vector>
 #include <ignition/msgs.hh>
 
 #include "gtest/gtest.h"
@@ -135,6 +140,58 @@ TEST(twoProcPubSub, PubSubTwoProcsThreeNodes)
   testing::waitAndCleanupFork(pi);
 }
 
+//////////////////////////////////////////////////
+/// \brief Wait for the subscribers of another process instead of sleeping.
+TEST(twoProcPubSub, WaitForSubscribers)
+{
+  transport::Node node;
+  auto pub = node.Advertise<ignition::msgs::Vector3d>(g_topic);
+  EXPECT_TRUE(pub);
+
+  // Nobody else yet.
+  EXPECT_TRUE(node.WaitForSubscribers(g_topic, 0,
+    std::chrono::milliseconds(0)));
+  EXPECT_FALSE(node.WaitForSubscribers(g_topic, 1,
+    std::chrono::milliseconds(100)));
+
+  std::string subscriberPath = testing::portablePathUnion(
+     IGN_TRANSPORT_TEST_DIR,
+     "INTEGRATION_twoProcsPubSubSubscriber_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(subscriberPath.c_str(),
+    partition.c_str());
+
+  EXPECT_TRUE(node.WaitForSubscribers(g_topic, 1,
+    std::chrono::milliseconds(5000)));
+  EXPECT_TRUE(pub.HasConnections());
+
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+/// \brief Wait for the publisher of another process instead of sleeping.
+TEST(twoProcPubSub, WaitForPublishers)
+{
+  transport::Node node;
+  EXPECT_FALSE(node.WaitForPublishers(g_topic, 1,
+    std::chrono::milliseconds(100)));
+
+  std::string publisherPath = testing::portablePathUnion(
+     IGN_TRANSPORT_TEST_DIR, "INTEGRATION_twoProcsPublisher_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(publisherPath.c_str(),
+    partition.c_str());
+
+  EXPECT_TRUE(node.WaitForPublishers(g_topic, 1,
+    std::chrono::milliseconds(5000)));
+
+  // There is a single publisher.
+  EXPECT_FALSE(node.WaitForPublishers(g_topic, 2,
+    std::chrono::milliseconds(100)));
+
+  testing::waitAndCleanupFork(pi);
+}
+
 //////////////////////////////////////////////////
 /// \brief This is the same as the last test, but we use PublishRaw(~) instead
 /// of Publish(~).
@@ -532,6 +589,56 @@ TEST(twoProcPubSub, TopicInfo)
   testing::waitAndCleanupFork(pi);
 }
 
+#ifndef _WIN32
+//////////////////////////////////////////////////
+/// \brief A publisher whose process stops answering the heartbeats of its
+/// connection is forgotten, without waiting for the silence interval of
+/// the discovery.
+TEST(twoProcPubSub, PublisherStopsHeartbeating)
+{
+  std::string publisherPath = testing::portablePathUnion(
+     IGN_TRANSPORT_TEST_DIR, "INTEGRATION_pub_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(publisherPath.c_str(),
+    partition.c_str());
+
+  reset();
+
+  transport::Node node;
+  EXPECT_TRUE(node.Subscribe(g_topic, cb));
+
+  // Wait until the subscriber is connected.
+  for (int i = 0; i < 50 && !cbExecuted; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_TRUE(cbExecuted);
+
+  std::vector<transport::MessagePublisher> publishers;
+  EXPECT_TRUE(node.TopicInfo(g_topic, publishers));
+  EXPECT_EQ(1u, publishers.size());
+
+  // The process is alive but doesn't answer anymore.
+  kill(pi, SIGSTOP);
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 100 && !publishers.empty(); ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    publishers.clear();
+    node.TopicInfo(g_topic, publishers);
+  }
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start);
+  EXPECT_TRUE(publishers.empty());
+
+  // The discovery alone would wait 3 seconds of silence.
+  EXPECT_LT(elapsed.count(), 2000);
+
+  kill(pi, SIGKILL);
+  reset();
+
+  testing::waitAndCleanupFork(pi);
+}
+#endif
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -15,8 +15,11 @@
  *
 */
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <ignition/msgs.hh>
 
 #include "ignition/transport/Node.hh"
@@ -163,6 +166,45 @@ TEST(twoProcSrvCallWithoutOutput, ServiceInfo)
   testing::waitAndCleanupFork(pi);
 }
 
+//////////////////////////////////////////////////
+/// \brief This test spawns a requester that sends a batch of requests to a
+/// service without output. The responder should run each request in order.
+TEST(twoProcSrvCallWithoutOutput, RequestBatch)
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<int> received;
+
+  std::function<void(const ignition::msgs::Int32 &)> advCb =
+    [&](const ignition::msgs::Int32 &_req)
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    received.push_back(_req.data());
+    cv.notify_all();
+  };
+
+  transport::Node node;
+  EXPECT_TRUE((node.Advertise<ignition::msgs::Int32>("/foo_batch", advCb)));
+
+  std::string requesterPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR,
+    "INTEGRATION_twoProcsSrvCallWithoutOutputBatch_aux");
+
+  testing::forkHandlerType pi = testing::forkAndRun(requesterPath.c_str(),
+    g_partition.c_str());
+
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    EXPECT_TRUE(cv.wait_for(lk, std::chrono::seconds(4),
+      [&received]{return received.size() >= 10u;}));
+    ASSERT_EQ(10u, received.size());
+    for (int i = 0; i < 10; ++i)
+      EXPECT_EQ(i, received[i]);
+  }
+
+  testing::waitAndCleanupFork(pi);
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
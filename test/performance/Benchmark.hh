@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGN_TRANSPORT_TEST_PERFORMANCE_BENCHMARK_HH_
+#define IGN_TRANSPORT_TEST_PERFORMANCE_BENCHMARK_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+/// \file Benchmark.hh
+/// \brief Helpers of the performance tests. The results are printed and
+/// recorded as properties of the running test, so they end up in the XML
+/// files of test_results/ and can be compared from one change to the next.
+
+namespace testing
+{
+  /// \brief Print and record a result of a benchmark.
+  /// \param[in] _name Name of the result, e.g. "publish_local_ns".
+  /// \param[in] _value The result.
+  /// \param[in] _unit Unit of the result, only printed.
+  inline void reportBenchmark(const std::string &_name, const double _value,
+      const std::string &_unit)
+  {
+    std::cout << "  " << std::left << std::setw(44) << _name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(1)
+              << _value << " " << _unit << std::endl;
+    ::testing::Test::RecordProperty(_name, std::to_string(_value));
+  }
+
+  /// \brief Time an operation. It runs in batches of doubling size until a
+  /// batch lasts at least _minTime, so the time of the clock calls is
+  /// negligible, and the time per operation of that batch is reported.
+  /// \param[in] _name Name of the result, "_ns" is appended.
+  /// \param[in] _op The operation.
+  /// \param[in] _minTime Minimum duration of the measured batch.
+  /// \return The time per operation in nanoseconds.
+  template<typename Op>
+  double benchmark(const std::string &_name, Op &&_op,
+      const std::chrono::nanoseconds &_minTime =
+        std::chrono::milliseconds(200))
+  {
+    for (uint64_t iterations = 1; ; iterations *= 2)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      for (uint64_t i = 0; i < iterations; ++i)
+        _op();
+      const auto elapsed = std::chrono::steady_clock::now() - start;
+
+      if (elapsed >= _minTime || iterations >= (uint64_t(1) << 32))
+      {
+        const double ns = static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+            elapsed).count()) / static_cast<double>(iterations);
+        reportBenchmark(_name + "_ns", ns, "ns/op");
+        return ns;
+      }
+    }
+  }
+}
+
+#endif
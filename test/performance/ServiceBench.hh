@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGN_TRANSPORT_TEST_PERFORMANCE_SERVICEBENCH_HH_
+#define IGN_TRANSPORT_TEST_PERFORMANCE_SERVICEBENCH_HH_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+
+/// \file ServiceBench.hh
+/// \brief Services of the service call benchmarks, advertised by the
+/// benchmark itself for the requests within the process and by
+/// PERFORMANCE_benchReplier_aux for the requests to another process.
+
+namespace testing
+{
+  /// \brief Advertise the services of the benchmarks, with a suffix
+  /// telling where they are advertised ("_local" or "_remote"):
+  ///   /bench_echo<suffix>: replies with the request.
+  ///   /bench_oneway<suffix>: no reply, only counts the requests.
+  ///   /bench_oneway_count<suffix>: replies with the requests counted.
+  /// \param[in] _node Node advertising the services.
+  /// \param[in] _suffix Suffix of the service names.
+  /// \param[in, out] _count Counter of the requests of /bench_oneway.
+  /// \return True if all the services were advertised.
+  inline bool advertiseBenchServices(ignition::transport::Node &_node,
+      const std::string &_suffix, std::atomic<uint64_t> &_count)
+  {
+    std::function<bool(const ignition::msgs::Bytes &,
+      ignition::msgs::Bytes &)> echo =
+      [](const ignition::msgs::Bytes &_req, ignition::msgs::Bytes &_rep)
+      {
+        _rep = _req;
+        return true;
+      };
+    std::function<void(const ignition::msgs::Bytes &)> oneway =
+      [&_count](const ignition::msgs::Bytes &) {++_count;};
+    std::function<bool(ignition::msgs::UInt64 &)> count =
+      [&_count](ignition::msgs::UInt64 &_rep)
+      {
+        _rep.set_data(_count);
+        return true;
+      };
+
+    return _node.Advertise("/bench_echo" + _suffix, echo) &&
+           _node.Advertise("/bench_oneway" + _suffix, oneway) &&
+           _node.Advertise("/bench_oneway_count" + _suffix, count);
+  }
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief Remote publisher of the throughput benchmarks. It publishes as
+/// fast as it can on the topics with subscribers, and runs until it is
+/// killed, or for two minutes at most.
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "Partition name has not be passed as argument" << std::endl;
+    return -1;
+  }
+
+  // Set the partition name for this test.
+  setenv("IGN_PARTITION", argv[1], 1);
+
+  transport::Node node;
+  auto smallPub = node.Advertise<msgs::Bytes>("/bench_stream_small");
+  auto largePub = node.Advertise<msgs::Bytes>("/bench_stream_large");
+  if (!smallPub || !largePub)
+  {
+    std::cerr << "Error advertising the topics" << std::endl;
+    return -1;
+  }
+
+  msgs::Bytes smallMsg;
+  smallMsg.set_data(std::string(256, 'x'));
+  msgs::Bytes largeMsg;
+  largeMsg.set_data(std::string(65536, 'x'));
+
+  const auto end = std::chrono::steady_clock::now() + std::chrono::minutes(2);
+  while (std::chrono::steady_clock::now() < end)
+  {
+    bool published = false;
+    if (smallPub.HasConnections())
+      published = smallPub.Publish(smallMsg);
+    if (largePub.HasConnections())
+      published = largePub.Publish(largeMsg);
+    if (!published)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return 0;
+}
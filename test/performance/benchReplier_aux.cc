@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+#include "ServiceBench.hh"
+
+using namespace ignition;
+
+//////////////////////////////////////////////////
+/// \brief Remote replier of the service call benchmarks. It advertises the
+/// services requested to other processes and runs until it is killed, or
+/// for two minutes at most.
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "Partition name has not be passed as argument" << std::endl;
+    return -1;
+  }
+
+  // Set the partition name for this test.
+  setenv("IGN_PARTITION", argv[1], 1);
+
+  transport::Node node;
+  std::atomic<uint64_t> count{0};
+  if (!testing::advertiseBenchServices(node, "_remote", count))
+  {
+    std::cerr << "Error advertising the services" << std::endl;
+    return -1;
+  }
+
+  std::this_thread::sleep_for(std::chrono::minutes(2));
+  return 0;
+}
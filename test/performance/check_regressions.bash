@@ -0,0 +1,90 @@
+#!/bin/bash
+#
+# Compare the results of the performance tests with a baseline.
+#
+# Usage: check_regressions.bash <results dir> <baseline> <tolerance> [--update]
+#
+# The results are the properties recorded by testing::reportBenchmark() in
+# the XML files of the PERFORMANCE tests. Times (_ns, _us) and footprints
+# (_bytes, _threads) are better when lower, rates (_mbps, _msgps) when
+# higher. A result is a regression when it is worse than the baseline by
+# more than <tolerance> percent. The results missing from the baseline are
+# only reported. With --update, the baseline is replaced by the current
+# results instead.
+
+results_dir=$1
+baseline=$2
+tolerance=${3:-25}
+update=$4
+
+if [ -z "$results_dir" ] || [ -z "$baseline" ]; then
+  echo "Usage: $0 <results dir> <baseline> <tolerance> [--update]"
+  exit 2
+fi
+
+# Print the results as "name value" lines. Old versions of gtest record the
+# properties as attributes of the test cases, newer ones as elements.
+results() {
+  local name='[A-Za-z0-9_]+_(ns|us|mbps|msgps|bytes|threads)'
+  local value='[-+0-9.eE]+'
+  for file in "$results_dir"/PERFORMANCE_*.xml; do
+    [ -e "$file" ] || continue
+    grep -oE "$name=\"$value\"" "$file" |
+      sed -E 's/^(.*)="(.*)"$/\1 \2/'
+    grep -oE "<property name=\"$name\" value=\"$value\"" "$file" |
+      sed -E 's/^<property name="(.*)" value="(.*)"$/\1 \2/'
+  done | sort -k1,1 -u
+}
+
+current=$(results)
+if [ -z "$current" ]; then
+  echo "No performance results in [$results_dir]," \
+    "run the PERFORMANCE tests first"
+  exit 0
+fi
+
+if [ "$update" = "--update" ]; then
+  {
+    echo "# Baseline of the performance tests, see check_regressions.bash."
+    echo "# Recorded on $(uname -n), $(date -u +%Y-%m-%d)."
+    echo "$current"
+  } > "$baseline"
+  echo "Baseline [$baseline] updated with $(echo "$current" | wc -l) results"
+  exit 0
+fi
+
+[ -e "$baseline" ] || baseline=/dev/null
+echo "$current" | awk -v tolerance="$tolerance" '
+  FILENAME != "-" {
+    if ($1 !~ /^#/ && NF == 2)
+      base[$1] = $2
+    next
+  }
+  {
+    name = $1
+    value = $2 + 0
+    if (!(name in base)) {
+      printf "  %-44s %14.1f  (new)\n", name, value
+      next
+    }
+    ref = base[name] + 0
+    if (ref == 0)
+      next
+    change = 100 * (value - ref) / ref
+    lowerIsBetter = name ~ /_(ns|us|bytes|threads)$/
+    worse = lowerIsBetter ? change : -change
+    status = ""
+    if (worse > tolerance) {
+      status = "REGRESSION"
+      ++regressions
+    }
+    printf "  %-44s %14.1f %14.1f %+7.1f%%  %s\n", name, ref, value, change,
+      status
+  }
+  END {
+    if (regressions > 0) {
+      printf "%d result(s) worse than the baseline by more than %s%%\n",
+        regressions, tolerance
+      exit 1
+    }
+  }' "$baseline" -
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+#include "Benchmark.hh"
+
+using namespace ignition;
+using namespace transport;
+
+/// \brief Topics, subscriptions and requests of each benchmark. Also the
+/// number of topics advertised by PERFORMANCE_benchAdvertiser_aux.
+static const int kCount = 1000;
+
+static std::string partition; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Resident set size of the process.
+/// \return The resident set size in bytes, or 0 if it couldn't be read.
+static int64_t residentBytes()
+{
+  std::ifstream statm("/proc/self/statm");
+  int64_t size = 0;
+  int64_t resident = 0;
+  if (!(statm >> size >> resident))
+    return 0;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+//////////////////////////////////////////////////
+/// \brief Number of threads of the process.
+/// \return The number of threads, or 0 if it couldn't be read.
+static int threadCount()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+  {
+    if (line.compare(0, 8, "Threads:") == 0)
+      return std::stoi(line.substr(8));
+  }
+  return 0;
+}
+
+//////////////////////////////////////////////////
+/// \brief Report the growth of the resident set size per item.
+/// \param[in] _name Name of the result, "_bytes" is appended.
+/// \param[in] _before Resident set size before creating the items.
+/// \param[in] _count Number of items.
+static void reportGrowth(const std::string &_name, const int64_t _before,
+    const int _count)
+{
+  const int64_t growth = std::max<int64_t>(0, residentBytes() - _before);
+  testing::reportBenchmark(_name + "_bytes",
+    static_cast<double>(growth) / _count, "bytes");
+}
+
+//////////////////////////////////////////////////
+/// \brief Memory and threads of the first node of the process, i.e. of the
+/// NodeShared singleton with its sockets, discoveries and threads. It must
+/// run first, before any other test creates a node.
+TEST(MemoryFootprint, FirstNode)
+{
+  const int threadsBefore = threadCount();
+  const int64_t before = residentBytes();
+  ASSERT_GT(before, 0);
+  {
+    Node node;
+    std::vector<std::string> topics;
+    node.TopicList(topics);
+    reportGrowth("footprint_first_node", before, 1);
+    testing::reportBenchmark("footprint_first_node_threads",
+      threadCount() - threadsBefore, "threads");
+  }
+
+  const int64_t beforeNodes = residentBytes();
+  std::vector<std::unique_ptr<Node>> nodes;
+  for (int i = 0; i < 100; ++i)
+    nodes.push_back(std::make_unique<Node>());
+  reportGrowth("footprint_node", beforeNodes, 100);
+}
+
+//////////////////////////////////////////////////
+/// \brief Memory per advertised topic, in the TopicStorage of the local
+/// discovery and in the publishers of the node.
+TEST(MemoryFootprint, AdvertisedTopic)
+{
+  Node node;
+  std::vector<Node::Publisher> publishers;
+  publishers.reserve(kCount);
+  const int64_t before = residentBytes();
+  for (int i = 0; i < kCount; ++i)
+  {
+    publishers.push_back(node.Advertise<msgs::Int32>(
+      "/bench_footprint_local_" + std::to_string(i)));
+    ASSERT_TRUE(publishers.back());
+  }
+  reportGrowth("footprint_advertised_topic", before, kCount);
+}
+
+//////////////////////////////////////////////////
+/// \brief Memory per subscription, in the HandlerStorage of NodeShared and
+/// in the node.
+TEST(MemoryFootprint, Subscription)
+{
+  Node node;
+  std::function<void(const msgs::Int32 &)> cb = [](const msgs::Int32 &){};
+  const int64_t before = residentBytes();
+  for (int i = 0; i < kCount; ++i)
+  {
+    ASSERT_TRUE(node.Subscribe(
+      "/bench_footprint_subscription_" + std::to_string(i), cb));
+  }
+  reportGrowth("footprint_subscription", before, kCount);
+}
+
+//////////////////////////////////////////////////
+/// \brief Memory per remote publisher stored by discovery. The publishers
+/// are advertised by another process, without subscribers, so there is no
+/// connection to them.
+TEST(MemoryFootprint, RemotePublisher)
+{
+  Node node;
+  std::vector<std::string> topics;
+  node.TopicList(topics);
+  const int64_t before = residentBytes();
+
+  const std::string advertiserPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR, "PERFORMANCE_benchAdvertiser_aux");
+  testing::forkHandlerType pi =
+    testing::forkAndRun(advertiserPath.c_str(), partition.c_str());
+
+  // A few datagrams may be dropped, so give up after a while.
+  int discovered = 0;
+  const auto deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (discovered < kCount && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    node.TopicList(topics);
+    discovered = static_cast<int>(std::count_if(topics.begin(),
+      topics.end(), [](const std::string &_topic)
+      {
+        return _topic.compare(0, 17, "/bench_footprint_") == 0 &&
+          _topic.find("_local_") == std::string::npos;
+      }));
+  }
+
+  EXPECT_GT(discovered, kCount / 2);
+  reportGrowth("footprint_remote_publisher", before, std::max(1, discovered));
+
+  testing::killFork(pi);
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+/// \brief Memory per asynchronous request waiting for a service that is
+/// never advertised, in the request storage of NodeShared.
+TEST(MemoryFootprint, PendingRequest)
+{
+  Node node;
+  std::function<void(const msgs::Int32 &, const bool)> cb =
+    [](const msgs::Int32 &, const bool){};
+  msgs::Int32 req;
+  req.set_data(42);
+  const int64_t before = residentBytes();
+  for (int i = 0; i < kCount; ++i)
+    ASSERT_TRUE(node.Request("/bench_footprint_pending", req, cb));
+  reportGrowth("footprint_pending_request", before, kCount);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
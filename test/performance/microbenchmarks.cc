@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/Discovery.hh"
+#include "ignition/transport/HandlerStorage.hh"
+#include "ignition/transport/MessageInfo.hh"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/NodeShared.hh"
+#include "ignition/transport/Publisher.hh"
+#include "ignition/transport/SubscriptionHandler.hh"
+#include "ignition/transport/TopicUtils.hh"
+#include "ignition/transport/TransportTypes.hh"
+#include "ignition/transport/Uuid.hh"
+#include "ignition/transport/test_config.h"
+#include "Benchmark.hh"
+
+using namespace ignition;
+using namespace transport;
+
+static std::string partition; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Start the remote subscriber of /bench_remote and /bench_mixed.
+/// \param[in] _pub A publisher of one of the topics, to wait for the
+/// subscriber.
+/// \return The subscriber process.
+static testing::forkHandlerType startRemoteSubscriber(
+    const Node::Publisher &_pub)
+{
+  const std::string subscriberPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR, "PERFORMANCE_benchSubscriber_aux");
+  testing::forkHandlerType pi =
+    testing::forkAndRun(subscriberPath.c_str(), partition.c_str());
+
+  for (int i = 0; i < 100 && !_pub.HasConnections(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  return pi;
+}
+
+//////////////////////////////////////////////////
+/// \brief Cost of Node::Publisher::Publish() with local subscribers only,
+/// with remote subscribers only, and with both.
+TEST(Microbenchmarks, Publish)
+{
+  Node node;
+  std::atomic<uint64_t> received{0};
+  std::function<void(const msgs::Int32 &)> cb =
+    [&received](const msgs::Int32 &) {++received;};
+  auto localPub = node.Advertise<msgs::Int32>("/bench_local");
+  auto remotePub = node.Advertise<msgs::Int32>("/bench_remote");
+  auto mixedPub = node.Advertise<msgs::Int32>("/bench_mixed");
+  ASSERT_TRUE(localPub && remotePub && mixedPub);
+  EXPECT_TRUE(node.Subscribe("/bench_local", cb));
+  EXPECT_TRUE(node.Subscribe("/bench_mixed", cb));
+
+  testing::forkHandlerType pi = startRemoteSubscriber(remotePub);
+  EXPECT_TRUE(remotePub.HasConnections());
+  EXPECT_TRUE(node.WaitForSubscribers("/bench_mixed", 1,
+    std::chrono::seconds(5)));
+
+  msgs::Int32 msg;
+  msg.set_data(42);
+  testing::benchmark("publish_local", [&]{localPub.Publish(msg);});
+  testing::benchmark("publish_remote", [&]{remotePub.Publish(msg);});
+  testing::benchmark("publish_mixed", [&]{mixedPub.Publish(msg);});
+  EXPECT_GT(received, 0u);
+
+  testing::killFork(pi);
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+/// \brief Cost of NodeShared::TriggerCallbacks() for a raw and a typed
+/// subscriber, i.e. of the dispatch of a received message.
+TEST(Microbenchmarks, TriggerCallbacks)
+{
+  Node node;
+  std::atomic<uint64_t> received{0};
+  std::function<void(const msgs::Int32 &)> cb =
+    [&received](const msgs::Int32 &) {++received;};
+  EXPECT_TRUE(node.Subscribe("/bench_trigger", cb));
+  EXPECT_TRUE(node.SubscribeRaw("/bench_trigger_raw",
+    [&received](const char *, const size_t, const MessageInfo &)
+    {
+      ++received;
+    }, msgs::Int32().GetTypeName()));
+
+  msgs::Int32 msg;
+  msg.set_data(42);
+  const std::string data = msg.SerializeAsString();
+  NodeShared *shared = NodeShared::Instance();
+
+  for (const std::string topic : {"/bench_trigger", "/bench_trigger_raw"})
+  {
+    std::string fullyQualifiedTopic;
+    ASSERT_TRUE(TopicUtils::FullyQualifiedName(partition, "", topic,
+      fullyQualifiedTopic));
+    MessageInfo info;
+    info.SetTopic(topic);
+    info.SetPartition(partition);
+    info.SetType(msg.GetTypeName());
+    const auto handlerInfo = shared->CheckHandlerInfo(fullyQualifiedTopic);
+
+    const uint64_t before = received;
+    testing::benchmark("trigger_callbacks" + topic.substr(strlen(
+      "/bench_trigger")), [&]
+      {
+        shared->TriggerCallbacks(info, data.data(), data.size(),
+          handlerInfo);
+      });
+    EXPECT_GT(received, before);
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Cost of TopicUtils::FullyQualifiedName(), called by every
+/// subscription, advertisement and service request.
+TEST(Microbenchmarks, FullyQualifiedName)
+{
+  std::string name;
+  testing::benchmark("fully_qualified_name", [&]
+    {
+      TopicUtils::FullyQualifiedName("partition", "/ns", "topic", name);
+    });
+  EXPECT_EQ("@/partition@/ns/topic", name);
+
+  testing::benchmark("fully_qualified_name_long", [&]
+    {
+      TopicUtils::FullyQualifiedName("robot_fleet_partition",
+        "/world/warehouse/model/robot_17",
+        "link/base_link/sensor/front_lidar/scan", name);
+    });
+  EXPECT_FALSE(name.empty());
+
+  // The names resolved by a node are cached.
+  Node node;
+  bool valid = true;
+  testing::benchmark("node_resolve", [&]
+    {
+      valid &= node.Resolve("link/base_link/sensor/front_lidar/scan").Valid();
+    });
+  EXPECT_TRUE(valid);
+}
+
+//////////////////////////////////////////////////
+/// \brief Cost of the creation and destruction of short lived nodes, with
+/// and without subscriptions.
+TEST(Microbenchmarks, NodeLifetime)
+{
+  const NodeOptions options;
+  testing::benchmark("node_create_destroy", [&]{Node node(options);});
+
+  std::function<void(const msgs::Int32 &)> cb = [](const msgs::Int32 &) {};
+  bool subscribed = true;
+  testing::benchmark("node_create_subscribe_destroy", [&]
+    {
+      Node node(options);
+      for (const std::string topic : {"/bench_life_a", "/bench_life_b"})
+        subscribed &= node.Subscribe(topic, cb);
+    });
+  EXPECT_TRUE(subscribed);
+}
+
+//////////////////////////////////////////////////
+/// \brief Cost of the creation of the UUIDs of the handlers, created by
+/// every subscription and service request, and of their representations.
+TEST(Microbenchmarks, Uuid)
+{
+  std::size_t size = 0;
+  testing::benchmark("uuid_create", [&]{size += Uuid().ToString().size();});
+
+  const Uuid uuid;
+  testing::benchmark("uuid_to_string", [&]{size += uuid.ToString().size();});
+  testing::benchmark("uuid_to_binary", [&]{size += uuid.ToBinary().size();});
+  EXPECT_GT(size, 0u);
+}
+
+//////////////////////////////////////////////////
+/// \brief Cost of the lookups of HandlerStorage with 100 topics, each one
+/// with a handler in each of 4 nodes.
+TEST(Microbenchmarks, HandlerStorage)
+{
+  HandlerStorage<ISubscriptionHandler> storage;
+  std::vector<std::string> nodes;
+  for (int i = 0; i < 4; ++i)
+    nodes.push_back(Uuid().ToString());
+  for (int i = 0; i < 100; ++i)
+  {
+    for (const auto &nUuid : nodes)
+    {
+      storage.AddHandler("@/partition@/topic_" + std::to_string(i), nUuid,
+        std::make_shared<SubscriptionHandler<msgs::Int32>>(nUuid));
+    }
+  }
+
+  const std::string topic = "@/partition@/topic_50";
+  const std::string type = msgs::Int32().GetTypeName();
+  std::map<std::string, std::map<std::string, ISubscriptionHandlerPtr>>
+    handlers;
+  ISubscriptionHandlerPtr handler;
+  bool found = true;
+  testing::benchmark("handler_storage_handlers",
+    [&]{found &= storage.Handlers(topic, handlers);});
+  testing::benchmark("handler_storage_first_handler",
+    [&]{found &= storage.FirstHandler(topic, type, handler);});
+  testing::benchmark("handler_storage_has_handlers",
+    [&]{found &= storage.HasHandlersForTopic(topic);});
+  EXPECT_TRUE(found);
+  EXPECT_EQ(4u, handlers.size());
+}
+
+//////////////////////////////////////////////////
+/// \brief Rate at which a discovery dispatches the advertisements sent by
+/// another one, through the loopback interface. It includes the cost of
+/// the UDP sockets, which the messages can't skip.
+TEST(Microbenchmarks, DiscoveryDispatch)
+{
+  const int port = 11329;
+  const std::string ip = "224.0.0.7";
+  const std::string pUuid1 = Uuid().ToString();
+  const std::string nUuid1 = Uuid().ToString();
+  Discovery<MessagePublisher> discovery1(pUuid1, ip, port);
+  Discovery<MessagePublisher> discovery2(Uuid().ToString(), ip, port);
+
+  std::atomic<int> discovered{0};
+  discovery2.ConnectionsCb([&](const MessagePublisher &_pub)
+    {
+      if (_pub.PUuid() == pUuid1)
+        ++discovered;
+    });
+  discovery1.Start();
+  discovery2.Start();
+  discovery2.WaitForSnapshot(std::chrono::milliseconds(500));
+  discovered = 0;
+
+  const int count = 2000;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i)
+  {
+    MessagePublisher publisher("/bench_discovery_" + std::to_string(i),
+      "tcp://127.0.0.1:12345", "tcp://127.0.0.1:12346", pUuid1, nUuid1,
+      msgs::Int32().GetTypeName(), AdvertiseMessageOptions());
+    EXPECT_TRUE(discovery1.Advertise(publisher));
+  }
+
+  // A few datagrams may be dropped, so give up after a while.
+  const auto deadline = start + std::chrono::seconds(10);
+  while (discovered < count && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_GT(discovered, count / 2);
+  testing::reportBenchmark("discovery_dispatch_ns",
+    static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      elapsed).count()) / std::max(1, discovered.load()), "ns/msg");
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
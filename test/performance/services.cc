@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ignition/msgs.hh>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+#include "Benchmark.hh"
+#include "ServiceBench.hh"
+
+using namespace ignition;
+using namespace transport;
+
+static std::string partition; // NOLINT(*)
+
+/// \brief Timeout of each request, in milliseconds.
+static const unsigned int kTimeout = 5000;
+
+/// \brief Sizes of the requests and responses, in bytes.
+static const std::vector<std::size_t> kSizes = {16, 4096, 262144};
+
+/// \brief Numbers of requests in flight at the same time.
+static const std::vector<int> kConcurrency = {1, 4, 16};
+
+//////////////////////////////////////////////////
+/// \brief Number of requests timed for a payload size, so the big ones
+/// don't take too long.
+/// \param[in] _size Payload size.
+/// \return Number of requests.
+static int requestCount(const std::size_t _size)
+{
+  return _size > 4096u ? 200 : 2000;
+}
+
+//////////////////////////////////////////////////
+/// \brief Time a run of requests and report the time per request.
+/// \param[in] _name Name of the result, "_ns" is appended.
+/// \param[in] _count Number of requests of the run.
+/// \param[in] _run The run.
+template<typename Run>
+static void timeRequests(const std::string &_name, const int _count,
+    Run &&_run)
+{
+  const auto start = std::chrono::steady_clock::now();
+  _run();
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  testing::reportBenchmark(_name + "_ns", static_cast<double>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+    _count, "ns/req");
+}
+
+//////////////////////////////////////////////////
+/// \brief Fixture advertising the local services and starting the remote
+/// replier once for all the tests.
+class ServiceBenchmarks : public ::testing::Test
+{
+  /// \brief Start the remote replier and wait for its services.
+  public: static void SetUpTestCase()
+  {
+    node = new Node();
+    ASSERT_TRUE(testing::advertiseBenchServices(*node, "_local", count));
+
+    const std::string replierPath = testing::portablePathUnion(
+      IGN_TRANSPORT_TEST_DIR, "PERFORMANCE_benchReplier_aux");
+    replier = testing::forkAndRun(replierPath.c_str(), partition.c_str());
+
+    msgs::Bytes req;
+    msgs::Bytes rep;
+    bool result = false;
+    for (int i = 0; i < 50 && !result; ++i)
+      node->Request("/bench_echo_remote", req, 100u, rep, result);
+    ASSERT_TRUE(result);
+  }
+
+  /// \brief Stop the remote replier.
+  public: static void TearDownTestCase()
+  {
+    testing::killFork(replier);
+    testing::waitAndCleanupFork(replier);
+    delete node;
+    node = nullptr;
+  }
+
+  /// \brief Names of the services, without the "_local" or "_remote"
+  /// suffix, where a benchmark runs.
+  public: static std::vector<std::string> Suffixes()
+  {
+    return {"_local", "_remote"};
+  }
+
+  /// \brief Node advertising the local services.
+  public: static Node *node;
+
+  /// \brief Requests received by the local /bench_oneway_local.
+  public: static std::atomic<uint64_t> count;
+
+  /// \brief The remote replier.
+  public: static testing::forkHandlerType replier;
+};
+
+Node *ServiceBenchmarks::node = nullptr;
+std::atomic<uint64_t> ServiceBenchmarks::count{0};
+testing::forkHandlerType ServiceBenchmarks::replier;
+
+//////////////////////////////////////////////////
+/// \brief Blocking requests, with a thread and a node per request in
+/// flight.
+TEST_F(ServiceBenchmarks, Blocking)
+{
+  for (const std::string &suffix : Suffixes())
+  {
+    for (const std::size_t size : kSizes)
+    {
+      for (const int concurrency : kConcurrency)
+      {
+        const int perThread = requestCount(size) / concurrency;
+        std::atomic<int> failed{0};
+        msgs::Bytes req;
+        req.set_data(std::string(size, 'x'));
+
+        timeRequests("srv_blocking" + suffix + "_" + std::to_string(size) +
+          "B_c" + std::to_string(concurrency), perThread * concurrency, [&]
+          {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < concurrency; ++t)
+            {
+              threads.emplace_back([&]
+                {
+                  Node requester;
+                  msgs::Bytes rep;
+                  bool result;
+                  for (int i = 0; i < perThread; ++i)
+                  {
+                    if (!requester.Request("/bench_echo" + suffix, req,
+                          kTimeout, rep, result) || !result ||
+                        rep.data().size() != size)
+                    {
+                      ++failed;
+                    }
+                  }
+                });
+            }
+            for (auto &thread : threads)
+              thread.join();
+          });
+        EXPECT_EQ(0, failed);
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Asynchronous requests from a single thread, keeping a window of
+/// requests in flight.
+TEST_F(ServiceBenchmarks, Async)
+{
+  for (const std::string &suffix : Suffixes())
+  {
+    for (const std::size_t size : kSizes)
+    {
+      for (const int concurrency : kConcurrency)
+      {
+        const int total = requestCount(size);
+        int failed = 0;
+        msgs::Bytes req;
+        req.set_data(std::string(size, 'x'));
+
+        timeRequests("srv_async" + suffix + "_" + std::to_string(size) +
+          "B_c" + std::to_string(concurrency), total, [&]
+          {
+            std::deque<std::future<std::optional<msgs::Bytes>>> window;
+            auto join = [&]
+            {
+              auto &future = window.front();
+              if (!future.valid() || future.wait_for(
+                    std::chrono::milliseconds(kTimeout)) !=
+                  std::future_status::ready || !future.get())
+              {
+                ++failed;
+              }
+              window.pop_front();
+            };
+
+            for (int i = 0; i < total; ++i)
+            {
+              if (static_cast<int>(window.size()) >= concurrency)
+                join();
+              window.push_back(node->RequestFuture<msgs::Bytes, msgs::Bytes>(
+                "/bench_echo" + suffix, req));
+            }
+            while (!window.empty())
+              join();
+          });
+        EXPECT_EQ(0, failed);
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Oneway requests, timed until the replier counted all of them.
+TEST_F(ServiceBenchmarks, Oneway)
+{
+  for (const std::string &suffix : Suffixes())
+  {
+    for (const std::size_t size : kSizes)
+    {
+      const int total = requestCount(size);
+      msgs::Bytes req;
+      req.set_data(std::string(size, 'x'));
+      msgs::UInt64 counted;
+      bool result = false;
+
+      // Requests received before this run.
+      ASSERT_TRUE(node->Request("/bench_oneway_count" + suffix, kTimeout,
+        counted, result));
+      ASSERT_TRUE(result);
+      const uint64_t expected = counted.data() + total;
+
+      timeRequests("srv_oneway" + suffix + "_" + std::to_string(size) + "B",
+        total, [&]
+        {
+          for (int i = 0; i < total; ++i)
+            EXPECT_TRUE(node->Request("/bench_oneway" + suffix, req));
+
+          const auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(kTimeout);
+          while (counted.data() < expected &&
+                 std::chrono::steady_clock::now() < deadline)
+          {
+            node->Request("/bench_oneway_count" + suffix, kTimeout, counted,
+              result);
+          }
+        });
+      EXPECT_EQ(expected, counted.data());
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <ignition/msgs.hh>
+
+#include "gtest/gtest.h"
+#include "ignition/transport/Node.hh"
+#include "ignition/transport/test_config.h"
+#include "Benchmark.hh"
+
+using namespace ignition;
+using namespace transport;
+
+static std::string partition; // NOLINT(*)
+
+//////////////////////////////////////////////////
+/// \brief Throughput of a topic published by another process as fast as
+/// it can, with small and large messages, like the two process tests of
+/// test/integration.
+TEST(TwoProcsPubSub, Throughput)
+{
+  const std::string publisherPath = testing::portablePathUnion(
+    IGN_TRANSPORT_TEST_DIR, "PERFORMANCE_benchPublisher_aux");
+  testing::forkHandlerType pi =
+    testing::forkAndRun(publisherPath.c_str(), partition.c_str());
+
+  for (const std::string size : {"small", "large"})
+  {
+    const std::string topic = "/bench_stream_" + size;
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> bytes{0};
+    Node node;
+    ASSERT_TRUE(node.SubscribeRaw(topic,
+      [&](const char *, const std::size_t _size, const MessageInfo &)
+      {
+        bytes += _size;
+        ++received;
+      }));
+
+    // Wait for the connection and the publisher to reach its pace.
+    for (int i = 0; i < 500 && received == 0; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_GT(received, 0u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const uint64_t receivedBefore = received;
+    const uint64_t bytesBefore = bytes;
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+    testing::reportBenchmark("two_procs_" + size + "_msgps",
+      (received - receivedBefore) / seconds, "msg/s");
+    testing::reportBenchmark("two_procs_" + size + "_mbps",
+      (bytes - bytesBefore) / 1e6 / seconds, "MB/s");
+    EXPECT_TRUE(node.Unsubscribe(topic));
+  }
+
+  testing::killFork(pi);
+  testing::waitAndCleanupFork(pi);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Get a random partition name.
+  partition = testing::getRandomNumber();
+
+  // Set the partition name for this process.
+  setenv("IGN_PARTITION", partition.c_str(), 1);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}